@@ -17,6 +17,14 @@
 
 package com.google.zetasql;
 
+import static java.nio.charset.StandardCharsets.UTF_8;
+
+import com.google.common.collect.ImmutableList;
+import com.google.common.util.concurrent.Futures;
+import com.google.common.util.concurrent.ListenableFuture;
+import com.google.common.util.concurrent.MoreExecutors;
+import com.google.zetasql.LocalService.AnalyzeBatchRequest;
+import com.google.zetasql.LocalService.AnalyzeBatchResponse;
 import com.google.zetasql.LocalService.AnalyzeRequest;
 import com.google.zetasql.LocalService.AnalyzeResponse;
 import com.google.zetasql.LocalService.BuildSqlRequest;
@@ -24,12 +32,14 @@ import com.google.zetasql.LocalService.BuildSqlResponse;
 import com.google.zetasql.LocalService.ExtractTableNamesFromStatementRequest;
 import com.google.zetasql.LocalService.ExtractTableNamesFromStatementResponse;
 import com.google.zetasql.LocalService.RegisteredParseResumeLocationProto;
+import com.google.zetasql.resolvedast.DeserializationHelper;
 import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedExpr;
 import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedStatement;
 import io.grpc.StatusRuntimeException;
 import java.io.Serializable;
 import java.util.ArrayList;
 import java.util.List;
+import javax.annotation.Nullable;
 
 /** The Analyzer class provides static methods to analyze ZetaSQL statements or expressions. */
 public class Analyzer implements Serializable {
@@ -64,6 +74,108 @@ public class Analyzer implements Serializable {
         catalog, fileDescriptorSetsBuilder, response);
   }
 
+  public ListenableFuture<ResolvedStatement> analyzeStatementAsync(String sql) {
+    return analyzeStatementAsync(sql, options, catalog);
+  }
+
+  /**
+   * Same as {@link #analyzeStatement(String, AnalyzerOptions, SimpleCatalog)}, but does not wait
+   * for the server. The request is serialized by the calling thread, and the returned future fails
+   * with a SqlException if the analysis fails. {@code catalog} must not be modified until the
+   * future is done.
+   */
+  public static ListenableFuture<ResolvedStatement> analyzeStatementAsync(
+      String sql, AnalyzerOptions options, SimpleCatalog catalog) {
+    AnalyzeRequest.Builder request = AnalyzeRequest.newBuilder().setSqlStatement(sql);
+
+    FileDescriptorSetsBuilder fileDescriptorSetsBuilder =
+        AnalyzerHelper.serializeSimpleCatalog(catalog, options, request);
+
+    return Futures.transform(
+        Client.withSqlExceptions(Client.getFutureStub().analyze(request.build())),
+        response ->
+            AnalyzerHelper.deserializeResolvedStatement(
+                catalog, fileDescriptorSetsBuilder, response),
+        MoreExecutors.directExecutor());
+  }
+
+  /** The result of the analysis of one statement of {@link #analyzeStatements}. */
+  public static final class StatementResult {
+    @Nullable private final ResolvedStatement resolvedStatement;
+    @Nullable private final SqlException error;
+
+    private StatementResult(
+        @Nullable ResolvedStatement resolvedStatement, @Nullable SqlException error) {
+      this.resolvedStatement = resolvedStatement;
+      this.error = error;
+    }
+
+    /** Returns true if the statement was analyzed successfully. */
+    public boolean isOk() {
+      return error == null;
+    }
+
+    /** Returns the resolved statement, or throws the error of the analysis if it failed. */
+    public ResolvedStatement getResolvedStatement() {
+      if (error != null) {
+        throw error;
+      }
+      return resolvedStatement;
+    }
+
+    /** Returns the error of the analysis, or null if it succeeded. */
+    @Nullable
+    public SqlException getError() {
+      return error;
+    }
+  }
+
+  public ImmutableList<StatementResult> analyzeStatements(List<String> sqls, int maxParallelism) {
+    return analyzeStatements(sqls, options, catalog, maxParallelism);
+  }
+
+  /**
+   * Analyzes all of {@code sqls} with one call of the server, which is cheaper than a call of
+   * {@link #analyzeStatement(String, AnalyzerOptions, SimpleCatalog)} for each statement,
+   * especially if {@code catalog} is not registered. Returns the results in the order of {@code
+   * sqls}. A statement that fails to analyze does not fail the others: its result holds the error
+   * instead. If {@code maxParallelism} is greater than 1, the server analyzes up to that many
+   * statements at once.
+   */
+  public static ImmutableList<StatementResult> analyzeStatements(
+      List<String> sqls, AnalyzerOptions options, SimpleCatalog catalog, int maxParallelism) {
+    AnalyzeBatchRequest.Builder request =
+        AnalyzeBatchRequest.newBuilder()
+            .addAllSqlStatement(sqls)
+            .setMaxParallelism(maxParallelism);
+
+    FileDescriptorSetsBuilder fileDescriptorSetsBuilder =
+        AnalyzerHelper.serializeSimpleCatalog(catalog, options, request);
+
+    AnalyzeBatchResponse response;
+    try {
+      response = Client.getStub().analyzeBatch(request.build());
+    } catch (StatusRuntimeException e) {
+      throw new SqlException(e);
+    }
+
+    DeserializationHelper deserializationHelper =
+        AnalyzerHelper.getDesializationHelper(catalog, fileDescriptorSetsBuilder);
+    ImmutableList.Builder<StatementResult> results = ImmutableList.builder();
+    for (AnalyzeBatchResponse.Result result : response.getResultList()) {
+      if (result.hasResolvedStatement()) {
+        results.add(
+            new StatementResult(
+                ResolvedStatement.deserialize(
+                    result.getResolvedStatement(), deserializationHelper),
+                null));
+      } else {
+        results.add(new StatementResult(null, new SqlException(result.getErrorMessage())));
+      }
+    }
+    return results.build();
+  }
+
   public static ResolvedExpr analyzeExpression(
       String expression, AnalyzerOptions options, SimpleCatalog catalog) {
     AnalyzeRequest.Builder request = AnalyzeRequest.newBuilder().setSqlExpression(expression);
@@ -82,6 +194,25 @@ public class Analyzer implements Serializable {
         catalog, fileDescriptorSetsBuilder, response);
   }
 
+  /**
+   * Same as {@link #analyzeExpression}, but does not wait for the server, like {@link
+   * #analyzeStatementAsync(String, AnalyzerOptions, SimpleCatalog)}.
+   */
+  public static ListenableFuture<ResolvedExpr> analyzeExpressionAsync(
+      String expression, AnalyzerOptions options, SimpleCatalog catalog) {
+    AnalyzeRequest.Builder request = AnalyzeRequest.newBuilder().setSqlExpression(expression);
+
+    FileDescriptorSetsBuilder fileDescriptorSetsBuilder =
+        AnalyzerHelper.serializeSimpleCatalog(catalog, options, request);
+
+    return Futures.transform(
+        Client.withSqlExceptions(Client.getFutureStub().analyze(request.build())),
+        response ->
+            AnalyzerHelper.deserializeResolvedExpression(
+                catalog, fileDescriptorSetsBuilder, response),
+        MoreExecutors.directExecutor());
+  }
+
   /**
    * Renders expression as a sql string.
    *
@@ -143,6 +274,25 @@ public class Analyzer implements Serializable {
    *     naming structure.
    */
   public static List<List<String>> extractTableNamesFromStatement(String sql) {
+    ClientChannelProvider.DirectCalls directCalls = Client.getDirectCalls();
+    if (directCalls != null) {
+      byte[][][] names;
+      try {
+        names = directCalls.extractTableNamesFromStatement(sql.getBytes(UTF_8));
+      } catch (IllegalArgumentException e) {
+        throw new SqlException(e.getMessage());
+      }
+      ArrayList<List<String>> result = new ArrayList<>(names.length);
+      for (byte[][] name : names) {
+        ArrayList<String> nameList = new ArrayList<>(name.length);
+        for (byte[] segment : name) {
+          nameList.add(new String(segment, UTF_8));
+        }
+        result.add(nameList);
+      }
+      return result;
+    }
+
     ExtractTableNamesFromStatementRequest request =
         ExtractTableNamesFromStatementRequest.newBuilder().setSqlStatement(sql).build();
 
@@ -18,6 +18,7 @@
 package com.google.zetasql;
 
 import com.google.common.collect.ImmutableList;
+import com.google.zetasql.LocalService.AnalyzeBatchRequest;
 import com.google.zetasql.LocalService.AnalyzeRequest;
 import com.google.zetasql.LocalService.AnalyzeResponse;
 import com.google.zetasql.LocalService.BuildSqlRequest;
@@ -54,6 +55,23 @@ class AnalyzerHelper {
     return fileDescriptorSetsBuilder;
   }
 
+  /** Same as above, for all the statements of a batch. */
+  public static FileDescriptorSetsBuilder serializeSimpleCatalog(
+      SimpleCatalog catalog, AnalyzerOptions options, AnalyzeBatchRequest.Builder request) {
+    FileDescriptorSetsBuilder fileDescriptorSetsBuilder;
+    if (catalog.isRegistered()) {
+      fileDescriptorSetsBuilder = catalog.getRegisteredFileDescriptorSetsBuilder();
+      request.setRegisteredCatalogId(catalog.getRegisteredId());
+      request.setOptions(options.serialize(fileDescriptorSetsBuilder));
+    } else {
+      fileDescriptorSetsBuilder = new FileDescriptorSetsBuilder();
+      request.setSimpleCatalog(catalog.serialize(fileDescriptorSetsBuilder));
+      request.setOptions(options.serialize(fileDescriptorSetsBuilder));
+      request.addAllFileDescriptorSet(fileDescriptorSetsBuilder.build());
+    }
+    return fileDescriptorSetsBuilder;
+  }
+
   /**
    * Includes a hack to allow DatePart enums to be properly serialized, however this doesn't support
    * registered catalogs.
@@ -17,17 +17,160 @@
 
 package com.google.zetasql;
 
-/** Provides interface for accessing the client. */
+import com.google.common.util.concurrent.Futures;
+import com.google.common.util.concurrent.ListenableFuture;
+import com.google.common.util.concurrent.MoreExecutors;
+import io.grpc.Channel;
+import io.grpc.ClientInterceptors;
+import io.grpc.StatusRuntimeException;
+import java.nio.ByteBuffer;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * Provides interface for accessing the client. The calls are spread round-robin over the channels
+ * of the provider, and their latencies are recorded in {@link ClientMetrics}.
+ */
 final class Client {
-  private static ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceBlockingStub stub = null;
+  private static ClientChannelProvider provider = null;
+  private static volatile ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceBlockingStub[] stubs = null;
+  private static volatile ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceFutureStub[] futureStubs =
+      null;
+  // Written before loadedDirectCalls, which publishes it.
+  private static ClientChannelProvider.DirectCalls directCalls = null;
+  private static volatile boolean loadedDirectCalls = false;
+  private static final AtomicInteger nextStub = new AtomicInteger();
 
   private Client() {}
 
+  private static synchronized ClientChannelProvider getProvider() {
+    if (provider == null) {
+      provider = ClientChannelProvider.loadProvider();
+    }
+    return provider;
+  }
+
+  /** Creates a blocking and a future stub for each channel of the provider. */
+  private static synchronized void createStubs() {
+    if (stubs != null) {
+      return;
+    }
+    List<Channel> channels = getProvider().getChannels();
+    ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceBlockingStub[] newStubs =
+        new ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceBlockingStub[channels.size()];
+    ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceFutureStub[] newFutureStubs =
+        new ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceFutureStub[channels.size()];
+    for (int i = 0; i < channels.size(); ++i) {
+      Channel channel = ClientInterceptors.intercept(channels.get(i), ClientMetrics.interceptor());
+      newStubs[i] = ZetaSqlLocalServiceGrpc.newBlockingStub(channel);
+      newFutureStubs[i] = ZetaSqlLocalServiceGrpc.newFutureStub(channel);
+    }
+    futureStubs = newFutureStubs;
+    stubs = newStubs;
+  }
+
+  /** Returns the index of the channel of the next call. */
+  private static int nextStubIndex(int numStubs) {
+    return Math.floorMod(nextStub.getAndIncrement(), numStubs);
+  }
+
   /** Returns the stub that can be used to call RPC of the ZetaSQL server. */
-  static synchronized ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceBlockingStub getStub() {
-    if (stub == null) {
-      stub = ZetaSqlLocalServiceGrpc.newBlockingStub(ClientChannelProvider.loadChannel());
+  static ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceBlockingStub getStub() {
+    if (stubs == null) {
+      createStubs();
+    }
+    ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceBlockingStub[] currentStubs = stubs;
+    return currentStubs[nextStubIndex(currentStubs.length)];
+  }
+
+  /**
+   * Returns the stub that can be used to call RPC of the ZetaSQL server without blocking, so that
+   * a thread can have several calls in flight.
+   */
+  static ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceFutureStub getFutureStub() {
+    if (stubs == null) {
+      createStubs();
+    }
+    ZetaSqlLocalServiceGrpc.ZetaSqlLocalServiceFutureStub[] currentStubs = futureStubs;
+    return currentStubs[nextStubIndex(currentStubs.length)];
+  }
+
+  /** Returns {@code future}, failing with a SqlException instead of a StatusRuntimeException. */
+  static <T> ListenableFuture<T> withSqlExceptions(ListenableFuture<T> future) {
+    return Futures.catching(
+        future,
+        StatusRuntimeException.class,
+        e -> {
+          throw new SqlException(e);
+        },
+        MoreExecutors.directExecutor());
+  }
+
+  /**
+   * Returns the calls that bypass the stub for a ZetaSQL server in this process, or null if the
+   * server is not in this process.
+   */
+  static ClientChannelProvider.DirectCalls getDirectCalls() {
+    if (!loadedDirectCalls) {
+      loadDirectCalls();
+    }
+    return directCalls;
+  }
+
+  private static synchronized void loadDirectCalls() {
+    if (!loadedDirectCalls) {
+      ClientChannelProvider.DirectCalls calls = getProvider().getDirectCalls();
+      directCalls = calls == null ? null : new TimedDirectCalls(calls);
+      loadedDirectCalls = true;
+    }
+  }
+
+  /** Records the latencies of the direct calls in ClientMetrics. */
+  private static final class TimedDirectCalls implements ClientChannelProvider.DirectCalls {
+    private final ClientChannelProvider.DirectCalls calls;
+
+    TimedDirectCalls(ClientChannelProvider.DirectCalls calls) {
+      this.calls = calls;
+    }
+
+    @Override
+    public byte[] formatSql(byte[] sql) {
+      long startNanos = System.nanoTime();
+      boolean ok = false;
+      try {
+        byte[] result = calls.formatSql(sql);
+        ok = true;
+        return result;
+      } finally {
+        ClientMetrics.record("FormatSql", System.nanoTime() - startNanos, ok);
+      }
+    }
+
+    @Override
+    public byte[][][] extractTableNamesFromStatement(byte[] sql) {
+      long startNanos = System.nanoTime();
+      boolean ok = false;
+      try {
+        byte[][][] result = calls.extractTableNamesFromStatement(sql);
+        ok = true;
+        return result;
+      } finally {
+        ClientMetrics.record(
+            "ExtractTableNamesFromStatement", System.nanoTime() - startNanos, ok);
+      }
+    }
+
+    @Override
+    public byte[] evaluate(ByteBuffer request, int length) {
+      long startNanos = System.nanoTime();
+      boolean ok = false;
+      try {
+        byte[] result = calls.evaluate(request, length);
+        ok = true;
+        return result;
+      } finally {
+        ClientMetrics.record("Evaluate", System.nanoTime() - startNanos, ok);
+      }
     }
-    return stub;
   }
 }
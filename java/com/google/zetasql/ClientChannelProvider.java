@@ -18,19 +18,61 @@
 package com.google.zetasql;
 
 import io.grpc.Channel;
+import java.nio.ByteBuffer;
+import java.util.Collections;
+import java.util.List;
 import java.util.ServiceLoader;
 
 /** Provides a interface for accessing the client channel. */
 public interface ClientChannelProvider {
 
+  /**
+   * Calls of a ZetaSQL server in the same process that bypass the channel. Strings are passed as
+   * UTF-8 bytes. The calls throw an IllegalArgumentException with the error message if they fail.
+   */
+  interface DirectCalls {
+    /** Same as the FormatSql RPC. */
+    byte[] formatSql(byte[] sql);
+
+    /**
+     * Same as the ExtractTableNamesFromStatement RPC. Returns the segments of each table name.
+     */
+    byte[][][] extractTableNamesFromStatement(byte[] sql);
+
+    /**
+     * Same as the Evaluate RPC, with a serialized EvaluateRequest in the first {@code length}
+     * bytes of the direct buffer {@code request}. Returns the serialized EvaluateResponse.
+     */
+    byte[] evaluate(ByteBuffer request, int length);
+  }
+
   /** Returns the channel to ZetaSQL server. */
   Channel getChannel();
 
-  /** Returns the channel to ZetaSQL server from a Service implementation. */
-  static Channel loadChannel() {
+  /**
+   * Returns the channels to ZetaSQL server, over which the client spreads its calls so that
+   * concurrent calls do not queue on a single connection. Returns the channel of {@link
+   * #getChannel} by default.
+   */
+  default List<Channel> getChannels() {
+    return Collections.singletonList(getChannel());
+  }
+
+  /** Returns the direct calls of the ZetaSQL server, or null if it is not in this process. */
+  default DirectCalls getDirectCalls() {
+    return null;
+  }
+
+  /** Returns the first ClientChannelProvider from a Service implementation. */
+  static ClientChannelProvider loadProvider() {
     for (ClientChannelProvider provider : ServiceLoader.load(ClientChannelProvider.class)) {
-      return provider.getChannel();
+      return provider;
     }
     throw new IllegalStateException("No ZetaSQL ClientChannelProvider loaded.");
   }
+
+  /** Returns the channel to ZetaSQL server from a Service implementation. */
+  static Channel loadChannel() {
+    return loadProvider().getChannel();
+  }
 }
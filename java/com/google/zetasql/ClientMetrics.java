@@ -0,0 +1,161 @@
+/*
+ * Copyright 2019 ZetaSQL Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+package com.google.zetasql;
+
+import com.google.common.collect.ImmutableMap;
+import io.grpc.CallOptions;
+import io.grpc.Channel;
+import io.grpc.ClientCall;
+import io.grpc.ClientInterceptor;
+import io.grpc.ForwardingClientCall.SimpleForwardingClientCall;
+import io.grpc.ForwardingClientCallListener.SimpleForwardingClientCallListener;
+import io.grpc.Metadata;
+import io.grpc.MethodDescriptor;
+import io.grpc.Status;
+import java.time.Duration;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.LongAdder;
+
+/**
+ * Latency metrics of the calls of the ZetaSQL server by this process, by method (e.g., "Analyze",
+ * "Evaluate"). Both the RPCs and the direct calls of a server in this process are counted.
+ */
+public final class ClientMetrics {
+
+  /** The metrics of the calls of one method. */
+  public static final class MethodMetrics {
+    private final long callCount;
+    private final long errorCount;
+    private final Duration totalLatency;
+    private final Duration maxLatency;
+
+    private MethodMetrics(
+        long callCount, long errorCount, Duration totalLatency, Duration maxLatency) {
+      this.callCount = callCount;
+      this.errorCount = errorCount;
+      this.totalLatency = totalLatency;
+      this.maxLatency = maxLatency;
+    }
+
+    /** Returns the number of completed calls. */
+    public long getCallCount() {
+      return callCount;
+    }
+
+    /** Returns the number of completed calls that failed. */
+    public long getErrorCount() {
+      return errorCount;
+    }
+
+    /** Returns the sum of the latencies of the completed calls. */
+    public Duration getTotalLatency() {
+      return totalLatency;
+    }
+
+    /** Returns the average latency of the completed calls. */
+    public Duration getAverageLatency() {
+      return callCount == 0 ? Duration.ZERO : totalLatency.dividedBy(callCount);
+    }
+
+    /** Returns the latency of the slowest completed call. */
+    public Duration getMaxLatency() {
+      return maxLatency;
+    }
+  }
+
+  /** Accumulates the metrics of one method. */
+  private static final class Recorder {
+    final LongAdder callCount = new LongAdder();
+    final LongAdder errorCount = new LongAdder();
+    final LongAdder totalNanos = new LongAdder();
+    final AtomicLong maxNanos = new AtomicLong();
+
+    void record(long nanos, boolean ok) {
+      callCount.increment();
+      if (!ok) {
+        errorCount.increment();
+      }
+      totalNanos.add(nanos);
+      maxNanos.accumulateAndGet(nanos, Math::max);
+    }
+
+    MethodMetrics snapshot() {
+      return new MethodMetrics(
+          callCount.sum(),
+          errorCount.sum(),
+          Duration.ofNanos(totalNanos.sum()),
+          Duration.ofNanos(maxNanos.get()));
+    }
+  }
+
+  private static final Map<String, Recorder> recorders = new ConcurrentHashMap<>();
+
+  private ClientMetrics() {}
+
+  /** Returns the metrics of each method that has been called, keyed by the method name. */
+  public static ImmutableMap<String, MethodMetrics> getMethodMetrics() {
+    ImmutableMap.Builder<String, MethodMetrics> metrics = ImmutableMap.builder();
+    for (Map.Entry<String, Recorder> entry : recorders.entrySet()) {
+      metrics.put(entry.getKey(), entry.getValue().snapshot());
+    }
+    return metrics.build();
+  }
+
+  /** Clears the metrics of all the methods. */
+  public static void reset() {
+    recorders.clear();
+  }
+
+  /** Records a call of {@code method} that took {@code nanos}. */
+  static void record(String method, long nanos, boolean ok) {
+    recorders.computeIfAbsent(method, m -> new Recorder()).record(nanos, ok);
+  }
+
+  /** Returns an interceptor that records the latency of the calls of a channel. */
+  static ClientInterceptor interceptor() {
+    return INTERCEPTOR;
+  }
+
+  private static final ClientInterceptor INTERCEPTOR =
+      new ClientInterceptor() {
+        @Override
+        public <ReqT, RespT> ClientCall<ReqT, RespT> interceptCall(
+            MethodDescriptor<ReqT, RespT> method, CallOptions callOptions, Channel next) {
+          String fullMethodName = method.getFullMethodName();
+          String methodName = fullMethodName.substring(fullMethodName.lastIndexOf('/') + 1);
+          return new SimpleForwardingClientCall<ReqT, RespT>(
+              next.newCall(method, callOptions)) {
+            @Override
+            public void start(Listener<RespT> responseListener, Metadata headers) {
+              long startNanos = System.nanoTime();
+              super.start(
+                  new SimpleForwardingClientCallListener<RespT>(responseListener) {
+                    @Override
+                    public void onClose(Status status, Metadata trailers) {
+                      record(methodName, System.nanoTime() - startNanos, status.isOk());
+                      super.onClose(status, trailers);
+                    }
+                  },
+                  headers);
+            }
+          };
+        }
+      };
+}
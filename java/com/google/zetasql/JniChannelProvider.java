@@ -29,13 +29,29 @@ import io.netty.util.concurrent.DefaultThreadFactory;
 import java.io.IOException;
 import java.net.InetSocketAddress;
 import java.net.SocketAddress;
+import java.nio.ByteBuffer;
 import java.nio.channels.SocketChannel;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
 
 /** Controller class of the ZetaSQL JniChannelProvider. */
 @AutoService(ClientChannelProvider.class)
 public class JniChannelProvider implements ClientChannelProvider {
   private static final InetSocketAddress ADDRESS = new InetSocketAddress(0);
-  private static Channel channel = null;
+  private static List<Channel> channels = null;
+
+  /**
+   * Returns the number of channels of the pool, from the zetasql.local_service.num_channels
+   * property. Defaults to the number of processors, up to 4.
+   */
+  private static int getNumChannels() {
+    String numChannels = System.getProperty("zetasql.local_service.num_channels");
+    if (numChannels != null) {
+      return Math.max(Integer.parseInt(numChannels), 1);
+    }
+    return Math.min(Runtime.getRuntime().availableProcessors(), 4);
+  }
 
   private static String getLibraryPath() {
     String path = System.getProperty("zetasql.local_service.path");
@@ -83,6 +99,32 @@ public class JniChannelProvider implements ClientChannelProvider {
   /** Returns a SocketChannel connected to the server. */
   private static native SocketChannel getSocketChannel() throws IOException;
 
+  private static native byte[] nativeFormatSql(byte[] sql);
+
+  private static native byte[][][] nativeExtractTableNamesFromStatement(byte[] sql);
+
+  private static native byte[] nativeEvaluate(ByteBuffer request, int length);
+
+  /** Calls the server through JNI instead of the channel. */
+  private static class JniDirectCalls implements DirectCalls {
+    @Override
+    public byte[] formatSql(byte[] sql) {
+      return nativeFormatSql(sql);
+    }
+
+    @Override
+    public byte[][][] extractTableNamesFromStatement(byte[] sql) {
+      return nativeExtractTableNamesFromStatement(sql);
+    }
+
+    @Override
+    public byte[] evaluate(ByteBuffer request, int length) {
+      return nativeEvaluate(request, length);
+    }
+  }
+
+  private static final DirectCalls DIRECT_CALLS = new JniDirectCalls();
+
   /** Wraps one end of a socketpair for NioSocketChannel. */
   protected static class SocketPairChannel extends NioSocketChannel {
 
@@ -131,26 +173,47 @@ public class JniChannelProvider implements ClientChannelProvider {
     }
   }
 
-  private synchronized Channel getChannelInternal() {
-    if (channel == null) {
+  /**
+   * Returns the pool of channels. Each channel has its own socketpair, and so its own connection to
+   * the server, and all of them share one event loop group.
+   */
+  private static synchronized List<Channel> getChannelsInternal() {
+    if (channels == null) {
       // The daemon flag tells the JVM to clean up on shutdown.
       DefaultThreadFactory threadFactory =
           new DefaultThreadFactory(/* poolType= */ "zetasqlJniChannel", /* daemon= */ true);
       NioEventLoopGroup eventLoopGroup =
           new NioEventLoopGroup(/* nThreads= */ 0, /* threadFactory= */ threadFactory);
-      channel =
-          NettyChannelBuilder.forAddress(ADDRESS)
-              .channelType(SocketPairChannel.class)
-              .eventLoopGroup(eventLoopGroup)
-              .usePlaintext()
-              .build();
-    }
-    return channel;
+      int numChannels = getNumChannels();
+      List<Channel> pool = new ArrayList<>(numChannels);
+      for (int i = 0; i < numChannels; ++i) {
+        pool.add(
+            NettyChannelBuilder.forAddress(ADDRESS)
+                .channelType(SocketPairChannel.class)
+                .eventLoopGroup(eventLoopGroup)
+                .usePlaintext()
+                .build());
+      }
+      channels = Collections.unmodifiableList(pool);
+    }
+    return channels;
   }
 
   /** Returns the channel that can be used to call RPC of the ZetaSQL server. */
   @Override
   public Channel getChannel() {
-    return getChannelInternal();
+    return getChannelsInternal().get(0);
+  }
+
+  /** Returns the pool of channels that can be used to call RPC of the ZetaSQL server. */
+  @Override
+  public List<Channel> getChannels() {
+    return getChannelsInternal();
+  }
+
+  /** Returns the calls of the ZetaSQL server that do not go through the channel. */
+  @Override
+  public DirectCalls getDirectCalls() {
+    return DIRECT_CALLS;
   }
 }
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2019 ZetaSQL Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+package com.google.zetasql;
+
+import static com.google.common.base.Preconditions.checkArgument;
+import static com.google.common.base.Preconditions.checkNotNull;
+import static com.google.common.base.Preconditions.checkState;
+
+import com.google.common.base.Strings;
+import com.google.common.collect.ImmutableList;
+import com.google.protobuf.ByteString;
+import com.google.protobuf.CodedInputStream;
+import com.google.protobuf.InvalidProtocolBufferException;
+import com.google.protobuf.UnsafeByteOperations;
+import com.google.protobuf.WireFormat;
+import com.google.zetasql.ZetaSQLType.TypeKind;
+import com.google.zetasql.ZetaSQLValue.ValueProto;
+import java.io.IOException;
+
+/**
+ * A read-only view of a serialized ValueProto that only decodes the parts that are read.
+ *
+ * <p>Value.deserialize() decodes a whole value eagerly, including all the fields of structs and
+ * all the elements of arrays. For wide structs or long arrays of which only a few fields or
+ * elements are read, a LazyValue avoids that: getField() and getElement() locate the serialized
+ * bytes of a field or element by skipping over the others, and return them as another LazyValue.
+ * toValue() decodes the value with Value.deserialize() once it is needed.
+ *
+ * <p>The serialized bytes are only checked when they are read, so errors in fields or elements
+ * that are never read are not detected.
+ *
+ * <p>This class is thread-safe.
+ */
+public final class LazyValue {
+  private final Type type;
+  private final ByteString bytes;
+  // The serialized fields of a struct or elements of an array, located on first use.
+  private volatile ImmutableList<ByteString> children;
+  // Decoded on first use.
+  private volatile Value value;
+
+  private LazyValue(Type type, ByteString bytes) {
+    this.type = type;
+    this.bytes = bytes;
+  }
+
+  /** Returns a view of the serialized ValueProto {@code bytes} of given {@code type}. */
+  public static LazyValue deserialize(Type type, ByteString bytes) {
+    checkNotNull(type);
+    checkNotNull(bytes);
+    checkArgument(Value.isSupportedTypeKind(type), "Type not supported %s", type);
+    return new LazyValue(type, bytes);
+  }
+
+  /**
+   * Returns a view of the serialized ValueProto {@code bytes} of given {@code type}. The bytes are
+   * not copied, so they must not be modified afterwards.
+   */
+  public static LazyValue deserialize(Type type, byte[] bytes) {
+    return deserialize(type, UnsafeByteOperations.unsafeWrap(bytes));
+  }
+
+  public Type getType() {
+    return type;
+  }
+
+  /** Returns the serialized ValueProto. */
+  public ByteString getSerializedValue() {
+    return bytes;
+  }
+
+  public boolean isNull() {
+    // All the fields of ValueProto are in the value oneof, so any field makes the value non-null.
+    return bytes.isEmpty();
+  }
+
+  /** Returns the number of fields, if the type is struct. */
+  public int getFieldCount() {
+    checkState(type.getKind() == TypeKind.TYPE_STRUCT);
+    return getChildren().size();
+  }
+
+  /** Returns the field at given index {@code i}, if the type is struct. */
+  public LazyValue getField(int i) {
+    checkState(type.getKind() == TypeKind.TYPE_STRUCT);
+    return new LazyValue(type.asStruct().getField(i).getType(), getChildren().get(i));
+  }
+
+  /**
+   * Returns the first field with given {@code name} (case sensitive), if the type is struct.
+   * Returns null if there is no such field.
+   */
+  public LazyValue findFieldByName(String name) {
+    checkState(type.getKind() == TypeKind.TYPE_STRUCT);
+    StructType structType = type.asStruct();
+    if (!Strings.isNullOrEmpty(name)) {
+      for (int i = 0; i < structType.getFieldCount(); ++i) {
+        if (structType.getField(i).getName().equals(name)) {
+          return getField(i);
+        }
+      }
+    }
+    return null;
+  }
+
+  /** Returns the number of elements, if the type is array. */
+  public int getElementCount() {
+    checkState(type.getKind() == TypeKind.TYPE_ARRAY);
+    return getChildren().size();
+  }
+
+  /** Returns the element at given index {@code i}, if the type is array. */
+  public LazyValue getElement(int i) {
+    checkState(type.getKind() == TypeKind.TYPE_ARRAY);
+    return new LazyValue(type.asArray().getElementType(), getChildren().get(i));
+  }
+
+  /**
+   * Decodes the value. Throws an IllegalArgumentException if the serialized value is invalid, like
+   * Value.deserialize().
+   */
+  public Value toValue() {
+    Value result = value;
+    if (result == null) {
+      try {
+        result = Value.deserialize(type, ValueProto.parseFrom(bytes));
+      } catch (InvalidProtocolBufferException e) {
+        throw new IllegalArgumentException(e);
+      }
+      value = result;
+    }
+    return result;
+  }
+
+  private ImmutableList<ByteString> getChildren() {
+    ImmutableList<ByteString> result = children;
+    if (result == null) {
+      try {
+        result = findChildren();
+      } catch (IOException e) {
+        throw new IllegalArgumentException(e);
+      }
+      children = result;
+    }
+    return result;
+  }
+
+  private ImmutableList<ByteString> findChildren() throws IOException {
+    checkState(!isNull(), "Null value of type %s", type);
+    boolean isArray = type.getKind() == TypeKind.TYPE_ARRAY;
+    int containerFieldNumber =
+        isArray ? ValueProto.ARRAY_VALUE_FIELD_NUMBER : ValueProto.STRUCT_VALUE_FIELD_NUMBER;
+    // Both ValueProto.Array.element and ValueProto.Struct.field are field 1.
+    int childFieldNumber =
+        isArray ? ValueProto.Array.ELEMENT_FIELD_NUMBER : ValueProto.Struct.FIELD_FIELD_NUMBER;
+
+    // A message field that occurs several times is merged, which for these messages with a single
+    // repeated field is the same as concatenating its occurrences.
+    ByteString container = null;
+    int lastFieldNumber = 0;
+    CodedInputStream input = bytes.newCodedInput();
+    input.enableAliasing(true);
+    for (int tag = input.readTag(); tag != 0; tag = input.readTag()) {
+      lastFieldNumber = WireFormat.getTagFieldNumber(tag);
+      if (lastFieldNumber == containerFieldNumber
+          && WireFormat.getTagWireType(tag) == WireFormat.WIRETYPE_LENGTH_DELIMITED) {
+        ByteString occurrence = input.readBytes();
+        container = container == null ? occurrence : container.concat(occurrence);
+      } else {
+        input.skipField(tag);
+      }
+    }
+    if (container == null || lastFieldNumber != containerFieldNumber) {
+      throw new IllegalArgumentException(
+          String.format("Type mismatch: provided type %s but the value has another type.", type));
+    }
+
+    ImmutableList.Builder<ByteString> builder = ImmutableList.builder();
+    input = container.newCodedInput();
+    input.enableAliasing(true);
+    for (int tag = input.readTag(); tag != 0; tag = input.readTag()) {
+      if (WireFormat.getTagFieldNumber(tag) == childFieldNumber
+          && WireFormat.getTagWireType(tag) == WireFormat.WIRETYPE_LENGTH_DELIMITED) {
+        builder.add(input.readBytes());
+      } else {
+        input.skipField(tag);
+      }
+    }
+    ImmutableList<ByteString> result = builder.build();
+    if (!isArray && result.size() != type.asStruct().getFieldCount()) {
+      throw new IllegalArgumentException(
+          "Type mismatch for struct. Type has " + type.asStruct().getFieldCount()
+          + " fields, but proto has " + result.size() + " fields.");
+    }
+    return result;
+  }
+}
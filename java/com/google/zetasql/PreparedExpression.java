@@ -18,6 +18,10 @@
 package com.google.zetasql;
 
 import com.google.common.base.Preconditions;
+import com.google.common.util.concurrent.Futures;
+import com.google.common.util.concurrent.ListenableFuture;
+import com.google.common.util.concurrent.MoreExecutors;
+import com.google.protobuf.CodedOutputStream;
 import com.google.protobuf.DescriptorProtos.FileDescriptorSet;
 import com.google.zetasql.ZetaSQLType.TypeProto;
 import com.google.zetasql.LocalService.EvaluateRequest;
@@ -26,6 +30,8 @@ import com.google.zetasql.LocalService.PrepareRequest;
 import com.google.zetasql.LocalService.PrepareResponse;
 import com.google.zetasql.LocalService.UnprepareRequest;
 import io.grpc.StatusRuntimeException;
+import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.util.Collections;
 import java.util.List;
 import java.util.Map;
@@ -54,6 +60,10 @@ import java.util.Map.Entry;
  * multiple threads.
  */
 public class PreparedExpression implements AutoCloseable {
+  /** Reused to pass serialized requests to a server in this process. */
+  private static final ThreadLocal<ByteBuffer> requestBuffer =
+      ThreadLocal.withInitial(() -> ByteBuffer.allocateDirect(4096));
+
   private final String sql;
   private boolean prepared = false;
   private boolean closed = false;
@@ -143,15 +153,7 @@ public class PreparedExpression implements AutoCloseable {
       }
     }
 
-    for (Entry<String, Value> entry : columns.entrySet()) {
-      request.addColumns(
-          serializeParameter(entry.getKey(), entry.getValue(), fileDescriptorSetsBuilder));
-    }
-
-    for (Entry<String, Value> entry : parameters.entrySet()) {
-      request.addParams(
-          serializeParameter(entry.getKey(), entry.getValue(), fileDescriptorSetsBuilder));
-    }
+    addParameters(request, columns, parameters);
 
     if (!prepared) {
       for (FileDescriptorSet fileDescriptorSet : fileDescriptorSetsBuilder.build()) {
@@ -162,10 +164,15 @@ public class PreparedExpression implements AutoCloseable {
     List<ZetaSQLDescriptorPool> pools = fileDescriptorSetsBuilder.getDescriptorPools();
 
     EvaluateResponse resp;
-    try {
-      resp = Client.getStub().evaluate(request.build());
-    } catch (StatusRuntimeException e) {
-      throw new SqlException(e);
+    ClientChannelProvider.DirectCalls directCalls = Client.getDirectCalls();
+    if (directCalls != null) {
+      resp = evaluateDirectly(directCalls, request.build());
+    } else {
+      try {
+        resp = Client.getStub().evaluate(request.build());
+      } catch (StatusRuntimeException e) {
+        throw new SqlException(e);
+      }
     }
 
     Type type = factory.deserialize(resp.getType(), pools);
@@ -177,6 +184,64 @@ public class PreparedExpression implements AutoCloseable {
     return Value.deserialize(type, resp.getValue());
   }
 
+  /**
+   * Same as {@link #execute(Map, Map)}, but does not wait for the server, so that a thread can have
+   * the evaluations of several rows in flight. The expression must have been prepared with {@link
+   * #prepare}. The returned future fails with a SqlException if the evaluation fails.
+   */
+  public ListenableFuture<Value> executeAsync(
+      Map<String, Value> columns, Map<String, Value> parameters) {
+    Preconditions.checkNotNull(columns);
+    Preconditions.checkNotNull(parameters);
+    Preconditions.checkState(prepared);
+    Preconditions.checkState(!closed);
+    validateParameters(columns, options.getExpressionColumns(), "column");
+    validateParameters(parameters, options.getQueryParameters(), "query");
+    EvaluateRequest.Builder request =
+        EvaluateRequest.newBuilder().setPreparedExpressionId(preparedId);
+    addParameters(request, columns, parameters);
+
+    Type type = outputType;
+    return Futures.transform(
+        Client.withSqlExceptions(Client.getFutureStub().evaluate(request.build())),
+        resp -> Value.deserialize(type, resp.getValue()),
+        MoreExecutors.directExecutor());
+  }
+
+  private void addParameters(
+      EvaluateRequest.Builder request, Map<String, Value> columns, Map<String, Value> parameters) {
+    for (Entry<String, Value> entry : columns.entrySet()) {
+      request.addColumns(
+          serializeParameter(entry.getKey(), entry.getValue(), fileDescriptorSetsBuilder));
+    }
+
+    for (Entry<String, Value> entry : parameters.entrySet()) {
+      request.addParams(
+          serializeParameter(entry.getKey(), entry.getValue(), fileDescriptorSetsBuilder));
+    }
+  }
+
+  private static EvaluateResponse evaluateDirectly(
+      ClientChannelProvider.DirectCalls directCalls, EvaluateRequest request) {
+    int size = request.getSerializedSize();
+    ByteBuffer buffer = requestBuffer.get();
+    if (buffer.capacity() < size) {
+      buffer = ByteBuffer.allocateDirect(Math.max(size, 2 * buffer.capacity()));
+      requestBuffer.set(buffer);
+    }
+    buffer.clear();
+    try {
+      CodedOutputStream output = CodedOutputStream.newInstance(buffer);
+      request.writeTo(output);
+      output.flush();
+      return EvaluateResponse.parseFrom(directCalls.evaluate(buffer, size));
+    } catch (IllegalArgumentException e) {
+      throw new SqlException(e.getMessage());
+    } catch (IOException e) {
+      throw new IllegalStateException(e);
+    }
+  }
+
   private void validateParameters(
       Map<String, Value> parameters, Map<String, Type> expected, String kind) {
     for (String name : parameters.keySet()) {
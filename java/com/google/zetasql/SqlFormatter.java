@@ -17,6 +17,8 @@
 
 package com.google.zetasql;
 
+import static java.nio.charset.StandardCharsets.UTF_8;
+
 import com.google.zetasql.LocalService.FormatSqlRequest;
 import io.grpc.StatusRuntimeException;
 
@@ -24,6 +26,14 @@ import io.grpc.StatusRuntimeException;
 public class SqlFormatter {
 
   public String formatSql(String sql) {
+    ClientChannelProvider.DirectCalls directCalls = Client.getDirectCalls();
+    if (directCalls != null) {
+      try {
+        return new String(directCalls.formatSql(sql.getBytes(UTF_8)), UTF_8);
+      } catch (IllegalArgumentException e) {
+        throw new SqlException(e.getMessage());
+      }
+    }
     try {
       return Client.getStub().formatSql(request(sql)).getSql();
     } catch (StatusRuntimeException e) {
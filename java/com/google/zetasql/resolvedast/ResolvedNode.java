@@ -40,11 +40,17 @@ import java.util.List;
  * <p> In this hierarchy, classes are either abstract or leaves.
  */
 public abstract class ResolvedNode implements Serializable {
+  // Deserializes the child nodes of a deserialized node when they are first accessed. Null if the
+  // node was built.
+  final transient DeserializationHelper deserializationHelper;
+
   ResolvedNode(ResolvedNodeProto proto, DeserializationHelper helper) {
-    // Nothing to deserialize for now.
+    this.deserializationHelper = helper;
   }
 
-  ResolvedNode() {}
+  ResolvedNode() {
+    this.deserializationHelper = null;
+  }
 
   /**
    * Deserializes {@code proto} into a sub class of {@link ResolvedNode}. The
@@ -19,16 +19,21 @@ package com.google.zetasql;
 
 import static com.google.common.truth.Truth.assertThat;
 import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.fail;
 
 import com.google.common.collect.ImmutableList;
+import com.google.common.util.concurrent.ListenableFuture;
 import com.google.zetasql.ZetaSQLType.TypeKind;
 import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedExpr;
 import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedStatement;
 import com.google.zetasqltest.TestSchemaProto.KitchenSinkPB;
 
 
+import java.time.Duration;
+import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.List;
+import java.util.concurrent.ExecutionException;
 import org.junit.Ignore;
 import org.junit.Test;
 import org.junit.runner.RunWith;
@@ -45,6 +50,79 @@ public class AnalyzerTest {
     assertThat(new Analyzer(options, catalog).analyzeStatement("select 1;")).isNotNull();
   }
 
+  @Test
+  public void testAnalyzeAsync() throws Exception {
+    SimpleCatalog catalog = new SimpleCatalog("foo");
+    catalog.addSimpleTable(
+        SimpleTable.tableFromProto(catalog.getTypeFactory().createProtoType(KitchenSinkPB.class)));
+    AnalyzerOptions options = new AnalyzerOptions();
+    ClientMetrics.reset();
+
+    List<ListenableFuture<ResolvedStatement>> futures = new ArrayList<>();
+    for (int i = 0; i < 10; ++i) {
+      futures.add(
+          Analyzer.analyzeStatementAsync(
+              "select nullable_int + " + i + " from KitchenSinkPB;", options, catalog));
+    }
+    ListenableFuture<ResolvedExpr> expression =
+        Analyzer.analyzeExpressionAsync("1 + 2", options, catalog);
+    for (ListenableFuture<ResolvedStatement> future : futures) {
+      assertThat(future.get()).isNotNull();
+    }
+    assertThat(expression.get().getType().getKind()).isEqualTo(TypeKind.TYPE_INT64);
+
+    try {
+      Analyzer.analyzeStatementAsync("select bad_column;", options, catalog).get();
+      fail();
+    } catch (ExecutionException e) {
+      assertThat(e.getCause()).isInstanceOf(SqlException.class);
+    }
+
+    ClientMetrics.MethodMetrics metrics = ClientMetrics.getMethodMetrics().get("Analyze");
+    assertThat(metrics.getCallCount()).isEqualTo(12);
+    assertThat(metrics.getErrorCount()).isEqualTo(1);
+    assertThat(metrics.getMaxLatency()).isAtLeast(metrics.getAverageLatency());
+    assertThat(metrics.getTotalLatency()).isGreaterThan(Duration.ZERO);
+  }
+
+  @Test
+  public void testAnalyzeStatements() {
+    SimpleCatalog catalog = new SimpleCatalog("foo");
+    catalog.addSimpleTable(
+        SimpleTable.tableFromProto(catalog.getTypeFactory().createProtoType(KitchenSinkPB.class)));
+    AnalyzerOptions options = new AnalyzerOptions();
+    ImmutableList<String> sqls =
+        ImmutableList.of(
+            "select nullable_int from KitchenSinkPB;",
+            "select bad_column;",
+            "select int64_key_1 + 1 from KitchenSinkPB;");
+
+    for (int maxParallelism : new int[] {1, 4}) {
+      List<Analyzer.StatementResult> results =
+          Analyzer.analyzeStatements(sqls, options, catalog, maxParallelism);
+      assertThat(results).hasSize(3);
+      assertThat(results.get(0).isOk()).isTrue();
+      assertThat(results.get(0).getResolvedStatement().toString())
+          .isEqualTo(Analyzer.analyzeStatement(sqls.get(0), options, catalog).toString());
+      assertThat(results.get(1).isOk()).isFalse();
+      assertThat(results.get(1).getError()).isInstanceOf(SqlException.class);
+      try {
+        results.get(1).getResolvedStatement();
+        fail();
+      } catch (SqlException expected) {
+      }
+      assertThat(results.get(2).isOk()).isTrue();
+    }
+
+    catalog.register();
+    List<Analyzer.StatementResult> results =
+        new Analyzer(options, catalog).analyzeStatements(sqls, 2);
+    assertThat(results.get(0).isOk()).isTrue();
+    assertThat(results.get(1).isOk()).isFalse();
+    assertThat(results.get(2).isOk()).isTrue();
+    catalog.unregister();
+  }
+
   @Test
   public void testAnalyzeNextStatementWithCatalog() {
     SimpleCatalog catalog = new SimpleCatalog("foo");
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2019 ZetaSQL Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+package com.google.zetasql;
+
+import static com.google.common.truth.Truth.assertThat;
+import static org.junit.Assert.fail;
+
+import com.google.common.collect.ImmutableList;
+import com.google.protobuf.ByteString;
+import com.google.zetasql.ZetaSQLType.TypeKind;
+import com.google.zetasql.ZetaSQLValue.ValueProto;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+import org.junit.runners.JUnit4;
+
+@RunWith(JUnit4.class)
+public class LazyValueTest {
+
+  private static final ArrayType INT64_ARRAY =
+      TypeFactory.createArrayType(TypeFactory.createSimpleType(TypeKind.TYPE_INT64));
+  private static final StructType STRUCT =
+      TypeFactory.createStructType(
+          ImmutableList.of(
+              new StructType.StructField("a", TypeFactory.createSimpleType(TypeKind.TYPE_INT64)),
+              new StructType.StructField("b", TypeFactory.createSimpleType(TypeKind.TYPE_STRING)),
+              new StructType.StructField("c", INT64_ARRAY)));
+
+  private static Value createStruct() {
+    return Value.createStructValue(
+        STRUCT,
+        ImmutableList.of(
+            Value.createInt64Value(1),
+            Value.createStringValue("foo"),
+            Value.createArrayValue(
+                INT64_ARRAY,
+                ImmutableList.of(Value.createInt64Value(2), Value.createInt64Value(3)))));
+  }
+
+  @Test
+  public void testStruct() {
+    Value value = createStruct();
+    LazyValue lazyValue = LazyValue.deserialize(STRUCT, value.serialize().toByteString());
+
+    assertThat(lazyValue.isNull()).isFalse();
+    assertThat(lazyValue.getFieldCount()).isEqualTo(3);
+    assertThat(lazyValue.getField(1).toValue().getStringValue()).isEqualTo("foo");
+    assertThat(lazyValue.findFieldByName("a").toValue().getInt64Value()).isEqualTo(1);
+    assertThat(lazyValue.findFieldByName("d")).isNull();
+
+    LazyValue array = lazyValue.findFieldByName("c");
+    assertThat(array.getElementCount()).isEqualTo(2);
+    assertThat(array.getElement(1).toValue().getInt64Value()).isEqualTo(3);
+    assertThat(array.toValue()).isEqualTo(value.getField(2));
+
+    assertThat(lazyValue.toValue()).isEqualTo(value);
+  }
+
+  @Test
+  public void testNull() {
+    LazyValue lazyValue = LazyValue.deserialize(STRUCT, ByteString.EMPTY);
+    assertThat(lazyValue.isNull()).isTrue();
+    assertThat(lazyValue.toValue().isNull()).isTrue();
+    try {
+      lazyValue.getField(0);
+      fail();
+    } catch (IllegalStateException expected) {
+    }
+
+    ValueProto proto =
+        ValueProto.newBuilder()
+            .setArrayValue(
+                ValueProto.Array.newBuilder().addElement(ValueProto.getDefaultInstance()))
+            .build();
+    LazyValue array = LazyValue.deserialize(INT64_ARRAY, proto.toByteString());
+    assertThat(array.getElementCount()).isEqualTo(1);
+    assertThat(array.getElement(0).isNull()).isTrue();
+  }
+
+  @Test
+  public void testOnlyReadPartsAreDecoded() {
+    // The second field holds an int64 instead of a string, which is only detected when it is
+    // read.
+    ValueProto proto =
+        ValueProto.newBuilder()
+            .setStructValue(
+                ValueProto.Struct.newBuilder()
+                    .addField(ValueProto.newBuilder().setInt64Value(1))
+                    .addField(ValueProto.newBuilder().setInt64Value(2))
+                    .addField(ValueProto.newBuilder().setArrayValue(ValueProto.Array.newBuilder())))
+            .build();
+    LazyValue lazyValue = LazyValue.deserialize(STRUCT, proto.toByteArray());
+    assertThat(lazyValue.getField(0).toValue().getInt64Value()).isEqualTo(1);
+    assertThat(lazyValue.getField(2).getElementCount()).isEqualTo(0);
+    try {
+      lazyValue.getField(1).toValue();
+      fail();
+    } catch (IllegalArgumentException expected) {
+    }
+    try {
+      lazyValue.toValue();
+      fail();
+    } catch (IllegalArgumentException expected) {
+    }
+  }
+
+  @Test
+  public void testTypeMismatch() {
+    ValueProto proto =
+        ValueProto.newBuilder()
+            .setStructValue(
+                ValueProto.Struct.newBuilder().addField(ValueProto.newBuilder().setInt64Value(1)))
+            .build();
+    try {
+      LazyValue.deserialize(STRUCT, proto.toByteString()).getField(0);
+      fail();
+    } catch (IllegalArgumentException expected) {
+    }
+    try {
+      LazyValue.deserialize(INT64_ARRAY, proto.toByteString()).getElementCount();
+      fail();
+    } catch (IllegalArgumentException expected) {
+    }
+  }
+}
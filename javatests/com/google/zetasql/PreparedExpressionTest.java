@@ -22,6 +22,7 @@ import static com.google.common.truth.Truth.assertWithMessage;
 import static com.google.zetasql.TypeTestBase.getDescriptorPoolWithTypeProtoAndTypeKind;
 import static org.junit.Assert.fail;
 
+import com.google.common.util.concurrent.ListenableFuture;
 import com.google.protobuf.InvalidProtocolBufferException;
 import com.google.zetasql.ZetaSQLOptions.ErrorMessageMode;
 import com.google.zetasql.ZetaSQLOptions.ProductMode;
@@ -29,8 +30,11 @@ import com.google.zetasql.ZetaSQLType.TypeKind;
 import com.google.zetasql.ZetaSQLType.TypeProto;
 
 
+import java.util.ArrayList;
 import java.util.Collections;
 import java.util.HashMap;
+import java.util.List;
+import java.util.concurrent.ExecutionException;
 import org.junit.Test;
 import org.junit.runner.RunWith;
 import org.junit.runners.JUnit4;
@@ -261,6 +265,38 @@ public class PreparedExpressionTest {
     }
   }
 
+  @Test
+  public void testExecuteAsync() throws Exception {
+    try (PreparedExpression exp = new PreparedExpression("a * @b")) {
+      AnalyzerOptions options = new AnalyzerOptions();
+      options.addExpressionColumn("a", TypeFactory.createSimpleType(TypeKind.TYPE_INT64));
+      options.addQueryParameter("b", TypeFactory.createSimpleType(TypeKind.TYPE_INT64));
+      exp.prepare(options);
+
+      // Several evaluations are in flight at once.
+      List<ListenableFuture<Value>> futures = new ArrayList<>();
+      HashMap<String, Value> params = new HashMap<>();
+      params.put("b", Value.createInt64Value(3));
+      for (int i = 0; i < 10; ++i) {
+        HashMap<String, Value> columns = new HashMap<>();
+        columns.put("a", Value.createInt64Value(i));
+        futures.add(exp.executeAsync(columns, params));
+      }
+      for (int i = 0; i < 10; ++i) {
+        assertThat(futures.get(i).get().getInt64Value()).isEqualTo(3 * i);
+      }
+
+      HashMap<String, Value> columns = new HashMap<>();
+      columns.put("a", Value.createInt64Value(Long.MIN_VALUE));
+      try {
+        exp.executeAsync(columns, params).get();
+        fail();
+      } catch (ExecutionException e) {
+        assertThat(e.getCause()).isInstanceOf(SqlException.class);
+      }
+    }
+  }
+
   @Test
   public void testPrepareWithColumns() {
     try (PreparedExpression exp = new PreparedExpression("IF(true, a, b.type_kind)")) {
@@ -24,6 +24,10 @@ import static org.junit.Assert.assertTrue;
 import static org.junit.Assert.fail;
 
 import com.google.common.collect.ImmutableList;
+import com.google.zetasql.FileDescriptorSetsBuilder;
+import com.google.zetasql.ResolvedLimitOffsetScanProto;
+import com.google.zetasql.SimpleCatalog;
+import com.google.zetasql.TestAccess;
 import com.google.zetasql.ZetaSQLType.TypeKind;
 import com.google.zetasql.SimpleTable;
 import com.google.zetasql.Type;
@@ -34,6 +38,7 @@ import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedLimitOffsetScan;
 import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedLiteral;
 import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedOption;
 import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedScan;
+import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedSingleRowScan;
 import com.google.zetasql.resolvedast.ResolvedNodes.ResolvedTableScan;
 import org.junit.Test;
 import org.junit.runner.RunWith;
@@ -158,4 +163,42 @@ public class ResolvedNodesTest {
     assertThat(scan.getLimit()).isSameInstanceAs(FIVE);
     assertThat(scan.getOffset()).isSameInstanceAs(TRUE_LITERAL);
   }
+
+  @Test
+  public void testDeserializesChildrenOnFirstAccess() {
+    ResolvedLimitOffsetScan scan =
+        ResolvedLimitOffsetScan.builder()
+            .setHintList(ImmutableList.of(TEST_HINT))
+            .setIsOrdered(false)
+            .setInputScan(
+                ResolvedSingleRowScan.builder().setColumnList(ImmutableList.of()).build())
+            .setColumnList(ImmutableList.of())
+            .setLimit(FIVE)
+            .build();
+    FileDescriptorSetsBuilder fileDescriptorSetsBuilder = new FileDescriptorSetsBuilder();
+    ResolvedLimitOffsetScanProto.Builder proto = ResolvedLimitOffsetScanProto.newBuilder();
+    scan.serialize(fileDescriptorSetsBuilder, proto);
+
+    TypeFactory factory = TypeFactory.nonUniqueNames();
+    DeserializationHelper helper =
+        new DeserializationHelper(
+            factory,
+            TestAccess.getDescriptorPools(fileDescriptorSetsBuilder),
+            new SimpleCatalog("foo", factory));
+    ResolvedLimitOffsetScan deserialized =
+        ResolvedLimitOffsetScan.deserialize(proto.build(), helper);
+
+    // Each child is deserialized once, and then shared by all the calls.
+    ResolvedExpr limit = deserialized.getLimit();
+    assertThat(limit).isInstanceOf(ResolvedLiteral.class);
+    assertThat(deserialized.getLimit()).isSameInstanceAs(limit);
+    assertThat(deserialized.getHintList()).hasSize(1);
+    assertThat(deserialized.getHintList()).isSameInstanceAs(deserialized.getHintList());
+    assertThat(deserialized.getOffset()).isNull();
+
+    assertThat(deserialized.debugString()).isEqualTo(scan.debugString());
+    ResolvedLimitOffsetScanProto.Builder reserialized = ResolvedLimitOffsetScanProto.newBuilder();
+    deserialized.serialize(fileDescriptorSetsBuilder, reserialized);
+    assertThat(reserialized.build()).isEqualTo(proto.build());
+  }
 }
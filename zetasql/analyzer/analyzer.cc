@@ -16,6 +16,8 @@
 
 #include "zetasql/public/analyzer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <thread>
@@ -30,14 +32,21 @@
 #include "zetasql/parser/parse_tree.h"
 #include "zetasql/parser/parse_tree_errors.h"
 #include "zetasql/parser/parser.h"
+#include "zetasql/parser/parser_output_cache.h"
 #include "zetasql/public/parse_helpers.h"
 #include "zetasql/public/parse_resume_location.h"
+#include "zetasql/public/runtime_metrics.h"
+#include "zetasql/public/tracer.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
+#include "zetasql/resolved_ast/column_reference_index.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/validator.h"
 #include "absl/flags/flag.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/ret_check.h"
@@ -131,6 +140,13 @@ const AnalyzerOptions& GetOptionsWithArenas(
   return **copy;
 }
 
+// Returns the arena to allocate the resolved AST from when analyzing with
+// <options>, or NULL to allocate it from the heap.
+zetasql_base::UnsafeArena* GetResolvedNodeArena(const AnalyzerOptions& options) {
+  return options.allocate_resolved_nodes_in_arena() ? options.arena().get()
+                                                    : nullptr;
+}
+
 }  // namespace
 
 void AllowedHintsAndOptions::AddOption(const std::string& name,
@@ -309,6 +325,14 @@ zetasql_base::Status AllowedHintsAndOptions::Serialize(
   return ::zetasql_base::OkStatus();
 }
 
+// Sizes the default arenas after the memory used by the previous ones.
+static zetasql_base::ArenaBlockSizeHint* DefaultArenaBlockSizeHint() {
+  static zetasql_base::ArenaBlockSizeHint* hint =
+      new zetasql_base::ArenaBlockSizeHint(/*min_block_size=*/4096,
+                                   /*max_block_size=*/1 << 20);
+  return hint;
+}
+
 AnalyzerOptions::AnalyzerOptions()
     : AnalyzerOptions(LanguageOptions()) {}
 
@@ -322,7 +346,8 @@ AnalyzerOptions::~AnalyzerOptions() {
 
 void AnalyzerOptions::CreateDefaultArenasIfNotSet() {
   if (arena_ == nullptr) {
-    arena_ = std::make_shared<zetasql_base::UnsafeArena>(/*block_size=*/4096);
+    arena_ = std::make_shared<zetasql_base::UnsafeArena>(
+        DefaultArenaBlockSizeHint());
   }
   if (id_string_pool_ == nullptr) {
     id_string_pool_ = std::make_shared<IdStringPool>(arena_);
@@ -490,6 +515,23 @@ zetasql_base::Status AnalyzerOptions::Serialize(
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::Status AnalyzerOptions::GetFingerprint(
+    std::string* fingerprint) const {
+  FileDescriptorSetMap file_descriptor_set_map;
+  AnalyzerOptionsProto proto;
+  ZETASQL_RETURN_IF_ERROR(Serialize(&file_descriptor_set_map, &proto));
+  *fingerprint = proto.SerializeAsString();
+  // Options that change the resolved AST but are not serialized.
+  absl::StrAppend(fingerprint, ";inline_tvfs=", inline_templated_sql_tvfs_);
+  // Proto and enum types are serialized with the index of their
+  // DescriptorPool, so the pools are part of the fingerprint too.
+  for (const auto& entry : file_descriptor_set_map) {
+    absl::StrAppend(fingerprint, ";", entry.second->descriptor_set_index, "=",
+                    absl::Hex(reinterpret_cast<uintptr_t>(entry.first)));
+  }
+  return zetasql_base::OkStatus();
+}
+
 zetasql_base::Status AnalyzerOptions::AddSystemVariable(
     const std::vector<std::string>& name_path, const Type* type) {
   if (type == nullptr) {
@@ -682,21 +724,140 @@ AnalyzerOutput::AnalyzerOutput(
 AnalyzerOutput::~AnalyzerOutput() {
 }
 
-// Common post-parsing work for AnalyzeStatement() series.
+const ColumnReferenceIndex& AnalyzerOutput::column_reference_index() const {
+  absl::call_once(column_reference_index_once_, [this] {
+    const ResolvedNode* root = statement_ != nullptr
+                                   ? static_cast<const ResolvedNode*>(
+                                         statement_.get())
+                                   : expr_.get();
+    column_reference_index_ = absl::make_unique<ColumnReferenceIndex>(
+        root, has_referenced_columns_ ? &referenced_columns_ : nullptr);
+  });
+  return *column_reference_index_;
+}
+
+// Returns the columns that <resolver> recorded as referenced.
+static std::vector<ResolvedColumn> GetReferencedColumns(
+    const Resolver& resolver) {
+  std::vector<ResolvedColumn> columns;
+  columns.reserve(resolver.referenced_column_access().size());
+  for (const auto& entry : resolver.referenced_column_access()) {
+    columns.push_back(entry.first);
+  }
+  return columns;
+}
+
+// Returns true if the resolved AST that was just produced should be validated,
+// sampling one in options.validate_resolved_ast_sample_rate() of them.
+static bool ShouldValidateResolvedAST(const AnalyzerOptions& options) {
+  if (!absl::GetFlag(FLAGS_zetasql_validate_resolved_ast)) return false;
+  const int sample_rate = options.validate_resolved_ast_sample_rate();
+  if (sample_rate <= 1) return true;
+  static std::atomic<int64_t> num_resolved_asts(0);
+  if (num_resolved_asts.fetch_add(1, std::memory_order_relaxed) %
+          sample_rate == 0) {
+    return true;
+  }
+  if (options.validator_timing_report() != nullptr) {
+    options.validator_timing_report()->RecordSkippedValidation();
+  }
+  return false;
+}
+
+static ValidatorOptions GetValidatorOptions(const AnalyzerOptions& options) {
+  ValidatorOptions validator_options;
+  validator_options.validate_expressions =
+      !options.validate_resolved_ast_structure_only();
+  validator_options.timing_report = options.validator_timing_report();
+  return validator_options;
+}
+
+namespace {
+
+// The RuntimeMetrics of the analyzer.
+struct AnalyzerMetrics {
+  RuntimeCounter statements_analyzed{"analyzer/statements_analyzed",
+                                     "Number of analyzed statements"};
+  RuntimeCounter expressions_analyzed{"analyzer/expressions_analyzed",
+                                      "Number of analyzed expressions"};
+  RuntimeHistogram parse_time_us{"analyzer/parse_time_us",
+                                 "Time spent parsing, in microseconds"};
+  RuntimeHistogram resolve_time_us{"analyzer/resolve_time_us",
+                                   "Time spent resolving, in microseconds"};
+  RuntimeHistogram validate_time_us{
+      "analyzer/validate_time_us",
+      "Time spent validating the resolved AST, in microseconds"};
+};
+
+AnalyzerMetrics& GetAnalyzerMetrics() {
+  static AnalyzerMetrics* metrics = new AnalyzerMetrics;
+  return *metrics;
+}
+
+// Records the time between its construction and destruction in <*histogram>,
+// and adds it to <*duration> if <duration> is not NULL. Also reports the
+// phase as a span called <phase> to <tracer> if it is not NULL.
+class ScopedPhaseTimer {
+ public:
+  ScopedPhaseTimer(Tracer* tracer, absl::string_view phase,
+                   absl::Duration* duration, RuntimeHistogram* histogram)
+      : span_(tracer, phase),
+        duration_(duration),
+        histogram_(histogram),
+        start_(absl::Now()) {}
+  ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+  ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+  ~ScopedPhaseTimer() {
+    const absl::Duration elapsed = absl::Now() - start_;
+    histogram_->Record(absl::ToInt64Microseconds(elapsed));
+    if (duration_ != nullptr) *duration_ += elapsed;
+  }
+
+ private:
+  // Ends after the time is recorded.
+  const ScopedTraceSpan span_;
+  absl::Duration* const duration_;
+  RuntimeHistogram* const histogram_;
+  const absl::Time start_;
+};
+
+// Returns <&times->*phase> if the phase times are being recorded, and NULL
+// otherwise, for ScopedPhaseTimer.
+absl::Duration* PhaseTimeOrNull(AnalyzerPhaseTimes* times,
+                                absl::Duration AnalyzerPhaseTimes::*phase) {
+  return times != nullptr ? &(times->*phase) : nullptr;
+}
+
+}  // namespace
+
+// Common post-parsing work for AnalyzeStatement() series. Adds the time spent
+// resolving and validating to <*phase_times> if it is not NULL.
 static zetasql_base::Status FinishAnalyzeStatementImpl(
     absl::string_view sql, const ParserOutput& parser_output,
     Resolver* resolver, const AnalyzerOptions& options, Catalog* catalog,
     TypeFactory* type_factory,
-    std::unique_ptr<const ResolvedStatement>* resolved_statement) {
+    std::unique_ptr<const ResolvedStatement>* resolved_statement,
+    AnalyzerPhaseTimes* phase_times) {
   VLOG(5) << "Parsed AST:\n" << parser_output.statement()->DebugString();
 
-  ZETASQL_RETURN_IF_ERROR(resolver->ResolveStatement(sql, parser_output.statement(),
-                                             resolved_statement));
+  {
+    ScopedPhaseTimer timer(
+        options.tracer(), "resolve",
+        PhaseTimeOrNull(phase_times, &AnalyzerPhaseTimes::resolve),
+        &GetAnalyzerMetrics().resolve_time_us);
+    ZETASQL_RETURN_IF_ERROR(resolver->ResolveStatement(
+        sql, parser_output.statement(), resolved_statement));
+  }
 
   VLOG(3) << "Resolved AST:\n" << (*resolved_statement)->DebugString();
 
-  if (absl::GetFlag(FLAGS_zetasql_validate_resolved_ast)) {
-    Validator validator(options.language_options());
+  if (ShouldValidateResolvedAST(options)) {
+    ScopedPhaseTimer timer(
+        options.tracer(), "validate",
+        PhaseTimeOrNull(phase_times, &AnalyzerPhaseTimes::validate),
+        &GetAnalyzerMetrics().validate_time_us);
+    Validator validator(options.language_options(),
+                        GetValidatorOptions(options));
     ZETASQL_RETURN_IF_ERROR(
         validator.ValidateResolvedStatement(resolved_statement->get()));
   }
@@ -734,6 +895,72 @@ static zetasql_base::Status UnsupportedStatementErrorOrStatus(
   return status;
 }
 
+// Analyzes the statement in <parser_output>. On success, the AnalyzerOutput
+// takes ownership of <*owned_parser_output> if it is non-NULL, and keeps
+// <shared_parser_output> alive if it is non-NULL. The arenas of a shared
+// parser output are never used for analysis, since other callers may be
+// using it concurrently. <parse_time> is the time it took to produce
+// <parser_output>, for AnalyzerOutput::phase_times().
+static zetasql_base::Status AnalyzeStatementFromParserOutputImpl(
+    const ParserOutput& parser_output,
+    std::unique_ptr<ParserOutput>* owned_parser_output,
+    std::shared_ptr<const ParserOutput> shared_parser_output,
+    const AnalyzerOptions& options, absl::string_view sql, Catalog* catalog,
+    TypeFactory* type_factory, absl::Duration parse_time,
+    std::unique_ptr<const AnalyzerOutput>* output) {
+  AnalyzerOptions local_options = options;
+
+  if (shared_parser_output != nullptr) {
+    local_options.CreateDefaultArenasIfNotSet();
+  }
+  // If the arena and IdStringPool are not set in <options>, use the
+  // arena and IdStringPool from the parser output by default.
+  if (local_options.arena() == nullptr) {
+    ZETASQL_RET_CHECK(parser_output.arena() != nullptr);
+    local_options.set_arena(parser_output.arena());
+  }
+  if (local_options.id_string_pool() == nullptr) {
+    ZETASQL_RET_CHECK(parser_output.id_string_pool() != nullptr);
+    local_options.set_id_string_pool(parser_output.id_string_pool());
+  }
+  output->reset();
+
+  GetAnalyzerMetrics().statements_analyzed.Increment();
+  AnalyzerPhaseTimes phase_times;
+  phase_times.parse = parse_time;
+  std::unique_ptr<const ResolvedStatement> resolved_statement;
+  ResolvedNode::ArenaScope arena_scope(GetResolvedNodeArena(local_options));
+  Resolver resolver(catalog, type_factory, &local_options);
+  const zetasql_base::Status status = FinishAnalyzeStatementImpl(
+      sql, parser_output, &resolver, local_options, catalog, type_factory,
+      &resolved_statement,
+      local_options.record_phase_times() ? &phase_times : nullptr);
+  if (!status.ok()) {
+    return ConvertInternalErrorLocationAndAdjustErrorString(
+        local_options.error_message_mode(), sql, status);
+  }
+  std::unique_ptr<ParserOutput> released_parser_output(
+      owned_parser_output != nullptr ? owned_parser_output->release()
+                                     : nullptr);
+  auto analyzer_output = absl::make_unique<AnalyzerOutput>(
+      local_options.id_string_pool(), local_options.arena(),
+      std::move(resolved_statement),
+      AnalyzerOutputProperties(),
+      std::move(released_parser_output),
+      ConvertInternalErrorLocationsAndAdjustErrorStrings(
+          local_options.error_message_mode(), sql,
+          resolver.deprecation_warnings()),
+      resolver.undeclared_parameters(),
+      resolver.undeclared_positional_parameters());
+  analyzer_output->set_referenced_columns(GetReferencedColumns(resolver));
+  analyzer_output->set_phase_times(phase_times);
+  if (shared_parser_output != nullptr) {
+    analyzer_output->set_shared_parser_output(std::move(shared_parser_output));
+  }
+  *output = std::move(analyzer_output);
+  return zetasql_base::OkStatus();
+}
+
 static zetasql_base::Status AnalyzeStatementImpl(
     absl::string_view sql, const AnalyzerOptions& options, Catalog* catalog,
     TypeFactory* type_factory, std::unique_ptr<const AnalyzerOutput>* output) {
@@ -742,16 +969,45 @@ static zetasql_base::Status AnalyzeStatementImpl(
   ZETASQL_RETURN_IF_ERROR(ValidateAnalyzerOptions(options));
 
   VLOG(1) << "Parsing statement:\n" << sql;
+  absl::Duration parse_time;
+  if (options.parser_output_cache() != nullptr) {
+    std::shared_ptr<const ParserOutput> shared_parser_output;
+    zetasql_base::Status status;
+    {
+      ScopedPhaseTimer timer(
+          options.tracer(), "parse",
+          options.record_phase_times() ? &parse_time : nullptr,
+          &GetAnalyzerMetrics().parse_time_us);
+      status = options.parser_output_cache()->ParseStatement(
+          sql, options.language(), &shared_parser_output);
+    }
+    if (!status.ok()) {
+      return UnsupportedStatementErrorOrStatus(
+          status, ParseResumeLocation::FromStringView(sql), options);
+    }
+    const ParserOutput& parser_output = *shared_parser_output;
+    return AnalyzeStatementFromParserOutputImpl(
+        parser_output, /*owned_parser_output=*/nullptr,
+        std::move(shared_parser_output), options, sql, catalog, type_factory,
+        parse_time, output);
+  }
   std::unique_ptr<ParserOutput> parser_output;
-  const zetasql_base::Status status = ParseStatement(
-      sql, options.GetParserOptions(), &parser_output);
+  zetasql_base::Status status;
+  {
+    ScopedPhaseTimer timer(
+        options.tracer(), "parse",
+        options.record_phase_times() ? &parse_time : nullptr,
+        &GetAnalyzerMetrics().parse_time_us);
+    status = ParseStatement(sql, options.GetParserOptions(), &parser_output);
+  }
   if (!status.ok()) {
     return UnsupportedStatementErrorOrStatus(
         status, ParseResumeLocation::FromStringView(sql), options);
   }
 
-  return AnalyzeStatementFromParserOutputOwnedOnSuccess(
-      &parser_output, options, sql, catalog, type_factory, output);
+  return AnalyzeStatementFromParserOutputImpl(
+      *parser_output, &parser_output, /*shared_parser_output=*/nullptr,
+      options, sql, catalog, type_factory, parse_time, output);
 }
 
 zetasql_base::Status AnalyzeStatement(absl::string_view sql,
@@ -785,17 +1041,25 @@ static zetasql_base::Status AnalyzeNextStatementImpl(
   }
 
   std::unique_ptr<ParserOutput> parser_output;
-  const zetasql_base::Status status = ParseNextStatement(
-      resume_location, options.GetParserOptions(), &parser_output,
-      at_end_of_input);
+  absl::Duration parse_time;
+  zetasql_base::Status status;
+  {
+    ScopedPhaseTimer timer(
+        options.tracer(), "parse",
+        options.record_phase_times() ? &parse_time : nullptr,
+        &GetAnalyzerMetrics().parse_time_us);
+    status = ParseNextStatement(resume_location, options.GetParserOptions(),
+                                &parser_output, at_end_of_input);
+  }
   if (!status.ok()) {
     return UnsupportedStatementErrorOrStatus(status, *resume_location, options);
   }
   ZETASQL_RET_CHECK(parser_output != nullptr);
 
-  return AnalyzeStatementFromParserOutputOwnedOnSuccess(
-      &parser_output, options, resume_location->input(), catalog,
-      type_factory, output);
+  return AnalyzeStatementFromParserOutputImpl(
+      *parser_output, &parser_output, /*shared_parser_output=*/nullptr,
+      options, resume_location->input(), catalog, type_factory, parse_time,
+      output);
 }
 
 zetasql_base::Status AnalyzeNextStatement(
@@ -814,48 +1078,85 @@ zetasql_base::Status AnalyzeNextStatement(
       options.error_message_mode(), resume_location->input(), status);
 }
 
-static zetasql_base::Status AnalyzeStatementFromParserOutputImpl(
-    std::unique_ptr<ParserOutput>* statement_parser_output,
-    bool take_ownership_on_success, const AnalyzerOptions& options,
-    absl::string_view sql, Catalog* catalog, TypeFactory* type_factory,
-    std::unique_ptr<const AnalyzerOutput>* output) {
-  AnalyzerOptions local_options = options;
+zetasql_base::Status AnalyzeStatements(
+    absl::string_view sql, const AnalyzerOptions& options_in, Catalog* catalog,
+    TypeFactory* type_factory, int num_threads,
+    std::vector<zetasql_base::StatusOr<std::unique_ptr<const AnalyzerOutput>>>*
+        outputs) {
+  outputs->clear();
+  ZETASQL_RETURN_IF_ERROR(ValidateAnalyzerOptions(options_in));
 
-  // If the arena and IdStringPool are not set in <options>, use the
-  // arena and IdStringPool from the parser output by default.
-  if (local_options.arena() == nullptr) {
-    ZETASQL_RET_CHECK((*statement_parser_output)->arena() != nullptr);
-    local_options.set_arena((*statement_parser_output)->arena());
+  // Parsing is cheap compared to resolving, so the statements are parsed on
+  // this thread. Arenas are not thread-safe, so every statement gets its own.
+  struct Statement {
+    std::unique_ptr<AnalyzerOptions> options;
+    std::unique_ptr<ParserOutput> parser_output;
+    absl::Duration parse_time;
+    zetasql_base::Status status;
+    std::unique_ptr<const AnalyzerOutput> output;
+  };
+  std::vector<Statement> statements;
+  zetasql_base::Status parse_status;
+  ParseResumeLocation resume_location = ParseResumeLocation::FromStringView(sql);
+  bool at_end_of_input = false;
+  while (!at_end_of_input) {
+    Statement statement;
+    statement.options = absl::make_unique<AnalyzerOptions>(options_in);
+    statement.options->set_arena(nullptr);
+    statement.options->set_id_string_pool(nullptr);
+    statement.options->CreateDefaultArenasIfNotSet();
+    {
+      ScopedPhaseTimer timer(
+          options_in.tracer(), "parse",
+          options_in.record_phase_times() ? &statement.parse_time : nullptr,
+          &GetAnalyzerMetrics().parse_time_us);
+      parse_status = ParseNextStatement(
+          &resume_location, statement.options->GetParserOptions(),
+          &statement.parser_output, &at_end_of_input);
+    }
+    if (!parse_status.ok()) {
+      parse_status = ConvertInternalErrorLocationAndAdjustErrorString(
+          options_in.error_message_mode(), sql,
+          UnsupportedStatementErrorOrStatus(parse_status, resume_location,
+                                            options_in));
+      break;
+    }
+    statements.push_back(std::move(statement));
+  }
+
+  const int num_statements = statements.size();
+  std::atomic<int> next_statement(0);
+  auto worker = [&]() {
+    while (true) {
+      const int i = next_statement.fetch_add(1, std::memory_order_relaxed);
+      if (i >= num_statements) return;
+      Statement& statement = statements[i];
+      statement.status = AnalyzeStatementFromParserOutputImpl(
+          *statement.parser_output, &statement.parser_output,
+          /*shared_parser_output=*/nullptr, *statement.options, sql, catalog,
+          type_factory, statement.parse_time, &statement.output);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < std::min(num_threads, num_statements); ++i) {
+    threads.emplace_back(worker);
   }
-  if (local_options.id_string_pool() == nullptr) {
-    ZETASQL_RET_CHECK((*statement_parser_output)->id_string_pool() != nullptr);
-    local_options.set_id_string_pool(
-        (*statement_parser_output)->id_string_pool());
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
   }
-  output->reset();
 
-  std::unique_ptr<const ResolvedStatement> resolved_statement;
-  Resolver resolver(catalog, type_factory, &local_options);
-  const zetasql_base::Status status =
-      FinishAnalyzeStatementImpl(
-          sql, *(statement_parser_output->get()), &resolver, local_options,
-          catalog, type_factory, &resolved_statement);
-  if (!status.ok()) {
-    return ConvertInternalErrorLocationAndAdjustErrorString(
-        local_options.error_message_mode(), sql, status);
+  outputs->reserve(num_statements + (parse_status.ok() ? 0 : 1));
+  for (Statement& statement : statements) {
+    if (statement.status.ok()) {
+      outputs->emplace_back(std::move(statement.output));
+    } else {
+      outputs->emplace_back(statement.status);
+    }
+  }
+  if (!parse_status.ok()) {
+    outputs->emplace_back(parse_status);
   }
-  std::unique_ptr<ParserOutput> owned_parser_output(
-      take_ownership_on_success ? statement_parser_output->release() : nullptr);
-  *output = absl::make_unique<AnalyzerOutput>(
-      local_options.id_string_pool(), local_options.arena(),
-      std::move(resolved_statement),
-      AnalyzerOutputProperties(),
-      std::move(owned_parser_output),
-      ConvertInternalErrorLocationsAndAdjustErrorStrings(
-          local_options.error_message_mode(), sql,
-          resolver.deprecation_warnings()),
-      resolver.undeclared_parameters(),
-      resolver.undeclared_positional_parameters());
   return zetasql_base::OkStatus();
 }
 
@@ -864,8 +1165,9 @@ zetasql_base::Status AnalyzeStatementFromParserOutputOwnedOnSuccess(
     const AnalyzerOptions& options, absl::string_view sql, Catalog* catalog,
     TypeFactory* type_factory, std::unique_ptr<const AnalyzerOutput>* output) {
   return AnalyzeStatementFromParserOutputImpl(
-      statement_parser_output, /*take_ownership_on_success=*/true, options,
-      sql, catalog, type_factory, output);
+      **statement_parser_output, statement_parser_output,
+      /*shared_parser_output=*/nullptr, options, sql, catalog, type_factory,
+      /*parse_time=*/absl::ZeroDuration(), output);
 }
 
 zetasql_base::Status AnalyzeStatementFromParserOutputUnowned(
@@ -873,8 +1175,9 @@ zetasql_base::Status AnalyzeStatementFromParserOutputUnowned(
     const AnalyzerOptions& options, absl::string_view sql, Catalog* catalog,
     TypeFactory* type_factory, std::unique_ptr<const AnalyzerOutput>* output) {
   return AnalyzeStatementFromParserOutputImpl(
-      statement_parser_output, /*take_ownership_on_success=*/false, options,
-      sql, catalog, type_factory, output);
+      **statement_parser_output, /*owned_parser_output=*/nullptr,
+      /*shared_parser_output=*/nullptr, options, sql, catalog, type_factory,
+      /*parse_time=*/absl::ZeroDuration(), output);
 }
 
 // Coerces <resolved_expr> to <target_type>, using assignment semantics
@@ -900,21 +1203,39 @@ static zetasql_base::Status AnalyzeExpressionFromParserASTImpl(
     const ASTExpression& ast_expression,
     std::unique_ptr<ParserOutput> parser_output, absl::string_view sql,
     const AnalyzerOptions& options, Catalog* catalog, TypeFactory* type_factory,
-    const Type* target_type, std::unique_ptr<const AnalyzerOutput>* output) {
+    const Type* target_type, absl::Duration parse_time,
+    std::unique_ptr<const AnalyzerOutput>* output) {
+  GetAnalyzerMetrics().expressions_analyzed.Increment();
+  AnalyzerPhaseTimes phase_times;
+  phase_times.parse = parse_time;
+  AnalyzerPhaseTimes* recorded_phase_times =
+      options.record_phase_times() ? &phase_times : nullptr;
   std::unique_ptr<const ResolvedExpr> resolved_expr;
+  ResolvedNode::ArenaScope arena_scope(GetResolvedNodeArena(options));
   Resolver resolver(catalog, type_factory, &options);
-  ZETASQL_RETURN_IF_ERROR(resolver.ResolveStandaloneExpr(
-      sql, &ast_expression, &resolved_expr));
-  VLOG(3) << "Resolved AST:\n" << resolved_expr->DebugString();
-
-  if (target_type != nullptr) {
-    ZETASQL_RETURN_IF_ERROR(ConvertExprToTargetType(ast_expression, sql, options,
-                                            catalog, type_factory, target_type,
-                                            &resolved_expr));
+  {
+    ScopedPhaseTimer timer(
+        options.tracer(), "resolve",
+        PhaseTimeOrNull(recorded_phase_times, &AnalyzerPhaseTimes::resolve),
+        &GetAnalyzerMetrics().resolve_time_us);
+    ZETASQL_RETURN_IF_ERROR(resolver.ResolveStandaloneExpr(
+        sql, &ast_expression, &resolved_expr));
+    VLOG(3) << "Resolved AST:\n" << resolved_expr->DebugString();
+
+    if (target_type != nullptr) {
+      ZETASQL_RETURN_IF_ERROR(ConvertExprToTargetType(ast_expression, sql, options,
+                                              catalog, type_factory,
+                                              target_type, &resolved_expr));
+    }
   }
 
-  if (absl::GetFlag(FLAGS_zetasql_validate_resolved_ast)) {
-    Validator validator(options.language_options());
+  if (ShouldValidateResolvedAST(options)) {
+    ScopedPhaseTimer timer(
+        options.tracer(), "validate",
+        PhaseTimeOrNull(recorded_phase_times, &AnalyzerPhaseTimes::validate),
+        &GetAnalyzerMetrics().validate_time_us);
+    Validator validator(options.language_options(),
+                        GetValidatorOptions(options));
     ZETASQL_RETURN_IF_ERROR(
         validator.ValidateStandaloneResolvedExpr(resolved_expr.get()));
   }
@@ -934,7 +1255,7 @@ static zetasql_base::Status AnalyzeExpressionFromParserASTImpl(
   // Make sure we're starting from a clean state for CheckFieldsAccessed.
   resolved_expr->ClearFieldsAccessed();
 
-  *output = absl::make_unique<AnalyzerOutput>(
+  auto analyzer_output = absl::make_unique<AnalyzerOutput>(
       options.id_string_pool(), options.arena(), std::move(resolved_expr),
       AnalyzerOutputProperties(),
       std::move(parser_output),
@@ -942,6 +1263,9 @@ static zetasql_base::Status AnalyzeExpressionFromParserASTImpl(
           options.error_message_mode(), sql, resolver.deprecation_warnings()),
       resolver.undeclared_parameters(),
       resolver.undeclared_positional_parameters());
+  analyzer_output->set_referenced_columns(GetReferencedColumns(resolver));
+  analyzer_output->set_phase_times(phase_times);
+  *output = std::move(analyzer_output);
   return zetasql_base::OkStatus();
 }
 
@@ -958,13 +1282,20 @@ static zetasql_base::Status AnalyzeExpressionImpl(
 
   std::unique_ptr<ParserOutput> parser_output;
   ParserOptions parser_options = options.GetParserOptions();
-  ZETASQL_RETURN_IF_ERROR(ParseExpression(sql, parser_options, &parser_output));
+  absl::Duration parse_time;
+  {
+    ScopedPhaseTimer timer(
+        options.tracer(), "parse",
+        options.record_phase_times() ? &parse_time : nullptr,
+        &GetAnalyzerMetrics().parse_time_us);
+    ZETASQL_RETURN_IF_ERROR(ParseExpression(sql, parser_options, &parser_output));
+  }
   const ASTExpression* expression = parser_output->expression();
   VLOG(5) << "Parsed AST:\n" << expression->DebugString();
 
   return AnalyzeExpressionFromParserASTImpl(
       *expression, std::move(parser_output), sql, options, catalog,
-      type_factory, target_type, output);
+      type_factory, target_type, parse_time, output);
 }
 
 zetasql_base::Status AnalyzeExpression(absl::string_view sql,
@@ -995,7 +1326,8 @@ zetasql_base::Status AnalyzeExpressionFromParserAST(
   const AnalyzerOptions& options = GetOptionsWithArenas(&options_in, &copy);
   const zetasql_base::Status status = AnalyzeExpressionFromParserASTImpl(
       ast_expression, /* parser_output = */ nullptr, sql, options, catalog,
-      type_factory, /*target_type=*/nullptr, output);
+      type_factory, /*target_type=*/nullptr,
+      /*parse_time=*/absl::ZeroDuration(), output);
   return ConvertInternalErrorLocationAndAdjustErrorString(
       options.error_message_mode(), sql, status);
 }
@@ -1032,6 +1364,13 @@ static zetasql_base::Status ExtractTableNamesFromStatementImpl(
     TableNamesSet* table_names) {
   ZETASQL_RETURN_IF_ERROR(ValidateAnalyzerOptions(options));
   VLOG(3) << "Extracting table names from statement:\n" << sql;
+  if (options.parser_output_cache() != nullptr) {
+    std::shared_ptr<const ParserOutput> parser_output;
+    ZETASQL_RETURN_IF_ERROR(options.parser_output_cache()->ParseStatement(
+        sql, options.language(), &parser_output));
+    return table_name_resolver::FindTables(sql, *parser_output->statement(),
+                                           options, table_names);
+  }
   std::unique_ptr<ParserOutput> parser_output;
   ZETASQL_RETURN_IF_ERROR(
       ParseStatement(sql, options.GetParserOptions(), &parser_output));
@@ -1167,6 +1506,14 @@ zetasql_base::Status ExtractTableResolutionTimeFromASTStatement(
 zetasql_base::Status ExtractTableNamesFromScript(absl::string_view sql,
                                          const AnalyzerOptions& options_in,
                                          TableNamesSet* table_names) {
+  return ExtractTableNamesFromScript(sql, options_in, /*num_threads=*/1,
+                                     table_names);
+}
+
+zetasql_base::Status ExtractTableNamesFromScript(absl::string_view sql,
+                                         const AnalyzerOptions& options_in,
+                                         int num_threads,
+                                         TableNamesSet* table_names) {
   ZETASQL_RETURN_IF_ERROR(ValidateAnalyzerOptions(options_in));
   VLOG(3) << "Extracting table names from script:\n" << sql;
   std::unique_ptr<AnalyzerOptions> copy;
@@ -1177,7 +1524,7 @@ zetasql_base::Status ExtractTableNamesFromScript(absl::string_view sql,
   VLOG(5) << "Parsed AST:\n" << parser_output->script()->DebugString();
 
   zetasql_base::Status status = table_name_resolver::FindTableNamesInScript(
-      sql, *(parser_output->script()), options, table_names);
+      sql, *(parser_output->script()), options, num_threads, table_names);
   return ConvertInternalErrorLocationAndAdjustErrorString(
       options.error_message_mode(), sql, status);
 }
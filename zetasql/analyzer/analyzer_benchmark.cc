@@ -0,0 +1,225 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmark for the latency of GetParseTokens, ParseStatement and
+// AnalyzeStatement over a corpus of queries against the SampleCatalog. For
+// each query, prints the median latency of tokenizing, of parsing, and of
+// analyzing, with the analysis broken down into the parse, resolve and
+// validate phases reported by AnalyzerOutput::phase_times().
+//
+// Example:
+//   bazel run -c opt //zetasql/analyzer:analyzer_benchmark -- \
+//       --num_iterations=1000
+//
+// Queries can be read from a file instead, with --sql_file. The file holds
+// one or more statements separated by ';'. Pass
+// --zetasql_validate_resolved_ast=false to leave out validation.
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/parser/parser.h"
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/language_options.h"
+#include "zetasql/public/parse_resume_location.h"
+#include "zetasql/public/parse_tokens.h"
+#include "zetasql/testdata/sample_catalog.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
+
+ABSL_FLAG(int32_t, num_iterations, 200,
+          "The number of timed runs of each phase for each query. The "
+          "reported latencies are medians over these runs.");
+ABSL_FLAG(std::string, sql_file, "",
+          "If set, benchmarks the ';'-separated statements in this file "
+          "instead of the built-in corpus.");
+
+namespace zetasql {
+namespace {
+
+// Built-in corpus, ordered roughly by resolved AST size.
+const char* const kQueries[] = {
+    "SELECT 1",
+    "SELECT key, value FROM KeyValue WHERE key > 10",
+    "SELECT kv.key, COUNT(*) AS c, MAX(kv2.value2) AS m "
+    "FROM KeyValue kv JOIN KeyValue2 kv2 USING (key) "
+    "GROUP BY 1 HAVING c > 2 ORDER BY c DESC LIMIT 10",
+    "SELECT key, SUM(key) OVER (PARTITION BY value ORDER BY key "
+    "ROWS BETWEEN 2 PRECEDING AND CURRENT ROW) AS s, "
+    "ROW_NUMBER() OVER (ORDER BY key) AS r FROM KeyValue",
+    "WITH t AS (SELECT key, value FROM KeyValue WHERE value LIKE 'a%'), "
+    "u AS (SELECT key, value2 FROM KeyValue2 WHERE key IN "
+    "(SELECT key FROM t)) "
+    "SELECT t.key, ARRAY_AGG(u.value2 ORDER BY u.value2) AS vs, "
+    "STRUCT(t.key AS k, t.value AS v) AS s "
+    "FROM t LEFT JOIN u ON t.key = u.key "
+    "WHERE EXISTS (SELECT 1 FROM UNNEST([1, 2, 3]) x WHERE x = t.key) "
+    "GROUP BY t.key, t.value "
+    "UNION ALL "
+    "SELECT key, [value], STRUCT(key, value) FROM KeyValue",
+    "SELECT KitchenSink.int64_key_1, KitchenSink.string_val, "
+    "ARRAY_LENGTH(KitchenSink.repeated_int32_val), "
+    "(SELECT SUM(v) FROM UNNEST(KitchenSink.repeated_int32_val) v), "
+    "CASE WHEN KitchenSink.int32_val > 0 THEN 'pos' ELSE 'neg' END "
+    "FROM TestTable WHERE KitchenSink.has_int32_val",
+};
+
+// Returns the statements to benchmark.
+zetasql_base::Status GetQueries(std::vector<std::string>* queries) {
+  const std::string sql_file = absl::GetFlag(FLAGS_sql_file);
+  if (sql_file.empty()) {
+    queries->assign(std::begin(kQueries), std::end(kQueries));
+    return zetasql_base::OkStatus();
+  }
+  std::ifstream stream(sql_file);
+  if (!stream) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "Unable to read " << sql_file;
+  }
+  std::stringstream contents;
+  contents << stream.rdbuf();
+  for (absl::string_view statement :
+       absl::StrSplit(contents.str(), ';', absl::SkipWhitespace())) {
+    queries->emplace_back(absl::StripAsciiWhitespace(statement));
+  }
+  return zetasql_base::OkStatus();
+}
+
+absl::Duration Median(std::vector<absl::Duration>* durations) {
+  ZETASQL_CHECK(!durations->empty());
+  auto middle = durations->begin() + durations->size() / 2;
+  std::nth_element(durations->begin(), middle, durations->end());
+  return *middle;
+}
+
+std::string FormatMicros(absl::Duration duration) {
+  return absl::StrFormat("%.1f", absl::ToDoubleMicroseconds(duration));
+}
+
+// Latencies of one query, one entry per timed iteration.
+struct QueryLatencies {
+  std::vector<absl::Duration> tokenize;
+  std::vector<absl::Duration> parse;
+  std::vector<absl::Duration> analyze;
+  std::vector<absl::Duration> analyze_parse;
+  std::vector<absl::Duration> analyze_resolve;
+  std::vector<absl::Duration> analyze_validate;
+};
+
+zetasql_base::Status TimeQuery(const std::string& sql,
+                       const AnalyzerOptions& options, SampleCatalog* catalog,
+                       int num_iterations, QueryLatencies* latencies) {
+  const ParserOptions parser_options = options.GetParserOptions();
+  // The first round is a warm-up and is not recorded.
+  for (int i = 0; i <= num_iterations; ++i) {
+    const bool record = i > 0;
+
+    ParseResumeLocation resume_location =
+        ParseResumeLocation::FromStringView(sql);
+    std::vector<ParseToken> tokens;
+    absl::Time start = absl::Now();
+    ZETASQL_RETURN_IF_ERROR(
+        GetParseTokens(ParseTokenOptions(), &resume_location, &tokens));
+    if (record) latencies->tokenize.push_back(absl::Now() - start);
+
+    std::unique_ptr<ParserOutput> parser_output;
+    start = absl::Now();
+    ZETASQL_RETURN_IF_ERROR(ParseStatement(sql, parser_options, &parser_output));
+    if (record) latencies->parse.push_back(absl::Now() - start);
+    parser_output.reset();
+
+    std::unique_ptr<const AnalyzerOutput> output;
+    start = absl::Now();
+    ZETASQL_RETURN_IF_ERROR(AnalyzeStatement(sql, options, catalog->catalog(),
+                                     catalog->type_factory(), &output));
+    const absl::Duration analyze_time = absl::Now() - start;
+    if (record) {
+      latencies->analyze.push_back(analyze_time);
+      latencies->analyze_parse.push_back(output->phase_times().parse);
+      latencies->analyze_resolve.push_back(output->phase_times().resolve);
+      latencies->analyze_validate.push_back(output->phase_times().validate);
+    }
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status Run() {
+  const int num_iterations = absl::GetFlag(FLAGS_num_iterations);
+  ZETASQL_RET_CHECK_GT(num_iterations, 0);
+  std::vector<std::string> queries;
+  ZETASQL_RETURN_IF_ERROR(GetQueries(&queries));
+
+  LanguageOptions language_options;
+  language_options.EnableMaximumLanguageFeatures();
+  language_options.SetSupportsAllStatementKinds();
+  SampleCatalog catalog(language_options);
+
+  AnalyzerOptions options(language_options);
+  options.set_record_phase_times(true);
+
+  std::cout << "Median latencies in microseconds over " << num_iterations
+            << " iterations. 'analyze' is AnalyzeStatement, which includes "
+               "its own parse.\n";
+  std::cout << absl::StrFormat("%-6s %10s %10s %10s %10s %10s %10s\n",
+                               "query", "tokenize", "parse", "analyze",
+                               "a.parse", "a.resolve", "a.validate");
+  for (int i = 0; i < queries.size(); ++i) {
+    QueryLatencies latencies;
+    const zetasql_base::Status status = TimeQuery(queries[i], options, &catalog,
+                                          num_iterations, &latencies);
+    if (!status.ok()) {
+      std::cout << absl::StrFormat("%-6d ERROR: ", i) << status << "\n";
+      continue;
+    }
+    std::cout << absl::StrFormat(
+        "%-6d %10s %10s %10s %10s %10s %10s\n", i,
+        FormatMicros(Median(&latencies.tokenize)),
+        FormatMicros(Median(&latencies.parse)),
+        FormatMicros(Median(&latencies.analyze)),
+        FormatMicros(Median(&latencies.analyze_parse)),
+        FormatMicros(Median(&latencies.analyze_resolve)),
+        FormatMicros(Median(&latencies.analyze_validate)));
+  }
+  return zetasql_base::OkStatus();
+}
+
+}  // namespace
+}  // namespace zetasql
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  const zetasql_base::Status status = zetasql::Run();
+  if (!status.ok()) {
+    std::cout << "ERROR: " << status << std::endl;
+    return 1;
+  }
+  return 0;
+}
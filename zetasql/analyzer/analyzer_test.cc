@@ -25,17 +25,21 @@
 #include "zetasql/common/status_payload_utils.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "zetasql/parser/parser.h"
+#include "zetasql/parser/parser_output_cache.h"
 #include "zetasql/public/function.h"
 #include "zetasql/public/function.pb.h"
+#include "zetasql/public/parse_helpers.h"
 #include "zetasql/public/parse_resume_location.h"
 #include "zetasql/public/simple_catalog.h"
 #include "zetasql/public/sql_formatter.h"
+#include "zetasql/public/templated_sql_function_call_cache.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/resolved_column.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "zetasql/resolved_ast/sql_builder.h"
+#include "zetasql/resolved_ast/validator.h"
 #include "zetasql/testdata/sample_catalog.h"
 #include "zetasql/testdata/test_schema.pb.h"
 #include "gmock/gmock.h"
@@ -955,10 +959,10 @@ TEST_F(AnalyzerOptionsTest, Deserialize) {
 }
 
 TEST_F(AnalyzerOptionsTest, ClassAndProtoSize) {
-  EXPECT_EQ(224, sizeof(AnalyzerOptions) - sizeof(LanguageOptions) -
+  EXPECT_EQ(264, sizeof(AnalyzerOptions) - sizeof(LanguageOptions) -
                      sizeof(AllowedHintsAndOptions) -
                      sizeof(Catalog::FindOptions) - sizeof(SystemVariablesMap) -
-                     2 * sizeof(QueryParametersMap) - 1 * sizeof(std::string))
+                     2 * sizeof(QueryParametersMap) - 2 * sizeof(std::string))
       << "The size of AnalyzerOptions class has changed, please also update "
       << "the proto and serialization code if you added/removed fields in it.";
   EXPECT_EQ(17, AnalyzerOptionsProto::descriptor()->field_count())
@@ -1379,6 +1383,346 @@ TEST(AnalyzerTest, LanguageOptions) {
             analyzer_options2.error_message_mode());
 }
 
+TEST_F(AnalyzerOptionsTest, AnalyzeStatements) {
+  std::vector<std::string> statements;
+  for (int i = 0; i < 20; ++i) {
+    statements.push_back(i % 5 == 3
+                             ? absl::StrCat("SELECT no_such_column", i)
+                             : absl::StrCat("SELECT key + ", i,
+                                            " FROM KeyValue"));
+  }
+  const std::string sql = absl::StrJoin(statements, ";\n");
+
+  for (int num_threads : {1, 4}) {
+    std::vector<zetasql_base::StatusOr<std::unique_ptr<const AnalyzerOutput>>>
+        outputs;
+    ZETASQL_ASSERT_OK(AnalyzeStatements(sql, options_, catalog(), &type_factory_,
+                                num_threads, &outputs));
+    ASSERT_EQ(statements.size(), outputs.size());
+    for (int i = 0; i < statements.size(); ++i) {
+      if (i % 5 == 3) {
+        EXPECT_THAT(outputs[i].status(),
+                    StatusIs(_, HasSubstr(absl::StrCat(
+                                    "Unrecognized name: no_such_column", i))));
+      } else {
+        ZETASQL_ASSERT_OK(outputs[i].status());
+        const ResolvedStatement* statement =
+            outputs[i].ValueOrDie()->resolved_statement();
+        ASSERT_EQ(RESOLVED_QUERY_STMT, statement->node_kind());
+      }
+    }
+  }
+
+  // Statements after one that does not parse are not analyzed.
+  std::vector<zetasql_base::StatusOr<std::unique_ptr<const AnalyzerOutput>>>
+      outputs;
+  ZETASQL_ASSERT_OK(AnalyzeStatements("SELECT 1; SELECT FROM; SELECT 2", options_,
+                              catalog(), &type_factory_, /*num_threads=*/4,
+                              &outputs));
+  ASSERT_EQ(2, outputs.size());
+  ZETASQL_EXPECT_OK(outputs[0].status());
+  EXPECT_THAT(outputs[1].status(), StatusIs(_, HasSubstr("Syntax error")));
+}
+
+TEST_F(AnalyzerOptionsTest, AllocateResolvedNodesInArena) {
+  const std::string sql =
+      "SELECT key, COUNT(*) FROM KeyValue WHERE value = 'a' GROUP BY key";
+  std::unique_ptr<const AnalyzerOutput> heap_output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options_, catalog(), &type_factory_,
+                             &heap_output));
+
+  options_.CreateDefaultArenasIfNotSet();
+  options_.set_allocate_resolved_nodes_in_arena(true);
+  const size_t initial_bytes =
+      options_.arena()->bytes_until_next_allocation();
+  std::unique_ptr<const AnalyzerOutput> arena_output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options_, catalog(), &type_factory_,
+                             &arena_output));
+  EXPECT_EQ(heap_output->resolved_statement()->DebugString(),
+            arena_output->resolved_statement()->DebugString());
+  EXPECT_LT(options_.arena()->bytes_until_next_allocation(), initial_bytes);
+
+  // The output keeps the arena alive.
+  options_.set_arena(nullptr);
+  options_.set_id_string_pool(nullptr);
+  EXPECT_EQ(heap_output->resolved_statement()->DebugString(),
+            arena_output->resolved_statement()->DebugString());
+  arena_output.reset();
+}
+
+TEST_F(AnalyzerOptionsTest, ValidationSamplingAndTiming) {
+  const std::string sql = "SELECT key + 1 FROM KeyValue WHERE key > 2";
+  ValidatorTimingReport report;
+  options_.set_validator_timing_report(&report);
+  options_.set_validate_resolved_ast_sample_rate(3);
+  for (int i = 0; i < 6; ++i) {
+    std::unique_ptr<const AnalyzerOutput> output;
+    ZETASQL_ASSERT_OK(
+        AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+  }
+  EXPECT_EQ(2, report.num_validated());
+  EXPECT_EQ(4, report.num_skipped());
+  std::map<ResolvedNodeKind, ValidatorTimingReport::NodeKindCost> costs =
+      report.GetCosts();
+  EXPECT_EQ(2, costs[RESOLVED_QUERY_STMT].num_nodes);
+  EXPECT_EQ(2, costs[RESOLVED_TABLE_SCAN].num_nodes);
+  EXPECT_LT(0, costs[RESOLVED_FUNCTION_CALL].num_nodes);
+  EXPECT_THAT(report.DebugString(),
+              HasSubstr("Validated 2 trees, skipped 4"));
+
+  // Structure-only validation does not visit expressions.
+  report.Clear();
+  options_.set_validate_resolved_ast_sample_rate(1);
+  options_.set_validate_resolved_ast_structure_only(true);
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(
+      AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+  EXPECT_EQ(1, report.num_validated());
+  costs = report.GetCosts();
+  EXPECT_EQ(1, costs[RESOLVED_FILTER_SCAN].num_nodes);
+  EXPECT_EQ(0, costs.count(RESOLVED_FUNCTION_CALL));
+}
+
+TEST_F(AnalyzerOptionsTest, PhaseTimes) {
+  const std::string sql = "SELECT key + 1 FROM KeyValue WHERE key > 2";
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(
+      AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+  EXPECT_EQ(absl::ZeroDuration(), output->phase_times().total());
+
+  options_.set_record_phase_times(true);
+  ZETASQL_ASSERT_OK(
+      AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+  AnalyzerPhaseTimes times = output->phase_times();
+  EXPECT_GT(times.parse, absl::ZeroDuration());
+  EXPECT_GT(times.resolve, absl::ZeroDuration());
+  EXPECT_GE(times.validate, absl::ZeroDuration());
+  EXPECT_EQ(times.parse + times.resolve + times.validate, times.total());
+
+  ZETASQL_ASSERT_OK(
+      AnalyzeExpression("1 + 2", options_, catalog(), &type_factory_, &output));
+  times = output->phase_times();
+  EXPECT_GT(times.parse, absl::ZeroDuration());
+  EXPECT_GT(times.resolve, absl::ZeroDuration());
+
+  // Statements analyzed from an existing ParserOutput have no parse time.
+  std::unique_ptr<ParserOutput> parser_output;
+  ZETASQL_ASSERT_OK(
+      ParseStatement(sql, options_.GetParserOptions(), &parser_output));
+  ZETASQL_ASSERT_OK(AnalyzeStatementFromParserOutputOwnedOnSuccess(
+      &parser_output, options_, sql, catalog(), &type_factory_, &output));
+  times = output->phase_times();
+  EXPECT_EQ(absl::ZeroDuration(), times.parse);
+  EXPECT_GT(times.resolve, absl::ZeroDuration());
+}
+
+TEST_F(AnalyzerOptionsTest, InternCatalogNames) {
+  const std::string sql = "SELECT key FROM KeyValue";
+  options_.set_intern_catalog_names(true);
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(
+      AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+  const ResolvedColumn column = output->resolved_statement()
+                                    ->GetAs<ResolvedQueryStmt>()
+                                    ->output_column_list(0)
+                                    ->column();
+  EXPECT_EQ(IdStringPool::MakeInterned("Key").ToStringView().data(),
+            column.name_id().ToStringView().data());
+  EXPECT_EQ(IdStringPool::MakeInterned("KeyValue").ToStringView().data(),
+            column.table_name_id().ToStringView().data());
+
+  // The resolved AST is the same as without interning.
+  std::unique_ptr<const AnalyzerOutput> uninterned_output;
+  options_.set_intern_catalog_names(false);
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options_, catalog(), &type_factory_,
+                             &uninterned_output));
+  EXPECT_EQ(uninterned_output->resolved_statement()->DebugString(),
+            output->resolved_statement()->DebugString());
+}
+
+TEST_F(AnalyzerOptionsTest, ParserOutputCache) {
+  const std::string sql = "SELECT key FROM KeyValue JOIN KeyValue2 USING (key)";
+  ParserOutputCache cache(/*max_entries=*/10);
+  std::unique_ptr<const AnalyzerOutput> uncached_output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options_, catalog(), &type_factory_,
+                             &uncached_output));
+
+  options_.set_parser_output_cache(&cache);
+  ZETASQL_ASSERT_OK(IsValidStatementSyntax(sql, ERROR_MESSAGE_ONE_LINE,
+                                   options_.language(), &cache));
+  TableNamesSet table_names;
+  ZETASQL_ASSERT_OK(ExtractTableNamesFromStatement(sql, options_, &table_names));
+  EXPECT_EQ(2, table_names.size());
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(
+      AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+  // One parse served all three.
+  EXPECT_EQ(2, cache.GetStats().hits);
+  EXPECT_EQ(1, cache.GetStats().misses);
+
+  // The output stays valid after the cache drops the parse.
+  cache.Clear();
+  EXPECT_EQ(uncached_output->resolved_statement()->DebugString(),
+            output->resolved_statement()->DebugString());
+
+  EXPECT_THAT(AnalyzeStatement("SELECT (", options_, catalog(), &type_factory_,
+                               &output),
+              StatusIs(zetasql_base::StatusCode::kInvalidArgument,
+                       HasSubstr("Syntax error")));
+}
+
+TEST_F(AnalyzerOptionsTest, TemplatedSQLFunctionCallCache) {
+  const std::string sql =
+      "SELECT udf_templated_arg_plus_integer(key), "
+      "udf_templated_arg_plus_integer(key + 1), "
+      "udf_templated_arg_plus_integer(1.5), udf_templated_return_one() "
+      "FROM KeyValue";
+  std::unique_ptr<const AnalyzerOutput> uncached_output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options_, catalog(), &type_factory_,
+                             &uncached_output));
+
+  TemplatedSQLFunctionCallCache cache(/*max_entries=*/10);
+  options_.set_templated_sql_function_call_cache(&cache, "v1");
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(
+      AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+  // The two calls with an INT64 argument share one resolution.
+  EXPECT_EQ(1, cache.GetStats().hits);
+  EXPECT_EQ(3, cache.GetStats().misses);
+  EXPECT_EQ(3, cache.GetStats().num_entries);
+  EXPECT_EQ(uncached_output->resolved_statement()->DebugString(),
+            output->resolved_statement()->DebugString());
+
+  // Later analyses share them too, and stay valid after the cache drops
+  // them.
+  std::unique_ptr<const AnalyzerOutput> second_output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options_, catalog(), &type_factory_,
+                             &second_output));
+  EXPECT_EQ(5, cache.GetStats().hits);
+  cache.Clear();
+  EXPECT_EQ(uncached_output->resolved_statement()->DebugString(),
+            second_output->resolved_statement()->DebugString());
+
+  // Another catalog version misses.
+  options_.set_templated_sql_function_call_cache(&cache, "v2");
+  ZETASQL_ASSERT_OK(
+      AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+  EXPECT_EQ(6, cache.GetStats().misses);
+
+  // Bodies are not cached when parse locations are recorded.
+  options_.set_record_parse_locations(true);
+  ZETASQL_ASSERT_OK(
+      AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+  EXPECT_EQ(6, cache.GetStats().hits);
+  EXPECT_EQ(6, cache.GetStats().misses);
+
+  // Errors are not cached.
+  options_.set_record_parse_locations(false);
+  EXPECT_FALSE(AnalyzeStatement("SELECT udf_templated_parse_error()", options_,
+                                catalog(), &type_factory_, &output)
+                   .ok());
+  EXPECT_EQ(3, cache.GetStats().num_entries);
+}
+
+TEST_F(AnalyzerOptionsTest, InlineTemplatedSQLTVFs) {
+  options_.mutable_language()->EnableLanguageFeature(
+      FEATURE_TABLE_VALUED_FUNCTIONS);
+  options_.set_inline_templated_sql_tvfs(true);
+  ZETASQL_ASSERT_OK(options_.AddQueryParameter("p", type_factory_.get_int64()));
+  auto has_tvf_scan = [](const AnalyzerOutput& output) {
+    std::vector<const ResolvedNode*> tvf_scans;
+    output.resolved_statement()->GetDescendantsWithKinds({RESOLVED_TVFSCAN},
+                                                         &tvf_scans);
+    return !tvf_scans.empty();
+  };
+
+  for (const std::string sql : {
+           "SELECT key FROM "
+           "tvf_templated_select_relation_arg_using_column_names("
+           "TABLE KeyValue) WHERE value = 'a'",
+           "SELECT x + 1 FROM tvf_templated_select_int64_arg(1)",
+           "SELECT * FROM tvf_templated_select_int64_arg(@p)",
+           "SELECT * FROM tvf_call_tvf_templated_select_one() "
+           "CROSS JOIN tvf_call_tvf_templated_select_one()",
+       }) {
+    SCOPED_TRACE(sql);
+    std::unique_ptr<const AnalyzerOutput> output;
+    ZETASQL_ASSERT_OK(
+        AnalyzeStatement(sql, options_, catalog(), &type_factory_, &output));
+    EXPECT_FALSE(has_tvf_scan(*output))
+        << output->resolved_statement()->DebugString();
+  }
+
+  // Arguments that are not literals or parameters are not copied into the
+  // body.
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(
+      "SELECT * FROM tvf_templated_select_int64_arg(1 + 1)", options_,
+      catalog(), &type_factory_, &output));
+  EXPECT_TRUE(has_tvf_scan(*output));
+
+  // Calls are kept when parse locations are recorded.
+  options_.set_record_parse_locations(true);
+  ZETASQL_ASSERT_OK(AnalyzeStatement(
+      "SELECT * FROM tvf_templated_select_int64_arg(1)", options_, catalog(),
+      &type_factory_, &output));
+  EXPECT_TRUE(has_tvf_scan(*output));
+}
+
+TEST_F(AnalyzerOptionsTest, ExtractTableNamesFromScriptInParallel) {
+  std::string script = "DECLARE x INT64 DEFAULT (SELECT COUNT(*) FROM t0);\n";
+  for (int i = 1; i < 50; ++i) {
+    absl::StrAppend(&script, "IF x > ", i, " THEN\n  SELECT * FROM t", i,
+                    " JOIN u USING (a) WHERE b IN (SELECT c FROM v", i,
+                    ");\nEND IF;\n");
+  }
+  TableNamesSet table_names;
+  ZETASQL_ASSERT_OK(ExtractTableNamesFromScript(script, options_, &table_names));
+  EXPECT_EQ(2 * 50, table_names.size());
+  for (int num_threads : {2, 8}) {
+    TableNamesSet parallel_table_names;
+    ZETASQL_ASSERT_OK(ExtractTableNamesFromScript(script, options_, num_threads,
+                                          &parallel_table_names));
+    EXPECT_EQ(table_names, parallel_table_names);
+  }
+}
+
+TEST(AnalyzerTest, WideTable) {
+  // Name lists of wide tables are shared between scopes rather than copied,
+  // so every scope must still see its own names.
+  const int kNumColumns = 5000;
+  SimpleTable table("WideTable");
+  for (int i = 0; i < kNumColumns; ++i) {
+    ZETASQL_ASSERT_OK(table.AddColumn(
+        new SimpleColumn("WideTable", absl::StrCat("c", i), types::Int64Type()),
+        /*is_owned=*/true));
+  }
+  SimpleCatalog catalog("catalog");
+  catalog.AddTable(&table);
+  catalog.AddZetaSQLFunctions();
+  TypeFactory type_factory;
+  AnalyzerOptions options;
+
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(
+      "SELECT *, c4999 + 1 AS c5000 FROM "
+      "(SELECT * FROM (SELECT * FROM WideTable) AS t1 WHERE t1.c0 > 0) AS t2 "
+      "WHERE c1 = t2.c2",
+      options, &catalog, &type_factory, &output));
+  const ResolvedQueryStmt* query =
+      output->resolved_statement()->GetAs<ResolvedQueryStmt>();
+  ASSERT_EQ(kNumColumns + 1, query->output_column_list_size());
+  EXPECT_EQ("c0", query->output_column_list(0)->name());
+  EXPECT_EQ("c5000", query->output_column_list(kNumColumns)->name());
+
+  // A name added in a nested scope is not visible from the table's scope.
+  EXPECT_THAT(
+      AnalyzeStatement("SELECT (SELECT c5000 FROM (SELECT 1 AS c5000)), "
+                       "c5000 FROM WideTable",
+                       options, &catalog, &type_factory, &output),
+      StatusIs(_, HasSubstr("Unrecognized name: c5000")));
+}
+
 TEST(SQLBuilderTest, Int32ParameterForLimit) {
   auto cast_limit = MakeResolvedCast(types::Int64Type(),
                                      MakeResolvedLiteral(values::Int32(2)),
@@ -1561,4 +1905,43 @@ TEST(SQLBuilderTest, WithScanWithArrayScan) {
       formatted_sql);
 }
 
+// Builds SQL for deeply nested subqueries, set operations and joins, whose
+// text is assembled without copying it at every level of nesting, and checks
+// that the SQL analyzes to a query with the same output.
+TEST(SQLBuilderTest, DeeplyNestedSubqueries) {
+  const int kDepth = 300;
+  std::string sql = "SELECT 1 AS x";
+  for (int i = 0; i < kDepth; ++i) {
+    switch (i % 3) {
+      case 0:
+        sql = absl::StrCat("SELECT x + 1 AS x FROM (", sql, ")");
+        break;
+      case 1:
+        sql = absl::StrCat("(", sql, ") UNION ALL (SELECT 0 AS x)");
+        break;
+      case 2:
+        sql = absl::StrCat("SELECT t.x FROM (", sql,
+                           ") AS t JOIN (SELECT 1 AS y) AS u ON t.x > u.y");
+        break;
+    }
+  }
+  SimpleCatalog catalog("catalog");
+  catalog.AddZetaSQLFunctions();
+  TypeFactory type_factory;
+  AnalyzerOptions options;
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(
+      AnalyzeStatement(sql, options, &catalog, &type_factory, &output));
+
+  SQLBuilder sql_builder;
+  ZETASQL_ASSERT_OK(sql_builder.Process(*output->resolved_statement()));
+  std::unique_ptr<const AnalyzerOutput> rebuilt_output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql_builder.sql(), options, &catalog,
+                             &type_factory, &rebuilt_output));
+  const ResolvedQueryStmt* query =
+      rebuilt_output->resolved_statement()->GetAs<ResolvedQueryStmt>();
+  ASSERT_EQ(1, query->output_column_list_size());
+  EXPECT_TRUE(query->output_column_list(0)->column().type()->IsInt64());
+}
+
 }  // namespace zetasql
@@ -54,6 +54,7 @@
 #include "absl/memory/memory.h"
 #include "zetasql/base/case.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/source_location.h"
@@ -1256,6 +1257,17 @@ FunctionResolver::FindMatchingSignature(
     const std::vector<const ASTNode*>& arg_locations_in,
     const std::vector<std::pair<const ASTNamedArgument*, int>>& named_arguments)
     const {
+  MatchingSignatureKey key;
+  const bool cacheable = MakeMatchingSignatureKey(function, input_arguments_in,
+                                                  named_arguments, &key);
+  if (cacheable) {
+    auto it = matching_signature_cache_.find(key);
+    if (it != matching_signature_cache_.end()) {
+      if (it->second == nullptr) return nullptr;
+      return new FunctionSignature(*it->second);
+    }
+  }
+
   std::unique_ptr<FunctionSignature> best_result_signature;
   SignatureMatchResult best_result;
 
@@ -1318,9 +1330,51 @@ FunctionResolver::FindMatchingSignature(
       }
     }
   }
+  if (cacheable) {
+    matching_signature_cache_.emplace(
+        std::move(key), best_result_signature == nullptr
+                            ? nullptr
+                            : absl::make_unique<const FunctionSignature>(
+                                  *best_result_signature));
+  }
   return best_result_signature.release();
 }
 
+bool FunctionResolver::MakeMatchingSignatureKey(
+    const Function* function,
+    const std::vector<InputArgumentType>& input_arguments,
+    const std::vector<std::pair<const ASTNamedArgument*, int>>&
+        named_arguments,
+    MatchingSignatureKey* key) {
+  // Named arguments are matched by the names in the AST.
+  if (!named_arguments.empty()) return false;
+  key->function = function;
+  key->arguments.reserve(input_arguments.size());
+  for (const InputArgumentType& argument : input_arguments) {
+    if (argument.is_relation() || argument.is_model() ||
+        argument.is_connection()) {
+      return false;
+    }
+    // STRUCT literals have their values, but other STRUCT arguments can have
+    // a mix of literal and non-literal fields.
+    if (!argument.is_literal() && argument.field_types_size() > 0) {
+      return false;
+    }
+    MatchingSignatureKey::Argument key_argument;
+    key_argument.type = argument.type();
+    key_argument.category = (argument.is_literal() ? 1 : 0) |
+                            (argument.is_query_parameter() ? 2 : 0) |
+                            (argument.is_untyped() ? 4 : 0) |
+                            (argument.is_untyped_null() ? 8 : 0) |
+                            (argument.is_untyped_empty_array() ? 16 : 0);
+    if (argument.is_literal()) {
+      key_argument.literal_value = *argument.literal_value();
+    }
+    key->arguments.push_back(std::move(key_argument));
+  }
+  return true;
+}
+
 static void ConvertMakeStructToLiteralIfAllExplicitLiteralFields(
     std::unique_ptr<const ResolvedExpr>* argument) {
   if (!(*argument)->type()->IsStruct() ||
@@ -2097,6 +2151,30 @@ zetasql_base::Status FunctionResolver::ResolveTemplatedSQLFunctionCall(
   ZETASQL_RET_CHECK_EQ(1, function.NumSignatures());
   ZETASQL_RET_CHECK_GE(function.signatures()[0].arguments().size(),
                actual_arguments.size());
+  Catalog* catalog = catalog_;
+  if (function.resolution_catalog() != nullptr) {
+    catalog = function.resolution_catalog();
+  }
+
+  TemplatedSQLFunctionCallCache* cache =
+      analyzer_options.templated_sql_function_call_cache();
+  TemplatedSQLFunctionCallCache::Key cache_key;
+  bool use_cache =
+      cache != nullptr &&
+      MakeTemplatedSQLFunctionCallCacheKey(function, *catalog, analyzer_options,
+                                           actual_arguments, &cache_key);
+  // Cached bodies must not be allocated in the arena of this analysis.
+  absl::optional<ResolvedNode::ArenaScope> heap_scope;
+  if (use_cache) {
+    std::shared_ptr<TemplatedSQLFunctionCall> cached_call =
+        cache->Lookup(cache_key);
+    if (cached_call != nullptr) {
+      *function_call_info_out = std::move(cached_call);
+      return ::zetasql_base::OkStatus();
+    }
+    heap_scope.emplace(/*arena=*/nullptr);
+  }
+
   for (int i = 0; i < actual_arguments.size(); ++i) {
     const IdString arg_name =
         analyzer_options.id_string_pool()->Make(function.GetArgumentNames()[i]);
@@ -2135,10 +2213,6 @@ zetasql_base::Status FunctionResolver::ResolveTemplatedSQLFunctionCall(
       ParseExpression(function.GetParseResumeLocation(), parser_options,
                       &parser_output),
       analyzer_options.error_message_mode()));
-  Catalog* catalog = catalog_;
-  if (function.resolution_catalog() != nullptr) {
-    catalog = function.resolution_catalog();
-  }
 
   // Create a separate new resolver and resolve the function's SQL expression,
   // using the specified function arguments.
@@ -2147,7 +2221,10 @@ zetasql_base::Status FunctionResolver::ResolveTemplatedSQLFunctionCall(
   // Otherwise, the catalog passed as the argument is used, and it may include
   // names that were not previously available when the function was initially
   // declared.
-  Resolver resolver(catalog, type_factory_, &analyzer_options);
+  // Bodies to cache get their types from the TypeFactory of the cache, which
+  // outlives this analysis.
+  Resolver resolver(catalog, use_cache ? cache->type_factory() : type_factory_,
+                    &analyzer_options);
 
   NameScope empty_name_scope;
   QueryResolutionInfo query_resolution_info(&resolver);
@@ -2215,14 +2292,59 @@ zetasql_base::Status FunctionResolver::ResolveTemplatedSQLFunctionCall(
     }
   }
 
+  // Only bodies without columns are cached, because the column ids of a
+  // cached body would collide with the column ids of other analyses.
+  if (use_cache) {
+    std::vector<const ResolvedNode*> column_nodes;
+    resolved_sql_body->GetDescendantsWithKinds(
+        {RESOLVED_SUBQUERY_EXPR, RESOLVED_COLUMN_REF}, &column_nodes);
+    use_cache = column_nodes.empty() &&
+                query_resolution_info.aggregate_columns_to_compute().empty();
+  }
+
   // Return the final TemplatedSQLUDFCall with the resolved expression.
-  function_call_info_out->reset(new TemplatedSQLFunctionCall(
+  auto call = std::make_shared<TemplatedSQLFunctionCall>(
       std::move(resolved_sql_body),
-      query_resolution_info.release_aggregate_columns_to_compute()));
+      query_resolution_info.release_aggregate_columns_to_compute());
+  if (use_cache) {
+    cache->Insert(std::move(cache_key), call);
+  }
+  *function_call_info_out = std::move(call);
 
   return ::zetasql_base::OkStatus();
 }
 
+bool FunctionResolver::MakeTemplatedSQLFunctionCallCacheKey(
+    const TemplatedSQLFunction& function, const Catalog& catalog,
+    const AnalyzerOptions& analyzer_options,
+    const std::vector<InputArgumentType>& actual_arguments,
+    TemplatedSQLFunctionCallCache::Key* key) {
+  // Parse locations in the body would be relative to the SQL of one caller,
+  // and expression columns are looked up by name in the calling statement.
+  if (analyzer_options.record_parse_locations() ||
+      analyzer_options.lookup_expression_column_callback() != nullptr) {
+    return false;
+  }
+  // Other types may be owned by the TypeFactory of the caller.
+  for (const InputArgumentType& argument : actual_arguments) {
+    if (argument.type() == nullptr || !argument.type()->IsSimpleType()) {
+      return false;
+    }
+    key->argument_types.push_back(argument.type());
+  }
+  if (!templated_sql_function_options_fingerprint_.has_value()) {
+    std::string fingerprint;
+    if (!analyzer_options.GetFingerprint(&fingerprint).ok()) return false;
+    templated_sql_function_options_fingerprint_ = std::move(fingerprint);
+  }
+  key->function = &function;
+  key->catalog = &catalog;
+  key->options = *templated_sql_function_options_fingerprint_;
+  key->catalog_version =
+      analyzer_options.templated_sql_function_catalog_version();
+  return true;
+}
+
 namespace {
 template <typename T>
 zetasql_base::Status CheckRange(
@@ -22,6 +22,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "zetasql/analyzer/expr_resolver_helper.h"
@@ -30,9 +31,12 @@
 #include "zetasql/public/function.h"
 #include "zetasql/public/function.pb.h"
 #include "zetasql/public/templated_sql_function.h"
+#include "zetasql/public/templated_sql_function_call_cache.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
 #include "zetasql/base/status.h"
 
 namespace zetasql {
@@ -220,6 +224,76 @@ class FunctionResolver {
   TypeFactory* type_factory_;  // Not owned.
   Resolver* resolver_;         // Not owned.
 
+  // Populates <key> for looking up a call of <function> with
+  // <actual_arguments> in the TemplatedSQLFunctionCallCache, and returns false
+  // if the resolved body of the call cannot be cached.
+  bool MakeTemplatedSQLFunctionCallCacheKey(
+      const TemplatedSQLFunction& function, const Catalog& catalog,
+      const AnalyzerOptions& analyzer_options,
+      const std::vector<InputArgumentType>& actual_arguments,
+      TemplatedSQLFunctionCallCache::Key* key);
+
+  // The fingerprint of the AnalyzerOptions in the keys of
+  // TemplatedSQLFunctionCallCache lookups, computed on the first lookup. The
+  // AnalyzerOptions of the calls only differ in their cycle detectors, which
+  // are not part of the fingerprint.
+  absl::optional<std::string> templated_sql_function_options_fingerprint_;
+
+  // Identifies a call to FindMatchingSignature() whose result only depends
+  // on the function and the InputArgumentTypes of its arguments.
+  struct MatchingSignatureKey {
+    // One argument. The Value is only set for literals, because coercion of
+    // literals and argument constraints may depend on their values.
+    struct Argument {
+      const Type* type;
+      int category;
+      absl::optional<Value> literal_value;
+
+      bool operator==(const Argument& other) const {
+        return type == other.type && category == other.category &&
+               literal_value == other.literal_value;
+      }
+    };
+
+    const Function* function;
+    std::vector<Argument> arguments;
+
+    bool operator==(const MatchingSignatureKey& other) const {
+      return function == other.function && arguments == other.arguments;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const MatchingSignatureKey& key) {
+      h = H::combine(std::move(h), key.function, key.arguments.size());
+      for (const Argument& argument : key.arguments) {
+        h = H::combine(std::move(h), argument.type, argument.category,
+                       argument.literal_value.has_value());
+        if (argument.literal_value.has_value()) {
+          h = H::combine(std::move(h), *argument.literal_value);
+        }
+      }
+      return h;
+    }
+  };
+
+  // Populates <key> for a call to FindMatchingSignature(), and returns false
+  // if the result of the call cannot be cached, e.g. because of named
+  // arguments or relation arguments.
+  static bool MakeMatchingSignatureKey(
+      const Function* function,
+      const std::vector<InputArgumentType>& input_arguments,
+      const std::vector<std::pair<const ASTNamedArgument*, int>>&
+          named_arguments,
+      MatchingSignatureKey* key);
+
+  // The results of FindMatchingSignature() during this analysis, so that
+  // calls with the same function and argument types (e.g. the many
+  // INT64 + INT64 additions of a query) only match the signatures once.
+  // The value is NULL if no signature matched.
+  mutable absl::flat_hash_map<MatchingSignatureKey,
+                              std::unique_ptr<const FunctionSignature>>
+      matching_signature_cache_;
+
   // Represents the argument types corresponding to a SignatureArgumentKind.
   // There are three possibilities:
   // 1) The object represents an untyped NULL.
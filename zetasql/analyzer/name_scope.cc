@@ -137,8 +137,10 @@ NameScope::NameScope(const NameScope* previous_scope,
     : previous_scope_(previous_scope),
       correlated_columns_set_(correlated_columns_set) {
   // Copy state_ from the new name targets and value table columns.
-  *mutable_names() = name_targets;
-  *mutable_value_table_columns() = value_table_columns;
+  if (!name_targets.empty() || !value_table_columns.empty()) {
+    *mutable_names() = name_targets;
+    *mutable_value_table_columns() = value_table_columns;
+  }
 }
 
 NameScope::NameScope(const NameList& name_list)
@@ -149,6 +151,20 @@ NameScope::NameScope(const NameList& name_list)
 NameScope::~NameScope() {
 }
 
+const NameScope::State& NameScope::state() const {
+  static const State* empty_state = new State;
+  return state_ == nullptr ? *empty_state : *state_;
+}
+
+NameScope::State* NameScope::mutable_state() {
+  if (state_ == nullptr) {
+    state_ = std::make_shared<State>();
+  } else if (state_.use_count() > 1) {
+    state_ = std::make_shared<State>(*state_);
+  }
+  return state_.get();
+}
+
 bool NameScope::IsEmpty() const {
   return names().empty() && value_table_columns().empty();
 }
@@ -1187,9 +1203,24 @@ NameList::NameList() {
 NameList::~NameList() {
 }
 
+const std::vector<NamedColumn>& NameList::columns() const {
+  static const std::vector<NamedColumn>* empty_columns =
+      new std::vector<NamedColumn>;
+  return columns_ == nullptr ? *empty_columns : *columns_;
+}
+
+std::vector<NamedColumn>* NameList::mutable_columns() {
+  if (columns_ == nullptr) {
+    columns_ = std::make_shared<std::vector<NamedColumn>>();
+  } else if (columns_.use_count() > 1) {
+    columns_ = std::make_shared<std::vector<NamedColumn>>(*columns_);
+  }
+  return columns_.get();
+}
+
 zetasql_base::Status NameList::AddColumn(
     IdString name, const ResolvedColumn& column, bool is_explicit) {
-  columns_.emplace_back(name, column, is_explicit);
+  mutable_columns()->emplace_back(name, column, is_explicit);
   if (!IsInternalAlias(name)) {
     name_scope_.AddColumn(name, column, is_explicit);
   }
@@ -1225,7 +1256,7 @@ zetasql_base::Status NameList::AddValueTableColumn(
   // as a column.  It will never be expanded by SELECT * (without rangevar.*),
   // so excluded_field_names is not actually used, but we fill it in for
   // clarity.
-  value_table_name_list->columns_.emplace_back(
+  value_table_name_list->mutable_columns()->emplace_back(
       kValueTableName, column, false /* is_explicit */, excluded_field_names);
   value_table_name_list->name_scope_
       .mutable_value_table_columns()->push_back(
@@ -1245,7 +1276,7 @@ zetasql_base::Status NameList::AddValueTableColumn(
 
   // We put in an implicit column that will expand to the value table column
   // in select star.
-  columns_.emplace_back(name, column, false /* is_explicit */,
+  mutable_columns()->emplace_back(name, column, false /* is_explicit */,
                         excluded_field_names);
 
   if (!IsInternalAlias(name)) {
@@ -1337,9 +1368,9 @@ zetasql_base::Status NameList::MergeFromExceptColumns(
   DCHECK(ast_location != nullptr);
 
   if ((excluded_field_names == nullptr || excluded_field_names->empty()) &&
-      columns_.empty() && name_scope_.IsEmpty()) {
+      columns().empty() && name_scope_.IsEmpty()) {
     // Optimization: When merging into an empty NameList with no exclusions,
-    // we can just copy the full state.
+    // we can just share the full state, which is copied on write.
     columns_ = other.columns_;
     name_scope_.CopyStateFrom(other.name_scope_);
 
@@ -1374,11 +1405,11 @@ zetasql_base::Status NameList::MergeFromExceptColumns(
 
         // Copy the column, but update excluded_field_names with the
         // new list.
-        columns_.emplace_back(
+        mutable_columns()->emplace_back(
             named_column.name, named_column.column, named_column.is_explicit,
             new_excluded_field_names);
       } else {
-        columns_.push_back(named_column);
+        mutable_columns()->push_back(named_column);
       }
     }
   }
@@ -1416,8 +1447,8 @@ zetasql_base::Status NameList::MergeFromExceptColumns(
 
 std::vector<ResolvedColumn> NameList::GetResolvedColumns() const {
   std::vector<ResolvedColumn> ret;
-  ret.reserve(columns_.size());
-  for (const NamedColumn& named_column : columns_) {
+  ret.reserve(columns().size());
+  for (const NamedColumn& named_column : columns()) {
     ret.push_back(named_column.column);
   }
   return ret;
@@ -1425,8 +1456,8 @@ std::vector<ResolvedColumn> NameList::GetResolvedColumns() const {
 
 std::vector<IdString> NameList::GetColumnNames() const {
   std::vector<IdString> ret;
-  ret.reserve(columns_.size());
-  for (const NamedColumn& named_column : columns_) {
+  ret.reserve(columns().size());
+  for (const NamedColumn& named_column : columns()) {
     ret.push_back(named_column.name);
   }
   return ret;
@@ -1442,7 +1473,7 @@ Type::HasFieldResult NameList::SelectStarHasColumn(IdString name) const {
   if (name.empty()) return Type::HAS_NO_FIELD;
 
   int fields_found = 0;
-  for (const NamedColumn& column : columns_) {
+  for (const NamedColumn& column : columns()) {
     // Value table columns *with fields* will be expanded to the list of
     // fields rather than the column itself in SELECT *.
     if (!column.is_value_table_column ||
@@ -1491,7 +1522,7 @@ std::string NameList::DebugString() const {
   if (is_value_table()) {
     absl::StrAppend(&out, "is_value_table = true");
   }
-  for (const NamedColumn& named_column : columns_) {
+  for (const NamedColumn& named_column : columns()) {
     if (!out.empty()) out += "\n";
     absl::StrAppend(&out, "  ", named_column.DebugString());
   }
@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "zetasql/base/logging.h"
+#include "zetasql/base/flat_map.h"
 
 #include "zetasql/public/id_string.h"
 #include "zetasql/public/type.h"
@@ -46,7 +47,9 @@ typedef std::shared_ptr<const NameList> NameListPtr;
 // The bool value is true if the reference is to a column from more than one
 // enclosing NameScope away; i.e. a column that was already a correlated
 // reference in the enclosing query.
-typedef std::map<ResolvedColumn, bool> CorrelatedColumnsSet;
+// These sets are small and looked up once per column reference, so they are
+// kept in a sorted vector.
+typedef zetasql_base::flat_map<ResolvedColumn, bool> CorrelatedColumnsSet;
 
 // A list of the CorrelatedColumnsSets attached to all NameScopes traversed
 // while looking up a name.  The sets are ordered from child scopes to
@@ -166,8 +169,9 @@ class ValidFieldInfo {
 // that are accessible from the original column.  Used in
 // the 'ValidFieldInfoMap' class, which owns the 'ValidNamePathList'
 // pointers in this map.
-typedef absl::flat_hash_map<ResolvedColumn, std::unique_ptr<ValidNamePathList>,
-                            ResolvedColumnHasher>
+// The map usually has a handful of entries, so it is a sorted vector, which
+// also makes iteration deterministic.
+typedef zetasql_base::flat_map<ResolvedColumn, std::unique_ptr<ValidNamePathList>>
     ResolvedColumnToValidNamePathsMap;
 
 // Map from ResolvedColumn column_id to a list of name paths that are
@@ -807,39 +811,40 @@ class NameScope {
       NameTarget* field_target);
 
   // The local state for this NameScope is stored in this struct which is
-  // stored in a CopyOnWrite.  This allows cheap copies when constructing
-  // NameScopes from NameLists and in NameList::MergeFrom.
+  // shared copy-on-write.  This allows cheap copies when constructing
+  // NameScopes from NameLists and in NameList::MergeFrom, which matters for
+  // tables with thousands of columns.
   struct State {
     // This is the main map storing the names visible in this local scope
     // (not including names from parent scopes).
-    // Using map rather than hash_map because the set is often small,
-    // and these may be constructed and destructed frequently.
     IdStringHashMapCase<NameTarget> names;
 
     // Vector of ValueTableColumns for all value tables in this local scope.
     // When looking up a name, we also look for fields of any of these columns
     // (except for fields marked as excluded for each value table column).
     std::vector<ValueTableColumn> value_table_columns;
-
-    void CopyFrom(const State& other) {
-      names = other.names;
-      value_table_columns = other.value_table_columns;
-    }
   };
-  State state_;
+  // NULL if the state is empty.  May be shared with other NameScopes, so it
+  // must only be modified through mutable_state().
+  std::shared_ptr<State> state_;
+
+  // Returns the state, which is empty if <state_> is NULL.
+  const State& state() const;
+  // Returns the state for modification, after copying it if it is shared.
+  State* mutable_state();
 
-  // Accessors for fields inside the CopyOnWrite state_.
+  // Accessors for fields inside the copy-on-write state_.
   const IdStringHashMapCase<NameTarget>& names() const {
-    return state_.names;
+    return state().names;
   }
   IdStringHashMapCase<NameTarget>* mutable_names() {
-    return &state_.names;
+    return &mutable_state()->names;
   }
   const std::vector<ValueTableColumn>& value_table_columns() const {
-    return state_.value_table_columns;
+    return state().value_table_columns;
   }
   std::vector<ValueTableColumn>* mutable_value_table_columns() {
-    return &state_.value_table_columns;
+    return &mutable_state()->value_table_columns;
   }
 
   // These are used internally to optimize copying.
@@ -926,7 +931,7 @@ class NameList {
 
   // Prepare this NameList for 'size' new columns. This is for efficiency
   // purposes only.
-  void ReserveColumns(int size) { columns_.reserve(size); }
+  void ReserveColumns(int size) { mutable_columns()->reserve(size); }
 
   // Add a named column.
   // <is_explicit> should be true if the alias for this column is an explicit
@@ -998,9 +1003,9 @@ class NameList {
       const ASTNode* ast_location);
 
   // Get the regular columns in this NameList.  Does not include pseudo-columns.
-  int num_columns() const { return columns_.size(); }
-  const std::vector<NamedColumn>& columns() const { return columns_; }
-  const NamedColumn& column(int i) const { return columns_[i]; }
+  int num_columns() const { return columns().size(); }
+  const std::vector<NamedColumn>& columns() const;
+  const NamedColumn& column(int i) const { return columns()[i]; }
 
   // Return vector of ResolvedColumns contained in columns().
   std::vector<ResolvedColumn> GetResolvedColumns() const;
@@ -1052,7 +1057,12 @@ class NameList {
   // This is the vector of columns that will show up in SELECT *.
   // Some will be marked as value tables; those may be expanded further
   // during SELECT * to show their fields instead of the value itself.
-  std::vector<NamedColumn> columns_;
+  // Like the state of NameScope, this is shared copy-on-write with the
+  // NameLists it was merged into, and is NULL if there are no columns.
+  std::shared_ptr<std::vector<NamedColumn>> columns_;
+
+  // Returns <columns_> for modification, after copying it if it is shared.
+  std::vector<NamedColumn>* mutable_columns();
 
   // This stores all resolvable names in the NameList, including range
   // variables and pseudo-columns, but excluding anonymous columns.
@@ -74,7 +74,8 @@ Resolver::Resolver(Catalog* catalog, TypeFactory* type_factory,
                &analyzer_options_.language()),
       empty_name_list_(new NameList),
       empty_name_scope_(new NameScope(*empty_name_list_)),
-      id_string_pool_(analyzer_options_.id_string_pool().get()) {
+      id_string_pool_(analyzer_options_.id_string_pool().get()),
+      column_registry_(analyzer_options_.arena().get()) {
   function_resolver_ =
       absl::make_unique<FunctionResolver>(catalog, type_factory, this);
   DCHECK(analyzer_options_.AllArenasAreInitialized());
@@ -135,6 +136,13 @@ IdString Resolver::MakeIdString(absl::string_view str) const {
   return id_string_pool_->Make(str);
 }
 
+IdString Resolver::MakeCatalogIdString(absl::string_view str) const {
+  if (analyzer_options_.intern_catalog_names()) {
+    return IdStringPool::MakeInterned(str);
+  }
+  return id_string_pool_->Make(str);
+}
+
 std::unique_ptr<const ResolvedLiteral> Resolver::MakeResolvedLiteral(
     const ASTNode* ast_location, const Value& value,
     bool set_has_explicit_type) const {
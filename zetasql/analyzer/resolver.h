@@ -210,6 +210,13 @@ class Resolver {
     return deprecation_warnings_;
   }
 
+  // Returns the columns that the resolved statement or expression references,
+  // and how it accesses them.
+  const std::map<ResolvedColumn, ResolvedStatement::ObjectAccess>&
+  referenced_column_access() const {
+    return referenced_column_access_;
+  }
+
   // Return undeclared parameters found the query, and their inferred types.
   const QueryParametersMap& undeclared_parameters() const {
     return undeclared_parameters_;
@@ -297,6 +304,10 @@ class Resolver {
   // Pool where IdStrings are allocated.  Copied from AnalyzerOptions.
   IdStringPool* const id_string_pool_;
 
+  // Interns the names of the ResolvedColumns of this analysis, allocated in
+  // the AnalyzerOptions arena.
+  ResolvedColumnRegistry column_registry_;
+
   // Next unique column_id to allocate.  Pointer may come from AnalyzerOptions.
   zetasql_base::SequenceNumber* next_column_id_sequence_ = nullptr;  // Not owned.
   std::unique_ptr<zetasql_base::SequenceNumber> owned_column_id_sequence_;
@@ -454,10 +465,21 @@ class Resolver {
   }
 
   int AllocateColumnId();
+
+  // Returns a new ResolvedColumn with a newly allocated column_id, whose
+  // names are interned in the column registry of this analysis.
+  ResolvedColumn MakeColumn(IdString table_name, IdString name,
+                            const Type* type) {
+    return column_registry_.MakeColumn(AllocateColumnId(), table_name, name,
+                                       type);
+  }
   IdString AllocateSubqueryName();
   IdString AllocateUnnestName();
 
   IdString MakeIdString(absl::string_view str) const;
+  // Like MakeIdString, for a table or column name that comes from the
+  // Catalog. See AnalyzerOptions::intern_catalog_names().
+  IdString MakeCatalogIdString(absl::string_view str) const;
 
   // Makes a new resolved literal and records its location.
   std::unique_ptr<const ResolvedLiteral> MakeResolvedLiteral(
@@ -1928,6 +1950,16 @@ class Resolver {
       std::unique_ptr<const ResolvedScan>* output,
       std::shared_ptr<const NameList>* output_name_list);
 
+  // Returns true if the resolved SQL body of the call in <tvf_scan> can
+  // replace it, see AnalyzerOptions::set_inline_templated_sql_tvfs().
+  static bool CanInlineTVFScan(const ResolvedTVFScan& tvf_scan);
+
+  // Returns in <output> the resolved SQL body of the call in <tvf_scan>, with
+  // the arguments substituted, in a ResolvedProjectScan that produces the
+  // columns of <tvf_scan>. CanInlineTVFScan() must be true.
+  zetasql_base::Status InlineTVFScan(std::unique_ptr<ResolvedTVFScan> tvf_scan,
+                             std::unique_ptr<const ResolvedScan>* output);
+
   zetasql_base::StatusOr<ResolvedTVFArg> ResolveTVFArg(
       const ASTTVFArgument* ast_tvf_arg, const NameScope* external_scope,
       const NameScope* local_scope,
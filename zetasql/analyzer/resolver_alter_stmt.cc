@@ -275,9 +275,9 @@ zetasql_base::Status Resolver::ResolveDropColumnAction(
                                     << "pseudo-column " << column_name;
     }
     if (column != nullptr) {
-      const ResolvedColumn resolved_column(AllocateColumnId(),
-                                           table_name_id_string, column_name,
-                                           column->GetType());
+      const ResolvedColumn resolved_column = MakeColumn(table_name_id_string,
+                                                        column_name,
+                                                        column->GetType());
       column_reference =
           MakeResolvedColumnRef(resolved_column.type(), resolved_column, false);
     }
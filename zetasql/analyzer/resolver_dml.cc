@@ -152,9 +152,9 @@ zetasql_base::Status Resolver::ResolveDeleteStatementImpl(
              << " in nested DELETE";
     }
 
-    const ResolvedColumn offset_column(AllocateColumnId(),
-                                       kArrayId /* table_name */, offset_alias,
-                                       types::Int64Type());
+    const ResolvedColumn offset_column = MakeColumn(kArrayId /* table_name */,
+                                                    offset_alias,
+                                                    types::Int64Type());
     resolved_array_offset_column = MakeResolvedColumnHolder(offset_column);
 
     // Stack a scope to include the offset column.  Stacking a scope is not
@@ -940,9 +940,8 @@ zetasql_base::Status Resolver::PopulateUpdateTargetInfos(
       }
 
       info.array_element = absl::make_unique<ResolvedColumn>(
-          AllocateColumnId(), /*table_name=*/kArrayId,
-          /*column_name=*/kElementId,
-          info.target->type()->AsArray()->element_type());
+          MakeColumn(/*table_name=*/kArrayId, /*column_name=*/kElementId,
+                     info.target->type()->AsArray()->element_type()));
 
       std::unique_ptr<ResolvedColumnRef> ref =
           MakeResolvedColumnRef(info.array_element->type(), *info.array_element,
@@ -1323,9 +1322,9 @@ zetasql_base::Status Resolver::MergeWithUpdateItem(
 
     if (resolved_update_item.element_column() == nullptr) {
       resolved_update_item.set_element_column(
-          MakeResolvedColumnHolder(ResolvedColumn(
-              AllocateColumnId(), /*table_name=*/kArrayId,
-              /*name=*/target_alias, target_type->AsArray()->element_type())));
+          MakeResolvedColumnHolder(MakeColumn(
+              /*table_name=*/kArrayId, /*name=*/target_alias,
+              target_type->AsArray()->element_type())));
     }
 
     // We create a target scope here for nested statements that contains only
@@ -1496,9 +1495,9 @@ zetasql_base::Status Resolver::ResolveUpdateStatementImpl(
              << " in nested UPDATE";
     }
 
-    const ResolvedColumn offset_column(AllocateColumnId(),
-                                       kArrayId /* table_name */, offset_alias,
-                                       types::Int64Type());
+    const ResolvedColumn offset_column = MakeColumn(kArrayId /* table_name */,
+                                                    offset_alias,
+                                                    types::Int64Type());
     resolved_array_offset_column = MakeResolvedColumnHolder(offset_column);
 
     // Stack a scope on top of 'update_scope' to include the offset column.
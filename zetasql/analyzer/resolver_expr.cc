@@ -2588,9 +2588,8 @@ zetasql_base::Status Resolver::ResolveInSubquery(
       // column to the supertype.
       ResolvedColumnList target_columns;
       ZETASQL_RET_CHECK_EQ(1, resolved_name_list->num_columns());
-      target_columns.push_back(ResolvedColumn(
-          AllocateColumnId(), kInSubqueryCastId,
-          resolved_name_list->column(0).column.name_id(),
+      target_columns.push_back(MakeColumn(
+          kInSubqueryCastId, resolved_name_list->column(0).column.name_id(),
           in_subquery_cast_type));
 
       ResolvedColumnList current_columns =
@@ -4771,8 +4770,8 @@ zetasql_base::Status Resolver::FinishResolvingAggregateFunction(
   // it out into <query_resolution_info->aggregate_columns_to_compute().
   // The actual ResolvedExpr we return is a ColumnRef pointing to that
   // function call.
-  ResolvedColumn aggregate_column(AllocateColumnId(), kAggregateId, alias,
-                                  resolved_agg_call->type());
+  ResolvedColumn aggregate_column = MakeColumn(kAggregateId, alias,
+                                               resolved_agg_call->type());
 
   query_resolution_info->AddAggregateComputedColumn(
       ast_function_call, MakeResolvedComputedColumn(
@@ -68,6 +68,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "zetasql/base/case.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
@@ -640,9 +641,9 @@ void Resolver::AddColumnsForOrderByExprs(
         }
         const IdString order_column_alias =
             MakeIdString(absl::StrCat("$orderbycol", order_by_item_idx + 1));
-        ResolvedColumn resolved_column(AllocateColumnId(), query_alias,
-                                       order_column_alias,
-                                       item_info.order_expression->type());
+        ResolvedColumn resolved_column = MakeColumn(
+            query_alias, order_column_alias,
+            item_info.order_expression->type());
         item_info.order_column = resolved_column;
         computed_columns->emplace_back(MakeResolvedComputedColumn(
             item_info.order_column, std::move(item_info.order_expression)));
@@ -1246,10 +1247,9 @@ zetasql_base::Status Resolver::ResolveModelTransformSelectList(
              "ResolveModelTransformSelectList";
       const ResolvedColumnRef* resolved_col_ref =
           select_column_state->resolved_expr->GetAs<ResolvedColumnRef>();
-      const ResolvedColumn resolved_col_cp(
-          AllocateColumnId(), resolved_col_ref->column().table_name(),
-          select_column_state->alias.ToString(),
-          resolved_col_ref->column().type());
+      const ResolvedColumn resolved_col_cp = MakeColumn(
+          resolved_col_ref->column().table_name_id(),
+          select_column_state->alias, resolved_col_ref->column().type());
       transform_list->push_back(MakeResolvedComputedColumn(
           resolved_col_cp,
           MakeResolvedColumnRef(resolved_col_ref->column().type(),
@@ -1416,8 +1416,8 @@ zetasql_base::Status Resolver::AnalyzeSelectColumnsToPrecomputeBeforeAggregation
         // The expression is not a simple column reference, it is a more
         // complicated expression that must be computed before aggregation
         // so that we can GROUP BY that computed column.
-        pre_group_by_column = ResolvedColumn(
-            AllocateColumnId(), kPreGroupById, select_column_state->alias,
+        pre_group_by_column = MakeColumn(
+            kPreGroupById, select_column_state->alias,
             select_column_state->resolved_expr->type());
         // If the expression is a path expression then collect that
         // information in the QueryResolutionInfo so that we know that
@@ -1598,8 +1598,8 @@ void Resolver::FinalizeSelectColumnStateList(
           resolved_expr->GetAs<ResolvedColumnRef>()->column();
       select_column_state->resolved_select_column = select_column;
     } else {
-      ResolvedColumn select_column(
-          AllocateColumnId(), query_alias, select_column_state->alias,
+      ResolvedColumn select_column = MakeColumn(
+          query_alias, select_column_state->alias,
           select_column_state->resolved_expr->type());
       std::unique_ptr<ResolvedComputedColumn> resolved_computed_column =
           MakeResolvedComputedColumn(
@@ -1887,8 +1887,8 @@ zetasql_base::Status Resolver::ResolveSelectDistinct(
       distinct_column = existing_computed_column->column();
     } else {
       // Create a new DISTINCT column.
-      distinct_column = ResolvedColumn(AllocateColumnId(), kDistinctId,
-                                       column.name_id(), column.type());
+      distinct_column = MakeColumn(kDistinctId, column.name_id(),
+                                   column.type());
       // Add a computed column for the new post-DISTINCT column.
       query_resolution_info->AddGroupByComputedColumnIfNeeded(
           distinct_column, MakeColumnRef(column));
@@ -2208,10 +2208,8 @@ zetasql_base::Status Resolver::ResolveSelectDotStar(
   } else {
     // We resolved the DotStar to be derived from an expression.
     const Type* type = resolved_dotstar_expr->type();
-    const ResolvedColumn src_column(
-        AllocateColumnId(), kPreProjectId,
-        type->IsStruct() ? kStructId : kProtoId,
-        type);
+    const ResolvedColumn src_column = MakeColumn(
+        kPreProjectId, type->IsStruct() ? kStructId : kProtoId, type);
 
     if (expr_resolution_info.has_analytic) {
       // The DotStar source expression contains analytic functions (and maybe
@@ -2582,9 +2580,8 @@ zetasql_base::Status Resolver::HandleGroupBySelectColumn(
     // expression.
     *group_by_column = existing_computed_column->column();
   } else {
-    *group_by_column = ResolvedColumn(
-        AllocateColumnId(), kGroupById, select_column_state->alias,
-        select_column_state->resolved_expr->type());
+    *group_by_column = MakeColumn(kGroupById, select_column_state->alias,
+                                  select_column_state->resolved_expr->type());
   }
 
   *resolved_expr = std::move(select_column_state->resolved_expr);
@@ -2661,8 +2658,7 @@ zetasql_base::Status Resolver::HandleGroupByExpression(
           "$groupbycol",
           query_resolution_info->group_by_columns_to_compute().size() + 1));
     }
-    *group_by_column = ResolvedColumn(
-        AllocateColumnId(), kGroupById, alias, (*resolved_expr)->type());
+    *group_by_column = MakeColumn(kGroupById, alias, (*resolved_expr)->type());
   }
 
   // If the 'resolved_expr' is a path expression, we must collect
@@ -2956,8 +2952,8 @@ zetasql_base::Status Resolver::ResolveSelectColumnSecondPass(
             select_column_state->resolved_expr->
             GetAs<ResolvedColumnRef>()->column();
       } else {
-        ResolvedColumn select_column(
-            AllocateColumnId(), query_alias, select_column_state->alias,
+        ResolvedColumn select_column = MakeColumn(
+            query_alias, select_column_state->alias,
             select_column_state->resolved_expr->type());
         query_resolution_info->select_list_columns_to_compute()->push_back(
             MakeResolvedComputedColumn(
@@ -3043,9 +3039,9 @@ zetasql_base::Status Resolver::ResolveSelectColumnSecondPass(
             resolved_expr->GetAs<ResolvedColumnRef>()->column();
         select_column_state->resolved_select_column = select_column;
       } else {
-        ResolvedColumn select_column(AllocateColumnId(), query_alias,
-                                     select_column_state->alias,
-                                     resolved_expr->type());
+        ResolvedColumn select_column = MakeColumn(query_alias,
+                                                  select_column_state->alias,
+                                                  resolved_expr->type());
         std::unique_ptr<ResolvedComputedColumn> computed_column =
             MakeResolvedComputedColumn(select_column, std::move(resolved_expr));
         query_resolution_info->select_list_columns_to_compute()->push_back(
@@ -3197,8 +3193,8 @@ zetasql_base::Status Resolver::CreateStructFromNameList(
   }
   const StructType* struct_type;
   ZETASQL_RETURN_IF_ERROR(type_factory_->MakeStructType(fields, &struct_type));
-  const ResolvedColumn struct_column(
-      AllocateColumnId(), kMakeStructId, kStructId, struct_type);
+  const ResolvedColumn struct_column = MakeColumn(kMakeStructId, kStructId,
+                                                  struct_type);
 
   *computed_column = MakeResolvedComputedColumn(
       struct_column,
@@ -3237,8 +3233,8 @@ zetasql_base::Status Resolver::ConvertScanToProto(
       &arguments, &resolved_build_proto_expr));
 
   // Wrap resolved_query with a projection that creates the proto.
-  const ResolvedColumn proto_column(
-      AllocateColumnId(), kMakeProtoId, kProtoId, proto_type);
+  const ResolvedColumn proto_column = MakeColumn(kMakeProtoId, kProtoId,
+                                                 proto_type);
 
   *output_scan = MakeResolvedProjectScan(
       std::vector<ResolvedColumn>{proto_column},
@@ -3410,8 +3406,7 @@ zetasql_base::Status Resolver::ResolveSetOperation(
         first_subquery_name_list->column(i);
     const IdString name = first_subquery_named_column.name;
 
-    column_list.push_back(ResolvedColumn(
-        AllocateColumnId(), op_type_str, name, supertype));
+    column_list.push_back(MakeColumn(op_type_str, name, supertype));
 
     ZETASQL_RETURN_IF_ERROR(name_list->AddColumn(
         name, column_list.back(), first_subquery_named_column.is_explicit));
@@ -3653,9 +3648,8 @@ zetasql_base::Status Resolver::CreateWrapperScanWithCasts(
                 ast_location, target_type, scan->get(),
                 false /* set_has_explicit_type */,
                 false /* return_null_on_error */, &casted_expr));
-        const ResolvedColumn casted_column(
-            AllocateColumnId(), scan_alias, scan_column.name_id(),
-            target_column_list[i].type());
+        const ResolvedColumn casted_column = MakeColumn(
+            scan_alias, scan_column.name_id(), target_column_list[i].type());
 
         // These casted columns should not get pruned.  We wouldn't create them
         // if they weren't required for the query.
@@ -4007,9 +4001,9 @@ zetasql_base::Status Resolver::ResolvePathExpressionAsFunctionTableArgument(
   std::vector<ResolvedColumn> resolved_columns;
   if (tvf_relation->is_value_table()) {
     ZETASQL_RET_CHECK_EQ(1, tvf_relation->num_columns());
-    resolved_columns.push_back(ResolvedColumn(
-        AllocateColumnId(), path_expr->first_name()->GetAsIdString(),
-        kValueColumnId, tvf_relation->column(0).type));
+    resolved_columns.push_back(MakeColumn(
+        path_expr->first_name()->GetAsIdString(), kValueColumnId,
+        tvf_relation->column(0).type));
     ZETASQL_RETURN_IF_ERROR(new_name_list->AddValueTableColumn(
         alias, resolved_columns[0], path_expr));
     new_name_list->set_is_value_table(true);
@@ -4017,8 +4011,7 @@ zetasql_base::Status Resolver::ResolvePathExpressionAsFunctionTableArgument(
   } else {
     resolved_columns.reserve(tvf_relation->num_columns());
     for (const TVFRelation::Column& column : tvf_relation->columns()) {
-      resolved_columns.push_back(ResolvedColumn(
-          AllocateColumnId(),
+      resolved_columns.push_back(MakeColumn(
           id_string_pool_->Make(path_expr->first_name()->GetAsString()),
           id_string_pool_->Make(column.name), column.type));
       ZETASQL_RETURN_IF_ERROR(new_name_list->AddColumn(
@@ -4215,10 +4208,9 @@ zetasql_base::Status Resolver::ResolveTablesampleClause(
         (with_weight_alias == nullptr ? kWeightAlias
                                       : with_weight_alias->GetAsIdString());
 
-    const ResolvedColumn column(
-        AllocateColumnId(),
-        /*table_name=*/kWeightId, /*name=*/weight_alias,
-        type_factory_->get_double());
+    const ResolvedColumn column = MakeColumn(/*table_name=*/kWeightId,
+                                             /*name=*/weight_alias,
+                                             type_factory_->get_double());
     weight_column = MakeResolvedColumnHolder(column);
     output_column_list.push_back(weight_column->column());
     std::shared_ptr<NameList> name_list(new NameList);
@@ -4286,8 +4278,8 @@ zetasql_base::Status Resolver::ResolveWithSubqueryRef(
     new_column_alias = *found;
 
     column_list.emplace_back(
-        ResolvedColumn(AllocateColumnId(), with_subquery_info.unique_alias,
-                       new_column_alias, column.type()));
+        MakeColumn(with_subquery_info.unique_alias, new_column_alias,
+                   column.type()));
     // Build mapping from WITH subquery column to the newly created column
     // for the WITH reference.
     old_column_to_new_column[column] = column_list.back();
@@ -4374,9 +4366,9 @@ zetasql_base::Status Resolver::ResolveColumnInUsing(
           ast_identifier, &resolved_get_field));
 
       // Then create a new ResolvedColumn to store this result.
-      *found_column = ResolvedColumn(
-          AllocateColumnId(), MakeIdString(absl::StrCat("$join_", side_name)),
-          key_name, resolved_get_field->type());
+      *found_column = MakeColumn(
+          MakeIdString(absl::StrCat("$join_", side_name)), key_name,
+          resolved_get_field->type());
 
       *compute_expr_for_found_column = std::move(resolved_get_field);
       break;
@@ -4498,9 +4490,8 @@ zetasql_base::Status Resolver::ResolveUsing(
           std::unique_ptr<const ResolvedExpr> coalesce_expr;
           ZETASQL_RETURN_IF_ERROR(MakeCoalesceExpr(using_key, {lhs_column, rhs_column},
                                            &coalesce_expr));
-          const ResolvedColumn coalesce_column(
-              AllocateColumnId(), kFullJoinId, key_name,
-              coalesce_expr->type());
+          const ResolvedColumn coalesce_column = MakeColumn(
+              kFullJoinId, key_name, coalesce_expr->type());
           computed_columns->push_back(MakeResolvedComputedColumn(
               coalesce_column, std::move(coalesce_expr)));
           ZETASQL_RETURN_IF_ERROR(output_name_list->AddColumn(
@@ -4995,6 +4986,11 @@ zetasql_base::Status Resolver::ResolveTVF(
     analyzer_options.mutable_find_options()->set_cycle_detector(
         &owned_cycle_detector);
   }
+  if (analyzer_options_.inline_templated_sql_tvfs()) {
+    // The columns of an inlined body must not collide with the columns of
+    // this statement.
+    analyzer_options.set_column_id_sequence_number(next_column_id_sequence_);
+  }
   const zetasql_base::Status resolve_status = tvf_catalog_entry->Resolve(
       &analyzer_options, tvf_input_arguments, *result_signature, catalog_,
       type_factory_, &tvf_signature);
@@ -5035,8 +5031,8 @@ zetasql_base::Status Resolver::ResolveTVF(
         tvf_signature->result_schema().column(i);
     const IdString column_name = MakeIdString(
         !column.name.empty() ? column.name : absl::StrCat("$col", i));
-    column_list.push_back(ResolvedColumn(AllocateColumnId(), tvf_name_idstring,
-                                         column_name, column.type));
+    column_list.push_back(MakeColumn(tvf_name_idstring, column_name,
+                                     column.type));
     if (column.is_pseudo_column) {
       ZETASQL_RETURN_IF_ERROR(
           name_list->AddPseudoColumn(column_name, column_list.back(), ast_tvf));
@@ -5138,7 +5134,13 @@ zetasql_base::Status Resolver::ResolveTVF(
   tvf_scan->set_hint_list(std::move(hints));
 
   MaybeRecordParseLocation(ast_tvf->name(), tvf_scan.get());
-  *output = std::move(tvf_scan);
+  if (analyzer_options_.inline_templated_sql_tvfs() &&
+      !analyzer_options_.record_parse_locations() &&
+      CanInlineTVFScan(*tvf_scan)) {
+    ZETASQL_RETURN_IF_ERROR(InlineTVFScan(std::move(tvf_scan), output));
+  } else {
+    *output = std::move(tvf_scan);
+  }
 
   // Resolve the TABLESAMPLE clause, if present.
   if (ast_tvf->sample() != nullptr) {
@@ -5153,6 +5155,209 @@ zetasql_base::Status Resolver::ResolveTVF(
   return ::zetasql_base::OkStatus();
 }
 
+namespace {
+
+// Copies the resolved SQL body of a TVF call, substituting the arguments of
+// the call for its ResolvedArgumentRefs and ResolvedRelationArgumentScans.
+// Argument names are matched case-insensitively, in lower case.
+class TVFBodyInliner : public ResolvedASTDeepCopyVisitor {
+ public:
+  struct RelationArgument {
+    std::unique_ptr<const ResolvedScan> scan;
+    std::vector<ResolvedColumn> column_list;
+  };
+
+  // Relation arguments are moved out of <relation_arguments> when they are
+  // substituted, so each of them can only be referenced once.
+  TVFBodyInliner(
+      const absl::flat_hash_map<std::string, const ResolvedExpr*>*
+          scalar_arguments,
+      absl::flat_hash_map<std::string, RelationArgument>* relation_arguments)
+      : scalar_arguments_(scalar_arguments),
+        relation_arguments_(relation_arguments) {}
+
+  zetasql_base::Status VisitResolvedArgumentRef(
+      const ResolvedArgumentRef* node) override {
+    const ResolvedExpr* const* argument = zetasql_base::FindOrNull(
+        *scalar_arguments_, absl::AsciiStrToLower(node->name()));
+    ZETASQL_RET_CHECK(argument != nullptr) << node->name();
+    // The arguments are literals or parameters, which can be copied any
+    // number of times.
+    return (*argument)->Accept(this);
+  }
+
+  zetasql_base::Status VisitResolvedRelationArgumentScan(
+      const ResolvedRelationArgumentScan* node) override {
+    RelationArgument* argument = zetasql_base::FindOrNull(
+        *relation_arguments_, absl::AsciiStrToLower(node->name()));
+    ZETASQL_RET_CHECK(argument != nullptr && argument->scan != nullptr)
+        << node->name();
+    ZETASQL_RET_CHECK_EQ(node->column_list_size(),
+                 argument->column_list.size());
+    std::vector<std::unique_ptr<const ResolvedComputedColumn>> expr_list;
+    for (int i = 0; i < node->column_list_size(); ++i) {
+      const ResolvedColumn& column = argument->column_list[i];
+      expr_list.push_back(MakeResolvedComputedColumn(
+          node->column_list(i),
+          MakeResolvedColumnRef(column.type(), column,
+                                /*is_correlated=*/false)));
+    }
+    PushNodeToStack(MakeResolvedProjectScan(
+        node->column_list(), std::move(expr_list), std::move(argument->scan)));
+    return ::zetasql_base::OkStatus();
+  }
+
+ private:
+  const absl::flat_hash_map<std::string, const ResolvedExpr*>* const
+      scalar_arguments_;
+  absl::flat_hash_map<std::string, RelationArgument>* const
+      relation_arguments_;
+};
+
+// Returns true if the types of <columns> equal <types>.
+bool ColumnTypesEqual(const std::vector<ResolvedColumn>& columns,
+                      const std::vector<const Type*>& types) {
+  if (columns.size() != types.size()) return false;
+  for (int i = 0; i < columns.size(); ++i) {
+    if (!columns[i].type()->Equals(types[i])) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool Resolver::CanInlineTVFScan(const ResolvedTVFScan& tvf_scan) {
+  const TVFSignature& signature = *tvf_scan.signature();
+  const ResolvedQueryStmt* body = signature.resolved_sql_body();
+  const std::vector<std::string>* argument_names =
+      signature.sql_body_argument_names();
+  if (body == nullptr || argument_names == nullptr ||
+      argument_names->size() != tvf_scan.argument_list_size() ||
+      tvf_scan.hint_list_size() > 0) {
+    return false;
+  }
+
+  // The types of the arguments, by name.
+  absl::flat_hash_map<std::string, const Type*> scalar_types;
+  absl::flat_hash_map<std::string, std::vector<const Type*>> relation_types;
+  for (int i = 0; i < tvf_scan.argument_list_size(); ++i) {
+    const ResolvedTVFArgument* argument = tvf_scan.argument_list(i);
+    const std::string name = absl::AsciiStrToLower((*argument_names)[i]);
+    if (argument->expr() != nullptr) {
+      // Other expressions would be evaluated once for each reference.
+      if (argument->expr()->node_kind() != RESOLVED_LITERAL &&
+          argument->expr()->node_kind() != RESOLVED_PARAMETER) {
+        return false;
+      }
+      scalar_types[name] = argument->expr()->type();
+    } else if (argument->scan() != nullptr) {
+      std::vector<const Type*>& types = relation_types[name];
+      for (const ResolvedColumn& column : argument->argument_column_list()) {
+        types.push_back(column.type());
+      }
+    } else {
+      // Models, connections and descriptors have no equivalent in a query.
+      return false;
+    }
+  }
+
+  std::vector<const ResolvedNode*> references;
+  body->GetDescendantsWithKinds(
+      {RESOLVED_ARGUMENT_REF, RESOLVED_RELATION_ARGUMENT_SCAN}, &references);
+  absl::flat_hash_set<std::string> referenced_relations;
+  for (const ResolvedNode* reference : references) {
+    if (reference->node_kind() == RESOLVED_ARGUMENT_REF) {
+      const ResolvedArgumentRef* argument_ref =
+          reference->GetAs<ResolvedArgumentRef>();
+      const Type* const* type = zetasql_base::FindOrNull(
+          scalar_types, absl::AsciiStrToLower(argument_ref->name()));
+      if (type == nullptr || !(*type)->Equals(argument_ref->type())) {
+        return false;
+      }
+    } else {
+      // A second reference to a relation would need a copy of the argument
+      // with new columns. Value table arguments all have the same column id.
+      const ResolvedRelationArgumentScan* argument_scan =
+          reference->GetAs<ResolvedRelationArgumentScan>();
+      const std::string name = absl::AsciiStrToLower(argument_scan->name());
+      const std::vector<const Type*>* types =
+          zetasql_base::FindOrNull(relation_types, name);
+      if (types == nullptr || argument_scan->is_value_table() ||
+          argument_scan->hint_list_size() > 0 ||
+          !ColumnTypesEqual(argument_scan->column_list(), *types) ||
+          !referenced_relations.insert(name).second) {
+        return false;
+      }
+    }
+  }
+
+  // The outputs of the body map to the columns of the call by position, e.g.
+  // without pseudo-columns in the call.
+  if (body->output_column_list_size() != tvf_scan.column_list_size()) {
+    return false;
+  }
+  for (int i = 0; i < body->output_column_list_size(); ++i) {
+    if (!body->output_column_list(i)->column().type()->Equals(
+            tvf_scan.column_list(i).type())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+zetasql_base::Status Resolver::InlineTVFScan(
+    std::unique_ptr<ResolvedTVFScan> tvf_scan,
+    std::unique_ptr<const ResolvedScan>* output) {
+  const TVFSignature& signature = *tvf_scan->signature();
+  const ResolvedQueryStmt* body = signature.resolved_sql_body();
+  const std::vector<std::string>& argument_names =
+      *signature.sql_body_argument_names();
+
+  // The scalar arguments stay owned by <arguments> while the body is copied.
+  std::vector<std::unique_ptr<const ResolvedTVFArgument>> arguments =
+      tvf_scan->release_argument_list();
+  absl::flat_hash_map<std::string, const ResolvedExpr*> scalar_arguments;
+  absl::flat_hash_map<std::string, TVFBodyInliner::RelationArgument>
+      relation_arguments;
+  for (int i = 0; i < arguments.size(); ++i) {
+    const std::string name = absl::AsciiStrToLower(argument_names[i]);
+    if (arguments[i]->expr() != nullptr) {
+      scalar_arguments[name] = arguments[i]->expr();
+    } else {
+      // We use const_cast to take the scan of the argument, which is dropped
+      // with the ResolvedTVFScan.
+      TVFBodyInliner::RelationArgument& relation_argument =
+          relation_arguments[name];
+      relation_argument.column_list = arguments[i]->argument_column_list();
+      relation_argument.scan =
+          const_cast<ResolvedTVFArgument*>(arguments[i].get())->release_scan();
+    }
+  }
+
+  TVFBodyInliner inliner(&scalar_arguments, &relation_arguments);
+  ZETASQL_RETURN_IF_ERROR(body->query()->Accept(&inliner));
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<const ResolvedScan> query,
+                   inliner.ConsumeRootNode<ResolvedScan>());
+
+  // The body was resolved by another Resolver, so none of its columns are
+  // pruned.
+  std::vector<const ResolvedNode*> scans;
+  query->GetDescendantsSatisfying(&ResolvedNode::IsScan, &scans);
+  for (const ResolvedNode* scan : scans) {
+    RecordColumnAccess(scan->GetAs<ResolvedScan>()->column_list());
+  }
+
+  std::vector<std::unique_ptr<const ResolvedComputedColumn>> expr_list;
+  for (int i = 0; i < tvf_scan->column_list_size(); ++i) {
+    expr_list.push_back(MakeResolvedComputedColumn(
+        tvf_scan->column_list(i),
+        MakeColumnRef(body->output_column_list(i)->column())));
+  }
+  *output = MakeResolvedProjectScan(tvf_scan->column_list(),
+                                    std::move(expr_list), std::move(query));
+  return ::zetasql_base::OkStatus();
+}
+
 zetasql_base::StatusOr<int> Resolver::MatchTVFSignature(
     const ASTTVF* ast_tvf, const TableValuedFunction* tvf_catalog_entry,
     const NameScope* external_scope, const NameScope* local_scope,
@@ -5618,9 +5823,9 @@ zetasql_base::Status Resolver::CoerceOrRearrangeTVFRelationArgColumns(
     if (result_type == nullptr) {
       new_column_list.push_back(provided_input_column);
     } else {
-      new_column_list.emplace_back(AllocateColumnId(), new_project_alias,
-                                   name_list->column(provided_col_idx).name,
-                                   result_type);
+      new_column_list.push_back(MakeColumn(
+          new_project_alias, name_list->column(provided_col_idx).name,
+          result_type));
       std::unique_ptr<const ResolvedExpr> resolved_cast(
           MakeColumnRef(provided_input_column, false /* is_correlated */));
       ZETASQL_RETURN_IF_ERROR(ResolveCastWithResolvedArgument(
@@ -5822,10 +6027,9 @@ zetasql_base::Status Resolver::ResolveArrayScan(
   }
   ZETASQL_RET_CHECK(!alias.empty());
 
-  const ResolvedColumn array_element_column(
-        AllocateColumnId(),
-        kArrayId /* table_name */, alias /* column_name */,
-        value_type->AsArray()->element_type());
+  const ResolvedColumn array_element_column = MakeColumn(
+      kArrayId /* table_name */, alias /* column_name */,
+      value_type->AsArray()->element_type());
 
   ResolvedColumnList output_column_list;
   if (*resolved_input_scan != nullptr) {
@@ -5856,10 +6060,9 @@ zetasql_base::Status Resolver::ResolveArrayScan(
         (with_offset_alias == nullptr ? kOffsetAlias
                                       : with_offset_alias->GetAsIdString());
 
-    const ResolvedColumn column(
-        AllocateColumnId(),
-        kArrayOffsetId /* table_name */, offset_alias /* column_name */,
-        type_factory_->get_int64());
+    const ResolvedColumn column = MakeColumn(kArrayOffsetId /* table_name */,
+                                             offset_alias /* column_name */,
+                                             type_factory_->get_int64());
     array_position_column = MakeResolvedColumnHolder(column);
     output_column_list.push_back(array_position_column->column());
 
@@ -6168,7 +6371,7 @@ zetasql_base::Status Resolver::ResolvePathExpressionAsTableScan(
   ZETASQL_RETURN_IF_ERROR(find_status);
 
   ZETASQL_RET_CHECK(table != nullptr);
-  const IdString table_name = MakeIdString(table->Name());
+  const IdString table_name = MakeCatalogIdString(table->Name());
 
   const bool is_value_table = table->IsValueTable();
   if (is_value_table) {
@@ -6179,13 +6382,13 @@ zetasql_base::Status Resolver::ResolvePathExpressionAsTableScan(
   std::shared_ptr<NameList> name_list(new NameList);
   for (int i = 0; i < table->NumColumns(); ++i) {
     const Column* column = table->GetColumn(i);
-    IdString column_name = MakeIdString(column->Name());
+    IdString column_name = MakeCatalogIdString(column->Name());
     if (column_name.empty()) {
       column_name = MakeIdString(absl::StrCat("$col", i + 1));
     }
 
-    column_list.emplace_back(ResolvedColumn(AllocateColumnId(), table_name,
-                                            column_name, column->GetType()));
+    column_list.emplace_back(MakeColumn(table_name, column_name,
+                                        column->GetType()));
     // Save the Catalog column for this ResolvedColumn so it can later be used
     // for checking column properties like Column::IsWritableColumn().
     resolved_columns_from_table_scans_[column_list.back()] = column;
@@ -6360,8 +6563,9 @@ zetasql_base::Status Resolver::CoerceQueryStatementResultToTypes(
           ast_location, target_type, &**scan,
           /* set_has_explicit_type =*/false,
           /* return_null_on_error =*/false, &casted_expr));
-      const ResolvedColumn casted_column(AllocateColumnId(), kCastedColumnId,
-                                         column_list[i].name, target_type);
+      const ResolvedColumn casted_column = MakeColumn(kCastedColumnId,
+                                                      column_list[i].name,
+                                                      target_type);
       RecordColumnAccess(casted_column);
       casted_column_list.emplace_back(casted_column);
       casted_exprs.push_back(
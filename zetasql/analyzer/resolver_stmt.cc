@@ -876,8 +876,8 @@ Resolver::ResolveColumnDefinitionNoCache(const ASTColumnDefinition* column,
   // Update column_name_list so that it can be used by the
   // ResolveGeneratedColumnInfo().
   const IdString column_name = column->name()->GetAsIdString();
-  ResolvedColumn defined_column(AllocateColumnId(), table_name_id_string,
-                                column_name, type);
+  ResolvedColumn defined_column = MakeColumn(table_name_id_string, column_name,
+                                             type);
   ZETASQL_RETURN_IF_ERROR(column_name_list->AddColumn(column_name, defined_column,
                                               /* is_explicit = */ true));
 
@@ -1541,9 +1541,9 @@ zetasql_base::Status Resolver::ResolveCreateIndexStatement(
       }
       case RESOLVED_GET_PROTO_FIELD:
       case RESOLVED_GET_STRUCT_FIELD: {
-        ResolvedColumn resolved_column(
-            AllocateColumnId(), /*table_name=*/table_alias,
-            GetAliasForExpression(path_expression), resolved_expr->type());
+        ResolvedColumn resolved_column = MakeColumn(
+            /*table_name=*/table_alias, GetAliasForExpression(path_expression),
+            resolved_expr->type());
         resolved_computed_columns.push_back(MakeResolvedComputedColumn(
             resolved_column, std::move(resolved_expr)));
         std::unique_ptr<ResolvedColumnRef> column_ref;
@@ -1684,8 +1684,7 @@ zetasql_base::Status Resolver::ResolveIndexUnnestExpressions(
     }
     ZETASQL_RET_CHECK(!alias_name.empty());
 
-    const ResolvedColumn array_element_column(
-        AllocateColumnId(),
+    const ResolvedColumn array_element_column = MakeColumn(
         /*table_name=*/kArrayId, /*name=*/alias_name,
         unnest_expr_type->AsArray()->element_type());
     std::shared_ptr<NameList> new_name_list(new NameList);
@@ -1703,10 +1702,9 @@ zetasql_base::Status Resolver::ResolveIndexUnnestExpressions(
           (with_offset_alias == nullptr ? kOffsetAlias
                                         : with_offset_alias->GetAsIdString());
 
-      const ResolvedColumn column(AllocateColumnId(),
-                                  /*table_name=*/kArrayOffsetId,
-                                  /*name=*/offset_alias,
-                                  type_factory_->get_int64());
+      const ResolvedColumn column = MakeColumn(/*table_name=*/kArrayOffsetId,
+                                               /*name=*/offset_alias,
+                                               type_factory_->get_int64());
       array_position_column = MakeResolvedColumnHolder(column);
 
       // We add the offset column as a value table column so its name acts
@@ -1975,9 +1973,8 @@ zetasql_base::Status Resolver::ResolveCreateTableStmtBaseProperties(
       for (const auto& ddl_pseudo_column : ddl_pseudo_columns_map) {
         const IdString pseudo_column_name =
             MakeIdString(ddl_pseudo_column.first);
-        const ResolvedColumn pseudo_column(
-            AllocateColumnId(), table_name_id_string, pseudo_column_name,
-            ddl_pseudo_column.second);
+        const ResolvedColumn pseudo_column = MakeColumn(
+            table_name_id_string, pseudo_column_name, ddl_pseudo_column.second);
         ZETASQL_RETURN_IF_ERROR(create_table_names.AddPseudoColumn(
             pseudo_column_name, pseudo_column, ast_statement));
         (statement_base_properties->pseudo_column_list)
@@ -2108,9 +2105,9 @@ zetasql_base::Status Resolver::ResolveQueryAndOutputColumns(
     output_column_list->push_back(
         MakeResolvedOutputColumn(column_name, named_column.column));
     if (column_definition_list != nullptr) {
-      ResolvedColumn defined_column(
-          AllocateColumnId(), table_name_id_string,
-          named_column.name, named_column.column.type());
+      ResolvedColumn defined_column = MakeColumn(table_name_id_string,
+                                                 named_column.name,
+                                                 named_column.column.type());
       column_definition_list->push_back(MakeResolvedColumnDefinition(
           column_name, named_column.column.type(),
           /* annotations = */ nullptr, /* is_hidden = */ false, defined_column,
@@ -3109,8 +3106,9 @@ zetasql_base::Status Resolver::CheckSQLBodyReturnTypesAndCoerceIfNeeded(
       if (provided_col_type->Equals(required_col_type)) {
         new_column_list.push_back(provided_col);
       } else {
-        new_column_list.emplace_back(AllocateColumnId(), new_project_alias,
-                                     provided_col.name_id(), required_col_type);
+        new_column_list.push_back(MakeColumn(new_project_alias,
+                                             provided_col.name_id(),
+                                             required_col_type));
         std::unique_ptr<const ResolvedExpr> resolved_cast =
             MakeColumnRef(provided_col, false /* is_correlated */);
         ZETASQL_RETURN_IF_ERROR(ResolveCastWithResolvedArgument(
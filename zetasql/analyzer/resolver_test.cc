@@ -745,6 +745,33 @@ TEST_F(ResolverTest, TestResolveFunctions) {
                        "No matching signature for function SQRT");
 }
 
+TEST_F(ResolverTest, TestResolveFunctionsWithSameArgumentTypes) {
+  // The second call of each function with the same argument types reuses the
+  // signature of the first one, unless the literals are different.
+  const std::vector<std::pair<std::string, const Type*>> expressions = {
+      {"CAST(1 AS UINT64) + 1", types::Uint64Type()},
+      {"CAST(1 AS UINT64) + 1", types::Uint64Type()},
+      // -1 cannot be coerced to UINT64.
+      {"CAST(1 AS UINT64) + -1", types::DoubleType()},
+      {"CAST(1 AS UINT64) + -1", types::DoubleType()},
+      {"CAST(1 AS UINT64) + 2", types::Uint64Type()},
+      {"CAST(1 AS INT32) + CAST(2 AS INT32)", types::Int64Type()},
+      {"CAST(1 AS INT32) + CAST(2 AS INT32)", types::Int64Type()},
+  };
+  for (const auto& expression : expressions) {
+    std::unique_ptr<ParserOutput> parser_output;
+    std::unique_ptr<const ResolvedExpr> resolved_expression;
+    ZETASQL_ASSERT_OK(
+        ParseExpression(expression.first, ParserOptions(), &parser_output));
+    ZETASQL_ASSERT_OK(ResolveExpr(parser_output->expression(), &resolved_expression))
+        << expression.first;
+    EXPECT_TRUE(resolved_expression->type()->Equals(expression.second))
+        << expression.first << ": " << resolved_expression->DebugString();
+  }
+  ResolveFunctionFails("sqrt('a')", "No matching signature for function SQRT");
+  ResolveFunctionFails("sqrt('a')", "No matching signature for function SQRT");
+}
+
 TEST_F(ResolverTest, TestResolveAggregateExpressions) {
   ParseAndResolveFunction("Count(*)", "ZetaSQL:sum",
                           true /* is aggregation function */,
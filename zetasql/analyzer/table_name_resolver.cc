@@ -16,9 +16,12 @@
 
 #include "zetasql/analyzer/table_name_resolver.h"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -31,6 +34,8 @@
 #include "zetasql/public/options.pb.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/types/span.h"
 #include "zetasql/base/case.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/ret_check.h"
@@ -46,6 +51,42 @@ namespace zetasql {
 namespace table_name_resolver {
 namespace {
 
+// Appends the nodes of kind <kind> under <root>, including <root> itself,
+// to <found_nodes>, without traversing below them. This is like
+// ASTNode::GetDescendantSubtreesWithKinds(), but does not build a std::set
+// and a std::queue on every call, which is significant here because it runs
+// for every expression of every statement.
+void FindSubtreesWithKind(const ASTNode* root, ASTNodeKind kind,
+                          std::vector<const ASTNode*>* found_nodes) {
+  absl::InlinedVector<const ASTNode*, 32> stack = {root};
+  while (!stack.empty()) {
+    const ASTNode* node = stack.back();
+    stack.pop_back();
+    if (node->node_kind() == kind) {
+      found_nodes->push_back(node);
+      continue;
+    }
+    // Push in reverse so that nodes are found in order.
+    for (int i = node->num_children() - 1; i >= 0; --i) {
+      stack.push_back(node->child(i));
+    }
+  }
+}
+
+// Appends the statements and expressions of a script that table names are
+// extracted from, in order: each descendant of <node> that is an expression
+// or a SQL statement, whether or not it is nested in another one.
+void CollectScriptItems(const ASTNode* node,
+                        std::vector<const ASTNode*>* items) {
+  for (int i = 0; i < node->num_children(); ++i) {
+    const ASTNode* child = node->child(i);
+    if (child->IsExpression() || child->IsSqlStatement()) {
+      items->push_back(child);
+    }
+    CollectScriptItems(child, items);
+  }
+}
+
 // Each instance should be used only once.
 class TableNameResolver {
  public:
@@ -74,16 +115,15 @@ class TableNameResolver {
   zetasql_base::Status FindTableNamesAndTemporalReferences(
       const ASTStatement& statement);
 
-  zetasql_base::Status FindTableNames(const ASTScript& script);
+  // Finds the table names in <items>, as returned by CollectScriptItems().
+  zetasql_base::Status FindTableNamesInScriptItems(
+      absl::Span<const ASTNode* const> items);
 
  private:
   typedef std::set<std::string> AliasSet;  // Always lowercase.
 
   zetasql_base::Status FindInStatement(const ASTStatement* statement);
 
-  // Consumes either an ASTScript, ASTStatementList, or ASTScriptStatement.
-  zetasql_base::Status FindInScriptNode(const ASTNode* node);
-
   zetasql_base::Status FindInQueryStatement(const ASTQueryStatement* statement);
 
   zetasql_base::Status FindInCreateViewStatement(
@@ -212,27 +252,21 @@ zetasql_base::Status TableNameResolver::FindTableNamesAndTemporalReferences(
   return ::zetasql_base::OkStatus();
 }
 
-zetasql_base::Status TableNameResolver::FindTableNames(const ASTScript& script) {
+zetasql_base::Status TableNameResolver::FindTableNamesInScriptItems(
+    absl::Span<const ASTNode* const> items) {
   table_names_->clear();
-  ZETASQL_RETURN_IF_ERROR(FindInScriptNode(&script));
+  for (const ASTNode* item : items) {
+    if (item->IsExpression()) {
+      ZETASQL_RETURN_IF_ERROR(FindInExpressionsUnder(item, /*visible_aliases=*/{}));
+    } else {
+      ZETASQL_RETURN_IF_ERROR(FindInStatement(item->GetAs<ASTStatement>()));
+    }
+  }
   // Sanity check - these should get popped.
   ZETASQL_RET_CHECK(local_table_aliases_.empty());
   return ::zetasql_base::OkStatus();
 }
 
-zetasql_base::Status TableNameResolver::FindInScriptNode(const ASTNode* node) {
-  for (int i = 0; i < node->num_children(); ++i) {
-    const ASTNode* child = node->child(i);
-    if (child->IsExpression()) {
-      ZETASQL_RETURN_IF_ERROR(FindInExpressionsUnder(child, /*visible_aliases=*/{}));
-    } else if (child->IsSqlStatement()) {
-      ZETASQL_RETURN_IF_ERROR(FindInStatement(child->GetAs<ASTStatement>()));
-    }
-    ZETASQL_RETURN_IF_ERROR(FindInScriptNode(child));
-  }
-  return zetasql_base::OkStatus();
-}
-
 zetasql_base::Status TableNameResolver::FindInStatement(const ASTStatement* statement) {
   // Find table name under OPTIONS (...) clause for any type of statement.
   ZETASQL_RETURN_IF_ERROR(FindInOptionsListUnder(statement, /*visible_aliases=*/{}));
@@ -1107,7 +1141,7 @@ zetasql_base::Status TableNameResolver::FindInExpressionsUnder(
   // which can be either ASTExpressionSubquery or ASTIn, both of which have
   // the subquery in an ASTQuery child.
   std::vector<const ASTNode*> subquery_nodes;
-  root->GetDescendantSubtreesWithKinds({AST_QUERY}, &subquery_nodes);
+  FindSubtreesWithKind(root, AST_QUERY, &subquery_nodes);
 
   for (const ASTNode* subquery_node : subquery_nodes) {
     ZETASQL_RETURN_IF_ERROR(FindInQuery(subquery_node->GetAs<ASTQuery>(),
@@ -1123,7 +1157,7 @@ zetasql_base::Status TableNameResolver::FindInOptionsListUnder(
   if (root == nullptr) return ::zetasql_base::OkStatus();
 
   std::vector<const ASTNode*> options_list_nodes;
-  root->GetDescendantSubtreesWithKinds({AST_OPTIONS_LIST}, &options_list_nodes);
+  FindSubtreesWithKind(root, AST_OPTIONS_LIST, &options_list_nodes);
 
   for (const ASTNode* options_list : options_list_nodes) {
     ZETASQL_RETURN_IF_ERROR(FindInExpressionsUnder(options_list, visible_aliases));
@@ -1146,10 +1180,58 @@ zetasql_base::Status FindTableNamesInScript(absl::string_view sql,
                                     const ASTScript& script,
                                     const AnalyzerOptions& analyzer_options,
                                     TableNamesSet* table_names) {
-  return TableNameResolver(sql, &analyzer_options, /*type_factory=*/nullptr,
-                           /*catalog=*/nullptr, table_names,
-                           /*table_resolution_time_info_map=*/nullptr)
-      .FindTableNames(script);
+  return FindTableNamesInScript(sql, script, analyzer_options,
+                                /*num_threads=*/1, table_names);
+}
+
+zetasql_base::Status FindTableNamesInScript(absl::string_view sql,
+                                    const ASTScript& script,
+                                    const AnalyzerOptions& analyzer_options,
+                                    int num_threads,
+                                    TableNamesSet* table_names) {
+  std::vector<const ASTNode*> items;
+  CollectScriptItems(&script, &items);
+  const int num_items = items.size();
+  if (num_threads <= 1 || num_items <= 1) {
+    return TableNameResolver(sql, &analyzer_options, /*type_factory=*/nullptr,
+                             /*catalog=*/nullptr, table_names,
+                             /*table_resolution_time_info_map=*/nullptr)
+        .FindTableNamesInScriptItems(items);
+  }
+
+  // Items are independent of each other, so each one is searched by its own
+  // TableNameResolver. Results are merged in order afterwards, so that the
+  // first error is the same as without threads.
+  std::vector<TableNamesSet> item_table_names(num_items);
+  std::vector<zetasql_base::Status> item_statuses(num_items);
+  std::atomic<int> next_item(0);
+  auto worker = [&]() {
+    while (true) {
+      const int i = next_item.fetch_add(1, std::memory_order_relaxed);
+      if (i >= num_items) return;
+      item_statuses[i] =
+          TableNameResolver(sql, &analyzer_options, /*type_factory=*/nullptr,
+                            /*catalog=*/nullptr, &item_table_names[i],
+                            /*table_resolution_time_info_map=*/nullptr)
+              .FindTableNamesInScriptItems({items[i]});
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < std::min(num_threads, num_items); ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  table_names->clear();
+  for (int i = 0; i < num_items; ++i) {
+    ZETASQL_RETURN_IF_ERROR(item_statuses[i]);
+    table_names->insert(item_table_names[i].begin(),
+                        item_table_names[i].end());
+  }
+  return ::zetasql_base::OkStatus();
 }
 
 }  // namespace table_name_resolver
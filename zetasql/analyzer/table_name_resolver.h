@@ -63,6 +63,15 @@ zetasql_base::Status FindTableNamesInScript(absl::string_view sql,
                                     const AnalyzerOptions& analyzer_options,
                                     TableNamesSet* table_names);
 
+// Same as above, but searches the statements and expressions of the script
+// on up to <num_threads> threads. The result, including which error is
+// returned, is the same as with one thread.
+zetasql_base::Status FindTableNamesInScript(absl::string_view sql,
+                                    const ASTScript& script,
+                                    const AnalyzerOptions& analyzer_options,
+                                    int num_threads,
+                                    TableNamesSet* table_names);
+
 inline zetasql_base::Status FindTables(absl::string_view sql,
                                const ASTStatement& statement,
                                const AnalyzerOptions& analyzer_options,
@@ -54,6 +54,162 @@ static void *aligned_malloc(size_t size, int minimum_alignment) {
     return ptr;
 }
 
+// ----------------------------------------------------------------------
+// Per-thread cache of released arena blocks.
+//    Arenas are often short-lived and created at a high rate (one or more
+//    per parsed or analyzed statement), so instead of returning their
+//    blocks to malloc, we keep up to kMaxCachedBytesPerThread of them per
+//    thread for the next arenas to reuse. Blocks are only reused for
+//    allocations of exactly the same size, which is the common case as
+//    arenas created at one call site use the same block size.
+// ----------------------------------------------------------------------
+
+#ifdef ADDRESS_SANITIZER
+
+// Reusing blocks would hide uses of the memory of destroyed arenas.
+static char* TakeCachedBlock(size_t size, size_t alignment) { return nullptr; }
+static void FreeBlock(char* mem, size_t size) { free(mem); }
+
+#else  // !ADDRESS_SANITIZER
+
+namespace {
+
+// Bigger blocks are rare and not worth holding on to.
+constexpr size_t kMaxCachedBlockSize = 1 << 20;
+constexpr size_t kMaxCachedBytesPerThread = 4 << 20;
+constexpr int kMaxCachedBlocksPerThread = 64;
+
+// Set once the cache of the thread has been destroyed, at thread exit.
+// Arenas destroyed after that free their blocks directly. The flag is
+// trivially destructible, so it stays usable during thread exit.
+thread_local bool block_cache_destroyed = false;
+
+class BlockCache {
+ public:
+  BlockCache() = default;
+  BlockCache(const BlockCache&) = delete;
+  BlockCache& operator=(const BlockCache&) = delete;
+
+  ~BlockCache() {
+    for (const Block& block : blocks_) free(block.mem);
+    block_cache_destroyed = true;
+  }
+
+  // Returns the cache of the current thread, or nullptr if it has already
+  // been destroyed.
+  static BlockCache* Get() {
+    if (block_cache_destroyed) return nullptr;
+    static thread_local BlockCache cache;
+    return &cache;
+  }
+
+  // Returns a cached block of exactly <size> bytes whose address is a
+  // multiple of <alignment>, or nullptr.
+  char* Take(size_t size, size_t alignment) {
+    // Look at the most recently released blocks first, they are the most
+    // likely to still be in the CPU caches.
+    for (int i = static_cast<int>(blocks_.size()) - 1; i >= 0; --i) {
+      const Block& block = blocks_[i];
+      if (block.size == size &&
+          (reinterpret_cast<uintptr_t>(block.mem) & (alignment - 1)) == 0) {
+        char* mem = block.mem;
+        cached_bytes_ -= size;
+        blocks_.erase(blocks_.begin() + i);
+        return mem;
+      }
+    }
+    return nullptr;
+  }
+
+  // Takes ownership of <mem>, a malloc()ed block of <size> bytes, evicting
+  // the oldest blocks if the cache is full.
+  void Release(char* mem, size_t size) {
+    if (size > kMaxCachedBlockSize) {
+      free(mem);
+      return;
+    }
+    int evicted = 0;
+    while (evicted < blocks_.size() &&
+           (blocks_.size() - evicted >= kMaxCachedBlocksPerThread ||
+            cached_bytes_ + size > kMaxCachedBytesPerThread)) {
+      free(blocks_[evicted].mem);
+      cached_bytes_ -= blocks_[evicted].size;
+      ++evicted;
+    }
+    blocks_.erase(blocks_.begin(), blocks_.begin() + evicted);
+    blocks_.push_back({mem, size});
+    cached_bytes_ += size;
+  }
+
+ private:
+  struct Block {
+    char* mem;
+    size_t size;
+  };
+  // Ordered from the least to the most recently released.
+  std::vector<Block> blocks_;
+  size_t cached_bytes_ = 0;
+};
+
+}  // namespace
+
+static char* TakeCachedBlock(size_t size, size_t alignment) {
+  BlockCache* cache = BlockCache::Get();
+  return cache != nullptr ? cache->Take(size, alignment) : nullptr;
+}
+
+static void FreeBlock(char* mem, size_t size) {
+  BlockCache* cache = BlockCache::Get();
+  if (cache != nullptr && mem != nullptr) {
+    cache->Release(mem, size);
+  } else {
+    free(mem);
+  }
+}
+
+#endif  // !ADDRESS_SANITIZER
+
+// Allocates a block of <size> bytes aligned to <alignment>, reusing a
+// cached block if possible. Returns nullptr if out of memory.
+static char* AllocBlock(size_t size, int alignment) {
+  char* mem = TakeCachedBlock(
+      size, std::max(alignment, static_cast<int>(sizeof(void*))));
+  if (mem != nullptr) return mem;
+  if (alignment > 1) {
+    return reinterpret_cast<char*>(aligned_malloc(size, alignment));
+  }
+  return reinterpret_cast<char*>(malloc(size));
+}
+
+// ----------------------------------------------------------------------
+// ArenaBlockSizeHint
+// ----------------------------------------------------------------------
+
+ArenaBlockSizeHint::ArenaBlockSizeHint(size_t min_block_size,
+                                       size_t max_block_size)
+    : min_block_size_(min_block_size),
+      max_block_size_(std::max(min_block_size, max_block_size)),
+      average_bytes_allocated_(0),
+      block_size_(min_block_size) {
+  CHECK_GT(min_block_size_, BaseArena::kDefaultAlignment);
+}
+
+void ArenaBlockSizeHint::Record(size_t bytes_allocated) {
+  size_t average = average_bytes_allocated_.load(std::memory_order_relaxed);
+  // Weighs the last arena by 1/4, to follow changes in the workload
+  // quickly without flapping on a single outlier.
+  average = average == 0 ? bytes_allocated
+                         : average - average / 4 + bytes_allocated / 4;
+  average_bytes_allocated_.store(average, std::memory_order_relaxed);
+
+  size_t block_size = min_block_size_;
+  while (block_size < average && block_size < max_block_size_) {
+    block_size *= 2;
+  }
+  block_size_.store(std::min(block_size, max_block_size_),
+                    std::memory_order_relaxed);
+}
+
 // The value here doesn't matter until page_aligned_ is supported.
 static const int kPageSize = 8192;   // should be getpagesize()
 
@@ -104,11 +260,10 @@ BaseArena::BaseArena(char* first, const size_t orig_block_size,
       // boundary.
       CHECK_EQ(block_size_ & (kPageSize - 1), 0) << "block_size is not a"
                                                  << "multiple of kPageSize";
-      first_blocks_[0].mem = reinterpret_cast<char*>(aligned_malloc(block_size_,
-                                                                    kPageSize));
+      first_blocks_[0].mem = AllocBlock(block_size_, kPageSize);
       PCHECK(nullptr != first_blocks_[0].mem);
     } else {
-      first_blocks_[0].mem = reinterpret_cast<char*>(malloc(block_size_));
+      first_blocks_[0].mem = AllocBlock(block_size_, 1);
     }
     first_blocks_[0].size = block_size_;
   }
@@ -117,6 +272,11 @@ BaseArena::BaseArena(char* first, const size_t orig_block_size,
 }
 
 BaseArena::~BaseArena() {
+  if (block_size_hint_ != nullptr) {
+    // The unused tail of the last block is not counted, so that the hint
+    // can also shrink the block size.
+    block_size_hint_->Record(status_.bytes_allocated() - remaining_);
+  }
   FreeBlocks();
   assert(overflow_blocks_ == nullptr);    // FreeBlocks() should do that
 #ifdef ADDRESS_SANITIZER
@@ -126,7 +286,7 @@ BaseArena::~BaseArena() {
 #endif
   // The first X blocks stay allocated always by default.  Delete them now.
   for (int i = first_block_externally_owned_ ? 1 : 0; i < blocks_alloced_; ++i)
-    free(first_blocks_[i].mem);
+    FreeBlock(first_blocks_[i].mem, first_blocks_[i].size);
 }
 
 // ----------------------------------------------------------------------
@@ -267,10 +427,9 @@ BaseArena::AllocatedBlock*  BaseArena::AllocNewBlock(const size_t block_size,
       size_t num_pages = ((adjusted_block_size - 1)/kPageSize) + 1;
       adjusted_block_size = num_pages * kPageSize;
     }
-    block->mem = reinterpret_cast<char*>(aligned_malloc(adjusted_block_size,
-                                                        adjusted_alignment));
+    block->mem = AllocBlock(adjusted_block_size, adjusted_alignment);
   } else {
-    block->mem = reinterpret_cast<char*>(malloc(adjusted_block_size));
+    block->mem = AllocBlock(adjusted_block_size, 1);
   }
   block->size = adjusted_block_size;
   PCHECK(nullptr != block->mem)
@@ -369,7 +528,7 @@ void* BaseArena::GetMemoryFallback(const size_t size, const int alignment) {
 
 void BaseArena::FreeBlocks() {
   for ( int i = 1; i < blocks_alloced_; ++i ) {  // keep first block alloced
-    free(first_blocks_[i].mem);
+    FreeBlock(first_blocks_[i].mem, first_blocks_[i].size);
     first_blocks_[i].mem = nullptr;
     first_blocks_[i].size = 0;
   }
@@ -377,7 +536,7 @@ void BaseArena::FreeBlocks() {
   if (overflow_blocks_ != nullptr) {
     std::vector<AllocatedBlock>::iterator it;
     for (it = overflow_blocks_->begin(); it != overflow_blocks_->end(); ++it) {
-      free(it->mem);
+      FreeBlock(it->mem, it->size);
     }
     delete overflow_blocks_;             // These should be used very rarely
     overflow_blocks_ = nullptr;
@@ -255,6 +255,7 @@
 
 #include <assert.h>
 #include <string.h>
+#include <atomic>
 #include <vector>
 #ifdef ADDRESS_SANITIZER
 #include <sanitizer/asan_interface.h>
@@ -265,9 +266,50 @@
 
 namespace zetasql_base {
 
+class BaseArena;
+
+// Suggests the block size of the arenas created at one call site, based on
+// the memory used by the arenas previously created there, so that arenas
+// which usually outgrow a small first block start out with a bigger one.
+// The suggestion is a power of two between the given bounds, tracking a
+// moving average of the bytes each arena had allocated when it was
+// destroyed. Thread-safe.
+//
+// Usage:
+//   static ArenaBlockSizeHint* hint = new ArenaBlockSizeHint(4096, 1 << 20);
+//   auto arena = std::make_shared<UnsafeArena>(hint);
+class ArenaBlockSizeHint {
+ public:
+  ArenaBlockSizeHint(size_t min_block_size, size_t max_block_size);
+  ArenaBlockSizeHint(const ArenaBlockSizeHint&) = delete;
+  ArenaBlockSizeHint& operator=(const ArenaBlockSizeHint&) = delete;
+
+  // Returns the suggested block size for the next arena.
+  size_t block_size() const {
+    return block_size_.load(std::memory_order_relaxed);
+  }
+
+  // Records that an arena created with this hint allocated <bytes_allocated>
+  // bytes in total. Called by the arena's destructor.
+  void Record(size_t bytes_allocated);
+
+ private:
+  const size_t min_block_size_;
+  const size_t max_block_size_;
+  // Updates race benignly: a lost update only delays the adaptation.
+  std::atomic<size_t> average_bytes_allocated_;
+  std::atomic<size_t> block_size_;
+};
+
 // This class is "thread-compatible": different threads can access the
 // arena at the same time without locking, as long as they use only
 // const methods.
+//
+// Blocks are not returned to malloc right away: each thread caches a few
+// megabytes of the blocks released by arenas on it, and new arenas reuse
+// cached blocks of the right size. This makes the many short-lived arenas
+// of parsing, analysis and evaluation much cheaper to create. There is no
+// cache in ASAN builds, to keep detecting uses of freed arena memory.
 class BaseArena {
  protected:         // You can't make an arena directly; only a subclass of one
   BaseArena(char* first_block, const size_t block_size, bool align_to_page);
@@ -344,6 +386,9 @@ class BaseArena {
 
   Status status_;
   size_t remaining_;
+  // If set, the arena reports its size to this hint when destroyed. Not
+  // owned.
+  ArenaBlockSizeHint* block_size_hint_ = nullptr;
 
  private:
   struct AllocatedBlock {
@@ -385,6 +430,13 @@ class UnsafeArena : public BaseArena {
     : BaseArena(nullptr, block_size, false) { }
   UnsafeArena(const size_t block_size, bool align)
     : BaseArena(nullptr, block_size, align) { }
+  // Allocates a thread-compatible arena with the block size suggested by
+  // "block_size_hint", and reports its size to it when destroyed.
+  // "block_size_hint" must outlive the arena.
+  explicit UnsafeArena(ArenaBlockSizeHint* block_size_hint)
+    : BaseArena(nullptr, block_size_hint->block_size(), false) {
+    block_size_hint_ = block_size_hint;
+  }
 
   // Allocates a thread-compatible arena with the specified block
   // size. "first_block" must have size "block_size". Memory is
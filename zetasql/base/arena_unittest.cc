@@ -931,4 +931,65 @@ TEST(ArenaTest, StrndupWithUnterminatedStringSafe) {
   TestStrndupUnterminated<SafeArena>();
 }
 
+//------------------------------------------------------------------------
+
+#ifndef ADDRESS_SANITIZER
+TEST(ArenaTest, ReusesReleasedBlocks) {
+  const char* first_block;
+  {
+    UnsafeArena arena(8192);
+    first_block = arena.Alloc(16);
+  }
+  // The block of the destroyed arena is cached and reused for the next
+  // arena of the same block size.
+  UnsafeArena arena(8192);
+  EXPECT_EQ(first_block, arena.Alloc(16));
+  // Blocks of other sizes are not.
+  UnsafeArena other_arena(16384);
+  EXPECT_NE(first_block, other_arena.Alloc(16));
+}
+#endif  // ADDRESS_SANITIZER
+
+TEST(ArenaTest, ReusedBlocksStayUsable) {
+  for (int i = 0; i < 100; ++i) {
+    UnsafeArena arena(1024);
+    for (int j = 0; j < 100; ++j) {
+      char* const mem = arena.Alloc(i + j + 1);
+      memset(mem, 'x', i + j + 1);
+    }
+  }
+}
+
+TEST(ArenaBlockSizeHintTest, Adapts) {
+  ArenaBlockSizeHint hint(/*min_block_size=*/1024,
+                          /*max_block_size=*/1 << 16);
+  EXPECT_EQ(1024, hint.block_size());
+
+  hint.Record(10000);
+  EXPECT_EQ(16384, hint.block_size());
+  for (int i = 0; i < 100; ++i) {
+    hint.Record(1 << 20);
+  }
+  EXPECT_EQ(1 << 16, hint.block_size());
+  for (int i = 0; i < 100; ++i) {
+    hint.Record(100);
+  }
+  EXPECT_EQ(1024, hint.block_size());
+}
+
+TEST(ArenaBlockSizeHintTest, RecordedByArena) {
+  ArenaBlockSizeHint hint(/*min_block_size=*/1024,
+                          /*max_block_size=*/1 << 16);
+  {
+    UnsafeArena arena(&hint);
+    EXPECT_EQ(1024, arena.block_size());
+    for (int i = 0; i < 100; ++i) {
+      arena.Alloc(100);
+    }
+  }
+  EXPECT_EQ(16384, hint.block_size());
+  UnsafeArena arena(&hint);
+  EXPECT_EQ(16384, arena.block_size());
+}
+
 }  // namespace zetasql_base
@@ -14,7 +14,7 @@
 // limitations under the License.
 //
 
-// Internal helpers for flat_set.h
+// Internal helpers for flat_set.h and flat_map.h
 
 #ifndef THIRD_PARTY_ZETASQL_ZETASQL_BASE_FLAT_INTERNAL_H_
 #define THIRD_PARTY_ZETASQL_ZETASQL_BASE_FLAT_INTERNAL_H_
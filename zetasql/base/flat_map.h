@@ -0,0 +1,446 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// flat_map is a map implementation that uses a contiguous container (by
+// default, std::vector) of key/value pairs instead of a binary tree. It is
+// the map counterpart of flat_set (see flat_set.h), with the same trade-offs:
+// zero per-entry memory overhead and fast, cache-friendly lookups, at the
+// cost of linear mutations that invalidate iterators.
+//
+// The typical use cases for flat_map are small maps that are built once, or
+// mostly appended to in key order, and then looked up many times, e.g. the
+// per-scope maps of the analyzer.
+//
+// Detailed comparison with std::map (using std::vector as an underlying
+// type):
+//   + zero per-entry memory overhead
+//   + smaller map object size
+//   + random-access iterators provided
+//   + reserve(), capacity(), shrink_to_fit() provided
+//   + mutations (insert, erase) at the end() are O(1)
+//   - mutations are generally O(n)
+//   - mutations may invalidate all iterators & pointers to elements
+//   - value_type is std::pair<Key, Value> rather than
+//     std::pair<const Key, Value>, as elements must be movable. Keys must not
+//     be modified through iterators.
+
+#ifndef THIRD_PARTY_ZETASQL_ZETASQL_BASE_FLAT_MAP_H_
+#define THIRD_PARTY_ZETASQL_ZETASQL_BASE_FLAT_MAP_H_
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/meta/type_traits.h"
+#include "zetasql/base/flat_internal.h"
+#include "zetasql/base/logging.h"
+
+namespace zetasql_base {
+
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          typename Rep = std::vector<std::pair<Key, Value>>>
+class flat_map {
+  // Whether Compare is a transparent comparator. The fake dependency on K only
+  // exists to allow SFINAE in methods templated by K.
+  template <typename K>
+  static constexpr bool CompareIsTransparent() {
+    return internal_flat::is_transparent<Compare>();
+  }
+
+ public:
+  using container_type = Rep;
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = typename container_type::value_type;
+  using key_compare = Compare;
+  using value_compare = internal_flat::value_compare<Compare>;
+
+  using reference = typename container_type::reference;
+  using const_reference = typename container_type::const_reference;
+  using pointer = typename container_type::pointer;
+  using const_pointer = typename container_type::const_pointer;
+  using size_type = typename container_type::size_type;
+  using difference_type = typename container_type::difference_type;
+
+  // Random access iterators, as in flat_set. Unlike flat_set, mutable
+  // iterators are exposed so that mapped values can be modified in place.
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+  using reverse_iterator = typename container_type::reverse_iterator;
+  using const_reverse_iterator =
+      typename container_type::const_reverse_iterator;
+
+  // construct/copy/destroy:
+  flat_map() : flat_map(Compare()) {}
+  explicit flat_map(const Compare& cmp) : impl_(value_compare(cmp)) {}
+
+  // If multiple elements in the input range have equal keys, the first of
+  // them will be present in the map.
+  template <typename InputIterator>
+  flat_map(InputIterator first, InputIterator last,
+           const Compare& cmp = Compare())
+      : flat_map(cmp) {
+    insert(first, last);
+  }
+
+  flat_map(std::initializer_list<value_type> init,
+           const Compare& cmp = Compare())
+      : flat_map(init.begin(), init.end(), cmp) {}
+
+  flat_map(const flat_map& m) = default;
+  flat_map(flat_map&& m) = default;
+  flat_map& operator=(const flat_map& m) = default;
+  flat_map& operator=(flat_map&& m) = default;
+
+  // Constructs underlying container by moving the given one.
+  // Note: the given container need not be pre-sorted.
+  explicit flat_map(Rep rep, const Compare& cmp = Compare())
+      : impl_(value_compare(cmp), std::move(rep)) {}
+
+  // Constructs underlying container directly by perfect forwarding arguments to
+  // its constructor. The constructed container MUST be strictly ordered by
+  // key. If not, the behavior is undefined (and the ordering is verified with
+  // assert() in debug builds).
+  template <typename... Args, typename = absl::enable_if_t<
+                                  std::is_constructible<Rep, Args...>::value>>
+  explicit flat_map(sorted_unique_container_t, Args&&... args)
+      : impl_(sorted_container, value_compare(Compare()),
+              std::forward<Args>(args)...) {}
+
+  template <typename... Args, typename = absl::enable_if_t<
+                                  std::is_constructible<Rep, Args...>::value>>
+  flat_map(sorted_unique_container_t, const Compare& cmp, Args&&... args)
+      : impl_(sorted_container, value_compare(cmp),
+              std::forward<Args>(args)...) {}
+
+  // iterators:
+  iterator begin() { return rep().begin(); }
+  const_iterator begin() const { return rep().begin(); }
+  iterator end() { return rep().end(); }
+  const_iterator end() const { return rep().end(); }
+
+  reverse_iterator rbegin() { return rep().rbegin(); }
+  const_reverse_iterator rbegin() const { return rep().rbegin(); }
+  reverse_iterator rend() { return rep().rend(); }
+  const_reverse_iterator rend() const { return rep().rend(); }
+
+  const_iterator cbegin() const { return rep().cbegin(); }
+  const_iterator cend() const { return rep().cend(); }
+  const_reverse_iterator crbegin() const { return rep().crbegin(); }
+  const_reverse_iterator crend() const { return rep().crend(); }
+
+  // capacity:
+  bool empty() const { return rep().empty(); }
+  size_type size() const { return rep().size(); }
+  size_type max_size() const { return rep().max_size(); }
+
+  // element access:
+  mapped_type& operator[](const key_type& k) {
+    return try_emplace(k).first->second;
+  }
+  mapped_type& operator[](key_type&& k) {
+    return try_emplace(std::move(k)).first->second;
+  }
+
+  mapped_type& at(const key_type& k) {
+    auto it = find(k);
+    CHECK(it != end()) << "flat_map::at: key not found";
+    return it->second;
+  }
+  const mapped_type& at(const key_type& k) const {
+    auto it = find(k);
+    CHECK(it != end()) << "flat_map::at: key not found";
+    return it->second;
+  }
+
+  // modifiers:
+
+  // As in flat_set, emplace* methods construct a temporary value_type and
+  // do not provide a performance advantage over insert + move. try_emplace
+  // only constructs the value if the key is absent.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+  template <typename... Args>
+  iterator emplace_hint(const_iterator position, Args&&... args) {
+    return insert(position, value_type(std::forward<Args>(args)...));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& k, Args&&... args) {
+    return TryEmplaceImpl(k, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& k, Args&&... args) {
+    return TryEmplaceImpl(std::move(k), std::forward<Args>(args)...);
+  }
+
+  std::pair<iterator, bool> insert(const value_type& v) {
+    return internal_flat::insert(&rep(), v, value_comp());
+  }
+  std::pair<iterator, bool> insert(value_type&& v) {
+    return internal_flat::insert(&rep(), std::move(v), value_comp());
+  }
+
+  iterator insert(const_iterator hint, const value_type& v) {
+    return internal_flat::insert_hint(&rep(), hint, v, value_comp());
+  }
+  iterator insert(const_iterator hint, value_type&& v) {
+    return internal_flat::insert_hint(&rep(), hint, std::move(v),
+                                      value_comp());
+  }
+
+  // If multiple elements in the input range have equal keys, the first of
+  // them will be present in the map.
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    internal_flat::insert_range(&rep(), first, last, value_comp());
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& k, M&& m) {
+    return internal_flat::insert_or_assign(
+        &rep(), value_type(k, std::forward<M>(m)), value_comp());
+  }
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& k, M&& m) {
+    return internal_flat::insert_or_assign(
+        &rep(), value_type(std::move(k), std::forward<M>(m)), value_comp());
+  }
+
+  iterator erase(const_iterator it) { return rep().erase(it); }
+  iterator erase(iterator it) { return rep().erase(it); }
+  size_type erase(const key_type& k) {
+    auto it = find(k);
+    if (it == end()) return 0;
+    erase(it);
+    return 1;
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    return rep().erase(first, last);
+  }
+
+  // Removes all elements for which predicate 'p' returns 'true'.
+  template <class UnaryPredicate>
+  size_t remove_if(UnaryPredicate p) {
+    const auto it = std::remove_if(rep().begin(), rep().end(), p);
+    auto n_erased = std::distance(it, rep().end());
+    rep().erase(it, rep().end());
+    return n_erased;
+  }
+
+  void swap(flat_map& other) { rep().swap(other.rep()); }
+  void clear() { rep().clear(); }
+
+  // observers:
+  key_compare key_comp() const { return impl_.cmp(); }
+  value_compare value_comp() const { return impl_.cmp(); }
+
+  // map operations:
+  iterator find(const key_type& k) { return FindImpl(k); }
+  const_iterator find(const key_type& k) const { return FindImpl(k); }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(), iterator> find(const K& k) {
+    return FindImpl(k);
+  }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(), const_iterator> find(
+      const K& k) const {
+    return FindImpl(k);
+  }
+
+  size_type count(const key_type& k) const {
+    return find(k) == end() ? 0 : 1;
+  }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(), size_type> count(
+      const K& k) const {
+    return find(k) == end() ? 0 : 1;
+  }
+
+  bool contains(const key_type& k) const { return find(k) != end(); }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(), bool> contains(
+      const K& k) const {
+    return find(k) != end();
+  }
+
+  iterator lower_bound(const key_type& k) { return LowerBoundImpl(k); }
+  const_iterator lower_bound(const key_type& k) const {
+    return LowerBoundImpl(k);
+  }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(), iterator> lower_bound(
+      const K& k) {
+    return LowerBoundImpl(k);
+  }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(), const_iterator> lower_bound(
+      const K& k) const {
+    return LowerBoundImpl(k);
+  }
+
+  iterator upper_bound(const key_type& k) { return UpperBoundImpl(k); }
+  const_iterator upper_bound(const key_type& k) const {
+    return UpperBoundImpl(k);
+  }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(), iterator> upper_bound(
+      const K& k) {
+    return UpperBoundImpl(k);
+  }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(), const_iterator> upper_bound(
+      const K& k) const {
+    return UpperBoundImpl(k);
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type& k) {
+    return {lower_bound(k), upper_bound(k)};
+  }
+  std::pair<const_iterator, const_iterator> equal_range(
+      const key_type& k) const {
+    return {lower_bound(k), upper_bound(k)};
+  }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(), std::pair<iterator, iterator>>
+  equal_range(const K& k) {
+    return {lower_bound(k), upper_bound(k)};
+  }
+  template <typename K>
+  absl::enable_if_t<CompareIsTransparent<K>(),
+                    std::pair<const_iterator, const_iterator>>
+  equal_range(const K& k) const {
+    return {lower_bound(k), upper_bound(k)};
+  }
+
+  // capacity-related extensions from std::vector interface:
+  void reserve(size_type capacity) { rep().reserve(capacity); }
+  size_type capacity() const { return rep().capacity(); }
+  void shrink_to_fit() { rep().shrink_to_fit(); }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const flat_map& map) {
+    return H::combine(std::move(h), map.rep());
+  }
+
+ private:
+  Rep& rep() { return impl_.rep; }
+  const Rep& rep() const { return impl_.rep; }
+  // The comparator on keys. value_compare hides its operator().
+  const Compare& key_cmp() const { return impl_.cmp(); }
+
+  // Binary searches on the keys only, so that lookups work with any key type
+  // accepted by Compare.
+  template <typename K>
+  iterator LowerBoundImpl(const K& k) {
+    return rep().begin() + (static_cast<const flat_map*>(this)->
+                                LowerBoundImpl(k) - rep().cbegin());
+  }
+  template <typename K>
+  const_iterator LowerBoundImpl(const K& k) const {
+    const Compare& cmp = key_cmp();
+    return std::lower_bound(
+        rep().begin(), rep().end(), k,
+        [&cmp](const value_type& v, const K& key) {
+          return cmp(v.first, key);
+        });
+  }
+  template <typename K>
+  iterator UpperBoundImpl(const K& k) {
+    return rep().begin() + (static_cast<const flat_map*>(this)->
+                                UpperBoundImpl(k) - rep().cbegin());
+  }
+  template <typename K>
+  const_iterator UpperBoundImpl(const K& k) const {
+    const Compare& cmp = key_cmp();
+    return std::upper_bound(
+        rep().begin(), rep().end(), k,
+        [&cmp](const K& key, const value_type& v) {
+          return cmp(key, v.first);
+        });
+  }
+  template <typename K>
+  iterator FindImpl(const K& k) {
+    auto it = LowerBoundImpl(k);
+    if (it == end() || key_cmp()(k, it->first)) return end();
+    return it;
+  }
+  template <typename K>
+  const_iterator FindImpl(const K& k) const {
+    auto it = LowerBoundImpl(k);
+    if (it == end() || key_cmp()(k, it->first)) return end();
+    return it;
+  }
+
+  template <typename K, typename... Args>
+  std::pair<iterator, bool> TryEmplaceImpl(K&& k, Args&&... args) {
+    auto it = LowerBoundImpl(k);
+    if (it != end() && !key_cmp()(k, it->first)) return {it, false};
+    it = rep().emplace(it, std::piecewise_construct,
+                       std::forward_as_tuple(std::forward<K>(k)),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+    return {it, true};
+  }
+
+  friend bool operator==(const flat_map& x, const flat_map& y) {
+    return x.rep() == y.rep();
+  }
+  friend bool operator<(const flat_map& x, const flat_map& y) {
+    // As in flat_set, ordering associative containers always uses the
+    // default '<' operator.
+    return x.rep() < y.rep();
+  }
+
+  internal_flat::Impl<value_compare, Rep> impl_;
+};
+
+template <typename K, typename V, typename C, typename R>
+bool operator!=(const flat_map<K, V, C, R>& x, const flat_map<K, V, C, R>& y) {
+  return !(x == y);
+}
+
+template <typename K, typename V, typename C, typename R>
+bool operator>(const flat_map<K, V, C, R>& x, const flat_map<K, V, C, R>& y) {
+  return y < x;
+}
+
+template <typename K, typename V, typename C, typename R>
+bool operator<=(const flat_map<K, V, C, R>& x, const flat_map<K, V, C, R>& y) {
+  return !(y < x);
+}
+
+template <typename K, typename V, typename C, typename R>
+bool operator>=(const flat_map<K, V, C, R>& x, const flat_map<K, V, C, R>& y) {
+  return !(x < y);
+}
+
+template <typename K, typename V, typename C, typename R>
+void swap(flat_map<K, V, C, R>& x, flat_map<K, V, C, R>& y) {
+  return x.swap(y);
+}
+
+}  // namespace zetasql_base
+
+#endif  // THIRD_PARTY_ZETASQL_ZETASQL_BASE_FLAT_MAP_H_
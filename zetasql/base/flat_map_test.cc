@@ -0,0 +1,266 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "zetasql/base/flat_map.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/hash/hash_testing.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+
+namespace zetasql_base {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+
+struct ReverseCmp {
+  bool operator()(int x, int y) const { return x > y; }
+};
+
+// Compares std::string with absl::string_view.
+struct TransparentCmp {
+  bool operator()(absl::string_view x, absl::string_view y) const {
+    return x < y;
+  }
+  using is_transparent = void;
+};
+
+TEST(FlatMapTest, DefaultIsSane) {
+  flat_map<int, int> m;
+  EXPECT_THAT(m, IsEmpty());
+  EXPECT_EQ(0, m.size());
+  EXPECT_TRUE(m.begin() == m.end());
+  EXPECT_TRUE(m.find(1) == m.end());
+  EXPECT_FALSE(m.contains(1));
+  EXPECT_EQ(0, m.count(1));
+}
+
+TEST(FlatMapTest, RangeAndListConstruction) {
+  const std::vector<std::pair<int, int>> v = {{3, 30}, {1, 10}, {3, 31}};
+  flat_map<int, int> from_range(v.begin(), v.end());
+  EXPECT_THAT(from_range, ElementsAre(Pair(1, 10), Pair(3, 30)));
+
+  flat_map<int, int> from_list = {{2, 20}, {1, 10}, {2, 21}};
+  EXPECT_THAT(from_list, ElementsAre(Pair(1, 10), Pair(2, 20)));
+
+  flat_map<int, int> from_container(
+      std::vector<std::pair<int, int>>{{5, 50}, {4, 40}});
+  EXPECT_THAT(from_container, ElementsAre(Pair(4, 40), Pair(5, 50)));
+}
+
+TEST(FlatMapTest, ExplicitComparator) {
+  flat_map<int, int, ReverseCmp> m = {{1, 10}, {3, 30}, {2, 20}};
+  EXPECT_THAT(m, ElementsAre(Pair(3, 30), Pair(2, 20), Pair(1, 10)));
+  EXPECT_EQ(20, m.at(2));
+}
+
+TEST(FlatMapTest, InsertHandlesDuplicates) {
+  flat_map<int, std::string> m;
+  EXPECT_TRUE(m.insert({2, "b"}).second);
+  EXPECT_TRUE(m.insert({1, "a"}).second);
+  auto result = m.insert({2, "c"});
+  EXPECT_FALSE(result.second);
+  EXPECT_EQ("b", result.first->second);
+  EXPECT_THAT(m, ElementsAre(Pair(1, "a"), Pair(2, "b")));
+
+  EXPECT_FALSE(m.insert_or_assign(2, "c").second);
+  EXPECT_TRUE(m.insert_or_assign(3, "d").second);
+  EXPECT_THAT(m, ElementsAre(Pair(1, "a"), Pair(2, "c"), Pair(3, "d")));
+}
+
+TEST(FlatMapTest, InsertWithHint) {
+  flat_map<int, int> m;
+  for (int i = 0; i < 10; ++i) {
+    m.insert(m.end(), {i, i * 10});
+  }
+  // A bad hint still inserts at the right place.
+  m.insert(m.begin(), {20, 200});
+  // An existing key is kept.
+  EXPECT_EQ(50, m.insert(m.begin() + 5, {5, 0})->second);
+  EXPECT_EQ(11, m.size());
+  EXPECT_TRUE(std::is_sorted(m.begin(), m.end()));
+}
+
+TEST(FlatMapTest, SubscriptAndTryEmplace) {
+  flat_map<std::string, int> m;
+  m["b"] = 2;
+  m["a"] = 1;
+  ++m["b"];
+  EXPECT_THAT(m, ElementsAre(Pair("a", 1), Pair("b", 3)));
+
+  EXPECT_FALSE(m.try_emplace("a", 10).second);
+  EXPECT_TRUE(m.try_emplace("c", 10).second);
+  EXPECT_THAT(m, ElementsAre(Pair("a", 1), Pair("b", 3), Pair("c", 10)));
+
+  const auto& const_m = m;
+  EXPECT_EQ(3, const_m.at("b"));
+}
+
+TEST(FlatMapTest, EraseWorks) {
+  flat_map<int, int> m = {{1, 10}, {2, 20}, {3, 30}, {4, 40}};
+  EXPECT_EQ(1, m.erase(2));
+  EXPECT_EQ(0, m.erase(2));
+  m.erase(m.find(4));
+  EXPECT_THAT(m, ElementsAre(Pair(1, 10), Pair(3, 30)));
+  m.erase(m.begin(), m.end());
+  EXPECT_THAT(m, IsEmpty());
+}
+
+TEST(FlatMapTest, RemoveIfWorks) {
+  flat_map<int, int> m = {{1, 1}, {2, 4}, {3, 9}, {4, 16}};
+  EXPECT_EQ(2, m.remove_if(
+                   [](const std::pair<int, int>& e) { return e.first % 2; }));
+  EXPECT_THAT(m, ElementsAre(Pair(2, 4), Pair(4, 16)));
+}
+
+TEST(FlatMapTest, BinarySearchesWork) {
+  const flat_map<int, int> m = {{10, 1}, {20, 2}, {30, 3}};
+  EXPECT_EQ(20, m.lower_bound(15)->first);
+  EXPECT_EQ(20, m.lower_bound(20)->first);
+  EXPECT_EQ(30, m.upper_bound(20)->first);
+  EXPECT_TRUE(m.upper_bound(30) == m.end());
+  auto range = m.equal_range(20);
+  EXPECT_EQ(1, std::distance(range.first, range.second));
+  range = m.equal_range(25);
+  EXPECT_EQ(0, std::distance(range.first, range.second));
+}
+
+TEST(FlatMapTest, ValuesAreMutable) {
+  flat_map<int, int> m = {{1, 10}, {2, 20}};
+  for (auto& entry : m) {
+    entry.second *= 2;
+  }
+  m.find(1)->second += 1;
+  EXPECT_THAT(m, ElementsAre(Pair(1, 21), Pair(2, 40)));
+}
+
+TEST(FlatMapTest, HeterogeneousLookup) {
+  flat_map<std::string, int, TransparentCmp> m = {{"a", 1}, {"bc", 2}};
+  absl::string_view key = "bc";
+  EXPECT_EQ(2, m.find(key)->second);
+  EXPECT_TRUE(m.contains(key));
+  EXPECT_EQ(1, m.count(absl::string_view("a")));
+  EXPECT_TRUE(m.find(absl::string_view("b")) == m.end());
+  EXPECT_EQ("bc", m.lower_bound(absl::string_view("b"))->first);
+}
+
+TEST(FlatMapTest, NonCopyableValues) {
+  flat_map<int, std::unique_ptr<int>> m;
+  m[2] = absl::make_unique<int>(20);
+  m.try_emplace(1, absl::make_unique<int>(10));
+  m.insert({3, absl::make_unique<int>(30)});
+  ASSERT_EQ(3, m.size());
+  EXPECT_EQ(10, *m.at(1));
+  EXPECT_EQ(20, *m.at(2));
+  EXPECT_EQ(30, *m.at(3));
+
+  flat_map<int, std::unique_ptr<int>> moved = std::move(m);
+  EXPECT_EQ(3, moved.size());
+  EXPECT_THAT(m, IsEmpty());  // NOLINT: checks the moved-from state.
+}
+
+TEST(FlatMapTest, CopyAndComparisons) {
+  const flat_map<int, int> a = {{1, 10}, {2, 20}};
+  flat_map<int, int> b = a;
+  EXPECT_EQ(a, b);
+  b[2] = 21;
+  EXPECT_NE(a, b);
+  EXPECT_LT(a, b);
+  EXPECT_GT(b, a);
+  EXPECT_LE(a, a);
+  EXPECT_GE(b, a);
+
+  flat_map<int, int> c;
+  swap(b, c);
+  EXPECT_THAT(b, IsEmpty());
+  EXPECT_EQ(2, c.size());
+  c.swap(b);
+  EXPECT_THAT(c, IsEmpty());
+}
+
+TEST(FlatMapTest, InstantiatesWithInlinedVector) {
+  flat_map<int, int, std::less<int>,
+           absl::InlinedVector<std::pair<int, int>, 4>>
+      m = {{2, 20}, {1, 10}};
+  EXPECT_THAT(m, ElementsAre(Pair(1, 10), Pair(2, 20)));
+  m[0] = 0;
+  EXPECT_EQ(0, m.begin()->second);
+}
+
+TEST(FlatMapTest, SortedUniqueContainerConstructor) {
+  flat_map<int, int> m(sorted_unique_container,
+                       std::vector<std::pair<int, int>>{{1, 10}, {2, 20}});
+  EXPECT_THAT(m, ElementsAre(Pair(1, 10), Pair(2, 20)));
+}
+
+TEST(FlatMapTest, VectorExtensions) {
+  flat_map<int, int> m;
+  m.reserve(10);
+  EXPECT_GE(m.capacity(), 10);
+  m[1] = 1;
+  m.shrink_to_fit();
+  EXPECT_EQ(1, m.size());
+}
+
+TEST(FlatMapTest, MatchesStdMap) {
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> key(0, 50);
+  flat_map<int, int> flat;
+  std::map<int, int> reference;
+  for (int i = 0; i < 1000; ++i) {
+    const int k = key(random);
+    switch (i % 3) {
+      case 0:
+        flat[k] += i;
+        reference[k] += i;
+        break;
+      case 1:
+        flat.insert({k, i});
+        reference.insert({k, i});
+        break;
+      case 2:
+        EXPECT_EQ(reference.erase(k), flat.erase(k));
+        break;
+    }
+  }
+  const std::vector<std::pair<int, int>> expected(reference.begin(),
+                                                  reference.end());
+  EXPECT_THAT(flat, ElementsAreArray(expected));
+}
+
+TEST(FlatMapTest, Hash) {
+  EXPECT_TRUE(absl::VerifyTypeImplementsAbslHashCorrectly({
+      flat_map<int, int>(),
+      flat_map<int, int>{{1, 10}},
+      flat_map<int, int>{{1, 11}},
+      flat_map<int, int>{{1, 10}, {2, 20}},
+  }));
+}
+
+}  // namespace
+}  // namespace zetasql_base
@@ -16,6 +16,7 @@
 
 #include "zetasql/base/status.h"
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "zetasql/base/map_util.h"
@@ -40,28 +41,39 @@ std::ostream& operator<<(std::ostream& os, StatusCode code) {
   return os << StatusCodeToString(code);
 }
 
-Status::Status(StatusCode code, absl::string_view message)
-    : code_(code), message_(code == StatusCode::kOk ? "" : message) {}
+Status::Status(StatusCode code, absl::string_view message) : code_(code) {
+  if (code != StatusCode::kOk) {
+    rep_ = absl::make_unique<Rep>();
+    rep_->message = std::string(message);
+  }
+}
+
+std::unique_ptr<Status::Rep> Status::CopyRep(const Rep& rep) {
+  return absl::make_unique<Rep>(rep);
+}
 
 std::string Status::ToString() const {
-  return ok() ? "OK" : absl::StrCat(StatusCodeToString(code()), ": ", message_);
+  return ok() ? "OK"
+              : absl::StrCat(StatusCodeToString(code()), ": ", message());
 }
 
 void Status::SetPayload(absl::string_view type_url, const StatusCord& payload) {
   if (!ok()) {
-    InsertOrUpdate(&payload_, std::string(type_url), payload);
+    if (rep_ == nullptr) rep_ = absl::make_unique<Rep>();
+    InsertOrUpdate(&rep_->payload, std::string(type_url), payload);
   }
 }
 
 absl::optional<StatusCord> Status::GetPayload(
     absl::string_view type_url) const {
-  auto it = payload_.find(std::string(type_url));
-  if (it == payload_.end()) return absl::nullopt;
+  if (rep_ == nullptr) return absl::nullopt;
+  auto it = rep_->payload.find(std::string(type_url));
+  if (it == rep_->payload.end()) return absl::nullopt;
   return it->second;
 }
 
 void Status::ErasePayload(absl::string_view type_url) {
-  payload_.erase(std::string(type_url));
+  if (rep_ != nullptr) rep_->payload.erase(std::string(type_url));
 }
 
 std::ostream& operator<<(std::ostream& os, const Status& x) {
@@ -17,6 +17,7 @@
 #ifndef THIRD_PARTY_ZETASQL_ZETASQL_BASE_STATUS_H_
 #define THIRD_PARTY_ZETASQL_ZETASQL_BASE_STATUS_H_
 
+#include <memory>
 #include <ostream>
 #include <string>
 #include <unordered_map>
@@ -78,18 +79,36 @@ constexpr StatusCode DATA_LOSS = StatusCode::kDataLoss;
 
 class ABSL_MUST_USE_RESULT Status;
 
+// An OK Status is just a status code, and constructing, copying, checking
+// and destroying it never allocates, so that returning Status from the
+// functions called for each row is cheap. The message and the payloads of
+// an error are only allocated when the error is constructed.
 class Status final {
  public:
   // Builds an OK Status.
   Status() = default;
 
+  Status(const Status& x)
+      : code_(x.code_), rep_(x.rep_ == nullptr ? nullptr : CopyRep(*x.rep_)) {}
+  Status& operator=(const Status& x) {
+    if (this != &x) {
+      code_ = x.code_;
+      rep_ = x.rep_ == nullptr ? nullptr : CopyRep(*x.rep_);
+    }
+    return *this;
+  }
+  Status(Status&&) noexcept = default;
+  Status& operator=(Status&&) noexcept = default;
+
   // Constructs a Status object containing a status code and message.
   // If `code == StatusCode::kOk`, `msg` is ignored and an object identical to
   // an OK status is constructed.
   Status(StatusCode code, absl::string_view message);
 
   // Return the error message (if any).
-  absl::string_view message() const { return message_; }
+  absl::string_view message() const {
+    return rep_ == nullptr ? absl::string_view() : rep_->message;
+  }
 
   // Returns true if the Status is OK.
   ABSL_MUST_USE_RESULT bool ok() const;
@@ -142,11 +161,19 @@ class Status final {
       const;
 
  private:
+  struct Rep {
+    std::string message;
+    // Structured error payload. String is a 'type_url' for example, a proto
+    // descriptor full name.
+    absl::node_hash_map<std::string, StatusCord> payload;
+  };
+
+  // Out of line, to keep the OK path of copies small.
+  static std::unique_ptr<Rep> CopyRep(const Rep& rep);
+
   StatusCode code_ = StatusCode::kOk;
-  std::string message_;
-  // Structured error payload. String is a 'type_url' for example, a proto
-  // descriptor full name.
-  absl::node_hash_map<std::string, StatusCord> payload_;
+  // Null for OK, and for errors that were moved from.
+  std::unique_ptr<Rep> rep_;
 };
 
 inline bool Status::ok() const { return StatusCode::kOk == code_; }
@@ -162,8 +189,12 @@ inline StatusCode Status::CanonicalCode() const { return code(); }
 inline Status Status::ToCanonical() const { return *this; }
 
 inline bool Status::operator==(const Status& x) const {
-  return (code_ == x.code_) && (message_ == x.message_) &&
-         (payload_ == x.payload_);
+  if (code_ != x.code_) return false;
+  if (rep_ == nullptr || x.rep_ == nullptr) {
+    const Rep* rep = rep_ != nullptr ? rep_.get() : x.rep_.get();
+    return rep == nullptr || (rep->message.empty() && rep->payload.empty());
+  }
+  return rep_->message == x.rep_->message && rep_->payload == x.rep_->payload;
 }
 
 inline bool Status::operator!=(const Status& x) const { return !(*this == x); }
@@ -175,7 +206,8 @@ inline void Status::IgnoreError() const {
 inline void Status::ForEachPayload(
     const std::function<void(absl::string_view, const StatusCord&)>& visitor)
     const {
-  for (auto it = payload_.begin(); it != payload_.end(); ++it) {
+  if (rep_ == nullptr) return;
+  for (auto it = rep_->payload.begin(); it != rep_->payload.end(); ++it) {
     visitor(it->first, it->second);
   }
 }
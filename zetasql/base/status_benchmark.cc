@@ -0,0 +1,166 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmark for the cost of reporting success through Status and StatusOr,
+// compared to returning a bool with a Status out-parameter, the convention
+// that some evaluator code uses for performance reasons. Also times the
+// error paths, which allocate the message and the payloads. Prints the
+// nanoseconds per call of each convention.
+//
+// Example:
+//   bazel run -c opt //zetasql/base:status_benchmark -- \
+//       --num_iterations=100000000
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "absl/base/attributes.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
+#include "zetasql/base/statusor.h"
+
+ABSL_FLAG(int64_t, num_iterations, 10000000,
+          "The number of calls timed for each convention.");
+
+namespace zetasql_base {
+namespace {
+
+// The functions below are not inlined, so that the Status or StatusOr really
+// is constructed, returned and checked for each call.
+
+ABSL_ATTRIBUTE_NOINLINE Status AddStatus(int64_t x, int64_t* sum) {
+  if (x < 0) return OutOfRangeError("negative");
+  *sum += x;
+  return OkStatus();
+}
+
+ABSL_ATTRIBUTE_NOINLINE StatusOr<int64_t> AddStatusOr(int64_t x,
+                                                      int64_t sum) {
+  if (x < 0) return OutOfRangeError("negative");
+  return sum + x;
+}
+
+ABSL_ATTRIBUTE_NOINLINE bool AddBool(int64_t x, int64_t* sum,
+                                     Status* status) {
+  if (x < 0) {
+    *status = OutOfRangeError("negative");
+    return false;
+  }
+  *sum += x;
+  return true;
+}
+
+ABSL_ATTRIBUTE_NOINLINE Status MakeError(int64_t x) {
+  Status status = OutOfRangeError("value out of range");
+  status.SetPayload("type.googleapis.com/zetasql.Value", std::to_string(x));
+  return status;
+}
+
+Status AddStatuses(int64_t n, int64_t* sum) {
+  for (int64_t i = 0; i < n; ++i) {
+    ZETASQL_RETURN_IF_ERROR(AddStatus(i, sum));
+  }
+  return OkStatus();
+}
+
+Status AddStatusOrs(int64_t n, int64_t* sum) {
+  for (int64_t i = 0; i < n; ++i) {
+    ZETASQL_ASSIGN_OR_RETURN(*sum, AddStatusOr(i, *sum));
+  }
+  return OkStatus();
+}
+
+Status AddBools(int64_t n, int64_t* sum) {
+  Status status;
+  for (int64_t i = 0; i < n; ++i) {
+    if (!AddBool(i, sum, &status)) return status;
+  }
+  return OkStatus();
+}
+
+Status CopyOkStatuses(int64_t n, int64_t* sum) {
+  const Status ok;
+  for (int64_t i = 0; i < n; ++i) {
+    Status copy = ok;
+    ZETASQL_RETURN_IF_ERROR(copy);
+    ++*sum;
+  }
+  return OkStatus();
+}
+
+Status MakeErrors(int64_t n, int64_t* sum) {
+  for (int64_t i = 0; i < n; ++i) {
+    *sum += MakeError(i).message().size();
+  }
+  return OkStatus();
+}
+
+struct Benchmark {
+  const char* name;
+  std::function<Status(int64_t, int64_t*)> run;
+};
+
+Status Run() {
+  const int64_t num_iterations = absl::GetFlag(FLAGS_num_iterations);
+  ZETASQL_RET_CHECK_GT(num_iterations, 0);
+  const Benchmark benchmarks[] = {
+      {"Status", AddStatuses},
+      {"StatusOr<int64_t>", AddStatusOrs},
+      {"bool + Status*", AddBools},
+      {"copy OK Status", CopyOkStatuses},
+      {"error + payload", MakeErrors},
+  };
+
+  std::cout << "sizeof(Status) = " << sizeof(Status)
+            << ", sizeof(StatusOr<int64_t>) = " << sizeof(StatusOr<int64_t>)
+            << "\n";
+  std::cout << absl::StrFormat("%-20s %12s\n", "convention", "ns/call");
+  for (const Benchmark& benchmark : benchmarks) {
+    int64_t sum = 0;
+    // Warm-up.
+    ZETASQL_RETURN_IF_ERROR(benchmark.run(num_iterations / 10 + 1, &sum));
+    const absl::Time start = absl::Now();
+    ZETASQL_RETURN_IF_ERROR(benchmark.run(num_iterations, &sum));
+    const absl::Duration elapsed = absl::Now() - start;
+    std::cout << absl::StrFormat(
+        "%-20s %12.2f\n", benchmark.name,
+        absl::ToDoubleNanoseconds(elapsed) / num_iterations);
+    // Keeps the sums alive.
+    if (sum == 42) std::cout << "";
+  }
+  return OkStatus();
+}
+
+}  // namespace
+}  // namespace zetasql_base
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  const zetasql_base::Status status = zetasql_base::Run();
+  if (!status.ok()) {
+    std::cout << "ERROR: " << status << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -227,4 +227,41 @@ TEST(Status, ForEachPayload_Multiple) {
   VisitAndAssertEquals(a, "type_b", "foo");
 }
 
+TEST(Status, OkIsPointerSized) {
+  EXPECT_LE(sizeof(Status), 2 * sizeof(void*));
+}
+
+TEST(Status, CopyAndAssign) {
+  Status a = Status(StatusCode::kCancelled, "msg");
+  a.SetPayload("type_a", ToPayload("foo"));
+
+  Status b = a;
+  EXPECT_EQ(a, b);
+  CheckStatus(b, StatusCode::kCancelled, "msg", "type_a", "foo");
+  // Copies are independent.
+  b.SetPayload("type_a", ToPayload("bar"));
+  CheckStatus(a, StatusCode::kCancelled, "msg", "type_a", "foo");
+
+  b = OkStatus();
+  CheckStatus(b, StatusCode::kOk, "");
+  b = a;
+  EXPECT_EQ(a, b);
+  const Status& self = b;
+  b = self;
+  EXPECT_EQ(a, b);
+}
+
+TEST(Status, Move) {
+  Status a = Status(StatusCode::kCancelled, "msg");
+  a.SetPayload("type_a", ToPayload("foo"));
+
+  Status b = std::move(a);
+  CheckStatus(b, StatusCode::kCancelled, "msg", "type_a", "foo");
+  Status c;
+  c = std::move(b);
+  CheckStatus(c, StatusCode::kCancelled, "msg", "type_a", "foo");
+  c = Status();
+  CheckStatus(c, StatusCode::kOk, "");
+}
+
 }  // namespace zetasql_base
@@ -94,6 +94,76 @@ class InternalValue {
     if (x.type_kind() != TYPE_PROTO) return nullptr;
     return x.proto_ptr_;
   }
+
+  // Returns the reference-counted representation that copies of 'x' share
+  // (the StringRef, TypedList or ProtoRep), or nullptr if 'x' has none, e.g.,
+  // because it is NULL, empty or of a scalar type. The pointer serves only to
+  // identify the representation while some copy of 'x' is alive.
+  static const void* GetSharedPayload(const Value& x) {
+    if (!x.is_valid() || x.is_null()) return nullptr;
+    switch (x.type_kind()) {
+      case TYPE_STRING:
+      case TYPE_BYTES:
+        return x.string_ptr_;
+      case TYPE_ARRAY:
+      case TYPE_STRUCT:
+        return x.has_typed_list_ ? x.list_ptr_ : nullptr;
+      case TYPE_PROTO:
+        return x.proto_ptr_;
+      default:
+        return nullptr;
+    }
+  }
+
+  // While an object of this class is alive, the StringRefs, TypedLists and
+  // ProtoReps of Values created on the current thread are allocated from
+  // 'arena', until it holds 'max_bytes'. Such Values must be destroyed before
+  // 'arena', so any that outlive it must be copied with CopyOutOfArena().
+  // Scopes can be nested; a NULL 'arena' disables arena allocation.
+  class ScopedArena {
+   public:
+    ScopedArena(zetasql_base::UnsafeArena* arena, size_t max_bytes)
+        : saved_(Value::payload_arena_) {
+      Value::payload_arena_.arena = arena;
+      Value::payload_arena_.max_bytes = max_bytes;
+    }
+    ScopedArena(const ScopedArena&) = delete;
+    ScopedArena& operator=(const ScopedArena&) = delete;
+    ~ScopedArena() { Value::payload_arena_ = saved_; }
+
+   private:
+    const Value::PayloadArena saved_;
+  };
+
+  using AllocationCounter = Value::PayloadAllocationCounter;
+
+  // While an object of this class is alive, the sizes of the StringRefs,
+  // TypedLists and ProtoReps of Values allocated and destroyed on the current
+  // thread are recorded in 'counter'. Destructions are charged to the counter
+  // that is current when they happen, which is not necessarily the one that
+  // recorded the allocation. Scopes can be nested; the innermost one gets the
+  // counts, and a NULL 'counter' disables counting.
+  class ScopedAllocationCounter {
+   public:
+    explicit ScopedAllocationCounter(AllocationCounter* counter)
+        : saved_(Value::payload_allocation_counter_) {
+      Value::payload_allocation_counter_ = counter;
+    }
+    ScopedAllocationCounter(const ScopedAllocationCounter&) = delete;
+    ScopedAllocationCounter& operator=(const ScopedAllocationCounter&) =
+        delete;
+    ~ScopedAllocationCounter() { Value::payload_allocation_counter_ = saved_; }
+
+   private:
+    AllocationCounter* const saved_;
+  };
+
+  // Returns a copy of 'x' that does not refer to memory allocated from any
+  // arena. Shares the representation of 'x' if it already does not.
+  static Value CopyOutOfArena(const Value& x) {
+    ScopedArena no_arena(/*arena=*/nullptr, /*max_bytes=*/0);
+    return x.CopyOutOfArenaInternal();
+  }
 };
 
 }  // namespace zetasql
@@ -16,6 +16,10 @@
 
 #include "zetasql/common/json_parser.h"
 
+#include <string.h>
+
+#include <cstdint>
+
 #include "zetasql/base/logging.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/escaping.h"
@@ -39,6 +43,32 @@ static constexpr absl::string_view kNull = "null";
 // Regexp for validating and extracting a key or variable name.
 static LazyRE2 key_re = {"([\\w_$][\\d\\w_$]*)"};
 
+// Returns the length of the longest prefix of 'data' that contains only ASCII
+// characters other than '\\' and 'quote', i.e. characters that a string
+// literal copies verbatim. Examines eight bytes at a time.
+static size_t PlainStringPrefixLength(absl::string_view data, char quote) {
+  constexpr uint64_t kOnes = 0x0101010101010101ULL;
+  constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+  const uint64_t backslashes = kOnes * static_cast<uint8_t>('\\');
+  const uint64_t quotes = kOnes * static_cast<uint8_t>(quote);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data.data() + i, sizeof(word));
+    // A byte of 'x' is zero iff that byte of 'word' is a backslash or a quote,
+    // and (x - kOnes) & ~x has the high bit set in some byte iff 'x' has a
+    // zero byte. Bytes with the high bit set in 'word' itself are not ASCII.
+    const uint64_t b = word ^ backslashes;
+    const uint64_t q = word ^ quotes;
+    if ((((b - kOnes) & ~b) | ((q - kOnes) & ~q) | word) & kHighBits) break;
+  }
+  for (; i < data.size(); ++i) {
+    const uint8_t c = static_cast<uint8_t>(data[i]);
+    if (c >= 0x80 || c == '\\' || c == static_cast<uint8_t>(quote)) break;
+  }
+  return i;
+}
+
 JSONParser::JSONParser(absl::string_view json) : json_(json) {}
 
 JSONParser::~JSONParser() {}
@@ -80,9 +110,10 @@ bool JSONParser::ParseValue() {
 }
 
 bool JSONParser::ParseString() {
-  std::string str;
-  if (!ParseStringHelper(&str)) return false;
-  if (!ParsedString(str)) return ReportFailure("ParsedString returned false");
+  if (!ParseStringHelper(&string_buffer_)) return false;
+  if (!ParsedString(string_buffer_)) {
+    return ReportFailure("ParsedString returned false");
+  }
   return true;
 }
 
@@ -238,6 +269,11 @@ bool JSONParser::ParseStringHelper(std::string* str) {
       if (flush_start == nullptr) {
         flush_start = p_.data();
       }
+      if (static_cast<uint8_t>(*p_.data()) < 0x80) {
+        // Skip over the run of plain ASCII characters that follows; the loop
+        // advances past the last of them.
+        p_.remove_prefix(PlainStringPrefixLength(p_.substr(1), *open));
+      }
     }
   }
   flush(flush_start, p_.data(), str);
@@ -345,9 +381,10 @@ bool JSONParser::ParseObject() {
   while (true) {
     t = GetNextTokenType();
     if (t == BEGIN_STRING) {
-      std::string str;
-      if (!ParseStringHelper(&str)) return false;
-      if (!BeginMember(str)) return ReportFailure("BeginMember returned false");
+      if (!ParseStringHelper(&string_buffer_)) return false;
+      if (!BeginMember(string_buffer_)) {
+        return ReportFailure("BeginMember returned false");
+      }
     } else if (t == BEGIN_KEY || t == BEGIN_NUMBER) {
       return ReportFailure("Non-string key encountered while parsing object");
     } else {
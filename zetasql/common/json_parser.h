@@ -61,7 +61,8 @@ class JSONParser {
   virtual bool EndObject();
 
   // Objects consist of a series of key/value pairs or members.
-  // Called with the key for the current member.
+  // Called with the key for the current member. 'key' is only valid during
+  // the call.
   virtual bool BeginMember(const std::string& key);
   // Called after the value for the member has been parsed. 'last'
   // will be true if this was the last member listed in the object.
@@ -78,7 +79,8 @@ class JSONParser {
   // true if this was the last element in the array.
   virtual bool EndArrayEntry(bool last);
 
-  // The parser just parsed a string with this value.
+  // The parser just parsed a string with this value. 'str' is only valid
+  // during the call.
   virtual bool ParsedString(const std::string& str);
   // The parser just parsed a number with this value.
   virtual bool ParsedNumber(absl::string_view str);
@@ -175,6 +177,10 @@ class JSONParser {
 
   // A pointer into json_ to keep track of the current parsing location.
   absl::string_view p_;
+
+  // Scratch buffer for unescaped strings and member names, reused to avoid an
+  // allocation per string. Callbacks must not keep references to it.
+  std::string string_buffer_;
 };
 
 }  // namespace zetasql
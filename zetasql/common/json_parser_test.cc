@@ -21,6 +21,7 @@
 #include "zetasql/base/logging.h"
 #include <cstdint>
 #include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "gtest/gtest.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/str_format.h"
@@ -261,6 +262,29 @@ TEST(JSONParserTest, ParseStringFail) {
   ParseAndExpectFail(special);
 }
 
+// Places escapes, quotes and non-ASCII characters at every offset of a string
+// longer than the eight bytes examined at a time for plain ASCII runs.
+TEST(JSONParserTest, ParseLongStrings) {
+  const std::string padding(20, 'a');
+  for (int i = 0; i <= padding.size(); ++i) {
+    const std::string prefix = padding.substr(0, i);
+    const std::string suffix = padding.substr(i);
+    for (const absl::string_view special :
+         {"\\n", "\\\\", "\\\"", "'", "\xC3\xA9", "\xE4\xB8\xAD"}) {
+      std::string unescaped;
+      ASSERT_TRUE(absl::CUnescape(special, &unescaped));
+      ParseAndCompare(absl::StrCat("\"", prefix, special, suffix, "\""),
+                      absl::StrFormat("\"%s\"", absl::CEscape(absl::StrCat(
+                                                      prefix, unescaped,
+                                                      suffix))));
+    }
+    ParseAndCompare(absl::StrCat("'", prefix, "\"", suffix, "'"),
+                    absl::StrFormat("\"%s\\\"%s\"", prefix, suffix));
+    ParseAndExpectFail(absl::StrCat("\"", prefix, "\"", suffix, "\""));
+    ParseAndExpectFail(absl::StrCat("\"", prefix, suffix));
+  }
+}
+
 TEST(JSONParserTest, ParseUTF7FalsePositive) {
   const std::string str = "\"+2011+Abc\"";
 
@@ -26,7 +26,11 @@ namespace zetasql {
 void JsonEscapeString(absl::string_view raw, std::string* value_string) {
   value_string->clear();
   value_string->reserve(raw.size() + 2);
+  JsonEscapeAndAppendString(raw, value_string);
+}
 
+void JsonEscapeAndAppendString(absl::string_view raw,
+                               std::string* value_string) {
   value_string->push_back('"');
   const size_t length = raw.length();
   for (size_t i = 0; i < length; ++i) {
@@ -28,6 +28,10 @@ namespace zetasql {
 // the string. We can't use CEscape because it isn't entirely JSON compatible.
 void JsonEscapeString(absl::string_view raw, std::string* value_string);
 
+// Like JsonEscapeString(), but appends the quoted string to `output` instead
+// of replacing its contents.
+void JsonEscapeAndAppendString(absl::string_view raw, std::string* output);
+
 }  // namespace zetasql
 
 #endif  // ZETASQL_COMMON_JSON_UTIL_H__
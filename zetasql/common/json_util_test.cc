@@ -62,4 +62,12 @@ TEST(JsonEscapeString, BigTest) {
                        R"("Σ\u2028Σ\u2029Σ\n\f\u0010\\\t")");
 }
 
+TEST(JsonEscapeAndAppendString, Appends) {
+  std::string output = "[";
+  JsonEscapeAndAppendString("a\"b", &output);
+  output.push_back(',');
+  JsonEscapeAndAppendString("\n", &output);
+  EXPECT_EQ(output, R"(["a\"b","\n")");
+}
+
 }  // namespace zetasql
@@ -0,0 +1,70 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/common/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "zetasql/base/status_builder.h"
+
+namespace zetasql {
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+zetasql_base::StatusOr<std::unique_ptr<MappedFile>> MappedFile::Open(
+    const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "Unable to open " << path << ": " << strerror(errno);
+  }
+  auto file = absl::WrapUnique(new MappedFile);
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    const int fstat_errno = errno;
+    close(fd);
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "Unable to stat " << path << ": " << strerror(fstat_errno);
+  }
+  if (file_stat.st_size > 0) {
+    void* data =
+        mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      const int mmap_errno = errno;
+      close(fd);
+      return zetasql_base::InvalidArgumentErrorBuilder()
+             << "Unable to map " << path << ": " << strerror(mmap_errno);
+    }
+    file->data_ = static_cast<const char*>(data);
+    file->size_ = file_stat.st_size;
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  return file;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,55 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// A read-only memory mapping of a whole file, for tables whose contents are
+// read in place instead of being loaded into memory.
+
+#ifndef ZETASQL_COMMON_MAPPED_FILE_H_
+#define ZETASQL_COMMON_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+class MappedFile {
+ public:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  // Maps the file at 'path'. An empty file has empty contents.
+  static zetasql_base::StatusOr<std::unique_ptr<MappedFile>> Open(
+      const std::string& path);
+
+  // The contents of the file. The mapping is page-aligned, so 'data()' is
+  // suitably aligned for any fundamental type.
+  absl::string_view contents() const { return absl::string_view(data_, size_); }
+
+ private:
+  MappedFile() {}
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_COMMON_MAPPED_FILE_H_
@@ -16,6 +16,14 @@
 
 #include "zetasql/common/utf_util.h"
 
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "zetasql/base/bits.h"
 #include "zetasql/base/logging.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
@@ -25,8 +33,58 @@ namespace zetasql {
 
 constexpr absl::string_view kReplacementCharacter = "\uFFFD";
 
+namespace {
+
+// The number of bytes examined at a time by the block loops below.
+#ifdef __SSE2__
+constexpr int kBlockSize = 16;
+#else
+constexpr int kBlockSize = 8;
+#endif
+
+// Returns true if the kBlockSize bytes starting at <s> are all ASCII.
+inline bool IsASCIIBlock(const char* s) {
+#ifdef __SSE2__
+  const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+  return _mm_movemask_epi8(block) == 0;
+#else
+  uint64_t word;
+  memcpy(&word, s, sizeof(word));
+  return (word & 0x8080808080808080ULL) == 0;
+#endif
+}
+
+// Returns the number of UTF8 continuation bytes (10xxxxxx) among the
+// kBlockSize bytes starting at <s>.
+inline int CountContinuationBytesInBlock(const char* s) {
+#ifdef __SSE2__
+  const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+  // As signed bytes, continuation bytes are exactly those in [-128, -65].
+  const __m128i continuation = _mm_cmplt_epi8(block, _mm_set1_epi8(-64));
+  return zetasql_base::Bits::CountOnes(_mm_movemask_epi8(continuation));
+#else
+  uint64_t word;
+  memcpy(&word, s, sizeof(word));
+  // Keeps the high bit of each byte whose top two bits are 10.
+  const uint64_t continuation = word & ~(word << 1) & 0x8080808080808080ULL;
+  return zetasql_base::Bits::CountOnes64(continuation);
+#endif
+}
+
+inline bool IsASCII(char c) { return static_cast<unsigned char>(c) < 0x80; }
+
+}  // namespace
+
 static int SpanWellFormedUTF8(const char* s, int length) {
   for (int i = 0; i < length;) {
+    while (i + kBlockSize <= length && IsASCIIBlock(s + i)) {
+      i += kBlockSize;
+    }
+    if (i == length) break;
+    if (IsASCII(s[i])) {
+      ++i;
+      continue;
+    }
     int start = i;
     UChar32 c;
     U8_NEXT(s, i, length, c);
@@ -42,6 +100,35 @@ absl::string_view::size_type SpanWellFormedUTF8(absl::string_view s) {
       SpanWellFormedUTF8(s.data(), static_cast<int>(s.length())));
 }
 
+absl::string_view::size_type SpanASCII(absl::string_view s) {
+  const char* data = s.data();
+  const size_t length = s.length();
+  size_t i = 0;
+  while (i + kBlockSize <= length && IsASCIIBlock(data + i)) {
+    i += kBlockSize;
+  }
+  while (i < length && IsASCII(data[i])) {
+    ++i;
+  }
+  return i;
+}
+
+int64_t CountUTF8CodePoints(absl::string_view s) {
+  const char* data = s.data();
+  const size_t length = s.length();
+  int64_t num_code_points = 0;
+  size_t i = 0;
+  for (; i + kBlockSize <= length; i += kBlockSize) {
+    num_code_points += kBlockSize - CountContinuationBytesInBlock(data + i);
+  }
+  for (; i < length; ++i) {
+    if ((static_cast<unsigned char>(data[i]) & 0xC0) != 0x80) {
+      ++num_code_points;
+    }
+  }
+  return num_code_points;
+}
+
 std::string CoerceToWellFormedUTF8(absl::string_view input) {
   const char* s = input.data();
   size_t length = input.length();
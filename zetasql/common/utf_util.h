@@ -17,6 +17,9 @@
 #ifndef ZETASQL_COMMON_UTF_UTIL_H_
 #define ZETASQL_COMMON_UTF_UTIL_H_
 
+#include <cstdint>
+#include <string>
+
 #include "absl/strings/string_view.h"
 #include "unicode/utf8.h"
 
@@ -24,8 +27,21 @@ namespace zetasql {
 
 // Returns the length of `s` that is well formed UTF8. This will return
 // `s.length()` if it is completely well formed UTF8.
+//
+// Runs of ASCII are checked a block of bytes at a time (with SSE2 where
+// available), so mostly-ASCII strings are validated much faster than one
+// code point at a time.
 absl::string_view::size_type SpanWellFormedUTF8(absl::string_view s);
 
+// Returns the length of the longest prefix of `s` that is all ASCII.
+absl::string_view::size_type SpanASCII(absl::string_view s);
+
+// Returns the number of code points in `s`, which must be well formed UTF8
+// (e.g., checked with IsWellFormedUTF8()). Counts the bytes that are not
+// continuation bytes, a block of bytes at a time. For ill-formed input the
+// result is not meaningful, but it is at most `s.length()`.
+int64_t CountUTF8CodePoints(absl::string_view s);
+
 inline bool IsWellFormedUTF8(absl::string_view s) {
   return SpanWellFormedUTF8(s) == s.length();
 }
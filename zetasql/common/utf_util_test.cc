@@ -16,7 +16,10 @@
 
 #include "zetasql/common/utf_util.h"
 
+#include <string>
+
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 
 namespace zetasql {
@@ -66,6 +69,48 @@ TEST(UtfUtilTest, WellFormedUTF8) {
   TestIllFormedString("ABC\xf0\x90", 3);
 }
 
+// Exercises the block-at-a-time paths, with the interesting byte at every
+// offset within and across blocks.
+TEST(UtfUtilTest, LongStrings) {
+  for (int prefix = 0; prefix < 40; ++prefix) {
+    const std::string ascii(prefix, 'a');
+    TestWellFormedString(ascii);
+    TestWellFormedString(absl::StrCat(ascii, "\xe8\xb0\xb7", ascii));
+    TestIllFormedString(absl::StrCat(ascii, "\xc1", ascii), prefix);
+    TestIllFormedString(
+        absl::StrCat(ascii, "\xe8\xb0\xb7", ascii, "\xf0\x90"),
+        2 * prefix + 3);
+  }
+}
+
+TEST(UtfUtilTest, SpanASCII) {
+  EXPECT_EQ(0, SpanASCII(""));
+  EXPECT_EQ(3, SpanASCII("abc"));
+  EXPECT_EQ(0, SpanASCII("\xc2\xbf"));
+  for (int prefix = 0; prefix < 40; ++prefix) {
+    const std::string ascii(prefix, 'a');
+    EXPECT_EQ(prefix, SpanASCII(ascii));
+    EXPECT_EQ(prefix, SpanASCII(absl::StrCat(ascii, "\xc2\xbf", ascii)));
+    EXPECT_EQ(prefix, SpanASCII(absl::StrCat(ascii, "\x80")));
+  }
+}
+
+TEST(UtfUtilTest, CountUTF8CodePoints) {
+  EXPECT_EQ(0, CountUTF8CodePoints(""));
+  EXPECT_EQ(3, CountUTF8CodePoints("abc"));
+  EXPECT_EQ(1, CountUTF8CodePoints("\xc2\xbf"));
+  EXPECT_EQ(2, CountUTF8CodePoints("\xe8\xb0\xb7\xe6\xad\x8c"));
+  EXPECT_EQ(1, CountUTF8CodePoints("\xf0\x90\x80\x80"));
+  for (int prefix = 0; prefix < 40; ++prefix) {
+    const std::string ascii(prefix, 'a');
+    EXPECT_EQ(prefix, CountUTF8CodePoints(ascii));
+    // ð, 谷 and 𐀀 are 2, 3 and 4 bytes.
+    EXPECT_EQ(2 * prefix + 3,
+              CountUTF8CodePoints(absl::StrCat(ascii, "\xc3\xb0\xe8\xb0\xb7",
+                                               ascii, "\xf0\x90\x80\x80")));
+  }
+}
+
 void TestCoerce(std::string str, std::string expected) {
   if (str == expected) {
     // Sanity check.
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -30,21 +31,31 @@
 #include "zetasql/local_service/state.h"
 #include "zetasql/proto/simple_catalog.pb.h"
 #include "zetasql/public/builtin_function.h"
+#include "zetasql/public/catalog.h"
 #include "zetasql/public/evaluator.h"
+#include "zetasql/public/evaluator_executor.h"
+#include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/function.h"
+#include "zetasql/public/functions/hash.h"
 #include "zetasql/public/id_string.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/simple_table.pb.h"
 #include "zetasql/public/sql_formatter.h"
 #include "zetasql/public/table_from_proto.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
 #include "zetasql/public/value.pb.h"
+#include "zetasql/reference_impl/parallel.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/sql_builder.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status_macros.h"
@@ -98,55 +109,255 @@ void PopulateExistingPoolsToFileDescriptorSetMap(
   CHECK_EQ(pools.size(), file_descriptor_set_map->size());
 }
 
-zetasql_base::Status SerializeTypeUsingExistingPools(
-    const Type* type, const std::vector<const google::protobuf::DescriptorPool*>& pools,
-    TypeProto* type_proto) {
-  FileDescriptorSetMap file_descriptor_set_map;
-  PopulateExistingPoolsToFileDescriptorSetMap(pools, &file_descriptor_set_map);
+// Forwards lookups to another Catalog, except for the tables that got contents
+// with AddTableContent(). Those are replaced by copies with the contents, so
+// that queries can read them without changing the shared Catalog.
+class TableContentsCatalog : public Catalog {
+ public:
+  // <catalog> must outlive this object.
+  explicit TableContentsCatalog(Catalog* catalog) : catalog_(catalog) {}
+  TableContentsCatalog(const TableContentsCatalog&) = delete;
+  TableContentsCatalog& operator=(const TableContentsCatalog&) = delete;
+
+  zetasql_base::Status AddTableContent(
+      const ExecuteQueryRequest::TableContent& content) {
+    const Table* table;
+    ZETASQL_RETURN_IF_ERROR(catalog_->FindTable({content.table_name()}, &table));
+    std::vector<SimpleTable::NameAndType> columns;
+    for (int i = 0; i < table->NumColumns(); ++i) {
+      columns.emplace_back(table->GetColumn(i)->Name(),
+                           table->GetColumn(i)->GetType());
+    }
+    std::vector<std::vector<Value>> rows;
+    rows.reserve(content.row_size());
+    for (const auto& row : content.row()) {
+      if (row.cell_size() != columns.size()) {
+        return MakeSqlError() << "Table " << content.table_name() << " has "
+                              << columns.size() << " columns, got a row with "
+                              << row.cell_size() << " values";
+      }
+      rows.emplace_back();
+      for (int i = 0; i < row.cell_size(); ++i) {
+        ZETASQL_ASSIGN_OR_RETURN(Value value,
+                         Value::Deserialize(row.cell(i), columns[i].second));
+        rows.back().push_back(std::move(value));
+      }
+    }
+    auto table_with_content =
+        absl::make_unique<SimpleTable>(table->Name(), columns);
+    table_with_content->SetContents(rows);
+    tables_[absl::AsciiStrToLower(content.table_name())] =
+        std::move(table_with_content);
+    return ::zetasql_base::OkStatus();
+  }
 
-  ZETASQL_RETURN_IF_ERROR(type->SerializeToProtoAndDistinctFileDescriptors(
-      type_proto, &file_descriptor_set_map));
+  std::string FullName() const override { return catalog_->FullName(); }
 
-  ZETASQL_RET_CHECK_EQ(pools.size(), file_descriptor_set_map.size())
-      << type->DebugString(true)
-      << " uses unknown DescriptorPool, this shouldn't happen.";
-  return ::zetasql_base::OkStatus();
-}
+  zetasql_base::Status FindTable(const absl::Span<const std::string>& path,
+                         const Table** table,
+                         const FindOptions& options = FindOptions()) override {
+    if (path.size() == 1) {
+      auto it = tables_.find(absl::AsciiStrToLower(path[0]));
+      if (it != tables_.end()) {
+        *table = it->second.get();
+        return ::zetasql_base::OkStatus();
+      }
+    }
+    return catalog_->FindTable(path, table, options);
+  }
+  zetasql_base::Status FindModel(const absl::Span<const std::string>& path,
+                         const Model** model,
+                         const FindOptions& options = FindOptions()) override {
+    return catalog_->FindModel(path, model, options);
+  }
+  zetasql_base::Status FindConnection(const absl::Span<const std::string>& path,
+                              const Connection** connection,
+                              const FindOptions& options) override {
+    return catalog_->FindConnection(path, connection, options);
+  }
+  zetasql_base::Status FindFunction(
+      const absl::Span<const std::string>& path, const Function** function,
+      const FindOptions& options = FindOptions()) override {
+    return catalog_->FindFunction(path, function, options);
+  }
+  zetasql_base::Status FindTableValuedFunction(
+      const absl::Span<const std::string>& path,
+      const TableValuedFunction** function,
+      const FindOptions& options = FindOptions()) override {
+    return catalog_->FindTableValuedFunction(path, function, options);
+  }
+  zetasql_base::Status FindProcedure(
+      const absl::Span<const std::string>& path, const Procedure** procedure,
+      const FindOptions& options = FindOptions()) override {
+    return catalog_->FindProcedure(path, procedure, options);
+  }
+  zetasql_base::Status FindType(const absl::Span<const std::string>& path,
+                        const Type** type,
+                        const FindOptions& options = FindOptions()) override {
+    return catalog_->FindType(path, type, options);
+  }
+  zetasql_base::Status FindConstantWithPathPrefix(
+      const absl::Span<const std::string> path, int* num_names_consumed,
+      const Constant** constant,
+      const FindOptions& options = FindOptions()) override {
+    return catalog_->FindConstantWithPathPrefix(path, num_names_consumed,
+                                                constant, options);
+  }
+
+ private:
+  Catalog* catalog_;  // Not owned.
+  // The tables with contents, by lowercase name.
+  std::map<std::string, std::unique_ptr<SimpleTable>> tables_;
+};
 
 }  // namespace
 
+// The descriptor pools of a request, built from its file_descriptor_set or
+// looked up by its file_descriptor_set_fingerprint.
+struct DescriptorPools {
+  std::vector<std::shared_ptr<google::protobuf::DescriptorPool>> pools;
+  // True if the pools are registered or belong to another registered
+  // catalog, in which case other requests share them and they must not be
+  // modified.
+  bool shared = false;
+};
+
+// The descriptor pools registered with RegisterFileDescriptorSets, by the
+// fingerprint of their descriptor set.
+//
+// This class is thread-safe.
+class DescriptorPoolRegistry {
+ public:
+  DescriptorPoolRegistry() {}
+  DescriptorPoolRegistry(const DescriptorPoolRegistry&) = delete;
+  DescriptorPoolRegistry& operator=(const DescriptorPoolRegistry&) = delete;
+
+  // Builds a pool for <fdset> unless one is registered already, and returns
+  // its fingerprint in <*fingerprint>.
+  zetasql_base::Status Register(
+      const google::protobuf::FileDescriptorSet& fdset, int64_t* fingerprint) {
+    *fingerprint = functions::FarmFingerprint(fdset.SerializeAsString());
+    {
+      absl::MutexLock lock(&mutex_);
+      auto it = entries_.find(*fingerprint);
+      if (it != entries_.end()) {
+        ++it->second.num_registrations;
+        return ::zetasql_base::OkStatus();
+      }
+    }
+
+    // Build the pool without holding the lock, in case someone else is
+    // registering the same descriptor set.
+    auto pool = std::make_shared<google::protobuf::DescriptorPool>();
+    ZETASQL_RETURN_IF_ERROR(AddFileDescriptorSetToPool(&fdset, pool.get()));
+
+    absl::MutexLock lock(&mutex_);
+    Entry& entry = entries_[*fingerprint];
+    if (entry.pool == nullptr) entry.pool = std::move(pool);
+    ++entry.num_registrations;
+    return ::zetasql_base::OkStatus();
+  }
+
+  // Drops one registration of each of <fingerprints>, which must all be
+  // registered. Pools that are no longer registered stay alive as long as saved
+  // states use them.
+  zetasql_base::Status Unregister(
+      const google::protobuf::RepeatedField<int64_t>& fingerprints) {
+    // Destroyed after releasing the lock.
+    std::vector<std::shared_ptr<google::protobuf::DescriptorPool>> released;
+    absl::MutexLock lock(&mutex_);
+    for (int64_t fingerprint : fingerprints) {
+      if (!entries_.contains(fingerprint)) {
+        return MakeSqlError() << "Unknown file descriptor set fingerprint "
+                              << fingerprint;
+      }
+    }
+    for (int64_t fingerprint : fingerprints) {
+      auto it = entries_.find(fingerprint);
+      // The same fingerprint may be repeated more times than registered.
+      if (it == entries_.end()) continue;
+      if (--it->second.num_registrations == 0) {
+        released.push_back(std::move(it->second.pool));
+        entries_.erase(it);
+      }
+    }
+    return ::zetasql_base::OkStatus();
+  }
+
+  // Sets <*pools> to new pools built from the file_descriptor_set of
+  // <request>, or to the registered pools of its
+  // file_descriptor_set_fingerprint.
+  template <class Request>
+  zetasql_base::Status BuildDescriptorPools(const Request& request,
+                                    DescriptorPools* pools) {
+    return BuildDescriptorPools(request.file_descriptor_set(),
+                                request.file_descriptor_set_fingerprint(),
+                                pools);
+  }
+
+ private:
+  struct Entry {
+    std::shared_ptr<google::protobuf::DescriptorPool> pool;
+    int64_t num_registrations = 0;
+  };
+
+  zetasql_base::Status BuildDescriptorPools(
+      const RepeatedPtrField<google::protobuf::FileDescriptorSet>& fdsets,
+      const google::protobuf::RepeatedField<int64_t>& fingerprints,
+      DescriptorPools* pools) {
+    pools->pools.clear();
+    pools->shared = !fingerprints.empty();
+    if (!fdsets.empty() && !fingerprints.empty()) {
+      return MakeSqlError() << "file_descriptor_set and "
+                               "file_descriptor_set_fingerprint cannot both be "
+                               "set";
+    }
+    pools->pools.reserve(fdsets.size() + fingerprints.size());
+
+    for (const auto& file_descriptor_set : fdsets) {
+      auto pool = std::make_shared<google::protobuf::DescriptorPool>();
+      ZETASQL_RETURN_IF_ERROR(
+          AddFileDescriptorSetToPool(&file_descriptor_set, pool.get()));
+      pools->pools.push_back(std::move(pool));
+    }
+
+    absl::ReaderMutexLock lock(&mutex_);
+    for (int64_t fingerprint : fingerprints) {
+      auto it = entries_.find(fingerprint);
+      if (it == entries_.end()) {
+        return MakeSqlError() << "Unknown file descriptor set fingerprint "
+                              << fingerprint;
+      }
+      pools->pools.push_back(it->second.pool);
+    }
+    return ::zetasql_base::OkStatus();
+  }
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<int64_t, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+};
+
 // This class is thread-safe.
 class BaseSavedState : public GenericState {
  protected:
   BaseSavedState() : GenericState(), initialized_(false) {}
 
-  zetasql_base::Status Init(const RepeatedPtrField<google::protobuf::FileDescriptorSet>& fdsets) {
+  zetasql_base::Status Init(const DescriptorPools& pools) {
     absl::MutexLock lock(&mutex_);
     CHECK(!initialized_);
 
-    // In case Init() failed half way and called again.
-    pools_.clear();
+    pools_ = pools.pools;
+    shared_pools_ = pools.shared;
     const_pools_.clear();
-
-    const int num_pools = fdsets.size();
-    pools_.reserve(num_pools);
-    const_pools_.reserve(num_pools);
-
-    for (const auto& file_descirptor_set : fdsets) {
-      std::unique_ptr<google::protobuf::DescriptorPool> pool(
-          new google::protobuf::DescriptorPool());
-      ZETASQL_RETURN_IF_ERROR(
-          AddFileDescriptorSetToPool(&file_descirptor_set, pool.get()));
-      const_pools_.emplace_back(pool.get());
-      pools_.emplace_back(pool.release());
+    for (const auto& pool : pools_) {
+      const_pools_.push_back(pool.get());
     }
-
     return ::zetasql_base::OkStatus();
   }
 
   zetasql_base::Status static MergeFileDescriptorSetsToPools(
       const RepeatedPtrField<google::protobuf::FileDescriptorSet>& fdsets,
-      std::vector<std::unique_ptr<google::protobuf::DescriptorPool>>* pools,
+      std::vector<std::shared_ptr<google::protobuf::DescriptorPool>>* pools,
       std::vector<const google::protobuf::DescriptorPool*>* const_pools) {
     const int original_num_pools = pools->size();
     const int num_pools = std::max(fdsets.size(), original_num_pools);
@@ -160,12 +371,11 @@ class BaseSavedState : public GenericState {
             AddFileDescriptorSetToPool(
                 &file_descirptor_set, (*pools)[i].get()));
       } else {
-        std::unique_ptr<google::protobuf::DescriptorPool> pool(
-                    new google::protobuf::DescriptorPool());
+        auto pool = std::make_shared<google::protobuf::DescriptorPool>();
         ZETASQL_RETURN_IF_ERROR(
             AddFileDescriptorSetToPool(&file_descirptor_set, pool.get()));
         const_pools->emplace_back(pool.get());
-        pools->emplace_back(pool.release());
+        pools->push_back(std::move(pool));
       }
       i++;
     }
@@ -175,19 +385,88 @@ class BaseSavedState : public GenericState {
 
  public:
   TypeFactory* GetTypeFactory() {
-    absl::MutexLock lock(&mutex_);
+    absl::ReaderMutexLock lock(&mutex_);
     CHECK(initialized_);
 
     return &factory_;
   }
 
   const std::vector<const google::protobuf::DescriptorPool*>& GetDescriptorPools() {
-    absl::MutexLock lock(&mutex_);
+    absl::ReaderMutexLock lock(&mutex_);
     CHECK(initialized_);
 
     return const_pools_;
   }
 
+  // Serializes <type> with the indices of GetDescriptorPools() as descriptor
+  // set indices. The TypeProtos are cached by Type, so <type> must live as
+  // long as this state, e.g. be a simple type or be owned by GetTypeFactory()
+  // or by the catalog.
+  //
+  // The cache lives as long as this state. It is not invalidated by
+  // AddSimpleTable, which only adds pools and files, and never changes the
+  // index of an existing pool.
+  zetasql_base::Status SerializeType(const Type* type, TypeProto* type_proto) {
+    {
+      absl::MutexLock lock(&cache_mutex_);
+      auto it = type_protos_.find(type);
+      if (it != type_protos_.end()) {
+        *type_proto = it->second;
+        return ::zetasql_base::OkStatus();
+      }
+    }
+
+    const auto& pools = GetDescriptorPools();
+    FileDescriptorSetMap file_descriptor_set_map =
+        NewFileDescriptorSetMap(pools);
+    ZETASQL_RETURN_IF_ERROR(type->SerializeToProtoAndDistinctFileDescriptors(
+        type_proto, &file_descriptor_set_map));
+
+    ZETASQL_RET_CHECK_EQ(pools.size(), file_descriptor_set_map.size())
+        << type->DebugString(true)
+        << " uses unknown DescriptorPool, this shouldn't happen.";
+    UpdateSerializedFiles(pools, file_descriptor_set_map);
+
+    absl::MutexLock lock(&cache_mutex_);
+    type_protos_.emplace(type, *type_proto);
+    return ::zetasql_base::OkStatus();
+  }
+
+  // Returns a map with an entry for each of <pools>, which must be
+  // GetDescriptorPools(), at its index. The entries already contain the proto
+  // files of the types serialized so far, so that serializing those types
+  // again does not copy their files. Their FileDescriptorSets are empty,
+  // since the descriptor sets of existing pools are not sent back.
+  FileDescriptorSetMap NewFileDescriptorSetMap(
+      const std::vector<const google::protobuf::DescriptorPool*>& pools) {
+    FileDescriptorSetMap file_descriptor_set_map;
+    PopulateExistingPoolsToFileDescriptorSetMap(pools,
+                                                &file_descriptor_set_map);
+    absl::MutexLock lock(&cache_mutex_);
+    for (int i = 0; i < serialized_files_.size() && i < pools.size(); ++i) {
+      file_descriptor_set_map[pools[i]]->file_descriptors =
+          serialized_files_[i];
+    }
+    return file_descriptor_set_map;
+  }
+
+  // Remembers the proto files of <pools> that <file_descriptor_set_map>
+  // contains, for NewFileDescriptorSetMap().
+  void UpdateSerializedFiles(
+      const std::vector<const google::protobuf::DescriptorPool*>& pools,
+      const FileDescriptorSetMap& file_descriptor_set_map) {
+    absl::MutexLock lock(&cache_mutex_);
+    if (serialized_files_.size() < pools.size()) {
+      serialized_files_.resize(pools.size());
+    }
+    for (int i = 0; i < pools.size(); ++i) {
+      auto it = file_descriptor_set_map.find(pools[i]);
+      if (it == file_descriptor_set_map.end()) continue;
+      serialized_files_[i].insert(it->second->file_descriptors.begin(),
+                                  it->second->file_descriptors.end());
+    }
+  }
+
  protected:
   absl::Mutex mutex_;
 
@@ -195,10 +474,22 @@ class BaseSavedState : public GenericState {
 
   TypeFactory factory_ ABSL_GUARDED_BY(mutex_);
 
-  std::vector<std::unique_ptr<google::protobuf::DescriptorPool>> pools_
+  // Shared with other states if <shared_pools_>.
+  std::vector<std::shared_ptr<google::protobuf::DescriptorPool>> pools_
       ABSL_GUARDED_BY(mutex_);
   std::vector<const google::protobuf::DescriptorPool*> const_pools_
       ABSL_GUARDED_BY(mutex_);
+  bool shared_pools_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // Caches for SerializeType() and NewFileDescriptorSetMap(). Not guarded by
+  // <mutex_>, so that serializing does not block the other users of the
+  // state.
+  absl::Mutex cache_mutex_;
+  absl::flat_hash_map<const Type*, TypeProto> type_protos_
+      ABSL_GUARDED_BY(cache_mutex_);
+  // The proto files of each pool that types serialized so far use.
+  std::vector<std::set<const google::protobuf::FileDescriptor*>>
+      serialized_files_ ABSL_GUARDED_BY(cache_mutex_);
 };
 
 class PreparedExpressionState : public BaseSavedState {
@@ -208,8 +499,8 @@ class PreparedExpressionState : public BaseSavedState {
   PreparedExpressionState& operator=(const PreparedExpressionState&) = delete;
 
   zetasql_base::Status Init(const std::string& sql,
-                    const RepeatedPtrField<google::protobuf::FileDescriptorSet>& fdsets) {
-    ZETASQL_RETURN_IF_ERROR(BaseSavedState::Init(fdsets));
+                    const DescriptorPools& pools) {
+    ZETASQL_RETURN_IF_ERROR(BaseSavedState::Init(pools));
 
     absl::MutexLock lock(&mutex_);
     exp_ = absl::make_unique<PreparedExpression>(sql, &factory_);
@@ -218,7 +509,7 @@ class PreparedExpressionState : public BaseSavedState {
   }
 
   PreparedExpression* GetPreparedExpression() {
-    absl::MutexLock lock(&mutex_);
+    absl::ReaderMutexLock lock(&mutex_);
     CHECK(initialized_);
 
     return exp_.get();
@@ -238,35 +529,132 @@ class RegisteredCatalogState : public BaseSavedState {
   RegisteredCatalogState& operator=(const RegisteredCatalogState&) = delete;
 
   zetasql_base::Status Init(const SimpleCatalogProto& proto,
-                    const RepeatedPtrField<google::protobuf::FileDescriptorSet>& fdsets) {
-    ZETASQL_RETURN_IF_ERROR(BaseSavedState::Init(fdsets));
+                    const DescriptorPools& pools) {
+    ZETASQL_RETURN_IF_ERROR(BaseSavedState::Init(pools));
 
     absl::MutexLock lock(&mutex_);
-    ZETASQL_RETURN_IF_ERROR(SimpleCatalog::Deserialize(proto, const_pools_, &catalog_));
+    table_factory_ = std::make_shared<TypeFactory>();
+    catalog_proto_ = proto;
+    catalog_proto_.clear_table();
+    for (const auto& table_proto : proto.table()) {
+      ZETASQL_RETURN_IF_ERROR(AddTableLocked(table_proto, /*replace=*/false));
+    }
+    ZETASQL_RETURN_IF_ERROR(BuildCatalogLocked());
     initialized_ = true;
     return ::zetasql_base::OkStatus();
   }
 
-  SimpleCatalog* GetCatalog() {
+  // Initializes this catalog as a copy of <base> with the top-level tables of
+  // <added> added, replacing tables with the same names, and the tables
+  // named <removed_table_names> removed. The unchanged tables, their types
+  // and the descriptor pools are shared with <base> rather than deserialized
+  // again, so only the changed tables are deserialized. The descriptor pools
+  // of both catalogs become shared, so neither can add descriptor sets
+  // afterwards.
+  zetasql_base::Status InitFromBase(
+      RegisteredCatalogState* base, const SimpleCatalogProto& added,
+      const RepeatedPtrField<std::string>& removed_table_names) {
+    SimpleCatalogProto not_tables = added;
+    not_tables.clear_name();
+    not_tables.clear_table();
+    if (not_tables.ByteSizeLong() != 0) {
+      return MakeSqlError() << "A catalog registered with "
+                               "base_registered_catalog_id can only add "
+                               "tables to its base catalog";
+    }
+
+    DescriptorPools pools;
+    {
+      absl::MutexLock base_lock(&base->mutex_);
+      ZETASQL_RET_CHECK(base->initialized_);
+      base->shared_pools_ = true;
+      pools.pools = base->pools_;
+      pools.shared = true;
+
+      absl::MutexLock lock(&mutex_);
+      table_factory_ = base->table_factory_;
+      catalog_proto_ = base->catalog_proto_;
+      tables_ = base->tables_;
+    }
+    ZETASQL_RETURN_IF_ERROR(BaseSavedState::Init(pools));
+
     absl::MutexLock lock(&mutex_);
+    for (const std::string& name : removed_table_names) {
+      if (tables_.erase(absl::AsciiStrToLower(name)) == 0) {
+        return MakeSqlError() << "Unknown table in base catalog: " << name;
+      }
+    }
+    for (const auto& table_proto : added.table()) {
+      ZETASQL_RETURN_IF_ERROR(AddTableLocked(table_proto, /*replace=*/true));
+    }
+    ZETASQL_RETURN_IF_ERROR(BuildCatalogLocked());
+    initialized_ = true;
+    return ::zetasql_base::OkStatus();
+  }
+
+  SimpleCatalog* GetCatalog() {
+    absl::ReaderMutexLock lock(&mutex_);
     CHECK(initialized_);
     return catalog_.get();
   }
 
   zetasql_base::Status AddSimpleTable(const AddSimpleTableRequest& request) {
     absl::MutexLock lock(&mutex_);
-    std::unique_ptr<SimpleTable> table;
+    if (shared_pools_ && !request.file_descriptor_set().empty()) {
+      return MakeSqlError() << "Cannot add file descriptor sets to a catalog "
+                               "that uses registered or shared descriptor sets";
+    }
     ZETASQL_RETURN_IF_ERROR(
         MergeFileDescriptorSetsToPools(request.file_descriptor_set(),
                                        &pools_, &const_pools_));
-    ZETASQL_RETURN_IF_ERROR(SimpleTable::Deserialize(request.table(),
-                                             const_pools_,
-                                             &factory_, &table));
-    catalog_->AddOwnedTable(table.release());
+    ZETASQL_RETURN_IF_ERROR(AddTableLocked(request.table(), /*replace=*/false));
+    const std::string key = TableKey(request.table());
+    catalog_->AddTable(key, tables_[key].get());
     return ::zetasql_base::OkStatus();
   }
 
  private:
+  static std::string TableKey(const SimpleTableProto& table_proto) {
+    return absl::AsciiStrToLower(table_proto.has_name_in_catalog()
+                                     ? table_proto.name_in_catalog()
+                                     : table_proto.name());
+  }
+
+  zetasql_base::Status AddTableLocked(const SimpleTableProto& table_proto,
+                              bool replace)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    std::unique_ptr<SimpleTable> table;
+    ZETASQL_RETURN_IF_ERROR(SimpleTable::Deserialize(
+        table_proto, const_pools_, table_factory_.get(), &table));
+    std::shared_ptr<const SimpleTable>& entry = tables_[TableKey(table_proto)];
+    if (entry != nullptr && !replace) {
+      return MakeSqlError() << "Duplicate table '" << table->Name()
+                            << "' in catalog";
+    }
+    entry = std::move(table);
+    return ::zetasql_base::OkStatus();
+  }
+
+  // Deserializes <catalog_proto_> into <catalog_> and adds <tables_> to it.
+  zetasql_base::Status BuildCatalogLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    ZETASQL_RETURN_IF_ERROR(
+        SimpleCatalog::Deserialize(catalog_proto_, const_pools_, &catalog_));
+    for (const auto& entry : tables_) {
+      catalog_->AddTable(entry.first, entry.second.get());
+    }
+    return ::zetasql_base::OkStatus();
+  }
+
+  // The top-level tables are kept apart from the rest of the catalog, so
+  // that catalogs registered with this one as their base can share them.
+  // They are immutable once added, and own their types in <table_factory_>,
+  // which is shared too.
+  std::shared_ptr<TypeFactory> table_factory_ ABSL_GUARDED_BY(mutex_);
+  // By lower-cased name.
+  absl::flat_hash_map<std::string, std::shared_ptr<const SimpleTable>> tables_
+      ABSL_GUARDED_BY(mutex_);
+  // The catalog without its top-level tables.
+  SimpleCatalogProto catalog_proto_ ABSL_GUARDED_BY(mutex_);
   std::unique_ptr<SimpleCatalog> catalog_ ABSL_GUARDED_BY(mutex_);
 };
 
@@ -306,14 +694,18 @@ ZetaSqlLocalServiceImpl::ZetaSqlLocalServiceImpl()
     : registered_catalogs_(new RegisteredCatalogPool()),
       prepared_expressions_(new PreparedExpressionPool()),
       registered_parse_resume_locations_(
-          new RegisteredParseResumeLocationPool()) {}
+          new RegisteredParseResumeLocationPool()),
+      descriptor_pools_(new DescriptorPoolRegistry()) {}
 
 ZetaSqlLocalServiceImpl::~ZetaSqlLocalServiceImpl() {}
 
 zetasql_base::Status ZetaSqlLocalServiceImpl::Prepare(const PrepareRequest& request,
                                                 PrepareResponse* response) {
+  DescriptorPools pools;
+  ZETASQL_RETURN_IF_ERROR(
+      descriptor_pools_->BuildDescriptorPools(request, &pools));
   std::unique_ptr<PreparedExpressionState> state(new PreparedExpressionState());
-  ZETASQL_RETURN_IF_ERROR(state->Init(request.sql(), request.file_descriptor_set()));
+  ZETASQL_RETURN_IF_ERROR(state->Init(request.sql(), pools));
 
   AnalyzerOptions options;
   ZETASQL_RETURN_IF_ERROR(AnalyzerOptions::Deserialize(
@@ -335,8 +727,8 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::Prepare(const PrepareRequest& requ
   } else if (request.has_simple_catalog()) {
     new_catalog_state = absl::make_unique<RegisteredCatalogState>();
     catalog_state = new_catalog_state.get();
-    ZETASQL_RETURN_IF_ERROR(catalog_state->Init(request.simple_catalog(),
-                                        request.file_descriptor_set()));
+    ZETASQL_RETURN_IF_ERROR(
+        catalog_state->Init(request.simple_catalog(), pools));
   }
 
   PreparedExpression* exp = state->GetPreparedExpression();
@@ -344,9 +736,8 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::Prepare(const PrepareRequest& requ
                                             ? catalog_state->GetCatalog()
                                             : nullptr));
 
-  ZETASQL_RETURN_IF_ERROR(SerializeTypeUsingExistingPools(
-      exp->output_type(), state->GetDescriptorPools(),
-      response->mutable_output_type()));
+  ZETASQL_RETURN_IF_ERROR(state->SerializeType(exp->output_type(),
+                                       response->mutable_output_type()));
 
   int64_t id = prepared_expressions_->Register(state.release());
   ZETASQL_RET_CHECK_NE(-1, id)
@@ -381,9 +772,12 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::Evaluate(const EvaluateRequest& re
       return MakeSqlError() << "Prepared expression " << id << " unknown.";
     }
   } else {
+    DescriptorPools pools;
+    ZETASQL_RETURN_IF_ERROR(
+        descriptor_pools_->BuildDescriptorPools(request, &pools));
     new_state = absl::make_unique<PreparedExpressionState>();
     state = new_state.get();
-    ZETASQL_RETURN_IF_ERROR(state->Init(request.sql(), request.file_descriptor_set()));
+    ZETASQL_RETURN_IF_ERROR(state->Init(request.sql(), pools));
   }
 
   const zetasql_base::Status result = EvaluateImpl(request, state, response);
@@ -416,12 +810,117 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::EvaluateImpl(
 
   const Value& value = result.ValueOrDie();
   ZETASQL_RETURN_IF_ERROR(value.Serialize(response->mutable_value()));
-  ZETASQL_RETURN_IF_ERROR(SerializeTypeUsingExistingPools(value.type(), const_pools,
-                                                  response->mutable_type()));
+  ZETASQL_RETURN_IF_ERROR(
+      state->SerializeType(value.type(), response->mutable_type()));
 
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::Status ZetaSqlLocalServiceImpl::EvaluateBatch(
+    const EvaluateBatchRequest& request, EvaluateBatchResponse* response) {
+  const int64_t id = request.prepared_expression_id();
+  std::shared_ptr<PreparedExpressionState> state =
+      prepared_expressions_->Get(id);
+  if (state == nullptr) {
+    return MakeSqlError() << "Prepared expression " << id << " unknown.";
+  }
+  const auto& const_pools = state->GetDescriptorPools();
+  TypeFactory* factory = state->GetTypeFactory();
+
+  std::vector<ParameterValueMap> columns(request.rows_size());
+  std::vector<ParameterValueMap> params(request.rows_size());
+  for (int i = 0; i < request.rows_size(); ++i) {
+    ZETASQL_RETURN_IF_ERROR(RepeatedParametersToMap(
+        request.rows(i).columns(), const_pools, factory, &columns[i]));
+    ZETASQL_RETURN_IF_ERROR(RepeatedParametersToMap(request.rows(i).params(),
+                                            const_pools, factory, &params[i]));
+  }
+
+  const PreparedExpression* exp = state->GetPreparedExpression();
+  ZETASQL_ASSIGN_OR_RETURN(const std::vector<Value> values,
+                   exp->ExecuteAfterPrepareBatch(columns, params));
+  for (const Value& value : values) {
+    ZETASQL_RETURN_IF_ERROR(value.Serialize(response->add_value()));
+  }
+  return state->SerializeType(exp->output_type(), response->mutable_type());
+}
+
+zetasql_base::Status ZetaSqlLocalServiceImpl::ExecuteQuery(
+    const ExecuteQueryRequest& request, const ExecuteQueryWriter& writer) {
+  constexpr int kDefaultMaxRowsPerResponse = 1000;
+  std::shared_ptr<RegisteredCatalogState> shared_state;
+  // Needed to hold the new state because shared_ptr doesn't support release().
+  std::unique_ptr<RegisteredCatalogState> new_catalog_state;
+  RegisteredCatalogState* catalog_state;
+  if (request.has_registered_catalog_id()) {
+    int64_t id = request.registered_catalog_id();
+    shared_state = registered_catalogs_->Get(id);
+    catalog_state = shared_state.get();
+    if (catalog_state == nullptr) {
+      return MakeSqlError() << "Registered catalog " << id << " unknown.";
+    }
+  } else {
+    DescriptorPools pools;
+    ZETASQL_RETURN_IF_ERROR(
+        descriptor_pools_->BuildDescriptorPools(request, &pools));
+    new_catalog_state = absl::make_unique<RegisteredCatalogState>();
+    catalog_state = new_catalog_state.get();
+    ZETASQL_RETURN_IF_ERROR(
+        catalog_state->Init(request.simple_catalog(), pools));
+  }
+  const auto& const_pools = catalog_state->GetDescriptorPools();
+  TypeFactory* factory = catalog_state->GetTypeFactory();
+
+  AnalyzerOptions options;
+  ZETASQL_RETURN_IF_ERROR(AnalyzerOptions::Deserialize(request.options(), const_pools,
+                                               factory, &options));
+  TableContentsCatalog catalog(catalog_state->GetCatalog());
+  for (const auto& content : request.table_content()) {
+    ZETASQL_RETURN_IF_ERROR(catalog.AddTableContent(content));
+  }
+  ParameterValueMap params;
+  ZETASQL_RETURN_IF_ERROR(
+      RepeatedParametersToMap(request.params(), const_pools, factory, &params));
+
+  EvaluatorOptions evaluator_options;
+  evaluator_options.type_factory = factory;
+  PreparedQuery query(request.sql(), evaluator_options);
+  ZETASQL_RETURN_IF_ERROR(query.Prepare(options, &catalog));
+
+  ExecuteQueryResponse response;
+  for (int i = 0; i < query.num_columns(); ++i) {
+    SimpleColumnProto* column = response.add_column();
+    column->set_name(query.column_name(i));
+    ZETASQL_RETURN_IF_ERROR(catalog_state->SerializeType(query.column_type(i),
+                                                 column->mutable_type()));
+  }
+
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+                   query.Execute(params));
+  const int max_rows_per_response = request.max_rows_per_response() > 0
+                                        ? request.max_rows_per_response()
+                                        : kDefaultMaxRowsPerResponse;
+  bool wrote_response = false;
+  while (iter->NextRow()) {
+    ExecuteQueryResponse::Row* row = response.add_row();
+    for (int i = 0; i < iter->NumColumns(); ++i) {
+      ZETASQL_RETURN_IF_ERROR(iter->GetValue(i).Serialize(row->add_value()));
+    }
+    if (response.row_size() >= max_rows_per_response) {
+      if (!writer(response)) {
+        return ::zetasql_base::CancelledErrorBuilder() << "Client went away";
+      }
+      wrote_response = true;
+      response.Clear();
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(iter->Status());
+  if ((!wrote_response || response.row_size() > 0) && !writer(response)) {
+    return ::zetasql_base::CancelledErrorBuilder() << "Client went away";
+  }
+  return ::zetasql_base::OkStatus();
+}
+
 zetasql_base::Status ZetaSqlLocalServiceImpl::GetTableFromProto(
     const TableFromProtoRequest& request, SimpleTableProto* response) {
   TypeFactory factory;
@@ -470,10 +969,13 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::Analyze(const AnalyzeRequest& requ
       return MakeSqlError() << "Registered catalog " << id << " unknown.";
     }
   } else {
+    DescriptorPools pools;
+    ZETASQL_RETURN_IF_ERROR(
+        descriptor_pools_->BuildDescriptorPools(request, &pools));
     new_catalog_state = absl::make_unique<RegisteredCatalogState>();
     catalog_state = new_catalog_state.get();
-    ZETASQL_RETURN_IF_ERROR(catalog_state->Init(request.simple_catalog(),
-                                        request.file_descriptor_set()));
+    ZETASQL_RETURN_IF_ERROR(
+        catalog_state->Init(request.simple_catalog(), pools));
   }
 
   RegisteredParseResumeLocationState* parse_resume_location_state;
@@ -570,6 +1072,76 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::AnalyzeExpressionImpl(
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::Status ZetaSqlLocalServiceImpl::AnalyzeBatch(
+    const AnalyzeBatchRequest& request, AnalyzeBatchResponse* response) {
+  // Held for the whole call, so that the catalog outlives the analyses even
+  // if it is unregistered meanwhile.
+  std::shared_ptr<RegisteredCatalogState> catalog_state;
+
+  if (request.has_registered_catalog_id()) {
+    int64_t id = request.registered_catalog_id();
+    catalog_state = registered_catalogs_->Get(id);
+    if (catalog_state == nullptr) {
+      return MakeSqlError() << "Registered catalog " << id << " unknown.";
+    }
+  } else {
+    DescriptorPools pools;
+    ZETASQL_RETURN_IF_ERROR(
+        descriptor_pools_->BuildDescriptorPools(request, &pools));
+    catalog_state = std::make_shared<RegisteredCatalogState>();
+    ZETASQL_RETURN_IF_ERROR(
+        catalog_state->Init(request.simple_catalog(), pools));
+  }
+
+  // Deserialized once for all the statements.
+  AnalyzerOptions options;
+  ZETASQL_RETURN_IF_ERROR(AnalyzerOptions::Deserialize(
+      request.options(), catalog_state->GetDescriptorPools(),
+      catalog_state->GetTypeFactory(), &options));
+
+  const int num_statements = request.sql_statement_size();
+  for (int i = 0; i < num_statements; ++i) {
+    response->add_result();
+  }
+  // Each call writes only its own result, so the calls may run in parallel.
+  auto analyze = [&](int64_t i) {
+    const std::string& sql = request.sql_statement(i);
+    std::unique_ptr<const AnalyzerOutput> output;
+    TypeFactory factory;
+    AnalyzeResponse statement_response;
+    zetasql_base::Status status = zetasql::AnalyzeStatement(
+        sql, options, catalog_state->GetCatalog(), &factory, &output);
+    if (status.ok()) {
+      status = SerializeResolvedOutput(output.get(), sql, &statement_response,
+                                       catalog_state.get());
+    }
+    AnalyzeBatchResponse::Result* result = response->mutable_result(i);
+    if (status.ok()) {
+      result->mutable_resolved_statement()->Swap(
+          statement_response.mutable_resolved_statement());
+    } else {
+      result->set_error_message(status.error_message());
+    }
+  };
+
+  const int max_parallelism = request.max_parallelism();
+  if (max_parallelism <= 1 || num_statements <= 1) {
+    for (int i = 0; i < num_statements; ++i) {
+      analyze(i);
+    }
+    return ::zetasql_base::OkStatus();
+  }
+  // ParallelFor() bounds the number of statements analyzed at once, and
+  // analyzes on the calling thread the statements that the executor does not
+  // get to.
+  std::unique_ptr<EvaluatorExecutor::TaskGroup> group =
+      EvaluatorExecutor::Default()->CreateTaskGroup(/*weight=*/1,
+                                                    /*max_parallelism=*/0);
+  EvaluatorExecutor::ScopedTaskGroup scoped_group(group.get());
+  ParallelFor(max_parallelism, num_statements, analyze);
+  return ::zetasql_base::OkStatus();
+}
+
 zetasql_base::Status ZetaSqlLocalServiceImpl::BuildSql(const BuildSqlRequest& request,
                                                  BuildSqlResponse* response) {
   RegisteredCatalogState* catalog_state;
@@ -585,15 +1157,20 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::BuildSql(const BuildSqlRequest& re
       return MakeSqlError() << "Registered catalog " << id << " unknown.";
     }
   } else {
+    DescriptorPools pools;
+    ZETASQL_RETURN_IF_ERROR(
+        descriptor_pools_->BuildDescriptorPools(request, &pools));
     new_catalog_state = absl::make_unique<RegisteredCatalogState>();
     catalog_state = new_catalog_state.get();
-    ZETASQL_RETURN_IF_ERROR(catalog_state->Init(request.simple_catalog(),
-                                        request.file_descriptor_set()));
+    ZETASQL_RETURN_IF_ERROR(
+        catalog_state->Init(request.simple_catalog(), pools));
   }
   IdStringPool string_pool;
+  ResolvedColumnRegistry column_registry;
   ResolvedNode::RestoreParams restore_params(
       catalog_state->GetDescriptorPools(), catalog_state->GetCatalog(),
       catalog_state->GetTypeFactory(), &string_pool);
+  restore_params.column_registry = &column_registry;
 
   std::unique_ptr<ResolvedNode> ast;
   if (request.has_resolved_statement()) {
@@ -671,8 +1248,8 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::SerializeResolvedOutput(
     AnalyzeResponse* response, RegisteredCatalogState* state) {
   const std::vector<const google::protobuf::DescriptorPool*>& pools =
       state->GetDescriptorPools();
-  FileDescriptorSetMap file_descriptor_set_map;
-  PopulateExistingPoolsToFileDescriptorSetMap(pools, &file_descriptor_set_map);
+  FileDescriptorSetMap file_descriptor_set_map =
+      state->NewFileDescriptorSetMap(pools);
 
   if (output->resolved_statement() != nullptr) {
     ZETASQL_RETURN_IF_ERROR(output->resolved_statement()->SaveTo(
@@ -701,6 +1278,7 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::SerializeResolvedOutput(
         << "Analyzer result of " << statement
         << " uses unknown DescriptorPool, this shouldn't happen.";
   }
+  state->UpdateSerializedFiles(pools, file_descriptor_set_map);
 
   return ::zetasql_base::OkStatus();
 }
@@ -713,8 +1291,32 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::FormatSql(
 zetasql_base::Status ZetaSqlLocalServiceImpl::RegisterCatalog(
     const RegisterCatalogRequest& request, RegisterResponse* response) {
   std::unique_ptr<RegisteredCatalogState> state(new RegisteredCatalogState());
-  ZETASQL_RETURN_IF_ERROR(
-      state->Init(request.simple_catalog(), request.file_descriptor_set()));
+  if (request.has_base_registered_catalog_id()) {
+    if (!request.file_descriptor_set().empty() ||
+        !request.file_descriptor_set_fingerprint().empty()) {
+      return MakeSqlError()
+             << "A catalog registered with base_registered_catalog_id uses "
+                "the descriptor sets of its base catalog";
+    }
+    int64_t base_id = request.base_registered_catalog_id();
+    std::shared_ptr<RegisteredCatalogState> base_state =
+        registered_catalogs_->Get(base_id);
+    if (base_state == nullptr) {
+      return MakeSqlError() << "Unknown catalog ID: " << base_id;
+    }
+    ZETASQL_RETURN_IF_ERROR(state->InitFromBase(base_state.get(),
+                                        request.simple_catalog(),
+                                        request.removed_table_name()));
+  } else {
+    if (!request.removed_table_name().empty()) {
+      return MakeSqlError() << "removed_table_name requires "
+                               "base_registered_catalog_id";
+    }
+    DescriptorPools pools;
+    ZETASQL_RETURN_IF_ERROR(
+        descriptor_pools_->BuildDescriptorPools(request, &pools));
+    ZETASQL_RETURN_IF_ERROR(state->Init(request.simple_catalog(), pools));
+  }
 
   int64_t id = registered_catalogs_->Register(state.release());
   ZETASQL_RET_CHECK_NE(-1, id) << "Failed to register catalog, this shouldn't happen.";
@@ -724,6 +1326,23 @@ zetasql_base::Status ZetaSqlLocalServiceImpl::RegisterCatalog(
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::Status ZetaSqlLocalServiceImpl::RegisterFileDescriptorSets(
+    const RegisterFileDescriptorSetsRequest& request,
+    RegisterFileDescriptorSetsResponse* response) {
+  for (const auto& file_descriptor_set : request.file_descriptor_set()) {
+    int64_t fingerprint;
+    ZETASQL_RETURN_IF_ERROR(
+        descriptor_pools_->Register(file_descriptor_set, &fingerprint));
+    response->add_fingerprint(fingerprint);
+  }
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::Status ZetaSqlLocalServiceImpl::UnregisterFileDescriptorSets(
+    const UnregisterFileDescriptorSetsRequest& request) {
+  return descriptor_pools_->Unregister(request.fingerprint());
+}
+
 zetasql_base::Status ZetaSqlLocalServiceImpl::UnregisterCatalog(int64_t id) {
   if (registered_catalogs_->Delete(id)) {
     return ::zetasql_base::OkStatus();
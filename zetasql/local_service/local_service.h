@@ -18,6 +18,7 @@
 #define ZETASQL_LOCAL_SERVICE_LOCAL_SERVICE_H_
 
 #include <stddef.h>
+#include <functional>
 #include <memory>
 
 #include "zetasql/local_service/local_service.pb.h"
@@ -32,6 +33,7 @@
 namespace zetasql {
 namespace local_service {
 
+class DescriptorPoolRegistry;
 class PreparedExpressionPool;
 class PreparedExpressionState;
 class RegisteredCatalogPool;
@@ -55,10 +57,23 @@ class ZetaSqlLocalServiceImpl {
   zetasql_base::Status Evaluate(const EvaluateRequest& request,
                         EvaluateResponse* response);
 
+  zetasql_base::Status EvaluateBatch(const EvaluateBatchRequest& request,
+                             EvaluateBatchResponse* response);
+
   zetasql_base::Status EvaluateImpl(const EvaluateRequest& request,
                             PreparedExpressionState* state,
                             EvaluateResponse* response);
 
+  // Called with each response of ExecuteQuery. Returns false if the client
+  // went away.
+  using ExecuteQueryWriter =
+      std::function<bool(const ExecuteQueryResponse& response)>;
+
+  // Writes at least one response, unless the query fails before returning
+  // any rows.
+  zetasql_base::Status ExecuteQuery(const ExecuteQueryRequest& request,
+                            const ExecuteQueryWriter& writer);
+
   zetasql_base::Status GetTableFromProto(const TableFromProtoRequest& request,
                                  SimpleTableProto* response);
 
@@ -80,6 +95,9 @@ class ZetaSqlLocalServiceImpl {
                                      RegisteredCatalogState* catalog_state,
                                      AnalyzeResponse* response);
 
+  zetasql_base::Status AnalyzeBatch(const AnalyzeBatchRequest& request,
+                            AnalyzeBatchResponse* response);
+
   zetasql_base::Status BuildSql(const BuildSqlRequest& request,
                         BuildSqlResponse* response);
 
@@ -104,6 +122,13 @@ class ZetaSqlLocalServiceImpl {
 
   zetasql_base::Status UnregisterCatalog(int64_t id);
 
+  zetasql_base::Status RegisterFileDescriptorSets(
+      const RegisterFileDescriptorSetsRequest& request,
+      RegisterFileDescriptorSetsResponse* response);
+
+  zetasql_base::Status UnregisterFileDescriptorSets(
+      const UnregisterFileDescriptorSetsRequest& request);
+
   zetasql_base::Status RegisterParseResumeLocation(
       const ParseResumeLocationProto& location, RegisterResponse* response);
 
@@ -117,6 +142,7 @@ class ZetaSqlLocalServiceImpl {
   std::unique_ptr<PreparedExpressionPool> prepared_expressions_;
   std::unique_ptr<RegisteredParseResumeLocationPool>
       registered_parse_resume_locations_;
+  std::unique_ptr<DescriptorPoolRegistry> descriptor_pools_;
 
   // For testing.
   size_t NumSavedPreparedExpression() const;
@@ -0,0 +1,457 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "zetasql/local_service/local_service_async_grpc.h"
+
+#include <grpcpp/support/async_stream.h>
+#include <grpcpp/support/async_unary_call.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/empty.pb.h"
+#include "zetasql/base/logging.h"
+#include "zetasql/local_service/local_service.pb.h"
+#include "zetasql/proto/options.pb.h"
+#include "zetasql/public/parse_resume_location.pb.h"
+#include "zetasql/public/simple_table.pb.h"
+#include "absl/memory/memory.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+namespace local_service {
+
+void LatencyHistogram::Add(absl::Duration latency) {
+  const int64_t micros = absl::ToInt64Microseconds(latency);
+  int bucket = 0;
+  while (bucket < kNumBuckets - 1 && micros >= (int64_t{1} << bucket)) {
+    ++bucket;
+  }
+  ++buckets_[bucket];
+  ++count_;
+  sum_ += latency;
+}
+
+absl::Duration LatencyHistogram::BucketLimit(int i) {
+  if (i >= kNumBuckets - 1) return absl::InfiniteDuration();
+  return absl::Microseconds(int64_t{1} << i);
+}
+
+absl::Duration LatencyHistogram::Quantile(double q) const {
+  if (count_ == 0) return absl::ZeroDuration();
+  const int64_t rank = std::max<int64_t>(
+      1, static_cast<int64_t>(std::ceil(q * static_cast<double>(count_))));
+  int64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) return BucketLimit(i);
+  }
+  return BucketLimit(kNumBuckets - 1);
+}
+
+// A fixed number of threads that run closures from a bounded queue.
+class ZetaSqlLocalServiceAsyncServer::Executor {
+ public:
+  Executor(int num_threads, int max_queued) : max_queued_(max_queued) {
+    for (int i = 0; i < std::max(1, num_threads); ++i) {
+      threads_.emplace_back([this]() { Run(); });
+    }
+  }
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+  ~Executor() { Stop(); }
+
+  // Returns false without running <fn> if the queue is full or the executor
+  // is stopped.
+  bool Schedule(std::function<void()> fn) {
+    absl::MutexLock lock(&mutex_);
+    if (stopped_ || queue_.size() >= max_queued_) return false;
+    queue_.push_back(std::move(fn));
+    return true;
+  }
+
+  // Waits for the queued closures to finish and stops the threads.
+  void Stop() {
+    {
+      absl::MutexLock lock(&mutex_);
+      stopped_ = true;
+    }
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+  }
+
+ private:
+  bool HasWorkOrStopped() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return stopped_ || !queue_.empty();
+  }
+
+  void Run() {
+    while (true) {
+      std::function<void()> fn;
+      {
+        absl::MutexLock lock(&mutex_);
+        mutex_.Await(absl::Condition(this, &Executor::HasWorkOrStopped));
+        if (queue_.empty()) return;
+        fn = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      fn();
+    }
+  }
+
+  const int max_queued_;
+  std::vector<std::thread> threads_;
+
+  absl::Mutex mutex_;
+  std::deque<std::function<void()>> queue_ ABSL_GUARDED_BY(mutex_);
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// A call of one RPC. The Calls are the tags of the completion queue: each
+// one waits for one operation at a time, and Proceed() is called on the
+// polling thread when it completes. A Call requests the next call of its RPC
+// when it starts, and deletes itself when it is done.
+class ZetaSqlLocalServiceAsyncServer::Call {
+ public:
+  Call(ZetaSqlLocalServiceAsyncServer* server, const char* name)
+      : server_(server), name_(name) {}
+  Call(const Call&) = delete;
+  Call& operator=(const Call&) = delete;
+  virtual ~Call() {}
+
+  // <ok> is the result of the operation, as returned by
+  // CompletionQueue::Next().
+  virtual void Proceed(bool ok) = 0;
+
+ protected:
+  // Runs <run> on the executor, or calls <reject> with the error if the
+  // executor is full.
+  void Schedule(std::function<void()> run,
+                std::function<void(const grpc::Status&)> reject) {
+    start_time_ = absl::Now();
+    if (!server_->executor_->Schedule(std::move(run))) {
+      RecordLatency();
+      reject(grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                          "Too many calls are waiting to run"));
+    }
+  }
+
+  bool DeadlinePassed() const {
+    return context_.deadline() < std::chrono::system_clock::now();
+  }
+
+  void RecordLatency() {
+    server_->RecordLatency(name_, absl::Now() - start_time_);
+  }
+
+  ZetaSqlLocalServiceAsyncServer* server_;
+  const char* name_;
+  grpc::ServerContext context_;
+  absl::Time start_time_;
+};
+
+template <class Request, class Response>
+class ZetaSqlLocalServiceAsyncServer::UnaryCall
+    : public ZetaSqlLocalServiceAsyncServer::Call {
+ public:
+  using RequestMethod = void (ZetaSqlLocalService::AsyncService::*)(
+      grpc::ServerContext*, Request*,
+      grpc::ServerAsyncResponseWriter<Response>*, grpc::CompletionQueue*,
+      grpc::ServerCompletionQueue*, void*);
+  using Handler = grpc::Status (ZetaSqlLocalServiceGrpcImpl::*)(
+      grpc::ServerContext*, const Request*, Response*);
+
+  UnaryCall(ZetaSqlLocalServiceAsyncServer* server, const char* name,
+            RequestMethod request_method, Handler handler)
+      : Call(server, name),
+        request_method_(request_method),
+        handler_(handler),
+        responder_(&context_) {
+    (server_->async_service_.*request_method_)(
+        &context_, &request_, &responder_, server_->completion_queue_.get(),
+        server_->completion_queue_.get(), this);
+  }
+
+  void Proceed(bool ok) override {
+    if (finished_ || !ok) {
+      delete this;
+      return;
+    }
+    new UnaryCall(server_, name_, request_method_, handler_);
+    Schedule([this]() { Run(); },
+             [this](const grpc::Status& status) { Finish(status); });
+  }
+
+ private:
+  void Run() {
+    if (DeadlinePassed()) {
+      Finish(grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                          "Deadline exceeded before the call started"));
+      return;
+    }
+    const grpc::Status status =
+        (server_->grpc_service_.*handler_)(&context_, &request_, &response_);
+    RecordLatency();
+    Finish(status);
+  }
+
+  void Finish(const grpc::Status& status) {
+    finished_ = true;
+    if (status.ok()) {
+      responder_.Finish(response_, status, this);
+    } else {
+      responder_.FinishWithError(status, this);
+    }
+  }
+
+  const RequestMethod request_method_;
+  const Handler handler_;
+  Request request_;
+  Response response_;
+  grpc::ServerAsyncResponseWriter<Response> responder_;
+  bool finished_ = false;
+};
+
+class ZetaSqlLocalServiceAsyncServer::ExecuteQueryCall
+    : public ZetaSqlLocalServiceAsyncServer::Call {
+ public:
+  explicit ExecuteQueryCall(ZetaSqlLocalServiceAsyncServer* server)
+      : Call(server, "ExecuteQuery"), writer_(&context_) {
+    server_->async_service_.RequestExecuteQuery(
+        &context_, &request_, &writer_, server_->completion_queue_.get(),
+        server_->completion_queue_.get(), this);
+  }
+
+  void Proceed(bool ok) override {
+    switch (state_) {
+      case State::kRequested:
+        if (!ok) {
+          delete this;
+          return;
+        }
+        new ExecuteQueryCall(server_);
+        state_ = State::kRunning;
+        Schedule([this]() { Run(); },
+                 [this](const grpc::Status& status) { Finish(status); });
+        return;
+      case State::kRunning: {
+        // A Write() completed.
+        absl::MutexLock lock(&mutex_);
+        write_ok_ = ok;
+        write_done_ = true;
+        return;
+      }
+      case State::kFinished:
+        delete this;
+        return;
+    }
+  }
+
+ private:
+  enum class State { kRequested, kRunning, kFinished };
+
+  void Run() {
+    if (DeadlinePassed()) {
+      Finish(grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                          "Deadline exceeded before the call started"));
+      return;
+    }
+    grpc::Status status = ToGrpcStatus(server_->service()->ExecuteQuery(
+        request_, [this](const ExecuteQueryResponse& response) {
+          return !DeadlinePassed() && Write(response);
+        }));
+    if (!status.ok() && DeadlinePassed()) {
+      status = grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                            "Deadline exceeded");
+    }
+    RecordLatency();
+    Finish(status);
+  }
+
+  // Writes <response> and waits for the write to complete, which keeps the
+  // query from running ahead of the client. Returns false if the client
+  // went away.
+  bool Write(const ExecuteQueryResponse& response) {
+    {
+      absl::MutexLock lock(&mutex_);
+      write_done_ = false;
+    }
+    writer_.Write(response, this);
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(&write_done_));
+    return write_ok_;
+  }
+
+  void Finish(const grpc::Status& status) {
+    state_ = State::kFinished;
+    writer_.Finish(status, this);
+  }
+
+  ExecuteQueryRequest request_;
+  grpc::ServerAsyncWriter<ExecuteQueryResponse> writer_;
+  State state_ = State::kRequested;
+
+  absl::Mutex mutex_;
+  bool write_done_ ABSL_GUARDED_BY(mutex_) = false;
+  bool write_ok_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+ZetaSqlLocalServiceAsyncServer::ZetaSqlLocalServiceAsyncServer(
+    const Options& options)
+    : executor_(absl::make_unique<Executor>(options.num_threads,
+                                            options.max_queued_calls)) {}
+
+ZetaSqlLocalServiceAsyncServer::~ZetaSqlLocalServiceAsyncServer() {
+  Shutdown();
+}
+
+void ZetaSqlLocalServiceAsyncServer::RegisterWith(
+    grpc::ServerBuilder* builder) {
+  builder->RegisterService(&async_service_);
+  completion_queue_ = builder->AddCompletionQueue();
+}
+
+void ZetaSqlLocalServiceAsyncServer::Start(grpc::Server* server) {
+  absl::MutexLock lock(&mutex_);
+  CHECK(server_ == nullptr) << "Start() must be called once";
+  CHECK(completion_queue_ != nullptr) << "RegisterWith() was not called";
+  server_ = server;
+
+  using AsyncService = ZetaSqlLocalService::AsyncService;
+  using Impl = ZetaSqlLocalServiceGrpcImpl;
+  using google::protobuf::Empty;
+  new UnaryCall<PrepareRequest, PrepareResponse>(
+      this, "Prepare", &AsyncService::RequestPrepare, &Impl::Prepare);
+  new UnaryCall<EvaluateRequest, EvaluateResponse>(
+      this, "Evaluate", &AsyncService::RequestEvaluate, &Impl::Evaluate);
+  new UnaryCall<EvaluateBatchRequest, EvaluateBatchResponse>(
+      this, "EvaluateBatch", &AsyncService::RequestEvaluateBatch,
+      &Impl::EvaluateBatch);
+  new ExecuteQueryCall(this);
+  new UnaryCall<RegisterFileDescriptorSetsRequest,
+                RegisterFileDescriptorSetsResponse>(
+      this, "RegisterFileDescriptorSets",
+      &AsyncService::RequestRegisterFileDescriptorSets,
+      &Impl::RegisterFileDescriptorSets);
+  new UnaryCall<UnregisterFileDescriptorSetsRequest, Empty>(
+      this, "UnregisterFileDescriptorSets",
+      &AsyncService::RequestUnregisterFileDescriptorSets,
+      &Impl::UnregisterFileDescriptorSets);
+  new UnaryCall<UnprepareRequest, Empty>(
+      this, "Unprepare", &AsyncService::RequestUnprepare, &Impl::Unprepare);
+  new UnaryCall<TableFromProtoRequest, SimpleTableProto>(
+      this, "GetTableFromProto", &AsyncService::RequestGetTableFromProto,
+      &Impl::GetTableFromProto);
+  new UnaryCall<RegisterCatalogRequest, RegisterResponse>(
+      this, "RegisterCatalog", &AsyncService::RequestRegisterCatalog,
+      &Impl::RegisterCatalog);
+  new UnaryCall<ParseResumeLocationProto, RegisterResponse>(
+      this, "RegisterParseResumeLocation",
+      &AsyncService::RequestRegisterParseResumeLocation,
+      &Impl::RegisterParseResumeLocation);
+  new UnaryCall<AnalyzeRequest, AnalyzeResponse>(
+      this, "Analyze", &AsyncService::RequestAnalyze, &Impl::Analyze);
+  new UnaryCall<AnalyzeBatchRequest, AnalyzeBatchResponse>(
+      this, "AnalyzeBatch", &AsyncService::RequestAnalyzeBatch,
+      &Impl::AnalyzeBatch);
+  new UnaryCall<BuildSqlRequest, BuildSqlResponse>(
+      this, "BuildSql", &AsyncService::RequestBuildSql, &Impl::BuildSql);
+  new UnaryCall<ExtractTableNamesFromStatementRequest,
+                ExtractTableNamesFromStatementResponse>(
+      this, "ExtractTableNamesFromStatement",
+      &AsyncService::RequestExtractTableNamesFromStatement,
+      &Impl::ExtractTableNamesFromStatement);
+  new UnaryCall<ExtractTableNamesFromNextStatementRequest,
+                ExtractTableNamesFromNextStatementResponse>(
+      this, "ExtractTableNamesFromNextStatement",
+      &AsyncService::RequestExtractTableNamesFromNextStatement,
+      &Impl::ExtractTableNamesFromNextStatement);
+  new UnaryCall<FormatSqlRequest, FormatSqlResponse>(
+      this, "FormatSql", &AsyncService::RequestFormatSql, &Impl::FormatSql);
+  // Not implemented by ZetaSqlLocalServiceGrpcImpl, but requested anyway so
+  // that calls fail with UNIMPLEMENTED rather than hang.
+  new UnaryCall<FormatSqlRequest, FormatSqlResponse>(
+      this, "LenientFormatSql", &AsyncService::RequestLenientFormatSql,
+      &Impl::LenientFormatSql);
+  new UnaryCall<UnregisterRequest, Empty>(
+      this, "UnregisterCatalog", &AsyncService::RequestUnregisterCatalog,
+      &Impl::UnregisterCatalog);
+  new UnaryCall<UnregisterRequest, Empty>(
+      this, "UnregisterParseResumeLocation",
+      &AsyncService::RequestUnregisterParseResumeLocation,
+      &Impl::UnregisterParseResumeLocation);
+  new UnaryCall<ZetaSQLBuiltinFunctionOptionsProto,
+                GetBuiltinFunctionsResponse>(
+      this, "GetBuiltinFunctions", &AsyncService::RequestGetBuiltinFunctions,
+      &Impl::GetBuiltinFunctions);
+  new UnaryCall<AddSimpleTableRequest, Empty>(
+      this, "AddSimpleTable", &AsyncService::RequestAddSimpleTable,
+      &Impl::AddSimpleTable);
+  new UnaryCall<LanguageOptionsRequest, LanguageOptionsProto>(
+      this, "GetLanguageOptions", &AsyncService::RequestGetLanguageOptions,
+      &Impl::GetLanguageOptions);
+
+  poll_thread_ = std::thread([this]() { PollCompletionQueue(); });
+}
+
+void ZetaSqlLocalServiceAsyncServer::Shutdown() {
+  grpc::Server* server;
+  std::thread poll_thread;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (server_ == nullptr) return;
+    server = server_;
+    server_ = nullptr;
+    poll_thread = std::move(poll_thread_);
+  }
+  // Waits for the calls in flight, which need the executor and the polling
+  // thread to finish. The calls still waiting for their next call fail.
+  server->Shutdown();
+  executor_->Stop();
+  completion_queue_->Shutdown();
+  poll_thread.join();
+}
+
+void ZetaSqlLocalServiceAsyncServer::PollCompletionQueue() {
+  void* tag;
+  bool ok;
+  while (completion_queue_->Next(&tag, &ok)) {
+    static_cast<Call*>(tag)->Proceed(ok);
+  }
+}
+
+void ZetaSqlLocalServiceAsyncServer::RecordLatency(const std::string& name,
+                                                   absl::Duration latency) {
+  absl::MutexLock lock(&stats_mutex_);
+  latencies_[name].Add(latency);
+}
+
+std::map<std::string, LatencyHistogram>
+ZetaSqlLocalServiceAsyncServer::GetLatencyHistograms() const {
+  absl::MutexLock lock(&stats_mutex_);
+  return latencies_;
+}
+
+}  // namespace local_service
+}  // namespace zetasql
@@ -0,0 +1,165 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef ZETASQL_LOCAL_SERVICE_LOCAL_SERVICE_ASYNC_GRPC_H_
+#define ZETASQL_LOCAL_SERVICE_LOCAL_SERVICE_ASYNC_GRPC_H_
+
+#include <grpcpp/completion_queue.h>
+#include <grpcpp/server.h>
+#include <grpcpp/server_builder.h>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+
+#include <cstdint>
+#include "zetasql/local_service/local_service.grpc.pb.h"
+#include "zetasql/local_service/local_service.h"
+#include "zetasql/local_service/local_service_grpc.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace zetasql {
+namespace local_service {
+
+// Counts latencies in buckets whose widths grow exponentially. Bucket 0
+// counts latencies under 1us, bucket i > 0 counts latencies in
+// [2^(i-1)us, 2^i us), and the last bucket also counts all larger latencies.
+//
+// This class is not thread-safe.
+class LatencyHistogram {
+ public:
+  static constexpr int kNumBuckets = 32;
+
+  void Add(absl::Duration latency);
+
+  // Returns the exclusive upper bound of bucket <i>, or an infinite duration
+  // for the last bucket.
+  static absl::Duration BucketLimit(int i);
+
+  // Returns the upper bound of the bucket that contains the latency at
+  // quantile <q> in [0, 1], e.g. 0.99 for the 99th percentile, or zero if
+  // nothing was added.
+  absl::Duration Quantile(double q) const;
+
+  int64_t count() const { return count_; }
+  absl::Duration sum() const { return sum_; }
+  const std::array<int64_t, kNumBuckets>& buckets() const { return buckets_; }
+
+ private:
+  std::array<int64_t, kNumBuckets> buckets_ = {};
+  int64_t count_ = 0;
+  absl::Duration sum_;
+};
+
+// A completion queue based asynchronous gRPC server for ZetaSqlLocalService,
+// for running the service as a sidecar shared by many client processes.
+//
+// ZetaSqlLocalServiceGrpcImpl uses the synchronous gRPC API, which runs every
+// call on its own thread. This server instead accepts calls on one thread
+// that polls a completion queue, and runs them on a fixed number of worker
+// threads. Calls that arrive while all workers are busy wait in a bounded
+// queue; calls that do not fit in it fail with RESOURCE_EXHAUSTED, and calls
+// whose deadline passed while they were waiting fail with DEADLINE_EXCEEDED
+// without being run. ExecuteQuery also stops producing rows when its deadline
+// passes. ExecuteQuery keeps its worker while it waits for the client to read
+// each response, as in the synchronous server.
+//
+// Usage:
+//   ZetaSqlLocalServiceAsyncServer async_server(options);
+//   grpc::ServerBuilder builder;
+//   builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+//   async_server.RegisterWith(&builder);
+//   std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+//   async_server.Start(server.get());
+//   ...
+//   async_server.Shutdown();
+//
+// This class is thread-safe.
+class ZetaSqlLocalServiceAsyncServer {
+ public:
+  struct Options {
+    // The number of threads that run calls.
+    int num_threads = 4;
+    // The maximum number of calls that wait for a thread.
+    int max_queued_calls = 1024;
+  };
+
+  explicit ZetaSqlLocalServiceAsyncServer(const Options& options);
+  ZetaSqlLocalServiceAsyncServer(const ZetaSqlLocalServiceAsyncServer&) =
+      delete;
+  ZetaSqlLocalServiceAsyncServer& operator=(
+      const ZetaSqlLocalServiceAsyncServer&) = delete;
+  // Calls Shutdown().
+  ~ZetaSqlLocalServiceAsyncServer();
+
+  // Registers the service and its completion queue with <builder>. Must be
+  // called once, before <builder> builds the server.
+  void RegisterWith(grpc::ServerBuilder* builder);
+
+  // Starts accepting calls on <server>, which must have been built by the
+  // builder passed to RegisterWith(), and must outlive this object.
+  void Start(grpc::Server* server);
+
+  // Shuts down the server passed to Start() and waits for the running and
+  // queued calls to finish. Does nothing if the server was not started or
+  // was shut down already.
+  void Shutdown();
+
+  // Returns the latencies of the calls that finished so far, by RPC name.
+  // A latency goes from the arrival of a call to the time its response is
+  // ready, and includes the time the call waited for a worker.
+  std::map<std::string, LatencyHistogram> GetLatencyHistograms() const;
+
+  // The implementation of the RPCs, for callers in the same process.
+  ZetaSqlLocalServiceImpl* service() { return grpc_service_.service(); }
+
+ private:
+  class Call;
+  template <class Request, class Response>
+  class UnaryCall;
+  class ExecuteQueryCall;
+  class Executor;
+
+  // Polls the completion queue until it is shut down and drained.
+  void PollCompletionQueue();
+
+  void RecordLatency(const std::string& name, absl::Duration latency)
+      ABSL_LOCKS_EXCLUDED(stats_mutex_);
+
+  // Runs the RPCs.
+  ZetaSqlLocalServiceGrpcImpl grpc_service_;
+  ZetaSqlLocalService::AsyncService async_service_;
+  std::unique_ptr<grpc::ServerCompletionQueue> completion_queue_;
+  std::unique_ptr<Executor> executor_;
+
+  absl::Mutex mutex_;
+  grpc::Server* server_ ABSL_GUARDED_BY(mutex_) = nullptr;  // Not owned.
+  std::thread poll_thread_ ABSL_GUARDED_BY(mutex_);
+
+  mutable absl::Mutex stats_mutex_;
+  std::map<std::string, LatencyHistogram> latencies_
+      ABSL_GUARDED_BY(stats_mutex_);
+};
+
+}  // namespace local_service
+}  // namespace zetasql
+
+#endif  // ZETASQL_LOCAL_SERVICE_LOCAL_SERVICE_ASYNC_GRPC_H_
@@ -21,8 +21,6 @@
 namespace zetasql {
 namespace local_service {
 
-namespace {
-
 grpc::Status ToGrpcStatus(zetasql_base::Status status) {
   if (status.ok()) {
     return grpc::Status();
@@ -80,8 +78,6 @@ grpc::Status ToGrpcStatus(zetasql_base::Status status) {
   return grpc::Status(grpc_code, status.error_message(), "");
 }
 
-}  // namespace
-
 grpc::Status ZetaSqlLocalServiceGrpcImpl::Prepare(
     grpc::ServerContext* context, const PrepareRequest* req,
     PrepareResponse* resp) {
@@ -100,6 +96,23 @@ grpc::Status ZetaSqlLocalServiceGrpcImpl::Evaluate(
   return ToGrpcStatus(service_.Evaluate(*req, resp));
 }
 
+grpc::Status ZetaSqlLocalServiceGrpcImpl::EvaluateBatch(
+    grpc::ServerContext* context, const EvaluateBatchRequest* req,
+    EvaluateBatchResponse* resp) {
+  return ToGrpcStatus(service_.EvaluateBatch(*req, resp));
+}
+
+grpc::Status ZetaSqlLocalServiceGrpcImpl::ExecuteQuery(
+    grpc::ServerContext* context, const ExecuteQueryRequest* req,
+    grpc::ServerWriter<ExecuteQueryResponse>* writer) {
+  // Write() blocks while the client is not reading, which keeps the query
+  // from running ahead of it.
+  return ToGrpcStatus(service_.ExecuteQuery(
+      *req, [writer](const ExecuteQueryResponse& response) {
+        return writer->Write(response);
+      }));
+}
+
 grpc::Status ZetaSqlLocalServiceGrpcImpl::GetTableFromProto(
     grpc::ServerContext* context, const TableFromProtoRequest* req,
     SimpleTableProto* resp) {
@@ -112,6 +125,12 @@ grpc::Status ZetaSqlLocalServiceGrpcImpl::Analyze(
   return ToGrpcStatus(service_.Analyze(*req, resp));
 }
 
+grpc::Status ZetaSqlLocalServiceGrpcImpl::AnalyzeBatch(
+    grpc::ServerContext* context, const AnalyzeBatchRequest* req,
+    AnalyzeBatchResponse* resp) {
+  return ToGrpcStatus(service_.AnalyzeBatch(*req, resp));
+}
+
 grpc::Status ZetaSqlLocalServiceGrpcImpl::BuildSql(
     grpc::ServerContext* context, const BuildSqlRequest* req,
     BuildSqlResponse* resp) {
@@ -150,6 +169,19 @@ grpc::Status ZetaSqlLocalServiceGrpcImpl::UnregisterCatalog(
   return ToGrpcStatus(service_.UnregisterCatalog(req->registered_id()));
 }
 
+grpc::Status ZetaSqlLocalServiceGrpcImpl::RegisterFileDescriptorSets(
+    grpc::ServerContext* context, const RegisterFileDescriptorSetsRequest* req,
+    RegisterFileDescriptorSetsResponse* resp) {
+  return ToGrpcStatus(service_.RegisterFileDescriptorSets(*req, resp));
+}
+
+grpc::Status ZetaSqlLocalServiceGrpcImpl::UnregisterFileDescriptorSets(
+    grpc::ServerContext* context,
+    const UnregisterFileDescriptorSetsRequest* req,
+    google::protobuf::Empty* unused) {
+  return ToGrpcStatus(service_.UnregisterFileDescriptorSets(*req));
+}
+
 grpc::Status ZetaSqlLocalServiceGrpcImpl::RegisterParseResumeLocation(
     grpc::ServerContext* context,
     const ParseResumeLocationProto* parse_resume_location,
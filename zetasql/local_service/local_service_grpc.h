@@ -23,10 +23,14 @@
 #include "zetasql/proto/options.pb.h"
 #include "zetasql/public/parse_resume_location.pb.h"
 #include "zetasql/public/simple_table.pb.h"
+#include "zetasql/base/status.h"
 
 namespace zetasql {
 namespace local_service {
 
+// Returns the grpc::Status with the code and message of <status>.
+grpc::Status ToGrpcStatus(zetasql_base::Status status);
+
 // Implementation of ZetaSqlLocalService Grpc RPC service.
 class ZetaSqlLocalServiceGrpcImpl
     : public ZetaSqlLocalService::Service {
@@ -42,6 +46,14 @@ class ZetaSqlLocalServiceGrpcImpl
                         const EvaluateRequest* req,
                         EvaluateResponse* resp) override;
 
+  grpc::Status EvaluateBatch(grpc::ServerContext* context,
+                             const EvaluateBatchRequest* req,
+                             EvaluateBatchResponse* resp) override;
+
+  grpc::Status ExecuteQuery(
+      grpc::ServerContext* context, const ExecuteQueryRequest* req,
+      grpc::ServerWriter<ExecuteQueryResponse>* writer) override;
+
   grpc::Status GetTableFromProto(grpc::ServerContext* context,
                                  const TableFromProtoRequest* req,
                                  SimpleTableProto* resp) override;
@@ -49,6 +61,10 @@ class ZetaSqlLocalServiceGrpcImpl
   grpc::Status Analyze(grpc::ServerContext* context, const AnalyzeRequest* req,
                        AnalyzeResponse* resp) override;
 
+  grpc::Status AnalyzeBatch(grpc::ServerContext* context,
+                            const AnalyzeBatchRequest* req,
+                            AnalyzeBatchResponse* resp) override;
+
   grpc::Status BuildSql(grpc::ServerContext* context,
                         const BuildSqlRequest* req,
                         BuildSqlResponse* resp) override;
@@ -75,6 +91,16 @@ class ZetaSqlLocalServiceGrpcImpl
                                  const UnregisterRequest* req,
                                  google::protobuf::Empty* unused) override;
 
+  grpc::Status RegisterFileDescriptorSets(
+      grpc::ServerContext* context,
+      const RegisterFileDescriptorSetsRequest* req,
+      RegisterFileDescriptorSetsResponse* resp) override;
+
+  grpc::Status UnregisterFileDescriptorSets(
+      grpc::ServerContext* context,
+      const UnregisterFileDescriptorSetsRequest* req,
+      google::protobuf::Empty* unused) override;
+
   grpc::Status RegisterParseResumeLocation(
       grpc::ServerContext* context,
       const ParseResumeLocationProto* parse_resume_location,
@@ -97,6 +123,10 @@ class ZetaSqlLocalServiceGrpcImpl
                                   const LanguageOptionsRequest* req,
                                   LanguageOptionsProto* resp) override;
 
+  // The implementation of the RPCs, for callers in the same process that
+  // bypass gRPC.
+  ZetaSqlLocalServiceImpl* service() { return &service_; }
+
  private:
   ZetaSqlLocalServiceImpl service_;
 };
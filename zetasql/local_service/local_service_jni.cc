@@ -25,25 +25,61 @@
 #include <unistd.h>
 
 #include <memory>
+#include <string>
 
+#include "zetasql/local_service/local_service.h"
+#include "zetasql/local_service/local_service.pb.h"
 #include "zetasql/local_service/local_service_grpc.h"
+#include "absl/strings/string_view.h"
+#include "zetasql/base/status.h"
 
 namespace zetasql {
 namespace local_service {
 namespace {
 
+static ZetaSqlLocalServiceGrpcImpl* GetService() {
+  // The service must remain for the lifetime of the server.
+  static ZetaSqlLocalServiceGrpcImpl* service =
+      new ZetaSqlLocalServiceGrpcImpl();
+  return service;
+}
+
 static grpc::Server* GetServer() {
   static grpc::Server* server = []() {
-    // The service must remain for the lifetime of the server.
-    static ZetaSqlLocalServiceGrpcImpl* service =
-        new ZetaSqlLocalServiceGrpcImpl();
     grpc::ServerBuilder builder;
-    builder.RegisterService(service);
+    builder.RegisterService(GetService());
     return builder.BuildAndStart().release();
   }();
   return server;
 }
 
+static void IllegalArgumentException(JNIEnv* env, absl::string_view message) {
+  jclass e = env->FindClass("java/lang/IllegalArgumentException");
+  if (e == nullptr) {
+    return;
+  }
+  env->ThrowNew(e, std::string(message).c_str());
+}
+
+static std::string ToString(JNIEnv* env, jbyteArray bytes) {
+  std::string result(env->GetArrayLength(bytes), '\0');
+  env->GetByteArrayRegion(bytes, 0, result.size(),
+                          reinterpret_cast<jbyte*>(&result[0]));
+  return result;
+}
+
+// Returns null with a pending OutOfMemoryError if the array can't be
+// allocated.
+static jbyteArray ToByteArray(JNIEnv* env, absl::string_view str) {
+  jbyteArray result = env->NewByteArray(str.size());
+  if (result == nullptr) {
+    return nullptr;
+  }
+  env->SetByteArrayRegion(result, 0, str.size(),
+                          reinterpret_cast<const jbyte*>(str.data()));
+  return result;
+}
+
 static void ErrnoSocketException(JNIEnv* env) {
   char buf[128];
   char* outstr = strerror_r(errno, buf, sizeof(buf));
@@ -123,6 +159,85 @@ jobject GetSocketChannel(JNIEnv* env) {
   return sc;
 }
 
+jbyteArray FormatSql(JNIEnv* env, jclass clazz, jbyteArray sql) {
+  FormatSqlRequest request;
+  request.set_sql(ToString(env, sql));
+  FormatSqlResponse response;
+  const zetasql_base::Status status =
+      GetService()->service()->FormatSql(request, &response);
+  if (!status.ok()) {
+    IllegalArgumentException(env, status.message());
+    return nullptr;
+  }
+  return ToByteArray(env, response.sql());
+}
+
+jobjectArray ExtractTableNamesFromStatement(JNIEnv* env, jclass clazz,
+                                            jbyteArray sql) {
+  ExtractTableNamesFromStatementRequest request;
+  request.set_sql_statement(ToString(env, sql));
+  ExtractTableNamesFromStatementResponse response;
+  const zetasql_base::Status status =
+      GetService()->service()->ExtractTableNamesFromStatement(request,
+                                                              &response);
+  if (!status.ok()) {
+    IllegalArgumentException(env, status.message());
+    return nullptr;
+  }
+
+  jclass segment_class = env->FindClass("[B");
+  jclass name_class = env->FindClass("[[B");
+  if (segment_class == nullptr || name_class == nullptr) {
+    return nullptr;
+  }
+  jobjectArray names =
+      env->NewObjectArray(response.table_name_size(), name_class, nullptr);
+  if (names == nullptr) {
+    return nullptr;
+  }
+  for (int i = 0; i < response.table_name_size(); ++i) {
+    const auto& table_name = response.table_name(i);
+    jobjectArray segments = env->NewObjectArray(
+        table_name.table_name_segment_size(), segment_class, nullptr);
+    if (segments == nullptr) {
+      return nullptr;
+    }
+    for (int j = 0; j < table_name.table_name_segment_size(); ++j) {
+      jbyteArray segment = ToByteArray(env, table_name.table_name_segment(j));
+      if (segment == nullptr) {
+        return nullptr;
+      }
+      env->SetObjectArrayElement(segments, j, segment);
+      env->DeleteLocalRef(segment);
+    }
+    env->SetObjectArrayElement(names, i, segments);
+    env->DeleteLocalRef(segments);
+  }
+  return names;
+}
+
+jbyteArray Evaluate(JNIEnv* env, jclass clazz, jobject request, jint length) {
+  const void* data = env->GetDirectBufferAddress(request);
+  if (data == nullptr || length < 0 ||
+      length > env->GetDirectBufferCapacity(request)) {
+    IllegalArgumentException(env, "Expected a direct ByteBuffer");
+    return nullptr;
+  }
+  EvaluateRequest evaluate_request;
+  if (!evaluate_request.ParseFromArray(data, length)) {
+    IllegalArgumentException(env, "Failed to parse EvaluateRequest");
+    return nullptr;
+  }
+  EvaluateResponse response;
+  const zetasql_base::Status status =
+      GetService()->service()->Evaluate(evaluate_request, &response);
+  if (!status.ok()) {
+    IllegalArgumentException(env, status.message());
+    return nullptr;
+  }
+  return ToByteArray(env, response.SerializeAsString());
+}
+
 extern "C" JNIEXPORT jint JNICALL JNI_OnLoad_zetasql_local_service(JavaVM* vm,
                                                            void* reserved) {
   JNIEnv* env = nullptr;
@@ -158,6 +273,11 @@ extern "C" JNIEXPORT jint JNICALL JNI_OnLoad_zetasql_local_service(JavaVM* vm,
   static JNINativeMethod methods[] = {
       {(char*)"getSocketChannel", (char*)"()Ljava/nio/channels/SocketChannel;",
        (void*)GetSocketChannel},
+      {(char*)"nativeFormatSql", (char*)"([B)[B", (void*)FormatSql},
+      {(char*)"nativeExtractTableNamesFromStatement", (char*)"([B)[[[B",
+       (void*)ExtractTableNamesFromStatement},
+      {(char*)"nativeEvaluate", (char*)"(Ljava/nio/ByteBuffer;I)[B",
+       (void*)Evaluate},
   };
   if (env->RegisterNatives(clazz, methods,
                            sizeof(methods) / sizeof(JNINativeMethod)) !=
@@ -26,6 +26,24 @@ namespace local_service {
 // and connects the other end to the local_service gRPC server.
 jobject GetSocketChannel(JNIEnv* env);
 
+// The following functions call the service that the gRPC server runs
+// directly, without serializing the requests and responses to go through the
+// socket. Strings are passed as UTF-8 byte arrays. On errors they throw an
+// IllegalArgumentException with the error message and return null.
+
+// Formats the SQL in <sql> like the FormatSql RPC.
+jbyteArray FormatSql(JNIEnv* env, jclass clazz, jbyteArray sql);
+
+// Returns the table names of the statement in <sql> like the
+// ExtractTableNamesFromStatement RPC, as an array with the segments of each
+// table name.
+jobjectArray ExtractTableNamesFromStatement(JNIEnv* env, jclass clazz,
+                                            jbyteArray sql);
+
+// Evaluates the serialized EvaluateRequest in the first <length> bytes of the
+// direct ByteBuffer <request>, and returns the serialized EvaluateResponse.
+jbyteArray Evaluate(JNIEnv* env, jclass clazz, jobject request, jint length);
+
 }  // namespace local_service
 }  // namespace zetasql
 
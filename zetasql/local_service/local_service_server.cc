@@ -0,0 +1,61 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Runs ZetaSqlLocalService as a standalone gRPC server, e.g. as a sidecar
+// that many client processes share, using ZetaSqlLocalServiceAsyncServer.
+
+#include <grpcpp/security/server_credentials.h>
+#include <grpcpp/server.h>
+#include <grpcpp/server_builder.h>
+
+#include <memory>
+#include <string>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/local_service/local_service_async_grpc.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(std::string, address, "localhost:50051",
+          "The address to listen on, e.g. 'localhost:50051' or "
+          "'unix:/tmp/zetasql.sock'.");
+ABSL_FLAG(int, num_threads, 4, "The number of threads that run calls.");
+ABSL_FLAG(int, max_queued_calls, 1024,
+          "The maximum number of calls that wait for a thread. Calls beyond "
+          "that fail with RESOURCE_EXHAUSTED.");
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+
+  zetasql::local_service::ZetaSqlLocalServiceAsyncServer::Options options;
+  options.num_threads = absl::GetFlag(FLAGS_num_threads);
+  options.max_queued_calls = absl::GetFlag(FLAGS_max_queued_calls);
+  zetasql::local_service::ZetaSqlLocalServiceAsyncServer async_server(
+      options);
+
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(absl::GetFlag(FLAGS_address),
+                           grpc::InsecureServerCredentials());
+  async_server.RegisterWith(&builder);
+  std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+  if (server == nullptr) {
+    LOG(QFATAL) << "Failed to listen on " << absl::GetFlag(FLAGS_address);
+  }
+  async_server.Start(server.get());
+  server->Wait();
+  return 0;
+}
@@ -17,7 +17,9 @@
 #include "zetasql/local_service/local_service.h"
 
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
+#include <vector>
 
 #include "zetasql/base/logging.h"
 #include "zetasql/base/path.h"
@@ -84,11 +86,30 @@ class ZetaSqlLocalServiceImplTest : public ::testing::Test {
     return service_.Evaluate(request, response);
   }
 
+  zetasql_base::Status EvaluateBatch(const EvaluateBatchRequest& request,
+                             EvaluateBatchResponse* response) {
+    return service_.EvaluateBatch(request, response);
+  }
+
+  zetasql_base::Status ExecuteQuery(const ExecuteQueryRequest& request,
+                            std::vector<ExecuteQueryResponse>* responses) {
+    return service_.ExecuteQuery(
+        request, [responses](const ExecuteQueryResponse& response) {
+          responses->push_back(response);
+          return true;
+        });
+  }
+
   zetasql_base::Status Analyze(const AnalyzeRequest& request,
                        AnalyzeResponse* response) {
     return service_.Analyze(request, response);
   }
 
+  zetasql_base::Status AnalyzeBatch(const AnalyzeBatchRequest& request,
+                            AnalyzeBatchResponse* response) {
+    return service_.AnalyzeBatch(request, response);
+  }
+
   zetasql_base::Status BuildSql(const BuildSqlRequest& request,
                         BuildSqlResponse* response) {
     return service_.BuildSql(request, response);
@@ -111,6 +132,11 @@ class ZetaSqlLocalServiceImplTest : public ::testing::Test {
     return service_.FormatSql(request, response);
   }
 
+  zetasql_base::Status RegisterCatalog(const RegisterCatalogRequest& request,
+                               RegisterResponse* response) {
+    return service_.RegisterCatalog(request, response);
+  }
+
   zetasql_base::Status UnregisterCatalog(int64_t id) {
     return service_.UnregisterCatalog(id);
   }
@@ -119,6 +145,17 @@ class ZetaSqlLocalServiceImplTest : public ::testing::Test {
     return service_.UnregisterParseResumeLocation(id);
   }
 
+  zetasql_base::Status RegisterFileDescriptorSets(
+      const RegisterFileDescriptorSetsRequest& request,
+      RegisterFileDescriptorSetsResponse* response) {
+    return service_.RegisterFileDescriptorSets(request, response);
+  }
+
+  zetasql_base::Status UnregisterFileDescriptorSets(
+      const UnregisterFileDescriptorSetsRequest& request) {
+    return service_.UnregisterFileDescriptorSets(request);
+  }
+
   zetasql_base::Status AddSimpleTable(const AddSimpleTableRequest& request) {
     return service_.AddSimpleTable(request);
   }
@@ -366,6 +403,205 @@ TEST_F(ZetaSqlLocalServiceImplTest, EvaluatePrepared) {
   ZETASQL_ASSERT_OK(Unprepare(response.prepared_expression_id()));
 }
 
+TEST_F(ZetaSqlLocalServiceImplTest, EvaluateBatch) {
+  PrepareRequest request;
+  request.set_sql("@p * c");
+  auto* column = request.mutable_options()->add_expression_columns();
+  column->set_name("c");
+  column->mutable_type()->set_type_kind(TYPE_INT64);
+  auto* param = request.mutable_options()->add_query_parameters();
+  param->set_name("p");
+  param->mutable_type()->set_type_kind(TYPE_INT64);
+  PrepareResponse response;
+  ZETASQL_ASSERT_OK(Prepare(request, &response));
+
+  EvaluateBatchRequest batch_request;
+  batch_request.set_prepared_expression_id(response.prepared_expression_id());
+  for (int i = 1; i <= 3; ++i) {
+    EvaluateBatchRequest::Row* row = batch_request.add_rows();
+    auto* evaluate_column = row->add_columns();
+    evaluate_column->set_name("c");
+    evaluate_column->mutable_type()->set_type_kind(TYPE_INT64);
+    evaluate_column->mutable_value()->set_int64_value(i);
+    auto* evaluate_param = row->add_params();
+    evaluate_param->set_name("p");
+    evaluate_param->mutable_type()->set_type_kind(TYPE_INT64);
+    evaluate_param->mutable_value()->set_int64_value(10);
+  }
+
+  EvaluateBatchResponse batch_response;
+  ZETASQL_ASSERT_OK(EvaluateBatch(batch_request, &batch_response));
+  EXPECT_EQ(TYPE_INT64, batch_response.type().type_kind());
+  ASSERT_EQ(3, batch_response.value_size());
+  EXPECT_EQ(10, batch_response.value(0).int64_value());
+  EXPECT_EQ(20, batch_response.value(1).int64_value());
+  EXPECT_EQ(30, batch_response.value(2).int64_value());
+
+  // A row without the column fails the whole batch.
+  batch_request.mutable_rows(1)->clear_columns();
+  batch_response.Clear();
+  EXPECT_FALSE(EvaluateBatch(batch_request, &batch_response).ok());
+
+  ZETASQL_ASSERT_OK(Unprepare(response.prepared_expression_id()));
+  batch_request.clear_rows();
+  EXPECT_FALSE(EvaluateBatch(batch_request, &batch_response).ok());
+}
+
+TEST_F(ZetaSqlLocalServiceImplTest, ExecuteQuery) {
+  ExecuteQueryRequest request;
+  request.set_sql("SELECT a AS x FROM T");
+  SimpleTableProto* table = request.mutable_simple_catalog()->add_table();
+  table->set_name("T");
+  SimpleColumnProto* column = table->add_column();
+  column->set_name("a");
+  column->mutable_type()->set_type_kind(TYPE_INT64);
+  ExecuteQueryRequest::TableContent* content = request.add_table_content();
+  content->set_table_name("t");
+  for (int i = 1; i <= 3; ++i) {
+    content->add_row()->add_cell()->set_int64_value(i);
+  }
+  request.set_max_rows_per_response(2);
+
+  std::vector<ExecuteQueryResponse> responses;
+  ZETASQL_ASSERT_OK(ExecuteQuery(request, &responses));
+  ASSERT_EQ(2, responses.size());
+  ASSERT_EQ(1, responses[0].column_size());
+  EXPECT_EQ("x", responses[0].column(0).name());
+  EXPECT_EQ(TYPE_INT64, responses[0].column(0).type().type_kind());
+  EXPECT_EQ(0, responses[1].column_size());
+  ASSERT_EQ(2, responses[0].row_size());
+  ASSERT_EQ(1, responses[1].row_size());
+  EXPECT_EQ(1, responses[0].row(0).value(0).int64_value());
+  EXPECT_EQ(2, responses[0].row(1).value(0).int64_value());
+  EXPECT_EQ(3, responses[1].row(0).value(0).int64_value());
+
+  // An empty result still returns the columns.
+  request.clear_table_content();
+  request.add_table_content()->set_table_name("T");
+  responses.clear();
+  ZETASQL_ASSERT_OK(ExecuteQuery(request, &responses));
+  ASSERT_EQ(1, responses.size());
+  EXPECT_EQ(1, responses[0].column_size());
+  EXPECT_EQ(0, responses[0].row_size());
+
+  // Rows must have a value for each column.
+  request.mutable_table_content(0)->add_row();
+  EXPECT_FALSE(ExecuteQuery(request, &responses).ok());
+
+  // The client going away cancels the query.
+  request.mutable_table_content(0)->clear_row();
+  request.mutable_table_content(0)->add_row()->add_cell()->set_int64_value(1);
+  EXPECT_EQ(zetasql_base::StatusCode::kCancelled,
+            service_
+                .ExecuteQuery(request,
+                              [](const ExecuteQueryResponse&) { return false; })
+                .code());
+}
+
+// Evaluates prepared expressions from many threads while other expressions
+// are prepared and unprepared.
+TEST_F(ZetaSqlLocalServiceImplTest, ConcurrentEvaluate) {
+  constexpr int kNumExpressions = 8;
+  constexpr int kNumThreads = 16;
+  constexpr int kNumEvaluationsPerThread = 50;
+  std::vector<int64_t> ids;
+  for (int i = 0; i < kNumExpressions; ++i) {
+    PrepareRequest request;
+    request.set_sql(absl::StrCat(i, " + 1"));
+    PrepareResponse response;
+    ZETASQL_ASSERT_OK(Prepare(request, &response));
+    ids.push_back(response.prepared_expression_id());
+  }
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([this, t, &ids]() {
+      for (int i = 0; i < kNumEvaluationsPerThread; ++i) {
+        const int expression = (t + i) % kNumExpressions;
+        EvaluateRequest request;
+        request.set_prepared_expression_id(ids[expression]);
+        EvaluateResponse response;
+        ZETASQL_EXPECT_OK(Evaluate(request, &response));
+        EXPECT_EQ(expression + 1, response.value().int64_value());
+
+        PrepareRequest prepare_request;
+        prepare_request.set_sql("1");
+        PrepareResponse prepare_response;
+        ZETASQL_EXPECT_OK(Prepare(prepare_request, &prepare_response));
+        ZETASQL_EXPECT_OK(Unprepare(prepare_response.prepared_expression_id()));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(kNumExpressions, NumSavedPreparedExpression());
+}
+
+TEST_F(ZetaSqlLocalServiceImplTest, RegisteredFileDescriptorSets) {
+  TypeFactory factory;
+  const ProtoType* proto_type;
+  ZETASQL_ASSERT_OK(factory.MakeProtoType(zetasql_test::KitchenSinkPB::descriptor(),
+                                  &proto_type));
+  TypeProto type_proto;
+  google::protobuf::FileDescriptorSet descriptor_set;
+  ZETASQL_ASSERT_OK(proto_type->SerializeToProtoAndFileDescriptors(&type_proto,
+                                                           &descriptor_set));
+
+  // Registering the same descriptor set twice returns the same fingerprint.
+  RegisterFileDescriptorSetsRequest register_request;
+  *register_request.add_file_descriptor_set() = descriptor_set;
+  *register_request.add_file_descriptor_set() = descriptor_set;
+  RegisterFileDescriptorSetsResponse register_response;
+  ZETASQL_ASSERT_OK(
+      RegisterFileDescriptorSets(register_request, &register_response));
+  ASSERT_EQ(2, register_response.fingerprint_size());
+  EXPECT_EQ(register_response.fingerprint(0), register_response.fingerprint(1));
+  const int64_t fingerprint = register_response.fingerprint(0);
+
+  EvaluateRequest request;
+  auto* column = request.add_columns();
+  column->set_name("c");
+  *column->mutable_type() = type_proto;
+  zetasql_test::KitchenSinkPB pb;
+  pb.set_int64_key_1(2);
+  pb.set_int64_key_2(3);
+  ZETASQL_ASSERT_OK(values::Proto(proto_type, pb).Serialize(column->mutable_value()));
+  request.add_file_descriptor_set_fingerprint(fingerprint);
+  request.set_sql("c.int64_key_1");
+
+  EvaluateResponse response;
+  ZETASQL_ASSERT_OK(Evaluate(request, &response));
+  EXPECT_EQ(TYPE_INT64, response.type().type_kind());
+  EXPECT_EQ(2, response.value().int64_value());
+  ZETASQL_ASSERT_OK(Unprepare(response.prepared_expression_id()));
+
+  EvaluateRequest both_request = request;
+  *both_request.add_file_descriptor_set() = descriptor_set;
+  zetasql_base::Status status = Evaluate(both_request, &response);
+  ASSERT_FALSE(status.ok());
+  EXPECT_EQ(
+      "file_descriptor_set and file_descriptor_set_fingerprint cannot both be "
+      "set",
+      status.message());
+
+  // The descriptor set stays registered until it is unregistered as many
+  // times as it was registered.
+  UnregisterFileDescriptorSetsRequest unregister_request;
+  unregister_request.add_fingerprint(fingerprint);
+  ZETASQL_ASSERT_OK(UnregisterFileDescriptorSets(unregister_request));
+  ZETASQL_ASSERT_OK(Evaluate(request, &response));
+  ZETASQL_ASSERT_OK(Unprepare(response.prepared_expression_id()));
+  ZETASQL_ASSERT_OK(UnregisterFileDescriptorSets(unregister_request));
+
+  status = Evaluate(request, &response);
+  ASSERT_FALSE(status.ok());
+  EXPECT_EQ(absl::StrCat("Unknown file descriptor set fingerprint ",
+                         fingerprint),
+            status.message());
+  EXPECT_FALSE(UnregisterFileDescriptorSets(unregister_request).ok());
+}
+
 TEST_F(ZetaSqlLocalServiceImplTest, EvaluateWithWrongId) {
   EvaluateRequest evaluate_request;
   evaluate_request.set_prepared_expression_id(12345);
@@ -769,6 +1005,177 @@ TEST_F(ZetaSqlLocalServiceImplTest, Analyze) {
   EXPECT_EQ(40, response3.resume_byte_position());
 }
 
+TEST_F(ZetaSqlLocalServiceImplTest, AnalyzeWithRegisteredCatalog) {
+  TypeFactory factory;
+  const ProtoType* proto_type;
+  ZETASQL_ASSERT_OK(factory.MakeProtoType(zetasql_test::KitchenSinkPB::descriptor(),
+                                  &proto_type));
+  TypeProto type_proto;
+  google::protobuf::FileDescriptorSet descriptor_set;
+  ZETASQL_ASSERT_OK(proto_type->SerializeToProtoAndFileDescriptors(&type_proto,
+                                                           &descriptor_set));
+
+  RegisterCatalogRequest register_request;
+  SimpleCatalogProto* catalog = register_request.mutable_simple_catalog();
+  catalog->set_name("foo");
+  SimpleTableProto* table = catalog->add_table();
+  table->set_name("bar");
+  SimpleColumnProto* column = table->add_column();
+  column->set_name("baz");
+  *column->mutable_type() = type_proto;
+  *register_request.add_file_descriptor_set() = descriptor_set;
+  RegisterResponse register_response;
+  ZETASQL_ASSERT_OK(RegisterCatalog(register_request, &register_response));
+
+  // The second response reuses the types and proto files serialized for the
+  // first one, and must be the same.
+  AnalyzeRequest request;
+  request.set_registered_catalog_id(register_response.registered_id());
+  request.set_sql_statement("select baz, baz.nested_value from bar");
+  AnalyzeResponse response;
+  ZETASQL_ASSERT_OK(Analyze(request, &response));
+  AnalyzeResponse response2;
+  ZETASQL_ASSERT_OK(Analyze(request, &response2));
+  EXPECT_THAT(response2, EqualsProto(response));
+  EXPECT_EQ(2, response.resolved_statement()
+                   .resolved_query_stmt_node()
+                   .output_column_list_size());
+
+  ZETASQL_ASSERT_OK(UnregisterCatalog(register_response.registered_id()));
+}
+
+TEST_F(ZetaSqlLocalServiceImplTest, AnalyzeBatch) {
+  RegisterCatalogRequest register_request;
+  SimpleCatalogProto* catalog = register_request.mutable_simple_catalog();
+  catalog->set_name("foo");
+  SimpleTableProto* table = catalog->add_table();
+  table->set_name("bar");
+  SimpleColumnProto* column = table->add_column();
+  column->set_name("baz");
+  column->mutable_type()->set_type_kind(TYPE_INT64);
+  RegisterResponse register_response;
+  ZETASQL_ASSERT_OK(RegisterCatalog(register_request, &register_response));
+
+  const std::vector<std::string> statements = {
+      "select baz from bar", "select baz + 1 as x, 'a' as y from bar",
+      "select qux from bar", "select count(*) from bar group by baz"};
+  for (int max_parallelism : {0, 1, 3, 8}) {
+    AnalyzeBatchRequest request;
+    request.set_registered_catalog_id(register_response.registered_id());
+    for (const std::string& sql : statements) {
+      request.add_sql_statement(sql);
+    }
+    request.set_max_parallelism(max_parallelism);
+    AnalyzeBatchResponse response;
+    ZETASQL_ASSERT_OK(AnalyzeBatch(request, &response));
+    ASSERT_EQ(statements.size(), response.result_size());
+
+    // Each result is the same as that of a separate Analyze call.
+    for (int i = 0; i < statements.size(); ++i) {
+      AnalyzeRequest analyze_request;
+      analyze_request.set_registered_catalog_id(
+          register_response.registered_id());
+      analyze_request.set_sql_statement(statements[i]);
+      AnalyzeResponse analyze_response;
+      zetasql_base::Status status = Analyze(analyze_request, &analyze_response);
+      const AnalyzeBatchResponse::Result& result = response.result(i);
+      if (status.ok()) {
+        EXPECT_FALSE(result.has_error_message()) << result.error_message();
+        EXPECT_THAT(result.resolved_statement(),
+                    EqualsProto(analyze_response.resolved_statement()));
+      } else {
+        EXPECT_FALSE(result.has_resolved_statement());
+        EXPECT_EQ(status.error_message(), result.error_message());
+      }
+    }
+    EXPECT_TRUE(response.result(2).has_error_message());
+  }
+
+  AnalyzeBatchRequest unknown_catalog_request;
+  unknown_catalog_request.set_registered_catalog_id(-1);
+  unknown_catalog_request.add_sql_statement("select 1");
+  AnalyzeBatchResponse unknown_catalog_response;
+  EXPECT_FALSE(
+      AnalyzeBatch(unknown_catalog_request, &unknown_catalog_response).ok());
+
+  ZETASQL_ASSERT_OK(UnregisterCatalog(register_response.registered_id()));
+}
+
+TEST_F(ZetaSqlLocalServiceImplTest, RegisterCatalogWithBase) {
+  RegisterCatalogRequest base_request;
+  SimpleCatalogProto* catalog = base_request.mutable_simple_catalog();
+  catalog->set_name("foo");
+  for (const std::string& name : {"t1", "t2"}) {
+    SimpleTableProto* table = catalog->add_table();
+    table->set_name(name);
+    SimpleColumnProto* column = table->add_column();
+    column->set_name("a");
+    column->mutable_type()->set_type_kind(TYPE_INT64);
+  }
+  RegisterResponse base_response;
+  ZETASQL_ASSERT_OK(RegisterCatalog(base_request, &base_response));
+
+  // Replace t1 with a table with a string column, remove t2 and add t3.
+  RegisterCatalogRequest request;
+  request.set_base_registered_catalog_id(base_response.registered_id());
+  request.add_removed_table_name("T2");
+  for (const std::string& name : {"t1", "t3"}) {
+    SimpleTableProto* table = request.mutable_simple_catalog()->add_table();
+    table->set_name(name);
+    SimpleColumnProto* column = table->add_column();
+    column->set_name("b");
+    column->mutable_type()->set_type_kind(TYPE_STRING);
+  }
+  RegisterResponse response;
+  ZETASQL_ASSERT_OK(RegisterCatalog(request, &response));
+
+  AnalyzeRequest analyze_request;
+  analyze_request.set_registered_catalog_id(response.registered_id());
+  AnalyzeResponse analyze_response;
+  analyze_request.set_sql_statement("select b from t1 join t3 using (b)");
+  ZETASQL_EXPECT_OK(Analyze(analyze_request, &analyze_response));
+  analyze_request.set_sql_statement("select a from t2");
+  EXPECT_FALSE(Analyze(analyze_request, &analyze_response).ok());
+
+  // The base catalog is unchanged, and outlives the catalogs based on it.
+  ZETASQL_ASSERT_OK(UnregisterCatalog(base_response.registered_id()));
+  analyze_request.set_sql_statement("select b from t3");
+  ZETASQL_EXPECT_OK(Analyze(analyze_request, &analyze_response));
+
+  // A catalog can be the base of another one.
+  RegisterCatalogRequest second_request;
+  second_request.set_base_registered_catalog_id(response.registered_id());
+  second_request.add_removed_table_name("t3");
+  RegisterResponse second_response;
+  ZETASQL_ASSERT_OK(RegisterCatalog(second_request, &second_response));
+  analyze_request.set_registered_catalog_id(second_response.registered_id());
+  analyze_request.set_sql_statement("select b from t1");
+  ZETASQL_EXPECT_OK(Analyze(analyze_request, &analyze_response));
+  analyze_request.set_sql_statement("select b from t3");
+  EXPECT_FALSE(Analyze(analyze_request, &analyze_response).ok());
+
+  // Descriptor sets cannot be added to shared descriptor pools.
+  AddSimpleTableRequest add_request;
+  add_request.set_registered_catalog_id(response.registered_id());
+  add_request.mutable_table()->set_name("t4");
+  add_request.add_file_descriptor_set();
+  EXPECT_FALSE(AddSimpleTable(add_request).ok());
+
+  second_request.set_base_registered_catalog_id(12345);
+  zetasql_base::Status status = RegisterCatalog(second_request, &second_response);
+  EXPECT_EQ("Unknown catalog ID: 12345", status.message());
+  second_request.set_base_registered_catalog_id(response.registered_id());
+  second_request.set_removed_table_name(0, "no_such_table");
+  status = RegisterCatalog(second_request, &second_response);
+  EXPECT_EQ("Unknown table in base catalog: no_such_table", status.message());
+  second_request.clear_removed_table_name();
+  second_request.mutable_simple_catalog()->add_named_type()->set_name("x");
+  EXPECT_FALSE(RegisterCatalog(second_request, &second_response).ok());
+
+  ZETASQL_ASSERT_OK(UnregisterCatalog(response.registered_id()));
+  ZETASQL_ASSERT_OK(UnregisterCatalog(second_response.registered_id()));
+}
+
 TEST_F(ZetaSqlLocalServiceImplTest, AnalyzeExpression) {
   SimpleCatalogProto catalog;
 
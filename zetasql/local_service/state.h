@@ -18,6 +18,7 @@
 #define ZETASQL_LOCAL_SERVICE_STATE_H_
 
 #include <stddef.h>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <type_traits>
@@ -34,6 +35,9 @@ class GenericState;
 
 // Pool of saved states that can be shared by multiple statements.
 // The state class T must extend GenericState and must be thread safe.
+//
+// The states are spread over kNumShards maps by id, each with its own mutex,
+// so that concurrent lookups of different states rarely contend.
 template<class T>
 class SharedStatePool {
  public:
@@ -48,25 +52,28 @@ class SharedStatePool {
       return -1;
     }
 
-    absl::MutexLock lock(&mutex_);
-    int64_t id = next_id_++;
+    int64_t id = next_id_.fetch_add(1, std::memory_order_relaxed);
     if (!state->SetId(id)) {
       return -1;
     }
-    saved_states_[id].reset(state);
+    Shard& shard = GetShard(id);
+    absl::MutexLock lock(&shard.mutex);
+    shard.saved_states[id].reset(state);
     return id;
   }
 
   bool Has(int64_t id) const {
-    absl::MutexLock lock(&mutex_);
-    return zetasql_base::ContainsKey(saved_states_, id);
+    const Shard& shard = GetShard(id);
+    absl::MutexLock lock(&shard.mutex);
+    return zetasql_base::ContainsKey(shard.saved_states, id);
   }
 
   // Get a state object with given id, ownership is shared by the pool and all
   // threads that currently hold the state object.
   std::shared_ptr<T> Get(int64_t id) {
-    absl::MutexLock lock(&mutex_);
-    std::shared_ptr<T>* result = zetasql_base::FindOrNull(saved_states_, id);
+    Shard& shard = GetShard(id);
+    absl::MutexLock lock(&shard.mutex);
+    std::shared_ptr<T>* result = zetasql_base::FindOrNull(shard.saved_states, id);
     if (result == nullptr) {
       return nullptr;
     } else {
@@ -77,23 +84,47 @@ class SharedStatePool {
   // Removes a state object from the pool. The state will be deleted immediately
   // if not held by any other threads, or after all threads releasing it.
   bool Delete(int64_t id) {
-    absl::MutexLock lock(&mutex_);
-    if (!zetasql_base::ContainsKey(saved_states_, id)) {
-      return false;
+    std::shared_ptr<T> state;
+    {
+      Shard& shard = GetShard(id);
+      absl::MutexLock lock(&shard.mutex);
+      auto it = shard.saved_states.find(id);
+      if (it == shard.saved_states.end()) {
+        return false;
+      }
+      // Destroy the state outside of the lock.
+      state = std::move(it->second);
+      shard.saved_states.erase(it);
     }
-    saved_states_.erase(id);
     return true;
   }
 
   size_t NumSavedStates() {
-    absl::MutexLock lock(&mutex_);
-    return saved_states_.size();
+    size_t num_saved_states = 0;
+    for (Shard& shard : shards_) {
+      absl::MutexLock lock(&shard.mutex);
+      num_saved_states += shard.saved_states.size();
+    }
+    return num_saved_states;
   }
 
  private:
-  mutable absl::Mutex mutex_;
-  int64_t next_id_ ABSL_GUARDED_BY(mutex_);
-  std::map<int64_t, std::shared_ptr<T>> saved_states_ ABSL_GUARDED_BY(mutex_);
+  static constexpr int kNumShards = 16;
+
+  struct Shard {
+    mutable absl::Mutex mutex;
+    std::map<int64_t, std::shared_ptr<T>> saved_states ABSL_GUARDED_BY(mutex);
+  };
+
+  Shard& GetShard(int64_t id) {
+    return shards_[static_cast<uint64_t>(id) % kNumShards];
+  }
+  const Shard& GetShard(int64_t id) const {
+    return shards_[static_cast<uint64_t>(id) % kNumShards];
+  }
+
+  std::atomic<int64_t> next_id_;
+  Shard shards_[kNumShards];
 
   static_assert(
       std::is_base_of<GenericState, T>::value,
@@ -122,6 +122,7 @@ class BisonParser {
   template <typename T>
   T* CreateASTNode(const zetasql_bison_parser::location& bison_location) {
     T* result = new (zetasql_base::AllocateInArena, arena_) T;
+    result->set_children_arena(arena_);
     SetNodeLocation(bison_location, result);
     allocated_ast_nodes_->push_back(std::unique_ptr<ASTNode>(result));
     return result;
@@ -135,6 +136,7 @@ class BisonParser {
       const zetasql_bison_parser::location& bison_location,
       absl::Span<ASTNode* const> children) {
     T* result = new (zetasql_base::AllocateInArena, arena_) T;
+    result->set_children_arena(arena_);
     SetNodeLocation(bison_location, result);
     allocated_ast_nodes_->push_back(std::unique_ptr<ASTNode>(result));
     result->AddChildren(children);
@@ -150,6 +152,7 @@ class BisonParser {
       const zetasql_bison_parser::location& bison_location_end,
       absl::Span<ASTNode* const> children) {
     T* result = new (zetasql_base::AllocateInArena, arena_) T;
+    result->set_children_arena(arena_);
     SetNodeLocation(bison_location_start, bison_location_end, result);
     allocated_ast_nodes_->push_back(std::unique_ptr<ASTNode>(result));
     result->AddChildren(children);
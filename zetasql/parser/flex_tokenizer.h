@@ -17,7 +17,8 @@
 #ifndef ZETASQL_PARSER_FLEX_TOKENIZER_H_
 #define ZETASQL_PARSER_FLEX_TOKENIZER_H_
 
-#include <sstream>
+#include <algorithm>
+#include <cstring>
 #include <string>
 
 #include "zetasql/parser/position.hh"
@@ -55,13 +56,7 @@ class ZetaSqlFlexTokenizer final : public ZetaSqlFlexTokenizerBase {
         start_offset_(start_offset),
         input_size_(static_cast<int64_t>(input.size())),
         mode_(mode),
-        input_stream_(absl::StrCat(input, kEofSentinelInput)) {
-    // Seek the stringstream to the start_offset, and then instruct flex to read
-    // from the stream. (Flex has the ability to read multiple consecutive
-    // streams, but we only ever feed it one.)
-    input_stream_.seekg(start_offset, std::ios_base::beg);
-    switch_streams(&input_stream_ /* new_in */, nullptr /* new_out */);
-  }
+        remaining_input_(input.substr(start_offset)) {}
 
   ZetaSqlFlexTokenizer(const ZetaSqlFlexTokenizer&) = delete;
   ZetaSqlFlexTokenizer& operator=(const ZetaSqlFlexTokenizer&) = delete;
@@ -111,6 +106,24 @@ class ZetaSqlFlexTokenizer final : public ZetaSqlFlexTokenizerBase {
     override_error_ = MakeSqlError() << msg;
   }
 
+  // This is called by flex to fill its buffer. Copies the next chunk of the
+  // input directly, followed by kEofSentinelInput, instead of going through a
+  // std::istream. Returns 0 at the end of the input.
+  int LexerInput(char* buf, int max_size) override {
+    if (remaining_input_.empty()) {
+      const int sentinel_size = static_cast<int>(strlen(kEofSentinelInput));
+      if (sentinel_returned_ || max_size < sentinel_size) return 0;
+      sentinel_returned_ = true;
+      memcpy(buf, kEofSentinelInput, sentinel_size);
+      return sentinel_size;
+    }
+    const int size =
+        std::min(max_size, static_cast<int>(remaining_input_.size()));
+    memcpy(buf, remaining_input_.data(), size);
+    remaining_input_.remove_prefix(size);
+    return size;
+  }
+
   // EOF sentinel input. This is appended to the input and used as a sentinel in
   // the tokenizer. The reason for doing this is that some tokenizer rules
   // try to match trailing context of the form [^...] where "..." is a set of
@@ -150,11 +163,14 @@ class ZetaSqlFlexTokenizer final : public ZetaSqlFlexTokenizerBase {
   // determines the mode that we'll run in.
   const BisonParserMode mode_;
 
-  // Stream on the input. This is what is consumed by flex. It consists of the
-  // input (of size input_size_) plus a single byte \001 which is used as a
-  // sentinel value in the tokenizer (but only if it occurs at location
+  // The part of the input that has not been passed to flex yet. Flex reads the
+  // input starting at start_offset_ and then kEofSentinelInput, which is used
+  // as a sentinel value in the tokenizer (but only if it occurs at location
   // input_size_).
-  std::istringstream input_stream_;
+  absl::string_view remaining_input_;
+
+  // True once LexerInput() has returned kEofSentinelInput.
+  bool sentinel_returned_ = false;
 
   // The tokenizer may want to return an error directly. It does this by
   // returning EOF to the bison parser, which then may or may not spew out its
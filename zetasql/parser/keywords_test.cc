@@ -24,6 +24,7 @@
 #include "zetasql/base/path.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "re2/re2.h"
@@ -70,6 +71,39 @@ TEST(GetKeywordInfo, NonHit) {
   EXPECT_FALSE(info != nullptr);
 }
 
+TEST(GetKeywordInfo, AllKeywordsInAnyCase) {
+  for (const KeywordInfo& keyword_info : GetAllKeywords()) {
+    const std::string& keyword = keyword_info.keyword();
+    EXPECT_EQ(&keyword_info, GetKeywordInfo(keyword)) << keyword;
+    EXPECT_EQ(&keyword_info, GetKeywordInfo(absl::AsciiStrToLower(keyword)))
+        << keyword;
+    EXPECT_EQ(keyword_info.IsReserved(),
+              GetReservedKeywordInfo(keyword) != nullptr)
+        << keyword;
+
+    // Strings that differ from a keyword in one byte, or in length, only
+    // match if they are another keyword.
+    std::string changed = keyword;
+    changed.back() = '$';
+    for (const std::string& other :
+         {absl::StrCat(keyword, "X"), keyword.substr(1), changed}) {
+      const KeywordInfo* other_info = GetKeywordInfo(other);
+      if (other_info != nullptr) {
+        EXPECT_EQ(other, other_info->keyword()) << keyword;
+      }
+    }
+  }
+}
+
+TEST(GetKeywordInfo, OnlyAsciiLettersFoldCase) {
+  EXPECT_NE(nullptr, GetKeywordInfo("SeLeCt"));
+  EXPECT_NE(nullptr, GetKeywordInfo("assert_rows_modified"));
+  // DEL differs from '_' only in the ASCII case bit.
+  EXPECT_EQ(nullptr, GetKeywordInfo("assert\x7frows_modified"));
+  EXPECT_EQ(nullptr, GetKeywordInfo(""));
+  EXPECT_EQ(nullptr, GetKeywordInfo(std::string(100, 'a')));
+}
+
 // Returns a section of lines from file 'file_path' delimited by
 // BEGIN_<section_delimiter> and END_<section_delimiter>. The section
 // delimiters do not need to be on a line by themselves. The lines that contain
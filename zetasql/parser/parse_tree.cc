@@ -312,6 +312,14 @@ static const absl::flat_hash_map<ASTNodeKind, std::string>& GetNodeNamesMap() {
 
 ASTNode::~ASTNode() {}
 
+void ASTNode::set_children_arena(zetasql_base::UnsafeArena* arena) {
+  DCHECK(children_.empty());
+  // The allocator of an InlinedVector cannot be replaced by assignment, so
+  // construct the empty vector again with the new allocator.
+  children_.~ChildVector();
+  new (&children_) ChildVector(ChildAllocator<ASTNode*>(arena));
+}
+
 void ASTNode::AddChild(ASTNode* child) {
   DCHECK(child != nullptr);
   children_.push_back(child);
@@ -19,6 +19,7 @@
 
 #include <stddef.h>
 
+#include <memory>
 #include <ostream>
 #include <set>
 #include <stack>
@@ -119,6 +120,12 @@ class ASTNode : public zetasql_base::ArenaOnlyGladiator {
   void set_parent(ASTNode* parent) { parent_ = parent; }
   ASTNode* parent() const { return parent_; }
 
+  // Makes the children that do not fit inline in this node use storage from
+  // <arena>, typically the arena that the node itself was allocated in, so
+  // that a parse tree does not need heap allocations for its child lists.
+  // <arena> must outlive this node. Must be called before adding children.
+  void set_children_arena(zetasql_base::UnsafeArena* arena);
+
   // Adds all nodes in 'children' to the child list. Elements in 'children' are
   // allowed to be NULL, in which case they are ignored.
   void AddChildren(absl::Span<ASTNode* const> children);
@@ -478,8 +485,48 @@ class ASTNode : public zetasql_base::ArenaOnlyGladiator {
 
   ParseLocationRange parse_location_range_;
 
+  // Allocates from the arena passed to set_children_arena(), or from the heap
+  // if there is none. Arena storage is released with the arena, not here.
+  template <class T>
+  class ChildAllocator {
+   public:
+    using value_type = T;
+
+    ChildAllocator() {}
+    explicit ChildAllocator(zetasql_base::UnsafeArena* arena) : arena_(arena) {}
+    template <class U>
+    ChildAllocator(const ChildAllocator<U>& other)  // NOLINT
+        : arena_(other.arena()) {}
+
+    T* allocate(size_t n) {
+      if (arena_ == nullptr) return std::allocator<T>().allocate(n);
+      return static_cast<T*>(arena_->AllocAligned(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, size_t n) {
+      if (arena_ == nullptr) std::allocator<T>().deallocate(p, n);
+    }
+
+    zetasql_base::UnsafeArena* arena() const { return arena_; }
+
+    template <class U>
+    bool operator==(const ChildAllocator<U>& other) const {
+      return arena_ == other.arena();
+    }
+    template <class U>
+    bool operator!=(const ChildAllocator<U>& other) const {
+      return arena_ != other.arena();
+    }
+
+   private:
+    zetasql_base::UnsafeArena* arena_ = nullptr;
+  };
+  using ChildVector =
+      absl::InlinedVector<ASTNode*, 3, ChildAllocator<ASTNode*>>;
+
   // Many nodes have one to two children, so InlinedVector saves allocations.
-  absl::InlinedVector<ASTNode*, 4> children_;
+  // Three inline children keep the vector, including its allocator, as small
+  // as four were without one; longer lists come from the arena.
+  ChildVector children_;
 };
 
 // This is a fake ASTNode implementation that exists only for tests,
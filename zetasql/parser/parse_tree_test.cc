@@ -249,6 +249,170 @@ TEST(ParseTreeTest, NodeKindCategories_LiteralExpression) {
   EXPECT_FALSE(expr->IsTableExpression());
 }
 
+TEST(ParseTreeTest, ChildrenInArena) {
+  zetasql_base::UnsafeArena arena(/*block_size=*/1024);
+  FakeASTNode arena_parent;
+  arena_parent.set_children_arena(&arena);
+  FakeASTNode heap_parent;
+  std::vector<ASTNode*> children;
+  for (int i = 0; i < 10; ++i) {
+    children.push_back(new (zetasql_base::AllocateInArena, &arena) FakeASTNode);
+  }
+
+  // The first children are stored inline.
+  size_t bytes_allocated = arena.status().bytes_allocated();
+  arena_parent.AddChild(children[0]);
+  EXPECT_EQ(bytes_allocated, arena.status().bytes_allocated());
+  for (int i = 1; i < children.size(); ++i) {
+    arena_parent.AddChild(children[i]);
+  }
+  EXPECT_GT(arena.status().bytes_allocated(), bytes_allocated);
+
+  bytes_allocated = arena.status().bytes_allocated();
+  heap_parent.AddChildren(children);
+  EXPECT_EQ(bytes_allocated, arena.status().bytes_allocated());
+
+  ASSERT_EQ(children.size(), arena_parent.num_children());
+  ASSERT_EQ(children.size(), heap_parent.num_children());
+  for (int i = 0; i < children.size(); ++i) {
+    EXPECT_EQ(children[i], arena_parent.child(i));
+    EXPECT_EQ(children[i], heap_parent.child(i));
+  }
+  EXPECT_EQ(&heap_parent, children[0]->parent());
+}
+
+TEST(ParseTreeTest, ParserContext) {
+  ParserContext context(/*block_size=*/1024);
+  const zetasql_base::UnsafeArena* arena = nullptr;
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<ParserOutput> parser_output;
+    ZETASQL_ASSERT_OK(ParseStatement("SELECT a FROM t", context.GetParserOptions(),
+                             &parser_output));
+    parser_output.reset();
+    context.Reset();
+    // After the first parse has sized the arena, it is reused.
+    if (i > 0) {
+      EXPECT_EQ(arena, context.GetParserOptions().arena().get());
+    }
+    arena = context.GetParserOptions().arena().get();
+  }
+
+  // A statement that does not fit in one block makes the arena larger.
+  std::string sql = "SELECT a0";
+  for (int i = 1; i < 100; ++i) {
+    absl::StrAppend(&sql, ", a", i);
+  }
+  std::unique_ptr<ParserOutput> parser_output;
+  ZETASQL_ASSERT_OK(
+      ParseStatement(sql, context.GetParserOptions(), &parser_output));
+  parser_output.reset();
+  const size_t block_size = context.GetParserOptions().arena()->block_size();
+  context.Reset();
+  EXPECT_GT(context.GetParserOptions().arena()->block_size(), block_size);
+
+  // The arena is not reset while a ParserOutput still uses it.
+  ZETASQL_ASSERT_OK(
+      ParseStatement(sql, context.GetParserOptions(), &parser_output));
+  context.Reset();
+  EXPECT_NE(parser_output->arena().get(),
+            context.GetParserOptions().arena().get());
+  std::vector<const ASTNode*> identifiers;
+  parser_output->statement()->GetDescendantsWithKinds({AST_IDENTIFIER},
+                                                      &identifiers);
+  ASSERT_EQ(100, identifiers.size());
+  EXPECT_EQ("a99",
+            identifiers.back()->GetAsOrDie<ASTIdentifier>()->GetAsString());
+}
+
+TEST(ParseTreeTest, ParseScriptInParallel) {
+  const std::string sql =
+      "DECLARE x INT64 DEFAULT 1;\n"
+      "SELECT ';' FROM t; -- ;\n"
+      "BEGIN\n"
+      "  SELECT 1; /* ; */ SELECT 2;\n"
+      "  IF x > 1 THEN SELECT 3;\n"
+      "  ELSE SELECT CASE x WHEN 1 THEN 2 END; END IF;\n"
+      "END;\n"
+      "BEGIN TRANSACTION;\n"
+      "IF TRUE THEN BEGIN\n"
+      "  LOOP BREAK; END LOOP;\n"
+      "  WHILE x > 0 DO SET x = x - 1; END WHILE;\n"
+      "END; END IF;\n"
+      "COMMIT;\n"
+      "SELECT IF(x > 0, 1, 2) FROM t;\n"
+      "SELECT 4";
+  std::unique_ptr<ParserOutput> expected;
+  ZETASQL_ASSERT_OK(ParseScript(sql, ParserOptions(), ERROR_MESSAGE_WITH_PAYLOAD,
+                        &expected));
+  for (int num_threads : {1, 2, 3, 10}) {
+    std::unique_ptr<ParserOutput> parser_output;
+    ZETASQL_ASSERT_OK(ParseScriptInParallel(sql, ParserOptions(),
+                                    ERROR_MESSAGE_WITH_PAYLOAD, num_threads,
+                                    &parser_output));
+    EXPECT_EQ(expected->script()->DebugString(),
+              parser_output->script()->DebugString())
+        << num_threads;
+    EXPECT_EQ(8, parser_output->script()->statement_list().size());
+  }
+
+  // Errors are the same as for ParseScript().
+  const std::string invalid_sql = "SELECT 1; SELECT 2; SELECT FROM;";
+  const zetasql_base::Status expected_status =
+      ParseScript(invalid_sql, ParserOptions(), ERROR_MESSAGE_WITH_PAYLOAD,
+                  &expected);
+  EXPECT_FALSE(expected_status.ok());
+  std::unique_ptr<ParserOutput> parser_output;
+  EXPECT_EQ(expected_status,
+            ParseScriptInParallel(invalid_sql, ParserOptions(),
+                                  ERROR_MESSAGE_WITH_PAYLOAD,
+                                  /*num_threads=*/3, &parser_output));
+}
+
+TEST(ParseTreeTest, ParseScriptWithErrorRecovery) {
+  const std::string sql =
+      "SELECT 1;\n"
+      "SELECT FROM;\n"
+      "BEGIN SELECT 2; SELECT 3 +; END;\n"
+      "SELECT 4;\n"
+      "SELECT 5 5";
+  std::unique_ptr<ParserOutput> parser_output;
+  std::vector<zetasql_base::Status> errors;
+  ZETASQL_ASSERT_OK(ParseScriptWithErrorRecovery(sql, ParserOptions(),
+                                         ERROR_MESSAGE_WITH_PAYLOAD,
+                                         &parser_output, &errors));
+  const ASTScript* script = parser_output->script();
+  ASSERT_EQ(2, script->statement_list().size());
+  EXPECT_EQ(0, script->statement_list()[0]
+                   ->GetParseLocationRange()
+                   .start()
+                   .GetByteOffset());
+  EXPECT_EQ(sql.find("SELECT 4"), script->statement_list()[1]
+                                      ->GetParseLocationRange()
+                                      .start()
+                                      .GetByteOffset());
+  ASSERT_EQ(3, errors.size());
+  for (const zetasql_base::Status& error : errors) {
+    EXPECT_FALSE(error.ok());
+  }
+
+  // The first error is the same as for ParseScript().
+  std::unique_ptr<ParserOutput> expected;
+  EXPECT_EQ(ParseScript(sql, ParserOptions(), ERROR_MESSAGE_WITH_PAYLOAD,
+                        &expected),
+            errors[0]);
+
+  // Without errors, the output is the same as for ParseScript().
+  const std::string valid_sql = "SELECT 1; BEGIN SELECT 2; END; SELECT 3;";
+  ZETASQL_ASSERT_OK(ParseScriptWithErrorRecovery(valid_sql, ParserOptions(),
+                                         ERROR_MESSAGE_WITH_PAYLOAD,
+                                         &parser_output, &errors));
+  EXPECT_TRUE(errors.empty());
+  ZETASQL_ASSERT_OK(ParseScript(valid_sql, ParserOptions(),
+                        ERROR_MESSAGE_WITH_PAYLOAD, &expected));
+  EXPECT_EQ(expected->script()->statement_list().size(),
+            parser_output->script()->statement_list().size());
+}
+
 TEST(ParseTreeTest, GetDescendantsWithKinds) {
   const std::string sql =
       "select * from (select 1+0x2, x+y), "
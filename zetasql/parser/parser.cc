@@ -16,10 +16,15 @@
 
 #include "zetasql/parser/parser.h"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
 #include "zetasql/base/logging.h"
 #include "zetasql/common/errors.h"
+#include "zetasql/parser/bison_parser.bison.h"
 #include "zetasql/parser/bison_parser.h"
 #include "zetasql/parser/bison_parser_mode.h"
 #include "zetasql/parser/parse_tree.h"
@@ -31,6 +36,9 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/flags/flag.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/canonical_errors.h"
 #include "zetasql/base/ret_check.h"
@@ -42,8 +50,17 @@ namespace zetasql {
 using parser::BisonParserMode;
 using parser::BisonParser;
 
+// Sizes the default arenas after the memory used by the previous ones.
+static zetasql_base::ArenaBlockSizeHint* DefaultArenaBlockSizeHint() {
+  static zetasql_base::ArenaBlockSizeHint* hint =
+      new zetasql_base::ArenaBlockSizeHint(/*min_block_size=*/4096,
+                                   /*max_block_size=*/1 << 20);
+  return hint;
+}
+
 ParserOptions::ParserOptions()
-    : arena_(std::make_shared<zetasql_base::UnsafeArena>(/*block_size=*/4096)),
+    : arena_(std::make_shared<zetasql_base::UnsafeArena>(
+          DefaultArenaBlockSizeHint())),
       id_string_pool_(std::make_shared<IdStringPool>(arena_)) {}
 
 ParserOptions::ParserOptions(std::shared_ptr<IdStringPool> id_string_pool,
@@ -57,13 +74,40 @@ ParserOptions::~ParserOptions() {}
 
 void ParserOptions::CreateDefaultArenasIfNotSet() {
   if (arena_ == nullptr) {
-    arena_ = std::make_shared<zetasql_base::UnsafeArena>(/*block_size=*/4096);
+    arena_ = std::make_shared<zetasql_base::UnsafeArena>(
+        DefaultArenaBlockSizeHint());
   }
   if (id_string_pool_ == nullptr) {
     id_string_pool_ = std::make_shared<IdStringPool>(arena_);
   }
 }
 
+constexpr size_t ParserContext::kDefaultBlockSize;
+constexpr size_t ParserContext::kMaxBlockSize;
+
+ParserContext::ParserContext(size_t block_size)
+    : block_size_(block_size),
+      arena_(std::make_shared<zetasql_base::UnsafeArena>(block_size_)),
+      id_string_pool_(std::make_shared<IdStringPool>(arena_)) {}
+
+ParserContext::~ParserContext() {}
+
+void ParserContext::Reset() {
+  // The IdStringPool holds a reference to the arena.
+  const bool in_use =
+      id_string_pool_.use_count() > 1 || arena_.use_count() > 2;
+  const size_t bytes_allocated = arena_->status().bytes_allocated();
+  id_string_pool_.reset();
+  if (in_use || bytes_allocated > block_size_) {
+    block_size_ = std::min(std::max(block_size_, bytes_allocated),
+                           kMaxBlockSize);
+    arena_ = std::make_shared<zetasql_base::UnsafeArena>(block_size_);
+  } else {
+    arena_->Reset();
+  }
+  id_string_pool_ = std::make_shared<IdStringPool>(arena_);
+}
+
 ParserOutput::ParserOutput(
     std::shared_ptr<IdStringPool> id_string_pool,
     std::shared_ptr<zetasql_base::UnsafeArena> arena,
@@ -197,6 +241,275 @@ zetasql_base::Status ParseNextScriptStatement(ParseResumeLocation* resume_locati
                                     output, at_end_of_input);
 }
 
+namespace {
+
+// Returns the byte offsets just past the semicolons that end the top-level
+// statements of <script>, excluding a semicolon that is only followed by
+// whitespace and comments. Semicolons inside BEGIN...END, IF, LOOP and WHILE
+// blocks are skipped by tracking the keywords that open and close blocks at
+// the start of statements. Returns an empty vector if <script> cannot be
+// tokenized or has an unbalanced END.
+//
+// This does not need to recognize every block exactly: a split inside a block
+// makes the segments fail to parse, and a missed split only makes a segment
+// larger.
+std::vector<int> FindTopLevelStatementEnds(absl::string_view script) {
+  using Token = zetasql_bison_parser::BisonParserImpl::token;
+  parser::ZetaSqlFlexTokenizer tokenizer(BisonParserMode::kTokenizer,
+                                           /*filename=*/"", script,
+                                           /*start_offset=*/0);
+  std::vector<int> statement_ends;
+  ParseLocationRange location;
+  int depth = 0;
+  bool at_statement_start = true;
+  bool after_begin = false;
+  int pending_statement_end = -1;
+  while (true) {
+    int token;
+    if (!tokenizer.GetNextToken(&location, &token).ok()) return {};
+    if (token == 0 /* EOF */) break;
+    if (pending_statement_end >= 0) {
+      statement_ends.push_back(pending_statement_end);
+      pending_statement_end = -1;
+    }
+    bool starts_statement = at_statement_start;
+    at_statement_start = false;
+    if (after_begin) {
+      after_begin = false;
+      // BEGIN and BEGIN TRANSACTION are statements. Otherwise BEGIN starts a
+      // block, and this token starts the first statement in it.
+      if (token != Token::KW_TRANSACTION && token != ';') {
+        ++depth;
+        starts_statement = true;
+      }
+    }
+    switch (token) {
+      case ';':
+        if (depth == 0) {
+          pending_statement_end = location.start().GetByteOffset() + 1;
+        }
+        at_statement_start = true;
+        break;
+      case Token::KW_BEGIN:
+        after_begin = starts_statement;
+        break;
+      case Token::KW_IF:
+      case Token::KW_WHILE:
+        if (starts_statement) ++depth;
+        break;
+      case Token::KW_LOOP:
+        if (starts_statement) {
+          ++depth;
+          at_statement_start = true;
+        }
+        break;
+      case Token::KW_END:
+        if (starts_statement && --depth < 0) return {};
+        break;
+      case Token::KW_THEN:
+      case Token::KW_ELSE:
+      case Token::KW_DO:
+        at_statement_start = true;
+        break;
+      default:
+        break;
+    }
+  }
+  return statement_ends;
+}
+
+}  // namespace
+
+zetasql_base::Status ParseScriptInParallel(absl::string_view script_string,
+                                   const ParserOptions& parser_options_in,
+                                   ErrorMessageMode error_message_mode,
+                                   int num_threads,
+                                   std::unique_ptr<ParserOutput>* output) {
+  std::vector<int> segment_starts = {0};
+  if (num_threads > 1) {
+    const int target_segment_size = script_string.size() / num_threads;
+    for (int statement_end : FindTopLevelStatementEnds(script_string)) {
+      if (segment_starts.size() < num_threads &&
+          statement_end - segment_starts.back() >= target_segment_size) {
+        segment_starts.push_back(statement_end);
+      }
+    }
+  }
+  if (segment_starts.size() < 2) {
+    return ParseScript(script_string, parser_options_in, error_message_mode,
+                       output);
+  }
+
+  struct Segment {
+    int start_byte_offset;
+    int end_byte_offset;
+    ParserOptions parser_options;
+    std::unique_ptr<ASTNode> script;
+    std::vector<std::unique_ptr<ASTNode>> other_allocated_ast_nodes;
+    zetasql_base::Status status;
+  };
+  const int num_segments = segment_starts.size();
+  std::vector<Segment> segments(num_segments);
+  for (int i = 0; i < num_segments; ++i) {
+    Segment& segment = segments[i];
+    segment.start_byte_offset = segment_starts[i];
+    segment.end_byte_offset =
+        i + 1 < num_segments ? segment_starts[i + 1] : script_string.size();
+    segment.parser_options.set_language_options(
+        parser_options_in.language_options());
+  }
+
+  std::atomic<int> next_segment(0);
+  auto worker = [&]() {
+    while (true) {
+      const int i = next_segment.fetch_add(1, std::memory_order_relaxed);
+      if (i >= num_segments) return;
+      Segment& segment = segments[i];
+      // Parsing the script up to the end of the segment, starting at the
+      // start of the segment, gives locations relative to the whole script.
+      BisonParser parser;
+      segment.status = parser.Parse(
+          BisonParserMode::kScript, /*filename=*/absl::string_view(),
+          script_string.substr(0, segment.end_byte_offset),
+          segment.start_byte_offset,
+          segment.parser_options.id_string_pool().get(),
+          segment.parser_options.arena().get(),
+          segment.parser_options.language_options(), &segment.script,
+          &segment.other_allocated_ast_nodes,
+          /*ast_statement_properties=*/nullptr,
+          /*statement_end_byte_offset=*/nullptr);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_segments; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (const Segment& segment : segments) {
+    if (!segment.status.ok()) {
+      // Return the same error as parsing the whole script.
+      return ParseScript(script_string, parser_options_in, error_message_mode,
+                         output);
+    }
+    ZETASQL_RET_CHECK_EQ(segment.script->node_kind(), AST_SCRIPT);
+  }
+
+  ParserOptions parser_options = parser_options_in;
+  parser_options.CreateDefaultArenasIfNotSet();
+  zetasql_base::UnsafeArena* arena = parser_options.arena().get();
+  std::vector<std::unique_ptr<ASTNode>> other_allocated_ast_nodes;
+  ASTStatementList* statement_list =
+      new (zetasql_base::AllocateInArena, arena) ASTStatementList;
+  statement_list->set_children_arena(arena);
+  other_allocated_ast_nodes.emplace_back(statement_list);
+  for (const Segment& segment : segments) {
+    ASTNode* segment_statement_list = segment.script->mutable_child(0);
+    for (int i = 0; i < segment_statement_list->num_children(); ++i) {
+      statement_list->AddChild(segment_statement_list->mutable_child(i));
+    }
+  }
+  statement_list->set_start_location(segments.front()
+                                         .script->child(0)
+                                         ->GetParseLocationRange()
+                                         .start());
+  statement_list->set_end_location(
+      segments.back().script->child(0)->GetParseLocationRange().end());
+  statement_list->set_variable_declarations_allowed(true);
+
+  std::unique_ptr<ASTScript> script =
+      absl::WrapUnique(new (zetasql_base::AllocateInArena, arena) ASTScript);
+  script->set_children_arena(arena);
+  script->AddChild(statement_list);
+  script->set_start_location(
+      statement_list->GetParseLocationRange().start());
+  script->set_end_location(statement_list->GetParseLocationRange().end());
+  static_cast<ASTNode*>(statement_list)->InitFields();
+  static_cast<ASTNode*>(script.get())->InitFields();
+
+  *output = absl::make_unique<ParserOutput>(
+      parser_options.id_string_pool(), parser_options.arena(),
+      std::move(other_allocated_ast_nodes), std::move(script));
+  for (Segment& segment : segments) {
+    (*output)->AddReferencedOutput(absl::make_unique<ParserOutput>(
+        segment.parser_options.id_string_pool(),
+        segment.parser_options.arena(),
+        std::move(segment.other_allocated_ast_nodes),
+        absl::WrapUnique(
+            segment.script.release()->GetAsOrDie<ASTScript>())));
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status ParseScriptWithErrorRecovery(
+    absl::string_view script_string, const ParserOptions& parser_options_in,
+    ErrorMessageMode error_message_mode,
+    std::unique_ptr<ParserOutput>* output,
+    std::vector<zetasql_base::Status>* errors) {
+  errors->clear();
+  std::vector<int> statement_ends = FindTopLevelStatementEnds(script_string);
+  statement_ends.push_back(script_string.size());
+
+  ParserOptions parser_options = parser_options_in;
+  parser_options.CreateDefaultArenasIfNotSet();
+  zetasql_base::UnsafeArena* arena = parser_options.arena().get();
+  std::vector<std::unique_ptr<ASTNode>> other_allocated_ast_nodes;
+  ASTStatementList* statement_list =
+      new (zetasql_base::AllocateInArena, arena) ASTStatementList;
+  statement_list->set_children_arena(arena);
+
+  // Every segment is parsed once, into the same arena and IdStringPool, so
+  // failed segments cost no more than successful ones.
+  int segment_start = 0;
+  for (int segment_end : statement_ends) {
+    BisonParser parser;
+    std::unique_ptr<ASTNode> segment_script;
+    const zetasql_base::Status status = parser.Parse(
+        BisonParserMode::kScript, /*filename=*/absl::string_view(),
+        script_string.substr(0, segment_end), segment_start,
+        parser_options.id_string_pool().get(), arena,
+        parser_options.language_options(), &segment_script,
+        &other_allocated_ast_nodes, /*ast_statement_properties=*/nullptr,
+        /*statement_end_byte_offset=*/nullptr);
+    segment_start = segment_end;
+    if (!status.ok()) {
+      errors->push_back(ConvertInternalErrorLocationAndAdjustErrorString(
+          error_message_mode, script_string, status));
+      continue;
+    }
+    ZETASQL_RET_CHECK_EQ(segment_script->node_kind(), AST_SCRIPT);
+    ASTNode* segment_statement_list = segment_script->mutable_child(0);
+    for (int i = 0; i < segment_statement_list->num_children(); ++i) {
+      statement_list->AddChild(segment_statement_list->mutable_child(i));
+    }
+    other_allocated_ast_nodes.push_back(std::move(segment_script));
+  }
+  other_allocated_ast_nodes.emplace_back(statement_list);
+
+  statement_list->set_start_location(ParseLocationPoint::FromByteOffset(0));
+  statement_list->set_end_location(
+      ParseLocationPoint::FromByteOffset(script_string.size()));
+  statement_list->set_variable_declarations_allowed(true);
+
+  std::unique_ptr<ASTScript> script =
+      absl::WrapUnique(new (zetasql_base::AllocateInArena, arena) ASTScript);
+  script->set_children_arena(arena);
+  script->AddChild(statement_list);
+  script->set_start_location(
+      statement_list->GetParseLocationRange().start());
+  script->set_end_location(statement_list->GetParseLocationRange().end());
+  static_cast<ASTNode*>(statement_list)->InitFields();
+  static_cast<ASTNode*>(script.get())->InitFields();
+
+  *output = absl::make_unique<ParserOutput>(
+      parser_options.id_string_pool(), parser_options.arena(),
+      std::move(other_allocated_ast_nodes), std::move(script));
+  return zetasql_base::OkStatus();
+}
+
 zetasql_base::Status ParseNextStatement(ParseResumeLocation* resume_location,
                                 const ParserOptions& parser_options_in,
                                 std::unique_ptr<ParserOutput>* output,
@@ -290,6 +603,101 @@ zetasql_base::Status ParseExpression(const ParseResumeLocation& resume_location,
   return ::zetasql_base::OkStatus();
 }
 
+namespace {
+
+// Returns the offset of the first byte at or after <offset> in <input> that is
+// not ASCII whitespace or part of a comment, or -1 if there is an unterminated
+// comment or non-ASCII whitespace might follow. The tokenizer also allows
+// Unicode whitespace, which is left to it.
+int SkipWhitespaceAndComments(absl::string_view input, int offset) {
+  while (offset < input.size()) {
+    const char c = input[offset];
+    if (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\b' ||
+        c == '\f' || c == '\v') {
+      ++offset;
+    } else if (c == '#' ||
+               (c == '-' && offset + 1 < input.size() &&
+                input[offset + 1] == '-')) {
+      const size_t end_of_line = input.find_first_of("\r\n", offset);
+      if (end_of_line == absl::string_view::npos) return input.size();
+      offset = end_of_line + 1;
+    } else if (c == '/' && offset + 1 < input.size() &&
+               input[offset + 1] == '*') {
+      const size_t end_of_comment = input.find("*/", offset + 2);
+      if (end_of_comment == absl::string_view::npos) return -1;
+      offset = end_of_comment + 2;
+    } else if (static_cast<unsigned char>(c) >= 0x80) {
+      return -1;
+    } else {
+      break;
+    }
+  }
+  return offset;
+}
+
+}  // namespace
+
+bool ParseNextStatementKindFromFirstKeyword(
+    const ParseResumeLocation& resume_location, ASTNodeKind* node_kind) {
+  // Keywords that determine the statement kind on their own, regardless of
+  // what follows them. These match the rules that consist of a single keyword
+  // in next_statement_kind_without_hint in bison_parser.y. The query
+  // statement keywords come first since they are the most common.
+  static constexpr struct {
+    absl::string_view keyword;
+    ASTNodeKind node_kind;
+  } kKeywordStatementKinds[] = {
+      {"SELECT", AST_QUERY_STATEMENT},
+      {"WITH", AST_QUERY_STATEMENT},
+      {"INSERT", AST_INSERT_STATEMENT},
+      {"UPDATE", AST_UPDATE_STATEMENT},
+      {"DELETE", AST_DELETE_STATEMENT},
+      {"MERGE", AST_MERGE_STATEMENT},
+      {"EXPLAIN", AST_EXPLAIN_STATEMENT},
+      {"DESCRIBE", AST_DESCRIBE_STATEMENT},
+      {"DESC", AST_DESCRIBE_STATEMENT},
+      {"SHOW", AST_SHOW_STATEMENT},
+      {"GRANT", AST_GRANT_STATEMENT},
+      {"REVOKE", AST_REVOKE_STATEMENT},
+      {"RENAME", AST_RENAME_STATEMENT},
+      {"BEGIN", AST_BEGIN_STATEMENT},
+      {"COMMIT", AST_COMMIT_STATEMENT},
+      {"ROLLBACK", AST_ROLLBACK_STATEMENT},
+  };
+
+  const absl::string_view input = resume_location.input();
+  int offset = resume_location.byte_position();
+  if (offset < 0 || offset > input.size()) return false;
+  bool in_parentheses = false;
+  while (true) {
+    offset = SkipWhitespaceAndComments(input, offset);
+    if (offset < 0 || offset == input.size()) return false;
+    if (input[offset] != '(') break;
+    in_parentheses = true;
+    ++offset;
+  }
+
+  const int keyword_start = offset;
+  while (offset < input.size() &&
+         (absl::ascii_isalnum(input[offset]) || input[offset] == '_')) {
+    ++offset;
+  }
+  const absl::string_view keyword =
+      input.substr(keyword_start, offset - keyword_start);
+  for (const auto& keyword_statement_kind : kKeywordStatementKinds) {
+    if (absl::EqualsIgnoreCase(keyword, keyword_statement_kind.keyword)) {
+      // Only queries can be in parentheses.
+      if (in_parentheses &&
+          keyword_statement_kind.node_kind != AST_QUERY_STATEMENT) {
+        return false;
+      }
+      *node_kind = keyword_statement_kind.node_kind;
+      return true;
+    }
+  }
+  return false;
+}
+
 ASTNodeKind ParseStatementKind(absl::string_view input,
                                const LanguageOptions& language_options,
                                bool* statement_is_ctas) {
@@ -302,6 +710,12 @@ ASTNodeKind ParseNextStatementKind(const ParseResumeLocation& resume_location,
                                    bool* next_statement_is_ctas) {
   ZETASQL_DCHECK_OK(resume_location.Validate());
 
+  ASTNodeKind node_kind;
+  if (ParseNextStatementKindFromFirstKeyword(resume_location, &node_kind)) {
+    *next_statement_is_ctas = false;
+    return node_kind;
+  }
+
   parser::BisonParser parser;
   IdStringPool id_string_pool;
   zetasql_base::UnsafeArena arena(/*block_size=*/1024);
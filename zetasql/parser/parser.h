@@ -100,6 +100,57 @@ class ParserOptions {
   const LanguageOptions* language_options_ = nullptr;
 };
 
+// ParserContext owns an arena and an IdStringPool that are reused across
+// parses, so that parsing many short statements does not allocate a new arena
+// and IdStringPool for each of them. Typical usage is one ParserContext per
+// thread:
+//
+//   ParserContext context;
+//   for (...) {
+//     std::unique_ptr<ParserOutput> parser_output;
+//     ZETASQL_RETURN_IF_ERROR(ParseStatement(
+//         sql, context.GetParserOptions(&language_options), &parser_output));
+//     ...
+//     parser_output.reset();
+//     context.Reset();
+//   }
+//
+// This class is not thread-safe.
+class ParserContext {
+ public:
+  explicit ParserContext(size_t block_size = kDefaultBlockSize);
+  ParserContext(const ParserContext&) = delete;
+  ParserContext& operator=(const ParserContext&) = delete;
+  ~ParserContext();
+
+  // Returns ParserOptions that allocate in this context's arena and
+  // IdStringPool.
+  ParserOptions GetParserOptions(
+      const LanguageOptions* language_options = nullptr) const {
+    return ParserOptions(id_string_pool_, arena_, language_options);
+  }
+
+  // Frees everything that was allocated since the last Reset(), and
+  // invalidates all the IdStrings in the IdStringPool. The memory of the
+  // arena's first block is kept for the next parse. If the last parse needed
+  // more than one block, the arena is replaced by one with a larger first
+  // block, up to kMaxBlockSize, so that the next parse of a similar statement
+  // needs only one block.
+  //
+  // If a ParserOutput or another object still holds a reference to the arena
+  // or the IdStringPool, they are left alone for that object and this context
+  // starts using a new arena and IdStringPool instead.
+  void Reset();
+
+  static constexpr size_t kDefaultBlockSize = 4096;
+  static constexpr size_t kMaxBlockSize = 1 << 20;
+
+ private:
+  size_t block_size_;
+  std::shared_ptr<zetasql_base::UnsafeArena> arena_;
+  std::shared_ptr<IdStringPool> id_string_pool_;
+};
+
 // Output of a parse operation. The output parse tree can be accessed via
 // statement(), expression(), or type(), depending on the parse function that
 // was called.
@@ -133,6 +184,12 @@ class ParserOutput {
   // ParserOptions.
   const std::shared_ptr<zetasql_base::UnsafeArena>& arena() const { return arena_; }
 
+  // Makes this ParserOutput keep <other> alive, because the parse tree of this
+  // output contains nodes that were parsed into <other>.
+  void AddReferencedOutput(std::unique_ptr<ParserOutput> other) {
+    referenced_outputs_.push_back(std::move(other));
+  }
+
  private:
   template<class T>
       T* GetNodeAs() const {
@@ -145,6 +202,10 @@ class ParserOutput {
   std::shared_ptr<IdStringPool> id_string_pool_;
   std::shared_ptr<zetasql_base::UnsafeArena> arena_;
 
+  // Outputs that own some of the nodes of the parse tree below, with their
+  // arenas. Also must not go after the ASTNodes below.
+  std::vector<std::unique_ptr<ParserOutput>> referenced_outputs_;
+
   // This vector owns the non-root nodes in the AST.
   std::vector<std::unique_ptr<ASTNode>> other_allocated_ast_nodes_;
 
@@ -179,6 +240,43 @@ zetasql_base::Status ParseScript(absl::string_view script_string,
                          ErrorMessageMode error_message_mode,
                          std::unique_ptr<ParserOutput>* output);
 
+// Same as ParseScript(), but parses large scripts on up to <num_threads>
+// threads. The script is first tokenized to find the semicolons that end
+// top-level statements, i.e. that are not inside BEGIN...END, IF, LOOP or
+// WHILE blocks. The script is then split at those semicolons into one segment
+// per thread, and the segments are parsed concurrently, each into its own
+// arena and IdStringPool. Their statements are combined into one ASTScript
+// whose parse locations are offsets into the whole <script_string>, as with
+// ParseScript(). The result can be passed to ParsedScript::Create().
+//
+// The output is the same as the output of ParseScript(). If any segment fails
+// to parse, the whole script is parsed again with ParseScript() to return the
+// same error. The arena and IdStringPool of <parser_options_in> are only used
+// for the ASTScript and ASTStatementList nodes at the root.
+zetasql_base::Status ParseScriptInParallel(absl::string_view script_string,
+                                   const ParserOptions& parser_options_in,
+                                   ErrorMessageMode error_message_mode,
+                                   int num_threads,
+                                   std::unique_ptr<ParserOutput>* output);
+
+// Same as ParseScript(), but recovers from syntax errors in top-level
+// statements instead of failing, e.g. for linting large scripts. The script is
+// split into top-level statements as in ParseScriptInParallel(), and every
+// statement is parsed once, so the time is linear in the size of the script.
+// A statement that fails to parse is skipped, and its error is appended to
+// <*errors>, with error locations that are offsets into <script_string>.
+//
+// <output> gets an ASTScript with the statements that parsed, which can be
+// passed to ParsedScript::Create(). It covers the whole <script_string>. A
+// syntax error inside a block skips the whole top-level block, and a script
+// that cannot be tokenized or has an unbalanced END is treated as a single
+// statement. Returns an error only for internal errors.
+zetasql_base::Status ParseScriptWithErrorRecovery(
+    absl::string_view script_string, const ParserOptions& parser_options_in,
+    ErrorMessageMode error_message_mode,
+    std::unique_ptr<ParserOutput>* output,
+    std::vector<zetasql_base::Status>* errors);
+
 // Parses one statement from a string that may contain multiple statements.
 // This can be called in a loop with the same <resume_location> to parse
 // all statements from a string.
@@ -262,6 +360,20 @@ ASTNodeKind ParseNextStatementKind(const ParseResumeLocation& resume_location,
                                    const LanguageOptions& language_options,
                                    bool* next_statement_is_ctas);
 
+// Determines the kind of the next statement starting from <resume_location>
+// by looking only at its first keyword (ignoring whitespace, comments and
+// leading parentheses). This only succeeds for statements whose kind is
+// determined by their first keyword alone, e.g. SELECT, WITH, INSERT, UPDATE,
+// DELETE and MERGE statements, and that have no statement level hints. It does
+// not run the parser or allocate memory, so it is much cheaper than
+// ParseNextStatementKind(), which calls it first.
+//
+// Returns true and sets <*node_kind> on success. Returns false if the
+// statement kind depends on more of the input, in which case the caller must
+// use ParseNextStatementKind() or ParseNextStatementProperties().
+bool ParseNextStatementKindFromFirstKeyword(
+    const ParseResumeLocation& resume_location, ASTNodeKind* node_kind);
+
 // Parse the first few keywords from <resume_location> (ignoring whitespace
 // and comments), to determine basic statement properties.
 //
@@ -0,0 +1,96 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/parser/parser_output_cache.h"
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/options.pb.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+ParserOutputCache::ParserOutputCache(int max_entries)
+    : max_entries_(max_entries) {}
+
+zetasql_base::Status ParserOutputCache::ParseStatement(
+    absl::string_view sql, const LanguageOptions& language_options,
+    std::shared_ptr<const ParserOutput>* output) {
+  output->reset();
+  LanguageOptionsProto language_options_proto;
+  language_options.Serialize(&language_options_proto);
+  Key key(std::string(sql), language_options_proto.SerializeAsString());
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      *output = it->second->output;
+      ++stats_.hits;
+      return zetasql_base::OkStatus();
+    }
+    ++stats_.misses;
+  }
+
+  // Parse without holding the lock, so that a slow parse does not block
+  // lookups of other statements. The default arenas are not shared with
+  // anyone.
+  std::unique_ptr<ParserOutput> parser_output;
+  ZETASQL_RETURN_IF_ERROR(zetasql::ParseStatement(
+      sql, ParserOptions(/*id_string_pool=*/nullptr, /*arena=*/nullptr,
+                         &language_options),
+      &parser_output));
+  *output = std::move(parser_output);
+  if (max_entries_ <= 0) return zetasql_base::OkStatus();
+
+  absl::MutexLock lock(&mutex_);
+  auto inserted = entries_.emplace(std::move(key), lru_.end());
+  if (!inserted.second) {
+    // Another thread parsed the same statement concurrently. Keep its output,
+    // so that all callers share one.
+    lru_.splice(lru_.begin(), lru_, inserted.first->second);
+    *output = inserted.first->second->output;
+    return zetasql_base::OkStatus();
+  }
+  lru_.push_front(Entry{&inserted.first->first, *output});
+  inserted.first->second = lru_.begin();
+  ++stats_.num_entries;
+  EvictLocked();
+  return zetasql_base::OkStatus();
+}
+
+ParserOutputCache::Stats ParserOutputCache::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void ParserOutputCache::Clear() {
+  absl::MutexLock lock(&mutex_);
+  entries_.clear();
+  lru_.clear();
+  stats_.num_entries = 0;
+}
+
+void ParserOutputCache::EvictLocked() {
+  while (stats_.num_entries > max_entries_) {
+    DCHECK(!lru_.empty());
+    --stats_.num_entries;
+    ++stats_.evictions;
+    entries_.erase(entries_.find(*lru_.back().key));
+    lru_.pop_back();
+  }
+}
+
+}  // namespace zetasql
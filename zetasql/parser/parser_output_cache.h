@@ -0,0 +1,100 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PARSER_PARSER_OUTPUT_CACHE_H_
+#define ZETASQL_PARSER_PARSER_OUTPUT_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <cstdint>
+#include "zetasql/parser/parser.h"
+#include "zetasql/public/language_options.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+// A bounded, thread-safe cache of ParserOutputs for statements, for tools
+// that each parse the same SQL again, e.g. a linter, a formatter,
+// ExtractTableNamesFromStatement() and AnalyzeStatement() run on the same
+// text. The cached outputs are shared and must not be modified; they stay
+// valid as long as a caller holds a reference, even after being evicted.
+//
+// Statements are looked up by their exact text and the LanguageOptions they
+// are parsed with. Errors are not cached.
+//
+// AnalyzerOptions::set_parser_output_cache() makes the analyzer and
+// ExtractTableNamesFromStatement() consult a cache; IsValidStatementSyntax()
+// takes one as an argument.
+//
+// Entries are evicted in least recently used order once the cache holds more
+// than 'max_entries' entries.
+class ParserOutputCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+    int64_t num_entries = 0;
+  };
+
+  explicit ParserOutputCache(int max_entries);
+  ParserOutputCache(const ParserOutputCache&) = delete;
+  ParserOutputCache& operator=(const ParserOutputCache&) = delete;
+
+  // Like zetasql::ParseStatement(), but returns a cached output if possible.
+  // The output has its own arena and IdStringPool, which are not shared with
+  // the caller.
+  zetasql_base::Status ParseStatement(absl::string_view sql,
+                              const LanguageOptions& language_options,
+                              std::shared_ptr<const ParserOutput>* output);
+
+  Stats GetStats() const;
+
+  // Removes all entries. Does not reset the hit/miss/eviction counters.
+  void Clear();
+
+ private:
+  // The SQL text and the serialized LanguageOptions.
+  using Key = std::pair<std::string, std::string>;
+
+  struct Entry {
+    const Key* key;  // Owned by 'entries_', which has stable keys.
+    std::shared_ptr<const ParserOutput> output;
+  };
+  // The list front is the most recently used entry.
+  using LruList = std::list<Entry>;
+
+  // Evicts least recently used entries until the limit is respected.
+  void EvictLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int max_entries_;
+
+  mutable absl::Mutex mutex_;
+  LruList lru_ ABSL_GUARDED_BY(mutex_);
+  absl::node_hash_map<Key, LruList::iterator> entries_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PARSER_PARSER_OUTPUT_CACHE_H_
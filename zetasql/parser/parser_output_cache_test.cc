@@ -0,0 +1,73 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/parser/parser_output_cache.h"
+
+#include <memory>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/parser/parse_tree.h"
+#include "zetasql/parser/parser.h"
+#include "zetasql/public/language_options.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+TEST(ParserOutputCacheTest, SharesOutputs) {
+  ParserOutputCache cache(/*max_entries=*/2);
+  LanguageOptions language_options;
+  std::shared_ptr<const ParserOutput> first;
+  ZETASQL_ASSERT_OK(cache.ParseStatement("SELECT 1", language_options, &first));
+  std::shared_ptr<const ParserOutput> second;
+  ZETASQL_ASSERT_OK(cache.ParseStatement("SELECT 1", language_options, &second));
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(AST_QUERY_STATEMENT, first->statement()->node_kind());
+
+  // Other text or LanguageOptions are separate entries.
+  ZETASQL_ASSERT_OK(cache.ParseStatement("SELECT  1", language_options, &second));
+  EXPECT_NE(first, second);
+  LanguageOptions other_language_options;
+  other_language_options.EnableMaximumLanguageFeatures();
+  ZETASQL_ASSERT_OK(
+      cache.ParseStatement("SELECT 1", other_language_options, &second));
+  EXPECT_NE(first, second);
+
+  ParserOutputCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(1, stats.evictions);
+  EXPECT_EQ(2, stats.num_entries);
+
+  // An evicted output stays valid while it is referenced.
+  EXPECT_EQ(AST_QUERY_STATEMENT, first->statement()->node_kind());
+  ZETASQL_ASSERT_OK(cache.ParseStatement("SELECT 1", language_options, &second));
+  EXPECT_NE(first, second);
+
+  // Errors are not cached.
+  EXPECT_FALSE(cache.ParseStatement("SELECT (", language_options, &second).ok());
+  EXPECT_EQ(nullptr, second);
+  EXPECT_FALSE(cache.ParseStatement("SELECT (", language_options, &second).ok());
+  stats = cache.GetStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(6, stats.misses);
+
+  cache.Clear();
+  EXPECT_EQ(0, cache.GetStats().num_entries);
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -17,7 +17,6 @@
 #include "zetasql/parser/unparser.h"
 
 #include <ctype.h>
-#include <set>
 #include <utility>
 
 #include "zetasql/parser/ast_node_kind.h"
@@ -26,12 +25,19 @@
 #include "zetasql/public/strings.h"
 #include "zetasql/public/type.h"
 #include "absl/strings/str_cat.h"
-#include "zetasql/base/map_util.h"
 
 namespace zetasql {
 
 std::string Unparse(const ASTNode* node) {
   std::string unparsed_;
+  // The output is usually about as long as the input it was parsed from, so
+  // reserve that much to avoid reallocating a large output repeatedly.
+  const ParseLocationRange& location = node->GetParseLocationRange();
+  const int input_length =
+      location.end().GetByteOffset() - location.start().GetByteOffset();
+  if (input_length > 0) {
+    unparsed_.reserve(input_length + input_length / 4);
+  }
   parser::Unparser unparser(&unparsed_);
   node->Accept(&unparser, nullptr);
   unparser.FlushLine();
@@ -46,7 +52,7 @@ static const int kDefaultNumIndentSpaces = 2;
 static const int kNumColumnLimit = 100;
 
 void Formatter::Indent() {
-  absl::StrAppend(&indentation_, std::string(kDefaultNumIndentSpaces, ' '));
+  indentation_.append(kDefaultNumIndentSpaces, ' ');
 }
 
 void Formatter::Dedent() {
@@ -120,31 +126,45 @@ void Formatter::FormatLine(absl::string_view s) {
 }
 
 bool Formatter::LastTokenIsSeparator() {
-  // These are keywords emitted in uppercase in Unparser, so don't need to make
-  // them case insensitive.
-  static const std::set<std::string> kWordSperarator = {"AND", "OR", "ON",
-                                                        "IN"};
-  static const std::set<char> kNonWordSperarator = {
-      ',', '<', '>', '-', '+', '=', '*', '/', '%' };
   if (buffer_.empty()) return false;
   // When last token is not a word.
   if (!isalnum(buffer_.back())) {
-    return zetasql_base::ContainsKey(kNonWordSperarator, buffer_.back());
+    switch (buffer_.back()) {
+      case ',':
+      case '<':
+      case '>':
+      case '-':
+      case '+':
+      case '=':
+      case '*':
+      case '/':
+      case '%':
+        return true;
+      default:
+        return false;
+    }
   }
 
-  int last_token_index = buffer_.size() - 1;
-  while (last_token_index >= 0 && isalnum(buffer_[last_token_index])) {
-    --last_token_index;
+  // These are keywords emitted in uppercase in Unparser, so don't need to make
+  // them case insensitive. None of them is longer than 3 characters, so we
+  // only need to look at the last 4 characters to tell.
+  int length = 0;
+  while (length < 4 && length < buffer_.size() &&
+         isalnum(buffer_[buffer_.size() - 1 - length])) {
+    ++length;
   }
-  std::string last_token = buffer_.substr(last_token_index + 1);
-  return zetasql_base::ContainsKey(kWordSperarator, last_token);
+  const absl::string_view last_token =
+      absl::string_view(buffer_).substr(buffer_.size() - length);
+  return last_token == "AND" || last_token == "OR" || last_token == "ON" ||
+         last_token == "IN";
 }
 
 void Formatter::FlushLine() {
   if ((unparsed_->empty() || unparsed_->back() == '\n') && buffer_.empty()) {
     return;
   }
-  absl::StrAppend(unparsed_, buffer_, "\n");
+  unparsed_->append(buffer_);
+  unparsed_->push_back('\n');
   buffer_.clear();
 }
 
@@ -190,7 +210,7 @@ void Unparser::UnparseLeafNode(const ASTLeaf* leaf_node) {
 }
 
 void Unparser::UnparseChildrenWithSeparator(const ASTNode* node, void* data,
-                                            const std::string& separator,
+                                            absl::string_view separator,
                                             bool break_line) {
   UnparseChildrenWithSeparator(node, data, 0, node->num_children(), separator,
                                break_line);
@@ -200,7 +220,7 @@ void Unparser::UnparseChildrenWithSeparator(const ASTNode* node, void* data,
 // putting <separator> between them.
 void Unparser::UnparseChildrenWithSeparator(const ASTNode* node, void* data,
                                             int begin, int end,
-                                            const std::string& separator,
+                                            absl::string_view separator,
                                             bool break_line) {
   for (int i = begin; i < end; i++) {
     if (i > begin) {
@@ -373,7 +393,7 @@ void Unparser::visitASTTVFSchemaColumn(const ASTTVFSchemaColumn* node,
 }
 
 static std::string GetCreateStatementPrefix(
-    const ASTCreateStatement* node, const std::string& create_object_type) {
+    const ASTCreateStatement* node, absl::string_view create_object_type) {
   std::string output("CREATE");
   if (node->is_or_replace()) absl::StrAppend(&output, " OR REPLACE");
   if (node->is_private()) absl::StrAppend(&output, " PRIVATE");
@@ -404,9 +424,8 @@ void Unparser::visitASTCreateDatabaseStatement(
 
 void Unparser::visitASTCreateFunctionStatement(
     const ASTCreateFunctionStatement* node, void* data) {
-  const std::string create_object_type =
-      absl::StrCat((node->is_aggregate() ? "AGGREGATE " : ""), "FUNCTION");
-  print(GetCreateStatementPrefix(node, create_object_type));
+  print(GetCreateStatementPrefix(
+      node, node->is_aggregate() ? "AGGREGATE FUNCTION" : "FUNCTION"));
   node->function_declaration()->Accept(this, data);
   println();
   if (node->return_type() != nullptr) {
@@ -1580,7 +1599,7 @@ void Unparser::visitASTBitwiseShiftExpression(
 void Unparser::visitASTInExpression(const ASTInExpression* node, void* data) {
   PrintOpenParenIfNeeded(node);
   node->lhs()->Accept(this, data);
-  print(absl::StrCat(node->is_not() ? "NOT " : "", "IN"));
+  print(node->is_not() ? "NOT IN" : "IN");
   if (node->hint() != nullptr) {
     node->hint()->Accept(this, data);
   }
@@ -1614,7 +1633,7 @@ void Unparser::visitASTBetweenExpression(const ASTBetweenExpression* node,
                                          void* data) {
   PrintOpenParenIfNeeded(node);
   node->child(0)->Accept(this, data);
-  print(absl::StrCat(node->is_not() ? "NOT " : "", "BETWEEN"));
+  print(node->is_not() ? "NOT BETWEEN" : "BETWEEN");
   UnparseChildrenWithSeparator(node, data, 1, node->num_children(), "AND");
   PrintCloseParenIfNeeded(node);
 }
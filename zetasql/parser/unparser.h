@@ -54,6 +54,7 @@ class Formatter {
     Formatter* formatter_;
   };
 
+  // Appends to <unparsed>, which may already contain output.
   explicit Formatter(std::string* unparsed) : unparsed_(unparsed) {}
   Formatter(const Formatter&) = delete;
   Formatter& operator=(const Formatter&) = delete;
@@ -99,7 +100,7 @@ class Formatter {
 
   // The length of indentation at the beginning of buffer_. We have to save it
   // in a variable since indentation_ is dynamically changing.
-  int indentation_length_in_buffer_;
+  int indentation_length_in_buffer_ = 0;
 
   // Unparsed result, not owned.
   std::string* unparsed_;
@@ -127,7 +128,7 @@ class Unparser : public ParseTreeVisitor {
   // Shorthand for calling methods in formatter_.
   void print(absl::string_view s) { formatter_.Format(s); }
 
-  void println(const std::string& s = "") { formatter_.FormatLine(s); }
+  void println(absl::string_view s = "") { formatter_.FormatLine(s); }
 
   void FlushLine() {
     formatter_.FlushLine();
@@ -545,17 +546,17 @@ class Unparser : public ParseTreeVisitor {
  protected:
   // Set break_line to true if you want to print each child on a separate line.
   virtual void UnparseChildrenWithSeparator(const ASTNode* node, void* data,
-                                            const std::string& separator,
+                                            absl::string_view separator,
                                             bool break_line = false);
   virtual void UnparseChildrenWithSeparator(const ASTNode* node, void* data,
                                             int begin, int end,
-                                            const std::string& separator,
+                                            absl::string_view separator,
                                             bool break_line = false);
 
   template <class NodeType>
   void UnparseVectorWithSeparator(
       absl::Span<const NodeType* const> node_vector, void* data,
-      const std::string& separator) {
+      absl::string_view separator) {
     bool first = true;
     for (const NodeType* node : node_vector) {
       if (first) {
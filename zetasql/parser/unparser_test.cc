@@ -22,6 +22,8 @@
 #include "zetasql/parser/parser.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 
 namespace zetasql {
 
@@ -85,4 +87,25 @@ TEST(TestUnparser, ExpressionTest) {
                     expression_string, unparsed_expression_string);
 }
 
+TEST(TestUnparser, LongQueryTest) {
+  std::string query_string = "SELECT a0";
+  for (int i = 1; i < 2000; ++i) {
+    absl::StrAppend(&query_string, i % 3 == 0 ? " AND a" : " + a", i);
+  }
+  absl::StrAppend(&query_string, " FROM t WHERE b IN (1, 2) OR c");
+  std::unique_ptr<ParserOutput> parser_output;
+  ZETASQL_ASSERT_OK(ParseStatement(query_string, ParserOptions(), &parser_output));
+  std::string unparsed_string = Unparse(parser_output->statement());
+  // Long lines are broken after separators like "+" and "AND".
+  for (absl::string_view line : absl::StrSplit(unparsed_string, '\n')) {
+    EXPECT_LT(line.size(), 120) << line;
+  }
+  std::unique_ptr<ParserOutput> unparsed_query_parser_output;
+  ZETASQL_ASSERT_OK(ParseStatement(unparsed_string, ParserOptions(),
+                           &unparsed_query_parser_output));
+  CompareParseTrees(parser_output->statement(),
+                    unparsed_query_parser_output->statement(), query_string,
+                    unparsed_string);
+}
+
 }  // namespace zetasql
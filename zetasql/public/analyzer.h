@@ -35,6 +35,8 @@
 #include "zetasql/public/options.pb.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_column.h"
+#include "absl/base/call_once.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/node_hash_set.h"
 #include "zetasql/base/case.h"
@@ -48,13 +50,18 @@ namespace zetasql {
 class ASTExpression;
 class ASTScript;
 class ASTStatement;
+class ColumnReferenceIndex;
 class ParseResumeLocation;
 class ParserOptions;
 class ParserOutput;
+class ParserOutputCache;
 class ResolvedExpr;
 class ResolvedLiteral;
 class ResolvedOption;
 class ResolvedStatement;
+class TemplatedSQLFunctionCallCache;
+class Tracer;
+class ValidatorTimingReport;
 
 // Performs a case-insensitive less-than vector<string> comparison, element
 // by element, using the C/POSIX locale for element comparisons. This function
@@ -215,6 +222,13 @@ class AnalyzerOptions {
   zetasql_base::Status Serialize(
       FileDescriptorSetMap* map, AnalyzerOptionsProto* proto) const;
 
+  // Populates <fingerprint> with a string that is equal for two
+  // AnalyzerOptions if they have the same serialization, their proto and enum
+  // types come from the same DescriptorPools and they inline the same TVFs,
+  // for use in cache keys.
+  // Returns an error if the options cannot be serialized.
+  zetasql_base::Status GetFingerprint(std::string* fingerprint) const;
+
   // Options for the language. Please use the shorter versions below; these
   // versions are deprecated and will be removed eventually.
   // TODO: Migrate clients and remove these.
@@ -411,6 +425,97 @@ class AnalyzerOptions {
   }
   std::shared_ptr<zetasql_base::UnsafeArena> arena() const { return arena_; }
 
+  // If true, the nodes of the resolved AST are allocated from arena() rather
+  // than the heap, which makes analyzing large statements and destroying
+  // their AnalyzerOutputs cheaper. The AnalyzerOutput keeps the arena alive.
+  // Callers must not keep ResolvedNodes that the analyzer created (e.g. in
+  // Catalog callbacks) after the AnalyzerOutput is destroyed.
+  void set_allocate_resolved_nodes_in_arena(bool value) {
+    allocate_resolved_nodes_in_arena_ = value;
+  }
+  bool allocate_resolved_nodes_in_arena() const {
+    return allocate_resolved_nodes_in_arena_;
+  }
+
+  // If set, AnalyzeStatement() and ExtractTableNamesFromStatement() look up
+  // the parse of the statement in this cache, and parse only on a miss, so
+  // that several tools working on the same SQL share one parse. The cache
+  // must outlive the AnalyzerOptions; AnalyzerOutputs keep the outputs they
+  // were analyzed from alive. Not owned.
+  void set_parser_output_cache(ParserOutputCache* cache) {
+    parser_output_cache_ = cache;
+  }
+  ParserOutputCache* parser_output_cache() const {
+    return parser_output_cache_;
+  }
+
+  // If set, the resolved bodies of calls to TemplatedSQLFunctions are looked
+  // up in this cache, and stored in it after a miss, so that calls with the
+  // same argument types share one resolution, also across analyses. Callers
+  // must pass a different <catalog_version> whenever the catalog or the
+  // functions in it change. The cache must outlive the AnalyzerOptions and
+  // the AnalyzerOutputs. Not owned.
+  void set_templated_sql_function_call_cache(
+      TemplatedSQLFunctionCallCache* cache, absl::string_view catalog_version) {
+    templated_sql_function_call_cache_ = cache;
+    templated_sql_function_catalog_version_ = std::string(catalog_version);
+  }
+  TemplatedSQLFunctionCallCache* templated_sql_function_call_cache() const {
+    return templated_sql_function_call_cache_;
+  }
+  const std::string& templated_sql_function_catalog_version() const {
+    return templated_sql_function_catalog_version_;
+  }
+
+  // When --zetasql_validate_resolved_ast is true, validates only one in
+  // <sample_rate> of the resolved ASTs that the analyzer produces, counted
+  // across all analyses in the process with the same rate. 1, the default,
+  // validates every resolved AST.
+  void set_validate_resolved_ast_sample_rate(int sample_rate) {
+    validate_resolved_ast_sample_rate_ = sample_rate;
+  }
+  int validate_resolved_ast_sample_rate() const {
+    return validate_resolved_ast_sample_rate_;
+  }
+
+  // If true, validation only checks statements and scans, not the
+  // expressions in them. See ValidatorOptions::validate_expressions.
+  void set_validate_resolved_ast_structure_only(bool value) {
+    validate_resolved_ast_structure_only_ = value;
+  }
+  bool validate_resolved_ast_structure_only() const {
+    return validate_resolved_ast_structure_only_;
+  }
+
+  // If set, validation adds the time it spends on each kind of resolved node,
+  // and the number of validated and skipped ASTs, to this report. Not owned.
+  void set_validator_timing_report(ValidatorTimingReport* report) {
+    validator_timing_report_ = report;
+  }
+  ValidatorTimingReport* validator_timing_report() const {
+    return validator_timing_report_;
+  }
+
+  // If true, AnalyzerOutput::phase_times() reports the time spent parsing,
+  // resolving and validating the statement or expression. Off by default,
+  // because reading the clock is not free on very small statements.
+  void set_record_phase_times(bool value) { record_phase_times_ = value; }
+  bool record_phase_times() const { return record_phase_times_; }
+
+  // If set, the analyzer reports its "parse", "resolve" and "validate" phases
+  // to this tracer. The tracer must outlive the AnalyzerOptions. Not owned.
+  void set_tracer(Tracer* tracer) { tracer_ = tracer; }
+  Tracer* tracer() const { return tracer_; }
+
+  // If true, the names of the tables and columns that come from the Catalog
+  // are interned with IdStringPool::MakeInterned() instead of being copied
+  // into id_string_pool(). This saves copying and hashing the same names in
+  // every analysis, for services that analyze many statements over one
+  // long-lived Catalog. The interned names are never freed, so leave this
+  // off if the set of names in the Catalog is unbounded.
+  void set_intern_catalog_names(bool value) { intern_catalog_names_ = value; }
+  bool intern_catalog_names() const { return intern_catalog_names_; }
+
   // Creates default-sized id_string_pool() and arena().
   // WARNING: After calling this, calling Analyze functions concurrently with
   // the same AnalyzerOptions is no longer allowed.
@@ -485,6 +590,20 @@ class AnalyzerOptions {
   void set_prune_unused_columns(bool value) { prune_unused_columns_ = value; }
   bool prune_unused_columns() const { return prune_unused_columns_; }
 
+  // If true, calls to TemplatedSQLTVFs are replaced by the resolved query of
+  // their body, wrapped in a ResolvedProjectScan that produces the columns of
+  // the call, instead of a ResolvedTVFScan, so that engines can optimize the
+  // body together with the calling query. Scalar arguments are substituted
+  // for their ResolvedArgumentRefs and relation arguments for their
+  // ResolvedRelationArgumentScans. Calls that cannot be inlined this way,
+  // e.g. with scalar arguments other than literals and parameters, with
+  // relation arguments referenced more than once, with hints, or when parse
+  // locations are recorded, are still ResolvedTVFScans.
+  void set_inline_templated_sql_tvfs(bool value) {
+    inline_templated_sql_tvfs_ = value;
+  }
+  bool inline_templated_sql_tvfs() const { return inline_templated_sql_tvfs_; }
+
   void set_allowed_hints_and_options(const AllowedHintsAndOptions& allowed) {
     allowed_hints_and_options_ = allowed;
   }
@@ -588,6 +707,20 @@ class AnalyzerOptions {
   // Allocate parts of the parse tree and resolved AST in this arena.
   // The arena will also be referenced in AnalyzerOutput to keep it alive.
   std::shared_ptr<zetasql_base::UnsafeArena> arena_;
+  bool allocate_resolved_nodes_in_arena_ = false;
+
+  ParserOutputCache* parser_output_cache_ = nullptr;  // Not owned.
+
+  // Not owned.
+  TemplatedSQLFunctionCallCache* templated_sql_function_call_cache_ = nullptr;
+  std::string templated_sql_function_catalog_version_;
+
+  int validate_resolved_ast_sample_rate_ = 1;
+  bool validate_resolved_ast_structure_only_ = false;
+  ValidatorTimingReport* validator_timing_report_ = nullptr;  // Not owned.
+  bool record_phase_times_ = false;
+  Tracer* tracer_ = nullptr;  // Not owned.
+  bool intern_catalog_names_ = false;
 
   // Allocate all IdStrings in the resolved AST in this pool.
   // The pool will also be referenced in AnalyzerOutput to keep it alive.
@@ -623,6 +756,8 @@ class AnalyzerOptions {
   // and then remove this option.
   bool prune_unused_columns_ = false;
 
+  bool inline_templated_sql_tvfs_ = false;
+
   // This specifies the set of allowed hints and options, their expected
   // types, and whether to give errors on unrecognized names.
   // See the class definition for details.
@@ -646,6 +781,22 @@ class AnalyzerOutputProperties {
   // Copyable
 };
 
+// The time spent in each phase of analyzing one statement or expression, see
+// AnalyzerOptions::set_record_phase_times(). The parser tokenizes its input
+// on demand, so tokenizing is part of 'parse'. 'parse' is zero for outputs
+// analyzed from an existing ParserOutput, and is the time of the lookup for
+// statements found in a ParserOutputCache.
+struct AnalyzerPhaseTimes {
+  absl::Duration parse;
+  // Includes the coercion to the target type of
+  // AnalyzeExpressionForAssignmentToType().
+  absl::Duration resolve;
+  // Zero if the resolved AST was not validated.
+  absl::Duration validate;
+
+  absl::Duration total() const { return parse + resolve + validate; }
+};
+
 class AnalyzerOutput {
  public:
   AnalyzerOutput(
@@ -725,6 +876,35 @@ class AnalyzerOutput {
     return analyzer_output_properties_;
   }
 
+  // Returns an index of the columns of the resolved statement or expression:
+  // the table columns that it references and the nodes that define its
+  // columns. The index is built on the first call, with one traversal of the
+  // tree. Thread-safe.
+  const ColumnReferenceIndex& column_reference_index() const;
+
+  // Sets the columns that the resolved statement or expression references,
+  // for column_reference_index(). The analyzer sets these from what the
+  // resolver recorded. Without them, the index finds the referenced columns
+  // in the tree.
+  void set_referenced_columns(std::vector<ResolvedColumn> referenced_columns) {
+    referenced_columns_ = std::move(referenced_columns);
+    has_referenced_columns_ = true;
+  }
+
+  // Returns the time spent in each phase of the analysis. All zero unless
+  // AnalyzerOptions::record_phase_times() was true.
+  const AnalyzerPhaseTimes& phase_times() const { return phase_times_; }
+  void set_phase_times(const AnalyzerPhaseTimes& phase_times) {
+    phase_times_ = phase_times;
+  }
+
+  // Keeps <parser_output> alive as long as this AnalyzerOutput, for outputs
+  // analyzed from a ParserOutput that is shared, e.g. by a ParserOutputCache.
+  void set_shared_parser_output(
+      std::shared_ptr<const ParserOutput> parser_output) {
+    shared_parser_output_ = std::move(parser_output);
+  }
+
  private:
   // This IdStringPool and arena must be kept alive for the Resolved trees below
   // to be valid.
@@ -741,11 +921,19 @@ class AnalyzerOutput {
   // AST is expensive.  This allows engines to defer AnalyzerOutput cleanup
   // until after critical-path work is done.  May be NULL.
   std::unique_ptr<ParserOutput> parser_output_;
+  std::shared_ptr<const ParserOutput> shared_parser_output_;
 
   std::vector<zetasql_base::Status> deprecation_warnings_;
 
   QueryParametersMap undeclared_parameters_;
   std::vector<const Type*> undeclared_positional_parameters_;
+
+  AnalyzerPhaseTimes phase_times_;
+
+  std::vector<ResolvedColumn> referenced_columns_;
+  bool has_referenced_columns_ = false;
+  mutable absl::once_flag column_reference_index_once_;
+  mutable std::unique_ptr<const ColumnReferenceIndex> column_reference_index_;
 };
 
 // Analyze a ZetaSQL statement.
@@ -782,6 +970,29 @@ zetasql_base::Status AnalyzeNextStatement(
     std::unique_ptr<const AnalyzerOutput>* output,
     bool* at_end_of_input);
 
+// Analyzes all the statements of <sql>, like calling AnalyzeNextStatement()
+// until the end of the input, but analyzes up to <num_threads> statements
+// concurrently. This is meant for long scripts of independent statements,
+// e.g. migration scripts with thousands of DDL statements.
+//
+// <*outputs> gets one entry per statement, in the order of the statements in
+// <sql>: either the output of the statement or the error from analyzing it.
+// An error in one statement does not stop the analysis of the others, except
+// that statements after one that fails to parse are not analyzed; the parse
+// error is the last entry. Returns an error only if <options_in> is invalid.
+//
+// Each statement is analyzed independently against <catalog>, so statements
+// cannot see the effects of earlier ones (e.g. a table created by an earlier
+// CREATE TABLE). <catalog> must support concurrent lookups and must not change
+// during the call, and the callbacks in <options_in> may be called from
+// several threads at once. Each statement gets its own arenas, so
+// <options_in.arena()> and <options_in.id_string_pool()> are ignored.
+zetasql_base::Status AnalyzeStatements(
+    absl::string_view sql, const AnalyzerOptions& options_in, Catalog* catalog,
+    TypeFactory* type_factory, int num_threads,
+    std::vector<zetasql_base::StatusOr<std::unique_ptr<const AnalyzerOutput>>>*
+        outputs);
+
 // Same as AnalyzeStatement(), but analyze from the parsed AST contained in a
 // ParserOutput instead of raw SQL string. For projects which are allowed to use
 // the parser directly, using this may save double parsing. If the
@@ -924,6 +1135,15 @@ zetasql_base::Status ExtractTableNamesFromScript(absl::string_view sql,
                                          const AnalyzerOptions& options_in,
                                          TableNamesSet* table_names);
 
+// Same as above, but extracts the table names of the statements and
+// expressions of the script on up to <num_threads> threads, which is faster
+// for large scripts. The result, including which error is returned, is the
+// same as with one thread.
+zetasql_base::Status ExtractTableNamesFromScript(absl::string_view sql,
+                                         const AnalyzerOptions& options_in,
+                                         int num_threads,
+                                         TableNamesSet* table_names);
+
 // Same as ExtractTableNamesFromScript(), but extracts table names from
 // the parsed AST script. For projects which are allowed to use the parser
 // directly, using this may save double parsing.
@@ -0,0 +1,293 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/analyzer_output_cache.h"
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/parse_resume_location.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+
+// Populates <tokens> with the tokens of <sql>, and <key_tokens> with their
+// images, except that literals are replaced by their type kinds.
+zetasql_base::Status GetStatementTokens(absl::string_view sql,
+                                std::vector<ParseToken>* tokens,
+                                std::string* key_tokens) {
+  ParseResumeLocation resume_location =
+      ParseResumeLocation::FromStringView(sql);
+  ZETASQL_RETURN_IF_ERROR(
+      GetParseTokens(ParseTokenOptions(), &resume_location, tokens));
+  for (const ParseToken& token : *tokens) {
+    if (token.IsEndOfInput()) break;
+    if (token.IsValue()) {
+      absl::StrAppend(key_tokens, "?", token.GetValue().type_kind(), ";");
+    } else {
+      // Length-prefixed, so that the concatenation is unambiguous.
+      const absl::string_view image = token.GetImage();
+      absl::StrAppend(key_tokens, image.size(), ":", image);
+    }
+  }
+  return zetasql_base::OkStatus();
+}
+
+// Returns true if analyzing with <options> is not fully described by
+// AnalyzerOptions::GetFingerprint(), or has side effects that a cached output
+// would not have.
+bool MustBypassCache(const AnalyzerOptions& options) {
+  return options.column_id_sequence_number() != nullptr ||
+         options.lookup_expression_column_callback() != nullptr ||
+         options.ddl_pseudo_columns_callback() != nullptr;
+}
+
+}  // namespace
+
+AnalyzerOutputCache::AnalyzerOutputCache(int max_entries)
+    : max_entries_(max_entries) {}
+
+zetasql_base::Status AnalyzerOutputCache::AnalyzeStatement(
+    absl::string_view sql, const AnalyzerOptions& options, Catalog* catalog,
+    absl::string_view catalog_version, Result* result) {
+  result->output.reset();
+  result->literal_bindings.clear();
+
+  Key key;
+  std::vector<ParseToken> tokens;
+  if (MustBypassCache(options) ||
+      !GetStatementTokens(sql, &tokens, &key.tokens).ok() ||
+      !options.GetFingerprint(&key.options).ok()) {
+    {
+      absl::MutexLock lock(&mutex_);
+      ++stats_.misses;
+    }
+    // Errors, if any, are reported by the analyzer.
+    std::unique_ptr<const AnalyzerOutput> output;
+    ZETASQL_RETURN_IF_ERROR(zetasql::AnalyzeStatement(sql, options, catalog,
+                                              &type_factory_, &output));
+    result->output = std::move(output);
+    return zetasql_base::OkStatus();
+  }
+  key.catalog_version = std::string(catalog_version);
+
+  std::shared_ptr<const CachedStatement> statement;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      statement = it->second->statement;
+    }
+  }
+  if (statement != nullptr && BindLiterals(*statement, tokens, result)) {
+    absl::MutexLock lock(&mutex_);
+    ++stats_.hits;
+    return zetasql_base::OkStatus();
+  }
+
+  {
+    absl::MutexLock lock(&mutex_);
+    ++stats_.misses;
+  }
+  // Analyze without holding the lock, so that a slow analysis does not block
+  // lookups of other statements.
+  ZETASQL_RETURN_IF_ERROR(AnalyzeForCache(sql, tokens, options, catalog, &statement));
+  ZETASQL_RET_CHECK(BindLiterals(*statement, tokens, result));
+  if (max_entries_ <= 0) return zetasql_base::OkStatus();
+
+  absl::MutexLock lock(&mutex_);
+  auto inserted = entries_.emplace(std::move(key), lru_.end());
+  if (!inserted.second) {
+    // Another thread analyzed the same statement concurrently, or the entry
+    // is for other values of the literals that must be identical. Either
+    // way, the latest statement replaces it.
+    lru_.erase(inserted.first->second);
+    --stats_.num_entries;
+  }
+  lru_.push_front(Entry{&inserted.first->first, std::move(statement)});
+  inserted.first->second = lru_.begin();
+  ++stats_.num_entries;
+  EvictLocked();
+  return zetasql_base::OkStatus();
+}
+
+bool AnalyzerOutputCache::BindLiterals(const CachedStatement& statement,
+                                       const std::vector<ParseToken>& tokens,
+                                       Result* result) {
+  result->literal_bindings.clear();
+  auto slot = statement.literal_slots.begin();
+  for (const ParseToken& token : tokens) {
+    if (!token.IsValue()) continue;
+    // The key has the same tokens, so the counts match.
+    DCHECK(slot != statement.literal_slots.end());
+    if (slot == statement.literal_slots.end()) return false;
+    if (slot->parameter_name.empty()) {
+      if (token.GetImage() != slot->image) return false;
+    } else {
+      result->literal_bindings.emplace(slot->parameter_name, token.GetValue());
+    }
+    ++slot;
+  }
+  result->output = statement.output;
+  return true;
+}
+
+zetasql_base::Status AnalyzerOutputCache::AnalyzeForCache(
+    absl::string_view sql, const std::vector<ParseToken>& tokens,
+    const AnalyzerOptions& options, Catalog* catalog,
+    std::shared_ptr<const CachedStatement>* statement) {
+  auto cached = std::make_shared<CachedStatement>();
+  for (const ParseToken& token : tokens) {
+    if (token.IsValue()) {
+      cached->literal_slots.push_back({"", std::string(token.GetImage())});
+    }
+  }
+
+  // ReplaceLiteralsByParameters() needs parse locations. Named parameters
+  // can only replace literals in the named parameter mode.
+  AnalyzerOptions literal_options = options;
+  literal_options.set_record_parse_locations(true);
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_RETURN_IF_ERROR(zetasql::AnalyzeStatement(sql, literal_options, catalog,
+                                            &type_factory_, &output));
+  LiteralReplacementMap literal_map;
+  GeneratedParameterMap generated_parameters;
+  std::string unused_sql;
+  if (options.parameter_mode() == PARAMETER_NAMED &&
+      !ReplaceLiteralsByParameters(std::string(sql), literal_options,
+                                   output.get(), &literal_map,
+                                   &generated_parameters, &unused_sql)
+           .ok()) {
+    // Keep all the literals.
+    literal_map.clear();
+  }
+
+  // Only replace the literals that are exactly one literal token and keep
+  // its type and value, so that the value of the token can be bound to the
+  // parameter for other statements with the same tokens.
+  // The literal tokens and their slots, by the offset of the token.
+  absl::flat_hash_map<int, std::pair<const ParseToken*, LiteralSlot*>>
+      slots_by_offset;
+  auto slot = cached->literal_slots.begin();
+  for (const ParseToken& token : tokens) {
+    if (token.IsValue()) {
+      slots_by_offset[token.GetLocationRange().start().GetByteOffset()] = {
+          &token, &*slot++};
+    }
+  }
+  int num_parameters = 0;
+  for (const auto& entry : literal_map) {
+    const ResolvedLiteral* literal = entry.first;
+    const ParseLocationRange* location = literal->GetParseLocationRangeOrNULL();
+    ZETASQL_RET_CHECK(location != nullptr);
+    auto it = slots_by_offset.find(location->start().GetByteOffset());
+    if (it == slots_by_offset.end()) continue;
+    const ParseToken& token = *it->second.first;
+    if (token.GetLocationRange().end() != location->end() ||
+        !literal->type()->Equals(token.GetValue().type()) ||
+        literal->value() != token.GetValue()) {
+      continue;
+    }
+    LiteralSlot& literal_slot = *it->second.second;
+    if (literal_slot.parameter_name.empty()) ++num_parameters;
+    literal_slot.parameter_name = entry.second;
+  }
+
+  if (num_parameters > 0) {
+    // Build the statement with the parameters, like
+    // ReplaceLiteralsByParameters() does.
+    std::string parameterized_sql;
+    AnalyzerOptions parameterized_options = options;
+    int prefix_offset = 0;
+    slot = cached->literal_slots.begin();
+    for (const ParseToken& token : tokens) {
+      if (!token.IsValue()) continue;
+      const std::string& parameter_name = (slot++)->parameter_name;
+      if (parameter_name.empty()) continue;
+      const int first_offset =
+          token.GetLocationRange().start().GetByteOffset();
+      const int last_offset = token.GetLocationRange().end().GetByteOffset();
+      absl::StrAppend(&parameterized_sql,
+                      sql.substr(prefix_offset, first_offset - prefix_offset),
+                      "@", parameter_name);
+      if (last_offset < sql.size()) {
+        const char ch = sql[last_offset];
+        if (absl::ascii_isalnum(ch) || ch == '_' || ch == '@') {
+          absl::StrAppend(&parameterized_sql, " ");
+        }
+      }
+      prefix_offset = last_offset;
+      ZETASQL_RETURN_IF_ERROR(parameterized_options.AddQueryParameter(
+          parameter_name, generated_parameters.at(parameter_name).type()));
+    }
+    absl::StrAppend(&parameterized_sql, sql.substr(prefix_offset));
+
+    std::unique_ptr<const AnalyzerOutput> parameterized_output;
+    if (zetasql::AnalyzeStatement(parameterized_sql, parameterized_options,
+                                    catalog, &type_factory_,
+                                    &parameterized_output)
+            .ok()) {
+      cached->output = std::move(parameterized_output);
+      *statement = std::move(cached);
+      return zetasql_base::OkStatus();
+    }
+    // Some literals cannot be parameters, e.g. in DATE '2019-01-01'. Keep
+    // all the literals instead.
+    for (LiteralSlot& literal_slot : cached->literal_slots) {
+      literal_slot.parameter_name.clear();
+    }
+  }
+
+  if (!options.record_parse_locations()) {
+    // Return the same output as without the cache.
+    ZETASQL_RETURN_IF_ERROR(zetasql::AnalyzeStatement(sql, options, catalog,
+                                              &type_factory_, &output));
+  }
+  cached->output = std::move(output);
+  *statement = std::move(cached);
+  return zetasql_base::OkStatus();
+}
+
+AnalyzerOutputCache::Stats AnalyzerOutputCache::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void AnalyzerOutputCache::Clear() {
+  absl::MutexLock lock(&mutex_);
+  entries_.clear();
+  lru_.clear();
+  stats_.num_entries = 0;
+}
+
+void AnalyzerOutputCache::EvictLocked() {
+  while (stats_.num_entries > max_entries_) {
+    DCHECK(!lru_.empty());
+    --stats_.num_entries;
+    ++stats_.evictions;
+    entries_.erase(entries_.find(*lru_.back().key));
+    lru_.pop_back();
+  }
+}
+
+}  // namespace zetasql
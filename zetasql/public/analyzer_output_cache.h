@@ -0,0 +1,164 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_ANALYZER_OUTPUT_CACHE_H_
+#define ZETASQL_PUBLIC_ANALYZER_OUTPUT_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/parse_tokens.h"
+#include "zetasql/public/type.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+// A bounded, thread-safe cache of AnalyzerOutputs, for callers that analyze
+// the same statements over and over with different literal values, e.g. a
+// service that sees the same few thousand query shapes.
+//
+// Statements are looked up by their tokens with the literals stripped, a
+// fingerprint of the AnalyzerOptions and a caller-provided catalog version.
+// On a miss, the statement is analyzed, and the literals that
+// ReplaceLiteralsByParameters() replaces without changing their type are
+// replaced by query parameters. The cached output is the analysis of the
+// statement with those parameters, and each lookup returns the values that
+// its literals had as bindings for them. The other literals (e.g. literals
+// coerced to another type, GROUP BY ordinals or negative numbers) must be
+// identical for a lookup to hit. Parse locations in the cached output, if
+// recorded, are relative to the statement with parameters.
+//
+// The cached outputs reference objects that the Catalog returned, so callers
+// must pass a different <catalog_version> whenever the contents of the
+// catalog change, and keep a catalog alive while outputs analyzed against it
+// are cached or in use. Types of the outputs come from a TypeFactory owned by
+// the cache.
+//
+// Entries are evicted in least recently used order once the cache holds more
+// than 'max_entries' entries.
+class AnalyzerOutputCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+    int64_t num_entries = 0;
+  };
+
+  struct Result {
+    std::shared_ptr<const AnalyzerOutput> output;
+    // Values for the query parameters that replaced literals in <output>, to
+    // be passed to the evaluator along with the caller's own parameters.
+    GeneratedParameterMap literal_bindings;
+  };
+
+  explicit AnalyzerOutputCache(int max_entries);
+  AnalyzerOutputCache(const AnalyzerOutputCache&) = delete;
+  AnalyzerOutputCache& operator=(const AnalyzerOutputCache&) = delete;
+
+  // Like zetasql::AnalyzeStatement(), but returns a cached output if possible.
+  // Errors are not cached. Statements are analyzed without the cache if
+  // <options> has a column_id_sequence_number(), because cached outputs do
+  // not allocate column ids from it, or if <options> cannot be serialized.
+  zetasql_base::Status AnalyzeStatement(absl::string_view sql,
+                                const AnalyzerOptions& options,
+                                Catalog* catalog,
+                                absl::string_view catalog_version,
+                                Result* result);
+
+  Stats GetStats() const;
+
+  // Removes all entries. Does not reset the hit/miss/eviction counters.
+  void Clear();
+
+ private:
+  struct Key {
+    // The tokens of the statement, with the images of literals replaced by
+    // their type kinds.
+    std::string tokens;
+    // The serialized AnalyzerOptions.
+    std::string options;
+    std::string catalog_version;
+
+    bool operator==(const Key& other) const {
+      return tokens == other.tokens && options == other.options &&
+             catalog_version == other.catalog_version;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& key) {
+      return H::combine(std::move(h), key.tokens, key.options,
+                        key.catalog_version);
+    }
+  };
+
+  // How a literal token of a cached statement gets its value.
+  struct LiteralSlot {
+    // The query parameter that replaced the literal, if any.
+    std::string parameter_name;
+    // Otherwise the image that the literal must have.
+    std::string image;
+  };
+
+  struct CachedStatement {
+    std::shared_ptr<const AnalyzerOutput> output;
+    // One slot for each literal token.
+    std::vector<LiteralSlot> literal_slots;
+  };
+
+  struct Entry {
+    const Key* key;  // Owned by 'entries_', which has stable keys.
+    std::shared_ptr<const CachedStatement> statement;
+  };
+  // The list front is the most recently used entry.
+  using LruList = std::list<Entry>;
+
+  // Populates <result> from <statement> if the literals in <tokens> match it.
+  static bool BindLiterals(const CachedStatement& statement,
+                           const std::vector<ParseToken>& tokens,
+                           Result* result);
+
+  // Analyzes <sql>, whose tokens are <tokens>, and returns the statement to
+  // cache for it.
+  zetasql_base::Status AnalyzeForCache(
+      absl::string_view sql, const std::vector<ParseToken>& tokens,
+      const AnalyzerOptions& options, Catalog* catalog,
+      std::shared_ptr<const CachedStatement>* statement);
+
+  // Evicts least recently used entries until the limit is respected.
+  void EvictLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int max_entries_;
+  TypeFactory type_factory_;
+
+  mutable absl::Mutex mutex_;
+  LruList lru_ ABSL_GUARDED_BY(mutex_);
+  absl::node_hash_map<Key, LruList::iterator> entries_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_ANALYZER_OUTPUT_CACHE_H_
@@ -0,0 +1,187 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/analyzer_output_cache.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/value.h"
+#include "zetasql/testdata/sample_catalog.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+namespace zetasql {
+namespace {
+
+using testing::Pair;
+using testing::UnorderedElementsAre;
+
+class AnalyzerOutputCacheTest : public ::testing::Test {
+ protected:
+  AnalyzerOutputCacheTest()
+      : sample_catalog_(absl::make_unique<SampleCatalog>(options_.language())) {
+  }
+
+  Catalog* catalog() { return sample_catalog_->catalog(); }
+
+  AnalyzerOptions options_;
+  std::unique_ptr<SampleCatalog> sample_catalog_;
+};
+
+TEST_F(AnalyzerOutputCacheTest, ReplacesLiteralsByParameters) {
+  AnalyzerOutputCache cache(/*max_entries=*/10);
+  AnalyzerOutputCache::Result result;
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement(
+      "SELECT 1 AS a, 'x' AS b FROM KeyValue WHERE key = 5", options_,
+      catalog(), "v1", &result));
+  ASSERT_NE(nullptr, result.output);
+  const AnalyzerOutput* output = result.output.get();
+  EXPECT_EQ(3, result.literal_bindings.size());
+
+  // Other literal values and whitespace hit the same entry.
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement(
+      "SELECT 2 AS a,  'yy' AS b FROM KeyValue WHERE key = 7", options_,
+      catalog(), "v1", &result));
+  EXPECT_EQ(output, result.output.get());
+  std::vector<Value> values;
+  for (const auto& binding : result.literal_bindings) {
+    values.push_back(binding.second);
+  }
+  EXPECT_THAT(values, UnorderedElementsAre(Value::Int64(2),
+                                           Value::String("yy"),
+                                           Value::Int64(7)));
+  EXPECT_EQ(1, cache.GetStats().hits);
+  EXPECT_EQ(1, cache.GetStats().misses);
+
+  // Literals of other types, other catalog versions and other options miss.
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement(
+      "SELECT 2.5 AS a, 'yy' AS b FROM KeyValue WHERE key = 7", options_,
+      catalog(), "v1", &result));
+  EXPECT_NE(output, result.output.get());
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement(
+      "SELECT 2 AS a, 'yy' AS b FROM KeyValue WHERE key = 7", options_,
+      catalog(), "v2", &result));
+  EXPECT_NE(output, result.output.get());
+  AnalyzerOptions other_options = options_;
+  other_options.set_prune_unused_columns(true);
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement(
+      "SELECT 2 AS a, 'yy' AS b FROM KeyValue WHERE key = 7", other_options,
+      catalog(), "v1", &result));
+  EXPECT_NE(output, result.output.get());
+  EXPECT_EQ(1, cache.GetStats().hits);
+  EXPECT_EQ(4, cache.GetStats().misses);
+  EXPECT_EQ(4, cache.GetStats().num_entries);
+}
+
+TEST_F(AnalyzerOutputCacheTest, LiteralsThatMustMatch) {
+  AnalyzerOutputCache cache(/*max_entries=*/10);
+  AnalyzerOutputCache::Result result;
+  // The date literal cannot be a parameter, and the ordinal is not a literal.
+  const std::string sql =
+      "SELECT key FROM KeyValue WHERE DATE '2019-01-01' IS NOT NULL "
+      "GROUP BY 1";
+  ZETASQL_ASSERT_OK(
+      cache.AnalyzeStatement(sql, options_, catalog(), "v1", &result));
+  EXPECT_TRUE(result.literal_bindings.empty());
+  const AnalyzerOutput* output = result.output.get();
+  ZETASQL_ASSERT_OK(
+      cache.AnalyzeStatement(sql, options_, catalog(), "v1", &result));
+  EXPECT_EQ(output, result.output.get());
+  EXPECT_EQ(1, cache.GetStats().hits);
+
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement(
+      "SELECT key FROM KeyValue WHERE DATE '2019-01-02' IS NOT NULL "
+      "GROUP BY 1",
+      options_, catalog(), "v1", &result));
+  EXPECT_NE(output, result.output.get());
+  EXPECT_EQ(1, cache.GetStats().hits);
+  // The new statement replaced the old one.
+  EXPECT_EQ(1, cache.GetStats().num_entries);
+}
+
+TEST_F(AnalyzerOutputCacheTest, ErrorsAreNotCached) {
+  AnalyzerOutputCache cache(/*max_entries=*/10);
+  AnalyzerOutputCache::Result result;
+  EXPECT_FALSE(cache
+                   .AnalyzeStatement("SELECT no_such_column FROM KeyValue",
+                                     options_, catalog(), "v1", &result)
+                   .ok());
+  EXPECT_FALSE(
+      cache.AnalyzeStatement("SELECT 'abc", options_, catalog(), "v1", &result)
+          .ok());
+  EXPECT_EQ(0, cache.GetStats().num_entries);
+  EXPECT_EQ(2, cache.GetStats().misses);
+}
+
+TEST_F(AnalyzerOutputCacheTest, EvictsLeastRecentlyUsed) {
+  AnalyzerOutputCache cache(/*max_entries=*/2);
+  AnalyzerOutputCache::Result result;
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement("SELECT 1", options_, catalog(), "v1",
+                                   &result));
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement("SELECT 'a'", options_, catalog(), "v1",
+                                   &result));
+  // Use "SELECT 1", so that "SELECT 'a'" is evicted next.
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement("SELECT 3", options_, catalog(), "v1",
+                                   &result));
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement("SELECT 1.5", options_, catalog(), "v1",
+                                   &result));
+  const AnalyzerOutputCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(1, stats.evictions);
+  EXPECT_EQ(2, stats.num_entries);
+  ZETASQL_ASSERT_OK(cache.AnalyzeStatement("SELECT 4", options_, catalog(), "v1",
+                                   &result));
+  EXPECT_EQ(2, cache.GetStats().hits);
+
+  cache.Clear();
+  EXPECT_EQ(0, cache.GetStats().num_entries);
+  // Cleared outputs stay valid for their holders.
+  EXPECT_NE(nullptr, result.output->resolved_statement());
+}
+
+TEST_F(AnalyzerOutputCacheTest, ConcurrentLookups) {
+  AnalyzerOutputCache cache(/*max_entries=*/4);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([this, &cache, i]() {
+      for (int j = 0; j < 50; ++j) {
+        AnalyzerOutputCache::Result result;
+        ZETASQL_EXPECT_OK(cache.AnalyzeStatement(
+            absl::StrCat("SELECT key + ", j, " FROM KeyValue WHERE key > ",
+                         i * j),
+            options_, catalog(), "v1", &result));
+        EXPECT_THAT(result.literal_bindings,
+                    UnorderedElementsAre(Pair(testing::_, Value::Int64(j)),
+                                         Pair(testing::_, Value::Int64(i * j))));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const AnalyzerOutputCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(4 * 50, stats.hits + stats.misses);
+  EXPECT_EQ(1, stats.num_entries);
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -33,12 +33,17 @@
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/options.pb.h"
 #include "zetasql/public/value.h"
+#include "absl/base/macros.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/memory/memory.h"
 #include "zetasql/base/case.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status.h"
@@ -93,38 +98,190 @@ const std::string FunctionSignatureIdToName(FunctionSignatureId id) {
 
 using NameToFunctionMap = std::map<std::string, std::unique_ptr<Function>>;
 
-void GetZetaSQLFunctions(TypeFactory* type_factory,
-                           const ZetaSQLBuiltinFunctionOptions& options,
-                           NameToFunctionMap* functions) {
-  GetDatetimeFunctions(type_factory, options, functions);
-  GetArithmeticFunctions(type_factory, options, functions);
-  GetBitwiseFunctions(type_factory, options, functions);
-  GetAggregateFunctions(type_factory, options, functions);
-  GetApproxFunctions(type_factory, options, functions);
-  GetStatisticalFunctions(type_factory, options, functions);
-  GetBooleanFunctions(type_factory, options, functions);
-  GetLogicFunctions(type_factory, options, functions);
-  GetStringFunctions(type_factory, options, functions);
-  GetRegexFunctions(type_factory, options, functions);
-  GetMiscellaneousFunctions(type_factory, options, functions);
-  GetMathFunctions(type_factory, options, functions);
-  GetHllCountFunctions(type_factory, options, functions);
-  GetKllQuantilesFunctions(type_factory, options, functions);
-  GetProto3ConversionFunctions(type_factory, options, functions);
+static void GetAnalyticFunctionsIfEnabled(
+    TypeFactory* type_factory, const ZetaSQLBuiltinFunctionOptions& options,
+    NameToFunctionMap* functions) {
   if (options.language_options.LanguageFeatureEnabled(
           FEATURE_ANALYTIC_FUNCTIONS)) {
     GetAnalyticFunctions(type_factory, options, functions);
   }
-  GetNetFunctions(type_factory, options, functions);
-  GetHashingFunctions(type_factory, options, functions);
+}
+
+static void GetEncryptionFunctionsIfEnabled(
+    TypeFactory* type_factory, const ZetaSQLBuiltinFunctionOptions& options,
+    NameToFunctionMap* functions) {
   if (options.language_options.LanguageFeatureEnabled(FEATURE_ENCRYPTION)) {
     GetEncryptionFunctions(type_factory, options, functions);
   }
+}
+
+static void GetGeographyFunctionsIfEnabled(
+    TypeFactory* type_factory, const ZetaSQLBuiltinFunctionOptions& options,
+    NameToFunctionMap* functions) {
   if (options.language_options.LanguageFeatureEnabled(FEATURE_GEOGRAPHY)) {
     GetGeographyFunctions(type_factory, options, functions);
   }
 }
 
+namespace {
+
+// A group of built-in functions that are built together.
+struct FunctionGroup {
+  void (*get_functions)(TypeFactory* type_factory,
+                        const ZetaSQLBuiltinFunctionOptions& options,
+                        NameToFunctionMap* functions);
+  // True if some functions of the group are in namespaces.
+  bool has_namespaces;
+};
+
+// All the built-in functions. LazyZetaSQLFunctions builds the groups in this
+// order, so the groups that most statements use come first.
+constexpr FunctionGroup kFunctionGroups[] = {
+    {&GetBooleanFunctions, false},
+    {&GetArithmeticFunctions, false},
+    {&GetLogicFunctions, false},
+    {&GetAggregateFunctions, false},
+    {&GetStringFunctions, false},
+    {&GetMiscellaneousFunctions, false},
+    {&GetDatetimeConversionFunctions, false},
+    {&GetDatetimeCurrentFunctions, false},
+    {&GetDatetimeExtractFunctions, false},
+    {&GetDatetimeFormatFunctions, false},
+    {&GetDatetimeAddSubFunctions, false},
+    {&GetDatetimeDiffTruncFunctions, false},
+    {&GetTimeAndDatetimeConstructionAndConversionFunctions, false},
+    {&GetNumericFunctions, false},
+    {&GetAnalyticFunctionsIfEnabled, false},
+    {&GetRegexFunctions, false},
+    {&GetBitwiseFunctions, false},
+    {&GetApproxFunctions, false},
+    {&GetStatisticalFunctions, false},
+    {&GetTrigonometricFunctions, false},
+    {&GetHashingFunctions, false},
+    {&GetProto3ConversionFunctions, false},
+    {&GetHllCountFunctions, true},
+    {&GetKllQuantilesFunctions, true},
+    {&GetNetFunctions, true},
+    {&GetEncryptionFunctionsIfEnabled, true},
+    {&GetGeographyFunctionsIfEnabled, false},
+};
+
+constexpr int kNumFunctionGroups = ABSL_ARRAYSIZE(kFunctionGroups);
+
+}  // namespace
+
+void GetZetaSQLFunctions(TypeFactory* type_factory,
+                           const ZetaSQLBuiltinFunctionOptions& options,
+                           NameToFunctionMap* functions) {
+  for (const FunctionGroup& group : kFunctionGroups) {
+    group.get_functions(type_factory, options, functions);
+  }
+}
+
+// Returns a key that is the same for equivalent <options>.
+static std::string SharedFunctionsKey(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  LanguageOptionsProto language_options;
+  options.language_options.Serialize(&language_options);
+  std::vector<int> include_ids(options.include_function_ids.begin(),
+                               options.include_function_ids.end());
+  std::vector<int> exclude_ids(options.exclude_function_ids.begin(),
+                               options.exclude_function_ids.end());
+  std::sort(include_ids.begin(), include_ids.end());
+  std::sort(exclude_ids.begin(), exclude_ids.end());
+  // An empty include list means that all functions are included, so it must
+  // be distinguishable from a list with only excluded functions.
+  return absl::StrCat(language_options.SerializeAsString(), ";+",
+                      absl::StrJoin(include_ids, ","), ";-",
+                      absl::StrJoin(exclude_ids, ","));
+}
+
+LazyZetaSQLFunctions* LazyZetaSQLFunctions::GetShared(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  static absl::Mutex* mutex = new absl::Mutex;
+  static auto* shared_functions =
+      new absl::node_hash_map<std::string,
+                              std::unique_ptr<LazyZetaSQLFunctions>>;
+
+  const std::string key = SharedFunctionsKey(options);
+  absl::MutexLock lock(mutex);
+  std::unique_ptr<LazyZetaSQLFunctions>& functions = (*shared_functions)[key];
+  if (functions == nullptr) {
+    functions = absl::WrapUnique(new LazyZetaSQLFunctions(options));
+  }
+  return functions.get();
+}
+
+LazyZetaSQLFunctions::LazyZetaSQLFunctions(
+    const ZetaSQLBuiltinFunctionOptions& options)
+    : options_(options), built_groups_(kNumFunctionGroups, false) {}
+
+void LazyZetaSQLFunctions::BuildGroupLocked(int group_index) {
+  static TypeFactory* type_factory = new TypeFactory;
+  if (built_groups_[group_index]) return;
+  built_groups_[group_index] = true;
+
+  NameToFunctionMap group_functions;
+  kFunctionGroups[group_index].get_functions(type_factory, options_,
+                                             &group_functions);
+  for (auto& entry : group_functions) {
+    const Function* function = entry.second.get();
+    const std::vector<std::string>& path = function->FunctionNamePath();
+    std::string prefix;
+    if (path.size() > 1) {
+      namespaces_.insert(path[0]);
+      prefix = absl::StrCat(path[0], ".");
+    }
+    const std::string& alias_name = function->alias_name();
+    if (!alias_name.empty()) {
+      aliases_.emplace(absl::StrCat(prefix, absl::AsciiStrToLower(alias_name)),
+                       function);
+    }
+    CHECK(functions_.emplace(entry.first, std::move(entry.second)).second)
+        << entry.first << " already exists";
+  }
+}
+
+const Function* LazyZetaSQLFunctions::Find(absl::string_view name) {
+  absl::MutexLock lock(&mutex_);
+  for (int group_index = 0;; ++group_index) {
+    auto it = functions_.find(std::string(name));
+    if (it != functions_.end()) return it->second.get();
+    auto alias_it = aliases_.find(name);
+    if (alias_it != aliases_.end()) return alias_it->second;
+
+    // Build the next group that is not built yet.
+    while (group_index < kNumFunctionGroups && built_groups_[group_index]) {
+      ++group_index;
+    }
+    if (group_index == kNumFunctionGroups) return nullptr;
+    BuildGroupLocked(group_index);
+  }
+}
+
+std::vector<std::string> LazyZetaSQLFunctions::GetNamespaces() {
+  absl::MutexLock lock(&mutex_);
+  for (int group_index = 0; group_index < kNumFunctionGroups; ++group_index) {
+    if (kFunctionGroups[group_index].has_namespaces) {
+      BuildGroupLocked(group_index);
+    }
+  }
+  return std::vector<std::string>(namespaces_.begin(), namespaces_.end());
+}
+
+const NameToFunctionMap& LazyZetaSQLFunctions::GetAll() {
+  absl::MutexLock lock(&mutex_);
+  for (int group_index = 0; group_index < kNumFunctionGroups; ++group_index) {
+    BuildGroupLocked(group_index);
+  }
+  return functions_;
+}
+
+const NameToFunctionMap& GetSharedZetaSQLFunctions(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  return LazyZetaSQLFunctions::GetShared(options)->GetAll();
+}
+
 bool FunctionMayHaveUnintendedArgumentCoercion(const Function* function) {
   if (function->NumSignatures() == 0 ||
       !function->ArgumentsAreCoercible()) {
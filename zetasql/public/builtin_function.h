@@ -20,7 +20,9 @@
 #include <stddef.h>
 
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "zetasql/proto/options.pb.h"
 #include "zetasql/public/builtin_function.pb.h"
@@ -28,7 +30,11 @@
 #include "zetasql/public/function.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/type.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 
 namespace zetasql {
 
@@ -48,6 +54,66 @@ void GetZetaSQLFunctions(
     TypeFactory* type_factory, const ZetaSQLBuiltinFunctionOptions& options,
     std::map<std::string, std::unique_ptr<Function>>* functions);
 
+// The built-in functions for one ZetaSQLBuiltinFunctionOptions, shared by
+// the whole process. Functions are built one group of related functions (e.g.
+// all the string functions) at a time, when a function of the group is first
+// looked up, so that processes that only use a few functions do not pay for
+// building all of them. The functions and their Types are immutable once
+// built, and come from a TypeFactory that is never freed.
+//
+// This class is thread-safe.
+class LazyZetaSQLFunctions {
+ public:
+  LazyZetaSQLFunctions(const LazyZetaSQLFunctions&) = delete;
+  LazyZetaSQLFunctions& operator=(const LazyZetaSQLFunctions&) = delete;
+
+  // Returns the instance for <options>, which is the same for all equivalent
+  // <options> and is never freed.
+  static LazyZetaSQLFunctions* GetShared(
+      const ZetaSQLBuiltinFunctionOptions& options);
+
+  // Returns the function with the name or alias <name>, or NULL if there is
+  // none. <name> must be lower case, with the namespace and the name joined
+  // by '.' for functions in namespaces, e.g. "net.host". Groups are built in
+  // order until the function is found, so a <name> that is not a built-in
+  // function builds all of them.
+  const Function* Find(absl::string_view name) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the namespaces of the functions, e.g. "net". Only builds the
+  // groups that have functions in namespaces.
+  std::vector<std::string> GetNamespaces() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Builds all the groups and returns all the functions, like
+  // GetZetaSQLFunctions() does. The returned map does not change afterwards.
+  const std::map<std::string, std::unique_ptr<Function>>& GetAll()
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  explicit LazyZetaSQLFunctions(const ZetaSQLBuiltinFunctionOptions& options);
+
+  // Builds group <group_index> of the functions, if not built yet.
+  void BuildGroupLocked(int group_index) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const ZetaSQLBuiltinFunctionOptions options_;
+
+  absl::Mutex mutex_;
+  std::vector<bool> built_groups_ ABSL_GUARDED_BY(mutex_);
+  std::map<std::string, std::unique_ptr<Function>> functions_
+      ABSL_GUARDED_BY(mutex_);
+  // Functions of <functions_> with an alias, by their lower case alias.
+  absl::flat_hash_map<std::string, const Function*> aliases_
+      ABSL_GUARDED_BY(mutex_);
+  std::set<std::string> namespaces_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Equivalent to LazyZetaSQLFunctions::GetShared(options)->GetAll(). Each call
+// after the first one for equivalent <options> costs a lookup instead of
+// constructing every Function and FunctionSignature again.
+//
+// This is thread-safe.
+const std::map<std::string, std::unique_ptr<Function>>&
+GetSharedZetaSQLFunctions(const ZetaSQLBuiltinFunctionOptions& options);
+
 // If the function allows argument coercion, then checks the function
 // signatures to see if they are defined for floating point and
 // only one of signed/unsigned integer arguments (but not both integer
@@ -25,6 +25,7 @@
 #include "zetasql/public/function.pb.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/options.pb.h"
+#include "zetasql/public/simple_catalog.h"
 #include "zetasql/public/value.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "zetasql/testdata/test_schema.pb.h"
@@ -426,6 +427,105 @@ TEST(SimpleBuiltinFunctionTests, LanguageOptions) {
   EXPECT_FALSE(zetasql_base::ContainsKey(functions, FunctionSignatureIdToName(FN_LEAD)));
 }
 
+TEST(SimpleBuiltinFunctionTests, SharedFunctions) {
+  const NameToFunctionMap& functions =
+      GetSharedZetaSQLFunctions(LanguageOptions());
+  // Equivalent options return the same functions.
+  EXPECT_EQ(&functions, &GetSharedZetaSQLFunctions(LanguageOptions()));
+  EXPECT_TRUE(zetasql_base::ContainsKey(functions, FunctionSignatureIdToName(FN_COUNT)));
+  EXPECT_FALSE(zetasql_base::ContainsKey(functions, FunctionSignatureIdToName(FN_RANK)));
+
+  ZetaSQLBuiltinFunctionOptions options{LanguageOptions()};
+  options.exclude_function_ids.insert(FN_COUNT);
+  const NameToFunctionMap& excluded_functions =
+      GetSharedZetaSQLFunctions(options);
+  EXPECT_NE(&functions, &excluded_functions);
+  EXPECT_FALSE(zetasql_base::ContainsKey(excluded_functions,
+                                FunctionSignatureIdToName(FN_COUNT)));
+  options.exclude_function_ids.clear();
+  options.include_function_ids.insert(FN_COUNT);
+  EXPECT_NE(&functions, &GetSharedZetaSQLFunctions(options));
+  EXPECT_NE(&excluded_functions, &GetSharedZetaSQLFunctions(options));
+
+  // Catalogs reference the shared functions, including the ones in
+  // namespaces, without copying them.
+  const ZetaSQLBuiltinFunctionOptions all_options;
+  SimpleCatalog catalog1("catalog1");
+  SimpleCatalog catalog2("catalog2");
+  catalog1.AddSharedZetaSQLFunctions(all_options);
+  catalog2.AddSharedZetaSQLFunctions(all_options);
+  for (const auto& entry : GetSharedZetaSQLFunctions(all_options)) {
+    const Function* function1;
+    const Function* function2;
+    ZETASQL_ASSERT_OK(catalog1.FindFunction(entry.second->FunctionNamePath(),
+                                    &function1));
+    ZETASQL_ASSERT_OK(catalog2.FindFunction(entry.second->FunctionNamePath(),
+                                    &function2));
+    EXPECT_EQ(entry.second.get(), function1);
+    EXPECT_EQ(entry.second.get(), function2);
+  }
+
+  catalog1.ClearFunctions();
+  const Function* function;
+  EXPECT_FALSE(catalog1.FindFunction({"count"}, &function).ok());
+  ZETASQL_EXPECT_OK(catalog2.FindFunction({"count"}, &function));
+}
+
+TEST(SimpleBuiltinFunctionTests, LazyFunctions) {
+  ZetaSQLBuiltinFunctionOptions options;
+  options.exclude_function_ids.insert(FN_ABS_INT64);
+  LazyZetaSQLFunctions* lazy_functions =
+      LazyZetaSQLFunctions::GetShared(options);
+  EXPECT_EQ(lazy_functions, LazyZetaSQLFunctions::GetShared(options));
+
+  // Lazily built functions are the same as the ones from
+  // GetZetaSQLFunctions().
+  TypeFactory type_factory;
+  NameToFunctionMap functions;
+  GetZetaSQLFunctions(&type_factory, options, &functions);
+  const Function* concat = lazy_functions->Find("concat");
+  ASSERT_NE(nullptr, concat);
+  EXPECT_EQ(functions["concat"]->DebugString(/*verbose=*/true),
+            concat->DebugString(/*verbose=*/true));
+  EXPECT_EQ(concat, lazy_functions->Find("concat"));
+  // Aliases and functions in namespaces.
+  EXPECT_EQ(lazy_functions->Find("char_length"),
+            lazy_functions->Find("character_length"));
+  EXPECT_NE(nullptr, lazy_functions->Find("net.host"));
+  EXPECT_EQ(nullptr, lazy_functions->Find("host"));
+  EXPECT_EQ(nullptr, lazy_functions->Find("no_such_function"));
+  EXPECT_THAT(lazy_functions->GetNamespaces(),
+              testing::IsSupersetOf({"hll_count", "kll_quantiles", "net"}));
+
+  const NameToFunctionMap& all_functions = lazy_functions->GetAll();
+  ASSERT_EQ(functions.size(), all_functions.size());
+  for (const auto& entry : functions) {
+    ASSERT_TRUE(zetasql_base::ContainsKey(all_functions, entry.first)) << entry.first;
+    EXPECT_EQ(entry.second->NumSignatures(),
+              all_functions.at(entry.first)->NumSignatures())
+        << entry.first;
+  }
+  EXPECT_EQ(concat, all_functions.at("concat").get());
+
+  // Catalogs only add the functions that are looked up, and list all of them.
+  SimpleCatalog catalog("catalog");
+  catalog.AddLazyZetaSQLFunctions(options);
+  const Function* function;
+  ZETASQL_ASSERT_OK(catalog.FindFunction({"CONCAT"}, &function));
+  EXPECT_EQ(concat, function);
+  ZETASQL_ASSERT_OK(catalog.FindFunction({"net", "host"}, &function));
+  EXPECT_EQ(lazy_functions->Find("net.host"), function);
+  EXPECT_FALSE(catalog.FindFunction({"host"}, &function).ok());
+  EXPECT_FALSE(catalog.FindFunction({"no_such_function"}, &function).ok());
+  EXPECT_THAT(catalog.function_names(), testing::Contains("abs"));
+  EXPECT_THAT(catalog.function_names(),
+              testing::Not(testing::Contains("net.host")));
+
+  catalog.ClearFunctions();
+  EXPECT_FALSE(catalog.FindFunction({"concat"}, &function).ok());
+  EXPECT_TRUE(catalog.function_names().empty());
+}
+
 TEST(SimpleBuiltinFunctionTests, NumericFunctions) {
   TypeFactory type_factory;
   NameToFunctionMap functions;
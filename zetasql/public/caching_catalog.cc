@@ -0,0 +1,225 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/caching_catalog.h"
+
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+
+bool IsCacheable(const zetasql_base::Status& status) {
+  return status.ok() || status.code() == zetasql_base::StatusCode::kNotFound;
+}
+
+}  // namespace
+
+CachingCatalog::CachingCatalog(Catalog* catalog, absl::Duration ttl,
+                               zetasql_base::Clock* clock)
+    : catalog_(catalog), ttl_(ttl), clock_(clock) {}
+
+bool CachingCatalog::LookupEntry(const Key& key, bool update_stats,
+                                 Entry* entry) {
+  const absl::Time now = clock_->TimeNow();
+  absl::MutexLock lock(&mutex_);
+  auto it = entries_.find(key);
+  const bool found = it != entries_.end() && now < it->second.expiration;
+  if (update_stats) {
+    ++(found ? stats_.hits : stats_.misses);
+  }
+  if (found) *entry = it->second;
+  return found;
+}
+
+void CachingCatalog::InsertEntry(Key key, Entry entry) {
+  if (!IsCacheable(entry.status)) return;
+  entry.expiration = clock_->TimeNow() + ttl_;
+  absl::MutexLock lock(&mutex_);
+  auto inserted = entries_.insert_or_assign(std::move(key), std::move(entry));
+  if (inserted.second) ++stats_.num_entries;
+}
+
+template <class ObjectType>
+zetasql_base::Status CachingCatalog::FindCached(ObjectKind kind,
+                                        absl::Span<const std::string> path,
+                                        const FindOptions& options,
+                                        const ObjectType** object) {
+  *object = nullptr;
+  if (options.cycle_detector() != nullptr) {
+    return catalog_->FindObject(path, object, options);
+  }
+  Key key(kind, std::vector<std::string>(path.begin(), path.end()));
+  Entry entry;
+  if (LookupEntry(key, /*update_stats=*/true, &entry)) {
+    *object = static_cast<const ObjectType*>(entry.object);
+    return entry.status;
+  }
+  entry.status = catalog_->FindObject(path, object, options);
+  entry.object = *object;
+  const zetasql_base::Status status = entry.status;
+  InsertEntry(std::move(key), std::move(entry));
+  return status;
+}
+
+zetasql_base::Status CachingCatalog::PrefetchTables(const TableNamesSet& table_names) {
+  std::vector<std::vector<std::string>> paths;
+  for (const std::vector<std::string>& path : table_names) {
+    Entry entry;
+    if (!LookupEntry(Key(ObjectKind::kTable, path), /*update_stats=*/false,
+                     &entry)) {
+      paths.push_back(path);
+    }
+  }
+  if (paths.empty()) return zetasql_base::OkStatus();
+
+  if (find_tables_callback_ == nullptr) {
+    for (const std::vector<std::string>& path : paths) {
+      const Table* table;
+      const zetasql_base::Status status = FindTable(path, &table);
+      if (!IsCacheable(status)) return status;
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  std::vector<const Table*> tables;
+  ZETASQL_RETURN_IF_ERROR(find_tables_callback_(paths, &tables));
+  ZETASQL_RET_CHECK_EQ(paths.size(), tables.size());
+  for (int i = 0; i < paths.size(); ++i) {
+    Entry entry;
+    entry.object = tables[i];
+    if (tables[i] == nullptr) {
+      entry.status = TableNotFoundError(paths[i]);
+    }
+    InsertEntry(Key(ObjectKind::kTable, std::move(paths[i])),
+                std::move(entry));
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status CachingCatalog::PrefetchTablesForStatement(
+    absl::string_view sql, const AnalyzerOptions& options) {
+  TableNamesSet table_names;
+  ZETASQL_RETURN_IF_ERROR(ExtractTableNamesFromStatement(sql, options, &table_names));
+  return PrefetchTables(table_names);
+}
+
+CachingCatalog::Stats CachingCatalog::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void CachingCatalog::Clear() {
+  absl::MutexLock lock(&mutex_);
+  entries_.clear();
+  stats_.num_entries = 0;
+}
+
+zetasql_base::Status CachingCatalog::FindTable(const absl::Span<const std::string>& path,
+                                       const Table** table,
+                                       const FindOptions& options) {
+  return FindCached(ObjectKind::kTable, path, options, table);
+}
+
+zetasql_base::Status CachingCatalog::FindModel(const absl::Span<const std::string>& path,
+                                       const Model** model,
+                                       const FindOptions& options) {
+  return FindCached(ObjectKind::kModel, path, options, model);
+}
+
+zetasql_base::Status CachingCatalog::FindConnection(
+    const absl::Span<const std::string>& path, const Connection** connection,
+    const FindOptions& options) {
+  return FindCached(ObjectKind::kConnection, path, options, connection);
+}
+
+zetasql_base::Status CachingCatalog::FindFunction(
+    const absl::Span<const std::string>& path, const Function** function,
+    const FindOptions& options) {
+  return FindCached(ObjectKind::kFunction, path, options, function);
+}
+
+zetasql_base::Status CachingCatalog::FindTableValuedFunction(
+    const absl::Span<const std::string>& path,
+    const TableValuedFunction** function, const FindOptions& options) {
+  return FindCached(ObjectKind::kTableValuedFunction, path, options, function);
+}
+
+zetasql_base::Status CachingCatalog::FindProcedure(
+    const absl::Span<const std::string>& path, const Procedure** procedure,
+    const FindOptions& options) {
+  return FindCached(ObjectKind::kProcedure, path, options, procedure);
+}
+
+zetasql_base::Status CachingCatalog::FindType(const absl::Span<const std::string>& path,
+                                      const Type** type,
+                                      const FindOptions& options) {
+  return FindCached(ObjectKind::kType, path, options, type);
+}
+
+zetasql_base::Status CachingCatalog::FindConstantWithPathPrefix(
+    const absl::Span<const std::string> path, int* num_names_consumed,
+    const Constant** constant, const FindOptions& options) {
+  *num_names_consumed = 0;
+  *constant = nullptr;
+  if (options.cycle_detector() != nullptr) {
+    return catalog_->FindConstantWithPathPrefix(path, num_names_consumed,
+                                                constant, options);
+  }
+  Key key(ObjectKind::kConstant,
+          std::vector<std::string>(path.begin(), path.end()));
+  Entry entry;
+  if (LookupEntry(key, /*update_stats=*/true, &entry)) {
+    *constant = static_cast<const Constant*>(entry.object);
+    *num_names_consumed = entry.num_names_consumed;
+    return entry.status;
+  }
+  entry.status = catalog_->FindConstantWithPathPrefix(path, num_names_consumed,
+                                                      constant, options);
+  entry.object = *constant;
+  entry.num_names_consumed = *num_names_consumed;
+  const zetasql_base::Status status = entry.status;
+  InsertEntry(std::move(key), std::move(entry));
+  return status;
+}
+
+std::string CachingCatalog::SuggestTable(
+    const absl::Span<const std::string>& mistyped_path) {
+  return catalog_->SuggestTable(mistyped_path);
+}
+
+std::string CachingCatalog::SuggestModel(
+    const absl::Span<const std::string>& mistyped_path) {
+  return catalog_->SuggestModel(mistyped_path);
+}
+
+std::string CachingCatalog::SuggestFunction(
+    const absl::Span<const std::string>& mistyped_path) {
+  return catalog_->SuggestFunction(mistyped_path);
+}
+
+std::string CachingCatalog::SuggestTableValuedFunction(
+    const absl::Span<const std::string>& mistyped_path) {
+  return catalog_->SuggestTableValuedFunction(mistyped_path);
+}
+
+std::string CachingCatalog::SuggestConstant(
+    const absl::Span<const std::string>& mistyped_path) {
+  return catalog_->SuggestConstant(mistyped_path);
+}
+
+}  // namespace zetasql
@@ -0,0 +1,189 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_CACHING_CATALOG_H_
+#define ZETASQL_PUBLIC_CACHING_CATALOG_H_
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+#include "zetasql/base/clock.h"
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/catalog.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+// A Catalog that forwards lookups to another Catalog and remembers their
+// results, including lookups that found nothing. This is meant for Catalogs
+// that are expensive to query, e.g. Catalogs backed by a remote metadata
+// service. The resolver looks up the same paths many times while analyzing a
+// statement, and many of those lookups are misses while it tries prefixes of
+// paths as nested catalogs, tables or constants.
+//
+// Results are cached for <ttl> after the lookup. A CachingCatalog with an
+// infinite <ttl> that is created for one analysis and then destroyed caches
+// per analysis; a long-lived one with a finite <ttl> caches across analyses.
+// Only successful lookups and NOT_FOUND errors are cached; other errors are
+// returned as is and looked up again next time. Lookups with a
+// cycle_detector() in their FindOptions are not cached, since they must reach
+// the wrapped Catalog to detect cycles.
+//
+// Objects of the wrapped Catalog are returned while they are cached, so they
+// must stay valid at least until they expire or Clear() is called.
+//
+// This class is thread-safe if the wrapped Catalog is.
+class CachingCatalog : public Catalog {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t num_entries = 0;
+  };
+
+  // Looks up tables for several paths in one request, e.g. one round trip to
+  // a metadata service. Sets <*tables> to the tables on <paths>, in the same
+  // order, with NULLs for paths that have no table.
+  using FindTablesCallback = std::function<zetasql_base::Status(
+      const std::vector<std::vector<std::string>>& paths,
+      std::vector<const Table*>* tables)>;
+
+  // <catalog> and <clock> must outlive this object.
+  explicit CachingCatalog(
+      Catalog* catalog, absl::Duration ttl = absl::InfiniteDuration(),
+      zetasql_base::Clock* clock = zetasql_base::Clock::RealClock());
+  CachingCatalog(const CachingCatalog&) = delete;
+  CachingCatalog& operator=(const CachingCatalog&) = delete;
+
+  // Sets the callback that PrefetchTables() uses. Without one,
+  // PrefetchTables() looks up the tables one by one.
+  void set_find_tables_callback(FindTablesCallback callback) {
+    find_tables_callback_ = std::move(callback);
+  }
+
+  // Looks up the tables on <table_names> that are not cached yet, with one
+  // call to the FindTablesCallback, and caches the results.
+  zetasql_base::Status PrefetchTables(const TableNamesSet& table_names);
+
+  // Calls PrefetchTables() with the tables that <sql> references, as
+  // returned by ExtractTableNamesFromStatement().
+  zetasql_base::Status PrefetchTablesForStatement(absl::string_view sql,
+                                          const AnalyzerOptions& options);
+
+  Stats GetStats() const;
+
+  // Removes all the cached results. Does not reset the hit/miss counters.
+  void Clear();
+
+  std::string FullName() const override { return catalog_->FullName(); }
+
+  zetasql_base::Status FindTable(const absl::Span<const std::string>& path,
+                         const Table** table,
+                         const FindOptions& options = FindOptions()) override;
+  zetasql_base::Status FindModel(const absl::Span<const std::string>& path,
+                         const Model** model,
+                         const FindOptions& options = FindOptions()) override;
+  zetasql_base::Status FindConnection(const absl::Span<const std::string>& path,
+                              const Connection** connection,
+                              const FindOptions& options) override;
+  zetasql_base::Status FindFunction(
+      const absl::Span<const std::string>& path, const Function** function,
+      const FindOptions& options = FindOptions()) override;
+  zetasql_base::Status FindTableValuedFunction(
+      const absl::Span<const std::string>& path,
+      const TableValuedFunction** function,
+      const FindOptions& options = FindOptions()) override;
+  zetasql_base::Status FindProcedure(
+      const absl::Span<const std::string>& path, const Procedure** procedure,
+      const FindOptions& options = FindOptions()) override;
+  zetasql_base::Status FindType(const absl::Span<const std::string>& path,
+                        const Type** type,
+                        const FindOptions& options = FindOptions()) override;
+  zetasql_base::Status FindConstantWithPathPrefix(
+      const absl::Span<const std::string> path, int* num_names_consumed,
+      const Constant** constant,
+      const FindOptions& options = FindOptions()) override;
+
+  std::string SuggestTable(
+      const absl::Span<const std::string>& mistyped_path) override;
+  std::string SuggestModel(
+      const absl::Span<const std::string>& mistyped_path) override;
+  std::string SuggestFunction(
+      const absl::Span<const std::string>& mistyped_path) override;
+  std::string SuggestTableValuedFunction(
+      const absl::Span<const std::string>& mistyped_path) override;
+  std::string SuggestConstant(
+      const absl::Span<const std::string>& mistyped_path) override;
+
+ private:
+  enum class ObjectKind {
+    kTable,
+    kModel,
+    kConnection,
+    kFunction,
+    kTableValuedFunction,
+    kProcedure,
+    kType,
+    kConstant,
+  };
+
+  using Key = std::pair<ObjectKind, std::vector<std::string>>;
+
+  struct Entry {
+    // OK or NOT_FOUND.
+    zetasql_base::Status status;
+    const void* object = nullptr;
+    // Only used for constants.
+    int num_names_consumed = 0;
+    absl::Time expiration;
+  };
+
+  // Returns true and sets <*entry> if <key> has an unexpired entry. Counts a
+  // hit or a miss if <update_stats>.
+  bool LookupEntry(const Key& key, bool update_stats, Entry* entry)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Caches <entry> for <key> if its status is cacheable.
+  void InsertEntry(Key key, Entry entry) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Implements the FindX methods other than FindConstantWithPathPrefix.
+  template <class ObjectType>
+  zetasql_base::Status FindCached(ObjectKind kind, absl::Span<const std::string> path,
+                          const FindOptions& options,
+                          const ObjectType** object);
+
+  Catalog* catalog_;  // Not owned.
+  const absl::Duration ttl_;
+  zetasql_base::Clock* clock_;  // Not owned.
+  FindTablesCallback find_tables_callback_;
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<Key, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_CACHING_CATALOG_H_
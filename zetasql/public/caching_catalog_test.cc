@@ -0,0 +1,178 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/caching_catalog.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/clock.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace zetasql {
+namespace {
+
+using testing::ElementsAre;
+using zetasql_base::testing::StatusIs;
+
+// A SimpleCatalog that counts the tables and types it is asked for.
+class CountingCatalog : public SimpleCatalog {
+ public:
+  CountingCatalog() : SimpleCatalog("counting") {}
+
+  zetasql_base::Status FindTable(const absl::Span<const std::string>& path,
+                         const Table** table,
+                         const FindOptions& options) override {
+    ++num_table_lookups;
+    return SimpleCatalog::FindTable(path, table, options);
+  }
+
+  zetasql_base::Status FindType(const absl::Span<const std::string>& path,
+                        const Type** type,
+                        const FindOptions& options) override {
+    ++num_type_lookups;
+    if (fail_type_lookups) {
+      return zetasql_base::Status(zetasql_base::StatusCode::kUnavailable, "down");
+    }
+    return SimpleCatalog::FindType(path, type, options);
+  }
+
+  int num_table_lookups = 0;
+  int num_type_lookups = 0;
+  bool fail_type_lookups = false;
+};
+
+class CachingCatalogTest : public ::testing::Test {
+ protected:
+  CachingCatalogTest() {
+    catalog_.AddTable(&table_);
+    catalog_.AddType("MyInt", types::Int64Type());
+  }
+
+  SimpleTable table_{"T", {{"a", types::Int64Type()}}};
+  CountingCatalog catalog_;
+  zetasql_base::SimulatedClock clock_;
+};
+
+TEST_F(CachingCatalogTest, CachesHitsAndMisses) {
+  CachingCatalog caching_catalog(&catalog_);
+  const Table* table;
+  for (int i = 0; i < 3; ++i) {
+    ZETASQL_ASSERT_OK(caching_catalog.FindTable({"T"}, &table));
+    EXPECT_EQ(&table_, table);
+    EXPECT_THAT(caching_catalog.FindTable({"NoSuchTable"}, &table),
+                StatusIs(zetasql_base::StatusCode::kNotFound, testing::_));
+    EXPECT_EQ(nullptr, table);
+  }
+  EXPECT_EQ(2, catalog_.num_table_lookups);
+  const CachingCatalog::Stats stats = caching_catalog.GetStats();
+  EXPECT_EQ(4, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+  EXPECT_EQ(2, stats.num_entries);
+
+  // Other kinds of objects on the same path are separate entries.
+  const Type* type;
+  EXPECT_FALSE(caching_catalog.FindType({"T"}, &type).ok());
+  ZETASQL_ASSERT_OK(caching_catalog.FindType({"MyInt"}, &type));
+  EXPECT_TRUE(type->IsInt64());
+  EXPECT_EQ(2, catalog_.num_type_lookups);
+
+  caching_catalog.Clear();
+  ZETASQL_ASSERT_OK(caching_catalog.FindTable({"T"}, &table));
+  EXPECT_EQ(3, catalog_.num_table_lookups);
+}
+
+TEST_F(CachingCatalogTest, DoesNotCacheOtherErrors) {
+  CachingCatalog caching_catalog(&catalog_);
+  catalog_.fail_type_lookups = true;
+  const Type* type;
+  EXPECT_THAT(caching_catalog.FindType({"MyInt"}, &type),
+              StatusIs(zetasql_base::StatusCode::kUnavailable, testing::_));
+  catalog_.fail_type_lookups = false;
+  ZETASQL_ASSERT_OK(caching_catalog.FindType({"MyInt"}, &type));
+  ZETASQL_ASSERT_OK(caching_catalog.FindType({"MyInt"}, &type));
+  EXPECT_EQ(2, catalog_.num_type_lookups);
+}
+
+TEST_F(CachingCatalogTest, Expiration) {
+  CachingCatalog caching_catalog(&catalog_, absl::Seconds(10), &clock_);
+  const Table* table;
+  ZETASQL_ASSERT_OK(caching_catalog.FindTable({"T"}, &table));
+  clock_.AdvanceTime(absl::Seconds(9));
+  ZETASQL_ASSERT_OK(caching_catalog.FindTable({"T"}, &table));
+  EXPECT_EQ(1, catalog_.num_table_lookups);
+  clock_.AdvanceTime(absl::Seconds(1));
+  ZETASQL_ASSERT_OK(caching_catalog.FindTable({"T"}, &table));
+  EXPECT_EQ(2, catalog_.num_table_lookups);
+  EXPECT_EQ(1, caching_catalog.GetStats().num_entries);
+}
+
+TEST_F(CachingCatalogTest, PrefetchTables) {
+  CachingCatalog caching_catalog(&catalog_);
+  std::vector<std::vector<std::vector<std::string>>> requests;
+  caching_catalog.set_find_tables_callback(
+      [this, &requests](const std::vector<std::vector<std::string>>& paths,
+                        std::vector<const Table*>* tables) {
+        requests.push_back(paths);
+        for (const std::vector<std::string>& path : paths) {
+          tables->push_back(path == std::vector<std::string>{"T"} ? &table_
+                                                                   : nullptr);
+        }
+        return zetasql_base::OkStatus();
+      });
+
+  const Table* table;
+  ZETASQL_ASSERT_OK(caching_catalog.FindTable({"T"}, &table));
+  ZETASQL_ASSERT_OK(caching_catalog.PrefetchTablesForStatement(
+      "SELECT * FROM T JOIN U USING (a) JOIN V USING (a)", AnalyzerOptions()));
+  // "T" was cached already.
+  EXPECT_THAT(requests, ElementsAre(ElementsAre(
+                            std::vector<std::string>{"U"},
+                            std::vector<std::string>{"V"})));
+
+  EXPECT_THAT(caching_catalog.FindTable({"U"}, &table),
+              StatusIs(zetasql_base::StatusCode::kNotFound, testing::_));
+  EXPECT_THAT(caching_catalog.FindTable({"V"}, &table),
+              StatusIs(zetasql_base::StatusCode::kNotFound, testing::_));
+  EXPECT_EQ(1, catalog_.num_table_lookups);
+
+  // Everything is cached now.
+  ZETASQL_ASSERT_OK(caching_catalog.PrefetchTablesForStatement(
+      "SELECT * FROM T JOIN U USING (a)", AnalyzerOptions()));
+  EXPECT_EQ(1, requests.size());
+}
+
+TEST_F(CachingCatalogTest, Analysis) {
+  CachingCatalog caching_catalog(&catalog_);
+  TypeFactory type_factory;
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<const AnalyzerOutput> output;
+    ZETASQL_ASSERT_OK(AnalyzeStatement("SELECT a, CAST(a AS MyInt) FROM T",
+                               AnalyzerOptions(), &caching_catalog,
+                               &type_factory, &output));
+  }
+  EXPECT_EQ(1, catalog_.num_table_lookups);
+  EXPECT_EQ(1, catalog_.num_type_lookups);
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -41,9 +41,11 @@
 #include "zetasql/public/strings.h"
 #include "zetasql/public/type.pb.h"
 #include <cstdint>
+#include "absl/container/fixed_array.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/str_split.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/status.h"
@@ -351,7 +353,7 @@ static zetasql_base::StatusOr<Value> NumericToString(const Value& v) {
   std::string str;
   zetasql_base::Status error;
   if (zetasql::functions::NumericToString<T>(value, &str, &error)) {
-    return Value::String(str);
+    return Value::String(std::move(str));
   } else {
     return error;
   }
@@ -367,7 +369,7 @@ static zetasql_base::StatusOr<Value> NumericToString(const Value& v) {
 template <typename T>
 static zetasql_base::StatusOr<Value> StringToNumeric(const Value& v) {
   if (v.is_null()) return Value::MakeNull<T>();
-  std::string value = v.string_value();
+  const std::string& value = v.string_value();
   T out;
   zetasql_base::Status error;
   if (zetasql::functions::StringToNumeric<T>(value, &out, &error)) {
@@ -377,6 +379,124 @@ static zetasql_base::StatusOr<Value> StringToNumeric(const Value& v) {
   }
 }
 
+// Batch versions of NumericToString() and StringToNumeric() above, for
+// CastValues().  Only the non-NULL values are converted.
+template <typename T>
+static zetasql_base::Status NumericsToStrings(absl::Span<const Value> values,
+                                      std::vector<Value>* out) {
+  // Not a std::vector, which is specialized for bool.
+  absl::FixedArray<T> numerics(values.size());
+  size_t num_numerics = 0;
+  for (const Value& value : values) {
+    if (!value.is_null()) numerics[num_numerics++] = value.Get<T>();
+  }
+  std::vector<std::string> strings(num_numerics);
+  zetasql::functions::NumericToStringBatch<T>(
+      absl::MakeConstSpan(numerics.data(), num_numerics),
+      absl::MakeSpan(strings));
+  out->reserve(values.size());
+  auto string = strings.begin();
+  for (const Value& value : values) {
+    out->push_back(value.is_null() ? Value::NullString()
+                                   : Value::String(std::move(*string++)));
+  }
+  return zetasql_base::OkStatus();
+}
+
+template <typename T>
+static zetasql_base::Status StringsToNumerics(absl::Span<const Value> values,
+                                      std::vector<Value>* out) {
+  std::vector<absl::string_view> strings;
+  strings.reserve(values.size());
+  for (const Value& value : values) {
+    if (!value.is_null()) strings.push_back(value.string_value());
+  }
+  // Not a std::vector, which is specialized for bool.
+  absl::FixedArray<T> numerics(strings.size());
+  zetasql_base::Status error;
+  if (zetasql::functions::StringToNumericBatch<T>(
+          strings, absl::MakeSpan(numerics), /*failed=*/nullptr, &error) > 0) {
+    return error;
+  }
+  out->reserve(values.size());
+  auto numeric = numerics.begin();
+  for (const Value& value : values) {
+    out->push_back(value.is_null() ? Value::MakeNull<T>()
+                                   : Value::Make<T>(*numeric++));
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::StatusOr<std::vector<Value>> CastValues(
+    absl::Span<const Value> from_values, absl::TimeZone default_timezone,
+    const LanguageOptions& language_options, const Type* to_type) {
+  std::vector<Value> result;
+  if (from_values.empty()) return result;
+  const Type* from_type = from_values[0].type();
+  zetasql_base::Status status;
+  // All these casts are valid, and cast NULLs to NULLs.
+  switch (FCT(from_type->kind(), to_type->kind())) {
+    case FCT(TYPE_INT32, TYPE_STRING):
+      status = NumericsToStrings<int32_t>(from_values, &result);
+      break;
+    case FCT(TYPE_INT64, TYPE_STRING):
+      status = NumericsToStrings<int64_t>(from_values, &result);
+      break;
+    case FCT(TYPE_UINT32, TYPE_STRING):
+      status = NumericsToStrings<uint32_t>(from_values, &result);
+      break;
+    case FCT(TYPE_UINT64, TYPE_STRING):
+      status = NumericsToStrings<uint64_t>(from_values, &result);
+      break;
+    case FCT(TYPE_BOOL, TYPE_STRING):
+      status = NumericsToStrings<bool>(from_values, &result);
+      break;
+    case FCT(TYPE_FLOAT, TYPE_STRING):
+      status = NumericsToStrings<float>(from_values, &result);
+      break;
+    case FCT(TYPE_DOUBLE, TYPE_STRING):
+      status = NumericsToStrings<double>(from_values, &result);
+      break;
+    case FCT(TYPE_STRING, TYPE_BOOL):
+      status = StringsToNumerics<bool>(from_values, &result);
+      break;
+    case FCT(TYPE_STRING, TYPE_INT32):
+      status = StringsToNumerics<int32_t>(from_values, &result);
+      break;
+    case FCT(TYPE_STRING, TYPE_INT64):
+      status = StringsToNumerics<int64_t>(from_values, &result);
+      break;
+    case FCT(TYPE_STRING, TYPE_UINT32):
+      status = StringsToNumerics<uint32_t>(from_values, &result);
+      break;
+    case FCT(TYPE_STRING, TYPE_UINT64):
+      status = StringsToNumerics<uint64_t>(from_values, &result);
+      break;
+    case FCT(TYPE_STRING, TYPE_FLOAT):
+      status = StringsToNumerics<float>(from_values, &result);
+      break;
+    case FCT(TYPE_STRING, TYPE_DOUBLE):
+      status = StringsToNumerics<double>(from_values, &result);
+      break;
+    default:
+      // The other casts go one value at a time.
+      result.reserve(from_values.size());
+      for (const Value& value : from_values) {
+        DCHECK(value.type()->Equals(from_type));
+        if (value.is_null()) {
+          result.push_back(Value::Null(to_type));
+          continue;
+        }
+        ZETASQL_ASSIGN_OR_RETURN(Value casted, CastValue(value, default_timezone,
+                                                 language_options, to_type));
+        result.push_back(std::move(casted));
+      }
+      return result;
+  }
+  ZETASQL_RETURN_IF_ERROR(status);
+  return result;
+}
+
 zetasql_base::StatusOr<Value> CastValue(const Value& from_value,
                                 absl::TimeZone default_timezone,
                                 const LanguageOptions& language_options,
@@ -815,16 +935,9 @@ zetasql_base::StatusOr<Value> CastValue(const Value& from_value,
       }
 
       const Type* to_element_type = to_type->AsArray()->element_type();
-      std::vector<Value> casted_elements(v.num_elements());
-      for (int i = 0; i < v.num_elements(); ++i) {
-        if (v.element(i).is_null()) {
-          casted_elements[i] = Value::Null(to_element_type);
-        } else {
-          ZETASQL_ASSIGN_OR_RETURN(casted_elements[i],
-                           CastValue(v.element(i), default_timezone,
-                                     language_options, to_element_type));
-        }
-      }
+      ZETASQL_ASSIGN_OR_RETURN(std::vector<Value> casted_elements,
+                       CastValues(v.elements(), default_timezone,
+                                  language_options, to_element_type));
       return InternalValue::ArrayChecked(to_type->AsArray(),
                                          InternalValue::order_kind(v),
                                          std::move(casted_elements));
@@ -17,10 +17,13 @@
 #ifndef ZETASQL_PUBLIC_CAST_H_
 #define ZETASQL_PUBLIC_CAST_H_
 
+#include <vector>
+
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "zetasql/base/statusor.h"
 
 // The full specification for ZetaSQL casting and coercion is at:
@@ -107,6 +110,16 @@ zetasql_base::StatusOr<Value> CastValue(const Value& from_value,
                                 absl::TimeZone default_timezone,
                                 const LanguageOptions& language_options,
                                 const Type* to_type);
+// Casts each of <from_values>, which must all have the same type, to
+// <to_type>, like CastValue() on each of them.  The casts between STRING and
+// the numeric types convert all the values in one batch.  Like the elements of
+// an array cast, NULLs are always cast to NULLs of <to_type>; CastValue()
+// also checks that a NULL of a complex type is castable.  Returns the error of
+// the first value that fails to cast.
+zetasql_base::StatusOr<std::vector<Value>> CastValues(
+    absl::Span<const Value> from_values, absl::TimeZone default_timezone,
+    const LanguageOptions& language_options, const Type* to_type);
+
 // DEPRECATED name for CastValue()
 inline zetasql_base::StatusOr<Value> CastStatusOrValue(
     const Value& from_value, absl::TimeZone default_timezone,
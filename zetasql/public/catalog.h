@@ -506,6 +506,29 @@ class Table {
     return std::optional<std::vector<int>>();
   }
 
+  // Returns an estimate of the number of rows in this table, or an empty
+  // std::optional if it is unknown.
+  //
+  // Not used for zetasql analysis. The reference implementation uses it to
+  // choose which input of a join it loads into memory. Estimates do not need
+  // to be exact, but plans are only as good as the estimates.
+  virtual std::optional<int64_t> GetRowCountEstimate() const {
+    return std::optional<int64_t>();
+  }
+
+  // Returns the ordinal indexes of the columns that the rows returned by the
+  // EvaluatorTableIterators of this table are sorted on, or an empty
+  // std::optional if their order is unspecified. The rows are sorted in
+  // ascending order with NULLs first on the first column, ties are sorted on
+  // the second column, and so on. Iterators that skip rows (e.g., because of
+  // ColumnFilters) must still return the other rows in this order.
+  //
+  // Not used for zetasql analysis. The reference implementation uses it to join
+  // tables that are sorted on their join keys with a merge join.
+  virtual std::optional<std::vector<int>> GetSortOrder() const {
+    return std::optional<std::vector<int>>();
+  }
+
   // This function returns nullptr for anonymous or duplicate column names.
   // TODO: The Table interface allows anonymous and duplicate columns,
   //                but the only way to access them is through GetColumn().
@@ -543,6 +566,68 @@ class Table {
            << " does not support the API in evaluator.h";
   }
 
+  // Returns true if CreateEvaluatorTableIteratorWithPredicate() should be used
+  // instead of CreateEvaluatorTableIterator() to scan this table when a query
+  // filters it.
+  virtual bool SupportsEvaluatorPredicatePushdown() const { return false; }
+
+  // Like CreateEvaluatorTableIterator(), but also receives the conjuncts of a
+  // filter on the scan that the evaluator was able to express as
+  // ColumnPredicates (in terms of the index of a column in 'column_idxs').
+  // 'column_idxs' contains exactly the columns that the query references.
+  //
+  // 'conjuncts' is the same size as 'fully_handled', which is initially all
+  // false. The iterator may skip any rows that do not satisfy all the
+  // conjuncts. The implementation should set the element of 'fully_handled'
+  // for each conjunct that the iterator is guaranteed to satisfy on every
+  // returned row; the evaluator then does not re-apply that conjunct. (Other
+  // conjuncts may still be used on a best-effort basis.)
+  //
+  // Only called if SupportsEvaluatorPredicatePushdown() returns true. The
+  // default implementation ignores the conjuncts.
+  virtual zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+  CreateEvaluatorTableIteratorWithPredicate(
+      absl::Span<const int> column_idxs,
+      absl::Span<const ColumnPredicate* const> conjuncts,
+      std::vector<bool>* fully_handled) const {
+    return CreateEvaluatorTableIterator(column_idxs);
+  }
+
+  // Returns true if CreateEvaluatorTableIteratorForKeys() can look up the rows
+  // of this table by the values of their PrimaryKey() columns faster than
+  // scanning the table.
+  virtual bool SupportsEvaluatorKeyLookups() const { return false; }
+
+  // Like CreateEvaluatorTableIterator(), but only returns the rows whose
+  // PrimaryKey() columns are equal to the values of one of 'keys'. Each
+  // element of 'keys' has one non-NULL value per column of PrimaryKey(), in
+  // the same order, each of the type of that column. 'keys' may contain keys
+  // that match no row. If GetSortOrder() is set, the rows must be returned in
+  // that order.
+  //
+  // The reference implementation uses this to join a small input with a large
+  // table on its primary key. Only called if SupportsEvaluatorKeyLookups()
+  // returns true.
+  virtual zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+  CreateEvaluatorTableIteratorForKeys(
+      absl::Span<const int> column_idxs,
+      absl::Span<const std::vector<Value>> keys) const {
+    return zetasql_base::UnimplementedErrorBuilder()
+           << "Table " << FullName() << " does not support key lookups";
+  }
+
+  // Returns a token identifying the current contents of this table as seen
+  // by CreateEvaluatorTableIterator() and its variants, or nullopt if the
+  // contents cannot be versioned. Two calls must return the same token only
+  // if the iterators would return the same rows in between.
+  //
+  // The evaluator uses this to key its result cache (see
+  // EvaluatorOptions::max_result_cache_byte_size); queries that scan a table
+  // with no version are never cached.
+  virtual std::optional<std::string> GetEvaluatorContentsVersion() const {
+    return std::optional<std::string>();
+  }
+
   // Returns whether or not this Table is a specific table interface or
   // implementation.
   template <class TableSubclass>
@@ -402,4 +402,32 @@ std::string DatetimeValue::DebugString() const {
   return std::string(output);
 }
 
+void EncodePacked64TimeMicros(absl::Span<const TimeValue> input,
+                              absl::Span<int64_t> output) {
+  for (int i = 0; i < input.size(); ++i) {
+    output[i] = input[i].Packed64TimeMicros();
+  }
+}
+
+void DecodePacked64TimeMicros(absl::Span<const int64_t> input,
+                              absl::Span<TimeValue> output) {
+  for (int i = 0; i < input.size(); ++i) {
+    output[i] = TimeValue::FromPacked64Micros(input[i]);
+  }
+}
+
+void EncodePacked64DatetimeMicros(absl::Span<const DatetimeValue> input,
+                                  absl::Span<int64_t> output) {
+  for (int i = 0; i < input.size(); ++i) {
+    output[i] = input[i].Packed64DatetimeMicros();
+  }
+}
+
+void DecodePacked64DatetimeMicros(absl::Span<const int64_t> input,
+                                  absl::Span<DatetimeValue> output) {
+  for (int i = 0; i < input.size(); ++i) {
+    output[i] = DatetimeValue::FromPacked64Micros(input[i]);
+  }
+}
+
 }  // namespace zetasql
@@ -18,9 +18,11 @@
 #define ZETASQL_PUBLIC_CIVIL_TIME_H_
 
 #include <string>
+#include <utility>
 
 #include <cstdint>
 #include "absl/time/civil_time.h"
+#include "absl/types/span.h"
 
 namespace zetasql {
 
@@ -198,6 +200,24 @@ class TimeValue {
   // Pack the hour/minute/second/nanos into a bit field.
   int64_t Packed64TimeNanos() const;
 
+  // Valid values compare and hash by their packed encoding, which preserves
+  // their order, without decoding anything.
+  bool operator==(const TimeValue& that) const {
+    return Packed64TimeNanos() == that.Packed64TimeNanos();
+  }
+  bool operator!=(const TimeValue& that) const { return !(*this == that); }
+  bool operator<(const TimeValue& that) const {
+    return Packed64TimeNanos() < that.Packed64TimeNanos();
+  }
+  bool operator>(const TimeValue& that) const { return that < *this; }
+  bool operator<=(const TimeValue& that) const { return !(that < *this); }
+  bool operator>=(const TimeValue& that) const { return !(*this < that); }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const TimeValue& v) {
+    return H::combine(std::move(h), v.Packed64TimeNanos());
+  }
+
  private:
   static TimeValue FromHMSAndNanosInternal(int64_t hour, int64_t minute,
                                            int64_t second, int64_t nanosecond);
@@ -346,6 +366,29 @@ class DatetimeValue {
   // It's impossible to encode all fields for Datetime with nano precision in a
   // single 8 byte integer, so there is no packing function for that.
 
+  // Valid values compare and hash by their packed seconds and their
+  // nanoseconds, which preserve their order, without decoding anything.
+  bool operator==(const DatetimeValue& that) const {
+    return Packed64DatetimeSeconds() == that.Packed64DatetimeSeconds() &&
+           nanosecond_ == that.nanosecond_;
+  }
+  bool operator!=(const DatetimeValue& that) const { return !(*this == that); }
+  bool operator<(const DatetimeValue& that) const {
+    const int64_t seconds = Packed64DatetimeSeconds();
+    const int64_t that_seconds = that.Packed64DatetimeSeconds();
+    return seconds < that_seconds ||
+           (seconds == that_seconds && nanosecond_ < that.nanosecond_);
+  }
+  bool operator>(const DatetimeValue& that) const { return that < *this; }
+  bool operator<=(const DatetimeValue& that) const { return !(that < *this); }
+  bool operator>=(const DatetimeValue& that) const { return !(*this < that); }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const DatetimeValue& v) {
+    return H::combine(std::move(h), v.Packed64DatetimeSeconds(),
+                      v.nanosecond_);
+  }
+
   absl::CivilSecond ConvertToCivilSecond() const {
     return absl::CivilSecond(year_, month_, day_, hour_, minute_, second_);
   }
@@ -372,6 +415,21 @@ class DatetimeValue {
   // Copyable
 };
 
+// Batch versions of Packed64TimeMicros(), Packed64DatetimeMicros() and the
+// FromPacked64Micros() factories, for converting a column of values at once.
+// <output> must be at least as large as <input>.  Decoding an invalid bit
+// field produces an invalid value, like the factories do.  The packed
+// encodings of valid values sort like the values, so sorting or grouping
+// values by their encoding does not need to decode them.
+void EncodePacked64TimeMicros(absl::Span<const TimeValue> input,
+                              absl::Span<int64_t> output);
+void DecodePacked64TimeMicros(absl::Span<const int64_t> input,
+                              absl::Span<TimeValue> output);
+void EncodePacked64DatetimeMicros(absl::Span<const DatetimeValue> input,
+                                  absl::Span<int64_t> output);
+void DecodePacked64DatetimeMicros(absl::Span<const int64_t> input,
+                                  absl::Span<DatetimeValue> output);
+
 // Masks of micros and nanos are always used on the least significant bits.
 static const unsigned int kMicrosMask = 0xFFFFF;     // 20 bits
 static const int kMicrosShift = 20;
@@ -22,7 +22,9 @@
 #include "zetasql/base/logging.h"
 #include "gtest/gtest.h"
 #include <cstdint>
+#include "absl/hash/hash.h"
 #include "absl/time/civil_time.h"
+#include "absl/types/span.h"
 
 using zetasql::TimeValue;
 using zetasql::DatetimeValue;
@@ -539,4 +541,86 @@ TEST(CivilTimeValuesTest, DatetimeValueNormalizationTest) {
   ASSERT_FALSE(datetime.IsValid());
 }
 
+TEST(CivilTimeValuesTest, ComparisonAndHashing) {
+  // In increasing order.
+  const std::vector<DatetimeValue> datetimes = {
+      DatetimeValue::FromYMDHMSAndNanos(1, 1, 1, 0, 0, 0, 0),
+      DatetimeValue::FromYMDHMSAndNanos(1, 1, 1, 0, 0, 0, 1),
+      DatetimeValue::FromYMDHMSAndNanos(1970, 1, 1, 0, 0, 0, 999999999),
+      DatetimeValue::FromYMDHMSAndNanos(1970, 1, 1, 0, 0, 1, 0),
+      DatetimeValue::FromYMDHMSAndNanos(1970, 1, 1, 23, 59, 59, 0),
+      DatetimeValue::FromYMDHMSAndNanos(1970, 1, 2, 0, 0, 0, 0),
+      DatetimeValue::FromYMDHMSAndNanos(1970, 12, 31, 0, 0, 0, 0),
+      DatetimeValue::FromYMDHMSAndNanos(9999, 12, 31, 23, 59, 59, 999999999)};
+  const std::vector<TimeValue> times = {
+      TimeValue::FromHMSAndNanos(0, 0, 0, 0),
+      TimeValue::FromHMSAndNanos(0, 0, 0, 999999999),
+      TimeValue::FromHMSAndNanos(0, 0, 1, 0),
+      TimeValue::FromHMSAndNanos(0, 59, 59, 0),
+      TimeValue::FromHMSAndNanos(1, 0, 0, 0),
+      TimeValue::FromHMSAndNanos(23, 59, 59, 999999999)};
+  for (int i = 0; i < datetimes.size(); ++i) {
+    ASSERT_TRUE(datetimes[i].IsValid());
+    for (int j = 0; j < datetimes.size(); ++j) {
+      EXPECT_EQ(i < j, datetimes[i] < datetimes[j]) << i << " " << j;
+      EXPECT_EQ(i == j, datetimes[i] == datetimes[j]) << i << " " << j;
+      EXPECT_EQ(i >= j, datetimes[i] >= datetimes[j]) << i << " " << j;
+      // The micros encoding drops the nanoseconds of datetimes[1].
+      if (i < j) {
+        EXPECT_LE(datetimes[i].Packed64DatetimeMicros(),
+                  datetimes[j].Packed64DatetimeMicros());
+      }
+    }
+  }
+  for (int i = 0; i < times.size(); ++i) {
+    ASSERT_TRUE(times[i].IsValid());
+    for (int j = 0; j < times.size(); ++j) {
+      EXPECT_EQ(i < j, times[i] < times[j]) << i << " " << j;
+      EXPECT_EQ(i == j, times[i] == times[j]) << i << " " << j;
+      EXPECT_EQ(i > j, times[i] > times[j]) << i << " " << j;
+      EXPECT_EQ(i < j,
+                times[i].Packed64TimeMicros() < times[j].Packed64TimeMicros());
+    }
+  }
+  EXPECT_EQ(absl::Hash<DatetimeValue>()(datetimes[2]),
+            absl::Hash<DatetimeValue>()(DatetimeValue::FromYMDHMSAndNanos(
+                1970, 1, 1, 0, 0, 0, 999999999)));
+  EXPECT_EQ(absl::Hash<TimeValue>()(times[3]),
+            absl::Hash<TimeValue>()(TimeValue::FromHMSAndNanos(0, 59, 59, 0)));
+}
+
+TEST(CivilTimeValuesTest, BatchEncodingDecoding) {
+  const std::vector<DatetimeValue> datetimes = {
+      DatetimeValue::FromYMDHMSAndMicros(1, 1, 1, 0, 0, 0, 0),
+      DatetimeValue::FromYMDHMSAndMicros(2006, 1, 2, 3, 4, 5, 123456),
+      DatetimeValue::FromYMDHMSAndMicros(9999, 12, 31, 23, 59, 59, 999999)};
+  std::vector<int64_t> packed(datetimes.size());
+  zetasql::EncodePacked64DatetimeMicros(datetimes, absl::MakeSpan(packed));
+  std::vector<DatetimeValue> decoded_datetimes(datetimes.size());
+  zetasql::DecodePacked64DatetimeMicros(packed,
+                                          absl::MakeSpan(decoded_datetimes));
+  for (int i = 0; i < datetimes.size(); ++i) {
+    EXPECT_EQ(datetimes[i].Packed64DatetimeMicros(), packed[i]);
+    EXPECT_EQ(datetimes[i], decoded_datetimes[i]);
+  }
+
+  const std::vector<TimeValue> times = {
+      TimeValue::FromHMSAndMicros(0, 0, 0, 0),
+      TimeValue::FromHMSAndMicros(12, 34, 56, 654321),
+      TimeValue::FromHMSAndMicros(23, 59, 59, 999999)};
+  packed.resize(times.size());
+  zetasql::EncodePacked64TimeMicros(times, absl::MakeSpan(packed));
+  std::vector<TimeValue> decoded_times(times.size());
+  zetasql::DecodePacked64TimeMicros(packed, absl::MakeSpan(decoded_times));
+  for (int i = 0; i < times.size(); ++i) {
+    EXPECT_EQ(times[i].Packed64TimeMicros(), packed[i]);
+    EXPECT_EQ(times[i], decoded_times[i]);
+  }
+
+  // An invalid bit field decodes to an invalid value.
+  zetasql::DecodePacked64TimeMicros({int64_t{-1}},
+                                      absl::MakeSpan(decoded_times).first(1));
+  EXPECT_FALSE(decoded_times[0].IsValid());
+}
+
 }  // namespace
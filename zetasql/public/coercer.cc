@@ -548,6 +548,11 @@ bool Coercer::CoercesTo(const InputArgumentType& from_argument,
     // result type for 'ROUND(NULL)', etc.
     return true;
   }
+  if ((from_argument.type()->IsStruct() || from_argument.type()->IsArray()) &&
+      !from_argument.is_literal() && !from_argument.is_query_parameter()) {
+    return CompoundTypeCoercesTo(from_argument.type(), to_type, is_explicit,
+                                 result);
+  }
   if (from_argument.type()->IsStruct()) {
     return StructCoercesTo(from_argument, to_type, is_explicit, result);
   }
@@ -611,6 +616,48 @@ bool Coercer::ParameterCoercesTo(const Type* from_type, const Type* to_type,
   return false;
 }
 
+bool Coercer::CompoundTypeCoercesTo(const Type* from_type,
+                                    const Type* to_type, bool is_explicit,
+                                    SignatureMatchResult* result) const {
+  const CoercionCacheKey key(from_type, to_type, is_explicit);
+  CachedCoercion cached;
+  bool found = false;
+  {
+    absl::ReaderMutexLock l(&coercion_cache_mutex_);
+    auto it = coercion_cache_.find(key);
+    if (it != coercion_cache_.end()) {
+      cached = it->second;
+      found = true;
+    }
+  }
+  if (!found) {
+    SignatureMatchResult local_result;
+    const InputArgumentType argument(from_type);
+    cached.coerces =
+        from_type->IsStruct()
+            ? StructCoercesTo(argument, to_type, is_explicit, &local_result)
+            : ArrayCoercesTo(argument, to_type, is_explicit, &local_result);
+    cached.non_matched_arguments = local_result.non_matched_arguments();
+    cached.non_literals_coerced = local_result.non_literals_coerced();
+    cached.non_literals_distance = local_result.non_literals_distance();
+    cached.literals_coerced = local_result.literals_coerced();
+    cached.literals_distance = local_result.literals_distance();
+    absl::MutexLock l(&coercion_cache_mutex_);
+    coercion_cache_.emplace(key, cached);
+  }
+  result->set_non_matched_arguments(result->non_matched_arguments() +
+                                    cached.non_matched_arguments);
+  result->set_non_literals_coerced(result->non_literals_coerced() +
+                                   cached.non_literals_coerced);
+  result->set_non_literals_distance(result->non_literals_distance() +
+                                    cached.non_literals_distance);
+  result->set_literals_coerced(result->literals_coerced() +
+                               cached.literals_coerced);
+  result->set_literals_distance(result->literals_distance() +
+                                cached.literals_distance);
+  return cached.coerces;
+}
+
 bool Coercer::TypeCoercesTo(const Type* from_type, const Type* to_type,
                             bool is_explicit,
                             SignatureMatchResult* result) const {
@@ -620,13 +667,8 @@ bool Coercer::TypeCoercesTo(const Type* from_type, const Type* to_type,
     result->incr_non_matched_arguments();
     return false;
   }
-  if (from_type->IsStruct()) {
-    return StructCoercesTo(InputArgumentType(from_type), to_type, is_explicit,
-                           result);
-  }
-  if (from_type->IsArray()) {
-    return ArrayCoercesTo(InputArgumentType(from_type), to_type, is_explicit,
-                          result);
+  if (from_type->IsStruct() || from_type->IsArray()) {
+    return CompoundTypeCoercesTo(from_type, to_type, is_explicit, result);
   }
   if (!is_explicit && !SupportsImplicitCoercion(property->type)) {
     result->incr_non_matched_arguments();
@@ -17,11 +17,16 @@
 #ifndef ZETASQL_PUBLIC_COERCER_H_
 #define ZETASQL_PUBLIC_COERCER_H_
 
+#include <tuple>
+
 #include "zetasql/public/function.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/signature_match_result.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 
 namespace zetasql {
@@ -118,6 +123,15 @@ class Coercer {
   bool TypeCoercesTo(const Type* from_type, const Type* to_type,
                      bool is_explicit, SignatureMatchResult* result) const;
 
+  // Returns whether a non-literal, non-parameter expression of struct or array
+  // type <from_type> can be coerced to <to_type>, as StructCoercesTo() or
+  // ArrayCoercesTo() for InputArgumentType(<from_type>).  These walk the
+  // field and element types, so the verdict and its effect on <result> are
+  // cached for each (<from_type>, <to_type>, <is_explicit>).
+  bool CompoundTypeCoercesTo(const Type* from_type, const Type* to_type,
+                             bool is_explicit,
+                             SignatureMatchResult* result) const;
+
   // Returns whether <struct_argument> can be coerced to <to_type>. We
   // consider <struct_argument> types individually to see whether they can be
   // coerced to <to_type> field types implicitly/explicitly. Field names are
@@ -192,6 +206,25 @@ class Coercer {
   // for other coercions.
   const absl::TimeZone default_timezone_;
   const LanguageOptions& language_options_;  // Not owned.
+
+  // The outcome of CompoundTypeCoercesTo(), with the amounts it adds to the
+  // counters of the SignatureMatchResult.
+  struct CachedCoercion {
+    bool coerces = false;
+    int non_matched_arguments = 0;
+    int non_literals_coerced = 0;
+    int non_literals_distance = 0;
+    int literals_coerced = 0;
+    int literals_distance = 0;
+  };
+  // Keyed by (from type, to type, is_explicit).  The types are owned by
+  // TypeFactories that outlive this Coercer, and the language options (and
+  // so the coercion rules) are fixed for its lifetime.
+  using CoercionCacheKey = std::tuple<const Type*, const Type*, bool>;
+  mutable absl::Mutex coercion_cache_mutex_;
+  mutable absl::flat_hash_map<CoercionCacheKey, CachedCoercion>
+      coercion_cache_ ABSL_GUARDED_BY(coercion_cache_mutex_);
+
   friend class CoercerTest;
 };
 
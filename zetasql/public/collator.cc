@@ -16,6 +16,7 @@
 
 #include "zetasql/public/collator.h"
 
+#include <string>
 #include <vector>
 
 #include "zetasql/base/logging.h"
@@ -23,6 +24,7 @@
 #include "absl/strings/str_split.h"
 #include "unicode/coll.h"
 #include "unicode/errorcode.h"
+#include "unicode/unistr.h"
 #include "unicode/utypes.h"
 #include "zetasql/base/ret_check.h"
 
@@ -75,6 +77,11 @@ class ZetaSqlCollatorIcu : public ZetaSqlCollator {
     return icu_collator_ == nullptr && !is_case_insensitive_;
   }
 
+  bool SupportsSortKeys() const override { return true; }
+
+  void AppendSortKeyUtf8(absl::string_view s, std::string* sort_key,
+                         zetasql_base::Status* error) const override;
+
  private:
   // icu::Collator used for locale-specific ordering. Not initialized for case
   // sensitive Unicode locale (i.e. is_unicode && !is_case_insensitive_).
@@ -125,6 +132,42 @@ int64_t ZetaSqlCollatorIcu::CompareUtf8(const absl::string_view s1,
   return result;
 }
 
+void ZetaSqlCollatorIcu::AppendSortKeyUtf8(absl::string_view s,
+                                             std::string* sort_key,
+                                             zetasql_base::Status* error) const {
+  if (icu_collator_ == nullptr) {
+    sort_key->append(s.data(), s.size());
+    return;
+  }
+  // Like compareUTF8(), fromUTF8() replaces ill-formed sequences with U+FFFD.
+  const icu::UnicodeString unicode_string = icu::UnicodeString::fromUTF8(
+      icu::StringPiece(s.data(), static_cast<int32_t>(s.size())));
+  const size_t start = sort_key->size();
+  // Try a buffer of a typical size first. getSortKey() returns the size of
+  // the full key, including a trailing zero byte, even if it does not fit.
+  int32_t capacity = static_cast<int32_t>(3 * s.size() + 16);
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    sort_key->resize(start + capacity);
+    const int32_t key_size = icu_collator_->getSortKey(
+        unicode_string, reinterpret_cast<uint8_t*>(&(*sort_key)[start]),
+        capacity);
+    if (key_size == 0) {
+      *error = zetasql_base::Status(zetasql_base::StatusCode::kInvalidArgument,
+                            "Sort key cannot be computed with the collator");
+      sort_key->resize(start);
+      return;
+    }
+    if (key_size <= capacity) {
+      // Drop the trailing zero byte.
+      sort_key->resize(start + key_size - 1);
+      return;
+    }
+    capacity = key_size;
+  }
+  LOG(DFATAL) << "Sort key size changed between calls to getSortKey()";
+  sort_key->resize(start);
+}
+
 }  // namespace
 
 // static
@@ -96,6 +96,21 @@ class ZetaSqlCollator {
   // implementation.
   virtual bool IsBinaryComparison() const = 0;
 
+  // Returns true if AppendSortKeyUtf8() can be called. The default
+  // implementation supports sort keys only for binary comparisons.
+  virtual bool SupportsSortKeys() const { return IsBinaryComparison(); }
+
+  // Appends the binary sort key of <s> to <*sort_key>. For any two strings,
+  // comparing their sort keys as strings of unsigned bytes gives the same
+  // result as CompareUtf8() on the strings, so code that compares each string
+  // many times, like a sort, can compute its key once and compare the keys
+  // instead. Requires SupportsSortKeys().
+  //
+  // If an error occurs, <*error> will be updated.
+  // Errors will never occur if <s> is valid UTF-8.
+  virtual void AppendSortKeyUtf8(absl::string_view s, std::string* sort_key,
+                                 zetasql_base::Status* error) const;
+
  protected:
   ZetaSqlCollator() = default;
 };
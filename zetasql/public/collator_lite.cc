@@ -15,6 +15,7 @@
 //
 
 #include "zetasql/public/collator.h"
+#include "zetasql/base/logging.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
 #include "zetasql/base/status_builder.h"
@@ -88,6 +89,13 @@ class CollatorRegistration {
 // has a dependency on :collator_lite).
 ZetaSqlCollator::~ZetaSqlCollator() {}
 
+void ZetaSqlCollator::AppendSortKeyUtf8(absl::string_view s,
+                                          std::string* sort_key,
+                                          zetasql_base::Status* error) const {
+  DCHECK(IsBinaryComparison());
+  sort_key->append(s.data(), s.size());
+}
+
 zetasql_base::StatusOr<ZetaSqlCollator*>
 ZetaSqlCollator::CreateFromCollationNameLite(
     const std::string& collation_name) {
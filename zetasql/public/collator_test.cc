@@ -19,16 +19,34 @@
 #include "zetasql/base/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 
 namespace zetasql {
 
 enum class CompareType {
-  kCompare
+  kCompare,
+  // Compares the strings' sort keys from AppendSortKeyUtf8().
+  kSortKey
 };
 
 class CollatorTest : public ::testing::TestWithParam<CompareType> {
  protected:
+  // Returns -1, 0 or 1 as the sort key of <s1> is less than, equal to or
+  // greater than the sort key of <s2>.
+  int CompareSortKeys(const std::string& s1, const std::string& s2,
+                      const ZetaSqlCollator* collator) {
+    EXPECT_TRUE(collator->SupportsSortKeys());
+    zetasql_base::Status error;
+    std::string key1 = "prefix";
+    std::string key2 = "prefix";
+    collator->AppendSortKeyUtf8(s1, &key1, &error);
+    collator->AppendSortKeyUtf8(s2, &key2, &error);
+    ZETASQL_EXPECT_OK(error);
+    const int result = key1.compare(key2);
+    return result < 0 ? -1 : (result > 0 ? 1 : 0);
+  }
+
   void TestEquals(const std::string& s1, const std::string& s2,
                   const ZetaSqlCollator* collator) {
     switch (GetParam()) {
@@ -40,6 +58,9 @@ class CollatorTest : public ::testing::TestWithParam<CompareType> {
         ZETASQL_EXPECT_OK(error);
         break;
       }
+      case CompareType::kSortKey:
+        EXPECT_EQ(0, CompareSortKeys(s1, s2, collator)) << s1 << "==" << s2;
+        break;
     }
   }
 
@@ -54,6 +75,10 @@ class CollatorTest : public ::testing::TestWithParam<CompareType> {
         ZETASQL_EXPECT_OK(error);
         break;
       }
+      case CompareType::kSortKey:
+        EXPECT_EQ(-1, CompareSortKeys(s1, s2, collator)) << s1 << "<" << s2;
+        EXPECT_EQ(1, CompareSortKeys(s2, s1, collator)) << s1 << ">" << s2;
+        break;
     }
   }
 };
@@ -126,6 +151,10 @@ TEST_P(CollatorTest, Comparison) {
   TestLessThan("a", "aa", collator.get());
   TestLessThan("@", "a", collator.get());
   TestLessThan("case sensitive", "Case sensitive", collator.get());
+  // Long strings, with long sort keys.
+  TestLessThan(std::string(1000, 'a'), std::string(1001, 'a'), collator.get());
+  TestLessThan(absl::StrCat(std::string(1000, 'a'), "b"),
+               absl::StrCat(std::string(1000, 'a'), "C"), collator.get());
 
   // Comparison with "en_US:ci" collation.
   collator.reset(ZetaSqlCollator::CreateFromCollationName("en_US:ci"));
@@ -166,7 +195,7 @@ TEST_P(CollatorTest, Comparison) {
 }
 
 INSTANTIATE_TEST_SUITE_P(CollatorTest, CollatorTest,
-                         ::testing::Values(
-                             CompareType::kCompare));
+                         ::testing::Values(CompareType::kCompare,
+                                           CompareType::kSortKey));
 
 }  // namespace zetasql
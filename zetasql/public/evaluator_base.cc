@@ -16,35 +16,49 @@
 
 #include "zetasql/public/evaluator_base.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <list>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "zetasql/base/logging.h"
+#include "zetasql/common/internal_value.h"
 #include "zetasql/public/analyzer.h"
 #include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator_executor.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/options.pb.h"
 #include "zetasql/public/simple_catalog.h"
 #include "zetasql/public/strings.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
+#include "zetasql/public/value.pb.h"
 #include "zetasql/reference_impl/algebrizer.h"
+#include "zetasql/reference_impl/compiled_expr.h"
 #include "zetasql/reference_impl/evaluation.h"
+#include "zetasql/reference_impl/evaluator_metrics.h"
 #include "zetasql/reference_impl/operator.h"
 #include "zetasql/reference_impl/parameters.h"
 #include "zetasql/reference_impl/tuple.h"
 #include "zetasql/reference_impl/variable_id.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_visitor.h"
 #include "zetasql/resolved_ast/resolved_column.h"
 #include "zetasql/resolved_ast/resolved_node_kind.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "zetasql/resolved_ast/validator.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "zetasql/base/case.h"
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "zetasql/base/map_util.h"
@@ -116,6 +130,46 @@ class VectorEvaluatorTableModifyIterator : public EvaluatorTableModifyIterator {
 
   bool NextRow() override { return ++row_idx_ < rows_.size(); }
 
+  // Copies the rows column by column instead of calling the virtual getters
+  // once per value.
+  bool NextBatch(int64_t max_rows, Batch* batch) override {
+    batch->num_rows = 0;
+    batch->columns.clear();
+    batch->original_keys.clear();
+    const int64_t begin = row_idx_ + 1;
+    const int64_t end =
+        std::min<int64_t>(rows_.size(), begin + std::max<int64_t>(max_rows, 1));
+    if (begin >= end) {
+      row_idx_ = static_cast<int>(rows_.size());
+      return false;
+    }
+    row_idx_ = static_cast<int>(end - 1);
+
+    batch->operation = operation_;
+    batch->num_rows = end - begin;
+    if (operation_ != Operation::kDelete) {
+      batch->columns.resize(table_->NumColumns());
+      for (int i = 0; i < batch->columns.size(); ++i) {
+        batch->columns[i].reserve(batch->num_rows);
+        for (int64_t row = begin; row < end; ++row) {
+          batch->columns[i].push_back(rows_[row].field(i));
+        }
+      }
+    }
+    const std::optional<std::vector<int>> primary_key = table_->PrimaryKey();
+    if (operation_ != Operation::kInsert && primary_key.has_value()) {
+      batch->original_keys.resize(primary_key->size());
+      for (int i = 0; i < primary_key->size(); ++i) {
+        batch->original_keys[i].reserve(batch->num_rows);
+        for (int64_t row = begin; row < end; ++row) {
+          batch->original_keys[i].push_back(
+              rows_[row].field(primary_key->at(i)));
+        }
+      }
+    }
+    return true;
+  }
+
   const Value& GetColumnValue(int i) const override {
     return operation_ == EvaluatorTableModifyIterator::Operation::kDelete
                ? invalid_value_
@@ -150,8 +204,289 @@ class VectorEvaluatorTableModifyIterator : public EvaluatorTableModifyIterator {
   const std::function<void()> deletion_cb_;
 };
 
+// The rows of the result of a query, with one value per output column.
+using ResultRows = std::vector<std::vector<Value>>;
+
+// Remembers the results of recent executions of a query, keyed on a string
+// that identifies the parameters and table contents of each execution. Evicts
+// the least recently used results to stay within a number of bytes.
+// Thread-safe.
+class ResultCache {
+ public:
+  explicit ResultCache(int64_t max_byte_size) : max_byte_size_(max_byte_size) {}
+
+  ResultCache(const ResultCache&) = delete;
+  ResultCache& operator=(const ResultCache&) = delete;
+
+  int64_t max_byte_size() const { return max_byte_size_; }
+
+  // Returns the rows cached for 'key', or NULL if there are none.
+  std::shared_ptr<const ResultRows> Lookup(const std::string& key)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock l(&mutex_);
+    auto it = entries_by_key_.find(key);
+    if (it == entries_by_key_.end()) return nullptr;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->rows;
+  }
+
+  // Caches 'rows', whose values use 'rows_byte_size' bytes, for 'key'.
+  // Evicts the least recently used entries to make room, or does nothing if
+  // the entry would not fit in the cache on its own.
+  void Insert(const std::string& key, std::shared_ptr<const ResultRows> rows,
+              int64_t rows_byte_size) ABSL_LOCKS_EXCLUDED(mutex_) {
+    // The key is stored twice.
+    const int64_t byte_size = 2 * key.size() + rows_byte_size;
+    if (byte_size > max_byte_size_) return;
+
+    absl::MutexLock l(&mutex_);
+    auto it = entries_by_key_.find(key);
+    if (it != entries_by_key_.end()) {
+      // A concurrent execution with the same key got here first.
+      byte_size_ -= it->second->byte_size;
+      entries_.erase(it->second);
+      entries_by_key_.erase(it);
+    }
+    while (byte_size_ + byte_size > max_byte_size_) {
+      const Entry& evicted = entries_.back();
+      byte_size_ -= evicted.byte_size;
+      entries_by_key_.erase(evicted.key);
+      entries_.pop_back();
+    }
+    entries_.push_front(Entry{key, std::move(rows), byte_size});
+    entries_by_key_[key] = entries_.begin();
+    byte_size_ += byte_size;
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const ResultRows> rows;
+    // The bytes charged for this entry.
+    int64_t byte_size;
+  };
+
+  const int64_t max_byte_size_;
+  absl::Mutex mutex_;
+  // The cached results, from the most to the least recently used.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, std::list<Entry>::iterator> entries_by_key_
+      ABSL_GUARDED_BY(mutex_);
+  // The sum of the 'byte_size' of 'entries_'.
+  int64_t byte_size_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// Implements EvaluatorTableIterator over the rows of a cached query result.
+//
+// `deletion_cb` is called on deletion, like for
+// VectorEvaluatorTableModifyIterator.
+class CachedResultIterator : public EvaluatorTableIterator {
+ public:
+  using NameAndType = PreparedQueryBase::NameAndType;
+
+  CachedResultIterator(const std::vector<NameAndType>& columns,
+                       std::shared_ptr<const ResultRows> rows,
+                       const std::function<void()>& deletion_cb)
+      : columns_(columns), rows_(std::move(rows)), deletion_cb_(deletion_cb) {}
+
+  CachedResultIterator(const CachedResultIterator&) = delete;
+  CachedResultIterator& operator=(const CachedResultIterator&) = delete;
+
+  ~CachedResultIterator() override { deletion_cb_(); }
+
+  int NumColumns() const override { return columns_.size(); }
+
+  std::string GetColumnName(int i) const override { return columns_[i].first; }
+
+  const Type* GetColumnType(int i) const override { return columns_[i].second; }
+
+  bool NextRow() override {
+    absl::MutexLock l(&mutex_);
+    if (cancelled_) return false;
+    if (row_idx_ < static_cast<int64_t>(rows_->size())) ++row_idx_;
+    return row_idx_ < static_cast<int64_t>(rows_->size());
+  }
+
+  const Value& GetValue(int i) const override {
+    absl::ReaderMutexLock l(&mutex_);
+    return (*rows_)[row_idx_][i];
+  }
+
+  zetasql_base::Status Status() const override {
+    absl::ReaderMutexLock l(&mutex_);
+    if (cancelled_) {
+      return zetasql_base::CancelledErrorBuilder()
+             << "The query was cancelled";
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  zetasql_base::Status Cancel() override {
+    absl::MutexLock l(&mutex_);
+    cancelled_ = true;
+    return zetasql_base::OkStatus();
+  }
+
+  // The rows are already computed, so there is nothing to time out.
+  void SetDeadline(absl::Time deadline) override {}
+
+ private:
+  const std::vector<NameAndType> columns_;
+  const std::shared_ptr<const ResultRows> rows_;
+  const std::function<void()> deletion_cb_;
+  mutable absl::Mutex mutex_;
+  // The index of the current row in 'rows_', or -1 before the first call to
+  // NextRow().
+  int64_t row_idx_ ABSL_GUARDED_BY(mutex_) = -1;
+  bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// ResolvedASTVisitor that determines whether the result of a query only
+// depends on its parameters and on the contents of the tables that it scans,
+// and collects those tables.
+class ResultCacheabilityVisitor : public ResolvedASTVisitor {
+ public:
+  ResultCacheabilityVisitor() {}
+  ResultCacheabilityVisitor(const ResultCacheabilityVisitor&) = delete;
+  ResultCacheabilityVisitor& operator=(const ResultCacheabilityVisitor&) =
+      delete;
+
+  bool cacheable() const { return cacheable_; }
+
+  // The scanned tables, in the order of their first scan.
+  const std::vector<const Table*>& tables() const { return tables_; }
+
+  zetasql_base::Status VisitResolvedTableScan(
+      const ResolvedTableScan* node) override {
+    if (seen_tables_.insert(node->table()).second) {
+      tables_.push_back(node->table());
+    }
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedTVFScan(
+      const ResolvedTVFScan* node) override {
+    cacheable_ = false;
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedSampleScan(
+      const ResolvedSampleScan* node) override {
+    cacheable_ = false;
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedFunctionCall(
+      const ResolvedFunctionCall* node) override {
+    CheckFunctionCall(node);
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedAggregateFunctionCall(
+      const ResolvedAggregateFunctionCall* node) override {
+    CheckFunctionCall(node);
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedAnalyticFunctionCall(
+      const ResolvedAnalyticFunctionCall* node) override {
+    CheckFunctionCall(node);
+    return DefaultVisit(node);
+  }
+
+ private:
+  // Volatile functions (like RAND()) and stable functions (like
+  // CURRENT_TIMESTAMP()) may return different values for the same arguments
+  // in different executions.
+  void CheckFunctionCall(const ResolvedFunctionCallBase* node) {
+    if (node->function()->function_options().volatility !=
+        FunctionEnums::IMMUTABLE) {
+      cacheable_ = false;
+    }
+  }
+
+  bool cacheable_ = true;
+  std::vector<const Table*> tables_;
+  absl::flat_hash_set<const Table*> seen_tables_;
+};
+
+// Collects the catalog objects that a statement refers to, whose identities
+// are part of the keys of PreparedQueryPlanCache.
+class PlanCatalogObjectsVisitor : public ResolvedASTVisitor {
+ public:
+  PlanCatalogObjectsVisitor() {}
+  PlanCatalogObjectsVisitor(const PlanCatalogObjectsVisitor&) = delete;
+  PlanCatalogObjectsVisitor& operator=(const PlanCatalogObjectsVisitor&) =
+      delete;
+
+  // The catalog objects, in the order in which they are first referenced.
+  const std::vector<const void*>& objects() const { return objects_; }
+
+  zetasql_base::Status VisitResolvedTableScan(
+      const ResolvedTableScan* node) override {
+    Add(node->table());
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedTVFScan(
+      const ResolvedTVFScan* node) override {
+    Add(node->tvf());
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedFunctionCall(
+      const ResolvedFunctionCall* node) override {
+    Add(node->function());
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedAggregateFunctionCall(
+      const ResolvedAggregateFunctionCall* node) override {
+    Add(node->function());
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedAnalyticFunctionCall(
+      const ResolvedAnalyticFunctionCall* node) override {
+    Add(node->function());
+    return DefaultVisit(node);
+  }
+
+ private:
+  void Add(const void* object) {
+    if (seen_objects_.insert(object).second) objects_.push_back(object);
+  }
+
+  std::vector<const void*> objects_;
+  absl::flat_hash_set<const void*> seen_objects_;
+};
+
+// Copies 'from' to 'to'. Parameters is not copyable to prevent accidental
+// copies.
+void CopyParameters(const Parameters& from, Parameters* to) {
+  to->set_named(from.is_named());
+  if (from.is_named()) {
+    to->named_parameters() = from.named_parameters();
+  } else {
+    to->positional_parameters() = from.positional_parameters();
+  }
+}
+
 }  // namespace
 
+// The algebrized plan of a query and the metadata that its executions need.
+// Does not change once it is cached: each execution keeps its state in its
+// EvaluationContext and TupleIterators.
+struct PreparedQueryPlanCache::Plan {
+  std::shared_ptr<const RelationalOp> relational_op;
+  Parameters parameters;
+  ParameterMap column_map;
+  SystemVariablesAlgebrizerMap system_variables;
+  std::vector<PreparedQueryBase::NameAndType> output_columns;
+  std::vector<VariableId> output_column_variables;
+  ExpressionCompilationStats expression_compilation_stats;
+};
+
 namespace internal {
 
 class Evaluator {
@@ -223,9 +558,38 @@ class Evaluator {
         query_output_iterator);
   }
 
+  // Evaluates the expression once for each element of 'columns', with the
+  // parameters in the same element of 'parameters', or no parameters if
+  // 'parameters' is empty. All the evaluations share one EvaluationContext.
+  zetasql_base::Status ExecuteAfterPrepareBatch(
+      absl::Span<const ParameterValueMap> columns,
+      absl::Span<const ParameterValueMap> parameters,
+      const SystemVariableValuesMap& system_variables,
+      std::vector<Value>* expression_output_values) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Evaluates the expression once for each element of 'column_rows', with
+  // the same 'parameters'. The evaluations share one EvaluationContext and
+  // one TupleData, whose column slots are overwritten for each row.
+  zetasql_base::Status ExecuteAfterPrepareBatchWithOrderedParams(
+      absl::Span<const ParameterValueList> column_rows,
+      const ParameterValueList& parameters,
+      const SystemVariableValuesMap& system_variables,
+      std::vector<Value>* expression_output_values) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
   zetasql_base::StatusOr<std::string> ExplainAfterPrepare() const
       ABSL_LOCKS_EXCLUDED(mutex_);
 
+  zetasql_base::StatusOr<double> GetCompiledExpressionFraction() const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  zetasql_base::StatusOr<OperatorProfileProto> GetLastProfile() const
+      ABSL_LOCKS_EXCLUDED(mutex_, last_profile_mutex_);
+
+  // Cancels the query executions whose contexts are in 'active_contexts_'.
+  void Cancel() const ABSL_LOCKS_EXCLUDED(active_contexts_mutex_);
+
   // Returns NULL if this object is for a query instead of an expression.
   const Type* expression_output_type() const ABSL_LOCKS_EXCLUDED(mutex_);
 
@@ -324,6 +688,47 @@ class Evaluator {
       std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const
       ABSL_SHARED_LOCKS_REQUIRED(mutex_);
 
+  // Returns the key of the plan of the query 'statement_', prepared with
+  // 'options', in EvaluatorOptions::plan_cache.
+  zetasql_base::StatusOr<std::string> GetPlanCacheKeyLocked(
+      const AnalyzerOptions& options) const ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Returns the prepared plan of the query, for EvaluatorOptions::plan_cache.
+  std::shared_ptr<const PreparedQueryPlanCache::Plan> MakePlanLocked() const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Makes this Evaluator execute 'plan', which a query with the same key in
+  // EvaluatorOptions::plan_cache prepared, instead of algebrizing the query.
+  void UsePlanLocked(const PreparedQueryPlanCache::Plan& plan)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Sets 'result_cache_' and 'result_cache_tables_' if the result of
+  // 'statement_' can be cached.
+  zetasql_base::Status InitResultCacheLocked()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Returns the key of 'result_cache_' for executing the query with
+  // 'columns', 'parameters' and 'system_variables', or nullopt if the result
+  // cannot be cached because a scanned table has no contents version.
+  absl::optional<std::string> GetResultCacheKey(
+      const ParameterValueList& columns, const ParameterValueList& parameters,
+      const SystemVariableValuesMap& system_variables) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Returns the TupleData with the values of 'columns', 'parameters' and
+  // 'system_variables', in the order of the algebrizer variables.
+  TupleData CreateParamsData(const ParameterValueList& columns,
+                             const ParameterValueList& parameters,
+                             const SystemVariableValuesMap& system_variables)
+      const ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Evaluates compiled_value_expr_ with 'context' and validated arguments.
+  zetasql_base::Status EvaluateExpressionLocked(
+      const ParameterValueList& columns, const ParameterValueList& parameters,
+      const SystemVariableValuesMap& system_variables,
+      EvaluationContext* context, Value* expression_output_value) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
   // Checks if 'parameters_map' specifies valid values for all variables from
   // resolved variable map 'variable_map', and populates 'values' with the
   // corresponding Values in the order they appear when iterating over
@@ -366,6 +771,14 @@ class Evaluator {
         evaluator_options_.max_value_byte_size;
     evaluation_options.max_intermediate_byte_size =
         evaluator_options_.max_intermediate_byte_size;
+    evaluation_options.batch_size = evaluator_options_.batch_size;
+    evaluation_options.num_threads = evaluator_options_.num_threads;
+    evaluation_options.spill_directory = evaluator_options_.spill_directory;
+    evaluation_options.collect_profile = evaluator_options_.collect_profile;
+    evaluation_options.track_allocations =
+        evaluator_options_.track_allocations;
+    evaluation_options.max_value_arena_byte_size =
+        evaluator_options_.max_value_arena_byte_size;
     evaluation_options.return_all_rows_for_dml = false;
 
     auto context = absl::make_unique<EvaluationContext>(evaluation_options);
@@ -386,6 +799,52 @@ class Evaluator {
     return context;
   }
 
+  // Returns the group for the tasks of one execution, or NULL if the
+  // execution does not run on multiple threads.
+  std::unique_ptr<EvaluatorExecutor::TaskGroup> CreateTaskGroup() const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
+    if (evaluator_options_.num_threads <= 1) return nullptr;
+    EvaluatorExecutor* executor = evaluator_options_.executor != nullptr
+                                      ? evaluator_options_.executor
+                                      : EvaluatorExecutor::Default();
+    return executor->CreateTaskGroup(
+        evaluator_options_.executor_weight,
+        evaluator_options_.max_executor_parallelism);
+  }
+
+  // Returns a context for evaluating the expression, reusing one that was
+  // passed to ReleaseExpressionContext() if there is one. Constructing a
+  // context copies the options and can dominate the evaluation of cheap
+  // expressions.
+  std::unique_ptr<EvaluationContext> AcquireExpressionContext() const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
+    // The test callback must see every context.
+    if (create_evaluation_context_cb_test_only_ == nullptr) {
+      absl::MutexLock l(&context_pool_mutex_);
+      if (!context_pool_.empty()) {
+        std::unique_ptr<EvaluationContext> context =
+            std::move(context_pool_.back());
+        context_pool_.pop_back();
+        return context;
+      }
+    }
+    return CreateEvaluationContext();
+  }
+
+  // Keeps 'context', which must have been returned by
+  // AcquireExpressionContext(), for reuse. No Values that were allocated in
+  // its arena may be alive.
+  void ReleaseExpressionContext(
+      std::unique_ptr<EvaluationContext> context) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
+    if (create_evaluation_context_cb_test_only_ != nullptr) return;
+    context->ResetForReuse();
+    absl::MutexLock l(&context_pool_mutex_);
+    if (context_pool_.size() < kMaxPooledContexts) {
+      context_pool_.push_back(std::move(context));
+    }
+  }
+
   void IncrementNumLiveIterators() const {
     absl::MutexLock l(&num_live_iterators_mutex_);
     ++num_live_iterators_;
@@ -396,6 +855,31 @@ class Evaluator {
     --num_live_iterators_;
   }
 
+  // Makes Cancel() cancel 'context' until RemoveActiveContext() is called.
+  void AddActiveContext(EvaluationContext* context) const
+      ABSL_LOCKS_EXCLUDED(active_contexts_mutex_) {
+    absl::MutexLock l(&active_contexts_mutex_);
+    active_contexts_.insert(context);
+  }
+
+  void RemoveActiveContext(const EvaluationContext* context) const
+      ABSL_LOCKS_EXCLUDED(active_contexts_mutex_) {
+    absl::MutexLock l(&active_contexts_mutex_);
+    active_contexts_.erase(const_cast<EvaluationContext*>(context));
+  }
+
+  // Called when the output iterator of a query that was evaluated with
+  // 'context' is destroyed.
+  void RecordProfile(const RelationalOp* root,
+                     const EvaluationContext& context) const
+      ABSL_LOCKS_EXCLUDED(last_profile_mutex_) {
+    if (context.profile() == nullptr) return;
+    OperatorProfileProto profile;
+    context.profile()->Serialize(root, &profile);
+    absl::MutexLock l(&last_profile_mutex_);
+    last_profile_ = std::move(profile);
+  }
+
   // The original SQL. Not present if expr_ or statement_ was passed in
   // directly.
   const std::string sql_;
@@ -428,11 +912,15 @@ class Evaluator {
       ABSL_PT_GUARDED_BY(mutex_);
 
   // For expressions, Prepare populates compiled_value_expr_. For queries, it
-  // populates compiled_relational_op.
+  // populates compiled_relational_op, which may be shared with other
+  // Evaluators through EvaluatorOptions::plan_cache.
   std::unique_ptr<ValueExpr> compiled_value_expr_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_);
-  std::unique_ptr<RelationalOp> compiled_relational_op_ ABSL_GUARDED_BY(mutex_)
-      ABSL_PT_GUARDED_BY(mutex_);
+  std::shared_ptr<const RelationalOp> compiled_relational_op_
+      ABSL_GUARDED_BY(mutex_) ABSL_PT_GUARDED_BY(mutex_);
+  // Populated by Prepare if EvaluatorOptions::compile_expressions is true.
+  ExpressionCompilationStats expression_compilation_stats_
+      ABSL_GUARDED_BY(mutex_);
 
   // Output columns corresponding to `compiled_relational_op_` Only valid if
   // the statement is ResolvedQueryStmt.
@@ -442,6 +930,13 @@ class Evaluator {
   // ResolvedQueryStmt.
   std::vector<VariableId> output_column_variables_ ABSL_GUARDED_BY(mutex_);
 
+  // Set by Prepare if EvaluatorOptions::max_result_cache_byte_size is positive
+  // and the result of the query can be cached. Has its own synchronization.
+  std::unique_ptr<ResultCache> result_cache_ ABSL_GUARDED_BY(mutex_);
+  // The tables whose contents versions are part of the keys of
+  // 'result_cache_'.
+  std::vector<const Table*> result_cache_tables_ ABSL_GUARDED_BY(mutex_);
+
   mutable absl::Mutex num_live_iterators_mutex_;
   // The number of live iterators corresponding to `compiled_relational_op_` or
   // `complied_value_expr` with type `DMLValueExpr`. Only valid if !is_expr_.
@@ -450,6 +945,26 @@ class Evaluator {
   mutable int num_live_iterators_ ABSL_GUARDED_BY(num_live_iterators_mutex_) =
       0;
 
+  // Enough for the threads that usually evaluate one expression at once.
+  static constexpr int kMaxPooledContexts = 16;
+  mutable absl::Mutex context_pool_mutex_;
+  // Contexts for evaluating the expression, for AcquireExpressionContext().
+  // Mutable for the same reason as 'num_live_iterators_'.
+  mutable std::vector<std::unique_ptr<EvaluationContext>> context_pool_
+      ABSL_GUARDED_BY(context_pool_mutex_);
+
+  mutable absl::Mutex active_contexts_mutex_;
+  // The contexts of the query executions that are in progress, for Cancel().
+  // Mutable for the same reason as 'num_live_iterators_'.
+  mutable absl::flat_hash_set<EvaluationContext*> active_contexts_
+      ABSL_GUARDED_BY(active_contexts_mutex_);
+
+  mutable absl::Mutex last_profile_mutex_;
+  // Populated by RecordProfile() if EvaluatorOptions::collect_profile is true.
+  // Mutable for the same reason as 'num_live_iterators_'.
+  mutable absl::optional<OperatorProfileProto> last_profile_
+      ABSL_GUARDED_BY(last_profile_mutex_);
+
   // The last EvaluationContext that we created, only for use by unit tests. May
   // be NULL.
   std::unique_ptr<std::function<void(EvaluationContext*)>>
@@ -478,8 +993,11 @@ zetasql_base::Status Evaluator::PrepareLocked(const AnalyzerOptions& options,
     simple_catalog = absl::make_unique<SimpleCatalog>(
         "default_catalog", evaluator_options_.type_factory);
     catalog = simple_catalog.get();
-    // Add built-in functions to the catalog, using provided <options>.
-    simple_catalog->AddZetaSQLFunctions(options.language());
+    // Add built-in functions to the catalog, using provided <options>. They
+    // are shared across catalogs and only built when they are looked up, so
+    // that preparing an expression does not construct the signatures of all
+    // the built-in functions it does not reference.
+    simple_catalog->AddLazyZetaSQLFunctions(options.language());
   }
 
   AlgebrizerOptions algebrizer_options;
@@ -487,7 +1005,35 @@ zetasql_base::Status Evaluator::PrepareLocked(const AnalyzerOptions& options,
   algebrizer_options.allow_hash_join = true;
   algebrizer_options.allow_order_by_limit_operator = true;
   algebrizer_options.push_down_filters = true;
-
+  algebrizer_options.use_row_count_estimates = true;
+  algebrizer_options.share_analytic_sorts = true;
+  algebrizer_options.defer_proto_field_reads = true;
+  algebrizer_options.batch_json_extractions = true;
+  algebrizer_options.fold_constant_subexpressions = true;
+  algebrizer_options.eliminate_common_subexpressions = true;
+  algebrizer_options.allow_merge_join = true;
+  algebrizer_options.push_build_keys_into_scans = true;
+  algebrizer_options.memoize_correlated_subqueries = true;
+  algebrizer_options.materialize_with_tables = true;
+  algebrizer_options.push_filters_into_array_scans = true;
+  algebrizer_options.generate_arrays_in_array_scans = true;
+  algebrizer_options.use_in_list_sets = true;
+  algebrizer_options.prune_unused_columns = true;
+  algebrizer_options.allow_partition_limit_sort = true;
+  algebrizer_options.push_limits_into_scans = true;
+  algebrizer_options.simplify_exists_subqueries = true;
+  algebrizer_options.use_key_lookups_for_joins = true;
+  algebrizer_options.order_conjuncts_by_cost = true;
+  algebrizer_options.use_exchange_operators =
+      evaluator_options_.num_threads > 1;
+  algebrizer_options.parallelize_union_all =
+      evaluator_options_.num_threads > 1;
+
+  // Only set for queries. Moved to 'compiled_relational_op_' once prepared.
+  std::unique_ptr<RelationalOp> relational_op;
+  // The key of the plan in EvaluatorOptions::plan_cache, or empty if the plan
+  // is not cached.
+  std::string plan_cache_key;
   if (!is_expr_) {
     if (statement_ == nullptr) {
       ZETASQL_RETURN_IF_ERROR(AnalyzeStatement(sql_, options, catalog,
@@ -497,10 +1043,30 @@ zetasql_base::Status Evaluator::PrepareLocked(const AnalyzerOptions& options,
     } else {
       // TODO: When we're confident that it's no longer possible to
       // crash the reference implementation, remove this validation step.
+      ScopedTraceSpan span(evaluator_options_.tracer, "validate");
       ZETASQL_RETURN_IF_ERROR(Validator().ValidateResolvedStatement(statement_));
     }
 
+    if (statement_->node_kind() == RESOLVED_QUERY_STMT) {
+      if (evaluator_options_.max_result_cache_byte_size > 0) {
+        ZETASQL_RETURN_IF_ERROR(InitResultCacheLocked());
+      }
+      // A plan could not outlive an owned type factory.
+      if (evaluator_options_.plan_cache != nullptr &&
+          owned_type_factory_ == nullptr) {
+        ZETASQL_ASSIGN_OR_RETURN(plan_cache_key,
+                         GetPlanCacheKeyLocked(options));
+        std::shared_ptr<const PreparedQueryPlanCache::Plan> plan =
+            evaluator_options_.plan_cache->Lookup(plan_cache_key);
+        if (plan != nullptr) {
+          UsePlanLocked(*plan);
+          return zetasql_base::OkStatus();
+        }
+      }
+    }
+
     // Algebrize.
+    ScopedTraceSpan span(evaluator_options_.tracer, "algebrize");
     if (analyzer_options_.parameter_mode() == PARAMETER_POSITIONAL) {
       algebrizer_parameters_.set_named(false);
     }
@@ -512,7 +1078,7 @@ zetasql_base::Status Evaluator::PrepareLocked(const AnalyzerOptions& options,
             options.language(), algebrizer_options,
             evaluator_options_.type_factory,
             statement_->GetAs<ResolvedQueryStmt>(), &output_column_list,
-            &compiled_relational_op_, &output_column_names,
+            &relational_op, &output_column_names,
             &output_column_variables_, &algebrizer_parameters_,
             &algebrizer_column_map_, &algebrizer_system_variables_));
         ZETASQL_RET_CHECK_EQ(output_column_list.size(), output_column_names.size());
@@ -546,10 +1112,12 @@ zetasql_base::Status Evaluator::PrepareLocked(const AnalyzerOptions& options,
     } else {
       // TODO: When we're confident that it's no longer possible to
       // crash the reference implementation, remove this validation step.
+      ScopedTraceSpan span(evaluator_options_.tracer, "validate");
       ZETASQL_RETURN_IF_ERROR(Validator().ValidateStandaloneResolvedExpr(expr_));
     }
 
     // Algebrize.
+    ScopedTraceSpan span(evaluator_options_.tracer, "algebrize");
     if (analyzer_options_.parameter_mode() == PARAMETER_POSITIONAL) {
       algebrizer_parameters_.set_named(false);
     }
@@ -584,17 +1152,123 @@ zetasql_base::Status Evaluator::PrepareLocked(const AnalyzerOptions& options,
   const TupleSchema params_schema(vars);
 
   // Set the TupleSchema for the parameters.
-  if (compiled_relational_op_ != nullptr) {
+  if (relational_op != nullptr) {
     ZETASQL_RETURN_IF_ERROR(
-        compiled_relational_op_->SetSchemasForEvaluation({&params_schema}));
+        relational_op->SetSchemasForEvaluation({&params_schema}));
   } else {
     ZETASQL_RETURN_IF_ERROR(
         compiled_value_expr_->SetSchemasForEvaluation({&params_schema}));
   }
 
+  // Compilation needs the slots of the variables, so it must come after
+  // SetSchemasForEvaluation().
+  if (evaluator_options_.compile_expressions) {
+    if (relational_op != nullptr) {
+      CompileValueExprs(relational_op.get(), &expression_compilation_stats_);
+    } else {
+      CompileValueExpr(&compiled_value_expr_, &expression_compilation_stats_);
+    }
+  }
+
+  if (relational_op != nullptr) {
+    compiled_relational_op_ = std::move(relational_op);
+    if (!plan_cache_key.empty()) {
+      evaluator_options_.plan_cache->Insert(plan_cache_key, MakePlanLocked());
+    }
+  }
+
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::StatusOr<std::string> Evaluator::GetPlanCacheKeyLocked(
+    const AnalyzerOptions& options) const {
+  PlanCatalogObjectsVisitor visitor;
+  ZETASQL_RETURN_IF_ERROR(statement_->Accept(&visitor));
+
+  // The options that affect algebrization, then the catalog objects and the
+  // statement. The debug string of the statement shows the names of the
+  // catalog objects but not their identities.
+  const LanguageOptions& language = options.language();
+  std::string key = absl::StrCat(
+      language.GetEnabledLanguageFeaturesAsString(), "|",
+      language.product_mode(), "|", language.name_resolution_mode(), "|",
+      options.parameter_mode(), "|", evaluator_options_.num_threads > 1, "|",
+      evaluator_options_.compile_expressions, "|",
+      absl::Hex(reinterpret_cast<uintptr_t>(evaluator_options_.type_factory)));
+  for (const void* object : visitor.objects()) {
+    absl::StrAppend(&key, "|", absl::Hex(reinterpret_cast<uintptr_t>(object)));
+  }
+  absl::StrAppend(&key, "\n", statement_->DebugString());
+  return key;
+}
+
+std::shared_ptr<const PreparedQueryPlanCache::Plan> Evaluator::MakePlanLocked()
+    const {
+  auto plan = std::make_shared<PreparedQueryPlanCache::Plan>();
+  plan->relational_op = compiled_relational_op_;
+  CopyParameters(algebrizer_parameters_, &plan->parameters);
+  plan->column_map = algebrizer_column_map_;
+  plan->system_variables = algebrizer_system_variables_;
+  plan->output_columns = output_columns_;
+  plan->output_column_variables = output_column_variables_;
+  plan->expression_compilation_stats = expression_compilation_stats_;
+  return plan;
+}
+
+void Evaluator::UsePlanLocked(const PreparedQueryPlanCache::Plan& plan) {
+  compiled_relational_op_ = plan.relational_op;
+  CopyParameters(plan.parameters, &algebrizer_parameters_);
+  algebrizer_column_map_ = plan.column_map;
+  algebrizer_system_variables_ = plan.system_variables;
+  output_columns_ = plan.output_columns;
+  output_column_variables_ = plan.output_column_variables;
+  expression_compilation_stats_ = plan.expression_compilation_stats;
+}
+
+zetasql_base::Status Evaluator::InitResultCacheLocked() {
+  // Scrambled orderings would be frozen by the cache.
+  if (evaluator_options_.scramble_undefined_orderings) {
+    return zetasql_base::OkStatus();
+  }
+  ResultCacheabilityVisitor visitor;
+  ZETASQL_RETURN_IF_ERROR(statement_->Accept(&visitor));
+  if (!visitor.cacheable()) return zetasql_base::OkStatus();
+  result_cache_tables_ = visitor.tables();
+  result_cache_ = absl::make_unique<ResultCache>(
+      evaluator_options_.max_result_cache_byte_size);
+  return zetasql_base::OkStatus();
+}
+
+absl::optional<std::string> Evaluator::GetResultCacheKey(
+    const ParameterValueList& columns, const ParameterValueList& parameters,
+    const SystemVariableValuesMap& system_variables) const {
+  ParameterValueList values;
+  values.reserve(columns.size() + parameters.size() + system_variables.size());
+  values.insert(values.end(), columns.begin(), columns.end());
+  values.insert(values.end(), parameters.begin(), parameters.end());
+  for (const auto& algebrizer_sysvar : algebrizer_system_variables_) {
+    values.push_back(system_variables.at(algebrizer_sysvar.first));
+  }
+
+  // The ValueProtos distinguish values that compare equal but may produce
+  // different results, like -0.0 and 0.0. Each part is prefixed with its
+  // length so that the key is unambiguous.
+  std::string key;
+  for (const Value& value : values) {
+    ValueProto value_proto;
+    if (!value.Serialize(&value_proto).ok()) return absl::nullopt;
+    const std::string bytes = value_proto.SerializeAsString();
+    absl::StrAppend(&key, bytes.size(), ":", bytes);
+  }
+  for (const Table* table : result_cache_tables_) {
+    const std::optional<std::string> version =
+        table->GetEvaluatorContentsVersion();
+    if (!version.has_value()) return absl::nullopt;
+    absl::StrAppend(&key, version->size(), ":", *version);
+  }
+  return key;
+}
+
 zetasql_base::StatusOr<std::vector<std::string>> Evaluator::GetReferencedColumns()
     const {
   absl::ReaderMutexLock l(&mutex_);
@@ -799,24 +1473,60 @@ namespace {
 class TupleIteratorAdaptor : public EvaluatorTableIterator {
  public:
   using NameAndType = PreparedQueryBase::NameAndType;
+  // Called with the EvaluationContext once the iterator is no longer used.
+  using DeletionCallback = std::function<void(const EvaluationContext&)>;
+  // Called with the rows of the result and the bytes used by their values.
+  using ResultCallback =
+      std::function<void(std::shared_ptr<const ResultRows>, int64_t)>;
 
   // 'tuple_indexes[i]' is in the index in a TupleData returned by 'iter' of the
-  // value for 'columns[i]'.
-  TupleIteratorAdaptor(const std::vector<NameAndType>& columns,
-                       const std::vector<int>& tuple_indexes,
-                       const std::function<void()>& deletion_cb,
-                       std::unique_ptr<EvaluationContext> context,
-                       std::unique_ptr<TupleIterator> iter)
+  // value for 'columns[i]'. 'task_group' (which may be NULL) is the group
+  // that 'iter' schedules its tasks in. 'tracer' (which may be NULL) gets the
+  // "drain" span.
+  TupleIteratorAdaptor(
+      const std::vector<NameAndType>& columns,
+      const std::vector<int>& tuple_indexes,
+      const DeletionCallback& deletion_cb,
+      std::unique_ptr<EvaluationContext> context,
+      std::unique_ptr<EvaluatorExecutor::TaskGroup> task_group,
+      std::unique_ptr<TupleIterator> iter, Tracer* tracer)
       : columns_(columns),
         tuple_indexes_(tuple_indexes),
         deletion_cb_(deletion_cb),
+        tracer_(tracer),
+        unlocked_context_(context.get()),
         context_(std::move(context)),
-        iter_(std::move(iter)) {}
+        task_group_(std::move(task_group)),
+        iter_(std::move(iter)) {
+    GetEvaluatorMetrics().queries_executed.Increment();
+  }
 
   TupleIteratorAdaptor(const TupleIteratorAdaptor&) = delete;
   TupleIteratorAdaptor& operator=(const TupleIteratorAdaptor&) = delete;
 
-  ~TupleIteratorAdaptor() override { deletion_cb_(); }
+  ~TupleIteratorAdaptor() override {
+    absl::MutexLock l(&mutex_);
+    // Destroying the iterator first makes any threads started by it fold their
+    // state back into 'context_'. Destroying it before the query is done stops
+    // the evaluation, since iterators only do work when Next() is called (or
+    // on threads that they stop when they are destroyed).
+    iter_.reset();
+    drain_span_.reset();
+    deletion_cb_(*context_);
+    GetEvaluatorMetrics().query_output_rows.Record(num_rows_);
+  }
+
+  // Makes the iterator collect the rows that it returns, and pass them to
+  // 'result_cb' once it has returned all of them, if the output is
+  // deterministic and its values use at most 'max_byte_size' bytes. Must be
+  // called before NextRow().
+  void SetResultCallback(int64_t max_byte_size,
+                         const ResultCallback& result_cb) {
+    absl::MutexLock l(&mutex_);
+    max_result_byte_size_ = max_byte_size;
+    result_cb_ = result_cb;
+    result_rows_ = absl::make_unique<ResultRows>();
+  }
 
   int NumColumns() const override { return columns_.size(); }
 
@@ -826,13 +1536,38 @@ class TupleIteratorAdaptor : public EvaluatorTableIterator {
 
   bool NextRow() override {
     absl::MutexLock l(&mutex_);
-    current_ = iter_->Next();
+    if (!called_next_ && tracer_ != nullptr) {
+      drain_span_ = tracer_->StartSpan("drain");
+    }
+    zetasql_base::UnsafeArena* arena = context_->value_arena();
+    {
+      InternalValue::ScopedArena scoped_arena(
+          arena, context_->options().max_value_arena_byte_size);
+      EvaluatorExecutor::ScopedTaskGroup scoped_task_group(task_group_.get());
+      current_ = iter_->Next();
+    }
     called_next_ = true;
-    return current_ != nullptr;
+    if (current_ == nullptr) {
+      drain_span_.reset();
+      MaybeReturnResultLocked();
+      return false;
+    }
+    ++num_rows_;
+    if (arena != nullptr) {
+      // The caller may keep the values after the arena is gone.
+      current_row_.clear();
+      for (int tuple_index : tuple_indexes_) {
+        current_row_.push_back(InternalValue::CopyOutOfArena(
+            current_->slot(tuple_index).value()));
+      }
+    }
+    if (result_rows_ != nullptr) CollectRowLocked();
+    return true;
   }
 
   const Value& GetValue(int i) const override {
     absl::ReaderMutexLock l(&mutex_);
+    if (context_->value_arena() != nullptr) return current_row_[i];
     return current_->slot(tuple_indexes_[i]).value();
   }
 
@@ -842,6 +1577,9 @@ class TupleIteratorAdaptor : public EvaluatorTableIterator {
   }
 
   zetasql_base::Status Cancel() override {
+    // NextRow() holds 'mutex_' while it evaluates the query, so first cancel
+    // without it to make a concurrent NextRow() return early.
+    unlocked_context_->SetCancelled();
     absl::MutexLock l(&mutex_);
     return context_->CancelStatement();
   }
@@ -852,18 +1590,69 @@ class TupleIteratorAdaptor : public EvaluatorTableIterator {
   }
 
  private:
+  // Appends the current row to 'result_rows_', or stops collecting rows if
+  // they no longer fit in 'max_result_byte_size_'.
+  void CollectRowLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    std::vector<Value> row;
+    row.reserve(tuple_indexes_.size());
+    for (int i = 0; i < tuple_indexes_.size(); ++i) {
+      const Value& value = context_->value_arena() != nullptr
+                               ? current_row_[i]
+                               : current_->slot(tuple_indexes_[i]).value();
+      result_byte_size_ += value.physical_byte_size();
+      row.push_back(value);
+    }
+    if (result_byte_size_ > max_result_byte_size_) {
+      result_rows_.reset();
+      return;
+    }
+    result_rows_->push_back(std::move(row));
+  }
+
+  // Called once 'iter_' is exhausted. Passes the collected rows to
+  // 'result_cb_' if the evaluation succeeded and was deterministic.
+  void MaybeReturnResultLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (result_rows_ == nullptr) return;
+    std::unique_ptr<ResultRows> rows = std::move(result_rows_);
+    if (iter_->Status().ok() && context_->IsDeterministicOutput()) {
+      result_cb_(std::shared_ptr<const ResultRows>(std::move(rows)),
+                 result_byte_size_);
+    }
+  }
+
   const std::vector<NameAndType> columns_;
   const std::vector<int> tuple_indexes_;
-  const std::function<void()> deletion_cb_;
+  const DeletionCallback deletion_cb_;
+  Tracer* const tracer_;
+  // The same as 'context_', for the methods of EvaluationContext that do not
+  // require synchronization.
+  EvaluationContext* const unlocked_context_;
   mutable absl::Mutex mutex_;
   std::unique_ptr<EvaluationContext> context_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_);
   bool called_next_ ABSL_GUARDED_BY(mutex_) = false;
+  // The number of rows returned by NextRow().
+  int64_t num_rows_ ABSL_GUARDED_BY(mutex_) = 0;
+  // From the first call to NextRow() until the end of the rows.
+  std::unique_ptr<Tracer::Span> drain_span_ ABSL_GUARDED_BY(mutex_);
+  // Must outlive 'iter_'.
+  const std::unique_ptr<EvaluatorExecutor::TaskGroup> task_group_;
   std::unique_ptr<TupleIterator> iter_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_);
   const TupleData* current_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_) = nullptr;
+  // Copies of the values of 'current_' for 'columns_' if 'context_' has a
+  // value arena.
+  std::vector<Value> current_row_ ABSL_GUARDED_BY(mutex_);
   zetasql_base::Status status_ ABSL_GUARDED_BY(mutex_);
+
+  // Only used after SetResultCallback(). 'result_rows_' holds the rows
+  // returned so far, or is NULL once they no longer fit or have been passed
+  // to 'result_cb_'.
+  int64_t max_result_byte_size_ ABSL_GUARDED_BY(mutex_) = 0;
+  ResultCallback result_cb_ ABSL_GUARDED_BY(mutex_);
+  std::unique_ptr<ResultRows> result_rows_ ABSL_GUARDED_BY(mutex_);
+  int64_t result_byte_size_ ABSL_GUARDED_BY(mutex_) = 0;
 };
 }  // namespace
 
@@ -883,8 +1672,97 @@ zetasql_base::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
   ZETASQL_RETURN_IF_ERROR(ValidateParameters(parameters));
   ZETASQL_RETURN_IF_ERROR(ValidateSystemVariables(system_variables));
 
+  if (compiled_relational_op_ == nullptr) {
+    std::unique_ptr<EvaluationContext> context = AcquireExpressionContext();
+    const zetasql_base::Status status =
+        EvaluateExpressionLocked(columns, parameters, system_variables,
+                                 context.get(), expression_output_value);
+    ReleaseExpressionContext(std::move(context));
+    return status;
+  }
+
+  absl::optional<std::string> result_cache_key;
+  if (result_cache_ != nullptr) {
+    result_cache_key = GetResultCacheKey(columns, parameters, system_variables);
+    if (result_cache_key.has_value()) {
+      std::shared_ptr<const ResultRows> rows =
+          result_cache_->Lookup(*result_cache_key);
+      if (rows != nullptr) {
+        IncrementNumLiveIterators();
+        *query_output_iterator = absl::make_unique<CachedResultIterator>(
+            output_columns_, std::move(rows),
+            std::bind(&Evaluator::DecrementNumLiveIterators, this));
+        return zetasql_base::OkStatus();
+      }
+    }
+  }
+
   std::unique_ptr<EvaluationContext> context = CreateEvaluationContext();
+  if (evaluator_options_.max_execution_time != absl::InfiniteDuration()) {
+    context->SetStatementEvaluationDeadline(
+        evaluator_options_.clock->TimeNow() +
+        evaluator_options_.max_execution_time);
+  }
+
+  const TupleData params_data =
+      CreateParamsData(columns, parameters, system_variables);
+  std::unique_ptr<EvaluatorExecutor::TaskGroup> task_group = CreateTaskGroup();
+  EvaluatorExecutor::ScopedTaskGroup scoped_task_group(task_group.get());
+  InternalValue::ScopedArena scoped_arena(
+      context->value_arena(), evaluator_options_.max_value_arena_byte_size);
+  // Eval() already reads the inputs of sorts, aggregations and the build
+  // sides of joins, so it must be cancellable too.
+  AddActiveContext(context.get());
+  zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> tuple_iter_or;
+  {
+    ScopedTraceSpan span(evaluator_options_.tracer, "open");
+    tuple_iter_or = compiled_relational_op_->Eval(
+        {&params_data}, /*num_extra_slots=*/0, context.get());
+  }
+  if (!tuple_iter_or.ok()) {
+    RemoveActiveContext(context.get());
+    return tuple_iter_or.status();
+  }
+  std::unique_ptr<TupleIterator> tuple_iter =
+      std::move(tuple_iter_or).ValueOrDie();
+  std::vector<int> tuple_indexes;
+  tuple_indexes.reserve(output_column_variables_.size());
+  for (const VariableId& var : output_column_variables_) {
+    absl::optional<int> i = tuple_iter->Schema().FindIndexForVariable(var);
+    if (!i.has_value()) RemoveActiveContext(context.get());
+    ZETASQL_RET_CHECK(i.has_value()) << var;
+    tuple_indexes.push_back(i.value());
+  }
 
+  IncrementNumLiveIterators();
+  const RelationalOp* root = compiled_relational_op_.get();
+  TupleIteratorAdaptor::DeletionCallback deletion_cb =
+      [this, root](const EvaluationContext& context) {
+        RemoveActiveContext(&context);
+        RecordProfile(root, context);
+        DecrementNumLiveIterators();
+      };
+  auto adaptor = absl::make_unique<TupleIteratorAdaptor>(
+      output_columns_, tuple_indexes, deletion_cb, std::move(context),
+      std::move(task_group), std::move(tuple_iter), evaluator_options_.tracer);
+  if (result_cache_key.has_value()) {
+    ResultCache* result_cache = result_cache_.get();
+    const std::string key = *result_cache_key;
+    adaptor->SetResultCallback(
+        result_cache->max_byte_size(),
+        [result_cache, key](std::shared_ptr<const ResultRows> rows,
+                            int64_t byte_size) {
+          result_cache->Insert(key, std::move(rows), byte_size);
+        });
+  }
+  *query_output_iterator = std::move(adaptor);
+
+  return zetasql_base::OkStatus();
+}
+
+TupleData Evaluator::CreateParamsData(
+    const ParameterValueList& columns, const ParameterValueList& parameters,
+    const SystemVariableValuesMap& system_variables) const {
   ParameterValueList params;
   params.reserve(columns.size() + parameters.size() + system_variables.size());
   params.insert(params.end(), columns.begin(), columns.end());
@@ -892,40 +1770,149 @@ zetasql_base::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
   for (const auto& algebrizer_sysvar : algebrizer_system_variables_) {
     params.push_back(system_variables.at(algebrizer_sysvar.first));
   }
-  const TupleData params_data = CreateTupleDataFromValues(params);
+  return CreateTupleDataFromValues(params);
+}
 
-  if (compiled_relational_op_ != nullptr) {
-    ZETASQL_ASSIGN_OR_RETURN(
-        std::unique_ptr<TupleIterator> tuple_iter,
-        compiled_relational_op_->Eval({&params_data},
-                                      /*num_extra_slots=*/0, context.get()));
-    std::vector<int> tuple_indexes;
-    tuple_indexes.reserve(output_column_variables_.size());
-    for (const VariableId& var : output_column_variables_) {
-      absl::optional<int> i = tuple_iter->Schema().FindIndexForVariable(var);
-      ZETASQL_RET_CHECK(i.has_value()) << var;
-      tuple_indexes.push_back(i.value());
-    }
+zetasql_base::Status Evaluator::EvaluateExpressionLocked(
+    const ParameterValueList& columns, const ParameterValueList& parameters,
+    const SystemVariableValuesMap& system_variables,
+    EvaluationContext* context, Value* expression_output_value) const {
+  ZETASQL_RET_CHECK(compiled_value_expr_ != nullptr);
+  // The parameters may differ from the last evaluation with 'context'.
+  context->ClearCachedValues();
+  const TupleData params_data =
+      CreateParamsData(columns, parameters, system_variables);
+  const std::unique_ptr<EvaluatorExecutor::TaskGroup> task_group =
+      CreateTaskGroup();
+  EvaluatorExecutor::ScopedTaskGroup scoped_task_group(task_group.get());
+  InternalValue::ScopedArena scoped_arena(
+      context->value_arena(), evaluator_options_.max_value_arena_byte_size);
+
+  ScopedTraceSpan span(evaluator_options_.tracer, "execute");
+  TupleSlot result;
+  ::zetasql_base::Status status;
+  if (!compiled_value_expr_->EvalSimple({&params_data}, context, &result,
+                                        &status)) {
+    return status;
+  }
+  *expression_output_value = InternalValue::CopyOutOfArena(result.value());
+  return zetasql_base::OkStatus();
+}
 
-    IncrementNumLiveIterators();
-    std::function<void()> deletion_cb = [this]() {
-      DecrementNumLiveIterators();
-    };
-    *query_output_iterator = absl::make_unique<TupleIteratorAdaptor>(
-        output_columns_, tuple_indexes, deletion_cb, std::move(context),
-        std::move(tuple_iter));
-  } else {
-    ZETASQL_RET_CHECK(compiled_value_expr_ != nullptr);
+zetasql_base::Status Evaluator::ExecuteAfterPrepareBatch(
+    absl::Span<const ParameterValueMap> columns,
+    absl::Span<const ParameterValueMap> parameters,
+    const SystemVariableValuesMap& system_variables,
+    std::vector<Value>* expression_output_values) const {
+  absl::ReaderMutexLock l(&mutex_);
+  if (!has_prepare_succeeded()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Invalid prepared expression/query";
+  }
+  ZETASQL_RET_CHECK(is_expr_);
+  if (!parameters.empty() && parameters.size() != columns.size()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Expected " << columns.size() << " sets of parameters, got "
+           << parameters.size();
+  }
+  if (!parameters.empty() && !algebrizer_parameters_.is_named()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Batch evaluation does not support positional parameters";
+  }
+  ZETASQL_RETURN_IF_ERROR(ValidateSystemVariables(system_variables));
 
-    TupleSlot result;
-    ::zetasql_base::Status status;
-    if (!compiled_value_expr_->EvalSimple({&params_data}, context.get(),
-                                          &result, &status)) {
-      return status;
+  expression_output_values->clear();
+  expression_output_values->reserve(columns.size());
+  const ParameterValueMap no_parameters;
+  std::unique_ptr<EvaluationContext> context = AcquireExpressionContext();
+  for (int i = 0; i < columns.size(); ++i) {
+    ParameterValueList columns_list;
+    ZETASQL_RETURN_IF_ERROR(TranslateParameterValueMapToList(
+        columns[i], algebrizer_column_map_, COLUMN_PARAMETER, &columns_list));
+    ZETASQL_RETURN_IF_ERROR(ValidateColumns(columns_list));
+    ParameterValueList parameters_list;
+    if (algebrizer_parameters_.is_named()) {
+      ZETASQL_RETURN_IF_ERROR(TranslateParameterValueMapToList(
+          parameters.empty() ? no_parameters : parameters[i],
+          algebrizer_parameters_.named_parameters(), QUERY_PARAMETER,
+          &parameters_list));
     }
-    *expression_output_value = result.value();
+    ZETASQL_RETURN_IF_ERROR(ValidateParameters(parameters_list));
+
+    Value output;
+    ZETASQL_RETURN_IF_ERROR(EvaluateExpressionLocked(columns_list, parameters_list,
+                                             system_variables, context.get(),
+                                             &output));
+    expression_output_values->push_back(std::move(output));
   }
+  ReleaseExpressionContext(std::move(context));
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status Evaluator::ExecuteAfterPrepareBatchWithOrderedParams(
+    absl::Span<const ParameterValueList> column_rows,
+    const ParameterValueList& parameters,
+    const SystemVariableValuesMap& system_variables,
+    std::vector<Value>* expression_output_values) const {
+  absl::ReaderMutexLock l(&mutex_);
+  if (!has_prepare_succeeded()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Invalid prepared expression/query";
+  }
+  ZETASQL_RET_CHECK(is_expr_);
+  ZETASQL_RET_CHECK(compiled_value_expr_ != nullptr);
+  ZETASQL_RETURN_IF_ERROR(ValidateParameters(parameters));
+  ZETASQL_RETURN_IF_ERROR(ValidateSystemVariables(system_variables));
 
+  expression_output_values->clear();
+  if (column_rows.empty()) return zetasql_base::OkStatus();
+  expression_output_values->reserve(column_rows.size());
+
+  const ParameterValueList& first_columns = column_rows[0];
+  ZETASQL_RETURN_IF_ERROR(ValidateColumns(first_columns));
+  std::unique_ptr<EvaluationContext> context = AcquireExpressionContext();
+  const std::unique_ptr<EvaluatorExecutor::TaskGroup> task_group =
+      CreateTaskGroup();
+  EvaluatorExecutor::ScopedTaskGroup scoped_task_group(task_group.get());
+  {
+    // The columns come first in the TupleData, followed by the parameters and
+    // system variables, which are the same for all the rows. Destroyed before
+    // the context is released, since its slots may refer to Values allocated
+    // in the context's arena.
+    TupleData params_data =
+        CreateParamsData(first_columns, parameters, system_variables);
+    ScopedTraceSpan span(evaluator_options_.tracer, "execute");
+    for (int i = 0; i < column_rows.size(); ++i) {
+      const ParameterValueList& columns = column_rows[i];
+      if (i > 0) {
+        // The other rows are valid if their types are those of the first
+        // row, which avoids looking up the column types for every row.
+        bool same_types = columns.size() == first_columns.size();
+        for (int j = 0; same_types && j < columns.size(); ++j) {
+          same_types = columns[j].type() == first_columns[j].type() ||
+                       columns[j].type()->Equals(first_columns[j].type());
+        }
+        if (!same_types) {
+          ZETASQL_RETURN_IF_ERROR(ValidateColumns(columns));
+        }
+        for (int j = 0; j < columns.size(); ++j) {
+          params_data.mutable_slot(j)->SetValue(columns[j]);
+        }
+      }
+      InternalValue::ScopedArena scoped_arena(
+          context->value_arena(),
+          evaluator_options_.max_value_arena_byte_size);
+      TupleSlot result;
+      ::zetasql_base::Status status;
+      if (!compiled_value_expr_->EvalSimple({&params_data}, context.get(),
+                                            &result, &status)) {
+        return status;
+      }
+      expression_output_values->push_back(
+          InternalValue::CopyOutOfArena(result.value()));
+    }
+  }
+  ReleaseExpressionContext(std::move(context));
   return zetasql_base::OkStatus();
 }
 
@@ -940,6 +1927,39 @@ zetasql_base::StatusOr<std::string> Evaluator::ExplainAfterPrepare() const {
   }
 }
 
+zetasql_base::StatusOr<double> Evaluator::GetCompiledExpressionFraction() const {
+  absl::ReaderMutexLock l(&mutex_);
+  ZETASQL_RET_CHECK(is_prepared()) << "Prepare must be called first";
+  const ExpressionCompilationStats& stats = expression_compilation_stats_;
+  if (stats.num_candidate_expressions == 0) return 0.0;
+  return static_cast<double>(stats.num_compiled_expressions) /
+         stats.num_candidate_expressions;
+}
+
+zetasql_base::StatusOr<OperatorProfileProto> Evaluator::GetLastProfile() const {
+  {
+    absl::ReaderMutexLock l(&mutex_);
+    ZETASQL_RET_CHECK(is_prepared()) << "Prepare must be called first";
+    if (!evaluator_options_.collect_profile) {
+      return ::zetasql_base::FailedPreconditionErrorBuilder()
+             << "EvaluatorOptions::collect_profile is not set";
+    }
+  }
+  absl::MutexLock l(&last_profile_mutex_);
+  if (!last_profile_.has_value()) {
+    return ::zetasql_base::FailedPreconditionErrorBuilder()
+           << "No execution of the query has finished yet";
+  }
+  return last_profile_.value();
+}
+
+void Evaluator::Cancel() const {
+  absl::MutexLock l(&active_contexts_mutex_);
+  for (EvaluationContext* context : active_contexts_) {
+    context->SetCancelled();
+  }
+}
+
 const Type* Evaluator::expression_output_type() const {
   absl::ReaderMutexLock l(&mutex_);
   CHECK(is_expr_) << "Only expressions have output types";
@@ -1107,6 +2127,52 @@ EvaluatorOptions EvaluatorOptionsFromTypeFactory(TypeFactory* type_factory) {
 
 }  // namespace internal
 
+PreparedQueryPlanCache::PreparedQueryPlanCache(int max_entries)
+    : max_entries_(max_entries) {}
+
+PreparedQueryPlanCache::~PreparedQueryPlanCache() {}
+
+int64_t PreparedQueryPlanCache::num_hits() const {
+  absl::MutexLock l(&mutex_);
+  return num_hits_;
+}
+
+int64_t PreparedQueryPlanCache::num_misses() const {
+  absl::MutexLock l(&mutex_);
+  return num_misses_;
+}
+
+std::shared_ptr<const PreparedQueryPlanCache::Plan>
+PreparedQueryPlanCache::Lookup(const std::string& key) {
+  absl::MutexLock l(&mutex_);
+  auto it = entries_by_key_.find(key);
+  if (it == entries_by_key_.end()) {
+    ++num_misses_;
+    return nullptr;
+  }
+  ++num_hits_;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->second;
+}
+
+void PreparedQueryPlanCache::Insert(const std::string& key,
+                                    std::shared_ptr<const Plan> plan) {
+  if (max_entries_ <= 0) return;
+  absl::MutexLock l(&mutex_);
+  auto it = entries_by_key_.find(key);
+  if (it != entries_by_key_.end()) {
+    // A concurrent Prepare() of the same query got here first.
+    entries_.erase(it->second);
+    entries_by_key_.erase(it);
+  }
+  while (static_cast<int>(entries_.size()) >= max_entries_) {
+    entries_by_key_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(key, std::move(plan));
+  entries_by_key_[key] = entries_.begin();
+}
+
 PreparedExpressionBase::PreparedExpressionBase(const std::string& sql,
                                                TypeFactory* type_factory)
     : PreparedExpressionBase(
@@ -1197,11 +2263,38 @@ PreparedExpressionBase::ExecuteAfterPrepareWithOrderedParams(
   return output;
 }
 
+zetasql_base::StatusOr<std::vector<Value>>
+PreparedExpressionBase::ExecuteAfterPrepareBatch(
+    absl::Span<const ParameterValueMap> columns,
+    absl::Span<const ParameterValueMap> parameters,
+    const SystemVariableValuesMap& system_variables) const {
+  std::vector<Value> outputs;
+  ZETASQL_RETURN_IF_ERROR(evaluator_->ExecuteAfterPrepareBatch(
+      columns, parameters, system_variables, &outputs));
+  return outputs;
+}
+
+zetasql_base::StatusOr<std::vector<Value>>
+PreparedExpressionBase::ExecuteAfterPrepareBatchWithOrderedParams(
+    absl::Span<const ParameterValueList> column_rows,
+    const ParameterValueList& parameters,
+    const SystemVariableValuesMap& system_variables) const {
+  std::vector<Value> outputs;
+  ZETASQL_RETURN_IF_ERROR(evaluator_->ExecuteAfterPrepareBatchWithOrderedParams(
+      column_rows, parameters, system_variables, &outputs));
+  return outputs;
+}
+
 zetasql_base::StatusOr<std::string> PreparedExpressionBase::ExplainAfterPrepare()
     const {
   return evaluator_->ExplainAfterPrepare();
 }
 
+zetasql_base::StatusOr<double>
+PreparedExpressionBase::GetCompiledExpressionFraction() const {
+  return evaluator_->GetCompiledExpressionFraction();
+}
+
 const Type* PreparedExpressionBase::output_type() const {
   return evaluator_->expression_output_type();
 }
@@ -1274,6 +2367,18 @@ zetasql_base::StatusOr<std::string> PreparedQueryBase::ExplainAfterPrepare() con
   return evaluator_->ExplainAfterPrepare();
 }
 
+zetasql_base::StatusOr<double> PreparedQueryBase::GetCompiledExpressionFraction()
+    const {
+  return evaluator_->GetCompiledExpressionFraction();
+}
+
+zetasql_base::StatusOr<OperatorProfileProto> PreparedQueryBase::GetLastProfile()
+    const {
+  return evaluator_->GetLastProfile();
+}
+
+void PreparedQueryBase::Cancel() const { evaluator_->Cancel(); }
+
 int PreparedQueryBase::num_columns() const {
   return evaluator_->query_output_columns().size();
 }
@@ -1302,6 +2407,37 @@ void PreparedQueryBase::SetCreateEvaluationCallbackTestOnly(
   return evaluator_->SetCreateEvaluationCallbackTestOnly(cb);
 }
 
+bool EvaluatorTableModifyIterator::NextBatch(int64_t max_rows, Batch* batch) {
+  batch->num_rows = 0;
+  batch->columns.clear();
+  batch->original_keys.clear();
+  if (!has_pending_row_ && !NextRow()) return false;
+  has_pending_row_ = false;
+
+  batch->operation = GetOperation();
+  if (batch->operation != Operation::kDelete) {
+    batch->columns.resize(table()->NumColumns());
+  }
+  const std::optional<std::vector<int>> primary_key = table()->PrimaryKey();
+  if (batch->operation != Operation::kInsert && primary_key.has_value()) {
+    batch->original_keys.resize(primary_key->size());
+  }
+  do {
+    if (GetOperation() != batch->operation) {
+      has_pending_row_ = true;
+      break;
+    }
+    for (int i = 0; i < batch->columns.size(); ++i) {
+      batch->columns[i].push_back(GetColumnValue(i));
+    }
+    for (int i = 0; i < batch->original_keys.size(); ++i) {
+      batch->original_keys[i].push_back(GetOriginalKeyValue(i));
+    }
+    ++batch->num_rows;
+  } while (batch->num_rows < max_rows && NextRow());
+  return true;
+}
+
 PreparedModifyBase::PreparedModifyBase(const std::string& sql,
                                        const EvaluatorOptions& options)
     : evaluator_(new internal::Evaluator(sql, /*is_expr=*/false, options)) {}
@@ -163,6 +163,8 @@
 //     statement.Execute().ValueOrDie();
 //   ... Iterate over `result` (which lists deleted rows) ...
 
+#include <cstdint>
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
@@ -171,14 +173,19 @@
 
 #include "zetasql/public/analyzer.h"
 #include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator_executor.h"
+#include "zetasql/public/evaluator_profile.pb.h"
 #include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/tracer.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
 #include "zetasql/base/clock.h"
@@ -196,6 +203,54 @@ namespace internal {
 class Evaluator;
 }  // namespace internal
 
+// Shares the algebrized plans of queries between PreparedQuery objects, so
+// that preparing a query whose resolved statement and options match those of
+// a query prepared before skips algebrization. A plan does not change once it
+// is built and is executed concurrently by all the queries that share it; the
+// state of each execution is kept apart. Evicts the least recently used plans
+// to stay within 'max_entries'. Thread-safe.
+//
+// Only queries with a non-NULL EvaluatorOptions::type_factory are cached. The
+// plans refer to the types, tables and functions of their queries, so the
+// cache must not outlive that type factory and the catalogs of the queries.
+class PreparedQueryPlanCache {
+ public:
+  explicit PreparedQueryPlanCache(int max_entries);
+  PreparedQueryPlanCache(const PreparedQueryPlanCache&) = delete;
+  PreparedQueryPlanCache& operator=(const PreparedQueryPlanCache&) = delete;
+  ~PreparedQueryPlanCache();
+
+  // Returns the number of Prepare() calls that reused a cached plan.
+  int64_t num_hits() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of Prepare() calls that found no cached plan for a
+  // cacheable query.
+  int64_t num_misses() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  friend class internal::Evaluator;
+  struct Plan;
+  using Entry = std::pair<std::string, std::shared_ptr<const Plan>>;
+
+  // Returns the plan cached for 'key', or NULL if there is none.
+  std::shared_ptr<const Plan> Lookup(const std::string& key)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Caches 'plan' for 'key', evicting the least recently used plan if the
+  // cache is full.
+  void Insert(const std::string& key, std::shared_ptr<const Plan> plan)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const int max_entries_;
+  mutable absl::Mutex mutex_;
+  // The cached plans, from the most to the least recently used.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, std::list<Entry>::iterator> entries_by_key_
+      ABSL_GUARDED_BY(mutex_);
+  int64_t num_hits_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t num_misses_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
 struct EvaluatorOptions {
  public:
   // If 'type_factory' is provided, the return value's Type will
@@ -237,13 +292,113 @@ struct EvaluatorOptions {
   // rows of data (which could otherwise use unbounded memory, depending on
   // data size).
   //
-  // It is also possible for the memory accounting to overestimate the amount of
-  // memory being used. One way this can happen is if Values are copied between
-  // rows during a query (e.g., while evaluating an array join). Large Values
-  // use reference counting to share the same underlying memory, but the memory
-  // accounting charges each of them individually. In some cases, it is
-  // necessary to set this option to a very large value.
+  // Large Values use reference counting to share the same underlying memory
+  // when they are copied between rows (e.g., while evaluating an array join).
+  // Operators that buffer rows charge such memory once, no matter how many of
+  // the buffered rows refer to it. Values nested inside arrays or structs, and
+  // copies made by operators that buffer individual Values (e.g., the
+  // accumulators of aggregate functions), are still charged individually, so
+  // the accounting can overestimate the memory in use in those cases.
   int64_t max_intermediate_byte_size = 128 * 1024 * 1024;
+
+  // If finite, each execution of a PreparedQuery fails with DEADLINE_EXCEEDED
+  // once this much time (as measured by 'clock') has passed since Execute()
+  // was called, including the time the caller spends between calls to
+  // NextRow(). Calling EvaluatorTableIterator::SetDeadline() on the output
+  // iterator replaces this deadline. Like cancellation, the deadline is
+  // checked by the operators every
+  // --zetasql_call_verify_not_aborted_rows_period rows they process.
+  absl::Duration max_execution_time = absl::InfiniteDuration();
+
+  // If non-empty, ORDER BY, GROUP BY and hash joins that would exceed
+  // 'max_intermediate_byte_size' write rows to unnamed temporary files in this
+  // directory and process them in pieces instead of failing. The directory
+  // must exist and be writable. The files are deleted as soon as they are
+  // created, so they do not outlive the process.
+  std::string spill_directory;
+
+  // If positive, table scans, filters, projections and LIMITs are evaluated on
+  // batches of (at most) this many rows at a time, which reduces the per-row
+  // overhead of evaluating long pipelines of these operators. Zero (the
+  // default) evaluates one row at a time. Results are the same either way.
+  int batch_size = 0;
+
+  // The maximum number of threads (including the calling thread) that an
+  // operator may use while evaluating a query. If greater than one, hash joins
+  // partition their build side and probe it on this many threads, and the
+  // filters and projections over each table scan that feeds an aggregation,
+  // sort or join are evaluated on this many threads, each reading a different
+  // subset of the table's rows. In that case
+  // Table::CreateEvaluatorTableIterator() may be called concurrently, the
+  // resulting iterators are used on different threads, and each thread gets an
+  // equal share of 'max_intermediate_byte_size'. The WHERE clauses of DELETE
+  // and UPDATE statements without a FROM clause are also evaluated on this
+  // many threads. Must be set before Prepare() to take full effect.
+  //
+  // The threads other than the calling thread are those of 'executor', which
+  // concurrent executions share, so an execution may use fewer threads than
+  // this while the executor is busy.
+  int num_threads = 1;
+
+  // The executor that runs the parallel parts of executions with 'num_threads'
+  // greater than one. If NULL, uses EvaluatorExecutor::Default(), which is
+  // shared by the whole process. Does not take ownership.
+  EvaluatorExecutor* executor = nullptr;
+
+  // The share of the threads of 'executor' that each execution gets relative
+  // to the other executions that are waiting for threads. At least 1.
+  int executor_weight = 1;
+
+  // If positive, at most this many tasks of each execution run on the threads
+  // of 'executor' at once, in addition to the calling thread.
+  int max_executor_parallelism = 0;
+
+  // If true, Prepare() compiles the simple scalar expressions of the
+  // expression or query (arithmetic, comparisons and logic over INT64, DOUBLE
+  // and BOOL values) into a form that is faster to evaluate. Other expressions
+  // are evaluated as usual. Results are the same either way.
+  bool compile_expressions = false;
+
+  // If true, the evaluation of each query collects runtime statistics about
+  // each operator of its plan (rows, time, memory and function calls), which
+  // PreparedQuery::GetLastProfile() returns once the output iterator has been
+  // destroyed. Slows down evaluation.
+  bool collect_profile = false;
+
+  // If true and 'collect_profile' is true, the profile of each operator also
+  // reports the bytes of the strings, arrays, structs and protos that it
+  // allocated and freed, and the peak of their difference.
+  bool track_allocations = false;
+
+  // If positive, the strings, arrays, structs and protos created while
+  // executing an expression or query are allocated from an arena of up to this
+  // many bytes that is freed all at once when the execution ends, instead of
+  // being allocated and freed one by one. Beyond that size, allocation falls
+  // back to the heap. Rows and results returned to the caller are copied out of
+  // the arena, so this does not change what the caller sees. The arena is
+  // only used on the thread that calls Execute() or NextRow(), not by the
+  // threads started for 'num_threads'.
+  int64_t max_value_arena_byte_size = 0;
+
+  // If positive, a PreparedQuery remembers the rows returned by its recent
+  // executions, up to this many bytes in total, and returns them again when
+  // it is re-executed with the same parameters and system variables while
+  // every scanned Table reports the same GetEvaluatorContentsVersion(). Only
+  // queries that call no volatile or stable functions (e.g., RAND() or
+  // CURRENT_TIMESTAMP()) and no table-valued functions, and whose result is
+  // deterministic, are cached. The least recently used results are evicted
+  // first. Results are only cached once their iterator has returned all rows.
+  int64_t max_result_cache_byte_size = 0;
+
+  // If set, Prepare() of a query reuses the plan of an earlier query with the
+  // same resolved statement and options from this cache, and adds its plan to
+  // the cache otherwise; see PreparedQueryPlanCache. Does not take ownership.
+  PreparedQueryPlanCache* plan_cache = nullptr;
+
+  // If set, Prepare() and the executions report their phases to this tracer;
+  // see tracer.h. To also trace the analysis done by Prepare(), install the
+  // tracer in the AnalyzerOptions too. Does not take ownership.
+  Tracer* tracer = nullptr;
 };
 
 class PreparedExpressionBase {
@@ -404,12 +559,45 @@ class PreparedExpressionBase {
       const ParameterValueList& columns, const ParameterValueList& parameters,
       const SystemVariableValuesMap& system_variables = {}) const;
 
+  // Evaluates the expression once for each element of <columns>, with the
+  // named parameters in the same element of <parameters>, and returns the
+  // results in the same order. <parameters> can be empty if the expression
+  // references no parameters. This is more efficient than calling
+  // ExecuteAfterPrepare() for each row because the evaluations share one
+  // EvaluationContext, so functions like CURRENT_TIMESTAMP() return the same
+  // value for all the rows. Returns the first error of any row.
+  //
+  // REQUIRES: Prepare() has been called successfully.
+  zetasql_base::StatusOr<std::vector<Value>> ExecuteAfterPrepareBatch(
+      absl::Span<const ParameterValueMap> columns,
+      absl::Span<const ParameterValueMap> parameters = {},
+      const SystemVariableValuesMap& system_variables = {}) const;
+
+  // Same as ExecuteAfterPrepareBatch(), but the columns of each element of
+  // <column_rows> are in the order returned by GetReferencedColumns(), and all
+  // the rows use the same <parameters>, passed as in
+  // ExecuteAfterPrepareWithOrderedParams(). This is the most efficient way to
+  // evaluate an expression over many rows: there are no map operations per
+  // row, and the parameters and system variables are validated and copied
+  // once for the whole batch.
+  //
+  // REQUIRES: Prepare() has been called successfully.
+  zetasql_base::StatusOr<std::vector<Value>> ExecuteAfterPrepareBatchWithOrderedParams(
+      absl::Span<const ParameterValueList> column_rows,
+      const ParameterValueList& parameters = {},
+      const SystemVariableValuesMap& system_variables = {}) const;
+
   // Returns a human-readable representation of how this expression would
   // actually be executed. Do not try to interpret this string with code, as the
   // format can change at any time. Requires that Prepare has already been
   // called.
   zetasql_base::StatusOr<std::string> ExplainAfterPrepare() const;
 
+  // Returns the fraction of the candidate scalar expressions that were
+  // compiled because of EvaluatorOptions::compile_expressions, or 0 if there
+  // were none. Requires that Prepare has already been called.
+  zetasql_base::StatusOr<double> GetCompiledExpressionFraction() const;
+
   // REQUIRES: Prepare() or Execute() must be called first.
   const Type* output_type() const;
 
@@ -488,6 +676,15 @@ class PreparedQueryBase {
   //
   // This method is thread safe. Multiple executions can proceed in parallel,
   // each using a different iterator.
+  //
+  // The rows are computed as the iterator's NextRow() is called. Scans,
+  // filters, projections, UNION ALL, LIMIT and the probe sides of joins
+  // stream their inputs, while sorts, aggregations and the build sides of
+  // joins read all of their inputs first. Destroying the iterator before it
+  // is exhausted stops the evaluation (including any threads started for
+  // it), and EvaluatorTableIterator::Cancel() (which may be called while
+  // another thread is in NextRow()) and SetDeadline() take effect the next
+  // time an operator checks for them, which they do every few rows.
   zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>> Execute(
       const ParameterValueMap& parameters = {},
       const SystemVariableValuesMap& system_variables = {});
@@ -515,6 +712,22 @@ class PreparedQueryBase {
   // called.
   zetasql_base::StatusOr<std::string> ExplainAfterPrepare() const;
 
+  // Same as PreparedExpressionBase::GetCompiledExpressionFraction().
+  zetasql_base::StatusOr<double> GetCompiledExpressionFraction() const;
+
+  // Returns the profile of the most recent execution whose output iterator has
+  // been destroyed, in the shape of the plan returned by
+  // ExplainAfterPrepare(). Requires EvaluatorOptions::collect_profile.
+  zetasql_base::StatusOr<OperatorProfileProto> GetLastProfile() const;
+
+  // Cancels the executions of this query that are in progress, from any
+  // thread. The NextRow() of their output iterators returns false with a
+  // CANCELLED status the next time an operator checks, as if
+  // EvaluatorTableIterator::Cancel() had been called on each of them, except
+  // that the iterators of the scanned tables are not cancelled. Executions
+  // that start afterwards are not affected.
+  void Cancel() const;
+
   // Get the schema of the output table of this query. Anonymous column names
   // are empty. (There may be more than one column with the same name.)
   //
@@ -568,6 +781,8 @@ class PreparedQueryBase {
 //     ... Do something with `iter->GetOperation()`, `iter->GetColumnValue(...)`
 //     and `iter->GetOriginalKeyValue()` ...
 //   }
+//
+// Alternatively, NextBatch() returns the modified rows in column batches.
 class EvaluatorTableModifyIterator {
  public:
   enum class Operation { kInsert, kDelete, kUpdate };
@@ -607,9 +822,36 @@ class EvaluatorTableModifyIterator {
   // Returns false if there is no next row. The caller must then check Status().
   virtual bool NextRow() = 0;
 
-  // Returns OK unless the last call to NextRow() returned false because of an
-  // error.
+  // Returns OK unless the last call to NextRow() or NextBatch() returned false
+  // because of an error.
   virtual zetasql_base::Status Status() const = 0;
+
+  // A batch of consecutive rows of the iterator that all have the same
+  // operation, stored column by column so that they can be applied to storage
+  // in a single write batch.
+  struct Batch {
+    Operation operation = Operation::kInsert;
+    int64_t num_rows = 0;
+    // columns[i][r] is GetColumnValue(i) for the r-th row of the batch. Empty
+    // if 'operation' is kDelete.
+    std::vector<std::vector<Value>> columns;
+    // original_keys[i][r] is GetOriginalKeyValue(i) for the r-th row of the
+    // batch. Empty if 'operation' is kInsert or the table has no primary key.
+    std::vector<std::vector<Value>> original_keys;
+  };
+
+  // Replaces the contents of `batch` with up to `max_rows` (which must be
+  // positive) of the next rows, and returns false if there are no rows left,
+  // in which case the caller must then check Status(). Calls to NextBatch()
+  // must not be mixed with calls to NextRow(). The default implementation
+  // calls NextRow() for each row.
+  virtual bool NextBatch(int64_t max_rows, Batch* batch);
+
+ private:
+  // True if the default NextBatch() stopped at a row with a different
+  // operation than the other rows of its batch, which the iterator is still
+  // positioned on.
+  bool has_pending_row_ = false;
 };
 
 // Executes an DML statement and returns an EvaluatorTableModifyIterator.
@@ -618,7 +860,10 @@ class EvaluatorTableModifyIterator {
 // FEATURE_DISALLOW_PRIMARY_KEY_UPDATES is implicitly enabled because primary
 // key updates are currently not supported.
 //
-// The underlying implementation is not optimized for performance.
+// The statement is evaluated in full by Execute(). If
+// EvaluatorOptions::num_threads is greater than one, the WHERE clause is
+// evaluated on multiple threads. Use EvaluatorTableModifyIterator::NextBatch()
+// to consume the modified rows in column batches.
 class PreparedModifyBase {
  public:
   // Constructs using a ResolvedStatement directly. Does not take ownership of
@@ -0,0 +1,432 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmark for PreparedQuery on a fixed set of queries modeled after TPC-H,
+// over synthetic tables generated at several scale factors. For each query and
+// scale factor, prints the number of table rows read per second of evaluation
+// and the peak number of intermediate bytes reported by the query profile.
+//
+// Example:
+//   bazel run -c opt //zetasql/public:evaluator_benchmark -- \
+//       --scale_factors=0.001,0.01 --num_threads=4
+//
+// At scale factor 1, the tables have the TPC-H cardinalities (e.g., 6 million
+// rows in 'lineitem'), which is more than the reference implementation is
+// meant to handle, so the default scale factors are much smaller.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/evaluator.h"
+#include "zetasql/public/evaluator_profile.pb.h"
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
+#include "zetasql/base/statusor.h"
+
+ABSL_FLAG(std::string, scale_factors, "0.001,0.01",
+          "Comma-separated list of scale factors to generate the tables at. "
+          "At scale factor 1, 'lineitem' has 6 million rows.");
+ABSL_FLAG(int32_t, num_iterations, 3,
+          "The number of timed executions of each query. The reported rate "
+          "is based on the fastest one.");
+ABSL_FLAG(int32_t, num_threads, 1, "Sets EvaluatorOptions::num_threads.");
+ABSL_FLAG(std::string, queries, "",
+          "Comma-separated list of the queries to run (e.g., 'Q1,Q6'). Runs "
+          "all the queries if empty.");
+
+namespace zetasql {
+namespace {
+
+// The number of rows of each table at scale factor 1, as in TPC-H.
+constexpr int64_t kNumCustomersPerScaleFactor = 150000;
+constexpr int64_t kNumOrdersPerScaleFactor = 1500000;
+// 'lineitem' has between 1 and 7 rows per order, 4 on average.
+constexpr int kMaxLineItemsPerOrder = 7;
+constexpr int kNumNations = 25;
+constexpr int kNumRegions = 5;
+
+// The range of 'o_orderdate', as the number of days since the epoch, from
+// 1992-01-01 to 1998-08-02.
+constexpr int32_t kMinOrderDate = 8035;
+constexpr int32_t kMaxOrderDate = 10440;
+
+struct BenchmarkQuery {
+  std::string name;
+  std::string sql;
+  // The tables read by the query, whose row counts make up the rows per
+  // second that are reported.
+  std::vector<std::string> tables;
+};
+
+// Simplified versions of TPC-H queries 1, 3, 5, 6, 12 and 13 that cover
+// filtered scans, aggregations, hash joins, outer joins and sorts.
+const std::vector<BenchmarkQuery>& GetBenchmarkQueries() {
+  static const auto* queries = new std::vector<BenchmarkQuery>{
+      {"Q1",
+       "SELECT l_returnflag, l_linestatus, SUM(l_quantity) AS sum_qty, "
+       "  SUM(l_extendedprice) AS sum_base_price, "
+       "  SUM(l_extendedprice * (1 - l_discount)) AS sum_disc_price, "
+       "  SUM(l_extendedprice * (1 - l_discount) * (1 + l_tax)) AS sum_charge, "
+       "  AVG(l_quantity) AS avg_qty, AVG(l_discount) AS avg_disc, "
+       "  COUNT(*) AS count_order "
+       "FROM lineitem "
+       "WHERE l_shipdate <= DATE '1998-09-02' "
+       "GROUP BY l_returnflag, l_linestatus "
+       "ORDER BY l_returnflag, l_linestatus",
+       {"lineitem"}},
+      {"Q3",
+       "SELECT l_orderkey, SUM(l_extendedprice * (1 - l_discount)) AS revenue, "
+       "  o_orderdate "
+       "FROM customer "
+       "  JOIN orders ON c_custkey = o_custkey "
+       "  JOIN lineitem ON l_orderkey = o_orderkey "
+       "WHERE c_mktsegment = 'BUILDING' AND o_orderdate < DATE '1995-03-15' "
+       "  AND l_shipdate > DATE '1995-03-15' "
+       "GROUP BY l_orderkey, o_orderdate "
+       "ORDER BY revenue DESC, o_orderdate "
+       "LIMIT 10",
+       {"customer", "orders", "lineitem"}},
+      {"Q5",
+       "SELECT n_name, SUM(l_extendedprice * (1 - l_discount)) AS revenue "
+       "FROM customer "
+       "  JOIN orders ON c_custkey = o_custkey "
+       "  JOIN lineitem ON l_orderkey = o_orderkey "
+       "  JOIN nation ON c_nationkey = n_nationkey "
+       "WHERE n_regionkey = 2 AND o_orderdate >= DATE '1994-01-01' "
+       "  AND o_orderdate < DATE '1995-01-01' "
+       "GROUP BY n_name "
+       "ORDER BY revenue DESC",
+       {"customer", "orders", "lineitem", "nation"}},
+      {"Q6",
+       "SELECT SUM(l_extendedprice * l_discount) AS revenue "
+       "FROM lineitem "
+       "WHERE l_shipdate >= DATE '1994-01-01' "
+       "  AND l_shipdate < DATE '1995-01-01' "
+       "  AND l_discount BETWEEN 0.05 AND 0.07 AND l_quantity < 24",
+       {"lineitem"}},
+      {"Q12",
+       "SELECT l_shipmode, "
+       "  SUM(CASE WHEN o_orderpriority IN ('1-URGENT', '2-HIGH') "
+       "      THEN 1 ELSE 0 END) AS high_line_count, "
+       "  SUM(CASE WHEN o_orderpriority NOT IN ('1-URGENT', '2-HIGH') "
+       "      THEN 1 ELSE 0 END) AS low_line_count "
+       "FROM orders JOIN lineitem ON o_orderkey = l_orderkey "
+       "WHERE l_shipmode IN ('MAIL', 'SHIP') "
+       "  AND l_shipdate >= DATE '1994-01-01' "
+       "  AND l_shipdate < DATE '1995-01-01' "
+       "GROUP BY l_shipmode "
+       "ORDER BY l_shipmode",
+       {"orders", "lineitem"}},
+      {"Q13",
+       "SELECT c_count, COUNT(*) AS custdist "
+       "FROM (SELECT c_custkey, COUNT(o_orderkey) AS c_count "
+       "      FROM customer LEFT OUTER JOIN orders "
+       "        ON c_custkey = o_custkey AND o_orderpriority != '5-LOW' "
+       "      GROUP BY c_custkey) "
+       "GROUP BY c_count "
+       "ORDER BY custdist DESC, c_count DESC",
+       {"customer", "orders"}},
+  };
+  return *queries;
+}
+
+// Returns a uniformly distributed element of 'values'.
+template <typename T>
+const T& PickOne(const std::vector<T>& values, std::mt19937_64* rng) {
+  return values[std::uniform_int_distribution<size_t>(0, values.size() - 1)(
+      *rng)];
+}
+
+// Returns a uniformly distributed DOUBLE in ['min', 'max'), rounded to cents.
+Value RandomPrice(double min, double max, std::mt19937_64* rng) {
+  const double price = std::uniform_real_distribution<double>(min, max)(*rng);
+  return Value::Double(std::round(price * 100) / 100);
+}
+
+// Adds the tables 'nation', 'customer', 'orders' and 'lineitem' at
+// 'scale_factor' to 'catalog'. The data is pseudo-random with a fixed seed, so
+// it is the same on every run. DECIMAL columns of TPC-H are DOUBLE here.
+// Other columns that the queries do not use are left out. Returns the number
+// of rows of each table.
+std::map<std::string, int64_t> AddTables(double scale_factor,
+                                         SimpleCatalog* catalog) {
+  std::mt19937_64 rng(/*seed=*/20190601);
+  const std::vector<std::string> segments = {
+      "AUTOMOBILE", "BUILDING", "FURNITURE", "HOUSEHOLD", "MACHINERY"};
+  const std::vector<std::string> priorities = {
+      "1-URGENT", "2-HIGH", "3-MEDIUM", "4-NOT SPECIFIED", "5-LOW"};
+  const std::vector<std::string> ship_modes = {
+      "AIR", "FOB", "MAIL", "RAIL", "REG AIR", "SHIP", "TRUCK"};
+
+  std::vector<std::vector<Value>> nation_rows;
+  for (int i = 0; i < kNumNations; ++i) {
+    nation_rows.push_back({Value::Int64(i),
+                           Value::String(absl::StrFormat("NATION%02d", i)),
+                           Value::Int64(i % kNumRegions)});
+  }
+
+  const int64_t num_customers = std::max<int64_t>(
+      1, static_cast<int64_t>(kNumCustomersPerScaleFactor * scale_factor));
+  std::vector<std::vector<Value>> customer_rows;
+  customer_rows.reserve(num_customers);
+  for (int64_t i = 1; i <= num_customers; ++i) {
+    customer_rows.push_back(
+        {Value::Int64(i),
+         Value::String(absl::StrFormat("Customer#%09d", i)),
+         Value::Int64(std::uniform_int_distribution<int>(
+             0, kNumNations - 1)(rng)),
+         RandomPrice(-999.99, 9999.99, &rng),
+         Value::String(PickOne(segments, &rng))});
+  }
+
+  const int64_t num_orders = std::max<int64_t>(
+      1, static_cast<int64_t>(kNumOrdersPerScaleFactor * scale_factor));
+  std::vector<std::vector<Value>> order_rows;
+  std::vector<std::vector<Value>> lineitem_rows;
+  order_rows.reserve(num_orders);
+  lineitem_rows.reserve(num_orders * (kMaxLineItemsPerOrder + 1) / 2);
+  std::uniform_int_distribution<int32_t> order_date(kMinOrderDate,
+                                                    kMaxOrderDate);
+  std::uniform_int_distribution<int64_t> customer(1, num_customers);
+  std::uniform_int_distribution<int> num_line_items(1, kMaxLineItemsPerOrder);
+  std::uniform_int_distribution<int> ship_delay(1, 121);
+  std::uniform_int_distribution<int> quantity(1, 50);
+  std::uniform_int_distribution<int> percent(0, 10);
+  for (int64_t order_key = 1; order_key <= num_orders; ++order_key) {
+    const int32_t date = order_date(rng);
+    double total_price = 0;
+    const int line_items = num_line_items(rng);
+    int num_shipped = 0;
+    for (int i = 0; i < line_items; ++i) {
+      const int32_t ship_date = date + ship_delay(rng);
+      const bool shipped = ship_date <= kMaxOrderDate;
+      num_shipped += shipped;
+      const int64_t qty = quantity(rng);
+      const double price = qty * RandomPrice(900, 2000, &rng).double_value();
+      total_price += price;
+      lineitem_rows.push_back(
+          {Value::Int64(order_key),
+           Value::Int64(std::uniform_int_distribution<int64_t>(
+               1, num_orders / 7 + 1)(rng)),
+           Value::Double(qty), Value::Double(price),
+           Value::Double(percent(rng) / 100.0),
+           Value::Double(percent(rng) % 9 / 100.0),
+           Value::String(!shipped ? "N" : (rng() % 2 == 0 ? "R" : "A")),
+           Value::String(shipped ? "F" : "O"), Value::Date(ship_date),
+           Value::String(PickOne(ship_modes, &rng))});
+    }
+    const char* status =
+        num_shipped == line_items ? "F" : (num_shipped == 0 ? "O" : "P");
+    order_rows.push_back({Value::Int64(order_key),
+                          Value::Int64(customer(rng)), Value::String(status),
+                          Value::Double(total_price), Value::Date(date),
+                          Value::String(PickOne(priorities, &rng))});
+  }
+
+  std::map<std::string, int64_t> num_rows = {
+      {"nation", nation_rows.size()},
+      {"customer", customer_rows.size()},
+      {"orders", order_rows.size()},
+      {"lineitem", lineitem_rows.size()}};
+
+  auto nation = absl::make_unique<SimpleTable>(
+      "nation", std::vector<SimpleTable::NameAndType>{
+                    {"n_nationkey", types::Int64Type()},
+                    {"n_name", types::StringType()},
+                    {"n_regionkey", types::Int64Type()}});
+  nation->SetContents(nation_rows);
+  catalog->AddOwnedTable(std::move(nation));
+
+  auto customer_table = absl::make_unique<SimpleTable>(
+      "customer", std::vector<SimpleTable::NameAndType>{
+                      {"c_custkey", types::Int64Type()},
+                      {"c_name", types::StringType()},
+                      {"c_nationkey", types::Int64Type()},
+                      {"c_acctbal", types::DoubleType()},
+                      {"c_mktsegment", types::StringType()}});
+  customer_table->SetContents(customer_rows);
+  catalog->AddOwnedTable(std::move(customer_table));
+
+  auto orders = absl::make_unique<SimpleTable>(
+      "orders", std::vector<SimpleTable::NameAndType>{
+                    {"o_orderkey", types::Int64Type()},
+                    {"o_custkey", types::Int64Type()},
+                    {"o_orderstatus", types::StringType()},
+                    {"o_totalprice", types::DoubleType()},
+                    {"o_orderdate", types::DateType()},
+                    {"o_orderpriority", types::StringType()}});
+  orders->SetContents(order_rows);
+  catalog->AddOwnedTable(std::move(orders));
+
+  auto lineitem = absl::make_unique<SimpleTable>(
+      "lineitem", std::vector<SimpleTable::NameAndType>{
+                      {"l_orderkey", types::Int64Type()},
+                      {"l_partkey", types::Int64Type()},
+                      {"l_quantity", types::DoubleType()},
+                      {"l_extendedprice", types::DoubleType()},
+                      {"l_discount", types::DoubleType()},
+                      {"l_tax", types::DoubleType()},
+                      {"l_returnflag", types::StringType()},
+                      {"l_linestatus", types::StringType()},
+                      {"l_shipdate", types::DateType()},
+                      {"l_shipmode", types::StringType()}});
+  lineitem->SetContents(lineitem_rows);
+  catalog->AddOwnedTable(std::move(lineitem));
+  return num_rows;
+}
+
+// Returns the largest OperatorProfileProto::peak_memory_bytes in the tree
+// rooted at 'profile'.
+int64_t GetPeakMemoryBytes(const OperatorProfileProto& profile) {
+  int64_t peak = profile.peak_memory_bytes();
+  for (const OperatorProfileProto& input : profile.inputs()) {
+    peak = std::max(peak, GetPeakMemoryBytes(input));
+  }
+  return peak;
+}
+
+// Executes 'query' and returns the number of output rows.
+zetasql_base::StatusOr<int64_t> ExecuteAndCountRows(PreparedQuery* query) {
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+                   query->Execute());
+  int64_t num_rows = 0;
+  while (iter->NextRow()) {
+    ++num_rows;
+  }
+  ZETASQL_RETURN_IF_ERROR(iter->Status());
+  return num_rows;
+}
+
+// Runs 'benchmark_query' against 'catalog', whose tables have 'num_rows' rows,
+// and prints one line of results.
+zetasql_base::Status RunQuery(const BenchmarkQuery& benchmark_query,
+                      double scale_factor,
+                      const std::map<std::string, int64_t>& num_rows,
+                      SimpleCatalog* catalog) {
+  AnalyzerOptions analyzer_options;
+  analyzer_options.set_prune_unused_columns(true);
+
+  int64_t num_table_rows = 0;
+  for (const std::string& table_name : benchmark_query.tables) {
+    num_table_rows += num_rows.at(table_name);
+  }
+
+  EvaluatorOptions options;
+  options.num_threads = absl::GetFlag(FLAGS_num_threads);
+  PreparedQuery query(benchmark_query.sql, options);
+  ZETASQL_RETURN_IF_ERROR(query.Prepare(analyzer_options, catalog));
+
+  absl::Duration fastest = absl::InfiniteDuration();
+  int64_t num_output_rows = 0;
+  for (int i = 0; i < std::max(absl::GetFlag(FLAGS_num_iterations), 1); ++i) {
+    const absl::Time start = absl::Now();
+    ZETASQL_ASSIGN_OR_RETURN(num_output_rows, ExecuteAndCountRows(&query));
+    fastest = std::min(fastest, absl::Now() - start);
+  }
+
+  // Profiling slows down evaluation, so the peak memory comes from a separate
+  // execution that is not timed.
+  EvaluatorOptions profile_options = options;
+  profile_options.collect_profile = true;
+  PreparedQuery profiled_query(benchmark_query.sql, profile_options);
+  ZETASQL_RETURN_IF_ERROR(profiled_query.Prepare(analyzer_options, catalog));
+  ZETASQL_RETURN_IF_ERROR(ExecuteAndCountRows(&profiled_query).status());
+  ZETASQL_ASSIGN_OR_RETURN(const OperatorProfileProto profile,
+                   profiled_query.GetLastProfile());
+
+  const double seconds = std::max(absl::ToDoubleSeconds(fastest), 1e-9);
+  std::cout << absl::StrFormat("%-5s %8g %12d %8d %10.3f %14.0f %16d",
+                               benchmark_query.name, scale_factor,
+                               num_table_rows, num_output_rows,
+                               absl::ToDoubleMilliseconds(fastest),
+                               num_table_rows / seconds,
+                               GetPeakMemoryBytes(profile))
+            << std::endl;
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status Run() {
+  std::vector<double> scale_factors;
+  for (absl::string_view scale_factor :
+       absl::StrSplit(absl::GetFlag(FLAGS_scale_factors), ',',
+                      absl::SkipWhitespace())) {
+    double value;
+    if (!absl::SimpleAtod(scale_factor, &value) || value <= 0) {
+      return zetasql_base::InvalidArgumentErrorBuilder()
+             << "Invalid --scale_factors: "
+             << absl::GetFlag(FLAGS_scale_factors);
+    }
+    scale_factors.push_back(value);
+  }
+  const std::vector<std::string> selected_queries =
+      absl::StrSplit(absl::GetFlag(FLAGS_queries), ',', absl::SkipWhitespace());
+
+  std::cout << absl::StrFormat("%-5s %8s %12s %8s %10s %14s %16s", "query",
+                               "sf", "table_rows", "out_rows", "millis",
+                               "rows_per_sec", "peak_interm_bytes")
+            << std::endl;
+  for (const double scale_factor : scale_factors) {
+    SimpleCatalog catalog("benchmark_catalog");
+    catalog.AddZetaSQLFunctions();
+    const std::map<std::string, int64_t> num_rows =
+        AddTables(scale_factor, &catalog);
+    for (const BenchmarkQuery& query : GetBenchmarkQueries()) {
+      if (!selected_queries.empty() &&
+          std::find(selected_queries.begin(), selected_queries.end(),
+                    query.name) == selected_queries.end()) {
+        continue;
+      }
+      ZETASQL_RETURN_IF_ERROR(RunQuery(query, scale_factor, num_rows, &catalog));
+    }
+  }
+  return zetasql_base::OkStatus();
+}
+
+}  // namespace
+}  // namespace zetasql
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  const zetasql_base::Status status = zetasql::Run();
+  if (!status.ok()) {
+    std::cout << "ERROR: " << status << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,233 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/evaluator_executor.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "zetasql/base/logging.h"
+#include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
+
+ABSL_FLAG(int32_t, zetasql_evaluator_executor_threads, 0,
+          "The number of threads of the EvaluatorExecutor that evaluations "
+          "share by default. If not positive, uses the number of CPUs.");
+
+ABSL_FLAG(int64_t, zetasql_evaluator_executor_max_queued_tasks, 1024,
+          "The maximum number of queued tasks of the EvaluatorExecutor that "
+          "evaluations share by default.");
+
+namespace zetasql {
+
+class EvaluatorExecutor::Task {
+ public:
+  enum State { kQueued, kRunning, kDone, kCancelled };
+
+  explicit Task(std::function<void()> fn) : fn(std::move(fn)) {}
+
+  static bool IsFinished(Task* task) {
+    return task->state == kDone || task->state == kCancelled;
+  }
+
+  const std::function<void()> fn;
+  // Guarded by the mutex of the executor.
+  State state = kQueued;
+  absl::Time schedule_time = absl::Now();
+};
+
+namespace {
+
+thread_local EvaluatorExecutor::TaskGroup* current_task_group = nullptr;
+
+}  // namespace
+
+EvaluatorExecutor::EvaluatorExecutor(const Options& options)
+    : max_queued_tasks_(options.max_queued_tasks) {
+  int num_threads = options.num_threads;
+  if (num_threads <= 0) {
+    num_threads = std::max<int>(1, std::thread::hardware_concurrency());
+  }
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this] { RunTasks(); });
+  }
+}
+
+EvaluatorExecutor::~EvaluatorExecutor() {
+  {
+    absl::MutexLock l(&mutex_);
+    CHECK(groups_.empty()) << "A TaskGroup outlived its EvaluatorExecutor";
+    stopping_ = true;
+  }
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+EvaluatorExecutor* EvaluatorExecutor::Default() {
+  static EvaluatorExecutor* executor = [] {
+    Options options;
+    options.num_threads =
+        absl::GetFlag(FLAGS_zetasql_evaluator_executor_threads);
+    options.max_queued_tasks =
+        absl::GetFlag(FLAGS_zetasql_evaluator_executor_max_queued_tasks);
+    return new EvaluatorExecutor(options);
+  }();
+  return executor;
+}
+
+std::unique_ptr<EvaluatorExecutor::TaskGroup>
+EvaluatorExecutor::CreateTaskGroup(int weight, int max_parallelism) {
+  std::unique_ptr<TaskGroup> group = absl::WrapUnique(
+      new TaskGroup(this, std::max(weight, 1), max_parallelism));
+  absl::MutexLock l(&mutex_);
+  groups_.push_back(group.get());
+  return group;
+}
+
+EvaluatorExecutor::Metrics EvaluatorExecutor::GetMetrics() const {
+  absl::MutexLock l(&mutex_);
+  return metrics_;
+}
+
+EvaluatorExecutor::TaskGroup* EvaluatorExecutor::PickGroupLocked() const {
+  TaskGroup* best = nullptr;
+  for (TaskGroup* group : groups_) {
+    if (!group->CanStartTaskLocked()) continue;
+    if (best == nullptr) {
+      best = group;
+      continue;
+    }
+    // Compare num_running_tasks_ / weight_ without dividing. Ties go to the
+    // group whose oldest task has waited the longest.
+    const int64_t group_share =
+        static_cast<int64_t>(group->num_running_tasks_) * best->weight_;
+    const int64_t best_share =
+        static_cast<int64_t>(best->num_running_tasks_) * group->weight_;
+    if (group_share < best_share ||
+        (group_share == best_share &&
+         group->queue_.front()->schedule_time <
+             best->queue_.front()->schedule_time)) {
+      best = group;
+    }
+  }
+  return best;
+}
+
+void EvaluatorExecutor::RunTasks() {
+  while (true) {
+    std::shared_ptr<Task> task;
+    TaskGroup* group;
+    absl::Time start_time;
+    {
+      absl::MutexLock l(&mutex_);
+      mutex_.Await(
+          absl::Condition(this, &EvaluatorExecutor::CanRunTaskLocked));
+      if (stopping_) return;
+      group = PickGroupLocked();
+      task = std::move(group->queue_.front());
+      group->queue_.pop_front();
+      --num_queued_tasks_;
+      ++group->num_running_tasks_;
+      task->state = Task::kRunning;
+      start_time = absl::Now();
+      const absl::Duration queue_time = start_time - task->schedule_time;
+      metrics_.total_queue_time += queue_time;
+      group->metrics_.total_queue_time += queue_time;
+    }
+
+    {
+      ScopedTaskGroup scoped_group(group);
+      task->fn();
+    }
+
+    absl::MutexLock l(&mutex_);
+    const absl::Duration run_time = absl::Now() - start_time;
+    metrics_.total_run_time += run_time;
+    ++metrics_.num_completed_tasks;
+    group->metrics_.total_run_time += run_time;
+    ++group->metrics_.num_completed_tasks;
+    --group->num_running_tasks_;
+    task->state = Task::kDone;
+  }
+}
+
+EvaluatorExecutor::TaskGroup::~TaskGroup() {
+  absl::MutexLock l(&executor_->mutex_);
+  CHECK(queue_.empty() && num_running_tasks_ == 0)
+      << "A TaskGroup was destroyed before its tasks finished";
+  executor_->groups_.erase(std::find(executor_->groups_.begin(),
+                                     executor_->groups_.end(), this));
+}
+
+std::shared_ptr<EvaluatorExecutor::Task>
+EvaluatorExecutor::TaskGroup::Schedule(std::function<void()> fn) {
+  absl::MutexLock l(&executor_->mutex_);
+  if (executor_->num_queued_tasks_ >= executor_->max_queued_tasks_) {
+    ++executor_->metrics_.num_rejected_tasks;
+    ++metrics_.num_rejected_tasks;
+    return nullptr;
+  }
+  auto task = std::make_shared<Task>(std::move(fn));
+  queue_.push_back(task);
+  ++executor_->num_queued_tasks_;
+  ++executor_->metrics_.num_scheduled_tasks;
+  ++metrics_.num_scheduled_tasks;
+  return task;
+}
+
+bool EvaluatorExecutor::TaskGroup::Cancel(Task* task) {
+  absl::MutexLock l(&executor_->mutex_);
+  if (task->state != Task::kQueued) return false;
+  auto it = std::find_if(
+      queue_.begin(), queue_.end(),
+      [task](const std::shared_ptr<Task>& queued) {
+        return queued.get() == task;
+      });
+  CHECK(it != queue_.end());
+  queue_.erase(it);
+  --executor_->num_queued_tasks_;
+  ++executor_->metrics_.num_cancelled_tasks;
+  ++metrics_.num_cancelled_tasks;
+  task->state = Task::kCancelled;
+  return true;
+}
+
+void EvaluatorExecutor::TaskGroup::Wait(Task* task) {
+  absl::MutexLock l(&executor_->mutex_);
+  executor_->mutex_.Await(absl::Condition(&Task::IsFinished, task));
+}
+
+EvaluatorExecutor::Metrics EvaluatorExecutor::TaskGroup::GetMetrics() const {
+  absl::MutexLock l(&executor_->mutex_);
+  return metrics_;
+}
+
+EvaluatorExecutor::TaskGroup* EvaluatorExecutor::TaskGroup::Current() {
+  return current_task_group;
+}
+
+EvaluatorExecutor::ScopedTaskGroup::ScopedTaskGroup(TaskGroup* group)
+    : saved_(current_task_group) {
+  current_task_group = group;
+}
+
+EvaluatorExecutor::ScopedTaskGroup::~ScopedTaskGroup() {
+  current_task_group = saved_;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,195 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_EVALUATOR_EXECUTOR_H_
+#define ZETASQL_PUBLIC_EVALUATOR_EXECUTOR_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include <cstdint>
+#include "absl/base/thread_annotations.h"
+#include "absl/flags/declare.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+ABSL_DECLARE_FLAG(int32_t, zetasql_evaluator_executor_threads);
+ABSL_DECLARE_FLAG(int64_t, zetasql_evaluator_executor_max_queued_tasks);
+
+namespace zetasql {
+
+// A pool of threads that runs the parallel parts of evaluations with
+// EvaluatorOptions::num_threads greater than one, so that concurrent
+// PreparedQuery, PreparedExpression and PreparedModify executions share a
+// bounded number of threads instead of each starting their own.
+//
+// Each execution schedules its tasks in its own TaskGroup. An idle thread
+// runs the oldest task of the group with the fewest running tasks relative to
+// its weight, skipping groups that already run their maximum number of tasks
+// at once. Schedule() rejects tasks while more than
+// Options::max_queued_tasks tasks are queued. The evaluator then does that
+// work on the thread that evaluates the query, with less parallelism, and it
+// also takes back tasks that have not started after a while, so evaluations
+// finish even when all the threads are busy.
+//
+// Thread-safe.
+class EvaluatorExecutor {
+ public:
+  struct Options {
+    // The number of threads. If not positive, uses the number of CPUs.
+    int num_threads = 0;
+    // The maximum number of tasks that wait for a thread at once.
+    int64_t max_queued_tasks = 1024;
+  };
+
+  // Counters of the tasks of an executor or of a TaskGroup. The queue time of
+  // a task is the time from Schedule() until a thread starts running it.
+  struct Metrics {
+    int64_t num_scheduled_tasks = 0;
+    int64_t num_rejected_tasks = 0;
+    // Tasks that were removed by Cancel() before they started.
+    int64_t num_cancelled_tasks = 0;
+    int64_t num_completed_tasks = 0;
+    absl::Duration total_queue_time;
+    absl::Duration total_run_time;
+  };
+
+  class Task;
+  class TaskGroup;
+  class ScopedTaskGroup;
+
+  explicit EvaluatorExecutor(const Options& options);
+  EvaluatorExecutor(const EvaluatorExecutor&) = delete;
+  EvaluatorExecutor& operator=(const EvaluatorExecutor&) = delete;
+
+  // Stops the threads. All the TaskGroups must have been destroyed.
+  ~EvaluatorExecutor();
+
+  // Returns the executor that evaluations use unless they set
+  // EvaluatorOptions::executor. Its threads and queue are sized by
+  // --zetasql_evaluator_executor_threads and
+  // --zetasql_evaluator_executor_max_queued_tasks when it is first used. It is
+  // never destroyed.
+  static EvaluatorExecutor* Default();
+
+  // Returns a new group for the tasks of one execution. 'weight' (at least 1)
+  // is the share of the threads that the group gets relative to other groups
+  // that have queued tasks. If 'max_parallelism' is positive, at most that
+  // many tasks of the group run at once. The group must not outlive the
+  // executor.
+  std::unique_ptr<TaskGroup> CreateTaskGroup(int weight, int max_parallelism);
+
+  int num_threads() const { return static_cast<int>(threads_.size()); }
+
+  Metrics GetMetrics() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // Runs tasks until the executor is destroyed.
+  void RunTasks() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the group whose oldest queued task should run next, or NULL if
+  // no task can run.
+  TaskGroup* PickGroupLocked() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  bool CanRunTaskLocked() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return stopping_ || PickGroupLocked() != nullptr;
+  }
+
+  const int64_t max_queued_tasks_;
+  std::vector<std::thread> threads_;
+
+  mutable absl::Mutex mutex_;
+  // The live groups, in order of creation.
+  std::vector<TaskGroup*> groups_ ABSL_GUARDED_BY(mutex_);
+  int64_t num_queued_tasks_ ABSL_GUARDED_BY(mutex_) = 0;
+  Metrics metrics_ ABSL_GUARDED_BY(mutex_);
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// The tasks of one execution. Thread-safe.
+class EvaluatorExecutor::TaskGroup {
+ public:
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  // Every task must have finished or been cancelled.
+  ~TaskGroup();
+
+  // Queues 'fn' to run on a thread of the executor, with Current() returning
+  // this group. Returns NULL if the executor rejects the task because too
+  // many tasks are queued.
+  std::shared_ptr<Task> Schedule(std::function<void()> fn);
+
+  // If 'task' has not started running, removes it from the queue, so that it
+  // never runs, and returns true. Otherwise returns false.
+  bool Cancel(Task* task);
+
+  // Waits until 'task' has finished running or has been cancelled.
+  void Wait(Task* task);
+
+  EvaluatorExecutor* executor() const { return executor_; }
+
+  Metrics GetMetrics() const;
+
+  // Returns the group that the parallel parts of the evaluation on the
+  // current thread schedule their tasks in, or NULL if they start their own
+  // threads. Set by ScopedTaskGroup, and by the executor while it runs a
+  // task.
+  static TaskGroup* Current();
+
+ private:
+  friend class EvaluatorExecutor;
+
+  TaskGroup(EvaluatorExecutor* executor, int weight, int max_parallelism)
+      : executor_(executor),
+        weight_(weight),
+        max_parallelism_(max_parallelism) {}
+
+  // True if a thread may start the next queued task.
+  bool CanStartTaskLocked() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(executor_->mutex_) {
+    return !queue_.empty() &&
+           (max_parallelism_ <= 0 || num_running_tasks_ < max_parallelism_);
+  }
+
+  EvaluatorExecutor* const executor_;
+  const int weight_;
+  const int max_parallelism_;
+  std::deque<std::shared_ptr<Task>> queue_
+      ABSL_GUARDED_BY(executor_->mutex_);
+  int num_running_tasks_ ABSL_GUARDED_BY(executor_->mutex_) = 0;
+  Metrics metrics_ ABSL_GUARDED_BY(executor_->mutex_);
+};
+
+// Makes TaskGroup::Current() return 'group' (which may be NULL) on the
+// current thread until destroyed.
+class EvaluatorExecutor::ScopedTaskGroup {
+ public:
+  explicit ScopedTaskGroup(TaskGroup* group);
+  ScopedTaskGroup(const ScopedTaskGroup&) = delete;
+  ScopedTaskGroup& operator=(const ScopedTaskGroup&) = delete;
+  ~ScopedTaskGroup();
+
+ private:
+  TaskGroup* const saved_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_EVALUATOR_EXECUTOR_H_
@@ -0,0 +1,244 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/evaluator_executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace zetasql {
+namespace {
+
+using testing::ElementsAre;
+using Task = EvaluatorExecutor::Task;
+using TaskGroup = EvaluatorExecutor::TaskGroup;
+
+EvaluatorExecutor::Options MakeOptions(int num_threads,
+                                       int64_t max_queued_tasks) {
+  EvaluatorExecutor::Options options;
+  options.num_threads = num_threads;
+  options.max_queued_tasks = max_queued_tasks;
+  return options;
+}
+
+TEST(EvaluatorExecutorTest, RunsScheduledTasks) {
+  EvaluatorExecutor executor(MakeOptions(/*num_threads=*/3,
+                                         /*max_queued_tasks=*/100));
+  EXPECT_EQ(executor.num_threads(), 3);
+  std::atomic<int> count(0);
+  {
+    std::unique_ptr<TaskGroup> group =
+        executor.CreateTaskGroup(/*weight=*/1, /*max_parallelism=*/0);
+    std::vector<std::shared_ptr<Task>> tasks;
+    for (int i = 0; i < 10; ++i) {
+      tasks.push_back(group->Schedule([&count] { ++count; }));
+      ASSERT_NE(tasks.back(), nullptr);
+    }
+    for (const std::shared_ptr<Task>& task : tasks) {
+      group->Wait(task.get());
+    }
+    EXPECT_EQ(count.load(), 10);
+
+    const EvaluatorExecutor::Metrics metrics = group->GetMetrics();
+    EXPECT_EQ(metrics.num_scheduled_tasks, 10);
+    EXPECT_EQ(metrics.num_completed_tasks, 10);
+    EXPECT_EQ(metrics.num_rejected_tasks, 0);
+    EXPECT_EQ(metrics.num_cancelled_tasks, 0);
+  }
+  EXPECT_EQ(executor.GetMetrics().num_completed_tasks, 10);
+}
+
+TEST(EvaluatorExecutorTest, RejectsTasksBeyondQueueLimit) {
+  EvaluatorExecutor executor(MakeOptions(/*num_threads=*/1,
+                                         /*max_queued_tasks=*/1));
+  std::unique_ptr<TaskGroup> group =
+      executor.CreateTaskGroup(/*weight=*/1, /*max_parallelism=*/0);
+  absl::Notification started;
+  absl::Notification release;
+  std::shared_ptr<Task> blocker = group->Schedule([&] {
+    started.Notify();
+    release.WaitForNotification();
+  });
+  ASSERT_NE(blocker, nullptr);
+  started.WaitForNotification();
+
+  // The only thread is busy, so the next task stays queued and fills the
+  // queue.
+  std::shared_ptr<Task> queued = group->Schedule([] {});
+  ASSERT_NE(queued, nullptr);
+  EXPECT_EQ(group->Schedule([] {}), nullptr);
+  EXPECT_EQ(group->GetMetrics().num_rejected_tasks, 1);
+  EXPECT_EQ(executor.GetMetrics().num_rejected_tasks, 1);
+
+  release.Notify();
+  group->Wait(blocker.get());
+  group->Wait(queued.get());
+  EXPECT_EQ(group->GetMetrics().num_completed_tasks, 2);
+}
+
+TEST(EvaluatorExecutorTest, CancelsOnlyQueuedTasks) {
+  EvaluatorExecutor executor(MakeOptions(/*num_threads=*/1,
+                                         /*max_queued_tasks=*/10));
+  std::unique_ptr<TaskGroup> group =
+      executor.CreateTaskGroup(/*weight=*/1, /*max_parallelism=*/0);
+  absl::Notification started;
+  absl::Notification release;
+  std::shared_ptr<Task> running = group->Schedule([&] {
+    started.Notify();
+    release.WaitForNotification();
+  });
+  ASSERT_NE(running, nullptr);
+  started.WaitForNotification();
+
+  bool ran = false;
+  std::shared_ptr<Task> queued = group->Schedule([&ran] { ran = true; });
+  ASSERT_NE(queued, nullptr);
+
+  EXPECT_FALSE(group->Cancel(running.get()));
+  EXPECT_TRUE(group->Cancel(queued.get()));
+  EXPECT_FALSE(group->Cancel(queued.get()));
+  // Waiting for a cancelled task returns immediately.
+  group->Wait(queued.get());
+
+  release.Notify();
+  group->Wait(running.get());
+  EXPECT_FALSE(ran);
+  const EvaluatorExecutor::Metrics metrics = group->GetMetrics();
+  EXPECT_EQ(metrics.num_cancelled_tasks, 1);
+  EXPECT_EQ(metrics.num_completed_tasks, 1);
+}
+
+TEST(EvaluatorExecutorTest, MaxParallelismCapsRunningTasks) {
+  EvaluatorExecutor executor(MakeOptions(/*num_threads=*/4,
+                                         /*max_queued_tasks=*/100));
+  std::unique_ptr<TaskGroup> group =
+      executor.CreateTaskGroup(/*weight=*/1, /*max_parallelism=*/2);
+  absl::Mutex mutex;
+  int num_running = 0;
+  int max_running = 0;
+  std::vector<std::shared_ptr<Task>> tasks;
+  for (int i = 0; i < 12; ++i) {
+    tasks.push_back(group->Schedule([&] {
+      {
+        absl::MutexLock l(&mutex);
+        ++num_running;
+        max_running = std::max(max_running, num_running);
+      }
+      absl::SleepFor(absl::Milliseconds(2));
+      absl::MutexLock l(&mutex);
+      --num_running;
+    }));
+    ASSERT_NE(tasks.back(), nullptr);
+  }
+  for (const std::shared_ptr<Task>& task : tasks) {
+    group->Wait(task.get());
+  }
+  EXPECT_LE(max_running, 2);
+  EXPECT_GE(max_running, 1);
+}
+
+TEST(EvaluatorExecutorTest, PrefersGroupsWithFewerRunningTasksPerWeight) {
+  EvaluatorExecutor executor(MakeOptions(/*num_threads=*/3,
+                                         /*max_queued_tasks=*/10));
+  std::unique_ptr<TaskGroup> group_a =
+      executor.CreateTaskGroup(/*weight=*/2, /*max_parallelism=*/0);
+  std::unique_ptr<TaskGroup> group_b =
+      executor.CreateTaskGroup(/*weight=*/1, /*max_parallelism=*/0);
+  std::unique_ptr<TaskGroup> group_c =
+      executor.CreateTaskGroup(/*weight=*/1, /*max_parallelism=*/0);
+
+  // Occupy each thread with one task of each group.
+  absl::Notification release_ab;
+  absl::Notification release_c;
+  std::vector<absl::Notification> started(3);
+  std::shared_ptr<Task> long_a = group_a->Schedule([&] {
+    started[0].Notify();
+    release_ab.WaitForNotification();
+  });
+  std::shared_ptr<Task> long_b = group_b->Schedule([&] {
+    started[1].Notify();
+    release_ab.WaitForNotification();
+  });
+  std::shared_ptr<Task> long_c = group_c->Schedule([&] {
+    started[2].Notify();
+    release_c.WaitForNotification();
+  });
+  for (absl::Notification& notification : started) {
+    notification.WaitForNotification();
+  }
+
+  absl::Mutex mutex;
+  std::vector<std::string> order;
+  std::shared_ptr<Task> b1 = group_b->Schedule([&] {
+    absl::MutexLock l(&mutex);
+    order.push_back("b1");
+  });
+  std::shared_ptr<Task> a1 = group_a->Schedule([&] {
+    absl::MutexLock l(&mutex);
+    order.push_back("a1");
+  });
+
+  // Both A and B run one task, but A has twice the weight, so its task runs
+  // first on the thread that C frees even though B's task is older.
+  release_c.Notify();
+  group_a->Wait(a1.get());
+  group_b->Wait(b1.get());
+  EXPECT_THAT(order, ElementsAre("a1", "b1"));
+
+  release_ab.Notify();
+  group_a->Wait(long_a.get());
+  group_b->Wait(long_b.get());
+  group_c->Wait(long_c.get());
+}
+
+TEST(EvaluatorExecutorTest, CurrentTaskGroup) {
+  EvaluatorExecutor executor(MakeOptions(/*num_threads=*/1,
+                                         /*max_queued_tasks=*/10));
+  std::unique_ptr<TaskGroup> group =
+      executor.CreateTaskGroup(/*weight=*/1, /*max_parallelism=*/0);
+  EXPECT_EQ(TaskGroup::Current(), nullptr);
+
+  TaskGroup* current_in_task = nullptr;
+  std::shared_ptr<Task> task =
+      group->Schedule([&] { current_in_task = TaskGroup::Current(); });
+  ASSERT_NE(task, nullptr);
+  group->Wait(task.get());
+  EXPECT_EQ(current_in_task, group.get());
+
+  {
+    EvaluatorExecutor::ScopedTaskGroup scoped_group(group.get());
+    EXPECT_EQ(TaskGroup::Current(), group.get());
+    {
+      EvaluatorExecutor::ScopedTaskGroup no_group(nullptr);
+      EXPECT_EQ(TaskGroup::Current(), nullptr);
+    }
+    EXPECT_EQ(TaskGroup::Current(), group.get());
+  }
+  EXPECT_EQ(TaskGroup::Current(), nullptr);
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -0,0 +1,147 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmark for the startup cost of PreparedExpressionLite. Prints the latency
+// of the first Prepare and Execute in the process, which build the shared
+// state of the analyzer and the evaluator, and the median latency of the
+// following ones. For comparison, also prints the median latency of adding
+// all the built-in functions to a SimpleCatalog, which is what each Prepare
+// without a catalog paid before the built-in functions were added lazily.
+//
+// Example:
+//   bazel run -c opt //zetasql/public:evaluator_lite_benchmark -- \
+//       --expression="SUBSTR(CONCAT('abc', 'def'), 2, 3)"
+//
+// This binary only links :evaluator_lite, so its size is a measure of the
+// footprint of embedding the lite evaluator, e.g.:
+//   bazel build -c opt //zetasql/public:evaluator_lite_benchmark
+//   size bazel-bin/zetasql/public/evaluator_lite_benchmark
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/evaluator_lite.h"
+#include "zetasql/public/language_options.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/value.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
+
+ABSL_FLAG(std::string, expression, "CONCAT('a', CAST(1 + 2 AS STRING))",
+          "The expression to prepare and execute.");
+ABSL_FLAG(int32_t, num_iterations, 100,
+          "The number of timed runs after the first one. The reported "
+          "latencies are medians over these runs.");
+
+namespace zetasql {
+namespace {
+
+absl::Duration Median(std::vector<absl::Duration>* durations) {
+  ZETASQL_CHECK(!durations->empty());
+  auto middle = durations->begin() + durations->size() / 2;
+  std::nth_element(durations->begin(), middle, durations->end());
+  return *middle;
+}
+
+std::string FormatMicros(absl::Duration duration) {
+  return absl::StrFormat("%.1f", absl::ToDoubleMicroseconds(duration));
+}
+
+// Prepares and executes <sql> without a catalog, and records the latency of
+// each step.
+zetasql_base::Status PrepareAndExecute(const std::string& sql,
+                               const AnalyzerOptions& options,
+                               absl::Duration* prepare_time,
+                               absl::Duration* execute_time) {
+  PreparedExpressionLite expression(sql);
+  absl::Time start = absl::Now();
+  ZETASQL_RETURN_IF_ERROR(expression.Prepare(options));
+  *prepare_time = absl::Now() - start;
+
+  start = absl::Now();
+  ZETASQL_ASSIGN_OR_RETURN(const Value result, expression.Execute());
+  *execute_time = absl::Now() - start;
+  // Keeps the result alive.
+  if (!result.is_valid()) std::cout << "";
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status Run() {
+  const int num_iterations = absl::GetFlag(FLAGS_num_iterations);
+  ZETASQL_RET_CHECK_GT(num_iterations, 0);
+  const std::string sql = absl::GetFlag(FLAGS_expression);
+  LanguageOptions language_options;
+  language_options.EnableMaximumLanguageFeatures();
+  const AnalyzerOptions options(language_options);
+
+  absl::Duration first_prepare;
+  absl::Duration first_execute;
+  ZETASQL_RETURN_IF_ERROR(
+      PrepareAndExecute(sql, options, &first_prepare, &first_execute));
+
+  std::vector<absl::Duration> prepare_times;
+  std::vector<absl::Duration> execute_times;
+  std::vector<absl::Duration> all_functions_times;
+  for (int i = 0; i < num_iterations; ++i) {
+    absl::Duration prepare_time;
+    absl::Duration execute_time;
+    ZETASQL_RETURN_IF_ERROR(
+        PrepareAndExecute(sql, options, &prepare_time, &execute_time));
+    prepare_times.push_back(prepare_time);
+    execute_times.push_back(execute_time);
+
+    SimpleCatalog catalog("all_functions");
+    const absl::Time start = absl::Now();
+    catalog.AddZetaSQLFunctions(language_options);
+    all_functions_times.push_back(absl::Now() - start);
+  }
+
+  std::cout << "Latencies in microseconds of: " << sql << "\n";
+  std::cout << absl::StrFormat("%-28s %10s %10s\n", "", "first", "median");
+  std::cout << absl::StrFormat("%-28s %10s %10s\n", "Prepare",
+                               FormatMicros(first_prepare),
+                               FormatMicros(Median(&prepare_times)));
+  std::cout << absl::StrFormat("%-28s %10s %10s\n", "Execute",
+                               FormatMicros(first_execute),
+                               FormatMicros(Median(&execute_times)));
+  std::cout << absl::StrFormat("%-28s %10s %10s\n", "AddZetaSQLFunctions", "",
+                               FormatMicros(Median(&all_functions_times)));
+  return zetasql_base::OkStatus();
+}
+
+}  // namespace
+}  // namespace zetasql
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  const zetasql_base::Status status = zetasql::Run();
+  if (!status.ok()) {
+    std::cout << "ERROR: " << status << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -19,7 +19,16 @@
 #ifndef ZETASQL_PUBLIC_EVALUATOR_TABLE_ITERATOR_H_
 #define ZETASQL_PUBLIC_EVALUATOR_TABLE_ITERATOR_H_
 
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "zetasql/public/value.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "zetasql/base/canonical_errors.h"
 #include "zetasql/base/status.h"
 
@@ -27,6 +36,63 @@ namespace zetasql {
 
 struct ColumnFilter;
 
+// A batch of consecutive rows in columnar form, as returned by
+// EvaluatorTableIterator::NextColumnBatch(). The spans point to memory owned by
+// the iterator, which must remain valid until the next call to
+// NextColumnBatch().
+struct EvaluatorTableColumnBatch {
+  // The values of one column for the rows in the batch. Which span holds them
+  // depends on the type of the column:
+  //   INT64:        'int64_values'
+  //   DOUBLE:       'double_values'
+  //   BOOL:         'bool_bitmap' (bit i is set if the value of row i is TRUE)
+  //   STRING:       'string_values'
+  //   Other types:  'values'
+  // The span that is used must have at least 'num_rows' elements (or bits).
+  //
+  // If 'validity_bitmap' is non-empty, bit i is clear if the value of row i is
+  // NULL, in which case the corresponding element of the values span is
+  // ignored. If it is empty, only 'values' can contain NULLs.
+  //
+  // Bitmaps are LSB-first, so bit i is (bitmap[i / 8] >> (i % 8)) & 1. This is
+  // the layout of Apache Arrow validity and boolean buffers.
+  //
+  // A column of any type can instead be dictionary-encoded: if 'dictionary' is
+  // non-empty, the value of row i is dictionary[dictionary_codes[i]], and the
+  // spans above other than 'validity_bitmap' are ignored. The elements of
+  // 'dictionary' must be non-NULL values of the type of the column. The
+  // evaluator copies the dictionary elements into its rows without decoding
+  // them, and STRING and BYTES values that were copied from the same element
+  // share their contents, so comparing and grouping them does not look at the
+  // bytes. Iterators should therefore keep the same dictionary for all the
+  // batches of a column when they can.
+  struct Column {
+    absl::Span<const int64_t> int64_values;
+    absl::Span<const double> double_values;
+    absl::Span<const uint8_t> bool_bitmap;
+    absl::Span<const absl::string_view> string_values;
+    absl::Span<const Value> values;
+    absl::Span<const int32_t> dictionary_codes;
+    absl::Span<const Value> dictionary;
+    absl::Span<const uint8_t> validity_bitmap;
+
+    // Returns true if 'validity_bitmap' marks row 'i' as NULL.
+    bool IsNull(int64_t i) const {
+      return !validity_bitmap.empty() && !GetBit(validity_bitmap, i);
+    }
+
+    // Returns bit 'i' of 'bitmap'.
+    static bool GetBit(absl::Span<const uint8_t> bitmap, int64_t i) {
+      return (bitmap[i >> 3] >> (i & 7)) & 1;
+    }
+  };
+
+  // The number of rows in the batch.
+  int64_t num_rows = 0;
+  // The i-th element is for the i-th column of the iterator.
+  std::vector<Column> columns;
+};
+
 // Iterator interface for a user-supplied table in a PreparedQuery.
 //
 // Example:
@@ -129,6 +195,31 @@ class EvaluatorTableIterator {
     return zetasql_base::OkStatus();
   }
 
+  // This method may be called before the first call to NextRow() to indicate
+  // that the evaluator only needs the first 'max_num_rows' rows of the
+  // iterator, e.g., for SELECT * FROM Table LIMIT 10. An iterator that fetches
+  // rows from remote storage in pages can then fetch only as many rows as
+  // needed. This is only a hint: the iterator must still return all the rows
+  // if the evaluator reads past 'max_num_rows'.
+  //
+  // The evaluator propagates a LIMIT with literal count and offset through
+  // projections and UNION ALLs down to the scans of tables, but not through
+  // filters, joins, aggregations or sorts.
+  virtual void SetRowLimitHint(int64_t max_num_rows) {}
+
+  // This method may be called before the first call to NextRow() for a scan
+  // with TABLESAMPLE SYSTEM (percent PERCENT). It asks the iterator to return
+  // about 'percent' percent of its rows (0 <= 'percent' <= 100), chosen at
+  // random in blocks, so that an iterator over paged storage can skip the
+  // pages that are not sampled. 'seed' is the REPEATABLE argument, if any; the
+  // same seed should select the same blocks.
+  //
+  // Returns true if the iterator samples its rows. Otherwise the evaluator
+  // samples the rows that the iterator returns, one row at a time.
+  virtual bool SetBlockSample(double percent, absl::optional<int64_t> seed) {
+    return false;
+  }
+
   // Indicates that the iterator should read from a snapshot of the table at the
   // given moment in time, rather than the current table content. This function
   // must be called prior to the first call to NextRow().
@@ -145,6 +236,21 @@ class EvaluatorTableIterator {
   // iterator are NumColumns(), GetColumnName(), GetColumnType(), and Status().
   virtual bool NextRow() = 0;
 
+  // Returns true if this iterator implements NextColumnBatch(). In that case
+  // the evaluator reads all the rows with NextColumnBatch() and never calls
+  // NextRow() or GetValue(). Storage that is already columnar can then hand
+  // out its column buffers without constructing a Value for every cell.
+  virtual bool SupportsColumnBatches() const { return false; }
+
+  // Only called if SupportsColumnBatches() returns true. Populates 'batch' with
+  // between 1 and 'max_num_rows' of the next rows and returns true. Returns
+  // false if there are no more rows. The caller must then check 'Status()'.
+  // 'max_num_rows' is always positive.
+  virtual bool NextColumnBatch(int64_t max_num_rows,
+                               EvaluatorTableColumnBatch* batch) {
+    return false;
+  }
+
   // Returns the value of the i-th column of this iterator.
   // 'i' must be in [0, 'NumColumns()').
   // NextRow() must have been called at least once and the last call must have
@@ -168,6 +274,13 @@ class EvaluatorTableIterator {
   // set a deadline member and check for its expiration inside processing loops
   // or in NextRow().
   virtual void SetDeadline(absl::Time deadline) {}
+
+  // Returns the total time that NextRow() and NextColumnBatch() have spent
+  // waiting for rows that were not available yet, for iterators that can tell
+  // it apart from the time spent producing rows (e.g.,
+  // PrefetchingEvaluatorTableIterator). The evaluator reports it in the
+  // profile of the scan.
+  virtual absl::Duration GetStallTime() const { return absl::ZeroDuration(); }
 };
 
 // Represents a restriction of values needed by a scan for a particular
@@ -231,6 +344,112 @@ class ColumnFilter {
   std::vector<Value> values_;
 };
 
+// A predicate over the columns of an EvaluatorTableIterator, passed to
+// Table::CreateEvaluatorTableIteratorWithPredicate(). Leaf predicates compare a
+// single column of the scan (identified by its index in the scan, not the
+// Table) to constant values.
+//
+// Unlike ColumnFilter, predicates have full SQL semantics: a row satisfies a
+// predicate if it evaluates to TRUE (not FALSE or NULL), the values may be
+// NULL, and kOr and kIsNull predicates can match rows with NULL column values.
+// Comparisons are allowed between the same types as for ColumnFilter, and
+// Value::SqlLessThan() and Value::SqlEquals() implement them.
+class ColumnPredicate {
+ public:
+  enum Kind {
+    // Conjunction and disjunction of 'children()'.
+    kAnd,
+    kOr,
+    // <column> <op> 'value()'.
+    kEqual,
+    kLess,
+    kLessOrEqual,
+    kGreater,
+    kGreaterOrEqual,
+    // <column> IS NULL and <column> IS NOT NULL.
+    kIsNull,
+    kIsNotNull,
+    // <column> LIKE '<value()>%' for a STRING or BYTES column, where 'value()'
+    // is a prefix that must be matched literally.
+    kStartsWith,
+    // <column> IN ('in_list()').
+    kInList,
+    // Switches must have a default case to allow us to add more kinds of
+    // predicates to the API.
+    __Kind__switches_must_have_a_default
+  };
+
+  ColumnPredicate(const ColumnPredicate&) = delete;
+  ColumnPredicate& operator=(const ColumnPredicate&) = delete;
+
+  // Constructs a kAnd or kOr predicate.
+  static std::unique_ptr<ColumnPredicate> CreateAnd(
+      std::vector<std::unique_ptr<ColumnPredicate>> children) {
+    return std::unique_ptr<ColumnPredicate>(
+        new ColumnPredicate(kAnd, -1, {}, std::move(children)));
+  }
+  static std::unique_ptr<ColumnPredicate> CreateOr(
+      std::vector<std::unique_ptr<ColumnPredicate>> children) {
+    return std::unique_ptr<ColumnPredicate>(
+        new ColumnPredicate(kOr, -1, {}, std::move(children)));
+  }
+
+  // Constructs a predicate comparing column 'column_idx' to 'value'. 'kind'
+  // must be one of kEqual, kLess, kLessOrEqual, kGreater, kGreaterOrEqual and
+  // kStartsWith.
+  static std::unique_ptr<ColumnPredicate> CreateComparison(Kind kind,
+                                                           int column_idx,
+                                                           const Value& value) {
+    return std::unique_ptr<ColumnPredicate>(
+        new ColumnPredicate(kind, column_idx, {value}, {}));
+  }
+
+  // Constructs a kIsNull or kIsNotNull predicate.
+  static std::unique_ptr<ColumnPredicate> CreateIsNull(int column_idx,
+                                                       bool negated) {
+    return std::unique_ptr<ColumnPredicate>(new ColumnPredicate(
+        negated ? kIsNotNull : kIsNull, column_idx, {}, {}));
+  }
+
+  // Constructs a kInList predicate.
+  static std::unique_ptr<ColumnPredicate> CreateInList(
+      int column_idx, std::vector<Value> in_list) {
+    return std::unique_ptr<ColumnPredicate>(
+        new ColumnPredicate(kInList, column_idx, std::move(in_list), {}));
+  }
+
+  Kind kind() const { return kind_; }
+
+  // Returns the index in the scan of the column tested by this predicate. Not
+  // valid for kAnd and kOr.
+  int column_idx() const { return column_idx_; }
+
+  // Returns the value that the column is compared to. Only valid for
+  // comparisons and kStartsWith.
+  const Value& value() const { return values_[0]; }
+
+  // Returns the in list of a kInList predicate.
+  const std::vector<Value>& in_list() const { return values_; }
+
+  // Returns the children of a kAnd or kOr predicate.
+  const std::vector<std::unique_ptr<ColumnPredicate>>& children() const {
+    return children_;
+  }
+
+ private:
+  ColumnPredicate(Kind kind, int column_idx, std::vector<Value> values,
+                  std::vector<std::unique_ptr<ColumnPredicate>> children)
+      : kind_(kind),
+        column_idx_(column_idx),
+        values_(std::move(values)),
+        children_(std::move(children)) {}
+
+  Kind kind_;
+  int column_idx_;
+  std::vector<Value> values_;
+  std::vector<std::unique_ptr<ColumnPredicate>> children_;
+};
+
 }  // namespace zetasql
 
 #endif  // ZETASQL_PUBLIC_EVALUATOR_TABLE_ITERATOR_H_
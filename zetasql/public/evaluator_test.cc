@@ -16,8 +16,11 @@
 
 #include "zetasql/public/evaluator.h"
 
+#include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 
 #include "zetasql/base/logging.h"
@@ -38,6 +41,7 @@
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/options.pb.h"
 #include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/tracer.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
@@ -58,6 +62,8 @@
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "zetasql/base/stl_util.h"
@@ -72,8 +78,10 @@ namespace {
 
 using ::testing::_;
 using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 using ::testing::HasSubstr;
 using ::testing::IsEmpty;
+using ::testing::Not;
 using ::testing::UnorderedElementsAre;
 using ::zetasql_base::testing::IsOkAndHolds;
 using ::zetasql_base::testing::StatusIs;
@@ -802,6 +810,79 @@ TEST(EvaluatorTest,
               IsOkAndHolds(Value::Int64(15)));
 }
 
+TEST(EvaluatorTest, ExecuteAfterPrepareBatch) {
+  PreparedExpression expr("@param * col");
+  AnalyzerOptions options;
+  ZETASQL_ASSERT_OK(options.AddQueryParameter("param", types::Int64Type()));
+  ZETASQL_ASSERT_OK(options.AddExpressionColumn("col", types::Int64Type()));
+  ZETASQL_ASSERT_OK(expr.Prepare(options));
+
+  const std::vector<ParameterValueMap> columns = {{{"col", Value::Int64(1)}},
+                                                  {{"col", Value::Int64(2)}},
+                                                  {{"col", Value::Int64(3)}}};
+  const std::vector<ParameterValueMap> parameters = {
+      {{"param", Value::Int64(10)}},
+      {{"param", Value::Int64(20)}},
+      {{"param", Value::NullInt64()}}};
+  EXPECT_THAT(expr.ExecuteAfterPrepareBatch(columns, parameters),
+              IsOkAndHolds(ElementsAre(Value::Int64(10), Value::Int64(40),
+                                       Value::NullInt64())));
+  EXPECT_THAT(expr.ExecuteAfterPrepareBatch({}, {}),
+              IsOkAndHolds(ElementsAre()));
+
+  EXPECT_THAT(expr.ExecuteAfterPrepareBatch(columns, {parameters[0]}),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("Expected 3 sets of parameters, got 1")));
+  EXPECT_THAT(expr.ExecuteAfterPrepareBatch(columns),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("Incomplete query parameters")));
+
+  PreparedExpression unprepared_expr("1");
+  EXPECT_THAT(unprepared_expr.ExecuteAfterPrepareBatch(
+                  std::vector<ParameterValueMap>(1)),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("Invalid prepared expression/query")));
+}
+
+TEST(EvaluatorTest, ExecuteAfterPrepareBatchWithOrderedParams) {
+  PreparedExpression expr("IF(col2, @param * col1, col1)");
+  AnalyzerOptions options;
+  ZETASQL_ASSERT_OK(options.AddQueryParameter("param", types::Int64Type()));
+  ZETASQL_ASSERT_OK(options.AddExpressionColumn("col1", types::Int64Type()));
+  ZETASQL_ASSERT_OK(options.AddExpressionColumn("col2", types::BoolType()));
+  ZETASQL_ASSERT_OK(expr.Prepare(options));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<std::string> columns,
+                       expr.GetReferencedColumns());
+  EXPECT_THAT(columns, ElementsAre("col1", "col2"));
+
+  const std::vector<ParameterValueList> column_rows = {
+      {Value::Int64(1), Value::Bool(true)},
+      {Value::Int64(2), Value::Bool(false)},
+      {Value::NullInt64(), Value::Bool(true)}};
+  EXPECT_THAT(
+      expr.ExecuteAfterPrepareBatchWithOrderedParams(column_rows,
+                                                     {Value::Int64(10)}),
+      IsOkAndHolds(ElementsAre(Value::Int64(10), Value::Int64(2),
+                               Value::NullInt64())));
+  EXPECT_THAT(expr.ExecuteAfterPrepareBatchWithOrderedParams(
+                  {}, {Value::Int64(10)}),
+              IsOkAndHolds(ElementsAre()));
+
+  // Every row is validated.
+  EXPECT_THAT(expr.ExecuteAfterPrepareBatchWithOrderedParams(
+                  {column_rows[0], {Value::Int64(1), Value::Int64(1)}},
+                  {Value::Int64(10)}),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("Expected column parameter 'col2'")));
+  EXPECT_THAT(expr.ExecuteAfterPrepareBatchWithOrderedParams(
+                  {column_rows[0], {Value::Int64(1)}}, {Value::Int64(10)}),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("Incorrect number of column parameters")));
+  EXPECT_THAT(
+      expr.ExecuteAfterPrepareBatchWithOrderedParams(column_rows, {}),
+      StatusIs(zetasql_base::INVALID_ARGUMENT, testing::_));
+}
+
 TEST(EvaluatorTest, ExplainAfterPrepareWithoutPrepare) {
   PreparedExpression expr("@param + col");
   EXPECT_THAT(expr.ExplainAfterPrepare(),
@@ -819,6 +900,31 @@ TEST(EvaluatorTest, ExplainAfterPrepare) {
               IsOkAndHolds("RootExpr(Add($param, $col))"));
 }
 
+TEST(EvaluatorTest, CompileExpressions) {
+  EvaluatorOptions evaluator_options;
+  evaluator_options.compile_expressions = true;
+  AnalyzerOptions options;
+  ZETASQL_ASSERT_OK(options.AddQueryParameter("param", types::Int64Type()));
+  ZETASQL_ASSERT_OK(options.AddExpressionColumn("col", types::Int64Type()));
+
+  PreparedExpression expr("(@param + col) * 2 > col", evaluator_options);
+  ZETASQL_ASSERT_OK(expr.Prepare(options));
+  EXPECT_THAT(expr.ExplainAfterPrepare(),
+              IsOkAndHolds(HasSubstr("CompiledExpr(")));
+  EXPECT_THAT(expr.GetCompiledExpressionFraction(), IsOkAndHolds(1.0));
+  EXPECT_THAT(expr.Execute({{"col", values::Int64(3)}},
+                           {{"param", values::Int64(-1)}}),
+              IsOkAndHolds(values::True()));
+  EXPECT_THAT(expr.Execute({{"col", values::Int64(3)}},
+                           {{"param", values::NullInt64()}}),
+              IsOkAndHolds(values::NullBool()));
+
+  // STRING functions are not compiled.
+  PreparedExpression string_expr("CONCAT('a', 'b')", evaluator_options);
+  ZETASQL_ASSERT_OK(string_expr.Prepare(options));
+  EXPECT_THAT(string_expr.GetCompiledExpressionFraction(), IsOkAndHolds(0.0));
+}
+
 TEST(EvaluatorTest, GetReferencedParametersAsProperSubset) {
   PreparedExpression expr("@param1 + @param2");
   AnalyzerOptions options;
@@ -1169,6 +1275,24 @@ TEST(EvaluatorTest, CurrentTimestamp) {
   EXPECT_EQ(test_time, value.ToTime());
 }
 
+TEST(EvaluatorTest, ReusedContextsGetTheCurrentTimestampAgain) {
+  const absl::Time test_time = absl::FromUnixMicros(1479885478000LL);
+  zetasql_base::SimulatedClock clock(test_time);
+  EvaluatorOptions evaluator_options;
+  evaluator_options.clock = &clock;
+
+  // The evaluations after the first one reuse its EvaluationContext.
+  PreparedExpression expr("STRUCT(CURRENT_TIMESTAMP(), RAND() < 1)",
+                          evaluator_options);
+  ZETASQL_ASSERT_OK(expr.Prepare(AnalyzerOptions()));
+  for (int i = 0; i < 3; ++i) {
+    Value value = expr.ExecuteAfterPrepare().ValueOrDie();
+    EXPECT_EQ(test_time + absl::Seconds(i), value.field(0).ToTime());
+    EXPECT_TRUE(value.field(1).bool_value());
+    clock.AdvanceTime(absl::Seconds(1));
+  }
+}
+
 absl::Time GetTestTime() {
   absl::TimeZone gst;
   CHECK(absl::LoadTimeZone("America/Los_Angeles", &gst));
@@ -1726,6 +1850,1167 @@ TEST(PreparedQuery, FromTable) {
   ZETASQL_EXPECT_OK(iter->Status());
 }
 
+TEST(PreparedQuery, JsonExtractScalarsFromTable) {
+  SimpleTable test_table("TestTable", {{"j", types::StringType()}});
+  test_table.SetContents({{String(R"({"a": "x", "b": 1, "c": [2, 3]})")},
+                          {String(R"({"b": 4, "c": [5]})")},
+                          {String(R"({"a": "y", "b": )")},
+                          {NullString()}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(test_table.Name(), &test_table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query(
+      "select json_extract_scalar(j, '$.a') a, "
+      "cast(json_extract_scalar(j, '$.b') as int64) b, "
+      "json_extract_scalar(j, '$.c[1]') c from TestTable",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  // The document in each row is parsed once for all three paths.
+  EXPECT_THAT(query.ExplainAfterPrepare(),
+              IsOkAndHolds(HasSubstr("JsonExtractScalars(")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(String("x"), iter->GetValue(0));
+  EXPECT_EQ(Int64(1), iter->GetValue(1));
+  EXPECT_EQ(String("3"), iter->GetValue(2));
+
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(NullString(), iter->GetValue(0));
+  EXPECT_EQ(Int64(4), iter->GetValue(1));
+  EXPECT_EQ(NullString(), iter->GetValue(2));
+
+  // Values before the document turns out to be malformed are still extracted,
+  // as by separate JSON_EXTRACT_SCALAR calls.
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(String("y"), iter->GetValue(0));
+  EXPECT_EQ(NullInt64(), iter->GetValue(1));
+  EXPECT_EQ(NullString(), iter->GetValue(2));
+
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(NullString(), iter->GetValue(0));
+  EXPECT_EQ(NullInt64(), iter->GetValue(1));
+  EXPECT_EQ(NullString(), iter->GetValue(2));
+
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST(PreparedQuery, FoldsParameterOnlySubexpressions) {
+  SimpleTable test_table("TestTable", {{"x", types::Int64Type()},
+                                       {"s", types::StringType()}});
+  test_table.SetContents({{Int64(1), String("a")},
+                          {Int64(2), String("B")},
+                          {Int64(200), String("b")}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(test_table.Name(), &test_table);
+  catalog.AddZetaSQLFunctions();
+  AnalyzerOptions analyzer_options;
+  ZETASQL_ASSERT_OK(analyzer_options.AddQueryParameter("p", types::StringType()));
+  ZETASQL_ASSERT_OK(analyzer_options.AddQueryParameter("zero", types::Int64Type()));
+
+  PreparedQuery query(
+      "SELECT x, IF(x > 100, DIV(1, @zero), x) FROM TestTable "
+      "WHERE UPPER(s) = UPPER(@p)",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(analyzer_options, &catalog));
+  EXPECT_THAT(query.ExplainAfterPrepare(),
+              IsOkAndHolds(HasSubstr("CachedExpr(")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<EvaluatorTableIterator> iter,
+      query.Execute({{"p", String("a")}, {"zero", Int64(0)}}));
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(Int64(1), iter->GetValue(0));
+  EXPECT_EQ(Int64(1), iter->GetValue(1));
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+
+  // DIV(1, @zero) is only evaluated for rows that need it, as before.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      iter, query.Execute({{"p", String("b")}, {"zero", Int64(0)}}));
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(Int64(2), iter->GetValue(0));
+  EXPECT_EQ(Int64(2), iter->GetValue(1));
+  EXPECT_FALSE(iter->NextRow());
+  EXPECT_THAT(iter->Status(), StatusIs(zetasql_base::OUT_OF_RANGE,
+                                       HasSubstr("division by zero")));
+}
+
+TEST(PreparedQuery, EliminatesCommonSubexpressions) {
+  SimpleTable test_table("TestTable", {{"s", types::StringType()}});
+  test_table.SetContents({{String("aB")}, {NullString()}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(test_table.Name(), &test_table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query(
+      "SELECT UPPER(s) a, CONCAT(UPPER(s), '!') b, "
+      "IF(s IS NULL, '', LOWER(s)) c, LOWER(s) d FROM TestTable",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  EXPECT_THAT(query.ExplainAfterPrepare(),
+              IsOkAndHolds(HasSubstr("$common_subexpression")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(String("AB"), iter->GetValue(0));
+  EXPECT_EQ(String("AB!"), iter->GetValue(1));
+  EXPECT_EQ(String("ab"), iter->GetValue(2));
+  EXPECT_EQ(String("ab"), iter->GetValue(3));
+
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(NullString(), iter->GetValue(0));
+  EXPECT_EQ(NullString(), iter->GetValue(1));
+  EXPECT_EQ(String(""), iter->GetValue(2));
+  EXPECT_EQ(NullString(), iter->GetValue(3));
+
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST(PreparedQuery, PushesFiltersIntoUnionAllInputs) {
+  SimpleTable table_a("A", {{"a", types::Int64Type()}});
+  table_a.SetContents({{Int64(1)}, {Int64(2)}});
+  SimpleTable table_b("B", {{"b", types::Int64Type()}});
+  table_b.SetContents({{Int64(3)}, {Int64(0)}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table_a.Name(), &table_a);
+  catalog.AddTable(table_b.Name(), &table_b);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query(
+      "SELECT v FROM (SELECT a AS v FROM A UNION ALL SELECT b AS v FROM B) "
+      "WHERE v >= 2 ORDER BY v",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  // The filter reaches the scans of both tables.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const std::string explain,
+                       query.ExplainAfterPrepare());
+  int num_column_filters = 0;
+  for (size_t pos = explain.find("HalfUnboundedColumnFilterArg");
+       pos != std::string::npos;
+       pos = explain.find("HalfUnboundedColumnFilterArg", pos + 1)) {
+    ++num_column_filters;
+  }
+  EXPECT_EQ(2, num_column_filters) << explain;
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(Int64(2), iter->GetValue(0));
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(Int64(3), iter->GetValue(0));
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST(PreparedQuery, LoadsSmallerJoinInputIntoMemory) {
+  SimpleTable small_table("SmallTable", {{"k", types::Int64Type()}});
+  small_table.SetContents({{Int64(1)}, {Int64(4)}});
+  small_table.set_row_count_estimate(2);
+  SimpleTable big_table("BigTable", {{"k", types::Int64Type()},
+                                     {"v", types::StringType()}});
+  big_table.SetContents(
+      {{Int64(1), String("a")},
+       {Int64(2), String("b")},
+       {Int64(3), String("c")}});
+  big_table.set_row_count_estimate(1000);
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(small_table.Name(), &small_table);
+  catalog.AddTable(big_table.Name(), &big_table);
+  catalog.AddZetaSQLFunctions();
+
+  // The smaller input is on the left, so the join is algebrized as a RIGHT
+  // OUTER join with the inputs swapped.
+  PreparedQuery query(
+      "SELECT s.k, b.v FROM SmallTable s LEFT JOIN BigTable b ON s.k = b.k "
+      "ORDER BY s.k",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  EXPECT_THAT(query.ExplainAfterPrepare(),
+              IsOkAndHolds(HasSubstr("RIGHT OUTER")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(Int64(1), iter->GetValue(0));
+  EXPECT_EQ(String("a"), iter->GetValue(1));
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(Int64(4), iter->GetValue(0));
+  EXPECT_EQ(NullString(), iter->GetValue(1));
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST(PreparedQuery, MergesSortedJoinInputs) {
+  SimpleTable left_table("L", {{"k", types::Int64Type()},
+                               {"v", types::StringType()}});
+  left_table.SetContents({{Int64(1), String("a")},
+                          {Int64(2), String("b")},
+                          {Int64(4), String("c")}});
+  ZETASQL_ASSERT_OK(left_table.SetSortOrder({0}));
+  SimpleTable right_table("R", {{"k", types::Int64Type()},
+                                {"w", types::StringType()}});
+  right_table.SetContents({{Int64(1), String("x")},
+                           {Int64(1), String("y")},
+                           {Int64(3), String("z")},
+                           {Int64(4), String("w")}});
+  ZETASQL_ASSERT_OK(right_table.SetSortOrder({0}));
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(left_table.Name(), &left_table);
+  catalog.AddTable(right_table.Name(), &right_table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query(
+      "SELECT l.v, r.w FROM L l LEFT JOIN R r ON l.k = r.k ORDER BY l.v, r.w",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  EXPECT_THAT(query.ExplainAfterPrepare(),
+              IsOkAndHolds(HasSubstr("num_merge_join_keys=1")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  for (const auto& expected :
+       std::vector<std::pair<Value, Value>>{{String("a"), String("x")},
+                                            {String("a"), String("y")},
+                                            {String("b"), NullString()},
+                                            {String("c"), String("w")}}) {
+    ASSERT_TRUE(iter->NextRow());
+    EXPECT_EQ(expected.first, iter->GetValue(0));
+    EXPECT_EQ(expected.second, iter->GetValue(1));
+  }
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST(PreparedQuery, PushesBuildKeysIntoProbeScans) {
+  SimpleTable probe_table("P", {{"k", types::Int64Type()},
+                                {"v", types::StringType()}});
+  probe_table.SetContents({{Int64(1), String("a")},
+                           {Int64(2), String("b")},
+                           {Int64(3), String("c")},
+                           {NullInt64(), String("d")}});
+  SimpleTable build_table("B", {{"k", types::Int64Type()}});
+  build_table.SetContents({{Int64(3)}, {Int64(1)}, {NullInt64()}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(probe_table.Name(), &probe_table);
+  catalog.AddTable(build_table.Name(), &build_table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query("SELECT p.v FROM P p JOIN B b ON p.k = b.k ORDER BY p.v",
+                      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  EXPECT_THAT(query.ExplainAfterPrepare(),
+              IsOkAndHolds(HasSubstr("BuildKeysColumnFilterArg")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  for (const Value& expected : {String("a"), String("c")}) {
+    ASSERT_TRUE(iter->NextRow());
+    EXPECT_EQ(expected, iter->GetValue(0));
+  }
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+// A SimpleTable that counts the calls to
+// CreateEvaluatorTableIteratorForKeys().
+class KeyLookupCountingTable : public SimpleTable {
+ public:
+  using SimpleTable::SimpleTable;
+
+  zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+  CreateEvaluatorTableIteratorForKeys(
+      absl::Span<const int> column_idxs,
+      absl::Span<const std::vector<Value>> keys) const override {
+    ++num_key_lookups;
+    return SimpleTable::CreateEvaluatorTableIteratorForKeys(column_idxs, keys);
+  }
+
+  mutable int num_key_lookups = 0;
+};
+
+TEST(PreparedQuery, LooksUpProbeRowsByPrimaryKey) {
+  KeyLookupCountingTable probe_table("P", {{"k1", types::Int64Type()},
+                                           {"k2", types::StringType()},
+                                           {"v", types::StringType()}});
+  ZETASQL_ASSERT_OK(probe_table.SetPrimaryKey({0, 1}));
+  probe_table.SetContents({{Int64(1), String("x"), String("a")},
+                           {Int64(1), String("y"), String("b")},
+                           {Int64(2), String("x"), String("c")},
+                           {Int64(3), String("y"), String("d")}});
+  SimpleTable build_table("B", {{"k1", types::Int64Type()},
+                                {"k2", types::StringType()}});
+  build_table.SetContents({{Int64(1), String("y")},
+                           {Int64(3), String("y")},
+                           {Int64(2), String("y")},
+                           {NullInt64(), String("x")}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(probe_table.Name(), &probe_table);
+  catalog.AddTable(build_table.Name(), &build_table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query(
+      "SELECT p.v FROM P p JOIN B b ON p.k1 = b.k1 AND p.k2 = b.k2 "
+      "ORDER BY p.v",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  EXPECT_THAT(query.ExplainAfterPrepare(),
+              IsOkAndHolds(HasSubstr("key_lookup_column_idxs: [0, 1]")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  for (const Value& expected : {String("b"), String("d")}) {
+    ASSERT_TRUE(iter->NextRow());
+    EXPECT_EQ(expected, iter->GetValue(0));
+  }
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+  EXPECT_EQ(probe_table.num_key_lookups, 1);
+}
+
+TEST(PreparedQuery, ChoosesJoinStrategiesFromHints) {
+  SimpleTable left_table("L", {{"k", types::Int64Type()},
+                               {"v", types::StringType()}});
+  left_table.SetContents({{Int64(1), String("a")},
+                          {Int64(2), String("b")},
+                          {Int64(3), String("c")}});
+  SimpleTable right_table("R", {{"k", types::Int64Type()}});
+  right_table.SetContents({{Int64(2)}, {Int64(3)}, {Int64(4)}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(left_table.Name(), &left_table);
+  catalog.AddTable(right_table.Name(), &right_table);
+  catalog.AddZetaSQLFunctions();
+
+  auto prepare = [&catalog](absl::string_view hint)
+      -> zetasql_base::StatusOr<std::unique_ptr<PreparedQuery>> {
+    auto query = absl::make_unique<PreparedQuery>(
+        absl::StrCat("SELECT l.v FROM L l LEFT JOIN ", hint,
+                     " R r ON l.k = r.k ORDER BY l.v"),
+        EvaluatorOptions());
+    ZETASQL_RETURN_IF_ERROR(query->Prepare(AnalyzerOptions(), &catalog));
+    return query;
+  };
+
+  struct HintTestCase {
+    std::string hint;
+    // Expected in the plan.
+    std::string plan_substr;
+  };
+  const HintTestCase test_cases[] = {
+      {"@{join_method=HASH}", "hash_join_equality_left_exprs: {\n"},
+      {"@{join_method=NESTED_LOOP}", "hash_join_equality_left_exprs: {}"},
+      {"@{build_side=LEFT}", "JoinOp(RIGHT OUTER"},
+      {"@{build_side=RIGHT}", "JoinOp(LEFT OUTER"},
+      {"@{parallelism=4}", "ExchangeOp(num_partitions=4"},
+      {"@{reference_impl.join_method=HASH, build_side=LEFT, parallelism=2}",
+       "ExchangeOp(num_partitions=2"},
+  };
+  for (const HintTestCase& test_case : test_cases) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<PreparedQuery> query,
+                         prepare(test_case.hint));
+    EXPECT_THAT(query->ExplainAfterPrepare(),
+                IsOkAndHolds(HasSubstr(test_case.plan_substr)))
+        << test_case.hint;
+
+    // The hints do not change the result.
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                         query->Execute());
+    for (const Value& expected : {String("a"), String("b"), String("c")}) {
+      ASSERT_TRUE(iter->NextRow()) << test_case.hint;
+      EXPECT_EQ(expected, iter->GetValue(0));
+    }
+    EXPECT_FALSE(iter->NextRow());
+    ZETASQL_EXPECT_OK(iter->Status());
+  }
+
+  EXPECT_THAT(prepare("@{join_method=SORT}"),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("must be HASH, NESTED_LOOP or MERGE")));
+  EXPECT_THAT(prepare("@{join_method=MERGE}"),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("sorted by the join keys")));
+  EXPECT_THAT(prepare("@{join_method=MERGE, build_side=LEFT}"),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("cannot be used with join_method=MERGE")));
+  EXPECT_THAT(prepare("@{parallelism=0}"),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("must be between 1 and 1024")));
+  EXPECT_THAT(prepare("@{num_shards=2}"),
+              StatusIs(zetasql_base::INVALID_ARGUMENT,
+                       HasSubstr("Unsupported hint: num_shards")));
+  // Hints for other engines are ignored.
+  ZETASQL_EXPECT_OK(prepare("@{other_engine.join_method=SORT}").status());
+}
+
+TEST(PreparedQuery, OrdersConjunctsByCost) {
+  SimpleTable table("T", {{"k", types::Int64Type()},
+                          {"s", types::StringType()}});
+  table.SetContents({{Int64(1), String("a")},
+                     {Int64(2), String("ab")},
+                     {Int64(4), String("b")},
+                     {Int64(5), String("bc")}});
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table.Name(), &table);
+  catalog.AddZetaSQLFunctions();
+
+  struct ConjunctsTestCase {
+    std::string where;
+    // Expected in the plan.
+    std::string plan_substr;
+    std::vector<Value> expected;
+  };
+  const ConjunctsTestCase test_cases[] = {
+      // The cheap comparison moves ahead of the regular expression.
+      {"REGEXP_CONTAINS(s, 'a') AND LENGTH(s) = 1", "And(Equal(Length(",
+       {Int64(1)}},
+      {"REGEXP_CONTAINS(s, 'a') OR LENGTH(s) = 1", "Or(Equal(Length(",
+       {Int64(1), Int64(2), Int64(4)}},
+      // The division can fail, so it stays behind the regular expression.
+      {"REGEXP_CONTAINS(s, 'c') OR 10 / k > 4", "Or(RegexpContains(",
+       {Int64(1), Int64(2), Int64(5)}},
+  };
+  for (const ConjunctsTestCase& test_case : test_cases) {
+    PreparedQuery query(
+        absl::StrCat("SELECT k FROM T WHERE ", test_case.where, " ORDER BY k"),
+        EvaluatorOptions());
+    ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+    EXPECT_THAT(query.ExplainAfterPrepare(),
+                IsOkAndHolds(HasSubstr(test_case.plan_substr)))
+        << test_case.where;
+
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                         query.Execute());
+    std::vector<Value> actual;
+    while (iter->NextRow()) {
+      actual.push_back(iter->GetValue(0));
+    }
+    ZETASQL_EXPECT_OK(iter->Status());
+    EXPECT_THAT(actual, ElementsAreArray(test_case.expected))
+        << test_case.where;
+  }
+}
+
+// A SimpleTable whose contents version is set by the test, so that changing
+// its contents without changing the version shows whether a result is cached.
+class FixedVersionTable : public SimpleTable {
+ public:
+  using SimpleTable::SimpleTable;
+
+  std::optional<std::string> GetEvaluatorContentsVersion() const override {
+    return version;
+  }
+
+  std::optional<std::string> version = "v1";
+};
+
+// Returns the only value of the only row of 'query' executed with
+// 'parameters'.
+static zetasql_base::StatusOr<Value> ExecuteSingleValueQuery(
+    PreparedQuery* query, const ParameterValueMap& parameters) {
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+                   query->Execute(parameters));
+  ZETASQL_RET_CHECK(iter->NextRow());
+  const Value value = iter->GetValue(0);
+  ZETASQL_RET_CHECK(!iter->NextRow());
+  ZETASQL_RETURN_IF_ERROR(iter->Status());
+  return value;
+}
+
+TEST(PreparedQuery, CachesDeterministicResults) {
+  FixedVersionTable table("T", {{"x", types::Int64Type()}});
+  table.SetContents({{Int64(1)}, {Int64(2)}});
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table.Name(), &table);
+  catalog.AddZetaSQLFunctions();
+
+  EvaluatorOptions options;
+  options.max_result_cache_byte_size = 1024 * 1024;
+  AnalyzerOptions analyzer_options;
+  ZETASQL_ASSERT_OK(analyzer_options.AddQueryParameter("p", types::Int64Type()));
+
+  PreparedQuery query("SELECT SUM(x) + @p FROM T", options);
+  ZETASQL_ASSERT_OK(query.Prepare(analyzer_options, &catalog));
+  EXPECT_THAT(ExecuteSingleValueQuery(&query, {{"p", Int64(10)}}),
+              IsOkAndHolds(Int64(13)));
+
+  // The version did not change, so the cached result is returned.
+  table.SetContents({{Int64(5)}});
+  EXPECT_THAT(ExecuteSingleValueQuery(&query, {{"p", Int64(10)}}),
+              IsOkAndHolds(Int64(13)));
+  // Other parameters are a different key.
+  EXPECT_THAT(ExecuteSingleValueQuery(&query, {{"p", Int64(20)}}),
+              IsOkAndHolds(Int64(25)));
+
+  table.version = "v2";
+  EXPECT_THAT(ExecuteSingleValueQuery(&query, {{"p", Int64(10)}}),
+              IsOkAndHolds(Int64(15)));
+
+  // Tables without a version are never cached.
+  table.version.reset();
+  table.SetContents({{Int64(6)}});
+  EXPECT_THAT(ExecuteSingleValueQuery(&query, {{"p", Int64(10)}}),
+              IsOkAndHolds(Int64(16)));
+  table.SetContents({{Int64(7)}});
+  EXPECT_THAT(ExecuteSingleValueQuery(&query, {{"p", Int64(10)}}),
+              IsOkAndHolds(Int64(17)));
+
+  // Neither are queries that call volatile functions.
+  table.version = "v3";
+  PreparedQuery volatile_query(
+      "SELECT SUM(x) + IF(RAND() < 2, @p, 0) FROM T", options);
+  ZETASQL_ASSERT_OK(volatile_query.Prepare(analyzer_options, &catalog));
+  EXPECT_THAT(ExecuteSingleValueQuery(&volatile_query, {{"p", Int64(10)}}),
+              IsOkAndHolds(Int64(17)));
+  table.SetContents({{Int64(8)}});
+  EXPECT_THAT(ExecuteSingleValueQuery(&volatile_query, {{"p", Int64(10)}}),
+              IsOkAndHolds(Int64(18)));
+}
+
+TEST(PreparedQuery, ResultCacheChangesWithSimpleTableContents) {
+  SimpleTable table("T", {{"x", types::Int64Type()}});
+  table.SetContents({{Int64(1)}});
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table.Name(), &table);
+  catalog.AddZetaSQLFunctions();
+
+  EvaluatorOptions options;
+  options.max_result_cache_byte_size = 1024 * 1024;
+  PreparedQuery query("SELECT SUM(x) FROM T", options);
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  EXPECT_THAT(ExecuteSingleValueQuery(&query, {}), IsOkAndHolds(Int64(1)));
+  EXPECT_THAT(ExecuteSingleValueQuery(&query, {}), IsOkAndHolds(Int64(1)));
+  table.SetContents({{Int64(2)}});
+  EXPECT_THAT(ExecuteSingleValueQuery(&query, {}), IsOkAndHolds(Int64(2)));
+}
+
+TEST(PreparedQuery, SharesPlansThroughPlanCache) {
+  SimpleTable table("T", {{"x", types::Int64Type()}});
+  table.SetContents({{Int64(1)}, {Int64(2)}});
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table.Name(), &table);
+  catalog.AddZetaSQLFunctions();
+
+  TypeFactory type_factory;
+  PreparedQueryPlanCache plan_cache(/*max_entries=*/2);
+  EvaluatorOptions options;
+  options.type_factory = &type_factory;
+  options.plan_cache = &plan_cache;
+  AnalyzerOptions analyzer_options;
+  ZETASQL_ASSERT_OK(analyzer_options.AddQueryParameter("p", types::Int64Type()));
+
+  const std::string sql = "SELECT SUM(x) + @p AS s FROM T";
+  auto first = absl::make_unique<PreparedQuery>(sql, options);
+  ZETASQL_ASSERT_OK(first->Prepare(analyzer_options, &catalog));
+  EXPECT_EQ(plan_cache.num_hits(), 0);
+  EXPECT_EQ(plan_cache.num_misses(), 1);
+
+  // The second query reuses the plan of the first, even after the first is
+  // destroyed, and executes it with its own parameters.
+  PreparedQuery second(sql, options);
+  ZETASQL_ASSERT_OK(second.Prepare(analyzer_options, &catalog));
+  EXPECT_EQ(plan_cache.num_hits(), 1);
+  EXPECT_THAT(ExecuteSingleValueQuery(first.get(), {{"p", Int64(10)}}),
+              IsOkAndHolds(Int64(13)));
+  first.reset();
+  EXPECT_THAT(ExecuteSingleValueQuery(&second, {{"p", Int64(20)}}),
+              IsOkAndHolds(Int64(23)));
+  ASSERT_EQ(second.num_columns(), 1);
+  EXPECT_EQ(second.column_name(0), "s");
+  EXPECT_THAT(second.GetReferencedParameters(),
+              IsOkAndHolds(ElementsAre("p")));
+
+  // Different options and different statements have their own plans.
+  EvaluatorOptions compiled_options = options;
+  compiled_options.compile_expressions = true;
+  PreparedQuery compiled(sql, compiled_options);
+  ZETASQL_ASSERT_OK(compiled.Prepare(analyzer_options, &catalog));
+  PreparedQuery other("SELECT SUM(x) - @p FROM T", options);
+  ZETASQL_ASSERT_OK(other.Prepare(analyzer_options, &catalog));
+  EXPECT_EQ(plan_cache.num_hits(), 1);
+  EXPECT_EQ(plan_cache.num_misses(), 3);
+  EXPECT_THAT(ExecuteSingleValueQuery(&other, {{"p", Int64(1)}}),
+              IsOkAndHolds(Int64(2)));
+
+  // Queries with an owned type factory are not cached.
+  EvaluatorOptions owned_options;
+  owned_options.plan_cache = &plan_cache;
+  PreparedQuery owned(sql, owned_options);
+  ZETASQL_ASSERT_OK(owned.Prepare(analyzer_options, &catalog));
+  EXPECT_EQ(plan_cache.num_hits(), 1);
+  EXPECT_EQ(plan_cache.num_misses(), 3);
+}
+
+TEST(PreparedQuery, MemoizesCorrelatedSubqueries) {
+  SimpleTable outer_table("O", {{"k", types::Int64Type()}});
+  outer_table.SetContents(
+      {{Int64(1)}, {Int64(2)}, {Int64(1)}, {NullInt64()}, {Int64(2)}});
+  SimpleTable inner_table("I", {{"k", types::Int64Type()},
+                                {"v", types::Int64Type()}});
+  inner_table.SetContents({{Int64(1), Int64(10)},
+                           {Int64(1), Int64(11)},
+                           {Int64(2), Int64(20)}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(outer_table.Name(), &outer_table);
+  catalog.AddTable(inner_table.Name(), &inner_table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query(
+      "SELECT (SELECT SUM(i.v) FROM I i WHERE i.k = o.k) FROM O o",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  EXPECT_THAT(query.ExplainAfterPrepare(),
+              IsOkAndHolds(HasSubstr("MemoizedSubqueryExpr")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  std::vector<Value> actual;
+  while (iter->NextRow()) {
+    actual.push_back(iter->GetValue(0));
+  }
+  ZETASQL_EXPECT_OK(iter->Status());
+  EXPECT_THAT(actual, UnorderedElementsAre(Int64(21), Int64(21), Int64(20),
+                                           Int64(20), NullInt64()));
+
+  // RAND() makes the subquery non-deterministic, so it is not memoized.
+  PreparedQuery volatile_query(
+      "SELECT (SELECT COUNT(*) FROM I i WHERE i.k = o.k AND RAND() < 2) "
+      "FROM O o",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(volatile_query.Prepare(AnalyzerOptions(), &catalog));
+  EXPECT_THAT(volatile_query.ExplainAfterPrepare(),
+              IsOkAndHolds(Not(HasSubstr("MemoizedSubqueryExpr"))));
+}
+
+TEST(PreparedQuery, MaterializesWithTablesOnce) {
+  SimpleTable table("T", {{"k", types::Int64Type()}});
+  table.SetContents({{Int64(1)}, {Int64(2)}, {Int64(3)}});
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table.Name(), &table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query(
+      "WITH w AS (SELECT k, k * 10 AS v FROM T WHERE k > 1), "
+      "x AS (SELECT v FROM w) "
+      "SELECT a.k, b.v FROM w a JOIN w b ON a.k = b.k "
+      "WHERE a.k IN (SELECT v / 10 FROM x) ORDER BY a.k",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const std::string explain,
+                       query.ExplainAfterPrepare());
+  EXPECT_THAT(explain, HasSubstr("MaterializeWithTableExpr"));
+  EXPECT_THAT(explain, HasSubstr("WithRefScanOp"));
+  EXPECT_THAT(explain, Not(HasSubstr("ArrayNestExpr(is_with_table=1")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  for (const int64_t k : {2, 3}) {
+    ASSERT_TRUE(iter->NextRow());
+    EXPECT_EQ(Int64(k), iter->GetValue(0));
+    EXPECT_EQ(Int64(k * 10), iter->GetValue(1));
+  }
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST(PreparedQuery, SharesSortsBetweenWindows) {
+  SimpleTable table("T", {{"p", types::Int64Type()},
+                          {"o", types::Int64Type()},
+                          {"x", types::Int64Type()}});
+  table.SetContents({{Int64(1), Int64(1), Int64(10)},
+                     {Int64(1), Int64(1), Int64(20)},
+                     {Int64(1), Int64(2), Int64(30)},
+                     {Int64(2), Int64(1), Int64(40)}});
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table.Name(), &table);
+  catalog.AddZetaSQLFunctions();
+  AnalyzerOptions options;
+  options.mutable_language()->EnableLanguageFeature(FEATURE_ANALYTIC_FUNCTIONS);
+
+  // The ordering of the first window is a prefix of the ordering of the
+  // second one, so both are evaluated by one AnalyticOp over one sort.
+  PreparedQuery query(
+      "SELECT x, SUM(x) OVER (PARTITION BY p ORDER BY o), "
+      "RANK() OVER (PARTITION BY p ORDER BY o, x) FROM T ORDER BY x",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(options, &catalog));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const std::string explain,
+                       query.ExplainAfterPrepare());
+  EXPECT_THAT(explain, HasSubstr("num_order_keys=1"));
+  EXPECT_EQ(explain.find("AnalyticOp("), explain.rfind("AnalyticOp("));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  const std::vector<std::vector<Value>> expected_rows = {
+      {Int64(10), Int64(30), Int64(1)},
+      {Int64(20), Int64(30), Int64(2)},
+      {Int64(30), Int64(60), Int64(3)},
+      {Int64(40), Int64(40), Int64(1)}};
+  for (const std::vector<Value>& expected_row : expected_rows) {
+    ASSERT_TRUE(iter->NextRow());
+    for (int i = 0; i < expected_row.size(); ++i) {
+      EXPECT_EQ(expected_row[i], iter->GetValue(i));
+    }
+  }
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST(PreparedQuery, LimitsSortedPartitionsOfRankedWindows) {
+  SimpleTable table("T", {{"p", types::Int64Type()},
+                          {"ts", types::Int64Type()},
+                          {"x", types::Int64Type()}});
+  table.SetContents({{Int64(1), Int64(1), Int64(10)},
+                     {Int64(1), Int64(2), Int64(20)},
+                     {Int64(1), Int64(3), Int64(30)},
+                     {Int64(2), Int64(1), Int64(40)},
+                     {Int64(2), Int64(4), Int64(50)},
+                     {Int64(2), Int64(3), Int64(60)},
+                     {Int64(2), Int64(4), Int64(70)}});
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table.Name(), &table);
+  catalog.AddZetaSQLFunctions();
+  AnalyzerOptions options;
+  options.mutable_language()->EnableLanguageFeature(FEATURE_ANALYTIC_FUNCTIONS);
+
+  struct TestCase {
+    std::string sql;
+    std::string partition_limit;
+    std::vector<std::vector<Value>> expected_rows;
+  };
+  const std::vector<TestCase> test_cases = {
+      {"SELECT x, rn FROM (SELECT x, ROW_NUMBER() OVER "
+       "(PARTITION BY p ORDER BY ts DESC, x) AS rn FROM T) "
+       "WHERE rn <= 2 ORDER BY x",
+       "partition_limit: 2 over 1",
+       {{Int64(20), Int64(2)},
+        {Int64(30), Int64(1)},
+        {Int64(50), Int64(1)},
+        {Int64(70), Int64(2)}}},
+      {"SELECT x, rk FROM (SELECT x, RANK() OVER "
+       "(PARTITION BY p ORDER BY ts DESC) AS rk FROM T) "
+       "WHERE 2 > rk ORDER BY x",
+       "partition_limit: 1 with ties over 1",
+       {{Int64(30), Int64(1)}, {Int64(50), Int64(1)}, {Int64(70), Int64(1)}}},
+  };
+  for (const TestCase& test_case : test_cases) {
+    PreparedQuery query(test_case.sql, EvaluatorOptions());
+    ZETASQL_ASSERT_OK(query.Prepare(options, &catalog));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(const std::string explain,
+                         query.ExplainAfterPrepare());
+    EXPECT_THAT(explain, HasSubstr(test_case.partition_limit));
+
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                         query.Execute());
+    for (const std::vector<Value>& expected_row : test_case.expected_rows) {
+      ASSERT_TRUE(iter->NextRow()) << test_case.sql;
+      for (int i = 0; i < expected_row.size(); ++i) {
+        EXPECT_EQ(expected_row[i], iter->GetValue(i)) << test_case.sql;
+      }
+    }
+    EXPECT_FALSE(iter->NextRow());
+    ZETASQL_EXPECT_OK(iter->Status());
+  }
+}
+
+// An EvaluatorTableIterator that forwards to another one, and records the row
+// limit hint that it gets.
+class RowLimitHintRecordingIterator : public EvaluatorTableIterator {
+ public:
+  RowLimitHintRecordingIterator(std::unique_ptr<EvaluatorTableIterator> iter,
+                                std::vector<int64_t>* hints)
+      : iter_(std::move(iter)), hints_(hints) {}
+
+  int NumColumns() const override { return iter_->NumColumns(); }
+  std::string GetColumnName(int i) const override {
+    return iter_->GetColumnName(i);
+  }
+  const Type* GetColumnType(int i) const override {
+    return iter_->GetColumnType(i);
+  }
+  void SetRowLimitHint(int64_t max_num_rows) override {
+    hints_->push_back(max_num_rows);
+  }
+  bool NextRow() override { return iter_->NextRow(); }
+  const Value& GetValue(int i) const override { return iter_->GetValue(i); }
+  zetasql_base::Status Status() const override { return iter_->Status(); }
+  zetasql_base::Status Cancel() override { return iter_->Cancel(); }
+
+ private:
+  std::unique_ptr<EvaluatorTableIterator> iter_;
+  std::vector<int64_t>* hints_;
+};
+
+TEST(PreparedQuery, PushesLimitsIntoTableScans) {
+  std::vector<int64_t> hints;
+  SimpleTable table("T", {{"x", types::Int64Type()}});
+  table.SetContents({{Int64(1)}, {Int64(2)}, {Int64(3)}});
+  SimpleTable hinted_table("H", {{"x", types::Int64Type()}});
+  hinted_table.SetEvaluatorTableIteratorFactory(
+      [&table, &hints](absl::Span<const int> column_idxs)
+          -> zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>> {
+        ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+                         table.CreateEvaluatorTableIterator(column_idxs));
+        return std::unique_ptr<EvaluatorTableIterator>(
+            absl::make_unique<RowLimitHintRecordingIterator>(std::move(iter),
+                                                             &hints));
+      });
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(hinted_table.Name(), &hinted_table);
+  catalog.AddZetaSQLFunctions();
+
+  struct TestCase {
+    std::string sql;
+    std::vector<int64_t> expected_hints;
+    int64_t expected_num_rows;
+  };
+  const std::vector<TestCase> test_cases = {
+      {"SELECT x + 1 FROM H LIMIT 2", {2}, 2},
+      {"SELECT x FROM H UNION ALL SELECT x FROM H LIMIT 2 OFFSET 1",
+       {3, 3},
+       2},
+      {"SELECT * FROM (SELECT x FROM H LIMIT 10) LIMIT 1 OFFSET 1", {2}, 1},
+      // Filters and sorts may need more rows than they produce.
+      {"SELECT x FROM H WHERE x > 1 LIMIT 1", {}, 1},
+      {"SELECT x FROM H ORDER BY x LIMIT 1", {}, 1},
+      {"SELECT x FROM H LIMIT @n", {}, 3},
+      // EXISTS only needs the first row of its subquery.
+      {"SELECT EXISTS(SELECT x FROM H ORDER BY x)", {1}, 1},
+      {"SELECT EXISTS(SELECT x FROM H WHERE x > 1)", {}, 1},
+  };
+  for (const TestCase& test_case : test_cases) {
+    hints.clear();
+    PreparedQuery query(test_case.sql, EvaluatorOptions());
+    AnalyzerOptions options;
+    ZETASQL_ASSERT_OK(options.AddQueryParameter("n", types::Int64Type()));
+    ZETASQL_ASSERT_OK(query.Prepare(options, &catalog));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<EvaluatorTableIterator> iter,
+        query.Execute(ParameterValueMap{{"n", Int64(3)}}));
+    int64_t num_rows = 0;
+    while (iter->NextRow()) ++num_rows;
+    ZETASQL_EXPECT_OK(iter->Status());
+    EXPECT_EQ(num_rows, test_case.expected_num_rows) << test_case.sql;
+    EXPECT_EQ(hints, test_case.expected_hints) << test_case.sql;
+  }
+}
+
+TEST(PreparedExpression, DropsOrderByInExistsSubqueries) {
+  SimpleTable table("T", {{"x", types::Int64Type()}});
+  table.SetContents({{Int64(2)}, {Int64(1)}});
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table.Name(), &table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedExpression expr("EXISTS(SELECT x FROM T ORDER BY x DESC)",
+                          EvaluatorOptions());
+  ZETASQL_ASSERT_OK(expr.Prepare(AnalyzerOptions(), &catalog));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const std::string explain,
+                       expr.ExplainAfterPrepare());
+  EXPECT_THAT(explain, Not(HasSubstr("SortOp")));
+  EXPECT_THAT(expr.Execute(), IsOkAndHolds(Bool(true)));
+}
+
+// Returns the first operator named 'name' in a pre-order traversal of
+// 'profile', or nullptr if there is none.
+static const OperatorProfileProto* FindOperatorProfile(
+    const OperatorProfileProto& profile, const std::string& name) {
+  if (profile.name() == name) return &profile;
+  for (const OperatorProfileProto& input : profile.inputs()) {
+    const OperatorProfileProto* found = FindOperatorProfile(input, name);
+    if (found != nullptr) return found;
+  }
+  return nullptr;
+}
+
+TEST(EvaluatorTest, CollectProfile) {
+  PreparedQuery unprofiled_query("SELECT 1", EvaluatorOptions());
+  ZETASQL_ASSERT_OK(unprofiled_query.Prepare(AnalyzerOptions()));
+  EXPECT_THAT(unprofiled_query.GetLastProfile(),
+              StatusIs(zetasql_base::FAILED_PRECONDITION,
+                       HasSubstr("collect_profile")));
+
+  EvaluatorOptions evaluator_options;
+  evaluator_options.collect_profile = true;
+  PreparedQuery query("SELECT x FROM UNNEST([1, 2, 3, 4]) AS x WHERE x > 2",
+                      evaluator_options);
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+  EXPECT_THAT(query.GetLastProfile(),
+              StatusIs(zetasql_base::FAILED_PRECONDITION,
+                       HasSubstr("No execution")));
+
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                         query.Execute());
+    int num_rows = 0;
+    while (iter->NextRow()) ++num_rows;
+    ZETASQL_ASSERT_OK(iter->Status());
+    EXPECT_EQ(num_rows, 2);
+    // The profile is only available once the iterator is destroyed.
+    EXPECT_THAT(query.GetLastProfile(),
+                StatusIs(zetasql_base::FAILED_PRECONDITION));
+  }
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(OperatorProfileProto profile, query.GetLastProfile());
+  EXPECT_EQ(profile.name(), "RootOp");
+  EXPECT_EQ(profile.num_iterators(), 1);
+  EXPECT_EQ(profile.num_output_rows(), 2);
+  const OperatorProfileProto* filter = FindOperatorProfile(profile, "FilterOp");
+  ASSERT_NE(filter, nullptr);
+  EXPECT_EQ(filter->num_input_rows(), 4);
+  EXPECT_EQ(filter->num_output_rows(), 2);
+  EXPECT_EQ(filter->num_function_calls(), 4);
+  EXPECT_LE(filter->self_time_nanos(), filter->total_time_nanos());
+  EXPECT_EQ(filter->allocated_bytes(), 0);
+}
+
+
+// A query that takes far too long to finish unless it is aborted.
+constexpr char kLongRunningQuery[] =
+    "SELECT COUNT(*) FROM UNNEST(GENERATE_ARRAY(1, 100000)) AS a, "
+    "UNNEST(GENERATE_ARRAY(1, 100000)) AS b WHERE a + b < 0";
+
+// Executes 'query' and reads all of its rows, returning the first error.
+static zetasql_base::Status ExecuteAndReadAllRows(PreparedQuery* query) {
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+                   query->Execute());
+  while (iter->NextRow()) {
+  }
+  return iter->Status();
+}
+
+TEST(EvaluatorTest, TrackAllocations) {
+  EvaluatorOptions evaluator_options;
+  evaluator_options.collect_profile = true;
+  evaluator_options.track_allocations = true;
+  PreparedQuery query(
+      "SELECT x FROM UNNEST(['a', 'b', 'c']) AS x ORDER BY CONCAT(x, '-', x)",
+      evaluator_options);
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+  ZETASQL_ASSERT_OK(ExecuteAndReadAllRows(&query));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(OperatorProfileProto profile, query.GetLastProfile());
+  // CONCAT() allocates a string for each row, which some operator is charged
+  // for.
+  int64_t allocated_bytes = 0;
+  std::function<void(const OperatorProfileProto&)> add_allocations =
+      [&](const OperatorProfileProto& op) {
+        EXPECT_LE(op.peak_allocated_bytes(), op.allocated_bytes());
+        allocated_bytes += op.allocated_bytes();
+        for (const OperatorProfileProto& input : op.inputs()) {
+          add_allocations(input);
+        }
+      };
+  add_allocations(profile);
+  EXPECT_GT(allocated_bytes, 0);
+}
+
+TEST(EvaluatorTest, MaxExecutionTime) {
+  EvaluatorOptions evaluator_options;
+  evaluator_options.max_execution_time = absl::Milliseconds(10);
+  PreparedQuery query(kLongRunningQuery, evaluator_options);
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+  EXPECT_THAT(ExecuteAndReadAllRows(&query),
+              StatusIs(zetasql_base::DEADLINE_EXCEEDED,
+                       HasSubstr("statement deadline")));
+
+  PreparedQuery fast_query("SELECT 1", evaluator_options);
+  ZETASQL_EXPECT_OK(ExecuteAndReadAllRows(&fast_query));
+}
+
+TEST(EvaluatorTest, CancelQuery) {
+  PreparedQuery query(kLongRunningQuery, EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+  // Cancelling without executions in progress has no effect.
+  query.Cancel();
+
+  zetasql_base::Status status;
+  absl::Notification done;
+  std::thread thread([&] {
+    status = ExecuteAndReadAllRows(&query);
+    done.Notify();
+  });
+  // Cancel() only affects the executions that have started, so keep
+  // cancelling until the query stops.
+  while (!done.WaitForNotificationWithTimeout(absl::Milliseconds(5))) {
+    query.Cancel();
+  }
+  thread.join();
+  EXPECT_THAT(status, StatusIs(zetasql_base::CANCELLED));
+}
+
+// Records the start and end of each span, except those of validation, which
+// depends on --zetasql_validate_resolved_ast.
+class RecordingTracer : public Tracer {
+ public:
+  std::unique_ptr<Span> StartSpan(absl::string_view name) override {
+    if (name == "validate") return nullptr;
+    Record(absl::StrCat("start ", name));
+    return absl::make_unique<RecordingSpan>(this, name);
+  }
+
+  std::vector<std::string> events() const {
+    absl::MutexLock l(&mutex_);
+    return events_;
+  }
+
+ private:
+  class RecordingSpan : public Span {
+   public:
+    RecordingSpan(RecordingTracer* tracer, absl::string_view name)
+        : tracer_(tracer), name_(name) {}
+    ~RecordingSpan() override { tracer_->Record(absl::StrCat("end ", name_)); }
+
+   private:
+    RecordingTracer* const tracer_;
+    const std::string name_;
+  };
+
+  void Record(const std::string& event) {
+    absl::MutexLock l(&mutex_);
+    events_.push_back(event);
+  }
+
+  mutable absl::Mutex mutex_;
+  std::vector<std::string> events_ ABSL_GUARDED_BY(mutex_);
+};
+
+TEST(EvaluatorTest, TracesQueryPhases) {
+  RecordingTracer tracer;
+  EvaluatorOptions evaluator_options;
+  evaluator_options.tracer = &tracer;
+  AnalyzerOptions analyzer_options;
+  analyzer_options.set_tracer(&tracer);
+  PreparedQuery query("SELECT 1", evaluator_options);
+  ZETASQL_ASSERT_OK(query.Prepare(analyzer_options));
+  EXPECT_THAT(tracer.events(),
+              ElementsAre("start parse", "end parse", "start resolve",
+                          "end resolve", "start algebrize", "end algebrize"));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  EXPECT_EQ(tracer.events().size(), 8);
+  EXPECT_EQ(tracer.events().back(), "end open");
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(tracer.events().back(), "start drain");
+  EXPECT_FALSE(iter->NextRow());
+  EXPECT_EQ(tracer.events().back(), "end drain");
+  iter.reset();
+  EXPECT_EQ(tracer.events().size(), 10);
+}
+
+TEST(EvaluatorTest, TracesExpressionExecution) {
+  RecordingTracer tracer;
+  EvaluatorOptions evaluator_options;
+  evaluator_options.tracer = &tracer;
+  PreparedExpression expr("1 + 1", evaluator_options);
+  ZETASQL_ASSERT_OK(expr.Prepare(AnalyzerOptions()));
+  EXPECT_THAT(tracer.events(), ElementsAre("start algebrize", "end algebrize"));
+  EXPECT_THAT(expr.Execute(), IsOkAndHolds(Int64(2)));
+  EXPECT_THAT(tracer.events(),
+              ElementsAre("start algebrize", "end algebrize", "start execute",
+                          "end execute"));
+}
+
+TEST(EvaluatorTest, UnnestGeneratedArrays) {
+  // The elements are generated as they are scanned, so the array may be
+  // larger than GENERATE_ARRAY itself allows.
+  PreparedQuery count_query(
+      "SELECT COUNT(*), SUM(x) FROM UNNEST(GENERATE_ARRAY(1, 100000)) AS x",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       count_query.Execute());
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(iter->GetValue(0), Int64(100000));
+  EXPECT_EQ(iter->GetValue(1), Int64(5000050000));
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+
+  PreparedQuery date_query(
+      "SELECT CAST(d AS STRING), o FROM UNNEST(GENERATE_DATE_ARRAY("
+      "'2020-01-01', '2020-01-10', INTERVAL 3 DAY)) AS d WITH OFFSET o "
+      "WHERE o >= 2 ORDER BY o",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, date_query.Execute());
+  std::vector<std::vector<Value>> rows;
+  while (iter->NextRow()) {
+    rows.push_back({iter->GetValue(0), iter->GetValue(1)});
+  }
+  ZETASQL_EXPECT_OK(iter->Status());
+  EXPECT_THAT(rows, ElementsAre(ElementsAre(String("2020-01-07"), Int64(2)),
+                                ElementsAre(String("2020-01-10"), Int64(3))));
+
+  PreparedQuery null_query("SELECT x FROM UNNEST(GENERATE_ARRAY(1, NULL)) x",
+                           EvaluatorOptions());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, null_query.Execute());
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+
+  PreparedQuery zero_step_query(
+      "SELECT x FROM UNNEST(GENERATE_ARRAY(1, 10, 0)) x", EvaluatorOptions());
+  const zetasql_base::Status zero_step_status =
+      [&zero_step_query]() -> zetasql_base::Status {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+                     zero_step_query.Execute());
+    while (iter->NextRow()) {
+    }
+    return iter->Status();
+  }();
+  EXPECT_THAT(zero_step_status,
+              StatusIs(zetasql_base::OUT_OF_RANGE,
+                       HasSubstr("step cannot be 0")));
+
+  // Outside of UNNEST, the array is still materialized.
+  PreparedExpression expr("ARRAY_LENGTH(GENERATE_ARRAY(1, 100000))");
+  EXPECT_THAT(expr.Execute(), StatusIs(zetasql_base::OUT_OF_RANGE));
+}
+
+TEST(EvaluatorTest, ValueArena) {
+  EvaluatorOptions evaluator_options;
+  evaluator_options.max_value_arena_byte_size = 1 << 20;
+
+  PreparedExpression expr("ARRAY(SELECT CONCAT('s', CAST(x AS STRING)) "
+                          "FROM UNNEST([1, 2, 3]) AS x ORDER BY x)",
+                          evaluator_options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(Value result, expr.Execute());
+  EXPECT_EQ(result, values::StringArray({"s1", "s2", "s3"}));
+
+  PreparedQuery query(
+      "SELECT x, CONCAT('s', CAST(x AS STRING)) AS s, [x, x] AS a "
+      "FROM UNNEST([1, 2]) AS x ORDER BY x",
+      evaluator_options);
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+  std::vector<std::vector<Value>> rows;
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                         query.Execute());
+    while (iter->NextRow()) {
+      rows.push_back(
+          {iter->GetValue(0), iter->GetValue(1), iter->GetValue(2)});
+    }
+    ZETASQL_ASSERT_OK(iter->Status());
+  }
+  // The rows outlive the iterator and with it the arena.
+  ASSERT_EQ(rows.size(), 2);
+  EXPECT_EQ(rows[0][1].string_value(), "s1");
+  EXPECT_EQ(rows[1][1].string_value(), "s2");
+  EXPECT_EQ(rows[1][2], values::Int64Array({2, 2}));
+}
+
 class PreparedModifyTest : public ::testing::Test {
  public:
   void SetUp() override {
@@ -1740,12 +3025,26 @@ class PreparedModifyTest : public ::testing::Test {
     ZETASQL_ASSERT_OK(test_table->SetPrimaryKey({0}));
     catalog_.AddOwnedTable(std::move(test_table));
 
+    // Large enough for the WHERE clause to be evaluated on multiple threads.
+    auto large_table = absl::make_unique<SimpleTable>(
+        "large_table",
+        std::vector<SimpleTable::NameAndType>{{"int_val", types::Int64Type()}});
+    std::vector<std::vector<Value>> large_table_rows;
+    for (int64_t i = 0; i < kNumLargeTableRows; ++i) {
+      large_table_rows.push_back({Int64(i)});
+    }
+    large_table->SetContents(large_table_rows);
+    ZETASQL_ASSERT_OK(large_table->SetPrimaryKey({0}));
+    catalog_.AddOwnedTable(std::move(large_table));
+
     analyzer_options_.mutable_language()->SetSupportsAllStatementKinds();
   }
 
   Catalog* catalog() { return &catalog_; }
   const AnalyzerOptions& analyzer_options() { return analyzer_options_; }
 
+  static constexpr int64_t kNumLargeTableRows = 10000;
+
  private:
   SimpleCatalog catalog_{"test_catalog"};
   AnalyzerOptions analyzer_options_;
@@ -1835,6 +3134,86 @@ TEST_F(PreparedModifyTest, ExecutesUpdate) {
   ZETASQL_EXPECT_OK(iter->Status());
 }
 
+TEST_F(PreparedModifyTest, NextBatch) {
+  PreparedModify modify(
+      "update test_table set str_val = 'foo' where int_val > 1",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(modify.Prepare(analyzer_options(), catalog()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableModifyIterator> iter,
+                       modify.Execute());
+
+  EvaluatorTableModifyIterator::Batch batch;
+  ASSERT_TRUE(iter->NextBatch(/*max_rows=*/10, &batch));
+  EXPECT_EQ(batch.operation, EvaluatorTableModifyIterator::Operation::kUpdate);
+  EXPECT_EQ(batch.num_rows, 2);
+  ASSERT_EQ(batch.columns.size(), 2);
+  EXPECT_THAT(batch.columns[0], ElementsAre(Int64(2), Int64(4)));
+  EXPECT_THAT(batch.columns[1], ElementsAre(String("foo"), String("foo")));
+  ASSERT_EQ(batch.original_keys.size(), 1);
+  EXPECT_THAT(batch.original_keys[0], ElementsAre(Int64(2), Int64(4)));
+
+  EXPECT_FALSE(iter->NextBatch(/*max_rows=*/10, &batch));
+  EXPECT_EQ(batch.num_rows, 0);
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST_F(PreparedModifyTest, NextBatchRespectsMaxRows) {
+  PreparedModify modify("delete test_table where true", EvaluatorOptions());
+  ZETASQL_ASSERT_OK(modify.Prepare(analyzer_options(), catalog()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableModifyIterator> iter,
+                       modify.Execute());
+
+  EvaluatorTableModifyIterator::Batch batch;
+  ASSERT_TRUE(iter->NextBatch(/*max_rows=*/2, &batch));
+  EXPECT_EQ(batch.operation, EvaluatorTableModifyIterator::Operation::kDelete);
+  EXPECT_EQ(batch.num_rows, 2);
+  EXPECT_TRUE(batch.columns.empty());
+  ASSERT_EQ(batch.original_keys.size(), 1);
+  EXPECT_THAT(batch.original_keys[0], ElementsAre(Int64(1), Int64(2)));
+
+  ASSERT_TRUE(iter->NextBatch(/*max_rows=*/2, &batch));
+  EXPECT_EQ(batch.num_rows, 1);
+  ASSERT_EQ(batch.original_keys.size(), 1);
+  EXPECT_THAT(batch.original_keys[0], ElementsAre(Int64(4)));
+
+  EXPECT_FALSE(iter->NextBatch(/*max_rows=*/2, &batch));
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST_F(PreparedModifyTest, WhereClauseOnMultipleThreads) {
+  for (const int num_threads : {1, 4}) {
+    SCOPED_TRACE(absl::StrCat("num_threads: ", num_threads));
+    EvaluatorOptions options;
+    options.num_threads = num_threads;
+
+    PreparedModify update(
+        "update large_table set int_val = int_val where mod(int_val, 3) = 0",
+        options);
+    ZETASQL_ASSERT_OK(update.Prepare(analyzer_options(), catalog()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableModifyIterator> iter,
+                         update.Execute());
+    std::vector<Value> updated_keys;
+    EvaluatorTableModifyIterator::Batch batch;
+    while (iter->NextBatch(/*max_rows=*/1000, &batch)) {
+      ASSERT_EQ(batch.original_keys.size(), 1);
+      updated_keys.insert(updated_keys.end(), batch.original_keys[0].begin(),
+                          batch.original_keys[0].end());
+    }
+    ZETASQL_ASSERT_OK(iter->Status());
+    ASSERT_EQ(updated_keys.size(), (kNumLargeTableRows + 2) / 3);
+    for (int64_t i = 0; i < updated_keys.size(); ++i) {
+      EXPECT_EQ(updated_keys[i], Int64(3 * i));
+    }
+
+    PreparedModify failing_delete(
+        "delete large_table where 1 / (int_val - 7777) > 0", options);
+    ZETASQL_ASSERT_OK(failing_delete.Prepare(analyzer_options(), catalog()));
+    EXPECT_THAT(
+        failing_delete.Execute(),
+        StatusIs(zetasql_base::OUT_OF_RANGE, HasSubstr("division by zero")));
+  }
+}
+
 TEST_F(PreparedModifyTest, IteratorStillLiveOnDestruction) {
   auto query = absl::make_unique<PreparedModify>(
       "delete from test_table where true", EvaluatorOptions());
@@ -2558,6 +3937,10 @@ class PreparedQueryProtoTest : public PreparedQueryTest {
     return context_->num_proto_deserializations();
   }
 
+  int64_t GetNumProtoFieldBytesDecoded() const {
+    return context_->num_proto_field_bytes_decoded();
+  }
+
   TypeFactory type_factory_;
   std::unique_ptr<SimpleTable> table_;
   std::unique_ptr<SimpleTable> table2_;
@@ -2662,6 +4045,40 @@ TEST_F(PreparedQueryProtoTest, SelectTwoFieldsFromProtoInTwoRows) {
   EXPECT_EQ(GetNumProtoDeserializations(), 2);
 }
 
+TEST_F(PreparedQueryProtoTest, DefersFieldsNotReadByFilter) {
+  auto new_table =
+      absl::WrapUnique(new SimpleTable("NewTestTable", {{"col", proto_type_}}));
+  new_table->SetContents({{GetProtoValue(1)}, {GetProtoValue(3)}});
+  catalog_->AddTable(new_table->Name(), new_table.get());
+
+  PreparedQuery query(
+      "select col.int64_key_1, col.int64_key_2, col.nested_value "
+      "from NewTestTable where col.int64_key_1 = 3",
+      EvaluatorOptions());
+  SetupContextCallback(&query);
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), catalog_.get()));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.ExecuteAfterPrepareWithOrderedParams({}));
+  ASSERT_EQ(iter->NumColumns(), 3);
+
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(iter->GetValue(0), Int64(3));
+  EXPECT_EQ(iter->GetValue(1), Int64(4));
+  const Value nested_value = iter->GetValue(2);
+
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+
+  // The filter field is read from both rows, the other fields only from the
+  // row that passes the filter.
+  EXPECT_EQ(GetNumProtoDeserializations(), 3);
+  EXPECT_EQ(GetNumProtoFieldBytesDecoded(),
+            2 * Int64(1).physical_byte_size() +
+                Int64(4).physical_byte_size() +
+                nested_value.physical_byte_size());
+}
+
 TEST_F(PreparedQueryProtoTest, SelectSameFieldTwice) {
   PreparedQuery query("select col.int64_key_1, col.int64_key_1 from TestTable",
                       EvaluatorOptions());
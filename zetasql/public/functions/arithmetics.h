@@ -24,6 +24,10 @@
 //   bool Modulo(T in1, T in2, T *out, zetasql_base::Status* error);
 //   bool UnaryMinus(InType in, OutType *out, zetasql_base::Status* error);
 //
+// Add(), Subtract() and Multiply() also have batch variants over spans,
+// AddBatch(), SubtractBatch() and MultiplyBatch(), for the evaluation of
+// columns of values.
+//
 // If overflow or any other error occurs, all functions return false and update
 // *error.
 // T must be a numeric type: either floating point type or integer type with
@@ -37,7 +41,9 @@
 #ifndef ZETASQL_PUBLIC_FUNCTIONS_ARITHMETICS_H_
 #define ZETASQL_PUBLIC_FUNCTIONS_ARITHMETICS_H_
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <limits>
 #include <type_traits>
 
@@ -49,6 +55,7 @@
 #include "absl/base/optimization.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
 
@@ -56,6 +63,13 @@
 #define __has_builtin(x) 0
 #endif
 
+// GCC has the overflow builtins since version 5, but only __has_builtin since
+// version 10.
+#if __has_builtin(__builtin_uadd_overflow) || \
+    (defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 5)
+#define ZETASQL_HAS_OVERFLOW_BUILTINS 1
+#endif
+
 namespace zetasql {
 namespace functions {
 
@@ -184,12 +198,12 @@ inline bool UnaryMinus(float in, float *out, zetasql_base::Status* error) {
 
 // ----------------------- Integer -----------------------
 
-// LLVM and Clang have builtin functions that implement overflow checking most
-// efficiently (using overflow flag). We use them when they are available.
+// LLVM, Clang and GCC have builtin functions that implement overflow checking
+// most efficiently (using overflow flag). We use them when they are available.
 //   http://clang.llvm.org/docs/LanguageExtensions.html#builtin-functions
 // Even when this builtins are available we may still need more generic code
 // below when input types are not the same.
-#if __has_builtin(__builtin_uadd_overflow)
+#ifdef ZETASQL_HAS_OVERFLOW_BUILTINS
 
 static_assert(std::is_same<uint32_t, unsigned>::value,  // NOLINT(runtime/int)
               "unsigned != uint32_t?");
@@ -606,6 +620,207 @@ inline bool UnaryMinus(BigNumericValue in, BigNumericValue* out,
   return false;
 }
 
+// ----------------------- Batch -----------------------
+
+// Computes out[i] = in1[i] + in2[i] for every i. The spans must have the same
+// size. Returns false and updates *error with the error that Add() returns for
+// the first element that fails, in which case the contents of 'out' are
+// unspecified.
+template <typename T>
+inline bool AddBatch(absl::Span<const T> in1, absl::Span<const T> in2,
+                     absl::Span<T> out, zetasql_base::Status* error);
+// Same as above, for Subtract<T, T>().
+template <typename T>
+inline bool SubtractBatch(absl::Span<const T> in1, absl::Span<const T> in2,
+                          absl::Span<T> out, zetasql_base::Status* error);
+// Same as above, for Multiply().
+template <typename T>
+inline bool MultiplyBatch(absl::Span<const T> in1, absl::Span<const T> in2,
+                          absl::Span<T> out, zetasql_base::Status* error);
+
+namespace internal {
+
+enum class BatchOp { kAdd, kSubtract, kMultiply };
+
+// The number of elements that the batch kernels below compute before checking
+// whether any of them failed.
+constexpr size_t kArithmeticBatchBlockSize = 64;
+
+// The scalar function of each BatchOp.
+template <BatchOp op>
+struct ScalarOp;
+
+template <>
+struct ScalarOp<BatchOp::kAdd> {
+  template <typename T>
+  static bool Apply(T in1, T in2, T* out, zetasql_base::Status* error) {
+    return Add<T>(in1, in2, out, error);
+  }
+};
+
+template <>
+struct ScalarOp<BatchOp::kSubtract> {
+  template <typename T>
+  static bool Apply(T in1, T in2, T* out, zetasql_base::Status* error) {
+    return Subtract<T, T>(in1, in2, out, error);
+  }
+};
+
+template <>
+struct ScalarOp<BatchOp::kMultiply> {
+  template <typename T>
+  static bool Apply(T in1, T in2, T* out, zetasql_base::Status* error) {
+    return Multiply<T>(in1, in2, out, error);
+  }
+};
+
+// Computes 'n' elements with the scalar function, stopping at the first one
+// that fails.
+template <BatchOp op, typename T>
+inline bool ApplyScalarOpToBlock(const T* in1, const T* in2, T* out, size_t n,
+                                 zetasql_base::Status* error) {
+  for (size_t i = 0; i < n; ++i) {
+    if (ABSL_PREDICT_FALSE(
+            !ScalarOp<op>::Apply(in1[i], in2[i], &out[i], error))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs 'compute_block' on consecutive blocks of kArithmeticBatchBlockSize
+// elements. 'compute_block' returns true if some element of the block may
+// have failed, in which case the block is computed again with the scalar
+// function to find out which one did and report its error.
+template <BatchOp op, typename T, typename ComputeBlock>
+inline bool ApplyByBlock(absl::Span<const T> in1, absl::Span<const T> in2,
+                         absl::Span<T> out, zetasql_base::Status* error,
+                         ComputeBlock compute_block) {
+  for (size_t start = 0; start < out.size();
+       start += kArithmeticBatchBlockSize) {
+    const size_t n = std::min(kArithmeticBatchBlockSize, out.size() - start);
+    const T* block_in1 = in1.data() + start;
+    const T* block_in2 = in2.data() + start;
+    T* block_out = out.data() + start;
+    if (ABSL_PREDICT_FALSE(compute_block(block_in1, block_in2, block_out, n)) &&
+        !ApplyScalarOpToBlock<op, T>(block_in1, block_in2, block_out, n,
+                                     error)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Batch implementation of 'op' for T. This generic version calls the scalar
+// function on every element, which NUMERIC and BIGNUMERIC need anyway; the
+// specializations below check whole blocks of elements at once.
+template <BatchOp op, typename T, typename Enable = void>
+struct BatchKernel {
+  static bool Run(absl::Span<const T> in1, absl::Span<const T> in2,
+                  absl::Span<T> out, zetasql_base::Status* error) {
+    return ApplyScalarOpToBlock<op, T>(in1.data(), in2.data(), out.data(),
+                                       out.size(), error);
+  }
+};
+
+// Floating point operations only fail if they produce an infinity or NaN from
+// finite inputs, so a block only needs to be checked again if one of its
+// results is not finite. The loop has no branches and can be vectorized.
+template <BatchOp op, typename T>
+struct BatchKernel<
+    op, T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static bool Run(absl::Span<const T> in1, absl::Span<const T> in2,
+                  absl::Span<T> out, zetasql_base::Status* error) {
+    return ApplyByBlock<op, T>(
+        in1, in2, out, error,
+        [](const T* block_in1, const T* block_in2, T* block_out, size_t n) {
+          bool maybe_failed = false;
+          for (size_t i = 0; i < n; ++i) {
+            switch (op) {
+              case BatchOp::kAdd:
+                block_out[i] = block_in1[i] + block_in2[i];
+                break;
+              case BatchOp::kSubtract:
+                block_out[i] = block_in1[i] - block_in2[i];
+                break;
+              case BatchOp::kMultiply:
+                block_out[i] = block_in1[i] * block_in2[i];
+                break;
+            }
+            maybe_failed |= !std::isfinite(block_out[i]);
+          }
+          return maybe_failed;
+        });
+  }
+};
+
+#ifdef ZETASQL_HAS_OVERFLOW_BUILTINS
+
+// Returns true for the integer types whose scalar 'op' is one of the
+// overflow builtin specializations above, which only fail on overflow.
+template <BatchOp op, typename T>
+constexpr bool HasOverflowBuiltinKernel() {
+  return std::is_same<T, int64_t>::value ||
+         (op != BatchOp::kSubtract && (std::is_same<T, int32_t>::value ||
+                                       std::is_same<T, uint64_t>::value));
+}
+
+// Integer operations accumulate the overflow flags of a block instead of
+// branching on every element.
+template <BatchOp op, typename T>
+struct BatchKernel<
+    op, T, typename std::enable_if<HasOverflowBuiltinKernel<op, T>()>::type> {
+  static bool Run(absl::Span<const T> in1, absl::Span<const T> in2,
+                  absl::Span<T> out, zetasql_base::Status* error) {
+    return ApplyByBlock<op, T>(
+        in1, in2, out, error,
+        [](const T* block_in1, const T* block_in2, T* block_out, size_t n) {
+          bool overflow = false;
+          for (size_t i = 0; i < n; ++i) {
+            switch (op) {
+              case BatchOp::kAdd:
+                overflow |= __builtin_add_overflow(block_in1[i], block_in2[i],
+                                                   &block_out[i]);
+                break;
+              case BatchOp::kSubtract:
+                overflow |= __builtin_sub_overflow(block_in1[i], block_in2[i],
+                                                   &block_out[i]);
+                break;
+              case BatchOp::kMultiply:
+                overflow |= __builtin_mul_overflow(block_in1[i], block_in2[i],
+                                                   &block_out[i]);
+                break;
+            }
+          }
+          return overflow;
+        });
+  }
+};
+
+#endif  // ZETASQL_HAS_OVERFLOW_BUILTINS
+
+}  // namespace internal
+
+template <typename T>
+inline bool AddBatch(absl::Span<const T> in1, absl::Span<const T> in2,
+                     absl::Span<T> out, zetasql_base::Status* error) {
+  return internal::BatchKernel<internal::BatchOp::kAdd, T>::Run(in1, in2, out,
+                                                                error);
+}
+
+template <typename T>
+inline bool SubtractBatch(absl::Span<const T> in1, absl::Span<const T> in2,
+                          absl::Span<T> out, zetasql_base::Status* error) {
+  return internal::BatchKernel<internal::BatchOp::kSubtract, T>::Run(
+      in1, in2, out, error);
+}
+
+template <typename T>
+inline bool MultiplyBatch(absl::Span<const T> in1, absl::Span<const T> in2,
+                          absl::Span<T> out, zetasql_base::Status* error) {
+  return internal::BatchKernel<internal::BatchOp::kMultiply, T>::Run(
+      in1, in2, out, error);
+}
 
 }  // namespace functions
 }  // namespace zetasql
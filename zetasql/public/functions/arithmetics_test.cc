@@ -0,0 +1,183 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/functions/arithmetics.h"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+#include "gtest/gtest.h"
+#include "zetasql/public/numeric_value.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+namespace functions {
+namespace {
+
+template <typename T>
+bool IsNaN(T value) {
+  return false;
+}
+
+bool IsNaN(double value) { return std::isnan(value); }
+
+// Checks that 'batch_function' computes the same results as
+// 'scalar_function' on 'in1' and 'in2', or fails with the error of the first
+// element for which 'scalar_function' fails.
+template <typename T>
+void ExpectBatchSameAsScalar(
+    bool (*batch_function)(absl::Span<const T>, absl::Span<const T>,
+                           absl::Span<T>, zetasql_base::Status*),
+    bool (*scalar_function)(T, T, T*, zetasql_base::Status*),
+    const std::vector<T>& in1, const std::vector<T>& in2) {
+  ASSERT_EQ(in1.size(), in2.size());
+  std::vector<T> expected(in1.size());
+  zetasql_base::Status expected_error;
+  int num_ok = 0;
+  for (; num_ok < in1.size(); ++num_ok) {
+    if (!scalar_function(in1[num_ok], in2[num_ok], &expected[num_ok],
+                         &expected_error)) {
+      break;
+    }
+  }
+
+  std::vector<T> out(in1.size());
+  zetasql_base::Status error;
+  const bool ok = batch_function(in1, in2, absl::MakeSpan(out), &error);
+  EXPECT_EQ(ok, num_ok == in1.size());
+  EXPECT_EQ(error, expected_error);
+  if (!ok) return;
+  for (int i = 0; i < in1.size(); ++i) {
+    if (IsNaN(expected[i])) {
+      EXPECT_TRUE(IsNaN(out[i])) << i;
+    } else {
+      EXPECT_EQ(out[i], expected[i]) << i;
+    }
+  }
+}
+
+// Returns 'size' elements counting up from 'start', with 'special' at
+// 'special_index' if it is not negative.
+template <typename T>
+std::vector<T> MakeInput(int size, T start, int special_index = -1,
+                         T special = T()) {
+  std::vector<T> values;
+  for (int i = 0; i < size; ++i) {
+    values.push_back(i == special_index ? special : start + static_cast<T>(i));
+  }
+  return values;
+}
+
+TEST(ArithmeticsTest, Int64Batches) {
+  const int64_t kMax = std::numeric_limits<int64_t>::max();
+  const int64_t kMin = std::numeric_limits<int64_t>::min();
+  // Sizes around the block size, with an overflow in a later block.
+  for (int size : {0, 1, 63, 64, 65, 200}) {
+    const std::vector<int64_t> in1 = MakeInput<int64_t>(size, -100);
+    const std::vector<int64_t> in2 = MakeInput<int64_t>(size, 3);
+    ExpectBatchSameAsScalar<int64_t>(&AddBatch<int64_t>, &Add<int64_t>, in1,
+                                     in2);
+    ExpectBatchSameAsScalar<int64_t>(&SubtractBatch<int64_t>,
+                                     &Subtract<int64_t, int64_t>, in1, in2);
+    ExpectBatchSameAsScalar<int64_t>(&MultiplyBatch<int64_t>,
+                                     &Multiply<int64_t>, in1, in2);
+  }
+  const std::vector<int64_t> in2 = MakeInput<int64_t>(200, 3);
+  ExpectBatchSameAsScalar<int64_t>(&AddBatch<int64_t>, &Add<int64_t>,
+                                   MakeInput<int64_t>(200, 0, 150, kMax), in2);
+  ExpectBatchSameAsScalar<int64_t>(&SubtractBatch<int64_t>,
+                                   &Subtract<int64_t, int64_t>,
+                                   MakeInput<int64_t>(200, 0, 70, kMin), in2);
+  ExpectBatchSameAsScalar<int64_t>(&MultiplyBatch<int64_t>,
+                                   &Multiply<int64_t>,
+                                   MakeInput<int64_t>(200, 0, 199, kMax / 2),
+                                   in2);
+  // Only the first failing element is reported.
+  std::vector<int64_t> in1(200, kMax);
+  in1[0] = 0;
+  ExpectBatchSameAsScalar<int64_t>(&AddBatch<int64_t>, &Add<int64_t>, in1,
+                                   in2);
+}
+
+TEST(ArithmeticsTest, OtherIntegerBatches) {
+  ExpectBatchSameAsScalar<int32_t>(
+      &AddBatch<int32_t>, &Add<int32_t>,
+      MakeInput<int32_t>(100, 0, 90, std::numeric_limits<int32_t>::max()),
+      MakeInput<int32_t>(100, 1));
+  ExpectBatchSameAsScalar<int32_t>(&MultiplyBatch<int32_t>,
+                                   &Multiply<int32_t>,
+                                   MakeInput<int32_t>(100, -50),
+                                   MakeInput<int32_t>(100, 7));
+  ExpectBatchSameAsScalar<uint64_t>(
+      &AddBatch<uint64_t>, &Add<uint64_t>,
+      MakeInput<uint64_t>(100, 0, 80, std::numeric_limits<uint64_t>::max()),
+      MakeInput<uint64_t>(100, 1));
+  ExpectBatchSameAsScalar<uint64_t>(
+      &MultiplyBatch<uint64_t>, &Multiply<uint64_t>,
+      MakeInput<uint64_t>(100, 1, 5, uint64_t{1} << 62),
+      MakeInput<uint64_t>(100, 2));
+}
+
+TEST(ArithmeticsTest, DoubleBatches) {
+  const double kMax = std::numeric_limits<double>::max();
+  const double kInf = std::numeric_limits<double>::infinity();
+  const double kNaN = std::numeric_limits<double>::quiet_NaN();
+  const std::vector<double> in2 = MakeInput<double>(100, 0.5);
+  using BatchFunction =
+      bool (*)(absl::Span<const double>, absl::Span<const double>,
+               absl::Span<double>, zetasql_base::Status*);
+  using ScalarFunction =
+      bool (*)(double, double, double*, zetasql_base::Status*);
+  for (const auto& functions :
+       std::vector<std::pair<BatchFunction, ScalarFunction>>{
+           {&AddBatch<double>, &Add<double>},
+           {&SubtractBatch<double>, &Subtract<double, double>},
+           {&MultiplyBatch<double>, &Multiply<double>}}) {
+    ExpectBatchSameAsScalar<double>(functions.first, functions.second,
+                                    MakeInput<double>(100, -20.25), in2);
+    // Non-finite inputs produce non-finite results without an error.
+    ExpectBatchSameAsScalar<double>(functions.first, functions.second,
+                                    MakeInput<double>(100, 0, 30, kInf), in2);
+    ExpectBatchSameAsScalar<double>(functions.first, functions.second,
+                                    MakeInput<double>(100, 0, 40, kNaN), in2);
+  }
+  // Finite inputs with a non-finite result fail.
+  ExpectBatchSameAsScalar<double>(&AddBatch<double>, &Add<double>,
+                                  MakeInput<double>(100, 0, 70, kMax),
+                                  std::vector<double>(100, kMax));
+  ExpectBatchSameAsScalar<double>(&MultiplyBatch<double>, &Multiply<double>,
+                                  MakeInput<double>(100, 0, 99, kMax), in2);
+}
+
+TEST(ArithmeticsTest, NumericBatches) {
+  const std::vector<NumericValue> in1 = {NumericValue(1), NumericValue(-2),
+                                         NumericValue::MaxValue()};
+  const std::vector<NumericValue> in2 = {NumericValue(3), NumericValue(4),
+                                         NumericValue(5)};
+  ExpectBatchSameAsScalar<NumericValue>(&AddBatch<NumericValue>,
+                                        &Add<NumericValue>, in1, in2);
+  ExpectBatchSameAsScalar<NumericValue>(
+      &MultiplyBatch<NumericValue>, &Multiply<NumericValue>,
+      {in1.begin(), in1.begin() + 2}, {in2.begin(), in2.begin() + 2});
+}
+
+}  // namespace
+}  // namespace functions
+}  // namespace zetasql
@@ -16,6 +16,11 @@
 
 #include "zetasql/public/functions/convert_string.h"
 
+#include <stdio.h>
+
+#include <cmath>
+#include <limits>
+
 #include "zetasql/common/string_util.h"
 #include "zetasql/public/functions/util.h"
 #include "zetasql/base/string_numbers.h"
@@ -58,6 +63,38 @@ bool IsHex(absl::string_view str) {
   return str.size() >= 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X');
 }
 
+// Parses <str> into <out> if it is a decimal integer of at most 18 digits with
+// an optional sign, and in the range of T.  Such strings cover almost all
+// inputs, and cannot overflow an int64_t while being parsed.  Returns false
+// for everything else, which is left to absl::SimpleAtoi().
+template <typename T>
+bool ParseShortDecimal(absl::string_view str, T* out) {
+  bool negative = false;
+  if (!str.empty() && (str[0] == '-' || str[0] == '+')) {
+    negative = str[0] == '-';
+    str.remove_prefix(1);
+  }
+  if (str.empty() || str.size() > 18) return false;
+  int64_t value = 0;
+  for (const char c : str) {
+    const unsigned int digit = static_cast<unsigned char>(c) - '0';
+    if (digit > 9) return false;
+    value = value * 10 + digit;
+  }
+  if (negative) {
+    // SimpleAtoi() rejects "-0" for unsigned types.
+    if (!std::numeric_limits<T>::is_signed) return false;
+    value = -value;
+  }
+  if (value < static_cast<int64_t>(std::numeric_limits<T>::min()) ||
+      static_cast<uint64_t>(value) >
+          static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+    return false;
+  }
+  *out = static_cast<T>(value);
+  return true;
+}
+
 constexpr absl::string_view kTrueStringValue = "true";
 constexpr absl::string_view kFalseStringValue = "false";
 
@@ -101,15 +138,27 @@ bool NumericToString(uint64_t value, std::string* out, zetasql_base::Status* err
   return true;
 }
 
+// Same as RoundTripFloatToString() and RoundTripDoubleToString().
 template <>
 bool NumericToString(float value, std::string* out, zetasql_base::Status* error) {
-  *out = RoundTripFloatToString(value);
+  if (std::isnan(value)) {
+    out->assign("nan");
+  } else {
+    // Formats into a buffer instead of a temporary string.
+    char buffer[32];
+    out->assign(buffer, snprintf(buffer, sizeof(buffer), "%.9g", value));
+  }
   return true;
 }
 
 template <>
 bool NumericToString(double value, std::string* out, zetasql_base::Status* error) {
-  *out = RoundTripDoubleToString(value);
+  if (std::isnan(value)) {
+    out->assign("nan");
+  } else {
+    char buffer[32];
+    out->assign(buffer, snprintf(buffer, sizeof(buffer), "%.17g", value));
+  }
   return true;
 }
 
@@ -154,7 +203,10 @@ bool StringToNumeric(absl::string_view value, int32_t* out, zetasql_base::Status
             zetasql_base::safe_strto32_base(value, out, 16 /* base */)))
       return true;
   } else {
-    if (ABSL_PREDICT_TRUE(absl::SimpleAtoi(value, out))) return true;
+    if (ABSL_PREDICT_TRUE(ParseShortDecimal(value, out) ||
+                          absl::SimpleAtoi(value, out))) {
+      return true;
+    }
   }
   return internal::UpdateError(error, FormatError("Bad int32_t value: ", value));
 }
@@ -167,7 +219,10 @@ bool StringToNumeric(absl::string_view value, int64_t* out, zetasql_base::Status
             zetasql_base::safe_strto64_base(value, out, 16 /* base */)))
       return true;
   } else {
-    if (ABSL_PREDICT_TRUE(absl::SimpleAtoi(value, out))) return true;
+    if (ABSL_PREDICT_TRUE(ParseShortDecimal(value, out) ||
+                          absl::SimpleAtoi(value, out))) {
+      return true;
+    }
   }
   return internal::UpdateError(error, FormatError("Bad int64_t value: ", value));
 }
@@ -181,7 +236,10 @@ bool StringToNumeric(absl::string_view value, uint32_t* out,
             zetasql_base::safe_strtou32_base(value, out, 16 /* base */)))
       return true;
   } else {
-    if (ABSL_PREDICT_TRUE(absl::SimpleAtoi(value, out))) return true;
+    if (ABSL_PREDICT_TRUE(ParseShortDecimal(value, out) ||
+                          absl::SimpleAtoi(value, out))) {
+      return true;
+    }
   }
   return internal::UpdateError(error, FormatError("Bad uint32_t value: ", value));
 }
@@ -195,7 +253,10 @@ bool StringToNumeric(absl::string_view value, uint64_t* out,
             zetasql_base::safe_strtou64_base(value, out, 16 /* base */)))
       return true;
   } else {
-    if (ABSL_PREDICT_TRUE(absl::SimpleAtoi(value, out))) return true;
+    if (ABSL_PREDICT_TRUE(ParseShortDecimal(value, out) ||
+                          absl::SimpleAtoi(value, out))) {
+      return true;
+    }
   }
   return internal::UpdateError(error, FormatError("Bad uint64_t value: ", value));
 }
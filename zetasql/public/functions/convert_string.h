@@ -30,10 +30,13 @@
 #define ZETASQL_PUBLIC_FUNCTIONS_CONVERT_STRING_H_
 
 #include <string>
+#include <vector>
 
 #include "zetasql/public/numeric_value.h"
 #include <cstdint>
+#include "absl/base/optimization.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "zetasql/base/status.h"
 
 namespace zetasql {
@@ -95,6 +98,43 @@ template <>
 bool StringToNumeric(absl::string_view value, BigNumericValue* out,
                      zetasql_base::Status* error);
 
+// Batch versions of StringToNumeric() and NumericToString(), which convert
+// each element of <values> into the element of <out> at the same index, for
+// casting many values of the same type at once.  <out> must be at least as
+// large as <values>.
+//
+// StringToNumericBatch() does not stop at errors.  It returns the number of
+// values that failed to convert, whose elements in <out> are unspecified.  If
+// <failed> is not null, it is resized to the number of values and its element
+// is set to true for each failed value.  <error> (if not null) is set to the
+// error of the first failed value.
+template <typename T>
+int64_t StringToNumericBatch(absl::Span<const absl::string_view> values,
+                             absl::Span<T> out, std::vector<bool>* failed,
+                             zetasql_base::Status* error) {
+  if (failed != nullptr) failed->assign(values.size(), false);
+  int64_t num_failed = 0;
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (ABSL_PREDICT_TRUE(StringToNumeric<T>(
+            values[i], &out[i], num_failed == 0 ? error : nullptr))) {
+      continue;
+    }
+    ++num_failed;
+    if (failed != nullptr) (*failed)[i] = true;
+  }
+  return num_failed;
+}
+
+// The conversions to strings cannot fail.  The strings in <out> are
+// overwritten, reusing their buffers.
+template <typename T>
+void NumericToStringBatch(absl::Span<const T> values,
+                          absl::Span<std::string> out) {
+  for (size_t i = 0; i < values.size(); ++i) {
+    NumericToString<T>(values[i], &out[i], /*error=*/nullptr);
+  }
+}
+
 }  // namespace functions
 }  // namespace zetasql
 
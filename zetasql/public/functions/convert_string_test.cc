@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/common/string_util.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
 #include "gmock/gmock.h"
@@ -181,5 +182,67 @@ TEST(Convert, TestDouble) {
   TestAll<double>();
 }
 
+TEST(Convert, ShortDecimalStrings) {
+  int32_t int32_out;
+  int64_t int64_out;
+  uint64_t uint64_out;
+  zetasql_base::Status error;
+  EXPECT_TRUE(StringToNumeric("+5", &int32_out, &error));
+  EXPECT_EQ(5, int32_out);
+  EXPECT_TRUE(StringToNumeric("-0012", &int32_out, &error));
+  EXPECT_EQ(-12, int32_out);
+  EXPECT_TRUE(StringToNumeric(" 12 ", &int32_out, &error));
+  EXPECT_EQ(12, int32_out);
+  EXPECT_TRUE(StringToNumeric("-2147483648", &int32_out, &error));
+  EXPECT_EQ(std::numeric_limits<int32_t>::min(), int32_out);
+  EXPECT_TRUE(StringToNumeric("1234567890123456789", &int64_out, &error));
+  EXPECT_EQ(1234567890123456789, int64_out);
+  ZETASQL_EXPECT_OK(error);
+
+  EXPECT_FALSE(StringToNumeric("2147483648", &int32_out, &error));
+  EXPECT_FALSE(StringToNumeric("-0", &uint64_out, &error));
+  EXPECT_FALSE(StringToNumeric("+", &int32_out, &error));
+  EXPECT_FALSE(StringToNumeric("1 2", &int32_out, &error));
+  EXPECT_FALSE(error.ok());
+}
+
+TEST(Convert, FloatingPointStrings) {
+  std::string out;
+  zetasql_base::Status error;
+  for (double value : {0.0, -0.0, 0.1, 1.0 / 3, 1e300, -2.5e-310,
+                       std::numeric_limits<double>::max(),
+                       std::numeric_limits<double>::infinity(),
+                       -std::numeric_limits<double>::infinity(),
+                       std::numeric_limits<double>::quiet_NaN()}) {
+    EXPECT_TRUE(NumericToString(value, &out, &error));
+    EXPECT_EQ(RoundTripDoubleToString(value), out);
+    EXPECT_TRUE(NumericToString(static_cast<float>(value), &out, &error));
+    EXPECT_EQ(RoundTripFloatToString(static_cast<float>(value)), out);
+  }
+  ZETASQL_EXPECT_OK(error);
+}
+
+TEST(Convert, Batches) {
+  const std::vector<absl::string_view> strings = {"1", "-2", "x", "40", ""};
+  std::vector<int64_t> numerics(strings.size());
+  std::vector<bool> failed;
+  zetasql_base::Status error;
+  EXPECT_EQ(2, StringToNumericBatch<int64_t>(strings, absl::MakeSpan(numerics),
+                                           &failed, &error));
+  EXPECT_THAT(failed, ::testing::ElementsAre(false, false, true, false, true));
+  EXPECT_EQ(1, numerics[0]);
+  EXPECT_EQ(-2, numerics[1]);
+  EXPECT_EQ(40, numerics[3]);
+  // The error is the one of the first failure.
+  int64_t unused;
+  zetasql_base::Status expected_error;
+  StringToNumeric("x", &unused, &expected_error);
+  EXPECT_EQ(expected_error, error);
+
+  std::vector<std::string> out(numerics.size());
+  NumericToStringBatch<int64_t>({1, -2, 40}, absl::MakeSpan(out).subspan(0, 3));
+  EXPECT_THAT(out, ::testing::ElementsAre("1", "-2", "40", "", ""));
+}
+
 }  // namespace functions
 }  // namespace zetasql
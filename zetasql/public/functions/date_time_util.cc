@@ -17,6 +17,7 @@
 #include "zetasql/public/functions/date_time_util.h"
 
 #include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <limits>
@@ -29,6 +30,7 @@
 #include "zetasql/public/functions/date_time_util_internal.h"
 #include "zetasql/public/type.h"
 #include "zetasql/base/status.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
@@ -47,10 +49,12 @@ namespace zetasql {
 namespace functions {
 namespace {
 
+using date_time_util_internal::CivilInfoAt;
 using date_time_util_internal::GetIsoWeek;
 using date_time_util_internal::GetIsoYear;
 using date_time_util_internal::NextWeekdayOrToday;
 using date_time_util_internal::PrevWeekdayOrToday;
+using date_time_util_internal::TimeZoneCache;
 
 constexpr int64_t kNaiveNumSecondsPerMinute = 60;
 constexpr int64_t kNaiveNumSecondsPerHour = 60 * kNaiveNumSecondsPerMinute;
@@ -1100,39 +1104,308 @@ static void NarrowTimestampIfPossible(int64_t* timestamp, TimestampScale* scale)
 // in years before 1884), we instead treat it (and display it) as -07:52.
 static absl::TimeZone GetNormalizedTimeZone(absl::Time base_time,
                                             absl::TimeZone timezone) {
-  const int timezone_offset = timezone.At(base_time).offset;
+  const int timezone_offset = CivilInfoAt(timezone, base_time).offset;
   if (const int seconds_offset = timezone_offset % 60)
     return absl::FixedTimeZone(timezone_offset - seconds_offset);
   return timezone;
 }
 
-static zetasql_base::Status FormatTimestampToStringInternal(
-    absl::string_view format_string, absl::Time base_time,
-    absl::TimeZone timezone, bool truncate_tz, bool expand_quarter,
-    std::string* output) {
-  if (!IsValidTime(base_time)) {
+// Appends the ZetaSQL format of a time zone with the given UTC offset,
+// 'UTC[+/-HHMM]', to <out>.  The offset must be a whole number of minutes.
+static zetasql_base::Status AppendTimeZoneName(int seconds, std::string* out) {
+  absl::StrAppend(out, "UTC");
+  if (seconds == 0) return zetasql_base::OkStatus();
+  const char sign = (seconds < 0 ? '-' : '+');
+  int minutes = seconds / 60;
+  seconds %= 60;
+  if (sign == '-') {
+    if (seconds > 0) {
+      seconds -= 60;
+      minutes += 1;
+    }
+    seconds = -seconds;
+    minutes = -minutes;
+  }
+  int hours = minutes / 60;
+  minutes %= 60;
+  out->push_back(sign);
+  ZETASQL_RET_CHECK_EQ(seconds, 0);
+  if (minutes != 0) {
+    absl::StrAppend(out, absl::StrFormat("%02d%02d", hours, minutes));
+  } else {
+    absl::StrAppend(out, hours);
+  }
+  return zetasql_base::OkStatus();
+}
+
+static void AppendTwoDigits(int value, std::string* out) {
+  out->push_back(static_cast<char>('0' + value / 10));
+  out->push_back(static_cast<char>('0' + value % 10));
+}
+
+TimestampFormatter::TimestampFormatter(absl::string_view format_string,
+                                       bool expand_quarter)
+    : format_string_(format_string), expand_quarter_(expand_quarter) {
+  // Format elements are split the same way as in ExpandPercentZQ(), which
+  // absl::FormatTime() agrees with for all the elements handled here.
+  absl::string_view format = format_string;
+  while (!format.empty()) {
+    const size_t pct = format.find('%');
+    if (pct == absl::string_view::npos) {
+      AddLiteral(format);
+      break;
+    }
+    AddLiteral(format.substr(0, pct));
+    if (pct + 1 == format.size()) {
+      // absl::FormatTime() copies a trailing '%'.
+      AddLiteral("%");
+      break;
+    }
+    const absl::string_view element = format.substr(pct, 2);
+    format.remove_prefix(pct + 2);
+    switch (element[1]) {
+      case 'Y':
+        AddElement(ElementKind::kYear);
+        break;
+      case 'm':
+        AddElement(ElementKind::kMonth);
+        break;
+      case 'd':
+        AddElement(ElementKind::kDay);
+        break;
+      case 'H':
+        AddElement(ElementKind::kHour);
+        break;
+      case 'M':
+        AddElement(ElementKind::kMinute);
+        break;
+      case 'S':
+        AddElement(ElementKind::kSecond);
+        break;
+      case 'F':
+        AddElement(ElementKind::kYear);
+        AddLiteral("-");
+        AddElement(ElementKind::kMonth);
+        AddLiteral("-");
+        AddElement(ElementKind::kDay);
+        break;
+      case 'T':
+        AddElement(ElementKind::kHour);
+        AddLiteral(":");
+        AddElement(ElementKind::kMinute);
+        AddLiteral(":");
+        AddElement(ElementKind::kSecond);
+        break;
+      case 'z':
+        AddElement(ElementKind::kOffset);
+        break;
+      case '%':
+        AddLiteral("%");
+        break;
+      case 'Z':
+        AddElement(ElementKind::kZone);
+        break;
+      case 'Q':
+        if (expand_quarter_) {
+          AddElement(ElementKind::kQuarter);
+        } else {
+          elements_.push_back({ElementKind::kAbslFormat, std::string(element)});
+        }
+        break;
+      case 'E':
+        if (absl::ConsumePrefix(&format, "4Y")) {
+          AddElement(ElementKind::kYear4);
+          break;
+        }
+        if (absl::ConsumePrefix(&format, "z")) {
+          AddElement(ElementKind::kOffset);
+          elements_.back().text = ":";
+          break;
+        }
+        if (absl::ConsumePrefix(&format, "*S")) {
+          AddElement(ElementKind::kSecond);
+          AddElement(ElementKind::kSubsecond, /*digits=*/-1);
+          break;
+        }
+        if (format.size() >= 2 && absl::ascii_isdigit(format[0]) &&
+            format[1] == 'S') {
+          const int digits = format[0] - '0';
+          format.remove_prefix(2);
+          AddElement(ElementKind::kSecond);
+          if (digits > 0) AddElement(ElementKind::kSubsecond, digits);
+          break;
+        }
+        use_absl_format_ = true;
+        elements_.clear();
+        return;
+      case 'O':
+        use_absl_format_ = true;
+        elements_.clear();
+        return;
+      default:
+        if (!elements_.empty() &&
+            elements_.back().kind == ElementKind::kAbslFormat) {
+          absl::StrAppend(&elements_.back().text, element);
+        } else {
+          elements_.push_back({ElementKind::kAbslFormat, std::string(element)});
+        }
+        break;
+    }
+  }
+}
+
+void TimestampFormatter::AddLiteral(absl::string_view text) {
+  if (text.empty()) return;
+  if (!elements_.empty() && elements_.back().kind == ElementKind::kLiteral) {
+    absl::StrAppend(&elements_.back().text, text);
+  } else {
+    elements_.push_back({ElementKind::kLiteral, std::string(text)});
+  }
+}
+
+void TimestampFormatter::AddElement(ElementKind kind, int digits) {
+  elements_.push_back({kind, "", digits});
+}
+
+zetasql_base::Status TimestampFormatter::Format(absl::Time timestamp,
+                                        absl::TimeZone timezone,
+                                        std::string* out) const {
+  if (!IsValidTime(timestamp)) {
     return MakeEvalError() << "Invalid timestamp value: "
-                           << absl::ToUnixMicros(base_time);
-  }
-  output->clear();
-  absl::TimeZone normalized_timezone =
-      GetNormalizedTimeZone(base_time, timezone);
-  std::string updated_format_string;
-  // We handle %Z and %Q here instead of passing them through to FormatTime()
-  // because ZetaSQL behavior is different than FormatTime() behavior.
-  ZETASQL_RETURN_IF_ERROR(internal_functions::ExpandPercentZQ(
-      format_string, base_time, normalized_timezone, expand_quarter,
-      &updated_format_string));
-  *output =
-      absl::FormatTime(updated_format_string, base_time, normalized_timezone);
+                           << absl::ToUnixMicros(timestamp);
+  }
+  out->clear();
+  // See GetNormalizedTimeZone().
+  absl::TimeZone::CivilInfo info = CivilInfoAt(timezone, timestamp);
+  if (const int seconds_offset = info.offset % 60) {
+    timezone = absl::FixedTimeZone(info.offset - seconds_offset);
+    info = CivilInfoAt(timezone, timestamp);
+  }
+  if (use_absl_format_) {
+    // We handle %Z and %Q here instead of passing them through to
+    // FormatTime() because ZetaSQL behavior is different than FormatTime()
+    // behavior.
+    std::string updated_format_string;
+    ZETASQL_RETURN_IF_ERROR(internal_functions::ExpandPercentZQ(
+        format_string_, timestamp, timezone, expand_quarter_,
+        &updated_format_string));
+    *out = absl::FormatTime(updated_format_string, timestamp, timezone);
+    return zetasql_base::OkStatus();
+  }
+
+  for (const Element& element : elements_) {
+    switch (element.kind) {
+      case ElementKind::kLiteral:
+        absl::StrAppend(out, element.text);
+        break;
+      case ElementKind::kAbslFormat:
+        absl::StrAppend(out, absl::FormatTime(element.text, timestamp,
+                                              timezone));
+        break;
+      case ElementKind::kYear:
+        absl::StrAppend(out, info.cs.year());
+        break;
+      case ElementKind::kYear4:
+        if (info.cs.year() >= 0 && info.cs.year() <= 9999) {
+          AppendTwoDigits(info.cs.year() / 100, out);
+          AppendTwoDigits(info.cs.year() % 100, out);
+        } else {
+          absl::StrAppend(out, absl::FormatTime("%E4Y", timestamp, timezone));
+        }
+        break;
+      case ElementKind::kMonth:
+        AppendTwoDigits(info.cs.month(), out);
+        break;
+      case ElementKind::kDay:
+        AppendTwoDigits(info.cs.day(), out);
+        break;
+      case ElementKind::kHour:
+        AppendTwoDigits(info.cs.hour(), out);
+        break;
+      case ElementKind::kMinute:
+        AppendTwoDigits(info.cs.minute(), out);
+        break;
+      case ElementKind::kSecond:
+        AppendTwoDigits(info.cs.second(), out);
+        break;
+      case ElementKind::kSubsecond: {
+        int64_t nanos = absl::ToInt64Nanoseconds(info.subsecond);
+        int digits = element.digits;
+        if (digits < 0) {
+          if (nanos == 0) break;
+          digits = 9;
+          while (nanos % 10 == 0) {
+            nanos /= 10;
+            --digits;
+          }
+        } else {
+          for (int i = digits; i < 9; ++i) nanos /= 10;
+        }
+        char buffer[10];
+        buffer[0] = '.';
+        for (int i = digits; i > 0; --i) {
+          buffer[i] = static_cast<char>('0' + nanos % 10);
+          nanos /= 10;
+        }
+        out->append(buffer, digits + 1);
+        break;
+      }
+      case ElementKind::kOffset: {
+        const int minutes = info.offset / 60;
+        out->push_back(minutes < 0 ? '-' : '+');
+        AppendTwoDigits(std::abs(minutes) / 60, out);
+        absl::StrAppend(out, element.text);
+        AppendTwoDigits(std::abs(minutes) % 60, out);
+        break;
+      }
+      case ElementKind::kQuarter:
+        absl::StrAppend(out, (info.cs.month() - 1) / 3 + 1);
+        break;
+      case ElementKind::kZone:
+        ZETASQL_RETURN_IF_ERROR(AppendTimeZoneName(info.offset, out));
+        break;
+    }
+  }
+  return zetasql_base::OkStatus();
+}
+
+static zetasql_base::Status FormatTimestampToStringInternal(
+    const TimestampFormatter& formatter, absl::Time base_time,
+    absl::TimeZone timezone, bool truncate_tz, std::string* output) {
+  ZETASQL_RETURN_IF_ERROR(formatter.Format(base_time, timezone, output));
   if (truncate_tz) {
     // If ":00" appears at the end, remove it.  This is consistent with
     // Postgres.
-    *output = std::string(absl::StripSuffix(*output, ":00"));
+    if (absl::EndsWith(*output, ":00")) output->resize(output->size() - 3);
   }
   return ::zetasql_base::OkStatus();
 }
 
+static zetasql_base::Status FormatTimestampToStringInternal(
+    absl::string_view format_string, absl::Time base_time,
+    absl::TimeZone timezone, bool truncate_tz, bool expand_quarter,
+    std::string* output) {
+  const TimestampFormatter formatter(format_string, expand_quarter);
+  return FormatTimestampToStringInternal(formatter, base_time, timezone,
+                                         truncate_tz, output);
+}
+
+// Returns the formatter for DefaultTimestampFormatStr(<scale>).
+static const TimestampFormatter& DefaultTimestampFormatter(
+    TimestampScale scale) {
+  static const TimestampFormatter* const kFormatters[] = {
+      new TimestampFormatter(DefaultTimestampFormatStr(kSeconds),
+                             /*expand_quarter=*/true),
+      new TimestampFormatter(DefaultTimestampFormatStr(kMilliseconds),
+                             /*expand_quarter=*/true),
+      new TimestampFormatter(DefaultTimestampFormatStr(kMicroseconds),
+                             /*expand_quarter=*/true),
+      new TimestampFormatter(DefaultTimestampFormatStr(kNanoseconds),
+                             /*expand_quarter=*/true),
+  };
+  return *kFormatters[scale / 3];
+}
+
 static zetasql_base::Status ConvertTimestampToStringInternal(
     int64_t timestamp, TimestampScale scale, absl::TimeZone timezone,
     bool truncate_trailing_zeros, std::string* out) {
@@ -1142,9 +1415,9 @@ static zetasql_base::Status ConvertTimestampToStringInternal(
     NarrowTimestampIfPossible(&timestamp, &scale);
   }
   const absl::Time base_time = MakeTime(timestamp, scale);
-  return FormatTimestampToStringInternal(
-      DefaultTimestampFormatStr(scale), base_time, timezone,
-      /*truncate_tz=*/true, /*expand_quarter=*/true, out);
+  return FormatTimestampToStringInternal(DefaultTimestampFormatter(scale),
+                                         base_time, timezone,
+                                         /*truncate_tz=*/true, out);
 }
 
 // Returns the absl::Weekday corresponding to 'part', which must be one of the
@@ -1179,7 +1452,7 @@ static zetasql_base::Status ExtractFromTimestampInternal(DateTimestampPart part,
                                                  absl::Time base_time,
                                                  absl::TimeZone timezone,
                                                  int32_t* output) {
-  const absl::TimeZone::CivilInfo info = timezone.At(base_time);
+  const absl::TimeZone::CivilInfo info = CivilInfoAt(timezone, base_time);
 
   switch (part) {
     case YEAR:
@@ -1389,7 +1662,7 @@ static zetasql_base::Status TimestampTruncAtLeastMinute(absl::Time timestamp,
                                                 absl::TimeZone timezone,
                                                 DateTimestampPart part,
                                                 absl::Time* output) {
-  const absl::TimeZone::CivilInfo info = timezone.At(timestamp);
+  const absl::TimeZone::CivilInfo info = CivilInfoAt(timezone, timestamp);
 
   // Given a valid input timestamp, truncation should never result in failure
   // when reconstructing the timestamp from its parts, so ZETASQL_RET_CHECK the results.
@@ -1759,7 +2032,7 @@ zetasql_base::Status ConvertTimestampMicrosToStringWithTruncation(
   }
   absl::TimeZone normalized_timezone = GetNormalizedTimeZone(time, timezone);
 
-  absl::TimeZone::CivilInfo info = normalized_timezone.At(time);
+  absl::TimeZone::CivilInfo info = CivilInfoAt(normalized_timezone, time);
 
   // YYYY-mm-dd HH:MM:SS.ssssss+oo:oo
   // 01234567890123456789012345678901
@@ -1995,20 +2268,51 @@ static void SanitizeDatetimeFormat(absl::string_view format_string,
   return SanitizeFormat(format_string, "Zz", out);
 }
 
-zetasql_base::Status FormatDateToString(absl::string_view format_string, int32_t date,
-                                bool expand_quarter, std::string* out) {
+static std::unique_ptr<TimestampFormatter> MakeDateFormatter(
+    absl::string_view format_string, bool expand_quarter) {
+  std::string date_format_string;
+  SanitizeDateFormat(format_string, &date_format_string);
+  return absl::make_unique<TimestampFormatter>(date_format_string,
+                                               expand_quarter);
+}
+
+std::unique_ptr<TimestampFormatter> MakeDateFormatter(
+    absl::string_view format_string) {
+  return MakeDateFormatter(format_string, /*expand_quarter=*/true);
+}
+
+std::unique_ptr<TimestampFormatter> MakeDatetimeFormatter(
+    absl::string_view format_string) {
+  std::string datetime_format_string;
+  SanitizeDatetimeFormat(format_string, &datetime_format_string);
+  return absl::make_unique<TimestampFormatter>(datetime_format_string,
+                                               /*expand_quarter=*/true);
+}
+
+std::unique_ptr<TimestampFormatter> MakeTimeFormatter(
+    absl::string_view format_string) {
+  std::string time_format_string;
+  SanitizeTimeFormat(format_string, &time_format_string);
+  return absl::make_unique<TimestampFormatter>(time_format_string,
+                                               /*expand_quarter=*/true);
+}
+
+zetasql_base::Status FormatDateToString(const TimestampFormatter& formatter,
+                                int32_t date, std::string* out) {
   if (!IsValidDate(date)) {
     return MakeEvalError() << "Invalid date value: " << date;
   }
-  std::string date_format_string;
-  SanitizeDateFormat(format_string, &date_format_string);
-  // Treats it as a timestamp at midnight on that date and invokes the
-  // format_timestamp function.
+  // Treats it as a timestamp at midnight on that date and formats it like
+  // the format_timestamp function.
   int64_t date_timestamp = static_cast<int64_t>(date) * kNaiveNumMicrosPerDay;
-  ZETASQL_RETURN_IF_ERROR(FormatTimestampToString(date_format_string, date_timestamp,
-                                          absl::UTCTimeZone(), expand_quarter,
-                                          out));
-  return ::zetasql_base::OkStatus();
+  return formatter.Format(MakeTime(date_timestamp, kMicroseconds),
+                          absl::UTCTimeZone(), out);
+}
+
+zetasql_base::Status FormatDateToString(absl::string_view format_string, int32_t date,
+                                bool expand_quarter, std::string* out) {
+  return FormatDateToString(*MakeDateFormatter(format_string, expand_quarter),
+                            date, out);
 }
 
 zetasql_base::Status FormatDateToString(absl::string_view format_string, int32_t date,
@@ -2016,41 +2320,43 @@ zetasql_base::Status FormatDateToString(absl::string_view format_string, int32_t
   return FormatDateToString(format_string, date, /*expand_quarter=*/true, out);
 }
 
-zetasql_base::Status FormatDatetimeToString(absl::string_view format_string,
+zetasql_base::Status FormatDatetimeToString(const TimestampFormatter& formatter,
                                     const DatetimeValue& datetime,
                                     std::string* out) {
   if (!datetime.IsValid()) {
     return MakeEvalError() << "Invalid datetime value: "
                            << datetime.DebugString();
   }
-  std::string datetime_format_string;
-  SanitizeDatetimeFormat(format_string, &datetime_format_string);
   absl::Time datetime_in_utc =
       absl::UTCTimeZone().At(datetime.ConvertToCivilSecond()).pre;
   datetime_in_utc += absl::Nanoseconds(datetime.Nanoseconds());
+  return formatter.Format(datetime_in_utc, absl::UTCTimeZone(), out);
+}
 
-  ZETASQL_RETURN_IF_ERROR(FormatTimestampToString(
-      datetime_format_string, datetime_in_utc, absl::UTCTimeZone(), out));
-  return ::zetasql_base::OkStatus();
+zetasql_base::Status FormatDatetimeToString(absl::string_view format_string,
+                                    const DatetimeValue& datetime,
+                                    std::string* out) {
+  return FormatDatetimeToString(*MakeDatetimeFormatter(format_string),
+                                datetime, out);
 }
 
-zetasql_base::Status FormatTimeToString(absl::string_view format_string,
+zetasql_base::Status FormatTimeToString(const TimestampFormatter& formatter,
                                 const TimeValue& time, std::string* out) {
   if (!time.IsValid()) {
     return MakeEvalError() << "Invalid time value: " << time.DebugString();
   }
-  std::string time_format_string;
-  SanitizeTimeFormat(format_string, &time_format_string);
   absl::Time time_in_epoch_day =
       absl::UTCTimeZone()
           .At(absl::CivilSecond(1970, 1, 1, time.Hour(), time.Minute(),
                                 time.Second()))
           .pre;
   time_in_epoch_day += absl::Nanoseconds(time.Nanoseconds());
+  return formatter.Format(time_in_epoch_day, absl::UTCTimeZone(), out);
+}
 
-  ZETASQL_RETURN_IF_ERROR(FormatTimestampToString(time_format_string, time_in_epoch_day,
-                                          absl::UTCTimeZone(), out));
-  return ::zetasql_base::OkStatus();
+zetasql_base::Status FormatTimeToString(absl::string_view format_string,
+                                const TimeValue& time, std::string* out) {
+  return FormatTimeToString(*MakeTimeFormatter(format_string), time, out);
 }
 
 zetasql_base::Status FormatTimestampToString(absl::string_view format_str,
@@ -2116,9 +2422,9 @@ zetasql_base::Status ConvertTimestampToString(absl::Time input, TimestampScale s
                                       absl::TimeZone timezone,
                                       std::string* output) {
   NarrowTimestampScaleIfPossible(input, &scale);
-  return FormatTimestampToStringInternal(DefaultTimestampFormatStr(scale),
+  return FormatTimestampToStringInternal(DefaultTimestampFormatter(scale),
                                          input, timezone, /*truncate_tz=*/true,
-                                         /*expand_quarter=*/true, output);
+                                         output);
 }
 
 zetasql_base::Status ConvertTimestampToString(absl::Time input, TimestampScale scale,
@@ -2129,8 +2435,8 @@ zetasql_base::Status ConvertTimestampToString(absl::Time input, TimestampScale s
   return ConvertTimestampToString(input, scale, timezone, output);
 }
 
-zetasql_base::Status MakeTimeZone(absl::string_view timezone_string,
-                          absl::TimeZone* timezone) {
+static zetasql_base::Status MakeTimeZoneUncached(
+    absl::string_view timezone_string, absl::TimeZone* timezone) {
   // An empty time zone is an error.  There is no inherent default.
   if (timezone_string.empty()) {
     return MakeEvalError() << "Invalid empty time zone";
@@ -2161,13 +2467,129 @@ zetasql_base::Status MakeTimeZone(absl::string_view timezone_string,
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::Status MakeTimeZone(absl::string_view timezone_string,
+                          absl::TimeZone* timezone) {
+  // Time zone arguments are usually the same few strings for every row, and
+  // absl::LoadTimeZone() locks and copies the name even when the zone is
+  // already loaded.
+  TimeZoneCache* cache = TimeZoneCache::Global();
+  if (cache->Lookup(timezone_string, timezone)) {
+    return ::zetasql_base::OkStatus();
+  }
+  ZETASQL_RETURN_IF_ERROR(MakeTimeZoneUncached(timezone_string, timezone));
+  cache->Insert(timezone_string, *timezone);
+  return ::zetasql_base::OkStatus();
+}
+
+// Parses exactly <num_digits> digits of <str> starting at offset <idx> into
+// <value>.  Returns success or failure.
+static bool ParseFixedDigits(absl::string_view str, int idx, int num_digits,
+                             int* value) {
+  if (idx + num_digits > static_cast<int64_t>(str.size())) return false;
+  *value = 0;
+  for (int i = idx; i < idx + num_digits; ++i) {
+    if (!absl::ascii_isdigit(str[i])) return false;
+    *value = *value * 10 + (str[i] - '0');
+  }
+  return true;
+}
+
+// Parses the YYYY-MM-DD prefix of <str>, with exactly 2 month and day digits.
+// Returns success or failure.
+static bool ParseFixedDateParts(absl::string_view str, int* year, int* month,
+                                int* day) {
+  return str.size() >= 10 && ParseFixedDigits(str, 0, 4, year) &&
+         str[4] == '-' && ParseFixedDigits(str, 5, 2, month) &&
+         str[7] == '-' && ParseFixedDigits(str, 8, 2, day);
+}
+
+// A fast path of ConvertStringToTimestamp() for the fixed-layout canonical
+// strings that event data mostly consists of:
+//   YYYY-MM-DD[( |T|t)HH:MM:SS[.D*]][Z|z| UTC|(+|-)HH[:MM]]
+// with exactly 2 digits per part.  Converts the parts with integer arithmetic
+// if the time zone is in <str>, instead of looking the time zone up.  Returns
+// false for any other string and for any string that is invalid, leaving the
+// parsing and the error to the general path.
+static bool ConvertCanonicalStringToTimestamp(absl::string_view str,
+                                              absl::TimeZone default_timezone,
+                                              TimestampScale scale,
+                                              bool allow_tz_in_str,
+                                              absl::Time* output) {
+  int year, month, day;
+  int hour = 0, minute = 0, second = 0, subsecond = 0;
+  if (!ParseFixedDateParts(str, &year, &month, &day)) return false;
+  int idx = 10;
+  const int size = str.size();
+  if (idx < size) {
+    if (idx + 9 > size ||
+        (str[idx] != ' ' && str[idx] != 'T' && str[idx] != 't') ||
+        !ParseFixedDigits(str, idx + 1, 2, &hour) || str[idx + 3] != ':' ||
+        !ParseFixedDigits(str, idx + 4, 2, &minute) || str[idx + 6] != ':' ||
+        !ParseFixedDigits(str, idx + 7, 2, &second)) {
+      return false;
+    }
+    idx += 9;
+    if (idx < size && str[idx] == '.') {
+      const int start_subsecond_idx = ++idx;
+      while (idx < size && idx - start_subsecond_idx < scale &&
+             absl::ascii_isdigit(str[idx])) {
+        subsecond = subsecond * 10 + (str[idx] - '0');
+        ++idx;
+      }
+      const int num_subsecond_digits = idx - start_subsecond_idx;
+      if (num_subsecond_digits == 0) return false;
+      subsecond *= powers_of_ten[scale - num_subsecond_digits];
+    }
+  }
+  if (!IsValidDay(year, month, day) ||
+      !IsValidTimeOfDay(hour, minute, second)) {
+    return false;
+  }
+
+  if (idx == size) {
+    const absl::CivilSecond cs(year, month, day, hour, minute, second);
+    *output = default_timezone.At(cs).pre + MakeDuration(subsecond, scale);
+    return IsValidTime(*output);
+  }
+  if (!allow_tz_in_str) return false;
+  const absl::string_view timezone_string = str.substr(idx);
+  int64_t offset_seconds = 0;
+  if (timezone_string != "Z" && timezone_string != "z" &&
+      timezone_string != " UTC") {
+    const char sign = timezone_string[0];
+    int timezone_hour;
+    int timezone_minute = 0;
+    if ((sign != '+' && sign != '-') ||
+        !ParseFixedDigits(timezone_string, 1, 2, &timezone_hour) ||
+        (timezone_string.size() != 3 &&
+         (timezone_string.size() != 6 || timezone_string[3] != ':' ||
+          !ParseFixedDigits(timezone_string, 4, 2, &timezone_minute))) ||
+        !TimeZonePartsToOffset(sign, timezone_hour, timezone_minute, kSeconds,
+                               &offset_seconds)) {
+      return false;
+    }
+  }
+  constexpr int64_t kSecondsPerDay = 24 * 60 * 60;
+  const int64_t seconds =
+      CivilDayToEpochDays(absl::CivilDay(year, month, day)) * kSecondsPerDay +
+      (hour * 60 + minute) * 60 + second - offset_seconds;
+  *output = absl::FromUnixSeconds(seconds) + MakeDuration(subsecond, scale);
+  return IsValidTime(*output);
+}
+
 zetasql_base::Status ConvertStringToDate(absl::string_view str, int32_t* date) {
   int year = 0, month = 0, day = 0, idx = 0;
+  absl::CivilDay civil_day;
+  // Fast path for the canonical YYYY-MM-DD form.
+  if (str.size() == 10 && ParseFixedDateParts(str, &year, &month, &day) &&
+      MakeDate(year, month, day, &civil_day)) {
+    *date = CivilDayToEpochDays(civil_day);
+    return ::zetasql_base::OkStatus();
+  }
   if (!ParseStringToDateParts(str, &idx, &year, &month, &day) ||
       !IsValidDay(year, month, day)) {
     return MakeEvalError() << "Invalid date: '" << str << "'";
   }
-  absl::CivilDay civil_day;
   if (!MakeDate(year, month, day, &civil_day)) {
     return MakeEvalError() << "Date value out of range: '" << str << "'";
   }
@@ -2230,6 +2652,10 @@ zetasql_base::Status ConvertStringToTimestamp(absl::string_view str,
                                       TimestampScale scale,
                                       bool allow_tz_in_str,
                                       absl::Time* output) {
+  if (ConvertCanonicalStringToTimestamp(str, default_timezone, scale,
+                                        allow_tz_in_str, output)) {
+    return ::zetasql_base::OkStatus();
+  }
   int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
   int subsecond = 0;
   bool string_includes_timezone = false;
@@ -2689,7 +3115,7 @@ zetasql_base::Status ConvertTimestampToDatetime(absl::Time base_time,
                                         absl::TimeZone timezone,
                                         DatetimeValue* output) {
   if (IsValidTime(base_time)) {
-    const absl::TimeZone::CivilInfo info = timezone.At(base_time);
+    const absl::TimeZone::CivilInfo info = CivilInfoAt(timezone, base_time);
     *output = DatetimeValue::FromYMDHMSAndNanos(
         // cast is safe, since we check 'IsValidTime.
         static_cast<int32_t>(info.cs.year()), info.cs.month(), info.cs.day(),
@@ -2721,7 +3147,7 @@ zetasql_base::Status ConvertTimestampToTime(absl::Time base_time,
                                     TimestampScale scale, TimeValue* output) {
   ZETASQL_RET_CHECK(scale == kNanoseconds || scale == kMicroseconds);
   if (IsValidTime(base_time)) {
-    const absl::TimeZone::CivilInfo info = timezone.At(base_time);
+    const absl::TimeZone::CivilInfo info = CivilInfoAt(timezone, base_time);
     if (scale == kNanoseconds) {
       *output = TimeValue::FromHMSAndNanos(
           info.cs.hour(), info.cs.minute(), info.cs.second(),
@@ -3802,6 +4228,243 @@ zetasql_base::Status TimestampDiff(absl::Time timestamp1, absl::Time timestamp2,
   return ::zetasql_base::OkStatus();
 }
 
+// Returns <value> / <divisor> rounded towards negative infinity.  <divisor>
+// must be positive.
+static int64_t FloorDivide(int64_t value, int64_t divisor) {
+  int64_t quotient = value / divisor;
+  if (value % divisor < 0) --quotient;
+  return quotient;
+}
+
+static int64_t FloorModulo(int64_t value, int64_t divisor) {
+  return value - FloorDivide(value, divisor) * divisor;
+}
+
+static constexpr int64_t kMicrosPerSecond = 1000000;
+static constexpr int64_t kMicrosPerDay = 24 * 60 * 60 * kMicrosPerSecond;
+
+// Returns the number of microseconds in a <part> of DAY through MICROSECOND,
+// or 0 for the other parts.
+static int64_t MicrosPerPart(DateTimestampPart part) {
+  switch (part) {
+    case DAY:
+      return kMicrosPerDay;
+    case HOUR:
+      return 60 * 60 * kMicrosPerSecond;
+    case MINUTE:
+      return 60 * kMicrosPerSecond;
+    case SECOND:
+      return kMicrosPerSecond;
+    case MILLISECOND:
+      return 1000;
+    case MICROSECOND:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+zetasql_base::Status TimestampTruncBatch(absl::Span<const int64_t> input,
+                                 absl::TimeZone timezone,
+                                 DateTimestampPart part,
+                                 absl::Span<int64_t> output) {
+  DCHECK_EQ(input.size(), output.size());
+  // Truncation to less than a minute does not depend on the time zone.
+  // Truncation to at most a day only depends on the offset of a fixed-offset
+  // time zone, as the start of a day, hour or minute of local time.
+  int64_t unit = 0;
+  int64_t offset_micros = 0;
+  int offset;
+  if (part == SECOND || part == MILLISECOND || part == MICROSECOND) {
+    unit = MicrosPerPart(part);
+  } else if ((part == DAY || part == HOUR || part == MINUTE) &&
+             date_time_util_internal::GetFixedUtcOffset(timezone, &offset)) {
+    unit = MicrosPerPart(part);
+    offset_micros = offset * kMicrosPerSecond;
+  }
+  for (int64_t i = 0; i < input.size(); ++i) {
+    if (unit != 0 && IsValidTimestamp(input[i], kMicroseconds)) {
+      const int64_t local_units = FloorDivide(input[i] + offset_micros, unit);
+      // The scalar function reports the error for a local day out of range.
+      if (part != DAY || IsValidDate(static_cast<int32_t>(local_units))) {
+        output[i] = local_units * unit - offset_micros;
+        continue;
+      }
+    }
+    ZETASQL_RETURN_IF_ERROR(TimestampTrunc(input[i], timezone, part, &output[i]));
+  }
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::Status ExtractFromTimestampBatch(DateTimestampPart part,
+                                       absl::Span<const int64_t> input,
+                                       absl::TimeZone timezone,
+                                       absl::Span<int32_t> output) {
+  DCHECK_EQ(input.size(), output.size());
+  bool fast = false;
+  int offset = 0;
+  switch (part) {
+    case DATE:
+    case DAYOFWEEK:
+    case HOUR:
+    case MINUTE:
+    case SECOND:
+    case MILLISECOND:
+    case MICROSECOND:
+    case NANOSECOND:
+      fast = date_time_util_internal::GetFixedUtcOffset(timezone, &offset);
+      break;
+    default:
+      break;
+  }
+  const int64_t offset_micros = offset * kMicrosPerSecond;
+  for (int64_t i = 0; i < input.size(); ++i) {
+    if (fast && IsValidTimestamp(input[i], kMicroseconds)) {
+      const int64_t local_micros = input[i] + offset_micros;
+      const int64_t days = FloorDivide(local_micros, kMicrosPerDay);
+      const int64_t micros_of_day = local_micros - days * kMicrosPerDay;
+      int64_t result;
+      switch (part) {
+        case DATE:
+          result = days;
+          break;
+        case DAYOFWEEK:
+          // 1970-01-01 is a Thursday, the 5th day of a week that starts on
+          // Sunday.
+          result = FloorModulo(days + 4, 7) + 1;
+          break;
+        case HOUR:
+          result = micros_of_day / MicrosPerPart(HOUR);
+          break;
+        case MINUTE:
+          result = micros_of_day / MicrosPerPart(MINUTE) % 60;
+          break;
+        case SECOND:
+          result = micros_of_day / kMicrosPerSecond % 60;
+          break;
+        case MILLISECOND:
+          result = micros_of_day % kMicrosPerSecond / 1000;
+          break;
+        case MICROSECOND:
+          result = micros_of_day % kMicrosPerSecond;
+          break;
+        default:  // NANOSECOND
+          result = micros_of_day % kMicrosPerSecond * 1000;
+          break;
+      }
+      // The scalar function reports the error for a date out of range.
+      if (part != DATE || IsValidDate(static_cast<int32_t>(result))) {
+        output[i] = static_cast<int32_t>(result);
+        continue;
+      }
+    }
+    ZETASQL_RETURN_IF_ERROR(ExtractFromTimestamp(part, input[i], kMicroseconds,
+                                         timezone, &output[i]));
+  }
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::Status TimestampDiffBatch(absl::Span<const int64_t> input,
+                                absl::Span<const int64_t> input2,
+                                DateTimestampPart part,
+                                absl::Span<int64_t> output) {
+  DCHECK_EQ(input.size(), input2.size());
+  DCHECK_EQ(input.size(), output.size());
+  const int64_t unit = MicrosPerPart(part);
+  const bool fast = unit != 0 || part == NANOSECOND;
+  for (int64_t i = 0; i < input.size(); ++i) {
+    // The difference between two valid timestamps cannot overflow.
+    if (fast && IsValidTimestamp(input[i], kMicroseconds) &&
+        IsValidTimestamp(input2[i], kMicroseconds)) {
+      const int64_t diff = input[i] - input2[i];
+      if (unit != 0) {
+        // Rounds towards zero like absl::IDivDuration().
+        output[i] = diff / unit;
+        continue;
+      }
+      if (Multiply<int64_t>(diff, 1000, &output[i], kNoError)) continue;
+    }
+    ZETASQL_RETURN_IF_ERROR(TimestampDiff(input[i], input2[i], kMicroseconds, part,
+                                  &output[i]));
+  }
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::Status AddTimestampBatch(absl::Span<const int64_t> input,
+                               absl::TimeZone timezone, DateTimestampPart part,
+                               int64_t interval, absl::Span<int64_t> output) {
+  DCHECK_EQ(input.size(), output.size());
+  // AddTimestamp() adds the interval as a number of microseconds, with a DAY
+  // being 24 hours, and truncates a NANOSECOND interval to microseconds.
+  int64_t interval_micros = 0;
+  bool fast;
+  if (part == NANOSECOND) {
+    interval_micros = interval / 1000;
+    fast = true;
+  } else {
+    const int64_t unit = MicrosPerPart(part);
+    fast = unit != 0 &&
+           Multiply<int64_t>(interval, unit, &interval_micros, kNoError);
+  }
+  for (int64_t i = 0; i < input.size(); ++i) {
+    if (fast && IsValidTimestamp(input[i], kMicroseconds) &&
+        Add<int64_t>(input[i], interval_micros, &output[i], kNoError) &&
+        IsValidTimestamp(output[i], kMicroseconds)) {
+      continue;
+    }
+    ZETASQL_RETURN_IF_ERROR(AddTimestamp(input[i], kMicroseconds, timezone, part,
+                                 interval, &output[i]));
+  }
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::Status TruncateDateBatch(absl::Span<const int32_t> input,
+                               DateTimestampPart part,
+                               absl::Span<int32_t> output) {
+  DCHECK_EQ(input.size(), output.size());
+  // The first day of the week, as a number of days after Monday.
+  int first_day_of_week = 0;
+  bool fast = false;
+  switch (part) {
+    case DAY:
+      fast = true;
+      break;
+    case WEEK:
+    case ISOWEEK:
+    case WEEK_MONDAY:
+    case WEEK_TUESDAY:
+    case WEEK_WEDNESDAY:
+    case WEEK_THURSDAY:
+    case WEEK_FRIDAY:
+    case WEEK_SATURDAY: {
+      ZETASQL_ASSIGN_OR_RETURN(const absl::Weekday weekday,
+                       GetFirstWeekDayOfWeek(part));
+      first_day_of_week = static_cast<int>(weekday);
+      fast = true;
+      break;
+    }
+    default:
+      break;
+  }
+  for (int64_t i = 0; i < input.size(); ++i) {
+    if (fast && IsValidDate(input[i])) {
+      int32_t result = input[i];
+      if (part != DAY) {
+        // 1970-01-01 is a Thursday, 3 days after a Monday.
+        const int64_t day_of_week = FloorModulo(int64_t{input[i]} + 3, 7);
+        result -= FloorModulo(day_of_week - first_day_of_week, 7);
+      }
+      // The scalar function reports the error for a date out of range.
+      if (IsValidDate(result)) {
+        output[i] = result;
+        continue;
+      }
+    }
+    ZETASQL_RETURN_IF_ERROR(TruncateDate(input[i], part, &output[i]));
+  }
+  return ::zetasql_base::OkStatus();
+}
+
 std::string TimestampScale_Name(TimestampScale scale) {
   switch (scale) {
     case kSeconds:         return "TIMESTAMP_SECOND";
@@ -3970,30 +4633,8 @@ zetasql_base::Status ExpandPercentZQ(absl::string_view format_string,
               (absl::ToCivilMonth(base_time, timezone).month() - 1) / 3 + 1));
     } else if (format_string[pct + 1] == 'Z') {
       // Handle %Z, computing the ZetaSQL defined timezone format.
-      absl::StrAppend(expanded_format_string, "UTC");
-      if (int seconds = timezone.At(base_time).offset) {
-        const char sign = (seconds < 0 ? '-' : '+');
-        int minutes = seconds / 60;
-        seconds %= 60;
-        if (sign == '-') {
-          if (seconds > 0) {
-            seconds -= 60;
-            minutes += 1;
-          }
-          seconds = -seconds;
-          minutes = -minutes;
-        }
-        int hours = minutes / 60;
-        minutes %= 60;
-        expanded_format_string->push_back(sign);
-        ZETASQL_RET_CHECK_EQ(seconds, 0);
-        if (minutes != 0) {
-          absl::StrAppend(expanded_format_string,
-                          absl::StrFormat("%02d%02d", hours, minutes));
-        } else {
-          absl::StrAppend(expanded_format_string, absl::StrFormat("%d", hours));
-        }
-      }
+      ZETASQL_RETURN_IF_ERROR(AppendTimeZoneName(timezone.At(base_time).offset,
+                                         expanded_format_string));
     } else {
       // Neither %Q nor %Z, copy as is.
       absl::StrAppend(expanded_format_string, format_string.substr(index, 2));
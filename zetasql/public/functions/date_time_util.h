@@ -17,7 +17,9 @@
 #ifndef ZETASQL_PUBLIC_FUNCTIONS_DATE_TIME_UTIL_H_
 #define ZETASQL_PUBLIC_FUNCTIONS_DATE_TIME_UTIL_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "google/protobuf/timestamp.pb.h"
 #include "google/type/date.pb.h"
@@ -30,6 +32,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/time/civil_time.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
 
@@ -222,6 +225,64 @@ zetasql_base::Status FormatTimestampToString(absl::string_view format_string,
                                      absl::string_view timezone_string,
                                      std::string* out);
 
+// A FormatTimestampToString() format string, compiled into a sequence of
+// format elements.  Formatting many timestamps with the same
+// TimestampFormatter avoids interpreting the format string for each of them,
+// and renders the common elements (%Y, %E4Y, %m, %d, %H, %M, %S, %E#S, %E*S,
+// %F, %T, %z, %Ez, %Q and %Z) without calling absl::FormatTime().  The other
+// elements are still rendered by absl::FormatTime().
+//
+// Produces the same output as FormatTimestampToString() with the same format
+// string and <expand_quarter>.  Thread-safe.
+class TimestampFormatter {
+ public:
+  TimestampFormatter(absl::string_view format_string, bool expand_quarter);
+  TimestampFormatter(const TimestampFormatter&) = delete;
+  TimestampFormatter& operator=(const TimestampFormatter&) = delete;
+
+  absl::string_view format_string() const { return format_string_; }
+  bool expand_quarter() const { return expand_quarter_; }
+
+  // Populates <out> with <timestamp> in <timezone>.  Returns an error if
+  // <timestamp> is out of the valid range.
+  zetasql_base::Status Format(absl::Time timestamp, absl::TimeZone timezone,
+                      std::string* out) const;
+
+ private:
+  enum class ElementKind {
+    kLiteral,     // Copies <text>.
+    kAbslFormat,  // Passes <text> to absl::FormatTime().
+    kYear,        // %Y, not padded.
+    kYear4,       // %E4Y, padded to 4 digits.
+    kMonth,
+    kDay,
+    kHour,
+    kMinute,
+    kSecond,
+    kSubsecond,   // <digits> digits after a '.', or all of the nonzero
+                  // digits (and no '.' if there are none) if <digits> is -1.
+    kOffset,      // %z, or %Ez if <text> is ":".
+    kQuarter,     // %Q if <expand_quarter>.
+    kZone,        // %Z, as 'UTC[+/-HHMM]'.
+  };
+  struct Element {
+    ElementKind kind;
+    std::string text;
+    int digits = 0;
+  };
+
+  void AddLiteral(absl::string_view text);
+  void AddElement(ElementKind kind, int digits = 0);
+
+  const std::string format_string_;
+  const bool expand_quarter_;
+  std::vector<Element> elements_;
+  // True if the format string has %E or %O elements that are not handled
+  // above, whose extent is up to absl::FormatTime().  Such format strings are
+  // passed to absl::FormatTime() as a whole, after expanding %Q and %Z.
+  bool use_absl_format_ = false;
+};
+
 // Populates <out> using the <format_string> as defined by absl::FormatTime()
 // in base/time.h. Assumes <date> is the number of days from 1970-01-01.
 //
@@ -269,6 +330,27 @@ zetasql_base::Status FormatDatetimeToString(absl::string_view format_string,
 zetasql_base::Status FormatTimeToString(absl::string_view format_string,
                                 const TimeValue& time, std::string* out);
 
+// Returns a TimestampFormatter that formats like FormatDateToString(),
+// FormatDatetimeToString() or FormatTimeToString() with <format_string>, i.e.
+// whose format elements that do not apply to the type are escaped.
+std::unique_ptr<TimestampFormatter> MakeDateFormatter(
+    absl::string_view format_string);
+std::unique_ptr<TimestampFormatter> MakeDatetimeFormatter(
+    absl::string_view format_string);
+std::unique_ptr<TimestampFormatter> MakeTimeFormatter(
+    absl::string_view format_string);
+
+// Same as the functions above, but with a <formatter> returned by
+// MakeDateFormatter(), MakeDatetimeFormatter() or MakeTimeFormatter()
+// respectively.
+zetasql_base::Status FormatDateToString(const TimestampFormatter& formatter,
+                                int32_t date, std::string* out);
+zetasql_base::Status FormatDatetimeToString(const TimestampFormatter& formatter,
+                                    const DatetimeValue& datetime,
+                                    std::string* out);
+zetasql_base::Status FormatTimeToString(const TimestampFormatter& formatter,
+                                const TimeValue& time, std::string* out);
+
 // Converts the string representation of a date to a date value.
 // Supported format: "YYYY-[M]M-[D]D".
 // Returns error status if conversion fails.
@@ -866,6 +948,42 @@ zetasql_base::Status TruncateTimestamp(int64_t timestamp, TimestampScale scale,
                                absl::string_view timezone_string,
                                DateTimestampPart part, int64_t* output);
 
+// Batch versions of the functions above, for bucketing many values with the
+// same arguments.  Each one populates <output>[i] from <input>[i] (and
+// <input2>[i] for TimestampDiffBatch()) as the scalar function would, and
+// returns the error of the scalar function for the first value it fails on,
+// leaving the rest of <output> unspecified.  <output> must have the size of
+// <input>.  Timestamps are at MICROSECOND precision.
+//
+// The common cases are computed with integer arithmetic on the whole batch
+// instead of a civil time decomposition per value:
+//   - TimestampTruncBatch() to SECOND, MILLISECOND and MICROSECOND, and to
+//     DAY, HOUR and MINUTE in a fixed-offset <timezone> (UTC, '+HH:MM' time
+//     zones and named time zones without transitions),
+//   - ExtractFromTimestampBatch() of DATE, DAYOFWEEK and HOUR through
+//     NANOSECOND in a fixed-offset <timezone>,
+//   - TimestampDiffBatch() and AddTimestampBatch() at DAY through NANOSECOND,
+//   - TruncateDateBatch() to DAY, WEEK, WEEK_<WEEKDAY> and ISOWEEK.
+// The other cases call the scalar function for each value.
+zetasql_base::Status TimestampTruncBatch(absl::Span<const int64_t> input,
+                                 absl::TimeZone timezone,
+                                 DateTimestampPart part,
+                                 absl::Span<int64_t> output);
+zetasql_base::Status ExtractFromTimestampBatch(DateTimestampPart part,
+                                       absl::Span<const int64_t> input,
+                                       absl::TimeZone timezone,
+                                       absl::Span<int32_t> output);
+zetasql_base::Status TimestampDiffBatch(absl::Span<const int64_t> input,
+                                absl::Span<const int64_t> input2,
+                                DateTimestampPart part,
+                                absl::Span<int64_t> output);
+zetasql_base::Status AddTimestampBatch(absl::Span<const int64_t> input,
+                               absl::TimeZone timezone, DateTimestampPart part,
+                               int64_t interval, absl::Span<int64_t> output);
+zetasql_base::Status TruncateDateBatch(absl::Span<const int32_t> input,
+                               DateTimestampPart part,
+                               absl::Span<int32_t> output);
+
 // Returns the name of the specified <scale>.
 std::string TimestampScale_Name(TimestampScale scale);
 
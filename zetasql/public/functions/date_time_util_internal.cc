@@ -16,9 +16,15 @@
 
 #include "zetasql/public/functions/date_time_util_internal.h"
 
-#include "zetasql/base/logging.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 
+#include "zetasql/base/logging.h"
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
 #include "absl/time/civil_time.h"
+#include "absl/time/time.h"
 
 namespace zetasql {
 namespace functions {
@@ -59,6 +65,176 @@ int GetIsoWeek(absl::CivilDay day) {
   return static_cast<int>(iso_week);
 }
 
+TimeZoneCache::TimeZoneCache() {
+  for (std::atomic<const Entry*>& slot : slots_) {
+    slot.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+TimeZoneCache::~TimeZoneCache() {
+  for (std::atomic<const Entry*>& slot : slots_) {
+    delete slot.load(std::memory_order_relaxed);
+  }
+}
+
+TimeZoneCache* TimeZoneCache::Global() {
+  static TimeZoneCache* cache = new TimeZoneCache;
+  return cache;
+}
+
+bool TimeZoneCache::Lookup(absl::string_view name,
+                           absl::TimeZone* timezone) const {
+  const size_t hash = absl::Hash<absl::string_view>()(name);
+  for (int i = 0; i < kMaxProbes; ++i) {
+    const Entry* entry =
+        slots_[(hash + i) % kNumSlots].load(std::memory_order_acquire);
+    if (entry == nullptr) return false;
+    if (entry->name == name) {
+      *timezone = entry->timezone;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TimeZoneCache::Insert(absl::string_view name, absl::TimeZone timezone) {
+  const size_t hash = absl::Hash<absl::string_view>()(name);
+  auto entry =
+      absl::make_unique<const Entry>(Entry{std::string(name), timezone});
+  for (int i = 0; i < kMaxProbes; ++i) {
+    const Entry* expected = nullptr;
+    if (slots_[(hash + i) % kNumSlots].compare_exchange_strong(
+            expected, entry.get(), std::memory_order_acq_rel)) {
+      entry.release();
+      return;
+    }
+    if (expected->name == name) return;
+  }
+}
+
+namespace {
+
+const absl::CivilSecond kEpochSecond = absl::CivilSecond(1970, 1, 1, 0, 0, 0);
+
+// CivilInfoAt() only reuses offsets within this range, so that the offset
+// arithmetic cannot overflow. It is far wider than the range of valid
+// timestamps.
+const absl::Time kMinWindowTime = absl::FromUnixSeconds(-(int64_t{1} << 40));
+const absl::Time kMaxWindowTime = absl::FromUnixSeconds(int64_t{1} << 40);
+
+// Returns kEpochSecond + seconds. Computes the date with the constant-time
+// algorithm from http://howardhinnant.github.io/date_algorithms.html
+// (civil_from_days), which is considerably faster than civil time arithmetic.
+absl::CivilSecond CivilSecondFromUnixSeconds(int64_t seconds) {
+  constexpr int64_t kSecondsPerDay = 24 * 60 * 60;
+  int64_t days = seconds / kSecondsPerDay;
+  int64_t second_of_day = seconds % kSecondsPerDay;
+  if (second_of_day < 0) {
+    second_of_day += kSecondsPerDay;
+    --days;
+  }
+  // Shift the epoch to 0000-03-01, the start of a 400-year era that begins
+  // right after a leap day.
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const int64_t day_of_era = days - era * 146097;  // [0, 146096]
+  const int64_t year_of_era =
+      (day_of_era - day_of_era / 1460 + day_of_era / 36524 -
+       day_of_era / 146096) /
+      365;  // [0, 399]
+  const int64_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  const int64_t shifted_month = (5 * day_of_year + 2) / 153;  // [0, 11]
+  const int day = static_cast<int>(day_of_year - (153 * shifted_month + 2) / 5 +
+                                   1);  // [1, 31]
+  const int month = static_cast<int>(
+      shifted_month < 10 ? shifted_month + 3 : shifted_month - 9);  // [1, 12]
+  const int64_t year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+  return absl::CivilSecond(year, month, day,
+                           static_cast<int>(second_of_day / 3600),
+                           static_cast<int>(second_of_day / 60 % 60),
+                           static_cast<int>(second_of_day % 60));
+}
+
+// An interval of times in which a time zone has the same UTC offset,
+// abbreviation and DST flag.
+struct OffsetWindow {
+  absl::TimeZone timezone;
+  // Empty until the first call on a thread.
+  absl::Time begin = absl::InfiniteFuture();
+  absl::Time end = absl::InfinitePast();
+  int offset = 0;
+  bool is_dst = false;
+  const char* zone_abbr = nullptr;
+};
+
+// Sets *window to the interval around 'time' in which 'timezone' has the offset
+// in 'info', or leaves it unchanged if the interval cannot be determined.
+void UpdateOffsetWindow(absl::TimeZone timezone, absl::Time time,
+                        const absl::TimeZone::CivilInfo& info,
+                        OffsetWindow* window) {
+  // Transitions happen at whole seconds, so the latest transition before
+  // 'time' plus a second is the last one at or before 'time'.
+  absl::Time begin = kMinWindowTime;
+  absl::Time end = kMaxWindowTime;
+  absl::TimeZone::CivilTransition transition;
+  const bool has_prev =
+      timezone.PrevTransition(time + absl::Seconds(1), &transition);
+  if (has_prev) {
+    // 'to' is a civil time in the offset that starts at the transition.
+    begin = std::max(begin, absl::FromUnixSeconds(
+                                (transition.to - kEpochSecond) - info.offset));
+  }
+  if (timezone.NextTransition(time, &transition)) {
+    // 'from' is a civil time in the offset that ends at the transition.
+    end = std::min(end, absl::FromUnixSeconds(
+                            (transition.from - kEpochSecond) - info.offset));
+  } else if (has_prev) {
+    // Transitions are only enumerated up to some point in the future, after
+    // which At() still applies the zone's rules.
+    return;
+  }
+  if (begin > time || time >= end) return;
+  window->timezone = timezone;
+  window->begin = begin;
+  window->end = end;
+  window->offset = info.offset;
+  window->is_dst = info.is_dst;
+  window->zone_abbr = info.zone_abbr;
+}
+
+}  // namespace
+
+absl::TimeZone::CivilInfo CivilInfoAt(absl::TimeZone timezone,
+                                      absl::Time time) {
+  static thread_local OffsetWindow window;
+  if (timezone != window.timezone || time < window.begin ||
+      time >= window.end) {
+    const absl::TimeZone::CivilInfo info = timezone.At(time);
+    if (time >= kMinWindowTime && time < kMaxWindowTime) {
+      UpdateOffsetWindow(timezone, time, info, &window);
+    }
+    return info;
+  }
+  const int64_t seconds = absl::ToUnixSeconds(time);
+  absl::TimeZone::CivilInfo info;
+  info.cs = CivilSecondFromUnixSeconds(seconds + window.offset);
+  info.subsecond = time - absl::FromUnixSeconds(seconds);
+  info.offset = window.offset;
+  info.is_dst = window.is_dst;
+  info.zone_abbr = window.zone_abbr;
+  return info;
+}
+
+bool GetFixedUtcOffset(absl::TimeZone timezone, int* offset) {
+  absl::TimeZone::CivilTransition transition;
+  if (timezone.NextTransition(absl::InfinitePast(), &transition)) {
+    return false;
+  }
+  *offset = timezone.At(absl::UnixEpoch()).offset;
+  return true;
+}
+
 }  // namespace date_time_util_internal
 }  // namespace functions
 }  // namespace zetasql
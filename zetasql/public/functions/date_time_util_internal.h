@@ -17,7 +17,12 @@
 #ifndef ZETASQL_PUBLIC_FUNCTIONS_DATE_TIME_UTIL_INTERNAL_H_
 #define ZETASQL_PUBLIC_FUNCTIONS_DATE_TIME_UTIL_INTERNAL_H_
 
+#include <atomic>
+#include <string>
+
+#include "absl/strings/string_view.h"
 #include "absl/time/civil_time.h"
+#include "absl/time/time.h"
 
 namespace zetasql {
 namespace functions {
@@ -74,6 +79,53 @@ absl::civil_year_t GetIsoYear(absl::CivilDay day);
 // inclusive.
 int GetIsoWeek(absl::CivilDay day);
 
+// A cache of time zones by name, for MakeTimeZone(). Queries use a handful of
+// time zone names for billions of rows, so a fixed-size open-addressing table
+// whose entries are immutable and never removed suffices. Lookups and inserts
+// do not lock; concurrent inserts of the same name keep one of the entries.
+class TimeZoneCache {
+ public:
+  TimeZoneCache();
+  TimeZoneCache(const TimeZoneCache&) = delete;
+  TimeZoneCache& operator=(const TimeZoneCache&) = delete;
+  ~TimeZoneCache();
+
+  // Returns the process-wide cache.
+  static TimeZoneCache* Global();
+
+  // Sets *timezone to the time zone cached for 'name' and returns true, or
+  // returns false if 'name' is not cached.
+  bool Lookup(absl::string_view name, absl::TimeZone* timezone) const;
+
+  // Caches 'timezone' for 'name'. Does nothing if 'name' is already cached or
+  // if there is no room left for it.
+  void Insert(absl::string_view name, absl::TimeZone timezone);
+
+ private:
+  struct Entry {
+    std::string name;
+    absl::TimeZone timezone;
+  };
+
+  static constexpr int kNumSlots = 256;
+  // The number of slots Lookup() and Insert() examine, starting at the one
+  // that 'name' hashes to.
+  static constexpr int kMaxProbes = 8;
+
+  std::atomic<const Entry*> slots_[kNumSlots];
+};
+
+// Returns timezone.At(time). Consecutive calls on the same thread for times
+// between the same two UTC offset transitions of the same time zone (e.g.
+// timestamps in the same DST interval) reuse the offset found by the first of
+// them instead of looking it up again.
+absl::TimeZone::CivilInfo CivilInfoAt(absl::TimeZone timezone, absl::Time time);
+
+// Returns true and sets *offset to the UTC offset of 'timezone' in seconds if
+// the offset never changes, e.g. for UTC and the '+HH:MM' time zones, or
+// returns false if 'timezone' has transitions.
+bool GetFixedUtcOffset(absl::TimeZone timezone, int* offset);
+
 }  // namespace date_time_util_internal
 }  // namespace functions
 }  // namespace zetasql
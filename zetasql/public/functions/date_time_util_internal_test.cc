@@ -19,6 +19,7 @@
 #include "gtest/gtest.h"
 #include "absl/strings/str_cat.h"
 #include "absl/time/civil_time.h"
+#include "absl/time/time.h"
 
 namespace zetasql {
 namespace functions {
@@ -109,6 +110,72 @@ TEST_P(IsoWeekTest, ISOWeekNumberTest) {
 INSTANTIATE_TEST_SUITE_P(IsoWeekTests, IsoWeekTest,
                          ::testing::ValuesIn(kIsoWeekTestCases));
 
+TEST(TimeZoneCacheTest, LookupAndInsert) {
+  TimeZoneCache cache;
+  absl::TimeZone timezone;
+  EXPECT_FALSE(cache.Lookup("UTC", &timezone));
+  cache.Insert("UTC", absl::UTCTimeZone());
+  cache.Insert("+01", absl::FixedTimeZone(3600));
+  // Inserting a cached name again keeps the first time zone.
+  cache.Insert("+01", absl::FixedTimeZone(7200));
+  ASSERT_TRUE(cache.Lookup("UTC", &timezone));
+  EXPECT_EQ(absl::UTCTimeZone(), timezone);
+  ASSERT_TRUE(cache.Lookup("+01", &timezone));
+  EXPECT_EQ(absl::FixedTimeZone(3600), timezone);
+  EXPECT_FALSE(cache.Lookup("+02", &timezone));
+
+  // Once the table is full, new names are not cached but lookups still work.
+  for (int i = 0; i < 1000; ++i) {
+    cache.Insert(absl::StrCat("name", i), absl::FixedTimeZone(i));
+  }
+  ASSERT_TRUE(cache.Lookup("name0", &timezone));
+  EXPECT_EQ(absl::FixedTimeZone(0), timezone);
+  ASSERT_TRUE(cache.Lookup("+01", &timezone));
+  EXPECT_EQ(absl::FixedTimeZone(3600), timezone);
+}
+
+static void ExpectSameCivilInfo(absl::TimeZone timezone, absl::Time time) {
+  const absl::TimeZone::CivilInfo expected = timezone.At(time);
+  const absl::TimeZone::CivilInfo actual = CivilInfoAt(timezone, time);
+  EXPECT_EQ(expected.cs, actual.cs) << timezone << " " << time;
+  EXPECT_EQ(expected.subsecond, actual.subsecond) << timezone << " " << time;
+  EXPECT_EQ(expected.offset, actual.offset) << timezone << " " << time;
+  EXPECT_EQ(expected.is_dst, actual.is_dst) << timezone << " " << time;
+  EXPECT_STREQ(expected.zone_abbr, actual.zone_abbr)
+      << timezone << " " << time;
+}
+
+TEST(CivilInfoAtTest, SameAsTimeZoneAt) {
+  absl::TimeZone los_angeles;
+  ASSERT_TRUE(absl::LoadTimeZone("America/Los_Angeles", &los_angeles));
+  const absl::Time spring_forward =
+      absl::FromCivil(absl::CivilSecond(2019, 3, 10, 10, 0, 0),
+                      absl::UTCTimeZone());
+  const absl::Time fall_back = absl::FromCivil(
+      absl::CivilSecond(2019, 11, 3, 9, 0, 0), absl::UTCTimeZone());
+  for (const absl::TimeZone timezone :
+       {los_angeles, absl::UTCTimeZone(), absl::FixedTimeZone(-3600 * 5 - 1)}) {
+    // Timestamps around the transitions, in increasing order and in a
+    // different order, and with subseconds.
+    for (const absl::Time transition : {spring_forward, fall_back}) {
+      for (int i = -3; i <= 3; ++i) {
+        ExpectSameCivilInfo(timezone, transition + absl::Seconds(i));
+        ExpectSameCivilInfo(timezone, transition + absl::Milliseconds(400 * i));
+      }
+      for (int i = 3; i >= -3; --i) {
+        ExpectSameCivilInfo(timezone, transition + absl::Hours(i));
+      }
+    }
+    ExpectSameCivilInfo(timezone, absl::FromUnixSeconds(-62135596800));
+    ExpectSameCivilInfo(timezone, absl::FromUnixSeconds(253402300799));
+    ExpectSameCivilInfo(timezone, absl::FromUnixMicros(-1));
+    ExpectSameCivilInfo(timezone, absl::UnixEpoch());
+  }
+  // Before the first transition, the zone has local mean time.
+  ExpectSameCivilInfo(los_angeles, absl::FromUnixSeconds(-5000000000));
+  ExpectSameCivilInfo(los_angeles, absl::FromUnixSeconds(-5000000001));
+}
+
 }  // namespace date_time_util_internal
 }  // namespace functions
 }  // namespace zetasql
@@ -0,0 +1,328 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/functions/date_time_util.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/type.h"
+#include "gtest/gtest.h"
+#include "absl/time/civil_time.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+namespace functions {
+namespace {
+
+// Returns what FormatTimestampToString() produced before TimestampFormatter,
+// by expanding %Q and %Z and passing the rest to absl::FormatTime().
+static std::string FormatWithAbsl(const std::string& format_string,
+                                  absl::Time timestamp,
+                                  absl::TimeZone timezone,
+                                  bool expand_quarter) {
+  const int offset = timezone.At(timestamp).offset;
+  if (offset % 60 != 0) {
+    timezone = absl::FixedTimeZone(offset - offset % 60);
+  }
+  std::string expanded;
+  ZETASQL_CHECK_OK(internal_functions::ExpandPercentZQ(
+      format_string, timestamp, timezone, expand_quarter, &expanded));
+  return absl::FormatTime(expanded, timestamp, timezone);
+}
+
+TEST(TimestampFormatterTest, SameAsAbslFormatTime) {
+  const std::vector<std::string> format_strings = {
+      "", "abc", "%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%E*S%Ez",
+      "%E4Y-%m-%d %H:%M:%E6S%Ez", "%E0S %E3S %E9S %E10S", "%F %T %z %Z %Q",
+      "%a %b %e %I:%M %p %j %U %y", "%A, %B %d, %Y %c", "%% %%Y %Q%Z %",
+      "%E1Q %EZ %Ey", "%OH:%OM", "%G-%V-%u %s"};
+  absl::TimeZone los_angeles;
+  ASSERT_TRUE(absl::LoadTimeZone("America/Los_Angeles", &los_angeles));
+  absl::TimeZone kathmandu;
+  ASSERT_TRUE(absl::LoadTimeZone("Asia/Kathmandu", &kathmandu));
+  const std::vector<absl::TimeZone> timezones = {
+      absl::UTCTimeZone(), los_angeles, kathmandu,
+      absl::FixedTimeZone(-(5 * 3600 + 30 * 60 + 17))};
+  const std::vector<absl::Time> timestamps = {
+      absl::FromCivil(absl::CivilSecond(1, 1, 1, 0, 0, 0),
+                      absl::UTCTimeZone()),
+      // Los Angeles had a sub-minute offset, -07:52:58, in 1850.
+      absl::FromCivil(absl::CivilSecond(1850, 7, 4, 12, 30, 45), los_angeles),
+      absl::FromUnixMicros(0),
+      absl::FromUnixMicros(1234567890123456),
+      absl::FromUnixNanos(1572757200000000001),
+      absl::FromCivil(absl::CivilSecond(9999, 12, 31, 23, 59, 59),
+                      absl::UTCTimeZone()) -
+          absl::Hours(15) + absl::Nanoseconds(999999990)};
+  for (const std::string& format_string : format_strings) {
+    for (bool expand_quarter : {true, false}) {
+      const TimestampFormatter formatter(format_string, expand_quarter);
+      for (const absl::TimeZone timezone : timezones) {
+        for (const absl::Time timestamp : timestamps) {
+          const std::string expected = FormatWithAbsl(
+              format_string, timestamp, timezone, expand_quarter);
+          std::string output;
+          ZETASQL_ASSERT_OK(formatter.Format(timestamp, timezone, &output));
+          EXPECT_EQ(expected, output)
+              << "format: " << format_string << "\ntimezone: "
+              << timezone.name() << "\ntimestamp: " << timestamp;
+          ZETASQL_ASSERT_OK(FormatTimestampToString(format_string, timestamp,
+                                            timezone, expand_quarter,
+                                            &output));
+          EXPECT_EQ(expected, output);
+        }
+      }
+    }
+  }
+}
+
+TEST(TimestampFormatterTest, InvalidTimestamp) {
+  const TimestampFormatter formatter("%Y", /*expand_quarter=*/true);
+  std::string output;
+  EXPECT_FALSE(formatter
+                   .Format(absl::FromUnixSeconds(-62135596801),
+                           absl::UTCTimeZone(), &output)
+                   .ok());
+  EXPECT_FALSE(
+      formatter.Format(absl::InfiniteFuture(), absl::UTCTimeZone(), &output)
+          .ok());
+}
+
+TEST(TimestampFormatterTest, DateDatetimeAndTimeFormatters) {
+  const std::vector<std::string> format_strings = {
+      "", "%Y-%m-%d %H:%M:%E*S %Z %z", "%F %T %Q", "%E4Y %E3S %Ez %OH",
+      "%%H %c %x %X", "%A %j %I %p"};
+  const int32_t date = 18000;  // 2019-04-14
+  const DatetimeValue datetime =
+      DatetimeValue::FromYMDHMSAndNanos(2019, 4, 13, 1, 2, 3, 450000000);
+  const TimeValue time = TimeValue::FromHMSAndNanos(23, 59, 58, 1000);
+  for (const std::string& format_string : format_strings) {
+    std::string expected;
+    std::string output;
+    ZETASQL_ASSERT_OK(FormatDateToString(format_string, date, &expected));
+    ZETASQL_ASSERT_OK(
+        FormatDateToString(*MakeDateFormatter(format_string), date, &output));
+    EXPECT_EQ(expected, output) << format_string;
+
+    ZETASQL_ASSERT_OK(FormatDatetimeToString(format_string, datetime, &expected));
+    ZETASQL_ASSERT_OK(FormatDatetimeToString(*MakeDatetimeFormatter(format_string),
+                                     datetime, &output));
+    EXPECT_EQ(expected, output) << format_string;
+
+    ZETASQL_ASSERT_OK(FormatTimeToString(format_string, time, &expected));
+    ZETASQL_ASSERT_OK(
+        FormatTimeToString(*MakeTimeFormatter(format_string), time, &output));
+    EXPECT_EQ(expected, output) << format_string;
+  }
+
+  std::string output;
+  ZETASQL_ASSERT_OK(
+      FormatDateToString(*MakeDateFormatter("%F %H"), date, &output));
+  EXPECT_EQ("2019-04-14 %H", output);
+  ZETASQL_ASSERT_OK(FormatTimeToString(*MakeTimeFormatter("%Y %T"), time, &output));
+  EXPECT_EQ("%Y 23:59:58", output);
+  ZETASQL_ASSERT_OK(FormatDatetimeToString(*MakeDatetimeFormatter("%F %T %Z"),
+                                   datetime, &output));
+  EXPECT_EQ("2019-04-13 01:02:03 %Z", output);
+
+  EXPECT_FALSE(
+      FormatDateToString(*MakeDateFormatter("%F"), 3000000, &output).ok());
+}
+
+TEST(DateTimestampBatchTest, SameAsScalarFunctions) {
+  absl::TimeZone los_angeles;
+  ASSERT_TRUE(absl::LoadTimeZone("America/Los_Angeles", &los_angeles));
+  const std::vector<absl::TimeZone> timezones = {
+      absl::UTCTimeZone(), los_angeles, absl::FixedTimeZone(5 * 3600 + 1800),
+      absl::FixedTimeZone(-14 * 3600)};
+  std::vector<int64_t> timestamps = {
+      types::kTimestampMin, types::kTimestampMax, 0, -1, 1, 1000000,
+      -86400000001};
+  constexpr int64_t kStep = 12345678901234567;
+  for (int64_t t = types::kTimestampMin + kStep; t < types::kTimestampMax;
+       t += kStep) {
+    timestamps.push_back(t);
+  }
+  std::vector<int64_t> timestamps2 = timestamps;
+  std::reverse(timestamps2.begin(), timestamps2.end());
+  const int n = timestamps.size();
+
+  for (const absl::TimeZone& timezone : timezones) {
+    for (DateTimestampPart part :
+         {YEAR, MONTH, DAY, HOUR, MINUTE, SECOND, MILLISECOND, MICROSECOND}) {
+      std::vector<int64_t> output(n);
+      for (int i = 0; i < n; ++i) {
+        // Fails for a local day out of range, as the scalar function does.
+        int64_t expected;
+        const zetasql_base::Status status =
+            TimestampTrunc(timestamps[i], timezone, part, &expected);
+        const absl::Span<int64_t> output_i = absl::MakeSpan(&output[i], 1);
+        ASSERT_EQ(TimestampTruncBatch({timestamps[i]}, timezone, part,
+                                      output_i),
+                  status);
+        if (status.ok()) EXPECT_EQ(output[i], expected) << timestamps[i];
+      }
+      ZETASQL_ASSERT_OK(TimestampTruncBatch(
+          absl::MakeSpan(timestamps).subspan(2), timezone, part,
+          absl::MakeSpan(output).subspan(2)));
+    }
+    for (DateTimestampPart part :
+         {YEAR, DAYOFWEEK, HOUR, MINUTE, SECOND, MILLISECOND, MICROSECOND,
+          NANOSECOND}) {
+      std::vector<int32_t> output(n);
+      ZETASQL_ASSERT_OK(ExtractFromTimestampBatch(part, timestamps, timezone,
+                                          absl::MakeSpan(output)));
+      for (int i = 0; i < n; ++i) {
+        int32_t expected;
+        ZETASQL_ASSERT_OK(ExtractFromTimestamp(part, timestamps[i], kMicroseconds,
+                                       timezone, &expected));
+        EXPECT_EQ(output[i], expected) << timestamps[i] << " " << part;
+      }
+    }
+  }
+
+  for (DateTimestampPart part :
+       {DAY, HOUR, MINUTE, SECOND, MILLISECOND, MICROSECOND, NANOSECOND}) {
+    std::vector<int64_t> output(n);
+    if (part == NANOSECOND) {
+      // The difference between the extreme timestamps overflows.
+      EXPECT_FALSE(TimestampDiffBatch(timestamps, timestamps2, part,
+                                      absl::MakeSpan(output))
+                       .ok());
+      continue;
+    }
+    ZETASQL_ASSERT_OK(TimestampDiffBatch(timestamps, timestamps2, part,
+                                 absl::MakeSpan(output)));
+    for (int i = 0; i < n; ++i) {
+      int64_t expected;
+      ZETASQL_ASSERT_OK(TimestampDiff(timestamps[i], timestamps2[i], kMicroseconds,
+                              part, &expected));
+      EXPECT_EQ(output[i], expected) << timestamps[i] << " " << part;
+    }
+  }
+
+  // Adding to the maximum timestamp fails as the scalar function does.
+  std::vector<int64_t> output(n);
+  EXPECT_EQ(AddTimestampBatch(timestamps, absl::UTCTimeZone(), HOUR, 1,
+                              absl::MakeSpan(output)),
+            AddTimestamp(types::kTimestampMax, kMicroseconds,
+                         absl::UTCTimeZone(), HOUR, 1, &output[0]));
+  std::vector<int64_t> small_timestamps = {0, -1, 1234567890123456};
+  output.resize(small_timestamps.size());
+  ZETASQL_ASSERT_OK(AddTimestampBatch(small_timestamps, absl::UTCTimeZone(),
+                              NANOSECOND, -12345, absl::MakeSpan(output)));
+  for (int i = 0; i < small_timestamps.size(); ++i) {
+    EXPECT_EQ(output[i], small_timestamps[i] - 12);
+  }
+
+  const int32_t date_min = types::kDateMin;
+  const int32_t date_max = types::kDateMax;
+  const std::vector<int32_t> dates = {date_min + 6, date_max, 0,    -1,
+                                      17000,        17001,    17002, 17003};
+  for (DateTimestampPart part : {YEAR, MONTH, DAY, WEEK, ISOWEEK, WEEK_MONDAY,
+                                 WEEK_FRIDAY, WEEK_SATURDAY}) {
+    std::vector<int32_t> output(dates.size());
+    ZETASQL_ASSERT_OK(TruncateDateBatch(dates, part, absl::MakeSpan(output)));
+    for (int i = 0; i < dates.size(); ++i) {
+      int32_t expected;
+      ZETASQL_ASSERT_OK(TruncateDate(dates[i], part, &expected));
+      EXPECT_EQ(output[i], expected) << dates[i] << " " << part;
+    }
+  }
+  // 0001-01-01 is a Monday, so the week that starts on Sunday is out of range.
+  std::vector<int32_t> date_output(1);
+  EXPECT_FALSE(TruncateDateBatch({date_min}, WEEK,
+                                 absl::MakeSpan(date_output))
+                   .ok());
+}
+
+TEST(ConvertStringToTimestampTest, CanonicalFormSameAsGeneralForm) {
+  // Each canonical string, which takes the fast path, and an equivalent
+  // string in a form that only the general path parses.
+  const std::vector<std::pair<std::string, std::string>> equivalent_strings = {
+      {"2026-10-14", "2026-10-14 00:00:00"},
+      {"2026-10-14 01:02:03", "2026-10-14 1:2:3"},
+      {"2026-10-14T01:02:03.456", "2026-10-14 1:02:03.456000"},
+      {"2026-10-14t01:02:03.123456", "2026-10-14 01:02:03.123456 UTC"},
+      {"2026-10-14 01:02:03Z", "2026-10-14 01:02:03+0"},
+      {"2026-10-14 01:02:03z", "2026-10-14 01:02:03 UTC+00:00"},
+      {"2026-10-14 01:02:03 UTC", "2026-10-14 01:02:03+00"},
+      {"2026-10-14 01:02:03+05:30", "2026-10-14 1:02:03+5:30"},
+      {"2026-10-14 01:02:03-08", "2026-10-14 01:02:03-8"},
+      {"2026-10-14 01:02:03.5-14:00", "2026-10-14 1:02:03.5-14:00"},
+      {"2026-10-14 23:59:60+01", "2026-10-14 23:0:00+00"},
+      {"0001-01-01 00:00:00+00", "1-01-01 00:00:00+00"},
+      {"9999-12-31 23:59:59.999999", "9999-12-31 23:59:59.999999+00"},
+  };
+  for (const auto& strings : equivalent_strings) {
+    int64_t fast_timestamp;
+    int64_t general_timestamp;
+    ZETASQL_ASSERT_OK(ConvertStringToTimestamp(
+        strings.first, absl::UTCTimeZone(), kMicroseconds,
+        /*allow_tz_in_str=*/true, &fast_timestamp))
+        << strings.first;
+    ZETASQL_ASSERT_OK(ConvertStringToTimestamp(
+        strings.second, absl::UTCTimeZone(), kMicroseconds,
+        /*allow_tz_in_str=*/true, &general_timestamp))
+        << strings.second;
+    EXPECT_EQ(fast_timestamp, general_timestamp) << strings.first;
+  }
+
+  // Invalid strings in the canonical layout fail as before.
+  for (const std::string& str :
+       {"2026-02-30 00:00:00+00", "2026-10-14 01:02:03.1234567",
+        "2026-10-14 01:02:03+14:30", "2026-10-14T", "2026-10-14 24:00:00Z",
+        "2026-10-14 01:02:03+", "2026-10-14 01:02:03.", "0000-12-31",
+        "10000-01-01"}) {
+    int64_t timestamp;
+    EXPECT_FALSE(ConvertStringToTimestamp(str, absl::UTCTimeZone(),
+                                          kMicroseconds,
+                                          /*allow_tz_in_str=*/true, &timestamp)
+                     .ok())
+        << str;
+  }
+  int64_t timestamp;
+  EXPECT_FALSE(ConvertStringToTimestamp("2026-10-14 01:02:03Z",
+                                        absl::UTCTimeZone(), kMicroseconds,
+                                        /*allow_tz_in_str=*/false, &timestamp)
+                   .ok());
+}
+
+TEST(ConvertStringToDateTest, CanonicalFormSameAsGeneralForm) {
+  int32_t fast_date;
+  int32_t general_date;
+  ZETASQL_ASSERT_OK(ConvertStringToDate("2026-10-04", &fast_date));
+  ZETASQL_ASSERT_OK(ConvertStringToDate("2026-10-4", &general_date));
+  EXPECT_EQ(fast_date, general_date);
+  ZETASQL_ASSERT_OK(ConvertStringToDate("0001-01-01", &fast_date));
+  EXPECT_EQ(fast_date, types::kDateMin);
+  ZETASQL_ASSERT_OK(ConvertStringToDate("9999-12-31", &fast_date));
+  EXPECT_EQ(fast_date, types::kDateMax);
+  for (const std::string& str : {"2026-02-29", "0000-01-01", "2026-13-01",
+                                 "2026-1a-01"}) {
+    EXPECT_FALSE(ConvertStringToDate(str, &fast_date).ok()) << str;
+  }
+}
+
+}  // namespace
+}  // namespace functions
+}  // namespace zetasql
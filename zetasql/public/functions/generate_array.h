@@ -150,6 +150,73 @@ zetasql_base::Status inline CheckStartEndStep(absl::Time start, absl::Time end,
   return ::zetasql_base::OkStatus();
 }
 
+// Computes the elements of a generated array one at a time, from start to end
+// inclusive, so that they can be consumed without materializing the array.
+// Unlike GenerateArray(), there is no limit on the number of elements.
+//
+// Example:
+//   ArrayGenerator<ArrayGenTrait<int64_t, int64_t>> generator;
+//   ZETASQL_RETURN_IF_ERROR(generator.Init(1, 100000000, 1));
+//   int64_t value;
+//   while (generator.Next(&value)) {
+//     ...
+//   }
+template <typename T>
+class ArrayGenerator {
+ public:
+  using elem_t = typename T::elem_t;
+  using step_t = typename T::step_t;
+
+  // Returns an error if <step> is invalid for the range.
+  zetasql_base::Status Init(elem_t start, elem_t end, step_t step) {
+    const elem_t step_value = T::ExtractStep(step);
+    const elem_t zero_value = elem_t();
+    ZETASQL_RETURN_IF_ERROR(CheckStartEndStep(start, end, step_value));
+    start_ = start;
+    end_ = end;
+    step_ = step;
+    current_ = start;
+    ascending_ = start <= end;
+    num_elements_ = 0;
+    // Empty range cases.
+    done_ = (start < end && step_value < zero_value) ||
+            (start > end && step_value > zero_value);
+    // Single element case. Handles start == end == +/-inf.
+    single_element_ = start == end;
+    return ::zetasql_base::OkStatus();
+  }
+
+  // Sets <*value> to the next element and returns true, or returns false if
+  // all the elements were returned.
+  bool Next(elem_t* value) {
+    if (done_ || (ascending_ ? !(current_ <= end_) : !(current_ >= end_))) {
+      done_ = true;
+      return false;
+    }
+    *value = current_;
+    ++num_elements_;
+    if (single_element_ ||
+        !T::GenerateNextValue(start_, current_, step_, num_elements_,
+                              &current_)
+             .ok()) {
+      // An overflow can only happen here if the generated element value would
+      // have been outside the start end range anyway.
+      done_ = true;
+    }
+    return true;
+  }
+
+ private:
+  elem_t start_ = elem_t();
+  elem_t end_ = elem_t();
+  step_t step_ = step_t();
+  elem_t current_ = elem_t();
+  bool ascending_ = true;
+  bool single_element_ = false;
+  bool done_ = true;
+  size_t num_elements_ = 0;
+};
+
 template <typename T>
 zetasql_base::Status GenerateArrayHelper(typename T::elem_t start,
                                  typename T::elem_t end,
@@ -159,40 +226,16 @@ zetasql_base::Status GenerateArrayHelper(typename T::elem_t start,
   // of generated arrays.
   static constexpr int kMaxGeneratedArraySize = 16000;
 
-  const typename T::elem_t step_value = T::ExtractStep(step);
-  const typename T::elem_t zero_value = typename T::elem_t();
-
-  ZETASQL_RETURN_IF_ERROR(CheckStartEndStep(start, end, step_value));
-
-  // Empty range cases.
-  if ((start < end && step_value < zero_value) ||
-      (start > end && step_value > zero_value)) {
-    return ::zetasql_base::OkStatus();
-  }
-
-  // Single element case. Handles start == end == +/-inf.
-  if (start == end) {
-    values->emplace_back(start);
-    return ::zetasql_base::OkStatus();
-  }
-
-  // When start <= end, generate the range [start, end].
-  // When start > end, generate the range [end, start].
-  for (typename T::elem_t val = start;
-       start <= end ? (val <= end) : (val >= end);) {
+  ArrayGenerator<T> generator;
+  ZETASQL_RETURN_IF_ERROR(generator.Init(start, end, step));
+  typename T::elem_t value;
+  while (generator.Next(&value)) {
     if (values->size() >= kMaxGeneratedArraySize) {
       return ::zetasql_base::OutOfRangeErrorBuilder()
              << "Cannot generate arrays with more than "
              << kMaxGeneratedArraySize << " elements.";
     }
-    values->emplace_back(val);
-    zetasql_base::Status status =
-        T::GenerateNextValue(start, val, step, values->size(), &val);
-    if (!status.ok()) {
-      // An overflow can only happen here if the generated element value would
-      // have been outside the start end range anyway.
-      break;
-    }
+    values->emplace_back(value);
   }
   return ::zetasql_base::OkStatus();
 }
@@ -57,6 +57,53 @@ TEST(GenerateArrayTest, TooManyElementsDouble) {
   EXPECT_THAT(status, zetasql_base::testing::StatusIs(zetasql_base::OUT_OF_RANGE));
 }
 
+TEST(GenerateArrayTest, ArrayGeneratorHasNoSizeLimit) {
+  ArrayGenerator<ArrayGenTrait<int64_t, int64_t>> generator;
+  ZETASQL_ASSERT_OK(generator.Init(1, 1000000, 3));
+  int64_t value;
+  int64_t count = 0;
+  int64_t last = 0;
+  while (generator.Next(&value)) {
+    ++count;
+    last = value;
+  }
+  EXPECT_EQ(333334, count);
+  EXPECT_EQ(1000000, last);
+  EXPECT_FALSE(generator.Next(&value));
+}
+
+TEST(GenerateArrayTest, ArrayGeneratorEdgeCases) {
+  ArrayGenerator<ArrayGenTrait<double, double>> generator;
+  double value;
+  ZETASQL_ASSERT_OK(generator.Init(1, 0, -0.5));
+  std::vector<double> values;
+  while (generator.Next(&value)) values.push_back(value);
+  EXPECT_THAT(values, ::testing::ElementsAre(1, 0.5, 0));
+
+  // Empty range.
+  ZETASQL_ASSERT_OK(generator.Init(0, 1, -1));
+  EXPECT_FALSE(generator.Next(&value));
+
+  // A single infinite element.
+  const double inf = std::numeric_limits<double>::infinity();
+  ZETASQL_ASSERT_OK(generator.Init(inf, inf, 1));
+  ASSERT_TRUE(generator.Next(&value));
+  EXPECT_EQ(inf, value);
+  EXPECT_FALSE(generator.Next(&value));
+
+  EXPECT_THAT(generator.Init(0, 1, 0),
+              zetasql_base::testing::StatusIs(zetasql_base::OUT_OF_RANGE));
+
+  // Generation stops at overflow.
+  ArrayGenerator<ArrayGenTrait<int64_t, int64_t>> int_generator;
+  const int64_t max = std::numeric_limits<int64_t>::max();
+  int64_t int_value;
+  ZETASQL_ASSERT_OK(int_generator.Init(max - 1, max, 2));
+  ASSERT_TRUE(int_generator.Next(&int_value));
+  EXPECT_EQ(max - 1, int_value);
+  EXPECT_FALSE(int_generator.Next(&int_value));
+}
+
 TEST(GenerateArrayTest, ComplianceTests) {
   const std::vector<FunctionTestCall> tests = GetFunctionTestsGenerateArray();
   for (const auto& test : tests) {
@@ -46,15 +46,32 @@ class OpenSSLHasher final : public Hasher {
   }
 
   std::string Hash(absl::string_view input) final {
-    init_f(&ctx_);
     memset(digest_, 0, sizeof(digest_));
-    CHECK_EQ(update_f(&ctx_, input.data(), input.length()), 1);
-
-    CHECK_EQ(finalize_f(digest_, &ctx_), 1);
+    HashTo(input, digest_);
     return std::string(reinterpret_cast<const char*>(digest_), sizeof(digest_));
   }
 
+  int digest_size() const final { return kDigestSize; }
+
+  void HashBatch(absl::Span<const absl::string_view> inputs,
+                 std::string* digests) final {
+    digests->resize(inputs.size() * kDigestSize);
+    // Finalizes directly into 'digests' instead of going through 'digest_'.
+    unsigned char* out = reinterpret_cast<unsigned char*>(&(*digests)[0]);
+    for (const absl::string_view input : inputs) {
+      HashTo(input, out);
+      out += kDigestSize;
+    }
+  }
+
  private:
+  // Writes the hash of 'input' to the kDigestSize bytes at 'out'.
+  void HashTo(absl::string_view input, unsigned char* out) {
+    init_f(&ctx_);
+    CHECK_EQ(update_f(&ctx_, input.data(), input.length()), 1);
+    CHECK_EQ(finalize_f(out, &ctx_), 1);
+  }
+
   // Note: Neither of these values are really state of the class, rather, they
   // are used as buffers to avoid having to allocate on every call to `Hash()`.
   CtxT ctx_;
@@ -112,5 +129,14 @@ int64_t FarmFingerprint(absl::string_view input) {
   return absl::bit_cast<int64_t>(farmhash::Fingerprint64(input));
 }
 
+void FarmFingerprintBatch(absl::Span<const absl::string_view> inputs,
+                          absl::Span<int64_t> fingerprints) {
+  CHECK_EQ(inputs.size(), fingerprints.size());
+  for (int i = 0; i < inputs.size(); ++i) {
+    fingerprints[i] =
+        absl::bit_cast<int64_t>(farmhash::Fingerprint64(inputs[i]));
+  }
+}
+
 }  // namespace functions
 }  // namespace zetasql
@@ -25,6 +25,7 @@
 #include "absl/base/attributes.h"
 #include <cstdint>
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace zetasql {
 namespace functions {
@@ -47,12 +48,27 @@ class Hasher {
   // Returns the hash of the input bytes. Calling this method concurrently
   // on the same object is not thread-safe.
   ABSL_MUST_USE_RESULT virtual std::string Hash(absl::string_view input) = 0;
+
+  // Returns the size in bytes of the hashes returned by Hash().
+  virtual int digest_size() const = 0;
+
+  // Replaces the contents of 'digests' with the hashes of 'inputs', each
+  // digest_size() bytes long, concatenated in order. Produces the same hashes
+  // as calling Hash() on each input, but with a single virtual call and a
+  // single allocation for the whole batch. Not thread-safe either.
+  virtual void HashBatch(absl::Span<const absl::string_view> inputs,
+                         std::string* digests) = 0;
 };
 
 // Computes the fingerprint of the input bytes using the farmhash::Fingerprint64
 // function from the FarmHash library (https://github.com/google/farmhash).
 int64_t FarmFingerprint(absl::string_view input);
 
+// Sets each element of 'fingerprints' to the FarmFingerprint() of the
+// corresponding element of 'inputs'. Both spans must have the same size.
+void FarmFingerprintBatch(absl::Span<const absl::string_view> inputs,
+                          absl::Span<int64_t> fingerprints);
+
 }  // namespace functions
 }  // namespace zetasql
 
@@ -16,6 +16,8 @@
 
 #include "zetasql/public/functions/hash.h"
 
+#include <cstdint>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -24,6 +26,7 @@
 #include "zetasql/public/value.h"
 #include "zetasql/testing/test_function.h"
 #include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 
 namespace zetasql {
@@ -79,6 +82,28 @@ TEST(HashTest, BasicCorrectness) {
   }
 }
 
+TEST(HashTest, HashBatchMatchesHash) {
+  const std::string long_input(1000, 'x');
+  const std::vector<absl::string_view> inputs = {"abc", "", long_input, "abc",
+                                                 "123456"};
+  for (const Hasher::Algorithm algorithm :
+       {Hasher::kMd5, Hasher::kSha1, Hasher::kSha256, Hasher::kSha512}) {
+    SCOPED_TRACE(absl::Substitute("Algorithm $0", algorithm));
+    const std::unique_ptr<Hasher> hasher = Hasher::Create(algorithm);
+    const int digest_size = hasher->digest_size();
+    std::string digests = "stale contents";
+    hasher->HashBatch(inputs, &digests);
+    ASSERT_EQ(inputs.size() * digest_size, digests.size());
+    for (int i = 0; i < inputs.size(); ++i) {
+      EXPECT_EQ(hasher->Hash(inputs[i]),
+                digests.substr(i * digest_size, digest_size));
+    }
+
+    hasher->HashBatch({}, &digests);
+    EXPECT_TRUE(digests.empty());
+  }
+}
+
 TEST(HashTest, ComplianceTests) {
   std::unique_ptr<Hasher> md5 = Hasher::Create(Hasher::Algorithm::kMd5);
   std::unique_ptr<Hasher> sha1 = Hasher::Create(Hasher::Algorithm::kSha1);
@@ -143,6 +168,17 @@ TEST(FingerprintTest, ComplianceTests) {
   }
 }
 
+TEST(FingerprintTest, FarmFingerprintBatchMatchesFarmFingerprint) {
+  const std::string long_input(1000, 'x');
+  const std::vector<absl::string_view> inputs = {"abc", "", long_input,
+                                                 "0123456789abcdef0"};
+  std::vector<int64_t> fingerprints(inputs.size());
+  FarmFingerprintBatch(inputs, absl::MakeSpan(fingerprints));
+  for (int i = 0; i < inputs.size(); ++i) {
+    EXPECT_EQ(FarmFingerprint(inputs[i]), fingerprints[i]) << inputs[i];
+  }
+}
+
 }  // namespace
 }  // namespace functions
 }  // namespace zetasql
@@ -80,6 +80,26 @@ zetasql_base::Status JsonPathEvaluator::ExtractScalar(absl::string_view json,
   return ::zetasql_base::OkStatus();
 }
 
+// static
+zetasql_base::Status JsonPathEvaluator::ExtractScalars(
+    absl::string_view json,
+    absl::Span<const JsonPathEvaluator* const> evaluators,
+    std::vector<std::string>* values, std::vector<bool>* is_null) {
+  std::vector<ValidJSONPathIterator*> iterators;
+  iterators.reserve(evaluators.size());
+  for (const JsonPathEvaluator* evaluator : evaluators) {
+    iterators.push_back(evaluator->path_iterator_.get());
+  }
+  json_internal::JSONPathMultiExtractScalar scalar_parser(json, iterators);
+  scalar_parser.Extract(values, is_null);
+  if (scalar_parser.StoppedDueToStackSpace()) {
+    return MakeEvalError() << "JSON parsing failed due to deeply nested "
+                              "array/struct. Maximum nesting depth is "
+                           << JSONPathExtractor::kMaxParsingDepth;
+  }
+  return ::zetasql_base::OkStatus();
+}
+
 zetasql_base::Status JsonPathEvaluator::ExtractArray(absl::string_view json,
                                              std::vector<std::string>* value,
                                              bool* is_null) const {
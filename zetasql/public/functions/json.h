@@ -27,6 +27,7 @@
 #include "absl/memory/memory.h"
 #include "zetasql/base/status.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "zetasql/base/statusor.h"
 
 namespace zetasql {
@@ -40,6 +41,9 @@ class ValidJSONPathIterator;
 
 // Utility class for Json extraction. Optimized for reuse of a constant
 // json_path, whereas the above functions normalize json_path on every call.
+// The JSONPath is parsed once in Create(); the Extract methods only read it,
+// so they may be called concurrently, and they stop parsing 'json' as soon as
+// the value that the path refers to has been extracted.
 class JsonPathEvaluator {
  public:
   ~JsonPathEvaluator();
@@ -105,6 +109,15 @@ class JsonPathEvaluator {
   zetasql_base::Status ExtractScalar(absl::string_view json, std::string* value,
                              bool* is_null) const;
 
+  // Equivalent to calling evaluators[i]->ExtractScalar(json, &(*values)[i],
+  // &is_null_i) for each i and setting (*is_null)[i] to is_null_i, but parses
+  // 'json' once for all of the JSONPaths. This is cheaper when extracting many
+  // values from the same document.
+  static zetasql_base::Status ExtractScalars(
+      absl::string_view json,
+      absl::Span<const JsonPathEvaluator* const> evaluators,
+      std::vector<std::string>* values, std::vector<bool>* is_null);
+
   // Extracts an array from 'json' according to the JSONPath string 'json_path'
   // provided in Create(). The value in 'json' that 'json_path' refers to should
   // be an JSON array. Then the output of the function will be in the form of an
@@ -20,6 +20,7 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "zetasql/base/logging.h"
@@ -128,12 +129,12 @@ bool ValidJSONPathIterator::operator++() {
                 RE2::Consume(&text_, *kKeyLexer, &token);
     if (is_valid_) {
       ++depth_;
-      tokens_.push_back(token);
+      PushToken(std::move(token));
     } else if ((is_valid_ =
                     RE2::Consume(&text_, *esc_key_lexer_, &esc_token))) {
       ++depth_;
       RemoveBackSlashFollowedByChar(&esc_token, esc_chr_);
-      tokens_.push_back(esc_token);
+      PushToken(std::move(esc_token));
     }
   } else if (depth_ <= tokens_.size()) {
     ++depth_;
@@ -164,10 +165,17 @@ void ValidJSONPathIterator::Init() {
   if (text_ == ".") {
     absl::ConsumePrefix(&text_, ".");
   }
-  tokens_.push_back("");
+  PushToken("");
   depth_ = 1;
 }
 
+void ValidJSONPathIterator::PushToken(Token token) {
+  ParsedArrayIndex parsed;
+  parsed.valid = sscanf(token.c_str(), "%u", &parsed.index) == 1;
+  tokens_.push_back(std::move(token));
+  array_indexes_.push_back(parsed);
+}
+
 }  // namespace json_internal
 }  // namespace functions
 }  // namespace zetasql
@@ -23,6 +23,7 @@
 #include <memory>
 #include <stack>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "zetasql/base/logging.h"
@@ -34,6 +35,7 @@
 #include "zetasql/base/status.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "re2/re2.h"
 #include "zetasql/base/statusor.h"
 
@@ -99,11 +101,30 @@ class ValidJSONPathIterator {
     return text_.empty() && depth_ == tokens_.size();
   }
 
+  // Returns whether the current token is an array index, i.e. whether
+  // sscanf(token, "%u") succeeds, and sets *index to the parsed value if so.
+  // Tokens are parsed once when they are scanned, not on every lookup.
+  // Precondition: End() is false.
+  inline bool ArrayIndex(unsigned int* index) const {
+    DCHECK(depth_ > 0 && depth_ <= tokens_.size());
+    const ParsedArrayIndex& parsed = array_indexes_[depth_ - 1];
+    *index = parsed.index;
+    return parsed.valid;
+  }
+
  private:
+  struct ParsedArrayIndex {
+    bool valid = false;
+    unsigned int index = 0;
+  };
+
   ValidJSONPathIterator(absl::string_view input, bool sql_standard_mode);
 
   void Init();
 
+  // Appends 'token' to 'tokens_' and its array index to 'array_indexes_'.
+  void PushToken(Token token);
+
   bool sql_standard_mode_ = false;
   const RE2* offset_lexer_ = nullptr;   // NOT OWNED
   const RE2* esc_key_lexer_ = nullptr;  // NOT OWNED
@@ -111,6 +132,8 @@ class ValidJSONPathIterator {
   absl::string_view text_;
   bool is_valid_ = false;
   std::vector<Token> tokens_;
+  // Same size as 'tokens_'.
+  std::vector<ParsedArrayIndex> array_indexes_;
   size_t depth_ = 0;
 };
 
@@ -155,7 +178,7 @@ class JSONPathExtractor : public zetasql::JSONParser {
     // Parse-failed OR no-match-found OR null-Value
     *is_null = !parse_success || !stop_on_first_match_ || parsed_null_result_;
     if (parse_success) {
-      result->assign(result_json_);
+      *result = std::move(result_json_);
     }
     return parse_success;
   }
@@ -191,11 +214,7 @@ class JSONPathExtractor : public zetasql::JSONParser {
 
     // Stack Usage Invariant: !accept_ && match_
     if (!accept_ && extend_match_) {
-      const std::string& token = *path_iterator_;
-      // TODO: we can save more runtime by doing a sscanf in each
-      // record. The tokens in the path iterator can store the index value
-      // instead of doing sscanf in every record scan.
-      has_index_token_ = (sscanf(token.c_str(), "%u", &index_token_) == 1);
+      has_index_token_ = path_iterator_.ArrayIndex(&index_token_);
       stack_.push(0);
     }
 
@@ -395,15 +414,20 @@ class JSONPathExtractScalar final : public JSONPathExtractor {
       : JSONPathExtractor(json, iter) {}
 
   bool Extract(std::string* result, bool* is_null) {
-    bool parse_success =
-        zetasql::JSONParser::Parse() || accept_ || stop_on_first_match_;
+    return ExtractResult(zetasql::JSONParser::Parse(), result, is_null);
+  }
+
+  // Returns the result of Extract() when JSONParser::Parse() returned
+  // 'parsed'. Used when another parser forwards its events to this one.
+  bool ExtractResult(bool parsed, std::string* result, bool* is_null) {
+    bool parse_success = parsed || accept_ || stop_on_first_match_;
 
     // Parse-failed  OR Subtree-Node OR null-Value OR no-match-found
     *is_null = !parse_success || accept_ || parsed_null_result_ ||
                !stop_on_first_match_;
 
     if (!(*is_null)) {
-      result->assign(result_json_);
+      *result = std::move(result_json_);
     }
     return parse_success;
   }
@@ -429,6 +453,130 @@ class JSONPathExtractScalar final : public JSONPathExtractor {
     }
     return !stop_on_first_match_;
   }
+
+ private:
+  friend class JSONPathMultiExtractScalar;
+};
+
+// Runs a JSONPathExtractScalar for each of several JSONPaths in a single pass
+// over the same JSON document, by forwarding every parser event to the
+// extractors that have not finished yet. Each extractor sees exactly the events
+// it would have seen when parsing on its own, so the results are the same as
+// those of separate JSONPathExtractScalar::Extract() calls. Parsing stops as
+// soon as all extractors have finished.
+class JSONPathMultiExtractScalar final : public zetasql::JSONParser {
+ public:
+  // The iterators in `iters` and the object underlying `json` must outlive
+  // this object.
+  JSONPathMultiExtractScalar(absl::string_view json,
+                             absl::Span<ValidJSONPathIterator* const> iters)
+      : zetasql::JSONParser(json),
+        results_(iters.size()),
+        is_null_(iters.size(), true) {
+    extractors_.reserve(iters.size());
+    active_.reserve(iters.size());
+    for (int i = 0; i < iters.size(); ++i) {
+      extractors_.push_back(
+          absl::make_unique<JSONPathExtractScalar>(json, iters[i]));
+      active_.push_back(i);
+    }
+  }
+
+  // Sets (*results)[i] and (*is_null)[i] as JSONPathExtractScalar::Extract()
+  // would for the i-th path.
+  void Extract(std::vector<std::string>* results, std::vector<bool>* is_null) {
+    const bool parsed = zetasql::JSONParser::Parse();
+    for (int i : active_) {
+      Finish(i, parsed);
+    }
+    active_.clear();
+    *results = std::move(results_);
+    *is_null = std::move(is_null_);
+  }
+
+  // Returns whether parsing failed for any of the paths due to running out
+  // of stack space.
+  bool StoppedDueToStackSpace() const {
+    for (const auto& extractor : extractors_) {
+      if (extractor->StoppedDueToStackSpace()) return true;
+    }
+    return false;
+  }
+
+ protected:
+  bool BeginObject() override {
+    return Forward([](JSONPathExtractScalar* e) { return e->BeginObject(); });
+  }
+  bool EndObject() override {
+    return Forward([](JSONPathExtractScalar* e) { return e->EndObject(); });
+  }
+  bool BeginMember(const std::string& key) override {
+    return Forward(
+        [&key](JSONPathExtractScalar* e) { return e->BeginMember(key); });
+  }
+  bool EndMember(bool last) override {
+    return Forward(
+        [last](JSONPathExtractScalar* e) { return e->EndMember(last); });
+  }
+  bool BeginArray() override {
+    return Forward([](JSONPathExtractScalar* e) { return e->BeginArray(); });
+  }
+  bool EndArray() override {
+    return Forward([](JSONPathExtractScalar* e) { return e->EndArray(); });
+  }
+  bool BeginArrayEntry() override {
+    return Forward(
+        [](JSONPathExtractScalar* e) { return e->BeginArrayEntry(); });
+  }
+  bool EndArrayEntry(bool last) override {
+    return Forward(
+        [last](JSONPathExtractScalar* e) { return e->EndArrayEntry(last); });
+  }
+  bool ParsedString(const std::string& str) override {
+    return Forward(
+        [&str](JSONPathExtractScalar* e) { return e->ParsedString(str); });
+  }
+  bool ParsedNumber(absl::string_view str) override {
+    return Forward(
+        [str](JSONPathExtractScalar* e) { return e->ParsedNumber(str); });
+  }
+  bool ParsedBool(bool val) override {
+    return Forward(
+        [val](JSONPathExtractScalar* e) { return e->ParsedBool(val); });
+  }
+  bool ParsedNull() override {
+    return Forward([](JSONPathExtractScalar* e) { return e->ParsedNull(); });
+  }
+
+ private:
+  // Calls 'event' on each active extractor. An extractor that returns false
+  // would have stopped parsing, so it is finished and no longer active.
+  // Returns false once no extractor is active.
+  template <typename Event>
+  bool Forward(const Event& event) {
+    int num_active = 0;
+    for (int i : active_) {
+      if (event(extractors_[i].get())) {
+        active_[num_active++] = i;
+      } else {
+        Finish(i, /*parsed=*/false);
+      }
+    }
+    active_.resize(num_active);
+    return !active_.empty();
+  }
+
+  void Finish(int i, bool parsed) {
+    bool is_null;
+    extractors_[i]->ExtractResult(parsed, &results_[i], &is_null);
+    is_null_[i] = is_null;
+  }
+
+  std::vector<std::unique_ptr<JSONPathExtractScalar>> extractors_;
+  // Indexes into 'extractors_' of the extractors that have not finished.
+  std::vector<int> active_;
+  std::vector<std::string> results_;
+  std::vector<bool> is_null_;
 };
 
 // A JSONPath extractor that extracts array referred to by JSONPath. Similar to
@@ -449,7 +597,7 @@ class JSONPathArrayExtractor final : public JSONPathExtractor {
     *is_null = !parse_success || !stop_on_first_match_ || parsed_null_result_ ||
                !array_accepted_;
     if (parse_success) {
-      result->assign(result_array_.begin(), result_array_.end());
+      *result = std::move(result_array_);
     }
     return parse_success;
   }
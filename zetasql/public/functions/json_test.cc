@@ -26,6 +26,7 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -77,6 +78,37 @@ TEST(JsonTest, JsonExtract) {
   }
 }
 
+TEST(JsonTest, JsonPathEvaluatorReuse) {
+  // One evaluator gives the same results for many documents as a new one for
+  // each, and can be shared by multiple threads.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const std::unique_ptr<JsonPathEvaluator> evaluator,
+                       JsonPathEvaluator::Create(
+                           "$.a[1].b", /*sql_standard_mode=*/false));
+  const std::vector<std::pair<std::string, std::string>> jsons_and_values = {
+      {R"({"a": [0, {"b": "foo"}]})", R"("foo")"},
+      {R"({"a": [{"b": 1}, {"b": [1, 2]}]})", "[1,2]"},
+      {R"({"a": [{"b": 1}]})", ""},
+      {R"({"a": {"1": {"b": 1}}})", ""}};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&evaluator, &jsons_and_values]() {
+      for (int j = 0; j < 100; ++j) {
+        for (const auto& json_and_value : jsons_and_values) {
+          std::string value;
+          bool is_null;
+          ZETASQL_EXPECT_OK(evaluator->Extract(json_and_value.first, &value,
+                                       &is_null));
+          EXPECT_EQ(json_and_value.second, value) << json_and_value.first;
+          EXPECT_EQ(json_and_value.second.empty(), is_null);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
 TEST(JsonTest, JsonExtractScalar) {
   const std::string json = R"({"a": {"b": [ { "c" : "foo" } ] } })";
   const std::vector<std::pair<std::string, std::string>> inputs_and_outputs = {
@@ -104,6 +136,58 @@ TEST(JsonTest, JsonExtractScalar) {
   }
 }
 
+TEST(JsonTest, JsonExtractScalars) {
+  const std::vector<std::string> paths = {
+      "$",        "$.a",    "$.b",    "$.b[0]", "$.b[1]", "$.b[2]",
+      "$.b[3]",   "$.c",    "$.c.d",  "$.c.e",  "$.a",    "$['c']['d']",
+      "$.x.y[0]", "$.b[0]", "$.c.f"};
+  std::vector<std::unique_ptr<JsonPathEvaluator>> owned_evaluators;
+  std::vector<const JsonPathEvaluator*> evaluators;
+  for (const std::string& path : paths) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<JsonPathEvaluator> evaluator,
+        JsonPathEvaluator::Create(path, /*sql_standard_mode=*/false));
+    evaluators.push_back(evaluator.get());
+    owned_evaluators.push_back(std::move(evaluator));
+  }
+  const std::vector<std::string> jsons = {
+      R"({"a": 1, "b": [true, null, "x"], "c": {"d": 2.5, "e": "\n"}})",
+      R"({"c": {"e": "y", "d": 3}, "b": [false], "a": "z"})",
+      // Malformed after some of the values.
+      R"({"a": -1, "b": [0, 1})",
+      R"({"c": {"d": 7,)",
+      R"([1, 2, 3])",
+      "null",
+      "",
+      absl::StrCat(R"({"a": 1, "c": )", std::string(2000, '['))};
+  for (const std::string& json : jsons) {
+    SCOPED_TRACE(json);
+    std::vector<std::string> values;
+    std::vector<bool> is_null;
+    const zetasql_base::Status status =
+        JsonPathEvaluator::ExtractScalars(json, evaluators, &values, &is_null);
+    ASSERT_EQ(values.size(), paths.size());
+    ASSERT_EQ(is_null.size(), paths.size());
+    bool any_error = false;
+    for (int i = 0; i < paths.size(); ++i) {
+      SCOPED_TRACE(paths[i]);
+      std::string expected_value;
+      bool expected_is_null;
+      const zetasql_base::Status expected_status = evaluators[i]->ExtractScalar(
+          json, &expected_value, &expected_is_null);
+      if (!expected_status.ok()) {
+        any_error = true;
+        continue;
+      }
+      EXPECT_EQ(expected_is_null, is_null[i]);
+      if (!expected_is_null) {
+        EXPECT_EQ(expected_value, values[i]);
+      }
+    }
+    EXPECT_EQ(any_error, !status.ok()) << status;
+  }
+}
+
 void ExpectExtractScalar(absl::string_view json, absl::string_view path,
                          absl::string_view expected) {
   SCOPED_TRACE(absl::Substitute("JSON_EXTRACT_SCALAR('$0', '$1')", json, path));
@@ -309,6 +393,26 @@ TEST(JsonPathExtractorTest, BackAndForthIteration) {
   EXPECT_EQ(*itr, "b");
 }
 
+TEST(JsonPathExtractorTest, ArrayIndexTokens) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ValidJSONPathIterator> iptr,
+      ValidJSONPathIterator::Create("$[0].a[12]", /*sql_standard_mode=*/false));
+  ValidJSONPathIterator& itr = *(iptr.get());
+  itr.Scan();
+  itr.Rewind();
+
+  std::vector<std::pair<bool, unsigned int>> indexes;
+  for (; !itr.End(); ++itr) {
+    unsigned int index = 0;
+    const bool is_index = itr.ArrayIndex(&index);
+    indexes.emplace_back(is_index, is_index ? index : 0);
+  }
+  EXPECT_THAT(indexes,
+              ::testing::ElementsAre(
+                  std::make_pair(false, 0u), std::make_pair(true, 0u),
+                  std::make_pair(false, 0u), std::make_pair(true, 12u)));
+}
+
 TEST(JsonPathExtractorTest, EscapedPathTokens) {
   std::string esc_text("$.a['\\'\\'\\s '].g[1]");
   ZETASQL_ASSERT_OK_AND_ASSIGN(
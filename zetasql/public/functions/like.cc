@@ -18,11 +18,15 @@
 
 #include <stddef.h>
 #include <string>
+#include <utility>
 
 #include "zetasql/base/logging.h"
+#include "zetasql/common/utf_util.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/match.h"
 #include "re2/re2.h"
 #include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
 
 namespace zetasql {
 namespace functions {
@@ -49,10 +53,10 @@ static bool IsRegexSpecialChar(char c) {
   }
 }
 
-zetasql_base::Status CreateLikeRegexpWithOptions(absl::string_view pattern,
-                                         const RE2::Options& options,
-                                         std::unique_ptr<RE2>* regexp) {
-  std::string re_pattern;
+// Translates the LIKE 'pattern' into an RE2 pattern for RE2::FullMatch().
+static zetasql_base::Status LikePatternToRegexp(absl::string_view pattern,
+                                        std::string* out) {
+  std::string& re_pattern = *out;
   size_t size = pattern.size();
   for (size_t i = 0; i < size; ++i) {
     // We scan the pattern and add it to re_pattern char by char. This
@@ -87,9 +91,31 @@ zetasql_base::Status CreateLikeRegexpWithOptions(absl::string_view pattern,
     }
   }
 
+  return ::zetasql_base::OkStatus();
+}
+
+// Returns the error for a LIKE 'regexp' that failed to compile.
+static zetasql_base::Status LikeRegexpError(const RE2& regexp) {
+  return zetasql_base::Status(zetasql_base::StatusCode::kOutOfRange, regexp.error());
+}
+
+static RE2::Options LikeRegexpOptions(TypeKind type) {
+  DCHECK(type == TYPE_STRING || type == TYPE_BYTES);
+  RE2::Options options;
+  options.set_utf8(type == TYPE_STRING);
+  options.set_dot_nl(true);
+  return options;
+}
+
+zetasql_base::Status CreateLikeRegexpWithOptions(absl::string_view pattern,
+                                         const RE2::Options& options,
+                                         std::unique_ptr<RE2>* regexp) {
+  std::string re_pattern;
+  ZETASQL_RETURN_IF_ERROR(LikePatternToRegexp(pattern, &re_pattern));
   *regexp = absl::make_unique<RE2>(re_pattern, options);
+  RegExpCompilationsCounter().Increment();
   if (!(*regexp)->ok()) {
-    zetasql_base::Status error(zetasql_base::StatusCode::kOutOfRange, (*regexp)->error());
+    zetasql_base::Status error = LikeRegexpError(**regexp);
     regexp->reset();
     return error;
   }
@@ -99,11 +125,95 @@ zetasql_base::Status CreateLikeRegexpWithOptions(absl::string_view pattern,
 
 zetasql_base::Status CreateLikeRegexp(absl::string_view pattern, TypeKind type,
                               std::unique_ptr<RE2>* regexp) {
-  DCHECK(type == TYPE_STRING || type == TYPE_BYTES);
-  RE2::Options options;
-  options.set_utf8(type == TYPE_STRING);
-  options.set_dot_nl(true);
-  return CreateLikeRegexpWithOptions(pattern, options, regexp);
+  return CreateLikeRegexpWithOptions(pattern, LikeRegexpOptions(type), regexp);
+}
+
+zetasql_base::Status CreateLikeRegexp(absl::string_view pattern, TypeKind type,
+                              RegExpCache* cache,
+                              std::shared_ptr<const RE2>* regexp) {
+  std::string re_pattern;
+  ZETASQL_RETURN_IF_ERROR(LikePatternToRegexp(pattern, &re_pattern));
+  std::shared_ptr<const RE2> compiled =
+      cache->GetOrCompile(re_pattern, LikeRegexpOptions(type));
+  if (!compiled->ok()) {
+    return LikeRegexpError(*compiled);
+  }
+  *regexp = std::move(compiled);
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::StatusOr<std::unique_ptr<LikeMatcher>> LikeMatcher::Create(
+    absl::string_view pattern, TypeKind type, RegExpCache* cache) {
+  auto matcher = absl::WrapUnique(new LikeMatcher());
+
+  // Check whether the pattern is a literal between optional runs of '%'.
+  std::string& literal = matcher->literal_;
+  bool leading_percent = false;
+  bool trailing_percent = false;
+  bool simple = true;
+  size_t i = 0;
+  for (; i < pattern.size() && pattern[i] == '%'; ++i) {
+    leading_percent = true;
+  }
+  for (; simple && i < pattern.size(); ++i) {
+    const char c = pattern[i];
+    if (c == '%') {
+      trailing_percent = true;
+    } else if (c == '_' || trailing_percent) {
+      simple = false;
+    } else if (c == '\\') {
+      if (i + 1 >= pattern.size()) {
+        return zetasql_base::Status(zetasql_base::StatusCode::kOutOfRange,
+                            "LIKE pattern ends with a backslash");
+      }
+      literal.push_back(pattern[++i]);
+    } else {
+      literal.push_back(c);
+    }
+  }
+  // A literal that is not well-formed UTF-8 is an error for TYPE_STRING,
+  // which the regexp reports.
+  if (simple && (type == TYPE_BYTES || IsWellFormedUTF8(literal))) {
+    if (leading_percent) {
+      matcher->kind_ = trailing_percent ? Kind::kContains : Kind::kEndsWith;
+    } else {
+      matcher->kind_ = trailing_percent ? Kind::kStartsWith : Kind::kEquals;
+    }
+    matcher->check_utf8_ = type == TYPE_STRING &&
+                           (leading_percent || trailing_percent);
+    return matcher;
+  }
+
+  literal.clear();
+  matcher->kind_ = Kind::kRegexp;
+  if (cache != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(
+        CreateLikeRegexp(pattern, type, cache, &matcher->regexp_));
+  } else {
+    std::unique_ptr<RE2> regexp;
+    ZETASQL_RETURN_IF_ERROR(CreateLikeRegexp(pattern, type, &regexp));
+    matcher->regexp_ = std::move(regexp);
+  }
+  return matcher;
+}
+
+bool LikeMatcher::Match(absl::string_view text) const {
+  switch (kind_) {
+    case Kind::kEquals:
+      return text == literal_;
+    case Kind::kStartsWith:
+      if (!absl::StartsWith(text, literal_)) return false;
+      break;
+    case Kind::kEndsWith:
+      if (!absl::EndsWith(text, literal_)) return false;
+      break;
+    case Kind::kContains:
+      if (!absl::StrContains(text, literal_)) return false;
+      break;
+    case Kind::kRegexp:
+      return RE2::FullMatch(text, *regexp_);
+  }
+  return !check_utf8_ || IsWellFormedUTF8(text);
 }
 
 }  // namespace functions
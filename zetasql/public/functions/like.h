@@ -18,12 +18,15 @@
 #define ZETASQL_PUBLIC_FUNCTIONS_LIKE_H_
 
 #include <memory>
+#include <string>
 
 #include "zetasql/public/type.pb.h"
 #include "absl/base/attributes.h"
 #include "absl/strings/string_view.h"
+#include "zetasql/public/functions/regexp_cache.h"
 #include "re2/re2.h"
 #include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
 
 namespace zetasql {
 namespace functions {
@@ -42,6 +45,45 @@ ABSL_MUST_USE_RESULT zetasql_base::Status CreateLikeRegexpWithOptions(
     absl::string_view pattern, const RE2::Options& options,
     std::unique_ptr<RE2>* regexp);
 
+// Same as CreateLikeRegexp(), but looks up the compiled regexp in 'cache'
+// first. Meant for patterns that are not constant.
+ABSL_MUST_USE_RESULT zetasql_base::Status CreateLikeRegexp(
+    absl::string_view pattern, TypeKind type, RegExpCache* cache,
+    std::shared_ptr<const RE2>* regexp);
+
+// Computes the LIKE function for a given pattern. Patterns that consist of a
+// literal optionally preceded and/or followed by '%' (e.g. 'abc', 'abc%',
+// '%abc' and '%abc%'), which are by far the most common, are matched with
+// string comparisons. Other patterns are matched with RE2::FullMatch() and the
+// regexp of CreateLikeRegexp(). Both give the same results.
+class LikeMatcher {
+ public:
+  // Creates a matcher for 'pattern'. 'type' must be either TYPE_STRING or
+  // TYPE_BYTES. If 'cache' is not NULL, a regexp that is needed is looked up
+  // in it.
+  static zetasql_base::StatusOr<std::unique_ptr<LikeMatcher>> Create(
+      absl::string_view pattern, TypeKind type, RegExpCache* cache = nullptr);
+
+  LikeMatcher(const LikeMatcher&) = delete;
+  LikeMatcher& operator=(const LikeMatcher&) = delete;
+
+  // Returns true if 'text' matches the pattern.
+  bool Match(absl::string_view text) const;
+
+ private:
+  enum class Kind { kEquals, kStartsWith, kEndsWith, kContains, kRegexp };
+
+  LikeMatcher() = default;
+
+  Kind kind_ = Kind::kRegexp;
+  // For all kinds but kRegexp, the unescaped literal of the pattern.
+  std::string literal_;
+  // With TYPE_STRING, '%' only matches well-formed UTF-8, as in the regexp.
+  bool check_utf8_ = false;
+  // Set for kRegexp.
+  std::shared_ptr<const RE2> regexp_;
+};
+
 }  // namespace functions
 }  // namespace zetasql
 
@@ -16,8 +16,12 @@
 
 #include "zetasql/public/functions/like.h"
 
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "zetasql/base/testing/status_matchers.h"
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/substitute.h"
 #include "re2/re2.h"
@@ -26,6 +30,8 @@
 namespace zetasql {
 namespace functions {
 
+using ::zetasql_base::testing::StatusIs;
+
 struct LikeMatchTestParams {
   const char *pattern;
   const char *input;
@@ -118,6 +124,40 @@ TEST_P(LikeMatchTest, MatchTest) {
   ASSERT_EQ(params.expected_outcome, RE2::FullMatch(params.input, *re));
 }
 
+TEST_P(LikeMatchTest, LikeMatcherTest) {
+  const LikeMatchTestParams& params = GetParam();
+  SCOPED_TRACE(absl::Substitute("Matching pattern \"$0\" with string \"$1\"",
+                                params.pattern, params.input));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<LikeMatcher> matcher,
+                       LikeMatcher::Create(params.pattern, params.type));
+  EXPECT_EQ(params.expected_outcome, matcher->Match(params.input));
+}
+
+// Compares LikeMatcher with the regexp on patterns that it matches without
+// RE2, and on similar patterns that it does not.
+TEST(LikeTest, LikeMatcherAgreesWithRegexp) {
+  const std::vector<std::string> patterns = {
+      "", "abc", "abc%", "%abc", "%abc%", "%%ab%%", "%", "a\\%", "%a\\_",
+      "\\%a%", "ф%", "%ф", "a%c", "%a%c", "a_%", "a%\\c"};
+  const std::vector<std::string> inputs = {
+      "", "a", "ab", "abc", "xabc", "abcx", "xabcx", "a%", "xa_", "%a", "%ab",
+      "ac", "abbc", "ф", "фф", "abc\xC2", "\xC2abc", "ф\xC2", "\xC2ф",
+      "a\nc"};
+  for (const std::string& pattern : patterns) {
+    for (TypeKind type : {TYPE_STRING, TYPE_BYTES}) {
+      std::unique_ptr<RE2> re;
+      ZETASQL_ASSERT_OK(CreateLikeRegexp(pattern, type, &re));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<LikeMatcher> matcher,
+                           LikeMatcher::Create(pattern, type));
+      for (const std::string& input : inputs) {
+        EXPECT_EQ(RE2::FullMatch(input, *re), matcher->Match(input))
+            << "pattern: " << pattern << " input: " << input
+            << " type: " << TypeKind_Name(type);
+      }
+    }
+  }
+}
+
 TEST(LikeTest, BadPatternUTF8) {
   std::unique_ptr<RE2> re;
   zetasql_base::Status status = CreateLikeRegexp("\xC2", TYPE_STRING, &re);
@@ -126,6 +166,16 @@ TEST(LikeTest, BadPatternUTF8) {
   EXPECT_EQ(zetasql_base::StatusCode::kOutOfRange, status.code());
 }
 
+TEST(LikeTest, LikeMatcherBadPatterns) {
+  EXPECT_THAT(LikeMatcher::Create("\xC2", TYPE_STRING),
+              StatusIs(zetasql_base::StatusCode::kOutOfRange));
+  EXPECT_THAT(LikeMatcher::Create("ab\\", TYPE_STRING),
+              StatusIs(zetasql_base::StatusCode::kOutOfRange));
+  EXPECT_THAT(LikeMatcher::Create("%a_\\", TYPE_BYTES),
+              StatusIs(zetasql_base::StatusCode::kOutOfRange));
+  ZETASQL_EXPECT_OK(LikeMatcher::Create("\xC2%", TYPE_BYTES).status());
+}
+
 TEST(LikeTest, BadPatternEscape) {
   std::unique_ptr<RE2> re;
   zetasql_base::Status status = CreateLikeRegexp("\\", TYPE_STRING, &re);
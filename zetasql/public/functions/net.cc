@@ -0,0 +1,434 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/functions/net.h"
+
+#include <string.h>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/functions/util.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+
+namespace zetasql {
+namespace functions {
+
+namespace {
+
+constexpr int kIPv6NumWords = kIPv6AddressLength / 2;
+
+// Parses the dotted IPv4 address in <str> into <out>. Each part must have
+// 1 to 3 digits without leading zeros. Returns success or failure.
+bool ParseIPv4(absl::string_view str, char out[kIPv4AddressLength]) {
+  int idx = 0;
+  const int size = str.size();
+  for (int part = 0; part < kIPv4AddressLength; ++part) {
+    if (part > 0) {
+      if (idx >= size || str[idx] != '.') return false;
+      ++idx;
+    }
+    const int start = idx;
+    int value = 0;
+    while (idx < size && idx - start < 3 && absl::ascii_isdigit(str[idx])) {
+      value = value * 10 + (str[idx] - '0');
+      ++idx;
+    }
+    const int num_digits = idx - start;
+    if (num_digits == 0 || value > 255 ||
+        (num_digits > 1 && str[start] == '0')) {
+      return false;
+    }
+    out[part] = static_cast<char>(value);
+  }
+  return idx == size;
+}
+
+int HexDigitValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Parses the IPv6 address in <str> into <out>. Returns success or failure.
+bool ParseIPv6(absl::string_view str, char out[kIPv6AddressLength]) {
+  uint16_t words[kIPv6NumWords];
+  int num_words = 0;
+  // The index in 'words' of the words that "::" stands for, or -1.
+  int double_colon = -1;
+  int idx = 0;
+  const int size = str.size();
+  if (size >= 1 && str[0] == ':') {
+    if (size < 2 || str[1] != ':') return false;
+    double_colon = 0;
+    idx = 2;
+  }
+  while (idx < size) {
+    const int start = idx;
+    int value = 0;
+    int digit;
+    while (idx < size && idx - start < 5 &&
+           (digit = HexDigitValue(str[idx])) >= 0) {
+      value = value * 16 + digit;
+      ++idx;
+    }
+    if (idx < size && str[idx] == '.') {
+      // A trailing IPv4 address, which stands for the last 2 words.
+      char ipv4[kIPv4AddressLength];
+      if (num_words > kIPv6NumWords - 2 ||
+          !ParseIPv4(str.substr(start), ipv4)) {
+        return false;
+      }
+      words[num_words++] = (static_cast<uint8_t>(ipv4[0]) << 8) |
+                           static_cast<uint8_t>(ipv4[1]);
+      words[num_words++] = (static_cast<uint8_t>(ipv4[2]) << 8) |
+                           static_cast<uint8_t>(ipv4[3]);
+      break;
+    }
+    const int num_digits = idx - start;
+    if (num_digits == 0 || num_digits > 4 || num_words == kIPv6NumWords) {
+      return false;
+    }
+    words[num_words++] = value;
+    if (idx == size) break;
+    if (str[idx] != ':') return false;
+    ++idx;
+    if (idx < size && str[idx] == ':') {
+      if (double_colon >= 0) return false;
+      double_colon = num_words;
+      ++idx;
+    } else if (idx == size) {
+      // A trailing single ':'.
+      return false;
+    }
+  }
+
+  if (double_colon < 0) {
+    if (num_words != kIPv6NumWords) return false;
+  } else {
+    if (num_words == kIPv6NumWords) return false;
+    const int num_zero_words = kIPv6NumWords - num_words;
+    for (int i = num_words - 1; i >= double_colon; --i) {
+      words[i + num_zero_words] = words[i];
+    }
+    for (int i = double_colon; i < double_colon + num_zero_words; ++i) {
+      words[i] = 0;
+    }
+  }
+  for (int i = 0; i < kIPv6NumWords; ++i) {
+    out[2 * i] = static_cast<char>(words[i] >> 8);
+    out[2 * i + 1] = static_cast<char>(words[i] & 0xff);
+  }
+  return true;
+}
+
+// Writes the decimal digits of <value> (at most 255) at <out>. Returns the
+// end of the written characters.
+char* FormatByte(uint8_t value, char* out) {
+  if (value >= 100) *out++ = '0' + value / 100;
+  if (value >= 10) *out++ = '0' + value / 10 % 10;
+  *out++ = '0' + value % 10;
+  return out;
+}
+
+// Writes the dotted form of the IPv4 address <packed> at <out>. Returns the
+// end of the written characters.
+char* FormatIPv4(const char packed[kIPv4AddressLength], char* out) {
+  for (int i = 0; i < kIPv4AddressLength; ++i) {
+    if (i > 0) *out++ = '.';
+    out = FormatByte(static_cast<uint8_t>(packed[i]), out);
+  }
+  return out;
+}
+
+// Writes the lowercase hex digits of <value>, without leading zeros, at
+// <out>. Returns the end of the written characters.
+char* FormatHexWord(uint16_t value, char* out) {
+  static constexpr char kHexDigits[] = "0123456789abcdef";
+  bool started = false;
+  for (int shift = 12; shift >= 0; shift -= 4) {
+    const int digit = (value >> shift) & 0xf;
+    if (digit != 0 || started || shift == 0) {
+      *out++ = kHexDigits[digit];
+      started = true;
+    }
+  }
+  return out;
+}
+
+// Writes the RFC 5952 form of the IPv6 address <packed> at <out>. Returns
+// the end of the written characters.
+char* FormatIPv6(const char packed[kIPv6AddressLength], char* out) {
+  uint16_t words[kIPv6NumWords];
+  for (int i = 0; i < kIPv6NumWords; ++i) {
+    words[i] = (static_cast<uint8_t>(packed[2 * i]) << 8) |
+               static_cast<uint8_t>(packed[2 * i + 1]);
+  }
+  // IPv4-mapped addresses, ::ffff:0:0/96.
+  if (words[0] == 0 && words[1] == 0 && words[2] == 0 && words[3] == 0 &&
+      words[4] == 0 && words[5] == 0xffff) {
+    memcpy(out, "::ffff:", 7);
+    return FormatIPv4(packed + 12, out + 7);
+  }
+  // The first of the longest runs of at least 2 zero words is shortened to
+  // "::".
+  int best_start = -1;
+  int best_length = 1;
+  for (int i = 0; i < kIPv6NumWords;) {
+    if (words[i] != 0) {
+      ++i;
+      continue;
+    }
+    int j = i;
+    while (j < kIPv6NumWords && words[j] == 0) ++j;
+    if (j - i > best_length) {
+      best_start = i;
+      best_length = j - i;
+    }
+    i = j;
+  }
+  for (int i = 0; i < kIPv6NumWords; ++i) {
+    if (i == best_start) {
+      *out++ = ':';
+      if (i == 0) *out++ = ':';
+      i += best_length - 1;
+      continue;
+    }
+    out = FormatHexWord(words[i], out);
+    if (i < kIPv6NumWords - 1) *out++ = ':';
+  }
+  return out;
+}
+
+bool IsPackedIPAddressLength(int64_t length) {
+  return length == kIPv4AddressLength || length == kIPv6AddressLength;
+}
+
+bool IPFromStringError(absl::string_view str, zetasql_base::Status* error) {
+  return internal::UpdateError(
+      error, absl::StrCat("NET.IP_FROM_STRING() encountered an unparseable "
+                          "IP-address: ",
+                          str));
+}
+
+bool PackedIPLengthError(absl::string_view function_name, int64_t length,
+                         zetasql_base::Status* error) {
+  return internal::UpdateError(
+      error, absl::StrCat(function_name,
+                          "() encountered a non-IPv4/IPv6 input of ", length,
+                          " bytes; expected 4 or 16 bytes"));
+}
+
+bool PrefixLengthError(absl::string_view function_name, int64_t length,
+                       int64_t prefix_length_bits,
+                       zetasql_base::Status* error) {
+  return internal::UpdateError(
+      error, absl::StrCat("The prefix length of ", function_name,
+                          "() must be between 0 and ", length * 8,
+                          " for an address of ", length, " bytes; got ",
+                          prefix_length_bits));
+}
+
+// Sets <mask> to the first <prefix_length_bits> bits set, and the rest of
+// the <length> bytes cleared. <prefix_length_bits> must be valid for
+// <length>.
+void MakeNetMask(int length, int64_t prefix_length_bits, char* mask) {
+  for (int i = 0; i < length; ++i) {
+    const int64_t bits = prefix_length_bits - 8 * i;
+    if (bits >= 8) {
+      mask[i] = static_cast<char>(0xff);
+    } else if (bits <= 0) {
+      mask[i] = 0;
+    } else {
+      mask[i] = static_cast<char>(0xff << (8 - bits));
+    }
+  }
+}
+
+// Sets <out> to <packed> AND <mask>, both of <length> bytes.
+void ApplyNetMask(const char* packed, const char* mask, int length,
+                  char* out) {
+  for (int i = 0; i < length; ++i) {
+    out[i] = packed[i] & mask[i];
+  }
+}
+
+}  // namespace
+
+int ParseIPAddress(absl::string_view str, char out[kIPv6AddressLength]) {
+  if (str.find(':') != absl::string_view::npos) {
+    return ParseIPv6(str, out) ? kIPv6AddressLength : 0;
+  }
+  return ParseIPv4(str, out) ? kIPv4AddressLength : 0;
+}
+
+int FormatIPAddress(absl::string_view packed,
+                    char out[kMaxIPAddressStringLength]) {
+  if (packed.size() == kIPv4AddressLength) {
+    return FormatIPv4(packed.data(), out) - out;
+  }
+  if (packed.size() == kIPv6AddressLength) {
+    return FormatIPv6(packed.data(), out) - out;
+  }
+  return 0;
+}
+
+bool IPFromString(absl::string_view str, std::string* out,
+                  zetasql_base::Status* error) {
+  char packed[kIPv6AddressLength];
+  const int length = ParseIPAddress(str, packed);
+  if (length == 0) return IPFromStringError(str, error);
+  out->assign(packed, length);
+  return true;
+}
+
+void SafeIPFromString(absl::string_view str, std::string* out,
+                      bool* is_null) {
+  char packed[kIPv6AddressLength];
+  const int length = ParseIPAddress(str, packed);
+  *is_null = length == 0;
+  if (!*is_null) out->assign(packed, length);
+}
+
+bool IPToString(absl::string_view packed, std::string* out,
+                zetasql_base::Status* error) {
+  char str[kMaxIPAddressStringLength];
+  const int length = FormatIPAddress(packed, str);
+  if (length == 0) {
+    return PackedIPLengthError("NET.IP_TO_STRING", packed.size(), error);
+  }
+  out->assign(str, length);
+  return true;
+}
+
+bool IPNetMask(int64_t output_length_bytes, int64_t prefix_length_bits,
+               std::string* out, zetasql_base::Status* error) {
+  if (!IsPackedIPAddressLength(output_length_bytes)) {
+    return internal::UpdateError(
+        error, absl::StrCat("The first argument of NET.IP_NET_MASK() must be "
+                            "4 or 16; got ",
+                            output_length_bytes));
+  }
+  if (prefix_length_bits < 0 || prefix_length_bits > output_length_bytes * 8) {
+    return PrefixLengthError("NET.IP_NET_MASK", output_length_bytes,
+                             prefix_length_bits, error);
+  }
+  char mask[kIPv6AddressLength];
+  MakeNetMask(output_length_bytes, prefix_length_bits, mask);
+  out->assign(mask, output_length_bytes);
+  return true;
+}
+
+bool IPTrunc(absl::string_view packed, int64_t prefix_length_bits,
+             std::string* out, zetasql_base::Status* error) {
+  if (!IsPackedIPAddressLength(packed.size())) {
+    return PackedIPLengthError("NET.IP_TRUNC", packed.size(), error);
+  }
+  if (prefix_length_bits < 0 ||
+      prefix_length_bits > static_cast<int64_t>(packed.size()) * 8) {
+    return PrefixLengthError("NET.IP_TRUNC", packed.size(),
+                             prefix_length_bits, error);
+  }
+  char mask[kIPv6AddressLength];
+  char truncated[kIPv6AddressLength];
+  MakeNetMask(packed.size(), prefix_length_bits, mask);
+  ApplyNetMask(packed.data(), mask, packed.size(), truncated);
+  out->assign(truncated, packed.size());
+  return true;
+}
+
+bool IPFromStringBatch(absl::Span<const absl::string_view> input,
+                       absl::Span<PackedIPAddress> output,
+                       zetasql_base::Status* error) {
+  DCHECK_EQ(input.size(), output.size());
+  for (int i = 0; i < input.size(); ++i) {
+    output[i].length = ParseIPAddress(input[i], output[i].bytes);
+    if (output[i].length == 0) return IPFromStringError(input[i], error);
+  }
+  return true;
+}
+
+void SafeIPFromStringBatch(absl::Span<const absl::string_view> input,
+                           absl::Span<PackedIPAddress> output) {
+  DCHECK_EQ(input.size(), output.size());
+  for (int i = 0; i < input.size(); ++i) {
+    output[i].length = ParseIPAddress(input[i], output[i].bytes);
+  }
+}
+
+bool IPToStringBatch(absl::Span<const absl::string_view> input,
+                     absl::Span<std::string> output,
+                     zetasql_base::Status* error) {
+  DCHECK_EQ(input.size(), output.size());
+  char str[kMaxIPAddressStringLength];
+  for (int i = 0; i < input.size(); ++i) {
+    const int length = FormatIPAddress(input[i], str);
+    if (length == 0) {
+      return PackedIPLengthError("NET.IP_TO_STRING", input[i].size(), error);
+    }
+    output[i].assign(str, length);
+  }
+  return true;
+}
+
+bool IPTruncBatch(absl::Span<const absl::string_view> input,
+                  int64_t prefix_length_bits,
+                  absl::Span<PackedIPAddress> output,
+                  zetasql_base::Status* error) {
+  DCHECK_EQ(input.size(), output.size());
+  // The prefix length is the same for the whole batch, so it is validated
+  // once for each address length, when the first address of that length is
+  // seen.
+  char ipv4_mask[kIPv4AddressLength];
+  char ipv6_mask[kIPv6AddressLength];
+  bool has_ipv4_mask = false;
+  bool has_ipv6_mask = false;
+  for (int i = 0; i < input.size(); ++i) {
+    const absl::string_view packed = input[i];
+    const char* mask;
+    if (packed.size() == kIPv4AddressLength) {
+      if (!has_ipv4_mask) {
+        if (prefix_length_bits < 0 ||
+            prefix_length_bits > kIPv4AddressLength * 8) {
+          return PrefixLengthError("NET.IP_TRUNC", kIPv4AddressLength,
+                                   prefix_length_bits, error);
+        }
+        MakeNetMask(kIPv4AddressLength, prefix_length_bits, ipv4_mask);
+        has_ipv4_mask = true;
+      }
+      mask = ipv4_mask;
+    } else if (packed.size() == kIPv6AddressLength) {
+      if (!has_ipv6_mask) {
+        if (prefix_length_bits < 0 ||
+            prefix_length_bits > kIPv6AddressLength * 8) {
+          return PrefixLengthError("NET.IP_TRUNC", kIPv6AddressLength,
+                                   prefix_length_bits, error);
+        }
+        MakeNetMask(kIPv6AddressLength, prefix_length_bits, ipv6_mask);
+        has_ipv6_mask = true;
+      }
+      mask = ipv6_mask;
+    } else {
+      return PackedIPLengthError("NET.IP_TRUNC", packed.size(), error);
+    }
+    ApplyNetMask(packed.data(), mask, packed.size(), output[i].bytes);
+    output[i].length = packed.size();
+  }
+  return true;
+}
+
+}  // namespace functions
+}  // namespace zetasql
@@ -0,0 +1,108 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_FUNCTIONS_NET_H_
+#define ZETASQL_PUBLIC_FUNCTIONS_NET_H_
+
+#include <string>
+
+#include <cstdint>
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+namespace functions {
+
+// The lengths of the packed (BYTES) forms of IPv4 and IPv6 addresses.
+constexpr int kIPv4AddressLength = 4;
+constexpr int kIPv6AddressLength = 16;
+
+// The length of the longest string form of an address,
+// "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255".
+constexpr int kMaxIPAddressStringLength = 45;
+
+// Parses the IPv4 address ("a.b.c.d") or IPv6 address (RFC 4291, with an
+// optional trailing dotted IPv4 part) in <str> into its packed form in
+// <out>. Leading and trailing characters, including whitespace, are not
+// allowed. Returns the number of bytes written (kIPv4AddressLength or
+// kIPv6AddressLength), or 0 if <str> is not a valid address. Does not
+// allocate.
+int ParseIPAddress(absl::string_view str, char out[kIPv6AddressLength]);
+
+// Formats the packed IPv4 or IPv6 address in <packed> into <out>. IPv6
+// addresses are formatted as recommended by RFC 5952, with IPv4-mapped
+// addresses in the "::ffff:a.b.c.d" form. Returns the number of characters
+// written, or 0 if <packed> has neither of the lengths of a packed address.
+// Does not allocate.
+int FormatIPAddress(absl::string_view packed,
+                    char out[kMaxIPAddressStringLength]);
+
+// NET.IP_FROM_STRING(STRING) -> BYTES
+bool IPFromString(absl::string_view str, std::string* out,
+                  zetasql_base::Status* error);
+
+// NET.SAFE_IP_FROM_STRING(STRING) -> BYTES
+// Sets <is_null> instead of returning an error for an invalid address.
+void SafeIPFromString(absl::string_view str, std::string* out, bool* is_null);
+
+// NET.IP_TO_STRING(BYTES) -> STRING
+bool IPToString(absl::string_view packed, std::string* out,
+                zetasql_base::Status* error);
+
+// NET.IP_NET_MASK(INT64, INT64) -> BYTES
+bool IPNetMask(int64_t output_length_bytes, int64_t prefix_length_bits,
+               std::string* out, zetasql_base::Status* error);
+
+// NET.IP_TRUNC(BYTES, INT64) -> BYTES
+bool IPTrunc(absl::string_view packed, int64_t prefix_length_bits,
+             std::string* out, zetasql_base::Status* error);
+
+// A packed IPv4 or IPv6 address, stored inline so that the batch functions
+// below do not allocate per value.
+struct PackedIPAddress {
+  char bytes[kIPv6AddressLength];
+  // kIPv4AddressLength or kIPv6AddressLength, or 0 for a NULL result.
+  int length = 0;
+
+  absl::string_view view() const { return absl::string_view(bytes, length); }
+};
+
+// Batch variants of the functions above, for the evaluation of a column of
+// values. Each of them computes output[i] from input[i], and is equivalent
+// to calling the scalar function on every element, returning the error of
+// the first element that fails. <output> must have the size of <input>.
+bool IPFromStringBatch(absl::Span<const absl::string_view> input,
+                       absl::Span<PackedIPAddress> output,
+                       zetasql_base::Status* error);
+// Sets the length of the invalid addresses to 0.
+void SafeIPFromStringBatch(absl::Span<const absl::string_view> input,
+                           absl::Span<PackedIPAddress> output);
+// Reuses the capacity of the strings in <output>, and so does not allocate
+// when called repeatedly with the same <output>.
+bool IPToStringBatch(absl::Span<const absl::string_view> input,
+                     absl::Span<std::string> output,
+                     zetasql_base::Status* error);
+// Computes the masks for IPv4 and IPv6 addresses once for the batch.
+bool IPTruncBatch(absl::Span<const absl::string_view> input,
+                  int64_t prefix_length_bits,
+                  absl::Span<PackedIPAddress> output,
+                  zetasql_base::Status* error);
+
+}  // namespace functions
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_FUNCTIONS_NET_H_
@@ -0,0 +1,247 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/functions/net.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+namespace functions {
+namespace {
+
+TEST(NetTest, IPFromString) {
+  struct TestCase {
+    std::string str;
+    std::string packed;  // Empty if 'str' is invalid.
+  };
+  const std::vector<TestCase> test_cases = {
+      {"64.65.66.67", "@ABC"},
+      {"64.0.66.67", std::string("@\0BC", 4)},
+      {"0.0.0.0", std::string(4, '\0')},
+      {"255.255.255.255", std::string(4, '\xff')},
+      {"6465:6667:6869:6a6b:6c6d:6e6f:7071:7172", "defghijklmnopqqr"},
+      {"6465:6667:6869:6A6B:6C6d:6e6f:7071:7172", "defghijklmnopqqr"},
+      {"::1", std::string(15, '\0') + "\1"},
+      {"::", std::string(16, '\0')},
+      {"1::", std::string("\0\1", 2) + std::string(14, '\0')},
+      {"::ffff:64.65.66.67", std::string(10, '\0') + "\xff\xff@ABC"},
+      {"6465:6667:6869:6a6b:6c6d:FFFF:128.129.130.131",
+       "defghijklm\xff\xff\x80\x81\x82\x83"},
+      {"64:0:66::67", std::string("\0\x64\0\0\0\x66", 6) +
+                          std::string(8, '\0') + std::string("\0\x67", 2)},
+      {"64.65.66.67 ", ""},
+      {" 64.65.66.67", ""},
+      {std::string("64.65.66.67\0", 12), ""},
+      {"64.65.66", ""},
+      {"64.65.66.67.68", ""},
+      {"256.0.0.0", ""},
+      {"01.2.3.4", ""},
+      {"1..2.3", ""},
+      {" 6465:6667:6869:6a6b:6c6d:6e6f:7071:7172", ""},
+      {"6465:6667:6869:6a6b:6c6d:6e6f:7071:7172 ", ""},
+      {"6465:6667:6869:6a6b:6c6d:6e6f:7071:7172:7374", ""},
+      {"6465:6667:6869:6a6b:6c6d:6e6f:7071", ""},
+      {"6465:6667:6869:6a6b:6c6d:6e6f:7071:7172::", ""},
+      {std::string("::1\0", 4), ""},
+      {"1:::2", ""},
+      {"1::2::3", ""},
+      {":1::2", ""},
+      {"1::2:", ""},
+      {"12345::", ""},
+      {"::ffff:1.2.3", ""},
+      {"::ffff:1.2.3.4.5", ""},
+      {"::1.2.3.4:5", ""},
+      {"foo", ""},
+      {"", ""},
+  };
+  for (const TestCase& test_case : test_cases) {
+    std::string out;
+    zetasql_base::Status error;
+    bool is_null;
+    std::string safe_out;
+    SafeIPFromString(test_case.str, &safe_out, &is_null);
+    if (test_case.packed.empty()) {
+      EXPECT_FALSE(IPFromString(test_case.str, &out, &error))
+          << test_case.str;
+      EXPECT_EQ(error.code(), zetasql_base::StatusCode::kOutOfRange);
+      EXPECT_TRUE(is_null) << test_case.str;
+    } else {
+      EXPECT_TRUE(IPFromString(test_case.str, &out, &error))
+          << test_case.str << " " << error;
+      EXPECT_EQ(out, test_case.packed) << test_case.str;
+      EXPECT_FALSE(is_null) << test_case.str;
+      EXPECT_EQ(safe_out, test_case.packed) << test_case.str;
+    }
+  }
+}
+
+TEST(NetTest, IPToString) {
+  struct TestCase {
+    std::string packed;
+    std::string str;  // Empty if 'packed' is invalid.
+  };
+  const std::vector<TestCase> test_cases = {
+      {"@ABC", "64.65.66.67"},
+      {std::string("@\0BC", 4), "64.0.66.67"},
+      {std::string(4, '\xff'), "255.255.255.255"},
+      {"defghijklmnopqqr", "6465:6667:6869:6a6b:6c6d:6e6f:7071:7172"},
+      {std::string("defg\0ijklmnopqqr", 16),
+       "6465:6667:69:6a6b:6c6d:6e6f:7071:7172"},
+      {std::string(15, '\0') + "\1", "::1"},
+      {std::string(16, '\0'), "::"},
+      {std::string("\0\1", 2) + std::string(14, '\0'), "1::"},
+      {std::string(10, '\0') + "\xff\xff@ABC", "::ffff:64.65.66.67"},
+      // A single zero word is not shortened.
+      {std::string("\0\1\0\0\0\2\0\3\0\4\0\5\0\6\0\7", 16),
+       "1:0:2:3:4:5:6:7"},
+      // Of the longest runs of zero words, the first is shortened.
+      {std::string("\0\1\0\0\0\0\0\2\0\0\0\0\0\3\0\4", 16),
+       "1::2:0:0:3:4"},
+      {std::string("\0\1\0\0\0\2\0\0\0\0\0\0\0\3\0\4", 16),
+       "1:0:2::3:4"},
+      {std::string(16, '\xff'), "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"},
+      {"foo", ""},
+      {"foobar", ""},
+      {"", ""},
+  };
+  for (const TestCase& test_case : test_cases) {
+    std::string out;
+    zetasql_base::Status error;
+    if (test_case.str.empty()) {
+      EXPECT_FALSE(IPToString(test_case.packed, &out, &error))
+          << test_case.packed;
+      EXPECT_EQ(error.code(), zetasql_base::StatusCode::kOutOfRange);
+      continue;
+    }
+    ASSERT_TRUE(IPToString(test_case.packed, &out, &error)) << error;
+    EXPECT_EQ(out, test_case.str);
+    // The formatted address parses back to the same bytes.
+    std::string packed;
+    ASSERT_TRUE(IPFromString(out, &packed, &error)) << error;
+    EXPECT_EQ(packed, test_case.packed) << out;
+  }
+}
+
+TEST(NetTest, IPNetMask) {
+  std::string out;
+  zetasql_base::Status error;
+  ASSERT_TRUE(IPNetMask(4, 32, &out, &error));
+  EXPECT_EQ(out, std::string(4, '\xff'));
+  ASSERT_TRUE(IPNetMask(4, 17, &out, &error));
+  EXPECT_EQ(out, std::string("\xff\xff\x80\x00", 4));
+  ASSERT_TRUE(IPNetMask(4, 0, &out, &error));
+  EXPECT_EQ(out, std::string(4, '\0'));
+  ASSERT_TRUE(IPNetMask(16, 100, &out, &error));
+  EXPECT_EQ(out, std::string(12, '\xff') + std::string("\xf0\0\0\0", 4));
+  ASSERT_TRUE(IPNetMask(16, 128, &out, &error));
+  EXPECT_EQ(out, std::string(16, '\xff'));
+
+  for (const std::pair<int64_t, int64_t>& args :
+       std::vector<std::pair<int64_t, int64_t>>{
+           {-4, 0}, {0, 0}, {3, 0}, {4, -1}, {4, 33}, {16, -1}, {16, 129}}) {
+    zetasql_base::Status error;
+    EXPECT_FALSE(IPNetMask(args.first, args.second, &out, &error));
+    EXPECT_EQ(error.code(), zetasql_base::StatusCode::kOutOfRange);
+  }
+}
+
+TEST(NetTest, IPTrunc) {
+  std::string out;
+  zetasql_base::Status error;
+  ASSERT_TRUE(IPTrunc("\x12\x34\x56\x78", 28, &out, &error));
+  EXPECT_EQ(out, "\x12\x34\x56\x70");
+  ASSERT_TRUE(IPTrunc("\x12\x34\x56\x78", 11, &out, &error));
+  EXPECT_EQ(out, std::string("\x12\x20\0\0", 4));
+  ASSERT_TRUE(IPTrunc("defghijklmno\x76\x54\x32\x10", 100, &out, &error));
+  EXPECT_EQ(out, std::string("defghijklmno\x70\0\0\0", 16));
+  ASSERT_TRUE(IPTrunc("defghijklmnopqqr", 0, &out, &error));
+  EXPECT_EQ(out, std::string(16, '\0'));
+
+  EXPECT_FALSE(IPTrunc("", 0, &out, &error));
+  for (const int64_t prefix_length_bits : {-1, 33}) {
+    zetasql_base::Status error;
+    EXPECT_FALSE(
+        IPTrunc("\x12\x34\x56\x78", prefix_length_bits, &out, &error));
+    EXPECT_EQ(error.code(), zetasql_base::StatusCode::kOutOfRange);
+  }
+}
+
+TEST(NetTest, BatchesSameAsScalarFunctions) {
+  const std::vector<absl::string_view> strings = {
+      "64.65.66.67", "::1", "::ffff:64.65.66.67",
+      "6465:6667:6869:6a6b:6c6d:6e6f:7071:7172", "1:0:2::3:4"};
+  std::vector<PackedIPAddress> packed(strings.size());
+  zetasql_base::Status error;
+  ASSERT_TRUE(IPFromStringBatch(strings, absl::MakeSpan(packed), &error));
+  std::vector<absl::string_view> packed_views;
+  for (int i = 0; i < strings.size(); ++i) {
+    std::string expected;
+    ASSERT_TRUE(IPFromString(strings[i], &expected, &error));
+    EXPECT_EQ(packed[i].view(), expected) << strings[i];
+    packed_views.push_back(packed[i].view());
+  }
+
+  std::vector<std::string> formatted(strings.size());
+  ASSERT_TRUE(
+      IPToStringBatch(packed_views, absl::MakeSpan(formatted), &error));
+  for (int i = 0; i < strings.size(); ++i) {
+    EXPECT_EQ(formatted[i], strings[i]);
+  }
+
+  for (const int64_t prefix_length_bits : {0, 1, 20, 32}) {
+    std::vector<PackedIPAddress> truncated(strings.size());
+    ASSERT_TRUE(IPTruncBatch(packed_views, prefix_length_bits,
+                             absl::MakeSpan(truncated), &error));
+    for (int i = 0; i < strings.size(); ++i) {
+      std::string expected;
+      ASSERT_TRUE(
+          IPTrunc(packed_views[i], prefix_length_bits, &expected, &error));
+      EXPECT_EQ(truncated[i].view(), expected);
+    }
+  }
+  // The prefix length is too long for the IPv4 address only.
+  std::vector<PackedIPAddress> truncated(strings.size());
+  EXPECT_FALSE(IPTruncBatch(packed_views, 64, absl::MakeSpan(truncated),
+                            &error));
+  EXPECT_EQ(error.code(), zetasql_base::StatusCode::kOutOfRange);
+  zetasql_base::Status ipv6_error;
+  EXPECT_TRUE(IPTruncBatch(absl::MakeSpan(packed_views).subspan(1), 64,
+                           absl::MakeSpan(truncated).subspan(1), &ipv6_error));
+
+  const std::vector<absl::string_view> invalid_strings = {"::1", "foo",
+                                                          "1.2.3.4"};
+  std::vector<PackedIPAddress> safe_packed(invalid_strings.size());
+  SafeIPFromStringBatch(invalid_strings, absl::MakeSpan(safe_packed));
+  EXPECT_EQ(safe_packed[0].length, kIPv6AddressLength);
+  EXPECT_EQ(safe_packed[1].length, 0);
+  EXPECT_EQ(safe_packed[2].length, kIPv4AddressLength);
+  zetasql_base::Status invalid_error;
+  EXPECT_FALSE(IPFromStringBatch(invalid_strings, absl::MakeSpan(safe_packed),
+                                 &invalid_error));
+  EXPECT_EQ(invalid_error.code(), zetasql_base::StatusCode::kOutOfRange);
+}
+
+}  // namespace
+}  // namespace functions
+}  // namespace zetasql
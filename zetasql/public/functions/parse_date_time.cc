@@ -31,7 +31,11 @@
 #include "zetasql/public/type.h"
 #include <cstdint>
 #include "absl/base/optimization.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
 #include "absl/time/time.h"
 #include "zetasql/base/mathutil.h"
 #include "zetasql/base/ret_check.h"
@@ -218,6 +222,156 @@ static const char* ParseTM(const char* dp, const char* fmt, struct tm* tm) {
   return dp;
 }
 
+// The fields parsed from a timestamp string.
+struct ParsedTimestampFields {
+  int64_t year = 1970;
+  int month = 1;
+  int day = 1;
+  int hour = 0;
+  int minute = 0;
+  int second = 0;
+  absl::Duration subseconds;
+  int timezone_offset_minutes = 0;
+  bool saw_timezone_offset = false;
+};
+
+// Returns the timestamp for <fields>.  The fields are interpreted in
+// <timezone>, or shifted from UTC by their time zone offset if one was parsed.
+static zetasql_base::Status TimestampFromParsedFields(
+    ParsedTimestampFields fields, absl::TimeZone timezone,
+    absl::Time* timestamp) {
+  // If we saw %z or %Ez then we want to interpret the parsed fields in
+  // UTC and then shift by that offset.  Otherwise we want to interpret
+  // the fields using the default or specified time zone name.
+  if (fields.saw_timezone_offset) {
+    // We will apply the timezone_offset from UTC.
+    timezone = absl::UTCTimeZone();
+  } else {
+    ZETASQL_RET_CHECK_EQ(0, fields.timezone_offset_minutes);
+  }
+
+  // Normalizes a leap second of 60 to the following ":00.000000".
+  if (fields.second == 60) {
+    fields.second -= 1;
+    fields.subseconds = absl::Seconds(1);
+  }
+
+  const absl::TimeConversion tc =
+      ConvertDateTime(fields.year, fields.month, fields.day, fields.hour,
+                      fields.minute, fields.second, timezone);
+
+  // ParseTime() fails if any normalization was done.  That is,
+  // parsing "Sep 31" will not produce the equivalent of "Oct 1".
+  if (tc.normalized) {
+    return MakeEvalError() << "Out-of-range datetime field in parsing function";
+  }
+
+  *timestamp = tc.pre - absl::Minutes(fields.timezone_offset_minutes) +
+               fields.subseconds;
+  if (!IsValidTime(*timestamp)) {
+    return MakeEvalError() << "Invalid result from parsing function";
+  }
+
+  return ::zetasql_base::OkStatus();
+}
+
+// Parses the <num_digits> digits at the start of <str> into <value>, if they
+// are all digits and the value is in [<min>, <max>].
+static bool ParseFixedDigits(absl::string_view str, int num_digits, int min,
+                             int max, int* value) {
+  int result = 0;
+  for (int i = 0; i < num_digits; ++i) {
+    if (!absl::ascii_isdigit(str[i])) return false;
+    result = result * 10 + (str[i] - '0');
+  }
+  if (result < min || result > max) return false;
+  *value = result;
+  return true;
+}
+
+// A fast path for the most common formats, the canonical format
+// "%Y-%m-%d %H:%M:%S" and the RFC 3339 format "%Y-%m-%dT%H:%M:%E*S%Ez".
+// <format> must be "%Y-%m-%d", followed by 'T' or ' ', "%H:%M:", "%S" or
+// "%E*S", and optionally "%Ez".  If it is, and if <timestamp_string> is
+// exactly in that form (with 4 digit years, 2 digit fields and offsets as
+// 'Z' or +/-HH:MM), populates <fields> and returns true.  Otherwise returns
+// false and leaves the string to the general parser below, which produces the
+// same fields for every string accepted here.
+static bool ParseCanonicalTimestamp(absl::string_view format,
+                                    absl::string_view timestamp_string,
+                                    TimestampScale scale,
+                                    ParsedTimestampFields* fields) {
+  if (!absl::ConsumePrefix(&format, "%Y-%m-%d") || format.empty() ||
+      (format[0] != 'T' && format[0] != ' ')) {
+    return false;
+  }
+  const char separator = format[0];
+  format.remove_prefix(1);
+  if (!absl::ConsumePrefix(&format, "%H:%M:")) return false;
+  bool has_subseconds = false;
+  if (absl::ConsumePrefix(&format, "%E*S")) {
+    has_subseconds = true;
+  } else if (!absl::ConsumePrefix(&format, "%S")) {
+    return false;
+  }
+  const bool has_offset = absl::ConsumePrefix(&format, "%Ez");
+  if (!format.empty()) return false;
+
+  // YYYY-MM-DD?HH:MM:SS
+  absl::string_view str = timestamp_string;
+  if (str.size() < 19 || str[4] != '-' || str[7] != '-' ||
+      str[10] != separator || str[13] != ':' || str[16] != ':') {
+    return false;
+  }
+  int year;
+  if (!ParseFixedDigits(str, 4, 0, 9999, &year) ||
+      !ParseFixedDigits(str.substr(5), 2, 1, 12, &fields->month) ||
+      !ParseFixedDigits(str.substr(8), 2, 1, 31, &fields->day) ||
+      !ParseFixedDigits(str.substr(11), 2, 0, 23, &fields->hour) ||
+      !ParseFixedDigits(str.substr(14), 2, 0, 59, &fields->minute) ||
+      !ParseFixedDigits(str.substr(17), 2, 0, 60, &fields->second)) {
+    return false;
+  }
+  fields->year = year;
+  str.remove_prefix(19);
+
+  if (has_subseconds && !str.empty() && str[0] == '.') {
+    size_t end = 1;
+    while (end < str.size() && absl::ascii_isdigit(str[end])) ++end;
+    if (end == 1) return false;
+    // Like ParseSubSeconds(), truncates the digits beyond <scale>.
+    int64_t value = 0;
+    int num_digits = 0;
+    for (size_t i = 1; i < end && num_digits < scale; ++i, ++num_digits) {
+      value = value * 10 + (str[i] - '0');
+    }
+    value *= powers_of_ten[scale - num_digits];
+    fields->subseconds = scale == kMicroseconds ? absl::Microseconds(value)
+                                                : absl::Nanoseconds(value);
+    str.remove_prefix(end);
+  }
+
+  if (has_offset) {
+    if (absl::ConsumePrefix(&str, "Z")) {
+      fields->saw_timezone_offset = true;
+    } else {
+      int hours;
+      int minutes;
+      if (str.size() < 6 || (str[0] != '+' && str[0] != '-') ||
+          str[3] != ':' || !ParseFixedDigits(str.substr(1), 2, 0, 23, &hours) ||
+          !ParseFixedDigits(str.substr(4), 2, 0, 59, &minutes)) {
+        return false;
+      }
+      const int offset = (str[0] == '-' ? -1 : 1) * (hours * 60 + minutes);
+      if (!IsValidTimeZone(offset)) return false;
+      fields->timezone_offset_minutes = offset;
+      fields->saw_timezone_offset = true;
+      str.remove_prefix(6);
+    }
+  }
+  return str.empty();
+}
+
 // This function generally uses strptime() to handle each format element,
 // but supports additional format element extensions and a few behavior
 // deviations for ZetaSQL semantics.
@@ -276,6 +430,15 @@ static zetasql_base::Status ParseTime(absl::string_view format,
     }
   }
 
+  {
+    ParsedTimestampFields fields;
+    if (ParseCanonicalTimestamp(absl::string_view(fmt, end_of_fmt - fmt),
+                                absl::string_view(data, end_of_data - data),
+                                scale, &fields)) {
+      return TimestampFromParsedFields(fields, default_timezone, timestamp);
+    }
+  }
+
   bool twelve_hour = false;
   bool afternoon = false;
 
@@ -680,44 +843,21 @@ static zetasql_base::Status ParseTime(absl::string_view format,
     return ::zetasql_base::OkStatus();
   }
 
-  // If we saw %z or %Ez then we want to interpret the parsed fields in
-  // UTC and then shift by that offset.  Otherwise we want to interpret
-  // the fields using the default or specified time zone name.
-  if (saw_timezone_offset) {
-    // We will apply the timezone_offset from UTC.
-    timezone = absl::UTCTimeZone();
-  } else {
-    ZETASQL_RET_CHECK_EQ(0, timezone_offset_minutes);
-  }
-
-  // Normalizes a leap second of 60 to the following ":00.000000".
-  if (tm.tm_sec == 60) {
-    tm.tm_sec -= 1;
-    subseconds = absl::Seconds(1);
-  }
-
+  ParsedTimestampFields fields;
   // Overflow cannot occur since the only valid range is years 0-10000.
-  int64_t year = tm.tm_year + 1900;
+  fields.year = tm.tm_year + 1900;
   if (use_century) {
-    year += century * 100 - 1900;
-  }
-
-  const absl::TimeConversion tc =
-      ConvertDateTime(year, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min,
-                      tm.tm_sec, timezone);
-
-  // ParseTime() fails if any normalization was done.  That is,
-  // parsing "Sep 31" will not produce the equivalent of "Oct 1".
-  if (tc.normalized) {
-    return MakeEvalError() << "Out-of-range datetime field in parsing function";
+    fields.year += century * 100 - 1900;
   }
-
-  *timestamp = tc.pre - absl::Minutes(timezone_offset_minutes) + subseconds;
-  if (!IsValidTime(*timestamp)) {
-    return MakeEvalError() << "Invalid result from parsing function";
-  }
-
-  return ::zetasql_base::OkStatus();
+  fields.month = tm.tm_mon + 1;
+  fields.day = tm.tm_mday;
+  fields.hour = tm.tm_hour;
+  fields.minute = tm.tm_min;
+  fields.second = tm.tm_sec;
+  fields.subseconds = subseconds;
+  fields.timezone_offset_minutes = timezone_offset_minutes;
+  fields.saw_timezone_offset = saw_timezone_offset;
+  return TimestampFromParsedFields(fields, timezone, timestamp);
 }
 
 // Validates that <format_string> does not have any <invalid_elements>.
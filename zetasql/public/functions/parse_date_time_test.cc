@@ -853,6 +853,57 @@ TEST(StringToTimestampTests, IntermediateWhitespaceTests) {
   }
 }
 
+TEST(StringToTimestampTests, CanonicalFormatsTests) {
+  // These formats take a fast path for strings that are exactly in their
+  // form.  A leading space in the format string does not change the result,
+  // but it disables the fast path.
+  const std::vector<std::string> formats = {
+      "%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M:%E*S",
+      "%Y-%m-%dT%H:%M:%E*S%Ez", "%Y-%m-%d %H:%M:%S%Ez"};
+  const std::vector<std::string> timestamp_strings = {
+      "2020-01-02 03:04:05", "2020-01-02T03:04:05", " 2020-01-02 03:04:05",
+      "2020-01-02  03:04:05", "2020-01-02 03:04:05 ", "2020-1-02 03:04:05",
+      "20200-01-02 03:04:05", "0001-01-01 00:00:00", "0000-12-31 23:59:59",
+      "9999-12-31 23:59:59", "2020-02-30 03:04:05", "2020-13-02 03:04:05",
+      "2016-12-31 23:59:60", "2016-12-31 23:59:60.5+00:00",
+      "2020-01-02 03:04:05.123456789", "2020-01-02 03:04:05.1234567890123",
+      "2020-01-02T03:04:05.", "2020-01-02T03:04:05.5Z",
+      "2020-01-02T03:04:05Z", "2020-01-02T03:04:05+05:30",
+      "2020-01-02T03:04:05-14:00", "2020-01-02T03:04:05+14:30",
+      "2020-01-02T03:04:05+0530", "2020-01-02T03:04:05+05",
+      "2020-01-02T03:04:05.25-07:00", "2020-01-02T03:04:05-07:00x",
+      std::string("2020-01-02 03:04:05\0", 20)};
+  for (const std::string& format : formats) {
+    for (const std::string& timestamp_string : timestamp_strings) {
+      for (const std::string& timezone : {"UTC", "America/Los_Angeles"}) {
+        absl::Time expected;
+        const zetasql_base::Status expected_status = ParseStringToTimestamp(
+            absl::StrCat(" ", format), timestamp_string, timezone, &expected);
+        absl::Time timestamp;
+        const zetasql_base::Status status = ParseStringToTimestamp(
+            format, timestamp_string, timezone, &timestamp);
+        EXPECT_EQ(expected_status, status)
+            << "format: " << format << "\ntimestamp: " << timestamp_string;
+        if (expected_status.ok() && status.ok()) {
+          EXPECT_EQ(expected, timestamp)
+              << "format: " << format << "\ntimestamp: " << timestamp_string;
+        }
+        int64_t expected_micros;
+        const zetasql_base::Status expected_micros_status =
+            ParseStringToTimestamp(absl::StrCat(" ", format), timestamp_string,
+                                   timezone, &expected_micros);
+        int64_t micros;
+        EXPECT_EQ(expected_micros_status,
+                  ParseStringToTimestamp(format, timestamp_string, timezone,
+                                         &micros));
+        if (expected_micros_status.ok()) {
+          EXPECT_EQ(expected_micros, micros);
+        }
+      }
+    }
+  }
+}
+
 TEST(StringToTimestampTests,
      SecondsWithMoreThanOneDigitOfFractionalPrecisionTests) {
   // Only %E0S to %E9S is supported (0-9 subseconds digits).
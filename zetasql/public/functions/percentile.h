@@ -73,7 +73,8 @@ class PercentileEvaluator {
   //   It means [nonnull_values_begin, nonnull_values_end) is not sorted. Itr
   //   must be mutable, and this method will reorder some of the elements in
   //   this range. This method has a time complexity of O(n) where
-  //   n = nonnull_values_end - nonnull_values_begin.
+  //   n = nonnull_values_end - nonnull_values_begin; it selects the percentile
+  //   with a single std::nth_element() instead of sorting.
   // If <sorted> is true:
   //   It means [nonnull_values_begin, nonnull_values_end) is sorted in
   //   ascending order. If this range contains NaNs, NaNs must be placed in the
@@ -108,8 +109,8 @@ class PercentileEvaluator {
       *result = *Accessor::template GetNthElement<Itr>(
           nonnull_values_begin, nonnull_values_end, index, num_nans);
       if (right_weight > 0) {
-        const double right_value = *Accessor::template GetNthElement<Itr>(
-                nonnull_values_begin, nonnull_values_end, index + 1, num_nans);
+        const double right_value = *Accessor::template GetNextElement<Itr>(
+            nonnull_values_begin, nonnull_values_end, index, num_nans);
         *result = left_weight * (*result) + right_weight * right_value;
       }
     } else if (index == num_nulls - 1 && right_weight > 0) {
@@ -219,6 +220,29 @@ class PercentileEvaluator {
       }
       return itr;
     }
+
+    // Returns the element that follows the one GetNthElement() just returned
+    // for <index> in the sorted order.
+    template <typename Itr>
+    static Itr GetNextElement(
+        typename std::enable_if<sorted, Itr>::type begin, Itr end,
+        size_t index, size_t num_nans) {
+      return begin + index + 1;
+    }
+
+    template <typename Itr>
+    static Itr GetNextElement(
+        typename std::enable_if<!sorted, Itr>::type begin, Itr end,
+        size_t index, size_t num_nans) {
+      Itr itr = begin + index + 1;
+      if (index + 1 >= num_nans) {
+        // The elements after <index> are not smaller than it, or are all of
+        // the non-NaN elements, so the next element is their minimum.  This is
+        // cheaper than another std::nth_element().
+        itr = std::min_element(itr, end);
+      }
+      return itr;
+    }
   };
 
   PercentileEvaluator(double percentile, int64_t percentile_mantissa,
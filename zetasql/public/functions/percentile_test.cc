@@ -16,10 +16,12 @@
 
 #include "zetasql/public/functions/percentile.h"
 
+#include <algorithm>
 #include <cmath>
 #include <deque>
 #include <limits>
 #include <string>
+#include <vector>
 
 #include "zetasql/common/string_util.h"
 #include "zetasql/base/testing/status_matchers.h"
@@ -336,6 +338,41 @@ TEST(PercentileTest, ComputePercentileCont) {
   VerifyPercentileCont("inf", values, 0, 1);
 }
 
+TEST(PercentileTest, ComputePercentileContUnsortedMatchesSorted) {
+  // Many duplicates and NaNs, so that the two values around the percentile
+  // are often equal, or NaN and non-NaN.
+  std::vector<double> sorted_values;
+  for (int i = 0; i < 200; ++i) {
+    sorted_values.push_back(i % 7 == 0 ? kNaN : (i * 37) % 23);
+  }
+  auto itr = std::partition(sorted_values.begin(), sorted_values.end(),
+                            [](double value) { return std::isnan(value); });
+  std::sort(itr, sorted_values.end());
+  for (size_t num_nulls : {0, 1, 20}) {
+    for (int i = 0; i <= 100; ++i) {
+      const double percentile = i / 100.0 + (i < 100 ? 0.003 : 0);
+      SCOPED_TRACE(absl::StrCat("percentile=", percentile,
+                                " num_nulls=", num_nulls));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(PercentileEvaluator percentile_evalutor,
+                           PercentileEvaluator::Create(percentile));
+      double expected = -1234;
+      const bool expected_not_null =
+          percentile_evalutor.ComputePercentileCont<true>(
+              sorted_values.cbegin(), sorted_values.cend(), num_nulls,
+              &expected);
+      std::vector<double> values = sorted_values;
+      std::reverse(values.begin(), values.end());
+      std::rotate(values.begin(), values.begin() + 77, values.end());
+      double result = -1234;
+      EXPECT_EQ(expected_not_null,
+                percentile_evalutor.ComputePercentileCont<false>(
+                    values.begin(), values.end(), num_nulls, &result));
+      EXPECT_EQ(RoundTripDoubleToString(expected),
+                RoundTripDoubleToString(result));
+    }
+  }
+}
+
 constexpr size_t kNumValues = 8;
 
 static const int kShuffledIndexes[kNumValues] = {3, 4, 6, 2, 1, 7, 0, 5};
@@ -19,10 +19,10 @@
 #include <ctype.h>
 
 #include <algorithm>
+#include <memory>
 
 #include "zetasql/base/logging.h"
 #include "zetasql/public/functions/util.h"
-#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "unicode/utf8.h"
 #include "zetasql/base/status.h"
@@ -32,23 +32,35 @@ namespace functions {
 
 bool RegExp::InitializePatternUtf8(absl::string_view pattern,
                                    zetasql_base::Status* error) {
-  RE2::Options options;
-  options.set_log_errors(false);
-  options.set_utf8(true);
-  re_ = absl::make_unique<RE2>(pattern, options);
-  if (!re_->ok()) {
-    return internal::UpdateError(
-        error, absl::StrCat("Cannot parse regular expression: ", re_->error()));
-  }
-  return true;
+  return InitializePattern(pattern, /*utf8=*/true, /*cache=*/nullptr, error);
 }
 
 bool RegExp::InitializePatternBytes(absl::string_view pattern,
                                     zetasql_base::Status* error) {
+  return InitializePattern(pattern, /*utf8=*/false, /*cache=*/nullptr, error);
+}
+
+bool RegExp::InitializePatternUtf8(absl::string_view pattern,
+                                   RegExpCache* cache, zetasql_base::Status* error) {
+  return InitializePattern(pattern, /*utf8=*/true, cache, error);
+}
+
+bool RegExp::InitializePatternBytes(absl::string_view pattern,
+                                    RegExpCache* cache, zetasql_base::Status* error) {
+  return InitializePattern(pattern, /*utf8=*/false, cache, error);
+}
+
+bool RegExp::InitializePattern(absl::string_view pattern, bool utf8,
+                               RegExpCache* cache, zetasql_base::Status* error) {
   RE2::Options options;
   options.set_log_errors(false);
-  options.set_utf8(false);
-  re_ = absl::make_unique<RE2>(pattern, options);
+  options.set_utf8(utf8);
+  if (cache != nullptr) {
+    re_ = cache->GetOrCompile(pattern, options);
+  } else {
+    re_ = std::make_shared<const RE2>(pattern, options);
+    RegExpCompilationsCounter().Increment();
+  }
   if (!re_->ok()) {
     return internal::UpdateError(
         error, absl::StrCat("Cannot parse regular expression: ", re_->error()));
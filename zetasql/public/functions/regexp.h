@@ -24,6 +24,7 @@
 #include "zetasql/base/logging.h"
 #include <cstdint>
 #include "absl/strings/string_view.h"
+#include "zetasql/public/functions/regexp_cache.h"
 #include "re2/re2.h"
 #include "zetasql/base/status.h"
 
@@ -62,6 +63,13 @@ class RegExp {
   bool InitializePatternUtf8(absl::string_view pattern, zetasql_base::Status* error);
   bool InitializePatternBytes(absl::string_view pattern, zetasql_base::Status* error);
 
+  // Same as above, but look up the compiled regular expression in 'cache'
+  // first. Meant for patterns that are not constant.
+  bool InitializePatternUtf8(absl::string_view pattern, RegExpCache* cache,
+                             zetasql_base::Status* error);
+  bool InitializePatternBytes(absl::string_view pattern, RegExpCache* cache,
+                              zetasql_base::Status* error);
+
   // REGEXP_CONTAINS (substring match)
   bool Contains(absl::string_view str, bool* out, zetasql_base::Status* error);
 
@@ -126,8 +134,14 @@ class RegExp {
                const std::vector<absl::string_view>& groups, std::string* out,
                zetasql_base::Status* error);
 
+  // Sets 're_' from 'pattern' with the given encoding, using 'cache' if it is
+  // not NULL.
+  bool InitializePattern(absl::string_view pattern, bool utf8,
+                         RegExpCache* cache, zetasql_base::Status* error);
+
   // The compiled RE2 object. It is NULL if this has not been initialized yet.
-  std::unique_ptr<RE2> re_;
+  // May be shared with a RegExpCache.
+  std::shared_ptr<const RE2> re_;
   int32_t max_out_size_ = std::numeric_limits<int32_t>::max();
 
   // The following fields keep internal state of the matcher between calls of
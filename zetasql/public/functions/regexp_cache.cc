@@ -0,0 +1,121 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/functions/regexp_cache.h"
+
+#include "zetasql/base/logging.h"
+
+namespace zetasql {
+namespace functions {
+
+namespace {
+
+constexpr int kDefaultMaxEntries = 1000;
+constexpr int64_t kDefaultMaxMemoryBytes = 32 << 20;
+
+// Rough size of a compiled program instruction, including the share of the
+// DFA states that matching typically builds lazily.
+constexpr int64_t kBytesPerInstruction = 64;
+
+}  // namespace
+
+RuntimeCounter& RegExpCompilationsCounter() {
+  static RuntimeCounter* counter =
+      new RuntimeCounter("functions/regexp_compilations",
+                         "Number of compiled regular expressions");
+  return *counter;
+}
+
+RegExpCache::RegExpCache(int max_entries, int64_t max_memory_bytes)
+    : max_entries_(max_entries), max_memory_bytes_(max_memory_bytes) {}
+
+RegExpCache* RegExpCache::Default() {
+  static RegExpCache* cache =
+      new RegExpCache(kDefaultMaxEntries, kDefaultMaxMemoryBytes);
+  return cache;
+}
+
+std::shared_ptr<const RE2> RegExpCache::GetOrCompile(
+    absl::string_view pattern, const RE2::Options& options) {
+  Key key{std::string(pattern), options.ParseFlags(), options.longest_match(),
+          options.max_mem()};
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      ++stats_.hits;
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return it->second->regexp;
+    }
+    ++stats_.misses;
+  }
+
+  // Compile without holding the lock, so that a slow compilation does not
+  // block lookups of other patterns.
+  auto regexp = std::make_shared<const RE2>(pattern, options);
+  RegExpCompilationsCounter().Increment();
+  if (!regexp->ok()) return regexp;
+  const int64_t byte_size = EstimateByteSize(key, *regexp);
+  if (byte_size > max_memory_bytes_ || max_entries_ <= 0) return regexp;
+
+  absl::MutexLock lock(&mutex_);
+  auto inserted = entries_.emplace(std::move(key), lru_.end());
+  if (!inserted.second) {
+    // Another thread compiled the same pattern concurrently.
+    return inserted.first->second->regexp;
+  }
+  lru_.push_front(Entry{&inserted.first->first, regexp, byte_size});
+  inserted.first->second = lru_.begin();
+  ++stats_.num_entries;
+  stats_.memory_bytes += byte_size;
+  EvictLocked();
+  return regexp;
+}
+
+RegExpCache::Stats RegExpCache::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void RegExpCache::Clear() {
+  absl::MutexLock lock(&mutex_);
+  entries_.clear();
+  lru_.clear();
+  stats_.num_entries = 0;
+  stats_.memory_bytes = 0;
+}
+
+int64_t RegExpCache::EstimateByteSize(const Key& key, const RE2& regexp) {
+  // The pattern is stored both in the key and in the RE2 object.
+  return sizeof(Key) + sizeof(Entry) + sizeof(RE2) + 2 * key.pattern.size() +
+         kBytesPerInstruction * regexp.ProgramSize();
+}
+
+void RegExpCache::EvictLocked() {
+  while (stats_.num_entries > max_entries_ ||
+         stats_.memory_bytes > max_memory_bytes_) {
+    DCHECK(!lru_.empty());
+    const Entry& entry = lru_.back();
+    stats_.memory_bytes -= entry.byte_size;
+    --stats_.num_entries;
+    ++stats_.evictions;
+    entries_.erase(entries_.find(*entry.key));
+    lru_.pop_back();
+  }
+}
+
+}  // namespace functions
+}  // namespace zetasql
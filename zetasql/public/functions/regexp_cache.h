@@ -0,0 +1,126 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_FUNCTIONS_REGEXP_CACHE_H_
+#define ZETASQL_PUBLIC_FUNCTIONS_REGEXP_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <cstdint>
+#include "zetasql/public/runtime_metrics.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "re2/re2.h"
+
+namespace zetasql {
+namespace functions {
+
+// A bounded, thread-safe cache of compiled RE2 objects, for regular expressions
+// whose patterns are only known at evaluation time (e.g. `col LIKE other_col`,
+// or REGEXP_CONTAINS(col, @param)). Compiling an RE2 is much more expensive
+// than matching short strings with it, and such patterns usually repeat.
+//
+// Entries are keyed by the pattern and the RE2::Options that affect the
+// compiled regexp, and are evicted in least recently used order once the cache
+// holds more than 'max_entries' entries or more than 'max_memory_bytes' of
+// estimated memory. RE2 objects are immutable after construction, so the
+// returned objects can be used concurrently, and stay valid after eviction
+// until the last reference is dropped.
+class RegExpCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+    int64_t num_entries = 0;
+    // Estimated memory held by the cached entries.
+    int64_t memory_bytes = 0;
+  };
+
+  RegExpCache(int max_entries, int64_t max_memory_bytes);
+  RegExpCache(const RegExpCache&) = delete;
+  RegExpCache& operator=(const RegExpCache&) = delete;
+
+  // Returns the process-wide cache used by the reference implementation.
+  static RegExpCache* Default();
+
+  // Returns the RE2 compiled from 'pattern' with 'options', from the cache if
+  // possible. Never returns NULL. Like the RE2 constructor, returns an object
+  // with ok() == false if 'pattern' does not compile; such objects are not
+  // cached.
+  std::shared_ptr<const RE2> GetOrCompile(absl::string_view pattern,
+                                          const RE2::Options& options);
+
+  Stats GetStats() const;
+
+  // Removes all entries. Does not reset the hit/miss/eviction counters.
+  void Clear();
+
+ private:
+  struct Key {
+    std::string pattern;
+    // RE2::Options::ParseFlags() plus the options it does not cover.
+    int parse_flags;
+    bool longest_match;
+    int64_t max_mem;
+
+    bool operator==(const Key& other) const {
+      return pattern == other.pattern && parse_flags == other.parse_flags &&
+             longest_match == other.longest_match && max_mem == other.max_mem;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& key) {
+      return H::combine(std::move(h), key.pattern, key.parse_flags,
+                        key.longest_match, key.max_mem);
+    }
+  };
+
+  struct Entry {
+    const Key* key;  // Owned by 'entries_', which has stable keys.
+    std::shared_ptr<const RE2> regexp;
+    int64_t byte_size;
+  };
+  // The list front is the most recently used entry.
+  using LruList = std::list<Entry>;
+
+  // Returns an estimate of the memory held by an entry for 'regexp'.
+  static int64_t EstimateByteSize(const Key& key, const RE2& regexp);
+
+  // Evicts least recently used entries until the limits are respected.
+  void EvictLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int max_entries_;
+  const int64_t max_memory_bytes_;
+
+  mutable absl::Mutex mutex_;
+  LruList lru_ ABSL_GUARDED_BY(mutex_);
+  absl::node_hash_map<Key, LruList::iterator> entries_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Returns the RuntimeCounter of the regular expressions compiled by the
+// function library, which every place that constructs an RE2 increments.
+RuntimeCounter& RegExpCompilationsCounter();
+
+}  // namespace functions
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_FUNCTIONS_REGEXP_CACHE_H_
@@ -0,0 +1,152 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/functions/regexp_cache.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/functions/like.h"
+#include "zetasql/public/functions/regexp.h"
+#include "gtest/gtest.h"
+#include "re2/re2.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+namespace functions {
+namespace {
+
+TEST(RegExpCacheTest, HitsAndMisses) {
+  RegExpCache cache(/*max_entries=*/10, /*max_memory_bytes=*/1 << 20);
+  RE2::Options options;
+  std::shared_ptr<const RE2> a = cache.GetOrCompile("a+b", options);
+  ASSERT_TRUE(a->ok());
+  EXPECT_TRUE(RE2::FullMatch("aab", *a));
+  EXPECT_EQ(a, cache.GetOrCompile("a+b", options));
+
+  // Options that change the compiled regexp are part of the key.
+  RE2::Options case_insensitive;
+  case_insensitive.set_case_sensitive(false);
+  std::shared_ptr<const RE2> a_ci = cache.GetOrCompile("a+b", case_insensitive);
+  EXPECT_NE(a, a_ci);
+  EXPECT_TRUE(RE2::FullMatch("AAB", *a_ci));
+
+  // Invalid patterns are returned but not cached.
+  EXPECT_FALSE(cache.GetOrCompile("(", options)->ok());
+  EXPECT_FALSE(cache.GetOrCompile("(", options)->ok());
+
+  const RegExpCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(4, stats.misses);
+  EXPECT_EQ(0, stats.evictions);
+  EXPECT_EQ(2, stats.num_entries);
+  EXPECT_GT(stats.memory_bytes, 0);
+
+  cache.Clear();
+  EXPECT_EQ(0, cache.GetStats().num_entries);
+  EXPECT_EQ(0, cache.GetStats().memory_bytes);
+  // Cleared entries stay valid for their holders.
+  EXPECT_TRUE(RE2::FullMatch("ab", *a));
+  EXPECT_NE(a, cache.GetOrCompile("a+b", options));
+}
+
+TEST(RegExpCacheTest, EvictsLeastRecentlyUsed) {
+  RegExpCache cache(/*max_entries=*/2, /*max_memory_bytes=*/1 <<20);
+  RE2::Options options;
+  std::shared_ptr<const RE2> a = cache.GetOrCompile("a", options);
+  std::shared_ptr<const RE2> b = cache.GetOrCompile("b", options);
+  // Use "a", so that "b" is evicted next.
+  EXPECT_EQ(a, cache.GetOrCompile("a", options));
+  cache.GetOrCompile("c", options);
+  EXPECT_EQ(1, cache.GetStats().evictions);
+  EXPECT_EQ(2, cache.GetStats().num_entries);
+  EXPECT_EQ(a, cache.GetOrCompile("a", options));
+  EXPECT_NE(b, cache.GetOrCompile("b", options));
+}
+
+TEST(RegExpCacheTest, MemoryLimit) {
+  // Too small to hold any entry.
+  RegExpCache cache(/*max_entries=*/10, /*max_memory_bytes=*/1);
+  RE2::Options options;
+  std::shared_ptr<const RE2> a = cache.GetOrCompile("a", options);
+  EXPECT_TRUE(a->ok());
+  EXPECT_NE(a, cache.GetOrCompile("a", options));
+  EXPECT_EQ(0, cache.GetStats().num_entries);
+  EXPECT_EQ(0, cache.GetStats().memory_bytes);
+}
+
+TEST(RegExpCacheTest, ConcurrentLookups) {
+  RegExpCache cache(/*max_entries=*/4, /*max_memory_bytes=*/1 <<20);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&cache, i]() {
+      RE2::Options options;
+      for (int j = 0; j < 200; ++j) {
+        const std::string pattern = std::to_string((i + j) % 6);
+        std::shared_ptr<const RE2> regexp =
+            cache.GetOrCompile(pattern, options);
+        EXPECT_TRUE(RE2::FullMatch(pattern, *regexp));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const RegExpCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(8 * 200, stats.hits + stats.misses);
+  EXPECT_LE(stats.num_entries, 4);
+}
+
+TEST(RegExpCacheTest, Like) {
+  RegExpCache cache(/*max_entries=*/10, /*max_memory_bytes=*/1 << 20);
+  std::shared_ptr<const RE2> regexp;
+  ZETASQL_ASSERT_OK(CreateLikeRegexp("a%_", TYPE_STRING, &cache, &regexp));
+  EXPECT_TRUE(RE2::FullMatch("abc", *regexp));
+  EXPECT_FALSE(RE2::FullMatch("a", *regexp));
+  std::shared_ptr<const RE2> bytes_regexp;
+  ZETASQL_ASSERT_OK(CreateLikeRegexp("a%_", TYPE_BYTES, &cache, &bytes_regexp));
+  EXPECT_NE(regexp, bytes_regexp);
+  std::shared_ptr<const RE2> regexp2;
+  ZETASQL_ASSERT_OK(CreateLikeRegexp("a%_", TYPE_STRING, &cache, &regexp2));
+  EXPECT_EQ(regexp, regexp2);
+  EXPECT_EQ(1, cache.GetStats().hits);
+
+  EXPECT_FALSE(CreateLikeRegexp("a\\", TYPE_STRING, &cache, &regexp).ok());
+}
+
+TEST(RegExpCacheTest, RegExp) {
+  RegExpCache cache(/*max_entries=*/10, /*max_memory_bytes=*/1 << 20);
+  RegExp re;
+  zetasql_base::Status status;
+  ASSERT_TRUE(re.InitializePatternUtf8("b+", &cache, &status));
+  bool out;
+  ASSERT_TRUE(re.Contains("abbc", &out, &status));
+  EXPECT_TRUE(out);
+  ASSERT_TRUE(re.InitializePatternUtf8("b+", &cache, &status));
+  EXPECT_EQ(1, cache.GetStats().hits);
+  ASSERT_TRUE(re.InitializePatternBytes("b+", &cache, &status));
+  EXPECT_EQ(1, cache.GetStats().hits);
+
+  EXPECT_FALSE(re.InitializePatternUtf8("(", &cache, &status));
+  EXPECT_FALSE(status.ok());
+}
+
+}  // namespace
+}  // namespace functions
+}  // namespace zetasql
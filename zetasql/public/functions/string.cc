@@ -91,6 +91,21 @@ static int32_t ClampToInt32Max(int64_t i) {
              : static_cast<int32_t>(i);
 }
 
+// Sets <out> to <str> with the case of the ASCII letters in
+// [<first_letter>, <first_letter> + 26) flipped, i.e., to uppercase <str> if
+// <first_letter> is 'a' and to lowercase it if it is 'A'. This is branch-free
+// so that the compiler can vectorize it.
+static void FlipAsciiCase(absl::string_view str, char first_letter,
+                          std::string* out) {
+  out->resize(str.size());
+  char* dest = &(*out)[0];
+  for (size_t i = 0; i < str.size(); ++i) {
+    const unsigned char c = str[i];
+    const bool is_letter = static_cast<unsigned char>(c - first_letter) < 26;
+    dest[i] = static_cast<char>(c ^ (is_letter << 5));
+  }
+}
+
 static bool GlobalStringReplace(absl::string_view s, absl::string_view oldsub,
                                 absl::string_view newsub, std::string* res,
                                 zetasql_base::Status* error) {
@@ -316,17 +331,10 @@ bool LengthUtf8(absl::string_view str, int64_t* out, zetasql_base::Status* error
     return false;
   }
 
-  int utf8_length = 0;
-  int32_t offset = 0;
-  while (offset < str_length32) {
-    UChar32 character;
-    U8_NEXT(str.data(), offset, str_length32, character);
-    if (character < 0) {
-      return internal::UpdateError(error, kBadUtf8);
-    }
-    utf8_length++;
+  if (!IsWellFormedUTF8(str)) {
+    return internal::UpdateError(error, kBadUtf8);
   }
-  *out = utf8_length;
+  *out = CountUTF8CodePoints(str);
   return true;
 }
 
@@ -438,6 +446,14 @@ bool SubstrUtf8(absl::string_view str, int64_t pos, absl::string_view* out,
 static bool ForwardN(const char* str, int32_t str_length32, int64_t num_code_points,
                      int32_t* str_offset, zetasql_base::Status* error) {
   for (int64_t i = 0; i < num_code_points && *str_offset < str_length32; ++i) {
+    // ASCII characters are one byte each, so skip over runs of them at once.
+    const int32_t ascii_length = static_cast<int32_t>(SpanASCII(
+        absl::string_view(str + *str_offset,
+                          std::min<int64_t>(num_code_points - i,
+                                            str_length32 - *str_offset))));
+    *str_offset += ascii_length;
+    i += ascii_length;
+    if (i == num_code_points || *str_offset == str_length32) break;
     UChar32 character;
     U8_NEXT(str, *str_offset, str_length32, character);
     if (character < 0) {
@@ -614,6 +630,12 @@ bool UpperUtf8(absl::string_view str, std::string* out, zetasql_base::Status* er
   if (!CheckAndCastStrLength(str, &str_length32, error)) {
     return false;
   }
+  // The root locale maps ASCII letters to ASCII letters and leaves all other
+  // ASCII characters as they are, so ASCII input does not need ICU.
+  if (SpanASCII(str) == str.size()) {
+    FlipAsciiCase(str, 'a', out);
+    return true;
+  }
   out->clear();
   out->reserve(str.length());
 
@@ -638,6 +660,10 @@ bool LowerUtf8(absl::string_view str, std::string* out, zetasql_base::Status* er
   if (!CheckAndCastStrLength(str, &str_length32, error)) {
     return false;
   }
+  if (SpanASCII(str) == str.size()) {
+    FlipAsciiCase(str, 'A', out);
+    return true;
+  }
   out->clear();
   out->reserve(str.length());
 
@@ -657,18 +683,12 @@ bool LowerUtf8(absl::string_view str, std::string* out, zetasql_base::Status* er
 }
 
 bool UpperBytes(absl::string_view str, std::string* out, zetasql_base::Status* error) {
-  out->resize(str.size());
-  for (int i = 0; i < str.size(); ++i) {
-    (*out)[i] = absl::ascii_toupper(str[i]);
-  }
+  FlipAsciiCase(str, 'a', out);
   return true;
 }
 
 bool LowerBytes(absl::string_view str, std::string* out, zetasql_base::Status* error) {
-  out->resize(str.size());
-  for (int i = 0; i < str.size(); ++i) {
-    (*out)[i] = absl::ascii_tolower(str[i]);
-  }
+  FlipAsciiCase(str, 'A', out);
   return true;
 }
 
@@ -1043,8 +1063,7 @@ bool PadUtf8(absl::string_view input_str, int64_t output_size_chars,
     return internal::UpdateError(error, kBadUtf8);
   }
 
-  int64_t input_size_chars = 0;
-  LengthUtf8(input_str, &input_size_chars, error);
+  const int64_t input_size_chars = CountUTF8CodePoints(input_str);
 
   if (output_size_chars <= input_size_chars) {
     absl::string_view input_str_prefix;
@@ -1061,10 +1080,7 @@ bool PadUtf8(absl::string_view input_str, int64_t output_size_chars,
     return internal::UpdateError(error, kBadUtf8);
   }
 
-  int64_t pattern_size_chars = 1;
-  if (pattern.length() > 1) {
-    LengthUtf8(pattern, &pattern_size_chars, error);
-  }
+  const int64_t pattern_size_chars = CountUTF8CodePoints(pattern);
   auto padding_div =
       std::div(output_size_chars - input_size_chars, pattern_size_chars);
   absl::string_view pattern_prefix;
@@ -1197,6 +1213,11 @@ bool ReverseUtf8(absl::string_view input, std::string* out,
     return false;
   }
 
+  if (SpanASCII(input) == input.size()) {
+    out->assign(input.rbegin(), input.rend());
+    return true;
+  }
+
   out->clear();
   out->reserve(input.size());
 
@@ -0,0 +1,281 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "zetasql/public/functions/to_json.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+#include "zetasql/common/json_util.h"
+#include "zetasql/public/civil_time.h"
+#include "zetasql/public/numeric_value.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/civil_time.h"
+#include "absl/time/time.h"
+#include "zetasql/base/status_builder.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+namespace functions {
+namespace {
+
+// Integers in [-kMaxExactInteger, kMaxExactInteger] can be represented
+// exactly as a double, so JSON readers do not lose precision on them.
+constexpr int64_t kMaxExactInteger = int64_t{1} << 53;
+
+void AppendQuoted(absl::string_view str, std::string* output) {
+  output->push_back('"');
+  output->append(str.data(), str.size());
+  output->push_back('"');
+}
+
+void AppendNonFinite(double value, std::string* output) {
+  if (std::isnan(value)) {
+    output->append("\"NaN\"");
+  } else if (value > 0) {
+    output->append("\"Infinity\"");
+  } else {
+    output->append("\"-Infinity\"");
+  }
+}
+
+// Appends the representation of 'value' with %g and the smallest precision,
+// from 'min_precision' to 'max_precision' digits, that reads back as
+// 'value'.
+template <typename T>
+void AppendShortestFloatingPoint(T value, int min_precision,
+                                 int max_precision, std::string* output) {
+  char buffer[32];
+  for (int precision = min_precision; precision <= max_precision;
+       ++precision) {
+    absl::SNPrintF(buffer, sizeof(buffer), "%.*g", precision, value);
+    const double parsed = std::is_same<T, float>::value
+                              ? std::strtof(buffer, nullptr)
+                              : std::strtod(buffer, nullptr);
+    if (precision == max_precision || static_cast<T>(parsed) == value) {
+      break;
+    }
+  }
+  output->append(buffer);
+}
+
+template <typename T>
+void AppendInteger(T value, std::string* output) {
+  if (value > kMaxExactInteger ||
+      (std::is_signed<T>::value &&
+       static_cast<int64_t>(value) < -kMaxExactInteger)) {
+    output->push_back('"');
+    absl::StrAppend(output, value);
+    output->push_back('"');
+  } else {
+    absl::StrAppend(output, value);
+  }
+}
+
+// T is NumericValue or BigNumericValue.
+template <typename T>
+void AppendNumeric(const T& value, std::string* output) {
+  const T max_exact{NumericValue(kMaxExactInteger)};
+  const T min_exact{NumericValue(-kMaxExactInteger)};
+  const bool quoted =
+      !(value == value.Trunc(0) && min_exact <= value && value <= max_exact);
+  if (quoted) output->push_back('"');
+  value.AppendToString(output);
+  if (quoted) output->push_back('"');
+}
+
+// Appends the fraction of a second in 'nanoseconds', if any, in groups of 3
+// digits.
+void AppendFractionalSeconds(int64_t nanoseconds, std::string* output) {
+  if (nanoseconds == 0) return;
+  if (nanoseconds % 1000000 == 0) {
+    absl::StrAppendFormat(output, ".%03d", nanoseconds / 1000000);
+  } else if (nanoseconds % 1000 == 0) {
+    absl::StrAppendFormat(output, ".%06d", nanoseconds / 1000);
+  } else {
+    absl::StrAppendFormat(output, ".%09d", nanoseconds);
+  }
+}
+
+}  // namespace
+
+zetasql_base::Status JsonWriter::Append(const Value& value,
+                                std::string* output) {
+  return AppendValue(value, /*depth=*/0, output);
+}
+
+void JsonWriter::AppendNewline(int depth, std::string* output) const {
+  output->push_back('\n');
+  output->append(2 * depth, ' ');
+}
+
+const std::vector<std::string>& JsonWriter::GetFieldNames(
+    const StructType* struct_type) {
+  auto it = field_names_.find(struct_type);
+  if (it != field_names_.end()) return it->second;
+  std::vector<std::string>& names = field_names_[struct_type];
+  names.reserve(struct_type->num_fields());
+  for (const StructType::StructField& field : struct_type->fields()) {
+    std::string name;
+    JsonEscapeString(field.name, &name);
+    name.append(pretty_print_ ? ": " : ":");
+    names.push_back(std::move(name));
+  }
+  return names;
+}
+
+zetasql_base::Status JsonWriter::AppendValue(const Value& value, int depth,
+                                     std::string* output) {
+  if (value.is_null()) {
+    output->append("null");
+    return zetasql_base::OkStatus();
+  }
+  switch (value.type_kind()) {
+    case TYPE_BOOL:
+      output->append(value.bool_value() ? "true" : "false");
+      break;
+    case TYPE_INT32:
+      absl::StrAppend(output, value.int32_value());
+      break;
+    case TYPE_UINT32:
+      absl::StrAppend(output, value.uint32_value());
+      break;
+    case TYPE_INT64:
+      AppendInteger(value.int64_value(), output);
+      break;
+    case TYPE_UINT64:
+      AppendInteger(value.uint64_value(), output);
+      break;
+    case TYPE_FLOAT:
+      if (!std::isfinite(value.float_value())) {
+        AppendNonFinite(value.float_value(), output);
+      } else {
+        AppendShortestFloatingPoint(value.float_value(), /*min_precision=*/6,
+                                    /*max_precision=*/9, output);
+      }
+      break;
+    case TYPE_DOUBLE:
+      if (!std::isfinite(value.double_value())) {
+        AppendNonFinite(value.double_value(), output);
+      } else {
+        AppendShortestFloatingPoint(value.double_value(),
+                                    /*min_precision=*/15,
+                                    /*max_precision=*/17, output);
+      }
+      break;
+    case TYPE_NUMERIC:
+      AppendNumeric(value.numeric_value(), output);
+      break;
+    case TYPE_BIGNUMERIC:
+      AppendNumeric(value.bignumeric_value(), output);
+      break;
+    case TYPE_STRING:
+      JsonEscapeAndAppendString(value.string_view_value(), output);
+      break;
+    case TYPE_BYTES:
+      absl::Base64Escape(value.bytes_view_value(), &bytes_buffer_);
+      AppendQuoted(bytes_buffer_, output);
+      break;
+    case TYPE_ENUM:
+      AppendQuoted(value.enum_name(), output);
+      break;
+    case TYPE_DATE: {
+      const absl::CivilDay day =
+          absl::CivilDay(1970, 1, 1) + value.date_value();
+      absl::StrAppendFormat(output, "\"%04d-%02d-%02d\"", day.year(),
+                            day.month(), day.day());
+      break;
+    }
+    case TYPE_TIMESTAMP: {
+      const absl::Time time = value.ToTime();
+      const absl::TimeZone utc = absl::UTCTimeZone();
+      const absl::CivilSecond second = absl::ToCivilSecond(time, utc);
+      absl::StrAppendFormat(output, "\"%04d-%02d-%02dT%02d:%02d:%02d",
+                            second.year(), second.month(), second.day(),
+                            second.hour(), second.minute(), second.second());
+      AppendFractionalSeconds(
+          absl::ToInt64Nanoseconds(time - absl::FromCivil(second, utc)),
+          output);
+      output->append("Z\"");
+      break;
+    }
+    case TYPE_DATETIME: {
+      const DatetimeValue datetime = value.datetime_value();
+      absl::StrAppendFormat(output, "\"%04d-%02d-%02dT%02d:%02d:%02d",
+                            datetime.Year(), datetime.Month(), datetime.Day(),
+                            datetime.Hour(), datetime.Minute(),
+                            datetime.Second());
+      AppendFractionalSeconds(datetime.Nanoseconds(), output);
+      output->push_back('"');
+      break;
+    }
+    case TYPE_TIME: {
+      const TimeValue time = value.time_value();
+      absl::StrAppendFormat(output, "\"%02d:%02d:%02d", time.Hour(),
+                            time.Minute(), time.Second());
+      AppendFractionalSeconds(time.Nanoseconds(), output);
+      output->push_back('"');
+      break;
+    }
+    case TYPE_ARRAY: {
+      output->push_back('[');
+      const int num_elements = value.num_elements();
+      for (int i = 0; i < num_elements; ++i) {
+        if (i > 0) output->push_back(',');
+        if (pretty_print_) AppendNewline(depth + 1, output);
+        ZETASQL_RETURN_IF_ERROR(
+            AppendValue(value.element(i), depth + 1, output));
+      }
+      if (pretty_print_ && num_elements > 0) AppendNewline(depth, output);
+      output->push_back(']');
+      break;
+    }
+    case TYPE_STRUCT: {
+      const StructType* struct_type = value.type()->AsStruct();
+      const std::vector<std::string>& field_names = GetFieldNames(struct_type);
+      output->push_back('{');
+      for (int i = 0; i < field_names.size(); ++i) {
+        if (i > 0) output->push_back(',');
+        if (pretty_print_) AppendNewline(depth + 1, output);
+        output->append(field_names[i]);
+        ZETASQL_RETURN_IF_ERROR(AppendValue(value.field(i), depth + 1, output));
+      }
+      if (pretty_print_ && !field_names.empty()) AppendNewline(depth, output);
+      output->push_back('}');
+      break;
+    }
+    default:
+      return zetasql_base::UnimplementedErrorBuilder()
+             << "TO_JSON_STRING does not support values of type "
+             << value.type()->DebugString();
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status ToJsonString(const Value& value, bool pretty_print,
+                          std::string* output) {
+  output->clear();
+  JsonWriter writer(pretty_print);
+  return writer.Append(value, output);
+}
+
+}  // namespace functions
+}  // namespace zetasql
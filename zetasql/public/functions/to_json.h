@@ -0,0 +1,92 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef ZETASQL_PUBLIC_FUNCTIONS_TO_JSON_H_
+#define ZETASQL_PUBLIC_FUNCTIONS_TO_JSON_H_
+
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+namespace functions {
+
+// Formats Values as JSON text for TO_JSON_STRING. Writes go straight into
+// the caller's output buffer, and nested arrays and structs do not build any
+// intermediate strings. The quoted and escaped field names of each StructType
+// are computed the first time the writer sees that type, so one writer should
+// be reused for all the values of a column.
+//
+// The JSON text has these rules:
+// - NULL values of any type are written as null.
+// - INT64 and UINT64 values outside [-2^53, 2^53], and NUMERIC and BIGNUMERIC
+//   values that are not integers in that range, are quoted. JSON readers
+//   cannot represent them exactly as numbers.
+// - FLOAT and DOUBLE values use the shortest representation that reads back
+//   as the same value. Infinities and NaN are the quoted strings "Infinity",
+//   "-Infinity" and "NaN".
+// - BYTES values are base64-escaped. ENUM values are their quoted names.
+// - DATE, DATETIME, TIME and TIMESTAMP values are quoted in ISO 8601 format.
+//   TIMESTAMP values use UTC and have a Z suffix. Fractional seconds are
+//   written in groups of 3 digits, and only as many groups as are needed.
+// - With pretty-printing, each array element and struct field goes on its
+//   own line, indented by two spaces for each level of nesting.
+//
+// PROTO and GEOGRAPHY values other than NULL are not supported.
+//
+// Not thread-safe.
+class JsonWriter {
+ public:
+  explicit JsonWriter(bool pretty_print) : pretty_print_(pretty_print) {}
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  // Appends the JSON text of 'value' to 'output'.
+  zetasql_base::Status Append(const Value& value, std::string* output);
+
+ private:
+  // Appends 'value', which is nested at 'depth' for pretty-printing.
+  zetasql_base::Status AppendValue(const Value& value, int depth,
+                           std::string* output);
+
+  // Appends a newline and the indentation of 'depth' for pretty-printing.
+  void AppendNewline(int depth, std::string* output) const;
+
+  // Returns the quoted field names of 'struct_type', each followed by the
+  // name separator.
+  const std::vector<std::string>& GetFieldNames(const StructType* struct_type);
+
+  const bool pretty_print_;
+  absl::flat_hash_map<const StructType*, std::vector<std::string>>
+      field_names_;
+  // Scratch space for base64 escaping.
+  std::string bytes_buffer_;
+};
+
+// Returns the JSON text of 'value' in 'output', as TO_JSON_STRING does.
+// Replaces the contents of 'output', but reuses its buffer.
+zetasql_base::Status ToJsonString(const Value& value, bool pretty_print,
+                          std::string* output);
+
+}  // namespace functions
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_FUNCTIONS_TO_JSON_H_
@@ -0,0 +1,128 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "zetasql/public/functions/to_json.h"
+
+#include <string>
+#include <vector>
+
+#include "zetasql/compliance/functions_testlib.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/testing/test_function.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/substitute.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+namespace functions {
+namespace {
+
+using ::zetasql_base::testing::StatusIs;
+
+// Returns true if 'value' is or contains a non-NULL PROTO or GEOGRAPHY.
+bool HasUnsupportedValue(const Value& value) {
+  if (value.is_null()) return false;
+  if (value.type()->IsProto() || value.type()->IsGeography()) return true;
+  if (value.type()->IsArray()) {
+    for (const Value& element : value.elements()) {
+      if (HasUnsupportedValue(element)) return true;
+    }
+  } else if (value.type()->IsStruct()) {
+    for (const Value& field : value.fields()) {
+      if (HasUnsupportedValue(field)) return true;
+    }
+  }
+  return false;
+}
+
+TEST(ToJsonTest, Compliance) {
+  for (const FunctionTestCall& test :
+       GetFunctionTestsToJsonString(/*include_nano_timestamp=*/true)) {
+    const std::vector<Value>& params = test.params.params();
+    // A NULL pretty-print argument makes the function return NULL without
+    // formatting anything.
+    if (params.size() == 2 && params[1].is_null()) continue;
+    // Take the result with all the features that the test case needs.
+    const QueryParamsWithResult::Result* expected = nullptr;
+    int num_features = -1;
+    for (const auto& entry : test.params.results()) {
+      if (static_cast<int>(entry.first.size()) > num_features) {
+        num_features = entry.first.size();
+        expected = &entry.second;
+      }
+    }
+    if (!expected->status.ok()) continue;
+    const Value& value = params[0];
+    const bool pretty_print = params.size() == 2 && params[1].bool_value();
+    SCOPED_TRACE(absl::Substitute("TO_JSON_STRING($0, $1)", value.DebugString(),
+                                  pretty_print));
+
+    std::string output;
+    const zetasql_base::Status status =
+        ToJsonString(value, pretty_print, &output);
+    if (HasUnsupportedValue(value)) {
+      EXPECT_THAT(status, StatusIs(zetasql_base::UNIMPLEMENTED));
+      continue;
+    }
+    ZETASQL_ASSERT_OK(status);
+    EXPECT_EQ(output, expected->result.string_value());
+  }
+}
+
+TEST(ToJsonTest, WriterAppendsAndReusesFieldNames) {
+  TypeFactory type_factory;
+  const StructType* struct_type;
+  ZETASQL_ASSERT_OK(type_factory.MakeStructType(
+      {{"a\"b", types::Int64Type()}, {"c", types::StringType()}},
+      &struct_type));
+  const Value row1 = Value::Struct(
+      struct_type, {Value::Int64(1), Value::String("x")});
+  const Value row2 = Value::Struct(
+      struct_type, {Value::NullInt64(), Value::String("y\n")});
+
+  JsonWriter writer(/*pretty_print=*/false);
+  std::string output = "[";
+  ZETASQL_ASSERT_OK(writer.Append(row1, &output));
+  output.push_back(',');
+  ZETASQL_ASSERT_OK(writer.Append(row2, &output));
+  output.push_back(']');
+  EXPECT_EQ(output,
+            R"([{"a\"b":1,"c":"x"},{"a\"b":null,"c":"y\n"}])");
+}
+
+TEST(ToJsonTest, ShortestFloatingPoint) {
+  std::string output;
+  ZETASQL_ASSERT_OK(ToJsonString(Value::Double(0.1), /*pretty_print=*/false,
+                         &output));
+  EXPECT_EQ(output, "0.1");
+  ZETASQL_ASSERT_OK(ToJsonString(Value::Double(1.0 / 3), /*pretty_print=*/false,
+                         &output));
+  EXPECT_EQ(output, "0.3333333333333333");
+  ZETASQL_ASSERT_OK(ToJsonString(Value::Float(0.1f), /*pretty_print=*/false,
+                         &output));
+  EXPECT_EQ(output, "0.1");
+  ZETASQL_ASSERT_OK(ToJsonString(Value::Double(1e21), /*pretty_print=*/false,
+                         &output));
+  EXPECT_EQ(output, "1e+21");
+}
+
+}  // namespace
+}  // namespace functions
+}  // namespace zetasql
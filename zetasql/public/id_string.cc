@@ -18,6 +18,8 @@
 
 #include "zetasql/base/logging.h"
 #include "zetasql/base/case.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "absl/synchronization/mutex.h"
 #include "zetasql/base/map_util.h"
 
@@ -86,8 +88,43 @@ int64_t IdStringPool::AllocatePoolId() {
 const IdString* const IdString::kEmptyString =
     new IdString(IdString::MakeGlobal(""));
 
+namespace {
+
+// One shard of the pool used by IdStringPool::MakeInterned().
+struct InternedIdStrings {
+  absl::Mutex mutex;
+  IdStringPool pool ABSL_GUARDED_BY(mutex);
+  // Keys point into the IdStrings.
+  absl::flat_hash_map<absl::string_view, IdString> id_strings
+      ABSL_GUARDED_BY(mutex);
+};
+
+constexpr int kNumInternedIdStringShards = 16;
+
+}  // namespace
+
+// static
+IdString IdStringPool::MakeInterned(absl::string_view str) {
+  static InternedIdStrings* shards =
+      new InternedIdStrings[kNumInternedIdStringShards];
+  InternedIdStrings& shard = shards[absl::Hash<absl::string_view>()(str) %
+                                    kNumInternedIdStringShards];
+  {
+    absl::ReaderMutexLock l(&shard.mutex);
+    auto it = shard.id_strings.find(str);
+    if (it != shard.id_strings.end()) return it->second;
+  }
+  absl::MutexLock l(&shard.mutex);
+  auto it = shard.id_strings.find(str);
+  if (it != shard.id_strings.end()) return it->second;
+  const IdString id_string = shard.pool.Make(str);
+  shard.id_strings.emplace(id_string.ToStringView(), id_string);
+  return id_string;
+}
+
 IdString IdString::ToLower(IdStringPool* pool) const {
-  return pool->Make(absl::AsciiStrToLower(ToStringView()));
+  CheckAlive();
+  return pool->Make(value_->str_lower);
 }
 
 }  // namespace zetasql
@@ -32,6 +32,7 @@
 #include "zetasql/base/arena.h"
 #include "absl/base/attributes.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/hash/hash.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
@@ -206,7 +207,7 @@ class IdString {
       // atomic value that can only be overwritten by an identical value.
       size_t h = hash_;
       if (h == 0) {
-        h = std::hash<std::string>()(std::string(str));
+        h = absl::Hash<absl::string_view>()(str);
         hash_ = h;
       }
       return h;
@@ -218,7 +219,7 @@ class IdString {
       // atomic value that can only be overwritten by an identical value.
       size_t h = hash_case_;
       if (h == 0) {
-        h = std::hash<std::string>()(std::string(str_lower));
+        h = absl::Hash<absl::string_view>()(str_lower);
         hash_case_ = h;
       }
       return h;
@@ -389,7 +390,8 @@ using IdStringHashMapCase =
 // IdStringPool is not thread-safe.  The returned IdStrings are thread-safe to
 // read and copy.
 //
-// TODO Consider variants, like an interning IdStringPool.
+// IdStringPool::MakeInterned() provides a thread-safe, process-wide pool that
+// interns its strings, for names that are used by many analyses.
 class IdStringPool {
  public:
   // Pass 'arena' to use an existing arena.
@@ -414,6 +416,16 @@ class IdStringPool {
   // This function is thread safe.
   static IdString MakeGlobal(absl::string_view str);
 
+  // Returns the IdString for <str> in a global pool that interns its strings:
+  // all calls with equal <str> return IdStrings with the same contents, so
+  // Equals() between them is a pointer compare and their memoized hashes are
+  // computed only once. Like MakeGlobal(), memory is never freed, so this is
+  // meant for a bounded set of strings like the names in a long-lived
+  // Catalog.
+  // This function is thread safe. The pool is sharded by hash, so concurrent
+  // callers rarely contend for the same lock.
+  static IdString MakeInterned(absl::string_view str);
+
  private:
   // Make an IdString::Shared for <str>, allocated in the arena.
   const IdString::Shared* MakeShared(absl::string_view str) {
@@ -445,9 +457,11 @@ class IdStringPool {
     memcpy(string_buf_words + padded_size_words, str.data(), str.size());
 
     // Create the lowercase version of the string in the first part of the
-    // buffer by copying from the second part.
-    for (int i = 0; i < str.size(); ++i) {
-      string_buf[i] = absl::ascii_tolower(string_buf[padded_size + i]);
+    // buffer by copying from the second part, a word at a time. The padding
+    // bytes are zero and stay zero.
+    for (int64_t i = 0; i < padded_size_words; ++i) {
+      string_buf_words[i] =
+          AsciiToLowerWord(string_buf_words[padded_size_words + i]);
     }
 
     absl::string_view copied_lower_str(string_buf, str.size());
@@ -457,6 +471,22 @@ class IdStringPool {
     return shared;
   }
 
+  // Returns <word> with the ASCII uppercase letters in each of its bytes
+  // lowercased, like absl::ascii_tolower() on each byte.
+  static uint64_t AsciiToLowerWord(uint64_t word) {
+    constexpr uint64_t kOnes = 0x0101010101010101ULL;
+    constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+    // Adding to the low 7 bits of each byte cannot carry into the next byte.
+    const uint64_t low_bits = word & ~kHighBits;
+    // The high bit of each byte is set if the byte is >= 'A' and > 'Z',
+    // respectively.
+    const uint64_t ge_a = low_bits + kOnes * (0x80 - 'A');
+    const uint64_t gt_z = low_bits + kOnes * (0x7f - 'Z');
+    // Bytes that have their own high bit set are not ASCII.
+    const uint64_t is_upper = ge_a & ~gt_z & ~word & kHighBits;
+    return word | (is_upper >> 2);
+  }
+
   std::shared_ptr<zetasql_base::UnsafeArena> arena_;
 
 #ifndef NDEBUG
@@ -17,7 +17,10 @@
 #include "zetasql/public/id_string.h"
 
 #include <set>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <unordered_set>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/container/flat_hash_set.h"
@@ -423,6 +426,53 @@ TEST(IdString, ToLower) {
   EXPECT_DEBUG_DEATH(s2.ToStringView(), kPoolIsDeadMsg);
 }
 
+TEST(IdStringPool, MakeInterned) {
+  const IdString name = IdStringPool::MakeInterned("interned_name");
+  const IdString same_name =
+      IdStringPool::MakeInterned(std::string("interned_name"));
+  EXPECT_EQ("interned_name", name.ToStringView());
+  EXPECT_EQ(name.ToStringView().data(), same_name.ToStringView().data());
+  EXPECT_TRUE(name.Equals(same_name));
+  EXPECT_EQ(name.Hash(), same_name.Hash());
+
+  const IdString other_name = IdStringPool::MakeInterned("Interned_Name");
+  EXPECT_NE(name.ToStringView().data(), other_name.ToStringView().data());
+  EXPECT_TRUE(name.CaseEquals(other_name));
+
+  // Concurrent calls intern the string once.
+  std::vector<const char*> data(8);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < data.size(); ++i) {
+    threads.emplace_back([&data, i] {
+      data[i] = IdStringPool::MakeInterned("concurrently_interned_name")
+                    .ToStringView()
+                    .data();
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const char* d : data) {
+    EXPECT_EQ(data[0], d);
+  }
+}
+
+// Checks the word-at-a-time lowercasing against absl::ascii_tolower for every
+// byte value, at every position within a word.
+TEST(IdString, ToLowerAllBytes) {
+  IdStringPool pool;
+  for (int offset = 0; offset < 8; ++offset) {
+    std::string str(offset, 'X');
+    for (int c = 0; c < 256; ++c) {
+      str.push_back(static_cast<char>(c));
+    }
+    const IdString id = pool.Make(str);
+    EXPECT_EQ(absl::AsciiStrToLower(str), id.ToLower(&pool).ToStringView());
+    EXPECT_TRUE(id.CaseEquals(pool.Make(absl::AsciiStrToUpper(str))));
+    EXPECT_EQ(id.HashCase(), pool.Make(absl::AsciiStrToLower(str)).HashCase());
+  }
+}
+
 STATIC_IDSTRING(kStaticOutside, "outside");
 TEST(IdString, Static) {
   STATIC_IDSTRING(kStaticInside, "inside");
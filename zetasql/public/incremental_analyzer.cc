@@ -0,0 +1,136 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/incremental_analyzer.h"
+
+#include <utility>
+
+#include "zetasql/public/parse_location.h"
+#include "zetasql/public/parse_resume_location.h"
+#include "zetasql/public/parse_tokens.h"
+#include "absl/strings/ascii.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+namespace {
+
+// The byte range of one statement in the input.
+struct StatementRange {
+  int start_byte_offset;
+  int end_byte_offset;
+};
+
+// Splits <sql> into the byte ranges of its statements. Only tokenizes <sql>.
+// If tokenizing fails, the rest of the input from the statement with the
+// error on is one statement, so that analyzing it reports the error.
+std::vector<StatementRange> SplitStatements(absl::string_view sql) {
+  std::vector<StatementRange> ranges;
+  ParseResumeLocation resume_location =
+      ParseResumeLocation::FromStringView(sql);
+  ParseTokenOptions options;
+  options.stop_at_end_of_statement = true;
+  while (true) {
+    const int start_byte_offset = resume_location.byte_position();
+    std::vector<ParseToken> tokens;
+    if (!GetParseTokens(options, &resume_location, &tokens).ok()) {
+      const absl::string_view rest = sql.substr(start_byte_offset);
+      ranges.push_back(
+          {static_cast<int>(sql.size() -
+                            absl::StripLeadingAsciiWhitespace(rest).size()),
+           static_cast<int>(sql.size())});
+      return ranges;
+    }
+    if (tokens.empty()) return ranges;
+    const ParseToken& last_token = tokens.back();
+    const bool at_end_of_input = last_token.IsEndOfInput();
+    const int num_statement_tokens = tokens.size() - 1;
+    if (num_statement_tokens == 0) {
+      // Only whitespace and comments after the last ";".
+      if (at_end_of_input) return ranges;
+      // An empty statement, which does not analyze.
+      const int offset =
+          last_token.GetLocationRange().start().GetByteOffset();
+      ranges.push_back({offset, offset});
+    } else {
+      ranges.push_back(
+          {tokens.front().GetLocationRange().start().GetByteOffset(),
+           tokens[num_statement_tokens - 1]
+               .GetLocationRange()
+               .end()
+               .GetByteOffset()});
+    }
+    if (at_end_of_input) return ranges;
+  }
+}
+
+}  // namespace
+
+IncrementalAnalyzer::IncrementalAnalyzer(const AnalyzerOptions* options,
+                                         Catalog* catalog)
+    : options_(options), catalog_(catalog) {}
+
+void IncrementalAnalyzer::Update(absl::string_view sql) {
+  absl::flat_hash_map<std::string,
+                      zetasql_base::StatusOr<std::shared_ptr<const AnalyzerOutput>>>
+      outputs_by_text;
+  std::vector<Statement> statements;
+  for (const StatementRange& range : SplitStatements(sql)) {
+    Statement statement;
+    statement.start_byte_offset = range.start_byte_offset;
+    statement.end_byte_offset = range.end_byte_offset;
+    const std::string text(sql.substr(
+        range.start_byte_offset,
+        range.end_byte_offset - range.start_byte_offset));
+
+    auto it = outputs_by_text.find(text);
+    if (it != outputs_by_text.end()) {
+      // The same statement occurs more than once in this version.
+      statement.output = it->second;
+      statement.reused = true;
+    } else {
+      auto previous = outputs_by_text_.find(text);
+      if (previous != outputs_by_text_.end()) {
+        statement.output = previous->second;
+        statement.reused = true;
+      } else {
+        std::unique_ptr<const AnalyzerOutput> output;
+        const zetasql_base::Status status = AnalyzeStatement(
+            text, *options_, catalog_, &type_factory_, &output);
+        if (status.ok()) {
+          statement.output = std::shared_ptr<const AnalyzerOutput>(
+              std::move(output));
+        } else {
+          statement.output = status;
+        }
+      }
+      outputs_by_text.emplace(text, statement.output);
+    }
+    statements.push_back(std::move(statement));
+  }
+
+  // Only keep the outputs of this version, so that memory use is bounded by
+  // the size of the current version.
+  outputs_by_text_ = std::move(outputs_by_text);
+  statements_ = std::move(statements);
+}
+
+void IncrementalAnalyzer::Clear() {
+  statements_.clear();
+  outputs_by_text_.clear();
+}
+
+}  // namespace zetasql
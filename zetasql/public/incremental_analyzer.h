@@ -0,0 +1,101 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_INCREMENTAL_ANALYZER_H_
+#define ZETASQL_PUBLIC_INCREMENTAL_ANALYZER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/type.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// Analyzes successive versions of a string of statements separated by
+// semicolons, e.g. the contents of an editor buffer after every keystroke,
+// and only parses and analyzes again the statements whose text changed since
+// the previous version.
+//
+// Each version is split into statements by tokenizing it, which is much
+// cheaper than parsing. Each statement is then analyzed on its own, as if it
+// were the whole input, so its output and errors do not depend on where the
+// statement is in the string: parse locations and error locations are
+// relative to the start of the statement, given by
+// Statement::start_byte_offset. Statements are analyzed independently
+// against the catalog and cannot see each other's effects, so the output of a
+// statement only depends on its text. A statement's previous output is reused
+// when a statement with the same text was in the previous version, wherever it
+// was.
+//
+// The outputs reference objects that the Catalog returned and Types owned by
+// the IncrementalAnalyzer. Callers must call Clear() whenever the contents of
+// the catalog change, and must not use outputs after destroying the
+// IncrementalAnalyzer.
+//
+// Script statements (e.g. BEGIN ... END blocks) are not supported.
+//
+// This class is not thread-safe.
+class IncrementalAnalyzer {
+ public:
+  struct Statement {
+    // The byte range of the statement in the last version, without the
+    // terminating semicolon and the whitespace and comments around it.
+    int start_byte_offset = 0;
+    int end_byte_offset = 0;
+    // The output of analyzing the statement, or the error.
+    zetasql_base::StatusOr<std::shared_ptr<const AnalyzerOutput>> output;
+    // True if <output> was reused from the previous version.
+    bool reused = false;
+  };
+
+  // <options> and <catalog> must outlive this object.
+  IncrementalAnalyzer(const AnalyzerOptions* options, Catalog* catalog);
+  IncrementalAnalyzer(const IncrementalAnalyzer&) = delete;
+  IncrementalAnalyzer& operator=(const IncrementalAnalyzer&) = delete;
+
+  // Analyzes the statements of <sql>, reusing the outputs of the statements
+  // of the previous version that are unchanged. Afterwards statements()
+  // returns all the statements of <sql>, with their outputs or errors.
+  void Update(absl::string_view sql);
+
+  // The statements of the last version passed to Update(), in order.
+  const std::vector<Statement>& statements() const { return statements_; }
+
+  // Forgets all the statements and their outputs, so that the next Update()
+  // analyzes all of them.
+  void Clear();
+
+ private:
+  const AnalyzerOptions* options_;  // Not owned.
+  Catalog* catalog_;                // Not owned.
+  TypeFactory type_factory_;
+
+  std::vector<Statement> statements_;
+  // The outputs of the statements of the last version, by their text.
+  absl::flat_hash_map<std::string,
+                      zetasql_base::StatusOr<std::shared_ptr<const AnalyzerOutput>>>
+      outputs_by_text_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_INCREMENTAL_ANALYZER_H_
@@ -0,0 +1,125 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/incremental_analyzer.h"
+
+#include <memory>
+#include <string>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/testdata/sample_catalog.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+
+namespace zetasql {
+namespace {
+
+using testing::HasSubstr;
+using zetasql_base::testing::StatusIs;
+
+class IncrementalAnalyzerTest : public ::testing::Test {
+ protected:
+  IncrementalAnalyzerTest()
+      : sample_catalog_(absl::make_unique<SampleCatalog>(options_.language())),
+        analyzer_(&options_, sample_catalog_->catalog()) {}
+
+  // Returns the text of statement <i> of <sql>.
+  std::string StatementText(const std::string& sql, int i) {
+    const IncrementalAnalyzer::Statement& statement =
+        analyzer_.statements()[i];
+    return sql.substr(statement.start_byte_offset,
+                      statement.end_byte_offset - statement.start_byte_offset);
+  }
+
+  AnalyzerOptions options_;
+  std::unique_ptr<SampleCatalog> sample_catalog_;
+  IncrementalAnalyzer analyzer_;
+};
+
+TEST_F(IncrementalAnalyzerTest, ReusesUnchangedStatements) {
+  const std::string sql =
+      "SELECT key FROM KeyValue;\n"
+      "  /* comment */ SELECT value FROM KeyValue ; SELECT 'a;b'";
+  analyzer_.Update(sql);
+  ASSERT_EQ(3, analyzer_.statements().size());
+  EXPECT_EQ("SELECT key FROM KeyValue", StatementText(sql, 0));
+  EXPECT_EQ("SELECT value FROM KeyValue", StatementText(sql, 1));
+  EXPECT_EQ("SELECT 'a;b'", StatementText(sql, 2));
+  for (const IncrementalAnalyzer::Statement& statement :
+       analyzer_.statements()) {
+    ZETASQL_ASSERT_OK(statement.output.status());
+    EXPECT_FALSE(statement.reused);
+  }
+  const AnalyzerOutput* first_output =
+      analyzer_.statements()[0].output.ValueOrDie().get();
+  const AnalyzerOutput* second_output =
+      analyzer_.statements()[1].output.ValueOrDie().get();
+
+  // Edit the second statement and insert a statement before the first one.
+  const std::string edited_sql =
+      "SELECT 1;\n"
+      "SELECT key FROM KeyValue;\n"
+      "  /* comment */ SELECT value, key FROM KeyValue ; SELECT 'a;b';";
+  analyzer_.Update(edited_sql);
+  ASSERT_EQ(4, analyzer_.statements().size());
+  EXPECT_FALSE(analyzer_.statements()[0].reused);
+  EXPECT_TRUE(analyzer_.statements()[1].reused);
+  EXPECT_EQ(first_output, analyzer_.statements()[1].output.ValueOrDie().get());
+  EXPECT_FALSE(analyzer_.statements()[2].reused);
+  EXPECT_NE(second_output,
+            analyzer_.statements()[2].output.ValueOrDie().get());
+  EXPECT_EQ("SELECT value, key FROM KeyValue", StatementText(edited_sql, 2));
+  EXPECT_TRUE(analyzer_.statements()[3].reused);
+
+  analyzer_.Clear();
+  EXPECT_TRUE(analyzer_.statements().empty());
+  analyzer_.Update(edited_sql);
+  for (const IncrementalAnalyzer::Statement& statement :
+       analyzer_.statements()) {
+    EXPECT_FALSE(statement.reused);
+  }
+}
+
+TEST_F(IncrementalAnalyzerTest, Errors) {
+  const std::string sql =
+      "SELECT no_such_column FROM KeyValue; SELECT 1; SELECT 'unclosed; "
+      "SELECT 2";
+  analyzer_.Update(sql);
+  ASSERT_EQ(3, analyzer_.statements().size());
+  EXPECT_THAT(analyzer_.statements()[0].output.status(),
+              StatusIs(testing::_, HasSubstr("Unrecognized name")));
+  ZETASQL_EXPECT_OK(analyzer_.statements()[1].output.status());
+  // The rest of the input after a tokenization error is one statement.
+  EXPECT_EQ("SELECT 'unclosed; SELECT 2", StatementText(sql, 2));
+  EXPECT_FALSE(analyzer_.statements()[2].output.ok());
+
+  // Errors are reused too, and so are outputs of duplicated statements.
+  analyzer_.Update(
+      "SELECT no_such_column FROM KeyValue; SELECT 1; SELECT 1; ;");
+  ASSERT_EQ(4, analyzer_.statements().size());
+  EXPECT_TRUE(analyzer_.statements()[0].reused);
+  EXPECT_FALSE(analyzer_.statements()[0].output.ok());
+  EXPECT_TRUE(analyzer_.statements()[1].reused);
+  EXPECT_TRUE(analyzer_.statements()[2].reused);
+  // The empty statement between the last two semicolons.
+  EXPECT_FALSE(analyzer_.statements()[3].reused);
+  EXPECT_FALSE(analyzer_.statements()[3].output.ok());
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -0,0 +1,706 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/mapped_columnar_table.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <utility>
+
+#include "zetasql/base/endian.h"
+#include "zetasql/common/mapped_file.h"
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/value_encoding.h"
+#include "absl/base/casts.h"
+#include "absl/base/config.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_builder.h"
+#include "zetasql/base/status_macros.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+namespace {
+
+constexpr absl::string_view kMagic = "ZSQLCOL1";
+
+// Bit of the column flags that is set if the column has a validity bitmap.
+constexpr uint64_t kHasNullsFlag = 1;
+
+int64_t NumBitmapBytes(int64_t num_bits) { return (num_bits + 7) / 8; }
+
+int64_t NumBlocks(int64_t num_rows) {
+  return (num_rows + MappedColumnarTable::kRowsPerBlock - 1) /
+         MappedColumnarTable::kRowsPerBlock;
+}
+
+// Builds the contents of a file in the mapped columnar layout.
+class FileBuilder {
+ public:
+  void AppendWord(uint64_t word) {
+    word = zetasql_base::LittleEndian::FromHost64(word);
+    contents_.append(reinterpret_cast<const char*>(&word), sizeof(word));
+  }
+
+  // Overwrites the word at 'position', which must have been appended.
+  void SetWord(size_t position, uint64_t word) {
+    word = zetasql_base::LittleEndian::FromHost64(word);
+    memcpy(&contents_[position], &word, sizeof(word));
+  }
+
+  void AppendBytes(absl::string_view bytes) {
+    contents_.append(bytes.data(), bytes.size());
+  }
+
+  // Appends a bitmap of 'num_bits' bits, where bit i is 'get_bit(i)'.
+  template <typename GetBit>
+  void AppendBitmap(int64_t num_bits, GetBit get_bit) {
+    std::string bitmap(NumBitmapBytes(num_bits), '\0');
+    for (int64_t i = 0; i < num_bits; ++i) {
+      if (get_bit(i)) bitmap[i / 8] |= 1 << (i % 8);
+    }
+    AppendBytes(bitmap);
+    Align();
+  }
+
+  // Pads the contents to a multiple of 8 bytes.
+  void Align() { contents_.resize((contents_.size() + 7) / 8 * 8, '\0'); }
+
+  size_t size() const { return contents_.size(); }
+  const std::string& contents() const { return contents_; }
+
+ private:
+  std::string contents_;
+};
+
+// One column of a mapped columnar file. The spans point into the mapping.
+struct MappedColumn {
+  const Type* type = nullptr;
+  // Empty if the column has no NULLs.
+  absl::Span<const uint8_t> validity_bitmap;
+  // Only one of these is set, depending on the type. 'offsets' and 'data' are
+  // the string offsets and characters of a STRING column, or the block
+  // offsets and encoded blocks of other columns.
+  absl::Span<const int64_t> int64_values;
+  absl::Span<const double> double_values;
+  absl::Span<const uint8_t> bool_bitmap;
+  absl::Span<const uint64_t> offsets;
+  absl::string_view data;
+
+  // Returns true if row 'i' is NULL.
+  bool IsNull(int64_t i) const {
+    return !validity_bitmap.empty() &&
+           !EvaluatorTableColumnBatch::Column::GetBit(validity_bitmap, i);
+  }
+};
+
+// A memory-mapped file written by MappedColumnarTableWriter.
+class MappedColumnarFile
+    : public std::enable_shared_from_this<MappedColumnarFile> {
+ public:
+  MappedColumnarFile(const MappedColumnarFile&) = delete;
+  MappedColumnarFile& operator=(const MappedColumnarFile&) = delete;
+
+  // Maps the file at 'path' and checks that its layout matches
+  // 'column_types'. Only the header and the fixed-size parts of the columns
+  // are checked; string and block offsets are checked when they are read.
+  static zetasql_base::StatusOr<std::shared_ptr<const MappedColumnarFile>> Open(
+      const std::string& path, const std::vector<const Type*>& column_types);
+
+  int64_t num_rows() const { return num_rows_; }
+  const std::vector<MappedColumn>& columns() const { return columns_; }
+
+  // Returns STRING 'column' of row 'i', referring to the mapping.
+  zetasql_base::StatusOr<absl::string_view> GetString(
+      const MappedColumn& column, int64_t i) const {
+    const uint64_t start = column.offsets[i];
+    const uint64_t end = column.offsets[i + 1];
+    if (start > end || end > column.data.size()) {
+      return CorruptionError() << "invalid string offsets for row " << i;
+    }
+    return column.data.substr(start, end - start);
+  }
+
+  // Decodes 'block' of 'column', whose Values refer to the mapping.
+  zetasql_base::StatusOr<std::vector<Value>> DecodeBlock(
+      const MappedColumn& column, int64_t block) const {
+    const uint64_t start = column.offsets[block];
+    const uint64_t end = column.offsets[block + 1];
+    if (start > end || end > column.data.size()) {
+      return CorruptionError() << "invalid offsets for block " << block;
+    }
+    ZETASQL_ASSIGN_OR_RETURN(std::vector<Value> values,
+                     DecodeValues(column.type,
+                                  column.data.substr(start, end - start),
+                                  shared_from_this()));
+    const int64_t block_start = block * MappedColumnarTable::kRowsPerBlock;
+    if (values.size() != std::min(MappedColumnarTable::kRowsPerBlock,
+                                  num_rows_ - block_start)) {
+      return CorruptionError() << "wrong number of values in block " << block;
+    }
+    return values;
+  }
+
+ private:
+  MappedColumnarFile(const std::string& path,
+                     std::unique_ptr<MappedFile> mapped_file)
+      : path_(path), mapped_file_(std::move(mapped_file)) {}
+
+  zetasql_base::StatusBuilder CorruptionError() const {
+    return zetasql_base::OutOfRangeErrorBuilder()
+           << "Corrupted mapped columnar table file " << path_ << ": ";
+  }
+
+  // Reads the word at '*position' and advances past it.
+  zetasql_base::StatusOr<uint64_t> ReadWord(size_t* position) const;
+
+  // Returns the 'size' bytes at '*position' and advances past them, to the
+  // next multiple of 8.
+  zetasql_base::StatusOr<absl::string_view> ReadBytes(uint64_t size,
+                                              size_t* position) const;
+
+  // Returns 'num_elements' elements of type T at '*position' and advances
+  // past them.
+  template <typename T>
+  zetasql_base::StatusOr<absl::Span<const T>> ReadArray(uint64_t num_elements,
+                                                size_t* position) const {
+    if (num_elements > mapped_file_->contents().size() / sizeof(T)) {
+      return CorruptionError() << "array out of bounds at offset " << *position;
+    }
+    ZETASQL_ASSIGN_OR_RETURN(absl::string_view bytes,
+                     ReadBytes(num_elements * sizeof(T), position));
+    // The mapping is page-aligned and sections are aligned to 8 bytes.
+    return absl::MakeConstSpan(reinterpret_cast<const T*>(bytes.data()),
+                               num_elements);
+  }
+
+  zetasql_base::Status ReadColumn(uint64_t offset, MappedColumn* column) const;
+
+  const std::string path_;
+  const std::unique_ptr<MappedFile> mapped_file_;
+  int64_t num_rows_ = 0;
+  std::vector<MappedColumn> columns_;
+};
+
+zetasql_base::StatusOr<uint64_t> MappedColumnarFile::ReadWord(
+    size_t* position) const {
+  ZETASQL_ASSIGN_OR_RETURN(absl::string_view bytes,
+                   ReadBytes(sizeof(uint64_t), position));
+  return zetasql_base::LittleEndian::Load64(bytes.data());
+}
+
+zetasql_base::StatusOr<absl::string_view> MappedColumnarFile::ReadBytes(
+    uint64_t size, size_t* position) const {
+  const absl::string_view contents = mapped_file_->contents();
+  if (*position > contents.size() || size > contents.size() - *position) {
+    return CorruptionError() << "section of " << size
+                             << " bytes out of bounds at offset " << *position;
+  }
+  const absl::string_view bytes = contents.substr(*position, size);
+  *position = std::min<size_t>(contents.size(), (*position + size + 7) / 8 * 8);
+  return bytes;
+}
+
+zetasql_base::Status MappedColumnarFile::ReadColumn(uint64_t offset,
+                                            MappedColumn* column) const {
+  if (offset % 8 != 0) {
+    return CorruptionError() << "misaligned column at offset " << offset;
+  }
+  size_t position = offset;
+  ZETASQL_ASSIGN_OR_RETURN(const uint64_t flags, ReadWord(&position));
+  if (flags & kHasNullsFlag) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        column->validity_bitmap,
+        ReadArray<uint8_t>(NumBitmapBytes(num_rows_), &position));
+  }
+  switch (column->type->kind()) {
+    case TYPE_INT64: {
+      ZETASQL_ASSIGN_OR_RETURN(column->int64_values,
+                       ReadArray<int64_t>(num_rows_, &position));
+      break;
+    }
+    case TYPE_DOUBLE: {
+      ZETASQL_ASSIGN_OR_RETURN(column->double_values,
+                       ReadArray<double>(num_rows_, &position));
+      break;
+    }
+    case TYPE_BOOL: {
+      ZETASQL_ASSIGN_OR_RETURN(
+          column->bool_bitmap,
+          ReadArray<uint8_t>(NumBitmapBytes(num_rows_), &position));
+      break;
+    }
+    default: {
+      const int64_t num_offsets =
+          (column->type->kind() == TYPE_STRING ? num_rows_
+                                               : NumBlocks(num_rows_)) +
+          1;
+      ZETASQL_ASSIGN_OR_RETURN(column->offsets,
+                       ReadArray<uint64_t>(num_offsets, &position));
+      if (column->offsets[0] != 0) {
+        return CorruptionError() << "invalid first offset at " << offset;
+      }
+      ZETASQL_ASSIGN_OR_RETURN(column->data,
+                       ReadBytes(column->offsets.back(), &position));
+      break;
+    }
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::StatusOr<std::shared_ptr<const MappedColumnarFile>>
+MappedColumnarFile::Open(const std::string& path,
+                         const std::vector<const Type*>& column_types) {
+#ifndef ABSL_IS_LITTLE_ENDIAN
+  return zetasql_base::UnimplementedErrorBuilder()
+         << "Mapped columnar tables are only supported on little-endian hosts";
+#endif
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<MappedFile> mapped_file,
+                   MappedFile::Open(path));
+  std::shared_ptr<MappedColumnarFile> file(
+      new MappedColumnarFile(path, std::move(mapped_file)));
+  if (!absl::StartsWith(file->mapped_file_->contents(), kMagic)) {
+    return file->CorruptionError() << "missing magic number";
+  }
+
+  size_t position = kMagic.size();
+  ZETASQL_ASSIGN_OR_RETURN(const uint64_t num_rows, file->ReadWord(&position));
+  ZETASQL_ASSIGN_OR_RETURN(const uint64_t num_columns,
+                   file->ReadWord(&position));
+  if (num_rows > file->mapped_file_->contents().size() * 8) {
+    return file->CorruptionError() << "invalid number of rows " << num_rows;
+  }
+  file->num_rows_ = num_rows;
+  if (num_columns != column_types.size()) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "Mapped columnar table file " << path << " has " << num_columns
+           << " columns, but the table has " << column_types.size();
+  }
+  file->columns_.resize(num_columns);
+  for (int i = 0; i < num_columns; ++i) {
+    ZETASQL_ASSIGN_OR_RETURN(const uint64_t kind, file->ReadWord(&position));
+    ZETASQL_ASSIGN_OR_RETURN(const uint64_t offset, file->ReadWord(&position));
+    if (kind != column_types[i]->kind()) {
+      return zetasql_base::InvalidArgumentErrorBuilder()
+             << "Column " << i << " of mapped columnar table file " << path
+             << " has type kind " << kind << ", but the table column has type "
+             << column_types[i]->DebugString();
+    }
+    file->columns_[i].type = column_types[i];
+    ZETASQL_RETURN_IF_ERROR(file->ReadColumn(offset, &file->columns_[i]));
+  }
+  return std::shared_ptr<const MappedColumnarFile>(std::move(file));
+}
+
+// Returns bits [start, start + num_bits) of 'bitmap', copying them into
+// 'scratch' if they do not start on a byte boundary.
+absl::Span<const uint8_t> SliceBitmap(absl::Span<const uint8_t> bitmap,
+                                      int64_t start, int64_t num_bits,
+                                      std::vector<uint8_t>* scratch) {
+  if (start % 8 == 0) {
+    return bitmap.subspan(start / 8, NumBitmapBytes(num_bits));
+  }
+  scratch->assign(NumBitmapBytes(num_bits), 0);
+  for (int64_t i = 0; i < num_bits; ++i) {
+    if (EvaluatorTableColumnBatch::Column::GetBit(bitmap, start + i)) {
+      (*scratch)[i / 8] |= 1 << (i % 8);
+    }
+  }
+  return *scratch;
+}
+
+// Reads some of the columns of a MappedColumnarFile, either row by row or in
+// column batches.
+class MappedColumnarTableIterator : public EvaluatorTableIterator {
+ public:
+  // 'columns[i]' is read from 'file->columns()[file_column_idxs[i]]'.
+  MappedColumnarTableIterator(std::vector<const Column*> columns,
+                              std::vector<int> file_column_idxs,
+                              std::shared_ptr<const MappedColumnarFile> file)
+      : columns_(std::move(columns)),
+        file_column_idxs_(std::move(file_column_idxs)),
+        file_(std::move(file)),
+        values_(columns_.size()),
+        blocks_(columns_.size()),
+        scratch_(columns_.size()) {}
+
+  MappedColumnarTableIterator(const MappedColumnarTableIterator&) = delete;
+  MappedColumnarTableIterator& operator=(const MappedColumnarTableIterator&) =
+      delete;
+
+  int NumColumns() const override { return columns_.size(); }
+
+  std::string GetColumnName(int i) const override {
+    return columns_[i]->Name();
+  }
+
+  const Type* GetColumnType(int i) const override {
+    return columns_[i]->GetType();
+  }
+
+  bool NextRow() override {
+    if (!CheckNotDone(/*num_rows=*/1)) return false;
+    const int64_t row = next_row_++;
+    for (int i = 0; i < columns_.size(); ++i) {
+      const MappedColumn& column = file_column(i);
+      if (column.IsNull(row)) {
+        values_[i] = Value::Null(column.type);
+        continue;
+      }
+      switch (column.type->kind()) {
+        case TYPE_INT64:
+          values_[i] = Value::Int64(column.int64_values[row]);
+          break;
+        case TYPE_DOUBLE:
+          values_[i] = Value::Double(column.double_values[row]);
+          break;
+        case TYPE_BOOL:
+          values_[i] = Value::Bool(
+              EvaluatorTableColumnBatch::Column::GetBit(column.bool_bitmap,
+                                                        row));
+          break;
+        case TYPE_STRING: {
+          const zetasql_base::StatusOr<absl::string_view> str =
+              file_->GetString(column, row);
+          if (!str.ok()) {
+            status_ = str.status();
+            return false;
+          }
+          values_[i] = Value::ExternalString(str.ValueOrDie(), file_);
+          break;
+        }
+        default: {
+          const zetasql_base::StatusOr<const std::vector<Value>*> block =
+              GetBlock(i, row / MappedColumnarTable::kRowsPerBlock);
+          if (!block.ok()) {
+            status_ = block.status();
+            return false;
+          }
+          values_[i] =
+              (*block.ValueOrDie())[row % MappedColumnarTable::kRowsPerBlock];
+          break;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool SupportsColumnBatches() const override { return true; }
+
+  bool NextColumnBatch(int64_t max_num_rows,
+                       EvaluatorTableColumnBatch* batch) override {
+    if (!CheckNotDone(max_num_rows)) return false;
+    const int64_t start = next_row_;
+    const int64_t num_rows =
+        std::min({max_num_rows, file_->num_rows() - start,
+                  MappedColumnarTable::kRowsPerBlock -
+                      start % MappedColumnarTable::kRowsPerBlock});
+    next_row_ += num_rows;
+
+    batch->num_rows = num_rows;
+    batch->columns.clear();
+    batch->columns.resize(columns_.size());
+    for (int i = 0; i < columns_.size(); ++i) {
+      const MappedColumn& column = file_column(i);
+      EvaluatorTableColumnBatch::Column& output = batch->columns[i];
+      if (!column.validity_bitmap.empty()) {
+        output.validity_bitmap = SliceBitmap(column.validity_bitmap, start,
+                                             num_rows, &scratch_[i].validity);
+      }
+      switch (column.type->kind()) {
+        case TYPE_INT64:
+          output.int64_values = column.int64_values.subspan(start, num_rows);
+          break;
+        case TYPE_DOUBLE:
+          output.double_values = column.double_values.subspan(start, num_rows);
+          break;
+        case TYPE_BOOL:
+          output.bool_bitmap = SliceBitmap(column.bool_bitmap, start, num_rows,
+                                           &scratch_[i].bools);
+          break;
+        case TYPE_STRING: {
+          std::vector<absl::string_view>& strings = scratch_[i].strings;
+          strings.resize(num_rows);
+          for (int64_t row = 0; row < num_rows; ++row) {
+            const zetasql_base::StatusOr<absl::string_view> str =
+                file_->GetString(column, start + row);
+            if (!str.ok()) {
+              status_ = str.status();
+              return false;
+            }
+            strings[row] = str.ValueOrDie();
+          }
+          output.string_values = strings;
+          break;
+        }
+        default: {
+          const zetasql_base::StatusOr<const std::vector<Value>*> block =
+              GetBlock(i, start / MappedColumnarTable::kRowsPerBlock);
+          if (!block.ok()) {
+            status_ = block.status();
+            return false;
+          }
+          output.values = absl::MakeConstSpan(*block.ValueOrDie())
+                              .subspan(start %
+                                           MappedColumnarTable::kRowsPerBlock,
+                                       num_rows);
+          break;
+        }
+      }
+    }
+    return true;
+  }
+
+  const Value& GetValue(int i) const override { return values_[i]; }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  zetasql_base::Status Cancel() override {
+    cancelled_ = true;
+    return zetasql_base::OkStatus();
+  }
+
+  void SetDeadline(absl::Time deadline) override { deadline_ = deadline; }
+
+ private:
+  // The decoded block of a column that is not INT64, DOUBLE, BOOL or STRING.
+  struct Block {
+    int64_t index = -1;
+    std::vector<Value> values;
+  };
+
+  // Buffers for the parts of a column batch that cannot point into the
+  // mapping.
+  struct BatchScratch {
+    std::vector<uint8_t> validity;
+    std::vector<uint8_t> bools;
+    std::vector<absl::string_view> strings;
+  };
+
+  // How often the deadline is checked, in rows.
+  static constexpr int64_t kRowsPerDeadlineCheck = 1024;
+
+  const MappedColumn& file_column(int i) const {
+    return file_->columns()[file_column_idxs_[i]];
+  }
+
+  // Returns false if there are no more rows, or if the iterator failed, was
+  // cancelled, or missed its deadline. 'num_rows' is the number of rows about
+  // to be read.
+  bool CheckNotDone(int64_t num_rows) {
+    if (!status_.ok() || next_row_ >= file_->num_rows()) return false;
+    if (cancelled_) {
+      status_ = zetasql_base::CancelledErrorBuilder()
+                << "MappedColumnarTableIterator was cancelled";
+      return false;
+    }
+    rows_since_deadline_check_ += num_rows;
+    if (rows_since_deadline_check_ >= kRowsPerDeadlineCheck) {
+      rows_since_deadline_check_ = 0;
+      if (absl::Now() > deadline_) {
+        status_ = zetasql_base::DeadlineExceededErrorBuilder()
+                  << "MappedColumnarTableIterator deadline exceeded";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Returns block 'index' of column 'i', decoding it unless it is the one
+  // that was decoded last.
+  zetasql_base::StatusOr<const std::vector<Value>*> GetBlock(int i,
+                                                     int64_t index) {
+    Block& block = blocks_[i];
+    if (block.index != index) {
+      block.index = -1;
+      ZETASQL_ASSIGN_OR_RETURN(block.values,
+                       file_->DecodeBlock(file_column(i), index));
+      block.index = index;
+    }
+    return &block.values;
+  }
+
+  const std::vector<const Column*> columns_;
+  const std::vector<int> file_column_idxs_;
+  const std::shared_ptr<const MappedColumnarFile> file_;
+
+  int64_t next_row_ = 0;
+  std::vector<Value> values_;
+  std::vector<Block> blocks_;
+  std::vector<BatchScratch> scratch_;
+
+  zetasql_base::Status status_;
+  std::atomic<bool> cancelled_{false};
+  absl::Time deadline_ = absl::InfiniteFuture();
+  int64_t rows_since_deadline_check_ = 0;
+};
+
+}  // namespace
+
+zetasql_base::Status MappedColumnarTable::SetContentsFromFile(
+    const std::string& path) {
+  std::vector<const Type*> column_types;
+  for (int i = 0; i < NumColumns(); ++i) {
+    column_types.push_back(GetColumn(i)->GetType());
+  }
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<const MappedColumnarFile> file,
+                   MappedColumnarFile::Open(path, column_types));
+  set_row_count_estimate(file->num_rows());
+
+  auto factory = [this, file](absl::Span<const int> column_idxs)
+      -> zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>> {
+    std::vector<const Column*> columns;
+    for (const int column_idx : column_idxs) {
+      ZETASQL_RET_CHECK_GE(column_idx, 0);
+      ZETASQL_RET_CHECK_LT(column_idx, file->columns().size());
+      columns.push_back(GetColumn(column_idx));
+    }
+    return std::unique_ptr<EvaluatorTableIterator>(
+        new MappedColumnarTableIterator(
+            std::move(columns),
+            std::vector<int>(column_idxs.begin(), column_idxs.end()), file));
+  };
+  SetEvaluatorTableIteratorFactory(factory);
+  return zetasql_base::OkStatus();
+}
+
+MappedColumnarTableWriter::MappedColumnarTableWriter(
+    std::vector<const Type*> column_types)
+    : column_types_(std::move(column_types)),
+      columns_(column_types_.size()) {}
+
+zetasql_base::Status MappedColumnarTableWriter::AddRow(
+    absl::Span<const Value> row) {
+  if (row.size() != column_types_.size()) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "Row has " << row.size() << " values, but the table has "
+           << column_types_.size() << " columns";
+  }
+  for (int i = 0; i < row.size(); ++i) {
+    if (!row[i].is_valid() || !row[i].type()->Equals(column_types_[i])) {
+      return zetasql_base::InvalidArgumentErrorBuilder()
+             << "Value " << row[i].DebugString() << " of column " << i
+             << " does not have type " << column_types_[i]->DebugString();
+    }
+  }
+  for (int i = 0; i < row.size(); ++i) {
+    columns_[i].push_back(row[i]);
+  }
+  ++num_rows_;
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status MappedColumnarTableWriter::WriteToFile(
+    const std::string& path) const {
+  FileBuilder builder;
+  builder.AppendBytes(kMagic);
+  builder.AppendWord(num_rows_);
+  builder.AppendWord(columns_.size());
+  const size_t directory_position = builder.size();
+  for (const Type* type : column_types_) {
+    builder.AppendWord(type->kind());
+    builder.AppendWord(0);  // The offset is set below.
+  }
+
+  for (int i = 0; i < columns_.size(); ++i) {
+    const std::vector<Value>& values = columns_[i];
+    builder.SetWord(directory_position + (2 * i + 1) * sizeof(uint64_t),
+                    builder.size());
+    const bool has_nulls =
+        std::any_of(values.begin(), values.end(),
+                    [](const Value& value) { return value.is_null(); });
+    builder.AppendWord(has_nulls ? kHasNullsFlag : 0);
+    if (has_nulls) {
+      builder.AppendBitmap(num_rows_, [&values](int64_t row) {
+        return !values[row].is_null();
+      });
+    }
+    switch (column_types_[i]->kind()) {
+      case TYPE_INT64:
+        for (const Value& value : values) {
+          builder.AppendWord(value.is_null() ? 0 : value.int64_value());
+        }
+        break;
+      case TYPE_DOUBLE:
+        for (const Value& value : values) {
+          builder.AppendWord(absl::bit_cast<uint64_t>(
+              value.is_null() ? 0.0 : value.double_value()));
+        }
+        break;
+      case TYPE_BOOL:
+        builder.AppendBitmap(num_rows_, [&values](int64_t row) {
+          return !values[row].is_null() && values[row].bool_value();
+        });
+        break;
+      case TYPE_STRING: {
+        uint64_t offset = 0;
+        builder.AppendWord(offset);
+        for (const Value& value : values) {
+          if (!value.is_null()) offset += value.string_view_value().size();
+          builder.AppendWord(offset);
+        }
+        for (const Value& value : values) {
+          if (!value.is_null()) builder.AppendBytes(value.string_view_value());
+        }
+        builder.Align();
+        break;
+      }
+      default: {
+        std::vector<std::string> blocks(NumBlocks(num_rows_));
+        for (int64_t block = 0; block < blocks.size(); ++block) {
+          const int64_t start = block * MappedColumnarTable::kRowsPerBlock;
+          ZETASQL_RETURN_IF_ERROR(EncodeValues(
+              column_types_[i],
+              absl::MakeConstSpan(values).subspan(
+                  start, MappedColumnarTable::kRowsPerBlock),
+              &blocks[block]));
+        }
+        uint64_t offset = 0;
+        builder.AppendWord(offset);
+        for (const std::string& block : blocks) {
+          offset += block.size();
+          builder.AppendWord(offset);
+        }
+        for (const std::string& block : blocks) {
+          builder.AppendBytes(block);
+        }
+        builder.Align();
+        break;
+      }
+    }
+  }
+
+  std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+  stream.write(builder.contents().data(), builder.contents().size());
+  stream.close();
+  if (!stream) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "Unable to write " << path;
+  }
+  return zetasql_base::OkStatus();
+}
+
+}  // namespace zetasql
@@ -0,0 +1,114 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// A SimpleTable whose contents are read in place from a memory-mapped
+// columnar file, and the writer for such files. Loading the table only maps
+// the file and checks its layout, so it takes constant time and memory
+// regardless of the number of rows. The evaluator reads the columns with
+// EvaluatorTableIterator::NextColumnBatch(), which hands out INT64, DOUBLE,
+// BOOL and STRING columns straight from the mapping.
+//
+// Example:
+//   MappedColumnarTableWriter writer({types::Int64Type(),
+//                                     types::StringType()});
+//   ZETASQL_RETURN_IF_ERROR(
+//       writer.AddRow({Value::Int64(1), Value::String("a")}));
+//   ZETASQL_RETURN_IF_ERROR(writer.WriteToFile(path));
+//
+//   MappedColumnarTable table("t", {{"key", types::Int64Type()},
+//                                   {"value", types::StringType()}});
+//   ZETASQL_RETURN_IF_ERROR(table.SetContentsFromFile(path));
+//
+// The file starts with the magic "ZSQLCOL1" and then holds little-endian
+// 64-bit words, with every section aligned to 8 bytes:
+//   header:  number of rows, number of columns, then the TypeKind and the file
+//            offset of each column
+//   column:  flags (bit 0 is set if the column has NULLs), the validity bitmap
+//            if it does, and the values:
+//     INT64, DOUBLE:  one word per row (0 for NULL)
+//     BOOL:           a bitmap
+//     STRING:         number of rows + 1 offsets into the string data that
+//                     follows them
+//     Other types:    blocks of kRowsPerBlock rows, each encoded with
+//                     EncodeValues(): the number of blocks + 1 offsets into
+//                     the block data that follows them
+// Bitmaps are LSB-first, as in EvaluatorTableColumnBatch. The TypeKinds are
+// checked against the columns of the table, but the full types are not
+// stored in the file.
+
+#ifndef ZETASQL_PUBLIC_MAPPED_COLUMNAR_TABLE_H_
+#define ZETASQL_PUBLIC_MAPPED_COLUMNAR_TABLE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+class MappedColumnarTable : public SimpleTable {
+ public:
+  // The number of rows in each EncodeValues() block of a column that is not
+  // INT64, DOUBLE, BOOL or STRING. Batches returned by the iterators do not
+  // cross block boundaries.
+  static constexpr int64_t kRowsPerBlock = 1024;
+
+  using SimpleTable::SimpleTable;
+
+  MappedColumnarTable(const MappedColumnarTable&) = delete;
+  MappedColumnarTable& operator=(const MappedColumnarTable&) = delete;
+
+  // Maps the file at 'path', which must have been written by a
+  // MappedColumnarTableWriter for the types of the columns of this table, and
+  // sets up CreateEvaluatorTableIterator() to read from it. Also sets the row
+  // count estimate. Replaces any previous contents or evaluator table
+  // iterator factory. The mapping stays alive until this table and all the
+  // iterators and Values that refer to it are destroyed.
+  zetasql_base::Status SetContentsFromFile(const std::string& path);
+};
+
+// Collects rows in memory and writes them as a file for
+// MappedColumnarTable::SetContentsFromFile().
+class MappedColumnarTableWriter {
+ public:
+  explicit MappedColumnarTableWriter(std::vector<const Type*> column_types);
+
+  MappedColumnarTableWriter(const MappedColumnarTableWriter&) = delete;
+  MappedColumnarTableWriter& operator=(const MappedColumnarTableWriter&) =
+      delete;
+
+  // Appends a row, which must have a Value of the corresponding type for
+  // each column.
+  zetasql_base::Status AddRow(absl::Span<const Value> row);
+
+  // Writes the rows added so far to the file at 'path', replacing it.
+  zetasql_base::Status WriteToFile(const std::string& path) const;
+
+ private:
+  const std::vector<const Type*> column_types_;
+  // The values of each column, one per row.
+  std::vector<std::vector<Value>> columns_;
+  int64_t num_rows_ = 0;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_MAPPED_COLUMNAR_TABLE_H_
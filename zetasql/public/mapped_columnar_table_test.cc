@@ -0,0 +1,188 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/mapped_columnar_table.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/evaluator.h"
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+namespace zetasql {
+namespace {
+
+using ::testing::HasSubstr;
+using ::zetasql_base::testing::StatusIs;
+
+constexpr int64_t kNumRows = 2500;
+
+// Returns row 'i' of the test table. Every column is NULL in every seventh
+// row.
+std::vector<Value> MakeRow(int64_t i) {
+  if (i % 7 == 3) {
+    return {Value::NullInt64(), Value::NullDouble(), Value::NullBool(),
+            Value::NullString(), Value::NullDate(),
+            Value::Null(types::Int64ArrayType())};
+  }
+  return {Value::Int64(i),
+          Value::Double(i / 4.0),
+          Value::Bool(i % 3 == 0),
+          Value::String(absl::StrCat("s", i)),
+          Value::Date(i),
+          Value::Array(types::Int64ArrayType(),
+                       {Value::Int64(i), Value::Int64(-i)})};
+}
+
+class MappedColumnarTableTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = absl::StrCat(testing::TempDir(), "/mapped_columnar_table");
+    MappedColumnarTableWriter writer(
+        {types::Int64Type(), types::DoubleType(), types::BoolType(),
+         types::StringType(), types::DateType(), types::Int64ArrayType()});
+    for (int64_t i = 0; i < kNumRows; ++i) {
+      ZETASQL_ASSERT_OK(writer.AddRow(MakeRow(i)));
+    }
+    ZETASQL_ASSERT_OK(writer.WriteToFile(path_));
+
+    table_ = absl::make_unique<MappedColumnarTable>(
+        "T", std::vector<SimpleTable::NameAndType>{
+                 {"i", types::Int64Type()},
+                 {"d", types::DoubleType()},
+                 {"b", types::BoolType()},
+                 {"s", types::StringType()},
+                 {"dt", types::DateType()},
+                 {"a", types::Int64ArrayType()}});
+    ZETASQL_ASSERT_OK(table_->SetContentsFromFile(path_));
+  }
+
+  std::string path_;
+  std::unique_ptr<MappedColumnarTable> table_;
+};
+
+TEST_F(MappedColumnarTableTest, ReadsRows) {
+  EXPECT_EQ(kNumRows, table_->GetRowCountEstimate());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       table_->CreateEvaluatorTableIterator({5, 3, 0}));
+  ASSERT_EQ(3, iter->NumColumns());
+  EXPECT_EQ("a", iter->GetColumnName(0));
+  int64_t num_rows = 0;
+  while (iter->NextRow()) {
+    const std::vector<Value> expected = MakeRow(num_rows);
+    EXPECT_EQ(expected[5], iter->GetValue(0)) << num_rows;
+    EXPECT_EQ(expected[3], iter->GetValue(1)) << num_rows;
+    EXPECT_EQ(expected[0], iter->GetValue(2)) << num_rows;
+    ++num_rows;
+  }
+  ZETASQL_EXPECT_OK(iter->Status());
+  EXPECT_EQ(kNumRows, num_rows);
+}
+
+TEST_F(MappedColumnarTableTest, ReadsColumnBatches) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       table_->CreateEvaluatorTableIterator({0, 1, 2, 3, 4}));
+  ASSERT_TRUE(iter->SupportsColumnBatches());
+  // Batches of 100 rows do not start on bitmap byte boundaries and are cut at
+  // the end of each block.
+  EvaluatorTableColumnBatch batch;
+  int64_t start = 0;
+  std::vector<int64_t> batch_sizes;
+  while (iter->NextColumnBatch(100, &batch)) {
+    batch_sizes.push_back(batch.num_rows);
+    ASSERT_EQ(5, batch.columns.size());
+    for (int64_t row = 0; row < batch.num_rows; ++row) {
+      const std::vector<Value> expected = MakeRow(start + row);
+      const bool is_null = expected[0].is_null();
+      for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(is_null, batch.columns[i].IsNull(row)) << start + row;
+      }
+      if (is_null) continue;
+      EXPECT_EQ(expected[0].int64_value(),
+                batch.columns[0].int64_values[row]);
+      EXPECT_EQ(expected[1].double_value(),
+                batch.columns[1].double_values[row]);
+      EXPECT_EQ(expected[2].bool_value(),
+                EvaluatorTableColumnBatch::Column::GetBit(
+                    batch.columns[2].bool_bitmap, row));
+      EXPECT_EQ(expected[3].string_value(),
+                batch.columns[3].string_values[row]);
+      EXPECT_EQ(expected[4], batch.columns[4].values[row]);
+    }
+    start += batch.num_rows;
+  }
+  ZETASQL_EXPECT_OK(iter->Status());
+  EXPECT_EQ(kNumRows, start);
+  // 11 batches for each of the two full blocks and 5 for the last one.
+  EXPECT_EQ(11 + 11 + 5, batch_sizes.size());
+  EXPECT_EQ(24, batch_sizes[10]);
+}
+
+TEST_F(MappedColumnarTableTest, Query) {
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(table_->Name(), table_.get());
+  catalog.AddZetaSQLFunctions();
+  PreparedQuery query(
+      "SELECT COUNT(*), SUM(i), COUNTIF(b), MAX(s), MAX(ARRAY_LENGTH(a)) "
+      "FROM T WHERE d >= 600",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  ASSERT_TRUE(iter->NextRow());
+  int64_t count = 0, sum = 0, num_true = 0;
+  for (int64_t i = 2400; i < kNumRows; ++i) {
+    if (i % 7 == 3) continue;
+    ++count;
+    sum += i;
+    if (i % 3 == 0) ++num_true;
+  }
+  EXPECT_EQ(Value::Int64(count), iter->GetValue(0));
+  EXPECT_EQ(Value::Int64(sum), iter->GetValue(1));
+  EXPECT_EQ(Value::Int64(num_true), iter->GetValue(2));
+  EXPECT_EQ(Value::String("s2499"), iter->GetValue(3));
+  EXPECT_EQ(Value::Int64(2), iter->GetValue(4));
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+}
+
+TEST_F(MappedColumnarTableTest, Errors) {
+  MappedColumnarTable wrong_types("W", {{"i", types::StringType()}});
+  EXPECT_THAT(wrong_types.SetContentsFromFile(path_),
+              StatusIs(zetasql_base::INVALID_ARGUMENT, HasSubstr("columns")));
+
+  MappedColumnarTableWriter writer({types::Int64Type()});
+  EXPECT_THAT(writer.AddRow({Value::String("x")}),
+              StatusIs(zetasql_base::INVALID_ARGUMENT));
+
+  const std::string bad_path = path_ + ".bad";
+  std::ofstream(bad_path, std::ios::binary | std::ios::trunc) << "not a table";
+  EXPECT_THAT(table_->SetContentsFromFile(bad_path),
+              StatusIs(zetasql_base::OUT_OF_RANGE, HasSubstr("magic")));
+}
+
+}  // namespace
+}  // namespace zetasql
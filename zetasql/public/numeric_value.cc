@@ -34,6 +34,7 @@
 #include "absl/base/optimization.h"
 #include "zetasql/base/status.h"
 #include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "zetasql/base/bits.h"
@@ -343,6 +344,70 @@ bool ParseNumber(absl::string_view int_part, absl::string_view fract_part,
 }
 #undef RETURN_FALSE_IF
 
+// Parses 'str' if it is a plain decimal number with at most 10 integer digits
+// and at most kMaxFractionalDigits fractional digits, e.g. "-123.45", which is
+// the common case when casting strings to NUMERIC. The absolute value of the
+// result then fits in a uint64_t, so the digits are accumulated without
+// FixedUint arithmetic. No rounding is needed, so the strict and non-strict
+// modes agree. Returns false for anything else, including whitespace,
+// exponents and invalid input, which are left to the general parser.
+bool ParseShortDecimal(absl::string_view str, __int128* packed) {
+  constexpr int kMaxShortIntegerDigits = 10;
+  static_assert(kMaxShortIntegerDigits + kMaxFractionalDigits <=
+                    std::numeric_limits<uint64_t>::digits10,
+                "The scaled value must fit in a uint64_t");
+  const char* ptr = str.data();
+  const char* const end = ptr + str.size();
+  bool negative = false;
+  if (ptr < end && (*ptr == '-' || *ptr == '+')) {
+    negative = *ptr == '-';
+    ++ptr;
+  }
+  uint64_t value = 0;
+  int num_digits = 0;
+  for (; ptr < end && absl::ascii_isdigit(*ptr); ++ptr) {
+    if (ABSL_PREDICT_FALSE(++num_digits > kMaxShortIntegerDigits)) {
+      return false;
+    }
+    value = value * 10 + (*ptr - '0');
+  }
+  int num_fract_digits = 0;
+  if (ptr < end && *ptr == '.') {
+    for (++ptr; ptr < end && absl::ascii_isdigit(*ptr); ++ptr) {
+      if (ABSL_PREDICT_FALSE(++num_fract_digits > kMaxFractionalDigits)) {
+        return false;
+      }
+      value = value * 10 + (*ptr - '0');
+    }
+  }
+  if (ptr != end || num_digits + num_fract_digits == 0) return false;
+
+  static constexpr std::array<uint64_t, kMaxFractionalDigits + 1>
+      kPowersOf10 = PowersAsc<uint64_t, 1, 10, kMaxFractionalDigits + 1>();
+  value *= kPowersOf10[kMaxFractionalDigits - num_fract_digits];
+  *packed = negative ? -static_cast<__int128>(value) : value;
+  return true;
+}
+
+// Appends the kMaxFractionalDigits digits of 'fract_part', a value below
+// kScalingFactor, to 'output' after a decimal point, without trailing zeros.
+// Appends nothing if 'fract_part' is zero.
+void AppendFractionalDigits(uint32_t fract_part, std::string* output) {
+  if (fract_part == 0) return;
+  char digits[kMaxFractionalDigits];
+  int num_digits = kMaxFractionalDigits;
+  // Skips the trailing zeros before writing the other digits.
+  for (; fract_part % 10 == 0; fract_part /= 10) {
+    --num_digits;
+  }
+  for (int i = num_digits - 1; i >= 0; --i) {
+    digits[i] = '0' + fract_part % 10;
+    fract_part /= 10;
+  }
+  output->push_back('.');
+  output->append(digits, num_digits);
+}
+
 // Computes static_cast<double>(value / kScalingFactor) with minimal precision
 // loss.
 double RemoveScaleAndConvertToDouble(__int128 value) {
@@ -400,16 +465,32 @@ size_t NumericValue::HashCode() const {
 }
 
 void NumericValue::AppendToString(std::string* output) const {
-  if (as_packed_int() == 0) {
-    output->push_back('0');
-    return;
+  const __int128 value = as_packed_int();
+  if (value < 0) {
+    output->push_back('-');
   }
-  size_t old_size = output->size();
-  FixedInt<64, 2> value(as_packed_int());
-  value.AppendToString(output);
-  size_t first_digit_index = old_size + value.is_negative();
-  AddDecimalPointAndAdjustZeros(first_digit_index, kMaxFractionalDigits,
-                                output);
+  const unsigned __int128 abs_value = int128_abs(value);
+  // Splits off the fractional digits with a single division, and formats the
+  // integer part with 64-bit arithmetic whenever it fits. Values below 1.8e10
+  // need no 128-bit arithmetic at all.
+  uint64_t int_part;
+  uint32_t fract_part;
+  if (ABSL_PREDICT_TRUE(abs_value <= std::numeric_limits<uint64_t>::max())) {
+    const uint64_t abs_value64 = static_cast<uint64_t>(abs_value);
+    int_part = abs_value64 / kScalingFactor;
+    fract_part = static_cast<uint32_t>(abs_value64 % kScalingFactor);
+  } else {
+    FixedUint<64, 2> quotient(abs_value);
+    quotient.DivMod(kScalingFactor, &quotient, &fract_part);
+    if (quotient.number()[1] != 0) {
+      quotient.AppendToString(output);
+      AppendFractionalDigits(fract_part, output);
+      return;
+    }
+    int_part = quotient.number()[0];
+  }
+  absl::StrAppend(output, int_part);
+  AppendFractionalDigits(fract_part, output);
 }
 
 // Parses a textual representation of a NUMERIC value. Returns an error if the
@@ -420,6 +501,10 @@ void NumericValue::AppendToString(std::string* output) const {
 // digits.
 zetasql_base::StatusOr<NumericValue> NumericValue::FromStringInternal(
     absl::string_view str, bool is_strict) {
+  __int128 packed;
+  if (ParseShortDecimal(str, &packed)) {
+    return NumericValue(packed);
+  }
   ENotationParts parts;
   int64_t exp;
   FixedUint<64, 2> abs;
@@ -554,6 +639,39 @@ zetasql_base::StatusOr<NumericValue> NumericValue::Multiply(NumericValue rh) con
                          << rh.ToString();
 }
 
+zetasql_base::Status NumericValue::MultiplyBatch(NumericValue factor,
+                                         absl::Span<const NumericValue> values,
+                                         absl::Span<NumericValue> results) {
+  DCHECK_EQ(values.size(), results.size());
+  const __int128 packed_factor = factor.as_packed_int();
+  const __int128 integer_factor = packed_factor / kScalingFactor;
+  if (integer_factor * kScalingFactor != packed_factor ||
+      integer_factor < std::numeric_limits<int64_t>::min() ||
+      integer_factor > std::numeric_limits<int64_t>::max()) {
+    for (size_t i = 0; i < values.size(); ++i) {
+      ZETASQL_ASSIGN_OR_RETURN(results[i], values[i].Multiply(factor));
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  // The product of a scaled value and an integer is already scaled, so it
+  // only needs a range check.
+  const FixedInt<64, 3> max_value(internal::kNumericMax);
+  const FixedInt<64, 3> min_value(internal::kNumericMin);
+  const FixedInt<64, 1> multiplier(static_cast<int64_t>(integer_factor));
+  for (size_t i = 0; i < values.size(); ++i) {
+    const FixedInt<64, 3> product = ExtendAndMultiply(
+        FixedInt<64, 2>(values[i].as_packed_int()), multiplier);
+    if (ABSL_PREDICT_FALSE(product > max_value || product < min_value)) {
+      return MakeEvalError() << "numeric overflow: " << values[i].ToString()
+                             << " * " << factor.ToString();
+    }
+    // We already checked the value range, so no need to call FromPackedInt.
+    results[i] = NumericValue(static_cast<__int128>(product));
+  }
+  return zetasql_base::OkStatus();
+}
+
 NumericValue NumericValue::Abs(NumericValue value) {
   // The result is expected to be within the valid range.
   return NumericValue(static_cast<__int128>(int128_abs(value.as_packed_int())));
@@ -997,6 +1115,24 @@ zetasql_base::StatusOr<NumericValue> NumericValue::SumAggregator::GetAverage(
   return MakeEvalError() << "numeric overflow: AVG";
 }
 
+void NumericValue::SumAggregator::AddBatch(
+    absl::Span<const NumericValue> values) {
+  // Each value is high_bits_ * 2^64 + low_bits_ with a signed high_bits_.
+  // Neither partial sum can overflow for fewer than 2^63 values.
+  __int128 high_sum = 0;
+  unsigned __int128 low_sum = 0;
+  for (NumericValue value : values) {
+    high_sum += static_cast<int64_t>(value.high_bits_);
+    low_sum += value.low_bits_;
+  }
+  FixedInt<64, 3> sum(high_sum);
+  sum <<= 64;
+  sum += FixedInt<64, 3>(std::array<uint64_t, 3>{
+      static_cast<uint64_t>(low_sum), static_cast<uint64_t>(low_sum >> 64),
+      0});
+  sum_ += sum;
+}
+
 void NumericValue::SumAggregator::MergeWith(const SumAggregator& other) {
   sum_ += other.sum_;
 }
@@ -32,6 +32,7 @@
 #include "absl/base/port.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "zetasql/base/status_builder.h"
 #include "zetasql/base/statusor.h"
 
@@ -101,6 +102,16 @@ class NumericValue final {
   zetasql_base::StatusOr<NumericValue> Multiply(NumericValue rh) const;
   zetasql_base::StatusOr<NumericValue> Divide(NumericValue rh) const;
 
+  // Sets each element of 'results' to the product of 'factor' and the
+  // corresponding element of 'values', which must have the same size. Returns
+  // OUT_OF_RANGE error on overflow, in which case some of 'results' may have
+  // been set. Equivalent to calling Multiply() for each element, but much
+  // faster when 'factor' is an integer, because the products then need no
+  // rescaling (i.e., no 256-bit division by the scaling factor).
+  static zetasql_base::Status MultiplyBatch(NumericValue factor,
+                                    absl::Span<const NumericValue> values,
+                                    absl::Span<NumericValue> results);
+
   // An integer division operation. Similar to general division followed by
   // truncating the result to the whole integer. May return OUT_OF_RANGE if an
   // overflow or division by zero happens. This operation is the same as the SQL
@@ -203,6 +214,14 @@ class NumericValue final {
    public:
     // Adds a NUMERIC value to the input.
     void Add(NumericValue value);
+    // Adds all of 'values' to the input. Same as calling Add() for each of
+    // them, but faster for long inputs: the high and low 64 bits of the values
+    // are summed into two independent 128-bit accumulators, and the 192-bit
+    // sum is updated once per call.
+    void AddBatch(absl::Span<const NumericValue> values);
+    // Removes a NUMERIC value that was added before from the input, e.g. when
+    // it leaves a sliding window.
+    void Subtract(NumericValue value);
     // Returns sum of all input values. Returns OUT_OF_RANGE error on overflow.
     zetasql_base::StatusOr<NumericValue> GetSum() const;
     // Returns sum of all input values divided by the specified divisor.
@@ -782,6 +801,10 @@ inline void NumericValue::SumAggregator::Add(NumericValue value) {
   sum_ += FixedInt<64, 3>(value.as_packed_int());
 }
 
+inline void NumericValue::SumAggregator::Subtract(NumericValue value) {
+  sum_ -= FixedInt<64, 3>(value.as_packed_int());
+}
+
 inline constexpr unsigned __int128 BigNumericValue::ScalingFactor() {
   return internal::k1e38;
 }
@@ -527,6 +527,56 @@ TEST_F(NumericValueTest, FromString) {
   }
 }
 
+TEST_F(NumericValueTest, FromString_ShortDecimals) {
+  // Short plain decimals are parsed by a fast path. Appending "e0" sends the
+  // same number through the general parser.
+  const char* const kSigns[] = {"", "-", "+"};
+  for (int i = 0; i < 10000; ++i) {
+    std::string str = kSigns[absl::Uniform<int32_t>(random_, 0, 3)];
+    const int32_t int_digits = absl::Uniform<int32_t>(random_, 0, 13);
+    const int32_t fract_digits = absl::Uniform<int32_t>(random_, -1, 11);
+    for (int j = 0; j < int_digits; ++j) {
+      str.push_back(static_cast<char>(absl::Uniform<int32_t>(random_, 0, 10)) +
+                    '0');
+    }
+    if (fract_digits >= 0) {
+      str.push_back('.');
+      for (int j = 0; j < fract_digits; ++j) {
+        str.push_back(
+            static_cast<char>(absl::Uniform<int32_t>(random_, 0, 10)) + '0');
+      }
+    }
+    const std::string general_str = absl::StrCat(str, "e0");
+    for (const bool strict : {false, true}) {
+      const zetasql_base::StatusOr<NumericValue> value =
+          strict ? NumericValue::FromStringStrict(str)
+                 : NumericValue::FromString(str);
+      const zetasql_base::StatusOr<NumericValue> expected =
+          strict ? NumericValue::FromStringStrict(general_str)
+                 : NumericValue::FromString(general_str);
+      ASSERT_EQ(expected.ok(), value.ok()) << str;
+      if (value.ok()) {
+        EXPECT_EQ(expected.ValueOrDie(), value.ValueOrDie()) << str;
+      }
+    }
+  }
+}
+
+TEST_F(NumericValueTest, ToString_RandomRoundTrip) {
+  for (int i = 0; i < 10000; ++i) {
+    const NumericValue value = MakeRandomNumeric();
+    const std::string str = value.ToString();
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        NumericValue parsed,
+        NumericValue::FromStringStrict(absl::StrCat(str, "e0")));
+    EXPECT_EQ(value, parsed) << str;
+    EXPECT_FALSE(absl::EndsWith(str, ".")) << str;
+    if (absl::StrContains(str, '.')) {
+      EXPECT_FALSE(absl::EndsWith(str, "0")) << str;
+    }
+  }
+}
+
 // A lite version of Status that allows instantiation with constexpr.
 struct Error : absl::string_view {
   constexpr explicit Error(absl::string_view message_prefix)
@@ -1018,6 +1068,48 @@ TEST_F(NumericValueTest, Multiply_AllPrecisionCombinations) {
   }
 }
 
+TEST_F(NumericValueTest, MultiplyBatch) {
+  std::vector<NumericValue> values;
+  for (__int128 packed : kNumericValidPackedValues) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(NumericValue value,
+                         NumericValue::FromPackedInt(packed));
+    values.push_back(value);
+  }
+  // Integer factors take the fast path, the others fall back to Multiply().
+  for (absl::string_view factor_str :
+       {"0", "1", "-1", "3", "-1000000007", "9223372036854775807",
+        "-9223372036854775808", "9223372036854775808", "0.5", "-2.000000001"}) {
+    NumericValue factor = MkNumeric(std::string(factor_str));
+    for (const NumericValue& value : values) {
+      const zetasql_base::StatusOr<NumericValue> expected = value.Multiply(factor);
+      NumericValue result;
+      const zetasql_base::Status status =
+          NumericValue::MultiplyBatch(factor, {value}, {&result, 1});
+      if (expected.ok()) {
+        ZETASQL_ASSERT_OK(status);
+        EXPECT_EQ(expected.ValueOrDie(), result)
+            << value.ToString() << " * " << factor_str;
+      } else {
+        EXPECT_EQ(expected.status(), status);
+      }
+    }
+  }
+
+  std::vector<NumericValue> results(3);
+  ZETASQL_ASSERT_OK(NumericValue::MultiplyBatch(
+      NumericValue(2),
+      {MkNumeric("1.5"), MkNumeric("-1e-9"), NumericValue(-7)},
+      absl::MakeSpan(results)));
+  EXPECT_THAT(results, testing::ElementsAre(NumericValue(3), MkNumeric("-2e-9"),
+                                            NumericValue(-14)));
+  EXPECT_THAT(NumericValue::MultiplyBatch(
+                  NumericValue(2), {NumericValue(1), NumericValue::MaxValue()},
+                  absl::MakeSpan(results).subspan(0, 2)),
+              StatusIs(zetasql_base::OUT_OF_RANGE,
+                       absl::StrCat("numeric overflow: ", kMaxNumericValueStr,
+                                    " * 2")));
+}
+
 TEST_F(NumericValueTest, UnaryMinus) {
   EXPECT_EQ(NumericValue(0), NumericValue::UnaryMinus(NumericValue(0)));
   EXPECT_EQ(NumericValue(-1), NumericValue::UnaryMinus(NumericValue(1)));
@@ -1773,6 +1865,23 @@ TEST(NumericSumAggregatorTest, Avg) {
   }
 }
 
+TEST(NumericSumAggregatorTest, Subtract) {
+  NumericValue::SumAggregator aggregator;
+  const NumericValue max = NumericValue::MaxValue();
+  aggregator.Add(max);
+  aggregator.Add(max);
+  EXPECT_THAT(aggregator.GetSum(),
+              StatusIs(zetasql_base::OUT_OF_RANGE, "numeric overflow: SUM"));
+  // The sum is back in range once a value is removed.
+  aggregator.Subtract(max);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(NumericValue sum, aggregator.GetSum());
+  EXPECT_EQ(max, sum);
+  aggregator.Add(NumericValue(-3));
+  aggregator.Subtract(max);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(sum, aggregator.GetSum());
+  EXPECT_EQ(NumericValue(-3), sum);
+}
+
 TEST(NumericSumAggregatorTest, MergeWith) {
   constexpr int kNumInputs = ABSL_ARRAYSIZE(kSumAggregatorTestData);
   // aggregators[j][k] is the sum of the inputs with indexes in [j, k).
@@ -1802,6 +1911,48 @@ TEST(NumericSumAggregatorTest, MergeWith) {
   }
 }
 
+TEST(NumericSumAggregatorTest, AddBatch) {
+  std::vector<NumericValue> inputs;
+  for (const SumAggregatorTestData& data : kSumAggregatorTestData) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(NumericValue input, GetValue(data.input));
+    inputs.push_back(input);
+  }
+  for (__int128 packed : kNumericValidPackedValues) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(NumericValue input,
+                         NumericValue::FromPackedInt(packed));
+    inputs.push_back(input);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    inputs.push_back(i % 2 == 0 ? NumericValue::MaxValue()
+                                : NumericValue::MinValue());
+  }
+
+  // Every split of the inputs into two batches yields the same aggregator as
+  // adding the inputs one at a time, including when intermediate sums
+  // overflow.
+  NumericValue::SumAggregator expected;
+  for (NumericValue input : inputs) {
+    expected.Add(input);
+  }
+  const absl::Span<const NumericValue> span(inputs);
+  for (size_t i = 0; i <= inputs.size(); i += 7) {
+    NumericValue::SumAggregator aggregator;
+    aggregator.AddBatch(span.subspan(0, i));
+    aggregator.AddBatch(span.subspan(i));
+    EXPECT_EQ(expected, aggregator) << i;
+  }
+
+  NumericValue::SumAggregator aggregator;
+  aggregator.AddBatch(
+      std::vector<NumericValue>(10, NumericValue::MaxValue()));
+  EXPECT_THAT(aggregator.GetSum(), StatusIs(zetasql_base::OUT_OF_RANGE));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(NumericValue avg, aggregator.GetAverage(10));
+  EXPECT_EQ(NumericValue::MaxValue(), avg);
+  aggregator.AddBatch(std::vector<NumericValue>(10, NumericValue::MinValue()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(NumericValue sum, aggregator.GetSum());
+  EXPECT_EQ(NumericValue(0), sum);
+}
+
 TYPED_TEST(AggregatorSerializationByTypeTest, AggregatorSerialization) {
   this->TestSerializeAggregator({NumericValue()});
   this->TestSerializeAggregator({NumericValue(1)});
@@ -38,6 +38,16 @@ zetasql_base::Status IsValidStatementSyntax(absl::string_view sql,
   return MaybeUpdateErrorFromPayload(error_message_mode, sql, parse_status);
 }
 
+zetasql_base::Status IsValidStatementSyntax(absl::string_view sql,
+                                    ErrorMessageMode error_message_mode,
+                                    const LanguageOptions& language_options,
+                                    ParserOutputCache* cache) {
+  std::shared_ptr<const ParserOutput> parser_output;
+  const zetasql_base::Status parse_status =
+      cache->ParseStatement(sql, language_options, &parser_output);
+  return MaybeUpdateErrorFromPayload(error_message_mode, sql, parse_status);
+}
+
 zetasql_base::Status IsValidNextStatementSyntax(ParseResumeLocation* resume_location,
                                         ErrorMessageMode error_message_mode,
                                         bool* at_end_of_input) {
@@ -181,11 +191,14 @@ zetasql_base::Status GetNextStatementProperties(
     const ParseResumeLocation& resume_location,
     const LanguageOptions& language_options,
     StatementProperties* statement_properties) {
+  ZETASQL_RETURN_IF_ERROR(resume_location.Validate());
+
   // Parsing the next statement properties may return an AST for statement
-  // level hints, so we create an arena here to own the AST nodes.
-  ParserOptions parser_options;
-  parser_options.set_language_options(&language_options);
-  parser_options.CreateDefaultArenasIfNotSet();
+  // level hints, so the parser needs arenas that own the AST nodes. They are
+  // only created if the statement kind cannot be determined from its first
+  // keyword, since the first keyword alone means there are no hints.
+  ParserOptions parser_options(/*id_string_pool=*/nullptr, /*arena=*/nullptr,
+                               &language_options);
 
   parser::ASTStatementProperties ast_statement_properties;
   // Since the ASTStatementProperties will include the ASTHint node if
@@ -193,9 +206,13 @@ zetasql_base::Status GetNextStatementProperties(
   // ASTNodes.
   std::vector<std::unique_ptr<ASTNode>> allocated_ast_nodes;
 
-  ZETASQL_RETURN_IF_ERROR(ParseNextStatementProperties(
-      resume_location, parser_options, &allocated_ast_nodes,
-      &ast_statement_properties));
+  if (!ParseNextStatementKindFromFirstKeyword(
+          resume_location, &ast_statement_properties.node_kind)) {
+    parser_options.CreateDefaultArenasIfNotSet();
+    ZETASQL_RETURN_IF_ERROR(ParseNextStatementProperties(
+        resume_location, parser_options, &allocated_ast_nodes,
+        &ast_statement_properties));
+  }
 
   statement_properties->node_kind =
       GetStatementKind(ast_statement_properties.node_kind);
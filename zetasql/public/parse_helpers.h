@@ -21,6 +21,7 @@
 
 #include "zetasql/parser/ast_node_kind.h"
 #include "zetasql/parser/parser.h"
+#include "zetasql/parser/parser_output_cache.h"
 #include "zetasql/public/options.pb.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "absl/container/flat_hash_map.h"
@@ -40,6 +41,15 @@ struct ParseResumeLocation;
 zetasql_base::Status IsValidStatementSyntax(absl::string_view sql,
                                     ErrorMessageMode error_message_mode);
 
+// Like the previous, but parses with <language_options> and looks up the
+// parse in <cache>, or adds it there. Later consumers of the same SQL, e.g.
+// AnalyzeStatement() with AnalyzerOptions::set_parser_output_cache(), then
+// reuse the parse instead of parsing again.
+zetasql_base::Status IsValidStatementSyntax(absl::string_view sql,
+                                    ErrorMessageMode error_message_mode,
+                                    const LanguageOptions& language_options,
+                                    ParserOutputCache* cache);
+
 // Similar to the previous, but checks the validity of the next statement
 // starting from <resume_location>.  If the syntax is valid then returns OK
 // and sets <at_end_of_input> and updates <resume_location> to indicate the
@@ -16,10 +16,13 @@
 
 #include "zetasql/public/parse_helpers.h"
 
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "zetasql/common/status_payload_utils.h"
 #include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/parser/parser.h"
 #include "zetasql/public/parse_resume_location.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -336,6 +339,48 @@ TEST(GetNextStatementKindAndPropertiesTest, BasicStatements) {
   }
 }
 
+TEST(GetNextStatementKindAndPropertiesTest, FirstKeyword) {
+  const std::vector<std::pair<std::string, ASTNodeKind>> statements = {
+      {"select 1", AST_QUERY_STATEMENT},
+      {" /* comment */ -- comment\n# comment\n((WITH", AST_QUERY_STATEMENT},
+      {"Insert INTO T VALUES (1)", AST_INSERT_STATEMENT},
+      {"DELETE", AST_DELETE_STATEMENT},
+      {"desc T", AST_DESCRIBE_STATEMENT},
+      {"COMMIT 'unterminated", AST_COMMIT_STATEMENT},
+  };
+  for (const auto& statement : statements) {
+    ASTNodeKind node_kind = kUnknownASTNodeKind;
+    EXPECT_TRUE(ParseNextStatementKindFromFirstKeyword(
+        ParseResumeLocation::FromStringView(statement.first), &node_kind))
+        << statement.first;
+    EXPECT_EQ(statement.second, node_kind) << statement.first;
+    bool is_ctas;
+    EXPECT_EQ(statement.second,
+              ParseStatementKind(statement.first, LanguageOptions(), &is_ctas))
+        << statement.first;
+  }
+
+  // The statement kind of these depends on more than the first keyword, or
+  // there are hints that need to be parsed.
+  for (const std::string& sql :
+       {"", "SELECTX 1", "`SELECT`", "@{a=1} SELECT 1", "(INSERT",
+        "CREATE TABLE", "/* unterminated SELECT", "DROP TABLE T",
+        "SET x = 1"}) {
+    ASTNodeKind node_kind;
+    EXPECT_FALSE(ParseNextStatementKindFromFirstKeyword(
+        ParseResumeLocation::FromStringView(sql), &node_kind))
+        << sql;
+  }
+
+  ParseResumeLocation resume_location =
+      ParseResumeLocation::FromStringView("SELECT 1; UPDATE T SET x = 1");
+  resume_location.set_byte_position(9);
+  ASTNodeKind node_kind;
+  EXPECT_TRUE(
+      ParseNextStatementKindFromFirstKeyword(resume_location, &node_kind));
+  EXPECT_EQ(AST_UPDATE_STATEMENT, node_kind);
+}
+
 struct StatementPropertiesTestCase {
   // The SQL string to test
   std::string sql;
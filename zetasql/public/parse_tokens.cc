@@ -64,6 +64,7 @@ static zetasql_base::Status MakeSyntaxErrorAtLocationOffset(
 static zetasql_base::Status ConvertBisonToken(int bison_token,
                                       const ParseLocationRange& location,
                                       std::string image,
+                                      bool include_literal_values,
                                       std::vector<ParseToken>* parse_tokens) {
   using zetasql_bison_parser::BisonParserImpl;
 
@@ -112,6 +113,11 @@ static zetasql_base::Status ConvertBisonToken(int bison_token,
     }
 
     case BisonParserImpl::token::STRING_LITERAL: {
+      if (!include_literal_values) {
+        parse_tokens->emplace_back(location, std::move(image),
+                                   ParseToken::VALUE);
+        break;
+      }
       std::string parsed_value;
       int error_offset;
       std::string error_message;
@@ -127,6 +133,11 @@ static zetasql_base::Status ConvertBisonToken(int bison_token,
     }
 
     case BisonParserImpl::token::BYTES_LITERAL: {
+      if (!include_literal_values) {
+        parse_tokens->emplace_back(location, std::move(image),
+                                   ParseToken::VALUE);
+        break;
+      }
       std::string parsed_value;
       int error_offset;
       std::string error_message;
@@ -142,6 +153,11 @@ static zetasql_base::Status ConvertBisonToken(int bison_token,
     }
 
     case BisonParserImpl::token::FLOATING_POINT_LITERAL: {
+      if (!include_literal_values) {
+        parse_tokens->emplace_back(location, std::move(image),
+                                   ParseToken::VALUE);
+        break;
+      }
       double double_value;
       if (!functions::StringToNumeric(image, &double_value, nullptr)) {
         return MakeSqlErrorAtPoint(location.start())
@@ -153,6 +169,11 @@ static zetasql_base::Status ConvertBisonToken(int bison_token,
     }
 
     case BisonParserImpl::token::INTEGER_LITERAL: {
+      if (!include_literal_values) {
+        parse_tokens->emplace_back(location, std::move(image),
+                                   ParseToken::VALUE);
+        break;
+      }
       Value parsed_value;
       if (!Value::ParseInteger(image, &parsed_value)) {
         return MakeSqlErrorAtPoint(location.start())
@@ -230,9 +251,12 @@ static zetasql_base::Status ConvertBisonToken(int bison_token,
   return ::zetasql_base::OkStatus();
 }
 
-zetasql_base::Status GetParseTokens(const ParseTokenOptions& options,
-                            ParseResumeLocation* resume_location,
-                            std::vector<ParseToken>* tokens) {
+// Tokenizes from <resume_location> and passes each token to <consume>, which
+// returns false to stop. <consume> is a callable taking a ParseToken&&.
+template <class TokenConsumer>
+static zetasql_base::Status GetParseTokensImpl(const ParseTokenOptions& options,
+                                       ParseResumeLocation* resume_location,
+                                       TokenConsumer consume) {
   if (!resume_location->allow_resume()) {
     return MakeSqlError()
            << "GetParseTokens() called on invalid ParseResumeLocation";
@@ -241,7 +265,6 @@ zetasql_base::Status GetParseTokens(const ParseTokenOptions& options,
     resume_location->DisallowResume();
   }
   ZETASQL_RETURN_IF_ERROR(resume_location->Validate());
-  tokens->clear();
 
   auto mode = parser::BisonParserMode::kTokenizer;
   if (options.include_comments) {
@@ -252,6 +275,11 @@ zetasql_base::Status GetParseTokens(const ParseTokenOptions& options,
       mode, resume_location->filename(), resume_location->input(),
       resume_location->byte_position());
 
+  // Holds the one or two ParseTokens of the current bison token.
+  std::vector<ParseToken> tokens;
+  int num_tokens = 0;
+  // The end of the last token that was passed to <consume>.
+  int end_byte_offset = -1;
   ParseLocationRange location;
   while (true) {
     int bison_token;
@@ -262,19 +290,36 @@ zetasql_base::Status GetParseTokens(const ParseTokenOptions& options,
     std::string image(absl::ClippedSubstr(
         resume_location->input(), location.start().GetByteOffset(),
         location.end().GetByteOffset() - location.start().GetByteOffset()));
+    tokens.clear();
     ZETASQL_RETURN_IF_ERROR(ConvertInternalErrorLocationToExternal(
-        ConvertBisonToken(bison_token, location, std::move(image), tokens),
+        ConvertBisonToken(bison_token, location, std::move(image),
+                          options.include_literal_values, &tokens),
         resume_location->input()));
 
-    if (options.max_tokens > 0 && tokens->size() >= options.max_tokens) {
+    bool stop = false;
+    for (ParseToken& token : tokens) {
+      const bool is_semicolon = token.kind() == ParseToken::KEYWORD &&
+                                token.GetImage().substr(0, 1) == ";";
+      end_byte_offset = token.GetLocationRange().end().GetByteOffset();
+      ++num_tokens;
+      if (!consume(std::move(token))) {
+        // The tokenizer state cannot be recreated from a byte position in
+        // the middle of a statement, like with max_tokens.
+        resume_location->DisallowResume();
+        stop = true;
+        break;
+      }
+      if (options.stop_at_end_of_statement && is_semicolon) {
+        stop = true;
+      }
+    }
+    if (stop) {
       break;
     }
-    if (bison_token == 0 /* EOF */) {
+    if (options.max_tokens > 0 && num_tokens >= options.max_tokens) {
       break;
     }
-    if (options.stop_at_end_of_statement &&
-        tokens->back().kind() == ParseToken::KEYWORD &&
-        tokens->back().GetImage().substr(0, 1) == ";") {
+    if (bison_token == 0 /* EOF */) {
       break;
     }
   }
@@ -283,12 +328,30 @@ zetasql_base::Status GetParseTokens(const ParseTokenOptions& options,
   // NOT use the token position directly from the tokenizer. Instead, we
   // take the position from the last token, which should always exist
   // because even if we have no real tokens, we always include an EOF token.
-  ZETASQL_RET_CHECK(!tokens->empty());
-  resume_location->set_byte_position(
-      tokens->back().GetLocationRange().end().GetByteOffset());
+  ZETASQL_RET_CHECK_GE(end_byte_offset, 0);
+  resume_location->set_byte_position(end_byte_offset);
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::Status GetParseTokens(const ParseTokenOptions& options,
+                            ParseResumeLocation* resume_location,
+                            std::vector<ParseToken>* tokens) {
+  tokens->clear();
+  return GetParseTokensImpl(options, resume_location,
+                            [tokens](ParseToken&& token) {
+                              tokens->push_back(std::move(token));
+                              return true;
+                            });
+}
+
+zetasql_base::Status GetParseTokens(const ParseTokenOptions& options,
+                            ParseResumeLocation* resume_location,
+                            const ParseTokenCallback& callback) {
+  return GetParseTokensImpl(
+      options, resume_location,
+      [&callback](ParseToken&& token) { return callback(token); });
+}
+
 std::string ParseToken::GetKeyword() const {
   if (kind_ == KEYWORD) {
     return absl::AsciiStrToUpper(GetImage());
@@ -323,7 +386,8 @@ std::string ParseToken::GetSQL() const {
     case IDENTIFIER:
       return ToIdentifierLiteral(value_.string_value());
     case VALUE:
-      return value_.GetSQL();
+      // Literals have no Value if include_literal_values was false.
+      return value_.is_valid() ? value_.GetSQL() : std::string(GetImage());
     case COMMENT:
       return value_.string_value();
     case END_OF_INPUT:
@@ -17,6 +17,7 @@
 #ifndef ZETASQL_PUBLIC_PARSE_TOKENS_H_
 #define ZETASQL_PUBLIC_PARSE_TOKENS_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -160,6 +161,13 @@ struct ParseTokenOptions {
 
   // Return the comments in the ParseToken vector or silently drop them.
   bool include_comments = false;
+
+  // If false, literals are returned as VALUE tokens without a Value, i.e.
+  // GetValue() returns an invalid Value and GetSQL() returns the image. This
+  // avoids unescaping and copying every literal when only the images and
+  // locations are needed, e.g. for syntax highlighting. Invalid literals, like
+  // strings with invalid escapes, are not reported as errors then.
+  bool include_literal_values = true;
 };
 
 // Gets a vector of ParseTokens starting from <resume_location>, and updates
@@ -204,6 +212,21 @@ zetasql_base::Status GetParseTokens(const ParseTokenOptions& options,
                             ParseResumeLocation* resume_location,
                             std::vector<ParseToken>* tokens);
 
+// Called with each token by the streaming GetParseTokens(). Returns false to
+// stop tokenizing after this token.
+using ParseTokenCallback = std::function<bool(const ParseToken& token)>;
+
+// Like above, but passes the tokens to <callback> one at a time, as they are
+// tokenized, instead of collecting them in a vector. Memory use does not grow
+// with the size of the input, so this can be used for very large inputs.
+// <options> work the same way. If <callback> returns false, this returns OK
+// after that token and <resume_location> cannot be resumed, like with
+// max_tokens. Tokens that were passed to <callback> before an error are not
+// retracted.
+zetasql_base::Status GetParseTokens(const ParseTokenOptions& options,
+                            ParseResumeLocation* resume_location,
+                            const ParseTokenCallback& callback);
+
 }  // namespace zetasql
 
 #endif  // ZETASQL_PUBLIC_PARSE_TOKENS_H_
@@ -149,6 +149,71 @@ TEST(GetNextTokensTest, LargeMaxTokensNotResumable) {
           HasSubstr("GetParseTokens() called on invalid ParseResumeLocation")));
 }
 
+TEST(GetNextTokensTest, LongInputWithOffset) {
+  // Longer than the buffer that the tokenizer reads its input into, so that
+  // the input is read in several chunks.
+  std::string input = "SELECT 1; SELECT x";
+  for (int i = 0; i < 10000; ++i) {
+    absl::StrAppend(&input, ", x", i);
+  }
+  absl::StrAppend(&input, " FROM t");
+  ParseTokenOptions options;
+  std::vector<ParseToken> parse_tokens;
+  ParseResumeLocation location = ParseResumeLocation::FromStringView(input);
+  location.set_byte_position(10);
+
+  ZETASQL_ASSERT_OK(GetParseTokens(options, &location, &parse_tokens));
+  ASSERT_EQ(2 * 10000 + 5, parse_tokens.size());
+  EXPECT_EQ("KEYWORD:SELECT", parse_tokens[0].DebugString());
+  EXPECT_EQ(10, parse_tokens[0].GetLocationRange().start().GetByteOffset());
+  EXPECT_EQ("IDENTIFIER:x9999", parse_tokens[2 * 10000 + 1].DebugString());
+  EXPECT_EQ("IDENTIFIER:t", parse_tokens[2 * 10000 + 3].DebugString());
+  EXPECT_EQ(input.size() - 1,
+            parse_tokens[2 * 10000 + 3].GetLocationRange().start()
+                .GetByteOffset());
+  EXPECT_EQ("EOF", parse_tokens.back().DebugString());
+}
+
+TEST(GetNextTokensTest, Callback) {
+  const std::string input = "SELECT 'a\\x', b\"\\q\", 1.5; SELECT 2";
+  ParseTokenOptions options;
+  options.stop_at_end_of_statement = true;
+  std::vector<ParseToken> parse_tokens;
+  ParseTokenCallback collect = [&parse_tokens](const ParseToken& token) {
+    parse_tokens.push_back(token);
+    return true;
+  };
+
+  // The invalid escapes are an error when the literals are parsed.
+  ParseResumeLocation location = ParseResumeLocation::FromStringView(input);
+  EXPECT_THAT(GetParseTokens(options, &location, collect),
+              StatusIs(_, HasSubstr("Illegal escape sequence")));
+
+  options.include_literal_values = false;
+  parse_tokens.clear();
+  location = ParseResumeLocation::FromStringView(input);
+  ZETASQL_ASSERT_OK(GetParseTokens(options, &location, collect));
+  ASSERT_EQ(7, parse_tokens.size());
+  EXPECT_EQ(ParseToken::VALUE, parse_tokens[1].kind());
+  EXPECT_FALSE(parse_tokens[1].GetValue().is_valid());
+  EXPECT_EQ("VALUE:'a\\x'", parse_tokens[1].DebugString());
+  EXPECT_EQ("VALUE:b\"\\q\"", parse_tokens[3].DebugString());
+  EXPECT_EQ("VALUE:1.5", parse_tokens[5].DebugString());
+  EXPECT_EQ(";", parse_tokens[6].GetKeyword());
+  EXPECT_EQ(input.find(';') + 1, location.byte_position());
+  EXPECT_TRUE(location.allow_resume());
+
+  // Stop after two tokens; the location cannot be resumed then.
+  int num_tokens = 0;
+  ZETASQL_ASSERT_OK(GetParseTokens(options, &location,
+                           [&num_tokens](const ParseToken& token) {
+                             return ++num_tokens < 2;
+                           }));
+  EXPECT_EQ(2, num_tokens);
+  EXPECT_EQ(input.size(), location.byte_position());
+  EXPECT_FALSE(location.allow_resume());
+}
+
 TEST(GetNextTokensTest, PreserveCommentsWithoutEndingNewline) {
   ParseTokenOptions options;
   options.include_comments = true;
@@ -0,0 +1,125 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/prefetching_evaluator_table_iterator.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/time/clock.h"
+#include "zetasql/base/status_builder.h"
+
+namespace zetasql {
+
+PrefetchingEvaluatorTableIterator::PrefetchingEvaluatorTableIterator(
+    std::unique_ptr<EvaluatorTableIterator> iter, const Options& options)
+    : iter_(std::move(iter)),
+      batch_size_(std::max(options.batch_size, 1)),
+      max_buffered_batches_(std::max(options.max_buffered_batches, 1)) {
+  for (int i = 0; i < iter_->NumColumns(); ++i) {
+    column_names_.push_back(iter_->GetColumnName(i));
+    column_types_.push_back(iter_->GetColumnType(i));
+  }
+}
+
+PrefetchingEvaluatorTableIterator::~PrefetchingEvaluatorTableIterator() {
+  if (!started_) return;
+  bool prefetch_done;
+  {
+    absl::MutexLock l(&mutex_);
+    prefetch_done = prefetch_done_;
+    cancelled_ = true;
+  }
+  if (!prefetch_done) iter_->Cancel().IgnoreError();
+  thread_.join();
+}
+
+bool PrefetchingEvaluatorTableIterator::NextRow() {
+  if (done_) return false;
+  if (!started_) {
+    thread_ = std::thread([this] { Prefetch(); });
+    started_ = true;
+  }
+  ++row_in_batch_;
+  if (row_in_batch_ < num_rows_in_batch_) return true;
+
+  absl::MutexLock l(&mutex_);
+  if (!CanPopLocked()) {
+    const absl::Time start_time = absl::Now();
+    mutex_.Await(absl::Condition(
+        this, &PrefetchingEvaluatorTableIterator::CanPopLocked));
+    stall_time_ += absl::Now() - start_time;
+  }
+  if (cancelled_ || batches_.empty()) {
+    done_ = true;
+    if (!prefetch_status_.ok()) {
+      status_ = prefetch_status_;
+    } else if (cancelled_) {
+      status_ = zetasql_base::CancelledErrorBuilder()
+                << "PrefetchingEvaluatorTableIterator was cancelled";
+    }
+    current_batch_.clear();
+    num_rows_in_batch_ = 0;
+    return false;
+  }
+  current_batch_ = std::move(batches_.front());
+  batches_.pop_front();
+  num_rows_in_batch_ = current_batch_.size() / NumValuesPerRow();
+  row_in_batch_ = 0;
+  return true;
+}
+
+zetasql_base::Status PrefetchingEvaluatorTableIterator::Cancel() {
+  {
+    absl::MutexLock l(&mutex_);
+    cancelled_ = true;
+  }
+  return iter_->Cancel();
+}
+
+void PrefetchingEvaluatorTableIterator::Prefetch() {
+  while (true) {
+    RowBatch batch;
+    batch.reserve(static_cast<int64_t>(batch_size_) * NumValuesPerRow());
+    bool end = false;
+    for (int i = 0; i < batch_size_; ++i) {
+      if (!iter_->NextRow()) {
+        end = true;
+        break;
+      }
+      if (column_types_.empty()) {
+        batch.push_back(Value());
+      }
+      for (int j = 0; j < column_types_.size(); ++j) {
+        batch.push_back(iter_->GetValue(j));
+      }
+    }
+
+    absl::MutexLock l(&mutex_);
+    if (!batch.empty()) {
+      mutex_.Await(absl::Condition(
+          this, &PrefetchingEvaluatorTableIterator::CanPushLocked));
+      if (!cancelled_) batches_.push_back(std::move(batch));
+    }
+    if (end) prefetch_status_ = iter_->Status();
+    if (end || cancelled_) {
+      prefetch_done_ = true;
+      return;
+    }
+  }
+}
+
+}  // namespace zetasql
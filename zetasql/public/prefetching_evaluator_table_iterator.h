@@ -0,0 +1,163 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_PREFETCHING_EVALUATOR_TABLE_ITERATOR_H_
+#define ZETASQL_PUBLIC_PREFETCHING_EVALUATOR_TABLE_ITERATOR_H_
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include <cstdint>
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+// An EvaluatorTableIterator that reads the rows of another iterator on a
+// background thread, ahead of the calls to NextRow(), so that an iterator
+// that blocks on remote storage does not stall the evaluation for every row.
+//
+// Example, in an implementation of Table::CreateEvaluatorTableIterator():
+//   std::unique_ptr<EvaluatorTableIterator> iter = ... remote iterator ...
+//   return absl::make_unique<PrefetchingEvaluatorTableIterator>(
+//       std::move(iter), PrefetchingEvaluatorTableIterator::Options());
+//
+// The background thread starts at the first call to NextRow(), after the
+// methods that configure the scan (SetColumnFilterMap(), SetReadTime(),
+// SetDeadline(), etc.) have been forwarded to the wrapped iterator. It reads
+// the wrapped iterator with NextRow() and copies each row, so the wrapper
+// never uses NextColumnBatch(). It stops when at most
+// Options::max_buffered_batches batches of rows are waiting to be returned,
+// when the wrapped iterator is exhausted or fails, or when Cancel() is called.
+// The status of the wrapped iterator is returned by Status() once the rows
+// before the failure have been returned.
+//
+// GetStallTime() returns the time that NextRow() has waited for the
+// background thread, which the evaluator reports in the profile of the scan.
+class PrefetchingEvaluatorTableIterator : public EvaluatorTableIterator {
+ public:
+  struct Options {
+    // The number of rows read from the wrapped iterator at a time.
+    int batch_size = 256;
+    // The maximum number of batches read ahead of NextRow().
+    int max_buffered_batches = 4;
+  };
+
+  PrefetchingEvaluatorTableIterator(
+      std::unique_ptr<EvaluatorTableIterator> iter, const Options& options);
+  PrefetchingEvaluatorTableIterator(const PrefetchingEvaluatorTableIterator&) =
+      delete;
+  PrefetchingEvaluatorTableIterator& operator=(
+      const PrefetchingEvaluatorTableIterator&) = delete;
+
+  // Stops the background thread, cancelling the wrapped iterator if it is
+  // still being read.
+  ~PrefetchingEvaluatorTableIterator() override;
+
+  int NumColumns() const override { return column_types_.size(); }
+  std::string GetColumnName(int i) const override { return column_names_[i]; }
+  const Type* GetColumnType(int i) const override { return column_types_[i]; }
+
+  zetasql_base::Status SetColumnFilterMap(
+      absl::flat_hash_map<int, std::unique_ptr<ColumnFilter>> filter_map)
+      override {
+    return iter_->SetColumnFilterMap(std::move(filter_map));
+  }
+  void SetRowLimitHint(int64_t max_num_rows) override {
+    iter_->SetRowLimitHint(max_num_rows);
+  }
+  bool SetBlockSample(double percent, absl::optional<int64_t> seed) override {
+    return iter_->SetBlockSample(percent, seed);
+  }
+  zetasql_base::Status SetReadTime(absl::Time read_time) override {
+    return iter_->SetReadTime(read_time);
+  }
+  void SetDeadline(absl::Time deadline) override {
+    iter_->SetDeadline(deadline);
+  }
+
+  bool NextRow() override;
+
+  const Value& GetValue(int i) const override {
+    return current_batch_[row_in_batch_ * column_types_.size() + i];
+  }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  // Makes the background thread stop and cancels the wrapped iterator.
+  zetasql_base::Status Cancel() override;
+
+  absl::Duration GetStallTime() const override { return stall_time_; }
+
+ private:
+  // A batch of rows, stored row-major.
+  using RowBatch = std::vector<Value>;
+
+  // The number of values per row in a RowBatch. An iterator without columns
+  // still returns rows, which are stored as one placeholder value each.
+  int NumValuesPerRow() const {
+    return std::max<int>(column_types_.size(), 1);
+  }
+
+  // Runs on 'thread_'. Reads 'iter_' into 'batches_'.
+  void Prefetch() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  bool CanPushLocked() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return cancelled_ || batches_.size() < max_buffered_batches_;
+  }
+  bool CanPopLocked() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return cancelled_ || prefetch_done_ || !batches_.empty();
+  }
+
+  const std::unique_ptr<EvaluatorTableIterator> iter_;
+  const int batch_size_;
+  const int max_buffered_batches_;
+  std::vector<std::string> column_names_;
+  std::vector<const Type*> column_types_;
+
+  // Only accessed by the thread that calls NextRow().
+  bool started_ = false;
+  bool done_ = false;
+  RowBatch current_batch_;
+  int64_t num_rows_in_batch_ = 0;
+  int64_t row_in_batch_ = -1;
+  zetasql_base::Status status_;
+  absl::Duration stall_time_ = absl::ZeroDuration();
+
+  std::thread thread_;
+
+  absl::Mutex mutex_;
+  std::deque<RowBatch> batches_ ABSL_GUARDED_BY(mutex_);
+  // True once 'iter_' is exhausted or has failed, or the thread has stopped
+  // because of 'cancelled_'.
+  bool prefetch_done_ ABSL_GUARDED_BY(mutex_) = false;
+  // The status of 'iter_' when 'prefetch_done_' became true.
+  zetasql_base::Status prefetch_status_ ABSL_GUARDED_BY(mutex_);
+  bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_PREFETCHING_EVALUATOR_TABLE_ITERATOR_H_
@@ -0,0 +1,198 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/prefetching_evaluator_table_iterator.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_builder.h"
+
+namespace zetasql {
+namespace {
+
+using ::testing::HasSubstr;
+using ::zetasql_base::testing::StatusIs;
+
+// Returns 'num_rows' rows with an INT64 column 'x' that counts from 0,
+// sleeping for 'row_delay' before each row, then fails with 'end_status'.
+class TestIterator : public EvaluatorTableIterator {
+ public:
+  TestIterator(int64_t num_rows, const zetasql_base::Status& end_status,
+               absl::Duration row_delay)
+      : num_rows_(num_rows), end_status_(end_status), row_delay_(row_delay) {}
+
+  int NumColumns() const override { return 1; }
+  std::string GetColumnName(int i) const override { return "x"; }
+  const Type* GetColumnType(int i) const override {
+    return types::Int64Type();
+  }
+
+  void SetRowLimitHint(int64_t max_num_rows) override {
+    row_limit_hint_ = max_num_rows;
+  }
+
+  bool NextRow() override {
+    if (cancelled_) return false;
+    absl::SleepFor(row_delay_);
+    if (++row_ >= num_rows_) return false;
+    value_ = Value::Int64(row_);
+    return true;
+  }
+
+  const Value& GetValue(int i) const override { return value_; }
+
+  zetasql_base::Status Status() const override {
+    if (cancelled_) {
+      return zetasql_base::CancelledErrorBuilder()
+             << "TestIterator was cancelled";
+    }
+    return row_ >= num_rows_ ? end_status_ : zetasql_base::OkStatus();
+  }
+
+  zetasql_base::Status Cancel() override {
+    cancelled_ = true;
+    return zetasql_base::OkStatus();
+  }
+
+  int64_t row_limit_hint() const { return row_limit_hint_; }
+  bool cancelled() const { return cancelled_; }
+
+ private:
+  const int64_t num_rows_;
+  const zetasql_base::Status end_status_;
+  const absl::Duration row_delay_;
+  int64_t row_ = -1;
+  Value value_;
+  int64_t row_limit_hint_ = -1;
+  std::atomic<bool> cancelled_{false};
+};
+
+PrefetchingEvaluatorTableIterator::Options MakeOptions(
+    int batch_size, int max_buffered_batches) {
+  PrefetchingEvaluatorTableIterator::Options options;
+  options.batch_size = batch_size;
+  options.max_buffered_batches = max_buffered_batches;
+  return options;
+}
+
+TEST(PrefetchingEvaluatorTableIteratorTest, ReturnsAllRowsInOrder) {
+  for (const int batch_size : {1, 3, 256}) {
+    for (const int max_buffered_batches : {1, 4}) {
+      auto test_iter = absl::make_unique<TestIterator>(
+          /*num_rows=*/100, zetasql_base::OkStatus(), absl::ZeroDuration());
+      PrefetchingEvaluatorTableIterator iter(
+          std::move(test_iter), MakeOptions(batch_size, max_buffered_batches));
+      ASSERT_EQ(iter.NumColumns(), 1);
+      EXPECT_EQ(iter.GetColumnName(0), "x");
+      EXPECT_EQ(iter.GetColumnType(0), types::Int64Type());
+
+      int64_t num_rows = 0;
+      while (iter.NextRow()) {
+        EXPECT_EQ(iter.GetValue(0), Value::Int64(num_rows)) << batch_size;
+        ++num_rows;
+      }
+      ZETASQL_EXPECT_OK(iter.Status());
+      EXPECT_EQ(num_rows, 100) << batch_size << " " << max_buffered_batches;
+      EXPECT_FALSE(iter.NextRow());
+    }
+  }
+}
+
+TEST(PrefetchingEvaluatorTableIteratorTest, ReturnsErrorAfterRows) {
+  const zetasql_base::Status error =
+      zetasql_base::OutOfRangeErrorBuilder() << "Failed to read";
+  PrefetchingEvaluatorTableIterator iter(
+      absl::make_unique<TestIterator>(/*num_rows=*/10, error,
+                                      absl::ZeroDuration()),
+      MakeOptions(/*batch_size=*/3, /*max_buffered_batches=*/2));
+  int64_t num_rows = 0;
+  while (iter.NextRow()) ++num_rows;
+  EXPECT_EQ(num_rows, 10);
+  EXPECT_THAT(iter.Status(), StatusIs(zetasql_base::OUT_OF_RANGE,
+                                      HasSubstr("Failed to read")));
+}
+
+TEST(PrefetchingEvaluatorTableIteratorTest, ForwardsScanConfiguration) {
+  auto test_iter = absl::make_unique<TestIterator>(
+      /*num_rows=*/5, zetasql_base::OkStatus(), absl::ZeroDuration());
+  const TestIterator* test_iter_ptr = test_iter.get();
+  PrefetchingEvaluatorTableIterator iter(
+      std::move(test_iter),
+      MakeOptions(/*batch_size=*/2, /*max_buffered_batches=*/1));
+  iter.SetRowLimitHint(3);
+  EXPECT_EQ(test_iter_ptr->row_limit_hint(), 3);
+  EXPECT_FALSE(iter.SetBlockSample(/*percent=*/50, /*seed=*/1));
+}
+
+TEST(PrefetchingEvaluatorTableIteratorTest, Cancel) {
+  auto test_iter = absl::make_unique<TestIterator>(
+      /*num_rows=*/1000000, zetasql_base::OkStatus(), absl::ZeroDuration());
+  const TestIterator* test_iter_ptr = test_iter.get();
+  PrefetchingEvaluatorTableIterator iter(
+      std::move(test_iter),
+      MakeOptions(/*batch_size=*/10, /*max_buffered_batches=*/2));
+  ASSERT_TRUE(iter.NextRow());
+  ZETASQL_EXPECT_OK(iter.Cancel());
+  EXPECT_TRUE(test_iter_ptr->cancelled());
+
+  // The rows of the current batch may still be returned.
+  int64_t num_rows = 1;
+  while (iter.NextRow()) ++num_rows;
+  EXPECT_LE(num_rows, 10);
+  EXPECT_THAT(iter.Status(), StatusIs(zetasql_base::CANCELLED));
+}
+
+TEST(PrefetchingEvaluatorTableIteratorTest, DestroyBeforeEnd) {
+  auto test_iter = absl::make_unique<TestIterator>(
+      /*num_rows=*/1000000, zetasql_base::OkStatus(), absl::ZeroDuration());
+  auto iter = absl::make_unique<PrefetchingEvaluatorTableIterator>(
+      std::move(test_iter),
+      MakeOptions(/*batch_size=*/10, /*max_buffered_batches=*/2));
+  for (int i = 0; i < 25; ++i) {
+    ASSERT_TRUE(iter->NextRow());
+    EXPECT_EQ(iter->GetValue(0), Value::Int64(i));
+  }
+  // Stops the background thread, which is blocked on the full buffer.
+  iter.reset();
+}
+
+TEST(PrefetchingEvaluatorTableIteratorTest, ReportsStallTime) {
+  PrefetchingEvaluatorTableIterator iter(
+      absl::make_unique<TestIterator>(/*num_rows=*/20, zetasql_base::OkStatus(),
+                                      absl::Milliseconds(1)),
+      MakeOptions(/*batch_size=*/5, /*max_buffered_batches=*/1));
+  EXPECT_EQ(iter.GetStallTime(), absl::ZeroDuration());
+  int64_t num_rows = 0;
+  while (iter.NextRow()) ++num_rows;
+  ZETASQL_EXPECT_OK(iter.Status());
+  EXPECT_EQ(num_rows, 20);
+  // The first batch takes at least 5ms to read.
+  EXPECT_GE(iter.GetStallTime(), absl::Milliseconds(5));
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -0,0 +1,134 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/prepared_expression_cache.h"
+
+#include "zetasql/base/logging.h"
+#include "absl/memory/memory.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+
+// Returns true if preparing with <options> is not fully described by
+// AnalyzerOptions::GetFingerprint(), or has side effects that a cached
+// expression would not have.
+bool MustBypassCache(const AnalyzerOptions& options) {
+  return options.column_id_sequence_number() != nullptr ||
+         options.lookup_expression_column_callback() != nullptr ||
+         options.ddl_pseudo_columns_callback() != nullptr;
+}
+
+}  // namespace
+
+PreparedExpressionCache::PreparedExpressionCache(
+    int max_entries, const EvaluatorOptions& options)
+    : max_entries_(max_entries), evaluator_options_(options) {
+  if (evaluator_options_.type_factory == nullptr) {
+    evaluator_options_.type_factory = &type_factory_;
+  }
+}
+
+PreparedExpressionCache* PreparedExpressionCache::GetShared() {
+  static PreparedExpressionCache* cache =
+      new PreparedExpressionCache(kSharedMaxEntries);
+  return cache;
+}
+
+zetasql_base::StatusOr<std::shared_ptr<const PreparedExpression>>
+PreparedExpressionCache::GetOrPrepare(const std::string& sql,
+                                      const AnalyzerOptions& options,
+                                      Catalog* catalog,
+                                      absl::string_view catalog_version) {
+  Key key;
+  if (MustBypassCache(options) || !options.GetFingerprint(&key.options).ok()) {
+    {
+      absl::MutexLock lock(&mutex_);
+      ++stats_.misses;
+    }
+    return Prepare(sql, options, catalog);
+  }
+  key.sql = sql;
+  key.catalog = catalog;
+  key.catalog_version = std::string(catalog_version);
+
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      ++stats_.hits;
+      return it->second->expression;
+    }
+    ++stats_.misses;
+  }
+
+  // Prepare without holding the lock, so that a slow analysis does not block
+  // lookups of other expressions.
+  std::shared_ptr<const PreparedExpression> expression;
+  ZETASQL_ASSIGN_OR_RETURN(expression, Prepare(sql, options, catalog));
+  if (max_entries_ <= 0) return expression;
+
+  absl::MutexLock lock(&mutex_);
+  auto inserted = entries_.emplace(std::move(key), lru_.end());
+  if (!inserted.second) {
+    // Another thread prepared the same expression concurrently. Keep its
+    // entry, so that all the callers share one expression from now on.
+    lru_.splice(lru_.begin(), lru_, inserted.first->second);
+    return inserted.first->second->expression;
+  }
+  lru_.push_front(Entry{&inserted.first->first, expression});
+  inserted.first->second = lru_.begin();
+  ++stats_.num_entries;
+  EvictLocked();
+  return expression;
+}
+
+zetasql_base::StatusOr<std::shared_ptr<const PreparedExpression>>
+PreparedExpressionCache::Prepare(const std::string& sql,
+                                 const AnalyzerOptions& options,
+                                 Catalog* catalog) {
+  auto expression = std::make_shared<PreparedExpression>(sql,
+                                                         evaluator_options_);
+  ZETASQL_RETURN_IF_ERROR(expression->Prepare(options, catalog));
+  return std::shared_ptr<const PreparedExpression>(std::move(expression));
+}
+
+PreparedExpressionCache::Stats PreparedExpressionCache::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void PreparedExpressionCache::Clear() {
+  absl::MutexLock lock(&mutex_);
+  entries_.clear();
+  lru_.clear();
+  stats_.num_entries = 0;
+}
+
+void PreparedExpressionCache::EvictLocked() {
+  while (stats_.num_entries > max_entries_) {
+    DCHECK(!lru_.empty());
+    --stats_.num_entries;
+    ++stats_.evictions;
+    entries_.erase(entries_.find(*lru_.back().key));
+    lru_.pop_back();
+  }
+}
+
+}  // namespace zetasql
@@ -0,0 +1,143 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_PREPARED_EXPRESSION_CACHE_H_
+#define ZETASQL_PUBLIC_PREPARED_EXPRESSION_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <cstdint>
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator.h"
+#include "zetasql/public/type.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// A bounded, thread-safe cache of prepared expressions, for callers that
+// create a PreparedExpression for the same SQL text over and over, e.g. in
+// each request handler of a service, and would otherwise analyze and
+// algebrize the expression every time.
+//
+// Expressions are looked up by their SQL text, a fingerprint of the
+// AnalyzerOptions (which includes the types of the query parameters and the
+// expression columns), the Catalog and a caller-provided catalog version.
+// The returned expressions are shared and already prepared, so callers use
+// the const, thread-safe ExecuteAfterPrepare*() methods on them.
+//
+// The prepared expressions reference objects that the Catalog returned, so
+// callers must pass a different <catalog_version> whenever the contents of
+// the catalog change, and keep a catalog alive while expressions prepared
+// against it are cached or in use. All the expressions are prepared with the
+// EvaluatorOptions of the cache. Unless those set a TypeFactory, the types
+// of the expressions come from a TypeFactory owned by the cache, so the
+// cache must outlive the expressions it returns.
+//
+// Entries are evicted in least recently used order once the cache holds more
+// than 'max_entries' entries. Evicted expressions stay valid for as long as
+// callers hold them.
+class PreparedExpressionCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+    int64_t num_entries = 0;
+  };
+
+  // The number of entries of the cache returned by GetShared().
+  static constexpr int kSharedMaxEntries = 1000;
+
+  explicit PreparedExpressionCache(
+      int max_entries, const EvaluatorOptions& options = EvaluatorOptions());
+  PreparedExpressionCache(const PreparedExpressionCache&) = delete;
+  PreparedExpressionCache& operator=(const PreparedExpressionCache&) = delete;
+
+  // Returns the process-wide cache, which has kSharedMaxEntries entries and
+  // the default EvaluatorOptions. It is never destroyed.
+  static PreparedExpressionCache* GetShared();
+
+  // Returns the expression <sql> prepared with <options> against <catalog>,
+  // which can be null as for PreparedExpression::Prepare(). Errors are not
+  // cached. Expressions are prepared without the cache if <options> cannot be
+  // fingerprinted or has callbacks or a column_id_sequence_number(), whose
+  // effects a cached expression would not have.
+  zetasql_base::StatusOr<std::shared_ptr<const PreparedExpression>>
+  GetOrPrepare(const std::string& sql, const AnalyzerOptions& options,
+               Catalog* catalog, absl::string_view catalog_version);
+
+  Stats GetStats() const;
+
+  // Removes all entries. Does not reset the hit/miss/eviction counters.
+  void Clear();
+
+ private:
+  struct Key {
+    std::string sql;
+    // The fingerprint of the AnalyzerOptions.
+    std::string options;
+    const Catalog* catalog;
+    std::string catalog_version;
+
+    bool operator==(const Key& other) const {
+      return sql == other.sql && options == other.options &&
+             catalog == other.catalog &&
+             catalog_version == other.catalog_version;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& key) {
+      return H::combine(std::move(h), key.sql, key.options, key.catalog,
+                        key.catalog_version);
+    }
+  };
+
+  struct Entry {
+    const Key* key;  // Owned by 'entries_', which has stable keys.
+    std::shared_ptr<const PreparedExpression> expression;
+  };
+  // The list front is the most recently used entry.
+  using LruList = std::list<Entry>;
+
+  // Returns <sql> prepared with the options of the cache.
+  zetasql_base::StatusOr<std::shared_ptr<const PreparedExpression>> Prepare(
+      const std::string& sql, const AnalyzerOptions& options,
+      Catalog* catalog);
+
+  // Evicts least recently used entries until the limit is respected.
+  void EvictLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int max_entries_;
+  TypeFactory type_factory_;
+  EvaluatorOptions evaluator_options_;
+
+  mutable absl::Mutex mutex_;
+  LruList lru_ ABSL_GUARDED_BY(mutex_);
+  absl::node_hash_map<Key, LruList::iterator> entries_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_PREPARED_EXPRESSION_CACHE_H_
@@ -0,0 +1,149 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/prepared_expression_cache.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+using testing::HasSubstr;
+using zetasql_base::testing::IsOkAndHolds;
+using zetasql_base::testing::StatusIs;
+
+TEST(PreparedExpressionCacheTest, SharesPreparedExpressions) {
+  PreparedExpressionCache cache(/*max_entries=*/10);
+  AnalyzerOptions options;
+  ZETASQL_ASSERT_OK(options.AddQueryParameter("p", types::Int64Type()));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<const PreparedExpression> first,
+                       cache.GetOrPrepare("@p + 1", options, nullptr, "v1"));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<const PreparedExpression> second,
+                       cache.GetOrPrepare("@p + 1", options, nullptr, "v1"));
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_THAT(second->ExecuteAfterPrepare({}, {{"p", Value::Int64(2)}}),
+              IsOkAndHolds(Value::Int64(3)));
+
+  PreparedExpressionCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(1, stats.num_entries);
+}
+
+TEST(PreparedExpressionCacheTest, KeysOnOptionsAndCatalog) {
+  PreparedExpressionCache cache(/*max_entries=*/10);
+  AnalyzerOptions int64_options;
+  ZETASQL_ASSERT_OK(int64_options.AddQueryParameter("p", types::Int64Type()));
+  AnalyzerOptions double_options;
+  ZETASQL_ASSERT_OK(double_options.AddQueryParameter("p", types::DoubleType()));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<const PreparedExpression> int64_expression,
+      cache.GetOrPrepare("@p", int64_options, nullptr, "v1"));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<const PreparedExpression> double_expression,
+      cache.GetOrPrepare("@p", double_options, nullptr, "v1"));
+  EXPECT_NE(int64_expression.get(), double_expression.get());
+  EXPECT_TRUE(int64_expression->output_type()->IsInt64());
+  EXPECT_TRUE(double_expression->output_type()->IsDouble());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<const PreparedExpression> other_version,
+      cache.GetOrPrepare("@p", int64_options, nullptr, "v2"));
+  EXPECT_NE(int64_expression.get(), other_version.get());
+
+  SimpleCatalog catalog("catalog");
+  catalog.AddZetaSQLFunctions();
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<const PreparedExpression> other_catalog,
+      cache.GetOrPrepare("@p", int64_options, &catalog, "v1"));
+  EXPECT_NE(int64_expression.get(), other_catalog.get());
+  EXPECT_EQ(4, cache.GetStats().num_entries);
+}
+
+TEST(PreparedExpressionCacheTest, EvictsLeastRecentlyUsed) {
+  PreparedExpressionCache cache(/*max_entries=*/2);
+  AnalyzerOptions options;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<const PreparedExpression> one,
+                       cache.GetOrPrepare("1", options, nullptr, ""));
+  ZETASQL_ASSERT_OK(cache.GetOrPrepare("2", options, nullptr, "").status());
+  // Makes "2" the least recently used entry.
+  ZETASQL_ASSERT_OK(cache.GetOrPrepare("1", options, nullptr, "").status());
+  ZETASQL_ASSERT_OK(cache.GetOrPrepare("3", options, nullptr, "").status());
+
+  PreparedExpressionCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(1, stats.evictions);
+  EXPECT_EQ(2, stats.num_entries);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<const PreparedExpression> again,
+                       cache.GetOrPrepare("1", options, nullptr, ""));
+  EXPECT_EQ(one.get(), again.get());
+  ZETASQL_ASSERT_OK(cache.GetOrPrepare("2", options, nullptr, "").status());
+  EXPECT_EQ(4, cache.GetStats().misses);
+
+  // Evicted and cleared expressions stay valid.
+  cache.Clear();
+  EXPECT_EQ(0, cache.GetStats().num_entries);
+  EXPECT_THAT(one->ExecuteAfterPrepare(), IsOkAndHolds(Value::Int64(1)));
+}
+
+TEST(PreparedExpressionCacheTest, DoesNotCacheErrors) {
+  PreparedExpressionCache cache(/*max_entries=*/10);
+  AnalyzerOptions options;
+  EXPECT_THAT(cache.GetOrPrepare("1 +", options, nullptr, "").status(),
+              StatusIs(zetasql_base::StatusCode::kInvalidArgument,
+                       HasSubstr("Syntax error")));
+  EXPECT_THAT(cache.GetOrPrepare("1 +", options, nullptr, "").status(),
+              StatusIs(zetasql_base::StatusCode::kInvalidArgument));
+  PreparedExpressionCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(2, stats.misses);
+  EXPECT_EQ(0, stats.num_entries);
+}
+
+TEST(PreparedExpressionCacheTest, ConcurrentLookupsShareOneEntry) {
+  PreparedExpressionCache cache(/*max_entries=*/10);
+  AnalyzerOptions options;
+  ZETASQL_ASSERT_OK(options.AddExpressionColumn("x", types::Int64Type()));
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&cache, &options, i] {
+      for (int j = 0; j < 20; ++j) {
+        zetasql_base::StatusOr<std::shared_ptr<const PreparedExpression>>
+            expression = cache.GetOrPrepare("x * 2", options, nullptr, "");
+        ZETASQL_ASSERT_OK(expression.status());
+        EXPECT_THAT(expression.ValueOrDie()->ExecuteAfterPrepare(
+                        {{"x", Value::Int64(i + j)}}),
+                    IsOkAndHolds(Value::Int64(2 * (i + j))));
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  PreparedExpressionCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(160, stats.hits + stats.misses);
+  EXPECT_EQ(1, stats.num_entries);
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -16,6 +16,7 @@
 
 #include "zetasql/public/proto_util.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -41,8 +42,10 @@
 #include "absl/flags/flag.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
-#include "zetasql/base/map_util.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status.h"
@@ -561,12 +564,14 @@ static bool ReadWireValue(google::protobuf::FieldDescriptor::Type field_type,
       return false;
     }
     case WireFormatLite::TYPE_MESSAGE: {
-      std::string c;
-      if (WireFormatLite::ReadBytes(in, &c)) {
-        *value = absl::Cord(c);
-        return true;
-      }
-      return false;
+      // Like for groups, share the bytes of the submessage with 'bytes'
+      // instead of copying them.
+      uint32_t length;
+      if (!in->ReadVarint32(&length)) return false;
+      const int start_position = in->CurrentPosition();
+      if (!in->Skip(length)) return false;
+      *value = bytes.Subcord(start_position, length);
+      return true;
     }
     case WireFormatLite::TYPE_GROUP: {
       const uint32_t start_position = in->CurrentPosition();
@@ -788,6 +793,16 @@ static bool ReadPackedWireValues(int tag_number,
   return true;
 }
 
+// Returns the contents of 'bytes' as one array. Only copies them into
+// '*buffer' if 'bytes' is not flat already.
+static absl::string_view GetFlatBytes(const absl::Cord& bytes,
+                                      std::string* buffer) {
+  const absl::optional<absl::string_view> flat_bytes = bytes.TryFlat();
+  if (flat_bytes.has_value()) return flat_bytes.value();
+  *buffer = std::string(bytes);
+  return *buffer;
+}
+
 // Optimized version of ReadProtoFields where only one field is being fetched.
 static zetasql_base::StatusOr<Value> ReadSingularProtoField(
     const ProtoFieldInfo& field_info, const absl::Cord& bytes) {
@@ -798,8 +813,10 @@ static zetasql_base::StatusOr<Value> ReadSingularProtoField(
   absl::InlinedVector<Value, 8> elements;
   const bool is_packable = field_info.descriptor->is_packable();
   uint32_t tag_and_type;
-  std::string bytes_str(bytes);
-  google::protobuf::io::ArrayInputStream cord_stream(bytes_str.data(), bytes_str.size());
+  std::string buffer;
+  const absl::string_view flat_bytes = GetFlatBytes(bytes, &buffer);
+  google::protobuf::io::ArrayInputStream cord_stream(flat_bytes.data(),
+                                           flat_bytes.size());
   google::protobuf::io::CodedInputStream in(&cord_stream);
   while (0 < (tag_and_type = in.ReadTag())) {
     const int tag_number = WireFormatLite::GetTagFieldNumber(tag_and_type);
@@ -879,8 +896,63 @@ static zetasql_base::StatusOr<Value> ReadSingularProtoField(
 
 namespace {
 
-// Maps a tag number to all ProtoFieldInfos indexes with that tag number.
-using FieldInfoMap = absl::flat_hash_map<int, std::vector<int>>;
+// All ProtoFieldInfo indexes with a particular tag number.
+struct TagFieldInfos {
+  int tag_number;
+  std::vector<int> info_idxs;
+};
+
+// The TagFieldInfos for all the tag numbers being read, sorted by tag number.
+using FieldInfoTable = std::vector<TagFieldInfos>;
+
+FieldInfoTable MakeFieldInfoTable(
+    absl::Span<const ProtoFieldInfo* const> field_infos) {
+  FieldInfoTable table;
+  for (int i = 0; i < field_infos.size(); ++i) {
+    table.push_back({field_infos[i]->descriptor->number(), {i}});
+  }
+  std::stable_sort(table.begin(), table.end(),
+                   [](const TagFieldInfos& a, const TagFieldInfos& b) {
+                     return a.tag_number < b.tag_number;
+                   });
+  // Merge the entries with the same tag number.
+  int num_tags = 0;
+  for (int i = 0; i < table.size(); ++i) {
+    if (num_tags > 0 && table[num_tags - 1].tag_number == table[i].tag_number) {
+      table[num_tags - 1].info_idxs.push_back(table[i].info_idxs[0]);
+    } else {
+      table[num_tags++] = std::move(table[i]);
+    }
+  }
+  table.resize(num_tags);
+  return table;
+}
+
+// Returns the ProtoFieldInfo indexes in 'table' for 'tag_number', or NULL if
+// it is not being read. '*position' is the position in 'table' of the previous
+// tag number that was found. Serializers usually write fields in tag number
+// order, so that is checked before searching the whole table.
+const std::vector<int>* FindFieldInfos(const FieldInfoTable& table,
+                                       int tag_number, int* position) {
+  const int num_tags = static_cast<int>(table.size());
+  for (int i = *position; i < num_tags && i <= *position + 1; ++i) {
+    if (table[i].tag_number == tag_number) {
+      *position = i;
+      return &table[i].info_idxs;
+    }
+    if (table[i].tag_number > tag_number &&
+        (i == 0 || table[i - 1].tag_number < tag_number)) {
+      return nullptr;
+    }
+  }
+  auto it = std::lower_bound(table.begin(), table.end(), tag_number,
+                             [](const TagFieldInfos& entry, int number) {
+                               return entry.tag_number < number;
+                             });
+  if (it == table.end() || it->tag_number != tag_number) return nullptr;
+  *position = static_cast<int>(it - table.begin());
+  return &it->info_idxs;
+}
 
 // Maps a ProtoFieldInfo (by its index) to the corresponding Values we have
 // seen for it, with errors for failure to convert wire values to the
@@ -905,11 +977,8 @@ zetasql_base::Status ReadProtoFields(
 
   field_value_list->resize(field_infos.size());
 
-  FieldInfoMap field_info_map;
-  for (int i = 0; i < field_infos.size(); ++i) {
-    const ProtoFieldInfo* field_info = field_infos[i];
-    field_info_map[field_info->descriptor->number()].push_back(i);
-  }
+  const FieldInfoTable field_info_table = MakeFieldInfoTable(field_infos);
+  int field_info_table_position = 0;
 
   // If get_has_bit is true, this is either empty or contains a single
   // Value::Bool(true).
@@ -917,14 +986,15 @@ zetasql_base::Status ReadProtoFields(
   ZETASQL_RET_CHECK(!field_infos.empty());
   const google::protobuf::FieldDescriptor* some_field = field_infos[0]->descriptor;
     uint32_t tag_and_type;
-    std::string bytes_str(bytes);
-    google::protobuf::io::ArrayInputStream cord_stream(bytes_str.data(),
-    bytes_str.size());
+    std::string buffer;
+    const absl::string_view flat_bytes = GetFlatBytes(bytes, &buffer);
+    google::protobuf::io::ArrayInputStream cord_stream(flat_bytes.data(),
+                                             flat_bytes.size());
     google::protobuf::io::CodedInputStream in(&cord_stream);
     while (0 < (tag_and_type = in.ReadTag())) {
       const int tag_number = WireFormatLite::GetTagFieldNumber(tag_and_type);
-      const std::vector<int>* info_idxs =
-          zetasql_base::FindOrNull(field_info_map, tag_number);
+      const std::vector<int>* info_idxs = FindFieldInfos(
+          field_info_table, tag_number, &field_info_table_position);
       if (info_idxs == nullptr) {
         if (ABSL_PREDICT_TRUE(WireFormatLite::SkipField(&in, tag_and_type))) {
           continue;
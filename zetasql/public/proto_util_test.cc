@@ -18,6 +18,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "zetasql/base/logging.h"
 #include "google/protobuf/io/coded_stream.h"
@@ -760,6 +761,56 @@ TEST_P(ReadProtoFieldsTest, SameFieldWithTwoFormats) {
   EXPECT_THAT(value_list[1], IsOkAndHolds(values::Date(10)));
 }
 
+TEST_P(ReadProtoFieldsTest, ManyFieldsMatchSingleFieldReads) {
+  kitchen_sink_.set_int64_key_1(1);
+  kitchen_sink_.set_int64_key_2(2);
+  kitchen_sink_.set_string_val("foo");
+  kitchen_sink_.add_repeated_int32_val(3);
+  kitchen_sink_.add_repeated_int32_val(4);
+  kitchen_sink_.add_repeated_int64_packed(5);
+  kitchen_sink_.add_repeated_int64_packed(6);
+  kitchen_sink_.mutable_nested_value()->set_nested_int64(7);
+  kitchen_sink_.add_nested_repeated_value()->set_nested_int64(8);
+  kitchen_sink_.set_int32_val(9);
+
+  // Read from a Cord that is not flat, and with the fields out of tag number
+  // order.
+  const std::string serialized = kitchen_sink_.SerializePartialAsString();
+  absl::Cord bytes;
+  for (char c : serialized) {
+    bytes.Append(std::string(1, c));
+  }
+  const std::vector<std::string> field_names = {
+      "nested_repeated_value", "int32_val",   "repeated_int64_packed",
+      "string_val",            "int64_key_1", "nested_value",
+      "repeated_int32_val",    "int64_key_2", "int64_val",
+      "int32_val"};
+
+  std::vector<ProtoFieldInfo> infos(field_names.size());
+  std::vector<const ProtoFieldInfo*> info_ptrs;
+  for (int i = 0; i < field_names.size(); ++i) {
+    infos[i].descriptor =
+        kitchen_sink_.GetDescriptor()->FindFieldByName(field_names[i]);
+    ASSERT_TRUE(infos[i].descriptor != nullptr) << field_names[i];
+    ZETASQL_ASSERT_OK(GetProtoFieldTypeAndDefault(infos[i].descriptor, &type_factory_,
+                                          &infos[i].type,
+                                          &infos[i].default_value));
+    info_ptrs.push_back(&infos[i]);
+  }
+
+  ProtoFieldValueList value_list;
+  ZETASQL_ASSERT_OK(ReadProtoFields(info_ptrs, bytes, &value_list));
+  ASSERT_EQ(value_list.size(), infos.size());
+  for (int i = 0; i < infos.size(); ++i) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        const Value expected,
+        ReadField(field_names[i], FieldFormat::DEFAULT_FORMAT, infos[i].type,
+                  infos[i].default_value));
+    EXPECT_THAT(value_list[i], IsOkAndHolds(expected)) << field_names[i];
+  }
+  EXPECT_THAT(value_list[2], IsOkAndHolds(values::Int64Array({5, 6})));
+}
+
 INSTANTIATE_TEST_SUITE_P(ReadProtoFieldsTestInstantiation, ReadProtoFieldsTest,
                          ::testing::Values(false, true));
 
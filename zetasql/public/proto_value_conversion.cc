@@ -16,7 +16,9 @@
 
 #include "zetasql/public/proto_value_conversion.h"
 
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "google/protobuf/descriptor.pb.h"
@@ -31,6 +33,7 @@
 #include "zetasql/public/value.h"
 #include "zetasql/public/value.pb.h"
 #include <cstdint>
+#include "absl/memory/memory.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
 #include "zetasql/base/source_location.h"
@@ -482,17 +485,10 @@ static zetasql_base::Status ProtoToStructValue(const google::protobuf::Message&
                                        bool use_wire_format_annotations,
                                        Value* value_out);
 
-// Mutually recursive with ProtoToStructValue.
-zetasql_base::Status ProtoFieldToValue(const google::protobuf::Message& proto,
-                               const google::protobuf::FieldDescriptor* field, int index,
-                               const Type* type,
-                               bool use_wire_format_annotations,
-                               Value* value_out) {
-  ZETASQL_RET_CHECK_NE(nullptr, value_out);
-  const google::protobuf::Reflection* reflection = proto.GetReflection();
-
-  const FieldFormat::Format field_format =
-      ProtoType::GetFormatAnnotation(field);
+// Returns an error if a field with the format annotation 'field_format' cannot
+// be read as a value of 'type'.
+static zetasql_base::Status CheckFormatForType(FieldFormat::Format field_format,
+                                       const Type* type) {
   if (!type->IsDate() && !type->IsTimestamp() && !type->IsArray() &&
       !type->IsTime() && !type->IsDatetime() && !type->IsGeography() &&
       type->kind() != TYPE_NUMERIC) {
@@ -500,51 +496,18 @@ zetasql_base::Status ProtoFieldToValue(const google::protobuf::Message& proto,
         << "Format " << FieldFormat::Format_Name(field_format)
         << " not supported for zetasql type " << type->DebugString();
   }
+  return ::zetasql_base::OkStatus();
+}
 
-  bool is_wrapper = use_wire_format_annotations;
-  if (use_wire_format_annotations) {
-    ZETASQL_RETURN_IF_ERROR(ShouldTreatAsWrapperForType(field, type, &is_wrapper));
-  }
-  if (is_wrapper) {
-    // Special case for handling NULL arrays.  NULL arrays are indicated
-    // by the absence of a wrapper.  NULL non-arrays are indicated by the
-    // absence of the field within the wrapper.
-    if (type->IsArray()) {
-      ZETASQL_RET_CHECK(!field->is_repeated()) << field->DebugString();
-      if (!reflection->HasField(proto, field)) {
-        *value_out = Value::Null(type);
-        return ::zetasql_base::OkStatus();
-      }
-    }
-
-    ZETASQL_RET_CHECK_EQ(google::protobuf::FieldDescriptor::TYPE_MESSAGE, field->type())
-        << field->DebugString();
-    const google::protobuf::Message& wrapper = field->is_repeated() ?
-        reflection->GetRepeatedMessage(proto, field, index) :
-        reflection->GetMessage(proto, field);
-    const google::protobuf::Descriptor* wrapper_descriptor =
-        wrapper.GetDescriptor();
-    ZETASQL_RET_CHECK_EQ(1, wrapper_descriptor->field_count());
-    const google::protobuf::FieldDescriptor* unwrapped_field =
-        wrapper_descriptor->field(0);
-    return ProtoFieldToValue(wrapper, unwrapped_field, -1 /* index */, type,
-                             use_wire_format_annotations, value_out);
-  }
-
-  // If a non-repeated field is missing, the value is NULL.
-  if (!field->is_repeated()) {
-    ZETASQL_RET_CHECK_EQ(-1, index) << field->DebugString();
-    if (!reflection->HasField(proto, field)) {
-      *value_out = Value::Null(type);
-      return ::zetasql_base::OkStatus();
-    }
-  } else if (!type->IsArray()) {
-    // If the field is repeated, then we'll need to know the index we're
-    // looking at.  Except when we are expecting an array, in which case
-    // we will look at all members of the repeated field.
-    ZETASQL_RET_CHECK_GE(index, 0) << field->DebugString();
-  }
-
+// Populates 'value_out' from the element at 'index' of the repeated 'field' of
+// 'proto', or from the non-repeated 'field' if 'index' is -1, which must be
+// present.  'type' must not be an ARRAY or a STRUCT, and 'field_format' is
+// the format annotation of 'field'.
+static zetasql_base::Status ProtoScalarFieldToValue(
+    const google::protobuf::Message& proto,
+    const google::protobuf::FieldDescriptor* field, int index, const Type* type,
+    FieldFormat::Format field_format, Value* value_out) {
+  const google::protobuf::Reflection* reflection = proto.GetReflection();
   switch (type->kind()) {
     case TypeKind::TYPE_ENUM: {
       ZETASQL_RET_CHECK_EQ(google::protobuf::FieldDescriptor::CPPTYPE_ENUM, field->cpp_type())
@@ -654,33 +617,6 @@ zetasql_base::Status ProtoFieldToValue(const google::protobuf::Message& proto,
           reflection->GetString(proto, field));
       return ::zetasql_base::OkStatus();
     }
-    case TypeKind::TYPE_ARRAY: {
-      // Array wrappers should have been handled above, so we can assert
-      // that we have a repeated field.
-      ZETASQL_RET_CHECK(field->is_repeated());
-      ZETASQL_RET_CHECK_EQ(-1, index);
-      const ArrayType* array_type = type->AsArray();
-      const int num_elements = reflection->FieldSize(proto, field);
-      std::vector<Value> values(num_elements);
-      for (int i = 0; i < num_elements; ++i) {
-        ZETASQL_RETURN_IF_ERROR(
-            ProtoFieldToValue(proto, field, i, array_type->element_type(),
-                              use_wire_format_annotations, &values[i]));
-      }
-      *value_out = Value::Array(array_type, values);
-      return ::zetasql_base::OkStatus();
-    }
-    case TypeKind::TYPE_STRUCT: {
-      ZETASQL_RET_CHECK_EQ(google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE, field->cpp_type())
-          << field->DebugString();
-      const google::protobuf::Message& submessage =
-          field->is_repeated() ?
-          reflection->GetRepeatedMessage(proto, field, index) :
-          reflection->GetMessage(proto, field);
-      ZETASQL_RETURN_IF_ERROR(ProtoToStructValue(
-          submessage, type, use_wire_format_annotations, value_out));
-      return ::zetasql_base::OkStatus();
-    }
     case TypeKind::TYPE_INT32: {
       ZETASQL_RET_CHECK_EQ(google::protobuf::FieldDescriptor::CPPTYPE_INT32, field->cpp_type())
           << field->DebugString();
@@ -804,6 +740,93 @@ zetasql_base::Status ProtoFieldToValue(const google::protobuf::Message& proto,
   }
 }
 
+// Mutually recursive with ProtoToStructValue.
+zetasql_base::Status ProtoFieldToValue(const google::protobuf::Message& proto,
+                               const google::protobuf::FieldDescriptor* field, int index,
+                               const Type* type,
+                               bool use_wire_format_annotations,
+                               Value* value_out) {
+  ZETASQL_RET_CHECK_NE(nullptr, value_out);
+  const google::protobuf::Reflection* reflection = proto.GetReflection();
+
+  const FieldFormat::Format field_format =
+      ProtoType::GetFormatAnnotation(field);
+  ZETASQL_RETURN_IF_ERROR(CheckFormatForType(field_format, type));
+
+  bool is_wrapper = use_wire_format_annotations;
+  if (use_wire_format_annotations) {
+    ZETASQL_RETURN_IF_ERROR(ShouldTreatAsWrapperForType(field, type, &is_wrapper));
+  }
+  if (is_wrapper) {
+    // Special case for handling NULL arrays.  NULL arrays are indicated
+    // by the absence of a wrapper.  NULL non-arrays are indicated by the
+    // absence of the field within the wrapper.
+    if (type->IsArray()) {
+      ZETASQL_RET_CHECK(!field->is_repeated()) << field->DebugString();
+      if (!reflection->HasField(proto, field)) {
+        *value_out = Value::Null(type);
+        return ::zetasql_base::OkStatus();
+      }
+    }
+
+    ZETASQL_RET_CHECK_EQ(google::protobuf::FieldDescriptor::TYPE_MESSAGE, field->type())
+        << field->DebugString();
+    const google::protobuf::Message& wrapper = field->is_repeated() ?
+        reflection->GetRepeatedMessage(proto, field, index) :
+        reflection->GetMessage(proto, field);
+    const google::protobuf::Descriptor* wrapper_descriptor =
+        wrapper.GetDescriptor();
+    ZETASQL_RET_CHECK_EQ(1, wrapper_descriptor->field_count());
+    const google::protobuf::FieldDescriptor* unwrapped_field =
+        wrapper_descriptor->field(0);
+    return ProtoFieldToValue(wrapper, unwrapped_field, -1 /* index */, type,
+                             use_wire_format_annotations, value_out);
+  }
+
+  // If a non-repeated field is missing, the value is NULL.
+  if (!field->is_repeated()) {
+    ZETASQL_RET_CHECK_EQ(-1, index) << field->DebugString();
+    if (!reflection->HasField(proto, field)) {
+      *value_out = Value::Null(type);
+      return ::zetasql_base::OkStatus();
+    }
+  } else if (!type->IsArray()) {
+    // If the field is repeated, then we'll need to know the index we're
+    // looking at.  Except when we are expecting an array, in which case
+    // we will look at all members of the repeated field.
+    ZETASQL_RET_CHECK_GE(index, 0) << field->DebugString();
+  }
+
+  if (type->IsArray()) {
+    // Array wrappers should have been handled above, so we can assert
+    // that we have a repeated field.
+    ZETASQL_RET_CHECK(field->is_repeated());
+    ZETASQL_RET_CHECK_EQ(-1, index);
+    const ArrayType* array_type = type->AsArray();
+    const int num_elements = reflection->FieldSize(proto, field);
+    std::vector<Value> values(num_elements);
+    for (int i = 0; i < num_elements; ++i) {
+      ZETASQL_RETURN_IF_ERROR(
+          ProtoFieldToValue(proto, field, i, array_type->element_type(),
+                            use_wire_format_annotations, &values[i]));
+    }
+    *value_out = Value::Array(array_type, values);
+    return ::zetasql_base::OkStatus();
+  }
+  if (type->IsStruct()) {
+    ZETASQL_RET_CHECK_EQ(google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE, field->cpp_type())
+        << field->DebugString();
+    const google::protobuf::Message& submessage =
+        field->is_repeated() ?
+        reflection->GetRepeatedMessage(proto, field, index) :
+        reflection->GetMessage(proto, field);
+    return ProtoToStructValue(submessage, type, use_wire_format_annotations,
+                              value_out);
+  }
+  return ProtoScalarFieldToValue(proto, field, index, type, field_format,
+                                 value_out);
+}
+
 // Converts 'proto' to a Value of type 'type' and returns it in
 // 'value_out'.  'type' must be a STRUCT type.
 //
@@ -850,4 +873,177 @@ zetasql_base::Status ConvertProtoMessageToStructOrArrayValue(
   ZETASQL_RET_CHECK_FAIL() << type->DebugString();
 }
 
+// How ProtoToValueConverter reads a Value of 'type' from 'field', resolved
+// the same way as ProtoFieldToValue() with wire format annotations.
+struct ProtoToValueConverter::FieldConversion {
+  const google::protobuf::FieldDescriptor* field = nullptr;
+  const Type* type = nullptr;
+  FieldFormat::Format format = FieldFormat::DEFAULT_FORMAT;
+  // If set, 'field' is a wrapper message and the value is read from its only
+  // field.
+  std::unique_ptr<const FieldConversion> unwrapped;
+  // Only for an ARRAY read from a repeated field. Reads each element.
+  std::unique_ptr<const FieldConversion> element;
+  // Only for a STRUCT. Reads the fields of the message in 'field'.
+  std::vector<std::unique_ptr<const FieldConversion>> struct_fields;
+};
+
+ProtoToValueConverter::ProtoToValueConverter(const Type* type) : type_(type) {}
+
+ProtoToValueConverter::~ProtoToValueConverter() {}
+
+zetasql_base::StatusOr<std::unique_ptr<const ProtoToValueConverter>>
+ProtoToValueConverter::Create(const google::protobuf::Descriptor* descriptor,
+                              const Type* type) {
+  ZETASQL_RET_CHECK(descriptor != nullptr);
+  ZETASQL_RET_CHECK(type != nullptr);
+  std::unique_ptr<ProtoToValueConverter> converter(
+      new ProtoToValueConverter(type));
+  if (type->IsStruct()) {
+    ZETASQL_RETURN_IF_ERROR(MakeStructFieldConversions(descriptor, type->AsStruct(),
+                                               &converter->fields_));
+  } else if (type->IsArray()) {
+    // At the top level, an ARRAY is always a wrapper.
+    ZETASQL_RET_CHECK(ProtoType::GetIsWrapperAnnotation(descriptor));
+    ZETASQL_RET_CHECK_EQ(1, descriptor->field_count());
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<const FieldConversion> conversion,
+        MakeFieldConversion(descriptor->field(0), type, /*is_element=*/false));
+    converter->fields_.push_back(std::move(conversion));
+  } else {
+    ZETASQL_RET_CHECK_FAIL() << type->DebugString();
+  }
+  return std::unique_ptr<const ProtoToValueConverter>(std::move(converter));
+}
+
+zetasql_base::StatusOr<
+    std::unique_ptr<const ProtoToValueConverter::FieldConversion>>
+ProtoToValueConverter::MakeFieldConversion(
+    const google::protobuf::FieldDescriptor* field, const Type* type,
+    bool is_element) {
+  auto conversion = absl::make_unique<FieldConversion>();
+  conversion->field = field;
+  conversion->type = type;
+  conversion->format = ProtoType::GetFormatAnnotation(field);
+  ZETASQL_RETURN_IF_ERROR(CheckFormatForType(conversion->format, type));
+
+  bool is_wrapper;
+  ZETASQL_RETURN_IF_ERROR(ShouldTreatAsWrapperForType(field, type, &is_wrapper));
+  if (is_wrapper) {
+    if (type->IsArray()) {
+      ZETASQL_RET_CHECK(!field->is_repeated()) << field->DebugString();
+    }
+    ZETASQL_RET_CHECK_EQ(google::protobuf::FieldDescriptor::TYPE_MESSAGE, field->type())
+        << field->DebugString();
+    const google::protobuf::Descriptor* wrapper_descriptor = field->message_type();
+    ZETASQL_RET_CHECK_EQ(1, wrapper_descriptor->field_count());
+    ZETASQL_ASSIGN_OR_RETURN(conversion->unwrapped,
+                     MakeFieldConversion(wrapper_descriptor->field(0), type,
+                                         /*is_element=*/false));
+    return std::unique_ptr<const FieldConversion>(std::move(conversion));
+  }
+
+  if (!field->is_repeated()) {
+    ZETASQL_RET_CHECK(!is_element) << field->DebugString();
+  } else if (!type->IsArray()) {
+    ZETASQL_RET_CHECK(is_element) << field->DebugString();
+  }
+  if (type->IsArray()) {
+    ZETASQL_RET_CHECK(field->is_repeated());
+    ZETASQL_RET_CHECK(!is_element);
+    ZETASQL_ASSIGN_OR_RETURN(conversion->element,
+                     MakeFieldConversion(field, type->AsArray()->element_type(),
+                                         /*is_element=*/true));
+  } else if (type->IsStruct()) {
+    ZETASQL_RET_CHECK_EQ(google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE, field->cpp_type())
+        << field->DebugString();
+    ZETASQL_RETURN_IF_ERROR(MakeStructFieldConversions(
+        field->message_type(), type->AsStruct(), &conversion->struct_fields));
+  }
+  return std::unique_ptr<const FieldConversion>(std::move(conversion));
+}
+
+zetasql_base::Status ProtoToValueConverter::MakeStructFieldConversions(
+    const google::protobuf::Descriptor* descriptor, const StructType* struct_type,
+    std::vector<std::unique_ptr<const FieldConversion>>* conversions) {
+  ZETASQL_RET_CHECK_EQ(struct_type->num_fields(), descriptor->field_count());
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<const FieldConversion> conversion,
+                     MakeFieldConversion(descriptor->field(i),
+                                         struct_type->field(i).type,
+                                         /*is_element=*/false));
+    conversions->push_back(std::move(conversion));
+  }
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::Status ProtoToValueConverter::Convert(const google::protobuf::Message& proto,
+                                            Value* value_out) const {
+  ZETASQL_RET_CHECK_NE(nullptr, value_out);
+  if (type_->IsStruct()) {
+    return ConvertStruct(fields_, type_->AsStruct(), proto, value_out);
+  }
+  return ConvertField(*fields_[0], proto, /*index=*/-1, value_out);
+}
+
+zetasql_base::Status ProtoToValueConverter::ConvertField(
+    const FieldConversion& conversion, const google::protobuf::Message& proto,
+    int index, Value* value_out) {
+  const google::protobuf::FieldDescriptor* field = conversion.field;
+  const google::protobuf::Reflection* reflection = proto.GetReflection();
+  if (conversion.unwrapped != nullptr) {
+    // NULL arrays are indicated by the absence of a wrapper.  NULL non-arrays
+    // are indicated by the absence of the field within the wrapper.
+    if (conversion.type->IsArray() && !reflection->HasField(proto, field)) {
+      *value_out = Value::Null(conversion.type);
+      return ::zetasql_base::OkStatus();
+    }
+    const google::protobuf::Message& wrapper =
+        field->is_repeated()
+            ? reflection->GetRepeatedMessage(proto, field, index)
+            : reflection->GetMessage(proto, field);
+    return ConvertField(*conversion.unwrapped, wrapper, /*index=*/-1,
+                        value_out);
+  }
+
+  if (!field->is_repeated() && !reflection->HasField(proto, field)) {
+    *value_out = Value::Null(conversion.type);
+    return ::zetasql_base::OkStatus();
+  }
+  if (conversion.element != nullptr) {
+    const int num_elements = reflection->FieldSize(proto, field);
+    std::vector<Value> values(num_elements);
+    for (int i = 0; i < num_elements; ++i) {
+      ZETASQL_RETURN_IF_ERROR(
+          ConvertField(*conversion.element, proto, i, &values[i]));
+    }
+    *value_out = Value::UnsafeArray(conversion.type->AsArray(),
+                                    std::move(values));
+    return ::zetasql_base::OkStatus();
+  }
+  if (conversion.type->IsStruct()) {
+    const google::protobuf::Message& submessage =
+        field->is_repeated()
+            ? reflection->GetRepeatedMessage(proto, field, index)
+            : reflection->GetMessage(proto, field);
+    return ConvertStruct(conversion.struct_fields, conversion.type->AsStruct(),
+                         submessage, value_out);
+  }
+  return ProtoScalarFieldToValue(proto, field, index, conversion.type,
+                                 conversion.format, value_out);
+}
+
+zetasql_base::Status ProtoToValueConverter::ConvertStruct(
+    const std::vector<std::unique_ptr<const FieldConversion>>& conversions,
+    const StructType* struct_type, const google::protobuf::Message& proto,
+    Value* value_out) {
+  std::vector<Value> values(conversions.size());
+  for (int i = 0; i < conversions.size(); ++i) {
+    ZETASQL_RETURN_IF_ERROR(
+        ConvertField(*conversions[i], proto, /*index=*/-1, &values[i]));
+  }
+  *value_out = Value::UnsafeStruct(struct_type, std::move(values));
+  return ::zetasql_base::OkStatus();
+}
+
 }  // namespace zetasql
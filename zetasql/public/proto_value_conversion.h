@@ -30,12 +30,17 @@
 #ifndef ZETASQL_PUBLIC_PROTO_VALUE_CONVERSION_H_
 #define ZETASQL_PUBLIC_PROTO_VALUE_CONVERSION_H_
 
+#include <memory>
+#include <vector>
+
 #include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/message.h"
 
 namespace zetasql {
 
+class StructType;
 class Type;
 class Value;
 
@@ -158,6 +163,63 @@ zetasql_base::Status ConvertStructOrArrayValueToProtoMessage(
 zetasql_base::Status ConvertProtoMessageToStructOrArrayValue(
     const google::protobuf::Message& proto, const Type* type, Value* value_out);
 
+// Converts protos of one descriptor to Values of one type, with the same
+// results as ConvertProtoMessageToStructOrArrayValue().  The wrapper and
+// format annotations of every field, and the mapping of the fields to the
+// STRUCT fields and ARRAY elements of the type, are resolved once by Create()
+// rather than for every field of every converted proto, so a converter should
+// be reused for all the protos (e.g., the rows of a table) of a descriptor.
+//
+// This class is thread-safe.
+class ProtoToValueConverter {
+ public:
+  // 'type' must have been created using
+  // TypeFactory::MakeUnwrappedTypeFromProto() on 'descriptor', and must
+  // outlive the converter.
+  static zetasql_base::StatusOr<std::unique_ptr<const ProtoToValueConverter>> Create(
+      const google::protobuf::Descriptor* descriptor, const Type* type);
+
+  ProtoToValueConverter(const ProtoToValueConverter&) = delete;
+  ProtoToValueConverter& operator=(const ProtoToValueConverter&) = delete;
+  ~ProtoToValueConverter();
+
+  // Converts 'proto', which must have the descriptor passed to Create(), and
+  // returns it in 'value_out'.
+  zetasql_base::Status Convert(const google::protobuf::Message& proto,
+                       Value* value_out) const;
+
+ private:
+  struct FieldConversion;
+
+  explicit ProtoToValueConverter(const Type* type);
+
+  // Returns how to read a Value of 'type' from 'field', or from one of its
+  // elements if 'is_element' is true.
+  static zetasql_base::StatusOr<std::unique_ptr<const FieldConversion>>
+  MakeFieldConversion(const google::protobuf::FieldDescriptor* field,
+                      const Type* type, bool is_element);
+  // Appends to 'conversions' how to read each field of 'struct_type' from the
+  // field with the same index in 'descriptor'.
+  static zetasql_base::Status MakeStructFieldConversions(
+      const google::protobuf::Descriptor* descriptor, const StructType* struct_type,
+      std::vector<std::unique_ptr<const FieldConversion>>* conversions);
+
+  // Reads the field of 'conversion' (or its element at 'index' if it is not
+  // -1) from 'proto' into 'value_out'.
+  static zetasql_base::Status ConvertField(const FieldConversion& conversion,
+                                   const google::protobuf::Message& proto, int index,
+                                   Value* value_out);
+  static zetasql_base::Status ConvertStruct(
+      const std::vector<std::unique_ptr<const FieldConversion>>& conversions,
+      const StructType* struct_type, const google::protobuf::Message& proto,
+      Value* value_out);
+
+  const Type* type_;
+  // For a STRUCT 'type_', one conversion per field. For an ARRAY 'type_', the
+  // conversion of the only field of the array wrapper.
+  std::vector<std::unique_ptr<const FieldConversion>> fields_;
+};
+
 }  // namespace zetasql
 
 #endif  // ZETASQL_PUBLIC_PROTO_VALUE_CONVERSION_H_
@@ -199,6 +199,18 @@ class ProtoValueConversionTest : public ::testing::Test {
         << "Expression '" << expression_sql
         << "' evaluates to: " << value.DebugString()
         << " which round-trips to: " << round_tripped_value.DebugString();
+
+    // A ProtoToValueConverter gives the same result.
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<const ProtoToValueConverter> converter,
+        ProtoToValueConverter::Create(proto->GetDescriptor(),
+                                      round_tripped_type));
+    Value converted_value;
+    ZETASQL_ASSERT_OK(converter->Convert(*proto, &converted_value));
+    ASSERT_TRUE(round_tripped_value.Equals(converted_value))
+        << "Expression '" << expression_sql
+        << "' round-trips to: " << round_tripped_value.DebugString()
+        << " but is converted to: " << converted_value.DebugString();
   }
 
   google::protobuf::DescriptorPool descriptor_pool_;
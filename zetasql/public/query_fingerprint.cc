@@ -0,0 +1,150 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/query_fingerprint.h"
+
+#include <vector>
+
+#include "zetasql/public/parse_resume_location.h"
+#include "zetasql/public/parse_tokens.h"
+#include "zetasql/public/strings.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_join.h"
+#include "farmhash.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+
+constexpr char kLiteral[] = "?";
+
+// Collects the normalized tokens of a query.
+class QueryNormalizer {
+ public:
+  void AddToken(const ParseToken& token) {
+    switch (token.kind()) {
+      case ParseToken::VALUE:
+        AddLiteral();
+        return;
+      case ParseToken::IDENTIFIER:
+        if (after_at_sign_) {
+          // A quoted named parameter, e.g. @`param`.
+          after_at_sign_ = false;
+          tokens_.back() = kLiteral;
+          return;
+        }
+        tokens_.push_back(
+            ToIdentifierLiteral(absl::AsciiStrToLower(token.GetIdentifier())));
+        return;
+      case ParseToken::IDENTIFIER_OR_KEYWORD:
+        if (after_at_sign_) {
+          after_at_sign_ = false;
+          tokens_.back() = kLiteral;
+          return;
+        }
+        tokens_.push_back(absl::AsciiStrToLower(token.GetImage()));
+        return;
+      case ParseToken::KEYWORD:
+        AddKeyword(token.GetKeyword());
+        return;
+      case ParseToken::COMMENT:
+      case ParseToken::END_OF_INPUT:
+        return;
+    }
+  }
+
+  // Returns the normalized tokens separated by spaces.
+  std::string Finish() {
+    while (!tokens_.empty() && tokens_.back() == ";") tokens_.pop_back();
+    return absl::StrJoin(tokens_, " ");
+  }
+
+ private:
+  void AddLiteral() {
+    after_at_sign_ = false;
+    tokens_.push_back(kLiteral);
+  }
+
+  void AddKeyword(std::string keyword) {
+    after_at_sign_ = false;
+    if (keyword == "TRUE" || keyword == "FALSE") {
+      AddLiteral();
+    } else if (keyword == "@") {
+      after_at_sign_ = true;
+      tokens_.push_back(std::move(keyword));
+    } else if (keyword == ")") {
+      tokens_.push_back(std::move(keyword));
+      CollapseInList();
+    } else {
+      tokens_.push_back(std::move(keyword));
+    }
+  }
+
+  // Replaces "IN ( ? , ? , ... )" at the end of 'tokens_' by "IN ( ? )". The
+  // literals may be negative numbers, which are "- ?".
+  void CollapseInList() {
+    int i = static_cast<int>(tokens_.size()) - 2;
+    bool expect_literal = true;
+    while (i >= 0) {
+      const std::string& token = tokens_[i];
+      if (expect_literal) {
+        if (token != kLiteral) return;
+        if (i > 0 && tokens_[i - 1] == "-") --i;
+      } else if (token == "(") {
+        break;
+      } else if (token != ",") {
+        return;
+      }
+      expect_literal = !expect_literal;
+      --i;
+    }
+    // 'i' is the index of "(", which must follow a literal.
+    if (i < 1 || expect_literal || tokens_[i - 1] != "IN") return;
+    tokens_.resize(i + 1);
+    tokens_.push_back(kLiteral);
+    tokens_.push_back(")");
+  }
+
+  std::vector<std::string> tokens_;
+  // True if the last token was "@", which starts a named parameter.
+  bool after_at_sign_ = false;
+};
+
+}  // namespace
+
+zetasql_base::StatusOr<std::string> GetNormalizedQueryText(
+    absl::string_view sql) {
+  ParseTokenOptions options;
+  options.include_literal_values = false;
+  ParseResumeLocation resume_location =
+      ParseResumeLocation::FromStringView(sql);
+  QueryNormalizer normalizer;
+  ZETASQL_RETURN_IF_ERROR(GetParseTokens(options, &resume_location,
+                                 [&normalizer](const ParseToken& token) {
+                                   normalizer.AddToken(token);
+                                   return true;
+                                 }));
+  return normalizer.Finish();
+}
+
+zetasql_base::StatusOr<uint64_t> GetQueryFingerprint(absl::string_view sql) {
+  ZETASQL_ASSIGN_OR_RETURN(const std::string normalized,
+                   GetNormalizedQueryText(sql));
+  return farmhash::Fingerprint64(normalized);
+}
+
+}  // namespace zetasql
@@ -0,0 +1,58 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_QUERY_FINGERPRINT_H_
+#define ZETASQL_PUBLIC_QUERY_FINGERPRINT_H_
+
+#include <string>
+
+#include <cstdint>
+#include "absl/strings/string_view.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// Returns a fingerprint of <sql> that is the same for queries that only
+// differ in their literals, so that logged queries can be grouped by shape
+// without analyzing them (which also needs the Catalog), unlike
+// ReplaceLiteralsByParameters(). The fingerprint only depends on the tokens of
+// <sql>, so it is cheap to compute, and it is stable across processes and
+// releases as long as the tokenizer is.
+//
+// The tokens are normalized as follows:
+// * Whitespace and comments are ignored, as are trailing semicolons.
+// * Literals (including TRUE and FALSE) and query parameters become "?".
+//   The keyword of typed literals like DATE '2019-01-01' is kept.
+// * Lists of literals in "IN (...)" count as one literal, regardless of
+//   their length.
+// * Keywords and unquoted identifiers are compared case-insensitively, and
+//   quoted identifiers are compared case-insensitively and without quotes
+//   when they do not need them.
+//
+// Since only the tokens are considered, <sql> does not need to be valid, but
+// its tokens must be; otherwise returns an error.
+zetasql_base::StatusOr<uint64_t> GetQueryFingerprint(absl::string_view sql);
+
+// Returns the normalized text of <sql> that GetQueryFingerprint() hashes, with
+// the normalized tokens separated by single spaces. Mostly useful to show the
+// shape that a group of queries have in common.
+zetasql_base::StatusOr<std::string> GetNormalizedQueryText(
+    absl::string_view sql);
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_QUERY_FINGERPRINT_H_
@@ -0,0 +1,74 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/query_fingerprint.h"
+
+#include <string>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+using ::zetasql_base::testing::IsOkAndHolds;
+using ::zetasql_base::testing::StatusIs;
+
+TEST(QueryFingerprintTest, NormalizedText) {
+  EXPECT_THAT(GetNormalizedQueryText(
+                  "select  a, 'x' FROM T\n-- comment\nWHERE b = 1.5;"),
+              IsOkAndHolds("SELECT a , ? FROM t WHERE b = ?"));
+  EXPECT_THAT(GetNormalizedQueryText("SELECT `My Col`, `Select` FROM `t`"),
+              IsOkAndHolds("SELECT `my col` , `select` FROM t"));
+  EXPECT_THAT(
+      GetNormalizedQueryText("SELECT * FROM t WHERE x IN (1, -2, 'a')"),
+      IsOkAndHolds("SELECT * FROM t WHERE x IN ( ? )"));
+  EXPECT_THAT(GetNormalizedQueryText("SELECT * FROM t WHERE x IN (a, 1)"),
+              IsOkAndHolds("SELECT * FROM t WHERE x IN ( a , ? )"));
+  EXPECT_THAT(GetNormalizedQueryText("SELECT f(1, 2), TRUE, NULL"),
+              IsOkAndHolds("SELECT f ( ? , ? ) , ? , NULL"));
+  EXPECT_THAT(GetNormalizedQueryText("SELECT @p, @`q`, ?, DATE '2019-01-01'"),
+              IsOkAndHolds("SELECT ? , ? , ? , date ?"));
+}
+
+TEST(QueryFingerprintTest, SameShapeHasSameFingerprint) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      const uint64_t fingerprint,
+      GetQueryFingerprint("SELECT a FROM t WHERE b IN (1, 2, 3) AND c = 'x'"));
+  EXPECT_THAT(GetQueryFingerprint(
+                  "select A\nfrom T where B in (4) and C = \"yy\";  "),
+              IsOkAndHolds(fingerprint));
+  EXPECT_THAT(GetQueryFingerprint("SELECT a FROM t WHERE b IN (1) AND c = @c"),
+              IsOkAndHolds(fingerprint));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      const uint64_t other_fingerprint,
+      GetQueryFingerprint("SELECT a FROM t WHERE b IN (1) OR c = 'x'"));
+  EXPECT_NE(fingerprint, other_fingerprint);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      const uint64_t other_table_fingerprint,
+      GetQueryFingerprint("SELECT a FROM u WHERE b IN (1) AND c = 'x'"));
+  EXPECT_NE(fingerprint, other_table_fingerprint);
+}
+
+TEST(QueryFingerprintTest, InvalidTokens) {
+  EXPECT_THAT(GetQueryFingerprint("SELECT 'unterminated"),
+              StatusIs(zetasql_base::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -0,0 +1,151 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/runtime_metrics.h"
+
+#include <map>
+
+#include "zetasql/base/logging.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "zetasql/base/bits.h"
+
+namespace zetasql {
+
+namespace runtime_metrics_internal {
+
+int CurrentShard() {
+  static std::atomic<int> next_shard(0);
+  thread_local const int shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return shard;
+}
+
+}  // namespace runtime_metrics_internal
+
+namespace {
+
+struct Registry {
+  absl::Mutex mutex;
+  // Sorted by name, which is the order of RuntimeMetrics::GetSnapshot().
+  std::map<std::string, const RuntimeMetric*> metrics ABSL_GUARDED_BY(mutex);
+};
+
+Registry& GetRegistry() {
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+}  // namespace
+
+void RuntimeMetric::Register() const { RuntimeMetrics::Register(this); }
+
+void RuntimeMetric::Unregister() const { RuntimeMetrics::Unregister(this); }
+
+RuntimeCounter::RuntimeCounter(absl::string_view name,
+                               absl::string_view description)
+    : RuntimeMetric(name, description) {
+  Register();
+}
+
+RuntimeCounter::~RuntimeCounter() { Unregister(); }
+
+int64_t RuntimeCounter::Value() const {
+  int64_t value = 0;
+  for (const Shard& shard : shards_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+void RuntimeCounter::AppendTo(RuntimeMetricsProto* proto) const {
+  RuntimeMetricsProto::Counter* counter = proto->add_counters();
+  counter->set_name(name());
+  counter->set_description(description());
+  counter->set_value(Value());
+}
+
+RuntimeHistogram::RuntimeHistogram(absl::string_view name,
+                                   absl::string_view description)
+    : RuntimeMetric(name, description) {
+  Register();
+}
+
+RuntimeHistogram::~RuntimeHistogram() { Unregister(); }
+
+int RuntimeHistogram::BucketForValue(int64_t value) {
+  if (value <= 0) return 0;
+  return zetasql_base::Bits::Log2FloorNonZero64(value) + 1;
+}
+
+void RuntimeHistogram::Record(int64_t value) {
+  Shard& shard = shards_[runtime_metrics_internal::CurrentShard()];
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+  shard.sum.fetch_add(value, std::memory_order_relaxed);
+  shard.buckets[BucketForValue(value)].fetch_add(1,
+                                                 std::memory_order_relaxed);
+}
+
+void RuntimeHistogram::AppendTo(RuntimeMetricsProto* proto) const {
+  RuntimeMetricsProto::Histogram* histogram = proto->add_histograms();
+  histogram->set_name(name());
+  histogram->set_description(description());
+  int64_t count = 0;
+  int64_t sum = 0;
+  int64_t buckets[kNumBuckets] = {};
+  int num_buckets = 0;
+  for (const Shard& shard : shards_) {
+    count += shard.count.load(std::memory_order_relaxed);
+    sum += shard.sum.load(std::memory_order_relaxed);
+    for (int i = 0; i < kNumBuckets; ++i) {
+      buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+      if (buckets[i] != 0 && i >= num_buckets) num_buckets = i + 1;
+    }
+  }
+  histogram->set_count(count);
+  histogram->set_sum(sum);
+  for (int i = 0; i < num_buckets; ++i) {
+    histogram->add_bucket_counts(buckets[i]);
+  }
+}
+
+void RuntimeMetrics::GetSnapshot(RuntimeMetricsProto* proto) {
+  proto->Clear();
+  Registry& registry = GetRegistry();
+  absl::MutexLock l(&registry.mutex);
+  for (const auto& entry : registry.metrics) {
+    entry.second->AppendTo(proto);
+  }
+}
+
+void RuntimeMetrics::Register(const RuntimeMetric* metric) {
+  Registry& registry = GetRegistry();
+  absl::MutexLock l(&registry.mutex);
+  if (!registry.metrics.emplace(metric->name(), metric).second) {
+    LOG(DFATAL) << "Duplicate runtime metric: " << metric->name();
+  }
+}
+
+void RuntimeMetrics::Unregister(const RuntimeMetric* metric) {
+  Registry& registry = GetRegistry();
+  absl::MutexLock l(&registry.mutex);
+  auto it = registry.metrics.find(metric->name());
+  if (it != registry.metrics.end() && it->second == metric) {
+    registry.metrics.erase(it);
+  }
+}
+
+}  // namespace zetasql
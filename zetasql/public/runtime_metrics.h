@@ -0,0 +1,160 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_RUNTIME_METRICS_H_
+#define ZETASQL_PUBLIC_RUNTIME_METRICS_H_
+
+#include <atomic>
+#include <string>
+
+#include <cstdint>
+#include "zetasql/public/runtime_metrics.pb.h"
+#include "absl/strings/string_view.h"
+
+// Process-wide counters and histograms of the internals of the analyzer, the
+// evaluator and the function libraries, e.g., the number of analyzed
+// statements, the time spent in each phase of the analysis, the bytes spilled
+// to disk by the evaluator, or the number of compiled regular expressions.
+//
+// RuntimeMetrics::GetSnapshot() returns the current values of all the
+// metrics, e.g., to export them to a monitoring system:
+//   RuntimeMetricsProto metrics;
+//   RuntimeMetrics::GetSnapshot(&metrics);
+//
+// Updating a metric does not take a lock: each metric keeps one value per
+// shard, each thread updates the shard that it is assigned to, and the shards
+// are only added up when the metric is read. Metrics are meant to be defined
+// once per process, in function-local statics that are never destroyed:
+//   RuntimeCounter& StatementsAnalyzedCounter() {
+//     static RuntimeCounter* counter = new RuntimeCounter(
+//         "analyzer/statements_analyzed", "Number of analyzed statements");
+//     return *counter;
+//   }
+
+namespace zetasql {
+
+namespace runtime_metrics_internal {
+
+constexpr int kNumShards = 16;
+
+// Returns the shard in [0, kNumShards) of the calling thread.
+int CurrentShard();
+
+}  // namespace runtime_metrics_internal
+
+// A metric registered in RuntimeMetrics. The name should be unique in the
+// process, and is of the form "<component>/<metric>".
+class RuntimeMetric {
+ public:
+  RuntimeMetric(const RuntimeMetric&) = delete;
+  RuntimeMetric& operator=(const RuntimeMetric&) = delete;
+  virtual ~RuntimeMetric() = default;
+
+  const std::string& name() const { return name_; }
+  const std::string& description() const { return description_; }
+
+ protected:
+  RuntimeMetric(absl::string_view name, absl::string_view description)
+      : name_(name), description_(description) {}
+
+  // Add the metric to RuntimeMetrics, and remove it. They are called by the
+  // constructor and the destructor of the subclasses, so that the snapshot
+  // never reads a metric that is partially constructed or destroyed.
+  void Register() const;
+  void Unregister() const;
+
+ private:
+  friend class RuntimeMetrics;
+
+  // Adds the current value of the metric to 'proto'.
+  virtual void AppendTo(RuntimeMetricsProto* proto) const = 0;
+
+  const std::string name_;
+  const std::string description_;
+};
+
+// A cumulative count, e.g., of compiled regular expressions.
+class RuntimeCounter : public RuntimeMetric {
+ public:
+  RuntimeCounter(absl::string_view name, absl::string_view description);
+  ~RuntimeCounter() override;
+
+  void Increment(int64_t delta = 1) {
+    shards_[runtime_metrics_internal::CurrentShard()].value.fetch_add(
+        delta, std::memory_order_relaxed);
+  }
+
+  // Returns the sum of all the increments so far.
+  int64_t Value() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value{0};
+  };
+
+  void AppendTo(RuntimeMetricsProto* proto) const override;
+
+  Shard shards_[runtime_metrics_internal::kNumShards];
+};
+
+// A distribution of values, e.g., the time in microseconds spent in one phase
+// of the analysis, with a power-of-two bucket per bit width of the value.
+class RuntimeHistogram : public RuntimeMetric {
+ public:
+  // Bucket 0 counts the values <= 0, and bucket i > 0 the values in
+  // [2^(i-1), 2^i).
+  static constexpr int kNumBuckets = 64;
+
+  RuntimeHistogram(absl::string_view name, absl::string_view description);
+  ~RuntimeHistogram() override;
+
+  void Record(int64_t value);
+
+  // Returns the bucket that counts 'value'.
+  static int BucketForValue(int64_t value);
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> count{0};
+    std::atomic<int64_t> sum{0};
+    std::atomic<int64_t> buckets[kNumBuckets] = {};
+  };
+
+  void AppendTo(RuntimeMetricsProto* proto) const override;
+
+  Shard shards_[runtime_metrics_internal::kNumShards];
+};
+
+// The registry of all the RuntimeMetrics of the process.
+class RuntimeMetrics {
+ public:
+  RuntimeMetrics() = delete;
+
+  // Replaces the contents of 'proto' with the current values of all the
+  // registered metrics. Metrics are read one at a time, so concurrent updates
+  // of different metrics may or may not be reflected together.
+  static void GetSnapshot(RuntimeMetricsProto* proto);
+
+ private:
+  friend class RuntimeMetric;
+
+  static void Register(const RuntimeMetric* metric);
+  static void Unregister(const RuntimeMetric* metric);
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_RUNTIME_METRICS_H_
@@ -0,0 +1,119 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/runtime_metrics.h"
+
+#include <limits>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/match.h"
+
+namespace zetasql {
+namespace {
+
+using testing::ElementsAre;
+
+const RuntimeMetricsProto::Counter* FindCounter(
+    const RuntimeMetricsProto& proto, const std::string& name) {
+  for (const RuntimeMetricsProto::Counter& counter : proto.counters()) {
+    if (counter.name() == name) return &counter;
+  }
+  return nullptr;
+}
+
+const RuntimeMetricsProto::Histogram* FindHistogram(
+    const RuntimeMetricsProto& proto, const std::string& name) {
+  for (const RuntimeMetricsProto::Histogram& histogram : proto.histograms()) {
+    if (histogram.name() == name) return &histogram;
+  }
+  return nullptr;
+}
+
+TEST(RuntimeMetricsTest, CounterAddsIncrementsOfAllThreads) {
+  RuntimeCounter counter("test/counter", "A test counter");
+  counter.Increment();
+  counter.Increment(4);
+  EXPECT_EQ(counter.Value(), 5);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&counter] {
+      for (int j = 0; j < 1000; ++j) counter.Increment();
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(counter.Value(), 8005);
+
+  RuntimeMetricsProto proto;
+  RuntimeMetrics::GetSnapshot(&proto);
+  const RuntimeMetricsProto::Counter* counter_proto =
+      FindCounter(proto, "test/counter");
+  ASSERT_NE(counter_proto, nullptr);
+  EXPECT_EQ(counter_proto->description(), "A test counter");
+  EXPECT_EQ(counter_proto->value(), 8005);
+}
+
+TEST(RuntimeMetricsTest, HistogramBuckets) {
+  EXPECT_EQ(RuntimeHistogram::BucketForValue(-5), 0);
+  EXPECT_EQ(RuntimeHistogram::BucketForValue(0), 0);
+  EXPECT_EQ(RuntimeHistogram::BucketForValue(1), 1);
+  EXPECT_EQ(RuntimeHistogram::BucketForValue(2), 2);
+  EXPECT_EQ(RuntimeHistogram::BucketForValue(3), 2);
+  EXPECT_EQ(RuntimeHistogram::BucketForValue(4), 3);
+  EXPECT_EQ(RuntimeHistogram::BucketForValue(int64_t{1} << 62), 63);
+  EXPECT_EQ(RuntimeHistogram::BucketForValue(
+                std::numeric_limits<int64_t>::max()),
+            RuntimeHistogram::kNumBuckets - 1);
+
+  RuntimeHistogram histogram("test/histogram", "A test histogram");
+  for (const int64_t value : {0, 1, 3, 3, 6}) {
+    histogram.Record(value);
+  }
+  RuntimeMetricsProto proto;
+  RuntimeMetrics::GetSnapshot(&proto);
+  const RuntimeMetricsProto::Histogram* histogram_proto =
+      FindHistogram(proto, "test/histogram");
+  ASSERT_NE(histogram_proto, nullptr);
+  EXPECT_EQ(histogram_proto->count(), 5);
+  EXPECT_EQ(histogram_proto->sum(), 13);
+  EXPECT_THAT(histogram_proto->bucket_counts(), ElementsAre(1, 1, 2, 1));
+}
+
+TEST(RuntimeMetricsTest, SnapshotIsSortedAndOmitsDestroyedMetrics) {
+  RuntimeMetricsProto proto;
+  {
+    RuntimeCounter counter_b("test/b", "");
+    RuntimeCounter counter_a("test/a", "");
+    RuntimeMetrics::GetSnapshot(&proto);
+    std::vector<std::string> names;
+    for (const RuntimeMetricsProto::Counter& counter : proto.counters()) {
+      if (absl::StartsWith(counter.name(), "test/")) {
+        names.push_back(counter.name());
+      }
+    }
+    EXPECT_THAT(names, ElementsAre("test/a", "test/b"));
+  }
+  RuntimeMetrics::GetSnapshot(&proto);
+  EXPECT_EQ(FindCounter(proto, "test/a"), nullptr);
+  EXPECT_EQ(FindCounter(proto, "test/b"), nullptr);
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -16,8 +16,11 @@
 
 #include "zetasql/public/simple_catalog.h"
 
+#include <atomic>
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "zetasql/base/logging.h"
@@ -31,6 +34,7 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/ascii.h"
 #include "zetasql/base/case.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
 #include "zetasql/base/map_util.h"
@@ -45,18 +49,63 @@ namespace zetasql {
 SimpleCatalog::SimpleCatalog(const std::string& name, TypeFactory* type_factory)
     : name_(name), type_factory_(type_factory) {}
 
+SimpleCatalog::~SimpleCatalog() {}
+
 zetasql_base::Status SimpleCatalog::GetTable(const std::string& name,
                                      const Table** table,
                                      const FindOptions& options) {
+  const std::string lower_name = absl::AsciiStrToLower(name);
+  {
+    absl::ReaderMutexLock l(&mutex_);
+    *table = zetasql_base::FindPtrOrNull(tables_, lower_name);
+    if (*table != nullptr || lazy_tables_.empty()) {
+      return ::zetasql_base::OkStatus();
+    }
+  }
   absl::MutexLock l(&mutex_);
-  *table = zetasql_base::FindPtrOrNull(tables_, absl::AsciiStrToLower(name));
+  return MaterializeLazyTableLocked(lower_name, table);
+}
+
+zetasql_base::Status SimpleCatalog::MaterializeLazyTableLocked(
+    const std::string& lower_name, const Table** table) const {
+  // The tables may have changed while the lock was released.
+  *table = zetasql_base::FindPtrOrNull(tables_, lower_name);
+  if (*table != nullptr) return ::zetasql_base::OkStatus();
+  auto it = lazy_tables_.find(lower_name);
+  if (it == lazy_tables_.end()) return ::zetasql_base::OkStatus();
+  std::unique_ptr<SimpleTable> simple_table;
+  ZETASQL_RETURN_IF_ERROR(SimpleTable::Deserialize(
+      *it->second, lazy_table_pools_, lazy_table_type_factory_, &simple_table));
+  *table = simple_table.get();
+  tables_.emplace(lower_name, *table);
+  owned_tables_.push_back(std::move(simple_table));
+  lazy_tables_.erase(it);
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::Status SimpleCatalog::MaterializeLazyTables() const {
+  {
+    absl::ReaderMutexLock l(&mutex_);
+    if (lazy_tables_.empty()) return ::zetasql_base::OkStatus();
+  }
+  absl::MutexLock l(&mutex_);
+  std::vector<std::string> names;
+  names.reserve(lazy_tables_.size());
+  for (const auto& entry : lazy_tables_) {
+    names.push_back(entry.first);
+  }
+  zetasql_base::Status status;
+  for (const std::string& name : names) {
+    const Table* table;
+    status.Update(MaterializeLazyTableLocked(name, &table));
+  }
+  return status;
+}
+
 zetasql_base::Status SimpleCatalog::GetModel(const std::string& name,
                                      const Model** model,
                                      const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   *model = zetasql_base::FindPtrOrNull(models_, absl::AsciiStrToLower(name));
   return ::zetasql_base::OkStatus();
 }
@@ -64,7 +113,7 @@ zetasql_base::Status SimpleCatalog::GetModel(const std::string& name,
 zetasql_base::Status SimpleCatalog::GetConnection(const std::string& name,
                                           const Connection** connection,
                                           const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   *connection = zetasql_base::FindPtrOrNull(connections_, absl::AsciiStrToLower(name));
   return zetasql_base::OkStatus();
 }
@@ -72,15 +121,32 @@ zetasql_base::Status SimpleCatalog::GetConnection(const std::string& name,
 zetasql_base::Status SimpleCatalog::GetFunction(const std::string& name,
                                         const Function** function,
                                         const FindOptions& options) {
+  const std::string lower_name = absl::AsciiStrToLower(name);
+  {
+    absl::ReaderMutexLock l(&mutex_);
+    *function = zetasql_base::FindPtrOrNull(functions_, lower_name);
+    if (*function != nullptr || lazy_zetasql_functions_ == nullptr) {
+      return ::zetasql_base::OkStatus();
+    }
+  }
   absl::MutexLock l(&mutex_);
-  *function = zetasql_base::FindPtrOrNull(functions_, absl::AsciiStrToLower(name));
+  // The functions may have changed while the lock was released.
+  *function = zetasql_base::FindPtrOrNull(functions_, lower_name);
+  if (*function == nullptr && lazy_zetasql_functions_ != nullptr) {
+    *function = lazy_zetasql_functions_->Find(
+        absl::StrCat(lazy_zetasql_function_prefix_, lower_name));
+    if (*function != nullptr) {
+      // Later lookups of this name do not need to go to the shared functions.
+      functions_.emplace(lower_name, *function);
+    }
+  }
   return ::zetasql_base::OkStatus();
 }
 
 zetasql_base::Status SimpleCatalog::GetTableValuedFunction(
     const std::string& name, const TableValuedFunction** function,
     const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   *function =
       zetasql_base::FindPtrOrNull(table_valued_functions_, absl::AsciiStrToLower(name));
   return ::zetasql_base::OkStatus();
@@ -89,7 +155,7 @@ zetasql_base::Status SimpleCatalog::GetTableValuedFunction(
 zetasql_base::Status SimpleCatalog::GetProcedure(const std::string& name,
                                          const Procedure** procedure,
                                          const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   *procedure = zetasql_base::FindPtrOrNull(procedures_, absl::AsciiStrToLower(name));
   return ::zetasql_base::OkStatus();
 }
@@ -98,7 +164,7 @@ zetasql_base::Status SimpleCatalog::GetType(const std::string& name, const Type*
                                     const FindOptions& options) {
   const google::protobuf::DescriptorPool* pool;
   {
-    absl::MutexLock l(&mutex_);
+    absl::ReaderMutexLock l(&mutex_);
     // Types contained in types_ have case-insensitive names, so we lowercase
     // the name as is done in AddType.
     *type = zetasql_base::FindPtrOrNull(types_, absl::AsciiStrToLower(name));
@@ -129,7 +195,7 @@ zetasql_base::Status SimpleCatalog::GetType(const std::string& name, const Type*
 zetasql_base::Status SimpleCatalog::GetCatalog(const std::string& name,
                                        Catalog** catalog,
                                        const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   *catalog = zetasql_base::FindPtrOrNull(catalogs_, absl::AsciiStrToLower(name));
   return ::zetasql_base::OkStatus();
 }
@@ -137,7 +203,7 @@ zetasql_base::Status SimpleCatalog::GetCatalog(const std::string& name,
 zetasql_base::Status SimpleCatalog::GetConstant(const std::string& name,
                                         const Constant** constant,
                                         const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   *constant = zetasql_base::FindPtrOrNull(constants_, absl::AsciiStrToLower(name));
   return ::zetasql_base::OkStatus();
 }
@@ -257,8 +323,10 @@ std::string SimpleCatalog::SuggestConstant(
 }
 
 void SimpleCatalog::AddTable(const std::string& name, const Table* table) {
+  const std::string lower_name = absl::AsciiStrToLower(name);
   absl::MutexLock l(&mutex_);
-  zetasql_base::InsertOrDie(&tables_, absl::AsciiStrToLower(name), table);
+  CHECK(!lazy_tables_.contains(lower_name)) << "Duplicate table " << name;
+  zetasql_base::InsertOrDie(&tables_, lower_name, table);
 }
 
 void SimpleCatalog::AddModel(const std::string& name, const Model* model) {
@@ -345,9 +413,10 @@ void SimpleCatalog::AddOwnedTable(const std::string& name,
 
 bool SimpleCatalog::AddOwnedTableIfNotPresent(
     const std::string& name, std::unique_ptr<const Table> table) {
+  const std::string lower_name = absl::AsciiStrToLower(name);
   absl::MutexLock l(&mutex_);
-  if (!zetasql_base::InsertIfNotPresent(&tables_, absl::AsciiStrToLower(name),
-                               table.get())) {
+  if (lazy_tables_.contains(lower_name) ||
+      !zetasql_base::InsertIfNotPresent(&tables_, lower_name, table.get())) {
     return false;
   }
   owned_tables_.emplace_back(std::move(table));
@@ -661,6 +730,30 @@ void SimpleCatalog::SetOwnedDescriptorPool(const google::protobuf::DescriptorPoo
   descriptor_pool_ = pool;
 }
 
+SimpleCatalog* SimpleCatalog::GetOrCreateZetaSQLSubcatalog(
+    const std::string& space, TypeFactory* type_factory) {
+  absl::MutexLock l(&mutex_);
+  auto sub_entry = owned_zetasql_subcatalogs_.find(space);
+  if (sub_entry != owned_zetasql_subcatalogs_.end()) {
+    CHECK(sub_entry->second != nullptr) << "internal state corrupt: " << space;
+    return sub_entry->second.get();
+  }
+  auto new_catalog = absl::make_unique<SimpleCatalog>(space, type_factory);
+  AddCatalogLocked(space, new_catalog.get());
+  SimpleCatalog* catalog = new_catalog.get();
+  CHECK(owned_zetasql_subcatalogs_.emplace(space, std::move(new_catalog))
+            .second);
+  return catalog;
+}
+
+SimpleCatalog* SimpleCatalog::GetOrCreateZetaSQLFunctionCatalog(
+    const Function& function, TypeFactory* type_factory) {
+  const std::vector<std::string>& path = function.FunctionNamePath();
+  if (path.size() <= 1) return this;
+  CHECK_LE(path.size(), 2);
+  return GetOrCreateZetaSQLSubcatalog(path[0], type_factory);
+}
+
 void SimpleCatalog::AddZetaSQLFunctions(
     const ZetaSQLBuiltinFunctionOptions& options) {
   std::map<std::string, std::unique_ptr<Function>> function_map;
@@ -668,35 +761,72 @@ void SimpleCatalog::AddZetaSQLFunctions(
   TypeFactory* type_factory = this->type_factory();
   GetZetaSQLFunctions(type_factory, options, &function_map);
   for (auto& function_pair : function_map) {
-    const std::vector<std::string>& path =
-        function_pair.second->FunctionNamePath();
-    SimpleCatalog* catalog = this;
-    if (path.size() > 1) {
-      CHECK_LE(path.size(), 2);
-      absl::MutexLock l(&mutex_);
-      const std::string& space = path[0];
-      auto sub_entry = owned_zetasql_subcatalogs_.find(space);
-      if (sub_entry != owned_zetasql_subcatalogs_.end()) {
-        catalog = sub_entry->second.get();
-        CHECK(catalog != nullptr) << "internal state corrupt: " << space;
-      } else {
-        auto new_catalog =
-            absl::make_unique<SimpleCatalog>(space, type_factory);
-        AddCatalogLocked(space, new_catalog.get());
-        catalog = new_catalog.get();
-        CHECK(
-            owned_zetasql_subcatalogs_.emplace(space, std::move(new_catalog))
-                .second);
-      }
+    SimpleCatalog* catalog =
+        GetOrCreateZetaSQLFunctionCatalog(*function_pair.second, type_factory);
+    const std::string name = function_pair.second->FunctionNamePath().back();
+    catalog->AddOwnedFunction(name, std::move(function_pair.second));
+  }
+}
+
+void SimpleCatalog::AddSharedZetaSQLFunctions(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  // We have to call type_factory() while not holding mutex_.
+  TypeFactory* type_factory = this->type_factory();
+  for (const auto& function_pair : GetSharedZetaSQLFunctions(options)) {
+    SimpleCatalog* catalog =
+        GetOrCreateZetaSQLFunctionCatalog(*function_pair.second, type_factory);
+    catalog->AddFunction(function_pair.second->FunctionNamePath().back(),
+                         function_pair.second.get());
+  }
+}
+
+void SimpleCatalog::AddLazyZetaSQLFunctions(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  LazyZetaSQLFunctions* lazy_functions =
+      LazyZetaSQLFunctions::GetShared(options);
+  // We have to call type_factory() while not holding mutex_.
+  TypeFactory* type_factory = this->type_factory();
+  for (const std::string& space : lazy_functions->GetNamespaces()) {
+    SimpleCatalog* catalog = GetOrCreateZetaSQLSubcatalog(space, type_factory);
+    absl::MutexLock l(&catalog->mutex_);
+    CHECK(catalog->lazy_zetasql_functions_ == nullptr) << space;
+    catalog->lazy_zetasql_functions_ = lazy_functions;
+    catalog->lazy_zetasql_function_prefix_ = absl::StrCat(space, ".");
+  }
+  absl::MutexLock l(&mutex_);
+  CHECK(lazy_zetasql_functions_ == nullptr)
+      << "AddLazyZetaSQLFunctions can only be called once";
+  lazy_zetasql_functions_ = lazy_functions;
+}
+
+absl::flat_hash_map<std::string, const Function*>
+SimpleCatalog::AllFunctionsLocked() const {
+  absl::flat_hash_map<std::string, const Function*> functions = functions_;
+  if (lazy_zetasql_functions_ == nullptr) return functions;
+  // Functions that were not looked up yet. Functions added to this catalog
+  // take precedence, as they do for lookups.
+  const int namespace_size = lazy_zetasql_function_prefix_.empty() ? 1 : 2;
+  for (const auto& entry : lazy_zetasql_functions_->GetAll()) {
+    const Function* function = entry.second.get();
+    const std::vector<std::string>& path = function->FunctionNamePath();
+    if (path.size() != namespace_size ||
+        !absl::StartsWith(entry.first, lazy_zetasql_function_prefix_)) {
+      continue;
+    }
+    functions.emplace(absl::AsciiStrToLower(path.back()), function);
+    if (!function->alias_name().empty()) {
+      functions.emplace(absl::AsciiStrToLower(function->alias_name()),
+                        function);
     }
-    catalog->AddOwnedFunction(path.back(), std::move(function_pair.second));
   }
+  return functions;
 }
 
 void SimpleCatalog::ClearFunctions() {
   absl::MutexLock l(&mutex_);
   functions_.clear();
   owned_functions_.clear();
+  lazy_zetasql_functions_ = nullptr;
   for (const auto& pair : owned_zetasql_subcatalogs_) {
     catalogs_.erase(pair.first);
   }
@@ -714,6 +844,10 @@ void SimpleCatalog::ClearTableValuedFunctions() {
 }
 
 TypeFactory* SimpleCatalog::type_factory() {
+  {
+    absl::ReaderMutexLock l(&mutex_);
+    if (type_factory_ != nullptr) return type_factory_;
+  }
   absl::MutexLock l(&mutex_);
   if (type_factory_ == nullptr) {
     DCHECK(owned_type_factory_ == nullptr);
@@ -723,24 +857,88 @@ TypeFactory* SimpleCatalog::type_factory() {
   return type_factory_;
 }
 
-namespace {
-
-zetasql_base::Status DeserializeImpl(
+zetasql_base::Status SimpleCatalog::DeserializeTables(
     const SimpleCatalogProto& proto,
     const std::vector<const google::protobuf::DescriptorPool*>& pools,
-    SimpleCatalog* catalog) {
-  for (const auto& table_proto : proto.table()) {
-    std::unique_ptr<SimpleTable> table;
-    ZETASQL_RETURN_IF_ERROR(SimpleTable::Deserialize(
-        table_proto, pools, catalog->type_factory(), &table));
-    const std::string& name = table_proto.has_name_in_catalog()
-                                  ? table_proto.name_in_catalog()
-                                  : table_proto.name();
-    if (!catalog->AddOwnedTableIfNotPresent(name, std::move(table))) {
+    const DeserializeOptions& options, SimpleCatalog* catalog) {
+  TypeFactory* type_factory = catalog->type_factory();
+  auto table_name_in_catalog =
+      [](const SimpleTableProto& table_proto) -> const std::string& {
+    return table_proto.has_name_in_catalog() ? table_proto.name_in_catalog()
+                                             : table_proto.name();
+  };
+
+  if (options.lazy_tables) {
+    absl::MutexLock l(&catalog->mutex_);
+    catalog->lazy_table_pools_ = pools;
+    catalog->lazy_table_type_factory_ = type_factory;
+    catalog->lazy_tables_.reserve(catalog->lazy_tables_.size() +
+                                  proto.table_size());
+    for (const SimpleTableProto& table_proto : proto.table()) {
+      const std::string& name = table_name_in_catalog(table_proto);
+      const std::string lower_name = absl::AsciiStrToLower(name);
+      if (catalog->tables_.contains(lower_name) ||
+          !catalog->lazy_tables_
+               .emplace(lower_name,
+                        absl::make_unique<SimpleTableProto>(table_proto))
+               .second) {
+        return ::zetasql_base::InvalidArgumentErrorBuilder()
+               << "Duplicate table '" << name << "' in serialized catalog";
+      }
+    }
+    return ::zetasql_base::OkStatus();
+  }
+
+  std::vector<std::unique_ptr<SimpleTable>> tables(proto.table_size());
+  const int num_threads = std::min(options.num_threads, proto.table_size());
+  if (num_threads > 1) {
+    // Each thread deserializes the next table that no thread has taken yet.
+    // TypeFactory and the DescriptorPools are safe to use concurrently.
+    std::atomic<int> next_table(0);
+    std::vector<zetasql_base::Status> statuses(num_threads);
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&, i] {
+        for (int t = next_table++; t < proto.table_size(); t = next_table++) {
+          statuses[i] = SimpleTable::Deserialize(proto.table(t), pools,
+                                                 type_factory, &tables[t]);
+          if (!statuses[i].ok()) {
+            // Makes the other threads stop.
+            next_table = proto.table_size();
+            return;
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (const zetasql_base::Status& status : statuses) {
+      ZETASQL_RETURN_IF_ERROR(status);
+    }
+  } else {
+    for (int t = 0; t < proto.table_size(); ++t) {
+      ZETASQL_RETURN_IF_ERROR(SimpleTable::Deserialize(proto.table(t), pools,
+                                               type_factory, &tables[t]));
+    }
+  }
+
+  for (int t = 0; t < proto.table_size(); ++t) {
+    const std::string& name = table_name_in_catalog(proto.table(t));
+    if (!catalog->AddOwnedTableIfNotPresent(name, std::move(tables[t]))) {
       return ::zetasql_base::InvalidArgumentErrorBuilder()
              << "Duplicate table '" << name << "' in serialized catalog";
     }
   }
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::Status SimpleCatalog::DeserializeImpl(
+    const SimpleCatalogProto& proto,
+    const std::vector<const google::protobuf::DescriptorPool*>& pools,
+    const DeserializeOptions& options, SimpleCatalog* catalog) {
+  ZETASQL_RETURN_IF_ERROR(DeserializeTables(proto, pools, options, catalog));
   for (const auto& named_type_proto : proto.named_type()) {
     const Type* type;
     ZETASQL_RETURN_IF_ERROR(
@@ -755,7 +953,8 @@ zetasql_base::Status DeserializeImpl(
   for (const auto& catalog_proto : proto.catalog()) {
     std::unique_ptr<SimpleCatalog> sub_catalog(
         new SimpleCatalog(catalog_proto.name(), catalog->type_factory()));
-    ZETASQL_RETURN_IF_ERROR(DeserializeImpl(catalog_proto, pools, sub_catalog.get()));
+    ZETASQL_RETURN_IF_ERROR(
+        DeserializeImpl(catalog_proto, pools, options, sub_catalog.get()));
     if (!catalog->AddOwnedCatalogIfNotPresent(catalog_proto.name(),
                                               std::move(sub_catalog))) {
       return ::zetasql_base::InvalidArgumentErrorBuilder()
@@ -815,6 +1014,8 @@ zetasql_base::Status DeserializeImpl(
   return ::zetasql_base::OkStatus();
 }
 
+namespace {
+
 template <typename M, typename ValueContainer>
 void InsertValuesFromMap(const M& m, ValueContainer* value_container) {
   for (const auto& kv : m) {
@@ -827,10 +1028,12 @@ void InsertValuesFromMap(const M& m, ValueContainer* value_container) {
 zetasql_base::Status SimpleCatalog::Deserialize(
     const SimpleCatalogProto& proto,
     const std::vector<const google::protobuf::DescriptorPool*>& pools,
+    const DeserializeOptions& options,
     std::unique_ptr<SimpleCatalog>* result) {
   // Create a top level catalog that owns the TypeFactory.
   std::unique_ptr<SimpleCatalog> catalog(new SimpleCatalog(proto.name()));
-  ZETASQL_RETURN_IF_ERROR(DeserializeImpl(proto, pools, catalog.get()));
+  ZETASQL_RETURN_IF_ERROR(
+      DeserializeImpl(proto, pools, options, catalog.get()));
   *result = std::move(catalog);
   return ::zetasql_base::OkStatus();
 }
@@ -851,8 +1054,9 @@ zetasql_base::Status SimpleCatalog::SerializeImpl(
     FileDescriptorSetMap* file_descriptor_set_map, SimpleCatalogProto* proto,
     bool ignore_builtin, bool ignore_recursive) const {
   seen_catalogs->insert(this);
+  ZETASQL_RETURN_IF_ERROR(MaterializeLazyTables());
 
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
 
   proto->Clear();
   proto->set_name(name_);
@@ -864,8 +1068,10 @@ zetasql_base::Status SimpleCatalog::SerializeImpl(
   const std::map<std::string, const Model*> models(models_.begin(),
                                                    models_.end());
   const std::map<std::string, const Type*> types(types_.begin(), types_.end());
-  const std::map<std::string, const Function*> functions(functions_.begin(),
-                                                         functions_.end());
+  const absl::flat_hash_map<std::string, const Function*> all_functions =
+      AllFunctionsLocked();
+  const std::map<std::string, const Function*> functions(all_functions.begin(),
+                                                         all_functions.end());
   const std::map<std::string, const TableValuedFunction*>
       table_valued_functions(table_valued_functions_.begin(),
                              table_valued_functions_.end());
@@ -968,7 +1174,7 @@ zetasql_base::Status SimpleCatalog::GetCatalogs(
     absl::flat_hash_set<const Catalog*>* output) const {
   ZETASQL_RET_CHECK_NE(output, nullptr);
   ZETASQL_RET_CHECK(output->empty());
-  absl::MutexLock lock(&mutex_);
+  absl::ReaderMutexLock lock(&mutex_);
   InsertValuesFromMap(catalogs_, output);
   return zetasql_base::OkStatus();
 }
@@ -977,7 +1183,8 @@ zetasql_base::Status SimpleCatalog::GetTables(
     absl::flat_hash_set<const Table*>* output) const {
   ZETASQL_RET_CHECK_NE(output, nullptr);
   ZETASQL_RET_CHECK(output->empty());
-  absl::MutexLock lock(&mutex_);
+  ZETASQL_RETURN_IF_ERROR(MaterializeLazyTables());
+  absl::ReaderMutexLock lock(&mutex_);
   InsertValuesFromMap(tables_, output);
   return zetasql_base::OkStatus();
 }
@@ -986,7 +1193,7 @@ zetasql_base::Status SimpleCatalog::GetTypes(
     absl::flat_hash_set<const Type*>* output) const {
   ZETASQL_RET_CHECK_NE(output, nullptr);
   ZETASQL_RET_CHECK(output->empty());
-  absl::MutexLock lock(&mutex_);
+  absl::ReaderMutexLock lock(&mutex_);
   InsertValuesFromMap(types_, output);
   return zetasql_base::OkStatus();
 }
@@ -995,48 +1202,52 @@ zetasql_base::Status SimpleCatalog::GetFunctions(
     absl::flat_hash_set<const Function*>* output) const {
   ZETASQL_RET_CHECK_NE(output, nullptr);
   ZETASQL_RET_CHECK(output->empty());
-  absl::MutexLock lock(&mutex_);
-  InsertValuesFromMap(functions_, output);
+  absl::ReaderMutexLock lock(&mutex_);
+  InsertValuesFromMap(AllFunctionsLocked(), output);
   return zetasql_base::OkStatus();
 }
 
 std::vector<std::string> SimpleCatalog::table_names() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<std::string> table_names;
   zetasql_base::AppendKeysFromMap(tables_, &table_names);
+  zetasql_base::AppendKeysFromMap(lazy_tables_, &table_names);
   return table_names;
 }
 
 std::vector<const Table*> SimpleCatalog::tables() const {
-  absl::MutexLock l(&mutex_);
+  // Tables that fail to deserialize are left out; looking them up returns
+  // the error.
+  MaterializeLazyTables().IgnoreError();
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<const Table*> tables;
   zetasql_base::AppendValuesFromMap(tables_, &tables);
   return tables;
 }
 
 std::vector<const Type*> SimpleCatalog::types() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<const Type*> types;
   zetasql_base::AppendValuesFromMap(types_, &types);
   return types;
 }
 
 std::vector<std::string> SimpleCatalog::function_names() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<std::string> function_names;
-  zetasql_base::AppendKeysFromMap(functions_, &function_names);
+  zetasql_base::AppendKeysFromMap(AllFunctionsLocked(), &function_names);
   return function_names;
 }
 
 std::vector<const Function*> SimpleCatalog::functions() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<const Function*> functions;
-  zetasql_base::AppendValuesFromMap(functions_, &functions);
+  zetasql_base::AppendValuesFromMap(AllFunctionsLocked(), &functions);
   return functions;
 }
 
 std::vector<std::string> SimpleCatalog::table_valued_function_names() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<std::string> table_valued_function_names;
   zetasql_base::AppendKeysFromMap(table_valued_functions_, &table_valued_function_names);
   return table_valued_function_names;
@@ -1044,42 +1255,42 @@ std::vector<std::string> SimpleCatalog::table_valued_function_names() const {
 
 std::vector<const TableValuedFunction*> SimpleCatalog::table_valued_functions()
     const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<const TableValuedFunction*> table_valued_functions;
   zetasql_base::AppendValuesFromMap(table_valued_functions_, &table_valued_functions);
   return table_valued_functions;
 }
 
 std::vector<const Procedure*> SimpleCatalog::procedures() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<const Procedure*> procedures;
   zetasql_base::AppendValuesFromMap(procedures_, &procedures);
   return procedures;
 }
 
 std::vector<std::string> SimpleCatalog::catalog_names() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<std::string> catalog_names;
   zetasql_base::AppendKeysFromMap(catalogs_, &catalog_names);
   return catalog_names;
 }
 
 std::vector<Catalog*> SimpleCatalog::catalogs() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<Catalog*> catalogs;
   zetasql_base::AppendValuesFromMap(catalogs_, &catalogs);
   return catalogs;
 }
 
 std::vector<std::string> SimpleCatalog::constant_names() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<std::string> constant_names;
   zetasql_base::AppendKeysFromMap(constants_, &constant_names);
   return constant_names;
 }
 
 std::vector<const Constant*> SimpleCatalog::constants() const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   std::vector<const Constant*> constants;
   zetasql_base::AppendValuesFromMap(constants_, &constants);
   return constants;
@@ -1147,6 +1358,22 @@ zetasql_base::Status SimpleTable::SetPrimaryKey(std::vector<int> primary_key) {
     }
   }
   primary_key_.emplace(primary_key);
+  IndexContentsOnPrimaryKey();
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status SimpleTable::SetSortOrder(std::vector<int> sort_order) {
+  if (sort_order.empty()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Sort order of " << FullName() << " must not be empty";
+  }
+  for (int column_index : sort_order) {
+    if (column_index < 0 || column_index >= NumColumns()) {
+      return ::zetasql_base::InvalidArgumentErrorBuilder()
+             << "Invalid column index " << column_index << " in sort order";
+    }
+  }
+  sort_order_.emplace(std::move(sort_order));
   return zetasql_base::OkStatus();
 }
 
@@ -1207,6 +1434,35 @@ void SimpleTable::SetContents(const std::vector<std::vector<Value>>& rows) {
   };
 
   SetEvaluatorTableIteratorFactory(factory);
+  iterators_return_contents_ = true;
+  static std::atomic<int64_t> next_contents_version(1);
+  contents_version_ = next_contents_version++;
+  IndexContentsOnPrimaryKey();
+}
+
+std::optional<std::string> SimpleTable::GetEvaluatorContentsVersion() const {
+  if (!iterators_return_contents_) return std::optional<std::string>();
+  return absl::StrCat(contents_version_);
+}
+
+void SimpleTable::IndexContentsOnPrimaryKey() {
+  if (!iterators_return_contents_ || !primary_key_.has_value()) {
+    primary_key_index_.reset();
+    return;
+  }
+  const int num_rows =
+      column_major_contents_.empty() ? 0 : column_major_contents_[0]->size();
+  auto index = std::make_shared<
+      absl::flat_hash_map<std::vector<Value>, std::vector<int>>>();
+  for (int row_idx = 0; row_idx < num_rows; ++row_idx) {
+    std::vector<Value> key;
+    key.reserve(primary_key_->size());
+    for (const int column_idx : primary_key_.value()) {
+      key.push_back((*column_major_contents_[column_idx])[row_idx]);
+    }
+    (*index)[std::move(key)].push_back(row_idx);
+  }
+  primary_key_index_ = std::move(index);
 }
 
 zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
@@ -1219,6 +1475,50 @@ SimpleTable::CreateEvaluatorTableIterator(
   return (*evaluator_table_iterator_factory_)(column_idxs);
 }
 
+zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+SimpleTable::CreateEvaluatorTableIteratorForKeys(
+    absl::Span<const int> column_idxs,
+    absl::Span<const std::vector<Value>> keys) const {
+  if (primary_key_index_ == nullptr) {
+    // Returns an error.
+    return Table::CreateEvaluatorTableIteratorForKeys(column_idxs, keys);
+  }
+  std::vector<int> row_idxs;
+  for (const std::vector<Value>& key : keys) {
+    const std::vector<int>* key_row_idxs =
+        zetasql_base::FindOrNull(*primary_key_index_, key);
+    if (key_row_idxs != nullptr) {
+      row_idxs.insert(row_idxs.end(), key_row_idxs->begin(),
+                      key_row_idxs->end());
+    }
+  }
+  // Return the rows in their original order, once each even if 'keys' has
+  // duplicates.
+  std::sort(row_idxs.begin(), row_idxs.end());
+  row_idxs.erase(std::unique(row_idxs.begin(), row_idxs.end()),
+                 row_idxs.end());
+
+  std::vector<const Column*> columns;
+  std::vector<std::shared_ptr<const std::vector<Value>>> column_values;
+  columns.reserve(column_idxs.size());
+  column_values.reserve(column_idxs.size());
+  for (const int column_idx : column_idxs) {
+    columns.push_back(GetColumn(column_idx));
+    auto values = std::make_shared<std::vector<Value>>();
+    values->reserve(row_idxs.size());
+    for (const int row_idx : row_idxs) {
+      values->push_back((*column_major_contents_[column_idx])[row_idx]);
+    }
+    column_values.push_back(std::move(values));
+  }
+  std::unique_ptr<EvaluatorTableIterator> iter(new SimpleEvaluatorTableIterator(
+      columns, column_values,
+      /*end_status=*/zetasql_base::OkStatus(), /*filter_column_idxs=*/{},
+      /*cancel_cb=*/[]() {},
+      /*set_deadline_cb=*/[](absl::Time t) {}, zetasql_base::Clock::RealClock()));
+  return iter;
+}
+
 zetasql_base::Status SimpleTable::Serialize(
     FileDescriptorSetMap* file_descriptor_set_map,
     SimpleTableProto* proto) const {
@@ -1244,6 +1544,9 @@ zetasql_base::Status SimpleTable::Serialize(
   if (allow_duplicate_column_names_) {
     proto->set_allow_duplicate_column_names(true);
   }
+  if (row_count_estimate_.has_value()) {
+    proto->set_row_count_estimate(row_count_estimate_.value());
+  }
   return ::zetasql_base::OkStatus();
 }
 
@@ -1274,6 +1577,9 @@ zetasql_base::Status SimpleTable::Deserialize(
     }
     ZETASQL_RETURN_IF_ERROR(table->SetPrimaryKey(primary_key));
   }
+  if (proto.has_row_count_estimate()) {
+    table->set_row_count_estimate(proto.row_count_estimate());
+  }
 
   *result = std::move(table);
   return ::zetasql_base::OkStatus();
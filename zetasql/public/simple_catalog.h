@@ -53,7 +53,9 @@ class SimpleTableProto;
 // SimpleCatalog is a concrete implementation of the Catalog interface.
 // It acts as a simple container for objects in the Catalog.
 //
-// This class is thread-safe.
+// This class is thread-safe. Lookups and enumeration only take a shared lock,
+// so concurrent analyses that look up objects in the same SimpleCatalog do not
+// block each other; only adding or removing objects takes an exclusive lock.
 class SimpleCatalog : public EnumerableCatalog {
  public:
   // Construct a Catalog with catalog name <name>.
@@ -66,6 +68,7 @@ class SimpleCatalog : public EnumerableCatalog {
                          TypeFactory* type_factory = nullptr);
   SimpleCatalog(const SimpleCatalog&) = delete;
   SimpleCatalog& operator=(const SimpleCatalog&) = delete;
+  ~SimpleCatalog() override;
 
   std::string FullName() const override { return name_; }
 
@@ -268,6 +271,26 @@ class SimpleCatalog : public EnumerableCatalog {
                                  ZetaSQLBuiltinFunctionOptions())
       ABSL_LOCKS_EXCLUDED(mutex_);
 
+  // Like AddZetaSQLFunctions, but adds the functions from
+  // GetSharedZetaSQLFunctions() without copying them, so that catalogs with
+  // the same <options> share one set of built-in functions. The catalog does
+  // not own these functions, and their Types do not come from the catalog's
+  // TypeFactory.
+  void AddSharedZetaSQLFunctions(const ZetaSQLBuiltinFunctionOptions& options =
+                                       ZetaSQLBuiltinFunctionOptions())
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Like AddSharedZetaSQLFunctions, but only adds the functions from
+  // LazyZetaSQLFunctions::GetShared(<options>) as they are looked up, so that
+  // the built-in functions that are never looked up are not built. Only the
+  // subcatalogs for function namespaces are created right away. Functions
+  // added to this catalog hide the built-in functions with the same names
+  // that were not looked up yet.
+  // This can only be called once, until ClearFunctions is called.
+  void AddLazyZetaSQLFunctions(const ZetaSQLBuiltinFunctionOptions& options =
+                                     ZetaSQLBuiltinFunctionOptions())
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
   // Set the google::protobuf::DescriptorPool to use when resolving Types.
   // All message and enum types declared in <pool> will be resolvable with
   // FindType or GetType, treating the full name as one identifier.
@@ -288,8 +311,8 @@ class SimpleCatalog : public EnumerableCatalog {
 
   // Clear the set of functions stored in this Catalog and any subcatalogs
   // created for zetasql namespaces. Does not affect any other catalogs.
-  // This can be called between calls to AddZetaSQLFunctions with different
-  // options.
+  // This can be called between calls to AddZetaSQLFunctions or
+  // AddSharedZetaSQLFunctions with different options.
   void ClearFunctions() ABSL_LOCKS_EXCLUDED(mutex_);
 
   // Clear the set of table-valued functions stored in this Catalog and any
@@ -306,6 +329,28 @@ class SimpleCatalog : public EnumerableCatalog {
   static zetasql_base::Status Deserialize(
       const SimpleCatalogProto& proto,
       const std::vector<const google::protobuf::DescriptorPool*>& pools,
+      std::unique_ptr<SimpleCatalog>* result) {
+    return Deserialize(proto, pools, DeserializeOptions(), result);
+  }
+
+  // Options for how Deserialize() builds the tables of the catalog and its
+  // subcatalogs.
+  struct DeserializeOptions {
+    // If true, the SimpleTableProtos are copied into the catalog, and each
+    // table is only deserialized when it is first looked up, or when the
+    // tables of its catalog are enumerated or serialized. An invalid table
+    // proto then makes that lookup fail instead of Deserialize().
+    bool lazy_tables = false;
+    // When <lazy_tables> is false, the number of threads that deserialize the
+    // tables of each catalog. Values <= 1 deserialize them on the calling
+    // thread. If several tables are invalid, which error is returned is
+    // unspecified.
+    int num_threads = 1;
+  };
+  static zetasql_base::Status Deserialize(
+      const SimpleCatalogProto& proto,
+      const std::vector<const google::protobuf::DescriptorPool*>& pools,
+      const DeserializeOptions& options,
       std::unique_ptr<SimpleCatalog>* result);
 
   // Serialize the SimpleCatalog to proto, optionally ignoring built-in
@@ -357,6 +402,29 @@ class SimpleCatalog : public EnumerableCatalog {
   std::vector<std::string> constant_names() const ABSL_LOCKS_EXCLUDED(mutex_);
 
  private:
+  // Implementation of Deserialize() that deserializes <proto> into <catalog>.
+  static zetasql_base::Status DeserializeImpl(
+      const SimpleCatalogProto& proto,
+      const std::vector<const google::protobuf::DescriptorPool*>& pools,
+      const DeserializeOptions& options, SimpleCatalog* catalog);
+  // Deserializes the tables of <proto> into <catalog>, or records them in
+  // <lazy_tables_> if <options.lazy_tables> is set.
+  static zetasql_base::Status DeserializeTables(
+      const SimpleCatalogProto& proto,
+      const std::vector<const google::protobuf::DescriptorPool*>& pools,
+      const DeserializeOptions& options, SimpleCatalog* catalog);
+
+  // Deserializes the table in <lazy_tables_> named <lower_name>, if any, and
+  // adds it to <tables_>. Returns it in <table>, or NULL if there is no
+  // such table.
+  zetasql_base::Status MaterializeLazyTableLocked(const std::string& lower_name,
+                                          const Table** table) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Deserializes all the tables in <lazy_tables_>. Tables that fail stay in
+  // <lazy_tables_>, and the first error is returned.
+  zetasql_base::Status MaterializeLazyTables() const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
   zetasql_base::Status SerializeImpl(absl::flat_hash_set<const Catalog*>* seen_catalogs,
                              FileDescriptorSetMap* file_descriptor_set_map,
                              SimpleCatalogProto* proto, bool ignore_builtin,
@@ -388,6 +456,22 @@ class SimpleCatalog : public EnumerableCatalog {
   void AddConstantLocked(const std::string& name, const Constant* constant)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Returns the subcatalog for the built-in function namespace <space>.
+  // Creates it with <type_factory> if needed.
+  SimpleCatalog* GetOrCreateZetaSQLSubcatalog(const std::string& space,
+                                              TypeFactory* type_factory)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Returns the catalog to add the built-in <function> to, which is either
+  // this catalog or the subcatalog for its namespace.
+  SimpleCatalog* GetOrCreateZetaSQLFunctionCatalog(const Function& function,
+                                                   TypeFactory* type_factory)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns <functions_>, plus the functions from <lazy_zetasql_functions_>
+  // that were not looked up yet.
+  absl::flat_hash_map<std::string, const Function*> AllFunctionsLocked() const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
   // Unified implementation of SuggestFunction and SuggestTableValuedFunction.
   std::string SuggestFunctionOrTableValuedFunction(
       bool is_table_valued_function,
@@ -401,7 +485,9 @@ class SimpleCatalog : public EnumerableCatalog {
   TypeFactory* type_factory_ ABSL_GUARDED_BY(mutex_);
   std::unique_ptr<TypeFactory> owned_type_factory_ ABSL_GUARDED_BY(mutex_);
 
-  absl::flat_hash_map<std::string, const Table*> tables_
+  // Mutable because const methods that enumerate the tables materialize
+  // <lazy_tables_> into <tables_> and <owned_tables_>.
+  mutable absl::flat_hash_map<std::string, const Table*> tables_
       ABSL_GUARDED_BY(mutex_);
   absl::flat_hash_map<std::string, const Connection*> connections_
       ABSL_GUARDED_BY(mutex_);
@@ -420,7 +506,7 @@ class SimpleCatalog : public EnumerableCatalog {
   absl::flat_hash_map<std::string, const Constant*> constants_
       ABSL_GUARDED_BY(mutex_);
 
-  std::vector<std::unique_ptr<const Table>> owned_tables_
+  mutable std::vector<std::unique_ptr<const Table>> owned_tables_
       ABSL_GUARDED_BY(mutex_);
   std::vector<std::unique_ptr<const Model>> owned_models_
       ABSL_GUARDED_BY(mutex_);
@@ -442,6 +528,25 @@ class SimpleCatalog : public EnumerableCatalog {
   absl::flat_hash_map<std::string, std::unique_ptr<SimpleCatalog>>
       owned_zetasql_subcatalogs_ ABSL_GUARDED_BY(mutex_);
 
+  // Built-in functions added with AddLazyZetaSQLFunctions, which are added to
+  // <functions_> when they are looked up. Function names in this catalog are
+  // the names of these functions without <lazy_zetasql_function_prefix_>,
+  // which is the namespace and a '.' in subcatalogs for namespaces.
+  LazyZetaSQLFunctions* lazy_zetasql_functions_ ABSL_GUARDED_BY(mutex_) =
+      nullptr;
+  std::string lazy_zetasql_function_prefix_ ABSL_GUARDED_BY(mutex_);
+
+  // Tables from Deserialize() with DeserializeOptions::lazy_tables that were
+  // not deserialized yet, keyed like <tables_>. A name is never in both maps.
+  // They are deserialized with <lazy_table_pools_> and
+  // <lazy_table_type_factory_>.
+  mutable absl::flat_hash_map<std::string,
+                              std::unique_ptr<const SimpleTableProto>>
+      lazy_tables_ ABSL_GUARDED_BY(mutex_);
+  std::vector<const google::protobuf::DescriptorPool*> lazy_table_pools_
+      ABSL_GUARDED_BY(mutex_);
+  TypeFactory* lazy_table_type_factory_ ABSL_GUARDED_BY(mutex_) = nullptr;
+
   const google::protobuf::DescriptorPool* descriptor_pool_ ABSL_GUARDED_BY(mutex_) =
       nullptr;
   std::unique_ptr<const google::protobuf::DescriptorPool> ABSL_GUARDED_BY(mutex_)
@@ -492,6 +597,26 @@ class SimpleTable : public Table {
     return primary_key_;
   };
 
+  std::optional<int64_t> GetRowCountEstimate() const override {
+    return row_count_estimate_;
+  }
+
+  // Sets the estimate returned by GetRowCountEstimate(). SetContents() does
+  // not change it.
+  void set_row_count_estimate(int64_t row_count_estimate) {
+    row_count_estimate_ = row_count_estimate;
+  }
+
+  std::optional<std::vector<int>> GetSortOrder() const override {
+    return sort_order_;
+  }
+
+  // Declares that the contents of this table (and the rows of the iterators
+  // returned by the EvaluatorTableIteratorFactory, if any) are sorted on the
+  // columns with the given ordinal indexes. See Table::GetSortOrder(). The
+  // caller is responsible for the order; SetContents() does not check it.
+  zetasql_base::Status SetSortOrder(std::vector<int> sort_order);
+
   bool IsValueTable() const override { return is_value_table_; }
 
   void set_is_value_table(bool value) { is_value_table_ = value; }
@@ -527,6 +652,17 @@ class SimpleTable : public Table {
   // Set primary key with give column ordinal indexes.
   zetasql_base::Status SetPrimaryKey(std::vector<int> primary_key);
 
+  // True if the table has a primary key and its contents were set with
+  // SetContents(), which indexes them on the primary key.
+  bool SupportsEvaluatorKeyLookups() const override {
+    return primary_key_index_ != nullptr;
+  }
+
+  zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+  CreateEvaluatorTableIteratorForKeys(
+      absl::Span<const int> column_idxs,
+      absl::Span<const std::vector<Value>> keys) const override;
+
   int64_t GetSerializationId() const override { return id_; }
 
   // Constructs an EvaluatorTableIterator from a list of column indexes.
@@ -542,6 +678,9 @@ class SimpleTable : public Table {
       const EvaluatorTableIteratorFactory& factory) {
     evaluator_table_iterator_factory_ =
         absl::make_unique<EvaluatorTableIteratorFactory>(factory);
+    iterators_return_contents_ = false;
+    contents_version_ = 0;
+    primary_key_index_.reset();
   }
 
   // Convenience method that calls SetEvaluatorTableIteratorFactory to
@@ -556,6 +695,10 @@ class SimpleTable : public Table {
   CreateEvaluatorTableIterator(
       absl::Span<const int> column_idxs) const override;
 
+  // Returns a token that changes on every call to SetContents(), or nullopt
+  // if the contents were not set with SetContents().
+  std::optional<std::string> GetEvaluatorContentsVersion() const override;
+
   // Serialize this table into protobuf. The provided map is used to store
   // serialized FileDescriptorSets, which can be deserialized into separate
   // DescriptorPools in order to reconstruct the Type. The map may be
@@ -593,10 +736,16 @@ class SimpleTable : public Table {
   // columns_map_.
   zetasql_base::Status InsertColumnToColumnMap(const Column* column);
 
+  // Sets 'primary_key_index_' from 'column_major_contents_', or resets it if
+  // there is no primary key or 'iterators_return_contents_' is false.
+  void IndexContentsOnPrimaryKey();
+
   const std::string name_;
   bool is_value_table_ = false;
   std::vector<const Column*> columns_;
   std::optional<std::vector<int>> primary_key_;
+  std::optional<int64_t> row_count_estimate_;
+  std::optional<std::vector<int>> sort_order_;
   std::vector<std::unique_ptr<const Column>> owned_columns_;
   absl::flat_hash_map<std::string, const Column*> columns_map_;
   absl::flat_hash_set<std::string> duplicate_column_names_;
@@ -610,6 +759,18 @@ class SimpleTable : public Table {
   std::vector<std::shared_ptr<const std::vector<Value>>> column_major_contents_;
   std::unique_ptr<EvaluatorTableIteratorFactory>
       evaluator_table_iterator_factory_;
+  // True if the EvaluatorTableIterators return the rows passed to the last
+  // call to SetContents().
+  bool iterators_return_contents_ = false;
+  // Identifies the last call to SetContents(), unique across all
+  // SimpleTables. Zero if 'iterators_return_contents_' is false.
+  int64_t contents_version_ = 0;
+  // Maps the primary key values of the rows passed to SetContents() to the
+  // indexes of those rows, in increasing order. See
+  // IndexContentsOnPrimaryKey().
+  std::shared_ptr<
+      const absl::flat_hash_map<std::vector<Value>, std::vector<int>>>
+      primary_key_index_;
 
   static zetasql_base::Status ValidateNonEmptyColumnName(
       const std::string& column_name);
@@ -0,0 +1,140 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "zetasql/public/simple_catalog.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/proto/simple_catalog.pb.h"
+#include "zetasql/public/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+namespace zetasql {
+namespace {
+
+using ::testing::UnorderedElementsAre;
+using ::zetasql_base::testing::StatusIs;
+
+// Returns the proto of a catalog with tables t0 .. t<num_tables - 1>, plus a
+// subcatalog with table "sub_table".
+SimpleCatalogProto MakeCatalogProto(int num_tables) {
+  SimpleCatalog catalog("catalog");
+  for (int i = 0; i < num_tables; ++i) {
+    catalog.AddOwnedTable(absl::make_unique<SimpleTable>(
+        absl::StrCat("T", i),
+        std::vector<SimpleTable::NameAndType>{{"x", types::Int64Type()}}));
+  }
+  SimpleCatalog* sub_catalog = catalog.MakeOwnedSimpleCatalog("sub");
+  sub_catalog->AddOwnedTable(absl::make_unique<SimpleTable>(
+      "sub_table",
+      std::vector<SimpleTable::NameAndType>{{"y", types::StringType()}}));
+
+  FileDescriptorSetMap file_descriptor_set_map;
+  SimpleCatalogProto proto;
+  ZETASQL_CHECK_OK(catalog.Serialize(&file_descriptor_set_map, &proto));
+  return proto;
+}
+
+TEST(SimpleCatalogTest, DeserializeParallel) {
+  const SimpleCatalogProto proto = MakeCatalogProto(/*num_tables=*/100);
+  SimpleCatalog::DeserializeOptions options;
+  options.num_threads = 4;
+  std::unique_ptr<SimpleCatalog> catalog;
+  ZETASQL_ASSERT_OK(
+      SimpleCatalog::Deserialize(proto, /*pools=*/{}, options, &catalog));
+  EXPECT_EQ(catalog->table_names().size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    const Table* table;
+    ZETASQL_ASSERT_OK(catalog->FindTable({absl::StrCat("t", i)}, &table));
+    EXPECT_EQ(table->Name(), absl::StrCat("T", i));
+    EXPECT_EQ(table->GetColumn(0)->GetType(), types::Int64Type());
+  }
+
+  // Duplicate names are still detected.
+  SimpleCatalogProto duplicate_proto = proto;
+  *duplicate_proto.add_table() = proto.table(0);
+  EXPECT_THAT(
+      SimpleCatalog::Deserialize(duplicate_proto, {}, options, &catalog),
+      StatusIs(zetasql_base::INVALID_ARGUMENT));
+}
+
+TEST(SimpleCatalogTest, DeserializeLazyTables) {
+  const SimpleCatalogProto proto = MakeCatalogProto(/*num_tables=*/3);
+  SimpleCatalog::DeserializeOptions options;
+  options.lazy_tables = true;
+  std::unique_ptr<SimpleCatalog> catalog;
+  ZETASQL_ASSERT_OK(
+      SimpleCatalog::Deserialize(proto, /*pools=*/{}, options, &catalog));
+
+  // The names are listed before the tables are deserialized.
+  EXPECT_THAT(catalog->table_names(), UnorderedElementsAre("t0", "t1", "t2"));
+
+  const Table* table;
+  ZETASQL_ASSERT_OK(catalog->FindTable({"T1"}, &table));
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(table->Name(), "T1");
+  const Table* table2;
+  ZETASQL_ASSERT_OK(catalog->FindTable({"t1"}, &table2));
+  EXPECT_EQ(table, table2);
+  ZETASQL_ASSERT_OK(catalog->FindTable({"sub", "sub_table"}, &table));
+  EXPECT_EQ(table->GetColumn(0)->GetType(), types::StringType());
+  EXPECT_FALSE(catalog->FindTable({"t3"}, &table).ok());
+
+  // Lazy names cannot be added again.
+  EXPECT_FALSE(catalog->AddOwnedTableIfNotPresent(
+      "t2", absl::make_unique<SimpleTable>(
+                "t2", std::vector<SimpleTable::NameAndType>{})));
+
+  // Enumerating and serializing the tables deserializes the rest.
+  EXPECT_EQ(catalog->tables().size(), 3);
+  FileDescriptorSetMap file_descriptor_set_map;
+  SimpleCatalogProto reserialized;
+  ZETASQL_ASSERT_OK(
+      catalog->Serialize(&file_descriptor_set_map, &reserialized));
+  EXPECT_EQ(reserialized.DebugString(), proto.DebugString());
+}
+
+TEST(SimpleCatalogTest, DeserializeLazyTablesError) {
+  SimpleCatalogProto proto = MakeCatalogProto(/*num_tables=*/2);
+  // An unknown type makes the table invalid.
+  proto.mutable_table(1)->mutable_column(0)->mutable_type()->set_type_kind(
+      TYPE_PROTO);
+  SimpleCatalog::DeserializeOptions options;
+  options.lazy_tables = true;
+  std::unique_ptr<SimpleCatalog> catalog;
+  ZETASQL_ASSERT_OK(
+      SimpleCatalog::Deserialize(proto, /*pools=*/{}, options, &catalog));
+
+  const Table* table;
+  ZETASQL_EXPECT_OK(catalog->FindTable({"t0"}, &table));
+  EXPECT_FALSE(catalog->FindTable({"t1"}, &table).ok());
+  absl::flat_hash_set<const Table*> tables;
+  EXPECT_FALSE(catalog->GetTables(&tables).ok());
+
+  // Eager deserialization returns the error right away.
+  EXPECT_FALSE(SimpleCatalog::Deserialize(proto, {}, &catalog).ok());
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -16,15 +16,388 @@
 
 #include "zetasql/public/table_from_proto.h"
 
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "zetasql/common/mapped_file.h"
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/proto/wire_format_annotation.pb.h"
+#include "zetasql/public/proto_util.h"
+#include "zetasql/public/proto_value_conversion.h"
+#include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_builder.h"
 #include "zetasql/base/status_macros.h"
+#include "zetasql/base/statusor.h"
 
 namespace zetasql {
 
+namespace {
+
+// The records of a memory-mapped file of length-delimited protos.
+class DelimitedProtoFile {
+ public:
+  DelimitedProtoFile(const DelimitedProtoFile&) = delete;
+  DelimitedProtoFile& operator=(const DelimitedProtoFile&) = delete;
+
+  // Maps the file at <path> and finds the bounds of its records.
+  static zetasql_base::StatusOr<std::shared_ptr<const DelimitedProtoFile>> Open(
+      const std::string& path);
+
+  // The serialized protos in the file, pointing into the mapping.
+  const std::vector<absl::string_view>& rows() const { return rows_; }
+
+ private:
+  explicit DelimitedProtoFile(std::unique_ptr<MappedFile> mapped_file)
+      : mapped_file_(std::move(mapped_file)) {}
+
+  const std::unique_ptr<MappedFile> mapped_file_;
+  std::vector<absl::string_view> rows_;
+};
+
+zetasql_base::StatusOr<std::shared_ptr<const DelimitedProtoFile>>
+DelimitedProtoFile::Open(const std::string& path) {
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<MappedFile> mapped_file,
+                   MappedFile::Open(path));
+  auto file = absl::WrapUnique(new DelimitedProtoFile(std::move(mapped_file)));
+  const absl::string_view contents = file->mapped_file_->contents();
+
+  size_t position = 0;
+  while (position < contents.size()) {
+    uint64_t length = 0;
+    for (int shift = 0;; shift += 7) {
+      if (position >= contents.size() || shift >= 64) {
+        return zetasql_base::OutOfRangeErrorBuilder()
+               << "Corrupted record length at offset " << position << " in "
+               << path;
+      }
+      const uint8_t byte = contents[position++];
+      length |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) break;
+    }
+    if (length > contents.size() - position) {
+      return zetasql_base::OutOfRangeErrorBuilder()
+             << "Truncated record at offset " << position << " in " << path;
+    }
+    file->rows_.push_back(contents.substr(position, length));
+    position += length;
+  }
+  return std::shared_ptr<const DelimitedProtoFile>(std::move(file));
+}
+
+// How a column of a TableFromProto is read from a serialized row.
+struct ColumnReader {
+  enum Kind {
+    // The row itself, as a proto Value. Nothing is decoded.
+    kRowProto,
+    // A field read from the wire format with ReadProtoFields().
+    kWireField,
+    // The whole row, converted with ConvertProtoMessageToStructOrArrayValue().
+    kConvertedRow,
+    // The field at <field_index> of the converted row.
+    kConvertedField,
+  };
+  Kind kind = kConvertedRow;
+
+  // Only for kWireField. <has_bit_info> is only used for non-repeated fields,
+  // which are NULL when they are missing from the row, like in
+  // ConvertProtoMessageToStructOrArrayValue().
+  ProtoFieldInfo field_info;
+  ProtoFieldInfo has_bit_info;
+
+  // Only for kConvertedField.
+  int field_index = -1;
+};
+
+// Returns how to read the column of <type> that is unwrapped from <field>,
+// the field at <field_index> of a struct proto.
+ColumnReader MakeFieldReader(const google::protobuf::FieldDescriptor* field,
+                             int field_index, const Type* type,
+                             TypeFactory* type_factory) {
+  ColumnReader reader;
+  const Type* field_type = nullptr;
+  Value default_value;
+  // The field can be read from the wire format if it decodes to the column
+  // type without unwrapping. Otherwise, or if the field has no SQL type of its
+  // own, the row is converted as a whole.
+  if (GetProtoFieldTypeAndDefault(field, type_factory, &field_type,
+                                  &default_value)
+          .ok() &&
+      field_type->Equals(type)) {
+    reader.kind = ColumnReader::kWireField;
+    reader.field_info.descriptor = field;
+    reader.field_info.format = ProtoType::GetFormatAnnotation(field);
+    reader.field_info.type = field_type;
+    reader.field_info.default_value = default_value;
+    reader.has_bit_info.descriptor = field;
+    reader.has_bit_info.get_has_bit = true;
+  } else {
+    reader.kind = ColumnReader::kConvertedField;
+    reader.field_index = field_index;
+  }
+  return reader;
+}
+
+// Returns whether <value> passes <filter>, with the same semantics as
+// SimpleEvaluatorTableIterator.
+bool PassesColumnFilter(const ColumnFilter& filter, const Value& value) {
+  switch (filter.kind()) {
+    case ColumnFilter::kRange: {
+      const Value& lower_bound = filter.lower_bound();
+      const Value& upper_bound = filter.upper_bound();
+      if (lower_bound.is_valid() &&
+          lower_bound.SqlLessThan(value) != values::True() &&
+          lower_bound.SqlEquals(value) != values::True()) {
+        return false;
+      }
+      return !upper_bound.is_valid() ||
+             value.SqlLessThan(upper_bound) == values::True() ||
+             value.SqlEquals(upper_bound) == values::True();
+    }
+    case ColumnFilter::kInList:
+      for (const Value& element : filter.in_list()) {
+        if (value.SqlEquals(element) == values::True()) return true;
+      }
+      return false;
+    default:
+      // Skip this unknown column filter.
+      return true;
+  }
+}
+
+// Iterates over the rows of a DelimitedProtoFile, decoding only the requested
+// columns of each row.
+class DelimitedProtoFileIterator : public EvaluatorTableIterator {
+ public:
+  // <readers> has one entry per column in <columns>, and points into
+  // <all_readers>.
+  DelimitedProtoFileIterator(
+      std::vector<const Column*> columns,
+      std::vector<const ColumnReader*> readers,
+      std::shared_ptr<const std::vector<ColumnReader>> all_readers,
+      std::shared_ptr<const DelimitedProtoFile> file,
+      const google::protobuf::Descriptor* descriptor, const Type* row_type,
+      std::shared_ptr<const ProtoToValueConverter> row_converter,
+      std::shared_ptr<google::protobuf::DynamicMessageFactory> message_factory)
+      : columns_(std::move(columns)),
+        readers_(std::move(readers)),
+        all_readers_(std::move(all_readers)),
+        file_(std::move(file)),
+        descriptor_(descriptor),
+        row_type_(row_type),
+        row_converter_(std::move(row_converter)),
+        message_factory_(std::move(message_factory)),
+        values_(columns_.size()) {
+    for (int i = 0; i < columns_.size(); ++i) {
+      unfiltered_column_idxs_.push_back(i);
+    }
+  }
+
+  DelimitedProtoFileIterator(const DelimitedProtoFileIterator&) = delete;
+  DelimitedProtoFileIterator& operator=(const DelimitedProtoFileIterator&) =
+      delete;
+
+  int NumColumns() const override { return columns_.size(); }
+
+  std::string GetColumnName(int i) const override {
+    return columns_[i]->Name();
+  }
+
+  const Type* GetColumnType(int i) const override {
+    return columns_[i]->GetType();
+  }
+
+  zetasql_base::Status SetColumnFilterMap(
+      absl::flat_hash_map<int, std::unique_ptr<ColumnFilter>> filter_map)
+      override {
+    filter_map_ = std::move(filter_map);
+    filtered_column_idxs_.clear();
+    unfiltered_column_idxs_.clear();
+    for (int i = 0; i < columns_.size(); ++i) {
+      if (filter_map_.contains(i)) {
+        filtered_column_idxs_.push_back(i);
+      } else {
+        unfiltered_column_idxs_.push_back(i);
+      }
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  bool NextRow() override {
+    if (!status_.ok()) return false;
+    for (++row_idx_; row_idx_ < file_->rows().size(); ++row_idx_) {
+      if (cancelled_) {
+        status_ = zetasql_base::CancelledErrorBuilder()
+                  << "DelimitedProtoFileIterator was cancelled";
+        return false;
+      }
+      if (row_idx_ % kRowsPerDeadlineCheck == 0 && absl::Now() > deadline_) {
+        status_ = zetasql_base::DeadlineExceededErrorBuilder()
+                  << "DelimitedProtoFileIterator deadline exceeded";
+        return false;
+      }
+
+      // The Cord keeps the mapping alive for as long as any Value that
+      // references the row bytes.
+      row_bytes_ = absl::MakeCordFromExternal(
+          file_->rows()[row_idx_],
+          [file = file_](absl::string_view /* unused */) {});
+      row_message_.reset();
+      converted_row_ = Value();
+
+      status_ = ReadColumns(filtered_column_idxs_);
+      if (!status_.ok()) return false;
+      bool keep_row = true;
+      for (const int i : filtered_column_idxs_) {
+        if (!PassesColumnFilter(*filter_map_[i], values_[i])) {
+          keep_row = false;
+          break;
+        }
+      }
+      if (!keep_row) continue;
+
+      status_ = ReadColumns(unfiltered_column_idxs_);
+      return status_.ok();
+    }
+    return false;
+  }
+
+  const Value& GetValue(int i) const override { return values_[i]; }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  zetasql_base::Status Cancel() override {
+    cancelled_ = true;
+    return zetasql_base::OkStatus();
+  }
+
+  void SetDeadline(absl::Time deadline) override { deadline_ = deadline; }
+
+ private:
+  // How often NextRow() checks the deadline.
+  static constexpr int64_t kRowsPerDeadlineCheck = 1000;
+
+  // Sets <values_> for the columns at <column_idxs> from the current row.
+  zetasql_base::Status ReadColumns(absl::Span<const int> column_idxs) {
+    field_infos_.clear();
+    wire_column_idxs_.clear();
+    for (const int i : column_idxs) {
+      const ColumnReader& reader = *readers_[i];
+      switch (reader.kind) {
+        case ColumnReader::kRowProto:
+          values_[i] = Value::Proto(columns_[i]->GetType()->AsProto(),
+                                    row_bytes_);
+          break;
+        case ColumnReader::kWireField:
+          wire_column_idxs_.push_back(i);
+          field_infos_.push_back(&reader.field_info);
+          if (!reader.field_info.descriptor->is_repeated()) {
+            field_infos_.push_back(&reader.has_bit_info);
+          }
+          break;
+        case ColumnReader::kConvertedRow:
+          ZETASQL_RETURN_IF_ERROR(ConvertRow());
+          values_[i] = converted_row_;
+          break;
+        case ColumnReader::kConvertedField:
+          ZETASQL_RETURN_IF_ERROR(ConvertRow());
+          values_[i] = converted_row_.is_null()
+                           ? Value::Null(columns_[i]->GetType())
+                           : converted_row_.field(reader.field_index);
+          break;
+      }
+    }
+    if (field_infos_.empty()) return zetasql_base::OkStatus();
+
+    // All the fields are read in a single pass over the row.
+    ProtoFieldValueList field_values;
+    ZETASQL_RETURN_IF_ERROR(
+        ReadProtoFields(field_infos_, row_bytes_, &field_values));
+    int info_idx = 0;
+    for (const int i : wire_column_idxs_) {
+      zetasql_base::StatusOr<Value>& value = field_values[info_idx++];
+      if (!readers_[i]->field_info.descriptor->is_repeated()) {
+        const zetasql_base::StatusOr<Value>& has_bit = field_values[info_idx++];
+        ZETASQL_RETURN_IF_ERROR(has_bit.status());
+        if (!has_bit.ValueOrDie().bool_value()) {
+          values_[i] = Value::Null(columns_[i]->GetType());
+          continue;
+        }
+      }
+      ZETASQL_RETURN_IF_ERROR(value.status());
+      values_[i] = std::move(value).ValueOrDie();
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  // Parses the current row and sets <converted_row_>, unless that was
+  // already done for this row.
+  zetasql_base::Status ConvertRow() {
+    if (converted_row_.is_valid()) return zetasql_base::OkStatus();
+    if (row_message_ == nullptr) {
+      row_message_.reset(
+          message_factory_->GetPrototype(descriptor_)->New());
+    }
+    const absl::string_view bytes = file_->rows()[row_idx_];
+    if (!row_message_->ParsePartialFromArray(bytes.data(), bytes.size())) {
+      return zetasql_base::OutOfRangeErrorBuilder()
+             << "Corrupted protocol buffer in row " << row_idx_ << " of "
+             << descriptor_->full_name();
+    }
+    if (row_converter_ != nullptr) {
+      return row_converter_->Convert(*row_message_, &converted_row_);
+    }
+    return ConvertProtoMessageToStructOrArrayValue(*row_message_, row_type_,
+                                                   &converted_row_);
+  }
+
+  const std::vector<const Column*> columns_;
+  const std::vector<const ColumnReader*> readers_;
+  const std::shared_ptr<const std::vector<ColumnReader>> all_readers_;
+  const std::shared_ptr<const DelimitedProtoFile> file_;
+  const google::protobuf::Descriptor* descriptor_;
+  const Type* row_type_;
+  // Converts <row_message_> to <row_type_>. NULL if <row_type_> is neither a
+  // STRUCT nor an ARRAY.
+  const std::shared_ptr<const ProtoToValueConverter> row_converter_;
+  const std::shared_ptr<google::protobuf::DynamicMessageFactory>
+      message_factory_;
+
+  absl::flat_hash_map<int, std::unique_ptr<ColumnFilter>> filter_map_;
+  // Indexes of the columns with and without an entry in <filter_map_>.
+  std::vector<int> filtered_column_idxs_;
+  std::vector<int> unfiltered_column_idxs_;
+
+  int64_t row_idx_ = -1;
+  absl::Cord row_bytes_;
+  std::unique_ptr<google::protobuf::Message> row_message_;
+  Value converted_row_;
+  std::vector<Value> values_;
+
+  // Scratch space for ReadColumns().
+  std::vector<const ProtoFieldInfo*> field_infos_;
+  std::vector<int> wire_column_idxs_;
+
+  zetasql_base::Status status_;
+  std::atomic<bool> cancelled_{false};
+  absl::Time deadline_ = absl::InfiniteFuture();
+};
+
+}  // namespace
+
 TableFromProto::TableFromProto(const std::string& name) : SimpleTable(name) {}
 
 TableFromProto::~TableFromProto() {
@@ -34,6 +407,8 @@ zetasql_base::Status TableFromProto::Init(const google::protobuf::Descriptor* de
                                   TypeFactory* type_factory,
                                   const TableFromProtoOptions& options) {
   ZETASQL_RET_CHECK_EQ(0, NumColumns()) << "TableFromProto::Init called twice";
+  descriptor_ = descriptor;
+  type_factory_ = type_factory;
 
   const TableType table_type =
       descriptor->options().GetExtension(zetasql::table_type);
@@ -43,6 +418,7 @@ zetasql_base::Status TableFromProto::Init(const google::protobuf::Descriptor* de
     // This table is not a zetasql table.  Just treat it as a proto value
     // table.
     ZETASQL_RETURN_IF_ERROR(type_factory->MakeProtoType(descriptor, &row_type));
+    row_type_ = row_type;
     ZETASQL_RETURN_IF_ERROR(AddColumn(new SimpleColumn(FullName(), "value", row_type),
                               true /* is_owned */));
     set_is_value_table(true);
@@ -52,6 +428,7 @@ zetasql_base::Status TableFromProto::Init(const google::protobuf::Descriptor* de
   // This table is a zetasql table.  Convert the proto to a zetasql Type.
   ZETASQL_RETURN_IF_ERROR(
       type_factory->MakeUnwrappedTypeFromProto(descriptor, &row_type));
+  row_type_ = row_type;
 
   if (table_type == VALUE_TABLE) {
     // TODO If it's a proto value table, we are supposed to strip off
@@ -85,4 +462,72 @@ zetasql_base::Status TableFromProto::Init(const google::protobuf::Descriptor* de
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::Status TableFromProto::SetContentsFromDelimitedProtoFile(
+    const std::string& path) {
+  ZETASQL_RET_CHECK(descriptor_ != nullptr)
+      << "TableFromProto::Init must be called before "
+         "SetContentsFromDelimitedProtoFile";
+  const int num_proto_columns =
+      IsValueTable() ? 1 : row_type_->AsStruct()->num_fields();
+  if (NumColumns() != num_proto_columns) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "Table " << FullName()
+           << " has columns that are not read from "
+           << descriptor_->full_name();
+  }
+
+  auto readers = std::make_shared<std::vector<ColumnReader>>(NumColumns());
+  for (int i = 0; i < NumColumns(); ++i) {
+    const Type* type = GetColumn(i)->GetType();
+    ColumnReader& reader = (*readers)[i];
+    if (IsValueTable()) {
+      reader.kind =
+          type->IsProto() && type->AsProto()->descriptor() == descriptor_
+              ? ColumnReader::kRowProto
+              : ColumnReader::kConvertedRow;
+    } else if (ProtoType::GetIsStructAnnotation(descriptor_)) {
+      reader = MakeFieldReader(descriptor_->field(i), i, type, type_factory_);
+    } else {
+      reader.kind = ColumnReader::kConvertedField;
+      reader.field_index = i;
+    }
+  }
+
+  // The rows that are parsed are converted with the field mapping that is
+  // resolved here, once for all the iterators.
+  std::shared_ptr<const ProtoToValueConverter> row_converter;
+  if (row_type_->IsStruct() || row_type_->IsArray()) {
+    ZETASQL_ASSIGN_OR_RETURN(row_converter,
+                     ProtoToValueConverter::Create(descriptor_, row_type_));
+  }
+
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<const DelimitedProtoFile> file,
+                   DelimitedProtoFile::Open(path));
+  set_row_count_estimate(file->rows().size());
+  if (message_factory_ == nullptr) {
+    message_factory_ =
+        std::make_shared<google::protobuf::DynamicMessageFactory>();
+  }
+
+  auto factory = [this, readers, file, row_converter](
+                     absl::Span<const int> column_idxs)
+      -> zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>> {
+    std::vector<const Column*> columns;
+    std::vector<const ColumnReader*> column_readers;
+    for (const int column_idx : column_idxs) {
+      ZETASQL_RET_CHECK_GE(column_idx, 0);
+      ZETASQL_RET_CHECK_LT(column_idx, readers->size());
+      columns.push_back(GetColumn(column_idx));
+      column_readers.push_back(&(*readers)[column_idx]);
+    }
+    return std::unique_ptr<EvaluatorTableIterator>(
+        new DelimitedProtoFileIterator(std::move(columns),
+                                       std::move(column_readers), readers,
+                                       file, descriptor_, row_type_,
+                                       row_converter, message_factory_));
+  };
+  SetEvaluatorTableIteratorFactory(factory);
+  return ::zetasql_base::OkStatus();
+}
+
 }  // namespace zetasql
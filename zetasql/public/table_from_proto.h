@@ -17,9 +17,11 @@
 #ifndef ZETASQL_PUBLIC_TABLE_FROM_PROTO_H_
 #define ZETASQL_PUBLIC_TABLE_FROM_PROTO_H_
 
+#include <memory>
 #include <string>
 
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/dynamic_message.h"
 #include "zetasql/public/simple_catalog.h"
 #include "zetasql/public/type.h"
 #include "zetasql/base/status.h"
@@ -61,6 +63,38 @@ class TableFromProto : public SimpleTable {
                     TypeFactory* type_factory,
                     const TableFromProtoOptions& options =
                         TableFromProtoOptions());
+
+  // Sets the contents of this table to the protos stored in the file at
+  // <path>. Each proto is serialized from the descriptor passed to Init() and
+  // is preceded by its length as a varint, as written by
+  // google::protobuf::util::SerializeDelimitedToOstream().
+  //
+  // The file is memory-mapped and only its record boundaries are read
+  // up front. The iterators returned by CreateEvaluatorTableIterator() decode
+  // each row from its wire format, reading only the requested columns. A
+  // proto value table column is returned without decoding at all. Columns
+  // that are unwrapped from the proto annotations (wrappers or nested
+  // structs) are decoded by parsing the whole row. The ColumnFilters passed
+  // to SetColumnFilterMap() are checked after decoding only the filtered
+  // columns, so rows that do not match them skip the decoding of the others.
+  //
+  // Must be called after Init(), and before any columns other than the ones
+  // added by Init() are added. Replaces any previous contents or evaluator
+  // table iterator factory, and sets the row count estimate. The mapping
+  // stays alive until this table and all the iterators and Values that read
+  // from it are destroyed.
+  zetasql_base::Status SetContentsFromDelimitedProtoFile(
+      const std::string& path);
+
+ private:
+  // Set by Init().
+  const google::protobuf::Descriptor* descriptor_ = nullptr;
+  TypeFactory* type_factory_ = nullptr;
+  // Unwrapped type of <descriptor_>, or its ProtoType for a table with
+  // DEFAULT_TABLE_TYPE.
+  const Type* row_type_ = nullptr;
+  // Used to parse the rows whose columns cannot be read field by field.
+  std::shared_ptr<google::protobuf::DynamicMessageFactory> message_factory_;
 };
 
 }  // namespace zetasql
@@ -0,0 +1,153 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/table_from_proto.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/message.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/testdata/test_schema.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+
+namespace zetasql {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::zetasql_base::testing::StatusIs;
+
+// Writes <messages> to a file in the test directory as length-delimited
+// protos and returns its path.
+std::string WriteDelimitedProtoFile(
+    const std::string& name,
+    const std::vector<const google::protobuf::Message*>& messages) {
+  std::string contents;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&contents);
+    google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    for (const google::protobuf::Message* message : messages) {
+      coded_stream.WriteVarint32(message->ByteSizeLong());
+      message->SerializeToCodedStream(&coded_stream);
+    }
+  }
+  const std::string path = testing::TempDir() + "/" + name;
+  std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+  stream << contents;
+  return path;
+}
+
+// Returns the values of all the rows of <iter>.
+std::vector<std::vector<Value>> ReadRows(EvaluatorTableIterator* iter) {
+  std::vector<std::vector<Value>> rows;
+  while (iter->NextRow()) {
+    std::vector<Value> row;
+    for (int i = 0; i < iter->NumColumns(); ++i) {
+      row.push_back(iter->GetValue(i));
+    }
+    rows.push_back(row);
+  }
+  ZETASQL_EXPECT_OK(iter->Status());
+  return rows;
+}
+
+TEST(TableFromProtoTest, SqlTableFromDelimitedProtoFile) {
+  TypeFactory type_factory;
+  TableFromProto table("TestSQLTable");
+  ZETASQL_ASSERT_OK(
+      table.Init(zetasql_test::TestSQLTable::descriptor(), &type_factory));
+
+  zetasql_test::TestSQLTable row1, row2, row3;
+  row1.set_f1(1);
+  row1.set_f2(10);
+  row2.set_f1(2);
+  row3.set_f2(30);
+  ZETASQL_ASSERT_OK(table.SetContentsFromDelimitedProtoFile(
+      WriteDelimitedProtoFile("sql_table", {&row1, &row2, &row3})));
+  EXPECT_EQ(3, table.GetRowCountEstimate());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       table.CreateEvaluatorTableIterator({1}));
+  ASSERT_EQ(1, iter->NumColumns());
+  EXPECT_EQ("f2", iter->GetColumnName(0));
+  EXPECT_THAT(ReadRows(iter.get()),
+              ElementsAre(ElementsAre(Value::Int32(10)),
+                          ElementsAre(Value::NullInt32()),
+                          ElementsAre(Value::Int32(30))));
+
+  // Rows where f1 is NULL or less than 2 are skipped.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter,
+                       table.CreateEvaluatorTableIterator({1, 0}));
+  absl::flat_hash_map<int, std::unique_ptr<ColumnFilter>> filter_map;
+  filter_map[1] = absl::make_unique<ColumnFilter>(Value::Int32(2), Value());
+  ZETASQL_ASSERT_OK(iter->SetColumnFilterMap(std::move(filter_map)));
+  EXPECT_THAT(ReadRows(iter.get()),
+              ElementsAre(ElementsAre(Value::NullInt32(), Value::Int32(2))));
+}
+
+TEST(TableFromProtoTest, ProtoValueTableFromDelimitedProtoFile) {
+  TypeFactory type_factory;
+  TableFromProto table("KitchenSink");
+  ZETASQL_ASSERT_OK(
+      table.Init(zetasql_test::KitchenSinkPB::descriptor(), &type_factory));
+  ASSERT_TRUE(table.IsValueTable());
+
+  zetasql_test::KitchenSinkPB row;
+  row.set_int64_key_1(1);
+  row.set_int64_key_2(2);
+  row.set_string_val("foo");
+  ZETASQL_ASSERT_OK(table.SetContentsFromDelimitedProtoFile(
+      WriteDelimitedProtoFile("value_table", {&row, &row})));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       table.CreateEvaluatorTableIterator({0}));
+  const std::vector<std::vector<Value>> rows = ReadRows(iter.get());
+  // The Values outlive the iterator.
+  iter.reset();
+  ASSERT_EQ(2, rows.size());
+  zetasql_test::KitchenSinkPB parsed;
+  ASSERT_TRUE(parsed.ParseFromString(std::string(rows[1][0].ToCord())));
+  EXPECT_EQ(row.DebugString(), parsed.DebugString());
+}
+
+TEST(TableFromProtoTest, CorruptDelimitedProtoFile) {
+  TypeFactory type_factory;
+  TableFromProto table("TestSQLTable");
+  ZETASQL_ASSERT_OK(
+      table.Init(zetasql_test::TestSQLTable::descriptor(), &type_factory));
+
+  const std::string path = testing::TempDir() + "/truncated";
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << "\x05" << "ab";
+  EXPECT_THAT(table.SetContentsFromDelimitedProtoFile(path),
+              StatusIs(zetasql_base::OUT_OF_RANGE, HasSubstr("Truncated")));
+  EXPECT_THAT(
+      table.SetContentsFromDelimitedProtoFile(path + ".does_not_exist"),
+      StatusIs(zetasql_base::INVALID_ARGUMENT, HasSubstr("Unable to open")));
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -45,6 +45,7 @@ namespace zetasql {
 
 class AnalyzerOptions;
 class ResolvedExpr;
+class ResolvedQueryStmt;
 class SignatureMatchResult;
 class TVFInputArgumentType;
 class TVFRelationProto;
@@ -607,6 +608,22 @@ class TVFSignature {
 
   std::string DebugString() const { return DebugString(/*verbose=*/false); }
 
+  // If the call has a resolved SQL body that the resolver may splice into the
+  // calling query (see AnalyzerOptions::set_inline_templated_sql_tvfs()),
+  // returns the body. Its ResolvedArgumentRefs and
+  // ResolvedRelationArgumentScans refer to the arguments of the call by the
+  // names in sql_body_argument_names(), and its columns must be allocated
+  // from the column_id_sequence_number() of the AnalyzerOptions passed to
+  // TableValuedFunction::Resolve(). Returns NULL by default.
+  virtual const ResolvedQueryStmt* resolved_sql_body() const {
+    return nullptr;
+  }
+  // The names of the arguments of the call, in order, if resolved_sql_body()
+  // is set. Returns NULL by default.
+  virtual const std::vector<std::string>* sql_body_argument_names() const {
+    return nullptr;
+  }
+
   // Returns whether or not this TVFCall is a specific table-valued function
   // call interface or implementation.
   template <class TVFCallSubclass>
@@ -0,0 +1,78 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/templated_sql_function_call_cache.h"
+
+#include "zetasql/base/logging.h"
+
+namespace zetasql {
+
+TemplatedSQLFunctionCallCache::TemplatedSQLFunctionCallCache(int max_entries)
+    : max_entries_(max_entries) {}
+
+std::shared_ptr<TemplatedSQLFunctionCall>
+TemplatedSQLFunctionCallCache::Lookup(const Key& key) {
+  absl::MutexLock lock(&mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->call;
+}
+
+void TemplatedSQLFunctionCallCache::Insert(
+    Key key, std::shared_ptr<TemplatedSQLFunctionCall> call) {
+  if (max_entries_ <= 0) return;
+  absl::MutexLock lock(&mutex_);
+  auto inserted = entries_.emplace(std::move(key), lru_.end());
+  if (!inserted.second) {
+    // Another thread resolved the same call concurrently.
+    lru_.erase(inserted.first->second);
+    --stats_.num_entries;
+  }
+  lru_.push_front(Entry{&inserted.first->first, std::move(call)});
+  inserted.first->second = lru_.begin();
+  ++stats_.num_entries;
+  EvictLocked();
+}
+
+TemplatedSQLFunctionCallCache::Stats TemplatedSQLFunctionCallCache::GetStats()
+    const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void TemplatedSQLFunctionCallCache::Clear() {
+  absl::MutexLock lock(&mutex_);
+  entries_.clear();
+  lru_.clear();
+  stats_.num_entries = 0;
+}
+
+void TemplatedSQLFunctionCallCache::EvictLocked() {
+  while (stats_.num_entries > max_entries_) {
+    DCHECK(!lru_.empty());
+    --stats_.num_entries;
+    ++stats_.evictions;
+    entries_.erase(entries_.find(*lru_.back().key));
+    lru_.pop_back();
+  }
+}
+
+}  // namespace zetasql
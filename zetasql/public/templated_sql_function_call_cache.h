@@ -0,0 +1,131 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_TEMPLATED_SQL_FUNCTION_CALL_CACHE_H_
+#define ZETASQL_PUBLIC_TEMPLATED_SQL_FUNCTION_CALL_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/templated_sql_function.h"
+#include "zetasql/public/type.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace zetasql {
+
+// A bounded, thread-safe cache of the resolved bodies of TemplatedSQLFunction
+// calls, shared by the analyses that set it with
+// AnalyzerOptions::set_templated_sql_function_call_cache(). Without it, the
+// body of a templated function is parsed and resolved again for every call,
+// even for calls with the same argument types.
+//
+// Calls are looked up by the function, the catalog that the body is resolved
+// against, the argument types, a fingerprint of the AnalyzerOptions and a
+// caller-provided catalog version. The analyzer only caches bodies that are
+// independent of the rest of the statement: bodies of calls with simple
+// argument types, without expression subqueries or aggregates, analyzed
+// without parse locations. Other calls are resolved as usual. Errors are not
+// cached.
+//
+// The cached bodies reference objects that the Catalog returned, so callers
+// must pass a different catalog version whenever the contents of the catalog
+// or the functions change, and keep catalogs and functions alive while
+// bodies resolved against them are cached or in use. Types that the bodies
+// create come from a TypeFactory owned by the cache, which must outlive the
+// resolved ASTs that contain cached bodies.
+//
+// Entries are evicted in least recently used order once the cache holds more
+// than 'max_entries' entries.
+class TemplatedSQLFunctionCallCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+    int64_t num_entries = 0;
+  };
+
+  struct Key {
+    const TemplatedSQLFunction* function = nullptr;
+    const Catalog* catalog = nullptr;
+    std::vector<const Type*> argument_types;
+    // The serialized AnalyzerOptions.
+    std::string options;
+    std::string catalog_version;
+
+    bool operator==(const Key& other) const {
+      return function == other.function && catalog == other.catalog &&
+             argument_types == other.argument_types &&
+             options == other.options &&
+             catalog_version == other.catalog_version;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& key) {
+      return H::combine(std::move(h), key.function, key.catalog,
+                        key.argument_types, key.options, key.catalog_version);
+    }
+  };
+
+  explicit TemplatedSQLFunctionCallCache(int max_entries);
+  TemplatedSQLFunctionCallCache(const TemplatedSQLFunctionCallCache&) = delete;
+  TemplatedSQLFunctionCallCache& operator=(
+      const TemplatedSQLFunctionCallCache&) = delete;
+
+  // Returns the call cached for <key>, or NULL.
+  std::shared_ptr<TemplatedSQLFunctionCall> Lookup(const Key& key);
+
+  // Caches <call> for <key>, replacing the call cached for it, if any.
+  void Insert(Key key, std::shared_ptr<TemplatedSQLFunctionCall> call);
+
+  // The TypeFactory to resolve the bodies to cache with.
+  TypeFactory* type_factory() { return &type_factory_; }
+
+  Stats GetStats() const;
+
+  // Removes all entries. Does not reset the hit/miss/eviction counters.
+  void Clear();
+
+ private:
+  struct Entry {
+    const Key* key;  // Owned by 'entries_', which has stable keys.
+    std::shared_ptr<TemplatedSQLFunctionCall> call;
+  };
+  // The list front is the most recently used entry.
+  using LruList = std::list<Entry>;
+
+  // Evicts least recently used entries until the limit is respected.
+  void EvictLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int max_entries_;
+  TypeFactory type_factory_;
+
+  mutable absl::Mutex mutex_;
+  LruList lru_ ABSL_GUARDED_BY(mutex_);
+  absl::node_hash_map<Key, LruList::iterator> entries_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_TEMPLATED_SQL_FUNCTION_CALL_CACHE_H_
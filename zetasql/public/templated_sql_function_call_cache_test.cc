@@ -0,0 +1,119 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/templated_sql_function_call_cache.h"
+
+#include <memory>
+#include <vector>
+
+#include "zetasql/public/function.h"
+#include "zetasql/public/parse_resume_location.h"
+#include "zetasql/public/templated_sql_function.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+
+namespace zetasql {
+namespace {
+
+class TemplatedSQLFunctionCallCacheTest : public ::testing::Test {
+ protected:
+  TemplatedSQLFunctionCallCacheTest()
+      : function_({"f"},
+                  FunctionSignature(FunctionArgumentType(ARG_TYPE_ARBITRARY),
+                                    {FunctionArgumentType(ARG_TYPE_ARBITRARY)},
+                                    /*context_id=*/-1),
+                  /*argument_names=*/{"x"},
+                  ParseResumeLocation::FromString("x")) {}
+
+  TemplatedSQLFunctionCallCache::Key MakeKey(const Type* argument_type) {
+    TemplatedSQLFunctionCallCache::Key key;
+    key.function = &function_;
+    key.argument_types = {argument_type};
+    key.options = "options";
+    key.catalog_version = "v1";
+    return key;
+  }
+
+  static std::shared_ptr<TemplatedSQLFunctionCall> MakeCall(int64_t value) {
+    return std::make_shared<TemplatedSQLFunctionCall>(
+        MakeResolvedLiteral(Value::Int64(value)).release());
+  }
+
+  TemplatedSQLFunction function_;
+};
+
+TEST_F(TemplatedSQLFunctionCallCacheTest, LookupAndInsert) {
+  TemplatedSQLFunctionCallCache cache(/*max_entries=*/10);
+  EXPECT_EQ(nullptr, cache.Lookup(MakeKey(types::Int64Type())));
+
+  const std::shared_ptr<TemplatedSQLFunctionCall> call = MakeCall(1);
+  cache.Insert(MakeKey(types::Int64Type()), call);
+  EXPECT_EQ(call, cache.Lookup(MakeKey(types::Int64Type())));
+  EXPECT_EQ(nullptr, cache.Lookup(MakeKey(types::DoubleType())));
+
+  // Every part of the key matters.
+  TemplatedSQLFunctionCallCache::Key key = MakeKey(types::Int64Type());
+  key.catalog_version = "v2";
+  EXPECT_EQ(nullptr, cache.Lookup(key));
+  key = MakeKey(types::Int64Type());
+  key.options = "other options";
+  EXPECT_EQ(nullptr, cache.Lookup(key));
+
+  // A later call replaces the cached one.
+  const std::shared_ptr<TemplatedSQLFunctionCall> other_call = MakeCall(2);
+  cache.Insert(MakeKey(types::Int64Type()), other_call);
+  EXPECT_EQ(other_call, cache.Lookup(MakeKey(types::Int64Type())));
+
+  const TemplatedSQLFunctionCallCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(4, stats.misses);
+  EXPECT_EQ(1, stats.num_entries);
+}
+
+TEST_F(TemplatedSQLFunctionCallCacheTest, EvictsLeastRecentlyUsed) {
+  TemplatedSQLFunctionCallCache cache(/*max_entries=*/2);
+  cache.Insert(MakeKey(types::Int64Type()), MakeCall(1));
+  cache.Insert(MakeKey(types::DoubleType()), MakeCall(2));
+  EXPECT_NE(nullptr, cache.Lookup(MakeKey(types::Int64Type())));
+  cache.Insert(MakeKey(types::StringType()), MakeCall(3));
+
+  EXPECT_EQ(nullptr, cache.Lookup(MakeKey(types::DoubleType())));
+  EXPECT_NE(nullptr, cache.Lookup(MakeKey(types::Int64Type())));
+  EXPECT_NE(nullptr, cache.Lookup(MakeKey(types::StringType())));
+  EXPECT_EQ(1, cache.GetStats().evictions);
+  EXPECT_EQ(2, cache.GetStats().num_entries);
+
+  // Calls stay valid after they are dropped.
+  const std::shared_ptr<TemplatedSQLFunctionCall> call =
+      cache.Lookup(MakeKey(types::StringType()));
+  cache.Clear();
+  EXPECT_EQ(0, cache.GetStats().num_entries);
+  EXPECT_EQ(nullptr, cache.Lookup(MakeKey(types::StringType())));
+  EXPECT_EQ(Value::Int64(3), call->expr()->GetAs<ResolvedLiteral>()->value());
+}
+
+TEST_F(TemplatedSQLFunctionCallCacheTest, ZeroEntriesCachesNothing) {
+  TemplatedSQLFunctionCallCache cache(/*max_entries=*/0);
+  cache.Insert(MakeKey(types::Int64Type()), MakeCall(1));
+  EXPECT_EQ(nullptr, cache.Lookup(MakeKey(types::Int64Type())));
+  EXPECT_EQ(0, cache.GetStats().num_entries);
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -135,21 +135,9 @@ zetasql_base::Status TemplatedSQLTVF::Resolve(
     }
   }
 
-  // Create a separate new parser and parse the templated TVFs SQL query body.
-  // Use the same ID string pool from the original parser.
-  ParserOptions parser_options(analyzer_options->id_string_pool(),
-                               analyzer_options->arena());
-  std::unique_ptr<ParserOutput> parser_output;
-  bool at_end_of_input = false;
-  ParseResumeLocation this_parse_resume_location(parse_resume_location_);
-  ZETASQL_RETURN_IF_ERROR(ForwardNestedResolutionAnalysisError(
-      ParseNextStatement(&this_parse_resume_location, parser_options,
-                         &parser_output, &at_end_of_input),
-      analyzer_options->error_message_mode()));
-  if (parser_output->statement()->node_kind() != AST_QUERY_STATEMENT) {
-    // TODO: Attach proper error locations to the returned Status.
-    return MakeTVFQueryAnalysisError("SQL body is not a query");
-  }
+  std::shared_ptr<const ParserOutput> parser_output;
+  ZETASQL_RETURN_IF_ERROR(
+      GetParsedBody(analyzer_options->error_message_mode(), &parser_output));
 
   if (resolution_catalog_ != nullptr) {
     catalog = resolution_catalog_;
@@ -222,6 +210,30 @@ zetasql_base::Status TemplatedSQLTVF::Resolve(
   return ::zetasql_base::OkStatus();
 }
 
+zetasql_base::Status TemplatedSQLTVF::GetParsedBody(
+    ErrorMessageMode mode,
+    std::shared_ptr<const ParserOutput>* parser_output) const {
+  absl::MutexLock lock(&parser_output_mutex_);
+  if (parser_output_ == nullptr) {
+    // Parse the templated TVFs SQL query body with a separate new parser,
+    // which has its own arena and ID string pool.
+    std::unique_ptr<ParserOutput> new_parser_output;
+    bool at_end_of_input = false;
+    ParseResumeLocation this_parse_resume_location(parse_resume_location_);
+    ZETASQL_RETURN_IF_ERROR(ForwardNestedResolutionAnalysisError(
+        ParseNextStatement(&this_parse_resume_location, ParserOptions(),
+                           &new_parser_output, &at_end_of_input),
+        mode));
+    if (new_parser_output->statement()->node_kind() != AST_QUERY_STATEMENT) {
+      // TODO: Attach proper error locations to the returned Status.
+      return MakeTVFQueryAnalysisError("SQL body is not a query");
+    }
+    parser_output_ = std::move(new_parser_output);
+  }
+  *parser_output = parser_output_;
+  return ::zetasql_base::OkStatus();
+}
+
 zetasql_base::Status TemplatedSQLTVF::CheckIsValid() const {
   for (const FunctionSignature& signature : signatures_) {
     ZETASQL_RET_CHECK(std::all_of(
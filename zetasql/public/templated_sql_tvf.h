@@ -28,6 +28,8 @@
 #include "zetasql/public/parse_resume_location.h"
 #include "zetasql/public/table_valued_function.h"
 #include "zetasql/public/type.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "zetasql/base/status.h"
 
 // This file includes interfaces and classes related to templated SQL
@@ -39,6 +41,7 @@
 namespace zetasql {
 
 class AnalyzerOptions;
+class ParserOutput;
 class ResolvedQueryStmt;
 class TableValuedFunctionProto;
 
@@ -133,6 +136,13 @@ class TemplatedSQLTVF : public TableValuedFunction {
   // If 'message' is not empty, appends it to the end of the error string.
   zetasql_base::Status MakeTVFQueryAnalysisError(const std::string& message = "") const;
 
+  // Returns the parse of the SQL body in <parser_output>, parsing it on the
+  // first call. Errors are forwarded with
+  // ForwardNestedResolutionAnalysisError().
+  zetasql_base::Status GetParsedBody(
+      ErrorMessageMode mode,
+      std::shared_ptr<const ParserOutput>* parser_output) const;
+
   // If non-NULL, this Catalog is used when the Resolve() method is called
   // to resolve the TVF expression for given arguments.
   Catalog* resolution_catalog_ = nullptr;
@@ -148,6 +158,13 @@ class TemplatedSQLTVF : public TableValuedFunction {
 
   // If true, the analyzer allows query parameters within the SQL function body.
   bool allow_query_parameters_ = false;
+
+  // The parse of the SQL body, shared by all the calls once it succeeded.
+  // It has its own IdStringPool, whose strings the resolved bodies of the
+  // calls reference, so it lives as long as this function.
+  mutable absl::Mutex parser_output_mutex_;
+  mutable std::shared_ptr<const ParserOutput> parser_output_
+      ABSL_GUARDED_BY(parser_output_mutex_);
 };
 
 // The TemplatedSQLTVF::Resolve method returns an instance of this class. It
@@ -183,6 +200,13 @@ class TemplatedSQLTVFSignature : public TVFSignature {
     return arg_name_list_;
   }
 
+  const ResolvedQueryStmt* resolved_sql_body() const override {
+    return resolved_templated_query_;
+  }
+  const std::vector<std::string>* sql_body_argument_names() const override {
+    return &arg_name_list_;
+  }
+
  private:
   const ResolvedQueryStmt* const resolved_templated_query_ = nullptr;
   const std::vector<std::string> arg_name_list_;
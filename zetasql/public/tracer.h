@@ -0,0 +1,69 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_TRACER_H_
+#define ZETASQL_PUBLIC_TRACER_H_
+
+#include <memory>
+
+#include "absl/strings/string_view.h"
+
+namespace zetasql {
+
+// An interface for recording the phases of the processing of one request in
+// a tracing system, e.g., to find out why a particular request was slow.
+// Installed with AnalyzerOptions::set_tracer() and EvaluatorOptions::tracer.
+//
+// The analyzer starts the spans "parse", "resolve" and "validate". The
+// evaluator starts "algebrize" (and "validate" for resolved ASTs passed to it
+// directly) in Prepare(), "execute" around the evaluation of an expression or
+// a DML statement, and for a query "open" while the plan is set up (which
+// already reads the inputs of sorts, aggregations and the build sides of
+// joins) and "drain" from the first call to NextRow() until the output
+// iterator returns false or is destroyed.
+//
+// Spans may be started and ended on different threads, and requests may run
+// concurrently, so implementations must be thread-safe. When no tracer is
+// installed, the only cost is a NULL check per phase.
+class Tracer {
+ public:
+  // A phase in progress. Destroying it ends the phase.
+  class Span {
+   public:
+    virtual ~Span() {}
+  };
+
+  virtual ~Tracer() {}
+
+  // Starts a span called 'name'. May return NULL to ignore it.
+  virtual std::unique_ptr<Span> StartSpan(absl::string_view name) = 0;
+};
+
+// Starts a span in 'tracer' if it is not NULL, and ends it when destroyed.
+class ScopedTraceSpan {
+ public:
+  ScopedTraceSpan(Tracer* tracer, absl::string_view name)
+      : span_(tracer == nullptr ? nullptr : tracer->StartSpan(name)) {}
+  ScopedTraceSpan(const ScopedTraceSpan&) = delete;
+  ScopedTraceSpan& operator=(const ScopedTraceSpan&) = delete;
+
+ private:
+  const std::unique_ptr<Tracer::Span> span_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_TRACER_H_
@@ -21,6 +21,7 @@
 #include "zetasql/public/strings.h"
 #include "zetasql/public/types/internal_utils.h"
 #include "zetasql/public/types/type_factory.h"
+#include "absl/strings/ascii.h"
 
 namespace zetasql {
 
@@ -311,16 +312,12 @@ const google::protobuf::FieldDescriptor* ProtoType::FindFieldByNameIgnoreCase(
   const google::protobuf::FieldDescriptor* found = descriptor->FindFieldByName(name);
   if (found != nullptr) return found;
 
+  // Then use the index of lowercased field names that the DescriptorPool
+  // builds once per file, instead of comparing 'name' with every field.
   // We don't bother looking for multiple names that match.
   // Protos with duplicate names (case insensitively) do not compile in
   // c++ or java, so we don't worry about them.
-  for (int i = 0; i < descriptor->field_count(); ++i) {
-    const google::protobuf::FieldDescriptor* field = descriptor->field(i);
-    if (zetasql_base::StringCaseEqual(field->name(), name)) {
-      return field;
-    }
-  }
-  return nullptr;
+  return descriptor->FindFieldByLowercaseName(absl::AsciiStrToLower(name));
 }
 
 bool ProtoType::HasFormatAnnotation(
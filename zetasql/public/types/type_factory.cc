@@ -21,9 +21,11 @@
 #include "zetasql/public/functions/normalize_mode.pb.h"
 #include "zetasql/public/proto/type_annotation.pb.h"
 #include "zetasql/public/proto/wire_format_annotation.pb.h"
+#include "zetasql/public/runtime_metrics.h"
 #include "zetasql/public/types/internal_utils.h"
 #include "zetasql/base/cleanup.h"
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "zetasql/base/map_util.h"
 
 ABSL_FLAG(int32_t, zetasql_type_factory_nesting_depth_limit,
@@ -34,6 +36,16 @@ ABSL_FLAG(int32_t, zetasql_type_factory_nesting_depth_limit,
 
 namespace zetasql {
 
+namespace {
+
+RuntimeCounter& TypesCreatedCounter() {
+  static RuntimeCounter* counter = new RuntimeCounter(
+      "types/types_created", "Number of types created by TypeFactories");
+  return *counter;
+}
+
+}  // namespace
+
 TypeFactory::TypeFactory()
     : nesting_depth_limit_(
           absl::GetFlag(FLAGS_zetasql_type_factory_nesting_depth_limit)),
@@ -70,16 +82,14 @@ TypeFactory::~TypeFactory() {
 }
 
 int TypeFactory::nesting_depth_limit() const {
-  absl::MutexLock l(&mutex_);
-  return nesting_depth_limit_;
+  return nesting_depth_limit_.load(std::memory_order_relaxed);
 }
 
 void TypeFactory::set_nesting_depth_limit(int value) {
   // We don't want to have to check the depth for simple types, so a depth of
   // 0 must be allowed.
   DCHECK_GE(value, 0);
-  absl::MutexLock l(&mutex_);
-  nesting_depth_limit_ = value;
+  nesting_depth_limit_.store(value, std::memory_order_relaxed);
 }
 
 int64_t TypeFactory::GetEstimatedOwnedMemoryBytesSize() const {
@@ -89,14 +99,30 @@ int64_t TypeFactory::GetEstimatedOwnedMemoryBytesSize() const {
   // GetExternallyAllocatedMemoryEstimate doesn't declare thread safety (even
   // though current implementation is safe).
   absl::MutexLock l(&mutex_);
+  int64_t published_types_size =
+      internal::GetExternallyAllocatedMemoryEstimate(all_published_types_);
+  for (const auto& published : all_published_types_) {
+    published_types_size +=
+        sizeof(*published) +
+        internal::GetExternallyAllocatedMemoryEstimate(
+            published->array_types) +
+        internal::GetExternallyAllocatedMemoryEstimate(
+            published->proto_types) +
+        internal::GetExternallyAllocatedMemoryEstimate(published->enum_types) +
+        internal::GetExternallyAllocatedMemoryEstimate(
+            published->proto_field_types);
+  }
   return sizeof(*this) + estimated_memory_used_by_types_ +
+         published_types_size +
          internal::GetExternallyAllocatedMemoryEstimate(owned_types_) +
          internal::GetExternallyAllocatedMemoryEstimate(depends_on_factories_) +
          internal::GetExternallyAllocatedMemoryEstimate(
              factories_depending_on_this_) +
          internal::GetExternallyAllocatedMemoryEstimate(cached_array_types_) +
          internal::GetExternallyAllocatedMemoryEstimate(cached_proto_types_) +
-         internal::GetExternallyAllocatedMemoryEstimate(cached_enum_types_);
+         internal::GetExternallyAllocatedMemoryEstimate(cached_enum_types_) +
+         internal::GetExternallyAllocatedMemoryEstimate(
+             cached_proto_field_types_);
 }
 
 template <class TYPE>
@@ -118,6 +144,7 @@ const TYPE* TypeFactory::TakeOwnershipLocked(const TYPE* type,
   DCHECK_GT(type_owned_bytes_size, 0);
   owned_types_.push_back(type);
   estimated_memory_used_by_types_ += type_owned_bytes_size;
+  TypesCreatedCounter().Increment();
   return type;
 }
 
@@ -148,25 +175,37 @@ const Type* TypeFactory::MakeSimpleType(TypeKind kind) {
 zetasql_base::Status TypeFactory::MakeArrayType(
     const Type* element_type, const ArrayType** result) {
   *result = nullptr;
-  AddDependency(element_type);
   if (element_type->IsArray()) {
     return ::zetasql_base::InvalidArgumentErrorBuilder()
            << "Array of array types are not supported";
-  } else {
-    const int depth_limit = nesting_depth_limit();
-    if (element_type->nesting_depth() + 1 > depth_limit) {
-      return ::zetasql_base::InvalidArgumentErrorBuilder()
-             << "Array type would exceed nesting depth limit of "
-             << depth_limit;
-    }
-    absl::MutexLock lock(&mutex_);
-    auto& cached_result = cached_array_types_[element_type];
-    if (cached_result == nullptr) {
-      cached_result = TakeOwnershipLocked(new ArrayType(this, element_type));
-    }
-    *result = cached_result;
-    return ::zetasql_base::OkStatus();
   }
+  const int depth_limit = nesting_depth_limit();
+  if (element_type->nesting_depth() + 1 > depth_limit) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Array type would exceed nesting depth limit of "
+           << depth_limit;
+  }
+  // The dependency on the factory of 'element_type' was added when a cached
+  // array type was created.
+  const PublishedTypes* published =
+      published_types_.load(std::memory_order_acquire);
+  if (published != nullptr) {
+    *result = zetasql_base::FindPtrOrNull(published->array_types, element_type);
+    if (*result != nullptr) return ::zetasql_base::OkStatus();
+  }
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    *result = zetasql_base::FindPtrOrNull(cached_array_types_, element_type);
+    if (*result != nullptr) return ::zetasql_base::OkStatus();
+  }
+  AddDependency(element_type);
+  absl::MutexLock lock(&mutex_);
+  auto& cached_result = cached_array_types_[element_type];
+  if (cached_result == nullptr) {
+    cached_result = TakeOwnershipLocked(new ArrayType(this, element_type));
+  }
+  *result = cached_result;
+  return ::zetasql_base::OkStatus();
 }
 
 zetasql_base::Status TypeFactory::MakeArrayType(
@@ -217,6 +256,17 @@ zetasql_base::Status TypeFactory::MakeStructTypeFromVector(
 
 zetasql_base::Status TypeFactory::MakeProtoType(
     const google::protobuf::Descriptor* descriptor, const ProtoType** result) {
+  const PublishedTypes* published =
+      published_types_.load(std::memory_order_acquire);
+  if (published != nullptr) {
+    *result = zetasql_base::FindPtrOrNull(published->proto_types, descriptor);
+    if (*result != nullptr) return ::zetasql_base::OkStatus();
+  }
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    *result = zetasql_base::FindPtrOrNull(cached_proto_types_, descriptor);
+    if (*result != nullptr) return ::zetasql_base::OkStatus();
+  }
   absl::MutexLock lock(&mutex_);
   auto& cached_result = cached_proto_types_[descriptor];
   if (cached_result == nullptr) {
@@ -233,6 +283,18 @@ zetasql_base::Status TypeFactory::MakeProtoType(
 
 zetasql_base::Status TypeFactory::MakeEnumType(
     const google::protobuf::EnumDescriptor* enum_descriptor, const EnumType** result) {
+  const PublishedTypes* published =
+      published_types_.load(std::memory_order_acquire);
+  if (published != nullptr) {
+    *result =
+        zetasql_base::FindPtrOrNull(published->enum_types, enum_descriptor);
+    if (*result != nullptr) return ::zetasql_base::OkStatus();
+  }
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    *result = zetasql_base::FindPtrOrNull(cached_enum_types_, enum_descriptor);
+    if (*result != nullptr) return ::zetasql_base::OkStatus();
+  }
   absl::MutexLock lock(&mutex_);
   auto& cached_result = cached_enum_types_[enum_descriptor];
   if (cached_result == nullptr) {
@@ -248,6 +310,88 @@ zetasql_base::Status TypeFactory::MakeEnumType(
                       reinterpret_cast<const EnumType**>(result));
 }
 
+zetasql_base::Status TypeFactory::PreregisterTypes(
+    absl::Span<const Type* const> types) {
+  std::set<const google::protobuf::Descriptor*> visited;
+  for (const Type* type : types) {
+    ZETASQL_RETURN_IF_ERROR(PreregisterType(type, &visited));
+  }
+
+  auto published = absl::make_unique<PublishedTypes>();
+  absl::MutexLock lock(&mutex_);
+  published->array_types = cached_array_types_;
+  published->proto_types = cached_proto_types_;
+  published->enum_types = cached_enum_types_;
+  published->proto_field_types = cached_proto_field_types_;
+  published_types_.store(published.get(), std::memory_order_release);
+  all_published_types_.push_back(std::move(published));
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::Status TypeFactory::PreregisterType(
+    const Type* type, std::set<const google::protobuf::Descriptor*>* visited) {
+  switch (type->kind()) {
+    case TYPE_ARRAY:
+      return PreregisterType(type->AsArray()->element_type(), visited);
+    case TYPE_STRUCT:
+      for (const StructType::StructField& field : type->AsStruct()->fields()) {
+        ZETASQL_RETURN_IF_ERROR(PreregisterType(field.type, visited));
+      }
+      break;
+    case TYPE_PROTO:
+      ZETASQL_RETURN_IF_ERROR(
+          PreregisterMessage(type->AsProto()->descriptor(), visited));
+      break;
+    case TYPE_ENUM: {
+      const EnumType* enum_type;
+      ZETASQL_RETURN_IF_ERROR(
+          MakeEnumType(type->AsEnum()->enum_descriptor(), &enum_type));
+      if (enum_type != type) {
+        ZETASQL_RETURN_IF_ERROR(PreregisterType(enum_type, visited));
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  // Types at the nesting depth limit have no array type.
+  if (type->nesting_depth() < nesting_depth_limit()) {
+    const ArrayType* array_type;
+    ZETASQL_RETURN_IF_ERROR(MakeArrayType(type, &array_type));
+  }
+  return ::zetasql_base::OkStatus();
+}
+
+zetasql_base::Status TypeFactory::PreregisterMessage(
+    const google::protobuf::Descriptor* descriptor,
+    std::set<const google::protobuf::Descriptor*>* visited) {
+  if (!visited->insert(descriptor).second) return ::zetasql_base::OkStatus();
+  const ProtoType* proto_type;
+  ZETASQL_RETURN_IF_ERROR(MakeProtoType(descriptor, &proto_type));
+  const ArrayType* array_type;
+  if (proto_type->nesting_depth() < nesting_depth_limit()) {
+    ZETASQL_RETURN_IF_ERROR(MakeArrayType(proto_type, &array_type));
+  }
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const google::protobuf::FieldDescriptor* field = descriptor->field(i);
+    // Fields with invalid annotations have no Type; looking them up returns
+    // the error again, so they are not an error here.
+    const Type* field_type;
+    GetProtoFieldType(field, &field_type).IgnoreError();
+    if (field->message_type() != nullptr) {
+      ZETASQL_RETURN_IF_ERROR(
+          PreregisterMessage(field->message_type(), visited));
+    } else if (field->enum_type() != nullptr) {
+      const EnumType* enum_type;
+      ZETASQL_RETURN_IF_ERROR(MakeEnumType(field->enum_type(), &enum_type));
+      if (enum_type->nesting_depth() < nesting_depth_limit()) {
+        ZETASQL_RETURN_IF_ERROR(MakeArrayType(enum_type, &array_type));
+      }
+    }
+  }
+  return ::zetasql_base::OkStatus();
+}
+
 zetasql_base::Status TypeFactory::MakeUnwrappedTypeFromProto(
     const google::protobuf::Descriptor* message, bool use_obsolete_timestamp,
     const Type** result_type) {
@@ -392,41 +536,65 @@ zetasql_base::Status TypeFactory::GetProtoFieldTypeWithKind(
 zetasql_base::Status TypeFactory::GetProtoFieldType(
     bool ignore_annotations, const google::protobuf::FieldDescriptor* field_descr,
     const Type** type) {
-  TypeKind kind;
-  ZETASQL_RETURN_IF_ERROR(ProtoType::FieldDescriptorToTypeKindBase(ignore_annotations,
-                                                           field_descr, &kind));
-  ZETASQL_RETURN_IF_ERROR(GetProtoFieldTypeWithKind(field_descr, kind, type));
-  if (ZETASQL_DEBUG_MODE) {
-    // For testing, make sure the TypeKinds we get from
-    // FieldDescriptorToTypeKind match the Types returned by this method.
-    TypeKind computed_type_kind;
-    ZETASQL_RETURN_IF_ERROR(ProtoType::FieldDescriptorToTypeKind(
-        ignore_annotations, field_descr, &computed_type_kind));
-    ZETASQL_RET_CHECK_EQ((*type)->kind(), computed_type_kind)
-        << (*type)->DebugString() << "\n"
-        << field_descr->DebugString();
-  }
-  return zetasql_base::OkStatus();
+  return GetCachedProtoFieldType(field_descr, ignore_annotations,
+                                 /*use_obsolete_timestamp=*/false, type);
 }
 
 zetasql_base::Status TypeFactory::GetProtoFieldType(
     const google::protobuf::FieldDescriptor* field_descr, bool use_obsolete_timestamp,
     const Type** type) {
-  TypeKind kind;
-  ZETASQL_RETURN_IF_ERROR(ProtoType::FieldDescriptorToTypeKindBase(
-      field_descr, use_obsolete_timestamp, &kind));
+  return GetCachedProtoFieldType(field_descr, /*ignore_annotations=*/false,
+                                 use_obsolete_timestamp, type);
+}
+
+zetasql_base::Status TypeFactory::GetCachedProtoFieldType(
+    const google::protobuf::FieldDescriptor* field_descr,
+    bool ignore_annotations, bool use_obsolete_timestamp, const Type** type) {
+  const ProtoFieldTypeKey key(field_descr, ignore_annotations,
+                              use_obsolete_timestamp);
+  const PublishedTypes* published =
+      published_types_.load(std::memory_order_acquire);
+  if (published != nullptr) {
+    *type = zetasql_base::FindPtrOrNull(published->proto_field_types, key);
+    if (*type != nullptr) return ::zetasql_base::OkStatus();
+  }
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    *type = zetasql_base::FindPtrOrNull(cached_proto_field_types_, key);
+    if (*type != nullptr) return ::zetasql_base::OkStatus();
+  }
 
+  // Errors are not cached; they are recomputed on each lookup.
+  TypeKind kind;
+  if (use_obsolete_timestamp) {
+    ZETASQL_RET_CHECK(!ignore_annotations);
+    ZETASQL_RETURN_IF_ERROR(ProtoType::FieldDescriptorToTypeKindBase(
+        field_descr, /*use_obsolete_timestamp=*/true, &kind));
+  } else {
+    ZETASQL_RETURN_IF_ERROR(ProtoType::FieldDescriptorToTypeKindBase(
+        ignore_annotations, field_descr, &kind));
+  }
   ZETASQL_RETURN_IF_ERROR(GetProtoFieldTypeWithKind(field_descr, kind, type));
   if (ZETASQL_DEBUG_MODE) {
     // For testing, make sure the TypeKinds we get from
     // FieldDescriptorToTypeKind match the Types returned by this method.
     TypeKind computed_type_kind;
-    ZETASQL_RETURN_IF_ERROR(ProtoType::FieldDescriptorToTypeKind(
-        field_descr, use_obsolete_timestamp, &computed_type_kind));
+    if (use_obsolete_timestamp) {
+      ZETASQL_RETURN_IF_ERROR(ProtoType::FieldDescriptorToTypeKind(
+          field_descr, /*use_obsolete_timestamp=*/true, &computed_type_kind));
+    } else {
+      ZETASQL_RETURN_IF_ERROR(ProtoType::FieldDescriptorToTypeKind(
+          ignore_annotations, field_descr, &computed_type_kind));
+    }
     ZETASQL_RET_CHECK_EQ((*type)->kind(), computed_type_kind)
-        << (*type)->DebugString() << "\n" << field_descr->DebugString();
+        << (*type)->DebugString() << "\n"
+        << field_descr->DebugString();
   }
 
+  // The factory returns the same Type for the same field and options, so a
+  // concurrent lookup that inserted first stored the same Type.
+  absl::MutexLock lock(&mutex_);
+  cached_proto_field_types_.emplace(key, *type);
   return ::zetasql_base::OkStatus();
 }
 
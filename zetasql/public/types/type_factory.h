@@ -17,6 +17,12 @@
 #ifndef ZETASQL_PUBLIC_TYPES_TYPE_FACTORY_H_
 #define ZETASQL_PUBLIC_TYPES_TYPE_FACTORY_H_
 
+#include <atomic>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <vector>
+
 #include "zetasql/public/types/array_type.h"
 #include "zetasql/public/types/enum_type.h"
 #include "zetasql/public/types/proto_type.h"
@@ -36,7 +42,10 @@ namespace zetasql {
 // from a separate TypeFactory, the constructed type may refer to the Type from
 // the separate TypeFactory, so that TypeFactory must outlive this one.
 //
-// This class is thread-safe.
+// This class is thread-safe. Looking up the array, proto and enum types and
+// the proto field types that were created before the last call to
+// PreregisterTypes() takes no lock, and looking up other types that were
+// already created takes a shared lock.
 class TypeFactory {
  public:
   TypeFactory();
@@ -138,6 +147,8 @@ class TypeFactory {
                             const Type** result);
 
   // Get the Type for a proto field.
+  // The Type of each field is computed once per TypeFactory and cached, so
+  // repeated lookups do not re-read the field's annotations.
   // If <ignore_annotations> is false, this looks at format annotations on the
   // field and possibly its parent message to help select the Type. If
   // <ignore_annotations> is true, annotations on the field are not considered
@@ -204,14 +215,26 @@ class TypeFactory {
       const std::vector<const google::protobuf::DescriptorPool*>& pools,
       const Type** type);
 
+  // Creates the types that MakeArrayType(), MakeProtoType() and
+  // MakeEnumType() return for 'types' ahead of time: the array type of each
+  // of 'types' that is not an array, the ProtoTypes and EnumTypes of the
+  // messages and enums they refer to (including those of proto fields,
+  // transitively), the array types of those, and the GetProtoFieldType()
+  // results of the proto fields. Afterwards, looking up any array, proto or
+  // enum type or proto field type that this factory has created so far takes
+  // no lock. This is intended for warming up the types of a catalog at startup;
+  // each call copies the lookup tables, so it should not be called often.
+  zetasql_base::Status PreregisterTypes(absl::Span<const Type* const> types)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
   // Maximum nesting depth for types supported by this TypeFactory. Any attempt
   // to create a type with a nesting_depth() greater than this will return an
   // error. If a limit is not set, the ZetaSQL analyzer may create types that
   // it cannot destruct. Use kint32max for no limit (the default).
   // The limit value must be >= 0. The default value of this field can be
   // overidden with FLAGS_zetasql_type_factory_nesting_depth_limit.
-  int nesting_depth_limit() const ABSL_LOCKS_EXCLUDED(mutex_);
-  void set_nesting_depth_limit(int value) ABSL_LOCKS_EXCLUDED(mutex_);
+  int nesting_depth_limit() const;
+  void set_nesting_depth_limit(int value);
 
   // Estimate memory size allocated to store TypeFactory's data in bytes
   int64_t GetEstimatedOwnedMemoryBytesSize() const;
@@ -238,6 +261,14 @@ class TypeFactory {
   // Mark that <other_type>'s factory must outlive <this>.
   void AddDependency(const Type* other_type) ABSL_LOCKS_EXCLUDED(mutex_);
 
+  // Creates the types for PreregisterTypes(). 'visited' holds the messages
+  // whose fields have already been visited.
+  zetasql_base::Status PreregisterType(
+      const Type* type, std::set<const google::protobuf::Descriptor*>* visited);
+  zetasql_base::Status PreregisterMessage(
+      const google::protobuf::Descriptor* descriptor,
+      std::set<const google::protobuf::Descriptor*>* visited);
+
   // Get the Type for a proto field from its corresponding TypeKind. For
   // repeated fields, <kind> must be the base TypeKind for the field (i.e., the
   // TypeKind of the field, ignoring repeatedness), which can be obtained by
@@ -246,6 +277,13 @@ class TypeFactory {
       const google::protobuf::FieldDescriptor* field_descr, TypeKind kind,
       const Type** type);
 
+  // Implementation of the GetProtoFieldType overloads. Looks up the Type in
+  // 'cached_proto_field_types_', computing and caching it on a miss.
+  zetasql_base::Status GetCachedProtoFieldType(
+      const google::protobuf::FieldDescriptor* field_descr,
+      bool ignore_annotations, bool use_obsolete_timestamp, const Type** type)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
   // Implementation of MakeUnwrappedTypeFromProto above that detects invalid use
   // of type annotations with recursive protos by storing all visited message
   // types in 'ancestor_messages'.
@@ -270,11 +308,33 @@ class TypeFactory {
       cached_proto_types_ ABSL_GUARDED_BY(mutex_);
   absl::flat_hash_map<const google::protobuf::EnumDescriptor*, const EnumType*>
       cached_enum_types_ ABSL_GUARDED_BY(mutex_);
+  // The results of GetProtoFieldType(), keyed by the field, whether
+  // annotations are ignored and whether obsolete timestamps are used.
+  using ProtoFieldTypeKey =
+      std::tuple<const google::protobuf::FieldDescriptor*, bool, bool>;
+  absl::flat_hash_map<ProtoFieldTypeKey, const Type*> cached_proto_field_types_
+      ABSL_GUARDED_BY(mutex_);
   // TODO: Once all Type objects are cached, we can likely eliminate
   // this and treat the maps above as owning the Type objects.
   std::vector<const Type*> owned_types_ ABSL_GUARDED_BY(mutex_);
 
-  int nesting_depth_limit_ ABSL_GUARDED_BY(mutex_);
+  // Copies of the maps above that are never modified once published.
+  struct PublishedTypes {
+    absl::flat_hash_map<const Type*, const ArrayType*> array_types;
+    absl::flat_hash_map<const google::protobuf::Descriptor*, const ProtoType*>
+        proto_types;
+    absl::flat_hash_map<const google::protobuf::EnumDescriptor*, const EnumType*>
+        enum_types;
+    absl::flat_hash_map<ProtoFieldTypeKey, const Type*> proto_field_types;
+  };
+  // The latest tables published by PreregisterTypes(), or NULL.
+  std::atomic<const PublishedTypes*> published_types_{nullptr};
+  // Owns all the published tables, since lock-free readers may still be
+  // using older ones.
+  std::vector<std::unique_ptr<const PublishedTypes>> all_published_types_
+      ABSL_GUARDED_BY(mutex_);
+
+  std::atomic<int> nesting_depth_limit_;
 
   // Stores estimation of how much memory was allocated by instances
   // of types owned by this TypeFactory (in bytes)
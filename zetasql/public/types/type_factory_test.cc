@@ -0,0 +1,176 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/types/type_factory.h"
+
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "google/protobuf/descriptor.h"
+#include "zetasql/testdata/test_schema.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+TEST(TypeFactoryTest, PreregisterTypes) {
+  TypeFactory factory;
+  const StructType* struct_type;
+  ZETASQL_ASSERT_OK(factory.MakeStructType(
+      {{"a", types::Int64Type()}, {"b", types::StringType()}}, &struct_type));
+  const ProtoType* proto_type;
+  ZETASQL_ASSERT_OK(factory.MakeProtoType(
+      zetasql_test::KitchenSinkPB::descriptor(), &proto_type));
+  const int64_t size_before = factory.GetEstimatedOwnedMemoryBytesSize();
+  ZETASQL_ASSERT_OK(factory.PreregisterTypes({struct_type, proto_type}));
+  EXPECT_GT(factory.GetEstimatedOwnedMemoryBytesSize(), size_before);
+
+  // The lookups return the preregistered types.
+  const ArrayType* array_type;
+  ZETASQL_ASSERT_OK(factory.MakeArrayType(struct_type, &array_type));
+  EXPECT_EQ(array_type->element_type(), struct_type);
+  const ArrayType* array_type2;
+  ZETASQL_ASSERT_OK(factory.MakeArrayType(struct_type, &array_type2));
+  EXPECT_EQ(array_type, array_type2);
+
+  // Messages and enums of proto fields are preregistered too, and looking them
+  // up returns the same types as later calls.
+  const ProtoType* nested_type;
+  ZETASQL_ASSERT_OK(factory.MakeProtoType(
+      zetasql_test::KitchenSinkPB::Nested::descriptor(), &nested_type));
+  const ProtoType* nested_type2;
+  ZETASQL_ASSERT_OK(factory.MakeProtoType(
+      zetasql_test::KitchenSinkPB::Nested::descriptor(), &nested_type2));
+  EXPECT_EQ(nested_type, nested_type2);
+  const EnumType* enum_type;
+  ZETASQL_ASSERT_OK(
+      factory.MakeEnumType(zetasql_test::TestEnum_descriptor(), &enum_type));
+  const EnumType* enum_type2;
+  ZETASQL_ASSERT_OK(
+      factory.MakeEnumType(zetasql_test::TestEnum_descriptor(), &enum_type2));
+  EXPECT_EQ(enum_type, enum_type2);
+
+  // Types created after preregistration are still cached.
+  const ArrayType* numeric_array_type;
+  ZETASQL_ASSERT_OK(
+      factory.MakeArrayType(types::NumericType(), &numeric_array_type));
+  const ArrayType* numeric_array_type2;
+  ZETASQL_ASSERT_OK(
+      factory.MakeArrayType(types::NumericType(), &numeric_array_type2));
+  EXPECT_EQ(numeric_array_type, numeric_array_type2);
+
+  // The nesting depth limit still applies to preregistered types.
+  factory.set_nesting_depth_limit(1);
+  EXPECT_FALSE(factory.MakeArrayType(struct_type, &array_type).ok());
+}
+
+TEST(TypeFactoryTest, ProtoFieldTypes) {
+  TypeFactory factory;
+  const google::protobuf::Descriptor* descriptor =
+      zetasql_test::KitchenSinkPB::descriptor();
+  const google::protobuf::FieldDescriptor* date_field =
+      descriptor->FindFieldByName("date");
+  ASSERT_NE(date_field, nullptr);
+
+  // Annotations are respected unless they are ignored, and each result is
+  // cached separately.
+  const Type* date_type;
+  ZETASQL_ASSERT_OK(factory.GetProtoFieldType(date_field, &date_type));
+  EXPECT_EQ(date_type, types::DateType());
+  const Type* raw_type;
+  ZETASQL_ASSERT_OK(factory.GetProtoFieldType(/*ignore_annotations=*/true,
+                                      date_field, &raw_type));
+  EXPECT_EQ(raw_type, types::Int32Type());
+  ZETASQL_ASSERT_OK(factory.GetProtoFieldType(date_field, &date_type));
+  EXPECT_EQ(date_type, types::DateType());
+
+  const google::protobuf::FieldDescriptor* nested_field =
+      descriptor->FindFieldByName("nested_repeated_value");
+  ASSERT_NE(nested_field, nullptr);
+  const Type* nested_type;
+  ZETASQL_ASSERT_OK(factory.GetProtoFieldType(nested_field, &nested_type));
+  ASSERT_TRUE(nested_type->IsArray());
+  EXPECT_EQ(nested_type->AsArray()->element_type()->AsProto()->descriptor(),
+            nested_field->message_type());
+
+  // Preregistering the message publishes the field types, which are the same
+  // as the cached ones.
+  const ProtoType* proto_type;
+  ZETASQL_ASSERT_OK(factory.MakeProtoType(descriptor, &proto_type));
+  ZETASQL_ASSERT_OK(factory.PreregisterTypes({proto_type}));
+  const Type* nested_type2;
+  ZETASQL_ASSERT_OK(factory.GetProtoFieldType(nested_field, &nested_type2));
+  EXPECT_EQ(nested_type, nested_type2);
+  const Type* field_type;
+  ZETASQL_ASSERT_OK(factory.GetProtoFieldType(
+      descriptor->FindFieldByName("timestamp_micros"), &field_type));
+  EXPECT_EQ(field_type, types::TimestampType());
+}
+
+TEST(ProtoTypeTest, FindFieldByNameIgnoreCase) {
+  const google::protobuf::Descriptor* descriptor =
+      zetasql_test::KitchenSinkPB::descriptor();
+  const google::protobuf::FieldDescriptor* field =
+      descriptor->FindFieldByName("int64_key_1");
+  ASSERT_NE(field, nullptr);
+  EXPECT_EQ(ProtoType::FindFieldByNameIgnoreCase(descriptor, "int64_key_1"),
+            field);
+  EXPECT_EQ(ProtoType::FindFieldByNameIgnoreCase(descriptor, "Int64_KEY_1"),
+            field);
+  EXPECT_EQ(ProtoType::FindFieldByNameIgnoreCase(descriptor, "int64_key"),
+            nullptr);
+
+  // Extensions are not fields of the message.
+  ASSERT_NE(zetasql_test::KitchenSinkExtension::descriptor()
+                ->FindExtensionByName("optional_extension"),
+            nullptr);
+  EXPECT_EQ(
+      ProtoType::FindFieldByNameIgnoreCase(descriptor, "Optional_Extension"),
+      nullptr);
+}
+
+TEST(TypeFactoryTest, ConcurrentLookups) {
+  TypeFactory factory;
+  const EnumType* enum_type;
+  ZETASQL_ASSERT_OK(
+      factory.MakeEnumType(zetasql_test::TestEnum_descriptor(), &enum_type));
+  ZETASQL_ASSERT_OK(factory.PreregisterTypes({enum_type}));
+  const ArrayType* expected;
+  ZETASQL_ASSERT_OK(factory.MakeArrayType(enum_type, &expected));
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&factory, enum_type, expected]() {
+      for (int j = 0; j < 1000; ++j) {
+        const ArrayType* array_type;
+        ZETASQL_EXPECT_OK(factory.MakeArrayType(enum_type, &array_type));
+        EXPECT_EQ(array_type, expected);
+        // Creating new types concurrently is still safe.
+        const ArrayType* date_array_type;
+        ZETASQL_EXPECT_OK(
+            factory.MakeArrayType(types::DateType(), &date_array_type));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+}  // namespace zetasql
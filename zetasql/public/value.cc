@@ -113,7 +113,7 @@ Value::Value(const Type* type)
       break;
     case TYPE_STRING:
     case TYPE_BYTES:
-      string_ptr_ = new StringRef();
+      string_ptr_ = nullptr;
       break;
     case TYPE_GEOGRAPHY:
       geography_ptr_ = new GeographyRef();
@@ -129,10 +129,11 @@ Value::Value(const Type* type)
       break;
     case TYPE_ARRAY:
     case TYPE_STRUCT:
-      list_ptr_ = new TypedList(type);
+      has_typed_list_ = false;
+      list_type_ = type;
       break;
     case TYPE_PROTO:
-      proto_ptr_ = new ProtoRep(type->AsProto(), absl::Cord());
+      proto_ptr_ = NewPayload<ProtoRep>(type->AsProto(), absl::Cord());
       break;
     case TYPE_UNKNOWN:
     case __TypeKind__switch_must_have_a_default__:
@@ -148,11 +149,11 @@ void Value::CopyFrom(const Value& that) {
   switch (that.type_kind_) {
     case TYPE_STRUCT:
     case TYPE_ARRAY:
-      list_ptr_->Ref();
+      if (has_typed_list_) list_ptr_->Ref();
       break;
     case TYPE_STRING:
     case TYPE_BYTES:
-      string_ptr_->Ref();
+      if (string_ptr_ != nullptr) string_ptr_->Ref();
       break;
     case TYPE_GEOGRAPHY:
       geography_ptr_->Ref();
@@ -233,7 +234,64 @@ Value::Value(const EnumType* enum_type, absl::string_view name)
 
 Value::Value(const ProtoType* proto_type, absl::Cord value)
     : type_kind_(TYPE_PROTO),
-      proto_ptr_(new ProtoRep(proto_type, std::move(value))) {}
+      proto_ptr_(NewPayload<ProtoRep>(proto_type, std::move(value))) {}
+
+thread_local Value::PayloadArena Value::payload_arena_;
+thread_local Value::PayloadAllocationCounter*
+    Value::payload_allocation_counter_ = nullptr;
+
+bool Value::HasArenaPayload() const {
+  switch (type_kind_) {
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      return string_ptr_ != nullptr && string_ptr_->is_arena_allocated();
+    case TYPE_PROTO:
+      return proto_ptr_->is_arena_allocated();
+    case TYPE_ARRAY:
+    case TYPE_STRUCT:
+      if (!has_typed_list_) return false;
+      if (list_ptr_->is_arena_allocated()) return true;
+      for (const Value& value : list_ptr_->values()) {
+        if (value.HasArenaPayload()) return true;
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+
+Value Value::CopyOutOfArenaInternal() const {
+  DCHECK(payload_arena_.arena == nullptr);
+  if (!HasArenaPayload()) return *this;
+  switch (type_kind_) {
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      if (string_ptr_->owner() != nullptr) {
+        return Value(static_cast<TypeKind>(type_kind_), string_ptr_->view(),
+                     *string_ptr_->owner());
+      }
+      return Value(static_cast<TypeKind>(type_kind_), string_ptr_->value());
+    case TYPE_PROTO:
+      if (is_null_) return Value(proto_ptr_->type());
+      return Value(proto_ptr_->type(), proto_ptr_->value());
+    case TYPE_ARRAY:
+    case TYPE_STRUCT: {
+      std::vector<Value> values;
+      values.reserve(list_ptr_->values().size());
+      for (const Value& value : list_ptr_->values()) {
+        values.push_back(value.CopyOutOfArenaInternal());
+      }
+      if (type_kind_ == TYPE_STRUCT) {
+        return StructInternal(/*safe=*/false, list_ptr_->type()->AsStruct(),
+                              std::move(values));
+      }
+      return ArrayInternal(/*safe=*/false, list_ptr_->type()->AsArray(),
+                           order_kind_, std::move(values));
+    }
+    default:
+      LOG(FATAL) << "Unexpected arena payload for type " << type_kind_;
+  }
+}
 
 #ifdef NDEBUG
 static constexpr bool kDebugMode = false;
@@ -247,10 +305,12 @@ Value Value::ArrayInternal(bool safe, const ArrayType* array_type,
   Value result(array_type);
   result.is_null_ = false;
   result.order_kind_ = order_kind;
-  std::vector<Value>& value_list = result.list_ptr_->values();
-  value_list = std::move(values);
+  if (!values.empty()) {
+    result.list_ptr_ = NewPayload<TypedList>(array_type, std::move(values));
+    result.has_typed_list_ = true;
+  }
   if (kDebugMode || safe) {
-    for (const Value& v : value_list) {
+    for (const Value& v : result.list_values()) {
       CHECK(v.type()->Equals(array_type->element_type()))
           << "Array element " << v << " must be of type "
           << array_type->element_type()->DebugString();
@@ -263,9 +323,12 @@ Value Value::StructInternal(bool safe, const StructType* struct_type,
                             std::vector<Value>&& values) {
   Value result(struct_type);
   result.is_null_ = false;
-  std::vector<Value>& value_list = result.list_ptr_->values();
-  value_list = std::move(values);
+  if (!values.empty()) {
+    result.list_ptr_ = NewPayload<TypedList>(struct_type, std::move(values));
+    result.has_typed_list_ = true;
+  }
   if (kDebugMode || safe) {
+    const std::vector<Value>& value_list = result.list_values();
     // Check that values are compatible with the type.
     CHECK_EQ(struct_type->num_fields(), value_list.size());
     for (int i = 0; i < value_list.size(); ++i) {
@@ -301,7 +364,7 @@ const Type* Value::type() const {
     case TYPE_ENUM: return enum_type_;
     case TYPE_ARRAY:
     case TYPE_STRUCT:
-      return list_ptr_->type();
+      return has_typed_list_ ? list_ptr_->type() : list_type_;
     case TYPE_PROTO:
       return proto_ptr_->type();
     case TYPE_UNKNOWN:
@@ -315,13 +378,13 @@ const Type* Value::type() const {
 const std::vector<Value>& Value::fields() const {
   CHECK_EQ(TYPE_STRUCT, type_kind_);
   CHECK(!is_null()) << "Null value";
-  return list_ptr_->values();
+  return list_values();
 }
 
 const std::vector<Value>& Value::elements() const {
   CHECK_EQ(TYPE_ARRAY, type_kind_);
   CHECK(!is_null()) << "Null value";
-  return list_ptr_->values();
+  return list_values();
 }
 
 Value Value::TimestampFromUnixMicros(int64_t v) {
@@ -450,11 +513,13 @@ uint64_t Value::physical_byte_size() const {
       break;
     case TYPE_STRING:
     case TYPE_BYTES:
-      physical_size += string_ptr_->physical_byte_size();
+      if (string_ptr_ != nullptr) {
+        physical_size += string_ptr_->physical_byte_size();
+      }
       break;
     case TYPE_ARRAY:
     case TYPE_STRUCT:
-      physical_size += list_ptr_->physical_byte_size();
+      if (has_typed_list_) physical_size += list_ptr_->physical_byte_size();
       break;
     case TYPE_PROTO:
       physical_size += proto_ptr_->physical_byte_size();
@@ -473,7 +538,7 @@ absl::Cord Value::ToCord() const {
   switch (type_kind_) {
     case TYPE_STRING:
     case TYPE_BYTES:
-      return absl::Cord(string_ptr_->value());
+      return absl::Cord(string_ref_view());
     case TYPE_PROTO:
       return proto_ptr_->value();
     default:
@@ -621,8 +686,14 @@ bool Value::EqualsInternal(const Value& x, const Value& y, bool allow_bags,
       return float_margin.Equal(x.float_value(), y.float_value());
     case TYPE_DOUBLE:
       return float_margin.Equal(x.double_value(), y.double_value());
-    case TYPE_STRING: return x.string_value() == y.string_value();
-    case TYPE_BYTES: return x.bytes_value() == y.bytes_value();
+    // Copies of a value, e.g. of a dictionary element of a column batch (see
+    // EvaluatorTableColumnBatch), share their contents.
+    case TYPE_STRING:
+      return x.string_ptr_ == y.string_ptr_ ||
+             x.string_view_value() == y.string_view_value();
+    case TYPE_BYTES:
+      return x.string_ptr_ == y.string_ptr_ ||
+             x.bytes_view_value() == y.bytes_view_value();
     case TYPE_DATE: return x.date_value() == y.date_value();
     case TYPE_TIMESTAMP:
       return x.timestamp_seconds_ == y.timestamp_seconds_ &&
@@ -1063,8 +1134,12 @@ bool Value::LessThan(const Value& that) const {
           return false;
         }
         return double_value() < that.double_value();
-      case TYPE_STRING: return string_value() < that.string_value();
-      case TYPE_BYTES: return bytes_value() < that.bytes_value();
+      case TYPE_STRING:
+        if (string_ptr_ == that.string_ptr_) return false;
+        return string_view_value() < that.string_view_value();
+      case TYPE_BYTES:
+        if (string_ptr_ == that.string_ptr_) return false;
+        return bytes_view_value() < that.bytes_view_value();
       case TYPE_DATE: return date_value() < that.date_value();
       case TYPE_TIMESTAMP:
         return ToTime() < that.ToTime();
@@ -19,6 +19,7 @@
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <iosfwd>
 #include <memory>
 #include <string>
@@ -42,6 +43,10 @@
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
 
+namespace zetasql_base {
+class UnsafeArena;
+}  // namespace zetasql_base
+
 namespace zetasql {
 
 // Represents a value in the ZetaSQL type system. Each valid value has a
@@ -112,6 +117,11 @@ class Value {
   double double_value() const;         // REQUIRES: double type
   const std::string& string_value() const;  // REQUIRES: string type
   const std::string& bytes_value() const;   // REQUIRES: bytes type
+  // Same as string_value() and bytes_value(), but without materializing the
+  // contents of values created by ExternalString() and ExternalBytes() as a
+  // std::string.
+  absl::string_view string_view_value() const;  // REQUIRES: string type
+  absl::string_view bytes_view_value() const;   // REQUIRES: bytes type
   int32_t date_value() const;            // REQUIRES: date type
   int32_t enum_value() const;            // REQUIRES: enum type
   const std::string& enum_name() const;  // REQUIRES: enum type
@@ -300,6 +310,15 @@ class Value {
   static Value Bytes(const absl::Cord& v);
   // str may contain '\0' in the middle, without getting truncated.
   template <size_t N> static Value Bytes(const char (&str)[N]);
+  // Creates a STRING or BYTES value that refers to 'v' instead of copying it.
+  // 'owner' must keep the memory of 'v' alive; it is released once the value
+  // and all its copies are destroyed. string_value() and bytes_value() copy
+  // 'v' into a std::string on first use, so callers that only need the bytes
+  // should use string_view_value() and bytes_view_value() instead.
+  static Value ExternalString(absl::string_view v,
+                              std::shared_ptr<const void> owner);
+  static Value ExternalBytes(absl::string_view v,
+                             std::shared_ptr<const void> owner);
   static Value Date(int32_t v);
   // Creates a timestamp value from absl::Time at nanoseconds precision.
   static Value Timestamp(absl::Time t);
@@ -424,6 +443,37 @@ class Value {
   class StringRef;  // Defined in value_inl.h
   class ProtoRep;   // Defined in value_inl.h
   class TypedList;  // Defined in value_inl.h
+  class Payload;    // Defined in value_inl.h
+
+  // The arena from which the StringRefs, TypedLists and ProtoReps of Values
+  // created on a thread are allocated. See InternalValue::ScopedArena.
+  struct PayloadArena {
+    zetasql_base::UnsafeArena* arena = nullptr;
+    // Once 'arena' has allocated this many bytes, payloads come from the heap
+    // again.
+    size_t max_bytes = 0;
+  };
+  static thread_local PayloadArena payload_arena_;
+
+  // Counts the bytes of the StringRefs, TypedLists and ProtoReps allocated and
+  // destroyed on a thread. See InternalValue::ScopedAllocationCounter.
+  struct PayloadAllocationCounter {
+    int64_t allocated_bytes = 0;
+    int64_t freed_bytes = 0;
+    // The largest value of 'allocated_bytes' - 'freed_bytes' so far.
+    int64_t peak_bytes = 0;
+
+    void RecordAllocation(int64_t num_bytes) {
+      allocated_bytes += num_bytes;
+      peak_bytes = std::max(peak_bytes, allocated_bytes - freed_bytes);
+    }
+    void RecordFree(int64_t num_bytes) { freed_bytes += num_bytes; }
+  };
+  static thread_local PayloadAllocationCounter* payload_allocation_counter_;
+
+  // Returns a new T, allocated from 'payload_arena_' if it is set.
+  template <typename T, typename... Args>
+  static T* NewPayload(Args&&... args);
 
   // Specifies whether an array value preserves or ignores order (public array
   // values always preserve order). The enum values are designed to be used with
@@ -447,6 +497,9 @@ class Value {
   Value(TypeKind type_kind, int64_t value);
   // REQUIRES: type_kind is string or bytes
   Value(TypeKind type_kind, std::string value);
+  // REQUIRES: type_kind is string or bytes
+  Value(TypeKind type_kind, absl::string_view value,
+        std::shared_ptr<const void> owner);
 
   // Constructs a typed NULL of the given 'type'.
   explicit Value(const Type* type);
@@ -478,6 +531,22 @@ class Value {
   // Copies the contents of a value from another value.
   void CopyFrom(const Value& that);
 
+  // Returns true if this value, or any value nested in it, has a payload that
+  // was allocated from an arena.
+  bool HasArenaPayload() const;
+
+  // Returns a copy of this value whose payloads are all heap-allocated.
+  // REQUIRES: 'payload_arena_' is not set.
+  Value CopyOutOfArenaInternal() const;
+
+  // Returns the contents of a STRING or BYTES value, which may be NULL.
+  const std::string& string_ref_value() const;
+  absl::string_view string_ref_view() const;
+
+  // Returns the elements of an ARRAY or the fields of a STRUCT value, which
+  // may be NULL.
+  const std::vector<Value>& list_values() const;
+
   // If an array has order_kind()=kIgnoresOrder, the array represents a
   // an unordered vector (aka multiset). This bit is used internally
   // by test code; public arrays are always ordered.
@@ -566,6 +635,9 @@ class Value {
     // Used for google.protobuf.Timestamp.nanos and sub-second part of
     // DatetimeValue and TimeValue.
     int32_t subsecond_nanos_;
+    // Used for arrays and structs. If false, the value is NULL or has no
+    // elements, and 'list_type_' is used instead of 'list_ptr_'.
+    bool has_typed_list_;
   };
 
   // 64-bit part of the value.
@@ -580,8 +652,11 @@ class Value {
     int64_t timestamp_seconds_;  // Same as google.protobuf.Timestamp.seconds.
     int32_t bit_field_32_value_;   // Whole-second part of TimeValue.
     int64_t bit_field_64_value_;   // Whole-second part of DatetimeValue.
-    StringRef* string_ptr_;  // Reffed. Used for TYPE_STRING and TYPE_BYTES.
+    // Reffed. Used for TYPE_STRING and TYPE_BYTES. NULL for NULL and empty
+    // values, which therefore need no allocation.
+    StringRef* string_ptr_;
     TypedList* list_ptr_;  // Reffed. Used for arrays and structs.
+    const Type* list_type_;  // Not owned. See 'has_typed_list_'.
     const EnumType* enum_type_;  // Not owned. Used for enums.
     ProtoRep* proto_ptr_;        // Reffed. Used for protos.
     GeographyRef* geography_ptr_;  // Owned. Used for geographies.
@@ -0,0 +1,498 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/value_encoding.h"
+
+#include <string.h>
+
+#include <limits>
+#include <utility>
+
+#include "zetasql/base/endian.h"
+#include "zetasql/public/civil_time.h"
+#include "zetasql/public/functions/date_time_util.h"
+#include "zetasql/public/numeric_value.h"
+#include <cstdint>
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_builder.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+
+constexpr uint64_t kFormatVersion = 1;
+
+constexpr char kNullMarker = 0;
+constexpr char kNonNullMarker = 1;
+
+constexpr int64_t kInt32Min = std::numeric_limits<int32_t>::min();
+constexpr int64_t kInt32Max = std::numeric_limits<int32_t>::max();
+constexpr uint64_t kUint32Max = std::numeric_limits<uint32_t>::max();
+
+uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+class Encoder {
+ public:
+  explicit Encoder(std::string* output) : output_(output) {}
+
+  Encoder(const Encoder&) = delete;
+  Encoder& operator=(const Encoder&) = delete;
+
+  void PutVarint(uint64_t value) {
+    char buffer[10];
+    int size = 0;
+    while (value >= 0x80) {
+      buffer[size++] = static_cast<char>(value | 0x80);
+      value >>= 7;
+    }
+    buffer[size++] = static_cast<char>(value);
+    output_->append(buffer, size);
+  }
+
+  void PutSignedVarint(int64_t value) { PutVarint(ZigZagEncode(value)); }
+
+  void PutFixed32(uint32_t value) {
+    value = zetasql_base::LittleEndian::FromHost32(value);
+    output_->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void PutFixed64(uint64_t value) {
+    value = zetasql_base::LittleEndian::FromHost64(value);
+    output_->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void PutBytes(absl::string_view bytes) {
+    PutVarint(bytes.size());
+    output_->append(bytes.data(), bytes.size());
+  }
+
+  zetasql_base::Status PutValue(const Value& value);
+
+ private:
+  std::string* output_;
+};
+
+zetasql_base::Status Encoder::PutValue(const Value& value) {
+  if (value.is_null()) {
+    output_->push_back(kNullMarker);
+    return zetasql_base::OkStatus();
+  }
+  output_->push_back(kNonNullMarker);
+  switch (value.type_kind()) {
+    case TYPE_INT32:
+      PutSignedVarint(value.int32_value());
+      break;
+    case TYPE_INT64:
+      PutSignedVarint(value.int64_value());
+      break;
+    case TYPE_UINT32:
+      PutVarint(value.uint32_value());
+      break;
+    case TYPE_UINT64:
+      PutVarint(value.uint64_value());
+      break;
+    case TYPE_BOOL:
+      output_->push_back(value.bool_value() ? 1 : 0);
+      break;
+    case TYPE_FLOAT: {
+      const float float_value = value.float_value();
+      uint32_t bits;
+      memcpy(&bits, &float_value, sizeof(bits));
+      PutFixed32(bits);
+      break;
+    }
+    case TYPE_DOUBLE: {
+      const double double_value = value.double_value();
+      uint64_t bits;
+      memcpy(&bits, &double_value, sizeof(bits));
+      PutFixed64(bits);
+      break;
+    }
+    case TYPE_NUMERIC:
+      PutBytes(value.numeric_value().SerializeAsProtoBytes());
+      break;
+    case TYPE_BIGNUMERIC:
+      PutBytes(value.bignumeric_value().SerializeAsProtoBytes());
+      break;
+    case TYPE_STRING:
+      PutBytes(value.string_view_value());
+      break;
+    case TYPE_BYTES:
+      PutBytes(value.bytes_view_value());
+      break;
+    case TYPE_DATE:
+      PutSignedVarint(value.date_value());
+      break;
+    case TYPE_TIMESTAMP: {
+      const absl::Time time = value.ToTime();
+      const int64_t seconds = absl::ToUnixSeconds(time);
+      PutSignedVarint(seconds);
+      PutVarint(
+          absl::ToInt64Nanoseconds(time - absl::FromUnixSeconds(seconds)));
+      break;
+    }
+    case TYPE_DATETIME:
+      PutSignedVarint(value.datetime_value().Packed64DatetimeSeconds());
+      PutVarint(value.datetime_value().Nanoseconds());
+      break;
+    case TYPE_TIME:
+      PutSignedVarint(value.time_value().Packed64TimeNanos());
+      break;
+    case TYPE_ENUM:
+      PutSignedVarint(value.enum_value());
+      break;
+    case TYPE_ARRAY:
+      PutVarint(value.num_elements());
+      for (const Value& element : value.elements()) {
+        ZETASQL_RETURN_IF_ERROR(PutValue(element));
+      }
+      break;
+    case TYPE_STRUCT:
+      for (const Value& field : value.fields()) {
+        ZETASQL_RETURN_IF_ERROR(PutValue(field));
+      }
+      break;
+    case TYPE_PROTO: {
+      const absl::Cord cord = value.ToCord();
+      PutVarint(cord.size());
+      for (absl::string_view chunk : cord.Chunks()) {
+        output_->append(chunk.data(), chunk.size());
+      }
+      break;
+    }
+    default:
+      return zetasql_base::UnimplementedErrorBuilder()
+             << "Cannot encode values of type "
+             << value.type()->DebugString();
+  }
+  return zetasql_base::OkStatus();
+}
+
+class Decoder {
+ public:
+  Decoder(absl::string_view input, std::shared_ptr<const void> owner)
+      : input_(input), owner_(std::move(owner)) {}
+
+  Decoder(const Decoder&) = delete;
+  Decoder& operator=(const Decoder&) = delete;
+
+  bool AtEnd() const { return input_.empty(); }
+
+  zetasql_base::Status GetByte(char* byte) {
+    if (input_.empty()) return Truncated();
+    *byte = input_[0];
+    input_.remove_prefix(1);
+    return zetasql_base::OkStatus();
+  }
+
+  zetasql_base::Status GetVarint(uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      char byte;
+      ZETASQL_RETURN_IF_ERROR(GetByte(&byte));
+      *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return zetasql_base::OkStatus();
+    }
+    return Malformed("varint is too long");
+  }
+
+  zetasql_base::Status GetSignedVarint(int64_t* value) {
+    uint64_t encoded;
+    ZETASQL_RETURN_IF_ERROR(GetVarint(&encoded));
+    *value = ZigZagDecode(encoded);
+    return zetasql_base::OkStatus();
+  }
+
+  zetasql_base::Status GetFixed32(uint32_t* value) {
+    if (input_.size() < sizeof(*value)) return Truncated();
+    memcpy(value, input_.data(), sizeof(*value));
+    *value = zetasql_base::LittleEndian::ToHost32(*value);
+    input_.remove_prefix(sizeof(*value));
+    return zetasql_base::OkStatus();
+  }
+
+  zetasql_base::Status GetFixed64(uint64_t* value) {
+    if (input_.size() < sizeof(*value)) return Truncated();
+    memcpy(value, input_.data(), sizeof(*value));
+    *value = zetasql_base::LittleEndian::ToHost64(*value);
+    input_.remove_prefix(sizeof(*value));
+    return zetasql_base::OkStatus();
+  }
+
+  // The returned bytes point into the input.
+  zetasql_base::Status GetBytes(absl::string_view* bytes) {
+    uint64_t size;
+    ZETASQL_RETURN_IF_ERROR(GetVarint(&size));
+    if (size > input_.size()) return Truncated();
+    *bytes = input_.substr(0, size);
+    input_.remove_prefix(size);
+    return zetasql_base::OkStatus();
+  }
+
+  zetasql_base::StatusOr<Value> GetValue(const Type* type);
+
+  zetasql_base::Status Malformed(absl::string_view reason) const {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "Malformed encoded values: " << reason;
+  }
+
+ private:
+  zetasql_base::Status Truncated() const { return Malformed("unexpected end"); }
+
+  zetasql_base::StatusOr<Value> GetNonNullValue(const Type* type);
+
+  absl::string_view input_;
+  const std::shared_ptr<const void> owner_;
+};
+
+zetasql_base::StatusOr<Value> Decoder::GetValue(const Type* type) {
+  char marker;
+  ZETASQL_RETURN_IF_ERROR(GetByte(&marker));
+  switch (marker) {
+    case kNullMarker:
+      return Value::Null(type);
+    case kNonNullMarker:
+      return GetNonNullValue(type);
+    default:
+      return Malformed("invalid NULL marker");
+  }
+}
+
+zetasql_base::StatusOr<Value> Decoder::GetNonNullValue(const Type* type) {
+  switch (type->kind()) {
+    case TYPE_INT32: {
+      int64_t value;
+      ZETASQL_RETURN_IF_ERROR(GetSignedVarint(&value));
+      if (value < kInt32Min || value > kInt32Max) {
+        return Malformed("INT32 out of range");
+      }
+      return Value::Int32(static_cast<int32_t>(value));
+    }
+    case TYPE_INT64: {
+      int64_t value;
+      ZETASQL_RETURN_IF_ERROR(GetSignedVarint(&value));
+      return Value::Int64(value);
+    }
+    case TYPE_UINT32: {
+      uint64_t value;
+      ZETASQL_RETURN_IF_ERROR(GetVarint(&value));
+      if (value > kUint32Max) return Malformed("UINT32 out of range");
+      return Value::Uint32(static_cast<uint32_t>(value));
+    }
+    case TYPE_UINT64: {
+      uint64_t value;
+      ZETASQL_RETURN_IF_ERROR(GetVarint(&value));
+      return Value::Uint64(value);
+    }
+    case TYPE_BOOL: {
+      char value;
+      ZETASQL_RETURN_IF_ERROR(GetByte(&value));
+      if (value != 0 && value != 1) return Malformed("invalid BOOL");
+      return Value::Bool(value == 1);
+    }
+    case TYPE_FLOAT: {
+      uint32_t bits;
+      ZETASQL_RETURN_IF_ERROR(GetFixed32(&bits));
+      float value;
+      memcpy(&value, &bits, sizeof(value));
+      return Value::Float(value);
+    }
+    case TYPE_DOUBLE: {
+      uint64_t bits;
+      ZETASQL_RETURN_IF_ERROR(GetFixed64(&bits));
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      return Value::Double(value);
+    }
+    case TYPE_NUMERIC: {
+      absl::string_view bytes;
+      ZETASQL_RETURN_IF_ERROR(GetBytes(&bytes));
+      ZETASQL_ASSIGN_OR_RETURN(NumericValue value,
+                       NumericValue::DeserializeFromProtoBytes(bytes));
+      return Value::Numeric(value);
+    }
+    case TYPE_BIGNUMERIC: {
+      absl::string_view bytes;
+      ZETASQL_RETURN_IF_ERROR(GetBytes(&bytes));
+      ZETASQL_ASSIGN_OR_RETURN(BigNumericValue value,
+                       BigNumericValue::DeserializeFromProtoBytes(bytes));
+      return Value::BigNumeric(value);
+    }
+    case TYPE_STRING: {
+      absl::string_view bytes;
+      ZETASQL_RETURN_IF_ERROR(GetBytes(&bytes));
+      if (owner_ != nullptr) return Value::ExternalString(bytes, owner_);
+      return Value::String(bytes);
+    }
+    case TYPE_BYTES: {
+      absl::string_view bytes;
+      ZETASQL_RETURN_IF_ERROR(GetBytes(&bytes));
+      if (owner_ != nullptr) return Value::ExternalBytes(bytes, owner_);
+      return Value::Bytes(bytes);
+    }
+    case TYPE_DATE: {
+      int64_t value;
+      ZETASQL_RETURN_IF_ERROR(GetSignedVarint(&value));
+      if (value < kInt32Min || value > kInt32Max ||
+          !functions::IsValidDate(static_cast<int32_t>(value))) {
+        return Malformed("invalid DATE");
+      }
+      return Value::Date(static_cast<int32_t>(value));
+    }
+    case TYPE_TIMESTAMP: {
+      int64_t seconds;
+      uint64_t nanos;
+      ZETASQL_RETURN_IF_ERROR(GetSignedVarint(&seconds));
+      ZETASQL_RETURN_IF_ERROR(GetVarint(&nanos));
+      if (nanos >= 1000000000) return Malformed("invalid TIMESTAMP");
+      const absl::Time time = absl::FromUnixSeconds(seconds) +
+                              absl::Nanoseconds(static_cast<int64_t>(nanos));
+      if (!functions::IsValidTime(time)) return Malformed("invalid TIMESTAMP");
+      return Value::Timestamp(time);
+    }
+    case TYPE_DATETIME: {
+      int64_t seconds;
+      uint64_t nanos;
+      ZETASQL_RETURN_IF_ERROR(GetSignedVarint(&seconds));
+      ZETASQL_RETURN_IF_ERROR(GetVarint(&nanos));
+      if (nanos >= 1000000000) return Malformed("invalid DATETIME");
+      const DatetimeValue datetime = DatetimeValue::FromPacked64SecondsAndNanos(
+          seconds, static_cast<int32_t>(nanos));
+      if (!datetime.IsValid()) return Malformed("invalid DATETIME");
+      return Value::Datetime(datetime);
+    }
+    case TYPE_TIME: {
+      int64_t packed;
+      ZETASQL_RETURN_IF_ERROR(GetSignedVarint(&packed));
+      const TimeValue time = TimeValue::FromPacked64Nanos(packed);
+      if (!time.IsValid()) return Malformed("invalid TIME");
+      return Value::Time(time);
+    }
+    case TYPE_ENUM: {
+      int64_t value;
+      ZETASQL_RETURN_IF_ERROR(GetSignedVarint(&value));
+      if (value < kInt32Min || value > kInt32Max ||
+          type->AsEnum()->enum_descriptor()->FindValueByNumber(
+              static_cast<int>(value)) == nullptr) {
+        return Malformed(
+            absl::StrCat("invalid value for ", type->DebugString()));
+      }
+      return Value::Enum(type->AsEnum(), value);
+    }
+    case TYPE_ARRAY: {
+      uint64_t num_elements;
+      ZETASQL_RETURN_IF_ERROR(GetVarint(&num_elements));
+      // Every element takes at least one byte, which bounds the reservation.
+      if (num_elements > input_.size()) return Truncated();
+      const Type* element_type = type->AsArray()->element_type();
+      std::vector<Value> elements;
+      elements.reserve(num_elements);
+      for (uint64_t i = 0; i < num_elements; ++i) {
+        ZETASQL_ASSIGN_OR_RETURN(Value element, GetValue(element_type));
+        elements.push_back(std::move(element));
+      }
+      return Value::UnsafeArray(type->AsArray(), std::move(elements));
+    }
+    case TYPE_STRUCT: {
+      const StructType* struct_type = type->AsStruct();
+      std::vector<Value> fields;
+      fields.reserve(struct_type->num_fields());
+      for (int i = 0; i < struct_type->num_fields(); ++i) {
+        ZETASQL_ASSIGN_OR_RETURN(Value field,
+                         GetValue(struct_type->field(i).type));
+        fields.push_back(std::move(field));
+      }
+      return Value::UnsafeStruct(struct_type, std::move(fields));
+    }
+    case TYPE_PROTO: {
+      absl::string_view bytes;
+      ZETASQL_RETURN_IF_ERROR(GetBytes(&bytes));
+      if (owner_ != nullptr) {
+        std::shared_ptr<const void> owner = owner_;
+        return Value::Proto(type->AsProto(),
+                            absl::MakeCordFromExternal(
+                                bytes, [owner](absl::string_view) {}));
+      }
+      return Value::Proto(type->AsProto(), absl::Cord(bytes));
+    }
+    default:
+      return zetasql_base::UnimplementedErrorBuilder()
+             << "Cannot decode values of type " << type->DebugString();
+  }
+}
+
+}  // namespace
+
+zetasql_base::Status EncodeValues(const Type* type, absl::Span<const Value> values,
+                          std::string* output) {
+  ZETASQL_RET_CHECK(type != nullptr);
+  Encoder encoder(output);
+  encoder.PutVarint(kFormatVersion);
+  encoder.PutVarint(values.size());
+  for (const Value& value : values) {
+    ZETASQL_RET_CHECK(value.type()->Equals(type))
+        << "Expected " << type->DebugString() << ", got "
+        << value.type()->DebugString();
+    ZETASQL_RETURN_IF_ERROR(encoder.PutValue(value));
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::StatusOr<std::vector<Value>> DecodeValues(
+    const Type* type, absl::string_view encoded,
+    std::shared_ptr<const void> owner) {
+  ZETASQL_RET_CHECK(type != nullptr);
+  Decoder decoder(encoded, std::move(owner));
+  uint64_t version;
+  ZETASQL_RETURN_IF_ERROR(decoder.GetVarint(&version));
+  if (version != kFormatVersion) {
+    return decoder.Malformed(absl::StrCat("unsupported version ", version));
+  }
+  uint64_t num_values;
+  ZETASQL_RETURN_IF_ERROR(decoder.GetVarint(&num_values));
+  // Every value takes at least one byte, which bounds the reservation.
+  if (num_values > encoded.size()) {
+    return decoder.Malformed("unexpected end");
+  }
+  std::vector<Value> values;
+  values.reserve(num_values);
+  for (uint64_t i = 0; i < num_values; ++i) {
+    ZETASQL_ASSIGN_OR_RETURN(Value value, decoder.GetValue(type));
+    values.push_back(std::move(value));
+  }
+  if (!decoder.AtEnd()) return decoder.Malformed("trailing bytes");
+  return values;
+}
+
+zetasql_base::StatusOr<std::vector<Value>> DecodeValues(
+    const Type* type, std::shared_ptr<const std::string> encoded) {
+  ZETASQL_RET_CHECK(encoded != nullptr);
+  const absl::string_view view = *encoded;
+  return DecodeValues(type, view, std::move(encoded));
+}
+
+}  // namespace zetasql
@@ -0,0 +1,76 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// A compact binary encoding for sequences of Values that share one Type, for
+// transferring many Values (e.g., the rows of a table or a large array of
+// structs) between processes. Unlike ValueProto, the encoding carries no
+// field tags or nested message lengths; the Type is known to both sides and
+// is not part of the encoding. Decoding can refer to STRING and BYTES
+// contents in the encoded buffer instead of copying them.
+//
+// The encoding is a varint format version followed by a varint count of
+// Values and then the Values themselves. Each Value starts with a byte that is
+// 0 for NULL and 1 otherwise, followed for non-NULL Values by:
+//   INT32, INT64, DATE, ENUM: zigzag varint
+//   UINT32, UINT64: varint
+//   BOOL: one byte
+//   FLOAT, DOUBLE: little-endian IEEE bits (4 or 8 bytes)
+//   STRING, BYTES, PROTO, NUMERIC, BIGNUMERIC: varint length and that many
+//       bytes (NUMERIC and BIGNUMERIC use SerializeAsProtoBytes())
+//   TIMESTAMP: zigzag varint seconds since the epoch and varint nanoseconds
+//   DATETIME: zigzag varint Packed64DatetimeSeconds() and varint nanoseconds
+//   TIME: zigzag varint Packed64TimeNanos()
+//   ARRAY: varint number of elements and the elements
+//   STRUCT: the fields in order
+// GEOGRAPHY Values cannot be encoded.
+
+#ifndef ZETASQL_PUBLIC_VALUE_ENCODING_H_
+#define ZETASQL_PUBLIC_VALUE_ENCODING_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// Appends the encoding of 'values', which must all have type 'type', to
+// 'output'.
+zetasql_base::Status EncodeValues(const Type* type, absl::Span<const Value> values,
+                          std::string* output);
+
+// Decodes Values of type 'type' from 'encoded', which must hold exactly the
+// output of one EncodeValues() call. If 'owner' is non-NULL it must keep the
+// memory of 'encoded' alive, and the decoded STRING and BYTES Values refer to
+// that memory instead of copying it (see Value::ExternalString()). Returns an
+// error if 'encoded' is malformed or does not match 'type'.
+zetasql_base::StatusOr<std::vector<Value>> DecodeValues(
+    const Type* type, absl::string_view encoded,
+    std::shared_ptr<const void> owner = nullptr);
+
+// Same as above, decoding from (and sharing) 'encoded'.
+zetasql_base::StatusOr<std::vector<Value>> DecodeValues(
+    const Type* type, std::shared_ptr<const std::string> encoded);
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_VALUE_ENCODING_H_
@@ -0,0 +1,191 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/value_encoding.h"
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/civil_time.h"
+#include "zetasql/public/numeric_value.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/testdata/test_schema.pb.h"
+#include "zetasql/testing/test_value.h"
+#include "zetasql/testing/using_test_value.cc"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace zetasql {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::zetasql_base::testing::StatusIs;
+
+// Encodes 'values' and decodes them again, both copying and sharing the
+// encoded bytes.
+void ExpectRoundTrip(const Type* type, const std::vector<Value>& values) {
+  auto encoded = std::make_shared<std::string>();
+  ZETASQL_ASSERT_OK(EncodeValues(type, values, encoded.get()));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<Value> copied,
+                       DecodeValues(type, *encoded));
+  EXPECT_THAT(copied, ElementsAreArray(values)) << type->DebugString();
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<Value> shared,
+      DecodeValues(type, std::shared_ptr<const std::string>(encoded)));
+  EXPECT_THAT(shared, ElementsAreArray(values)) << type->DebugString();
+}
+
+TEST(ValueEncodingTest, Scalars) {
+  ExpectRoundTrip(Int32Type(), {Int32(0), Int32(-1),
+                                Int32(std::numeric_limits<int32_t>::min()),
+                                Int32(std::numeric_limits<int32_t>::max()),
+                                NullInt32()});
+  ExpectRoundTrip(Int64Type(), {Int64(0), Int64(-1),
+                                Int64(std::numeric_limits<int64_t>::min()),
+                                Int64(std::numeric_limits<int64_t>::max()),
+                                NullInt64()});
+  ExpectRoundTrip(Uint32Type(),
+                  {Uint32(0), Uint32(std::numeric_limits<uint32_t>::max()),
+                   NullUint32()});
+  ExpectRoundTrip(Uint64Type(),
+                  {Uint64(0), Uint64(std::numeric_limits<uint64_t>::max()),
+                   NullUint64()});
+  ExpectRoundTrip(BoolType(), {Bool(true), Bool(false), NullBool()});
+  ExpectRoundTrip(FloatType(), {Float(1.5), Float(-0.0), NullFloat()});
+  ExpectRoundTrip(DoubleType(), {Double(1.5), Double(-1e300), NullDouble()});
+  ExpectRoundTrip(StringType(), {String(""), String("abc"), NullString()});
+  ExpectRoundTrip(BytesType(),
+                  {Bytes(""), Bytes(std::string("a\0b", 3)), NullBytes()});
+  ExpectRoundTrip(DateType(), {Date(0), Date(-719162), NullDate()});
+  ExpectRoundTrip(TimestampType(),
+                  {Value::Timestamp(absl::FromUnixNanos(-1)),
+                   Value::Timestamp(absl::FromUnixNanos(1234567890123)),
+                   NullTimestamp()});
+  ExpectRoundTrip(
+      DatetimeType(),
+      {Datetime(DatetimeValue::FromYMDHMSAndNanos(2019, 1, 2, 3, 4, 5, 6)),
+       NullDatetime()});
+  ExpectRoundTrip(TimeType(),
+                  {Time(TimeValue::FromHMSAndNanos(23, 59, 58, 999999999)),
+                   NullTime()});
+  ExpectRoundTrip(NumericType(),
+                  {Numeric(NumericValue::MaxValue()),
+                   Numeric(NumericValue(-3)), NullNumeric()});
+  ExpectRoundTrip(BigNumericType(),
+                  {BigNumeric(BigNumericValue::MinValue()), NullBigNumeric()});
+}
+
+TEST(ValueEncodingTest, EnumsAndProtos) {
+  const EnumType* enum_type =
+      test_values::MakeEnumType(zetasql_test::TestEnum_descriptor());
+  ExpectRoundTrip(enum_type, {Enum(enum_type, 1), Value::Null(enum_type)});
+
+  const ProtoType* proto_type =
+      test_values::MakeProtoType(zetasql_test::KitchenSinkPB::descriptor());
+  zetasql_test::KitchenSinkPB proto;
+  proto.set_int64_key_1(1);
+  proto.set_int64_key_2(2);
+  proto.set_string_val("foo");
+  ExpectRoundTrip(proto_type,
+                  {Value::Proto(proto_type,
+                                absl::Cord(proto.SerializeAsString())),
+                   Value::Null(proto_type)});
+}
+
+TEST(ValueEncodingTest, ArraysOfStructs) {
+  const StructType* struct_type =
+      MakeStructType({{"a", Int64Type()}, {"b", StringArrayType()}});
+  const ArrayType* array_type = MakeArrayType(struct_type);
+  std::vector<Value> structs;
+  for (int i = 0; i < 100; ++i) {
+    structs.push_back(Value::Struct(
+        struct_type,
+        {Int64(i), i % 10 == 0 ? Value::Null(StringArrayType())
+                               : Array({String("x"), NullString()})}));
+  }
+  ExpectRoundTrip(array_type, {Value::Array(array_type, structs),
+                               Value::EmptyArray(array_type),
+                               Value::Null(array_type)});
+  ExpectRoundTrip(EmptyStructType(), {Value::Struct(EmptyStructType(), {})});
+}
+
+TEST(ValueEncodingTest, SmallerThanValueProto) {
+  const ArrayType* array_type =
+      MakeArrayType(MakeStructType({{"a", Int64Type()}, {"b", DoubleType()}}));
+  std::vector<Value> structs;
+  for (int i = 0; i < 1000; ++i) {
+    structs.push_back(Struct({{"a", Int64(i)}, {"b", Double(i)}}));
+  }
+  const Value array = Value::Array(array_type, structs);
+
+  std::string encoded;
+  ZETASQL_ASSERT_OK(EncodeValues(array_type, {array}, &encoded));
+  ValueProto proto;
+  ZETASQL_ASSERT_OK(array.Serialize(&proto));
+  EXPECT_LT(encoded.size(), proto.ByteSizeLong());
+}
+
+TEST(ValueEncodingTest, DecodedStringsShareTheBuffer) {
+  std::string encoded;
+  ZETASQL_ASSERT_OK(EncodeValues(StringType(), {String("hello")}, &encoded));
+  auto buffer = std::make_shared<const std::string>(std::move(encoded));
+  std::weak_ptr<const std::string> weak_buffer = buffer;
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<Value> values,
+                       DecodeValues(StringType(), buffer));
+  ASSERT_EQ(values.size(), 1);
+  const absl::string_view view = values[0].string_view_value();
+  EXPECT_GE(view.data(), buffer->data());
+  EXPECT_LE(view.data() + view.size(), buffer->data() + buffer->size());
+
+  // The values keep the buffer alive.
+  buffer.reset();
+  EXPECT_FALSE(weak_buffer.expired());
+  EXPECT_EQ(values[0], String("hello"));
+  values.clear();
+  EXPECT_TRUE(weak_buffer.expired());
+}
+
+TEST(ValueEncodingTest, Errors) {
+  std::string encoded;
+  EXPECT_THAT(EncodeValues(Int64Type(), {String("a")}, &encoded),
+              StatusIs(zetasql_base::StatusCode::kInternal));
+
+  encoded.clear();
+  ZETASQL_ASSERT_OK(EncodeValues(StringType(), {String("abc")}, &encoded));
+  // Every proper prefix is truncated.
+  for (int i = 0; i < encoded.size(); ++i) {
+    EXPECT_THAT(DecodeValues(StringType(), encoded.substr(0, i)),
+                StatusIs(zetasql_base::StatusCode::kInvalidArgument));
+  }
+  EXPECT_THAT(DecodeValues(StringType(), encoded + "x"),
+              StatusIs(zetasql_base::StatusCode::kInvalidArgument));
+
+  encoded.clear();
+  ZETASQL_ASSERT_OK(EncodeValues(Int64Type(), {Int64(1LL << 40)}, &encoded));
+  EXPECT_THAT(DecodeValues(Int32Type(), encoded),
+              StatusIs(zetasql_base::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -25,6 +25,7 @@
 #include <stddef.h>
 #include <string.h>
 #include <memory>
+#include <new>
 #include <string>
 #include <utility>
 #include <vector>
@@ -40,24 +41,86 @@
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"  
 #include <cstdint>
+#include "absl/base/call_once.h"
 #include "absl/hash/hash.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
+#include "zetasql/base/arena.h"
 #include "zetasql/base/simple_reference_counted.h"
 
 namespace zetasql {
 
-class Value::TypedList : public zetasql_base::SimpleReferenceCounted {
+// -------------------------------------------------------
+// Payload
+// -------------------------------------------------------
+// Base class of the reference-counted representations that may be allocated
+// from an arena by NewPayload(). An arena-allocated payload is destroyed when
+// its last reference goes away, but its memory is only released with the
+// arena.
+class Value::Payload : public zetasql_base::SimpleReferenceCounted {
+ public:
+  bool is_arena_allocated() const { return is_arena_allocated_; }
+
+  // The number of bytes reported to 'payload_allocation_counter_' for this
+  // payload. Must not change after construction.
+  virtual int64_t allocation_byte_size() const = 0;
+
+ protected:
+  Payload() {}
+
+  void OnRefCountIsZero() const override {
+    if (payload_allocation_counter_ != nullptr) {
+      payload_allocation_counter_->RecordFree(allocation_byte_size());
+    }
+    if (is_arena_allocated_) {
+      this->~Payload();
+    } else {
+      delete this;
+    }
+  }
+
+ private:
+  friend class Value;
+
+  bool is_arena_allocated_ = false;
+};
+
+template <typename T, typename... Args>
+inline T* Value::NewPayload(Args&&... args) {
+  const PayloadArena& payload_arena = payload_arena_;
+  T* payload;
+  if (payload_arena.arena == nullptr ||
+      payload_arena.arena->status().bytes_allocated() >=
+          payload_arena.max_bytes) {
+    payload = new T(std::forward<Args>(args)...);
+  } else {
+    payload = new (payload_arena.arena->AllocAligned(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    payload->is_arena_allocated_ = true;
+  }
+  if (payload_allocation_counter_ != nullptr) {
+    payload_allocation_counter_->RecordAllocation(
+        payload->allocation_byte_size());
+  }
+  return payload;
+}
+
+class Value::TypedList : public Payload {
  public:
   explicit TypedList(const Type* type) : type_(type) { CHECK(type != nullptr); }
+  TypedList(const Type* type, std::vector<Value>&& values)
+      : type_(type), values_(std::move(values)) {
+    CHECK(type != nullptr);
+  }
 
   TypedList(const TypedList&) = delete;
   TypedList& operator=(const TypedList&) = delete;
 
   const Type* type() const { return type_; }
   std::vector<Value>& values() { return values_; }
+  const std::vector<Value>& values() const { return values_; }
   uint64_t physical_byte_size() const {
     if (physical_byte_size_.has_value()) {
       return physical_byte_size_.value();
@@ -69,6 +132,9 @@ class Value::TypedList : public zetasql_base::SimpleReferenceCounted {
     physical_byte_size_ = size;
     return size;
   }
+  int64_t allocation_byte_size() const override {
+    return sizeof(TypedList) + values_.capacity() * sizeof(Value);
+  }
 
  private:
   const Type* type_;  // not owned
@@ -82,7 +148,7 @@ class Value::TypedList : public zetasql_base::SimpleReferenceCounted {
 // Even though Cord is internally reference counted, ProtoRep is reference
 // counted so that the internal representation can keep track of state
 // associated with a ProtoRep (specifically, already deserialized fields).
-class Value::ProtoRep : public zetasql_base::SimpleReferenceCounted {
+class Value::ProtoRep : public Payload {
  public:
   ProtoRep(const ProtoType* type, absl::Cord value)
       : type_(type), value_(std::move(value)) {
@@ -96,6 +162,9 @@ class Value::ProtoRep : public zetasql_base::SimpleReferenceCounted {
   const ProtoType* type() const { return type_; }
   const absl::Cord& value() const { return value_; }
   uint64_t physical_byte_size() const { return sizeof(ProtoRep) + value_.size(); }
+  int64_t allocation_byte_size() const override {
+    return physical_byte_size();
+  }
 
  private:
   const ProtoType* type_;
@@ -156,24 +225,62 @@ class Value::BigNumericRef : public zetasql_base::SimpleReferenceCounted {
 };
 
 // -------------------------------------------------------
-// StringRef is ref count wrapper around string.
+// StringRef is ref count wrapper around string. It either owns the string or
+// refers to external memory kept alive by an owner, in which case value()
+// copies the external bytes on first use.
 // -------------------------------------------------------
-class Value::StringRef : public zetasql_base::SimpleReferenceCounted {
+class Value::StringRef : public Payload {
  public:
   StringRef() {}
   explicit StringRef(std::string value) : value_(std::move(value)) {}
+  StringRef(absl::string_view view, std::shared_ptr<const void> owner)
+      : external_(new External{view, std::move(owner)}) {}
 
   StringRef(const StringRef&) = delete;
   StringRef& operator=(const StringRef&) = delete;
 
-  const std::string& value() const { return value_; }
+  const std::string& value() const {
+    if (external_ != nullptr) {
+      absl::call_once(external_->materialize_once, [this] {
+        value_.assign(external_->view.data(), external_->view.size());
+      });
+    }
+    return value_;
+  }
+
+  absl::string_view view() const {
+    return external_ == nullptr ? absl::string_view(value_) : external_->view;
+  }
+
+  // Returns the owner of the external memory, or nullptr if the string is
+  // owned by this StringRef.
+  const std::shared_ptr<const void>* owner() const {
+    return external_ == nullptr ? nullptr : &external_->owner;
+  }
 
+  // Counts external bytes as well, so that memory accounting does not depend
+  // on whether value() has been called.
   uint64_t physical_byte_size() const {
-    return sizeof(StringRef) + value_.size() * sizeof(char);
+    return sizeof(StringRef) + view().size() * sizeof(char) +
+           (external_ == nullptr ? 0 : sizeof(External));
+  }
+
+  // Does not count the external bytes, which this StringRef does not own.
+  int64_t allocation_byte_size() const override {
+    return sizeof(StringRef) +
+           (external_ == nullptr ? value_.size() : sizeof(External));
   }
 
  private:
-  const std::string value_;
+  struct External {
+    const absl::string_view view;
+    const std::shared_ptr<const void> owner;
+    absl::once_flag materialize_once;
+  };
+
+  // Only written by value() if 'external_' is set.
+  mutable std::string value_;
+  const std::unique_ptr<External> external_;
 };
 
 // -------------------------------------------------------
@@ -192,13 +299,13 @@ inline void Value::Clear() {
   switch (type_kind_) {
     case TYPE_STRING:
     case TYPE_BYTES:
-      string_ptr_->Unref();
+      if (string_ptr_ != nullptr) string_ptr_->Unref();
       break;
     case TYPE_ARRAY:
     case TYPE_STRUCT:
       // TODO This recursively deletes Values, so for deeply nested
       // struct types, we can get a stack overflow.
-      list_ptr_->Unref();
+      if (has_typed_list_) list_ptr_->Unref();
       break;
     case TYPE_GEOGRAPHY:
       geography_ptr_->Unref();
@@ -286,7 +393,18 @@ inline Value::Value(double value)
 
 inline Value::Value(TypeKind type_kind, std::string value)
     : type_kind_(static_cast<int16_t>(type_kind)),
-      string_ptr_(new StringRef(std::move(value))) {
+      string_ptr_(value.empty() ? nullptr
+                                : NewPayload<StringRef>(std::move(value))) {
+  CHECK(type_kind == TYPE_STRING ||
+        type_kind == TYPE_BYTES);
+}
+
+inline Value::Value(TypeKind type_kind, absl::string_view value,
+                    std::shared_ptr<const void> owner)
+    : type_kind_(static_cast<int16_t>(type_kind)),
+      string_ptr_(value.empty()
+                      ? nullptr
+                      : NewPayload<StringRef>(value, std::move(owner))) {
   CHECK(type_kind == TYPE_STRING ||
         type_kind == TYPE_BYTES);
 }
@@ -363,6 +481,15 @@ inline Value Value::Bytes(const char (&str)[N]) {
   return Value::Bytes(std::string(str, N - 1));
 }
 
+inline Value Value::ExternalString(absl::string_view v,
+                                   std::shared_ptr<const void> owner) {
+  return Value(TYPE_STRING, v, std::move(owner));
+}
+inline Value Value::ExternalBytes(absl::string_view v,
+                                  std::shared_ptr<const void> owner) {
+  return Value(TYPE_BYTES, v, std::move(owner));
+}
+
 inline Value Value::Date(int32_t v) {
   return Value(TYPE_DATE, v);
 }
@@ -499,16 +626,49 @@ inline double Value::double_value() const {
   return double_value_;
 }
 
+inline const std::string& Value::string_ref_value() const {
+  if (string_ptr_ == nullptr) {
+    static const std::string* const kEmptyString = new std::string;
+    return *kEmptyString;
+  }
+  return string_ptr_->value();
+}
+
+inline absl::string_view Value::string_ref_view() const {
+  if (string_ptr_ == nullptr) return absl::string_view();
+  return string_ptr_->view();
+}
+
+inline const std::vector<Value>& Value::list_values() const {
+  if (!has_typed_list_) {
+    static const std::vector<Value>* const kEmptyList = new std::vector<Value>;
+    return *kEmptyList;
+  }
+  return list_ptr_->values();
+}
+
 inline const std::string& Value::string_value() const {
   CHECK_EQ(TYPE_STRING, type_kind_) << "Not a string value";
   CHECK(!is_null_) << "Null value";
-  return string_ptr_->value();
+  return string_ref_value();
 }
 
 inline const std::string& Value::bytes_value() const {
   CHECK_EQ(TYPE_BYTES, type_kind_) << "Not a bytes value";
   CHECK(!is_null_) << "Null value";
-  return string_ptr_->value();
+  return string_ref_value();
+}
+
+inline absl::string_view Value::string_view_value() const {
+  CHECK_EQ(TYPE_STRING, type_kind_) << "Not a string value";
+  CHECK(!is_null_) << "Null value";
+  return string_ref_view();
+}
+
+inline absl::string_view Value::bytes_view_value() const {
+  CHECK_EQ(TYPE_BYTES, type_kind_) << "Not a bytes value";
+  CHECK(!is_null_) << "Null value";
+  return string_ref_view();
 }
 
 inline int32_t Value::date_value() const {
@@ -598,7 +758,7 @@ H Value::HashValueInternal(H h) const {
     case TYPE_ARRAY: {
       // Array types are equivalent if their element types are equivalent,
       // so we hash the element type kind.
-      const Type* element_type = list_ptr_->type()->AsArray()->element_type();
+      const Type* element_type = type()->AsArray()->element_type();
       h = H::combine(std::move(h), element_type->kind());
 
       // If the array elements are enums or protos, we also hash the full name
@@ -666,7 +826,7 @@ H Value::HashValueInternal(H h) const {
     }
     case TYPE_STRING:
     case TYPE_BYTES: {
-      return H::combine(std::move(h), string_ptr_->value());
+      return H::combine(std::move(h), string_ref_view());
     }
     case TYPE_DATE: {
       return H::combine(std::move(h), int32_value_);
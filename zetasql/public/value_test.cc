@@ -21,6 +21,7 @@
 #include <time.h>
 
 #include <limits>
+#include <memory>
 #include <type_traits>
 #include <utility>
 
@@ -54,6 +55,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/time/time.h"
 #include "zetasql/common/testing/proto_matchers.h"
+#include "zetasql/base/arena.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "zetasql/base/statusor.h"
 
@@ -1115,6 +1117,150 @@ TEST_F(ValueTest, StructWithNoFields) {
   EXPECT_EQ("Struct{}", value.FullDebugString());
 }
 
+// Empty strings, arrays and structs do not allocate a StringRef or TypedList,
+// but must behave like any other value.
+TEST_F(ValueTest, EmptyValuesWithoutAllocation) {
+  const Value empty_string = Value::String("");
+  EXPECT_EQ("", empty_string.string_value());
+  EXPECT_EQ(empty_string, Value::String(std::string()));
+  EXPECT_NE(empty_string, Value::String("a"));
+  EXPECT_NE(empty_string, Value::NullString());
+  EXPECT_EQ(empty_string.HashCode(), Value::String("").HashCode());
+  EXPECT_TRUE(empty_string.LessThan(Value::String("a")));
+  EXPECT_EQ("", Value::Bytes("").bytes_value());
+  EXPECT_EQ("", std::string(Value::Bytes("").ToCord()));
+
+  const Value empty_array = values::Int64Array({});
+  EXPECT_EQ("ARRAY<INT64>", empty_array.type()->DebugString());
+  EXPECT_TRUE(empty_array.is_empty_array());
+  EXPECT_EQ(0, empty_array.num_elements());
+  EXPECT_TRUE(empty_array.elements().empty());
+  EXPECT_EQ(empty_array, Value::EmptyArray(empty_array.type()->AsArray()));
+  EXPECT_NE(empty_array, values::Int64Array({1}));
+  EXPECT_NE(empty_array, Value::Null(empty_array.type()));
+  EXPECT_NE(empty_array, Value::EmptyArray(StringArrayType()));
+
+  const Value empty_struct = Struct({}, {});
+  EXPECT_EQ(0, empty_struct.num_fields());
+  EXPECT_TRUE(empty_struct.fields().empty());
+
+  Value copy = empty_array;
+  Value moved = std::move(copy);
+  EXPECT_EQ(empty_array, moved);
+  copy = empty_string;
+  EXPECT_EQ(empty_string, copy);
+  copy = values::Int64Array({1, 2});
+  EXPECT_EQ(2, copy.num_elements());
+}
+
+TEST_F(ValueTest, ArenaPayloads) {
+  zetasql_base::UnsafeArena arena(/*block_size=*/1024);
+  Value string_value;
+  Value array_value;
+  Value copy;
+  const size_t initial_remaining = arena.bytes_until_next_allocation();
+  {
+    InternalValue::ScopedArena scoped_arena(&arena, /*max_bytes=*/1 << 20);
+    string_value = Value::String("arena string");
+    array_value = values::Array(
+        MakeArrayType(StringArrayType()),
+        {values::StringArray({"a", "b"}), values::StringArray({"c"})});
+    EXPECT_LT(arena.bytes_until_next_allocation(), initial_remaining);
+    copy = InternalValue::CopyOutOfArena(array_value);
+  }
+  const size_t remaining = arena.bytes_until_next_allocation();
+  EXPECT_EQ("arena string", string_value.string_value());
+  EXPECT_EQ(array_value, copy);
+  EXPECT_EQ("[[\"a\", \"b\"], [\"c\"]]", copy.DebugString());
+
+  // Values created outside the scope do not use the arena.
+  Value heap_value = Value::String("heap string");
+  EXPECT_EQ(remaining, arena.bytes_until_next_allocation());
+  EXPECT_EQ(heap_value, InternalValue::CopyOutOfArena(heap_value));
+
+  // Once 'max_bytes' is reached, payloads are allocated on the heap.
+  {
+    InternalValue::ScopedArena scoped_arena(&arena, /*max_bytes=*/1);
+    EXPECT_EQ("full", Value::String("full").string_value());
+  }
+  EXPECT_EQ(remaining, arena.bytes_until_next_allocation());
+
+  string_value = Value();
+  array_value = Value();
+  EXPECT_EQ(2, copy.num_elements());
+}
+
+TEST_F(ValueTest, AllocationCounter) {
+  InternalValue::AllocationCounter counter;
+  InternalValue::AllocationCounter inner_counter;
+  {
+    InternalValue::ScopedAllocationCounter scoped_counter(&counter);
+    Value string_value = Value::String("a string that is not tiny");
+    EXPECT_GT(counter.allocated_bytes, 25);
+    EXPECT_EQ(counter.freed_bytes, 0);
+    Value array_value = values::StringArray({"a", "b"});
+    Value copy = array_value;
+    const int64_t allocated_bytes = counter.allocated_bytes;
+    {
+      // Only the innermost counter records.
+      InternalValue::ScopedAllocationCounter inner_scope(&inner_counter);
+      Value inner_value = Value::Bytes("bytes");
+      EXPECT_GT(inner_counter.allocated_bytes, 0);
+    }
+    EXPECT_EQ(counter.allocated_bytes, allocated_bytes);
+    EXPECT_EQ(inner_counter.freed_bytes, inner_counter.allocated_bytes);
+    EXPECT_EQ(counter.peak_bytes, allocated_bytes);
+    // Ints and empty strings have no payload.
+    Value int_value = Value::Int64(1);
+    Value empty_string = Value::String("");
+    EXPECT_EQ(counter.allocated_bytes, allocated_bytes);
+  }
+  // Copies share the payload, so everything is freed exactly once.
+  EXPECT_EQ(counter.freed_bytes, counter.allocated_bytes);
+  EXPECT_EQ(counter.peak_bytes, counter.allocated_bytes);
+
+  // Without a counter, nothing is recorded.
+  const InternalValue::AllocationCounter saved_counter = counter;
+  Value value = Value::String("not counted");
+  EXPECT_EQ(counter.allocated_bytes, saved_counter.allocated_bytes);
+}
+
+TEST_F(ValueTest, ExternalString) {
+  auto buffer = std::make_shared<const std::string>("external string");
+  std::weak_ptr<const std::string> weak_buffer = buffer;
+  const absl::string_view data(*buffer);
+
+  Value value = Value::ExternalString(data.substr(0, 8), buffer);
+  Value bytes = Value::ExternalBytes(data, buffer);
+  buffer.reset();
+  EXPECT_FALSE(weak_buffer.expired());
+
+  EXPECT_EQ(data.data(), value.string_view_value().data());
+  EXPECT_EQ("external", value.string_view_value());
+  EXPECT_EQ(data, bytes.bytes_view_value());
+  EXPECT_EQ(Value::String("external"), value);
+  EXPECT_EQ(Value::String("external").HashCode(), value.HashCode());
+  EXPECT_TRUE(value.LessThan(Value::String("externalz")));
+  EXPECT_EQ("\"external\"", value.DebugString());
+  EXPECT_EQ("external string", std::string(bytes.ToCord()));
+
+  // string_value() copies the bytes, so its result stays valid as long as the
+  // value.
+  EXPECT_EQ("external", value.string_value());
+  EXPECT_EQ("external string", bytes.bytes_value());
+  EXPECT_NE(data.data(), value.string_value().data());
+
+  EXPECT_EQ("", Value::ExternalString("", nullptr).string_value());
+
+  Value copy = value;
+  value = Value();
+  bytes = Value();
+  EXPECT_FALSE(weak_buffer.expired());
+  EXPECT_EQ("external", copy.string_view_value());
+  copy = Value();
+  EXPECT_TRUE(weak_buffer.expired());
+}
+
 TEST_F(ValueTest, ArrayNotNull) {
   Value value = TestGetSQL(Int64Array({1, 2}));
   EXPECT_FALSE(value.is_null());
@@ -2305,16 +2451,16 @@ TEST_F(ValueTest, PhysicalByteSize) {
   EXPECT_EQ(sizeof(Value), Value::Uint32(1).physical_byte_size());
   EXPECT_EQ(sizeof(Value), Value::Uint64(1).physical_byte_size());
 
-  // Variable sized types.
-  uint64_t empty_array_size = values::Int64Array({}).physical_byte_size();
-  EXPECT_EQ(sizeof(Value) + sizeof(Value::TypedList), empty_array_size);
-  EXPECT_EQ(empty_array_size + Value::Int64(1).physical_byte_size(),
+  // Variable sized types. Empty arrays, structs and strings are stored in the
+  // Value itself.
+  EXPECT_EQ(sizeof(Value), values::Int64Array({}).physical_byte_size());
+  const uint64_t array_size = sizeof(Value) + sizeof(Value::TypedList);
+  EXPECT_EQ(array_size + Value::Int64(1).physical_byte_size(),
             values::Int64Array({1}).physical_byte_size());
-  EXPECT_EQ(empty_array_size + 3 * Value::Int64(1).physical_byte_size(),
+  EXPECT_EQ(array_size + 3 * Value::Int64(1).physical_byte_size(),
             values::Int64Array({1, 2, 3}).physical_byte_size());
 
-  EXPECT_EQ(sizeof(Value) + sizeof(Value::StringRef),
-            Value::Bytes("").physical_byte_size());
+  EXPECT_EQ(sizeof(Value), Value::Bytes("").physical_byte_size());
   EXPECT_EQ(sizeof(Value) + sizeof(Value::StringRef) + 3 * sizeof(char),
             Value::Bytes("abc").physical_byte_size());
   // Strings should be consistent with bytes.
@@ -2324,8 +2470,7 @@ TEST_F(ValueTest, PhysicalByteSize) {
             Value::String("abc").physical_byte_size());
 
   // Structs should be consistent with their contents.
-  EXPECT_EQ(sizeof(Value) + sizeof(Value::TypedList),
-            Struct({}, {}).physical_byte_size());
+  EXPECT_EQ(sizeof(Value), Struct({}, {}).physical_byte_size());
   EXPECT_EQ(sizeof(Value) + sizeof(Value::TypedList) +
                 bool_value.physical_byte_size() +
                 date_value.physical_byte_size(),
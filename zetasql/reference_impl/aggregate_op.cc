@@ -16,6 +16,10 @@
 
 // This file contains the code for evaluating aggregate functions.
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -24,18 +28,23 @@
 
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
+#include "zetasql/reference_impl/aggregate_state.h"
 #include "zetasql/reference_impl/common.h"
 #include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/function.h"
+#include "zetasql/reference_impl/hll_sketch.h"
 #include "zetasql/reference_impl/operator.h"
+#include "zetasql/reference_impl/spill.h"
 #include "zetasql/reference_impl/tuple.h"
 #include "zetasql/reference_impl/tuple_comparator.h"
+#include "zetasql/reference_impl/value_comparator.h"
 #include "zetasql/reference_impl/variable_id.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include <cstdint>
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
+#include "absl/hash/hash.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
@@ -55,6 +64,31 @@ using zetasql::values::Int64;
 
 namespace zetasql {
 
+// -------------------------------------------------------
+// AggregateAccumulator
+// -------------------------------------------------------
+
+static zetasql_base::Status PartialAggregationUnsupportedError() {
+  return ::zetasql_base::UnimplementedErrorBuilder()
+         << "Partial aggregation is not supported for this aggregate";
+}
+
+::zetasql_base::StatusOr<Value> AggregateAccumulator::SerializeState() {
+  return PartialAggregationUnsupportedError();
+}
+
+::zetasql_base::Status AggregateAccumulator::Merge(const Value& state) {
+  return PartialAggregationUnsupportedError();
+}
+
+::zetasql_base::StatusOr<Value> AggregateArgAccumulator::SerializeState() {
+  return PartialAggregationUnsupportedError();
+}
+
+::zetasql_base::Status AggregateArgAccumulator::Merge(const Value& state) {
+  return PartialAggregationUnsupportedError();
+}
+
 // -------------------------------------------------------
 // AggregateArg
 // -------------------------------------------------------
@@ -108,6 +142,20 @@ namespace zetasql {
   return zetasql_base::OkStatus();
 }
 
+::zetasql_base::Status AggregateArg::SetSchemasForMerge(
+    const TupleSchema& group_schema,
+    absl::Span<const TupleSchema* const> params_schemas) {
+  ZETASQL_RET_CHECK(SupportsPartialAggregation());
+  for (int i = 0; i < parameter_list_size(); ++i) {
+    ZETASQL_RETURN_IF_ERROR(
+        mutable_parameter(i)->SetSchemasForEvaluation(params_schemas));
+  }
+
+  group_schema_ =
+      absl::make_unique<const TupleSchema>(group_schema.variables());
+  return zetasql_base::OkStatus();
+}
+
 namespace {
 
 // Variant of the aggregator accumulator interfaces that is able to look at both
@@ -128,6 +176,17 @@ class IntermediateAggregateAccumulator {
 
   virtual ::zetasql_base::StatusOr<Value> GetFinalResult(
       bool inputs_in_defined_order) = 0;
+
+  // Like AggregateAccumulator::SerializeState() and Merge(). Only the
+  // accumulators that AggregateArg::SupportsPartialAggregation() allows
+  // override these.
+  virtual ::zetasql_base::StatusOr<Value> SerializeState() {
+    return PartialAggregationUnsupportedError();
+  }
+
+  virtual ::zetasql_base::Status Merge(const Value& state) {
+    return PartialAggregationUnsupportedError();
+  }
 };
 
 // Adapts AggregateAccumulator to IntermediateAggregateAccumulator.
@@ -177,6 +236,14 @@ class AggregateAccumulatorAdaptor : public IntermediateAggregateAccumulator {
     return status_or_value.ValueOrDie();
   }
 
+  ::zetasql_base::StatusOr<Value> SerializeState() override {
+    return accumulator_->SerializeState();
+  }
+
+  ::zetasql_base::Status Merge(const Value& state) override {
+    return accumulator_->Merge(state);
+  }
+
  private:
   const Type* output_type_;
   const ResolvedFunctionCallBase::ErrorMode error_mode_;
@@ -285,7 +352,10 @@ class OrderByAccumulator : public IntermediateAggregateAccumulator {
     while (!inputs_.IsEmpty()) {
       std::unique_ptr<TupleData> input_row = inputs_.PopFront();
       ZETASQL_RET_CHECK(!input_row->slots().empty());
-      const Value value = input_row->slots().back().value();
+      // The row is discarded, so its last value is moved rather than copied.
+      const Value value = std::move(
+          *input_row->mutable_slot(input_row->num_slots() - 1)
+               ->mutable_value());
       input_row->RemoveSlots(1);
 
       if (!accumulator_->Accumulate(*input_row, value, &stop_accumulation,
@@ -311,16 +381,16 @@ class OrderByAccumulator : public IntermediateAggregateAccumulator {
 
 // Accumulator that keeps the top N values and accumulates them in
 // order. Functionally equivalent to LimitAccumulator(OrderByAccumulator) but
-// uses less memory.
+// uses less memory. The values are kept in a bounded heap, and an input row
+// that would not make the cut is not copied at all.
 class TopNAccumulator : public IntermediateAggregateAccumulator {
  public:
   TopNAccumulator(const int64_t n,
                   std::unique_ptr<TupleComparator> tuple_comparator,
                   std::unique_ptr<IntermediateAggregateAccumulator> accumulator,
                   EvaluationContext* context)
-      : n_(n),
-        tuple_comparator_(std::move(tuple_comparator)),
-        top_n_(*tuple_comparator_, context->memory_accountant()),
+      : tuple_comparator_(std::move(tuple_comparator)),
+        top_n_(*tuple_comparator_, n, context->memory_accountant()),
         accumulator_(std::move(accumulator)) {}
 
   ::zetasql_base::Status Reset() override {
@@ -335,28 +405,25 @@ class TopNAccumulator : public IntermediateAggregateAccumulator {
                   bool* stop_accumulation, ::zetasql_base::Status* status) override {
     *stop_accumulation = false;
 
+    // The comparator only reads the key slots, which 'input_row' has too.
+    if (!top_n_.WouldKeep(input_row)) return true;
+
     auto input = absl::make_unique<TupleData>(input_row);
     input->AddSlots(1);
     input->mutable_slot(input->num_slots() - 1)->SetValue(value);
-
-    if (!top_n_.Insert(std::move(input), status)) return false;
-
-    // 'if' should be good enough; 'while' is for paranoia.
-    while (top_n_.GetSize() > n_) {
-      top_n_.PopBack();
-    }
-
-    return true;
+    return top_n_.Insert(std::move(input), status);
   }
 
   ::zetasql_base::StatusOr<Value> GetFinalResult(
       bool /* inputs_in_defined_order */) override {
     bool stop_accumulation;
     ::zetasql_base::Status status;
-    while (!top_n_.IsEmpty()) {
-      std::unique_ptr<TupleData> input_row = top_n_.PopFront();
+    for (const std::unique_ptr<TupleData>& input_row : top_n_.PopAllSorted()) {
       ZETASQL_RET_CHECK(!input_row->slots().empty());
-      const Value value = input_row->slots().back().value();
+      // The row is discarded, so its last value is moved rather than copied.
+      const Value value = std::move(
+          *input_row->mutable_slot(input_row->num_slots() - 1)
+               ->mutable_value());
       input_row->RemoveSlots(1);
 
       if (!accumulator_->Accumulate(*input_row, value, &stop_accumulation,
@@ -375,21 +442,55 @@ class TopNAccumulator : public IntermediateAggregateAccumulator {
   }
 
  private:
-  const int64_t n_;
   const std::unique_ptr<TupleComparator> tuple_comparator_;
-  // The last slot of each TupleData in this queue is the Value passed to the
+  // The last slot of each TupleData in this heap is the Value passed to the
   // corresponding call to Accumulate().
-  TupleDataOrderedQueue top_n_;
+  TupleDataBoundedHeap top_n_;
   std::unique_ptr<IntermediateAggregateAccumulator> accumulator_;
 };
 
+// Accumulates each value of a state holding a list of values of 'type' into
+// 'accumulator'. Used to merge the states of the distinct accumulators below.
+// If 'distinct_values' is non-NULL, first reserves room in it for the values
+// of the state, since most of them are usually distinct from the values that
+// it already holds.
+zetasql_base::Status MergeDistinctValues(
+    const Value& state, const Type* type,
+    IntermediateAggregateAccumulator* accumulator,
+    ValueHashSet* distinct_values = nullptr) {
+  if (state.is_null()) return zetasql_base::OkStatus();
+  ZETASQL_ASSIGN_OR_RETURN(AggregateStateReader reader,
+                   AggregateStateReader::Create(state));
+  if (distinct_values != nullptr) {
+    zetasql_base::Status status;
+    if (!distinct_values->Reserve(
+            distinct_values->size() + reader.num_remaining_fields(),
+            &status)) {
+      return status;
+    }
+  }
+  const TupleData empty_row;
+  while (!reader.AtEnd()) {
+    ZETASQL_ASSIGN_OR_RETURN(const Value value, reader.ReadValue(type));
+    bool stop_accumulation;
+    zetasql_base::Status status;
+    if (!accumulator->Accumulate(empty_row, value, &stop_accumulation,
+                                 &status)) {
+      return status;
+    }
+  }
+  return zetasql_base::OkStatus();
+}
+
 // Accumulator that only passes through distinct values.
 class DistinctAccumulator : public IntermediateAggregateAccumulator {
  public:
   DistinctAccumulator(
+      const Type* input_type,
       std::unique_ptr<IntermediateAggregateAccumulator> accumulator,
       EvaluationContext* context)
-      : distinct_values_(context->memory_accountant()),
+      : input_type_(input_type),
+        distinct_values_(context->memory_accountant(), input_type),
         accumulator_(std::move(accumulator)) {}
 
   ::zetasql_base::Status Reset() override {
@@ -423,11 +524,219 @@ class DistinctAccumulator : public IntermediateAggregateAccumulator {
     return accumulator_->GetFinalResult(inputs_in_defined_order);
   }
 
+  // The state is the list of distinct values, which Merge() passes through
+  // Accumulate() again to dedup them against the values seen here.
+  ::zetasql_base::StatusOr<Value> SerializeState() override {
+    AggregateStateWriter writer;
+    zetasql_base::Status status;
+    distinct_values_.ForEach([&writer, &status](const Value& value) {
+      if (status.ok()) status = writer.AddValue(value);
+    });
+    ZETASQL_RETURN_IF_ERROR(status);
+    return writer.Finish();
+  }
+
+  ::zetasql_base::Status Merge(const Value& state) override {
+    return MergeDistinctValues(state, input_type_, this, &distinct_values_);
+  }
+
  private:
+  const Type* input_type_;
   ValueHashSet distinct_values_;
   std::unique_ptr<IntermediateAggregateAccumulator> accumulator_;
 };
 
+// Keys of a CompactDistinctAccumulator for INT64 values.
+struct Int64DistinctKeyTraits {
+  using Key = int64_t;
+  static int64_t GetKey(const Value& value) { return value.int64_value(); }
+  // Returns the Value of 'type' that 'key' was built from.
+  static Value ToValue(const Type* type, const Key& key) {
+    return Value::Int64(key);
+  }
+  // The number of bytes owned by 'key' outside of its slot.
+  static int64_t OwnedBytes(const Key& key) { return 0; }
+};
+
+// Keys of a CompactDistinctAccumulator for STRING and BYTES values.
+struct StringDistinctKeyTraits {
+  using Key = std::string;
+  static absl::string_view GetKey(const Value& value) {
+    return value.type_kind() == TYPE_STRING ? value.string_value()
+                                            : value.bytes_value();
+  }
+  static Value ToValue(const Type* type, const Key& key) {
+    return type->kind() == TYPE_STRING ? Value::String(key)
+                                       : Value::Bytes(key);
+  }
+  static int64_t OwnedBytes(const Key& key) { return key.size(); }
+};
+
+// Like DistinctAccumulator, but stores the distinct values of a single type as
+// raw keys in a flat hash set instead of Values. The accountant is charged for
+// every slot of the set (including the ones that are still empty) and for the
+// bytes of the keys.
+template <typename KeyTraits>
+class CompactDistinctAccumulator : public IntermediateAggregateAccumulator {
+ public:
+  CompactDistinctAccumulator(
+      const Type* input_type,
+      std::unique_ptr<IntermediateAggregateAccumulator> accumulator,
+      EvaluationContext* context)
+      : input_type_(input_type),
+        accountant_(context->memory_accountant()),
+        accumulator_(std::move(accumulator)) {}
+
+  CompactDistinctAccumulator(const CompactDistinctAccumulator&) = delete;
+  CompactDistinctAccumulator& operator=(const CompactDistinctAccumulator&) =
+      delete;
+
+  ~CompactDistinctAccumulator() override { Clear(); }
+
+  ::zetasql_base::Status Reset() override {
+    Clear();
+    return accumulator_->Reset();
+  }
+
+  bool Accumulate(const TupleData& input_row, const Value& value,
+                  bool* stop_accumulation, ::zetasql_base::Status* status) override {
+    *stop_accumulation = false;
+
+    if (value.is_null()) {
+      if (seen_null_) return true;
+      seen_null_ = true;
+    } else {
+      const auto inserted = values_.emplace(KeyTraits::GetKey(value));
+      if (!inserted.second) return true;
+      const int64_t owned_bytes = KeyTraits::OwnedBytes(*inserted.first);
+      owned_bytes_ += owned_bytes;
+      const int64_t num_bytes =
+          static_cast<int64_t>(values_.capacity()) * kSlotBytes +
+          owned_bytes_;
+      if (num_bytes > num_bytes_) {
+        if (!accountant_->RequestBytes(num_bytes - num_bytes_, status)) {
+          values_.erase(inserted.first);
+          owned_bytes_ -= owned_bytes;
+          return false;
+        }
+        num_bytes_ = num_bytes;
+      }
+    }
+
+    return accumulator_->Accumulate(input_row, value, stop_accumulation,
+                                    status);
+  }
+
+  ::zetasql_base::StatusOr<Value> GetFinalResult(
+      bool inputs_in_defined_order) override {
+    return accumulator_->GetFinalResult(inputs_in_defined_order);
+  }
+
+  // Like DistinctAccumulator::SerializeState().
+  ::zetasql_base::StatusOr<Value> SerializeState() override {
+    AggregateStateWriter writer;
+    if (seen_null_) {
+      ZETASQL_RETURN_IF_ERROR(writer.AddValue(Value::Null(input_type_)));
+    }
+    for (const Key& key : values_) {
+      ZETASQL_RETURN_IF_ERROR(
+          writer.AddValue(KeyTraits::ToValue(input_type_, key)));
+    }
+    return writer.Finish();
+  }
+
+  ::zetasql_base::Status Merge(const Value& state) override {
+    return MergeDistinctValues(state, input_type_, this);
+  }
+
+ private:
+  using Key = typename KeyTraits::Key;
+
+  // Each slot holds a key and a control byte.
+  static constexpr int64_t kSlotBytes = sizeof(Key) + 1;
+
+  void Clear() {
+    absl::flat_hash_set<Key>().swap(values_);
+    seen_null_ = false;
+    owned_bytes_ = 0;
+    accountant_->ReturnBytes(num_bytes_);
+    num_bytes_ = 0;
+  }
+
+  const Type* input_type_;
+  MemoryAccountant* accountant_;  // Not owned.
+  absl::flat_hash_set<Key> values_;
+  bool seen_null_ = false;
+  int64_t owned_bytes_ = 0;
+  // The number of bytes charged to 'accountant_'.
+  int64_t num_bytes_ = 0;
+  std::unique_ptr<IntermediateAggregateAccumulator> accumulator_;
+};
+
+// Computes APPROX_COUNT_DISTINCT with an HllSketch instead of the exact count
+// of a DistinctAccumulator. Used if
+// EvaluationOptions::use_sketches_for_approx_count_distinct is true.
+class HllAccumulator : public IntermediateAggregateAccumulator {
+ public:
+  explicit HllAccumulator(EvaluationContext* context)
+      : sketch_(context->memory_accountant()) {}
+
+  HllAccumulator(const HllAccumulator&) = delete;
+  HllAccumulator& operator=(const HllAccumulator&) = delete;
+
+  ::zetasql_base::Status Reset() override {
+    sketch_.Clear();
+    return zetasql_base::OkStatus();
+  }
+
+  bool Accumulate(const TupleData& input_row, const Value& value,
+                  bool* stop_accumulation, ::zetasql_base::Status* status) override {
+    *stop_accumulation = false;
+    return sketch_.Add(HllSketch::HashValue(value), status);
+  }
+
+  ::zetasql_base::StatusOr<Value> GetFinalResult(
+      bool inputs_in_defined_order) override {
+    return Value::Int64(sketch_.Estimate());
+  }
+
+ private:
+  HllSketch sketch_;
+};
+
+// Returns true if 'arg' is an APPROX_COUNT_DISTINCT that may be estimated with
+// an HllAccumulator.
+bool UseHllAccumulator(const AggregateArg& arg,
+                       const EvaluationContext& context) {
+  if (!context.options().use_sketches_for_approx_count_distinct) return false;
+  const auto* function = dynamic_cast<const BuiltinAggregateFunction*>(
+      arg.aggregate_function()->function());
+  return function != nullptr &&
+         function->kind() == FunctionKind::kApproxCountDistinct;
+}
+
+// Returns an accumulator that passes the distinct values of 'input_type' to
+// 'accumulator'.
+std::unique_ptr<IntermediateAggregateAccumulator> CreateDistinctAccumulator(
+    const Type* input_type,
+    std::unique_ptr<IntermediateAggregateAccumulator> accumulator,
+    EvaluationContext* context) {
+  switch (input_type->kind()) {
+    case TYPE_INT64:
+      return absl::make_unique<
+          CompactDistinctAccumulator<Int64DistinctKeyTraits>>(
+          input_type, std::move(accumulator), context);
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      return absl::make_unique<
+          CompactDistinctAccumulator<StringDistinctKeyTraits>>(
+          input_type, std::move(accumulator), context);
+    default:
+      return absl::make_unique<DistinctAccumulator>(
+          input_type, std::move(accumulator), context);
+  }
+}
+
 // Accumulator that discards NULL values.
 class IgnoresNullAccumulator : public IntermediateAggregateAccumulator {
  public:
@@ -471,6 +780,14 @@ class IgnoresNullAccumulator : public IntermediateAggregateAccumulator {
     return accumulator_->GetFinalResult(inputs_in_defined_order);
   }
 
+  ::zetasql_base::StatusOr<Value> SerializeState() override {
+    return accumulator_->SerializeState();
+  }
+
+  ::zetasql_base::Status Merge(const Value& state) override {
+    return accumulator_->Merge(state);
+  }
+
  private:
   const bool use_compound_values_;
   std::unique_ptr<IntermediateAggregateAccumulator> accumulator_;
@@ -497,6 +814,8 @@ class HavingExtremalValueAccumulator : public IntermediateAggregateAccumulator {
       : params_(params.begin(), params.end()),
         having_expr_(having_expr),
         use_max_(use_max),
+        comparator_(GetPrimitiveValueComparator(having_expr->output_type())),
+        is_floating_point_(having_expr->output_type()->IsFloatingPoint()),
         accumulator_(std::move(accumulator)),
         context_(context) {}
 
@@ -523,6 +842,10 @@ class HavingExtremalValueAccumulator : public IntermediateAggregateAccumulator {
     }
     const Value& having_value = slot.value();
 
+    if (comparator_ != nullptr) {
+      return AccumulatePrimitive(input_row, value, having_value, status);
+    }
+
     // Compute the new extremal having value.
     Value new_extremal_having_value;
     if (!extremal_having_value_.is_valid()) {
@@ -612,9 +935,64 @@ class HavingExtremalValueAccumulator : public IntermediateAggregateAccumulator {
   }
 
  private:
+  bool IsNaN(const Value& value) const {
+    return is_floating_point_ && std::isnan(value.ToDouble());
+  }
+
+  // Returns true if 'v1' and 'v2' are equal with SQL semantics, which is never
+  // the case if either is NULL or NaN.
+  bool SqlEquals(const Value& v1, const Value& v2) const {
+    if (v1.is_null() || v2.is_null() || IsNaN(v1) || IsNaN(v2)) return false;
+    return comparator_(v1, v2) == 0;
+  }
+
+  // Same as the remainder of Accumulate() for 'having_value', but compares
+  // the values with 'comparator_' instead of evaluating MAX/MIN and '='. This
+  // keeps the semantics of MAX/MIN, which ignore NULLs and return NaN if any
+  // input is NaN.
+  bool AccumulatePrimitive(const TupleData& input_row, const Value& value,
+                           const Value& having_value,
+                           ::zetasql_base::Status* status) {
+    bool reset;
+    if (!extremal_having_value_.is_valid()) {
+      extremal_having_value_ = having_value;
+      reset = true;
+    } else if (having_value.is_null()) {
+      // The extremal value does not change, but it is only equal to itself if
+      // it is neither NULL nor NaN.
+      reset = !SqlEquals(extremal_having_value_, extremal_having_value_);
+    } else {
+      bool replace;
+      if (extremal_having_value_.is_null() || IsNaN(having_value)) {
+        replace = true;
+      } else if (IsNaN(extremal_having_value_)) {
+        replace = false;
+      } else {
+        const int result = comparator_(having_value, extremal_having_value_);
+        replace = use_max_ ? result > 0 : result < 0;
+      }
+      reset = replace || !SqlEquals(extremal_having_value_,
+                                    extremal_having_value_);
+      if (replace) extremal_having_value_ = having_value;
+    }
+    if (reset) {
+      *status = accumulator_->Reset();
+      if (!status->ok()) return false;
+    }
+    if (!SqlEquals(extremal_having_value_, having_value)) return true;
+
+    bool dummy_stop_accumulation;
+    return accumulator_->Accumulate(input_row, value, &dummy_stop_accumulation,
+                                    status);
+  }
+
   const std::vector<const TupleData*> params_;
   const ValueExpr* having_expr_;
   const bool use_max_;
+  // The comparator for the values of 'having_expr_', or nullptr if they are
+  // not of a primitive type.
+  const ValueComparator comparator_;
+  const bool is_floating_point_;
   Value extremal_having_value_;
   std::unique_ptr<IntermediateAggregateAccumulator> accumulator_;
   EvaluationContext* context_;
@@ -674,6 +1052,15 @@ class IntermediateAggregateAccumulatorAdaptor : public AggregateArgAccumulator {
     return accumulator_->GetFinalResult(inputs_in_defined_order);
   }
 
+  ::zetasql_base::StatusOr<Value> SerializeState() override {
+    return accumulator_->SerializeState();
+  }
+
+  ::zetasql_base::Status Merge(const Value& state) override {
+    if (state.is_null()) return zetasql_base::OkStatus();
+    return accumulator_->Merge(state);
+  }
+
  private:
   const std::vector<const TupleData*> params_;
   const std::vector<const ValueExpr*> value_exprs_;
@@ -720,17 +1107,24 @@ AggregateArg::CreateAccumulator(absl::Span<const TupleData* const> params,
     ::zetasql_base::Status status;
     if (!parameter(i)->Eval(params, context, &slot, &status)) return status;
   }
-  ZETASQL_ASSIGN_OR_RETURN(
-      std::unique_ptr<AggregateAccumulator> underlying_accumulator,
-      aggregate_function()->function()->CreateAccumulator(args, context));
-
-  // Adapt the underlying AggregateAccumulator to the
-  // IntermediateAggregateAccumulator interface so that we can stack other
-  // intermediate accumulators on top of it.
-  std::unique_ptr<IntermediateAggregateAccumulator> accumulator =
-      absl::make_unique<AggregateAccumulatorAdaptor>(
-          aggregate_function()->output_type(), error_mode_,
-          std::move(underlying_accumulator));
+  // An HllAccumulator replaces both the underlying AggregateAccumulator and
+  // the DistinctAccumulator below.
+  const bool use_hll_accumulator = UseHllAccumulator(*this, *context);
+  std::unique_ptr<IntermediateAggregateAccumulator> accumulator;
+  if (use_hll_accumulator) {
+    accumulator = absl::make_unique<HllAccumulator>(context);
+  } else {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<AggregateAccumulator> underlying_accumulator,
+        aggregate_function()->function()->CreateAccumulator(args, context));
+
+    // Adapt the underlying AggregateAccumulator to the
+    // IntermediateAggregateAccumulator interface so that we can stack other
+    // intermediate accumulators on top of it.
+    accumulator = absl::make_unique<AggregateAccumulatorAdaptor>(
+        aggregate_function()->output_type(), error_mode_,
+        std::move(underlying_accumulator));
+  }
 
   // LIMIT support.
   bool consumed_order_by = false;
@@ -779,9 +1173,9 @@ AggregateArg::CreateAccumulator(absl::Span<const TupleData* const> params,
   }
 
   // DISTINCT support.
-  if (distinct()) {
-    accumulator =
-        absl::make_unique<DistinctAccumulator>(std::move(accumulator), context);
+  if (distinct() && !use_hll_accumulator) {
+    accumulator = CreateDistinctAccumulator(input_type(),
+                                            std::move(accumulator), context);
   }
 
   // Support for aggregation functions that ignore NULLs.
@@ -919,6 +1313,19 @@ bool AggregateArg::ignores_null() const {
   return aggregate_function()->function()->ignores_null();
 }
 
+bool AggregateArg::IsPlainAggregation() const {
+  return distinct() == kAll && having_modifier_kind() == kHavingNone &&
+         order_by_keys().empty() && limit() == nullptr &&
+         parameter_list_size() == 0;
+}
+
+bool AggregateArg::SupportsPartialAggregation() const {
+  return aggregate_function()->function()->SupportsPartialAggregation() &&
+         having_modifier_kind() == kHavingNone && order_by_keys().empty() &&
+         limit() == nullptr &&
+         error_mode_ == ResolvedFunctionCallBase::DEFAULT_ERROR_MODE;
+}
+
 const ValueExpr* AggregateArg::input_field(int i) const {
   return aggregate_function()->GetArgs()[i]->node()->AsValueExpr();
 }
@@ -961,12 +1368,22 @@ std::string AggregateOp::GetIteratorDebugString(
 zetasql_base::StatusOr<std::unique_ptr<AggregateOp>> AggregateOp::Create(
     std::vector<std::unique_ptr<KeyArg>> keys,
     std::vector<std::unique_ptr<AggregateArg>> aggregators,
-    std::unique_ptr<RelationalOp> input) {
+    std::unique_ptr<RelationalOp> input, Mode mode) {
   for (auto& arg : keys) {
     ZETASQL_RETURN_IF_ERROR(ValidateTypeSupportsEqualityComparison(arg->type()));
   }
-  return absl::WrapUnique(new AggregateOp(
-      std::move(keys), std::move(aggregators), std::move(input)));
+  if (mode != kComplete) {
+    for (const auto& arg : aggregators) {
+      if (!arg->SupportsPartialAggregation()) {
+        return ::zetasql_base::UnimplementedErrorBuilder()
+               << "Partial aggregation is not supported for "
+               << arg->DebugString();
+      }
+    }
+  }
+  return absl::WrapUnique(new AggregateOp(std::move(keys),
+                                          std::move(aggregators),
+                                          std::move(input), mode));
 }
 
 ::zetasql_base::Status AggregateOp::SetSchemasForEvaluation(
@@ -982,8 +1399,16 @@ zetasql_base::StatusOr<std::unique_ptr<AggregateOp>> AggregateOp::Create(
   }
 
   for (AggregateArg* arg : mutable_aggregators()) {
-    ZETASQL_RETURN_IF_ERROR(
-        arg->SetSchemasForEvaluation(*input_schema, params_schemas));
+    if (mode_ == kFinal) {
+      ZETASQL_RET_CHECK(
+          input_schema->FindIndexForVariable(arg->variable()).has_value())
+          << arg->DebugString();
+      ZETASQL_RETURN_IF_ERROR(
+          arg->SetSchemasForMerge(*input_schema, params_schemas));
+    } else {
+      ZETASQL_RETURN_IF_ERROR(
+          arg->SetSchemasForEvaluation(*input_schema, params_schemas));
+    }
   }
 
   return zetasql_base::OkStatus();
@@ -996,11 +1421,13 @@ class AggregateTupleIterator : public TupleIterator {
  public:
   AggregateTupleIterator(
       absl::Span<const TupleData* const> params,
-      std::unique_ptr<TupleDataDeque> tuples,
+      std::unique_ptr<TupleComparator> comparator,
+      std::unique_ptr<SpillableTupleSorter> tuples,
       std::unique_ptr<TupleIterator> input_iter_for_debug_string,
       std::unique_ptr<TupleSchema> output_schema, EvaluationContext* context)
       : params_(params.begin(), params.end()),
         output_schema_(std::move(output_schema)),
+        comparator_(std::move(comparator)),
         tuples_(std::move(tuples)),
         input_iter_for_debug_string_(std::move(input_iter_for_debug_string)),
         context_(context) {}
@@ -1024,7 +1451,7 @@ class AggregateTupleIterator : public TupleIterator {
     }
     ++num_next_calls_;
 
-    current_ = tuples_->PopFront();
+    current_ = tuples_->PopFront(&status_);
     return current_.get();
   }
 
@@ -1039,7 +1466,9 @@ class AggregateTupleIterator : public TupleIterator {
   const std::vector<const TupleData*> params_;
   const std::unique_ptr<TupleSchema> output_schema_;
   const std::vector<const AggregateArg*> aggregators_;
-  const std::unique_ptr<TupleDataDeque> tuples_;
+  // Used by 'tuples_'.
+  const std::unique_ptr<TupleComparator> comparator_;
+  const std::unique_ptr<SpillableTupleSorter> tuples_;
   // We store a TupleIterator instead of the debug string to avoid computing the
   // debug string unnecessarily.
   const std::unique_ptr<TupleIterator> input_iter_for_debug_string_;
@@ -1049,45 +1478,35 @@ class AggregateTupleIterator : public TupleIterator {
   int64_t num_next_calls_ = 0;
 };
 
-// Wraps a const TupleData* but hashes as the underlying TupleData.
-struct TupleDataPtr {
-  explicit TupleDataPtr(const TupleData* data_in) : data(data_in) {}
-
-  const TupleData* data = nullptr;
-
-  bool operator==(const TupleDataPtr& t) const { return *data == *t.data; }
-
-  template <typename H>
-  friend H AbslHashValue(H h, const TupleDataPtr& t) {
-    return H::combine(std::move(h), *t.data);
-  }
-};
-
 // The bool is true if we should stop accumulation for the corresponding
 // accumulator.
 using AccumulatorList =
     std::vector<std::pair<std::unique_ptr<AggregateArgAccumulator>, bool>>;
 
-// The data associated with a grouping key during aggregation.
+// The data associated with a grouping key during aggregation. GroupValues are
+// movable so that GroupMap can store them inline in its hash tables.
 class GroupValue {
  public:
   // Reserves bytes for 'key' with 'accountant' and returns a new GroupValue.
-  static zetasql_base::StatusOr<std::unique_ptr<GroupValue>> Create(
-      std::unique_ptr<TupleData> key, MemoryAccountant* accountant) {
+  static zetasql_base::StatusOr<GroupValue> Create(std::unique_ptr<TupleData> key,
+                                           MemoryAccountant* accountant) {
     const int64_t bytes_size = key->GetPhysicalByteSize();
     zetasql_base::Status status;
     if (!accountant->RequestBytes(bytes_size, &status)) {
       return status;
     }
-    return absl::WrapUnique(
-        new GroupValue(std::move(key), bytes_size, accountant));
+    return GroupValue(std::move(key), bytes_size, accountant);
   }
 
   GroupValue(const GroupValue&) = delete;
   GroupValue& operator=(const GroupValue&) = delete;
+  GroupValue(GroupValue&&) = default;
+  GroupValue& operator=(GroupValue&&) = delete;
 
   ~GroupValue() { ConsumeKey(); }
 
+  const TupleData& key() const { return *key_; }
+
   // Unregisters the key with the 'accountant' and returns it.
   std::unique_ptr<TupleData> ConsumeKey() {
     if (key_ != nullptr) {
@@ -1105,24 +1524,265 @@ class GroupValue {
         key_physical_byte_size_(key_physical_byte_size),
         accountant_(accountant) {}
 
+  // Heap allocated so that the keys of GroupMap can point into it.
   std::unique_ptr<TupleData> key_;
   int64_t key_physical_byte_size_ = 0;
   MemoryAccountant* accountant_ = nullptr;
   AccumulatorList accumulator_list_;
 };
 
-}  // namespace
+// Maps grouping keys to GroupValues. The GroupValues are stored inline in
+// open-addressing hash tables. A single INT64 or STRING key is hashed and
+// compared directly instead of as a TupleData; all other keys (including small
+// multi-column keys) use the generic TupleData representation, hashed and
+// compared with a TupleHasher for the key types.
+class GroupMap {
+ public:
+  explicit GroupMap(absl::Span<const KeyArg* const> keys)
+      : GroupMap(GetKeyShape(keys), CreateKeyHasher(keys)) {}
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> AggregateOp::CreateIterator(
-    absl::Span<const TupleData* const> params, int num_extra_slots,
-    EvaluationContext* context) const {
-  ZETASQL_ASSIGN_OR_RETURN(
-      std::unique_ptr<TupleIterator> input_iter,
-      input()->CreateIterator(params, /*num_extra_slots=*/0, context));
+  GroupMap(const GroupMap&) = delete;
+  GroupMap& operator=(const GroupMap&) = delete;
+
+  int64_t size() const {
+    return generic_map_.size() + int64_map_.size() + string_map_.size() +
+           (null_group_.has_value() ? 1 : 0);
+  }
+
+  // Pre-sizes the table for 'num_groups' groups to avoid rehashing.
+  void Reserve(int64_t num_groups) {
+    if (shape_ == KeyShape::kInt64) {
+      int64_map_.reserve(num_groups);
+    } else if (shape_ == KeyShape::kString) {
+      string_map_.reserve(num_groups);
+    } else {
+      generic_map_.reserve(num_groups);
+    }
+  }
+
+  // Returns the GroupValue for 'key', or NULL if there is none.
+  GroupValue* Find(const TupleData& key) {
+    if (shape_ == KeyShape::kGeneric) {
+      return zetasql_base::FindOrNull(generic_map_, TupleDataPtr(&key));
+    }
+    const Value& value = key.slot(0).value();
+    if (value.is_null()) {
+      return null_group_.has_value() ? &null_group_.value() : nullptr;
+    }
+    if (shape_ == KeyShape::kInt64) {
+      return zetasql_base::FindOrNull(int64_map_, value.int64_value());
+    }
+    const absl::string_view str = value.string_view_value();
+    if (str.empty()) return zetasql_base::FindOrNull(string_map_, str);
+    StringGroupCacheEntry& entry =
+        string_group_cache_[StringGroupCacheIndex(str)];
+    if (entry.data == str.data() && entry.size == str.size()) {
+      return entry.group;
+    }
+    GroupValue* group = zetasql_base::FindOrNull(string_map_, str);
+    // Only cache 'group' if 'value' shares the contents of its key, which the
+    // group keeps alive, so that no other string can have the same address.
+    if (group != nullptr &&
+        group->key().slot(0).value().string_view_value().data() ==
+            str.data()) {
+      entry = {str.data(), str.size(), group};
+    }
+    return group;
+  }
+
+  // Inserts 'group_value', whose key must not be in the map yet, and returns a
+  // pointer to its new location.
+  zetasql_base::StatusOr<GroupValue*> Insert(GroupValue group_value) {
+    const TupleData& key = group_value.key();
+    if (shape_ == KeyShape::kGeneric) {
+      auto result =
+          generic_map_.emplace(TupleDataPtr(&key), std::move(group_value));
+      ZETASQL_RET_CHECK(result.second);
+      return &result.first->second;
+    }
+    const Value& value = key.slot(0).value();
+    if (value.is_null()) {
+      ZETASQL_RET_CHECK(!null_group_.has_value());
+      null_group_.emplace(std::move(group_value));
+      return &null_group_.value();
+    }
+    if (shape_ == KeyShape::kInt64) {
+      auto result =
+          int64_map_.emplace(value.int64_value(), std::move(group_value));
+      ZETASQL_RET_CHECK(result.second);
+      return &result.first->second;
+    }
+    // The string_view points into the key owned by the GroupValue, which does
+    // not move when the table rehashes. The GroupValues themselves may move.
+    string_group_cache_.fill(StringGroupCacheEntry());
+    auto result = string_map_.emplace(value.string_view_value(),
+                                      std::move(group_value));
+    ZETASQL_RET_CHECK(result.second);
+    return &result.first->second;
+  }
+
+  // Calls 'fn' on each GroupValue in an unspecified order, and then clears the
+  // map. 'fn' may consume the GroupValue. Stops at the first error.
+  zetasql_base::Status ConsumeAll(
+      const std::function<zetasql_base::Status(GroupValue*)>& fn) {
+    zetasql_base::Status status = ConsumeAllImpl(fn);
+    generic_map_.clear();
+    int64_map_.clear();
+    string_map_.clear();
+    string_group_cache_.fill(StringGroupCacheEntry());
+    null_group_.reset();
+    return status;
+  }
+
+ private:
+  enum class KeyShape { kGeneric, kInt64, kString };
+
+  GroupMap(KeyShape shape, const std::shared_ptr<const TupleHasher>& hasher)
+      : shape_(shape),
+        generic_map_(/*bucket_count=*/0, TupleDataPtrHash{hasher},
+                     TupleDataPtrEq{hasher}) {}
+
+  // Wraps a const TupleData*, which TupleDataPtrHash and TupleDataPtrEq hash
+  // and compare as the underlying TupleData.
+  struct TupleDataPtr {
+    explicit TupleDataPtr(const TupleData* data_in) : data(data_in) {}
+
+    const TupleData* data = nullptr;
+  };
+
+  // An entry of 'string_group_cache_'.
+  struct StringGroupCacheEntry {
+    const char* data = nullptr;
+    size_t size = 0;
+    GroupValue* group = nullptr;
+  };
+
+  static constexpr int kStringGroupCacheSize = 16;
+
+  static int StringGroupCacheIndex(absl::string_view str) {
+    return (reinterpret_cast<uintptr_t>(str.data()) >> 4) &
+           (kStringGroupCacheSize - 1);
+  }
+
+  struct TupleDataPtrHash {
+    size_t operator()(const TupleDataPtr& t) const {
+      return hasher->HashCode(*t.data);
+    }
+    std::shared_ptr<const TupleHasher> hasher;
+  };
+
+  struct TupleDataPtrEq {
+    bool operator()(const TupleDataPtr& t1, const TupleDataPtr& t2) const {
+      return hasher->Equals(*t1.data, *t2.data);
+    }
+    std::shared_ptr<const TupleHasher> hasher;
+  };
+
+  static std::shared_ptr<const TupleHasher> CreateKeyHasher(
+      absl::Span<const KeyArg* const> keys) {
+    std::vector<const Type*> key_types;
+    key_types.reserve(keys.size());
+    for (const KeyArg* key : keys) {
+      key_types.push_back(key->type());
+    }
+    return std::make_shared<const TupleHasher>(key_types);
+  }
 
-  // The key is owned by the GroupValue.
-  absl::flat_hash_map<TupleDataPtr, std::unique_ptr<GroupValue>> group_map;
+  static KeyShape GetKeyShape(absl::Span<const KeyArg* const> keys) {
+    if (keys.size() == 1) {
+      if (keys[0]->type()->IsInt64()) return KeyShape::kInt64;
+      if (keys[0]->type()->IsString()) return KeyShape::kString;
+    }
+    return KeyShape::kGeneric;
+  }
+
+  zetasql_base::Status ConsumeAllImpl(
+      const std::function<zetasql_base::Status(GroupValue*)>& fn) {
+    for (auto& entry : generic_map_) {
+      ZETASQL_RETURN_IF_ERROR(fn(&entry.second));
+    }
+    for (auto& entry : int64_map_) {
+      ZETASQL_RETURN_IF_ERROR(fn(&entry.second));
+    }
+    for (auto& entry : string_map_) {
+      ZETASQL_RETURN_IF_ERROR(fn(&entry.second));
+    }
+    if (null_group_.has_value()) {
+      ZETASQL_RETURN_IF_ERROR(fn(&null_group_.value()));
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  const KeyShape shape_;
+  // Only one of these is used, depending on 'shape_'.
+  absl::flat_hash_map<TupleDataPtr, GroupValue, TupleDataPtrHash,
+                      TupleDataPtrEq>
+      generic_map_;
+  absl::flat_hash_map<int64_t, GroupValue> int64_map_;
+  absl::flat_hash_map<absl::string_view, GroupValue> string_map_;
+  // Maps the addresses of the contents of STRING keys to their groups, so that
+  // keys that share their contents with the key of a group, such as the
+  // elements of a dictionary-encoded column, are found without hashing and
+  // comparing their bytes. Direct-mapped, and cleared whenever a group is
+  // inserted.
+  std::array<StringGroupCacheEntry, kStringGroupCacheSize> string_group_cache_;
+  // The group for the NULL key if 'shape_' is not kGeneric.
+  absl::optional<GroupValue> null_group_;
+};
+
+// If grouped aggregation runs out of memory and spilling is enabled, the input
+// rows for groups that are not in memory yet are hash partitioned into
+// 2^kNumAggregateSpillPartitionBits TupleSpillFiles. Each file is aggregated
+// separately afterwards, and may itself be partitioned again, up to
+// kMaxAggregateSpillDepth times.
+constexpr int kNumAggregateSpillPartitionBits = 4;
+constexpr int kMaxAggregateSpillDepth = 4;
+
+// Returns the spill partition of 'key' at 'spill_depth'. Every level uses
+// different bits of the hash.
+int GetAggregateSpillPartition(const TupleData& key, int spill_depth) {
+  const uint64_t hash = absl::Hash<TupleData>()(key);
+  return static_cast<int>(
+      (hash >> (kNumAggregateSpillPartitionBits * spill_depth)) &
+      ((1 << kNumAggregateSpillPartitionBits) - 1));
+}
+
+// Groups the tuples from 'input_iter' by 'keys', computes 'aggregators' for
+// each group and adds the resulting tuples to 'output'. 'spill_depth' is the
+// number of times the input has been partitioned. If 'expected_num_groups' is
+// positive, the group map is pre-sized for that many groups.
+zetasql_base::Status AggregateTuples(absl::Span<const KeyArg* const> keys,
+                             absl::Span<const AggregateArg* const> aggregators,
+                             absl::Span<const TupleData* const> params,
+                             int num_extra_slots, int spill_depth,
+                             int64_t expected_num_groups,
+                             TupleIterator* input_iter,
+                             SpillableTupleSorter* output,
+                             AggregateOp::Mode mode,
+                             EvaluationContext* context) {
+  // In kFinal mode, the slots of the input holding the states to merge.
+  std::vector<int> state_slots;
+  if (mode == AggregateOp::kFinal) {
+    state_slots.reserve(aggregators.size());
+    for (const AggregateArg* aggregator : aggregators) {
+      const absl::optional<int> slot_idx =
+          input_iter->Schema().FindIndexForVariable(aggregator->variable());
+      ZETASQL_RET_CHECK(slot_idx.has_value()) << aggregator->DebugString();
+      state_slots.push_back(slot_idx.value());
+    }
+  }
+
+  GroupMap group_map(keys);
+  if (expected_num_groups > 0) {
+    group_map.Reserve(expected_num_groups);
+  }
+  // The number of groups in 'group_map' when it stopped accepting new groups.
+  int64_t max_num_groups_in_memory = 0;
+  // Once we run out of memory for new groups, the input rows for groups that
+  // are not in 'group_map' go here.
+  std::vector<std::unique_ptr<TupleSpillFile>> spill_partitions;
 
+  TupleData key_data(keys.size());
   ::zetasql_base::Status status;
   while (true) {
     const TupleData* next_input = input_iter->Next();
@@ -1131,13 +1791,13 @@ class GroupValue {
       break;
     }
 
-    // Determine the key to 'group_to_accumulator_map'.
+    // Determine the key to 'group_map'. It is only copied to the heap for new
+    // groups.
     const std::vector<const TupleData*> params_and_input_tuple =
         ConcatSpans(params, {next_input});
-    auto key_data = absl::make_unique<TupleData>(keys().size());
-    for (int i = 0; i < keys().size(); ++i) {
-      TupleSlot* slot = key_data->mutable_slot(i);
-      const KeyArg* key = keys()[i];
+    for (int i = 0; i < keys.size(); ++i) {
+      TupleSlot* slot = key_data.mutable_slot(i);
+      const KeyArg* key = keys[i];
       ::zetasql_base::Status status;
       if (!key->value_expr()->EvalSimple(params_and_input_tuple, context, slot,
                                          &status)) {
@@ -1145,41 +1805,63 @@ class GroupValue {
       }
     }
 
-    // Look up the value in 'group_to_accumulator_map', initializing a new one
-    // if necessary.
+    // Look up the value in 'group_map', initializing a new one if necessary.
     AccumulatorList* accumulators = nullptr;
-    std::unique_ptr<GroupValue>* found_group_value =
-        zetasql_base::FindOrNull(group_map, TupleDataPtr(key_data.get()));
+    GroupValue* found_group_value = group_map.Find(key_data);
     if (found_group_value == nullptr) {
+      if (!spill_partitions.empty()) {
+        ZETASQL_RETURN_IF_ERROR(
+            spill_partitions[GetAggregateSpillPartition(key_data, spill_depth)]
+                ->Write(*next_input));
+        continue;
+      }
+
       // Create the new GroupValue.
-      const TupleData* key_data_ptr = key_data.get();
-      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<GroupValue> inserted_group_value,
-                       GroupValue::Create(std::move(key_data),
-                                          context->memory_accountant()));
+      zetasql_base::StatusOr<GroupValue> status_or_group_value = GroupValue::Create(
+          absl::make_unique<TupleData>(key_data), context->memory_accountant());
+      if (!status_or_group_value.ok()) {
+        if (context->options().spill_directory.empty() || keys.empty() ||
+            !ShouldSpill(status_or_group_value.status(), *context) ||
+            spill_depth >= kMaxAggregateSpillDepth) {
+          return status_or_group_value.status();
+        }
+        max_num_groups_in_memory = group_map.size();
+        spill_partitions.resize(1 << kNumAggregateSpillPartitionBits);
+        for (std::unique_ptr<TupleSpillFile>& partition : spill_partitions) {
+          ZETASQL_ASSIGN_OR_RETURN(partition, TupleSpillFile::Create(context));
+        }
+        ZETASQL_RETURN_IF_ERROR(
+            spill_partitions[GetAggregateSpillPartition(key_data, spill_depth)]
+                ->Write(*next_input));
+        continue;
+      }
+      ZETASQL_ASSIGN_OR_RETURN(
+          GroupValue * inserted_group_value,
+          group_map.Insert(std::move(status_or_group_value).ValueOrDie()));
 
       // Initialize the accumulators.
       accumulators = inserted_group_value->mutable_accumulator_list();
-      accumulators->reserve(aggregators().size());
-      for (const AggregateArg* aggregator : aggregators()) {
+      accumulators->reserve(aggregators.size());
+      for (const AggregateArg* aggregator : aggregators) {
         std::pair<std::unique_ptr<AggregateArgAccumulator>, bool>
             accumulator_and_stop_bit;
         ZETASQL_ASSIGN_OR_RETURN(accumulator_and_stop_bit.first,
                          aggregator->CreateAccumulator(params, context));
         accumulators->push_back(std::move(accumulator_and_stop_bit));
       }
-
-      // Insert the new GroupValue.
-      ZETASQL_RET_CHECK(group_map
-                    .emplace(TupleDataPtr(key_data_ptr),
-                             std::move(inserted_group_value))
-                    .second);
     } else {
-      accumulators = (*found_group_value)->mutable_accumulator_list();
-      key_data.reset();
+      accumulators = found_group_value->mutable_accumulator_list();
     }
 
     // Accumulate.
-    ZETASQL_RET_CHECK_EQ(accumulators->size(), aggregators().size());
+    ZETASQL_RET_CHECK_EQ(accumulators->size(), aggregators.size());
+    if (mode == AggregateOp::kFinal) {
+      for (int i = 0; i < accumulators->size(); ++i) {
+        ZETASQL_RETURN_IF_ERROR((*accumulators)[i].first->Merge(
+            next_input->slot(state_slots[i]).value()));
+      }
+      continue;
+    }
     bool all_accumulators_stopped = true;
     for (auto& accumulator_and_stop_bit : *accumulators) {
       bool& stop_bit = accumulator_and_stop_bit.second;
@@ -1191,19 +1873,20 @@ class GroupValue {
       if (!stop_bit) all_accumulators_stopped = false;
     }
 
-    if (all_accumulators_stopped && keys().empty()) {
+    if (all_accumulators_stopped && keys.empty()) {
       // We are doing full aggregation and all the accumulators have stopped, we
       // can stop reading the input.
       break;
     }
   }
 
+  EvaluationStats* stats = context->mutable_stats();
+  stats->peak_num_groups =
+      std::max(stats->peak_num_groups, group_map.size());
+  context->RecordHashTableSize(group_map.size());
+
   // Build the tuples that the iterator should return.
-  auto tuples = absl::make_unique<TupleDataDeque>(context->memory_accountant());
-  for (auto& entry : group_map) {
-    // Destruction of the 'group_value' will clear all memory used by its
-    // members.
-    std::unique_ptr<GroupValue> group_value = std::move(entry.second);
+  auto finalize_group = [&](GroupValue* group_value) -> zetasql_base::Status {
     AccumulatorList& accumulators = *group_value->mutable_accumulator_list();
 
     std::unique_ptr<TupleData> tuple = group_value->ConsumeKey();
@@ -1211,30 +1894,99 @@ class GroupValue {
 
     for (int i = 0; i < accumulators.size(); ++i) {
       AggregateArgAccumulator& accumulator = *accumulators[i].first;
-      ZETASQL_ASSIGN_OR_RETURN(Value value, accumulator.GetFinalResult(
-                                        /*inputs_in_defined_order=*/false));
-      tuple->mutable_slot(keys().size() + i)->SetValue(value);
+      Value value;
+      if (mode == AggregateOp::kPartial) {
+        ZETASQL_ASSIGN_OR_RETURN(value, accumulator.SerializeState());
+      } else {
+        ZETASQL_ASSIGN_OR_RETURN(value, accumulator.GetFinalResult(
+                                    /*inputs_in_defined_order=*/false));
+      }
+      tuple->mutable_slot(keys.size() + i)->SetValue(value);
     }
     // This can free up considerable memory. E.g., for STRING_AGG.
     accumulators.clear();
 
-    if (!tuples->PushBack(std::move(tuple), &status)) {
+    zetasql_base::Status status;
+    if (!output->PushBack(std::move(tuple), &status)) {
       return status;
     }
+    return zetasql_base::OkStatus();
+  };
+  ZETASQL_RETURN_IF_ERROR(group_map.ConsumeAll(finalize_group));
+
+  // Now that all the groups in memory are done, aggregate the spilled rows one
+  // partition at a time. No group is in more than one partition.
+  for (std::unique_ptr<TupleSpillFile>& partition : spill_partitions) {
+    // Make as much memory available as possible for the groups in the
+    // partition.
+    ZETASQL_RETURN_IF_ERROR(output->Spill());
+    ZETASQL_RETURN_IF_ERROR(partition->FinishWriting());
+    const int64_t partition_num_tuples = partition->num_tuples();
+    TupleSpillFileIterator partition_iter(
+        absl::make_unique<TupleSchema>(input_iter->Schema().variables()),
+        std::move(partition));
+    // A partition usually has fewer groups than fit in memory, and never has
+    // more groups than tuples.
+    const int64_t expected_partition_groups =
+        std::min(partition_num_tuples, max_num_groups_in_memory);
+    ZETASQL_RETURN_IF_ERROR(AggregateTuples(
+        keys, aggregators, params, num_extra_slots, spill_depth + 1,
+        expected_partition_groups, &partition_iter, output, mode, context));
   }
+  return zetasql_base::OkStatus();
+}
 
+}  // namespace
+
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> AggregateOp::CreateIteratorInternal(
+    absl::Span<const TupleData* const> params, int num_extra_slots,
+    EvaluationContext* context) const {
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<TupleIterator> input_iter,
+      input()->CreateIterator(params, /*num_extra_slots=*/0, context));
+
+  // The tuples are sorted by key as described above.
+  //
+  // TODO: Consider eliminating this sort. The downside is that
+  // AggregationTupleIterator will then give a non-deterministic ordering of
+  // groups, which can break the reference implementation compliance tests
+  // (which are based on purely textual matching). It can also break some user
+  // tests.
+  std::vector<int> slots_for_keys;
+  slots_for_keys.reserve(keys().size());
+  for (int i = 0; i < keys().size(); ++i) {
+    slots_for_keys.push_back(i);
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<TupleComparator> tuple_comparator,
+      TupleComparator::Create(keys(), slots_for_keys, params, context));
+  auto tuples = absl::make_unique<SpillableTupleSorter>(
+      tuple_comparator.get(), /*use_stable_sort=*/false, context);
+
+  ZETASQL_RETURN_IF_ERROR(AggregateTuples(
+      keys(), aggregators(), params, num_extra_slots, /*spill_depth=*/0,
+      /*expected_num_groups=*/0, input_iter.get(), tuples.get(), mode(),
+      context));
+
+  ::zetasql_base::Status status;
   if (tuples->IsEmpty()) {
     if (keys().empty()) {
       // We are doing full aggregation over empty input, so we must compute
-      // trivial values for the aggregators.
+      // trivial values (or in kPartial mode, empty states) for the
+      // aggregators.
       auto tuple =
           absl::make_unique<TupleData>(aggregators().size() + num_extra_slots);
       for (int i = 0; i < aggregators().size(); ++i) {
         const AggregateArg* aggregator = aggregators()[i];
         ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<AggregateArgAccumulator> accumulator,
                          aggregator->CreateAccumulator(params, context));
-        ZETASQL_ASSIGN_OR_RETURN(Value value, accumulator->GetFinalResult(
-                                          /*inputs_in_defined_order=*/true));
+        Value value;
+        if (mode() == kPartial) {
+          ZETASQL_ASSIGN_OR_RETURN(value, accumulator->SerializeState());
+        } else {
+          ZETASQL_ASSIGN_OR_RETURN(value, accumulator->GetFinalResult(
+                                      /*inputs_in_defined_order=*/true));
+        }
         tuple->mutable_slot(i)->SetValue(value);
       }
       if (!tuples->PushBack(std::move(tuple), &status)) {
@@ -1248,30 +2000,14 @@ class GroupValue {
       }
     }
   }
-
-  // Sort the tuples by key as described above.
-  //
-  // TODO: Consider eliminating this sort. The downside is that
-  // AggregationTupleIterator will then give a non-deterministic ordering of
-  // groups, which can break the reference implementation compliance tests
-  // (which are based on purely textual matching). It can also break some user
-  // tests.
-  std::vector<int> slots_for_keys;
-  slots_for_keys.reserve(keys().size());
-  for (int i = 0; i < keys().size(); ++i) {
-    slots_for_keys.push_back(i);
-  }
-  ZETASQL_ASSIGN_OR_RETURN(
-      std::unique_ptr<TupleComparator> tuple_comparator,
-      TupleComparator::Create(keys(), slots_for_keys, params, context));
-  tuples->Sort(*tuple_comparator, /*use_stable_sort=*/false);
+  ZETASQL_RETURN_IF_ERROR(tuples->Finish());
 
   auto input_schema =
       absl::make_unique<TupleSchema>(input_iter->Schema().variables());
   std::unique_ptr<TupleIterator> iter =
-      absl::make_unique<AggregateTupleIterator>(params, std::move(tuples),
-                                                std::move(input_iter),
-                                                CreateOutputSchema(), context);
+      absl::make_unique<AggregateTupleIterator>(
+          params, std::move(tuple_comparator), std::move(tuples),
+          std::move(input_iter), CreateOutputSchema(), context);
   return MaybeReorder(std::move(iter), context);
 }
 
@@ -1294,7 +2030,13 @@ std::string AggregateOp::IteratorDebugString() const {
 
 std::string AggregateOp::DebugInternal(const std::string& indent,
                                        bool verbose) const {
-  return absl::StrCat("AggregateOp(",
+  const char* name = "AggregateOp(";
+  if (mode_ == kPartial) {
+    name = "PartialAggregateOp(";
+  } else if (mode_ == kFinal) {
+    name = "FinalAggregateOp(";
+  }
+  return absl::StrCat(name,
                       ArgDebugString({"keys", "aggregators", "input"},
                                      {kN, kN, k1}, indent, verbose),
                       ")");
@@ -1302,7 +2044,8 @@ std::string AggregateOp::DebugInternal(const std::string& indent,
 
 AggregateOp::AggregateOp(std::vector<std::unique_ptr<KeyArg>> keys,
                          std::vector<std::unique_ptr<AggregateArg>> aggregators,
-                         std::unique_ptr<RelationalOp> input) {
+                         std::unique_ptr<RelationalOp> input, Mode mode)
+    : mode_(mode) {
   SetArgs<KeyArg>(kKey, std::move(keys));
   SetArgs<AggregateArg>(kAggregator, std::move(aggregators));
   SetArg(kInput, absl::make_unique<RelationalArg>(std::move(input)));
@@ -16,6 +16,7 @@
 
 // Tests of aggregate function code.
 
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
@@ -41,6 +42,7 @@
 #include "gtest/gtest.h"
 #include <cstdint>
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "zetasql/base/status.h"
 #include "absl/strings/str_join.h"
 #include "absl/types/optional.h"
@@ -520,6 +522,117 @@ TEST(EvalAggTest, SumNumericOverflow) {
   EXPECT_TRUE(context.IsDeterministicOutput());
 }
 
+// Returns the result of accumulating values[0, split) and values[split, end)
+// into two accumulators and merging their states into a third one.
+static ::zetasql_base::StatusOr<Value> EvalAggWithMerge(
+    const BuiltinAggregateFunction& agg, absl::Span<const Value> values,
+    int split, EvaluationContext* context) {
+  std::vector<Value> states;
+  for (absl::Span<const Value> part :
+       {values.subspan(0, split), values.subspan(split)}) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<AggregateAccumulator> accumulator,
+                     agg.CreateAccumulator(/*args=*/{}, context));
+    bool stop_accumulation;
+    ::zetasql_base::Status status;
+    for (const Value& value : part) {
+      if (!accumulator->Accumulate(value, &stop_accumulation, &status)) {
+        return status;
+      }
+    }
+    ZETASQL_ASSIGN_OR_RETURN(Value state, accumulator->SerializeState());
+    states.push_back(std::move(state));
+  }
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<AggregateAccumulator> accumulator,
+                   agg.CreateAccumulator(/*args=*/{}, context));
+  ZETASQL_RETURN_IF_ERROR(accumulator->DeserializeState(states[0]));
+  ZETASQL_RETURN_IF_ERROR(accumulator->Merge(states[1]));
+  // NULL states are ignored.
+  ZETASQL_RETURN_IF_ERROR(accumulator->Merge(NullBytes()));
+  return accumulator->GetFinalResult(/*inputs_in_defined_order=*/false);
+}
+
+TEST(EvalAggTest, MergePartialStates) {
+  const int64_t int64max = std::numeric_limits<int64_t>::max();
+  const uint64_t uint64max = std::numeric_limits<uint64_t>::max();
+  const NumericValue numeric_max_minus_one =
+      NumericValue::MaxValue().Subtract(NumericValue(1)).ValueOrDie();
+  const std::vector<AggregateFunctionTemplate> templates = {
+      {FunctionKind::kCount, {Int64(1), NullInt64(), Int64(2)}, Int64(2)},
+      {FunctionKind::kCountIf,
+       {Bool(true), Bool(false), NullBool(), Bool(true)},
+       Int64(2)},
+      {FunctionKind::kSum,
+       {Int64(int64max), Int64(1), Int64(-2)},
+       Int64(int64max - 1)},
+      {FunctionKind::kSum,
+       {Uint64(uint64max), Uint64(1), NullUint64()},
+       NullUint64()},
+      {FunctionKind::kSum,
+       {Double(1e308), Double(1e308), Double(-1e308), Double(-1e308),
+        Double(0.5), NullDouble()},
+       Double(0.5)},
+      {FunctionKind::kSum,
+       {Numeric(NumericValue::MaxValue()), Numeric(1), Numeric(-2)},
+       Numeric(numeric_max_minus_one)},
+      {FunctionKind::kAvg,
+       {Int64(2), Int64(4), NullInt64(), Int64(6), Int64(8)},
+       Double(5)},
+      {FunctionKind::kAvg, {Double(-1), Double(1), Double(3)}, Double(1)},
+      {FunctionKind::kAvg,
+       {Numeric(1), Numeric(2)},
+       Numeric(NumericValue::FromDouble(1.5).ValueOrDie())},
+      {FunctionKind::kMin, {Int64(3), NullInt64(), Int64(1)}, Int64(1)},
+      {FunctionKind::kMax, {String("a"), String("c"), String("b")},
+       String("c")},
+      {FunctionKind::kArrayAgg,
+       {Int64(1), NullInt64(), Int64(2)},
+       Array({Int64(1), NullInt64(), Int64(2)})},
+      {FunctionKind::kStringAgg,
+       {String("a"), NullString(), String("b"), String("c")},
+       String("a,b,c")},
+  };
+  for (const AggregateFunctionTemplate& t : templates) {
+    BuiltinAggregateFunction fct(t.kind, t.result.type(),
+                                 /*num_input_fields=*/1, t.argument_type(),
+                                 /*ignores_null=*/t.kind !=
+                                     FunctionKind::kArrayAgg);
+    ASSERT_TRUE(fct.SupportsPartialAggregation()) << fct.debug_name();
+    for (int split = 0; split <= t.values.size(); ++split) {
+      EvaluationContext context((EvaluationOptions()));
+      const ::zetasql_base::StatusOr<Value> expected =
+          EvalAgg(fct, t.values, &context);
+      const ::zetasql_base::StatusOr<Value> result =
+          EvalAggWithMerge(fct, t.values, split, &context);
+      // A NULL result stands for an overflow error, which the merged
+      // accumulator must report too.
+      if (t.result.is_null()) {
+        EXPECT_THAT(expected, StatusIs(zetasql_base::StatusCode::kOutOfRange));
+        EXPECT_THAT(result, StatusIs(zetasql_base::StatusCode::kOutOfRange))
+            << fct.debug_name() << " split at " << split;
+        continue;
+      }
+      EXPECT_THAT(expected, IsOkAndHolds(t.result)) << fct.debug_name();
+      EXPECT_THAT(result, IsOkAndHolds(t.result))
+          << fct.debug_name() << " split at " << split;
+    }
+  }
+}
+
+TEST(EvalAggTest, MergeInvalidState) {
+  BuiltinAggregateFunction fct(FunctionKind::kSum, Int64Type(),
+                               /*num_input_fields=*/1, Int64Type());
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<AggregateAccumulator> accumulator,
+      fct.CreateAccumulator(/*args=*/{}, &context));
+  EXPECT_THAT(accumulator->Merge(Bytes("not a state")),
+              StatusIs(zetasql_base::StatusCode::kInvalidArgument));
+
+  BuiltinAggregateFunction any_value(FunctionKind::kAnyValue, Int64Type(),
+                                     /*num_input_fields=*/1, Int64Type());
+  EXPECT_FALSE(any_value.SupportsPartialAggregation());
+}
+
 TEST(OrderPreservationTest, GroupByAggregate) {
   TypeFactory type_factory;
   VariableId a("a"), b("b"), c1("c1"), c2("c2"), k("k"), n("n"), d("d");
@@ -787,6 +900,239 @@ TEST(CreateIteratorTest, AggregateAll) {
                HasSubstr("Out of memory")));
 }
 
+// Single INT64 and STRING keys have their own group map representations.
+TEST(CreateIteratorTest, AggregateSingleColumnKeys) {
+  VariableId a("a"), k("k"), c("c");
+
+  // In each list, the first key is less than the third one.
+  const std::vector<std::vector<Value>> keys_list = {
+      {Int64(1), NullInt64(), Int64(2), Int64(1), NullInt64()},
+      {String("a"), NullString(), String("b"), String("a"), NullString()},
+      {Bool(false), NullBool(), Bool(true), Bool(false), NullBool()}};
+  for (const std::vector<Value>& key_values : keys_list) {
+    const Type* key_type = key_values[0].type();
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, key_type));
+
+    std::vector<std::unique_ptr<KeyArg>> keys;
+    keys.push_back(absl::make_unique<KeyArg>(k, std::move(deref_a)));
+
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        auto arg_c,
+        AggregateArg::Create(c, absl::make_unique<BuiltinAggregateFunction>(
+                                    FunctionKind::kCount, Int64Type(),
+                                    /*num_input_fields=*/0, EmptyStructType())));
+    std::vector<std::unique_ptr<AggregateArg>> aggregators;
+    aggregators.push_back(std::move(arg_c));
+
+    std::vector<TupleData> input_tuples;
+    for (const Value& value : key_values) {
+      input_tuples.push_back(CreateTestTupleData({value}));
+    }
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        auto aggregate_op,
+        AggregateOp::Create(std::move(keys), std::move(aggregators),
+                            absl::make_unique<TestRelationalOp>(
+                                std::vector<VariableId>{a}, input_tuples,
+                                /*preserves_order=*/true)));
+    ZETASQL_ASSERT_OK(aggregate_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+    EvaluationContext context((EvaluationOptions()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<TupleIterator> iter,
+        aggregate_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                     &context));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    EXPECT_EQ(context.stats().peak_num_groups, 3) << key_type->DebugString();
+    // NULL sorts first.
+    ASSERT_EQ(data.size(), 3) << key_type->DebugString();
+    EXPECT_THAT(data[0].slots(), ElementsAre(IsTupleSlotWith(key_values[1], _),
+                                             IsTupleSlotWith(Int64(2), _)));
+    EXPECT_THAT(data[1].slots(), ElementsAre(IsTupleSlotWith(key_values[0], _),
+                                             IsTupleSlotWith(Int64(2), _)));
+    EXPECT_THAT(data[2].slots(), ElementsAre(IsTupleSlotWith(key_values[2], _),
+                                             IsTupleSlotWith(Int64(1), _)));
+  }
+}
+
+TEST(CreateIteratorTest, AggregateSpillsToDisk) {
+  VariableId a("a"), b("b"), k("k"), c("c");
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+
+  std::vector<std::unique_ptr<KeyArg>> keys;
+  keys.push_back(absl::make_unique<KeyArg>(k, std::move(deref_a)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_b, DerefExpr::Create(b, Int64Type()));
+
+  std::vector<std::unique_ptr<ValueExpr>> args_for_c;
+  args_for_c.push_back(std::move(deref_b));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto arg_c,
+      AggregateArg::Create(c,
+                           absl::make_unique<BuiltinAggregateFunction>(
+                               FunctionKind::kCount, Int64Type(),
+                               /*num_input_fields=*/1, Int64Type()),
+                           std::move(args_for_c)));
+
+  std::vector<std::unique_ptr<AggregateArg>> aggregators;
+  aggregators.push_back(std::move(arg_c));
+
+  // 1000 groups with three rows each.
+  std::vector<TupleData> input_tuples;
+  for (int64_t i = 0; i < 3000; ++i) {
+    input_tuples.push_back(CreateTestTupleData({Int64(i % 1000), Int64(i)}));
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto aggregate_op,
+      AggregateOp::Create(std::move(keys), std::move(aggregators),
+                          absl::make_unique<TestRelationalOp>(
+                              std::vector<VariableId>{a, b}, input_tuples,
+                              /*preserves_order=*/true)));
+  ZETASQL_ASSERT_OK(aggregate_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  // Without a spill directory, the aggregation runs out of memory.
+  EvaluationOptions options =
+      GetIntermediateMemoryEvaluationOptions(/*total_bytes=*/10000);
+  EvaluationContext memory_context(options);
+  EXPECT_THAT(aggregate_op->CreateIterator(
+                  EmptyParams(), /*num_extra_slots=*/0, &memory_context),
+              StatusIs(zetasql_base::StatusCode::kResourceExhausted,
+                       HasSubstr("Out of memory")));
+
+  options.spill_directory = testing::TempDir();
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      aggregate_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                   &context));
+  EXPECT_GT(context.stats().num_spill_files, 0);
+  EXPECT_GT(context.stats().peak_num_groups, 0);
+  EXPECT_LT(context.stats().peak_num_groups, 1000);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  // The groups are still sorted by key.
+  ASSERT_EQ(data.size(), 1000);
+  for (int i = 0; i < data.size(); ++i) {
+    EXPECT_THAT(data[i].slots(), ElementsAre(IsTupleSlotWith(Int64(i), _),
+                                             IsTupleSlotWith(Int64(3), _)))
+        << i;
+  }
+}
+
+// DISTINCT aggregates over INT64 and STRING use compact hash sets, and
+// APPROX_COUNT_DISTINCT may be estimated with a sketch.
+TEST(CreateIteratorTest, AggregateDistinct) {
+  for (const bool use_sketches : {false, true}) {
+    for (const Type* type : {Int64Type(), StringType(), DoubleType()}) {
+      VariableId a("a"), c1("c1"), c2("c2"), c3("c3");
+      std::vector<std::unique_ptr<AggregateArg>> aggregators;
+      for (const auto& variable_and_kind :
+           {std::make_pair(c1, FunctionKind::kCount),
+            std::make_pair(c2, FunctionKind::kApproxCountDistinct),
+            std::make_pair(c3, FunctionKind::kArrayAgg)}) {
+        const bool is_array_agg =
+            variable_and_kind.second == FunctionKind::kArrayAgg;
+        const Type* output_type =
+            is_array_agg ? MakeArrayType(type) : Int64Type();
+        ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, type));
+        std::vector<std::unique_ptr<ValueExpr>> args;
+        args.push_back(std::move(deref_a));
+        ZETASQL_ASSERT_OK_AND_ASSIGN(
+            auto arg,
+            AggregateArg::Create(
+                variable_and_kind.first,
+                absl::make_unique<BuiltinAggregateFunction>(
+                    variable_and_kind.second, output_type,
+                    /*num_input_fields=*/1, type,
+                    /*ignores_null=*/!is_array_agg),
+                std::move(args), AggregateArg::kDistinct));
+        aggregators.push_back(std::move(arg));
+      }
+
+      // 100 distinct values and a NULL, each repeated three times.
+      std::vector<TupleData> input_tuples;
+      for (int i = 0; i < 303; ++i) {
+        const int64_t n = i % 101;
+        Value value;
+        if (n == 100) {
+          value = Value::Null(type);
+        } else if (type->IsInt64()) {
+          value = Int64(n);
+        } else if (type->IsString()) {
+          value = String(absl::StrCat("value", n));
+        } else {
+          value = Double(n);
+        }
+        input_tuples.push_back(CreateTestTupleData({value}));
+      }
+      ZETASQL_ASSERT_OK_AND_ASSIGN(
+          auto aggregate_op,
+          AggregateOp::Create(/*keys=*/{}, std::move(aggregators),
+                              absl::make_unique<TestRelationalOp>(
+                                  std::vector<VariableId>{a}, input_tuples,
+                                  /*preserves_order=*/true)));
+      ZETASQL_ASSERT_OK(aggregate_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+      EvaluationOptions options;
+      options.use_sketches_for_approx_count_distinct = use_sketches;
+      EvaluationContext context(options);
+      ZETASQL_ASSERT_OK_AND_ASSIGN(
+          std::unique_ptr<TupleIterator> iter,
+          aggregate_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                       &context));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                           ReadFromTupleIterator(iter.get()));
+      ASSERT_EQ(data.size(), 1);
+      EXPECT_EQ(data[0].slot(0).value(), Int64(100)) << type->DebugString();
+      // Linear counting is exact for so few values.
+      EXPECT_EQ(data[0].slot(1).value(), Int64(100)) << type->DebugString();
+      // ARRAY_AGG(DISTINCT) keeps one NULL.
+      EXPECT_EQ(data[0].slot(2).value().num_elements(), 101)
+          << type->DebugString();
+    }
+  }
+}
+
+// The compact DISTINCT sets are charged to the memory accountant.
+TEST(CreateIteratorTest, AggregateDistinctOutOfMemory) {
+  VariableId a("a"), c("c");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> args;
+  args.push_back(std::move(deref_a));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto arg_c,
+      AggregateArg::Create(c,
+                           absl::make_unique<BuiltinAggregateFunction>(
+                               FunctionKind::kCount, Int64Type(),
+                               /*num_input_fields=*/1, Int64Type()),
+                           std::move(args), AggregateArg::kDistinct));
+  std::vector<std::unique_ptr<AggregateArg>> aggregators;
+  aggregators.push_back(std::move(arg_c));
+
+  std::vector<TupleData> input_tuples;
+  for (int64_t i = 0; i < 10000; ++i) {
+    input_tuples.push_back(CreateTestTupleData({Int64(i)}));
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto aggregate_op,
+      AggregateOp::Create(/*keys=*/{}, std::move(aggregators),
+                          absl::make_unique<TestRelationalOp>(
+                              std::vector<VariableId>{a}, input_tuples,
+                              /*preserves_order=*/true)));
+  ZETASQL_ASSERT_OK(aggregate_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  EvaluationContext context(
+      GetIntermediateMemoryEvaluationOptions(/*total_bytes=*/50000));
+  EXPECT_THAT(aggregate_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                           &context),
+              StatusIs(zetasql_base::StatusCode::kResourceExhausted,
+                       HasSubstr("Out of memory")));
+  // All the memory is returned.
+  EXPECT_EQ(context.memory_accountant()->remaining_bytes(), 50000);
+}
+
 TEST(CreateIteratorTest, AggregateOrderBy) {
   TypeFactory type_factory;
   VariableId a("a"), b("b"), c("c"), d("d"), e("e"), f("f"), g("g"), h("h"),
@@ -1339,6 +1685,33 @@ TEST(CreateIteratorTest, AggregateLimit) {
   EXPECT_EQ(data[0].num_slots(), 8);
   EXPECT_EQ(data[1].num_slots(), 8);
 
+  // TopNAccumulator returns the same values, and says that they are ordered.
+  EvaluationOptions top_n_options;
+  top_n_options.use_top_n_accumulator_when_possible = true;
+  EvaluationContext top_n_context(top_n_options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      iter, aggregate_op->CreateIterator({&params_data}, /*num_extra_slots=*/0,
+                                         &top_n_context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(data, ReadFromTupleIterator(iter.get()));
+  EXPECT_TRUE(top_n_context.used_top_n_accumulator());
+  ASSERT_EQ(data.size(), 2);
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[0]).DebugString(),
+            "<k:0,"
+            "d:NULL,"
+            "e:[1, 1],"
+            "f:[1, 1, 2],"
+            "g:NULL,"
+            "h:[\"z\", \"y\"],"
+            "i:[\"z\", \"y\", \"x\"]>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[1]).DebugString(),
+            "<k:1,"
+            "d:NULL,"
+            "e:[NULL, NULL],"
+            "f:[NULL, NULL, 10, 10],"
+            "g:NULL,"
+            "h:[\"c\", \"b\"],"
+            "i:[\"c\", \"b\", \"a\", NULL]>");
+
   // Do it again with cancellation.
   context.ClearDeadlineAndCancellationState();
   ZETASQL_ASSERT_OK_AND_ASSIGN(
@@ -1502,5 +1875,147 @@ TEST(CreateIteratorTest, AggregateHaving) {
                HasSubstr("Out of memory")));
 }
 
+// Returns COUNT(*), SUM(b) and COUNT(DISTINCT b) for the variables 'outputs'.
+static ::zetasql_base::StatusOr<std::vector<std::unique_ptr<AggregateArg>>>
+CreatePartialAggregators(const VariableId& b,
+                         const std::vector<VariableId>& outputs) {
+  std::vector<std::unique_ptr<AggregateArg>> aggregators;
+  ZETASQL_ASSIGN_OR_RETURN(
+      auto count_star,
+      AggregateArg::Create(outputs[0],
+                           absl::make_unique<BuiltinAggregateFunction>(
+                               FunctionKind::kCount, Int64Type(),
+                               /*num_input_fields=*/0, EmptyStructType())));
+  aggregators.push_back(std::move(count_star));
+  for (const AggregateArg::Distinctness distinct :
+       {AggregateArg::kAll, AggregateArg::kDistinct}) {
+    const FunctionKind kind = distinct == AggregateArg::kAll
+                                  ? FunctionKind::kSum
+                                  : FunctionKind::kCount;
+    ZETASQL_ASSIGN_OR_RETURN(auto deref_b, DerefExpr::Create(b, Int64Type()));
+    std::vector<std::unique_ptr<ValueExpr>> args;
+    args.push_back(std::move(deref_b));
+    ZETASQL_ASSIGN_OR_RETURN(
+        auto arg,
+        AggregateArg::Create(
+            outputs[aggregators.size()],
+            absl::make_unique<BuiltinAggregateFunction>(
+                kind, Int64Type(), /*num_input_fields=*/1, Int64Type()),
+            std::move(args), distinct));
+    aggregators.push_back(std::move(arg));
+  }
+  return aggregators;
+}
+
+// Runs a kPartial AggregateOp over each of two shards and a kFinal
+// AggregateOp over their outputs, and checks that the result matches a
+// kComplete AggregateOp over all the rows.
+TEST(CreateIteratorTest, AggregatePartialAndFinal) {
+  VariableId a("a"), b("b"), k("k"), c1("c1"), c2("c2"), c3("c3");
+  const std::vector<VariableId> outputs = {c1, c2, c3};
+
+  std::vector<std::vector<TupleData>> shards(2);
+  std::vector<TupleData> all_tuples;
+  for (int i = 0; i < 40; ++i) {
+    const Value b_value = (i % 9 == 0) ? NullInt64() : Int64(i % 7);
+    TupleData tuple = CreateTestTupleData({Int64(i % 3), b_value});
+    shards[i < 25 ? 0 : 1].push_back(tuple);
+    all_tuples.push_back(tuple);
+  }
+
+  auto run = [&](AggregateOp::Mode mode, const std::vector<VariableId>& vars,
+                 const std::vector<TupleData>& tuples,
+                 std::vector<TupleData>* output) -> ::zetasql_base::Status {
+    ZETASQL_ASSIGN_OR_RETURN(auto deref_key,
+                     DerefExpr::Create(vars[0], Int64Type()));
+    std::vector<std::unique_ptr<KeyArg>> keys;
+    keys.push_back(absl::make_unique<KeyArg>(k, std::move(deref_key)));
+    ZETASQL_ASSIGN_OR_RETURN(auto aggregators,
+                     CreatePartialAggregators(b, outputs));
+    ZETASQL_ASSIGN_OR_RETURN(
+        auto aggregate_op,
+        AggregateOp::Create(std::move(keys), std::move(aggregators),
+                            absl::make_unique<TestRelationalOp>(
+                                vars, tuples, /*preserves_order=*/true),
+                            mode));
+    ZETASQL_RETURN_IF_ERROR(
+        aggregate_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+    EvaluationContext context((EvaluationOptions()));
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<TupleIterator> iter,
+        aggregate_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                     &context));
+    ZETASQL_ASSIGN_OR_RETURN(*output, ReadFromTupleIterator(iter.get()));
+    return ::zetasql_base::OkStatus();
+  };
+
+  std::vector<TupleData> states;
+  for (const std::vector<TupleData>& shard : shards) {
+    std::vector<TupleData> shard_states;
+    ZETASQL_ASSERT_OK(run(AggregateOp::kPartial, {a, b}, shard, &shard_states));
+    ASSERT_EQ(shard_states.size(), 3);
+    for (const TupleData& tuple : shard_states) {
+      EXPECT_TRUE(tuple.slot(1).value().type()->IsBytes());
+      states.push_back(tuple);
+    }
+  }
+
+  std::vector<TupleData> result;
+  ZETASQL_ASSERT_OK(run(AggregateOp::kFinal, {k, c1, c2, c3}, states, &result));
+  std::vector<TupleData> expected;
+  ZETASQL_ASSERT_OK(run(AggregateOp::kComplete, {a, b}, all_tuples, &expected));
+  ASSERT_EQ(result.size(), 3);
+  ASSERT_EQ(expected.size(), 3);
+  for (int i = 0; i < expected.size(); ++i) {
+    for (int j = 0; j < 4; ++j) {
+      EXPECT_EQ(result[i].slot(j).value(), expected[i].slot(j).value())
+          << i << " " << j;
+    }
+  }
+  // Every group has seven distinct non-NULL values.
+  EXPECT_EQ(expected[0].slot(3).value(), Int64(7));
+}
+
+TEST(CreateIteratorTest, PartialAggregateRequiresMergeableAggregators) {
+  VariableId a("a"), c("c");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> args;
+  args.push_back(std::move(deref_a));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto arg,
+      AggregateArg::Create(c,
+                           absl::make_unique<BuiltinAggregateFunction>(
+                               FunctionKind::kAnyValue, Int64Type(),
+                               /*num_input_fields=*/1, Int64Type()),
+                           std::move(args)));
+  EXPECT_FALSE(arg->SupportsPartialAggregation());
+  std::vector<std::unique_ptr<AggregateArg>> aggregators;
+  aggregators.push_back(std::move(arg));
+  EXPECT_THAT(AggregateOp::Create(/*keys=*/{}, std::move(aggregators),
+                                  absl::make_unique<TestRelationalOp>(
+                                      std::vector<VariableId>{a},
+                                      std::vector<TupleData>(),
+                                      /*preserves_order=*/true),
+                                  AggregateOp::kPartial),
+              StatusIs(zetasql_base::StatusCode::kUnimplemented));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto mergeable_aggregators,
+                       CreatePartialAggregators(a, {c, VariableId("d"),
+                                                    VariableId("e")}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto aggregate_op,
+      AggregateOp::Create(/*keys=*/{}, std::move(mergeable_aggregators),
+                          absl::make_unique<TestRelationalOp>(
+                              std::vector<VariableId>{a},
+                              std::vector<TupleData>(),
+                              /*preserves_order=*/true),
+                          AggregateOp::kFinal));
+  EXPECT_EQ(aggregate_op->mode(), AggregateOp::kFinal);
+  EXPECT_THAT(aggregate_op->DebugString(), HasSubstr("FinalAggregateOp("));
+  // The input has no column for the states.
+  EXPECT_FALSE(
+      aggregate_op->SetSchemasForEvaluation(EmptyParamsSchemas()).ok());
+}
+
 }  // namespace
 }  // namespace zetasql
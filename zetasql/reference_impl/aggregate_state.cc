@@ -0,0 +1,94 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/aggregate_state.h"
+
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+
+zetasql_base::Status InvalidStateError() {
+  return zetasql_base::InvalidArgumentErrorBuilder()
+         << "Invalid serialized aggregate state";
+}
+
+}  // namespace
+
+zetasql_base::StatusOr<AggregateStateReader> AggregateStateReader::Create(
+    const Value& state) {
+  if (!state.type()->IsBytes() || state.is_null()) return InvalidStateError();
+  AggregateStateReader reader;
+  if (!reader.fields_.ParseFromString(state.bytes_value())) {
+    return InvalidStateError();
+  }
+  return reader;
+}
+
+zetasql_base::StatusOr<const ValueProto*> AggregateStateReader::NextField(
+    ValueProto::ValueCase value_case) {
+  if (AtEnd()) return InvalidStateError();
+  const ValueProto& field = fields_.element(next_);
+  // VALUE_NOT_SET accepts any field, since Values of any kind (including
+  // NULLs, which are empty protos) are read with ReadValue().
+  if (value_case != ValueProto::VALUE_NOT_SET &&
+      field.value_case() != value_case) {
+    return InvalidStateError();
+  }
+  ++next_;
+  return &field;
+}
+
+zetasql_base::StatusOr<int64_t> AggregateStateReader::ReadInt64() {
+  ZETASQL_ASSIGN_OR_RETURN(const ValueProto* field,
+                   NextField(ValueProto::kInt64Value));
+  return field->int64_value();
+}
+
+zetasql_base::StatusOr<uint64_t> AggregateStateReader::ReadUint64() {
+  ZETASQL_ASSIGN_OR_RETURN(const ValueProto* field,
+                   NextField(ValueProto::kUint64Value));
+  return field->uint64_value();
+}
+
+zetasql_base::StatusOr<double> AggregateStateReader::ReadDouble() {
+  ZETASQL_ASSIGN_OR_RETURN(const ValueProto* field,
+                   NextField(ValueProto::kDoubleValue));
+  return field->double_value();
+}
+
+zetasql_base::StatusOr<std::string> AggregateStateReader::ReadBytes() {
+  ZETASQL_ASSIGN_OR_RETURN(const ValueProto* field,
+                   NextField(ValueProto::kBytesValue));
+  return field->bytes_value();
+}
+
+zetasql_base::StatusOr<Value> AggregateStateReader::ReadValue(
+    const Type* type) {
+  ZETASQL_ASSIGN_OR_RETURN(const ValueProto* field,
+                   NextField(ValueProto::VALUE_NOT_SET));
+  zetasql_base::StatusOr<Value> value = Value::Deserialize(*field, type);
+  if (!value.ok()) return InvalidStateError();
+  return value;
+}
+
+zetasql_base::Status AggregateStateReader::Finish() const {
+  if (!AtEnd()) return InvalidStateError();
+  return zetasql_base::OkStatus();
+}
+
+}  // namespace zetasql
@@ -0,0 +1,103 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Encoding of the partial states of aggregate accumulators. See
+// AggregateAccumulator::SerializeState() in operator.h.
+
+#ifndef ZETASQL_REFERENCE_IMPL_AGGREGATE_STATE_H_
+#define ZETASQL_REFERENCE_IMPL_AGGREGATE_STATE_H_
+
+#include <string>
+
+#include <cstdint>
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/public/value.pb.h"
+#include "absl/strings/string_view.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// A serialized aggregate state is a BYTES Value holding a
+// ValueProto::Array, whose elements are the fields of the state. The fields
+// only have a meaning for the accumulator that wrote them, so Values are
+// serialized without their types, which the reader passes back in.
+// AggregateStateWriter builds such a state, and AggregateStateReader reads
+// its fields back in the same order.
+class AggregateStateWriter {
+ public:
+  AggregateStateWriter() {}
+  AggregateStateWriter(const AggregateStateWriter&) = delete;
+  AggregateStateWriter& operator=(const AggregateStateWriter&) = delete;
+
+  void AddInt64(int64_t value) { AddField()->set_int64_value(value); }
+  void AddUint64(uint64_t value) { AddField()->set_uint64_value(value); }
+  void AddDouble(double value) { AddField()->set_double_value(value); }
+  void AddBytes(absl::string_view value) {
+    AddField()->set_bytes_value(value.data(), value.size());
+  }
+  zetasql_base::Status AddValue(const Value& value) {
+    return value.Serialize(AddField());
+  }
+
+  // Returns the serialized state.
+  Value Finish() const { return Value::Bytes(fields_.SerializeAsString()); }
+
+ private:
+  ValueProto* AddField() { return fields_.add_element(); }
+
+  ValueProto::Array fields_;
+};
+
+class AggregateStateReader {
+ public:
+  // Returns an error if 'state' is not a non-NULL state built by
+  // AggregateStateWriter.
+  static zetasql_base::StatusOr<AggregateStateReader> Create(
+      const Value& state);
+
+  // Returns true if all the fields have been read.
+  bool AtEnd() const { return next_ == fields_.element_size(); }
+
+  // Returns the number of fields that have not been read yet.
+  int num_remaining_fields() const { return fields_.element_size() - next_; }
+
+  // Each of these returns an error if the next field does not exist or is not
+  // of the requested kind.
+  zetasql_base::StatusOr<int64_t> ReadInt64();
+  zetasql_base::StatusOr<uint64_t> ReadUint64();
+  zetasql_base::StatusOr<double> ReadDouble();
+  zetasql_base::StatusOr<std::string> ReadBytes();
+  zetasql_base::StatusOr<Value> ReadValue(const Type* type);
+
+  // Returns an error unless AtEnd().
+  zetasql_base::Status Finish() const;
+
+ private:
+  AggregateStateReader() {}
+
+  // Returns the next field if it has the case 'value_case'.
+  zetasql_base::StatusOr<const ValueProto*> NextField(
+      ValueProto::ValueCase value_case);
+
+  ValueProto::Array fields_;
+  int next_ = 0;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_AGGREGATE_STATE_H_
@@ -16,7 +16,9 @@
 
 #include "zetasql/reference_impl/algebrizer.h"
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <string>
 #include <unordered_set>
 #include <utility>
@@ -36,15 +38,20 @@
 #include "zetasql/public/value.h"
 #include "zetasql/reference_impl/common.h"
 #include "zetasql/reference_impl/function.h"
+#include "zetasql/reference_impl/in_list_set.h"
 #include "zetasql/reference_impl/proto_util.h"
 #include "zetasql/reference_impl/tuple.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_deep_copy_visitor.h"
 #include "zetasql/resolved_ast/resolved_ast_enums.pb.h"
 #include "zetasql/resolved_ast/resolved_ast_visitor.h"
 #include "zetasql/resolved_ast/resolved_column.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/source_location.h"
@@ -76,15 +83,25 @@ static bool IgnoresNullArguments(
   }
 }
 
+// Returns true if 'hint' is meant for the reference_impl rather than for a
+// specific different engine.
+static bool IsReferenceImplHint(const ResolvedOption& hint) {
+  return hint.qualifier().empty() || hint.qualifier() == "reference_impl";
+}
+
+// Returns an error for any hint in 'hint_list' that is meant for the
+// reference_impl and is not in 'supported_hints'.
 static zetasql_base::Status CheckHints(
-    const std::vector<std::unique_ptr<const ResolvedOption>>& hint_list) {
+    const std::vector<std::unique_ptr<const ResolvedOption>>& hint_list,
+    absl::Span<const absl::string_view> supported_hints = {}) {
   for (const auto& hint : hint_list) {
-    // Ignore all hints meant for a specific different engine.
-    if (!hint->qualifier().empty() && hint->qualifier() != "reference_impl") {
+    if (!IsReferenceImplHint(*hint)) continue;
+    if (std::any_of(supported_hints.begin(), supported_hints.end(),
+                    [&hint](absl::string_view name) {
+                      return absl::EqualsIgnoreCase(hint->name(), name);
+                    })) {
       continue;
     }
-    // All hints are currently unsupported in the reference_impl, so we
-    // always give an error.
     return ::zetasql_base::InvalidArgumentErrorBuilder()
            << "Unsupported hint: " << hint->qualifier()
            << (hint->qualifier().empty() ? "" : ".") << hint->name();
@@ -92,6 +109,95 @@ static zetasql_base::Status CheckHints(
   return ::zetasql_base::OkStatus();
 }
 
+// The hints that GetScanHints() reads.
+constexpr absl::string_view kJoinMethodHint = "join_method";
+constexpr absl::string_view kBuildSideHint = "build_side";
+constexpr absl::string_view kParallelismHint = "parallelism";
+constexpr int kMaxHintParallelism = 1024;
+
+// Returns the hints that the algebrizer supports for scans of 'kind'.
+static absl::Span<const absl::string_view> GetSupportedScanHints(
+    ResolvedNodeKind kind) {
+  static constexpr absl::string_view kJoinScanHints[] = {
+      kJoinMethodHint, kBuildSideHint, kParallelismHint};
+  static constexpr absl::string_view kAggregateScanHints[] = {
+      kParallelismHint};
+  switch (kind) {
+    case RESOLVED_JOIN_SCAN:
+      return kJoinScanHints;
+    case RESOLVED_AGGREGATE_SCAN:
+      return kAggregateScanHints;
+    default:
+      return {};
+  }
+}
+
+// Returns the value of 'hint', which must be a literal of type 'type'.
+static zetasql_base::StatusOr<Value> GetHintLiteral(const ResolvedOption& hint,
+                                            const Type* type) {
+  if (hint.value()->node_kind() != RESOLVED_LITERAL ||
+      !hint.value()->type()->Equals(type) ||
+      hint.value()->GetAs<ResolvedLiteral>()->value().is_null()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Hint " << hint.name() << " must be a non-NULL "
+           << type->DebugString() << " literal";
+  }
+  return hint.value()->GetAs<ResolvedLiteral>()->value();
+}
+
+zetasql_base::StatusOr<Algebrizer::ScanHints> Algebrizer::GetScanHints(
+    const ResolvedScan* scan) {
+  ScanHints hints;
+  for (const std::unique_ptr<const ResolvedOption>& hint : scan->hint_list()) {
+    if (!IsReferenceImplHint(*hint)) continue;
+    if (absl::EqualsIgnoreCase(hint->name(), kJoinMethodHint)) {
+      ZETASQL_ASSIGN_OR_RETURN(const Value value,
+                       GetHintLiteral(*hint, types::StringType()));
+      if (absl::EqualsIgnoreCase(value.string_value(), "HASH")) {
+        hints.join_method = ScanHints::kHashJoin;
+      } else if (absl::EqualsIgnoreCase(value.string_value(), "NESTED_LOOP")) {
+        hints.join_method = ScanHints::kNestedLoopJoin;
+      } else if (absl::EqualsIgnoreCase(value.string_value(), "MERGE")) {
+        hints.join_method = ScanHints::kMergeJoin;
+      } else {
+        return ::zetasql_base::InvalidArgumentErrorBuilder()
+               << "Hint " << hint->name()
+               << " must be HASH, NESTED_LOOP or MERGE, but is "
+               << value.string_value();
+      }
+    } else if (absl::EqualsIgnoreCase(hint->name(), kBuildSideHint)) {
+      ZETASQL_ASSIGN_OR_RETURN(const Value value,
+                       GetHintLiteral(*hint, types::StringType()));
+      if (absl::EqualsIgnoreCase(value.string_value(), "LEFT")) {
+        hints.build_side = ScanHints::kBuildLeft;
+      } else if (absl::EqualsIgnoreCase(value.string_value(), "RIGHT")) {
+        hints.build_side = ScanHints::kBuildRight;
+      } else {
+        return ::zetasql_base::InvalidArgumentErrorBuilder()
+               << "Hint " << hint->name() << " must be LEFT or RIGHT, but is "
+               << value.string_value();
+      }
+    } else if (absl::EqualsIgnoreCase(hint->name(), kParallelismHint)) {
+      ZETASQL_ASSIGN_OR_RETURN(const Value value,
+                       GetHintLiteral(*hint, types::Int64Type()));
+      if (value.int64_value() < 1 ||
+          value.int64_value() > kMaxHintParallelism) {
+        return ::zetasql_base::InvalidArgumentErrorBuilder()
+               << "Hint " << hint->name() << " must be between 1 and "
+               << kMaxHintParallelism << ", but is " << value.int64_value();
+      }
+      hints.parallelism = static_cast<int>(value.int64_value());
+    }
+  }
+  if (hints.join_method == ScanHints::kMergeJoin &&
+      hints.build_side.has_value()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Hint " << kBuildSideHint << " cannot be used with "
+           << kJoinMethodHint << "=MERGE";
+  }
+  return hints;
+}
+
 Algebrizer::Algebrizer(const LanguageOptions& language_options,
                        const AlgebrizerOptions& algebrizer_options,
                        TypeFactory* type_factory, Parameters* parameters,
@@ -129,15 +235,41 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeCast(
 
 zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeFunctionCall(
     const ResolvedFunctionCall* function_call) {
-  int num_arguments = function_call->argument_list_size();
+  const auto batched = batched_json_extractions_.find(function_call);
+  if (batched != batched_json_extractions_.end()) {
+    const VariableId& extractions = batched->second.first;
+    std::vector<std::unique_ptr<ValueExpr>> arguments;
+    ZETASQL_ASSIGN_OR_RETURN(
+        auto deref_extractions,
+        DerefExpr::Create(extractions, types::StringArrayType()));
+    arguments.push_back(std::move(deref_extractions));
+    ZETASQL_ASSIGN_OR_RETURN(auto offset,
+                     ConstExpr::Create(Value::Int64(batched->second.second)));
+    arguments.push_back(std::move(offset));
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> element,
+                     BuiltinScalarFunction::CreateCall(
+                         FunctionKind::kArrayAtOffset, language_options_,
+                         types::StringType(), std::move(arguments)));
+    return element;
+  }
+
+  const std::string& name = function_call->function()->FullName(false);
+  std::vector<const ResolvedExpr*> argument_exprs;
+  argument_exprs.reserve(function_call->argument_list_size());
+  for (const std::unique_ptr<const ResolvedExpr>& argument_expr :
+       function_call->argument_list()) {
+    argument_exprs.push_back(argument_expr.get());
+  }
+  if (function_call->function()->IsZetaSQLBuiltin() &&
+      (name == "$and" || name == "$or")) {
+    MaybeOrderConjunctsByCost(&argument_exprs);
+  }
   std::vector<std::unique_ptr<ValueExpr>> arguments;
-  for (int i = 0; i < num_arguments; ++i) {
-    const ResolvedExpr* argument_expr = function_call->argument_list(i);
+  for (const ResolvedExpr* argument_expr : argument_exprs) {
     ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> argument,
                      AlgebrizeExpression(argument_expr));
     arguments.push_back(std::move(argument));
   }
-  const std::string& name = function_call->function()->FullName(false);
   const ResolvedFunctionCallBase::ErrorMode& error_mode =
       function_call->error_mode();
 
@@ -193,6 +325,9 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeFunction
   } else if (name == "$case_with_value") {
     return AlgebrizeCaseWithValue(function_call->type(), std::move(arguments));
   } else if (name == "$in") {
+    if (ShouldUseInListSet(function_call)) {
+      return AlgebrizeInListSet(InListExpr::kList, std::move(arguments));
+    }
     return AlgebrizeIn(function_call->type(), std::move(arguments));
   } else if (name == "$between") {
     return AlgebrizeBetween(function_call->type(), std::move(arguments));
@@ -202,6 +337,9 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeFunction
                                           std::move(arguments)));
     return new_array_expr;
   } else if (name == "$in_array") {
+    if (ShouldUseInListSet(function_call)) {
+      return AlgebrizeInListSet(InListExpr::kArray, std::move(arguments));
+    }
     return AlgebrizeInArray(std::move(arguments[0]), std::move(arguments[1]));
   } else {
     zetasql_base::StatusOr<FunctionKind> status_or_kind =
@@ -218,6 +356,396 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeFunction
   return function_call_expr;
 }
 
+// Returns the JSON_EXTRACT_SCALAR call that 'expr' consists of, possibly
+// inside casts, if its JSON argument is a column and its JSONPath is a non-NULL
+// literal. Otherwise returns NULL.
+static const ResolvedFunctionCall* GetBatchableJsonExtraction(
+    const ResolvedExpr* expr) {
+  while (expr->node_kind() == RESOLVED_CAST) {
+    expr = expr->GetAs<ResolvedCast>()->expr();
+  }
+  if (expr->node_kind() != RESOLVED_FUNCTION_CALL) return nullptr;
+  const ResolvedFunctionCall* call = expr->GetAs<ResolvedFunctionCall>();
+  if (!call->function()->IsZetaSQLBuiltin() ||
+      call->function()->FullName(false) != "json_extract_scalar" ||
+      call->error_mode() != ResolvedFunctionCallBase::DEFAULT_ERROR_MODE ||
+      call->argument_list_size() != 2 ||
+      call->argument_list(0)->node_kind() != RESOLVED_COLUMN_REF ||
+      call->argument_list(1)->node_kind() != RESOLVED_LITERAL ||
+      call->argument_list(1)->GetAs<ResolvedLiteral>()->value().is_null()) {
+    return nullptr;
+  }
+  return call;
+}
+
+zetasql_base::StatusOr<std::vector<std::unique_ptr<ExprArg>>>
+Algebrizer::AlgebrizeBatchedJsonExtractions(
+    absl::Span<const ResolvedExpr* const> exprs) {
+  std::vector<std::unique_ptr<ExprArg>> batches;
+  if (!algebrizer_options_.batch_json_extractions) return batches;
+
+  // Groups in the order of their first call, so that plans are deterministic.
+  std::vector<std::vector<const ResolvedFunctionCall*>> groups;
+  absl::flat_hash_map<int, int> column_id_to_group;
+  for (const ResolvedExpr* expr : exprs) {
+    const ResolvedFunctionCall* call = GetBatchableJsonExtraction(expr);
+    if (call == nullptr) continue;
+    const int column_id = call->argument_list(0)
+                              ->GetAs<ResolvedColumnRef>()
+                              ->column()
+                              .column_id();
+    const auto inserted = column_id_to_group.emplace(column_id, groups.size());
+    if (inserted.second) groups.emplace_back();
+    groups[inserted.first->second].push_back(call);
+  }
+
+  for (const std::vector<const ResolvedFunctionCall*>& group : groups) {
+    if (group.size() < 2) continue;
+    std::vector<std::unique_ptr<ValueExpr>> arguments;
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> json,
+                     AlgebrizeExpression(group[0]->argument_list(0)));
+    arguments.push_back(std::move(json));
+    for (const ResolvedFunctionCall* call : group) {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> json_path,
+                       AlgebrizeExpression(call->argument_list(1)));
+      arguments.push_back(std::move(json_path));
+    }
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<ValueExpr> extractions,
+        BuiltinScalarFunction::CreateCall(
+            FunctionKind::kJsonExtractScalars, language_options_,
+            types::StringArrayType(), std::move(arguments)));
+    const VariableId variable =
+        variable_gen_->GetNewVariableName("json_extractions");
+    for (int i = 0; i < group.size(); ++i) {
+      batched_json_extractions_[group[i]] = std::make_pair(variable, i);
+    }
+    batches.push_back(
+        absl::make_unique<ExprArg>(variable, std::move(extractions)));
+  }
+  return batches;
+}
+
+// Returns the subexpressions of 'expr' that AlgebrizeCommonSubexpressions()
+// and IsStatementConstant() look into, or an empty vector if 'expr' is not one
+// of the kinds of expressions they look into.
+static std::vector<const ResolvedExpr*> GetSimpleSubexpressions(
+    const ResolvedExpr* expr) {
+  std::vector<const ResolvedExpr*> subexpressions;
+  switch (expr->node_kind()) {
+    case RESOLVED_FUNCTION_CALL:
+      for (const auto& argument :
+           expr->GetAs<ResolvedFunctionCall>()->argument_list()) {
+        subexpressions.push_back(argument.get());
+      }
+      break;
+    case RESOLVED_CAST:
+      subexpressions.push_back(expr->GetAs<ResolvedCast>()->expr());
+      break;
+    case RESOLVED_GET_STRUCT_FIELD:
+      subexpressions.push_back(expr->GetAs<ResolvedGetStructField>()->expr());
+      break;
+    case RESOLVED_GET_PROTO_FIELD:
+      subexpressions.push_back(expr->GetAs<ResolvedGetProtoField>()->expr());
+      break;
+    case RESOLVED_MAKE_STRUCT:
+      for (const auto& field_expr :
+           expr->GetAs<ResolvedMakeStruct>()->field_list()) {
+        subexpressions.push_back(field_expr.get());
+      }
+      break;
+    default:
+      break;
+  }
+  return subexpressions;
+}
+
+// Returns true if 'call' is a builtin function that always produces the same
+// value for the same arguments during a statement. Only builtin functions are
+// considered, because engines may implement the other functions with
+// side effects whatever their declared volatility.
+static bool IsDeterministicBuiltinFunctionCall(
+    const ResolvedFunctionCall* call) {
+  return call->function()->IsZetaSQLBuiltin() &&
+         call->function()->function_options().volatility !=
+             FunctionEnums::VOLATILE;
+}
+
+// Returns true if only the first argument of 'call' is always evaluated.
+static bool IsShortCircuitingFunctionCall(const ResolvedFunctionCall* call) {
+  if (!call->function()->IsZetaSQLBuiltin()) return false;
+  const std::string name = call->function()->FullName(/*include_group=*/false);
+  return name == "if" || name == "$case_no_value" ||
+         name == "$case_with_value" || name == "coalesce" ||
+         name == "ifnull" || name == "$and" || name == "$or";
+}
+
+// Returns true if 'expr' is a deterministic computation that only depends on
+// literals, parameters and system variables, and therefore produces the same
+// value for the whole statement.
+static bool IsStatementConstant(const ResolvedExpr* expr) {
+  switch (expr->node_kind()) {
+    case RESOLVED_LITERAL:
+    case RESOLVED_CONSTANT:
+    case RESOLVED_PARAMETER:
+    case RESOLVED_SYSTEM_VARIABLE:
+      return true;
+    case RESOLVED_FUNCTION_CALL:
+      if (!IsDeterministicBuiltinFunctionCall(
+              expr->GetAs<ResolvedFunctionCall>())) {
+        return false;
+      }
+      break;
+    case RESOLVED_CAST:
+    case RESOLVED_GET_STRUCT_FIELD:
+    case RESOLVED_MAKE_STRUCT:
+      break;
+    default:
+      return false;
+  }
+  for (const ResolvedExpr* subexpression : GetSimpleSubexpressions(expr)) {
+    if (!IsStatementConstant(subexpression)) return false;
+  }
+  return true;
+}
+
+zetasql_base::StatusOr<std::unique_ptr<ValueExpr>>
+Algebrizer::MaybeAlgebrizeCachedExpression(const ResolvedExpr* expr) {
+  std::unique_ptr<ValueExpr> no_cached_expr;
+  if (!algebrizer_options_.fold_constant_subexpressions ||
+      num_scans_in_progress_ == 0 || in_cached_expression_) {
+    return no_cached_expr;
+  }
+  // Literals, parameters and the like are cheaper to evaluate than to cache.
+  if (GetSimpleSubexpressions(expr).empty() || !IsStatementConstant(expr)) {
+    return no_cached_expr;
+  }
+  in_cached_expression_ = true;
+  zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> algebrized_expr =
+      AlgebrizeExpression(expr);
+  in_cached_expression_ = false;
+  ZETASQL_RETURN_IF_ERROR(algebrized_expr.status());
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<CachedExpr> cached_expr,
+                   CachedExpr::Create(std::move(algebrized_expr).ValueOrDie()));
+  return std::unique_ptr<ValueExpr>(std::move(cached_expr));
+}
+
+namespace {
+
+// Finds the common subexpressions for AlgebrizeCommonSubexpressions().
+class CommonSubexpressionFinder {
+ public:
+  CommonSubexpressionFinder() {}
+  CommonSubexpressionFinder(const CommonSubexpressionFinder&) = delete;
+  CommonSubexpressionFinder& operator=(const CommonSubexpressionFinder&) =
+      delete;
+
+  // Counts the subexpressions of 'expr'. Must be called for all the
+  // expressions before Select().
+  void Count(const ResolvedExpr* expr) {
+    std::string fingerprint;
+    AppendFingerprint(expr, &fingerprint);
+  }
+
+  // Appends to 'selected' the occurrences of the subexpressions of 'expr'
+  // that occur more than once in the expressions passed to Count(), and are
+  // not part of another such subexpression. Sets 'conditional' to whether
+  // each of them is only evaluated for some rows.
+  void Select(const ResolvedExpr* expr, bool conditional,
+              std::vector<std::pair<const ResolvedExpr*, bool>>* selected) {
+    const auto fingerprint = fingerprints_.find(expr);
+    if (fingerprint != fingerprints_.end() &&
+        counts_[fingerprint->second] > 1) {
+      selected->emplace_back(expr, conditional);
+      return;
+    }
+    const std::vector<const ResolvedExpr*> subexpressions =
+        GetSimpleSubexpressions(expr);
+    const bool short_circuiting =
+        expr->node_kind() == RESOLVED_FUNCTION_CALL &&
+        IsShortCircuitingFunctionCall(expr->GetAs<ResolvedFunctionCall>());
+    for (int i = 0; i < subexpressions.size(); ++i) {
+      Select(subexpressions[i], conditional || (short_circuiting && i > 0),
+             selected);
+    }
+  }
+
+  // Returns the fingerprint of 'expr', which must have been selected.
+  const std::string& fingerprint(const ResolvedExpr* expr) const {
+    return fingerprints_.at(expr);
+  }
+
+ private:
+  // Appends a string that identifies the computation of 'expr' to
+  // 'fingerprint', so that two expressions with the same fingerprint always
+  // produce the same value for the same row. Returns false if 'expr' is not a
+  // deterministic computation of literals, parameters, system variables and
+  // columns. Records the fingerprints of the subexpressions worth computing
+  // once.
+  bool AppendFingerprint(const ResolvedExpr* expr, std::string* fingerprint) {
+    const size_t start = fingerprint->size();
+    bool deterministic = true;
+    switch (expr->node_kind()) {
+      case RESOLVED_COLUMN_REF:
+        absl::StrAppend(
+            fingerprint, "col:",
+            expr->GetAs<ResolvedColumnRef>()->column().column_id(), ";");
+        return true;
+      case RESOLVED_LITERAL:
+        AppendString(
+            expr->GetAs<ResolvedLiteral>()->value().FullDebugString(),
+            fingerprint);
+        break;
+      case RESOLVED_PARAMETER: {
+        const ResolvedParameter* parameter = expr->GetAs<ResolvedParameter>();
+        absl::StrAppend(fingerprint, "param:", parameter->position(), ":");
+        AppendString(parameter->name(), fingerprint);
+        break;
+      }
+      case RESOLVED_SYSTEM_VARIABLE:
+        fingerprint->append("sysvar:");
+        for (const std::string& name :
+             expr->GetAs<ResolvedSystemVariable>()->name_path()) {
+          AppendString(name, fingerprint);
+        }
+        break;
+      case RESOLVED_FUNCTION_CALL: {
+        const ResolvedFunctionCall* call = expr->GetAs<ResolvedFunctionCall>();
+        deterministic = IsDeterministicBuiltinFunctionCall(call);
+        fingerprint->append("call:");
+        AppendString(call->function()->Name(), fingerprint);
+        AppendString(call->signature().DebugString(), fingerprint);
+        absl::StrAppend(fingerprint, static_cast<int>(call->error_mode()), ":");
+        break;
+      }
+      case RESOLVED_CAST:
+        absl::StrAppend(fingerprint, "cast:",
+                        expr->GetAs<ResolvedCast>()->return_null_on_error(),
+                        ":");
+        break;
+      case RESOLVED_GET_STRUCT_FIELD:
+        absl::StrAppend(fingerprint, "field:",
+                        expr->GetAs<ResolvedGetStructField>()->field_idx(),
+                        ":");
+        break;
+      case RESOLVED_GET_PROTO_FIELD: {
+        const ResolvedGetProtoField* get_field =
+            expr->GetAs<ResolvedGetProtoField>();
+        fingerprint->append("proto_field:");
+        AppendString(get_field->field_descriptor()->full_name(), fingerprint);
+        AppendString(get_field->default_value().FullDebugString(),
+                     fingerprint);
+        absl::StrAppend(fingerprint, get_field->get_has_bit(), ":",
+                        static_cast<int>(get_field->format()), ":",
+                        get_field->return_default_value_when_unset(), ":");
+        break;
+      }
+      case RESOLVED_MAKE_STRUCT:
+        fingerprint->append("struct:");
+        break;
+      default:
+        return false;
+    }
+    AppendString(expr->type()->DebugString(), fingerprint);
+
+    // Visit all of the subexpressions, even if 'expr' is not deterministic,
+    // because they may have common subexpressions of their own.
+    const std::vector<const ResolvedExpr*> subexpressions =
+        GetSimpleSubexpressions(expr);
+    absl::StrAppend(fingerprint, "(", subexpressions.size(), ":");
+    for (const ResolvedExpr* subexpression : subexpressions) {
+      if (!AppendFingerprint(subexpression, fingerprint)) {
+        deterministic = false;
+      }
+    }
+    fingerprint->append(")");
+    if (!deterministic) return false;
+
+    // Reading columns, literals and fields of structs is cheap.
+    const ResolvedNodeKind kind = expr->node_kind();
+    if (kind == RESOLVED_FUNCTION_CALL || kind == RESOLVED_CAST ||
+        kind == RESOLVED_GET_PROTO_FIELD) {
+      std::string expr_fingerprint = fingerprint->substr(start);
+      ++counts_[expr_fingerprint];
+      fingerprints_.emplace(expr, std::move(expr_fingerprint));
+    }
+    return true;
+  }
+
+  // Appends 's' to 'fingerprint' so that it cannot be confused with what
+  // follows.
+  static void AppendString(absl::string_view s, std::string* fingerprint) {
+    absl::StrAppend(fingerprint, s.size(), ":", s, ";");
+  }
+
+  absl::flat_hash_map<const ResolvedExpr*, std::string> fingerprints_;
+  absl::flat_hash_map<std::string, int> counts_;
+};
+
+}  // namespace
+
+zetasql_base::StatusOr<std::vector<std::unique_ptr<ExprArg>>>
+Algebrizer::AlgebrizeCommonSubexpressions(
+    absl::Span<const ResolvedExpr* const> exprs,
+    std::vector<const ResolvedExpr*>* occurrences) {
+  std::vector<std::unique_ptr<ExprArg>> common_subexpressions;
+  if (!algebrizer_options_.eliminate_common_subexpressions) {
+    return common_subexpressions;
+  }
+
+  CommonSubexpressionFinder finder;
+  for (const ResolvedExpr* expr : exprs) {
+    finder.Count(expr);
+  }
+  std::vector<std::pair<const ResolvedExpr*, bool>> selected;
+  for (const ResolvedExpr* expr : exprs) {
+    finder.Select(expr, /*conditional=*/false, &selected);
+  }
+
+  // Groups in the order of their first occurrence, so that plans are
+  // deterministic. Subexpressions that are part of a selected subexpression
+  // are only counted once, so a group may end up with a single occurrence.
+  struct Group {
+    std::vector<const ResolvedExpr*> occurrences;
+    bool has_unconditional_occurrence = false;
+  };
+  std::vector<Group> groups;
+  absl::flat_hash_map<absl::string_view, int> fingerprint_to_group;
+  for (const auto& entry : selected) {
+    const auto inserted = fingerprint_to_group.emplace(
+        finder.fingerprint(entry.first), groups.size());
+    if (inserted.second) groups.emplace_back();
+    Group& group = groups[inserted.first->second];
+    group.occurrences.push_back(entry.first);
+    if (!entry.second) group.has_unconditional_occurrence = true;
+  }
+
+  // Algebrize all of the subexpressions before recording any of them, so
+  // that none of them refers to the variable of another.
+  std::vector<const Group*> hoisted_groups;
+  std::vector<VariableId> variables;
+  for (const Group& group : groups) {
+    if (group.occurrences.size() < 2 || !group.has_unconditional_occurrence) {
+      continue;
+    }
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_expr,
+                     AlgebrizeExpression(group.occurrences[0]));
+    const VariableId variable =
+        variable_gen_->GetNewVariableName("common_subexpression");
+    common_subexpressions.push_back(
+        absl::make_unique<ExprArg>(variable, std::move(algebrized_expr)));
+    hoisted_groups.push_back(&group);
+    variables.push_back(variable);
+  }
+  for (int i = 0; i < hoisted_groups.size(); ++i) {
+    for (const ResolvedExpr* occurrence : hoisted_groups[i]->occurrences) {
+      common_subexpressions_[occurrence] = variables[i];
+      occurrences->push_back(occurrence);
+    }
+  }
+  return common_subexpressions;
+}
+
 // CASE WHEN w1 THEN t1 ELSE e END =
 //     IfExpr(w1, t1, e)
 // CASE WHEN w1 THEN t1 WHEN w2 THEN t2 ELSE e END =
@@ -437,6 +965,39 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeIn(
   return let_expr;
 }
 
+// IN lists with fewer elements are cheaper to evaluate with comparisons than
+// with an InListExpr.
+static constexpr int kMinInListSetSize = 8;
+
+bool Algebrizer::ShouldUseInListSet(const ResolvedFunctionCall* call) const {
+  if (!algebrizer_options_.use_in_list_sets) return false;
+  const Type* value_type = call->argument_list(0)->type();
+  if (!InListSet::SupportsType(value_type)) return false;
+  const bool is_array = call->function()->FullName(false) == "$in_array";
+  if (!is_array && call->argument_list_size() - 1 < kMinInListSetSize) {
+    return false;
+  }
+  for (int i = 1; i < call->argument_list_size(); ++i) {
+    const ResolvedExpr* element = call->argument_list(i);
+    const Type* element_type =
+        is_array ? element->type()->AsArray()->element_type() : element->type();
+    if (!element_type->Equals(value_type) || !IsStatementConstant(element)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeInListSet(
+    InListExpr::Kind kind, std::vector<std::unique_ptr<ValueExpr>> args) {
+  ZETASQL_RET_CHECK_GE(args.size(), 2);
+  std::unique_ptr<ValueExpr> value = std::move(args[0]);
+  args.erase(args.begin());
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<InListExpr> in_list,
+                   InListExpr::Create(kind, std::move(value), std::move(args)));
+  return std::unique_ptr<ValueExpr>(std::move(in_list));
+}
+
 // Between(v, min, max) = LetExpr(x:=v, And(min<=x, x<=max))
 zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeBetween(
     const Type* output_type, std::vector<std::unique_ptr<ValueExpr>> args) {
@@ -804,6 +1365,9 @@ Algebrizer::AlgebrizeGetProtoFieldOfPath(
         ZETASQL_ASSIGN_OR_RETURN(reader, AddProtoFieldReader(column_and_field_path,
                                                      access_info, registry));
       }
+      if (in_filter_conjunct_) {
+        registry->MarkEagerField(reader->access_info_registry_id());
+      }
 
       ZETASQL_ASSIGN_OR_RETURN(base_expr,
                        GetProtoFieldExpr::Create(std::move(base_expr), reader));
@@ -823,6 +1387,32 @@ Algebrizer::AlgebrizeGetProtoFieldOfPath(
   return base_expr;
 }
 
+zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
+Algebrizer::AlgebrizeExistsSubquery(const ResolvedScan* scan,
+                                    const ResolvedScan** first_row_scan) {
+  *first_row_scan = scan;
+  if (!algebrizer_options_.simplify_exists_subqueries ||
+      scan->node_kind() != RESOLVED_ORDER_BY_SCAN) {
+    return AlgebrizeScan(scan);
+  }
+  const ResolvedOrderByScan* order_by_scan = scan->GetAs<ResolvedOrderByScan>();
+  ZETASQL_RETURN_IF_ERROR(CheckHints(order_by_scan->hint_list()));
+  // The output columns of 'order_by_scan' are columns of its input, so they
+  // keep their variables.
+  *first_row_scan = order_by_scan->input_scan();
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> input,
+                   AlgebrizeScan(*first_row_scan));
+  // The sort keys are discarded. They are only algebrized for
+  // CheckFieldsAccessed().
+  order_by_scan->is_ordered();
+  absl::flat_hash_map<int, VariableId> column_to_id_map;
+  std::vector<std::unique_ptr<KeyArg>> keys;
+  ZETASQL_RETURN_IF_ERROR(AlgebrizeOrderByItems(
+      /*drop_correlated_columns=*/true, /*create_new_ids=*/false,
+      order_by_scan->order_by_item_list(), &column_to_id_map, &keys));
+  return input;
+}
+
 zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubqueryExpr(
     const ResolvedSubqueryExpr* subquery_expr) {
   // Access 'parameters' to suppress the resolver check for non-accessed
@@ -836,11 +1426,22 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
       column_to_variable_->map();
   ZETASQL_RETURN_IF_ERROR(CheckHints(subquery_expr->hint_list()));
   const ResolvedScan* scan = subquery_expr->subquery();
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> relation, AlgebrizeScan(scan));
+  const ResolvedScan* first_row_scan = scan;
+  std::unique_ptr<RelationalOp> relation;
+  if (subquery_expr->subquery_type() == ResolvedSubqueryExpr::EXISTS) {
+    ZETASQL_ASSIGN_OR_RETURN(relation,
+                     AlgebrizeExistsSubquery(scan, &first_row_scan));
+  } else {
+    ZETASQL_ASSIGN_OR_RETURN(relation, AlgebrizeScan(scan));
+  }
 
   const ResolvedColumnList& output_columns = scan->column_list();
   switch (subquery_expr->subquery_type()) {
     case ResolvedSubqueryExpr::EXISTS: {
+      if (algebrizer_options_.simplify_exists_subqueries &&
+          algebrizer_options_.push_limits_into_scans) {
+        AddRowLimitHints(first_row_scan, /*max_num_rows=*/1);
+      }
       // In theory, we don't need a new expression for this, and can instead do
       // some function of SingleValueExpr(LimitOp(<relation>, LIMIT 1)). The
       // problem is that if the relation has more than one row, the LimitOp will
@@ -848,7 +1449,7 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
       // testing of this feature.
       ZETASQL_ASSIGN_OR_RETURN(auto subquery_valueop,
                        ExistsExpr::Create(std::move(relation)));
-      return std::unique_ptr<ValueExpr>(std::move(subquery_valueop));
+      return MaybeMemoizeSubquery(subquery_expr, std::move(subquery_valueop));
     }
     case ResolvedSubqueryExpr::SCALAR: {
       // A single column which may be a struct or an array.
@@ -858,10 +1459,14 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
       ZETASQL_ASSIGN_OR_RETURN(auto deref,
                        DerefExpr::Create(var, output_columns[0].type()));
       column_to_variable_->set_map(original_column_to_variable);
+      if (algebrizer_options_.simplify_exists_subqueries &&
+          algebrizer_options_.push_limits_into_scans) {
+        AddRowLimitHints(scan, /*max_num_rows=*/2);
+      }
       ZETASQL_ASSIGN_OR_RETURN(
           auto single_value_expr,
           SingleValueExpr::Create(std::move(deref), std::move(relation)));
-      return std::unique_ptr<ValueExpr>(std::move(single_value_expr));
+      return MaybeMemoizeSubquery(subquery_expr, std::move(single_value_expr));
     }
     case ResolvedSubqueryExpr::ARRAY: {
       // Either a single scalar column or a struct column.
@@ -870,7 +1475,7 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
           NestSingleColumnRelation(output_columns, std::move(relation),
                                    /*is_with_table=*/false));
       column_to_variable_->set_map(original_column_to_variable);
-      return std::move(nest_expr);
+      return MaybeMemoizeSubquery(subquery_expr, std::move(nest_expr));
     }
     case ResolvedSubqueryExpr::IN: {
       ZETASQL_RET_CHECK_EQ(1, scan->column_list().size());
@@ -893,6 +1498,96 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
   }
 }
 
+// Returns true if evaluating 'subquery_expr' twice with the same values of its
+// correlated columns produces the same result (up to undefined orderings).
+static zetasql_base::StatusOr<bool> IsDeterministicSubquery(
+    const ResolvedSubqueryExpr* subquery_expr) {
+  // ResolvedASTVisitor that looks for nodes whose result may change between
+  // evaluations.
+  class NonDeterminismVisitor : public ResolvedASTVisitor {
+   public:
+    NonDeterminismVisitor() {}
+    NonDeterminismVisitor(const NonDeterminismVisitor&) = delete;
+    NonDeterminismVisitor& operator=(const NonDeterminismVisitor&) = delete;
+
+    bool deterministic() const { return deterministic_; }
+
+    zetasql_base::Status VisitResolvedFunctionCall(
+        const ResolvedFunctionCall* node) override {
+      CheckFunctionCall(node);
+      return DefaultVisit(node);
+    }
+
+    zetasql_base::Status VisitResolvedAggregateFunctionCall(
+        const ResolvedAggregateFunctionCall* node) override {
+      CheckFunctionCall(node);
+      return DefaultVisit(node);
+    }
+
+    zetasql_base::Status VisitResolvedAnalyticFunctionCall(
+        const ResolvedAnalyticFunctionCall* node) override {
+      CheckFunctionCall(node);
+      return DefaultVisit(node);
+    }
+
+    zetasql_base::Status VisitResolvedSampleScan(
+        const ResolvedSampleScan* node) override {
+      deterministic_ = false;
+      return DefaultVisit(node);
+    }
+
+    // Arguments of SQL functions are not correlated columns.
+    zetasql_base::Status VisitResolvedArgumentRef(
+        const ResolvedArgumentRef* node) override {
+      deterministic_ = false;
+      return DefaultVisit(node);
+    }
+
+   private:
+    void CheckFunctionCall(const ResolvedFunctionCallBase* node) {
+      if (!node->function()->IsZetaSQLBuiltin() ||
+          node->function()->function_options().volatility ==
+              FunctionEnums::VOLATILE) {
+        deterministic_ = false;
+      }
+    }
+
+    bool deterministic_ = true;
+  };
+
+  NonDeterminismVisitor visitor;
+  ZETASQL_RETURN_IF_ERROR(subquery_expr->Accept(&visitor));
+  return visitor.deterministic();
+}
+
+zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::MaybeMemoizeSubquery(
+    const ResolvedSubqueryExpr* subquery_expr,
+    std::unique_ptr<ValueExpr> subquery) {
+  if (!algebrizer_options_.memoize_correlated_subqueries ||
+      num_scans_in_progress_ == 0) {
+    return subquery;
+  }
+  std::vector<std::unique_ptr<ValueExpr>> keys;
+  for (const auto& parameter : subquery_expr->parameter_list()) {
+    const ResolvedColumn& column = parameter->column();
+    if (!column.type()->IsSimpleType() || column.type()->IsFloatingPoint()) {
+      return subquery;
+    }
+    ZETASQL_ASSIGN_OR_RETURN(const VariableId variable,
+                     column_to_variable_->LookupVariableNameForColumn(&column));
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<DerefExpr> key,
+                     DerefExpr::Create(variable, column.type()));
+    keys.push_back(std::move(key));
+  }
+  ZETASQL_ASSIGN_OR_RETURN(const bool deterministic,
+                   IsDeterministicSubquery(subquery_expr));
+  if (!deterministic) return subquery;
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<MemoizedSubqueryExpr> memoized_subquery,
+      MemoizedSubqueryExpr::Create(std::move(keys), std::move(subquery)));
+  return std::unique_ptr<ValueExpr>(std::move(memoized_subquery));
+}
+
 zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeInArray(
     std::unique_ptr<ValueExpr> in_value,
     std::unique_ptr<ValueExpr> array_value) {
@@ -993,7 +1688,19 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeExpressi
            << expr->type()->TypeName(language_options_.product_mode());
   }
 
-  std::unique_ptr<ValueExpr> val_op;
+  if (!common_subexpressions_.empty()) {
+    const auto common_subexpression = common_subexpressions_.find(expr);
+    if (common_subexpression != common_subexpressions_.end()) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          std::unique_ptr<DerefExpr> deref,
+          DerefExpr::Create(common_subexpression->second, expr->type()));
+      return std::unique_ptr<ValueExpr>(std::move(deref));
+    }
+  }
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> val_op,
+                   MaybeAlgebrizeCachedExpression(expr));
+  if (val_op != nullptr) return val_op;
+
   switch (expr->node_kind()) {
     case RESOLVED_LITERAL: {
       ZETASQL_ASSIGN_OR_RETURN(
@@ -1241,6 +1948,120 @@ static bool IsNonVolatile(const ResolvedExpr* expr) {
   }
 }
 
+// Returns the estimated cost of evaluating 'expr' once, in the units of
+// BuiltinFunctionCatalog::CostClass.
+static int64_t EstimateEvaluationCost(const ResolvedExpr* expr) {
+  switch (expr->node_kind()) {
+    case RESOLVED_EXPRESSION_COLUMN:
+    case RESOLVED_LITERAL:
+    case RESOLVED_CONSTANT:
+    case RESOLVED_COLUMN_REF:
+    case RESOLVED_PARAMETER:
+      return 0;
+    case RESOLVED_FUNCTION_CALL: {
+      const ResolvedFunctionCall* function_call =
+          expr->GetAs<ResolvedFunctionCall>();
+      // User-defined functions may do anything.
+      int64_t cost = BuiltinFunctionCatalog::kExpensive;
+      if (function_call->function()->IsZetaSQLBuiltin()) {
+        // Operators that the algebrizer rewrites, for example $greater, have
+        // no FunctionKind.
+        const zetasql_base::StatusOr<FunctionKind> kind =
+            BuiltinFunctionCatalog::GetKindByName(
+                function_call->function()->FullName(/*include_group=*/false));
+        cost = kind.ok()
+                   ? BuiltinFunctionCatalog::GetCostClassByKind(kind.value())
+                   : BuiltinFunctionCatalog::kCheap;
+      }
+      for (const std::unique_ptr<const ResolvedExpr>& argument :
+           function_call->argument_list()) {
+        cost += EstimateEvaluationCost(argument.get());
+      }
+      return cost;
+    }
+    case RESOLVED_CAST:
+      return BuiltinFunctionCatalog::kCheap +
+             EstimateEvaluationCost(expr->GetAs<ResolvedCast>()->expr());
+    case RESOLVED_GET_STRUCT_FIELD:
+      return BuiltinFunctionCatalog::kCheap +
+             EstimateEvaluationCost(
+                 expr->GetAs<ResolvedGetStructField>()->expr());
+    case RESOLVED_GET_PROTO_FIELD:
+      return BuiltinFunctionCatalog::kModerate +
+             EstimateEvaluationCost(
+                 expr->GetAs<ResolvedGetProtoField>()->expr());
+    case RESOLVED_SUBQUERY_EXPR:
+      // Evaluates a whole scan.
+      return 10 * BuiltinFunctionCatalog::kExpensive;
+    default:
+      return BuiltinFunctionCatalog::kModerate;
+  }
+}
+
+// Returns true if evaluating 'expr' never returns an error.
+static bool CannotFail(const ResolvedExpr* expr) {
+  switch (expr->node_kind()) {
+    case RESOLVED_EXPRESSION_COLUMN:
+    case RESOLVED_LITERAL:
+    case RESOLVED_CONSTANT:
+    case RESOLVED_COLUMN_REF:
+    case RESOLVED_PARAMETER:
+      return true;
+    case RESOLVED_GET_STRUCT_FIELD:
+      return CannotFail(expr->GetAs<ResolvedGetStructField>()->expr());
+    case RESOLVED_FUNCTION_CALL: {
+      const ResolvedFunctionCall* function_call =
+          expr->GetAs<ResolvedFunctionCall>();
+      if (!function_call->function()->IsZetaSQLBuiltin()) return false;
+      static const auto* never_failing_functions =
+          new absl::flat_hash_set<std::string>{
+              "$equal", "$not_equal", "$less", "$less_or_equal", "$greater",
+              "$greater_or_equal", "$and", "$or", "$not", "$is_null",
+              "$is_true", "$is_false", "$in", "$between", "starts_with",
+              "ends_with", "length", "byte_length", "char_length",
+              "array_length", "is_nan", "is_inf"};
+      // SAFE only turns the errors of the function itself into NULL.
+      if (function_call->error_mode() !=
+              ResolvedFunctionCallBase::SAFE_ERROR_MODE &&
+          !never_failing_functions->contains(
+              function_call->function()->FullName(/*include_group=*/false))) {
+        return false;
+      }
+      for (const std::unique_ptr<const ResolvedExpr>& argument :
+           function_call->argument_list()) {
+        if (!CannotFail(argument.get())) return false;
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+void Algebrizer::MaybeOrderConjunctsByCost(
+    std::vector<const ResolvedExpr*>* conjuncts) const {
+  if (!algebrizer_options_.order_conjuncts_by_cost) return;
+  std::vector<std::pair<int64_t, const ResolvedExpr*>> ordered;
+  ordered.reserve(conjuncts->size());
+  for (const ResolvedExpr* conjunct : *conjuncts) {
+    const int64_t cost = EstimateEvaluationCost(conjunct);
+    auto position = ordered.end();
+    if (IsNonVolatile(conjunct) && CannotFail(conjunct)) {
+      // Move ahead of the more expensive conjuncts. Skipping them can only
+      // hide their errors.
+      position = std::find_if(
+          ordered.begin(), ordered.end(),
+          [cost](const std::pair<int64_t, const ResolvedExpr*>& other) {
+            return other.first > cost;
+          });
+    }
+    ordered.insert(position, {cost, conjunct});
+  }
+  for (int i = 0; i < ordered.size(); ++i) {
+    (*conjuncts)[i] = ordered[i].second;
+  }
+}
+
 zetasql_base::StatusOr<std::unique_ptr<Algebrizer::FilterConjunctInfo>>
 Algebrizer::FilterConjunctInfo::Create(const ResolvedExpr* conjunct) {
   auto info = absl::make_unique<FilterConjunctInfo>();
@@ -1290,6 +2111,46 @@ Algebrizer::FilterConjunctInfo::Create(const ResolvedExpr* conjunct) {
   return info;
 }
 
+namespace {
+
+// Copies a resolved expression, replacing the columns that it references.
+class ColumnRefReplacer : public ResolvedASTDeepCopyVisitor {
+ public:
+  explicit ColumnRefReplacer(
+      const absl::flat_hash_map<ResolvedColumn, ResolvedColumn>* column_map)
+      : column_map_(column_map) {}
+
+  zetasql_base::Status VisitResolvedColumnRef(
+      const ResolvedColumnRef* node) override {
+    const ResolvedColumn* column =
+        zetasql_base::FindOrNull(*column_map_, node->column());
+    if (column == nullptr) {
+      return ResolvedASTDeepCopyVisitor::VisitResolvedColumnRef(node);
+    }
+    PushNodeToStack(
+        MakeResolvedColumnRef(node->type(), *column, node->is_correlated()));
+    return zetasql_base::OkStatus();
+  }
+
+ private:
+  const absl::flat_hash_map<ResolvedColumn, ResolvedColumn>* const
+      column_map_;
+};
+
+}  // namespace
+
+zetasql_base::StatusOr<std::unique_ptr<Algebrizer::FilterConjunctInfo>>
+Algebrizer::CreateRewrittenFilterConjunctInfo(
+    const ResolvedExpr* conjunct,
+    const absl::flat_hash_map<ResolvedColumn, ResolvedColumn>& column_map) {
+  ColumnRefReplacer replacer(&column_map);
+  ZETASQL_RETURN_IF_ERROR(conjunct->Accept(&replacer));
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ResolvedExpr> rewritten_conjunct,
+                   replacer.ConsumeRootNode<ResolvedExpr>());
+  rewritten_conjuncts_.push_back(std::move(rewritten_conjunct));
+  return FilterConjunctInfo::Create(rewritten_conjuncts_.back().get());
+}
+
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::AlgebrizeSingleRowScan() {
   ZETASQL_ASSIGN_OR_RETURN(auto const_expr, ConstExpr::Create(Value::Int64(1)));
@@ -1386,12 +2247,249 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeTable
       }
     }
 
-    return EvaluatorTableScanOp::Create(
-        table_scan->table(), table_scan->alias(), column_idx_list, column_names,
-        variables, std::move(and_filters), std::move(system_time_expr));
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<EvaluatorTableScanOp> scan_op,
+        EvaluatorTableScanOp::Create(table_scan->table(), table_scan->alias(),
+                                     column_idx_list, column_names, variables,
+                                     std::move(and_filters),
+                                     std::move(system_time_expr)));
+    table_scan_ops_[table_scan] = scan_op.get();
+
+    // Push whole conjuncts into tables that can evaluate them. The scan
+    // re-applies each conjunct that the table does not report as fully
+    // handled, so the conjunct is redundant for the filters above it.
+    if (algebrizer_options_.push_down_filters &&
+        table_scan->table()->SupportsEvaluatorPredicatePushdown()) {
+      for (auto i = active_conjuncts->rbegin(); i != active_conjuncts->rend();
+           ++i) {
+        FilterConjunctInfo* info = *i;
+        if (info->redundant || !info->is_non_volatile ||
+            info->referenced_columns.empty()) {
+          continue;
+        }
+        bool only_references_table = true;
+        for (const ResolvedColumn& column : info->referenced_columns) {
+          if (!column_info_map.contains(column)) {
+            only_references_table = false;
+            break;
+          }
+        }
+        if (!only_references_table) continue;
+
+        ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ColumnPredicateArg> predicate,
+                         TryAlgebrizeExprAsColumnPredicateArg(column_info_map,
+                                                              info->conjunct));
+        if (predicate == nullptr) continue;
+        ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> conjunct,
+                         AlgebrizeFilterConjunct(info->conjunct));
+        ZETASQL_RETURN_IF_ERROR(scan_op->AddPushedDownConjunct(std::move(predicate),
+                                                       std::move(conjunct)));
+        info->redundant = true;
+      }
+    }
+
+    return std::unique_ptr<RelationalOp>(std::move(scan_op));
   }
 }
 
+zetasql_base::StatusOr<std::unique_ptr<ColumnPredicateArg>>
+Algebrizer::TryAlgebrizeExprAsColumnPredicateArg(
+    const TableScanColumnInfoMap& column_info_map, const ResolvedExpr* expr) {
+  if (expr->node_kind() != RESOLVED_FUNCTION_CALL) return nullptr;
+  const ResolvedFunctionCall* function_call =
+      expr->GetAs<ResolvedFunctionCall>();
+  const Function* function = function_call->function();
+  if (!function->IsZetaSQLBuiltin()) return nullptr;
+  const std::string name = function->FullName(/*include_group=*/false);
+
+  // Returns the VariableId and scan index of 'arg' if it is a column of the
+  // scan, or nullptr otherwise.
+  auto get_column = [&column_info_map](const ResolvedExpr* arg)
+      -> const std::pair<VariableId, int>* {
+    if (arg->node_kind() != RESOLVED_COLUMN_REF) return nullptr;
+    return zetasql_base::FindOrNull(column_info_map,
+                           arg->GetAs<ResolvedColumnRef>()->column());
+  };
+  // Returns true if 'arg' does not depend on the scan's row.
+  auto is_row_independent =
+      [&column_info_map](const ResolvedExpr* arg) -> zetasql_base::StatusOr<bool> {
+    ZETASQL_ASSIGN_OR_RETURN(const absl::flat_hash_set<ResolvedColumn> columns,
+                     GetReferencedColumns(arg));
+    for (const ResolvedColumn& column : columns) {
+      if (column_info_map.contains(column)) return false;
+    }
+    return true;
+  };
+
+  if (name == "$and" || name == "$or") {
+    std::vector<std::unique_ptr<ColumnPredicateArg>> children;
+    children.reserve(function_call->argument_list_size());
+    for (int i = 0; i < function_call->argument_list_size(); ++i) {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ColumnPredicateArg> child,
+                       TryAlgebrizeExprAsColumnPredicateArg(
+                           column_info_map, function_call->argument_list(i)));
+      if (child == nullptr) return nullptr;
+      children.push_back(std::move(child));
+    }
+    return ColumnPredicateArg::CreateJunction(
+        name == "$and" ? ColumnPredicate::kAnd : ColumnPredicate::kOr,
+        std::move(children));
+  }
+
+  if (name == "$is_null" || name == "$not") {
+    ZETASQL_RET_CHECK_EQ(function_call->argument_list_size(), 1);
+    const ResolvedExpr* arg = function_call->argument_list(0);
+    ColumnPredicate::Kind kind = ColumnPredicate::kIsNull;
+    if (name == "$not") {
+      // Only NOT(<column> IS NULL) is supported.
+      if (arg->node_kind() != RESOLVED_FUNCTION_CALL) return nullptr;
+      const ResolvedFunctionCall* not_arg = arg->GetAs<ResolvedFunctionCall>();
+      if (!not_arg->function()->IsZetaSQLBuiltin() ||
+          not_arg->function()->FullName(/*include_group=*/false) !=
+              "$is_null") {
+        return nullptr;
+      }
+      ZETASQL_RET_CHECK_EQ(not_arg->argument_list_size(), 1);
+      arg = not_arg->argument_list(0);
+      kind = ColumnPredicate::kIsNotNull;
+    }
+    const std::pair<VariableId, int>* column = get_column(arg);
+    if (column == nullptr) return nullptr;
+    return ColumnPredicateArg::CreateLeaf(kind, column->first, column->second,
+                                          /*args=*/{});
+  }
+
+  if (name == "$like") {
+    ZETASQL_RET_CHECK_EQ(function_call->argument_list_size(), 2);
+    const std::pair<VariableId, int>* column =
+        get_column(function_call->argument_list(0));
+    const ResolvedExpr* pattern_expr = function_call->argument_list(1);
+    if (column == nullptr || pattern_expr->node_kind() != RESOLVED_LITERAL) {
+      return nullptr;
+    }
+    const Value& pattern = pattern_expr->GetAs<ResolvedLiteral>()->value();
+    if (pattern.is_null()) return nullptr;
+    const std::string& pattern_str = pattern.type()->IsString()
+                                         ? pattern.string_value()
+                                         : pattern.bytes_value();
+    // Only patterns of the form 'prefix%', where the prefix has no wildcards
+    // or escapes, are supported.
+    if (pattern_str.empty() || pattern_str.back() != '%') return nullptr;
+    const absl::string_view prefix(pattern_str.data(), pattern_str.size() - 1);
+    if (prefix.find_first_of("%_\\") != absl::string_view::npos) {
+      return nullptr;
+    }
+    const Value prefix_value = pattern.type()->IsString()
+                                   ? Value::String(prefix)
+                                   : Value::Bytes(prefix);
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ConstExpr> prefix_expr,
+                     ConstExpr::Create(prefix_value));
+    std::vector<std::unique_ptr<ValueExpr>> args;
+    args.push_back(std::move(prefix_expr));
+    return ColumnPredicateArg::CreateLeaf(ColumnPredicate::kStartsWith,
+                                          column->first, column->second,
+                                          std::move(args));
+  }
+
+  if (name == "$in") {
+    ZETASQL_RET_CHECK_GE(function_call->argument_list_size(), 1);
+    const std::pair<VariableId, int>* column =
+        get_column(function_call->argument_list(0));
+    if (column == nullptr) return nullptr;
+    std::vector<std::unique_ptr<ValueExpr>> elements;
+    elements.reserve(function_call->argument_list_size() - 1);
+    for (int i = 1; i < function_call->argument_list_size(); ++i) {
+      const ResolvedExpr* element = function_call->argument_list(i);
+      ZETASQL_ASSIGN_OR_RETURN(const bool row_independent,
+                       is_row_independent(element));
+      if (!row_independent) return nullptr;
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> element_expr,
+                       AlgebrizeExpression(element));
+      elements.push_back(std::move(element_expr));
+    }
+    return ColumnPredicateArg::CreateLeaf(ColumnPredicate::kInList,
+                                          column->first, column->second,
+                                          std::move(elements));
+  }
+
+  ColumnPredicate::Kind kind;
+  ColumnPredicate::Kind flipped_kind;
+  if (name == "$equal") {
+    kind = ColumnPredicate::kEqual;
+    flipped_kind = ColumnPredicate::kEqual;
+  } else if (name == "$less") {
+    kind = ColumnPredicate::kLess;
+    flipped_kind = ColumnPredicate::kGreater;
+  } else if (name == "$less_or_equal") {
+    kind = ColumnPredicate::kLessOrEqual;
+    flipped_kind = ColumnPredicate::kGreaterOrEqual;
+  } else if (name == "$greater") {
+    kind = ColumnPredicate::kGreater;
+    flipped_kind = ColumnPredicate::kLess;
+  } else if (name == "$greater_or_equal") {
+    kind = ColumnPredicate::kGreaterOrEqual;
+    flipped_kind = ColumnPredicate::kLessOrEqual;
+  } else {
+    return nullptr;
+  }
+
+  ZETASQL_RET_CHECK_EQ(function_call->argument_list_size(), 2);
+  const ResolvedExpr* column_side = function_call->argument_list(0);
+  const ResolvedExpr* value_side = function_call->argument_list(1);
+  const std::pair<VariableId, int>* column = get_column(column_side);
+  if (column == nullptr) {
+    std::swap(column_side, value_side);
+    kind = flipped_kind;
+    column = get_column(column_side);
+    if (column == nullptr) return nullptr;
+  }
+  ZETASQL_ASSIGN_OR_RETURN(const bool row_independent, is_row_independent(value_side));
+  if (!row_independent) return nullptr;
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> value_expr,
+                   AlgebrizeExpression(value_side));
+  std::vector<std::unique_ptr<ValueExpr>> args;
+  args.push_back(std::move(value_expr));
+  return ColumnPredicateArg::CreateLeaf(kind, column->first, column->second,
+                                        std::move(args));
+}
+
+// Returns the ResolvedTableScan at the bottom of 'scan' if 'scan' only
+// consists of filters and projections over a table scan, or nullptr otherwise.
+static const ResolvedTableScan* GetPartitionableTableScan(
+    const ResolvedScan* scan) {
+  while (true) {
+    switch (scan->node_kind()) {
+      case RESOLVED_TABLE_SCAN:
+        return scan->GetAs<ResolvedTableScan>();
+      case RESOLVED_FILTER_SCAN:
+        scan = scan->GetAs<ResolvedFilterScan>()->input_scan();
+        break;
+      case RESOLVED_PROJECT_SCAN:
+        scan = scan->GetAs<ResolvedProjectScan>()->input_scan();
+        break;
+      default:
+        return nullptr;
+    }
+  }
+}
+
+zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::MaybeAddExchange(
+    const ResolvedScan* scan, std::unique_ptr<RelationalOp> rel_op,
+    int parallelism) {
+  if (!algebrizer_options_.use_exchange_operators && parallelism == 0) {
+    return rel_op;
+  }
+  const ResolvedTableScan* table_scan = GetPartitionableTableScan(scan);
+  if (table_scan == nullptr) return rel_op;
+  const EvaluatorTableScanOp* scan_op =
+      zetasql_base::FindPtrOrNull(table_scan_ops_, table_scan);
+  if (scan_op == nullptr) return rel_op;
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ExchangeOp> exchange_op,
+                   ExchangeOp::Create(std::move(rel_op), scan_op));
+  if (parallelism > 0) exchange_op->set_num_partitions(parallelism);
+  return std::unique_ptr<RelationalOp>(std::move(exchange_op));
+}
+
 // Returns true if any element of 'a' is in 'b'.
 static bool Intersects(const absl::flat_hash_set<ResolvedColumn>& a,
                        const absl::flat_hash_set<ResolvedColumn>& b) {
@@ -1582,14 +2680,27 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeWithS
   for (const auto& with_entry : scan->with_entry_list()) {
     ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> subquery,
                      AlgebrizeScan(with_entry->with_subquery()));
-    ZETASQL_ASSIGN_OR_RETURN(
-        std::unique_ptr<ArrayNestExpr> nested_subquery,
-        NestRelationInStruct(with_entry->with_subquery()->column_list(),
-                             std::move(subquery),
-                             /*is_with_table=*/true));
     const VariableId subquery_variable =
         variable_gen_->GetNewVariableName(with_entry->with_query_name());
-    ExprArg* arg = new ExprArg(subquery_variable, std::move(nested_subquery));
+    std::unique_ptr<ValueExpr> subquery_expr;
+    if (algebrizer_options_.materialize_with_tables) {
+      std::vector<VariableId> columns;
+      for (const ResolvedColumn& column :
+           with_entry->with_subquery()->column_list()) {
+        columns.push_back(
+            column_to_variable_->GetVariableNameFromColumn(&column));
+      }
+      ZETASQL_ASSIGN_OR_RETURN(subquery_expr, MaterializeWithTableExpr::Create(
+                                          subquery_variable, std::move(columns),
+                                          std::move(subquery)));
+    } else {
+      ZETASQL_ASSIGN_OR_RETURN(
+          subquery_expr,
+          NestRelationInStruct(with_entry->with_subquery()->column_list(),
+                               std::move(subquery),
+                               /*is_with_table=*/true));
+    }
+    ExprArg* arg = new ExprArg(subquery_variable, std::move(subquery_expr));
     // Record a mapping from subquery name to ExprArg.
     with_map_[with_entry->with_query_name()] = arg;
     with_subquery_let_assignments_.emplace_back(arg);  // Takes ownership.
@@ -1608,6 +2719,14 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeWithR
       with_map_.find(scan->GetAs<ResolvedWithRefScan>()->with_query_name());
   ZETASQL_RET_CHECK(it != with_map_.end());
   const ExprArg* arg = it->second;
+  if (algebrizer_options_.materialize_with_tables) {
+    std::vector<VariableId> columns;
+    for (const ResolvedColumn& column : scan->column_list()) {
+      columns.push_back(
+          column_to_variable_->GetVariableNameFromColumn(&column));
+    }
+    return WithRefScanOp::Create(arg->variable(), std::move(columns));
+  }
   ZETASQL_ASSIGN_OR_RETURN(
       auto deref_arg,
       DerefExpr::Create(arg->variable(), arg->value_expr()->output_type()));
@@ -1650,17 +2769,30 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeArray
 
     return AlgebrizeJoinScanInternal(
         join_kind, array_scan->join_expr(), array_scan->input_scan(),
-        right_output_columns, right_scan_algebrizer_cb, active_conjuncts);
+        right_output_columns, /*right_scan=*/nullptr, right_scan_algebrizer_cb,
+        ScanHints(), active_conjuncts);
+  }
+}
+
+// Returns true if 'expr' is a call to GENERATE_ARRAY, GENERATE_DATE_ARRAY or
+// GENERATE_TIMESTAMP_ARRAY whose elements ArrayScanOp can generate. SAFE
+// calls are excluded, because their errors must make the array NULL.
+static bool IsGeneratedArray(const ResolvedExpr* expr) {
+  if (expr->node_kind() != RESOLVED_FUNCTION_CALL) return false;
+  const ResolvedFunctionCall* call = expr->GetAs<ResolvedFunctionCall>();
+  if (!call->function()->IsZetaSQLBuiltin() ||
+      call->error_mode() != ResolvedFunctionCall::DEFAULT_ERROR_MODE) {
+    return false;
   }
+  const std::string name = call->function()->FullName(/*include_group=*/false);
+  return name == "generate_array" || name == "generate_date_array" ||
+         name == "generate_timestamp_array";
 }
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::AlgebrizeArrayScanWithoutJoin(
     const ResolvedArrayScan* array_scan,
     std::vector<FilterConjunctInfo*>* active_conjuncts) {
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> array,
-                   AlgebrizeExpression(array_scan->array_expr()));
-
   const VariableId array_element_in =
       column_to_variable_->GetVariableNameFromColumn(
           &array_scan->element_column());
@@ -1671,12 +2803,61 @@ Algebrizer::AlgebrizeArrayScanWithoutJoin(
         &array_scan->array_offset_column()->column());
   }
 
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> rel_op,
-                   ArrayScanOp::Create(array_element_in, array_position_in,
-                                       /*fields=*/{}, std::move(array)));
+  std::unique_ptr<RelationalOp> rel_op;
+  if (algebrizer_options_.generate_arrays_in_array_scans &&
+      IsGeneratedArray(array_scan->array_expr())) {
+    const ResolvedFunctionCall* call =
+        array_scan->array_expr()->GetAs<ResolvedFunctionCall>();
+    std::vector<std::unique_ptr<ValueExpr>> arguments;
+    for (const std::unique_ptr<const ResolvedExpr>& argument :
+         call->argument_list()) {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_argument,
+                       AlgebrizeExpression(argument.get()));
+      arguments.push_back(std::move(algebrized_argument));
+    }
+    ZETASQL_ASSIGN_OR_RETURN(
+        rel_op, ArrayScanOp::CreateForGeneratedArray(
+                    array_element_in, array_position_in,
+                    call->type()->AsArray(), std::move(arguments)));
+  } else {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> array,
+                     AlgebrizeExpression(array_scan->array_expr()));
+    ZETASQL_ASSIGN_OR_RETURN(rel_op,
+                     ArrayScanOp::Create(array_element_in, array_position_in,
+                                         /*fields=*/{}, std::move(array)));
+  }
   return MaybeApplyFilterConjuncts(std::move(rel_op), active_conjuncts);
 }
 
+// Returns 'expr' if it is a non-negative INT64 literal, or absl::nullopt.
+static absl::optional<int64_t> GetNonNegativeInt64Literal(
+    const ResolvedExpr* expr) {
+  if (expr == nullptr || expr->node_kind() != RESOLVED_LITERAL) {
+    return absl::nullopt;
+  }
+  const Value& value = expr->GetAs<ResolvedLiteral>()->value();
+  if (value.type_kind() != TYPE_INT64 || value.is_null() ||
+      value.int64_value() < 0) {
+    return absl::nullopt;
+  }
+  return value.int64_value();
+}
+
+// Returns the number of rows of its input that 'scan' reads, if its count and
+// offset are literals, or absl::nullopt.
+static absl::optional<int64_t> GetLimitMaxNumRows(
+    const ResolvedLimitOffsetScan* scan) {
+  const absl::optional<int64_t> limit =
+      GetNonNegativeInt64Literal(scan->limit());
+  const absl::optional<int64_t> offset =
+      scan->offset() == nullptr ? 0
+                                : GetNonNegativeInt64Literal(scan->offset());
+  if (!limit.has_value() || !offset.has_value()) return absl::nullopt;
+  return limit.value() > std::numeric_limits<int64_t>::max() - offset.value()
+             ? std::numeric_limits<int64_t>::max()
+             : limit.value() + offset.value();
+}
+
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::AlgebrizeLimitOffsetScan(const ResolvedLimitOffsetScan* scan) {
   ZETASQL_RET_CHECK(scan->limit() != nullptr);
@@ -1699,11 +2880,117 @@ Algebrizer::AlgebrizeLimitOffsetScan(const ResolvedLimitOffsetScan* scan) {
   } else {
     ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> input,
                      AlgebrizeScan(scan->input_scan()));
+    if (algebrizer_options_.push_limits_into_scans) {
+      const absl::optional<int64_t> max_num_rows = GetLimitMaxNumRows(scan);
+      if (max_num_rows.has_value()) {
+        AddRowLimitHints(scan->input_scan(), max_num_rows.value());
+      }
+    }
     return LimitOp::Create(std::move(limit), std::move(offset),
                            std::move(input), scan->is_ordered());
   }
 }
 
+zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
+Algebrizer::AlgebrizeSampleScan(const ResolvedSampleScan* scan) {
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> input,
+                   AlgebrizeScan(scan->input_scan()));
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> size,
+                   AlgebrizeExpression(scan->size()));
+  std::unique_ptr<ValueExpr> repeatable;
+  if (scan->repeatable_argument() != nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(repeatable,
+                     AlgebrizeExpression(scan->repeatable_argument()));
+  }
+  std::vector<std::unique_ptr<ExprArg>> partition_keys;
+  for (const std::unique_ptr<const ResolvedExpr>& partition_by :
+       scan->partition_by_list()) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> key,
+                     AlgebrizeExpression(partition_by.get()));
+    partition_keys.push_back(absl::make_unique<ExprArg>(std::move(key)));
+  }
+  VariableId weight;
+  if (scan->weight_column() != nullptr) {
+    weight = column_to_variable_->GetVariableNameFromColumn(
+        &scan->weight_column()->column());
+  }
+
+  const bool is_percent = scan->unit() == ResolvedSampleScan::PERCENT;
+  SampleScanOp::Method method;
+  if (scan->method() == "system" && is_percent) {
+    // Storage may skip whole blocks of an unweighted table scan. Elsewhere
+    // SYSTEM sampling is the same as BERNOULLI.
+    EvaluatorTableScanOp* scan_op =
+        scan->input_scan()->node_kind() == RESOLVED_TABLE_SCAN
+            ? zetasql_base::FindPtrOrNull(
+                  table_scan_ops_,
+                  scan->input_scan()->GetAs<ResolvedTableScan>())
+            : nullptr;
+    if (scan_op != nullptr && !weight.is_valid()) {
+      scan_op->SetBlockSample(std::move(size), std::move(repeatable));
+      return input;
+    }
+    method = SampleScanOp::kBernoulli;
+  } else if (scan->method() == "bernoulli" && is_percent) {
+    method = SampleScanOp::kBernoulli;
+  } else if (scan->method() == "reservoir" && !is_percent) {
+    method = SampleScanOp::kReservoir;
+  } else {
+    return ::zetasql_base::UnimplementedErrorBuilder()
+           << "Unsupported TABLESAMPLE method " << scan->method() << " with "
+           << (is_percent ? "PERCENT" : "ROWS");
+  }
+  return SampleScanOp::Create(method, std::move(size), std::move(repeatable),
+                              std::move(partition_keys), weight,
+                              std::move(input));
+}
+
+void Algebrizer::AddRowLimitHints(const ResolvedScan* scan,
+                                  int64_t max_num_rows) {
+  switch (scan->node_kind()) {
+    case RESOLVED_TABLE_SCAN: {
+      EvaluatorTableScanOp* scan_op = zetasql_base::FindPtrOrNull(
+          table_scan_ops_, scan->GetAs<ResolvedTableScan>());
+      if (scan_op != nullptr) scan_op->AddRowLimitHint(max_num_rows);
+      break;
+    }
+    case RESOLVED_PROJECT_SCAN:
+      AddRowLimitHints(scan->GetAs<ResolvedProjectScan>()->input_scan(),
+                       max_num_rows);
+      break;
+    case RESOLVED_SET_OPERATION_SCAN: {
+      // Each input of a UNION ALL may produce all of the rows.
+      const ResolvedSetOperationScan* set_scan =
+          scan->GetAs<ResolvedSetOperationScan>();
+      if (set_scan->op_type() != ResolvedSetOperationScan::UNION_ALL) break;
+      for (const std::unique_ptr<const ResolvedSetOperationItem>& item :
+           set_scan->input_item_list()) {
+        AddRowLimitHints(item->scan(), max_num_rows);
+      }
+      break;
+    }
+    case RESOLVED_LIMIT_OFFSET_SCAN: {
+      const ResolvedLimitOffsetScan* limit_scan =
+          scan->GetAs<ResolvedLimitOffsetScan>();
+      const absl::optional<int64_t> offset =
+          limit_scan->offset() == nullptr
+              ? 0
+              : GetNonNegativeInt64Literal(limit_scan->offset());
+      if (!offset.has_value()) break;
+      AddRowLimitHints(
+          limit_scan->input_scan(),
+          max_num_rows > std::numeric_limits<int64_t>::max() - offset.value()
+              ? std::numeric_limits<int64_t>::max()
+              : max_num_rows + offset.value());
+      break;
+    }
+    default:
+      // Filters, joins, aggregations and sorts may need more input rows than
+      // they produce.
+      break;
+  }
+}
+
 zetasql_base::Status Algebrizer::AddFilterConjunctsTo(
     const ResolvedExpr* expr,
     std::vector<std::unique_ptr<FilterConjunctInfo>>* conjunct_infos) {
@@ -1726,9 +3013,116 @@ zetasql_base::Status Algebrizer::AddFilterConjunctsTo(
     }
   }
 
-  ZETASQL_ASSIGN_OR_RETURN(auto conjunct_info, FilterConjunctInfo::Create(expr));
-  conjunct_infos->push_back(std::move(conjunct_info));
-  return zetasql_base::OkStatus();
+  ZETASQL_ASSIGN_OR_RETURN(auto conjunct_info, FilterConjunctInfo::Create(expr));
+  conjunct_infos->push_back(std::move(conjunct_info));
+  return zetasql_base::OkStatus();
+}
+
+// Returns an estimate of the number of rows that 'scan' produces, based on
+// Table::GetRowCountEstimate(), or absl::nullopt if there is no estimate.
+static absl::optional<int64_t> EstimateRowCount(const ResolvedScan* scan) {
+  switch (scan->node_kind()) {
+    case RESOLVED_TABLE_SCAN: {
+      const std::optional<int64_t> estimate =
+          scan->GetAs<ResolvedTableScan>()->table()->GetRowCountEstimate();
+      if (!estimate.has_value()) return absl::nullopt;
+      return estimate.value();
+    }
+    case RESOLVED_SINGLE_ROW_SCAN:
+      return 1;
+    case RESOLVED_FILTER_SCAN:
+      return EstimateRowCount(scan->GetAs<ResolvedFilterScan>()->input_scan());
+    case RESOLVED_PROJECT_SCAN:
+      return EstimateRowCount(scan->GetAs<ResolvedProjectScan>()->input_scan());
+    case RESOLVED_ORDER_BY_SCAN:
+      return EstimateRowCount(scan->GetAs<ResolvedOrderByScan>()->input_scan());
+    case RESOLVED_ANALYTIC_SCAN:
+      return EstimateRowCount(
+          scan->GetAs<ResolvedAnalyticScan>()->input_scan());
+    case RESOLVED_AGGREGATE_SCAN: {
+      const ResolvedAggregateScan* aggregate_scan =
+          scan->GetAs<ResolvedAggregateScan>();
+      if (aggregate_scan->group_by_list().empty()) return 1;
+      return EstimateRowCount(aggregate_scan->input_scan());
+    }
+    case RESOLVED_LIMIT_OFFSET_SCAN: {
+      const ResolvedLimitOffsetScan* limit_scan =
+          scan->GetAs<ResolvedLimitOffsetScan>();
+      const absl::optional<int64_t> input_estimate =
+          EstimateRowCount(limit_scan->input_scan());
+      if (limit_scan->limit()->node_kind() != RESOLVED_LITERAL) {
+        return input_estimate;
+      }
+      const Value& limit =
+          limit_scan->limit()->GetAs<ResolvedLiteral>()->value();
+      if (limit.is_null() || !limit.type()->IsInt64()) return input_estimate;
+      if (input_estimate.has_value()) {
+        return std::min(limit.int64_value(), input_estimate.value());
+      }
+      return limit.int64_value();
+    }
+    case RESOLVED_JOIN_SCAN: {
+      const ResolvedJoinScan* join_scan = scan->GetAs<ResolvedJoinScan>();
+      const absl::optional<int64_t> left =
+          EstimateRowCount(join_scan->left_scan());
+      const absl::optional<int64_t> right =
+          EstimateRowCount(join_scan->right_scan());
+      if (!left.has_value() || !right.has_value()) return absl::nullopt;
+      // Assume that a join with a condition matches each row of the larger
+      // input with about one row of the other input.
+      if (join_scan->join_expr() != nullptr) {
+        return std::max(left.value(), right.value());
+      }
+      if (right.value() != 0 &&
+          left.value() > std::numeric_limits<int64_t>::max() / right.value()) {
+        return std::numeric_limits<int64_t>::max();
+      }
+      return left.value() * right.value();
+    }
+    default:
+      return absl::nullopt;
+  }
+}
+
+// Returns the columns of 'scan' that its rows are sorted on according to
+// Table::GetSortOrder(), in order. Only follows filters and projections, which
+// keep the order of their input.
+static std::vector<ResolvedColumn> GetSortColumns(const ResolvedScan* scan) {
+  std::vector<ResolvedColumn> sort_columns;
+  switch (scan->node_kind()) {
+    case RESOLVED_TABLE_SCAN: {
+      const ResolvedTableScan* table_scan = scan->GetAs<ResolvedTableScan>();
+      const std::optional<std::vector<int>> sort_order =
+          table_scan->table()->GetSortOrder();
+      if (!sort_order.has_value()) break;
+      const std::vector<int>& column_index_list =
+          table_scan->column_index_list();
+      for (const int column_index : sort_order.value()) {
+        const auto it = std::find(column_index_list.begin(),
+                                  column_index_list.end(), column_index);
+        // The order is only useful up to the first column the scan omits.
+        if (it == column_index_list.end()) break;
+        sort_columns.push_back(
+            table_scan->column_list(it - column_index_list.begin()));
+      }
+      break;
+    }
+    case RESOLVED_FILTER_SCAN:
+      return GetSortColumns(scan->GetAs<ResolvedFilterScan>()->input_scan());
+    case RESOLVED_PROJECT_SCAN: {
+      const absl::flat_hash_set<ResolvedColumn> output_columns(
+          scan->column_list().begin(), scan->column_list().end());
+      for (const ResolvedColumn& column : GetSortColumns(
+               scan->GetAs<ResolvedProjectScan>()->input_scan())) {
+        if (!output_columns.contains(column)) break;
+        sort_columns.push_back(column);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return sort_columns;
 }
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeJoinScan(
@@ -1750,14 +3144,21 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeJoinS
       break;
   }
 
+  ZETASQL_ASSIGN_OR_RETURN(const ScanHints hints, GetScanHints(join_scan));
   const ResolvedScan* right_scan = join_scan->right_scan();
   auto right_scan_algebrizer_cb =
-      [this, right_scan](std::vector<FilterConjunctInfo*>* active_conjuncts) {
-        return AlgebrizeScan(right_scan, active_conjuncts);
+      [this, right_scan,
+       &hints](std::vector<FilterConjunctInfo*>* active_conjuncts)
+      -> zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> {
+        ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> right,
+                         AlgebrizeScan(right_scan, active_conjuncts));
+        return MaybeAddExchange(right_scan, std::move(right),
+                                hints.parallelism);
       };
   return AlgebrizeJoinScanInternal(
       join_kind, join_scan->join_expr(), join_scan->left_scan(),
-      right_scan->column_list(), right_scan_algebrizer_cb, active_conjuncts);
+      right_scan->column_list(), right_scan, right_scan_algebrizer_cb, hints,
+      active_conjuncts);
 }
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
@@ -1765,7 +3166,9 @@ Algebrizer::AlgebrizeJoinScanInternal(
     JoinOp::JoinKind join_kind, const ResolvedExpr* join_expr,
     const ResolvedScan* left_scan,
     const std::vector<ResolvedColumn>& right_output_column_list,
+    const ResolvedScan* right_scan,
     const RightScanAlgebrizerCb& right_scan_algebrizer_cb,
+    const ScanHints& hints,
     std::vector<FilterConjunctInfo*>* active_conjuncts) {
   std::vector<std::unique_ptr<FilterConjunctInfo>> conjunct_infos;
   if (join_expr != nullptr) {
@@ -1851,6 +3254,8 @@ Algebrizer::AlgebrizeJoinScanInternal(
   // 'right_conjuncts_with_push_down' may overlap.
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> left,
                    AlgebrizeScan(left_scan, &left_conjuncts_with_push_down));
+  ZETASQL_ASSIGN_OR_RETURN(left, MaybeAddExchange(left_scan, std::move(left),
+                                          hints.parallelism));
   for (FilterConjunctInfo* info : left_conjuncts_with_push_down) {
     ZETASQL_RET_CHECK(info->redundant);
     info->redundant = false;
@@ -1872,9 +3277,12 @@ Algebrizer::AlgebrizeJoinScanInternal(
     info->redundant = true;
   }
 
-  // Incorporate conjuncts into the hash join where allowed/possible.
+  // Incorporate conjuncts into the hash join where allowed/possible. A
+  // join_method hint overrides the options.
   std::vector<JoinOp::HashJoinEqualityExprs> hash_join_equality_exprs;
-  if (algebrizer_options_.allow_hash_join) {
+  if (hints.join_method.has_value()
+          ? hints.join_method != ScanHints::kNestedLoopJoin
+          : algebrizer_options_.allow_hash_join) {
     switch (join_kind) {
       case JoinOp::kInnerJoin:
       case JoinOp::kLeftOuterJoin:
@@ -1892,19 +3300,52 @@ Algebrizer::AlgebrizeJoinScanInternal(
     }
   }
 
+  if (hints.join_method.has_value() &&
+      hints.join_method != ScanHints::kNestedLoopJoin &&
+      hash_join_equality_exprs.empty()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Hint " << kJoinMethodHint
+           << " requires an equality between the inputs in the join condition";
+  }
+
+  int num_merge_join_keys = 0;
+  if ((hints.join_method.has_value()
+           ? hints.join_method == ScanHints::kMergeJoin
+           : algebrizer_options_.allow_merge_join &&
+                 !hints.build_side.has_value()) &&
+      (join_kind == JoinOp::kInnerJoin ||
+       join_kind == JoinOp::kLeftOuterJoin) &&
+      !hash_join_equality_exprs.empty() && right_scan != nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(num_merge_join_keys,
+                     OrderHashJoinEqualityExprsForMergeJoin(
+                         GetSortColumns(left_scan), GetSortColumns(right_scan),
+                         &hash_join_equality_exprs));
+  }
+  if (hints.join_method == ScanHints::kMergeJoin && num_merge_join_keys == 0) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Hint " << kJoinMethodHint
+           << "=MERGE requires an INNER or LEFT join of inputs that are "
+              "sorted by the join keys";
+  }
+
   // Algebrize all of the non-redundant remaining conjuncts for use in the join
   // condition. Iterate in reverse order to de-stackify the ordering.
-  std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts;
+  std::vector<const ResolvedExpr*> remaining_conjuncts;
   for (auto i = join_condition_conjuncts_with_push_down.rbegin();
        i != join_condition_conjuncts_with_push_down.rend(); ++i) {
     FilterConjunctInfo* conjunct_info = *i;
     if (!conjunct_info->redundant) {
-      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_conjunct,
-                       AlgebrizeExpression(conjunct_info->conjunct));
-      algebrized_conjuncts.push_back(std::move(algebrized_conjunct));
+      remaining_conjuncts.push_back(conjunct_info->conjunct);
       conjunct_info->redundant = true;
     }
   }
+  MaybeOrderConjunctsByCost(&remaining_conjuncts);
+  std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts;
+  for (const ResolvedExpr* conjunct : remaining_conjuncts) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_conjunct,
+                     AlgebrizeFilterConjunct(conjunct));
+    algebrized_conjuncts.push_back(std::move(algebrized_conjunct));
+  }
 
   // Algebrize the join condition using the algebrized conjuncts.
   std::unique_ptr<ValueExpr> remaining_join_expr;
@@ -1943,6 +3384,54 @@ Algebrizer::AlgebrizeJoinScanInternal(
       break;
   }
 
+  // JoinOp loads its right input into memory, so make the input that is
+  // estimated to be smaller the right one, unless a build_side hint chooses
+  // it. Commuting the inputs of an uncorrelated join does not change its
+  // result. A merge join only keeps part of its right input in memory, so it
+  // keeps the sorted inputs as they are.
+  const ResolvedScan* probe_scan = left_scan;  // May be NULL
+  if (num_merge_join_keys == 0 && right_scan != nullptr &&
+      join_kind != JoinOp::kCrossApply && join_kind != JoinOp::kOuterApply) {
+    bool build_left = false;
+    if (hints.build_side.has_value()) {
+      build_left = hints.build_side == ScanHints::kBuildLeft;
+    } else if (algebrizer_options_.use_row_count_estimates) {
+      const absl::optional<int64_t> left_row_count_estimate =
+          EstimateRowCount(left_scan);
+      const absl::optional<int64_t> right_row_count_estimate =
+          EstimateRowCount(right_scan);
+      build_left =
+          left_row_count_estimate.has_value() &&
+          right_row_count_estimate.has_value() &&
+          right_row_count_estimate.value() > left_row_count_estimate.value();
+    }
+    if (build_left) {
+      probe_scan = right_scan;
+      std::swap(left, right);
+      std::swap(left_output, right_output);
+      for (JoinOp::HashJoinEqualityExprs& exprs : hash_join_equality_exprs) {
+        std::swap(exprs.left_expr, exprs.right_expr);
+      }
+      if (join_kind == JoinOp::kLeftOuterJoin) {
+        join_kind = JoinOp::kRightOuterJoin;
+      } else if (join_kind == JoinOp::kRightOuterJoin) {
+        join_kind = JoinOp::kLeftOuterJoin;
+      }
+    }
+  }
+
+  std::vector<BuildKeysColumnFilter> build_keys_column_filters;
+  if (algebrizer_options_.push_build_keys_into_scans &&
+      num_merge_join_keys == 0 &&
+      (join_kind == JoinOp::kInnerJoin ||
+       join_kind == JoinOp::kRightOuterJoin)) {
+    ZETASQL_ASSIGN_OR_RETURN(build_keys_column_filters,
+                     FindBuildKeysColumnFilters(probe_scan,
+                                                hash_join_equality_exprs));
+    SetKeyLookupColumns(build_keys_column_filters,
+                        probe_scan == left_scan ? right_scan : left_scan);
+  }
+
   // Algebrize the join.
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<RelationalOp> join_op,
@@ -1950,6 +3439,12 @@ Algebrizer::AlgebrizeJoinScanInternal(
                      std::move(remaining_join_expr), std::move(left),
                      std::move(right), std::move(left_output),
                      std::move(right_output)));
+  if (num_merge_join_keys > 0) {
+    ZETASQL_RETURN_IF_ERROR(static_cast<JoinOp*>(join_op.get())
+                        ->set_num_merge_join_keys(num_merge_join_keys));
+  }
+  ZETASQL_RETURN_IF_ERROR(AddBuildKeysColumnFilters(
+      build_keys_column_filters, static_cast<JoinOp*>(join_op.get())));
 
   return join_op;
 }
@@ -2121,6 +3616,210 @@ zetasql_base::Status Algebrizer::AlgebrizeJoinConditionForHashJoin(
   return zetasql_base::OkStatus();
 }
 
+zetasql_base::StatusOr<int> Algebrizer::OrderHashJoinEqualityExprsForMergeJoin(
+    const std::vector<ResolvedColumn>& left_sort_columns,
+    const std::vector<ResolvedColumn>& right_sort_columns,
+    std::vector<JoinOp::HashJoinEqualityExprs>* hash_join_equality_exprs) {
+  int num_merge_keys = 0;
+  while (num_merge_keys < left_sort_columns.size() &&
+         num_merge_keys < right_sort_columns.size()) {
+    ZETASQL_ASSIGN_OR_RETURN(const VariableId left_var,
+                     column_to_variable_->LookupVariableNameForColumn(
+                         &left_sort_columns[num_merge_keys]));
+    ZETASQL_ASSIGN_OR_RETURN(const VariableId right_var,
+                     column_to_variable_->LookupVariableNameForColumn(
+                         &right_sort_columns[num_merge_keys]));
+    bool found = false;
+    for (int i = num_merge_keys; i < hash_join_equality_exprs->size(); ++i) {
+      JoinOp::HashJoinEqualityExprs& exprs = (*hash_join_equality_exprs)[i];
+      const DerefExpr* left_deref =
+          dynamic_cast<const DerefExpr*>(exprs.left_expr->value_expr());
+      const DerefExpr* right_deref =
+          dynamic_cast<const DerefExpr*>(exprs.right_expr->value_expr());
+      if (left_deref == nullptr || right_deref == nullptr ||
+          left_deref->name() != left_var || right_deref->name() != right_var) {
+        continue;
+      }
+      // Both inputs must be sorted the same way.
+      const Type* type = exprs.left_expr->type();
+      if (!type->Equals(exprs.right_expr->type()) ||
+          !type->SupportsOrdering(language_options_,
+                                  /*type_description=*/nullptr)) {
+        continue;
+      }
+      std::swap(exprs, (*hash_join_equality_exprs)[num_merge_keys]);
+      found = true;
+      break;
+    }
+    if (!found) break;
+    ++num_merge_keys;
+  }
+  return num_merge_keys;
+}
+
+// Returns the table scan in 'scan' that 'column' comes from and populates
+// 'column_idx' with the index of 'column' in it, if every row of 'scan' with a
+// given value of 'column' comes from a row of the table scan with that value.
+// Else returns NULL.
+static const ResolvedTableScan* FindTableScanOfColumn(
+    const ResolvedScan* scan, const ResolvedColumn& column, int* column_idx) {
+  const std::vector<ResolvedColumn>& columns = scan->column_list();
+  const auto it = std::find(columns.begin(), columns.end(), column);
+  if (it == columns.end()) return nullptr;
+  switch (scan->node_kind()) {
+    case RESOLVED_TABLE_SCAN:
+      *column_idx = static_cast<int>(it - columns.begin());
+      return scan->GetAs<ResolvedTableScan>();
+    case RESOLVED_FILTER_SCAN:
+      return FindTableScanOfColumn(
+          scan->GetAs<ResolvedFilterScan>()->input_scan(), column, column_idx);
+    case RESOLVED_PROJECT_SCAN:
+      return FindTableScanOfColumn(
+          scan->GetAs<ResolvedProjectScan>()->input_scan(), column,
+          column_idx);
+    case RESOLVED_JOIN_SCAN: {
+      const ResolvedJoinScan* join_scan = scan->GetAs<ResolvedJoinScan>();
+      const ResolvedTableScan* table_scan =
+          FindTableScanOfColumn(join_scan->left_scan(), column, column_idx);
+      if (table_scan != nullptr) return table_scan;
+      return FindTableScanOfColumn(join_scan->right_scan(), column,
+                                   column_idx);
+    }
+    default:
+      return nullptr;
+  }
+}
+
+zetasql_base::StatusOr<std::vector<Algebrizer::BuildKeysColumnFilter>>
+Algebrizer::FindBuildKeysColumnFilters(
+    const ResolvedScan* probe_scan,
+    const std::vector<JoinOp::HashJoinEqualityExprs>&
+        hash_join_equality_exprs) {
+  std::vector<BuildKeysColumnFilter> filters;
+  if (probe_scan == nullptr) return filters;
+  for (int i = 0; i < hash_join_equality_exprs.size(); ++i) {
+    const JoinOp::HashJoinEqualityExprs& exprs = hash_join_equality_exprs[i];
+    const DerefExpr* left_deref =
+        dynamic_cast<const DerefExpr*>(exprs.left_expr->value_expr());
+    const Type* key_type = exprs.left_expr->type();
+    if (left_deref == nullptr || !key_type->Equals(exprs.right_expr->type()) ||
+        !key_type->SupportsOrdering(language_options_,
+                                    /*type_description=*/nullptr)) {
+      continue;
+    }
+    for (const ResolvedColumn& column : probe_scan->column_list()) {
+      const zetasql_base::StatusOr<VariableId> variable =
+          column_to_variable_->LookupVariableNameForColumn(&column);
+      if (!variable.ok() || variable.ValueOrDie() != left_deref->name()) {
+        continue;
+      }
+      int column_idx = -1;
+      const ResolvedTableScan* table_scan =
+          FindTableScanOfColumn(probe_scan, column, &column_idx);
+      EvaluatorTableScanOp* scan_op =
+          table_scan == nullptr
+              ? nullptr
+              : zetasql_base::FindPtrOrNull(table_scan_ops_, table_scan);
+      if (scan_op != nullptr) {
+        filters.push_back({i, scan_op, table_scan, column_idx,
+                           left_deref->name(), key_type});
+      }
+      break;
+    }
+  }
+  return filters;
+}
+
+void Algebrizer::SetKeyLookupColumns(
+    const std::vector<BuildKeysColumnFilter>& filters,
+    const ResolvedScan* build_scan) {
+  if (!algebrizer_options_.use_key_lookups_for_joins) return;
+  const absl::optional<int64_t> build_row_count =
+      build_scan == nullptr ? absl::nullopt : EstimateRowCount(build_scan);
+  if (build_row_count.has_value() &&
+      build_row_count.value() > EvaluatorTableScanOp::kMaxKeyLookups) {
+    return;
+  }
+  // The filtered columns of a table scan, keyed on their index in the table,
+  // with their index in the scan.
+  struct FilteredColumns {
+    const ResolvedTableScan* table_scan = nullptr;
+    absl::flat_hash_map<int, int> columns;
+  };
+  absl::flat_hash_map<EvaluatorTableScanOp*, FilteredColumns>
+      filtered_columns_of_scan;
+  for (const BuildKeysColumnFilter& filter : filters) {
+    FilteredColumns& filtered_columns =
+        filtered_columns_of_scan[filter.scan_op];
+    filtered_columns.table_scan = filter.table_scan;
+    filtered_columns.columns.emplace(
+        filter.table_scan->column_index_list(filter.column_idx),
+        filter.column_idx);
+  }
+  for (const auto& entry : filtered_columns_of_scan) {
+    const FilteredColumns& filtered_columns = entry.second;
+    const Table* table = filtered_columns.table_scan->table();
+    const std::optional<std::vector<int>> primary_key = table->PrimaryKey();
+    if (!table->SupportsEvaluatorKeyLookups() || !primary_key.has_value()) {
+      continue;
+    }
+    // Looking up each row of the build side is no better than a scan if it
+    // has more rows than the table.
+    const std::optional<int64_t> table_row_count =
+        table->GetRowCountEstimate();
+    if (build_row_count.has_value() && table_row_count.has_value() &&
+        build_row_count.value() >= table_row_count.value()) {
+      continue;
+    }
+    std::vector<int> key_column_idxs;
+    for (const int table_column_idx : primary_key.value()) {
+      const int* column_idx =
+          zetasql_base::FindOrNull(filtered_columns.columns, table_column_idx);
+      // Floating point keys are not looked up, since equal values (e.g., 0 and
+      // -0) may not be identical.
+      if (column_idx == nullptr || table->GetColumn(table_column_idx)
+                                       ->GetType()
+                                       ->IsFloatingPoint()) {
+        key_column_idxs.clear();
+        break;
+      }
+      key_column_idxs.push_back(*column_idx);
+    }
+    if (!key_column_idxs.empty()) {
+      entry.first->SetKeyLookupColumns(std::move(key_column_idxs));
+    }
+  }
+}
+
+zetasql_base::Status Algebrizer::AddBuildKeysColumnFilters(
+    const std::vector<BuildKeysColumnFilter>& filters, JoinOp* join_op) {
+  for (const BuildKeysColumnFilter& filter : filters) {
+    const ArrayType* keys_type;
+    ZETASQL_RETURN_IF_ERROR(type_factory_->MakeArrayType(filter.key_type, &keys_type));
+    const VariableId keys = variable_gen_->GetNewVariableName("build_keys");
+    const VariableId min_key =
+        variable_gen_->GetNewVariableName("min_build_key");
+    const VariableId max_key =
+        variable_gen_->GetNewVariableName("max_build_key");
+    ZETASQL_RETURN_IF_ERROR(join_op->AddBuildKeysParameter(
+        filter.equality_expr_idx, keys, min_key, max_key, keys_type));
+
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> keys_expr,
+                     DerefExpr::Create(keys, keys_type));
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> min_key_expr,
+                     DerefExpr::Create(min_key, filter.key_type));
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> max_key_expr,
+                     DerefExpr::Create(max_key, filter.key_type));
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<ColumnFilterArg> column_filter,
+        BuildKeysColumnFilterArg::Create(
+            filter.column_variable, filter.column_idx, std::move(keys_expr),
+            std::move(min_key_expr), std::move(max_key_expr)));
+    filter.scan_op->AddColumnFilter(std::move(column_filter));
+  }
+  return zetasql_base::OkStatus();
+}
+
 // Returns true if 'a' is a subset of 'b'.
 static bool IsSubsetOf(const absl::flat_hash_set<ResolvedColumn>& a,
                        const absl::flat_hash_set<ResolvedColumn>& b) {
@@ -2223,14 +3922,17 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeFilte
   }
 
   // Drop any FilterConjunctInfos that are now redundant.
-  std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts;
-  algebrized_conjuncts.reserve(conjunct_infos.size());
+  std::vector<const ResolvedExpr*> remaining_conjuncts;
   for (std::unique_ptr<FilterConjunctInfo>& info : conjunct_infos) {
-    if (!info->redundant) {
-      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_conjunct,
-                       AlgebrizeExpression(info->conjunct));
-      algebrized_conjuncts.push_back(std::move(algebrized_conjunct));
-    }
+    if (!info->redundant) remaining_conjuncts.push_back(info->conjunct);
+  }
+  MaybeOrderConjunctsByCost(&remaining_conjuncts);
+  std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts;
+  algebrized_conjuncts.reserve(remaining_conjuncts.size());
+  for (const ResolvedExpr* conjunct : remaining_conjuncts) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_conjunct,
+                     AlgebrizeFilterConjunct(conjunct));
+    algebrized_conjuncts.push_back(std::move(algebrized_conjunct));
   }
 
   // Algebrize the filter.
@@ -2238,6 +3940,19 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeFilte
                                         std::move(algebrized_conjuncts));
 }
 
+zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeFilterConjunct(
+    const ResolvedExpr* conjunct) {
+  if (!algebrizer_options_.defer_proto_field_reads) {
+    return AlgebrizeExpression(conjunct);
+  }
+  const bool original_in_filter_conjunct = in_filter_conjunct_;
+  in_filter_conjunct_ = true;
+  zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> algebrized_conjunct =
+      AlgebrizeExpression(conjunct);
+  in_filter_conjunct_ = original_in_filter_conjunct;
+  return algebrized_conjunct;
+}
+
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::ApplyAlgebrizedFilterConjuncts(
     std::unique_ptr<RelationalOp> input,
@@ -2247,29 +3962,36 @@ Algebrizer::ApplyAlgebrizedFilterConjuncts(
     // No FilterOp needed, just use the input directly.
     rel_op = std::move(input);
   } else {
-    std::unique_ptr<ValueExpr> filter;
-    if (algebrized_conjuncts.size() == 1) {
-      filter = std::move(algebrized_conjuncts[0]);
-    } else {
-      ZETASQL_ASSIGN_OR_RETURN(
-          filter, BuiltinScalarFunction::CreateCall(
-                      FunctionKind::kAnd, language_options_, types::BoolType(),
-                      std::move(algebrized_conjuncts),
-                      ResolvedFunctionCallBase::DEFAULT_ERROR_MODE));
-    }
-
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> filter,
+                     CombineFilterConjuncts(std::move(algebrized_conjuncts)));
     ZETASQL_ASSIGN_OR_RETURN(rel_op,
                      FilterOp::Create(std::move(filter), std::move(input)));
   }
   return rel_op;
 }
 
+zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::CombineFilterConjuncts(
+    std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts) {
+  ZETASQL_RET_CHECK(!algebrized_conjuncts.empty());
+  if (algebrized_conjuncts.size() == 1) {
+    return std::move(algebrized_conjuncts[0]);
+  }
+  return BuiltinScalarFunction::CreateCall(
+      FunctionKind::kAnd, language_options_, types::BoolType(),
+      std::move(algebrized_conjuncts),
+      ResolvedFunctionCallBase::DEFAULT_ERROR_MODE);
+}
+
 zetasql_base::StatusOr<std::unique_ptr<AggregateOp>>
 Algebrizer::AlgebrizeAggregateScan(
     const ResolvedAggregateScan* aggregate_scan) {
+  ZETASQL_ASSIGN_OR_RETURN(const ScanHints hints, GetScanHints(aggregate_scan));
   // Algebrize the relational input of the aggregate.
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> input,
                    AlgebrizeScan(aggregate_scan->input_scan()));
+  ZETASQL_ASSIGN_OR_RETURN(input, MaybeAddExchange(aggregate_scan->input_scan(),
+                                           std::move(input),
+                                           hints.parallelism));
   // Build the list of grouping keys.
   std::vector<std::unique_ptr<KeyArg>> keys;
   for (const std::unique_ptr<const ResolvedComputedColumn>& key_expr :
@@ -2313,28 +4035,190 @@ Algebrizer::AlgebrizeAggregateScan(
                              std::move(input));
 }
 
+// Returns true if 'a' and 'b' partition by the same columns, in the same
+// order. Either can be nullptr, which is the same as an empty partitioning.
+static bool PartitioningsAreEqual(const ResolvedWindowPartitioning* a,
+                                  const ResolvedWindowPartitioning* b) {
+  const int a_size = a == nullptr ? 0 : a->partition_by_list_size();
+  const int b_size = b == nullptr ? 0 : b->partition_by_list_size();
+  if (a_size != b_size) return false;
+  for (int i = 0; i < a_size; ++i) {
+    const ResolvedColumnRef* a_ref = a->partition_by_list(i);
+    const ResolvedColumnRef* b_ref = b->partition_by_list(i);
+    if (!(a_ref->column() == b_ref->column()) ||
+        a_ref->is_correlated() != b_ref->is_correlated()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if the items of 'prefix' are a prefix of the items of
+// 'ordering', and none of them has a collation. Either can be nullptr, which
+// is the same as an empty ordering.
+static bool IsOrderingPrefix(const ResolvedWindowOrdering* prefix,
+                             const ResolvedWindowOrdering* ordering) {
+  const int prefix_size =
+      prefix == nullptr ? 0 : prefix->order_by_item_list_size();
+  const int ordering_size =
+      ordering == nullptr ? 0 : ordering->order_by_item_list_size();
+  if (prefix_size > ordering_size) return false;
+  for (int i = 0; i < prefix_size; ++i) {
+    const ResolvedOrderByItem* prefix_item = prefix->order_by_item_list(i);
+    const ResolvedOrderByItem* item = ordering->order_by_item_list(i);
+    const ResolvedColumnRef* prefix_ref = prefix_item->column_ref();
+    const ResolvedColumnRef* ref = item->column_ref();
+    if (prefix_item->collation_name() != nullptr ||
+        item->collation_name() != nullptr ||
+        !(prefix_ref->column() == ref->column()) ||
+        prefix_ref->is_correlated() != ref->is_correlated() ||
+        prefix_item->is_descending() != item->is_descending() ||
+        prefix_item->null_order() != item->null_order()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the analytic function groups of 'analytic_scan' in sets that can be
+// evaluated over one sorted input. If 'share_sorts' is false, each set has a
+// single group. Otherwise, the groups of a set have the same partitioning and
+// their orderings are prefixes of the ordering of the first group of the set.
+// Sorting by the partitioning and ordering of the first group then also sorts
+// the input for the other groups.
+static std::vector<std::vector<const ResolvedAnalyticFunctionGroup*>>
+GroupAnalyticFunctionGroups(const ResolvedAnalyticScan* analytic_scan,
+                            bool share_sorts) {
+  std::vector<std::vector<const ResolvedAnalyticFunctionGroup*>> group_sets;
+  for (const std::unique_ptr<const ResolvedAnalyticFunctionGroup>& group :
+       analytic_scan->function_group_list()) {
+    std::vector<const ResolvedAnalyticFunctionGroup*>* group_set = nullptr;
+    if (share_sorts) {
+      for (std::vector<const ResolvedAnalyticFunctionGroup*>& candidate :
+           group_sets) {
+        const ResolvedAnalyticFunctionGroup* first = candidate.front();
+        if (!PartitioningsAreEqual(first->partition_by(),
+                                   group->partition_by())) {
+          continue;
+        }
+        if (IsOrderingPrefix(group->order_by(), first->order_by())) {
+          group_set = &candidate;
+          group_set->push_back(group.get());
+          break;
+        }
+        if (IsOrderingPrefix(first->order_by(), group->order_by())) {
+          // 'group' has the longest ordering of the set now.
+          group_set = &candidate;
+          group_set->insert(group_set->begin(), group.get());
+          break;
+        }
+      }
+    }
+    if (group_set == nullptr) {
+      group_sets.push_back({group.get()});
+    }
+  }
+  return group_sets;
+}
+
+absl::optional<Algebrizer::PartitionLimit> Algebrizer::GetPartitionLimit(
+    const ResolvedAnalyticScan* analytic_scan,
+    const std::vector<FilterConjunctInfo*>& active_conjuncts) {
+  if (analytic_scan->function_group_list_size() != 1) return absl::nullopt;
+  const ResolvedAnalyticFunctionGroup* group =
+      analytic_scan->function_group_list(0);
+  if (group->order_by() == nullptr) return absl::nullopt;
+  // Whether each analytic column is a RANK() (or else a ROW_NUMBER()).
+  absl::flat_hash_map<ResolvedColumn, bool> is_rank_column;
+  for (const std::unique_ptr<const ResolvedComputedColumn>& analytic_column :
+       group->analytic_function_list()) {
+    if (analytic_column->expr()->node_kind() !=
+        RESOLVED_ANALYTIC_FUNCTION_CALL) {
+      return absl::nullopt;
+    }
+    const Function* function =
+        analytic_column->expr()->GetAs<ResolvedAnalyticFunctionCall>()
+            ->function();
+    if (!function->IsZetaSQLBuiltin()) return absl::nullopt;
+    const std::string name = function->FullName(/*include_group=*/false);
+    if (name != "row_number" && name != "rank") return absl::nullopt;
+    is_rank_column[analytic_column->column()] = name == "rank";
+  }
+
+  absl::optional<PartitionLimit> partition_limit;
+  for (const FilterConjunctInfo* info : active_conjuncts) {
+    if ((info->kind != FilterConjunctInfo::kLE &&
+         info->kind != FilterConjunctInfo::kGE) ||
+        info->arguments.size() != 2) {
+      continue;
+    }
+    // Normalize 'column <op> literal' and 'literal <op> column' to
+    // 'column <= bound'.
+    const ResolvedExpr* column_arg =
+        info->arguments[info->kind == FilterConjunctInfo::kLE ? 0 : 1];
+    const ResolvedExpr* literal_arg =
+        info->arguments[info->kind == FilterConjunctInfo::kLE ? 1 : 0];
+    if (column_arg->node_kind() != RESOLVED_COLUMN_REF ||
+        literal_arg->node_kind() != RESOLVED_LITERAL) {
+      continue;
+    }
+    const ResolvedColumnRef* column_ref =
+        column_arg->GetAs<ResolvedColumnRef>();
+    const Value& literal = literal_arg->GetAs<ResolvedLiteral>()->value();
+    const bool* is_rank =
+        zetasql_base::FindOrNull(is_rank_column, column_ref->column());
+    if (column_ref->is_correlated() || is_rank == nullptr ||
+        literal.type_kind() != TYPE_INT64 || literal.is_null()) {
+      continue;
+    }
+    const std::string name =
+        info->conjunct->GetAs<ResolvedFunctionCall>()->function()->FullName(
+            /*include_group=*/false);
+    int64_t limit = std::max<int64_t>(literal.int64_value(), 0);
+    if ((name == "$less" || name == "$greater") && limit > 0) --limit;
+    // A ROW_NUMBER() bound keeps no more rows than the same RANK() bound.
+    if (!partition_limit.has_value() || limit < partition_limit->limit ||
+        (limit == partition_limit->limit && !*is_rank)) {
+      partition_limit = PartitionLimit{limit, /*with_ties=*/*is_rank};
+    }
+  }
+  return partition_limit;
+}
+
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeAnalyticScan(
-    const ResolvedAnalyticScan* analytic_scan) {
+    const ResolvedAnalyticScan* analytic_scan,
+    const std::vector<FilterConjunctInfo*>& active_conjuncts) {
   // Algebrize the input scan.
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> relation_op,
                    AlgebrizeScan(analytic_scan->input_scan()));
 
-  // Algebrize each ResolvedAnalyticFunctionGroup sequentially.
+  // The filter conjuncts above the scan still apply, the partition limit only
+  // avoids sorting the rows that they filter out.
+  absl::optional<PartitionLimit> partition_limit;
+  if (algebrizer_options_.allow_partition_limit_sort) {
+    partition_limit = GetPartitionLimit(analytic_scan, active_conjuncts);
+  }
+
+  // Algebrize each set of ResolvedAnalyticFunctionGroups sequentially.
   std::set<ResolvedColumn> input_columns(
       analytic_scan->input_scan()->column_list().begin(),
       analytic_scan->input_scan()->column_list().end());
   bool first = true;
-  for (const std::unique_ptr<const ResolvedAnalyticFunctionGroup>& group :
-       analytic_scan->function_group_list()) {
+  for (const std::vector<const ResolvedAnalyticFunctionGroup*>& group_set :
+       GroupAnalyticFunctionGroups(
+           analytic_scan, algebrizer_options_.share_analytic_sorts)) {
     ZETASQL_ASSIGN_OR_RETURN(relation_op,
                      AlgebrizeAnalyticFunctionGroup(
-                         input_columns, group.get(), std::move(relation_op),
-                         /*input_is_from_same_analytic_scan=*/!first));
+                         input_columns, group_set, std::move(relation_op),
+                         /*input_is_from_same_analytic_scan=*/!first,
+                         partition_limit));
     first = false;
-    for (const std::unique_ptr<const ResolvedComputedColumn>& analytic_column :
-         group->analytic_function_list()) {
-      ZETASQL_RET_CHECK(
-          zetasql_base::InsertIfNotPresent(&input_columns, analytic_column->column()));
+    for (const ResolvedAnalyticFunctionGroup* group : group_set) {
+      for (const std::unique_ptr<const ResolvedComputedColumn>&
+               analytic_column : group->analytic_function_list()) {
+        ZETASQL_RET_CHECK(zetasql_base::InsertIfNotPresent(&input_columns,
+                                          analytic_column->column()));
+      }
     }
   }
 
@@ -2344,9 +4228,13 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeAnaly
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::AlgebrizeAnalyticFunctionGroup(
     const std::set<ResolvedColumn>& input_resolved_columns,
-    const ResolvedAnalyticFunctionGroup* analytic_group,
+    absl::Span<const ResolvedAnalyticFunctionGroup* const> analytic_groups,
     std::unique_ptr<RelationalOp> input_relation_op,
-    bool input_is_from_same_analytic_scan) {
+    bool input_is_from_same_analytic_scan,
+    const absl::optional<PartitionLimit>& partition_limit) {
+  ZETASQL_RET_CHECK(!analytic_groups.empty());
+  // The partitioning and ordering of the first group define the sort.
+  const ResolvedAnalyticFunctionGroup* analytic_group = analytic_groups[0];
   const ResolvedWindowPartitioning* partition_by =
       analytic_group->partition_by();
   const ResolvedWindowOrdering* order_by =
@@ -2364,7 +4252,8 @@ Algebrizer::AlgebrizeAnalyticFunctionGroup(
         input_relation_op,
         MaybeCreateSortForAnalyticOperator(
             input_resolved_columns, analytic_group,
-            std::move(input_relation_op), input_is_from_same_analytic_scan));
+            std::move(input_relation_op), input_is_from_same_analytic_scan,
+            partition_limit));
   }
 
   std::vector<std::unique_ptr<KeyArg>> partition_keys;
@@ -2389,20 +4278,29 @@ Algebrizer::AlgebrizeAnalyticFunctionGroup(
   }
 
   std::vector<std::unique_ptr<AnalyticArg>> analytic_args;
-  for (const std::unique_ptr<const ResolvedComputedColumn>& analytic_column :
-       analytic_group->analytic_function_list()) {
-    ZETASQL_RET_CHECK_EQ(RESOLVED_ANALYTIC_FUNCTION_CALL,
-                 analytic_column->expr()->node_kind());
-    const ResolvedAnalyticFunctionCall* analytic_function_call =
-        static_cast<const ResolvedAnalyticFunctionCall*>(
-            analytic_column->expr());
-
-    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<AnalyticArg> analytic_arg,
-                     AlgebrizeAnalyticFunctionCall(
-                         column_to_variable_->AssignNewVariableToColumn(
-                             &analytic_column->column()),
-                         analytic_function_call));
-    analytic_args.push_back(std::move(analytic_arg));
+  for (const ResolvedAnalyticFunctionGroup* group : analytic_groups) {
+    const ResolvedWindowOrdering* group_order_by = group->order_by();
+    const int num_order_keys =
+        group_order_by == nullptr ? 0
+                                  : group_order_by->order_by_item_list_size();
+    for (const std::unique_ptr<const ResolvedComputedColumn>& analytic_column :
+         group->analytic_function_list()) {
+      ZETASQL_RET_CHECK_EQ(RESOLVED_ANALYTIC_FUNCTION_CALL,
+                   analytic_column->expr()->node_kind());
+      const ResolvedAnalyticFunctionCall* analytic_function_call =
+          static_cast<const ResolvedAnalyticFunctionCall*>(
+              analytic_column->expr());
+
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<AnalyticArg> analytic_arg,
+                       AlgebrizeAnalyticFunctionCall(
+                           column_to_variable_->AssignNewVariableToColumn(
+                               &analytic_column->column()),
+                           analytic_function_call));
+      if (num_order_keys < order_keys.size()) {
+        analytic_arg->set_num_order_keys(num_order_keys);
+      }
+      analytic_args.push_back(std::move(analytic_arg));
+    }
   }
 
   ZETASQL_ASSIGN_OR_RETURN(
@@ -2425,7 +4323,8 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::MaybeCreateSortForAnalyticOperator(
     const std::set<ResolvedColumn>& input_resolved_columns,
     const ResolvedAnalyticFunctionGroup* analytic_group,
-    std::unique_ptr<RelationalOp> input_relation_op, bool require_stable_sort) {
+    std::unique_ptr<RelationalOp> input_relation_op, bool require_stable_sort,
+    const absl::optional<PartitionLimit>& partition_limit) {
   std::vector<std::unique_ptr<KeyArg>> sort_keys;
   // Map from each referenced column to its VariableId from the input.
   absl::flat_hash_map<int, VariableId> column_to_id_map;
@@ -2436,6 +4335,7 @@ Algebrizer::MaybeCreateSortForAnalyticOperator(
     ZETASQL_RETURN_IF_ERROR(AlgebrizePartitionExpressions(
         partition_by, &column_to_id_map, &sort_keys));
   }
+  const int num_partition_keys = sort_keys.size();
 
   const ResolvedWindowOrdering* order_by =
       analytic_group->order_by();
@@ -2482,12 +4382,17 @@ Algebrizer::MaybeCreateSortForAnalyticOperator(
   }
 
   ZETASQL_ASSIGN_OR_RETURN(
-      std::unique_ptr<RelationalOp> sort_op,
+      std::unique_ptr<SortOp> sort_op,
       SortOp::Create(std::move(sort_keys), std::move(non_sort_expressions),
                      /*limit=*/nullptr, /*offset=*/nullptr,
                      std::move(input_relation_op),
                      /*is_order_preserving=*/true, require_stable_sort));
-  return sort_op;
+  if (partition_limit.has_value()) {
+    ZETASQL_RETURN_IF_ERROR(sort_op->SetPartitionLimit(num_partition_keys,
+                                               partition_limit->limit,
+                                               partition_limit->with_ties));
+  }
+  return std::unique_ptr<RelationalOp>(std::move(sort_op));
 }
 
 zetasql_base::Status Algebrizer::AlgebrizeOrderByItems(
@@ -2807,27 +4712,64 @@ Algebrizer::AlgebrizeWindowFrameExpr(
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::AlgebrizeSetOperationScan(
-    const ResolvedSetOperationScan* set_scan) {
+    const ResolvedSetOperationScan* set_scan,
+    std::vector<FilterConjunctInfo*>* active_conjuncts) {
   if (set_scan->op_type() == ResolvedSetOperationScan::UNION_ALL ||
       set_scan->op_type() == ResolvedSetOperationScan::UNION_DISTINCT) {
-    return AlgebrizeUnionScan(set_scan);
+    return AlgebrizeUnionScan(set_scan, active_conjuncts);
   } else {
     return AlgebrizeExceptIntersectScan(set_scan);
   }
 }
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeUnionScan(
-    const ResolvedSetOperationScan* set_scan) {
+    const ResolvedSetOperationScan* set_scan,
+    std::vector<FilterConjunctInfo*>* active_conjuncts) {
   const ResolvedColumnList& output_columns = set_scan->column_list();
   int num_columns = output_columns.size();
   int num_input_relations = set_scan->input_item_list_size();
+  // Each row of a UNION ALL comes from exactly one input, so the filters
+  // above it can be evaluated in each input instead, on the corresponding
+  // columns of the input, and pushed down further from there. This does not
+  // hold for UNION DISTINCT, which may keep either of two rows that are equal
+  // but distinguishable, like 0.0 and -0.0.
+  std::vector<FilterConjunctInfo*> pushed_conjuncts;
+  if (algebrizer_options_.push_down_filters &&
+      set_scan->op_type() == ResolvedSetOperationScan::UNION_ALL) {
+    for (FilterConjunctInfo* info : *active_conjuncts) {
+      ZETASQL_RET_CHECK(!info->redundant);
+      pushed_conjuncts.push_back(info);
+    }
+  }
+  // Whether each of 'pushed_conjuncts' was applied in all the inputs.
+  std::vector<bool> applied_in_inputs(pushed_conjuncts.size(), true);
   // Algebrize all children first to ensure that no errors arise later.
   std::vector<std::unique_ptr<RelationalOp>> children;
   for (int i = 0; i < num_input_relations; ++i) {
+    const ResolvedSetOperationItem* item = set_scan->input_item_list(i);
+    absl::flat_hash_map<ResolvedColumn, ResolvedColumn> column_map;
+    for (int j = 0; j < num_columns; ++j) {
+      column_map[output_columns[j]] = item->output_column_list(j);
+    }
+    std::vector<std::unique_ptr<FilterConjunctInfo>> input_conjunct_infos;
+    std::vector<FilterConjunctInfo*> input_active_conjuncts;
+    for (const FilterConjunctInfo* info : pushed_conjuncts) {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<FilterConjunctInfo> input_info,
+                       CreateRewrittenFilterConjunctInfo(info->conjunct,
+                                                         column_map));
+      input_active_conjuncts.push_back(input_info.get());
+      input_conjunct_infos.push_back(std::move(input_info));
+    }
     ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> child,
-                     AlgebrizeScan(set_scan->input_item_list(i)->scan()));
+                     AlgebrizeScan(item->scan(), &input_active_conjuncts));
+    for (int k = 0; k < input_conjunct_infos.size(); ++k) {
+      if (!input_conjunct_infos[k]->redundant) applied_in_inputs[k] = false;
+    }
     children.push_back(std::move(child));
   }
+  for (int k = 0; k < pushed_conjuncts.size(); ++k) {
+    if (applied_in_inputs[k]) pushed_conjuncts[k]->redundant = true;
+  }
   // There is one set of column mappings per input relation of the union.
   std::vector<UnionAllOp::Input> column_mappings(num_input_relations);
   for (int i = 0; i < num_input_relations; ++i) {
@@ -2845,8 +4787,11 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeUnion
           std::move(deref)));
     }
   }
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> union_op,
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<UnionAllOp> union_all_op,
                    UnionAllOp::Create(std::move(column_mappings)));
+  union_all_op->set_evaluate_inputs_in_parallel(
+      algebrizer_options_.parallelize_union_all);
+  std::unique_ptr<RelationalOp> union_op = std::move(union_all_op);
   if (set_scan->op_type() == ResolvedSetOperationScan::UNION_ALL) {
     return union_op;
   }
@@ -2946,8 +4891,11 @@ Algebrizer::AlgebrizeExceptIntersectScan(
   }
 
   // Construct the actual union.
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> query_u,
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<UnionAllOp> union_all_op,
                    UnionAllOp::Create(std::move(union_inputs)));
+  union_all_op->set_evaluate_inputs_in_parallel(
+      algebrizer_options_.parallelize_union_all);
+  std::unique_ptr<RelationalOp> query_u = std::move(union_all_op);
 
   // Aggregate the result of the union:
   // T = SELECT X0, SUM(bit0) cnt0, ..., SUM(bitN) cntN FROM U GROUP BY X0
@@ -3103,20 +5051,72 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeProje
   // Determine the active conjuncts for the input scan and then algebrize
   // it. Note that volatile conjuncts can be pushed through projections because
   // they will only be evaluated once in both places.
+  //
+  // Conjuncts that reference columns that the projection only renames, like
+  // 'k' in SELECT key AS k, are pushed down as copies that reference the
+  // input columns instead.
+  absl::flat_hash_map<ResolvedColumn, ResolvedColumn> renamed_columns;
+  if (algebrizer_options_.push_down_filters) {
+    for (const auto& entry : defined_columns_and_exprs) {
+      if (entry.second->node_kind() == RESOLVED_COLUMN_REF &&
+          !entry.second->GetAs<ResolvedColumnRef>()->is_correlated()) {
+        renamed_columns.emplace(
+            entry.first, entry.second->GetAs<ResolvedColumnRef>()->column());
+      }
+    }
+  }
   std::vector<FilterConjunctInfo*> input_active_conjuncts;
+  // The conjuncts that are pushed down as copies, and their copies.
+  std::vector<std::pair<FilterConjunctInfo*,
+                        std::unique_ptr<FilterConjunctInfo>>>
+      rewritten_conjunct_infos;
   for (FilterConjunctInfo* info : *active_conjuncts) {
     ZETASQL_RET_CHECK(!info->redundant);
     if (!Intersects(info->referenced_columns, defined_columns)) {
       input_active_conjuncts.push_back(info);
+      continue;
+    }
+    bool only_references_renamed_columns = !renamed_columns.empty();
+    for (const ResolvedColumn& column : info->referenced_columns) {
+      if (defined_columns.contains(column) &&
+          !renamed_columns.contains(column)) {
+        only_references_renamed_columns = false;
+        break;
+      }
+    }
+    if (only_references_renamed_columns) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          std::unique_ptr<FilterConjunctInfo> rewritten_info,
+          CreateRewrittenFilterConjunctInfo(info->conjunct, renamed_columns));
+      input_active_conjuncts.push_back(rewritten_info.get());
+      rewritten_conjunct_infos.emplace_back(info, std::move(rewritten_info));
     }
   }
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<RelationalOp> input,
       AlgebrizeScan(resolved_project->input_scan(), &input_active_conjuncts));
+  for (const auto& entry : rewritten_conjunct_infos) {
+    if (entry.second->redundant) entry.first->redundant = true;
+  }
 
-  // Assign variables to the new columns and algebrize their definitions.
-  std::vector<std::unique_ptr<ExprArg>> arguments;
-  arguments.reserve(defined_columns_and_exprs.size());
+  // Assign variables to the new columns and algebrize their definitions,
+  // after the extractions they share (if any).
+  std::vector<const ResolvedExpr*> exprs;
+  exprs.reserve(defined_columns_and_exprs.size());
+  for (const auto& entry : defined_columns_and_exprs) {
+    exprs.push_back(entry.second);
+  }
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<std::unique_ptr<ExprArg>> arguments,
+                   AlgebrizeBatchedJsonExtractions(exprs));
+  std::vector<const ResolvedExpr*> common_subexpression_occurrences;
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<std::unique_ptr<ExprArg>> common_subexpressions,
+                   AlgebrizeCommonSubexpressions(
+                       exprs, &common_subexpression_occurrences));
+  for (std::unique_ptr<ExprArg>& common_subexpression :
+       common_subexpressions) {
+    arguments.push_back(std::move(common_subexpression));
+  }
+  arguments.reserve(arguments.size() + defined_columns_and_exprs.size());
   for (const auto& entry : defined_columns_and_exprs) {
     const ResolvedColumn& column = entry.first;
     const ResolvedExpr* expr = entry.second;
@@ -3127,6 +5127,15 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeProje
     arguments.push_back(
         absl::make_unique<ExprArg>(variable, std::move(argument)));
   }
+  // The extraction and common subexpression variables are only visible in
+  // this ComputeOp.
+  for (const ResolvedExpr* expr : exprs) {
+    const ResolvedFunctionCall* call = GetBatchableJsonExtraction(expr);
+    if (call != nullptr) batched_json_extractions_.erase(call);
+  }
+  for (const ResolvedExpr* occurrence : common_subexpression_occurrences) {
+    common_subexpressions_.erase(occurrence);
+  }
 
   // If no columns were defined by this project then just drop it.
   if (!arguments.empty()) {
@@ -3150,6 +5159,9 @@ zetasql_base::StatusOr<std::unique_ptr<SortOp>> Algebrizer::AlgebrizeOrderByScan
 
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> input,
                    AlgebrizeScan(scan->input_scan()));
+  ZETASQL_ASSIGN_OR_RETURN(input, MaybeAddExchange(scan->input_scan(),
+                                           std::move(input),
+                                           /*parallelism=*/0));
   // 'order_by_item_list' form the key.
   std::vector<std::unique_ptr<KeyArg>> keys;
   absl::flat_hash_map<int, VariableId> column_to_id_map;
@@ -3187,8 +5199,14 @@ zetasql_base::StatusOr<std::unique_ptr<SortOp>> Algebrizer::AlgebrizeOrderByScan
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeScan(
     const ResolvedScan* scan,
     std::vector<FilterConjunctInfo*>* active_conjuncts) {
-  ZETASQL_RETURN_IF_ERROR(CheckHints(scan->hint_list()));
+  ZETASQL_RETURN_IF_ERROR(CheckHints(scan->hint_list(),
+                             GetSupportedScanHints(scan->node_kind())));
   const int original_active_conjuncts_size = active_conjuncts->size();
+  ++num_scans_in_progress_;
+  // The proto fields that a subquery in a filter reads are only eager if a
+  // filter in the subquery reads them.
+  const bool original_in_filter_conjunct = in_filter_conjunct_;
+  in_filter_conjunct_ = false;
   std::unique_ptr<RelationalOp> rel_op;
   switch (scan->node_kind()) {
     case RESOLVED_SINGLE_ROW_SCAN: {
@@ -3226,7 +5244,8 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeScan(
     }
     case RESOLVED_SET_OPERATION_SCAN: {
       ZETASQL_ASSIGN_OR_RETURN(rel_op, AlgebrizeSetOperationScan(
-                                   scan->GetAs<ResolvedSetOperationScan>()));
+                                   scan->GetAs<ResolvedSetOperationScan>(),
+                                   active_conjuncts));
       break;
     }
     case RESOLVED_PROJECT_SCAN: {
@@ -3256,9 +5275,15 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeScan(
           rel_op, AlgebrizeWithRefScan(scan->GetAs<ResolvedWithRefScan>()));
       break;
     }
+    case RESOLVED_SAMPLE_SCAN: {
+      ZETASQL_ASSIGN_OR_RETURN(rel_op,
+                       AlgebrizeSampleScan(scan->GetAs<ResolvedSampleScan>()));
+      break;
+    }
     case RESOLVED_ANALYTIC_SCAN: {
       ZETASQL_ASSIGN_OR_RETURN(
-          rel_op, AlgebrizeAnalyticScan(scan->GetAs<ResolvedAnalyticScan>()));
+          rel_op, AlgebrizeAnalyticScan(scan->GetAs<ResolvedAnalyticScan>(),
+                                    *active_conjuncts));
       break;
     }
     default:
@@ -3269,27 +5294,55 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeScan(
   ZETASQL_RET_CHECK_EQ(active_conjuncts->size(), original_active_conjuncts_size);
 
   // Crete a FilterOp for any conjuncts that cannot be pushed down further.
-  return MaybeApplyFilterConjuncts(std::move(rel_op), active_conjuncts);
+  ZETASQL_ASSIGN_OR_RETURN(rel_op,
+                   MaybeApplyFilterConjuncts(std::move(rel_op), active_conjuncts));
+  in_filter_conjunct_ = original_in_filter_conjunct;
+  --num_scans_in_progress_;
+  return rel_op;
 }
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::MaybeApplyFilterConjuncts(
     std::unique_ptr<RelationalOp> input,
     std::vector<FilterConjunctInfo*>* active_conjuncts) {
-  std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts;
+  std::vector<const ResolvedExpr*> conjuncts;
+  // The variables that 'conjuncts' reference.
+  std::vector<VariableId> filter_variables;
   if (algebrizer_options_.push_down_filters) {
     // Iterate over 'active_conjuncts' in reverse order because it's a stack.
     for (auto i = active_conjuncts->rbegin(); i != active_conjuncts->rend();
          ++i) {
       FilterConjunctInfo* conjunct_info = *i;
       if (!conjunct_info->redundant) {
-        ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_conjunct,
-                         AlgebrizeExpression(conjunct_info->conjunct));
-        algebrized_conjuncts.push_back(std::move(algebrized_conjunct));
+        conjuncts.push_back(conjunct_info->conjunct);
         conjunct_info->redundant = true;
+        for (const ResolvedColumn& column :
+             conjunct_info->referenced_columns) {
+          const VariableId* variable =
+              zetasql_base::FindOrNull(column_to_variable_->map(), column);
+          if (variable != nullptr) filter_variables.push_back(*variable);
+        }
       }
     }
   }
+  MaybeOrderConjunctsByCost(&conjuncts);
+  std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts;
+  for (const ResolvedExpr* conjunct : conjuncts) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_conjunct,
+                     AlgebrizeFilterConjunct(conjunct));
+    algebrized_conjuncts.push_back(std::move(algebrized_conjunct));
+  }
+
+  ArrayScanOp* array_scan = dynamic_cast<ArrayScanOp*>(input.get());
+  if (algebrizer_options_.push_filters_into_array_scans &&
+      array_scan != nullptr && !array_scan->has_filter() &&
+      !algebrized_conjuncts.empty()) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> filter,
+                     CombineFilterConjuncts(std::move(algebrized_conjuncts)));
+    ZETASQL_RETURN_IF_ERROR(
+        array_scan->set_filter(std::move(filter), filter_variables));
+    return input;
+  }
 
   return ApplyAlgebrizedFilterConjuncts(std::move(input),
                                         std::move(algebrized_conjuncts));
@@ -3410,11 +5463,262 @@ std::unique_ptr<RootData> Algebrizer::GetRootData() {
   return root_data;
 }
 
+namespace {
+
+// Removes the columns that are never read from the column lists of the scans
+// of a query statement, for AlgebrizerOptions::prune_unused_columns.
+//
+// A column is read if a ResolvedColumnRef in an evaluated expression
+// references it, or if a node reads the columns of a scan by position, like
+// the statement, a set operation item, a WITH entry, or a scalar, ARRAY or IN
+// subquery. The expressions of a ResolvedProjectScan are only evaluated for
+// the columns that are read, so the columns that they reference are only
+// read if theirs are. Columns are only removed from the scans whose
+// algebrization does not depend on their column lists beyond the columns
+// they produce; the columns of the other scans are all read.
+class UnusedColumnPruner : public ResolvedASTVisitor {
+ public:
+  UnusedColumnPruner() {}
+  UnusedColumnPruner(const UnusedColumnPruner&) = delete;
+  UnusedColumnPruner& operator=(const UnusedColumnPruner&) = delete;
+
+  // Returns a copy of 'query' without the columns that are never read, or
+  // NULL if every column of 'query' is read.
+  static zetasql_base::StatusOr<std::unique_ptr<const ResolvedQueryStmt>> Prune(
+      const ResolvedQueryStmt* query) {
+    UnusedColumnPruner pruner;
+    ZETASQL_RETURN_IF_ERROR(pruner.FindReadColumns(query));
+    if (!pruner.HasUnreadColumns(query)) return {nullptr};
+
+    ResolvedASTDeepCopyVisitor copier;
+    ZETASQL_RETURN_IF_ERROR(query->Accept(&copier));
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ResolvedQueryStmt> copy,
+                     copier.ConsumeRootNode<ResolvedQueryStmt>());
+    std::vector<const ResolvedNode*> scans;
+    copy->GetDescendantsSatisfying(&ResolvedNode::IsScan, &scans);
+    // 'scans' lists ancestors before descendants, so iterating backwards
+    // removes the expressions of a ResolvedProjectScan, with the scans in
+    // them, after those scans.
+    for (auto it = scans.rbegin(); it != scans.rend(); ++it) {
+      // We use const_cast to mutate the copy, which is not shared yet.
+      pruner.RemoveUnreadColumns(
+          const_cast<ResolvedScan*>((*it)->GetAs<ResolvedScan>()));
+    }
+    return {std::move(copy)};
+  }
+
+  zetasql_base::Status DefaultVisit(const ResolvedNode* node) override {
+    if (node->IsScan() && !IsPrunable(node->node_kind())) {
+      AddReadColumns(node->GetAs<ResolvedScan>()->column_list());
+    }
+    return ResolvedASTVisitor::DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedColumnRef(
+      const ResolvedColumnRef* node) override {
+    read_columns_.insert(node->column());
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedOutputColumn(
+      const ResolvedOutputColumn* node) override {
+    read_columns_.insert(node->column());
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedSetOperationItem(
+      const ResolvedSetOperationItem* node) override {
+    AddReadColumns(node->output_column_list());
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedWithEntry(
+      const ResolvedWithEntry* node) override {
+    AddReadColumns(node->with_subquery()->column_list());
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedTVFArgument(
+      const ResolvedTVFArgument* node) override {
+    AddReadColumns(node->argument_column_list());
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedSubqueryExpr(
+      const ResolvedSubqueryExpr* node) override {
+    if (node->subquery_type() != ResolvedSubqueryExpr::EXISTS) {
+      AddReadColumns(node->subquery()->column_list());
+    }
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedProjectScan(
+      const ResolvedProjectScan* node) override {
+    project_scans_.push_back(node);
+    for (const std::unique_ptr<const ResolvedComputedColumn>& computed_column :
+         node->expr_list()) {
+      pending_exprs_.emplace(computed_column->column(),
+                             computed_column->expr());
+    }
+    for (const std::unique_ptr<const ResolvedOption>& hint :
+         node->hint_list()) {
+      ZETASQL_RETURN_IF_ERROR(hint->Accept(this));
+    }
+    return node->input_scan()->Accept(this);
+  }
+
+ private:
+  static bool IsPrunable(ResolvedNodeKind kind) {
+    switch (kind) {
+      case RESOLVED_TABLE_SCAN:
+      case RESOLVED_PROJECT_SCAN:
+      case RESOLVED_FILTER_SCAN:
+      case RESOLVED_JOIN_SCAN:
+      case RESOLVED_ARRAY_SCAN:
+      case RESOLVED_ORDER_BY_SCAN:
+      case RESOLVED_LIMIT_OFFSET_SCAN:
+      case RESOLVED_WITH_SCAN:
+      case RESOLVED_ANALYTIC_SCAN:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  void AddReadColumns(const std::vector<ResolvedColumn>& columns) {
+    read_columns_.insert(columns.begin(), columns.end());
+  }
+
+  // Populates 'read_columns_' for 'query'.
+  zetasql_base::Status FindReadColumns(const ResolvedQueryStmt* query) {
+    ZETASQL_RETURN_IF_ERROR(query->Accept(this));
+    while (true) {
+      // The expressions of read columns may read more columns.
+      std::vector<const ResolvedExpr*> exprs = TakeExprsOfReadColumns();
+      if (exprs.empty()) {
+        // A ResolvedProjectScan must produce a column, so it keeps its first
+        // one if none is read.
+        for (const ResolvedProjectScan* scan : project_scans_) {
+          if (!scan->column_list().empty() && !ReadsAny(scan->column_list())) {
+            read_columns_.insert(scan->column_list(0));
+          }
+        }
+        exprs = TakeExprsOfReadColumns();
+        if (exprs.empty()) return zetasql_base::OkStatus();
+      }
+      for (const ResolvedExpr* expr : exprs) {
+        ZETASQL_RETURN_IF_ERROR(expr->Accept(this));
+      }
+    }
+  }
+
+  // Removes from 'pending_exprs_' and returns the expressions of the columns
+  // that are read.
+  std::vector<const ResolvedExpr*> TakeExprsOfReadColumns() {
+    std::vector<const ResolvedExpr*> exprs;
+    for (auto it = pending_exprs_.begin(); it != pending_exprs_.end();) {
+      if (read_columns_.contains(it->first)) {
+        exprs.push_back(it->second);
+        pending_exprs_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+    return exprs;
+  }
+
+  // Returns true if one of 'columns' is read.
+  bool ReadsAny(const std::vector<ResolvedColumn>& columns) const {
+    for (const ResolvedColumn& column : columns) {
+      if (read_columns_.contains(column)) return true;
+    }
+    return false;
+  }
+
+  bool HasUnreadColumns(const ResolvedQueryStmt* query) const {
+    std::vector<const ResolvedNode*> scans;
+    query->GetDescendantsSatisfying(&ResolvedNode::IsScan, &scans);
+    for (const ResolvedNode* scan : scans) {
+      for (const ResolvedColumn& column :
+           scan->GetAs<ResolvedScan>()->column_list()) {
+        if (!read_columns_.contains(column)) return true;
+      }
+    }
+    return false;
+  }
+
+  void RemoveUnreadColumns(ResolvedScan* scan) const {
+    if (!IsPrunable(scan->node_kind())) return;
+    std::vector<ResolvedColumn> column_list;
+    std::vector<int> column_index_list;
+    ResolvedTableScan* table_scan = scan->node_kind() == RESOLVED_TABLE_SCAN
+                                        ? static_cast<ResolvedTableScan*>(scan)
+                                        : nullptr;
+    const bool has_column_index_list =
+        table_scan != nullptr &&
+        table_scan->column_index_list_size() == table_scan->column_list_size();
+    for (int i = 0; i < scan->column_list_size(); ++i) {
+      if (!read_columns_.contains(scan->column_list(i))) continue;
+      column_list.push_back(scan->column_list(i));
+      if (has_column_index_list) {
+        column_index_list.push_back(table_scan->column_index_list(i));
+      }
+    }
+    if (column_list.size() == scan->column_list_size()) return;
+    scan->set_column_list(column_list);
+    if (has_column_index_list) {
+      table_scan->set_column_index_list(column_index_list);
+    }
+    if (scan->node_kind() == RESOLVED_PROJECT_SCAN) {
+      // The expressions of the removed columns are not evaluated.
+      ResolvedProjectScan* project_scan =
+          static_cast<ResolvedProjectScan*>(scan);
+      std::vector<std::unique_ptr<const ResolvedComputedColumn>> expr_list =
+          project_scan->release_expr_list();
+      expr_list.erase(
+          std::remove_if(
+              expr_list.begin(), expr_list.end(),
+              [this](const std::unique_ptr<const ResolvedComputedColumn>& c) {
+                return !read_columns_.contains(c->column());
+              }),
+          expr_list.end());
+      project_scan->set_expr_list(std::move(expr_list));
+    }
+  }
+
+  absl::flat_hash_set<ResolvedColumn> read_columns_;
+  // The expressions of the ResolvedProjectScans that compute the columns
+  // that are not known to be read yet.
+  absl::flat_hash_map<ResolvedColumn, const ResolvedExpr*> pending_exprs_;
+  std::vector<const ResolvedProjectScan*> project_scans_;
+};
+
+}  // namespace
+
+// Sets '*query' to a copy without the columns that it never reads if
+// AlgebrizerOptions::prune_unused_columns is set and there are any. The copy
+// is owned by 'pruned_query'.
+static zetasql_base::Status MaybePruneUnusedColumns(
+    const AlgebrizerOptions& algebrizer_options,
+    const ResolvedQueryStmt** query,
+    std::unique_ptr<const ResolvedQueryStmt>* pruned_query) {
+  if (!algebrizer_options.prune_unused_columns ||
+      algebrizer_options.use_arrays_for_tables) {
+    return zetasql_base::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(*pruned_query, UnusedColumnPruner::Prune(*query));
+  if (*pruned_query != nullptr) *query = pruned_query->get();
+  return zetasql_base::OkStatus();
+}
+
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::AlgebrizeQueryStatementAsRelation(
     const ResolvedQueryStmt* query, ResolvedColumnList* output_column_list,
     std::vector<std::string>* output_column_names,
     std::vector<VariableId>* output_column_variables) {
+  std::unique_ptr<const ResolvedQueryStmt> pruned_query;
+  ZETASQL_RETURN_IF_ERROR(
+      MaybePruneUnusedColumns(algebrizer_options_, &query, &pruned_query));
   ZETASQL_RETURN_IF_ERROR(CheckHints(query->hint_list()));
   const ResolvedScan* scan = query->query();
   ZETASQL_RETURN_IF_ERROR(CheckHints(scan->hint_list()));
@@ -3803,6 +6107,9 @@ zetasql_base::Status Algebrizer::AlgebrizeStatement(
   switch (ast_root->node_kind()) {
     case RESOLVED_QUERY_STMT: {
       const ResolvedQueryStmt* stmt = ast_root->GetAs<ResolvedQueryStmt>();
+      std::unique_ptr<const ResolvedQueryStmt> pruned_stmt;
+      ZETASQL_RETURN_IF_ERROR(
+          MaybePruneUnusedColumns(algebrizer_options, &stmt, &pruned_stmt));
       ZETASQL_RETURN_IF_ERROR(CheckHints(stmt->hint_list()));
       const ResolvedScan* scan = stmt->query();
       ZETASQL_RETURN_IF_ERROR(CheckHints(scan->hint_list()));
@@ -3813,8 +6120,7 @@ zetasql_base::Status Algebrizer::AlgebrizeStatement(
       // TODO: fix this.
       IdStringPool id_string_pool;
       ResolvedColumnList output_column_list;
-      for (const auto& it :
-           ast_root->GetAs<ResolvedQueryStmt>()->output_column_list()) {
+      for (const auto& it : stmt->output_column_list()) {
         // TODO IdString conversion shouldn't be needed here.
         // We should have IdStrings in ResolvedOutputColumn.
         output_column_list.emplace_back(
@@ -3825,7 +6131,7 @@ zetasql_base::Status Algebrizer::AlgebrizeStatement(
       ZETASQL_ASSIGN_OR_RETURN(*output,
                        single_use_algebrizer.AlgebrizeRootScanAsValueExpr(
                            output_column_list, stmt->is_value_table(), scan));
-      ZETASQL_RETURN_IF_ERROR(ast_root->CheckFieldsAccessed());
+      ZETASQL_RETURN_IF_ERROR(stmt->CheckFieldsAccessed());
       break;
     }
     // TODO: Add MERGE support.
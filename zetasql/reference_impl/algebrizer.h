@@ -46,6 +46,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
@@ -77,6 +78,139 @@ struct AlgebrizerOptions {
   // latter case, the filter remains in its original location because
   // EvaluatorTableIterator does not have to honor the filter.
   bool push_down_filters = false;
+
+  // If true, the algebrizer wraps the inputs of aggregations, sorts and joins
+  // that are filters and projections over a table scan in ExchangeOps, so
+  // that they are evaluated on EvaluationOptions::num_threads threads.
+  bool use_exchange_operators = false;
+
+  // If true, the algebrizer arranges so that a projection with several
+  // JSON_EXTRACT_SCALAR(json_col, '<constant path>') expressions parses each
+  // 'json_col' once for all of its paths.
+  bool batch_json_extractions = false;
+
+  // If true, the algebrizer arranges so that the deterministic subexpressions
+  // of the expressions in scans that only depend on literals, parameters and
+  // system variables, e.g. UPPER(@p) in WHERE UPPER(col) = UPPER(@p), are
+  // evaluated at most once per statement instead of once per row.
+  bool fold_constant_subexpressions = false;
+
+  // If true, the algebrizer arranges so that a deterministic subexpression
+  // that occurs several times in the expressions of a projection is evaluated
+  // once per row.
+  bool eliminate_common_subexpressions = false;
+
+  // If true, the algebrizer uses Table::GetRowCountEstimate() to make the
+  // input of each join that is estimated to produce fewer rows the one that
+  // is loaded into memory.
+  bool use_row_count_estimates = false;
+
+  // If true, the algebrizer evaluates the analytic function groups of an
+  // analytic scan that have the same partitioning, and whose orderings are
+  // prefixes of the longest of their orderings, with one AnalyticOp over one
+  // SortOp, instead of sorting the input again for each group.
+  bool share_analytic_sorts = false;
+
+  // If true, and 'consolidate_proto_field_accesses' is true, the algebrizer
+  // arranges so that the proto fields that filters read are read before the
+  // other fields of the same protos, which are only read for the rows that
+  // pass the filters.
+  bool defer_proto_field_reads = false;
+
+  // If true, and 'allow_hash_join' is true, the algebrizer makes an inner or
+  // left outer join merge its inputs if both are scans of tables that
+  // Table::GetSortOrder() declares sorted on columns that the join compares
+  // for equality. The merge join only keeps the right rows with the current
+  // key in memory.
+  bool allow_merge_join = false;
+
+  // If true, and 'allow_hash_join' is true, an inner or right outer hash join
+  // passes the keys of its hash table to the scans of tables on its left side
+  // that produce the columns it compares them with, so that the scans can skip
+  // the rows that cannot join. The keys are passed as an IN-list if there are
+  // at most JoinOp::kMaxBuildKeysInList of them and as a range otherwise.
+  bool push_build_keys_into_scans = false;
+
+  // If true, and 'push_build_keys_into_scans' is true, a scan on the left side
+  // of such a join whose table supports key lookups (see
+  // Table::SupportsEvaluatorKeyLookups()), and whose keys all get an IN-list,
+  // looks up the rows with those keys instead of scanning the whole table,
+  // unless the right side is estimated to have more rows than the table or
+  // than EvaluatorTableScanOp::kMaxKeyLookups.
+  bool use_key_lookups_for_joins = false;
+
+  // If true, the algebrizer wraps deterministic EXISTS, scalar and ARRAY
+  // subqueries that are evaluated for each row of a scan in a
+  // MemoizedSubqueryExpr, so that they are only evaluated once for each
+  // distinct tuple of values of their correlated columns. Subqueries that are
+  // correlated on FLOAT, DOUBLE or non-simple columns are not memoized.
+  bool memoize_correlated_subqueries = false;
+
+  // If true, each WITH table is materialized once per evaluation by a
+  // MaterializeWithTableExpr into a buffer of tuples (which may be spilled to
+  // disk) that every reference reads with a WithRefScanOp. Otherwise, WITH
+  // tables are nested into arrays of structs that are unnested by every
+  // reference.
+  bool materialize_with_tables = false;
+
+  // If true, filter conjuncts that are pushed down to an ArrayScanOp are
+  // evaluated by the ArrayScanOp itself, which only populates the rest of each
+  // output tuple for the elements that pass.
+  bool push_filters_into_array_scans = false;
+
+  // If true, UNNEST(GENERATE_ARRAY(...)), and likewise for
+  // GENERATE_DATE_ARRAY and GENERATE_TIMESTAMP_ARRAY, is algebrized into an
+  // ArrayScanOp that computes the elements as they are scanned, instead of
+  // materializing the array. Such scans take constant memory, and are not
+  // subject to the limits on the size of the arrays the functions return.
+  bool generate_arrays_in_array_scans = false;
+
+  // If true, the UnionAllOps that implement set operations evaluate their
+  // inputs concurrently on EvaluationOptions::num_threads threads, and
+  // interleave the tuples of different inputs.
+  bool parallelize_union_all = false;
+
+  // If true, 'x IN (<list>)' with at least 8 elements and
+  // 'x IN UNNEST(<array>)' are evaluated with a hash set of the elements that
+  // is built once per evaluation, if the elements only depend on literals,
+  // parameters and system variables and their type is supported by InListSet.
+  bool use_in_list_sets = false;
+
+  // If true, query statements are algebrized without the columns of their
+  // scans that are never read, e.g. the columns of 'wide_table' other than
+  // 'a' in SELECT a FROM (SELECT * FROM wide_table), nor the expressions in
+  // projections that compute them. Table scans then only read the needed
+  // columns from their EvaluatorTableIterators, and tuples are narrower.
+  // Ignored if 'use_arrays_for_tables' is true.
+  bool prune_unused_columns = false;
+
+  // If true, an analytic scan that only computes ROW_NUMBER() and RANK() over
+  // one window, under a filter that compares one of them with an INT64
+  // literal, e.g. WHERE ROW_NUMBER() OVER (PARTITION BY k ORDER BY ts) <= 3,
+  // is algebrized with a SortOp that only keeps the rows of each partition
+  // that can pass the filter, in a bounded heap per partition (see
+  // SortOp::SetPartitionLimit()), instead of sorting every partition fully.
+  bool allow_partition_limit_sort = false;
+
+  // If true, a LIMIT with a literal count and offset passes the number of rows
+  // it needs as a hint to the EvaluatorTableIterators of the table scans
+  // below it (see EvaluatorTableIterator::SetRowLimitHint()), through any
+  // projections, UNION ALLs and other LIMITs in between.
+  bool push_limits_into_scans = false;
+
+  // If true, the subquery of an EXISTS is algebrized for its first row only:
+  // a top-level ORDER BY, which cannot change whether there is a row, is
+  // dropped. With 'push_limits_into_scans', the table scans below an EXISTS
+  // also get a row limit hint of 1, and those below a scalar subquery a hint
+  // of 2 (enough to detect that it returned more than one row).
+  bool simplify_exists_subqueries = false;
+
+  // If true, the conjuncts of filters and join conditions, and the arguments
+  // of AND and OR, are evaluated in increasing order of their estimated cost
+  // (see BuiltinFunctionCatalog::GetCostClassByKind()). Only non-volatile
+  // conjuncts that cannot fail move ahead of others, so that the reordering
+  // cannot introduce an error.
+  bool order_conjuncts_by_cost = false;
 };
 
 class Algebrizer {
@@ -178,6 +312,33 @@ class Algebrizer {
   zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeFunctionCall(
       const ResolvedFunctionCall* function_call);
 
+  // If 'algebrizer_options_.batch_json_extractions' is true, groups the
+  // JSON_EXTRACT_SCALAR calls that make up 'exprs', possibly inside casts, by
+  // their JSON column. For each column with several such calls with constant
+  // JSONPaths, returns an ExprArg that extracts all of the paths at once and
+  // records in 'batched_json_extractions_' where AlgebrizeFunctionCall() finds
+  // the result of each call.
+  zetasql_base::StatusOr<std::vector<std::unique_ptr<ExprArg>>>
+  AlgebrizeBatchedJsonExtractions(absl::Span<const ResolvedExpr* const> exprs);
+
+  // If 'algebrizer_options_.eliminate_common_subexpressions' is true, finds
+  // the deterministic subexpressions that occur several times in 'exprs', at
+  // least once outside of the branches of IF, CASE, COALESCE, IFNULL, AND and
+  // OR, so that computing them for every row does not raise new errors.
+  // Returns an ExprArg for each of them and records in
+  // 'common_subexpressions_' that AlgebrizeExpression() reads its variable for
+  // all of their occurrences, which are appended to 'occurrences'.
+  zetasql_base::StatusOr<std::vector<std::unique_ptr<ExprArg>>>
+  AlgebrizeCommonSubexpressions(absl::Span<const ResolvedExpr* const> exprs,
+                                std::vector<const ResolvedExpr*>* occurrences);
+
+  // Returns 'expr' algebrized inside a CachedExpr if
+  // 'algebrizer_options_.fold_constant_subexpressions' is true, 'expr' is
+  // part of a scan and 'expr' is a deterministic computation that only depends
+  // on literals, parameters and system variables. Otherwise returns NULL.
+  zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> MaybeAlgebrizeCachedExpression(
+      const ResolvedExpr* expr);
+
   zetasql_base::StatusOr<std::unique_ptr<NewStructExpr>> MakeStruct(
       const ResolvedMakeStruct* make_struct);
 
@@ -202,6 +363,17 @@ class Algebrizer {
       const ResolvedExpr* expr);
   zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeSubqueryExpr(
       const ResolvedSubqueryExpr* subquery_expr);
+  // Algebrizes 'scan', the subquery of an EXISTS, without its top-level ORDER
+  // BY if 'algebrizer_options_.simplify_exists_subqueries' is true. Sets
+  // '*first_row_scan' to the scan that was actually algebrized.
+  zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeExistsSubquery(
+      const ResolvedScan* scan, const ResolvedScan** first_row_scan);
+  // Returns 'subquery', the algebrized form of 'subquery_expr', wrapped in a
+  // MemoizedSubqueryExpr if
+  // 'algebrizer_options_.memoize_correlated_subqueries' allows it.
+  zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> MaybeMemoizeSubquery(
+      const ResolvedSubqueryExpr* subquery_expr,
+      std::unique_ptr<ValueExpr> subquery);
   zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeInArray(
       std::unique_ptr<ValueExpr> in_value,
       std::unique_ptr<ValueExpr> array_value);
@@ -285,6 +457,15 @@ class Algebrizer {
     bool redundant = false;
   };
 
+  // Returns a FilterConjunctInfo for a copy of 'conjunct' that references
+  // the values of 'column_map' instead of its keys, to push 'conjunct' below
+  // an operator that renames columns. The copy is owned by
+  // 'rewritten_conjuncts_'.
+  zetasql_base::StatusOr<std::unique_ptr<FilterConjunctInfo>>
+  CreateRewrittenFilterConjunctInfo(
+      const ResolvedExpr* conjunct,
+      const absl::flat_hash_map<ResolvedColumn, ResolvedColumn>& column_map);
+
   // Adds all the conjuncts in 'expr' to 'conjunct_infos'.
   static zetasql_base::Status AddFilterConjunctsTo(
       const ResolvedExpr* expr,
@@ -305,6 +486,32 @@ class Algebrizer {
   // The algebrized tree will ultimately push down the filters as far as they
   // can go.
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeSingleRowScan();
+
+  // The physical strategy that the hints of a join or aggregate scan choose,
+  // for example @{join_method=HASH, build_side=LEFT, parallelism=8}. Unset
+  // fields are left to the algebrizer.
+  struct ScanHints {
+    enum JoinMethod { kHashJoin, kNestedLoopJoin, kMergeJoin };
+    // The input that JoinOp loads into memory.
+    enum BuildSide { kBuildLeft, kBuildRight };
+
+    absl::optional<JoinMethod> join_method;
+    absl::optional<BuildSide> build_side;
+    // The number of threads that evaluate each partitionable input (see
+    // MaybeAddExchange()), or 0 to use EvaluationOptions::num_threads.
+    int parallelism = 0;
+  };
+
+  // Reorders 'conjuncts', the arguments of an AND or OR, as described for
+  // AlgebrizerOptions::order_conjuncts_by_cost, if that option is true.
+  void MaybeOrderConjunctsByCost(
+      std::vector<const ResolvedExpr*>* conjuncts) const;
+
+  // Returns the ScanHints in the hint list of 'scan'. Returns an error for
+  // invalid values.
+  static zetasql_base::StatusOr<ScanHints> GetScanHints(
+      const ResolvedScan* scan);
+
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeJoinScan(
       const ResolvedJoinScan* join_scan,
       std::vector<FilterConjunctInfo*>* active_conjuncts);
@@ -317,7 +524,9 @@ class Algebrizer {
       const ResolvedExpr* join_expr,  // May be NULL
       const ResolvedScan* left_scan,
       const std::vector<ResolvedColumn>& right_output_column_list,
+      const ResolvedScan* right_scan,  // May be NULL
       const RightScanAlgebrizerCb& right_scan_algebrizer_cb,
+      const ScanHints& hints,
       std::vector<FilterConjunctInfo*>* active_conjuncts);
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeFilterScan(
       const ResolvedFilterScan* filter_scan,
@@ -325,9 +534,11 @@ class Algebrizer {
   zetasql_base::StatusOr<std::unique_ptr<AggregateOp>> AlgebrizeAggregateScan(
       const ResolvedAggregateScan* aggregate_scan);
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeSetOperationScan(
-      const ResolvedSetOperationScan* set_scan);
+      const ResolvedSetOperationScan* set_scan,
+      std::vector<FilterConjunctInfo*>* active_conjuncts);
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeUnionScan(
-      const ResolvedSetOperationScan* set_scan);
+      const ResolvedSetOperationScan* set_scan,
+      std::vector<FilterConjunctInfo*>* active_conjuncts);
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeExceptIntersectScan(
       const ResolvedSetOperationScan* set_scan);
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeProjectScan(
@@ -346,6 +557,10 @@ class Algebrizer {
       std::vector<FilterConjunctInfo*>* active_conjuncts);
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeLimitOffsetScan(
       const ResolvedLimitOffsetScan* scan);
+  // Algebrizes a TABLESAMPLE clause. SYSTEM sampling of a table scan is pushed
+  // into its EvaluatorTableScanOp as a block sample.
+  zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeSampleScan(
+      const ResolvedSampleScan* scan);
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeWithScan(
       const ResolvedWithScan* scan);
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeWithRefScan(
@@ -367,26 +582,66 @@ class Algebrizer {
       const FilterConjunctInfo& conjunct_info,
       std::vector<std::unique_ptr<ColumnFilterArg>>* and_filters);
 
+  // If 'algebrizer_options_.use_exchange_operators' is true or 'parallelism'
+  // is positive, and 'scan' is a chain of filters and projections over a table
+  // scan, returns 'rel_op' (the algebrized 'scan') wrapped in an ExchangeOp
+  // that partitions the table scan into 'parallelism' partitions (or
+  // EvaluationOptions::num_threads if it is 0). Otherwise returns 'rel_op'.
+  zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> MaybeAddExchange(
+      const ResolvedScan* scan, std::unique_ptr<RelationalOp> rel_op,
+      int parallelism);
+
+  // Returns a ColumnPredicateArg equivalent to 'expr', or nullptr if 'expr'
+  // cannot be expressed as one with the columns in 'column_info_map'.
+  zetasql_base::StatusOr<std::unique_ptr<ColumnPredicateArg>>
+  TryAlgebrizeExprAsColumnPredicateArg(
+      const TableScanColumnInfoMap& column_info_map, const ResolvedExpr* expr);
+
   // Algebrizes the resolved AST for an AnalyticScan. The AnalyticScan is
-  // converted to a sequence of AnalyticOp, one per analytic function group.
-  // For each analytic function group, a SortOp is also created if it contains
-  // partitioning and ordering expressions, even when the input relation has
-  // been already sorted by those expressions.
+  // converted to a sequence of AnalyticOp, one per analytic function group,
+  // or, if 'algebrizer_options_.share_analytic_sorts' is true, one per set of
+  // analytic function groups that can share a sort (see
+  // GroupAnalyticFunctionGroups()). For each AnalyticOp, a SortOp is also
+  // created if it contains partitioning and ordering expressions, even when
+  // the input relation has been already sorted by those expressions.
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeAnalyticScan(
-      const ResolvedAnalyticScan* analytic_scan);
+      const ResolvedAnalyticScan* analytic_scan,
+      const std::vector<FilterConjunctInfo*>& active_conjuncts);
+
+  // The rows of each partition of an analytic function group that a filter
+  // above its AnalyticOp can keep: the first 'limit' rows in the order of the
+  // window, and if 'with_ties' is true, the rows that tie with the last one.
+  struct PartitionLimit {
+    int64_t limit;
+    bool with_ties;
+  };
 
-  // Returns an AnalyticOp for 'analytic_group'. A SortOp is also created under
-  // the AnalyticOp if the partitioning or ordering expressions are not
+  // Returns the PartitionLimit for 'analytic_scan' that 'active_conjuncts'
+  // imply, if 'analytic_scan' only has one analytic function group with an
+  // ordering, and only computes ROW_NUMBER() and RANK() in it, and a conjunct
+  // compares one of them with an INT64 literal. Returns absl::nullopt
+  // otherwise.
+  static absl::optional<PartitionLimit> GetPartitionLimit(
+      const ResolvedAnalyticScan* analytic_scan,
+      const std::vector<FilterConjunctInfo*>& active_conjuncts);
+
+  // Returns an AnalyticOp for 'analytic_groups', which must have the same
+  // partitioning and whose orderings must be prefixes of the ordering of the
+  // first group. A SortOp is also created under the AnalyticOp if the
+  // partitioning or ordering expressions of the first group are not
   // empty. 'input_resolved_columns' contains the input columns including the
   // analytic columns created by the preceding analytic function
-  // groups. 'input_is_from_same_analytic_scan' must be true if 'analytic_group'
-  // and 'input_relation_op' correspond to the same AnalyticScan resolved AST
-  // node.
+  // groups. 'input_is_from_same_analytic_scan' must be true if
+  // 'analytic_groups' and 'input_relation_op' correspond to the same
+  // AnalyticScan resolved AST node.
+  // If 'partition_limit' is set, the SortOp only keeps the rows of each
+  // partition that it describes.
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeAnalyticFunctionGroup(
       const std::set<ResolvedColumn>& input_resolved_columns,
-      const ResolvedAnalyticFunctionGroup* analytic_group,
+      absl::Span<const ResolvedAnalyticFunctionGroup* const> analytic_groups,
       std::unique_ptr<RelationalOp> input_relation_op,
-      bool input_is_from_same_analytic_scan);
+      bool input_is_from_same_analytic_scan,
+      const absl::optional<PartitionLimit>& partition_limit);
 
   // Returns 'input_relation_op' if all the partitioning and ordering
   // expressions in 'analytic_group' are correlated column references.
@@ -400,7 +655,8 @@ class Algebrizer {
       const std::set<ResolvedColumn>& input_resolved_columns,
       const ResolvedAnalyticFunctionGroup* analytic_group,
       std::unique_ptr<RelationalOp> input_relation_op,
-      bool require_stable_sort);
+      bool require_stable_sort,
+      const absl::optional<PartitionLimit>& partition_limit);
 
   // Converts each ResolvedOrderByItem to a KeyArg.
   // If 'drop_correlated_columns' is true, the output 'order_by_keys' does not
@@ -540,6 +796,15 @@ class Algebrizer {
       std::vector<std::unique_ptr<ValueExpr>> args);
   zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeIn(
       const Type* output_type, std::vector<std::unique_ptr<ValueExpr>> args);
+  // Returns true if the '$in' or '$in_array' 'call' should be algebrized by
+  // AlgebrizeInListSet(): 'algebrizer_options_.use_in_list_sets' is set, the
+  // list is long enough or is an array, its elements are statement constants
+  // of the type of the value, and InListSet supports that type.
+  bool ShouldUseInListSet(const ResolvedFunctionCall* call) const;
+  // Returns an InListExpr of 'kind' for 'args', the value followed by the list
+  // (or the array).
+  zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeInListSet(
+      InListExpr::Kind kind, std::vector<std::unique_ptr<ValueExpr>> args);
   zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeBetween(
       const Type* output_type, std::vector<std::unique_ptr<ValueExpr>> args);
 
@@ -585,6 +850,55 @@ class Algebrizer {
       std::vector<FilterConjunctInfo*>* conjuncts_with_push_down,
       std::vector<JoinOp::HashJoinEqualityExprs>* hash_join_equality_exprs);
 
+  // Moves the entries of 'hash_join_equality_exprs' that compare
+  // 'left_sort_columns[i]' with 'right_sort_columns[i]' for i = 0, 1, ... to
+  // the front, in that order, stopping at the first i without one. Returns the
+  // number of such entries, which JoinOp can use as merge join keys.
+  zetasql_base::StatusOr<int> OrderHashJoinEqualityExprsForMergeJoin(
+      const std::vector<ResolvedColumn>& left_sort_columns,
+      const std::vector<ResolvedColumn>& right_sort_columns,
+      std::vector<JoinOp::HashJoinEqualityExprs>* hash_join_equality_exprs);
+
+  // The column of a table scan that the left-hand side of a hash join
+  // equality reads, which the table scan can filter with the keys of the hash
+  // table.
+  struct BuildKeysColumnFilter {
+    int equality_expr_idx;
+    EvaluatorTableScanOp* scan_op;        // Not owned.
+    const ResolvedTableScan* table_scan;  // Algebrized as 'scan_op'.
+    int column_idx;                       // In 'scan_op'.
+    VariableId column_variable;
+    const Type* key_type;
+  };
+
+  // Returns a BuildKeysColumnFilter for each of 'hash_join_equality_exprs'
+  // whose left-hand side reads a column of 'probe_scan' (which may be NULL)
+  // that comes from a table scan.
+  zetasql_base::StatusOr<std::vector<BuildKeysColumnFilter>>
+  FindBuildKeysColumnFilters(
+      const ResolvedScan* probe_scan,
+      const std::vector<JoinOp::HashJoinEqualityExprs>&
+          hash_join_equality_exprs);
+
+  // Makes the scans of 'filters' whose filters cover the primary key of their
+  // table look up their rows by key (see
+  // EvaluatorTableScanOp::SetKeyLookupColumns()), if
+  // 'algebrizer_options_.use_key_lookups_for_joins' allows it. 'build_scan' is
+  // the input of the join that is loaded into memory, or NULL if it is not a
+  // scan.
+  void SetKeyLookupColumns(const std::vector<BuildKeysColumnFilter>& filters,
+                           const ResolvedScan* build_scan);
+
+  // Passes 'max_num_rows' as a row limit hint to the EvaluatorTableScanOps of
+  // the table scans that produce the first 'max_num_rows' rows of 'scan',
+  // which must already be algebrized.
+  void AddRowLimitHints(const ResolvedScan* scan, int64_t max_num_rows);
+
+  // Makes 'join_op' publish the keys of its hash table for each of 'filters'
+  // and adds a BuildKeysColumnFilterArg that reads them to the scan.
+  zetasql_base::Status AddBuildKeysColumnFilters(
+      const std::vector<BuildKeysColumnFilter>& filters, JoinOp* join_op);
+
   // If 'conjunct_info' can be represented by a HashJoinEqualityExprs, populates
   // 'equality_exprs'. Else returns false.
   zetasql_base::StatusOr<bool> TryAlgebrizeFilterConjunctAsHashJoinEqualityExprs(
@@ -608,12 +922,22 @@ class Algebrizer {
       std::unique_ptr<RelationalOp> input,
       std::vector<FilterConjunctInfo*>* active_conjuncts);
 
+  // Algebrizes 'conjunct', which is part of a filter. If
+  // 'algebrizer_options_.defer_proto_field_reads' is true, marks the proto
+  // fields that it reads as eager fields of their ProtoFieldRegistries.
+  zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeFilterConjunct(
+      const ResolvedExpr* conjunct);
+
   // Returns a RelationalOp corresponding to 'input' that applies
   // 'algebrized_conjuncts' as filters.
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> ApplyAlgebrizedFilterConjuncts(
       std::unique_ptr<RelationalOp> input,
       std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts);
 
+  // Returns the conjunction of 'algebrized_conjuncts', which must not be empty.
+  zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> CombineFilterConjuncts(
+      std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts);
+
   // Represents a named or positional parameter.
   class Parameter {
    public:
@@ -802,6 +1126,16 @@ class Algebrizer {
   // the query.
   std::vector<std::unique_ptr<ExprArg>> with_subquery_let_assignments_;
 
+  // Maps each algebrized ResolvedTableScan to its EvaluatorTableScanOp (if
+  // any), for MaybeAddExchange() and FindBuildKeysColumnFilters(). Not owned.
+  absl::flat_hash_map<const ResolvedTableScan*, EvaluatorTableScanOp*>
+      table_scan_ops_;
+
+  // Owns the copies of filter conjuncts that are pushed below projections
+  // and UNION ALLs, which must outlive the algebrization because
+  // 'table_scan_ops_' may reference their subqueries.
+  std::vector<std::unique_ptr<const ResolvedExpr>> rewritten_conjuncts_;
+
   // Owns all the ProtoFieldRegistries created by the algebrizer.
   std::vector<std::unique_ptr<ProtoFieldRegistry>> proto_field_registries_;
 
@@ -848,6 +1182,26 @@ class Algebrizer {
   absl::flat_hash_map<SharedProtoFieldPath, ProtoFieldReader*>
       get_proto_field_reader_map_;
 
+  // Maps each JSON_EXTRACT_SCALAR call batched by
+  // AlgebrizeBatchedJsonExtractions() to the variable holding the array of
+  // extracted values and its offset in that array.
+  absl::flat_hash_map<const ResolvedFunctionCall*, std::pair<VariableId, int>>
+      batched_json_extractions_;
+
+  // Maps each occurrence of a subexpression recorded by
+  // AlgebrizeCommonSubexpressions() to the variable that holds its value.
+  absl::flat_hash_map<const ResolvedExpr*, VariableId> common_subexpressions_;
+
+  // The number of AlgebrizeScan() calls in progress. Expressions are only
+  // folded into CachedExprs inside of scans, where they are evaluated per row.
+  int num_scans_in_progress_ = 0;
+  // True while MaybeAlgebrizeCachedExpression() algebrizes the expression of a
+  // CachedExpr.
+  bool in_cached_expression_ = false;
+  // True while AlgebrizeFilterConjunct() algebrizes a conjunct, outside of
+  // any scans in that conjunct.
+  bool in_filter_conjunct_ = false;
+
   TypeFactory* type_factory_;  // Not owned.
 
   // For generating unique column names.
@@ -54,6 +54,7 @@ namespace zetasql {
 
 using testing::HasSubstr;
 using testing::MatchesRegex;
+using testing::Not;
 using testing::TestWithParam;
 using testing::ValuesIn;
 using zetasql_base::testing::StatusIs;
@@ -532,6 +533,60 @@ TEST_F(AlgebrizerTestBase, TableScanAsIterator) {
             "+-table: table_all_types)");
 }
 
+TEST_F(ExpressionAlgebrizerTest, PruneUnusedColumns) {
+  // SELECT col_int64 FROM (SELECT *, col_string AS s FROM table_all_types)
+  auto table_scan = MakeResolvedTableScan(columns_, &table_,
+                                          /*for_system_time_expr=*/nullptr);
+  for (int i = 0; i < columns_.size(); ++i) {
+    table_scan->add_column_index_list(i);
+  }
+  const ResolvedColumn s(100, "$subquery1", "s", StringType());
+  auto lower_project = MakeResolvedProjectScan();
+  lower_project->set_column_list(columns_);
+  lower_project->add_column_list(s);
+  lower_project->add_expr_list(MakeResolvedComputedColumn(
+      s, MakeResolvedColumnRef(StringType(), columns_[kStringColIdx],
+                               kNonCorrelated)));
+  lower_project->set_input_scan(std::move(table_scan));
+  auto upper_project = MakeResolvedProjectScan();
+  upper_project->add_column_list(columns_[kInt64ColIdx]);
+  upper_project->set_input_scan(std::move(lower_project));
+  auto query = MakeResolvedQueryStmt();
+  query->add_output_column_list(
+      MakeResolvedOutputColumn(kInt64Col, columns_[kInt64ColIdx]));
+  query->set_query(std::move(upper_project));
+
+  for (const bool prune_unused_columns : {false, true}) {
+    AlgebrizerOptions algebrizer_options;
+    algebrizer_options.prune_unused_columns = prune_unused_columns;
+    Parameters parameters;
+    ParameterMap column_map;
+    SystemVariablesAlgebrizerMap system_variables_map;
+    ResolvedColumnList output_column_list;
+    std::unique_ptr<RelationalOp> relation;
+    std::vector<std::string> output_column_names;
+    std::vector<VariableId> output_column_variables;
+    ZETASQL_ASSERT_OK(Algebrizer::AlgebrizeQueryStatementAsRelation(
+        LanguageOptions(), algebrizer_options, &type_factory_, query.get(),
+        &output_column_list, &relation, &output_column_names,
+        &output_column_variables, &parameters, &column_map,
+        &system_variables_map));
+    ASSERT_EQ(1, output_column_list.size());
+    EXPECT_EQ(columns_[kInt64ColIdx], output_column_list[0]);
+
+    const std::string debug_string = relation->DebugString();
+    EXPECT_THAT(debug_string, HasSubstr("col_int64#2"));
+    if (prune_unused_columns) {
+      // Only the selected column is read, and 's' is not computed.
+      EXPECT_THAT(debug_string, Not(HasSubstr("col_int32#0")));
+      EXPECT_THAT(debug_string, Not(HasSubstr("col_string")));
+    } else {
+      EXPECT_THAT(debug_string, HasSubstr("col_int32#0"));
+      EXPECT_THAT(debug_string, HasSubstr("$s"));
+    }
+  }
+}
+
 TEST_F(StatementAlgebrizerTest, SingleRowSelect) {
   // Create a resolved AST for a select:
   // SELECT 101, "Hello world", true, 2.71828, null;
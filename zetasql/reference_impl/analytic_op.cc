@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <deque>
 #include <functional>
 #include <limits>
 #include <memory>
@@ -32,6 +33,7 @@
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
 #include "zetasql/reference_impl/evaluation.h"
+#include "zetasql/reference_impl/function.h"
 #include "zetasql/reference_impl/operator.h"
 #include "zetasql/reference_impl/tuple.h"
 #include "zetasql/reference_impl/tuple_comparator.h"
@@ -1867,10 +1869,369 @@ zetasql_base::Status WindowFrameArg::IsStaticallyEmpty(
   return ::zetasql_base::OkStatus();
 }
 
+// -------------------------------------------------------
+// AnalyticArg
+// -------------------------------------------------------
+
+std::string AnalyticArg::NumOrderKeysDebugString() const {
+  if (!num_order_keys_.has_value()) return "";
+  return absl::StrCat(", num_order_keys=", num_order_keys_.value());
+}
+
 // -------------------------------------------------------
 // AggregateAnalyticArg
 // -------------------------------------------------------
 
+namespace {
+
+// Maintains the result of a plain builtin aggregation over a window of input
+// values that slides forward, i.e., values are added at its end and removed
+// from its start. Every value is added and removed once, so evaluating the
+// aggregation on all the windows of a partition takes time linear in the size
+// of the partition instead of in the total size of the windows.
+//
+// Supports COUNT, COUNT(*), COUNTIF, SUM of INT64, UINT64 and NUMERIC, AVG of
+// NUMERIC, whose results can be updated exactly when a value is removed, and
+// MIN and MAX of types that have a total order. MIN and MAX keep the values of
+// the window that can still become its extremal value in a deque, in which
+// they are sorted both by position and by value.
+//
+// Results are identical to those of AggregateArg::EvalAgg(). In particular,
+// AVG of INT64 and DOUBLE and SUM of DOUBLE are not supported, because their
+// results depend on the order in which the values are added.
+class SlidingWindowAggregator {
+ public:
+  // Returns nullptr if 'aggregator' is not supported.
+  static std::unique_ptr<SlidingWindowAggregator> Create(
+      const AggregateArg& aggregator);
+
+  SlidingWindowAggregator(const SlidingWindowAggregator&) = delete;
+  SlidingWindowAggregator& operator=(const SlidingWindowAggregator&) = delete;
+
+  // Adds 'value' at the end of the window. 'value' is ignored for COUNT(*).
+  void Push(const Value& value);
+
+  // Removes 'value', which must be the value at the start of the window.
+  void Pop(const Value& value);
+
+  // Returns the aggregation of the values in the window, or the error that
+  // the accumulator of the aggregation would return, e.g., on overflow.
+  zetasql_base::StatusOr<Value> GetResult() const;
+
+ private:
+  SlidingWindowAggregator(FunctionKind kind, const Type* input_type,
+                          const Type* output_type, bool ignores_null)
+      : kind_(kind),
+        input_type_(input_type),
+        output_type_(output_type),
+        ignores_null_(ignores_null) {}
+
+  // Returns true if 'a' must be kept in the deque instead of 'b' when 'a'
+  // follows 'b' in the window.
+  bool IsMoreExtremal(const Value& a, const Value& b) const {
+    if (input_type_->IsFloatingPoint()) {
+      return kind_ == FunctionKind::kMax ? b.ToDouble() < a.ToDouble()
+                                         : a.ToDouble() < b.ToDouble();
+    }
+    return kind_ == FunctionKind::kMax ? b.LessThan(a) : a.LessThan(b);
+  }
+
+  const FunctionKind kind_;
+  const Type* input_type_;
+  const Type* output_type_;
+  const bool ignores_null_;
+
+  // The number of values that were pushed and popped so far, including NULLs.
+  int64_t num_pushed_ = 0;
+  int64_t num_popped_ = 0;
+  // The number of non-NULL values in the window.
+  int64_t count_ = 0;
+  // COUNTIF.
+  int64_t countif_ = 0;
+  // SUM, AVG.
+  __int128 int128_sum_ = 0;
+  unsigned __int128 uint128_sum_ = 0;
+  NumericValue::SumAggregator numeric_sum_;
+  // MIN, MAX: the positions and values of the candidate extremal values. NaNs
+  // are only counted, since any NaN in the window makes the result NaN.
+  std::deque<std::pair<int64_t, Value>> extremal_values_;
+  int64_t num_nans_ = 0;
+};
+
+std::unique_ptr<SlidingWindowAggregator> SlidingWindowAggregator::Create(
+    const AggregateArg& aggregator) {
+  if (!aggregator.IsPlainAggregation()) return nullptr;
+  const BuiltinAggregateFunction* function =
+      dynamic_cast<const BuiltinAggregateFunction*>(
+          aggregator.aggregate_function()->function());
+  if (function == nullptr) return nullptr;
+  const Type* input_type = function->input_type();
+  const Type* output_type = function->output_type();
+  if (function->num_input_fields() == 0) {
+    if (function->kind() != FunctionKind::kCount) return nullptr;
+    return absl::WrapUnique(new SlidingWindowAggregator(
+        FunctionKind::kCount, input_type, output_type,
+        /*ignores_null=*/false));
+  }
+  if (function->num_input_fields() != 1 || !function->ignores_null()) {
+    return nullptr;
+  }
+
+  bool supported = false;
+  switch (function->kind()) {
+    case FunctionKind::kCount:
+      supported = true;
+      break;
+    case FunctionKind::kCountIf:
+      supported = input_type->IsBool();
+      break;
+    case FunctionKind::kSum:
+      supported = input_type->IsInt64() || input_type->IsUint64() ||
+                  input_type->IsNumericType();
+      break;
+    case FunctionKind::kAvg:
+      supported = input_type->IsNumericType();
+      break;
+    case FunctionKind::kMax:
+    case FunctionKind::kMin:
+      switch (input_type->kind()) {
+        case TYPE_INT32:
+        case TYPE_INT64:
+        case TYPE_UINT32:
+        case TYPE_UINT64:
+        case TYPE_BOOL:
+        case TYPE_DATE:
+        case TYPE_FLOAT:
+        case TYPE_DOUBLE:
+        case TYPE_NUMERIC:
+        case TYPE_STRING:
+        case TYPE_BYTES:
+          supported = true;
+          break;
+        default:
+          break;
+      }
+      break;
+    default:
+      break;
+  }
+  if (!supported) return nullptr;
+  return absl::WrapUnique(new SlidingWindowAggregator(
+      function->kind(), input_type, output_type, /*ignores_null=*/true));
+}
+
+void SlidingWindowAggregator::Push(const Value& value) {
+  const int64_t position = num_pushed_++;
+  if (ignores_null_ && value.is_null()) return;
+  ++count_;
+  switch (kind_) {
+    case FunctionKind::kCountIf:
+      if (value.bool_value()) ++countif_;
+      break;
+    case FunctionKind::kSum:
+    case FunctionKind::kAvg:
+      switch (input_type_->kind()) {
+        case TYPE_INT64:
+          int128_sum_ += value.int64_value();
+          break;
+        case TYPE_UINT64:
+          uint128_sum_ += value.uint64_value();
+          break;
+        default:
+          numeric_sum_.Add(value.numeric_value());
+          break;
+      }
+      break;
+    case FunctionKind::kMax:
+    case FunctionKind::kMin:
+      if (input_type_->IsFloatingPoint() && std::isnan(value.ToDouble())) {
+        ++num_nans_;
+        break;
+      }
+      // Values that are not more extremal than a value that follows them can
+      // never be the extremal value of a window. Ties are kept, so that the
+      // result is the first extremal value, as for EvalAgg().
+      while (!extremal_values_.empty() &&
+             IsMoreExtremal(value, extremal_values_.back().second)) {
+        extremal_values_.pop_back();
+      }
+      extremal_values_.emplace_back(position, value);
+      break;
+    default:
+      break;
+  }
+}
+
+void SlidingWindowAggregator::Pop(const Value& value) {
+  const int64_t position = num_popped_++;
+  if (ignores_null_ && value.is_null()) return;
+  --count_;
+  switch (kind_) {
+    case FunctionKind::kCountIf:
+      if (value.bool_value()) --countif_;
+      break;
+    case FunctionKind::kSum:
+    case FunctionKind::kAvg:
+      switch (input_type_->kind()) {
+        case TYPE_INT64:
+          int128_sum_ -= value.int64_value();
+          break;
+        case TYPE_UINT64:
+          // Exact, since the sum of the values in the window fits.
+          uint128_sum_ -= value.uint64_value();
+          break;
+        default:
+          numeric_sum_.Subtract(value.numeric_value());
+          break;
+      }
+      break;
+    case FunctionKind::kMax:
+    case FunctionKind::kMin:
+      if (input_type_->IsFloatingPoint() && std::isnan(value.ToDouble())) {
+        --num_nans_;
+      } else if (!extremal_values_.empty() &&
+                 extremal_values_.front().first == position) {
+        extremal_values_.pop_front();
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+zetasql_base::StatusOr<Value> SlidingWindowAggregator::GetResult() const {
+  switch (kind_) {
+    case FunctionKind::kCount:
+      return Value::Int64(count_);
+    case FunctionKind::kCountIf:
+      return Value::Int64(countif_);
+    default:
+      break;
+  }
+  if (count_ == 0) return Value::Null(output_type_);
+  switch (kind_) {
+    case FunctionKind::kSum:
+      switch (input_type_->kind()) {
+        case TYPE_INT64:
+          if (int128_sum_ > std::numeric_limits<int64_t>::max() ||
+              int128_sum_ < std::numeric_limits<int64_t>::min()) {
+            return ::zetasql_base::OutOfRangeErrorBuilder() << "int64 overflow";
+          }
+          return Value::Int64(static_cast<int64_t>(int128_sum_));
+        case TYPE_UINT64:
+          if (uint128_sum_ > std::numeric_limits<uint64_t>::max()) {
+            return ::zetasql_base::OutOfRangeErrorBuilder() << "uint64 overflow";
+          }
+          return Value::Uint64(static_cast<uint64_t>(uint128_sum_));
+        default: {
+          ZETASQL_ASSIGN_OR_RETURN(const NumericValue sum, numeric_sum_.GetSum());
+          return Value::Numeric(sum);
+        }
+      }
+    case FunctionKind::kAvg: {
+      ZETASQL_ASSIGN_OR_RETURN(const NumericValue average,
+                       numeric_sum_.GetAverage(count_));
+      return Value::Numeric(average);
+    }
+    case FunctionKind::kMax:
+    case FunctionKind::kMin:
+      if (num_nans_ > 0) {
+        return input_type_->kind() == TYPE_FLOAT
+                   ? Value::Float(std::numeric_limits<float>::quiet_NaN())
+                   : Value::Double(std::numeric_limits<double>::quiet_NaN());
+      }
+      ZETASQL_RET_CHECK(!extremal_values_.empty());
+      return extremal_values_.front().second;
+    default:
+      ZETASQL_RET_CHECK_FAIL() << "Unsupported sliding window aggregation";
+  }
+}
+
+// Returns the result of 'sliding_aggregator', or NULL if it fails and the
+// error is suppressed in the error mode of 'aggregator', as for
+// AggregateArg::EvalAgg().
+zetasql_base::StatusOr<Value> GetSlidingWindowResult(
+    const AggregateArg& aggregator,
+    const SlidingWindowAggregator& sliding_aggregator) {
+  zetasql_base::StatusOr<Value> result = sliding_aggregator.GetResult();
+  if (!result.ok() &&
+      ShouldSuppressError(result.status(), aggregator.error_mode())) {
+    return Value::Null(aggregator.type());
+  }
+  return result;
+}
+
+// Returns true if the starts and the ends of the non-empty 'windows' never
+// move backwards.
+bool WindowsSlideForward(absl::Span<const AnalyticWindow> windows) {
+  int prev_start = 0;
+  int prev_end = 0;
+  for (const AnalyticWindow& window : windows) {
+    if (window.num_tuples == 0) continue;
+    const int end = window.start_tuple_id + window.num_tuples;
+    if (window.start_tuple_id < prev_start || end < prev_end) return false;
+    prev_start = window.start_tuple_id;
+    prev_end = end;
+  }
+  return true;
+}
+
+// Evaluates 'aggregator' on 'windows' of 'partition', which must slide
+// forward, by pushing the tuples that enter each window to
+// 'sliding_aggregator' and popping the ones that leave it.
+zetasql_base::Status EvalSlidingWindows(
+    const AggregateArg& aggregator,
+    absl::Span<const TupleData* const> partition,
+    absl::Span<const AnalyticWindow> windows,
+    absl::Span<const TupleData* const> params, EvaluationContext* context,
+    SlidingWindowAggregator* sliding_aggregator, std::vector<Value>* values) {
+  const ValueExpr* input_field = aggregator.input_field_list_size() == 1
+                                     ? aggregator.input_field(0)
+                                     : nullptr;
+  // The input values of the tuples in [window_start, window_end), which have
+  // been pushed to 'sliding_aggregator'. Each value is evaluated when its
+  // tuple enters a window, as EvalAgg() would.
+  std::vector<Value> input_values(partition.size());
+  int window_start = 0;
+  int window_end = 0;
+  for (const AnalyticWindow& window : windows) {
+    if (window.num_tuples == 0) {
+      ZETASQL_ASSIGN_OR_RETURN(const Value agg_value,
+                       aggregator.EvalAgg(/*group=*/{}, params, context));
+      values->emplace_back(agg_value);
+      continue;
+    }
+    for (; window_start < window.start_tuple_id; ++window_start) {
+      if (window_start < window_end) {
+        sliding_aggregator->Pop(input_values[window_start]);
+        input_values[window_start] = Value();
+      }
+    }
+    window_end = std::max(window_end, window_start);
+    const int end = window.start_tuple_id + window.num_tuples;
+    for (; window_end < end; ++window_end) {
+      if (input_field != nullptr) {
+        TupleSlot slot;
+        zetasql_base::Status status;
+        if (!input_field->EvalSimple(
+                ConcatSpans(params, {partition[window_end]}), context, &slot,
+                &status)) {
+          return status;
+        }
+        input_values[window_end] = std::move(*slot.mutable_value());
+      }
+      sliding_aggregator->Push(input_values[window_end]);
+    }
+
+    ZETASQL_ASSIGN_OR_RETURN(Value agg_value,
+                     GetSlidingWindowResult(aggregator, *sliding_aggregator));
+    values->push_back(std::move(agg_value));
+  }
+  return zetasql_base::OkStatus();
+}
+
+}  // namespace
+
 zetasql_base::Status AggregateAnalyticArg::SetSchemasForEvaluation(
     const TupleSchema& partition_schema,
     absl::Span<const TupleSchema* const> params_schemas) {
@@ -1897,14 +2258,24 @@ zetasql_base::Status AggregateAnalyticArg::Eval(
       *partition_schema_, partition, order_keys, params, context, &windows,
       &window_frame_is_deterministic));
 
-  for (const AnalyticWindow& window : windows) {
-    // Call AggregateArg::EvalAgg to evaluate the argument expressions and
-    // compute the aggregate on each window.
-    const absl::Span<const TupleData* const> window_tuples =
-        partition.subspan(window.start_tuple_id, window.num_tuples);
-    ZETASQL_ASSIGN_OR_RETURN(const Value agg_value,
-                     aggregator_->EvalAgg(window_tuples, params, context));
-    values->emplace_back(agg_value);
+  std::unique_ptr<SlidingWindowAggregator> sliding_aggregator;
+  if (WindowsSlideForward(windows)) {
+    sliding_aggregator = SlidingWindowAggregator::Create(*aggregator_);
+  }
+  if (sliding_aggregator != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(EvalSlidingWindows(*aggregator_, partition, windows,
+                                       params, context,
+                                       sliding_aggregator.get(), values));
+  } else {
+    for (const AnalyticWindow& window : windows) {
+      // Call AggregateArg::EvalAgg to evaluate the argument expressions and
+      // compute the aggregate on each window.
+      const absl::Span<const TupleData* const> window_tuples =
+          partition.subspan(window.start_tuple_id, window.num_tuples);
+      ZETASQL_ASSIGN_OR_RETURN(const Value agg_value,
+                       aggregator_->EvalAgg(window_tuples, params, context));
+      values->emplace_back(agg_value);
+    }
   }
 
   // We conservatively treat aggregation results as non-deterministic
@@ -1919,7 +2290,8 @@ std::string AggregateAnalyticArg::DebugInternal(const std::string& indent,
                                                 bool verbose) const {
   return absl::StrCat("AggregateAnalyticArg(",
                       window_frame_->DebugInternal(indent, verbose), ", ",
-                      aggregator_->DebugInternal(indent, verbose), ")");
+                      aggregator_->DebugInternal(indent, verbose),
+                      NumOrderKeysDebugString(), ")");
 }
 
 // -------------------------------------------------------
@@ -2047,7 +2419,8 @@ std::string NonAggregateAnalyticArg::DebugInternal(const std::string& indent,
     absl::StrAppend(&result, "[", type()->DebugString(), "]");
   }
   absl::StrAppend(&result,
-                  " := ", function_call_->DebugInternal(indent, verbose), ")");
+                  " := ", function_call_->DebugInternal(indent, verbose),
+                  NumOrderKeysDebugString(), ")");
   return result;
 }
 
@@ -2254,8 +2627,9 @@ class AnalyticTupleIterator : public TupleIterator {
           remaining_current_partition_.GetTuplePtrs();
 
       std::vector<Value> values;
-      ZETASQL_RETURN_IF_ERROR(analytic_arg->Eval(current_partition_ptrs, order_keys_,
-                                         params_, context_, &values));
+      ZETASQL_RETURN_IF_ERROR(analytic_arg->Eval(
+          current_partition_ptrs, analytic_arg->GetOrderKeys(order_keys_),
+          params_, context_, &values));
 
       const int slot_idx = input_iter_->Schema().num_variables() + arg_idx;
       ZETASQL_RETURN_IF_ERROR(
@@ -2286,9 +2660,382 @@ class AnalyticTupleIterator : public TupleIterator {
   zetasql_base::Status status_;
   int64_t num_next_calls_ = 0;
 };
+
+// Returns true if StreamingAnalyticTupleIterator supports all of
+// 'analytic_args'.
+bool CanStreamAnalyticArgs(absl::Span<const AnalyticArg* const> analytic_args) {
+  for (const AnalyticArg* analytic_arg : analytic_args) {
+    const AggregateAnalyticArg* aggregate_arg =
+        dynamic_cast<const AggregateAnalyticArg*>(analytic_arg);
+    if (aggregate_arg == nullptr) return false;
+    const WindowFrameArg* window_frame = aggregate_arg->window_frame();
+    if (window_frame == nullptr ||
+        window_frame->window_frame_type() != WindowFrameArg::kRows) {
+      return false;
+    }
+    switch (window_frame->start_boundary_arg()->boundary_type()) {
+      case WindowFrameBoundaryArg::kUnboundedPreceding:
+      case WindowFrameBoundaryArg::kOffsetPreceding:
+      case WindowFrameBoundaryArg::kCurrentRow:
+        break;
+      default:
+        return false;
+    }
+    switch (window_frame->end_boundary_arg()->boundary_type()) {
+      case WindowFrameBoundaryArg::kCurrentRow:
+      case WindowFrameBoundaryArg::kOffsetFollowing:
+        break;
+      default:
+        return false;
+    }
+    if (SlidingWindowAggregator::Create(*aggregate_arg->aggregator()) ==
+        nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Same as AnalyticTupleIterator, but without loading whole partitions. All of
+// the 'analytic_args' must be supported according to CanStreamAnalyticArgs():
+// they are aggregations over ROWS window frames that start at UNBOUNDED
+// PRECEDING, 'n' PRECEDING or CURRENT ROW, and end at CURRENT ROW or 'm'
+// FOLLOWING. The window of a tuple never extends more than the largest 'm'
+// tuples past it, so the tuple is returned as soon as those have been read.
+// Only the tuples that have not been returned yet and the input values of the
+// aggregations that later windows still include are kept.
+class StreamingAnalyticTupleIterator : public TupleIterator {
+ public:
+  StreamingAnalyticTupleIterator(
+      absl::Span<const TupleData* const> params,
+      absl::Span<const KeyArg* const> partition_keys,
+      absl::Span<const AnalyticArg* const> analytic_args,
+      std::unique_ptr<TupleIterator> input_iter,
+      std::unique_ptr<TupleComparator> partition_comparator,
+      std::unique_ptr<TupleComparator> order_comparator,
+      std::vector<int> value_slot_idxs,
+      std::unique_ptr<TupleSchema> output_schema, EvaluationContext* context)
+      : params_(params.begin(), params.end()),
+        partition_keys_(partition_keys.begin(), partition_keys.end()),
+        input_iter_(std::move(input_iter)),
+        partition_comparator_(std::move(partition_comparator)),
+        order_comparator_(std::move(order_comparator)),
+        value_slot_idxs_(std::move(value_slot_idxs)),
+        output_schema_(std::move(output_schema)),
+        remaining_current_partition_(context->memory_accountant()),
+        context_(context) {
+    for (int arg_idx = 0; arg_idx < analytic_args.size(); ++arg_idx) {
+      ArgState arg_state;
+      arg_state.arg =
+          static_cast<const AggregateAnalyticArg*>(analytic_args[arg_idx]);
+      arg_state.slot_idx = input_iter_->Schema().num_variables() + arg_idx;
+      const WindowFrameArg* window_frame = arg_state.arg->window_frame();
+      arg_state.unbounded_preceding =
+          window_frame->start_boundary_arg()->IsUnbounded();
+      if (!window_frame->start_boundary_arg()->IsCurrentRow() ||
+          !window_frame->end_boundary_arg()->IsCurrentRow()) {
+        requires_unique_order_ = true;
+      }
+      arg_states_.push_back(std::move(arg_state));
+    }
+  }
+
+  StreamingAnalyticTupleIterator(const StreamingAnalyticTupleIterator&) =
+      delete;
+  StreamingAnalyticTupleIterator& operator=(
+      const StreamingAnalyticTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return *output_schema_; }
+
+  TupleData* Next() override {
+    if (num_next_calls_ %
+            absl::GetFlag(
+                FLAGS_zetasql_call_verify_not_aborted_rows_period) ==
+        0) {
+      zetasql_base::Status status = context_->VerifyNotAborted();
+      if (!status.ok()) {
+        status_ = status;
+        return nullptr;
+      }
+    }
+    ++num_next_calls_;
+
+    while (true) {
+      const int64_t num_pending_tuples =
+          num_tuples_read_ - num_tuples_returned_;
+      if (num_pending_tuples > 0 &&
+          (is_partition_complete_ || num_pending_tuples > max_following_)) {
+        // All the windows of the next tuple are complete.
+        zetasql_base::Status status = PopulateNextTuple();
+        if (!status.ok()) {
+          status_ = status;
+          return nullptr;
+        }
+        output_empty_ = false;
+        return current_.get();
+      }
+
+      if (is_partition_complete_) {
+        if (first_tuple_in_next_partition_ == nullptr) {
+          if (!output_empty_) {
+            // Partitioning by a floating point type is a non-deterministic
+            // operation unless the output is empty.
+            for (const KeyArg* key : partition_keys_) {
+              if (key->type()->IsFloatingPoint()) {
+                context_->SetNonDeterministicOutput();
+              }
+            }
+          }
+          return nullptr;
+        }
+        zetasql_base::Status status = StartPartition();
+        if (status.ok()) {
+          status = AddTupleToPartition(*first_tuple_in_next_partition_);
+        }
+        if (!status.ok()) {
+          status_ = status;
+          return nullptr;
+        }
+        first_tuple_in_next_partition_.reset();
+        continue;
+      }
+
+      const TupleData* input_data = input_iter_->Next();
+      if (input_data == nullptr) {
+        status_ = input_iter_->Status();
+        if (!status_.ok()) return nullptr;
+        CompletePartition();
+        continue;
+      }
+
+      zetasql_base::Status status;
+      if (num_tuples_read_ == 0) {
+        // 'input_data' is the first tuple of the first partition.
+        status = StartPartition();
+      } else if ((*partition_comparator_)(*last_tuple_read_, *input_data) ||
+                 (*partition_comparator_)(*input_data, *last_tuple_read_)) {
+        // We are done reading the current partition. 'input_data' belongs in
+        // the next partition.
+        first_tuple_in_next_partition_ =
+            absl::make_unique<TupleData>(*input_data);
+        CompletePartition();
+        continue;
+      }
+      if (status.ok()) status = AddTupleToPartition(*input_data);
+      if (!status.ok()) {
+        status_ = status;
+        return nullptr;
+      }
+    }
+  }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  std::string DebugString() const override {
+    return AnalyticOp::GetIteratorDebugString(input_iter_->DebugString());
+  }
+
+ private:
+  // The evaluation state of an AggregateAnalyticArg on the current partition.
+  // Positions are relative to the start of the partition.
+  struct ArgState {
+    const AggregateAnalyticArg* arg = nullptr;
+    int slot_idx = 0;
+    bool unbounded_preceding = false;
+    // The number of tuples that the window frame includes before and after
+    // the current row. 'num_preceding' is unused if 'unbounded_preceding'.
+    int64_t num_preceding = 0;
+    int64_t num_following = 0;
+    std::unique_ptr<SlidingWindowAggregator> sliding_aggregator;
+    // The input values of the tuples in [values_start, num_tuples_read_).
+    std::deque<Value> values;
+    int64_t values_start = 0;
+    // The tuples in [window_start, window_end) have been pushed to
+    // 'sliding_aggregator'.
+    int64_t window_start = 0;
+    int64_t window_end = 0;
+  };
+
+  // Resets the state for a new partition. Evaluates the window frame offsets
+  // when called for the first time.
+  zetasql_base::Status StartPartition() {
+    if (!offsets_evaluated_) {
+      for (ArgState& arg_state : arg_states_) {
+        const WindowFrameArg* window_frame = arg_state.arg->window_frame();
+        if (window_frame->start_boundary_arg()->boundary_type() ==
+            WindowFrameBoundaryArg::kOffsetPreceding) {
+          ZETASQL_ASSIGN_OR_RETURN(
+              arg_state.num_preceding,
+              GetOffset(*window_frame->start_boundary_arg()));
+        }
+        if (window_frame->end_boundary_arg()->boundary_type() ==
+            WindowFrameBoundaryArg::kOffsetFollowing) {
+          ZETASQL_ASSIGN_OR_RETURN(arg_state.num_following,
+                           GetOffset(*window_frame->end_boundary_arg()));
+        }
+        max_following_ = std::max(max_following_, arg_state.num_following);
+      }
+      offsets_evaluated_ = true;
+    }
+    for (ArgState& arg_state : arg_states_) {
+      arg_state.sliding_aggregator =
+          SlidingWindowAggregator::Create(*arg_state.arg->aggregator());
+      ZETASQL_RET_CHECK(arg_state.sliding_aggregator != nullptr);
+      arg_state.values.clear();
+      arg_state.values_start = 0;
+      arg_state.window_start = 0;
+      arg_state.window_end = 0;
+    }
+    num_tuples_read_ = 0;
+    num_tuples_returned_ = 0;
+    is_partition_complete_ = false;
+    is_uniquely_ordered_ = true;
+    return zetasql_base::OkStatus();
+  }
+
+  zetasql_base::StatusOr<int64_t> GetOffset(
+      const WindowFrameBoundaryArg& boundary) const {
+    Value offset;
+    ZETASQL_RETURN_IF_ERROR(boundary.GetOffsetValue(params_, context_, &offset));
+    ZETASQL_RET_CHECK(offset.type()->IsInt64());
+    return offset.int64_value();
+  }
+
+  // Appends 'data' to the current partition and evaluates the input values of
+  // the aggregations on it.
+  zetasql_base::Status AddTupleToPartition(const TupleData& data) {
+    if (num_tuples_read_ > 0 && requires_unique_order_ &&
+        is_uniquely_ordered_) {
+      // Same as TupleComparator::IsUniquelyOrdered(), one pair of adjacent
+      // tuples at a time.
+      if (!(*order_comparator_)(*last_tuple_read_, data)) {
+        for (const int slot_idx : value_slot_idxs_) {
+          if (!last_tuple_read_->slot(slot_idx).value().Equals(
+                  data.slot(slot_idx).value())) {
+            is_uniquely_ordered_ = false;
+            break;
+          }
+        }
+      }
+    }
+
+    for (ArgState& arg_state : arg_states_) {
+      const AggregateArg* aggregator = arg_state.arg->aggregator();
+      if (aggregator->input_field_list_size() == 0) {
+        arg_state.values.emplace_back();
+        continue;
+      }
+      TupleSlot slot;
+      zetasql_base::Status status;
+      if (!aggregator->input_field(0)->EvalSimple(
+              ConcatSpans(absl::Span<const TupleData* const>(params_),
+                          {&data}),
+              context_, &slot, &status)) {
+        return status;
+      }
+      arg_state.values.push_back(std::move(*slot.mutable_value()));
+    }
+
+    zetasql_base::Status status;
+    if (!remaining_current_partition_.PushBackCopy(data, &status)) {
+      return status;
+    }
+    if (last_tuple_read_ == nullptr) {
+      last_tuple_read_ = absl::make_unique<TupleData>(data);
+    } else {
+      *last_tuple_read_ = data;
+    }
+    ++num_tuples_read_;
+    return zetasql_base::OkStatus();
+  }
+
+  // Marks the current partition as completely read.
+  void CompletePartition() {
+    is_partition_complete_ = true;
+    if (requires_unique_order_ && !is_uniquely_ordered_) {
+      context_->SetNonDeterministicOutput();
+    }
+  }
+
+  // Pops the next tuple of the current partition into 'current_' and
+  // populates its analytic slots. The windows of the tuple must be complete.
+  zetasql_base::Status PopulateNextTuple() {
+    const int64_t position = num_tuples_returned_;
+    current_ = remaining_current_partition_.PopFront();
+    ++num_tuples_returned_;
+    for (ArgState& arg_state : arg_states_) {
+      const int64_t window_end =
+          num_tuples_read_ - position > arg_state.num_following
+              ? position + arg_state.num_following + 1
+              : num_tuples_read_;
+      for (; arg_state.window_end < window_end; ++arg_state.window_end) {
+        arg_state.sliding_aggregator->Push(
+            arg_state.values[arg_state.window_end - arg_state.values_start]);
+      }
+      if (arg_state.unbounded_preceding) {
+        // The values that have been pushed are never popped.
+        for (; arg_state.values_start < arg_state.window_end;
+             ++arg_state.values_start) {
+          arg_state.values.pop_front();
+        }
+      } else {
+        const int64_t window_start =
+            std::max<int64_t>(0, position - arg_state.num_preceding);
+        for (; arg_state.window_start < window_start;
+             ++arg_state.window_start) {
+          arg_state.sliding_aggregator->Pop(arg_state.values.front());
+          arg_state.values.pop_front();
+          ++arg_state.values_start;
+        }
+      }
+      ZETASQL_ASSIGN_OR_RETURN(
+          Value value,
+          GetSlidingWindowResult(*arg_state.arg->aggregator(),
+                                 *arg_state.sliding_aggregator));
+      current_->mutable_slot(arg_state.slot_idx)->SetValue(std::move(value));
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  const std::vector<const TupleData*> params_;
+  const std::vector<const KeyArg*> partition_keys_;
+  std::unique_ptr<TupleIterator> input_iter_;
+  std::unique_ptr<TupleComparator> partition_comparator_;
+  std::unique_ptr<TupleComparator> order_comparator_;
+  // The slots of the input tuples that are not order keys.
+  const std::vector<int> value_slot_idxs_;
+  std::unique_ptr<TupleSchema> output_schema_;
+  std::vector<ArgState> arg_states_;
+  // True if the output is only deterministic if the order within each
+  // partition is unique.
+  bool requires_unique_order_ = false;
+  bool offsets_evaluated_ = false;
+  // The largest 'num_following' of 'arg_states_'.
+  int64_t max_following_ = 0;
+  // The last tuple returned. NULL if Next() has never been called.
+  std::unique_ptr<TupleData> current_;
+  // The tuples of the current partition that have been read but not returned.
+  TupleDataDeque remaining_current_partition_;
+  // A copy of the last tuple that was read from 'input_iter_'.
+  std::unique_ptr<TupleData> last_tuple_read_;
+  int64_t num_tuples_read_ = 0;
+  int64_t num_tuples_returned_ = 0;
+  // True if all the tuples of the current partition have been read.
+  bool is_partition_complete_ = false;
+  // True if the tuples of the current partition that have been read so far
+  // are uniquely ordered.
+  bool is_uniquely_ordered_ = true;
+  bool output_empty_ = true;
+  // NULL unless 'is_partition_complete_' is true and the current partition is
+  // not the last one.
+  std::unique_ptr<TupleData> first_tuple_in_next_partition_;
+  EvaluationContext* context_;
+  zetasql_base::Status status_;
+  int64_t num_next_calls_ = 0;
+};
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> AnalyticOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> AnalyticOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   ZETASQL_ASSIGN_OR_RETURN(
@@ -2312,9 +3059,38 @@ class AnalyticTupleIterator : public TupleIterator {
       TupleComparator::Create(partition_keys(), slots_for_partition_keys,
                               params, context));
 
-  iter = absl::make_unique<AnalyticTupleIterator>(
-      params, partition_keys(), order_keys(), analytic_args(), std::move(iter),
-      std::move(partition_comparator), CreateOutputSchema(), context);
+  if (CanStreamAnalyticArgs(analytic_args())) {
+    // The order is unique for all the functions whose output depends on it
+    // if it is unique for the one with the fewest order keys.
+    absl::Span<const KeyArg* const> unique_order_keys = order_keys();
+    for (const AnalyticArg* arg : analytic_args()) {
+      if (arg->window_frame()->start_boundary_arg()->IsCurrentRow() &&
+          arg->window_frame()->end_boundary_arg()->IsCurrentRow()) {
+        continue;
+      }
+      if (arg->GetOrderKeys(order_keys()).size() < unique_order_keys.size()) {
+        unique_order_keys = arg->GetOrderKeys(order_keys());
+      }
+    }
+    std::vector<int> slots_for_order_keys;
+    std::vector<int> slots_for_values;
+    ZETASQL_RETURN_IF_ERROR(GetSlotsForKeysAndValues(iter->Schema(), unique_order_keys,
+                                             &slots_for_order_keys,
+                                             &slots_for_values));
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<TupleComparator> order_comparator,
+        TupleComparator::Create(unique_order_keys, slots_for_order_keys,
+                                params, context));
+    iter = absl::make_unique<StreamingAnalyticTupleIterator>(
+        params, partition_keys(), analytic_args(), std::move(iter),
+        std::move(partition_comparator), std::move(order_comparator),
+        std::move(slots_for_values), CreateOutputSchema(), context);
+  } else {
+    iter = absl::make_unique<AnalyticTupleIterator>(
+        params, partition_keys(), order_keys(), analytic_args(),
+        std::move(iter), std::move(partition_comparator), CreateOutputSchema(),
+        context);
+  }
   if (is_order_preserving()) {
     return iter;
   } else {
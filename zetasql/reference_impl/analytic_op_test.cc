@@ -3524,5 +3524,193 @@ TEST_P(AnalyticOpTest, AnalyticOpTest) {
                        HasSubstr("Out of memory")));
 }
 
+// MIN, MAX and SAFE.SUM over ROWS BETWEEN 1 PRECEDING AND CURRENT ROW, whose
+// windows slide forward, so they are evaluated incrementally.
+TEST(AggregateAnalyticArgTest, SlidingWindows) {
+  const int64_t int64max = std::numeric_limits<int64_t>::max();
+  const VariableId c("c");
+  const TupleSchema schema({c});
+  const std::vector<TupleData> tuples = CreateTestTupleDatas(
+      {{Int64(3)}, {NullInt64()}, {Int64(5)}, {Int64(int64max)}, {Int64(1)},
+       {Int64(2)}});
+
+  const std::vector<std::pair<FunctionKind, std::vector<Value>>> test_cases =
+      {{FunctionKind::kMin,
+        {Int64(3), Int64(3), Int64(5), Int64(5), Int64(1), Int64(1)}},
+       {FunctionKind::kMax,
+        {Int64(3), Int64(3), Int64(5), Int64(int64max), Int64(int64max),
+         Int64(2)}},
+       // The sums of the windows with int64max overflow.
+       {FunctionKind::kSum,
+        {Int64(3), Int64(3), Int64(5), NullInt64(), NullInt64(), Int64(3)}}};
+  for (const auto& test_case : test_cases) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_c, DerefExpr::Create(c, Int64Type()));
+    std::vector<std::unique_ptr<ValueExpr>> args;
+    args.push_back(std::move(deref_c));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        auto agg,
+        AggregateArg::Create(VariableId("agg"),
+                             absl::make_unique<BuiltinAggregateFunction>(
+                                 test_case.first, Int64Type(),
+                                 /*num_input_fields=*/1, Int64Type()),
+                             std::move(args), AggregateArg::kAll,
+                             /*having_expr=*/nullptr, AggregateArg::kHavingNone,
+                             /*order_by_keys=*/{}, /*limit=*/nullptr,
+                             ResolvedFunctionCallBase::SAFE_ERROR_MODE));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        auto analytic_arg,
+        AggregateAnalyticArg::Create(
+            AnalyticWindowTest::CreateWindowFrameFromParam(
+                AnalyticWindowTest::CreateOffsetPrecedingCurrentRow(
+                    WindowFrameArg::kRows, 1)),
+            std::move(agg), ResolvedFunctionCallBase::SAFE_ERROR_MODE));
+    ZETASQL_ASSERT_OK(
+        analytic_arg->SetSchemasForEvaluation(schema, EmptyParamsSchemas()));
+
+    EvaluationContext context((EvaluationOptions()));
+    std::vector<Value> values;
+    ZETASQL_ASSERT_OK(analytic_arg->Eval(GetTupleDataPtrs(tuples),
+                                 /*order_keys=*/{}, EmptyParams(), &context,
+                                 &values));
+    EXPECT_THAT(values, ElementsAreArray(test_case.second))
+        << BuiltinFunctionCatalog::GetDebugNameByKind(test_case.first);
+  }
+}
+
+// Returns an AnalyticOp over 'input_tuples' (with variables a, b and c) for
+//   SUM(c) OVER (PARTITION BY a ORDER BY b
+//                ROWS BETWEEN 1 PRECEDING AND 1 FOLLOWING),
+//   COUNT(*) OVER (PARTITION BY a ORDER BY b
+//                  ROWS BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW)
+// and RANK() OVER (PARTITION BY a ORDER BY b) if 'with_rank'.
+std::unique_ptr<AnalyticOp> CreateBoundedWindowsAnalyticOp(
+    const std::vector<TupleData>& input_tuples, bool with_rank) {
+  VariableId a("a"), b("b"), c("c");
+  auto input_op = absl::make_unique<TestRelationalOp>(
+      std::vector<VariableId>{a, b, c}, input_tuples,
+      /*preserves_order=*/true);
+
+  std::vector<std::unique_ptr<ValueExpr>> sum_args;
+  sum_args.push_back(DerefExpr::Create(c, Int64Type()).ValueOrDie());
+  std::vector<std::unique_ptr<AnalyticArg>> analytic_args;
+  analytic_args.push_back(
+      AggregateAnalyticArg::Create(
+          AnalyticWindowTest::CreateWindowFrameFromParam(
+              AnalyticWindowTest::CreateOffsetPrecedingOffsetFollowing(
+                  WindowFrameArg::kRows, 1, 1)),
+          AggregateArg::Create(VariableId("sum"),
+                               absl::make_unique<BuiltinAggregateFunction>(
+                                   FunctionKind::kSum, Int64Type(),
+                                   /*num_input_fields=*/1, Int64Type()),
+                               std::move(sum_args))
+              .ValueOrDie(),
+          DEFAULT_ERROR_MODE)
+          .ValueOrDie());
+  analytic_args.push_back(
+      AggregateAnalyticArg::Create(
+          AnalyticWindowTest::CreateWindowFrameFromParam(
+              AnalyticWindowTest::CreateUnboundedPrecedingCurrentRow(
+                  WindowFrameArg::kRows)),
+          AggregateArg::Create(VariableId("count"),
+                               absl::make_unique<BuiltinAggregateFunction>(
+                                   FunctionKind::kCount, Int64Type(),
+                                   /*num_input_fields=*/0, EmptyStructType()))
+              .ValueOrDie(),
+          DEFAULT_ERROR_MODE)
+          .ValueOrDie());
+  if (with_rank) {
+    analytic_args.push_back(
+        NonAggregateAnalyticArg::Create(
+            VariableId("rank"), /*window_frame=*/nullptr,
+            absl::make_unique<RankFunction>(), /*non_const_arguments=*/{},
+            /*const_arguments=*/{}, DEFAULT_ERROR_MODE)
+            .ValueOrDie());
+  }
+
+  std::vector<std::unique_ptr<KeyArg>> partition_keys;
+  partition_keys.emplace_back(absl::make_unique<KeyArg>(
+      a, DerefExpr::Create(a, Int64Type()).ValueOrDie(),
+      KeyArg::kNotApplicable));
+  std::vector<std::unique_ptr<KeyArg>> order_keys;
+  order_keys.emplace_back(absl::make_unique<KeyArg>(
+      b, DerefExpr::Create(b, Int64Type()).ValueOrDie(), KeyArg::kAscending));
+
+  std::unique_ptr<AnalyticOp> analytic_op =
+      AnalyticOp::Create(std::move(partition_keys), std::move(order_keys),
+                         std::move(analytic_args), std::move(input_op),
+                         /*preserves_order=*/true)
+          .ValueOrDie();
+  ZETASQL_CHECK_OK(analytic_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+  return analytic_op;
+}
+
+TEST(StreamingAnalyticOpTest, BoundedWindowFrames) {
+  const std::vector<TupleData> input_tuples =
+      CreateTestTupleDatas({{Int64(0), Int64(1), Int64(1)},
+                            {Int64(0), Int64(2), Int64(2)},
+                            {Int64(0), Int64(3), NullInt64()},
+                            {Int64(0), Int64(4), Int64(4)},
+                            {Int64(1), Int64(1), Int64(5)},
+                            {Int64(1), Int64(1), Int64(6)}});
+  std::unique_ptr<AnalyticOp> analytic_op =
+      CreateBoundedWindowsAnalyticOp(input_tuples, /*with_rank=*/false);
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      analytic_op->CreateIterator(EmptyParams(),
+                                  /*num_extra_slots=*/1, &context));
+  EXPECT_EQ(iter->DebugString(), "AnalyticTupleIterator(TestTupleIterator)");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  const std::vector<std::vector<Value>> expected_values = {
+      {Int64(3), Int64(1)}, {Int64(3), Int64(2)},  {Int64(6), Int64(3)},
+      {Int64(4), Int64(4)}, {Int64(11), Int64(1)}, {Int64(11), Int64(2)}};
+  ASSERT_EQ(data.size(), expected_values.size());
+  for (int i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(data[i].num_slots(), 6);
+    EXPECT_EQ(data[i].slot(3).value(), expected_values[i][0]);
+    EXPECT_EQ(data[i].slot(4).value(), expected_values[i][1]);
+  }
+  // The order of the tuples of the second partition is not unique.
+  EXPECT_FALSE(context.IsDeterministicOutput());
+}
+
+// Only the tuples whose windows are not complete yet are kept in memory, so
+// the partition does not need to fit in memory, unlike for RANK().
+TEST(StreamingAnalyticOpTest, DoesNotLoadPartitions) {
+  std::vector<std::vector<Value>> values;
+  for (int i = 0; i < 100; ++i) {
+    values.push_back({Int64(0), Int64(i), Int64(i)});
+  }
+  const std::vector<TupleData> input_tuples = CreateTestTupleDatas(values);
+
+  for (const bool with_rank : {false, true}) {
+    std::unique_ptr<AnalyticOp> analytic_op =
+        CreateBoundedWindowsAnalyticOp(input_tuples, with_rank);
+    EvaluationContext context(GetIntermediateMemoryEvaluationOptions(
+        /*total_bytes=*/2000));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<TupleIterator> iter,
+        analytic_op->CreateIterator(EmptyParams(),
+                                    /*num_extra_slots=*/0, &context));
+    if (with_rank) {
+      EXPECT_THAT(ReadFromTupleIterator(iter.get()),
+                  StatusIs(zetasql_base::StatusCode::kResourceExhausted,
+                           HasSubstr("Out of memory")));
+      continue;
+    }
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    ASSERT_EQ(data.size(), 100);
+    // SUM(c) ROWS BETWEEN 1 PRECEDING AND 1 FOLLOWING.
+    EXPECT_EQ(data[50].slot(3).value(), Int64(49 + 50 + 51));
+    EXPECT_EQ(data[99].slot(3).value(), Int64(98 + 99));
+    // COUNT(*) ROWS BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW.
+    EXPECT_EQ(data[99].slot(4).value(), Int64(100));
+    EXPECT_TRUE(context.IsDeterministicOutput());
+  }
+}
+
 }  // namespace
 }  // namespace zetasql
@@ -0,0 +1,503 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/compiled_expr.h"
+
+#include <utility>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/functions/arithmetics.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/reference_impl/function.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+namespace zetasql {
+
+namespace {
+
+// Most expressions that are worth compiling need only a handful of registers,
+// which we then keep on the stack.
+constexpr int kNumInlineRegisters = 16;
+
+bool IsSupportedTypeKind(TypeKind kind) {
+  return kind == TYPE_INT64 || kind == TYPE_DOUBLE || kind == TYPE_BOOL;
+}
+
+}  // namespace
+
+// Translates a tree of ValueExprs into instructions, allocating one register
+// per node.
+class CompiledExpr::Compiler {
+ public:
+  Compiler() {}
+  Compiler(const Compiler&) = delete;
+  Compiler& operator=(const Compiler&) = delete;
+
+  // Returns the register holding the value of 'expr', or -1 if 'expr' (or
+  // one of its descendants) is not supported.
+  int Compile(const ValueExpr* expr);
+
+  std::vector<Instruction>* mutable_program() { return &program_; }
+  std::vector<Register>* mutable_registers() { return &registers_; }
+  int num_function_calls() const { return num_function_calls_; }
+
+ private:
+  int NewRegister() {
+    registers_.emplace_back();
+    return registers_.size() - 1;
+  }
+
+  int Emit(Opcode opcode, int src1 = -1, int src2 = -1) {
+    Instruction instruction;
+    instruction.opcode = opcode;
+    instruction.dst = NewRegister();
+    instruction.src1 = src1;
+    instruction.src2 = src2;
+    program_.push_back(instruction);
+    return instruction.dst;
+  }
+
+  int CompileConst(const ConstExpr* expr);
+  int CompileDeref(const DerefExpr* expr);
+  int CompileFunctionCall(const ScalarFunctionCallExpr* expr);
+
+  std::vector<Instruction> program_;
+  std::vector<Register> registers_;
+  int num_function_calls_ = 0;
+};
+
+int CompiledExpr::Compiler::Compile(const ValueExpr* expr) {
+  if (!IsSupportedTypeKind(expr->output_type()->kind())) return -1;
+  if (const auto* const_expr = dynamic_cast<const ConstExpr*>(expr)) {
+    return CompileConst(const_expr);
+  }
+  if (const auto* deref_expr = dynamic_cast<const DerefExpr*>(expr)) {
+    return CompileDeref(deref_expr);
+  }
+  if (const auto* call_expr =
+          dynamic_cast<const ScalarFunctionCallExpr*>(expr)) {
+    return CompileFunctionCall(call_expr);
+  }
+  return -1;
+}
+
+int CompiledExpr::Compiler::CompileConst(const ConstExpr* expr) {
+  const Value& value = expr->value();
+  const int reg = NewRegister();
+  Register& r = registers_[reg];
+  r.is_null = value.is_null();
+  if (!r.is_null) {
+    switch (value.type_kind()) {
+      case TYPE_INT64:
+        r.int64_value = value.int64_value();
+        break;
+      case TYPE_DOUBLE:
+        r.double_value = value.double_value();
+        break;
+      case TYPE_BOOL:
+        r.bool_value = value.bool_value();
+        break;
+      default:
+        return -1;
+    }
+  }
+  return reg;
+}
+
+int CompiledExpr::Compiler::CompileDeref(const DerefExpr* expr) {
+  Opcode opcode;
+  switch (expr->output_type()->kind()) {
+    case TYPE_INT64:
+      opcode = kLoadInt64;
+      break;
+    case TYPE_DOUBLE:
+      opcode = kLoadDouble;
+      break;
+    case TYPE_BOOL:
+      opcode = kLoadBool;
+      break;
+    default:
+      return -1;
+  }
+  const int reg = Emit(opcode);
+  program_.back().deref = expr;
+  return reg;
+}
+
+int CompiledExpr::Compiler::CompileFunctionCall(
+    const ScalarFunctionCallExpr* expr) {
+  // SAFE calls turn errors into NULLs, which the program does not do.
+  if (expr->error_mode() != ResolvedFunctionCallBase::DEFAULT_ERROR_MODE) {
+    return -1;
+  }
+  const auto* function =
+      dynamic_cast<const BuiltinScalarFunction*>(expr->function());
+  if (function == nullptr) return -1;
+  ++num_function_calls_;
+
+  std::vector<int> args;
+  std::vector<TypeKind> arg_kinds;
+  for (const AlgebraArg* arg : expr->GetArgs()) {
+    const int reg = Compile(arg->value_expr());
+    if (reg < 0) return -1;
+    args.push_back(reg);
+    arg_kinds.push_back(arg->value_expr()->output_type()->kind());
+  }
+  const TypeKind output_kind = expr->output_type()->kind();
+
+  // Returns true if there are 'n' arguments, all of type 'kind'.
+  auto args_are = [&args, &arg_kinds](int n, TypeKind kind) {
+    if (args.size() != n) return false;
+    for (TypeKind arg_kind : arg_kinds) {
+      if (arg_kind != kind) return false;
+    }
+    return true;
+  };
+
+  switch (function->kind()) {
+    case FunctionKind::kAdd:
+    case FunctionKind::kSubtract:
+    case FunctionKind::kMultiply: {
+      if (!args_are(2, output_kind)) return -1;
+      const bool is_int64 = output_kind == TYPE_INT64;
+      if (!is_int64 && output_kind != TYPE_DOUBLE) return -1;
+      Opcode opcode;
+      if (function->kind() == FunctionKind::kAdd) {
+        opcode = is_int64 ? kAddInt64 : kAddDouble;
+      } else if (function->kind() == FunctionKind::kSubtract) {
+        opcode = is_int64 ? kSubtractInt64 : kSubtractDouble;
+      } else {
+        opcode = is_int64 ? kMultiplyInt64 : kMultiplyDouble;
+      }
+      return Emit(opcode, args[0], args[1]);
+    }
+    case FunctionKind::kDivide:
+      if (output_kind != TYPE_DOUBLE || !args_are(2, TYPE_DOUBLE)) return -1;
+      return Emit(kDivideDouble, args[0], args[1]);
+    case FunctionKind::kUnaryMinus:
+      if (!args_are(1, output_kind)) return -1;
+      if (output_kind == TYPE_INT64) return Emit(kNegateInt64, args[0]);
+      if (output_kind == TYPE_DOUBLE) return Emit(kNegateDouble, args[0]);
+      return -1;
+    case FunctionKind::kEqual:
+    case FunctionKind::kLess:
+    case FunctionKind::kLessOrEqual: {
+      if (output_kind != TYPE_BOOL || args.size() != 2 ||
+          !args_are(2, arg_kinds[0])) {
+        return -1;
+      }
+      // Rows are argument types, columns are kEqual, kLess and kLessOrEqual.
+      static const Opcode kComparisons[3][3] = {
+          {kEqualInt64, kLessInt64, kLessOrEqualInt64},
+          {kEqualDouble, kLessDouble, kLessOrEqualDouble},
+          {kEqualBool, kLessBool, kLessOrEqualBool}};
+      const int column = function->kind() == FunctionKind::kEqual
+                             ? 0
+                             : (function->kind() == FunctionKind::kLess ? 1 : 2);
+      const int row = arg_kinds[0] == TYPE_INT64
+                          ? 0
+                          : (arg_kinds[0] == TYPE_DOUBLE ? 1 : 2);
+      return Emit(kComparisons[row][column], args[0], args[1]);
+    }
+    case FunctionKind::kAnd:
+    case FunctionKind::kOr: {
+      if (output_kind != TYPE_BOOL || args.empty() ||
+          !args_are(args.size(), TYPE_BOOL)) {
+        return -1;
+      }
+      // Three-valued AND and OR are associative, so n-ary calls become chains
+      // of binary instructions. Every argument is still evaluated, like in the
+      // tree interpreter.
+      const Opcode opcode = function->kind() == FunctionKind::kAnd ? kAnd : kOr;
+      int reg = args[0];
+      for (int i = 1; i < args.size(); ++i) {
+        reg = Emit(opcode, reg, args[i]);
+      }
+      return reg;
+    }
+    case FunctionKind::kNot:
+      if (output_kind != TYPE_BOOL || !args_are(1, TYPE_BOOL)) return -1;
+      return Emit(kNot, args[0]);
+    case FunctionKind::kIsNull:
+      if (output_kind != TYPE_BOOL || args.size() != 1) return -1;
+      return Emit(kIsNull, args[0]);
+    default:
+      return -1;
+  }
+}
+
+// -------------------------------------------------------
+// CompiledExpr
+// -------------------------------------------------------
+
+std::unique_ptr<CompiledExpr> CompiledExpr::MaybeCreate(
+    std::unique_ptr<ValueExpr>* expr) {
+  Compiler compiler;
+  const int result_register = compiler.Compile(expr->get());
+  if (result_register < 0) return nullptr;
+
+  auto compiled = absl::WrapUnique(new CompiledExpr(std::move(*expr)));
+  compiled->program_ = std::move(*compiler.mutable_program());
+  compiled->initial_registers_ = std::move(*compiler.mutable_registers());
+  compiled->result_register_ = result_register;
+  compiled->num_function_calls_ = compiler.num_function_calls();
+  compiled->ResolveLoads();
+  return compiled;
+}
+
+bool CompiledExpr::IsCandidate(const ValueExpr* expr) {
+  return dynamic_cast<const ScalarFunctionCallExpr*>(expr) != nullptr;
+}
+
+::zetasql_base::Status CompiledExpr::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  ZETASQL_RETURN_IF_ERROR(
+      GetMutableArg(kExpr)->mutable_value_expr()->SetSchemasForEvaluation(
+          params_schemas));
+  ResolveLoads();
+  return ::zetasql_base::OkStatus();
+}
+
+void CompiledExpr::ResolveLoads() {
+  for (Instruction& instruction : program_) {
+    if (instruction.deref != nullptr) {
+      instruction.idx_in_params = instruction.deref->idx_in_params();
+      instruction.slot = instruction.deref->slot();
+    }
+  }
+}
+
+bool CompiledExpr::Eval(absl::Span<const TupleData* const> params,
+                        EvaluationContext* context, VirtualTupleSlot* result,
+                        ::zetasql_base::Status* status) const {
+  context->RecordFunctionCalls(num_function_calls_);
+  absl::InlinedVector<Register, kNumInlineRegisters> registers(
+      initial_registers_.begin(), initial_registers_.end());
+  if (!Run(params, registers.data(), status)) return false;
+
+  const Register& r = registers[result_register_];
+  if (r.is_null) {
+    result->SetValue(Value::Null(output_type()));
+    return true;
+  }
+  switch (output_type()->kind()) {
+    case TYPE_INT64:
+      result->SetValue(Value::Int64(r.int64_value));
+      break;
+    case TYPE_DOUBLE:
+      result->SetValue(Value::Double(r.double_value));
+      break;
+    case TYPE_BOOL:
+      result->SetValue(Value::Bool(r.bool_value));
+      break;
+    default:
+      *status = ::zetasql_base::InternalErrorBuilder()
+                << "Unexpected output type of CompiledExpr: "
+                << output_type()->DebugString();
+      return false;
+  }
+  return true;
+}
+
+bool CompiledExpr::Run(absl::Span<const TupleData* const> params,
+                       Register* registers,
+                       ::zetasql_base::Status* status) const {
+  for (const Instruction& instruction : program_) {
+    Register& dst = registers[instruction.dst];
+    switch (instruction.opcode) {
+      case kLoadInt64:
+      case kLoadDouble:
+      case kLoadBool: {
+        DCHECK(instruction.idx_in_params >= 0 && instruction.slot >= 0)
+            << "You forgot to call SetSchemasForEvaluation()";
+        const Value& value =
+            params[instruction.idx_in_params]->slot(instruction.slot).value();
+        dst.is_null = value.is_null();
+        if (dst.is_null) break;
+        if (instruction.opcode == kLoadInt64) {
+          dst.int64_value = value.int64_value();
+        } else if (instruction.opcode == kLoadDouble) {
+          dst.double_value = value.double_value();
+        } else {
+          dst.bool_value = value.bool_value();
+        }
+        break;
+      }
+      case kNegateInt64:
+      case kNegateDouble:
+      case kNot:
+      case kIsNull: {
+        const Register& src = registers[instruction.src1];
+        if (instruction.opcode == kIsNull) {
+          dst.is_null = false;
+          dst.bool_value = src.is_null;
+          break;
+        }
+        dst.is_null = src.is_null;
+        if (dst.is_null) break;
+        if (instruction.opcode == kNot) {
+          dst.bool_value = !src.bool_value;
+        } else if (instruction.opcode == kNegateDouble) {
+          dst.double_value = -src.double_value;
+        } else if (!functions::UnaryMinus<int64_t, int64_t>(
+                       src.int64_value, &dst.int64_value, status)) {
+          return false;
+        }
+        break;
+      }
+      case kAnd:
+      case kOr: {
+        const Register& x = registers[instruction.src1];
+        const Register& y = registers[instruction.src2];
+        // The dominant value (FALSE for AND, TRUE for OR) wins over NULL.
+        const bool dominant = instruction.opcode == kOr;
+        if ((!x.is_null && x.bool_value == dominant) ||
+            (!y.is_null && y.bool_value == dominant)) {
+          dst.is_null = false;
+          dst.bool_value = dominant;
+        } else if (x.is_null || y.is_null) {
+          dst.is_null = true;
+        } else {
+          dst.is_null = false;
+          dst.bool_value = !dominant;
+        }
+        break;
+      }
+      default: {
+        const Register& x = registers[instruction.src1];
+        const Register& y = registers[instruction.src2];
+        dst.is_null = x.is_null || y.is_null;
+        if (dst.is_null) break;
+        bool ok = true;
+        switch (instruction.opcode) {
+          case kAddInt64:
+            ok = functions::Add<int64_t>(x.int64_value, y.int64_value,
+                                         &dst.int64_value, status);
+            break;
+          case kSubtractInt64:
+            ok = functions::Subtract<int64_t>(x.int64_value, y.int64_value,
+                                              &dst.int64_value, status);
+            break;
+          case kMultiplyInt64:
+            ok = functions::Multiply<int64_t>(x.int64_value, y.int64_value,
+                                              &dst.int64_value, status);
+            break;
+          case kAddDouble:
+            ok = functions::Add<double>(x.double_value, y.double_value,
+                                        &dst.double_value, status);
+            break;
+          case kSubtractDouble:
+            ok = functions::Subtract<double>(x.double_value, y.double_value,
+                                             &dst.double_value, status);
+            break;
+          case kMultiplyDouble:
+            ok = functions::Multiply<double>(x.double_value, y.double_value,
+                                             &dst.double_value, status);
+            break;
+          case kDivideDouble:
+            ok = functions::Divide<double>(x.double_value, y.double_value,
+                                           &dst.double_value, status);
+            break;
+          case kEqualInt64:
+            dst.bool_value = x.int64_value == y.int64_value;
+            break;
+          case kLessInt64:
+            dst.bool_value = x.int64_value < y.int64_value;
+            break;
+          case kLessOrEqualInt64:
+            dst.bool_value = x.int64_value <= y.int64_value;
+            break;
+          // These are false if either side is NaN.
+          case kEqualDouble:
+            dst.bool_value = x.double_value == y.double_value;
+            break;
+          case kLessDouble:
+            dst.bool_value = x.double_value < y.double_value;
+            break;
+          case kLessOrEqualDouble:
+            dst.bool_value = x.double_value <= y.double_value;
+            break;
+          case kEqualBool:
+            dst.bool_value = x.bool_value == y.bool_value;
+            break;
+          case kLessBool:
+            dst.bool_value = !x.bool_value && y.bool_value;
+            break;
+          case kLessOrEqualBool:
+            dst.bool_value = !x.bool_value || y.bool_value;
+            break;
+          default:
+            *status = ::zetasql_base::InternalErrorBuilder()
+                      << "Unexpected opcode in CompiledExpr: "
+                      << instruction.opcode;
+            return false;
+        }
+        if (!ok) return false;
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+std::string CompiledExpr::DebugInternal(const std::string& indent,
+                                        bool verbose) const {
+  return absl::StrCat("CompiledExpr(", expr()->DebugInternal(indent, verbose),
+                      ")");
+}
+
+CompiledExpr::CompiledExpr(std::unique_ptr<ValueExpr> expr)
+    : ValueExpr(expr->output_type()) {
+  SetArg(kExpr, absl::make_unique<ExprArg>(std::move(expr)));
+}
+
+// -------------------------------------------------------
+// CompileValueExprs
+// -------------------------------------------------------
+
+void CompileValueExpr(std::unique_ptr<ValueExpr>* expr,
+                      ExpressionCompilationStats* stats) {
+  if (CompiledExpr::IsCandidate(expr->get())) {
+    ++stats->num_candidate_expressions;
+    std::unique_ptr<CompiledExpr> compiled = CompiledExpr::MaybeCreate(expr);
+    if (compiled != nullptr) {
+      ++stats->num_compiled_expressions;
+      *expr = std::move(compiled);
+      return;
+    }
+  }
+  // The whole expression is not supported, but some of its arguments might be.
+  CompileValueExprs(expr->get(), stats);
+}
+
+void CompileValueExprs(AlgebraNode* node, ExpressionCompilationStats* stats) {
+  for (AlgebraArg* arg : node->GetMutableArgs()) {
+    if (arg == nullptr || !arg->has_node()) continue;
+    if (arg->value_expr() == nullptr) {
+      CompileValueExprs(arg->mutable_node(), stats);
+      continue;
+    }
+    std::unique_ptr<ValueExpr> expr(
+        arg->release_node().release()->AsMutableValueExpr());
+    CompileValueExpr(&expr, stats);
+    arg->set_node(std::move(expr));
+  }
+}
+
+}  // namespace zetasql
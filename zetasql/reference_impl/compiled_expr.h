@@ -0,0 +1,172 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Compilation of trees of ScalarFunctionCallExprs into a linear program over
+// typed registers, which avoids the per-node virtual calls, intermediate
+// Values and status plumbing of the tree interpreter in value_expr.cc.
+//
+// Only a small subset of expressions is supported: INT64, DOUBLE and BOOL
+// constants and variables, arithmetic, comparisons, AND/OR/NOT and IS NULL.
+// Everything else is left to the tree interpreter.
+
+#ifndef ZETASQL_REFERENCE_IMPL_COMPILED_EXPR_H_
+#define ZETASQL_REFERENCE_IMPL_COMPILED_EXPR_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/reference_impl/evaluation.h"
+#include "zetasql/reference_impl/operator.h"
+#include "zetasql/reference_impl/tuple.h"
+#include <cstdint>
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+// Evaluates a compiled copy of a tree of ScalarFunctionCallExprs. The original
+// tree is kept as the only argument, both for DebugString() and because the
+// program reads the slots of its DerefExprs.
+class CompiledExpr : public ValueExpr {
+ public:
+  CompiledExpr(const CompiledExpr&) = delete;
+  CompiledExpr& operator=(const CompiledExpr&) = delete;
+
+  // Returns a CompiledExpr for 'expr' if every node of 'expr' is supported,
+  // or nullptr otherwise (in which case 'expr' is left untouched).
+  // SetSchemasForEvaluation() must already have been called on 'expr'.
+  static std::unique_ptr<CompiledExpr> MaybeCreate(
+      std::unique_ptr<ValueExpr>* expr);
+
+  // Returns true if 'expr' is a candidate for compilation, i.e., a
+  // ScalarFunctionCallExpr.
+  static bool IsCandidate(const ValueExpr* expr);
+
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  bool Eval(absl::Span<const TupleData* const> params,
+            EvaluationContext* context, VirtualTupleSlot* result,
+            ::zetasql_base::Status* status) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+  int num_instructions() const { return program_.size(); }
+  int num_registers() const { return initial_registers_.size(); }
+
+ private:
+  enum ArgKind { kExpr };
+
+  enum Opcode {
+    kLoadInt64,
+    kLoadDouble,
+    kLoadBool,
+    kAddInt64,
+    kSubtractInt64,
+    kMultiplyInt64,
+    kNegateInt64,
+    kAddDouble,
+    kSubtractDouble,
+    kMultiplyDouble,
+    kDivideDouble,
+    kNegateDouble,
+    kEqualInt64,
+    kLessInt64,
+    kLessOrEqualInt64,
+    kEqualDouble,
+    kLessDouble,
+    kLessOrEqualDouble,
+    kEqualBool,
+    kLessBool,
+    kLessOrEqualBool,
+    kAnd,
+    kOr,
+    kNot,
+    kIsNull,
+  };
+
+  // The type of the value in a register is implied by the instructions that
+  // read and write it.
+  struct Register {
+    union {
+      int64_t int64_value;
+      double double_value;
+      bool bool_value;
+    };
+    bool is_null = true;
+
+    Register() : int64_value(0) {}
+  };
+
+  struct Instruction {
+    Opcode opcode;
+    int dst = -1;
+    int src1 = -1;
+    int src2 = -1;
+    // Only used by loads. 'idx_in_params' and 'slot' are copied from 'deref'
+    // by SetSchemasForEvaluation().
+    const DerefExpr* deref = nullptr;
+    int idx_in_params = -1;
+    int slot = -1;
+  };
+
+  class Compiler;
+
+  explicit CompiledExpr(std::unique_ptr<ValueExpr> expr);
+
+  // Copies the slots of the DerefExprs into the load instructions.
+  void ResolveLoads();
+
+  // Executes 'program_' on 'registers'. Returns false and populates 'status'
+  // if an instruction fails.
+  bool Run(absl::Span<const TupleData* const> params, Register* registers,
+           ::zetasql_base::Status* status) const;
+
+  const ValueExpr* expr() const { return GetArg(kExpr)->value_expr(); }
+
+  std::vector<Instruction> program_;
+  // Registers holding constants are initialized here and never written.
+  std::vector<Register> initial_registers_;
+  int result_register_ = -1;
+  // The number of ScalarFunctionCallExprs in the original tree, reported to
+  // EvaluationContext::RecordFunctionCalls().
+  int num_function_calls_ = 0;
+};
+
+// Counts the expressions considered by CompileValueExprs().
+struct ExpressionCompilationStats {
+  // Number of ScalarFunctionCallExprs visited, i.e., those that are not
+  // arguments of another ScalarFunctionCallExpr that was compiled.
+  int64_t num_candidate_expressions = 0;
+  // Number of those that were replaced by a CompiledExpr.
+  int64_t num_compiled_expressions = 0;
+};
+
+// Replaces each maximal tree of ScalarFunctionCallExprs below 'node' that can
+// be compiled by a CompiledExpr, updating 'stats'. Expressions that cannot be
+// compiled are searched for compilable subtrees. SetSchemasForEvaluation() must
+// already have been called on 'node'.
+void CompileValueExprs(AlgebraNode* node, ExpressionCompilationStats* stats);
+
+// Same as above, but also considers '*expr' itself, which may be replaced.
+void CompileValueExpr(std::unique_ptr<ValueExpr>* expr,
+                      ExpressionCompilationStats* stats);
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_COMPILED_EXPR_H_
@@ -0,0 +1,284 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/compiled_expr.h"
+
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/language_options.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/reference_impl/evaluation.h"
+#include "zetasql/reference_impl/function.h"
+#include "zetasql/reference_impl/operator.h"
+#include "zetasql/reference_impl/tuple.h"
+#include "zetasql/reference_impl/tuple_test_util.h"
+#include "zetasql/reference_impl/variable_id.h"
+#include "zetasql/testing/test_value.h"
+#include "zetasql/testing/using_test_value.cc"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+namespace {
+
+using testing::IsNull;
+using testing::NotNull;
+using zetasql_base::testing::IsOkAndHolds;
+using zetasql_base::testing::StatusIs;
+
+using types::BoolType;
+using types::DoubleType;
+using types::Int64Type;
+using types::StringType;
+
+static const auto DEFAULT_ERROR_MODE =
+    ResolvedFunctionCallBase::DEFAULT_ERROR_MODE;
+
+template <typename... T>
+std::vector<std::unique_ptr<ValueExpr>> Exprs(T... exprs) {
+  std::vector<std::unique_ptr<ValueExpr>> result;
+  (result.push_back(std::move(exprs)), ...);
+  return result;
+}
+
+std::unique_ptr<ValueExpr> Call(
+    FunctionKind kind, const Type* output_type,
+    std::vector<std::unique_ptr<ValueExpr>> args,
+    ResolvedFunctionCallBase::ErrorMode error_mode = DEFAULT_ERROR_MODE) {
+  LanguageOptions language_options;
+  language_options.EnableMaximumLanguageFeaturesForDevelopment();
+  std::unique_ptr<ScalarFunctionBody> function =
+      BuiltinScalarFunction::CreateValidated(kind, language_options,
+                                             output_type, {})
+          .ValueOrDie();
+  return ScalarFunctionCallExpr::Create(std::move(function), std::move(args),
+                                        error_mode)
+      .ValueOrDie();
+}
+
+std::unique_ptr<ValueExpr> Deref(const VariableId& var, const Type* type) {
+  return DerefExpr::Create(var, type).ValueOrDie();
+}
+
+std::unique_ptr<ValueExpr> Const(const Value& value) {
+  return ConstExpr::Create(value).ValueOrDie();
+}
+
+zetasql_base::StatusOr<Value> EvalExpr(const ValueExpr& expr,
+                               absl::Span<const TupleData* const> params) {
+  EvaluationContext context((EvaluationOptions()));
+  TupleSlot slot;
+  zetasql_base::Status status;
+  if (!expr.EvalSimple(params, &context, &slot, &status)) {
+    return status;
+  }
+  return slot.value();
+}
+
+// Builds the expression returned by 'build' twice, sets its schemas to
+// 'schema', and compiles the second copy.
+template <typename BuildFn>
+void BuildBoth(const BuildFn& build, const TupleSchema& schema,
+               std::unique_ptr<ValueExpr>* interpreted,
+               std::unique_ptr<CompiledExpr>* compiled) {
+  *interpreted = build();
+  ZETASQL_ASSERT_OK((*interpreted)->SetSchemasForEvaluation({&schema}));
+  std::unique_ptr<ValueExpr> to_compile = build();
+  ZETASQL_ASSERT_OK(to_compile->SetSchemasForEvaluation({&schema}));
+  *compiled = CompiledExpr::MaybeCreate(&to_compile);
+  ASSERT_THAT(*compiled, NotNull());
+  EXPECT_THAT(to_compile, IsNull());
+}
+
+TEST(CompiledExprTest, ArithmeticAndComparison) {
+  const VariableId a("a"), b("b"), c("c");
+  const TupleSchema schema({a, b, c});
+  // c < a + b * 2
+  auto build = [&]() {
+    return Call(
+        FunctionKind::kLess, BoolType(),
+        Exprs(Deref(c, Int64Type()),
+              Call(FunctionKind::kAdd, Int64Type(),
+                   Exprs(Deref(a, Int64Type()),
+                         Call(FunctionKind::kMultiply, Int64Type(),
+                              Exprs(Deref(b, Int64Type()), Const(Int64(2))))))));
+  };
+  std::unique_ptr<ValueExpr> interpreted;
+  std::unique_ptr<CompiledExpr> compiled;
+  BuildBoth(build, schema, &interpreted, &compiled);
+  EXPECT_EQ(compiled->num_instructions(), 6);
+  EXPECT_EQ("CompiledExpr(Less($c, Add($a, Multiply($b, ConstExpr(2)))))",
+            compiled->DebugString());
+
+  const std::vector<std::vector<Value>> rows = {
+      {Int64(1), Int64(2), Int64(4)},    {Int64(1), Int64(2), Int64(5)},
+      {Int64(-7), Int64(3), Int64(-2)},  {NullInt64(), Int64(2), Int64(0)},
+      {Int64(1), NullInt64(), Int64(0)}, {Int64(1), Int64(2), NullInt64()}};
+  for (const std::vector<Value>& row : rows) {
+    const TupleData data = CreateTestTupleData(row);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(const Value expected,
+                         EvalExpr(*interpreted, {&data}));
+    EXPECT_THAT(EvalExpr(*compiled, {&data}), IsOkAndHolds(expected));
+  }
+}
+
+TEST(CompiledExprTest, DoubleArithmetic) {
+  const VariableId x("x"), y("y");
+  const TupleSchema schema({x, y});
+  // -(x / y) <= x - y
+  auto build = [&]() {
+    return Call(
+        FunctionKind::kLessOrEqual, BoolType(),
+        Exprs(Call(FunctionKind::kUnaryMinus, DoubleType(),
+                   Exprs(Call(FunctionKind::kDivide, DoubleType(),
+                              Exprs(Deref(x, DoubleType()),
+                                    Deref(y, DoubleType()))))),
+              Call(FunctionKind::kSubtract, DoubleType(),
+                   Exprs(Deref(x, DoubleType()), Deref(y, DoubleType())))));
+  };
+  std::unique_ptr<ValueExpr> interpreted;
+  std::unique_ptr<CompiledExpr> compiled;
+  BuildBoth(build, schema, &interpreted, &compiled);
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const std::vector<std::vector<Value>> rows = {
+      {Double(1), Double(2)},   {Double(-8), Double(2)},
+      {Double(nan), Double(1)}, {Double(1), NullDouble()},
+      {Double(1), Double(0)}};
+  for (const std::vector<Value>& row : rows) {
+    const TupleData data = CreateTestTupleData(row);
+    const zetasql_base::StatusOr<Value> expected = EvalExpr(*interpreted, {&data});
+    const zetasql_base::StatusOr<Value> actual = EvalExpr(*compiled, {&data});
+    ASSERT_EQ(expected.status(), actual.status());
+    if (expected.ok()) {
+      EXPECT_EQ(expected.ValueOrDie(), actual.ValueOrDie());
+    }
+  }
+}
+
+TEST(CompiledExprTest, ThreeValuedLogic) {
+  const VariableId p("p"), q("q");
+  const TupleSchema schema({p, q});
+  // (p AND q) OR NOT(p) OR q IS NULL
+  auto build = [&]() {
+    return Call(
+        FunctionKind::kOr, BoolType(),
+        Exprs(Call(FunctionKind::kAnd, BoolType(),
+                   Exprs(Deref(p, BoolType()), Deref(q, BoolType()))),
+              Call(FunctionKind::kNot, BoolType(), Exprs(Deref(p, BoolType()))),
+              Call(FunctionKind::kIsNull, BoolType(),
+                   Exprs(Deref(q, BoolType())))));
+  };
+  std::unique_ptr<ValueExpr> interpreted;
+  std::unique_ptr<CompiledExpr> compiled;
+  BuildBoth(build, schema, &interpreted, &compiled);
+
+  for (const Value& p_value : {True(), False(), NullBool()}) {
+    for (const Value& q_value : {True(), False(), NullBool()}) {
+      const TupleData data = CreateTestTupleData({p_value, q_value});
+      ZETASQL_ASSERT_OK_AND_ASSIGN(const Value expected,
+                           EvalExpr(*interpreted, {&data}));
+      EXPECT_THAT(EvalExpr(*compiled, {&data}), IsOkAndHolds(expected))
+          << p_value << " " << q_value;
+    }
+  }
+}
+
+TEST(CompiledExprTest, Int64OverflowIsAnError) {
+  const VariableId a("a");
+  const TupleSchema schema({a});
+  auto build = [&]() {
+    return Call(FunctionKind::kAdd, Int64Type(),
+                Exprs(Deref(a, Int64Type()), Const(Int64(1))));
+  };
+  std::unique_ptr<ValueExpr> interpreted;
+  std::unique_ptr<CompiledExpr> compiled;
+  BuildBoth(build, schema, &interpreted, &compiled);
+
+  const TupleData data =
+      CreateTestTupleData({Int64(std::numeric_limits<int64_t>::max())});
+  const zetasql_base::StatusOr<Value> expected = EvalExpr(*interpreted, {&data});
+  EXPECT_THAT(expected, StatusIs(zetasql_base::StatusCode::kOutOfRange));
+  EXPECT_EQ(expected.status(), EvalExpr(*compiled, {&data}).status());
+}
+
+TEST(CompiledExprTest, UnsupportedExpressions) {
+  const VariableId a("a"), s("s");
+  const TupleSchema schema({a, s});
+
+  // SAFE calls are left to the interpreter.
+  std::unique_ptr<ValueExpr> safe_add =
+      Call(FunctionKind::kAdd, Int64Type(),
+           Exprs(Deref(a, Int64Type()), Const(Int64(1))),
+           ResolvedFunctionCallBase::SAFE_ERROR_MODE);
+  ZETASQL_ASSERT_OK(safe_add->SetSchemasForEvaluation({&schema}));
+  EXPECT_THAT(CompiledExpr::MaybeCreate(&safe_add), IsNull());
+  EXPECT_THAT(safe_add, NotNull());
+
+  // So are STRING values.
+  std::unique_ptr<ValueExpr> string_equal =
+      Call(FunctionKind::kEqual, BoolType(),
+           Exprs(Deref(s, StringType()), Const(String("foo"))));
+  ZETASQL_ASSERT_OK(string_equal->SetSchemasForEvaluation({&schema}));
+  EXPECT_THAT(CompiledExpr::MaybeCreate(&string_equal), IsNull());
+  EXPECT_THAT(string_equal, NotNull());
+}
+
+TEST(CompiledExprTest, CompileValueExprs) {
+  const VariableId a("a"), s("s");
+  const TupleSchema schema({a, s});
+  // (s = 'foo') OR (a < 10) cannot be compiled as a whole because of the string
+  // comparison, but a < 10 can.
+  std::vector<std::unique_ptr<ExprArg>> args;
+  args.push_back(absl::make_unique<ExprArg>(
+      Call(FunctionKind::kOr, BoolType(),
+              Exprs(Call(FunctionKind::kEqual, BoolType(),
+                         Exprs(Deref(s, StringType()), Const(String("foo")))),
+                    Call(FunctionKind::kLess, BoolType(),
+                         Exprs(Deref(a, Int64Type()), Const(Int64(10))))))));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<NewStructExpr> root,
+      NewStructExpr::Create(
+          MakeStructType({{"x", BoolType()}}), std::move(args)));
+  ZETASQL_ASSERT_OK(root->SetSchemasForEvaluation({&schema}));
+
+  ExpressionCompilationStats stats;
+  CompileValueExprs(root.get(), &stats);
+  EXPECT_EQ(stats.num_candidate_expressions, 3);
+  EXPECT_EQ(stats.num_compiled_expressions, 1);
+  EXPECT_EQ(
+      "NewStructExpr(\n"
+      "+-type: STRUCT<x BOOL>,\n"
+      "+-0 x: Or(Equal($s, ConstExpr(\"foo\")), "
+      "CompiledExpr(Less($a, ConstExpr(10)))))",
+      root->DebugString());
+
+  const TupleData data = CreateTestTupleData({Int64(3), String("bar")});
+  EXPECT_THAT(EvalExpr(*root, {&data}),
+              IsOkAndHolds(Struct({"x"}, {True()})));
+}
+
+}  // namespace
+}  // namespace zetasql
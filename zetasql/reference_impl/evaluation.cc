@@ -16,6 +16,8 @@
 
 #include "zetasql/reference_impl/evaluation.h"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -32,6 +34,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "zetasql/base/arena.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/ret_check.h"
@@ -44,6 +47,9 @@ ABSL_FLAG(
 
 namespace zetasql {
 
+// The size of the blocks allocated by EvaluationContext::value_arena().
+static constexpr int64_t kValueArenaBlockSize = 64 * 1024;
+
 zetasql_base::Status ValidateFirstColumnPrimaryKey(
     const std::string& table_name, const Value& array,
     const LanguageOptions& language_options) {
@@ -83,7 +89,18 @@ zetasql_base::Status ValidateFirstColumnPrimaryKey(
 EvaluationContext::EvaluationContext(const EvaluationOptions& options)
     : options_(options),
       memory_accountant_(options.max_intermediate_byte_size),
-      deterministic_output_(true) {}
+      deterministic_output_(true) {
+  if (options_.collect_profile) {
+    profile_ = absl::make_unique<EvaluationProfile>();
+  }
+  if (options_.max_value_arena_byte_size > 0) {
+    value_arena_ = absl::make_unique<zetasql_base::UnsafeArena>(
+        std::min<int64_t>(kValueArenaBlockSize,
+                          options_.max_value_arena_byte_size));
+  }
+}
+
+EvaluationContext::~EvaluationContext() { ClearCachedValues(); }
 
 ::zetasql_base::Status EvaluationContext::AddTableAsArray(
     const std::string& table_name, bool is_value_table, Value array,
@@ -105,11 +122,11 @@ EvaluationContext::EvaluationContext(const EvaluationOptions& options)
 }
 
 zetasql_base::Status EvaluationContext::VerifyNotAborted() const {
-  if (cancelled_) {
+  if (cancelled_ || (parent_ != nullptr && parent_->cancelled_)) {
     return zetasql_base::CancelledErrorBuilder() << "The statement has been cancelled";
   }
   if (clock_->TimeNow() > statement_eval_deadline_) {
-    return zetasql_base::ResourceExhaustedErrorBuilder()
+    return zetasql_base::DeadlineExceededErrorBuilder()
            << "The statement has been aborted because the statement deadline ("
            << absl::FormatTime(statement_eval_deadline_, absl::UTCTimeZone())
            << ") was exceeded.";
@@ -117,6 +134,129 @@ zetasql_base::Status EvaluationContext::VerifyNotAborted() const {
   return zetasql_base::OkStatus();
 }
 
+std::unique_ptr<EvaluationContext> EvaluationContext::CreateChildContext(
+    int64_t max_intermediate_byte_size, const RelationalOp* partitioned_scan,
+    int partition_index, int num_partitions) {
+  EvaluationOptions options = options_;
+  options.max_intermediate_byte_size = max_intermediate_byte_size;
+  options.num_threads = 1;
+  options.max_value_arena_byte_size = 0;
+  auto child = absl::make_unique<EvaluationContext>(options);
+
+  // Initialize the lazy statement-level state here so that every child sees
+  // the same values, and so that they never write to this context.
+  LazilyInitializeCurrentTimestamp();
+  child->tables_ = tables_;
+  child->cached_values_ = cached_values_;
+  child->in_list_sets_ = in_list_sets_;
+  child->with_tables_ = with_tables_;
+  child->language_options_ = language_options_;
+  child->statement_eval_deadline_ = statement_eval_deadline_;
+  child->clock_ = clock_;
+  child->default_timezone_ = default_timezone_;
+  child->current_timestamp_ = current_timestamp_;
+  child->current_date_in_default_timezone_ = current_date_in_default_timezone_;
+  child->current_datetime_in_default_timezone_ =
+      current_datetime_in_default_timezone_;
+  child->current_time_in_default_timezone_ = current_time_in_default_timezone_;
+  child->populate_last_get_field_value_call_read_fields_from_proto_map_ =
+      populate_last_get_field_value_call_read_fields_from_proto_map_;
+
+  child->parent_ = this;
+  child->partitioned_scan_ = partitioned_scan;
+  child->partition_index_ = partition_index;
+  child->num_partitions_ = num_partitions;
+  return child;
+}
+
+void EvaluationContext::MergeChildContext(const EvaluationContext& child) {
+  stats_.num_spill_files += child.stats_.num_spill_files;
+  stats_.num_spilled_tuples += child.stats_.num_spilled_tuples;
+  stats_.num_spilled_bytes += child.stats_.num_spilled_bytes;
+  stats_.peak_num_groups =
+      std::max(stats_.peak_num_groups, child.stats_.peak_num_groups);
+  if (!child.deterministic_output_) deterministic_output_ = false;
+  num_proto_deserializations_ += child.num_proto_deserializations_;
+  num_proto_field_bytes_decoded_ += child.num_proto_field_bytes_decoded_;
+  used_top_n_accumulator_ |= child.used_top_n_accumulator_;
+  if (profile_ != nullptr && child.profile_ != nullptr) {
+    profile_->Merge(*child.profile_);
+  }
+}
+
+void EvaluationContext::ResetForReuse() {
+  DCHECK(parent_ == nullptr);
+  // These hold on to memory, and possibly to Values in the arena.
+  ClearCachedValues();
+  with_tables_.clear();
+  DCHECK_EQ(memory_accountant_.remaining_bytes(),
+            memory_accountant_.total_num_bytes());
+  stats_ = EvaluationStats();
+  if (profile_ != nullptr) {
+    profile_ = absl::make_unique<EvaluationProfile>();
+  }
+  if (value_arena_ != nullptr) {
+    value_arena_->Reset();
+  }
+  current_operator_profile_ = nullptr;
+  tables_.clear();
+  deterministic_output_ = true;
+  ClearDeadlineAndCancellationState();
+  current_timestamp_.reset();
+  num_proto_deserializations_ = 0;
+  num_proto_field_bytes_decoded_ = 0;
+  last_get_field_value_call_read_fields_from_proto_map_.clear();
+  used_top_n_accumulator_ = false;
+}
+
+void EvaluationContext::SetCachedValue(const ValueExpr* expr,
+                                       const Value& value) {
+  cached_values_.insert_or_assign(expr, InternalValue::CopyOutOfArena(value));
+}
+
+const Value* EvaluationContext::GetMemoizedSubqueryValue(
+    const ValueExpr* expr, const std::vector<Value>& key) {
+  const auto it = memoized_subquery_values_.find(std::make_pair(expr, key));
+  const bool hit = it != memoized_subquery_values_.end();
+  RecordSubqueryCacheLookup(hit);
+  return hit ? &it->second : nullptr;
+}
+
+void EvaluationContext::MemoizeSubqueryValue(const ValueExpr* expr,
+                                             std::vector<Value> key,
+                                             const Value& value) {
+  int64_t num_bytes = sizeof(std::pair<const ValueExpr*, std::vector<Value>>) +
+                      value.physical_byte_size();
+  for (Value& key_value : key) {
+    num_bytes += key_value.physical_byte_size();
+    key_value = InternalValue::CopyOutOfArena(key_value);
+  }
+  if (memoized_subquery_bytes_ + num_bytes >
+      options_.max_memoized_subquery_byte_size) {
+    return;
+  }
+  zetasql_base::Status status;
+  if (!memory_accountant_.RequestBytes(num_bytes, &status)) return;
+  const bool inserted =
+      memoized_subquery_values_
+          .emplace(std::make_pair(expr, std::move(key)),
+                   InternalValue::CopyOutOfArena(value))
+          .second;
+  if (inserted) {
+    memoized_subquery_bytes_ += num_bytes;
+  } else {
+    memory_accountant_.ReturnBytes(num_bytes);
+  }
+}
+
+void EvaluationContext::ClearCachedValues() {
+  cached_values_.clear();
+  in_list_sets_.clear();
+  memoized_subquery_values_.clear();
+  memory_accountant_.ReturnBytes(memoized_subquery_bytes_);
+  memoized_subquery_bytes_ = 0;
+}
+
 void EvaluationContext::InitializeDefaultTimeZone() {
   absl::TimeZone timezone;
   CHECK(absl::LoadTimeZone("America/Los_Angeles", &timezone));
@@ -17,8 +17,11 @@
 #ifndef ZETASQL_REFERENCE_IMPL_EVALUATION_H_
 #define ZETASQL_REFERENCE_IMPL_EVALUATION_H_
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -26,14 +29,17 @@
 #include "zetasql/public/civil_time.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/value.h"
+#include "zetasql/reference_impl/profile.h"
 #include "zetasql/reference_impl/tuple.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include <cstdint>
 #include "absl/container/flat_hash_map.h"
 #include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
 #include "absl/random/random.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "zetasql/base/arena.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/clock.h"
@@ -84,6 +90,27 @@ struct EvaluationOptions {
   // always says its results are ordered according to ZetaSQL semantics.
   bool use_top_n_accumulator_when_possible = false;
 
+  // If true, the reference implementation estimates APPROX_COUNT_DISTINCT with
+  // a HyperLogLog sketch (see hll_sketch.h) of fixed size instead of counting
+  // the distinct values exactly. Not safe to use in compliance or random query
+  // tests because the results are approximate.
+  bool use_sketches_for_approx_count_distinct = false;
+
+  // If positive, EvaluatorTableScanOp, FilterOp, ComputeOp and LimitOp pass
+  // tuples to each other in TupleBatches of (at most) this many rows instead of
+  // one at a time. Other operators consume these batches through Next(). Zero
+  // disables batching.
+  int batch_size = 0;
+
+  // The maximum number of threads that a single operator may use. Hash joins
+  // build and probe their hash tables in parallel if this is greater than
+  // one, and each ExchangeOp evaluates its input on this many threads (as do
+  // UnionAllOps that evaluate their inputs in parallel), each with its own
+  // EvaluationContext (see CreateChildContext()) and an equal share of
+  // 'max_intermediate_byte_size'. Sorts of many tuples also sort chunks of the
+  // tuples on this many threads and merge them in parallel.
+  int num_threads = 1;
+
   // Limit on the maximum number of in-memory bytes used by values. Exceeding
   // this limit results in an error. See the implementation of
   // Value::physical_byte_size for more details.
@@ -94,6 +121,12 @@ struct EvaluationOptions {
   // limit results in an error.
   int64_t max_intermediate_byte_size = 128 * 1024 * 1024;
 
+  // If non-empty, SortOp, AggregateOp and hash joins that would exceed
+  // 'max_intermediate_byte_size' write some of their tuples to unnamed
+  // temporary files in this directory instead of returning an error. See
+  // spill.h for details.
+  std::string spill_directory;
+
   // If true, the results of DML statements will include all rows in the
   // modified table; otherwise, only modified rows (i.e. those matching the
   // WHERE clause) are included. For DELETE, 'modified rows' means the rows to
@@ -102,9 +135,47 @@ struct EvaluationOptions {
   // Note that rows are considered modified even if the new row happens to be
   // the same as the old as long as they match the WHERE clause.
   bool return_all_rows_for_dml = true;
+
+  // If true, the EvaluationContext collects an EvaluationProfile with the
+  // number of rows, time and memory spent in each RelationalOp. This slows
+  // down evaluation.
+  bool collect_profile = false;
+
+  // If true and 'collect_profile' is true, the profile also counts the bytes
+  // of the Value payloads allocated and freed by each RelationalOp (see
+  // OperatorProfile::allocations).
+  bool track_allocations = false;
+
+  // If positive, the EvaluationContext owns an arena of up to this many bytes
+  // for the representations of the Values created while evaluating with it
+  // (see InternalValue::ScopedArena), which saves allocating and freeing them
+  // one by one. Values that escape the evaluation must be copied out of the
+  // arena with InternalValue::CopyOutOfArena().
+  int64_t max_value_arena_byte_size = 0;
+
+  // The maximum number of bytes that an EvaluationContext spends on the results
+  // of MemoizedSubqueryExprs. They are also charged against
+  // 'max_intermediate_byte_size'. Results that do not fit are not memoized.
+  int64_t max_memoized_subquery_byte_size = 16 * 1024 * 1024;
 };
 
+// Counters describing the work done by an evaluation.
+struct EvaluationStats {
+  // The number of files that operators spilled tuples to because they would
+  // otherwise have exceeded EvaluationOptions::max_intermediate_byte_size.
+  int64_t num_spill_files = 0;
+  // The total number of tuples and bytes written to those files.
+  int64_t num_spilled_tuples = 0;
+  int64_t num_spilled_bytes = 0;
+  // The largest number of groups that an AggregateOp held in memory at once.
+  int64_t peak_num_groups = 0;
+};
+
+class InListSet;
 class ProtoFieldReader;
+class RelationalOp;
+class SharedTupleBuffer;
+class ValueExpr;
 
 // Contains state about the evaluation in progress.
 class EvaluationContext {
@@ -117,11 +188,68 @@ class EvaluationContext {
   explicit EvaluationContext(const EvaluationOptions& options);
   EvaluationContext(const EvaluationContext&) = delete;
   EvaluationContext& operator=(const EvaluationContext&) = delete;
+  ~EvaluationContext();
 
   const EvaluationOptions& options() const { return options_; }
 
   MemoryAccountant* memory_accountant() { return &memory_accountant_; }
 
+  const EvaluationStats& stats() const { return stats_; }
+  EvaluationStats* mutable_stats() { return &stats_; }
+
+  // Returns nullptr unless EvaluationOptions::max_value_arena_byte_size is
+  // positive. Children created by CreateChildContext() have no arena, because
+  // the Values they produce are read by the parent.
+  zetasql_base::UnsafeArena* value_arena() { return value_arena_.get(); }
+
+  // Returns nullptr unless EvaluationOptions::collect_profile is true.
+  const EvaluationProfile* profile() const { return profile_.get(); }
+  EvaluationProfile* mutable_profile() { return profile_.get(); }
+
+  // The profile of the RelationalOp whose iterator is currently running on
+  // this context, or nullptr if there is none or profiling is disabled. Set by
+  // RelationalOp::CreateIterator() and the iterators it returns.
+  OperatorProfile* current_operator_profile() const {
+    return current_operator_profile_;
+  }
+  void set_current_operator_profile(OperatorProfile* profile) {
+    current_operator_profile_ = profile;
+  }
+
+  // Charges 'num_calls' scalar function calls to the current operator.
+  void RecordFunctionCalls(int64_t num_calls) {
+    if (current_operator_profile_ != nullptr) {
+      current_operator_profile_->num_function_calls += num_calls;
+    }
+  }
+
+  // Records whether the current operator found the result of a subquery in
+  // the results memoized by MemoizeSubqueryValue().
+  void RecordSubqueryCacheLookup(bool hit) {
+    if (current_operator_profile_ == nullptr) return;
+    if (hit) {
+      ++current_operator_profile_->num_subquery_cache_hits;
+    } else {
+      ++current_operator_profile_->num_subquery_cache_misses;
+    }
+  }
+
+  // Charges 'stall_time' spent waiting for an EvaluatorTableIterator to the
+  // current operator.
+  void RecordTableStallTime(absl::Duration stall_time) {
+    if (current_operator_profile_ != nullptr) {
+      current_operator_profile_->table_stall_time += stall_time;
+    }
+  }
+
+  // Records that the current operator holds a hash table with 'size' entries.
+  void RecordHashTableSize(int64_t size) {
+    if (current_operator_profile_ != nullptr) {
+      current_operator_profile_->peak_hash_table_size =
+          std::max(current_operator_profile_->peak_hash_table_size, size);
+    }
+  }
+
   // Returns the contents of table 'table_name' or Value::Invalid().
   Value GetTableAsArray(const std::string& table_name) {
     const auto it = tables_.find(table_name);
@@ -136,6 +264,66 @@ class EvaluationContext {
                                  bool is_value_table, Value array,
                                  const LanguageOptions& language_options);
 
+  // Returns the value that SetCachedValue() stored for 'expr', or NULL if
+  // there is none. Used by CachedExpr to evaluate expressions that do not
+  // depend on any tuple once per statement.
+  const Value* GetCachedValue(const ValueExpr* expr) const {
+    const auto it = cached_values_.find(expr);
+    return it == cached_values_.end() ? nullptr : &it->second;
+  }
+
+  // Stores a copy of 'value' for GetCachedValue(). The copy does not refer to
+  // the value arena.
+  void SetCachedValue(const ValueExpr* expr, const Value& value);
+
+  // Returns the value that MemoizeSubqueryValue() stored for 'expr' and 'key',
+  // or NULL if there is none, and records the lookup in the profile. Used by
+  // MemoizedSubqueryExpr.
+  const Value* GetMemoizedSubqueryValue(const ValueExpr* expr,
+                                        const std::vector<Value>& key);
+
+  // Stores copies of 'key' and 'value' for GetMemoizedSubqueryValue() and
+  // charges them to the MemoryAccountant. Does nothing if that would exceed
+  // EvaluationOptions::max_memoized_subquery_byte_size or the memory of the
+  // MemoryAccountant.
+  void MemoizeSubqueryValue(const ValueExpr* expr, std::vector<Value> key,
+                            const Value& value);
+
+  // Makes 'table', the materialized contents of a WITH table, accessible
+  // under 'variable' for WithRefScanOps. Replaces any table previously stored
+  // under 'variable'.
+  void SetWithTable(const VariableId& variable,
+                    std::shared_ptr<const SharedTupleBuffer> table) {
+    with_tables_[variable] = std::move(table);
+  }
+
+  // Returns the table that SetWithTable() stored under 'variable', or NULL if
+  // there is none.
+  std::shared_ptr<const SharedTupleBuffer> GetWithTable(
+      const VariableId& variable) const {
+    const auto it = with_tables_.find(variable);
+    return it == with_tables_.end() ? nullptr : it->second;
+  }
+
+  // Returns the set that SetInListSet() stored for 'expr', or NULL if there is
+  // none. Used by InListExpr to build the set of its elements once per
+  // statement.
+  const InListSet* GetInListSet(const ValueExpr* expr) const {
+    const auto it = in_list_sets_.find(expr);
+    return it == in_list_sets_.end() ? nullptr : it->second.get();
+  }
+
+  // Stores 'set' for GetInListSet().
+  void SetInListSet(const ValueExpr* expr,
+                    std::shared_ptr<const InListSet> set) {
+    in_list_sets_[expr] = std::move(set);
+  }
+
+  // Forgets the values stored by SetCachedValue(), MemoizeSubqueryValue() and
+  // SetInListSet(), e.g. because the parameters of the next evaluation are
+  // different.
+  void ClearCachedValues();
+
   // Indicates that the result of evaluation is non-deterministic.
   void SetNonDeterministicOutput() { deterministic_output_ = false; }
 
@@ -253,7 +441,7 @@ class EvaluationContext {
   // callbacks are just a way of notifying user code that the statement has been
   // cancelled if we are stuck in a user's EvaluatorTableIterator.
   ::zetasql_base::Status CancelStatement() {
-    cancelled_ = true;
+    SetCancelled();
     // Call all the callbacks, returning the first non-OK error code.
     zetasql_base::Status ret = zetasql_base::OkStatus();
     for (const CancelCallback& cb : cancel_cbs_) {
@@ -265,6 +453,13 @@ class EvaluationContext {
     return ret;
   }
 
+  // Makes VerifyNotAborted() fail on this context and its children without
+  // invoking the cancellation callbacks. Unlike the other non-const methods,
+  // this may be called concurrently with an evaluation that uses this context,
+  // e.g. by a consumer on another thread that is no longer interested in the
+  // results.
+  void SetCancelled() { cancelled_ = true; }
+
   // Reset the deadline to infinity, uncancel the statement, and clear the
   // cancellation callbacks.
   void ClearDeadlineAndCancellationState() {
@@ -273,16 +468,85 @@ class EvaluationContext {
     cancel_cbs_.clear();
   }
 
-  // Returns an error if the statement has been aborted. This function is
-  // expensive (it gets the current time).
+  // Returns an error if the statement has been aborted: CANCELLED if it has
+  // been cancelled, and DEADLINE_EXCEEDED if its deadline has passed. This
+  // function is expensive (it gets the current time).
   ::zetasql_base::Status VerifyNotAborted() const;
 
+  // Calls VerifyNotAborted() on every
+  // --zetasql_call_verify_not_aborted_rows_period-th call, counting the calls
+  // in '*num_calls', so that loops can call it for every row they process.
+  zetasql_base::Status VerifyNotAbortedPeriodically(int64_t* num_calls) const {
+    if ((*num_calls)++ %
+            absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period) !=
+        0) {
+      return zetasql_base::OkStatus();
+    }
+    return VerifyNotAborted();
+  }
+
+  // Returns a new context for evaluating part of the statement on another
+  // thread on behalf of an ExchangeOp. The child shares the statement-level
+  // state of this context (language options, time zone, current timestamp,
+  // deadline and tables), but has its own MemoryAccountant that can allocate
+  // 'max_intermediate_byte_size' bytes, runs nested operators on a single
+  // thread, and reports itself as aborted when this context is cancelled.
+  // The child starts with the cached values of this context.
+  // 'partitioned_scan' evaluated with the child only produces partition
+  // 'partition_index' of 'num_partitions' of its rows (see
+  // GetScanPartition()).
+  //
+  // Must be called on the thread that uses this context, which must outlive
+  // the child. Once the child is no longer used, MergeChildContext() folds
+  // its statistics back into this context.
+  std::unique_ptr<EvaluationContext> CreateChildContext(
+      int64_t max_intermediate_byte_size, const RelationalOp* partitioned_scan,
+      int partition_index, int num_partitions);
+
+  // Adds the statistics of 'child', which must have been created by
+  // CreateChildContext(), to this context.
+  void MergeChildContext(const EvaluationContext& child);
+
+  // Makes this context ready to evaluate another statement, so that callers
+  // that evaluate many cheap statements can reuse contexts instead of
+  // constructing one per statement. Keeps the options, clock, default time
+  // zone, language options and the memory of the value arena, and clears
+  // everything else that evaluating a statement changes, including the current
+  // timestamp, tables, cached values, statistics, profile, deadline and
+  // cancellation state.
+  // No Values allocated in the arena may be alive, and all the bytes of the
+  // MemoryAccountant must have been returned. Must not be called on a child
+  // context.
+  void ResetForReuse();
+
+  // Returns true and populates 'partition_index' and 'num_partitions' if
+  // 'scan' must only produce one partition of its rows in this context.
+  bool GetScanPartition(const RelationalOp* scan, int* partition_index,
+                        int* num_partitions) const {
+    if (partitioned_scan_ == nullptr || partitioned_scan_ != scan) {
+      return false;
+    }
+    *partition_index = partition_index_;
+    *num_partitions = num_partitions_;
+    return true;
+  }
+
   int num_proto_deserializations() const { return num_proto_deserializations_; }
 
   void set_num_proto_deserializations(int n) {
     num_proto_deserializations_ = n;
   }
 
+  // The total physical byte size of the proto field Values that
+  // ProtoFieldReaders have decoded.
+  int64_t num_proto_field_bytes_decoded() const {
+    return num_proto_field_bytes_decoded_;
+  }
+
+  void add_num_proto_field_bytes_decoded(int64_t num_bytes) {
+    num_proto_field_bytes_decoded_ += num_bytes;
+  }
+
   bool used_top_n_accumulator() const { return used_top_n_accumulator_; }
 
   void set_used_top_n_accumulator(bool value) {
@@ -331,16 +595,41 @@ class EvaluationContext {
 
   const EvaluationOptions options_;
   MemoryAccountant memory_accountant_;
+  EvaluationStats stats_;
+  std::unique_ptr<EvaluationProfile> profile_;
+  std::unique_ptr<zetasql_base::UnsafeArena> value_arena_;
+  OperatorProfile* current_operator_profile_ = nullptr;
   // Tables added by AddTableAsArray().
   std::map<std::string, Value> tables_;
+  // Values stored by SetCachedValue().
+  absl::flat_hash_map<const ValueExpr*, Value> cached_values_;
+  // Sets stored by SetInListSet(). Shared with children.
+  absl::flat_hash_map<const ValueExpr*, std::shared_ptr<const InListSet>>
+      in_list_sets_;
+  // Values stored by MemoizeSubqueryValue(), and the number of bytes charged
+  // to 'memory_accountant_' for them.
+  absl::flat_hash_map<std::pair<const ValueExpr*, std::vector<Value>>, Value>
+      memoized_subquery_values_;
+  int64_t memoized_subquery_bytes_ = 0;
+  // Tables stored by SetWithTable().
+  absl::flat_hash_map<VariableId, std::shared_ptr<const SharedTupleBuffer>>
+      with_tables_;
   // Indicates that the result of evaluation is non-deterministic.
   bool deterministic_output_;
   LanguageOptions language_options_;
   // Default is no deadline.
   absl::Time statement_eval_deadline_ = absl::InfiniteFuture();
-  bool cancelled_ = false;
+  // Atomic because children created by CreateChildContext() read it from
+  // other threads.
+  std::atomic<bool> cancelled_{false};
   std::vector<CancelCallback> cancel_cbs_;
 
+  // Set by CreateChildContext().
+  const EvaluationContext* parent_ = nullptr;
+  const RelationalOp* partitioned_scan_ = nullptr;
+  int partition_index_ = 0;
+  int num_partitions_ = 1;
+
   // Used to obtain the current timestamp.
   zetasql_base::Clock* clock_ = zetasql_base::Clock::RealClock();
 
@@ -357,6 +646,9 @@ class EvaluationContext {
   // Records the number of times a proto was deserialized. Only for unit tests.
   int num_proto_deserializations_ = 0;
 
+  // See num_proto_field_bytes_decoded().
+  int64_t num_proto_field_bytes_decoded_ = 0;
+
   // Whether to populate
   // 'last_get_field_value_call_read_fields_from_proto_map_'. For performance
   // reasons, this is only set to true in unit tests.
@@ -0,0 +1,54 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Process-wide RuntimeMetrics of the reference implementation. Unlike the
+// OperatorProfiles in profile.h, they are always collected.
+
+#ifndef ZETASQL_REFERENCE_IMPL_EVALUATOR_METRICS_H_
+#define ZETASQL_REFERENCE_IMPL_EVALUATOR_METRICS_H_
+
+#include "zetasql/public/runtime_metrics.h"
+
+namespace zetasql {
+
+struct EvaluatorMetrics {
+  RuntimeCounter queries_executed{"evaluator/queries_executed",
+                                  "Number of evaluated queries"};
+  RuntimeHistogram query_output_rows{"evaluator/query_output_rows",
+                                     "Number of rows returned per query"};
+  RuntimeHistogram peak_tracked_bytes{
+      "evaluator/peak_tracked_bytes",
+      "Peak bytes held by the operators of a MemoryAccountant"};
+  RuntimeCounter out_of_memory_errors{
+      "evaluator/out_of_memory_errors",
+      "Number of requests rejected by a MemoryAccountant"};
+  RuntimeCounter spill_files{"evaluator/spill_files",
+                             "Number of files that tuples were spilled to"};
+  RuntimeCounter spilled_tuples{"evaluator/spilled_tuples",
+                                "Number of tuples spilled to disk"};
+  RuntimeCounter spilled_bytes{"evaluator/spilled_bytes",
+                               "Number of bytes spilled to disk"};
+  RuntimeCounter proto_deserializations{
+      "evaluator/proto_deserializations",
+      "Number of protos deserialized to read their fields"};
+};
+
+// Returns the EvaluatorMetrics of the process.
+EvaluatorMetrics& GetEvaluatorMetrics();
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_EVALUATOR_METRICS_H_
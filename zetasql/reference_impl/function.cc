@@ -56,6 +56,7 @@
 #include "zetasql/public/functions/parse_date_time.h"
 #include "zetasql/public/functions/percentile.h"
 #include "zetasql/public/functions/regexp.h"
+#include "zetasql/public/functions/regexp_cache.h"
 #include "zetasql/public/functions/string.h"
 #include "zetasql/public/numeric_value.h"
 #include "zetasql/public/options.pb.h"
@@ -64,6 +65,7 @@
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
+#include "zetasql/reference_impl/aggregate_state.h"
 #include "zetasql/reference_impl/common.h"
 #include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/proto_util.h"
@@ -382,6 +384,8 @@ FunctionMap::FunctionMap() {
   RegisterFunction(FunctionKind::kAnd, "$and", "And");
   RegisterFunction(FunctionKind::kAndAgg, kPrivate, "AndAgg");
   RegisterFunction(FunctionKind::kAnyValue, "any_value", "AnyValue");
+  RegisterFunction(FunctionKind::kApproxCountDistinct, "approx_count_distinct",
+                   "ApproxCountDistinct");
   RegisterFunction(FunctionKind::kArrayAgg, "array_agg", "ArrayAgg");
   RegisterFunction(FunctionKind::kArrayConcat, "array_concat", "ArrayConcat");
   RegisterFunction(FunctionKind::kArrayConcatAgg, "array_concat_agg",
@@ -452,6 +456,10 @@ FunctionMap::FunctionMap() {
                    "JsonExtractArray");
   RegisterFunction(FunctionKind::kJsonQuery, "json_query", "JsonQuery");
   RegisterFunction(FunctionKind::kJsonValue, "json_value", "JsonValue");
+  RegisterFunction(FunctionKind::kToJsonString, "to_json_string",
+                   "ToJsonString");
+  RegisterFunction(FunctionKind::kJsonExtractScalars, "$json_extract_scalars",
+                   "JsonExtractScalars");
   RegisterFunction(FunctionKind::kGreatest, "greatest", "Greatest");
   RegisterFunction(FunctionKind::kIsNull, "$is_null", "IsNull");
   RegisterFunction(FunctionKind::kIsTrue, "$is_true", "IsTrue");
@@ -663,13 +671,22 @@ const FunctionMap& GetFunctionMap() {
 template <TypeKind type>
 struct ValueTraits;
 
+// SPLIT and REGEXP_EXTRACT_ALL return their parts as views into the STRING or
+// BYTES input 'value' instead of copying each part. Returns the copy of
+// 'value' that owns the contents of those views. It shares the payload of
+// 'value', but not its arena, because the parts may outlive the arena.
+static std::shared_ptr<const Value> ShareStringContents(const Value& value) {
+  return std::make_shared<const Value>(InternalValue::CopyOutOfArena(value));
+}
+
 // Traits for zetasql String
 template <>
 struct ValueTraits<TYPE_STRING> {
   static zetasql_base::Status InitializePattern(const Value& pattern,
+                                        functions::RegExpCache* cache,
                                         functions::RegExp* regexp) {
     zetasql_base::Status status;
-    regexp->InitializePatternUtf8(FromValue(pattern), &status);
+    regexp->InitializePatternUtf8(FromValue(pattern), cache, &status);
     return status;
   }
 
@@ -677,8 +694,18 @@ struct ValueTraits<TYPE_STRING> {
     return value.string_value();
   }
 
+  static absl::string_view ViewFromValue(const Value& value) {
+    return value.string_view_value();
+  }
+
   static Value ToValue(absl::string_view out) { return Value::String(out); }
 
+  // Returns a value that refers to 'out', which must point into 'owner'.
+  static Value ToExternalValue(absl::string_view out,
+                               std::shared_ptr<const Value> owner) {
+    return Value::ExternalString(out, std::move(owner));
+  }
+
   static Value ToArray(absl::Span<const Value> values) {
     return Value::Array(types::StringArrayType(), values);
   }
@@ -692,9 +719,10 @@ struct ValueTraits<TYPE_STRING> {
 template <>
 struct ValueTraits<TYPE_BYTES> {
   static zetasql_base::Status InitializePattern(const Value& pattern,
+                                        functions::RegExpCache* cache,
                                         functions::RegExp* regexp) {
     zetasql_base::Status status;
-    regexp->InitializePatternBytes(FromValue(pattern), &status);
+    regexp->InitializePatternBytes(FromValue(pattern), cache, &status);
     return status;
   }
 
@@ -702,8 +730,18 @@ struct ValueTraits<TYPE_BYTES> {
     return value.bytes_value();
   }
 
+  static absl::string_view ViewFromValue(const Value& value) {
+    return value.bytes_view_value();
+  }
+
   static Value ToValue(absl::string_view out) { return Value::Bytes(out); }
 
+  // Returns a value that refers to 'out', which must point into 'owner'.
+  static Value ToExternalValue(absl::string_view out,
+                               std::shared_ptr<const Value> owner) {
+    return Value::ExternalBytes(out, std::move(owner));
+  }
+
   static Value ToArray(absl::Span<const Value> values) {
     return Value::Array(types::BytesArrayType(), values);
   }
@@ -715,18 +753,21 @@ struct ValueTraits<TYPE_BYTES> {
 
 // Wrap the function in a function which initializes the RE2 expr (if the
 // RE2 pattern is not known at Prepare time) or initialize the RE2 expression
-// and directly pass back the function.
+// and directly pass back the function. Patterns that are not known at Prepare
+// time are compiled through the process-wide RegExpCache.
 template <TypeKind type>
 static RegexpFunction::EvalFunction WrapOrInitRegexpFunction(
     RegexpFunction::EvalFunction func, const ConstExpr* pattern,
     functions::RegExp* regexp, zetasql_base::Status* status) {
   if (pattern && !pattern->value().is_null()) {
-    *status = ValueTraits<type>::InitializePattern(pattern->value(), regexp);
+    *status = ValueTraits<type>::InitializePattern(pattern->value(),
+                                                   /*cache=*/nullptr, regexp);
     return func;
   } else {
     return [func](const absl::Span<const Value>& x,
                   functions::RegExp* regexp) -> zetasql_base::StatusOr<Value> {
-      ZETASQL_RETURN_IF_ERROR(ValueTraits<type>::InitializePattern(x[1], regexp));
+      ZETASQL_RETURN_IF_ERROR(ValueTraits<type>::InitializePattern(
+          x[1], functions::RegExpCache::Default(), regexp));
       return func(x, regexp);
     };
   }
@@ -793,15 +834,15 @@ static zetasql_base::StatusOr<Value> ExtractAll(absl::Span<const Value> x,
                                         functions::RegExp* regexp) {
   zetasql_base::Status status;
   std::vector<Value> values;
-  std::string in_str = ValueTraits<type>::FromValue(x[0]);
-  absl::string_view in = in_str;
-  regexp->ExtractAllReset(in);
+  // The matches are views into 'input', which they keep alive.
+  const std::shared_ptr<const Value> input = ShareStringContents(x[0]);
+  regexp->ExtractAllReset(ValueTraits<type>::ViewFromValue(*input));
   while (true) {
     absl::string_view out;
     if (!regexp->ExtractAllNext(&out, &status)) {
       break;
     }
-    values.push_back(ValueTraits<type>::ToValue(out));
+    values.push_back(ValueTraits<type>::ToExternalValue(out, input));
   }
   if (!status.ok()) {
     return status;
@@ -1015,6 +1056,78 @@ std::string BuiltinFunctionCatalog::GetDebugNameByKind(FunctionKind kind) {
                               kind);
 }
 
+BuiltinFunctionCatalog::CostClass BuiltinFunctionCatalog::GetCostClassByKind(
+    FunctionKind kind) {
+  switch (kind) {
+    case FunctionKind::kRegexpExtract:
+    case FunctionKind::kRegexpExtractAll:
+    case FunctionKind::kRegexpContains:
+    case FunctionKind::kRegexpMatch:
+    case FunctionKind::kRegexpReplace:
+    case FunctionKind::kJsonExtract:
+    case FunctionKind::kJsonExtractScalar:
+    case FunctionKind::kJsonExtractArray:
+    case FunctionKind::kJsonQuery:
+    case FunctionKind::kJsonValue:
+    case FunctionKind::kJsonExtractScalars:
+    case FunctionKind::kToJsonString:
+    case FunctionKind::kFromProto:
+    case FunctionKind::kToProto:
+    case FunctionKind::kMakeProto:
+    case FunctionKind::kReplaceFields:
+    case FunctionKind::kNormalize:
+    case FunctionKind::kNormalizeAndCasefold:
+    case FunctionKind::kGenerateArray:
+    case FunctionKind::kGenerateDateArray:
+    case FunctionKind::kGenerateTimestampArray:
+    case FunctionKind::kMd5:
+    case FunctionKind::kSha1:
+    case FunctionKind::kSha256:
+    case FunctionKind::kSha512:
+      return kExpensive;
+    case FunctionKind::kLike:
+    case FunctionKind::kConcat:
+    case FunctionKind::kLower:
+    case FunctionKind::kUpper:
+    case FunctionKind::kLtrim:
+    case FunctionKind::kRtrim:
+    case FunctionKind::kTrim:
+    case FunctionKind::kReplace:
+    case FunctionKind::kSplit:
+    case FunctionKind::kStrpos:
+    case FunctionKind::kSubstr:
+    case FunctionKind::kLpad:
+    case FunctionKind::kRpad:
+    case FunctionKind::kRepeat:
+    case FunctionKind::kReverse:
+    case FunctionKind::kToBase64:
+    case FunctionKind::kFromBase64:
+    case FunctionKind::kToHex:
+    case FunctionKind::kFromHex:
+    case FunctionKind::kToCodePoints:
+    case FunctionKind::kCodePointsToString:
+    case FunctionKind::kCodePointsToBytes:
+    case FunctionKind::kSafeConvertBytesToString:
+    case FunctionKind::kArrayConcat:
+    case FunctionKind::kArrayToString:
+    case FunctionKind::kArrayReverse:
+    case FunctionKind::kFormatDate:
+    case FunctionKind::kFormatDatetime:
+    case FunctionKind::kFormatTime:
+    case FunctionKind::kFormatTimestamp:
+    case FunctionKind::kStringFromTimestamp:
+    case FunctionKind::kParseDate:
+    case FunctionKind::kParseDatetime:
+    case FunctionKind::kParseTime:
+    case FunctionKind::kParseTimestamp:
+    case FunctionKind::kFarmFingerprint:
+    case FunctionKind::kGenerateUuid:
+      return kModerate;
+    default:
+      return kCheap;
+  }
+}
+
 std::string BuiltinScalarFunction::debug_name() const {
   return BuiltinFunctionCatalog::GetDebugNameByKind(kind());
 }
@@ -1056,6 +1169,187 @@ static zetasql_base::Status ValidateSupportedTypes(
   return ::zetasql_base::OkStatus();
 }
 
+// Returns the formatter that <make_formatter> compiles from the format string
+// in <arguments>[0] if it is a non-NULL constant, so that it is compiled once
+// instead of for every row.  Otherwise returns null.
+template <typename MakeFormatter>
+static std::unique_ptr<const functions::TimestampFormatter>
+MakeConstantFormatter(const std::vector<std::unique_ptr<ValueExpr>>& arguments,
+                      MakeFormatter make_formatter) {
+  if (arguments.empty() || !arguments[0]->IsConstant()) return nullptr;
+  const Value& format_string =
+      static_cast<const ConstExpr*>(arguments[0].get())->value();
+  if (format_string.is_null()) return nullptr;
+  return make_formatter(format_string.string_value());
+}
+
+namespace {
+
+// Specialization of ArithmeticFunction for a function kind whose arguments and
+// result all have the C++ type 'T'. Calls 'function' directly instead of
+// dispatching on the function kind and the input types on every call. If
+// 'kSafe' is true, errors produce NULL instead.
+template <typename T, bool (*function)(T, T, T*, zetasql_base::Status*), bool kSafe>
+class BinaryArithmeticKernel : public BuiltinScalarFunction {
+ public:
+  using BuiltinScalarFunction::BuiltinScalarFunction;
+
+  bool Eval(absl::Span<const Value> args, EvaluationContext* context,
+            Value* result, ::zetasql_base::Status* status) const override {
+    DCHECK_EQ(2, args.size());
+    if (HasNulls(args)) {
+      *result = Value::Null(output_type());
+      return true;
+    }
+    T out;
+    if (ABSL_PREDICT_FALSE(!function(args[0].template Get<T>(),
+                                     args[1].template Get<T>(), &out,
+                                     status))) {
+      if (!kSafe) return false;
+      *result = Value::MakeNull<T>();
+      return true;
+    }
+    *result = Value::Make<T>(out);
+    return true;
+  }
+};
+
+// Specialization of ComparisonFunction for two arguments whose values have
+// the C++ type 'T', compared with 'Compare'.
+template <typename T, typename Compare>
+class ComparisonKernel : public BuiltinScalarFunction {
+ public:
+  using BuiltinScalarFunction::BuiltinScalarFunction;
+
+  bool Eval(absl::Span<const Value> args, EvaluationContext* context,
+            Value* result, ::zetasql_base::Status* status) const override {
+    DCHECK_EQ(2, args.size());
+    if (HasNulls(args)) {
+      *result = Value::Null(output_type());
+      return true;
+    }
+    *result = Value::Bool(
+        Compare()(args[0].template Get<T>(), args[1].template Get<T>()));
+    return true;
+  }
+};
+
+template <typename T>
+BuiltinScalarFunction* CreateComparisonKernel(FunctionKind kind,
+                                              const Type* output_type) {
+  switch (kind) {
+    case FunctionKind::kEqual:
+      return new ComparisonKernel<T, std::equal_to<T>>(kind, output_type);
+    case FunctionKind::kLess:
+      return new ComparisonKernel<T, std::less<T>>(kind, output_type);
+    case FunctionKind::kLessOrEqual:
+      return new ComparisonKernel<T, std::less_equal<T>>(kind, output_type);
+    default:
+      return nullptr;
+  }
+}
+
+// Returns a BinaryArithmeticKernel or a ComparisonKernel for a call to 'kind'
+// with two arguments of types 'input_types', or NULL if there is none. Only
+// covers the cases where ArithmeticFunction and ComparisonFunction do nothing
+// more than convert the arguments to C++ values and call a function on them.
+BuiltinScalarFunction* MaybeCreateKernel(
+    FunctionKind kind, const Type* output_type,
+    absl::Span<const Type* const> input_types) {
+  if (input_types.size() != 2 ||
+      input_types[0]->kind() != input_types[1]->kind()) {
+    return nullptr;
+  }
+  const TypeKind type_kind = input_types[0]->kind();
+  if (output_type->IsBool()) {
+    switch (type_kind) {
+      case TYPE_INT32:
+        return CreateComparisonKernel<int32_t>(kind, output_type);
+      case TYPE_INT64:
+        return CreateComparisonKernel<int64_t>(kind, output_type);
+      case TYPE_UINT32:
+        return CreateComparisonKernel<uint32_t>(kind, output_type);
+      case TYPE_UINT64:
+        return CreateComparisonKernel<uint64_t>(kind, output_type);
+      default:
+        return nullptr;
+    }
+  }
+  if (output_type->kind() != type_kind) return nullptr;
+  switch (FCT(kind, type_kind)) {
+    case FCT(FunctionKind::kAdd, TYPE_INT64):
+      return new BinaryArithmeticKernel<int64_t, &functions::Add<int64_t>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kAdd, TYPE_UINT64):
+      return new BinaryArithmeticKernel<uint64_t, &functions::Add<uint64_t>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kAdd, TYPE_DOUBLE):
+      return new BinaryArithmeticKernel<double, &functions::Add<double>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kSubtract, TYPE_INT64):
+      return new BinaryArithmeticKernel<int64_t, &functions::Subtract<int64_t>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kSubtract, TYPE_DOUBLE):
+      return new BinaryArithmeticKernel<double, &functions::Subtract<double>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kMultiply, TYPE_INT64):
+      return new BinaryArithmeticKernel<int64_t, &functions::Multiply<int64_t>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kMultiply, TYPE_UINT64):
+      return new BinaryArithmeticKernel<
+          uint64_t, &functions::Multiply<uint64_t>, false>(kind, output_type);
+    case FCT(FunctionKind::kMultiply, TYPE_DOUBLE):
+      return new BinaryArithmeticKernel<double, &functions::Multiply<double>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kDivide, TYPE_DOUBLE):
+      return new BinaryArithmeticKernel<double, &functions::Divide<double>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kDiv, TYPE_INT64):
+      return new BinaryArithmeticKernel<int64_t, &functions::Divide<int64_t>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kDiv, TYPE_UINT64):
+      return new BinaryArithmeticKernel<uint64_t, &functions::Divide<uint64_t>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kMod, TYPE_INT64):
+      return new BinaryArithmeticKernel<int64_t, &functions::Modulo<int64_t>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kMod, TYPE_UINT64):
+      return new BinaryArithmeticKernel<uint64_t, &functions::Modulo<uint64_t>,
+                                        false>(kind, output_type);
+    case FCT(FunctionKind::kSafeAdd, TYPE_INT64):
+      return new BinaryArithmeticKernel<int64_t, &functions::Add<int64_t>,
+                                        true>(kind, output_type);
+    case FCT(FunctionKind::kSafeAdd, TYPE_DOUBLE):
+      return new BinaryArithmeticKernel<double, &functions::Add<double>, true>(
+          kind, output_type);
+    case FCT(FunctionKind::kSafeAdd, TYPE_UINT64):
+      return new BinaryArithmeticKernel<uint64_t, &functions::Add<uint64_t>,
+                                        true>(kind, output_type);
+    case FCT(FunctionKind::kSafeSubtract, TYPE_INT64):
+      return new BinaryArithmeticKernel<int64_t, &functions::Subtract<int64_t>,
+                                        true>(kind, output_type);
+    case FCT(FunctionKind::kSafeSubtract, TYPE_DOUBLE):
+      return new BinaryArithmeticKernel<double, &functions::Subtract<double>,
+                                        true>(kind, output_type);
+    case FCT(FunctionKind::kSafeMultiply, TYPE_INT64):
+      return new BinaryArithmeticKernel<int64_t, &functions::Multiply<int64_t>,
+                                        true>(kind, output_type);
+    case FCT(FunctionKind::kSafeMultiply, TYPE_UINT64):
+      return new BinaryArithmeticKernel<
+          uint64_t, &functions::Multiply<uint64_t>, true>(kind, output_type);
+    case FCT(FunctionKind::kSafeMultiply, TYPE_DOUBLE):
+      return new BinaryArithmeticKernel<double, &functions::Multiply<double>,
+                                        true>(kind, output_type);
+    case FCT(FunctionKind::kSafeDivide, TYPE_DOUBLE):
+      return new BinaryArithmeticKernel<double, &functions::Divide<double>,
+                                        true>(kind, output_type);
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace
+
 zetasql_base::StatusOr<std::unique_ptr<ScalarFunctionCallExpr>>
 BuiltinScalarFunction::CreateCall(
     FunctionKind kind, const LanguageOptions& language_options,
@@ -1087,6 +1381,9 @@ BuiltinScalarFunction::CreateValidatedRaw(
   }
   ZETASQL_RETURN_IF_ERROR(ValidateSupportedTypes(language_options, {output_type}));
   ZETASQL_RETURN_IF_ERROR(ValidateSupportedTypes(language_options, input_types));
+  BuiltinScalarFunction* kernel =
+      MaybeCreateKernel(kind, output_type, input_types);
+  if (kernel != nullptr) return kernel;
   switch (kind) {
     case FunctionKind::kAdd:
     case FunctionKind::kSubtract:
@@ -1240,6 +1537,8 @@ BuiltinScalarFunction::CreateValidatedRaw(
     case FunctionKind::kJsonExtractArray:
     case FunctionKind::kJsonQuery:
     case FunctionKind::kJsonValue:
+    case FunctionKind::kJsonExtractScalars:
+    case FunctionKind::kToJsonString:
       return BuiltinFunctionRegistry::GetScalarFunction(kind, output_type);
     case FunctionKind::kArrayConcat:
       return new ArrayConcatFunction(kind, output_type);
@@ -1290,13 +1589,24 @@ BuiltinScalarFunction::CreateValidatedRaw(
     case FunctionKind::kExtractDatetimeFrom:
       return new ExtractDatetimeFromFunction(kind, output_type);
     case FunctionKind::kFormatDate:
-      return new FormatDateFunction(kind, output_type);
+      return new FormatDateFunction(
+          kind, output_type,
+          MakeConstantFormatter(arguments, functions::MakeDateFormatter));
     case FunctionKind::kFormatDatetime:
-      return new FormatDatetimeFunction(kind, output_type);
+      return new FormatDatetimeFunction(
+          kind, output_type,
+          MakeConstantFormatter(arguments, functions::MakeDatetimeFormatter));
     case FunctionKind::kFormatTime:
-      return new FormatTimeFunction(kind, output_type);
+      return new FormatTimeFunction(
+          kind, output_type,
+          MakeConstantFormatter(arguments, functions::MakeTimeFormatter));
     case FunctionKind::kFormatTimestamp:
-      return new FormatTimestampFunction(kind, output_type);
+      return new FormatTimestampFunction(
+          kind, output_type,
+          MakeConstantFormatter(arguments, [](absl::string_view format) {
+            return absl::make_unique<functions::TimestampFormatter>(
+                format, /*expand_quarter=*/true);
+          }));
     case FunctionKind::kTimestamp:
       return new TimestampConversionFunction(kind, output_type);
     case FunctionKind::kDate:
@@ -1424,24 +1734,23 @@ BuiltinScalarFunction::CreateLikeFunction(
     const ConstExpr* pattern_expr =
         static_cast<const ConstExpr*>(arguments[1].get());
     if (!pattern_expr->value().is_null()) {
-      // Build and precompile the regexp.
+      // Build the matcher, precompiling the regexp if it needs one.
       const std::string& pattern =
           pattern_expr->value().type_kind() == TYPE_STRING
               ? pattern_expr->value().string_value()
               : pattern_expr->value().bytes_value();
-      std::unique_ptr<RE2> regexp;
-      ZETASQL_RETURN_IF_ERROR(functions::CreateLikeRegexp(
-          pattern, arguments[1]->output_type()->kind(),
-          &regexp));
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<functions::LikeMatcher> matcher,
+                       functions::LikeMatcher::Create(
+                           pattern, arguments[1]->output_type()->kind()));
       return std::unique_ptr<BuiltinScalarFunction>(
-          new LikeFunction(kind, output_type, std::move(regexp)));
+          new LikeFunction(kind, output_type, std::move(matcher)));
     }
   }
 
-  // The pattern is not a constant expression or it is null; build and
-  // compile the regexp at evaluation time.
+  // The pattern is not a constant expression or it is null; build the
+  // matcher at evaluation time.
   return std::unique_ptr<BuiltinScalarFunction>(
-      new LikeFunction(kind, output_type, nullptr /* regexp */));
+      new LikeFunction(kind, output_type, nullptr /* matcher */));
 }
 
 zetasql_base::StatusOr<std::unique_ptr<BuiltinScalarFunction>>
@@ -2340,6 +2649,31 @@ std::string BuiltinAggregateFunction::debug_name() const {
   return BuiltinFunctionCatalog::GetDebugNameByKind(kind());
 }
 
+bool BuiltinAggregateFunction::SupportsPartialAggregation() const {
+  switch (kind()) {
+    case FunctionKind::kCount:
+    case FunctionKind::kCountIf:
+    case FunctionKind::kMin:
+    case FunctionKind::kMax:
+    case FunctionKind::kArrayAgg:
+    case FunctionKind::kStringAgg:
+      return true;
+    case FunctionKind::kSum:
+    case FunctionKind::kAvg:
+      switch (input_type()->kind()) {
+        case TYPE_INT64:
+        case TYPE_UINT64:
+        case TYPE_DOUBLE:
+        case TYPE_NUMERIC:
+          return true;
+        default:
+          return false;
+      }
+    default:
+      return false;
+  }
+}
+
 namespace {
 // kOrAgg is an aggregate function used internally to execute IN subqueries and
 // later ANY(SELECT ...) subqueries, once supported in ZetaSQL. The function
@@ -2377,6 +2711,12 @@ class BuiltinAggregateAccumulator : public AggregateAccumulator {
 
   ::zetasql_base::StatusOr<Value> GetFinalResult(bool inputs_in_defined_order) override;
 
+  // The state starts with 'count_', followed by the fields specific to the
+  // function.
+  ::zetasql_base::StatusOr<Value> SerializeState() override;
+
+  ::zetasql_base::Status Merge(const Value& state) override;
+
  private:
 
   BuiltinAggregateAccumulator(const BuiltinAggregateFunction* function,
@@ -2386,7 +2726,11 @@ class BuiltinAggregateAccumulator : public AggregateAccumulator {
       : function_(function),
         input_type_(input_type),
         args_(args.begin(), args.end()),
-        context_(context) {}
+        context_(context),
+        is_numeric_sum_or_avg_(
+            input_type->kind() == TYPE_NUMERIC &&
+            (function->kind() == FunctionKind::kSum ||
+             function->kind() == FunctionKind::kAvg)) {}
 
   ::zetasql_base::StatusOr<Value> GetFinalResultInternal(bool inputs_in_defined_order);
 
@@ -2396,6 +2740,8 @@ class BuiltinAggregateAccumulator : public AggregateAccumulator {
   const Type* input_type_;
   const std::vector<Value> args_;
   EvaluationContext* context_;
+  // True for SUM and AVG of NUMERIC, which Accumulate() handles up front.
+  const bool is_numeric_sum_or_avg_;
 
   // The number of bytes currently requested from 'accountant()'.
   int64_t requested_bytes_ = 0;
@@ -2608,6 +2954,15 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
                                              ::zetasql_base::Status* status) {
   *stop_accumulation = false;
 
+  if (is_numeric_sum_or_avg_ && !value.is_null()) {
+    // The sum is accumulated in 'numeric_aggregator_', which only checks for
+    // overflow in GetSum() and GetAverage(), and needs no memory beyond this
+    // accumulator. Skip the generic dispatch and memory accounting below.
+    ++count_;
+    numeric_aggregator_.Add(value.numeric_value());
+    return true;
+  }
+
   int64_t bytes_to_return = 0;
   int64_t additional_bytes_to_request = 0;
 
@@ -2806,9 +3161,7 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
       break;
     }
     case FCT(FunctionKind::kMax, TYPE_DATETIME): {
-      out_datetime_ = Value::Datetime(out_datetime_).LessThan(value)
-                          ? value.datetime_value()
-                          : out_datetime_;
+      out_datetime_ = std::max(out_datetime_, value.datetime_value());
       break;
     }
     case FCT(FunctionKind::kMax, TYPE_TIME): {
@@ -2879,9 +3232,7 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
       break;
     }
     case FCT(FunctionKind::kMin, TYPE_DATETIME): {
-      out_datetime_ = value.LessThan(Value::Datetime(out_datetime_))
-                          ? value.datetime_value()
-                          : out_datetime_;
+      out_datetime_ = std::min(out_datetime_, value.datetime_value());
       break;
     }
     case FCT(FunctionKind::kMin, TYPE_TIME): {
@@ -2937,8 +3288,8 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
         additional_bytes_to_request = delimiter_.size();
         absl::StrAppend(&out_string_, delimiter_);
       }
-      additional_bytes_to_request += value.string_value().size();
-      absl::StrAppend(&out_string_, value.string_value());
+      additional_bytes_to_request += value.string_view_value().size();
+      absl::StrAppend(&out_string_, value.string_view_value());
       break;
     }
     case FCT(FunctionKind::kStringAgg, TYPE_BYTES): {
@@ -2946,8 +3297,8 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
         additional_bytes_to_request = delimiter_.size();
         absl::StrAppend(&out_string_, delimiter_);
       }
-      additional_bytes_to_request = value.bytes_value().size();
-      absl::StrAppend(&out_string_, value.bytes_value());
+      additional_bytes_to_request += value.bytes_view_value().size();
+      absl::StrAppend(&out_string_, value.bytes_view_value());
       break;
     }
     case FCT(FunctionKind::kOrAgg, TYPE_BOOL):
@@ -2981,7 +3332,7 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
 
 ::zetasql_base::StatusOr<Value> BuiltinAggregateAccumulator::GetFinalResult(
     bool inputs_in_defined_order) {
-  ZETASQL_ASSIGN_OR_RETURN(const Value result,
+  ZETASQL_ASSIGN_OR_RETURN(Value result,
                    GetFinalResultInternal(inputs_in_defined_order));
   if (result.physical_byte_size() > context_->options().max_value_byte_size) {
     return ::zetasql_base::OutOfRangeErrorBuilder()
@@ -2991,6 +3342,217 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
   return result;
 }
 
+// Appends the exact value of 'value' to 'writer'. A finite value is written as
+// a list of (exponent, double) terms that add up to it, terminated by a zero
+// term.
+void AddExactFloat(zetasql_base::ExactFloat value,
+                   AggregateStateWriter* writer) {
+  writer->AddInt64(value.is_finite() ? 1 : 0);
+  if (!value.is_finite()) {
+    writer->AddDouble(value.ToDouble());
+    return;
+  }
+  while (!value.is_zero()) {
+    int exp;
+    const double term = frexp(value, &exp).ToDouble();
+    writer->AddInt64(exp);
+    writer->AddDouble(term);
+    value -= ldexp(zetasql_base::ExactFloat(term), exp);
+  }
+  writer->AddInt64(0);
+  writer->AddDouble(0);
+}
+
+// Reads back a value appended by AddExactFloat().
+zetasql_base::StatusOr<zetasql_base::ExactFloat> ReadExactFloat(
+    AggregateStateReader* reader) {
+  ZETASQL_ASSIGN_OR_RETURN(const int64_t is_finite, reader->ReadInt64());
+  if (!is_finite) {
+    ZETASQL_ASSIGN_OR_RETURN(const double value, reader->ReadDouble());
+    return zetasql_base::ExactFloat(value);
+  }
+  zetasql_base::ExactFloat value = 0;
+  while (true) {
+    ZETASQL_ASSIGN_OR_RETURN(const int64_t exp, reader->ReadInt64());
+    ZETASQL_ASSIGN_OR_RETURN(const double term, reader->ReadDouble());
+    if (term == 0) return value;
+    value += ldexp(zetasql_base::ExactFloat(term), static_cast<int>(exp));
+  }
+}
+
+void AddUint128(unsigned __int128 value, AggregateStateWriter* writer) {
+  writer->AddUint64(static_cast<uint64_t>(value >> 64));
+  writer->AddUint64(static_cast<uint64_t>(value));
+}
+
+zetasql_base::StatusOr<unsigned __int128> ReadUint128(
+    AggregateStateReader* reader) {
+  ZETASQL_ASSIGN_OR_RETURN(const uint64_t high, reader->ReadUint64());
+  ZETASQL_ASSIGN_OR_RETURN(const uint64_t low, reader->ReadUint64());
+  return (static_cast<unsigned __int128>(high) << 64) | low;
+}
+
+::zetasql_base::StatusOr<Value> BuiltinAggregateAccumulator::SerializeState() {
+  ZETASQL_RET_CHECK(function_->SupportsPartialAggregation())
+      << function_->debug_name();
+  AggregateStateWriter writer;
+  writer.AddInt64(count_);
+  switch (function_->kind()) {
+    case FunctionKind::kCount:
+      return writer.Finish();
+    case FunctionKind::kCountIf:
+      writer.AddInt64(countif_);
+      return writer.Finish();
+    case FunctionKind::kArrayAgg:
+      for (const Value& value : array_agg_) {
+        ZETASQL_RETURN_IF_ERROR(writer.AddValue(value));
+      }
+      return writer.Finish();
+    case FunctionKind::kStringAgg:
+      // The partial result is accumulated again by Merge(). Unlike
+      // GetFinalResultInternal(), this keeps 'out_string_'.
+      if (count_ > 0) {
+        ZETASQL_RETURN_IF_ERROR(writer.AddValue(input_type_->IsString()
+                                            ? Value::String(out_string_)
+                                            : Value::Bytes(out_string_)));
+      }
+      return writer.Finish();
+    case FunctionKind::kMin:
+    case FunctionKind::kMax:
+      // The partial result is accumulated again by Merge().
+      if (count_ > 0) {
+        ZETASQL_ASSIGN_OR_RETURN(const Value partial_result,
+                         GetFinalResultInternal(
+                             /*inputs_in_defined_order=*/false));
+        ZETASQL_RETURN_IF_ERROR(writer.AddValue(partial_result));
+      }
+      return writer.Finish();
+    default:
+      break;
+  }
+  switch (FCT(function_->kind(), input_type_->kind())) {
+    case FCT(FunctionKind::kSum, TYPE_INT64):
+      AddUint128(static_cast<unsigned __int128>(out_int128_), &writer);
+      break;
+    case FCT(FunctionKind::kSum, TYPE_UINT64):
+      AddUint128(out_uint128_, &writer);
+      break;
+    case FCT(FunctionKind::kSum, TYPE_DOUBLE):
+      AddExactFloat(out_exact_float_, &writer);
+      break;
+    case FCT(FunctionKind::kSum, TYPE_NUMERIC):
+    case FCT(FunctionKind::kAvg, TYPE_NUMERIC):
+      writer.AddBytes(numeric_aggregator_.SerializeAsProtoBytes());
+      break;
+    case FCT(FunctionKind::kAvg, TYPE_INT64):
+    case FCT(FunctionKind::kAvg, TYPE_UINT64):
+    case FCT(FunctionKind::kAvg, TYPE_DOUBLE):
+      writer.AddDouble(out_double_);
+      break;
+    default:
+      ZETASQL_RET_CHECK_FAIL() << "Unexpected partial aggregate "
+                       << function_->debug_name();
+  }
+  return writer.Finish();
+}
+
+::zetasql_base::Status BuiltinAggregateAccumulator::Merge(const Value& state) {
+  ZETASQL_RET_CHECK(function_->SupportsPartialAggregation())
+      << function_->debug_name();
+  if (state.is_null()) return zetasql_base::OkStatus();
+  ZETASQL_ASSIGN_OR_RETURN(AggregateStateReader reader,
+                   AggregateStateReader::Create(state));
+  ZETASQL_ASSIGN_OR_RETURN(const int64_t count, reader.ReadInt64());
+  bool stop_accumulation;
+  zetasql_base::Status status;
+  switch (function_->kind()) {
+    case FunctionKind::kCount:
+      count_ += count;
+      return reader.Finish();
+    case FunctionKind::kCountIf: {
+      ZETASQL_ASSIGN_OR_RETURN(const int64_t countif, reader.ReadInt64());
+      count_ += count;
+      countif_ += countif;
+      return reader.Finish();
+    }
+    case FunctionKind::kArrayAgg:
+      // Accumulate() counts the non-NULL elements again.
+      while (!reader.AtEnd()) {
+        ZETASQL_ASSIGN_OR_RETURN(const Value value,
+                         reader.ReadValue(input_type_));
+        if (!Accumulate(value, &stop_accumulation, &status)) return status;
+      }
+      return zetasql_base::OkStatus();
+    case FunctionKind::kStringAgg:
+    case FunctionKind::kMin:
+    case FunctionKind::kMax:
+      if (count > 0) {
+        ZETASQL_ASSIGN_OR_RETURN(const Value partial_result,
+                         reader.ReadValue(function_->output_type()));
+        if (!Accumulate(partial_result, &stop_accumulation, &status)) {
+          return status;
+        }
+        // Accumulate() counted the partial result as one value.
+        count_ += count - 1;
+      }
+      return reader.Finish();
+    default:
+      break;
+  }
+  switch (FCT(function_->kind(), input_type_->kind())) {
+    case FCT(FunctionKind::kSum, TYPE_INT64): {
+      ZETASQL_ASSIGN_OR_RETURN(const unsigned __int128 sum,
+                       ReadUint128(&reader));
+      out_int128_ += static_cast<__int128>(sum);
+      break;
+    }
+    case FCT(FunctionKind::kSum, TYPE_UINT64): {
+      ZETASQL_ASSIGN_OR_RETURN(const unsigned __int128 sum,
+                       ReadUint128(&reader));
+      out_uint128_ += sum;
+      break;
+    }
+    case FCT(FunctionKind::kSum, TYPE_DOUBLE): {
+      ZETASQL_ASSIGN_OR_RETURN(const zetasql_base::ExactFloat sum,
+                       ReadExactFloat(&reader));
+      out_exact_float_ += sum;
+      break;
+    }
+    case FCT(FunctionKind::kSum, TYPE_NUMERIC):
+    case FCT(FunctionKind::kAvg, TYPE_NUMERIC): {
+      ZETASQL_ASSIGN_OR_RETURN(const std::string bytes, reader.ReadBytes());
+      ZETASQL_ASSIGN_OR_RETURN(
+          const NumericValue::SumAggregator sum,
+          NumericValue::SumAggregator::DeserializeFromProtoBytes(bytes));
+      numeric_aggregator_.MergeWith(sum);
+      break;
+    }
+    case FCT(FunctionKind::kAvg, TYPE_INT64):
+    case FCT(FunctionKind::kAvg, TYPE_UINT64):
+    case FCT(FunctionKind::kAvg, TYPE_DOUBLE): {
+      ZETASQL_ASSIGN_OR_RETURN(const double mean, reader.ReadDouble());
+      if (count == 0) break;
+      // Weighted mean of the two partial means, computed like the running
+      // mean of Accumulate().
+      double delta;
+      if (!functions::Subtract(mean, out_double_, &delta, &status) ||
+          !functions::Multiply(delta, static_cast<double>(count), &delta,
+                               &status) ||
+          !functions::Divide(delta, static_cast<double>(count_ + count),
+                             &delta, &status) ||
+          !functions::Add(out_double_, delta, &out_double_, &status)) {
+        return status;
+      }
+      break;
+    }
+    default:
+      ZETASQL_RET_CHECK_FAIL() << "Unexpected partial aggregate "
+                       << function_->debug_name();
+  }
+  count_ += count;
+  return reader.Finish();
+}
+
 ::zetasql_base::StatusOr<Value> BuiltinAggregateAccumulator::GetFinalResultInternal(
     bool inputs_in_defined_order) {
   const Type* output_type = function_->output_type();
@@ -3025,7 +3587,10 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
     }
     case FunctionKind::kAnyValue:
       return any_value_.is_valid() ? any_value_ : Value::Null(output_type);
+    case FunctionKind::kApproxCountDistinct:
     case FunctionKind::kCount:
+      // The algebrizer makes APPROX_COUNT_DISTINCT a DISTINCT aggregate, so
+      // unless it is estimated by an HllAccumulator the count is exact.
       return Value::Int64(count_);
     case FunctionKind::kCountIf:
       return Value::Int64(countif_);
@@ -3139,7 +3704,9 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
       if (count_ > 1) {
         context_->SetNonDeterministicOutput();
       }
-      return count_ > 0 ? Value::String(out_string_) : Value::NullString();
+      // Like ARRAY_AGG, the result takes over the accumulated string.
+      return count_ > 0 ? Value::StringValue(std::move(out_string_))
+                        : Value::NullString();
     case FCT(FunctionKind::kMax, TYPE_BYTES):
     case FCT(FunctionKind::kMin, TYPE_BYTES):
       return count_ > 0 ? Value::Bytes(out_string_) : Value::NullBytes();
@@ -3147,7 +3714,8 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
       if (count_ > 1) {
         context_->SetNonDeterministicOutput();
       }
-      return count_ > 0 ? Value::Bytes(out_string_) : Value::NullBytes();
+      return count_ > 0 ? Value::Bytes(std::move(out_string_))
+                        : Value::NullBytes();
     case FCT(FunctionKind::kMax, TYPE_DATE):
     case FCT(FunctionKind::kMin, TYPE_DATE):
       return count_ > 0 ? Value::Date(out_int64_) : Value::NullDate();
@@ -3416,23 +3984,24 @@ zetasql_base::StatusOr<Value> LikeFunction::Eval(absl::Span<const Value> args,
                                          EvaluationContext* context) const {
   CHECK_EQ(2, args.size());
   if (HasNulls(args)) return Value::Null(output_type());
-  const std::string& text = args[0].type_kind() == TYPE_STRING
-                                ? args[0].string_value()
-                                : args[0].bytes_value();
+  const absl::string_view text = args[0].type_kind() == TYPE_STRING
+                                    ? args[0].string_view_value()
+                                    : args[0].bytes_view_value();
 
-  if (regexp_ != nullptr) {
-    // Regexp is precompiled
-    return Value::Bool(RE2::FullMatch(text, *regexp_));
+  if (matcher_ != nullptr) {
+    // Matcher is precreated
+    return Value::Bool(matcher_->Match(text));
   } else {
-    // Regexp is not precompiled, compile it on the fly
+    // Matcher is not precreated, create it on the fly (finding its regexp, if
+    // any, in the cache).
     const std::string& pattern = args[1].type_kind() == TYPE_STRING
                                      ? args[1].string_value()
                                      : args[1].bytes_value();
-    std::unique_ptr<RE2> regexp;
-    ZETASQL_RETURN_IF_ERROR(functions::CreateLikeRegexp(
-        pattern, args[0].type_kind(),
-        &regexp));
-    return Value::Bool(RE2::FullMatch(text, *regexp));
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<functions::LikeMatcher> matcher,
+                     functions::LikeMatcher::Create(
+                         pattern, args[0].type_kind(),
+                         functions::RegExpCache::Default()));
+    return Value::Bool(matcher->Match(text));
   }
 }
 
@@ -3779,37 +4348,43 @@ bool StringFunction::Eval(absl::Span<const Value> args,
   switch (FCT_TYPE_ARITY(kind(), args[0].type_kind(), args.size())) {
     case FCT_TYPE_ARITY(FunctionKind::kStrpos, TYPE_STRING, 2):
       return Invoke<int64_t>(&functions::StrposUtf8, result, status,
-                           args[0].string_value(), args[1].string_value());
+                           args[0].string_view_value(),
+                           args[1].string_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kStrpos, TYPE_BYTES, 2):
       return Invoke<int64_t>(&functions::StrposBytes, result, status,
-                           args[0].bytes_value(), args[1].bytes_value());
+                           args[0].bytes_view_value(),
+                           args[1].bytes_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kLength, TYPE_STRING, 1):
       return Invoke<int64_t>(&functions::LengthUtf8, result, status,
-                           args[0].string_value());
+                           args[0].string_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kLength, TYPE_BYTES, 1):
       return Invoke<int64_t>(&functions::LengthBytes, result, status,
-                           args[0].bytes_value());
+                           args[0].bytes_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kByteLength, TYPE_STRING, 1):
       return Invoke<int64_t>(&functions::LengthBytes, result, status,
-                           args[0].string_value());
+                           args[0].string_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kByteLength, TYPE_BYTES, 1):
       return Invoke<int64_t>(&functions::LengthBytes, result, status,
-                           args[0].bytes_value());
+                           args[0].bytes_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kCharLength, TYPE_STRING, 1):
       return Invoke<int64_t>(&functions::LengthUtf8, result, status,
-                           args[0].string_value());
+                           args[0].string_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kStartsWith, TYPE_STRING, 2):
       return Invoke<bool>(&functions::StartsWithUtf8, result, status,
-                          args[0].string_value(), args[1].string_value());
+                          args[0].string_view_value(),
+                          args[1].string_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kStartsWith, TYPE_BYTES, 2):
       return Invoke<bool>(&functions::StartsWithBytes, result, status,
-                          args[0].bytes_value(), args[1].bytes_value());
+                          args[0].bytes_view_value(),
+                          args[1].bytes_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kEndsWith, TYPE_STRING, 2):
       return Invoke<bool>(&functions::EndsWithUtf8, result, status,
-                          args[0].string_value(), args[1].string_value());
+                          args[0].string_view_value(),
+                          args[1].string_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kEndsWith, TYPE_BYTES, 2):
       return Invoke<bool>(&functions::EndsWithBytes, result, status,
-                          args[0].bytes_value(), args[1].bytes_value());
+                          args[0].bytes_view_value(),
+                          args[1].bytes_view_value());
     case FCT_TYPE_ARITY(FunctionKind::kSubstr, TYPE_STRING, 2):
       return InvokeString<absl::string_view>(&functions::SubstrUtf8, result,
                                              status, args[0].string_value(),
@@ -3969,27 +4544,30 @@ zetasql_base::StatusOr<Value> SplitFunction::Eval(absl::Span<const Value> args,
                                           EvaluationContext* context) const {
   if (HasNulls(args)) return Value::Null(output_type());
   zetasql_base::Status status;
-  std::vector<std::string> parts;
+  // The parts are views into 'input', which they keep alive.
+  const std::shared_ptr<const Value> input = ShareStringContents(args[0]);
+  std::vector<absl::string_view> parts;
   std::vector<Value> values;
   if (args[0].type()->kind() == TYPE_STRING) {
-    const std::string& delimiter =
-        (args.size() == 1) ? "," : args[1].string_value();
-    if (!functions::SplitUtf8(args[0].string_value(), delimiter, &parts,
+    const absl::string_view delimiter =
+        (args.size() == 1) ? "," : args[1].string_view_value();
+    if (!functions::SplitUtf8(input->string_view_value(), delimiter, &parts,
                               &status)) {
       return status;
     }
-    for (const std::string& s : parts) {
-      values.push_back(Value::String(s));
+    values.reserve(parts.size());
+    for (absl::string_view s : parts) {
+      values.push_back(Value::ExternalString(s, input));
     }
     return Value::Array(types::StringArrayType(), values);
   } else {
-    zetasql_base::Status status;
-    if (!functions::SplitBytes(args[0].bytes_value(), args[1].bytes_value(),
-                               &parts, &status)) {
+    if (!functions::SplitBytes(input->bytes_view_value(),
+                               args[1].bytes_view_value(), &parts, &status)) {
       return status;
     }
-    for (const std::string& s : parts) {
-      values.push_back(Value::Bytes(s));
+    values.reserve(parts.size());
+    for (absl::string_view s : parts) {
+      values.push_back(Value::ExternalBytes(s, input));
     }
     return Value::Array(types::BytesArrayType(), values);
   }
@@ -4066,7 +4644,8 @@ zetasql_base::StatusOr<Value> CaseConverterFunction::Eval(
 zetasql_base::StatusOr<Value> MakeProtoFunction::Eval(
     absl::Span<const Value> args, EvaluationContext* context) const {
   CHECK_EQ(args.size(), fields_.size());
-  absl::Cord proto_cord;
+  // The fields are written straight to the wire format, without building a
+  // message.
   std::string bytes_str;
   {
     google::protobuf::io::StringOutputStream cord_output(&bytes_str);
@@ -4082,8 +4661,8 @@ zetasql_base::StatusOr<Value> MakeProtoFunction::Eval(
       }
     }
   }
-  proto_cord = absl::Cord(bytes_str);
-  return Value::Proto(output_type()->AsProto(), proto_cord);
+  return Value::Proto(output_type()->AsProto(),
+                      absl::Cord(std::move(bytes_str)));
 }
 
 // Sets the proto field denoted by <path> to <new_field_value>. The first proto
@@ -4262,9 +4841,13 @@ zetasql_base::StatusOr<Value> FormatDateFunction::Eval(
   DCHECK_EQ(args.size(), 2);
   if (HasNulls(args)) return Value::Null(output_type());
   std::string result_string;
-  ZETASQL_RETURN_IF_ERROR(functions::FormatDateToString(
-      args[0].string_value(), args[1].date_value(),
-      &result_string));
+  if (formatter_ != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(functions::FormatDateToString(
+        *formatter_, args[1].date_value(), &result_string));
+  } else {
+    ZETASQL_RETURN_IF_ERROR(functions::FormatDateToString(
+        args[0].string_value(), args[1].date_value(), &result_string));
+  }
   return Value::String(result_string);
 }
 
@@ -4273,9 +4856,13 @@ zetasql_base::StatusOr<Value> FormatDatetimeFunction::Eval(
   DCHECK_EQ(args.size(), 2);
   if (HasNulls(args)) return Value::Null(output_type());
   std::string result_string;
-  ZETASQL_RETURN_IF_ERROR(functions::FormatDatetimeToString(
-      args[0].string_value(), args[1].datetime_value(),
-      &result_string));
+  if (formatter_ != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(functions::FormatDatetimeToString(
+        *formatter_, args[1].datetime_value(), &result_string));
+  } else {
+    ZETASQL_RETURN_IF_ERROR(functions::FormatDatetimeToString(
+        args[0].string_value(), args[1].datetime_value(), &result_string));
+  }
   return Value::String(result_string);
 }
 
@@ -4284,9 +4871,13 @@ zetasql_base::StatusOr<Value> FormatTimeFunction::Eval(
   DCHECK_EQ(args.size(), 2);
   if (HasNulls(args)) return Value::Null(output_type());
   std::string result_string;
-  ZETASQL_RETURN_IF_ERROR(functions::FormatTimeToString(
-      args[0].string_value(), args[1].time_value(),
-      &result_string));
+  if (formatter_ != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(functions::FormatTimeToString(
+        *formatter_, args[1].time_value(), &result_string));
+  } else {
+    ZETASQL_RETURN_IF_ERROR(functions::FormatTimeToString(
+        args[0].string_value(), args[1].time_value(), &result_string));
+  }
   return Value::String(result_string);
 }
 
@@ -4296,15 +4887,20 @@ zetasql_base::StatusOr<Value> FormatTimestampFunction::Eval(
       (args.size() == 3 && args[2].is_null())) {
     return Value::Null(output_type());
   }
+  absl::TimeZone timezone = context->GetDefaultTimeZone();
+  if (args.size() == 3) {
+    ZETASQL_RETURN_IF_ERROR(
+        functions::MakeTimeZone(args[2].string_value(), &timezone));
+  }
+  // The timestamp is formatted at microseconds precision.
+  const absl::Time timestamp = absl::FromUnixMicros(args[1].ToUnixMicros());
   std::string result_string;
-  if (args.size() == 2) {
-    ZETASQL_RETURN_IF_ERROR(functions::FormatTimestampToString(
-        args[0].string_value(), args[1].ToUnixMicros(),
-        context->GetDefaultTimeZone(), &result_string));
+  if (formatter_ != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(
+        formatter_->Format(timestamp, timezone, &result_string));
   } else {
     ZETASQL_RETURN_IF_ERROR(functions::FormatTimestampToString(
-        args[0].string_value(), args[1].ToUnixMicros(), args[2].string_value(),
-        &result_string));
+        args[0].string_value(), timestamp, timezone, &result_string));
   }
   return Value::String(result_string);
 }
@@ -28,6 +28,8 @@
 #include "zetasql/base/logging.h"
 #include "google/protobuf/descriptor.h"
 #include "zetasql/public/function.h"
+#include "zetasql/public/functions/date_time_util.h"
+#include "zetasql/public/functions/like.h"
 #include "zetasql/public/functions/regexp.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/proto/type_annotation.pb.h"
@@ -172,6 +174,10 @@ enum class FunctionKind {
   kJsonExtractArray,
   kJsonQuery,
   kJsonValue,
+  // JSON_EXTRACT_SCALAR over several constant JSONPaths at once, added by the
+  // algebrizer.
+  kJsonExtractScalars,
+  kToJsonString,
   // Proto functions
   kFromProto,
   kToProto,
@@ -305,6 +311,12 @@ class BuiltinFunctionCatalog {
 
   static std::string GetDebugNameByKind(FunctionKind kind);
 
+  // The relative cost of one call to a built-in function, not counting the
+  // evaluation of its arguments.
+  enum CostClass { kCheap = 1, kModerate = 10, kExpensive = 100 };
+
+  static CostClass GetCostClassByKind(FunctionKind kind);
+
  private:
   BuiltinFunctionCatalog() {}
 };
@@ -410,6 +422,10 @@ class BuiltinAggregateFunction : public AggregateFunctionBody {
 
   std::string debug_name() const override;
 
+  // True for COUNT, COUNTIF, MIN, MAX, ARRAY_AGG, STRING_AGG, and SUM and AVG
+  // of INT64, UINT64, DOUBLE and NUMERIC.
+  bool SupportsPartialAggregation() const override;
+
   ::zetasql_base::StatusOr<std::unique_ptr<AggregateAccumulator>> CreateAccumulator(
       absl::Span<const Value> args, EvaluationContext* context) const override;
 
@@ -574,9 +590,9 @@ class BitCastFunction : public BuiltinScalarFunction {
 class LikeFunction : public SimpleBuiltinScalarFunction {
  public:
   LikeFunction(FunctionKind kind, const Type* output_type,
-               std::unique_ptr<RE2> regexp)
+               std::unique_ptr<functions::LikeMatcher> matcher)
       : SimpleBuiltinScalarFunction(kind, output_type),
-        regexp_(std::move(regexp)) {}
+        matcher_(std::move(matcher)) {}
   ::zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
                                EvaluationContext* context) const override;
 
@@ -584,8 +600,8 @@ class LikeFunction : public SimpleBuiltinScalarFunction {
   LikeFunction& operator=(const LikeFunction&) = delete;
 
  private:
-  // Regexp precompiled at prepare time; null if cannot be precompiled.
-  std::unique_ptr<RE2> regexp_;
+  // Matcher created at prepare time; null if cannot be precreated.
+  std::unique_ptr<functions::LikeMatcher> matcher_;
 };
 
 class BitwiseFunction : public BuiltinScalarFunction {
@@ -819,30 +835,75 @@ class DateTimeUnaryFunction : public SimpleBuiltinScalarFunction {
 
 class FormatDateFunction : public SimpleBuiltinScalarFunction {
  public:
-  using SimpleBuiltinScalarFunction::SimpleBuiltinScalarFunction;
+  FormatDateFunction(
+      FunctionKind kind, const Type* output_type,
+      std::unique_ptr<const functions::TimestampFormatter> formatter)
+      : SimpleBuiltinScalarFunction(kind, output_type),
+        formatter_(std::move(formatter)) {}
   zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
                              EvaluationContext* context) const override;
+
+  FormatDateFunction(const FormatDateFunction&) = delete;
+  FormatDateFunction& operator=(const FormatDateFunction&) = delete;
+
+ private:
+  // Same as FormatTimestampFunction::formatter_.
+  std::unique_ptr<const functions::TimestampFormatter> formatter_;
 };
 
 class FormatDatetimeFunction : public SimpleBuiltinScalarFunction {
  public:
-  using SimpleBuiltinScalarFunction::SimpleBuiltinScalarFunction;
+  FormatDatetimeFunction(
+      FunctionKind kind, const Type* output_type,
+      std::unique_ptr<const functions::TimestampFormatter> formatter)
+      : SimpleBuiltinScalarFunction(kind, output_type),
+        formatter_(std::move(formatter)) {}
   zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
                              EvaluationContext* context) const override;
+
+  FormatDatetimeFunction(const FormatDatetimeFunction&) = delete;
+  FormatDatetimeFunction& operator=(const FormatDatetimeFunction&) = delete;
+
+ private:
+  // Same as FormatTimestampFunction::formatter_.
+  std::unique_ptr<const functions::TimestampFormatter> formatter_;
 };
 
 class FormatTimeFunction : public SimpleBuiltinScalarFunction {
  public:
-  using SimpleBuiltinScalarFunction::SimpleBuiltinScalarFunction;
+  FormatTimeFunction(
+      FunctionKind kind, const Type* output_type,
+      std::unique_ptr<const functions::TimestampFormatter> formatter)
+      : SimpleBuiltinScalarFunction(kind, output_type),
+        formatter_(std::move(formatter)) {}
   zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
                              EvaluationContext* context) const override;
+
+  FormatTimeFunction(const FormatTimeFunction&) = delete;
+  FormatTimeFunction& operator=(const FormatTimeFunction&) = delete;
+
+ private:
+  // Same as FormatTimestampFunction::formatter_.
+  std::unique_ptr<const functions::TimestampFormatter> formatter_;
 };
 
 class FormatTimestampFunction : public SimpleBuiltinScalarFunction {
  public:
-  using SimpleBuiltinScalarFunction::SimpleBuiltinScalarFunction;
+  FormatTimestampFunction(
+      FunctionKind kind, const Type* output_type,
+      std::unique_ptr<const functions::TimestampFormatter> formatter)
+      : SimpleBuiltinScalarFunction(kind, output_type),
+        formatter_(std::move(formatter)) {}
   zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
                              EvaluationContext* context) const override;
+
+  FormatTimestampFunction(const FormatTimestampFunction&) = delete;
+  FormatTimestampFunction& operator=(const FormatTimestampFunction&) = delete;
+
+ private:
+  // Formatter compiled at prepare time; null if the format string is not a
+  // constant.
+  std::unique_ptr<const functions::TimestampFormatter> formatter_;
 };
 
 class TimestampFromIntFunction : public SimpleBuiltinScalarFunction {
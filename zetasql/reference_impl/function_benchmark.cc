@@ -0,0 +1,406 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Microbenchmark for the builtin scalar functions, driven by the inputs of the
+// compliance function tests (compliance/functions_testlib.h). For each suite
+// of test cases, times the evaluation of every case through the reference
+// implementation (a ScalarFunctionCallExpr over the BuiltinScalarFunction for
+// the case) and, for the arithmetic and math functions and the casts from
+// STRING to DATE and TIMESTAMP, through the corresponding public/functions/
+// primitive, and prints the average time per call.
+//
+// Example:
+//   bazel run -c opt //zetasql/reference_impl:function_benchmark -- \
+//       --suites=Add,Math
+//
+// Comparing the output of two releases on the same machine shows regressions
+// of individual function kernels.
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/compliance/functions_testlib.h"
+#include "zetasql/public/functions/arithmetics.h"
+#include "zetasql/public/functions/date_time_util.h"
+#include "zetasql/public/functions/math.h"
+#include "zetasql/public/language_options.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/reference_impl/evaluation.h"
+#include "zetasql/reference_impl/function.h"
+#include "zetasql/reference_impl/operator.h"
+#include "zetasql/reference_impl/tuple.h"
+#include "zetasql/testing/test_function.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
+#include "zetasql/base/statusor.h"
+
+ABSL_FLAG(int32_t, num_iterations, 100,
+          "The number of times each test case of a suite is evaluated.");
+ABSL_FLAG(std::string, suites, "",
+          "Comma-separated list of the suites to run (e.g., 'Add,Math'). Runs "
+          "all the suites if empty.");
+
+namespace zetasql {
+namespace {
+
+// A test case of a compliance test suite, with the kind of the function it
+// calls.
+struct BenchmarkCase {
+  FunctionKind kind;
+  QueryParamsWithResult params;
+};
+
+// Times the evaluation of the non-NULL arguments in 'cases' that have the types
+// expected by a public/functions/ primitive. Returns the number of calls
+// made, and adds their total time to 'elapsed'.
+using PrimitiveBenchmark = std::function<int64_t(
+    const std::vector<BenchmarkCase>& cases, int num_iterations,
+    absl::Duration* elapsed)>;
+
+struct BenchmarkSuite {
+  std::string name;
+  std::function<std::vector<BenchmarkCase>()> get_cases;
+  // NULL if there is no primitive for the suite.
+  PrimitiveBenchmark primitive;
+};
+
+// Returns the cases of a suite of QueryParamsWithResult that all call the
+// function of 'kind'.
+std::function<std::vector<BenchmarkCase>()> CasesOfKind(
+    FunctionKind kind,
+    std::function<std::vector<QueryParamsWithResult>()> get_tests) {
+  return [kind, get_tests]() {
+    std::vector<BenchmarkCase> cases;
+    for (const QueryParamsWithResult& params : get_tests()) {
+      cases.push_back({kind, params});
+    }
+    return cases;
+  };
+}
+
+// Returns the cases of a suite of FunctionTestCalls, whose function names are
+// mapped to FunctionKinds. Skips the calls of functions that the reference
+// implementation does not know under that name.
+std::function<std::vector<BenchmarkCase>()> CasesOfCalls(
+    std::function<std::vector<FunctionTestCall>()> get_calls) {
+  return [get_calls]() {
+    std::vector<BenchmarkCase> cases;
+    for (const FunctionTestCall& call : get_calls()) {
+      const zetasql_base::StatusOr<FunctionKind> kind =
+          BuiltinFunctionCatalog::GetKindByName(call.function_name);
+      if (kind.ok()) {
+        cases.push_back({kind.ValueOrDie(), call.params});
+      }
+    }
+    return cases;
+  };
+}
+
+// Returns a PrimitiveBenchmark for a binary primitive of type 'T', which only
+// runs on the cases of 'kind'.
+template <typename T>
+PrimitiveBenchmark BinaryPrimitive(FunctionKind kind,
+                                   bool (*fn)(T, T, T*, zetasql_base::Status*)) {
+  return [kind, fn](const std::vector<BenchmarkCase>& cases,
+                    int num_iterations, absl::Duration* elapsed) -> int64_t {
+    const TypeKind type_kind = Value::MakeNull<T>().type_kind();
+    std::vector<std::pair<T, T>> inputs;
+    for (const BenchmarkCase& c : cases) {
+      if (c.kind != kind || c.params.num_params() != 2) continue;
+      const Value& in1 = c.params.param(0);
+      const Value& in2 = c.params.param(1);
+      if (in1.type_kind() != type_kind || in2.type_kind() != type_kind ||
+          in1.is_null() || in2.is_null()) {
+        continue;
+      }
+      inputs.emplace_back(in1.Get<T>(), in2.Get<T>());
+    }
+    T out;
+    zetasql_base::Status error;
+    const absl::Time start = absl::Now();
+    for (int i = 0; i < num_iterations; ++i) {
+      for (const std::pair<T, T>& input : inputs) {
+        fn(input.first, input.second, &out, &error);
+      }
+    }
+    *elapsed += absl::Now() - start;
+    return static_cast<int64_t>(inputs.size()) * num_iterations;
+  };
+}
+
+// Like BinaryPrimitive(), but for unary primitives.
+template <typename T>
+PrimitiveBenchmark UnaryPrimitive(FunctionKind kind,
+                                  bool (*fn)(T, T*, zetasql_base::Status*)) {
+  return [kind, fn](const std::vector<BenchmarkCase>& cases,
+                    int num_iterations, absl::Duration* elapsed) -> int64_t {
+    const TypeKind type_kind = Value::MakeNull<T>().type_kind();
+    std::vector<T> inputs;
+    for (const BenchmarkCase& c : cases) {
+      if (c.kind != kind || c.params.num_params() != 1) continue;
+      const Value& in = c.params.param(0);
+      if (in.type_kind() != type_kind || in.is_null()) continue;
+      inputs.push_back(in.Get<T>());
+    }
+    T out;
+    zetasql_base::Status error;
+    const absl::Time start = absl::Now();
+    for (int i = 0; i < num_iterations; ++i) {
+      for (const T input : inputs) {
+        fn(input, &out, &error);
+      }
+    }
+    *elapsed += absl::Now() - start;
+    return static_cast<int64_t>(inputs.size()) * num_iterations;
+  };
+}
+
+// Returns a PrimitiveBenchmark for the conversion of the STRING arguments of
+// the CAST cases whose result type is TIMESTAMP or DATE.
+PrimitiveBenchmark StringToDateTimestampPrimitive() {
+  return [](const std::vector<BenchmarkCase>& cases, int num_iterations,
+            absl::Duration* elapsed) -> int64_t {
+    std::vector<std::pair<std::string, TypeKind>> inputs;
+    for (const BenchmarkCase& c : cases) {
+      if (c.kind != FunctionKind::kCast || c.params.num_params() != 1) {
+        continue;
+      }
+      const Value& in = c.params.param(0);
+      const TypeKind result_kind = c.params.GetResultType()->kind();
+      if (in.type_kind() != TYPE_STRING || in.is_null() ||
+          (result_kind != TYPE_TIMESTAMP && result_kind != TYPE_DATE)) {
+        continue;
+      }
+      inputs.emplace_back(in.string_value(), result_kind);
+    }
+    int64_t timestamp;
+    int32_t date;
+    const absl::Time start = absl::Now();
+    for (int i = 0; i < num_iterations; ++i) {
+      for (const std::pair<std::string, TypeKind>& input : inputs) {
+        if (input.second == TYPE_TIMESTAMP) {
+          functions::ConvertStringToTimestamp(
+              input.first, absl::UTCTimeZone(), functions::kMicroseconds,
+              /*allow_tz_in_str=*/true, &timestamp)
+              .IgnoreError();
+        } else {
+          functions::ConvertStringToDate(input.first, &date).IgnoreError();
+        }
+      }
+    }
+    *elapsed += absl::Now() - start;
+    return static_cast<int64_t>(inputs.size()) * num_iterations;
+  };
+}
+
+// Runs all of 'primitives'.
+PrimitiveBenchmark AllOf(std::vector<PrimitiveBenchmark> primitives) {
+  return [primitives](const std::vector<BenchmarkCase>& cases,
+                      int num_iterations, absl::Duration* elapsed) {
+    int64_t num_calls = 0;
+    for (const PrimitiveBenchmark& primitive : primitives) {
+      num_calls += primitive(cases, num_iterations, elapsed);
+    }
+    return num_calls;
+  };
+}
+
+const std::vector<BenchmarkSuite>& GetBenchmarkSuites() {
+  using functions::Add;
+  using functions::Divide;
+  using functions::Multiply;
+  using functions::Subtract;
+  static const auto* suites = new std::vector<BenchmarkSuite>{
+      {"Add", CasesOfKind(FunctionKind::kAdd, &GetFunctionTestsAdd),
+       AllOf({BinaryPrimitive<int64_t>(FunctionKind::kAdd, &Add<int64_t>),
+              BinaryPrimitive<uint64_t>(FunctionKind::kAdd, &Add<uint64_t>),
+              BinaryPrimitive<double>(FunctionKind::kAdd, &Add<double>)})},
+      {"Subtract",
+       CasesOfKind(FunctionKind::kSubtract, &GetFunctionTestsSubtract),
+       AllOf({BinaryPrimitive<int64_t>(FunctionKind::kSubtract,
+                                       &Subtract<int64_t, int64_t>),
+              BinaryPrimitive<double>(FunctionKind::kSubtract,
+                                      &Subtract<double, double>)})},
+      {"Multiply",
+       CasesOfKind(FunctionKind::kMultiply, &GetFunctionTestsMultiply),
+       AllOf({BinaryPrimitive<int64_t>(FunctionKind::kMultiply,
+                                       &Multiply<int64_t>),
+              BinaryPrimitive<uint64_t>(FunctionKind::kMultiply,
+                                        &Multiply<uint64_t>),
+              BinaryPrimitive<double>(FunctionKind::kMultiply,
+                                      &Multiply<double>)})},
+      {"Divide", CasesOfKind(FunctionKind::kDivide, &GetFunctionTestsDivide),
+       BinaryPrimitive<double>(FunctionKind::kDivide, &Divide<double>)},
+      {"Modulo", CasesOfKind(FunctionKind::kMod, &GetFunctionTestsModulo),
+       nullptr},
+      {"Equal", CasesOfKind(FunctionKind::kEqual,
+                            [] {
+                              return GetFunctionTestsEqual(
+                                  /*include_nano_timestamp=*/false);
+                            }),
+       nullptr},
+      {"Less", CasesOfKind(FunctionKind::kLess,
+                           [] {
+                             return GetFunctionTestsLess(
+                                 /*include_nano_timestamp=*/false);
+                           }),
+       nullptr},
+      {"And", CasesOfKind(FunctionKind::kAnd, &GetFunctionTestsAnd), nullptr},
+      {"Or", CasesOfKind(FunctionKind::kOr, &GetFunctionTestsOr), nullptr},
+      {"Like", CasesOfKind(FunctionKind::kLike, &GetFunctionTestsLike),
+       nullptr},
+      {"Math", CasesOfCalls(&GetFunctionTestsMath),
+       AllOf({UnaryPrimitive<double>(FunctionKind::kAbs, &functions::Abs),
+              UnaryPrimitive<int64_t>(FunctionKind::kAbs, &functions::Abs),
+              UnaryPrimitive<double>(FunctionKind::kSqrt, &functions::Sqrt),
+              UnaryPrimitive<double>(FunctionKind::kExp, &functions::Exp),
+              UnaryPrimitive<double>(FunctionKind::kNaturalLogarithm,
+                                     &functions::NaturalLogarithm),
+              BinaryPrimitive<double>(FunctionKind::kPow, &functions::Pow)})},
+      {"Rounding", CasesOfCalls(&GetFunctionTestsRounding),
+       AllOf({UnaryPrimitive<double>(FunctionKind::kRound, &functions::Round),
+              UnaryPrimitive<double>(FunctionKind::kTrunc, &functions::Trunc),
+              UnaryPrimitive<double>(FunctionKind::kCeil, &functions::Ceil),
+              UnaryPrimitive<double>(FunctionKind::kFloor,
+                                     &functions::Floor)})},
+      {"Trigonometric", CasesOfCalls(&GetFunctionTestsTrigonometric),
+       AllOf({UnaryPrimitive<double>(FunctionKind::kCos, &functions::Cos),
+              UnaryPrimitive<double>(FunctionKind::kSin, &functions::Sin),
+              UnaryPrimitive<double>(FunctionKind::kTan, &functions::Tan)})},
+      {"String", CasesOfCalls(&GetFunctionTestsString), nullptr},
+      {"Regexp", CasesOfCalls(&GetFunctionTestsRegexp), nullptr},
+      {"DateTime", CasesOfCalls(&GetFunctionTestsDateTime), nullptr},
+      {"CastDateTime",
+       CasesOfKind(FunctionKind::kCast, &GetFunctionTestsCastDateTime),
+       StringToDateTimestampPrimitive()},
+      {"Array", CasesOfCalls(&GetFunctionTestsArray), nullptr},
+      {"Json", CasesOfCalls(&GetFunctionTestsJson), nullptr},
+  };
+  return *suites;
+}
+
+// Times 'num_iterations' evaluations of each of 'cases' through the reference
+// implementation. Returns the number of calls made, and sets 'elapsed' to
+// their total time. Cases that the reference implementation rejects (e.g.,
+// because the compliance test only covers the analyzer) are skipped.
+int64_t BenchmarkReferenceImpl(const std::vector<BenchmarkCase>& cases,
+                               int num_iterations, absl::Duration* elapsed) {
+  LanguageOptions language_options;
+  language_options.EnableMaximumLanguageFeaturesForDevelopment();
+  EvaluationContext context((EvaluationOptions()));
+  context.SetLanguageOptions(language_options);
+
+  std::vector<std::unique_ptr<ValueExpr>> calls;
+  for (const BenchmarkCase& c : cases) {
+    std::vector<std::unique_ptr<ValueExpr>> arguments;
+    bool ok = true;
+    for (int i = 0; ok && i < c.params.num_params(); ++i) {
+      zetasql_base::StatusOr<std::unique_ptr<ConstExpr>> arg =
+          ConstExpr::Create(c.params.param(i));
+      ok = arg.ok();
+      if (ok) arguments.push_back(std::move(arg).ValueOrDie());
+    }
+    if (!ok) continue;
+    zetasql_base::StatusOr<std::unique_ptr<BuiltinScalarFunction>> function =
+        BuiltinScalarFunction::CreateValidated(
+            c.kind, language_options, c.params.GetResultType(), arguments);
+    if (!function.ok()) continue;
+    zetasql_base::StatusOr<std::unique_ptr<ScalarFunctionCallExpr>> call =
+        ScalarFunctionCallExpr::Create(std::move(function).ValueOrDie(),
+                                       std::move(arguments));
+    if (!call.ok() || !call.ValueOrDie()->SetSchemasForEvaluation({}).ok()) {
+      continue;
+    }
+    calls.push_back(std::move(call).ValueOrDie());
+  }
+
+  TupleSlot slot;
+  zetasql_base::Status status;
+  const absl::Time start = absl::Now();
+  for (int i = 0; i < num_iterations; ++i) {
+    for (const std::unique_ptr<ValueExpr>& call : calls) {
+      // Errors are expected for some of the cases and are timed as well.
+      call->EvalSimple({}, &context, &slot, &status);
+    }
+  }
+  *elapsed = absl::Now() - start;
+  return static_cast<int64_t>(calls.size()) * num_iterations;
+}
+
+// Prints one line of results.
+void PrintResult(const std::string& suite, const std::string& path,
+                 int64_t num_calls, absl::Duration elapsed) {
+  const double nanos_per_call =
+      num_calls == 0 ? 0 : absl::ToDoubleNanoseconds(elapsed) / num_calls;
+  std::cout << absl::StrFormat("%-14s %-10s %12d %14.1f", suite, path,
+                               num_calls, nanos_per_call)
+            << std::endl;
+}
+
+void Run() {
+  const int num_iterations = std::max(absl::GetFlag(FLAGS_num_iterations), 1);
+  const std::vector<std::string> selected_suites =
+      absl::StrSplit(absl::GetFlag(FLAGS_suites), ',', absl::SkipWhitespace());
+
+  std::cout << absl::StrFormat("%-14s %-10s %12s %14s", "suite", "path",
+                               "calls", "nanos_per_call")
+            << std::endl;
+  for (const BenchmarkSuite& suite : GetBenchmarkSuites()) {
+    if (!selected_suites.empty() &&
+        std::find(selected_suites.begin(), selected_suites.end(),
+                  suite.name) == selected_suites.end()) {
+      continue;
+    }
+    const std::vector<BenchmarkCase> cases = suite.get_cases();
+
+    absl::Duration elapsed;
+    const int64_t num_calls =
+        BenchmarkReferenceImpl(cases, num_iterations, &elapsed);
+    PrintResult(suite.name, "reference", num_calls, elapsed);
+
+    if (suite.primitive != nullptr) {
+      absl::Duration primitive_elapsed;
+      const int64_t num_primitive_calls =
+          suite.primitive(cases, num_iterations, &primitive_elapsed);
+      PrintResult(suite.name, "primitive", num_primitive_calls,
+                  primitive_elapsed);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace zetasql
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  zetasql::Run();
+  return 0;
+}
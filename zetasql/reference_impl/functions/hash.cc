@@ -16,19 +16,59 @@
 
 #include "zetasql/reference_impl/functions/hash.h"
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "zetasql/public/functions/hash.h"
 #include "zetasql/public/value.h"
 #include "zetasql/reference_impl/function.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_builder.h"
 #include "zetasql/base/statusor.h"
 
 namespace zetasql {
 namespace {
 
+// Returns the bytes of a STRING or BYTES value.
+absl::string_view GetHashInput(const Value& value) {
+  return value.type_kind() == TYPE_BYTES ? value.bytes_value()
+                                         : value.string_value();
+}
+
+// Returns false and populates 'status' unless there is exactly one argument
+// per row.
+bool CheckOneArgumentPerRow(absl::Span<const Value> args,
+                            absl::Span<Value> results,
+                            zetasql_base::Status* status) {
+  if (args.size() != results.size()) {
+    *status = zetasql_base::InternalErrorBuilder()
+              << "Expected one argument per row, got " << args.size()
+              << " arguments for " << results.size() << " rows";
+    return false;
+  }
+  return true;
+}
+
+// Appends the inputs of the non-NULL values in 'args' to 'inputs'.
+void GetNonNullHashInputs(absl::Span<const Value> args,
+                          std::vector<absl::string_view>* inputs) {
+  inputs->reserve(args.size());
+  for (const Value& arg : args) {
+    if (!arg.is_null()) inputs->push_back(GetHashInput(arg));
+  }
+}
+
 class HashFunction : public SimpleBuiltinScalarFunction {
  public:
   explicit HashFunction(FunctionKind kind);
   zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
                              EvaluationContext* context) const override;
+  bool EvalBatch(absl::Span<const Value> args, EvaluationContext* context,
+                 absl::Span<Value> results,
+                 zetasql_base::Status* status) const override;
 
  private:
   const std::unique_ptr<functions::Hasher> hasher_;
@@ -41,6 +81,9 @@ class FarmFingerprintFunction : public SimpleBuiltinScalarFunction {
                                     types::Int64Type()) {}
   zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
                              EvaluationContext* context) const override;
+  bool EvalBatch(absl::Span<const Value> args, EvaluationContext* context,
+                 absl::Span<Value> results,
+                 zetasql_base::Status* status) const override;
 };
 
 HashFunction::HashFunction(FunctionKind kind)
@@ -71,11 +114,31 @@ zetasql_base::StatusOr<Value> HashFunction::Eval(absl::Span<const Value> args,
     return Value::Null(output_type());
   }
 
-  const absl::string_view input = args[0].type_kind() == TYPE_BYTES
-                                      ? args[0].bytes_value()
-                                      : args[0].string_value();
+  return Value::Bytes(hasher_->Hash(GetHashInput(args[0])));
+}
 
-  return Value::Bytes(hasher_->Hash(input));
+bool HashFunction::EvalBatch(absl::Span<const Value> args,
+                             EvaluationContext* context,
+                             absl::Span<Value> results,
+                             zetasql_base::Status* status) const {
+  if (!CheckOneArgumentPerRow(args, results, status)) return false;
+  std::vector<absl::string_view> inputs;
+  GetNonNullHashInputs(args, &inputs);
+  std::string digests;
+  hasher_->HashBatch(inputs, &digests);
+
+  const absl::string_view all_digests = digests;
+  const int digest_size = hasher_->digest_size();
+  int next_digest = 0;
+  for (int i = 0; i < args.size(); ++i) {
+    if (args[i].is_null()) {
+      results[i] = Value::Null(output_type());
+    } else {
+      results[i] = Value::Bytes(
+          all_digests.substr(next_digest++ * digest_size, digest_size));
+    }
+  }
+  return true;
 }
 
 zetasql_base::StatusOr<Value> FarmFingerprintFunction::Eval(
@@ -85,11 +148,26 @@ zetasql_base::StatusOr<Value> FarmFingerprintFunction::Eval(
     return Value::Null(output_type());
   }
 
-  const absl::string_view input = args[0].type_kind() == TYPE_BYTES
-                                      ? args[0].bytes_value()
-                                      : args[0].string_value();
+  return Value::Int64(functions::FarmFingerprint(GetHashInput(args[0])));
+}
 
-  return Value::Int64(functions::FarmFingerprint(input));
+bool FarmFingerprintFunction::EvalBatch(absl::Span<const Value> args,
+                                        EvaluationContext* context,
+                                        absl::Span<Value> results,
+                                        zetasql_base::Status* status) const {
+  if (!CheckOneArgumentPerRow(args, results, status)) return false;
+  std::vector<absl::string_view> inputs;
+  GetNonNullHashInputs(args, &inputs);
+  std::vector<int64_t> fingerprints(inputs.size());
+  functions::FarmFingerprintBatch(inputs, absl::MakeSpan(fingerprints));
+
+  int next_fingerprint = 0;
+  for (int i = 0; i < args.size(); ++i) {
+    results[i] = args[i].is_null()
+                     ? Value::Null(output_type())
+                     : Value::Int64(fingerprints[next_fingerprint++]);
+  }
+  return true;
 }
 
 }  // namespace
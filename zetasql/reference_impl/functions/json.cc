@@ -16,27 +16,168 @@
 
 #include "zetasql/reference_impl/functions/json.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "zetasql/public/functions/json.h"
+#include "zetasql/public/functions/to_json.h"
 #include "zetasql/reference_impl/function.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 
 namespace zetasql {
 namespace {
 
+// Holds the JsonPathEvaluator for the last JSONPath that a function was called
+// with. The JSONPath argument is almost always a constant, so this parses it
+// once instead of for every row. The evaluator is shared by all threads
+// evaluating the function.
+class JsonPathEvaluatorCache {
+ public:
+  explicit JsonPathEvaluatorCache(bool sql_standard_mode)
+      : sql_standard_mode_(sql_standard_mode) {}
+
+  zetasql_base::StatusOr<std::shared_ptr<const functions::JsonPathEvaluator>> Get(
+      absl::string_view json_path) const {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (evaluator_ != nullptr && json_path_ == json_path) {
+        return evaluator_;
+      }
+    }
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<functions::JsonPathEvaluator> evaluator,
+        functions::JsonPathEvaluator::Create(json_path, sql_standard_mode_));
+    evaluator->enable_special_character_escaping();
+    std::shared_ptr<const functions::JsonPathEvaluator> shared_evaluator =
+        std::move(evaluator);
+    absl::MutexLock lock(&mutex_);
+    json_path_ = std::string(json_path);
+    evaluator_ = shared_evaluator;
+    return shared_evaluator;
+  }
+
+ private:
+  const bool sql_standard_mode_;
+  mutable absl::Mutex mutex_;
+  mutable std::string json_path_ ABSL_GUARDED_BY(mutex_);
+  mutable std::shared_ptr<const functions::JsonPathEvaluator> evaluator_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+// Like JsonPathEvaluatorCache, but for the list of JSONPaths of a
+// $json_extract_scalars call.
+class JsonPathEvaluatorListCache {
+ public:
+  using EvaluatorList =
+      std::vector<std::unique_ptr<const functions::JsonPathEvaluator>>;
+
+  zetasql_base::StatusOr<std::shared_ptr<const EvaluatorList>> Get(
+      absl::Span<const Value> json_paths) const {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (evaluators_ != nullptr && SamePathsLocked(json_paths)) {
+        return evaluators_;
+      }
+    }
+    auto evaluators = std::make_shared<EvaluatorList>();
+    std::vector<std::string> paths;
+    for (const Value& json_path : json_paths) {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<functions::JsonPathEvaluator> evaluator,
+                       functions::JsonPathEvaluator::Create(
+                           json_path.string_view_value(),
+                           /*sql_standard_mode=*/false));
+      evaluators->push_back(std::move(evaluator));
+      paths.push_back(json_path.string_value());
+    }
+    absl::MutexLock lock(&mutex_);
+    json_paths_ = std::move(paths);
+    evaluators_ = evaluators;
+    return std::shared_ptr<const EvaluatorList>(std::move(evaluators));
+  }
+
+ private:
+  bool SamePathsLocked(absl::Span<const Value> json_paths) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (json_paths.size() != json_paths_.size()) return false;
+    for (int i = 0; i < json_paths.size(); ++i) {
+      if (json_paths[i].string_view_value() != json_paths_[i]) return false;
+    }
+    return true;
+  }
+
+  mutable absl::Mutex mutex_;
+  mutable std::vector<std::string> json_paths_ ABSL_GUARDED_BY(mutex_);
+  mutable std::shared_ptr<const EvaluatorList> evaluators_
+      ABSL_GUARDED_BY(mutex_);
+};
+
 class JsonFunction : public SimpleBuiltinScalarFunction {
  public:
   explicit JsonFunction(FunctionKind kind)
-      : SimpleBuiltinScalarFunction(kind, types::StringType()) {}
+      : SimpleBuiltinScalarFunction(kind, types::StringType()),
+        evaluator_cache_(
+            /*sql_standard_mode=*/kind == FunctionKind::kJsonQuery ||
+            kind == FunctionKind::kJsonValue) {}
   zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
                              EvaluationContext* context) const override;
+
+ private:
+  const JsonPathEvaluatorCache evaluator_cache_;
 };
 
 class JsonExtractArrayFunction : public SimpleBuiltinScalarFunction {
  public:
   explicit JsonExtractArrayFunction()
       : SimpleBuiltinScalarFunction(FunctionKind::kJsonExtractArray,
+                                    types::StringArrayType()),
+        // sql_standard_mode is set to false for all JSON_EXTRACT functions to
+        // keep the JSONPath syntax the same.
+        evaluator_cache_(/*sql_standard_mode=*/false) {}
+  zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
+                             EvaluationContext* context) const override;
+
+ private:
+  const JsonPathEvaluatorCache evaluator_cache_;
+};
+
+// $json_extract_scalars(json, path_1, ..., path_n) returns the array
+// [JSON_EXTRACT_SCALAR(json, path_1), ..., JSON_EXTRACT_SCALAR(json, path_n)],
+// parsing 'json' only once. The algebrizer uses it for projections that
+// extract several values from the same JSON column.
+class JsonExtractScalarsFunction : public SimpleBuiltinScalarFunction {
+ public:
+  JsonExtractScalarsFunction()
+      : SimpleBuiltinScalarFunction(FunctionKind::kJsonExtractScalars,
                                     types::StringArrayType()) {}
   zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
                              EvaluationContext* context) const override;
+
+ private:
+  const JsonPathEvaluatorListCache evaluator_cache_;
+};
+
+class ToJsonStringFunction : public SimpleBuiltinScalarFunction {
+ public:
+  ToJsonStringFunction()
+      : SimpleBuiltinScalarFunction(FunctionKind::kToJsonString,
+                                    types::StringType()),
+        compact_writer_(/*pretty_print=*/false),
+        pretty_writer_(/*pretty_print=*/true) {}
+  zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
+                             EvaluationContext* context) const override;
+
+ private:
+  // The writers keep the quoted field names of the struct types that they
+  // have written, so they are reused across rows. A thread that finds them
+  // busy uses a writer of its own instead of waiting.
+  mutable absl::Mutex mutex_;
+  mutable functions::JsonWriter compact_writer_ ABSL_GUARDED_BY(mutex_);
+  mutable functions::JsonWriter pretty_writer_ ABSL_GUARDED_BY(mutex_);
 };
 
 zetasql_base::StatusOr<Value> JsonFunction::Eval(absl::Span<const Value> args,
@@ -45,25 +186,18 @@ zetasql_base::StatusOr<Value> JsonFunction::Eval(absl::Span<const Value> args,
   if (HasNulls(args)) {
     return Value::Null(output_type());
   }
-  // Note that since the second argument, json_path, is always a constant, it
-  // would be better performance-wise just to create the JsonPathEvaluator once.
-  bool sql_standard_mode = (kind() == FunctionKind::kJsonQuery ||
-                            kind() == FunctionKind::kJsonValue);
-
   ZETASQL_ASSIGN_OR_RETURN(
-      const std::unique_ptr<functions::JsonPathEvaluator> evaluator,
-      functions::JsonPathEvaluator::Create(
-          /*json_path=*/args[1].string_value(), sql_standard_mode));
-  evaluator->enable_special_character_escaping();
+      const std::shared_ptr<const functions::JsonPathEvaluator> evaluator,
+      evaluator_cache_.Get(/*json_path=*/args[1].string_view_value()));
   std::string output;
   bool is_null = true;
   if (kind() == FunctionKind::kJsonQuery ||
       kind() == FunctionKind::kJsonExtract) {
     ZETASQL_RETURN_IF_ERROR(
-        evaluator->Extract(args[0].string_value(), &output, &is_null));
+        evaluator->Extract(args[0].string_view_value(), &output, &is_null));
   } else {  // kJsonValue || kJsonExtractScalar
-    ZETASQL_RETURN_IF_ERROR(
-        evaluator->ExtractScalar(args[0].string_value(), &output, &is_null));
+    ZETASQL_RETURN_IF_ERROR(evaluator->ExtractScalar(args[0].string_view_value(),
+                                             &output, &is_null));
   }
   if (is_null) {
     return Value::Null(output_type());
@@ -79,25 +213,75 @@ zetasql_base::StatusOr<Value> JsonExtractArrayFunction::Eval(
   if (HasNulls(args)) {
     return Value::Null(types::StringArrayType());
   }
-  std::string json_path = args.size() == 2 ? args[1].string_value() : "$";
-
-  // sql_standard_mode is set to false for all JSON_EXTRACT functions to keep
-  // the JSONPath syntax the same.
+  const absl::string_view json_path =
+      args.size() == 2 ? args[1].string_view_value() : "$";
   ZETASQL_ASSIGN_OR_RETURN(
-      const std::unique_ptr<functions::JsonPathEvaluator> evaluator,
-      functions::JsonPathEvaluator::Create(json_path,
-                                           /*sql_standard_mode=*/false));
-  evaluator->enable_special_character_escaping();
+      const std::shared_ptr<const functions::JsonPathEvaluator> evaluator,
+      evaluator_cache_.Get(json_path));
   std::vector<std::string> output;
   bool is_null = false;
-  ZETASQL_RETURN_IF_ERROR(
-      evaluator->ExtractArray(args[0].string_value(), &output, &is_null));
+  ZETASQL_RETURN_IF_ERROR(evaluator->ExtractArray(args[0].string_view_value(),
+                                          &output, &is_null));
   if (is_null) {
     return Value::Null(types::StringArrayType());
   }
   return values::StringArray(output);
 }
 
+zetasql_base::StatusOr<Value> JsonExtractScalarsFunction::Eval(
+    absl::Span<const Value> args, EvaluationContext* context) const {
+  DCHECK_GE(args.size(), 2);
+  if (args[0].is_null()) {
+    return Value::Null(types::StringArrayType());
+  }
+  const absl::Span<const Value> json_paths = args.subspan(1);
+  for (const Value& json_path : json_paths) {
+    ZETASQL_RET_CHECK(!json_path.is_null());
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      const std::shared_ptr<const JsonPathEvaluatorListCache::EvaluatorList>
+          evaluators,
+      evaluator_cache_.Get(json_paths));
+  std::vector<const functions::JsonPathEvaluator*> evaluator_ptrs;
+  evaluator_ptrs.reserve(evaluators->size());
+  for (const auto& evaluator : *evaluators) {
+    evaluator_ptrs.push_back(evaluator.get());
+  }
+  std::vector<std::string> outputs;
+  std::vector<bool> is_null;
+  ZETASQL_RETURN_IF_ERROR(functions::JsonPathEvaluator::ExtractScalars(
+      args[0].string_view_value(), evaluator_ptrs, &outputs, &is_null));
+  std::vector<Value> elements;
+  elements.reserve(outputs.size());
+  for (int i = 0; i < outputs.size(); ++i) {
+    elements.push_back(is_null[i] ? Value::NullString()
+                                  : Value::String(std::move(outputs[i])));
+  }
+  return Value::Array(types::StringArrayType(), std::move(elements));
+}
+
+zetasql_base::StatusOr<Value> ToJsonStringFunction::Eval(
+    absl::Span<const Value> args, EvaluationContext* context) const {
+  DCHECK_GE(args.size(), 1);
+  DCHECK_LE(args.size(), 2);
+  if (args.size() == 2 && args[1].is_null()) {
+    return Value::NullString();
+  }
+  const bool pretty_print = args.size() == 2 && args[1].bool_value();
+  std::string output;
+  if (mutex_.TryLock()) {
+    functions::JsonWriter& writer =
+        pretty_print ? pretty_writer_ : compact_writer_;
+    const zetasql_base::Status status = writer.Append(args[0], &output);
+    mutex_.Unlock();
+    ZETASQL_RETURN_IF_ERROR(status);
+  } else {
+    functions::JsonWriter writer(pretty_print);
+    ZETASQL_RETURN_IF_ERROR(writer.Append(args[0], &output));
+  }
+  return Value::String(std::move(output));
+}
+
 }  // namespace
 
 void RegisterBuiltinJsonFunctions() {
@@ -112,6 +296,16 @@ void RegisterBuiltinJsonFunctions() {
       [](FunctionKind kind, const Type* output_type) {
         return new JsonExtractArrayFunction();
       });
+  BuiltinFunctionRegistry::RegisterScalarFunction(
+      {FunctionKind::kJsonExtractScalars},
+      [](FunctionKind kind, const Type* output_type) {
+        return new JsonExtractScalarsFunction();
+      });
+  BuiltinFunctionRegistry::RegisterScalarFunction(
+      {FunctionKind::kToJsonString},
+      [](FunctionKind kind, const Type* output_type) {
+        return new ToJsonStringFunction();
+      });
 }
 
 }  // namespace zetasql
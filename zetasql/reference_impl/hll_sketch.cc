@@ -0,0 +1,182 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/hll_sketch.h"
+
+#include <cmath>
+#include <utility>
+
+#include "zetasql/base/bits.h"
+#include "absl/strings/string_view.h"
+
+namespace zetasql {
+
+namespace {
+
+// The number of bytes charged for each slot of the sparse registers, which
+// includes the control byte of the hash table.
+constexpr int64_t kSparseSlotBytes =
+    sizeof(std::pair<const uint16_t, uint8_t>) + 1;
+
+// Finalizer of SplitMix64, which spreads the bits of 'x' over the result.
+uint64_t Mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// 64-bit FNV-1a.
+uint64_t HashBytes(absl::string_view bytes) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const char c : bytes) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+}  // namespace
+
+uint64_t HllSketch::HashValue(const Value& value) {
+  if (value.is_null()) return Mix64(value.HashCode());
+  switch (value.type_kind()) {
+    case TYPE_INT32:
+      return Mix64(static_cast<uint64_t>(value.int32_value()));
+    case TYPE_INT64:
+      return Mix64(static_cast<uint64_t>(value.int64_value()));
+    case TYPE_UINT32:
+      return Mix64(value.uint32_value());
+    case TYPE_UINT64:
+      return Mix64(value.uint64_value());
+    case TYPE_BOOL:
+      return Mix64(value.bool_value() ? 1 : 0);
+    case TYPE_DATE:
+      return Mix64(static_cast<uint64_t>(value.date_value()));
+    case TYPE_ENUM:
+      return Mix64(static_cast<uint64_t>(value.enum_value()));
+    case TYPE_STRING:
+      return Mix64(HashBytes(value.string_value()));
+    case TYPE_BYTES:
+      return Mix64(HashBytes(value.bytes_value()));
+    default:
+      return Mix64(value.HashCode());
+  }
+}
+
+bool HllSketch::Add(uint64_t hash, zetasql_base::Status* status) {
+  const int index = static_cast<int>(hash >> (64 - kPrecision));
+  const uint64_t remaining_bits = hash << kPrecision;
+  const uint8_t rank =
+      remaining_bits == 0
+          ? 64 - kPrecision + 1
+          : zetasql_base::Bits::CountLeadingZeros64(remaining_bits) + 1;
+  return UpdateRegister(index, rank, status);
+}
+
+bool HllSketch::Merge(const HllSketch& other, zetasql_base::Status* status) {
+  if (other.dense_registers_.empty()) {
+    for (const auto& entry : other.sparse_registers_) {
+      if (!UpdateRegister(entry.first, entry.second, status)) return false;
+    }
+    return true;
+  }
+  if (dense_registers_.empty() && !Densify(status)) return false;
+  for (int i = 0; i < kNumRegisters; ++i) {
+    if (other.dense_registers_[i] > dense_registers_[i]) {
+      dense_registers_[i] = other.dense_registers_[i];
+    }
+  }
+  return true;
+}
+
+int64_t HllSketch::Estimate() const {
+  double sum = 0;
+  int num_zeros = 0;
+  if (dense_registers_.empty()) {
+    num_zeros = kNumRegisters - static_cast<int>(sparse_registers_.size());
+    sum = num_zeros;
+    for (const auto& entry : sparse_registers_) {
+      sum += std::ldexp(1.0, -entry.second);
+    }
+  } else {
+    for (const uint8_t rank : dense_registers_) {
+      sum += std::ldexp(1.0, -rank);
+      if (rank == 0) ++num_zeros;
+    }
+  }
+  if (num_zeros == kNumRegisters) return 0;
+
+  const double m = kNumRegisters;
+  const double alpha = 0.7213 / (1 + 1.079 / m);
+  double estimate = alpha * m * m / sum;
+  // Linear counting is more accurate for small cardinalities.
+  if (estimate <= 2.5 * m && num_zeros > 0) {
+    estimate = m * std::log(m / num_zeros);
+  }
+  return std::llround(estimate);
+}
+
+void HllSketch::Clear() {
+  absl::flat_hash_map<uint16_t, uint8_t>().swap(sparse_registers_);
+  std::vector<uint8_t>().swap(dense_registers_);
+  accountant_->ReturnBytes(num_bytes_);
+  num_bytes_ = 0;
+}
+
+bool HllSketch::UpdateRegister(int index, uint8_t rank,
+                               zetasql_base::Status* status) {
+  if (!dense_registers_.empty()) {
+    if (rank > dense_registers_[index]) dense_registers_[index] = rank;
+    return true;
+  }
+  uint8_t& register_rank = sparse_registers_[index];
+  if (rank > register_rank) register_rank = rank;
+  if (sparse_registers_.capacity() * kSparseSlotBytes >= kNumRegisters) {
+    return Densify(status);
+  }
+  return UpdateMemory(status);
+}
+
+bool HllSketch::Densify(zetasql_base::Status* status) {
+  dense_registers_.assign(kNumRegisters, 0);
+  for (const auto& entry : sparse_registers_) {
+    dense_registers_[entry.first] = entry.second;
+  }
+  absl::flat_hash_map<uint16_t, uint8_t>().swap(sparse_registers_);
+  return UpdateMemory(status);
+}
+
+bool HllSketch::UpdateMemory(zetasql_base::Status* status) {
+  const int64_t new_num_bytes =
+      dense_registers_.empty()
+          ? static_cast<int64_t>(sparse_registers_.capacity()) *
+                kSparseSlotBytes
+          : static_cast<int64_t>(dense_registers_.size());
+  if (new_num_bytes > num_bytes_) {
+    if (!accountant_->RequestBytes(new_num_bytes - num_bytes_, status)) {
+      return false;
+    }
+  } else {
+    accountant_->ReturnBytes(num_bytes_ - new_num_bytes);
+  }
+  num_bytes_ = new_num_bytes;
+  return true;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,93 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// HyperLogLog sketch used by the reference implementation to estimate
+// APPROX_COUNT_DISTINCT if
+// EvaluationOptions::use_sketches_for_approx_count_distinct is true.
+
+#ifndef ZETASQL_REFERENCE_IMPL_HLL_SKETCH_H_
+#define ZETASQL_REFERENCE_IMPL_HLL_SKETCH_H_
+
+#include <vector>
+
+#include <cstdint>
+#include "zetasql/public/value.h"
+#include "zetasql/reference_impl/tuple.h"
+#include "absl/container/flat_hash_map.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+// Estimates the number of distinct 64-bit hashes added to it with
+// 2^kPrecision registers, for a standard error of about 0.8%. Small sketches
+// only store their non-zero registers, so that a sketch per group of a
+// GROUP BY with few distinct values per group stays small. All the memory is
+// charged to a MemoryAccountant.
+class HllSketch {
+ public:
+  static constexpr int kPrecision = 14;
+  static constexpr int kNumRegisters = 1 << kPrecision;
+
+  // 'accountant' must outlive this object.
+  explicit HllSketch(MemoryAccountant* accountant) : accountant_(accountant) {}
+
+  HllSketch(const HllSketch&) = delete;
+  HllSketch& operator=(const HllSketch&) = delete;
+
+  ~HllSketch() { Clear(); }
+
+  // Returns a hash of 'value' to pass to Add(). Equal values of the same type
+  // have the same hash. The hashes of integers, strings and bytes do not
+  // depend on the process, so neither do the estimates for them.
+  static uint64_t HashValue(const Value& value);
+
+  // Adds 'hash' to the sketch. Returns false and populates 'status' if the
+  // accountant is out of memory.
+  bool Add(uint64_t hash, zetasql_base::Status* status);
+
+  // Adds all the hashes that were added to 'other' to this sketch.
+  bool Merge(const HllSketch& other, zetasql_base::Status* status);
+
+  // Returns the estimated number of distinct hashes.
+  int64_t Estimate() const;
+
+  // Removes all the hashes and returns the memory to the accountant.
+  void Clear();
+
+  // Returns the number of bytes charged to the accountant.
+  int64_t num_bytes() const { return num_bytes_; }
+
+ private:
+  // Sets register 'index' to 'rank' if that is larger.
+  bool UpdateRegister(int index, uint8_t rank, zetasql_base::Status* status);
+
+  // Replaces 'sparse_registers_' with 'dense_registers_'.
+  bool Densify(zetasql_base::Status* status);
+
+  // Updates 'num_bytes_' for the size of the registers.
+  bool UpdateMemory(zetasql_base::Status* status);
+
+  MemoryAccountant* accountant_;  // Not owned.
+  // The non-zero registers while the sketch is sparse.
+  absl::flat_hash_map<uint16_t, uint8_t> sparse_registers_;
+  // All the registers once the sketch is dense; empty before.
+  std::vector<uint8_t> dense_registers_;
+  int64_t num_bytes_ = 0;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_HLL_SKETCH_H_
@@ -0,0 +1,131 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/hll_sketch.h"
+
+#include <cstdint>
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/value.h"
+#include "zetasql/reference_impl/tuple.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+
+namespace zetasql {
+namespace {
+
+using zetasql_base::testing::StatusIs;
+
+constexpr int64_t kMaxBytes = 1024 * 1024;
+
+// Adds INT64 values 'begin' to 'end' (exclusive) to 'sketch'.
+void AddInt64s(int64_t begin, int64_t end, HllSketch* sketch) {
+  zetasql_base::Status status;
+  for (int64_t i = begin; i < end; ++i) {
+    ASSERT_TRUE(sketch->Add(HllSketch::HashValue(Value::Int64(i)), &status))
+        << status;
+  }
+}
+
+TEST(HllSketchTest, Empty) {
+  MemoryAccountant accountant(kMaxBytes);
+  HllSketch sketch(&accountant);
+  EXPECT_EQ(0, sketch.Estimate());
+  EXPECT_EQ(0, sketch.num_bytes());
+}
+
+TEST(HllSketchTest, EstimatesAreAccurate) {
+  for (const int64_t num_values : {1, 10, 1000, 20000, 200000}) {
+    MemoryAccountant accountant(kMaxBytes);
+    HllSketch sketch(&accountant);
+    // Every value is added twice.
+    AddInt64s(0, num_values, &sketch);
+    AddInt64s(0, num_values, &sketch);
+    EXPECT_NEAR(num_values, sketch.Estimate(), 0.03 * num_values + 1)
+        << num_values;
+    EXPECT_LE(sketch.num_bytes(), HllSketch::kNumRegisters);
+    EXPECT_EQ(kMaxBytes - sketch.num_bytes(), accountant.remaining_bytes());
+  }
+}
+
+TEST(HllSketchTest, HashesStrings) {
+  MemoryAccountant accountant(kMaxBytes);
+  HllSketch sketch(&accountant);
+  zetasql_base::Status status;
+  for (int i = 0; i < 5000; ++i) {
+    const Value value = Value::String(absl::StrCat("value", i % 1000));
+    ASSERT_TRUE(sketch.Add(HllSketch::HashValue(value), &status)) << status;
+  }
+  EXPECT_NEAR(1000, sketch.Estimate(), 30);
+  EXPECT_EQ(HllSketch::HashValue(Value::String("a")),
+            HllSketch::HashValue(Value::String("a")));
+  EXPECT_NE(HllSketch::HashValue(Value::String("a")),
+            HllSketch::HashValue(Value::String("b")));
+}
+
+TEST(HllSketchTest, Merge) {
+  MemoryAccountant accountant(kMaxBytes);
+  HllSketch small(&accountant);
+  HllSketch large(&accountant);
+  HllSketch merged(&accountant);
+  AddInt64s(0, 100, &small);
+  AddInt64s(50, 100000, &large);
+
+  zetasql_base::Status status;
+  ASSERT_TRUE(merged.Merge(small, &status)) << status;
+  EXPECT_EQ(small.Estimate(), merged.Estimate());
+  ASSERT_TRUE(merged.Merge(large, &status)) << status;
+  EXPECT_NEAR(100000, merged.Estimate(), 3000);
+
+  // Merging a sketch into itself does not change it.
+  const int64_t estimate = merged.Estimate();
+  ASSERT_TRUE(merged.Merge(merged, &status)) << status;
+  EXPECT_EQ(estimate, merged.Estimate());
+}
+
+TEST(HllSketchTest, ReturnsMemory) {
+  MemoryAccountant accountant(kMaxBytes);
+  {
+    HllSketch sketch(&accountant);
+    AddInt64s(0, 10, &sketch);
+    EXPECT_GT(sketch.num_bytes(), 0);
+    EXPECT_EQ(kMaxBytes - sketch.num_bytes(), accountant.remaining_bytes());
+    sketch.Clear();
+    EXPECT_EQ(0, sketch.num_bytes());
+    EXPECT_EQ(0, sketch.Estimate());
+    EXPECT_EQ(kMaxBytes, accountant.remaining_bytes());
+
+    AddInt64s(0, 100000, &sketch);
+    EXPECT_EQ(HllSketch::kNumRegisters, sketch.num_bytes());
+  }
+  EXPECT_EQ(kMaxBytes, accountant.remaining_bytes());
+}
+
+TEST(HllSketchTest, OutOfMemory) {
+  MemoryAccountant accountant(/*total_num_bytes=*/100);
+  HllSketch sketch(&accountant);
+  zetasql_base::Status status;
+  bool ok = true;
+  for (int64_t i = 0; ok && i < 1000; ++i) {
+    ok = sketch.Add(HllSketch::HashValue(Value::Int64(i)), &status);
+  }
+  EXPECT_FALSE(ok);
+  EXPECT_THAT(status,
+              StatusIs(zetasql_base::StatusCode::kResourceExhausted, testing::_));
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -0,0 +1,43 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/in_list_set.h"
+
+#include "zetasql/base/logging.h"
+
+namespace zetasql {
+
+InListSet::InListSet(absl::Span<const Value> elements)
+    : empty_(elements.empty()) {
+  set_.reserve(elements.size());
+  for (const Value& element : elements) {
+    DCHECK(SupportsType(element.type())) << element.type()->DebugString();
+    if (element.is_null()) {
+      has_null_ = true;
+    } else if (set_.insert(element).second) {
+      distinct_values_.push_back(element);
+    }
+  }
+}
+
+Value InListSet::Contains(const Value& value) const {
+  if (empty_) return values::False();
+  if (value.is_null()) return values::NullBool();
+  if (set_.contains(value)) return values::True();
+  return has_null_ ? values::NullBool() : values::False();
+}
+
+}  // namespace zetasql
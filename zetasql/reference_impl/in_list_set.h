@@ -0,0 +1,64 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_REFERENCE_IMPL_IN_LIST_SET_H_
+#define ZETASQL_REFERENCE_IMPL_IN_LIST_SET_H_
+
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
+
+namespace zetasql {
+
+// The elements of an IN list or of the array of an IN UNNEST, stored so that
+// '<value> IN <elements>' can be computed with one hash lookup instead of one
+// comparison per element.
+class InListSet {
+ public:
+  // Returns true if equal values of 'type' are indistinguishable, so that the
+  // set implements SQL equality.
+  static bool SupportsType(const Type* type) {
+    return type->IsSimpleType() && !type->IsFloatingPoint();
+  }
+
+  // The elements must have a type for which SupportsType() is true.
+  explicit InListSet(absl::Span<const Value> elements);
+
+  InListSet(const InListSet&) = delete;
+  InListSet& operator=(const InListSet&) = delete;
+
+  // Returns the result of '<value> IN <elements>' with SQL semantics: FALSE if
+  // there are no elements, NULL if 'value' is NULL, TRUE if 'value' equals an
+  // element, and otherwise NULL if there is a NULL element and FALSE if not.
+  Value Contains(const Value& value) const;
+
+  // Returns the distinct non-NULL elements, in the order that they first
+  // appear in the elements passed to the constructor.
+  const std::vector<Value>& distinct_values() const { return distinct_values_; }
+
+ private:
+  const bool empty_;
+  bool has_null_ = false;
+  std::vector<Value> distinct_values_;
+  absl::flat_hash_set<Value> set_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_IN_LIST_SET_H_
@@ -0,0 +1,67 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/in_list_set.h"
+
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/testing/test_value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(InListSetTest, SupportsType) {
+  EXPECT_TRUE(InListSet::SupportsType(types::Int64Type()));
+  EXPECT_TRUE(InListSet::SupportsType(types::StringType()));
+  EXPECT_TRUE(InListSet::SupportsType(types::DateType()));
+  EXPECT_FALSE(InListSet::SupportsType(types::DoubleType()));
+  EXPECT_FALSE(InListSet::SupportsType(types::Int64ArrayType()));
+}
+
+TEST(InListSetTest, Contains) {
+  const InListSet set(
+      {Value::Int64(3), Value::Int64(1), Value::Int64(3), Value::Int64(2)});
+  EXPECT_THAT(set.distinct_values(),
+              ElementsAre(Value::Int64(3), Value::Int64(1), Value::Int64(2)));
+  EXPECT_EQ(set.Contains(Value::Int64(1)), values::True());
+  EXPECT_EQ(set.Contains(Value::Int64(4)), values::False());
+  EXPECT_EQ(set.Contains(Value::NullInt64()), values::NullBool());
+}
+
+TEST(InListSetTest, NullElements) {
+  const InListSet set({Value::String("a"), Value::NullString()});
+  EXPECT_THAT(set.distinct_values(), ElementsAre(Value::String("a")));
+  EXPECT_EQ(set.Contains(Value::String("a")), values::True());
+  EXPECT_EQ(set.Contains(Value::String("b")), values::NullBool());
+  EXPECT_EQ(set.Contains(Value::NullString()), values::NullBool());
+}
+
+TEST(InListSetTest, Empty) {
+  const InListSet set(std::vector<Value>{});
+  EXPECT_THAT(set.distinct_values(), IsEmpty());
+  EXPECT_EQ(set.Contains(Value::Int64(1)), values::False());
+  EXPECT_EQ(set.Contains(Value::NullInt64()), values::False());
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -82,6 +82,7 @@ class AlgebraNode;
 class AnalyticFunctionBody;
 class AnalyticFunctionCallExpr;
 class ExprArg;
+class InListSet;
 class KeyArg;
 class RelationalArg;
 class RelationalOp;
@@ -116,6 +117,11 @@ class AlgebraArg {
   const AlgebraNode* node() const { return node_.get(); }
   AlgebraNode* mutable_node() { return node_.get(); }
 
+  // Replaces the node, e.g., to wrap it in another one. If this argument has a
+  // variable, 'node' must be a ValueExpr.
+  std::unique_ptr<AlgebraNode> release_node() { return std::move(node_); }
+  void set_node(std::unique_ptr<AlgebraNode> node) { node_ = std::move(node); }
+
   bool has_variable() const { return variable_.is_valid(); }
   const VariableId& variable() const { return variable_; }
 
@@ -452,6 +458,16 @@ class WindowFrameArg : public AlgebraArg {
   WindowFrameArg& operator=(const WindowFrameArg&) = delete;
   ~WindowFrameArg() override {}
 
+  WindowFrameType window_frame_type() const { return window_frame_type_; }
+
+  const WindowFrameBoundaryArg* start_boundary_arg() const {
+    return start_boundary_arg_.get();
+  }
+
+  const WindowFrameBoundaryArg* end_boundary_arg() const {
+    return end_boundary_arg_.get();
+  }
+
   // Sets evaluation context on the boundary offset expressions.
   void SetContext(EvaluationContext* context) const;
 
@@ -589,6 +605,20 @@ class AggregateArgAccumulator {
   // only important if we are doing compliance or random query testing.
   virtual ::zetasql_base::StatusOr<Value> GetFinalResult(
       bool inputs_in_defined_order) = 0;
+
+  // Like AggregateAccumulator::SerializeState(). Only supported if
+  // AggregateArg::SupportsPartialAggregation() returns true; the default
+  // implementation returns an error.
+  virtual ::zetasql_base::StatusOr<Value> SerializeState();
+
+  // Like AggregateAccumulator::Merge().
+  virtual ::zetasql_base::Status Merge(const Value& state);
+
+  // Resets the accumulation to 'state'.
+  ::zetasql_base::Status DeserializeState(const Value& state) {
+    ZETASQL_RETURN_IF_ERROR(Reset());
+    return Merge(state);
+  }
 };
 
 // Operator argument class used by AggregateOp for aggregated arguments.
@@ -618,6 +648,13 @@ class AggregateArg : public ExprArg {
       const TupleSchema& group_schema,
       absl::Span<const TupleSchema* const> params_schemas);
 
+  // Like SetSchemasForEvaluation(), but for an aggregation that only merges
+  // the states of its accumulators (see AggregateOp::kFinal) and therefore
+  // never evaluates its input fields.
+  ::zetasql_base::Status SetSchemasForMerge(
+      const TupleSchema& group_schema,
+      absl::Span<const TupleSchema* const> params_schemas);
+
   // Returns an accumulator corresponding this aggregation operations.
   ::zetasql_base::StatusOr<std::unique_ptr<AggregateArgAccumulator>> CreateAccumulator(
       absl::Span<const TupleData* const> params,
@@ -635,6 +672,27 @@ class AggregateArg : public ExprArg {
   // Sets evaluation context on input expressions.
   void SetContext(EvaluationContext* context) const;
 
+  // Returns true if the aggregation has no DISTINCT, HAVING, ORDER BY or
+  // LIMIT modifiers and no arguments besides its input fields, so that its
+  // result only depends on the multiset of the values of its input fields.
+  bool IsPlainAggregation() const;
+
+  // Returns true if the accumulators of this aggregation support
+  // SerializeState() and Merge(), which requires the function to support
+  // them and the aggregation to have no HAVING, ORDER BY or LIMIT modifiers
+  // and the default error mode.
+  bool SupportsPartialAggregation() const;
+
+  const AggregateFunctionCallExpr* aggregate_function() const;
+
+  // The fields to be aggregated.
+  int input_field_list_size() const { return num_input_fields(); }
+  const ValueExpr* input_field(int i) const;
+
+  ResolvedFunctionCallBase::ErrorMode error_mode() const {
+    return error_mode_;
+  }
+
  private:
   AggregateArg(const VariableId& variable,
                std::unique_ptr<AggregateFunctionCallExpr> function,
@@ -649,7 +707,6 @@ class AggregateArg : public ExprArg {
 
   Distinctness distinct() const { return distinct_; }
 
-  const AggregateFunctionCallExpr* aggregate_function() const;
   AggregateFunctionCallExpr* mutable_aggregate_function();
 
   int num_input_fields() const;
@@ -670,13 +727,6 @@ class AggregateArg : public ExprArg {
     return having_modifier_kind_;
   }
 
-  ResolvedFunctionCallBase::ErrorMode error_mode() const {
-    return error_mode_;
-  }
-
-  // The fields to be aggregated.
-  int input_field_list_size() const { return num_input_fields(); }
-  const ValueExpr* input_field(int i) const;
   ValueExpr* mutable_input_field(int i);
 
   // Additional literals or parameters to be passed to the aggregation
@@ -718,6 +768,26 @@ class AnalyticArg : public ExprArg {
                             EvaluationContext* context,
                             std::vector<Value>* values) const = 0;
 
+  // Can be nullptr.
+  const WindowFrameArg* window_frame() const { return window_frame_.get(); }
+
+  // Sets the number of leading order keys of the AnalyticOp that make up the
+  // window ordering of this function. By default, all of them do. This allows
+  // one AnalyticOp to evaluate functions whose window orderings are prefixes
+  // of each other.
+  void set_num_order_keys(int num_order_keys) {
+    num_order_keys_ = num_order_keys;
+  }
+
+  // Returns the keys among <order_keys>, the order keys of the AnalyticOp,
+  // that make up the window ordering of this function.
+  absl::Span<const KeyArg* const> GetOrderKeys(
+      absl::Span<const KeyArg* const> order_keys) const {
+    return num_order_keys_.has_value()
+               ? order_keys.subspan(0, num_order_keys_.value())
+               : order_keys;
+  }
+
  protected:
   // Takes ownership of <window_frame>.
   AnalyticArg(const VariableId& variable, const Type* type,
@@ -727,9 +797,14 @@ class AnalyticArg : public ExprArg {
         window_frame_(std::move(window_frame)),
         error_mode_(error_mode) {}
 
+  // Returns the suffix that DebugInternal() appends for
+  // set_num_order_keys(), if it was called.
+  std::string NumOrderKeysDebugString() const;
+
   // Can be nullptr.
   const std::unique_ptr<WindowFrameArg> window_frame_;
   const ResolvedFunctionCallBase::ErrorMode error_mode_;
+  absl::optional<int> num_order_keys_;
 };
 
 // Aggregate analytic expression argument.
@@ -761,6 +836,8 @@ class AggregateAnalyticArg : public AnalyticArg {
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
 
+  const AggregateArg* aggregator() const { return aggregator_.get(); }
+
  private:
   // 'window_frame' cannot be nullptr, because all aggregate functions must
   // support window framing.
@@ -945,6 +1022,96 @@ class HalfUnboundedColumnFilterArg : public ColumnFilterArg {
   std::unique_ptr<ValueExpr> arg_;
 };
 
+// Represents a ColumnFilter for the keys of the hash table of a JoinOp (see
+// JoinOp::AddBuildKeysParameter()). 'keys' is an array of the keys, or NULL if
+// there are too many of them, in which case the filter is the range from
+// 'min_key' to 'max_key' (each of which may be NULL if it is unknown).
+class BuildKeysColumnFilterArg : public ColumnFilterArg {
+ public:
+  BuildKeysColumnFilterArg(const BuildKeysColumnFilterArg&) = delete;
+  BuildKeysColumnFilterArg& operator=(const BuildKeysColumnFilterArg&) =
+      delete;
+
+  // 'variable' is the VariableId used for the column for debug
+  // logging. 'column_idx' is the index of the column in the scan (not the
+  // Table).
+  static ::zetasql_base::StatusOr<std::unique_ptr<BuildKeysColumnFilterArg>> Create(
+      const VariableId& variable, int column_idx,
+      std::unique_ptr<ValueExpr> keys, std::unique_ptr<ValueExpr> min_key,
+      std::unique_ptr<ValueExpr> max_key);
+
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  ::zetasql_base::StatusOr<std::unique_ptr<ColumnFilter>> Eval(
+      absl::Span<const TupleData* const> params,
+      EvaluationContext* context) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  BuildKeysColumnFilterArg(const VariableId& variable, int column_idx,
+                           std::unique_ptr<ValueExpr> keys,
+                           std::unique_ptr<ValueExpr> min_key,
+                           std::unique_ptr<ValueExpr> max_key);
+
+  const VariableId variable_;
+  std::unique_ptr<ValueExpr> keys_;
+  std::unique_ptr<ValueExpr> min_key_;
+  std::unique_ptr<ValueExpr> max_key_;
+};
+
+// An argument in the tree that generates a ColumnPredicate for an
+// EvaluatorTableScanOp. The values in the leaves are computed from the
+// parameters when the scan starts.
+class ColumnPredicateArg : public AlgebraArg {
+ public:
+  ColumnPredicateArg(const ColumnPredicateArg&) = delete;
+  ColumnPredicateArg& operator=(const ColumnPredicateArg&) = delete;
+
+  // Creates a kAnd or kOr predicate.
+  static ::zetasql_base::StatusOr<std::unique_ptr<ColumnPredicateArg>> CreateJunction(
+      ColumnPredicate::Kind kind,
+      std::vector<std::unique_ptr<ColumnPredicateArg>> children);
+
+  // Creates a predicate on a single column. 'variable' is the VariableId used
+  // for the column for debug logging. 'column_idx' is the index of the column
+  // in the scan (not the Table). 'args' has one element for comparisons and
+  // kStartsWith, none for kIsNull and kIsNotNull, and the elements of the list
+  // for kInList.
+  static ::zetasql_base::StatusOr<std::unique_ptr<ColumnPredicateArg>> CreateLeaf(
+      ColumnPredicate::Kind kind, const VariableId& variable, int column_idx,
+      std::vector<std::unique_ptr<ValueExpr>> args);
+
+  // Sets the TupleSchemas for the TupleDatas passed to Eval(). A particular
+  // VariableId can only occur in one TupleSchema.
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas);
+
+  // Returns a ColumnPredicate corresponding to the given parameters.
+  ::zetasql_base::StatusOr<std::unique_ptr<ColumnPredicate>> Eval(
+      absl::Span<const TupleData* const> params,
+      EvaluationContext* context) const;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  ColumnPredicateArg(ColumnPredicate::Kind kind, const VariableId& variable,
+                     int column_idx,
+                     std::vector<std::unique_ptr<ColumnPredicateArg>> children,
+                     std::vector<std::unique_ptr<ValueExpr>> args);
+
+  const ColumnPredicate::Kind kind_;
+  // Only valid for leaves.
+  const VariableId variable_;
+  const int column_idx_;
+  // Only non-empty for kAnd and kOr.
+  std::vector<std::unique_ptr<ColumnPredicateArg>> children_;
+  std::vector<std::unique_ptr<ValueExpr>> args_;
+};
+
 // Abstract base class for an operator.
 class AlgebraNode {
  public:
@@ -1133,9 +1300,19 @@ class RelationalOp : public AlgebraNode {
   // wraps it in a PassThroughTupleIterator to allow for cancellation while it
   // is running. This method is only public for internal purposes. Users should
   // call Eval() instead.
-  virtual ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  //
+  // If 'context' collects an EvaluationProfile, the iterator returned by
+  // CreateIteratorInternal() is wrapped to record the rows and time spent in
+  // this operator.
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
       absl::Span<const TupleData* const> params, int num_extra_slots,
-      EvaluationContext* context) const = 0;
+      EvaluationContext* context) const;
+
+  // Implements CreateIterator().
+  virtual ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>>
+  CreateIteratorInternal(absl::Span<const TupleData* const> params,
+                         int num_extra_slots,
+                         EvaluationContext* context) const = 0;
 
   // Returns a copy of the output schema of the TupleIterator corresponding to
   // this operator.
@@ -1170,6 +1347,12 @@ class RelationalOp : public AlgebraNode {
   zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> MaybeReorder(
       std::unique_ptr<TupleIterator> iter, EvaluationContext* context) const;
 
+  // Depending on the EvaluationOptions in 'context', either returns 'iter' or a
+  // BatchedTupleIterator that wraps 'iter'. Should only be called on iterators
+  // that natively implement TupleIterator::NextBatch().
+  std::unique_ptr<TupleIterator> MaybeBatch(std::unique_ptr<TupleIterator> iter,
+                                            EvaluationContext* context) const;
+
  private:
   // If false, the operator's output is never marked as ordered.
   bool is_order_preserving_ = false;
@@ -1196,6 +1379,57 @@ class EvaluatorTableScanOp : public RelationalOp {
       std::vector<std::unique_ptr<ColumnFilterArg>> and_filters,
       std::unique_ptr<ValueExpr> read_time);
 
+  // Pushes a conjunct of a filter on this scan into the Table, if the Table
+  // supports it (see Table::SupportsEvaluatorPredicatePushdown()). 'predicate'
+  // is the ColumnPredicate form of the conjunct and 'conjunct' is the conjunct
+  // itself, which is evaluated on each row from the Table (with the parameters
+  // followed by the output of this scan) unless the Table reports that it
+  // fully handled 'predicate'. Must be called before SetSchemasForEvaluation().
+  ::zetasql_base::Status AddPushedDownConjunct(
+      std::unique_ptr<ColumnPredicateArg> predicate,
+      std::unique_ptr<ValueExpr> conjunct);
+
+  // Adds 'filter' to the ColumnFilters passed to the EvaluatorTableIterator.
+  // Must be called before SetSchemasForEvaluation().
+  void AddColumnFilter(std::unique_ptr<ColumnFilterArg> filter) {
+    and_filters_.push_back(std::move(filter));
+  }
+
+  // Indicates that at most the first 'max_num_rows' rows of the scan are
+  // needed, which is passed to EvaluatorTableIterator::SetRowLimitHint(). The
+  // smallest of several hints wins.
+  void AddRowLimitHint(int64_t max_num_rows) {
+    if (row_limit_hint_ < 0 || max_num_rows < row_limit_hint_) {
+      row_limit_hint_ = max_num_rows;
+    }
+  }
+
+  // The maximum number of keys that the scan looks up with
+  // Table::CreateEvaluatorTableIteratorForKeys().
+  static constexpr int kMaxKeyLookups = 1000;
+
+  // Makes the scan look up its rows by key instead of scanning the whole
+  // table, if the table supports it (see Table::SupportsEvaluatorKeyLookups())
+  // and the ColumnFilters of the columns at 'key_column_idxs' (in this scan,
+  // not the Table; one per column of Table::PrimaryKey(), in order) are all
+  // kInList filters with at most kMaxKeyLookups combinations of values. The
+  // keys are all those combinations.
+  void SetKeyLookupColumns(std::vector<int> key_column_idxs) {
+    key_lookup_column_idxs_ = std::move(key_column_idxs);
+  }
+
+  // Makes the scan return a sample of about 'percent' percent of its rows, for
+  // TABLESAMPLE SYSTEM. The sample is pushed into the EvaluatorTableIterator
+  // (see EvaluatorTableIterator::SetBlockSample()), and rows are sampled with
+  // a SampleScanOp::kBernoulli sample if it does not support that. 'percent'
+  // must be an INT64 or DOUBLE. 'seed' is an INT64, or NULL if the sample is
+  // not repeatable. Must be called before SetSchemasForEvaluation().
+  void SetBlockSample(std::unique_ptr<ValueExpr> percent,
+                      std::unique_ptr<ValueExpr> seed) {
+    block_sample_percent_ = std::move(percent);
+    block_sample_seed_ = std::move(seed);
+  }
+
   // Returns a ColumnFilter corresponding to the intersection of 'filters'. This
   // method is only public for unit testing purposes.
   static ::zetasql_base::StatusOr<std::unique_ptr<ColumnFilter>> IntersectColumnFilters(
@@ -1204,7 +1438,7 @@ class EvaluatorTableScanOp : public RelationalOp {
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1233,6 +1467,19 @@ class EvaluatorTableScanOp : public RelationalOp {
   const std::vector<VariableId> variables_;
   std::vector<std::unique_ptr<ColumnFilterArg>> and_filters_;
   std::unique_ptr<ValueExpr> read_time_;
+  // Set by AddPushedDownConjunct(). The i-th element of
+  // 'pushed_down_conjuncts_' is the conjunct for the i-th element of
+  // 'pushed_down_predicates_'.
+  std::vector<std::unique_ptr<ColumnPredicateArg>> pushed_down_predicates_;
+  std::vector<std::unique_ptr<ValueExpr>> pushed_down_conjuncts_;
+  // Set by AddRowLimitHint(). Negative if there is no hint.
+  int64_t row_limit_hint_ = -1;
+  // Set by SetKeyLookupColumns().
+  std::vector<int> key_lookup_column_idxs_;
+  // Set by SetBlockSample(). 'block_sample_percent_' is NULL if the scan is
+  // not sampled.
+  std::unique_ptr<ValueExpr> block_sample_percent_;
+  std::unique_ptr<ValueExpr> block_sample_seed_;
 };
 
 // Evaluates some expressions and makes them available to 'body'. Each
@@ -1252,7 +1499,7 @@ class LetOp : public RelationalOp {
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1344,10 +1591,51 @@ class JoinOp : public RelationalOp {
       std::vector<std::unique_ptr<ExprArg>> left_outputs,
       std::vector<std::unique_ptr<ExprArg>> right_outputs);
 
+  // Makes the join merge its inputs instead of loading the right input into a
+  // hash table. Requires an inner or left outer join with at least
+  // 'num_merge_join_keys' HashJoinEqualityExprs, the first
+  // 'num_merge_join_keys' of which must each compare two expressions of the
+  // same type, and both inputs must be sorted on those expressions (in order)
+  // in ascending order with NULLs first. The join then only keeps the right
+  // tuples with the current key in memory. It still uses a hash join when
+  // evaluating on several threads or scrambling undefined orderings, since
+  // both change the order of the inputs.
+  ::zetasql_base::Status set_num_merge_join_keys(int num_merge_join_keys);
+  int num_merge_join_keys() const { return num_merge_join_keys_; }
+
+  // The maximum number of distinct keys in the array that
+  // AddBuildKeysParameter() publishes.
+  static constexpr int kMaxBuildKeysInList = 1000;
+
+  // Makes the join add a TupleData to the parameters of its left input, once
+  // the hash table is built, with the following variables for the right-hand
+  // side values of the 'equality_expr_idx'-th HashJoinEqualityExprs:
+  // 'keys' is an array of type 'keys_type' of the distinct non-NULL, non-NaN
+  // values (NULL if there are more than kMaxBuildKeysInList of them), and
+  // 'min_key' and 'max_key' are the smallest and largest of them. All three
+  // are NULL if the join does not build a hash table. Scans in the left input
+  // can use them to skip rows that cannot join, which requires an inner or
+  // right outer join (see BuildKeysColumnFilterArg). Must be called before
+  // SetSchemasForEvaluation().
+  ::zetasql_base::Status AddBuildKeysParameter(int equality_expr_idx,
+                                       const VariableId& keys,
+                                       const VariableId& min_key,
+                                       const VariableId& max_key,
+                                       const ArrayType* keys_type);
+
+  // A parameter of the left input added by AddBuildKeysParameter().
+  struct BuildKeysParameter {
+    int equality_expr_idx;
+    VariableId keys;
+    VariableId min_key;
+    VariableId max_key;
+    const ArrayType* keys_type;
+  };
+
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1402,13 +1690,31 @@ class JoinOp : public RelationalOp {
   absl::Span<const ExprArg* const> right_outputs() const;
   absl::Span<ExprArg* const> mutable_right_outputs();
 
+  // Returns the schema of the TupleData that the join adds to the parameters
+  // of its left input for AddBuildKeysParameter(), or NULL if it adds none.
+  std::unique_ptr<TupleSchema> CreateBuildKeysSchema() const;
+
   const JoinKind join_kind_;
+  int num_merge_join_keys_ = 0;
+  std::vector<BuildKeysParameter> build_keys_parameters_;
 };
 
 // Partitions the input using 'keys' and returns tuples constructed from
 // 'aggregators' evaluated on each partition.
+//
+// Aggregation can be split into two phases, e.g., to pre-aggregate shards of
+// the input in parallel. In kPartial mode, the aggregators produce the
+// serialized states of their accumulators (see
+// AggregateAccumulator::SerializeState()) instead of their final results. In
+// kFinal mode, the input must have a column for the variable of each
+// aggregator holding such a state, typically the output of a kPartial
+// AggregateOp with the same aggregators, and the states of each group are
+// merged before computing the final results. The input fields of the
+// aggregators are not evaluated in kFinal mode.
 class AggregateOp : public RelationalOp {
  public:
+  enum Mode { kComplete, kPartial, kFinal };
+
   AggregateOp(const AggregateOp&) = delete;
   AggregateOp& operator=(const AggregateOp&) = delete;
 
@@ -1416,16 +1722,19 @@ class AggregateOp : public RelationalOp {
       absl::string_view input_iter_debug_string);
 
   // Creates a validated AggregateOp that checks whether the keys can be
-  // compared for equality and that no collations are used.
+  // compared for equality and that no collations are used. Unless 'mode' is
+  // kComplete, all the aggregators must support partial aggregation.
   static zetasql_base::StatusOr<std::unique_ptr<AggregateOp>> Create(
       std::vector<std::unique_ptr<KeyArg>> keys,
       std::vector<std::unique_ptr<AggregateArg>> aggregators,
-      std::unique_ptr<RelationalOp> input);
+      std::unique_ptr<RelationalOp> input, Mode mode = kComplete);
+
+  Mode mode() const { return mode_; }
 
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1443,7 +1752,7 @@ class AggregateOp : public RelationalOp {
 
   AggregateOp(std::vector<std::unique_ptr<KeyArg>> keys,
               std::vector<std::unique_ptr<AggregateArg>> aggregators,
-              std::unique_ptr<RelationalOp> input);
+              std::unique_ptr<RelationalOp> input, Mode mode);
 
   absl::Span<const KeyArg* const> keys() const;
   absl::Span<KeyArg* const> mutable_keys();
@@ -1453,6 +1762,8 @@ class AggregateOp : public RelationalOp {
 
   const RelationalOp* input() const;
   RelationalOp* mutable_input();
+
+  const Mode mode_;
 };
 
 // Partitions the input by <partition_keys>, and evaluates a number of analytic
@@ -1483,7 +1794,7 @@ class AnalyticOp : public RelationalOp {
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1547,10 +1858,23 @@ class SortOp : public RelationalOp {
       std::unique_ptr<RelationalOp> input, bool is_order_preserving,
       bool is_stable_sort);
 
+  // Makes the iterator only return, for each distinct tuple of values of the
+  // first 'num_partition_keys' keys, the first 'partition_limit' tuples in
+  // sorted order, or, if 'with_ties' is true, every tuple that does not sort
+  // after the 'partition_limit'-th one. The tuples of each partition are kept
+  // in a TupleDataBoundedHeap while the input is consumed. These are the
+  // tuples whose ROW_NUMBER() (or RANK(), if 'with_ties' is true) is at most
+  // 'partition_limit' in an AnalyticOp over this SortOp, which computes the
+  // same ROW_NUMBER() and RANK() for them as for the whole input. Like
+  // 'limit', this is not safe to use for compliance or random query testing.
+  // Must not be used with 'limit'.
+  zetasql_base::Status SetPartitionLimit(int num_partition_keys,
+                                 int64_t partition_limit, bool with_ties);
+
   zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1589,9 +1913,16 @@ class SortOp : public RelationalOp {
   const RelationalOp* input() const;
   RelationalOp* mutable_input();
 
+  bool has_partition_limit() const { return partition_limit_ >= 0; }
+
   const bool has_limit_;
   const bool has_offset_;
   const bool is_stable_sort_;
+  // Set by SetPartitionLimit(). 'partition_limit_' is negative if there is no
+  // partition limit.
+  int num_partition_keys_ = 0;
+  int64_t partition_limit_ = -1;
+  bool partition_limit_with_ties_ = false;
 };
 
 // Scans (or unnests) an 'array' as a relation. Each output tuple contains an
@@ -1603,6 +1934,9 @@ class SortOp : public RelationalOp {
 // pairs (which are useful for scanning a table represented as an array of
 // structs in the compliance test framework). field_index refers to the field
 // number in the struct type inside the array type.
+//
+// An optional 'filter' (see set_filter()) drops the elements for which it is
+// not true, so that no FilterOp is needed on top of the scan.
 class ArrayScanOp : public RelationalOp {
  public:
   // When ArrayScanOp is used to represent a scan of a table represented by an
@@ -1632,10 +1966,32 @@ class ArrayScanOp : public RelationalOp {
       absl::Span<const std::pair<VariableId, int>> fields,
       std::unique_ptr<ValueExpr> array);
 
+  // Creates a scan of the array that GENERATE_ARRAY, GENERATE_DATE_ARRAY or
+  // GENERATE_TIMESTAMP_ARRAY (depending on the element type of 'array_type')
+  // returns for 'generator_arguments'. The elements are computed one at a
+  // time as they are read instead of materializing the array, so the scan
+  // takes constant memory and is not subject to the limits on the size of
+  // the array that the functions return.
+  static ::zetasql_base::StatusOr<std::unique_ptr<ArrayScanOp>>
+  CreateForGeneratedArray(
+      const VariableId& element, const VariableId& position,
+      const ArrayType* array_type,
+      std::vector<std::unique_ptr<ValueExpr>> generator_arguments);
+
+  // Sets a predicate on the output tuples (and the parameters) that an element
+  // must satisfy to be returned. Only the output variables in
+  // 'filter_variables' are populated before 'filter' is evaluated; the others
+  // are only populated for the elements that pass it. Must be called at most
+  // once, before SetSchemasForEvaluation().
+  ::zetasql_base::Status set_filter(std::unique_ptr<ValueExpr> filter,
+                            absl::Span<const VariableId> filter_variables);
+
+  bool has_filter() const { return GetArg(kFilter) != nullptr; }
+
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1650,20 +2006,75 @@ class ArrayScanOp : public RelationalOp {
                             bool verbose) const override;
 
  private:
-  enum ArgKind { kElement, kPosition, kField, kArray };
+  enum ArgKind {
+    kElement,
+    kPosition,
+    kField,
+    kArray,
+    kFilter,
+    kGeneratorArgument
+  };
 
   // 'fields' contains (variable, field_index) pairs given an 'array' of
-  // structs, and must be empty otherwise.
+  // structs, and must be empty otherwise. Exactly one of 'array' and
+  // 'generator_arguments' is non-empty.
   ArrayScanOp(const VariableId& element, const VariableId& position,
               absl::Span<const std::pair<VariableId, int>> fields,
-              std::unique_ptr<ValueExpr> array);
+              const ArrayType* array_type, std::unique_ptr<ValueExpr> array,
+              std::vector<std::unique_ptr<ValueExpr>> generator_arguments);
 
   const VariableId& element() const;  // May be empty, i.e., unused.
   const VariableId& position() const;  // May be empty, i.e., unused.
   absl::Span<const FieldArg* const> field_list() const;
 
-  const ValueExpr* array_expr() const;
+  const ValueExpr* array_expr() const;  // NULL for a generated array.
   ValueExpr* mutable_array_expr();
+
+  bool is_generated_array() const { return array_expr() == nullptr; }
+  absl::Span<const ExprArg* const> generator_arguments() const;
+  absl::Span<ExprArg* const> mutable_generator_arguments();
+
+  const ValueExpr* filter() const;  // May be NULL.
+  ValueExpr* mutable_filter();
+
+  const ArrayType* array_type_;
+  // Whether each slot of the output schema is read by 'filter'.
+  std::vector<bool> filter_slots_;
+};
+
+// Scans the WITH table that a MaterializeWithTableExpr stored under
+// 'with_table'. The i-th column of the table is bound to 'columns[i]'.
+class WithRefScanOp : public RelationalOp {
+ public:
+  WithRefScanOp(const WithRefScanOp&) = delete;
+  WithRefScanOp& operator=(const WithRefScanOp&) = delete;
+
+  static std::string GetIteratorDebugString(absl::string_view with_table);
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<WithRefScanOp>> Create(
+      const VariableId& with_table, std::vector<VariableId> columns);
+
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
+      absl::Span<const TupleData* const> params, int num_extra_slots,
+      EvaluationContext* context) const override;
+
+  // Returns a schema consisting of 'columns'.
+  std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
+
+  std::string IteratorDebugString() const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  WithRefScanOp(const VariableId& with_table, std::vector<VariableId> columns)
+      : with_table_(with_table), columns_(std::move(columns)) {}
+
+  const VariableId with_table_;
+  const std::vector<VariableId> columns_;
 };
 
 // Returns the union of N relations in 'inputs'. Each output tuple is
@@ -1687,7 +2098,7 @@ class UnionAllOp : public RelationalOp {
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1700,6 +2111,17 @@ class UnionAllOp : public RelationalOp {
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
 
+  // If true and EvaluationOptions::num_threads is greater than one, the inputs
+  // are evaluated concurrently, each with its own EvaluationContext (see
+  // EvaluationContext::CreateChildContext()), and the output interleaves their
+  // tuples. Otherwise the inputs are evaluated one after the other.
+  void set_evaluate_inputs_in_parallel(bool evaluate_inputs_in_parallel) {
+    evaluate_inputs_in_parallel_ = evaluate_inputs_in_parallel;
+  }
+  bool evaluate_inputs_in_parallel() const {
+    return evaluate_inputs_in_parallel_;
+  }
+
  private:
   explicit UnionAllOp(std::vector<Input> inputs);
 
@@ -1714,6 +2136,7 @@ class UnionAllOp : public RelationalOp {
   int num_variables() const;
 
   const int num_rel_;
+  bool evaluate_inputs_in_parallel_ = false;
 };
 
 // Augments the tuples from 'input' by 'map' slots computed for each tuple.
@@ -1733,7 +2156,7 @@ class ComputeOp : public RelationalOp {
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1775,7 +2198,7 @@ class FilterOp : public RelationalOp {
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1800,6 +2223,62 @@ class FilterOp : public RelationalOp {
   RelationalOp* mutable_input();
 };
 
+// Evaluates 'input' on EvaluationOptions::num_threads threads at once and
+// gathers the results in an unspecified order. 'partitioned_scan' must be an
+// EvaluatorTableScanOp in 'input' that is evaluated at most once per tuple of
+// 'input' (e.g., at the bottom of a chain of filters and projections). Each
+// thread evaluates 'input' with its own EvaluationContext, in which
+// 'partitioned_scan' only returns a disjoint subset of the rows of its table,
+// so together the threads return each tuple of 'input' exactly once.
+//
+// If 'num_threads' is one, this is equivalent to 'input'.
+class ExchangeOp : public RelationalOp {
+ public:
+  ExchangeOp(const ExchangeOp&) = delete;
+  ExchangeOp& operator=(const ExchangeOp&) = delete;
+
+  static std::string GetIteratorDebugString(
+      absl::string_view input_iter_debug_string);
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<ExchangeOp>> Create(
+      std::unique_ptr<RelationalOp> input,
+      const EvaluatorTableScanOp* partitioned_scan);
+
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
+      absl::Span<const TupleData* const> params, int num_extra_slots,
+      EvaluationContext* context) const override;
+
+  // Returns the schema of the input.
+  std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
+
+  std::string IteratorDebugString() const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+  // Evaluates the input on 'num_partitions' threads instead of
+  // EvaluationOptions::num_threads.
+  void set_num_partitions(int num_partitions) {
+    num_partitions_ = num_partitions;
+  }
+
+ private:
+  enum ArgKind { kInput };
+
+  ExchangeOp(std::unique_ptr<RelationalOp> input,
+             const EvaluatorTableScanOp* partitioned_scan);
+
+  const RelationalOp* input() const;
+  RelationalOp* mutable_input();
+
+  const EvaluatorTableScanOp* partitioned_scan_;
+  // 0 to use EvaluationOptions::num_threads.
+  int num_partitions_ = 0;
+};
+
 // Skips 'offset' tuples of 'input' and returns the next 'row_count' tuples.
 // Produces non-deterministic result if the order of the input is unspecified.
 class LimitOp : public RelationalOp {
@@ -1817,7 +2296,7 @@ class LimitOp : public RelationalOp {
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1848,6 +2327,77 @@ class LimitOp : public RelationalOp {
   RelationalOp* mutable_input();
 };
 
+// Returns a random sample of the tuples of 'input', in a single pass over it,
+// for TABLESAMPLE.
+//
+// With kBernoulli, 'size' is a percent (an INT64 or DOUBLE between 0 and 100)
+// and each tuple is returned independently with that probability. With
+// kReservoir, 'size' is a number of rows (a non-negative INT64), and that many
+// tuples (or all of them, if there are fewer) are chosen uniformly at random
+// with reservoir sampling for each partition of the input by
+// 'partition_keys', of which there may be none. Only kReservoir keeps tuples
+// in memory, at most 'size' of them per partition.
+//
+// 'repeatable' is an INT64 that seeds the random number generator, or NULL to
+// pick a random seed. If 'weight' is valid, the output has an extra DOUBLE
+// variable with the inverse of the probability that each returned tuple was
+// sampled.
+class SampleScanOp : public RelationalOp {
+ public:
+  enum Method { kBernoulli, kReservoir };
+
+  SampleScanOp(const SampleScanOp&) = delete;
+  SampleScanOp& operator=(const SampleScanOp&) = delete;
+
+  static std::string GetIteratorDebugString(
+      Method method, absl::string_view input_iter_debug_string);
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<SampleScanOp>> Create(
+      Method method, std::unique_ptr<ValueExpr> size,
+      std::unique_ptr<ValueExpr> repeatable,
+      std::vector<std::unique_ptr<ExprArg>> partition_keys,
+      const VariableId& weight, std::unique_ptr<RelationalOp> input);
+
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
+      absl::Span<const TupleData* const> params, int num_extra_slots,
+      EvaluationContext* context) const override;
+
+  // Returns the schema of the input, followed by 'weight' if it is valid.
+  std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
+
+  std::string IteratorDebugString() const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kSize, kRepeatable, kPartitionKey, kInput };
+
+  SampleScanOp(Method method, std::unique_ptr<ValueExpr> size,
+               std::unique_ptr<ValueExpr> repeatable,
+               std::vector<std::unique_ptr<ExprArg>> partition_keys,
+               const VariableId& weight, std::unique_ptr<RelationalOp> input);
+
+  const ValueExpr* size() const;
+  ValueExpr* mutable_size();
+
+  // May be NULL.
+  const ValueExpr* repeatable() const;
+  ValueExpr* mutable_repeatable();
+
+  absl::Span<const ExprArg* const> partition_keys() const;
+  absl::Span<ExprArg* const> mutable_partition_keys();
+
+  const RelationalOp* input() const;
+  RelationalOp* mutable_input();
+
+  const Method method_;
+  const VariableId weight_;
+};
+
 // Relation with no columns emitting N rows. N specified as an integer
 // expression. If N is negative, returns 0 rows. This operator is used to
 // represent a single-row relation (e.g., in SELECT 1) and N-row relations in
@@ -1866,7 +2416,7 @@ class EnumerateOp : public RelationalOp {
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1929,6 +2479,11 @@ class DerefExpr : public ValueExpr {
 
   const VariableId& name() const { return name_; }
 
+  // The location of the variable in the 'params' passed to Eval(). Only valid
+  // after SetSchemasForEvaluation().
+  int idx_in_params() const { return idx_in_params_; }
+  int slot() const { return slot_; }
+
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
@@ -1949,6 +2504,11 @@ class DerefExpr : public ValueExpr {
 };
 
 // Returns field 'field_name' (or 'field_index') from 'expr'.
+//
+// A FieldValueExpr created over another FieldValueExpr absorbs it, so a chain
+// such as $t.a.b is a single FieldValueExpr with a path of field indexes. When
+// the input is a DerefExpr, Eval() walks the path over the variable's slot
+// without copying the intermediate structs.
 class FieldValueExpr : public ValueExpr {
  public:
   FieldValueExpr(const FieldValueExpr&) = delete;
@@ -1973,16 +2533,17 @@ class FieldValueExpr : public ValueExpr {
  private:
   enum ArgKind { kStruct };
 
-  FieldValueExpr(int field_index, std::unique_ptr<ValueExpr> expr);
-
-  int field_index() const { return field_index_; }
-  std::string field_name() const { return field_name_; }
+  FieldValueExpr(std::vector<int> field_path, const Type* output_type,
+                 std::unique_ptr<ValueExpr> expr);
 
   const ValueExpr* input() const;
   ValueExpr* mutable_input();
 
-  std::string field_name_;
-  int field_index_;
+  // The indexes of the fields accessed from the value of 'input()', outermost
+  // struct first.
+  std::vector<int> field_path_;
+  // Set when 'input()' is a DerefExpr.
+  const DerefExpr* deref_input_ = nullptr;
 };
 
 // Class that actually reads fields from a proto, as specified by a
@@ -2004,7 +2565,9 @@ class ProtoFieldReader {
   // Populates 'field_value' with the appropriate field value from
   // 'proto_slot', which must have a proto Value. If the field values
   // (corresponding to 'registry_') have not been stored in the
-  // ProtoFieldValueList in 'proto_slot', reads all of them. If
+  // ProtoFieldValueList in 'proto_slot', reads all of them, or, if 'registry_'
+  // has deferred fields, all of the eager or all of the deferred ones,
+  // depending on the field of this reader. If
   // EvaluationOptions::store_proto_field_value_maps is true, also stores
   // them in 'proto_slot'. On failure, returns false and populates
   // 'status'. (This method does not return ::zetasql_base::StatusOr<Value> for
@@ -2018,6 +2581,9 @@ class ProtoFieldReader {
 
   int registry_id() const { return registry_->id(); }
 
+  // Returns the index of 'access_info()' in the registry.
+  int access_info_registry_id() const { return access_info_registry_id_; }
+
  private:
   const int id_;
   const ProtoFieldAccessInfo access_info_;
@@ -2155,6 +2721,51 @@ class ArrayNestExpr : public ValueExpr {
   const bool is_with_table_;
 };
 
+// Materializes the 'columns' of 'input', the subquery of a WITH table, into a
+// SharedTupleBuffer that is stored under 'with_table' in the
+// EvaluationContext, where WithRefScanOps read it. Returns the number of rows
+// as an INT64. Meant to be assigned to 'with_table' by a LetOp or LetExpr, so
+// that the table is materialized once per evaluation of the statement and
+// only in the format used by the scans. The rows are charged to the
+// MemoryAccountant until the EvaluationContext is reset, and are spilled to
+// disk if they do not fit and EvaluationOptions::spill_directory is set.
+class MaterializeWithTableExpr : public ValueExpr {
+ public:
+  MaterializeWithTableExpr(const MaterializeWithTableExpr&) = delete;
+  MaterializeWithTableExpr& operator=(const MaterializeWithTableExpr&) =
+      delete;
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<MaterializeWithTableExpr>> Create(
+      const VariableId& with_table, std::vector<VariableId> columns,
+      std::unique_ptr<RelationalOp> input);
+
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  bool Eval(absl::Span<const TupleData* const> params,
+            EvaluationContext* context, VirtualTupleSlot* result,
+            ::zetasql_base::Status* status) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kInput };
+
+  MaterializeWithTableExpr(const VariableId& with_table,
+                           std::vector<VariableId> columns,
+                           std::unique_ptr<RelationalOp> input);
+
+  const RelationalOp* input() const;
+  RelationalOp* mutable_input();
+
+  const VariableId with_table_;
+  const std::vector<VariableId> columns_;
+  // The slot of each element of 'columns_' in the tuples of 'input'. Set by
+  // SetSchemasForEvaluation().
+  std::vector<int> column_slot_idxs_;
+};
+
 // Constructs a struct of the given 'type' and 'args'. Number and order of
 // fields must match the type definition.
 class NewStructExpr : public ValueExpr {
@@ -2247,6 +2858,129 @@ class ConstExpr : public ValueExpr {
   TupleSlot slot_;
 };
 
+// Evaluates 'expr' the first time it is evaluated with an EvaluationContext,
+// and returns the same value on later evaluations with that context. 'expr'
+// must not depend on any variables other than parameters and system
+// variables, and must be deterministic for the duration of a statement.
+// Errors are not cached, so 'expr' fails every time it is evaluated if it
+// fails. The algebrizer uses this for subexpressions like UPPER(@p) that would
+// otherwise be evaluated once per row.
+class CachedExpr : public ValueExpr {
+ public:
+  CachedExpr(const CachedExpr&) = delete;
+  CachedExpr& operator=(const CachedExpr&) = delete;
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<CachedExpr>> Create(
+      std::unique_ptr<ValueExpr> expr);
+
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  bool Eval(absl::Span<const TupleData* const> params,
+            EvaluationContext* context, VirtualTupleSlot* result,
+            ::zetasql_base::Status* status) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kExpr };
+
+  explicit CachedExpr(std::unique_ptr<ValueExpr> expr);
+
+  const ValueExpr* expr() const;
+  ValueExpr* mutable_expr();
+};
+
+// Evaluates 'subquery' once per distinct tuple of values of 'keys' per
+// EvaluationContext (as long as the results fit in
+// EvaluationOptions::max_memoized_subquery_byte_size), and returns the memoized
+// result for later evaluations with the same values. 'subquery' must be
+// deterministic and must not depend on any variables other than 'keys',
+// parameters and system variables. 'keys' must have simple types other than
+// FLOAT and DOUBLE, so that equal values are indistinguishable. The algebrizer
+// uses this for correlated subqueries, with their correlated columns as
+// 'keys'.
+class MemoizedSubqueryExpr : public ValueExpr {
+ public:
+  MemoizedSubqueryExpr(const MemoizedSubqueryExpr&) = delete;
+  MemoizedSubqueryExpr& operator=(const MemoizedSubqueryExpr&) = delete;
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<MemoizedSubqueryExpr>> Create(
+      std::vector<std::unique_ptr<ValueExpr>> keys,
+      std::unique_ptr<ValueExpr> subquery);
+
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  bool Eval(absl::Span<const TupleData* const> params,
+            EvaluationContext* context, VirtualTupleSlot* result,
+            ::zetasql_base::Status* status) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kKey, kSubquery };
+
+  MemoizedSubqueryExpr(std::vector<std::unique_ptr<ValueExpr>> keys,
+                       std::unique_ptr<ValueExpr> subquery);
+
+  absl::Span<const ExprArg* const> keys() const;
+  absl::Span<ExprArg* const> mutable_keys();
+
+  const ValueExpr* subquery() const;
+  ValueExpr* mutable_subquery();
+};
+
+// Evaluates '<value> IN <elements>' by looking 'value' up in an InListSet of
+// the elements, which is built once per EvaluationContext (see
+// EvaluationContext::GetInListSet()). For kList, each of 'elements' is an
+// element of the list. For kArray (IN UNNEST), 'elements' has a single array
+// whose elements are the list. 'elements' must not depend on any variables
+// other than parameters and system variables, and 'value' must have a type
+// for which InListSet::SupportsType() is true.
+class InListExpr : public ValueExpr {
+ public:
+  enum Kind { kList, kArray };
+
+  InListExpr(const InListExpr&) = delete;
+  InListExpr& operator=(const InListExpr&) = delete;
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<InListExpr>> Create(
+      Kind kind, std::unique_ptr<ValueExpr> value,
+      std::vector<std::unique_ptr<ValueExpr>> elements);
+
+  ::zetasql_base::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  bool Eval(absl::Span<const TupleData* const> params,
+            EvaluationContext* context, VirtualTupleSlot* result,
+            ::zetasql_base::Status* status) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kValue, kElement };
+
+  InListExpr(Kind kind, std::unique_ptr<ValueExpr> value,
+             std::vector<std::unique_ptr<ValueExpr>> elements);
+
+  // Returns the set of the elements for 'context', building it if necessary.
+  ::zetasql_base::StatusOr<const InListSet*> GetSet(
+      absl::Span<const TupleData* const> params,
+      EvaluationContext* context) const;
+
+  const ValueExpr* value() const;
+  ValueExpr* mutable_value();
+
+  absl::Span<const ExprArg* const> elements() const;
+  absl::Span<ExprArg* const> mutable_elements();
+
+  const Kind kind_;
+};
+
 // Produces a single value from the variable ranging over the given 'input'
 // relation, or NULL if the 'input' is empty. Sets an error if the 'input' has
 // more than one element.
@@ -2351,6 +3085,16 @@ class ScalarFunctionBody : public FunctionBody {
   // returning ::zetasql_base::StatusOr<Value> for performance reasons.
   virtual bool Eval(absl::Span<const Value> args, EvaluationContext* context,
                     Value* result, ::zetasql_base::Status* status) const = 0;
+
+  // Evaluates the function for 'results.size()' rows at once. 'args' holds the
+  // arguments of each row in turn, so it has a multiple of 'results.size()'
+  // elements. On success, populates 'results' and returns true. On failure,
+  // populates 'status' and returns false. The default implementation calls
+  // Eval() for each row. Functions that can share work across rows, like the
+  // hash functions, override it.
+  virtual bool EvalBatch(absl::Span<const Value> args,
+                         EvaluationContext* context, absl::Span<Value> results,
+                         ::zetasql_base::Status* status) const;
 };
 
 // Accumulator interface for aggregating a bunch of values.
@@ -2387,6 +3131,24 @@ class AggregateAccumulator {
   // only important if we are doing compliance or random query testing.
   virtual ::zetasql_base::StatusOr<Value> GetFinalResult(
       bool inputs_in_defined_order) = 0;
+
+  // Returns the partial state of the accumulation, an opaque BYTES value (see
+  // aggregate_state.h) that Merge() can fold into another accumulator of the
+  // same aggregate function. Only supported if
+  // AggregateFunctionBody::SupportsPartialAggregation() returns true; the
+  // default implementation returns an error.
+  virtual ::zetasql_base::StatusOr<Value> SerializeState();
+
+  // Merges a state returned by SerializeState() into this accumulation, as if
+  // the values accumulated by the other accumulator had been accumulated here.
+  // A NULL 'state' is ignored. The default implementation returns an error.
+  virtual ::zetasql_base::Status Merge(const Value& state);
+
+  // Resets the accumulation to 'state'.
+  ::zetasql_base::Status DeserializeState(const Value& state) {
+    ZETASQL_RETURN_IF_ERROR(Reset());
+    return Merge(state);
+  }
 };
 
 // Defines an executable aggregate function.
@@ -2411,6 +3173,10 @@ class AggregateFunctionBody : public FunctionBody {
   const int num_input_fields() const { return num_input_fields_; }
   const Type* input_type() const { return input_type_; }
 
+  // Returns true if the accumulators of this function implement
+  // AggregateAccumulator::SerializeState() and Merge().
+  virtual bool SupportsPartialAggregation() const { return false; }
+
   // 'args' contains the constant arguments for the aggregation
   // function (e.g., the delimeter for STRING_AGG).
   virtual ::zetasql_base::StatusOr<std::unique_ptr<AggregateAccumulator>>
@@ -2439,9 +3205,21 @@ class ScalarFunctionCallExpr : public ValueExpr {
             EvaluationContext* context, VirtualTupleSlot* result,
             ::zetasql_base::Status* status) const override;
 
+  // Evaluates the function call for each row of 'batch' and stores the
+  // results in slot 'slot_idx' of the rows. The arguments of each row are
+  // evaluated with the row appended to 'params', like Eval() is called by
+  // ComputeOp, and the function is then called once for the whole batch
+  // through ScalarFunctionBody::EvalBatch().
+  bool EvalBatch(absl::Span<const TupleData* const> params, int slot_idx,
+                 EvaluationContext* context, TupleBatch* batch,
+                 ::zetasql_base::Status* status) const;
+
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
 
+  const ScalarFunctionBody* function() const { return function_.get(); }
+  ResolvedFunctionCallBase::ErrorMode error_mode() const { return error_mode_; }
+
  private:
   enum ArgKind { kArgument };
 
@@ -2452,8 +3230,6 @@ class ScalarFunctionCallExpr : public ValueExpr {
   ScalarFunctionCallExpr(const ScalarFunctionCallExpr&) = delete;
   ScalarFunctionCallExpr& operator=(const ScalarFunctionCallExpr&) = delete;
 
-  const ScalarFunctionBody* function() const { return function_.get(); }
-
   std::unique_ptr<const ScalarFunctionBody> function_;
   const ResolvedFunctionCallBase::ErrorMode error_mode_;
 };
@@ -2806,6 +3582,17 @@ class DMLValueExpr : public ValueExpr {
   ::zetasql_base::StatusOr<Value> GetColumnValue(const ResolvedColumn& column,
                                          const Tuple& t) const;
 
+  // Evaluates 'where_expr' on 'params' followed by each of 'tuples', and sets
+  // (*matches)[i] to whether the result for 'tuples[i]' was TRUE. If
+  // EvaluationOptions::num_threads is greater than one and there are enough
+  // tuples, disjoint ranges of 'tuples' are evaluated on different threads,
+  // each with its own child of 'context', and the first error stops the other
+  // ranges.
+  ::zetasql_base::Status EvalWhereClause(
+      const ValueExpr& where_expr, absl::Span<const TupleData* const> params,
+      const std::vector<std::unique_ptr<TupleData>>& tuples,
+      EvaluationContext* context, std::vector<uint8_t>* matches) const;
+
   // Populates 'row_map' according to 'original_rows'. If the table does not
   // have a primary key, uses the row number instead. Also sets
   // 'has_primary_key' to true if the table has a primary key. If a duplicate
@@ -3372,7 +4159,7 @@ class RootOp : public RelationalOp {
   ::zetasql_base::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -0,0 +1,98 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "zetasql/public/evaluator_executor.h"
+
+namespace zetasql {
+
+void ParallelFor(int num_threads, int64_t num_shards,
+                 const std::function<void(int64_t)>& fn) {
+  const int64_t num_workers =
+      std::min<int64_t>(std::max(num_threads, 1), num_shards);
+  if (num_workers <= 1) {
+    for (int64_t shard = 0; shard < num_shards; ++shard) {
+      fn(shard);
+    }
+    return;
+  }
+
+  std::atomic<int64_t> next_shard(0);
+  auto worker = [&next_shard, num_shards, &fn]() {
+    while (true) {
+      const int64_t shard = next_shard.fetch_add(1, std::memory_order_relaxed);
+      if (shard >= num_shards) return;
+      fn(shard);
+    }
+  };
+
+  EvaluatorExecutor::TaskGroup* group = EvaluatorExecutor::TaskGroup::Current();
+  if (group != nullptr) {
+    // The calling thread claims shards too, so the shards all run even if the
+    // executor rejects the tasks or does not start them. Tasks that have not
+    // started by the time the calling thread runs out of shards would find
+    // none left, so they are cancelled.
+    std::vector<std::shared_ptr<EvaluatorExecutor::Task>> tasks;
+    tasks.reserve(num_workers - 1);
+    for (int64_t i = 1; i < num_workers; ++i) {
+      std::shared_ptr<EvaluatorExecutor::Task> task = group->Schedule(worker);
+      if (task == nullptr) break;
+      tasks.push_back(std::move(task));
+    }
+    worker();
+    for (const std::shared_ptr<EvaluatorExecutor::Task>& task : tasks) {
+      if (!group->Cancel(task.get())) group->Wait(task.get());
+    }
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_workers - 1);
+  for (int64_t i = 1; i < num_workers; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+void ParallelForRanges(int num_threads, int64_t size, int64_t min_range_size,
+                       const std::function<void(int64_t, int64_t)>& fn) {
+  if (size <= 0) return;
+  min_range_size = std::max<int64_t>(min_range_size, 1);
+  // Use a few ranges per thread so that a slow range does not hold up the
+  // others for long.
+  const int64_t max_num_ranges =
+      static_cast<int64_t>(std::max(num_threads, 1)) * 4;
+  const int64_t num_ranges = std::max<int64_t>(
+      1, std::min(max_num_ranges, size / min_range_size));
+  const int64_t range_size = (size + num_ranges - 1) / num_ranges;
+  ParallelFor(num_threads, num_ranges, [&fn, size, range_size](int64_t range) {
+    const int64_t begin = range * range_size;
+    const int64_t end = std::min(size, begin + range_size);
+    if (begin < end) fn(begin, end);
+  });
+}
+
+}  // namespace zetasql
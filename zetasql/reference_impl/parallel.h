@@ -0,0 +1,50 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Helpers for the (few) parts of the reference implementation that run on
+// multiple threads.
+
+#ifndef ZETASQL_REFERENCE_IMPL_PARALLEL_H_
+#define ZETASQL_REFERENCE_IMPL_PARALLEL_H_
+
+#include <functional>
+
+#include <cstdint>
+
+namespace zetasql {
+
+// Calls 'fn(shard)' for every shard in [0, 'num_shards'), using up to
+// 'num_threads' threads (including the calling thread), and returns when all
+// the calls have finished. Shards are handed out dynamically, so 'num_shards'
+// may exceed 'num_threads' to balance uneven work. 'fn' must be thread-safe
+// for distinct shards. If 'num_threads' <= 1, runs everything on the calling
+// thread in increasing shard order. If EvaluatorExecutor::TaskGroup::Current()
+// is set, the other threads are those of its executor instead of new ones.
+//
+// Note that EvaluationContext is not thread-safe, so 'fn' generally must not
+// evaluate ValueExprs.
+void ParallelFor(int num_threads, int64_t num_shards,
+                 const std::function<void(int64_t)>& fn);
+
+// Calls 'fn(begin, end)' on disjoint ranges that cover [0, 'size'), each
+// containing at least 'min_range_size' elements (except possibly the last),
+// using ParallelFor() with 'num_threads' threads.
+void ParallelForRanges(int num_threads, int64_t size, int64_t min_range_size,
+                       const std::function<void(int64_t, int64_t)>& fn);
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_PARALLEL_H_
@@ -0,0 +1,101 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/parallel.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/public/evaluator_executor.h"
+
+namespace zetasql {
+namespace {
+
+using testing::Each;
+using testing::ElementsAre;
+
+TEST(ParallelForTest, SingleThreadRunsInOrder) {
+  std::vector<int64_t> shards;
+  ParallelFor(/*num_threads=*/1, /*num_shards=*/4,
+              [&shards](int64_t shard) { shards.push_back(shard); });
+  EXPECT_THAT(shards, ElementsAre(0, 1, 2, 3));
+}
+
+TEST(ParallelForTest, EachShardRunsOnce) {
+  for (const int num_threads : {1, 2, 4, 16}) {
+    std::vector<std::atomic<int>> counts(100);
+    ParallelFor(num_threads, counts.size(),
+                [&counts](int64_t shard) { ++counts[shard]; });
+    for (const std::atomic<int>& count : counts) {
+      EXPECT_EQ(count.load(), 1) << num_threads;
+    }
+  }
+}
+
+TEST(ParallelForTest, EachShardRunsOnceOnExecutor) {
+  // With no queue, the executor rejects every task and the caller runs all
+  // the shards.
+  for (const int64_t max_queued_tasks : {0, 100}) {
+    EvaluatorExecutor::Options options;
+    options.num_threads = 3;
+    options.max_queued_tasks = max_queued_tasks;
+    EvaluatorExecutor executor(options);
+    std::unique_ptr<EvaluatorExecutor::TaskGroup> group =
+        executor.CreateTaskGroup(/*weight=*/1, /*max_parallelism=*/0);
+    EvaluatorExecutor::ScopedTaskGroup scoped_group(group.get());
+    std::vector<std::atomic<int>> counts(100);
+    ParallelFor(/*num_threads=*/4, counts.size(),
+                [&counts](int64_t shard) { ++counts[shard]; });
+    for (const std::atomic<int>& count : counts) {
+      EXPECT_EQ(count.load(), 1) << max_queued_tasks;
+    }
+    if (max_queued_tasks == 0) {
+      EXPECT_EQ(group->GetMetrics().num_scheduled_tasks, 0);
+      EXPECT_GT(group->GetMetrics().num_rejected_tasks, 0);
+    }
+  }
+}
+
+TEST(ParallelForTest, NoShards) {
+  ParallelFor(/*num_threads=*/4, /*num_shards=*/0,
+              [](int64_t shard) { FAIL() << shard; });
+}
+
+TEST(ParallelForRangesTest, RangesCoverInput) {
+  for (const int num_threads : {1, 3, 8}) {
+    for (const int64_t size : {0, 1, 10, 1000, 1001}) {
+      std::vector<int> covered(size);
+      std::atomic<int64_t> num_small_ranges(0);
+      ParallelForRanges(num_threads, size, /*min_range_size=*/64,
+                        [&](int64_t begin, int64_t end) {
+                          if (end - begin < 64 && end != size) {
+                            ++num_small_ranges;
+                          }
+                          for (int64_t i = begin; i < end; ++i) {
+                            ++covered[i];
+                          }
+                        });
+      EXPECT_THAT(covered, Each(1)) << num_threads << " " << size;
+      EXPECT_EQ(num_small_ranges.load(), 0) << num_threads << " " << size;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -0,0 +1,125 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/profile.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/evaluator_profile.pb.h"
+#include "zetasql/reference_impl/operator.h"
+#include "absl/strings/string_view.h"
+#include "zetasql/base/map_util.h"
+
+namespace zetasql {
+
+namespace {
+
+// Appends the RelationalOps that 'node' reads from to 'inputs', looking
+// through the ValueExprs (e.g., subqueries) between them.
+void CollectInputs(const AlgebraNode* node,
+                   std::vector<const RelationalOp*>* inputs) {
+  for (const AlgebraArg* arg : node->GetArgs()) {
+    if (arg == nullptr || !arg->has_node()) continue;
+    const RelationalOp* op = arg->relational_op();
+    if (op != nullptr) {
+      inputs->push_back(op);
+    } else {
+      CollectInputs(arg->node(), inputs);
+    }
+  }
+}
+
+// Returns the class name that starts the debug string of 'op'.
+std::string GetOperatorName(const RelationalOp* op) {
+  const std::string debug_string = op->DebugInternal("", /*verbose=*/false);
+  return std::string(
+      absl::string_view(debug_string).substr(0, debug_string.find('(')));
+}
+
+}  // namespace
+
+void OperatorProfile::Merge(const OperatorProfile& other) {
+  num_iterators += other.num_iterators;
+  num_output_rows += other.num_output_rows;
+  total_time += other.total_time;
+  peak_memory_bytes = std::max(peak_memory_bytes, other.peak_memory_bytes);
+  peak_hash_table_size =
+      std::max(peak_hash_table_size, other.peak_hash_table_size);
+  num_function_calls += other.num_function_calls;
+  num_subquery_cache_hits += other.num_subquery_cache_hits;
+  num_subquery_cache_misses += other.num_subquery_cache_misses;
+  table_stall_time += other.table_stall_time;
+  allocations.allocated_bytes += other.allocations.allocated_bytes;
+  allocations.freed_bytes += other.allocations.freed_bytes;
+  allocations.peak_bytes =
+      std::max(allocations.peak_bytes, other.allocations.peak_bytes);
+}
+
+const OperatorProfile* EvaluationProfile::GetOperatorProfile(
+    const RelationalOp* op) const {
+  return zetasql_base::FindOrNull(operator_profiles_, op);
+}
+
+void EvaluationProfile::Merge(const EvaluationProfile& other) {
+  for (const auto& entry : other.operator_profiles_) {
+    operator_profiles_[entry.first].Merge(entry.second);
+  }
+}
+
+void EvaluationProfile::Serialize(const RelationalOp* root,
+                                  OperatorProfileProto* proto) const {
+  const OperatorProfile empty_profile;
+  const OperatorProfile* profile = GetOperatorProfile(root);
+  if (profile == nullptr) profile = &empty_profile;
+
+  proto->set_name(GetOperatorName(root));
+  proto->set_num_iterators(profile->num_iterators);
+  proto->set_num_output_rows(profile->num_output_rows);
+  proto->set_peak_memory_bytes(profile->peak_memory_bytes);
+  proto->set_peak_hash_table_size(profile->peak_hash_table_size);
+  proto->set_num_function_calls(profile->num_function_calls);
+  proto->set_num_subquery_cache_hits(profile->num_subquery_cache_hits);
+  proto->set_num_subquery_cache_misses(profile->num_subquery_cache_misses);
+  proto->set_table_stall_time_nanos(
+      absl::ToInt64Nanoseconds(profile->table_stall_time));
+  proto->set_allocated_bytes(profile->allocations.allocated_bytes);
+  proto->set_freed_bytes(profile->allocations.freed_bytes);
+  proto->set_peak_allocated_bytes(profile->allocations.peak_bytes);
+
+  std::vector<const RelationalOp*> inputs;
+  CollectInputs(root, &inputs);
+  int64_t num_input_rows = 0;
+  int64_t input_time_nanos = 0;
+  for (const RelationalOp* input : inputs) {
+    OperatorProfileProto* input_proto = proto->add_inputs();
+    Serialize(input, input_proto);
+    num_input_rows += input_proto->num_output_rows();
+    input_time_nanos += input_proto->total_time_nanos();
+  }
+
+  const int64_t total_time_nanos =
+      absl::ToInt64Nanoseconds(profile->total_time);
+  proto->set_num_input_rows(num_input_rows);
+  proto->set_total_time_nanos(total_time_nanos);
+  // Inputs evaluated on other threads by an ExchangeOp can take longer in total
+  // than the operator reading them.
+  proto->set_self_time_nanos(
+      std::max<int64_t>(0, total_time_nanos - input_time_nanos));
+}
+
+}  // namespace zetasql
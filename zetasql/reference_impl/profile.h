@@ -0,0 +1,95 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Per-operator runtime statistics collected when
+// EvaluationOptions::collect_profile is true.
+
+#ifndef ZETASQL_REFERENCE_IMPL_PROFILE_H_
+#define ZETASQL_REFERENCE_IMPL_PROFILE_H_
+
+#include <cstdint>
+#include "zetasql/common/internal_value.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/time/time.h"
+
+namespace zetasql {
+
+class OperatorProfileProto;
+class RelationalOp;
+
+// The statistics of one RelationalOp, summed over all of its iterators.
+struct OperatorProfile {
+  // The number of calls to RelationalOp::CreateIterator().
+  int64_t num_iterators = 0;
+  // The number of tuples returned by those iterators.
+  int64_t num_output_rows = 0;
+  // The time spent creating the iterators and in their Next() and NextBatch()
+  // methods, including the time spent in the iterators of the inputs.
+  absl::Duration total_time = absl::ZeroDuration();
+  // The largest MemoryAccountant usage observed at the end of a call to one of
+  // those methods.
+  int64_t peak_memory_bytes = 0;
+  // See EvaluationContext::RecordHashTableSize().
+  int64_t peak_hash_table_size = 0;
+  // See EvaluationContext::RecordFunctionCalls().
+  int64_t num_function_calls = 0;
+  // See EvaluationContext::RecordSubqueryCacheLookup().
+  int64_t num_subquery_cache_hits = 0;
+  int64_t num_subquery_cache_misses = 0;
+  // See EvaluationContext::RecordTableStallTime().
+  absl::Duration table_stall_time = absl::ZeroDuration();
+  // The Value payload bytes allocated and freed while the operator was
+  // running, not counting its inputs. Only collected if
+  // EvaluationOptions::track_allocations is true. See
+  // InternalValue::ScopedAllocationCounter.
+  InternalValue::AllocationCounter allocations;
+
+  // Adds 'other', which describes the same operator, to this profile.
+  void Merge(const OperatorProfile& other);
+};
+
+// Maps each RelationalOp that was evaluated to its OperatorProfile. Not
+// thread-safe; every EvaluationContext has its own.
+class EvaluationProfile {
+ public:
+  EvaluationProfile() {}
+  EvaluationProfile(const EvaluationProfile&) = delete;
+  EvaluationProfile& operator=(const EvaluationProfile&) = delete;
+
+  // The returned pointer remains valid for the lifetime of this object.
+  OperatorProfile* GetMutableOperatorProfile(const RelationalOp* op) {
+    return &operator_profiles_[op];
+  }
+
+  // Returns nullptr if 'op' has not been evaluated.
+  const OperatorProfile* GetOperatorProfile(const RelationalOp* op) const;
+
+  // Adds the profiles in 'other' to this one.
+  void Merge(const EvaluationProfile& other);
+
+  // Populates 'proto' with the profile of 'root' and, recursively, of the
+  // RelationalOps it reads from. Operators that were never evaluated are
+  // reported with zero counts.
+  void Serialize(const RelationalOp* root, OperatorProfileProto* proto) const;
+
+ private:
+  // node_hash_map for pointer stability.
+  absl::node_hash_map<const RelationalOp*, OperatorProfile> operator_profiles_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_PROFILE_H_
@@ -34,6 +34,7 @@
 #include <cstdint>
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status.h"
@@ -261,9 +262,14 @@ static zetasql_base::Status WriteScalarValue(
       dst->WriteString(v.bytes_value());
       break;
     case PAIR(FieldDescriptor::TYPE_MESSAGE, TYPE_PROTO):
-    case PAIR(FieldDescriptor::TYPE_GROUP, TYPE_PROTO):
-      dst->WriteString(std::string(v.ToCord()));
+    case PAIR(FieldDescriptor::TYPE_GROUP, TYPE_PROTO): {
+      // Write the chunks of the serialized message without flattening them.
+      const absl::Cord bytes = v.ToCord();
+      for (absl::string_view chunk : bytes.Chunks()) {
+        dst->WriteRaw(chunk.data(), chunk.size());
+      }
       break;
+    }
 
     default:
       return ::zetasql_base::OutOfRangeErrorBuilder()
@@ -18,9 +18,15 @@
 // warrant their own files.
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <limits>
 #include <map>
 #include <memory>
+#include <random>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -28,13 +34,18 @@
 #include "zetasql/base/logging.h"
 #include "zetasql/common/internal_value.h"
 #include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator_executor.h"
 #include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/functions/generate_array.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
 #include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/function.h"
+#include "zetasql/reference_impl/in_list_set.h"
 #include "zetasql/reference_impl/operator.h"
+#include "zetasql/reference_impl/parallel.h"
+#include "zetasql/reference_impl/spill.h"
 #include "zetasql/reference_impl/tuple.h"
 #include "zetasql/reference_impl/tuple_comparator.h"
 #include "zetasql/reference_impl/variable_id.h"
@@ -42,11 +53,15 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
+#include "absl/hash/hash.h"
 #include "absl/memory/memory.h"
+#include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/ret_check.h"
@@ -103,6 +118,110 @@ zetasql_base::Status RelationalOp::set_is_order_preserving(bool is_order_preserv
   return iter;
 }
 
+namespace {
+
+// Makes an OperatorProfile current on an EvaluationContext for its lifetime,
+// and charges it the elapsed time and the memory in use at the end. If
+// EvaluationOptions::track_allocations is set, also charges it the Value
+// payloads allocated and freed on this thread in the meantime.
+class OperatorProfileScope {
+ public:
+  OperatorProfileScope(OperatorProfile* profile, EvaluationContext* context)
+      : profile_(profile),
+        context_(context),
+        saved_profile_(context->current_operator_profile()),
+        start_time_(absl::Now()) {
+    context_->set_current_operator_profile(profile_);
+    if (context_->options().track_allocations) {
+      allocation_counter_.emplace(&profile_->allocations);
+    }
+  }
+
+  OperatorProfileScope(const OperatorProfileScope&) = delete;
+  OperatorProfileScope& operator=(const OperatorProfileScope&) = delete;
+
+  ~OperatorProfileScope() {
+    profile_->total_time += absl::Now() - start_time_;
+    const MemoryAccountant* accountant = context_->memory_accountant();
+    profile_->peak_memory_bytes =
+        std::max(profile_->peak_memory_bytes,
+                 accountant->total_num_bytes() - accountant->remaining_bytes());
+    context_->set_current_operator_profile(saved_profile_);
+  }
+
+ private:
+  OperatorProfile* profile_;
+  EvaluationContext* context_;
+  OperatorProfile* saved_profile_;
+  const absl::Time start_time_;
+  absl::optional<InternalValue::ScopedAllocationCounter> allocation_counter_;
+};
+
+// Wraps the iterator of a RelationalOp to charge the work it does to the
+// OperatorProfile of that RelationalOp.
+class ProfilingTupleIterator : public TupleIterator {
+ public:
+  ProfilingTupleIterator(std::unique_ptr<TupleIterator> iter,
+                         OperatorProfile* profile, EvaluationContext* context)
+      : iter_(std::move(iter)), profile_(profile), context_(context) {}
+
+  ProfilingTupleIterator(const ProfilingTupleIterator&) = delete;
+  ProfilingTupleIterator& operator=(const ProfilingTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return iter_->Schema(); }
+
+  TupleData* Next() override {
+    OperatorProfileScope scope(profile_, context_);
+    TupleData* data = iter_->Next();
+    if (data != nullptr) ++profile_->num_output_rows;
+    return data;
+  }
+
+  bool NextBatch(TupleBatch* batch) override {
+    OperatorProfileScope scope(profile_, context_);
+    if (!iter_->NextBatch(batch)) return false;
+    profile_->num_output_rows += batch->size();
+    return true;
+  }
+
+  zetasql_base::Status Status() const override { return iter_->Status(); }
+
+  bool PreservesOrder() const override { return iter_->PreservesOrder(); }
+
+  zetasql_base::Status DisableReordering() override {
+    return iter_->DisableReordering();
+  }
+
+  std::string DebugString() const override { return iter_->DebugString(); }
+
+ private:
+  const std::unique_ptr<TupleIterator> iter_;
+  OperatorProfile* profile_;
+  EvaluationContext* context_;
+};
+
+}  // namespace
+
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RelationalOp::CreateIterator(
+    absl::Span<const TupleData* const> params, int num_extra_slots,
+    EvaluationContext* context) const {
+  if (context->profile() == nullptr) {
+    return CreateIteratorInternal(params, num_extra_slots, context);
+  }
+  OperatorProfile* profile =
+      context->mutable_profile()->GetMutableOperatorProfile(this);
+  ++profile->num_iterators;
+  std::unique_ptr<TupleIterator> iter;
+  {
+    OperatorProfileScope scope(profile, context);
+    ZETASQL_ASSIGN_OR_RETURN(iter,
+                     CreateIteratorInternal(params, num_extra_slots, context));
+  }
+  iter = absl::make_unique<ProfilingTupleIterator>(std::move(iter), profile,
+                                                  context);
+  return iter;
+}
+
 ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RelationalOp::MaybeReorder(
     std::unique_ptr<TupleIterator> iter, EvaluationContext* context) const {
   if (context->options().scramble_undefined_orderings) {
@@ -111,10 +230,38 @@ zetasql_base::Status RelationalOp::set_is_order_preserving(bool is_order_preserv
   return iter;
 }
 
+std::unique_ptr<TupleIterator> RelationalOp::MaybeBatch(
+    std::unique_ptr<TupleIterator> iter, EvaluationContext* context) const {
+  if (context->options().batch_size > 0) {
+    iter = absl::make_unique<BatchedTupleIterator>(
+        std::move(iter), context->options().batch_size);
+  }
+  return iter;
+}
+
 // -------------------------------------------------------
 // InArrayColumnFilterArg
 // -------------------------------------------------------
 
+// Returns a kInList ColumnFilter for the elements that are not NULL or NaN.
+// Drops duplicates with an InListSet, like InListExpr, if the type allows it.
+static std::unique_ptr<ColumnFilter> CreateInListColumnFilter(
+    absl::Span<const Value> elements) {
+  if (!elements.empty() && InListSet::SupportsType(elements[0].type())) {
+    const InListSet set(elements);
+    return absl::make_unique<ColumnFilter>(set.distinct_values());
+  }
+  std::vector<Value> values;
+  values.reserve(elements.size());
+  for (const Value& value : elements) {
+    // Check for NULL and NaN.
+    if (value.SqlEquals(value) == values::True()) {
+      values.push_back(value);
+    }
+  }
+  return absl::make_unique<ColumnFilter>(values);
+}
+
 ::zetasql_base::StatusOr<std::unique_ptr<InArrayColumnFilterArg>>
 InArrayColumnFilterArg::Create(const VariableId& variable, int column_idx,
                                std::unique_ptr<ValueExpr> array) {
@@ -136,18 +283,10 @@ InArrayColumnFilterArg::Create(const VariableId& variable, int column_idx,
     return status;
   }
 
-  std::vector<Value> values;
-  if (!array.value().is_null()) {
-    values.reserve(array.value().elements().size());
-    for (const Value& value : array.value().elements()) {
-      // Check for NULL or NaN.
-      if (value.SqlEquals(value) == values::True()) {
-        values.push_back(value);
-      }
-    }
+  if (array.value().is_null()) {
+    return absl::make_unique<ColumnFilter>(std::vector<Value>());
   }
-
-  return absl::make_unique<ColumnFilter>(values);
+  return CreateInListColumnFilter(array.value().elements());
 }
 
 std::string InArrayColumnFilterArg::DebugInternal(const std::string& indent,
@@ -197,16 +336,7 @@ InListColumnFilterArg::Create(
     }
   }
 
-  std::vector<Value> values;
-  values.reserve(elements.size());
-  for (const Value& value : elements) {
-    // Check for NULL and NaN.
-    if (value.SqlEquals(value) == values::True()) {
-      values.push_back(value);
-    }
-  }
-
-  return absl::make_unique<ColumnFilter>(values);
+  return CreateInListColumnFilter(elements);
 }
 
 std::string InListColumnFilterArg::DebugInternal(const std::string& indent,
@@ -298,6 +428,240 @@ HalfUnboundedColumnFilterArg::HalfUnboundedColumnFilterArg(
       kind_(kind),
       arg_(std::move(arg)) {}
 
+// -------------------------------------------------------
+// BuildKeysColumnFilterArg
+// -------------------------------------------------------
+
+::zetasql_base::StatusOr<std::unique_ptr<BuildKeysColumnFilterArg>>
+BuildKeysColumnFilterArg::Create(const VariableId& variable, int column_idx,
+                                 std::unique_ptr<ValueExpr> keys,
+                                 std::unique_ptr<ValueExpr> min_key,
+                                 std::unique_ptr<ValueExpr> max_key) {
+  ZETASQL_RET_CHECK(keys->output_type()->IsArray());
+  return absl::WrapUnique(new BuildKeysColumnFilterArg(
+      variable, column_idx, std::move(keys), std::move(min_key),
+      std::move(max_key)));
+}
+
+::zetasql_base::Status BuildKeysColumnFilterArg::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  ZETASQL_RETURN_IF_ERROR(keys_->SetSchemasForEvaluation(params_schemas));
+  ZETASQL_RETURN_IF_ERROR(min_key_->SetSchemasForEvaluation(params_schemas));
+  return max_key_->SetSchemasForEvaluation(params_schemas);
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<ColumnFilter>> BuildKeysColumnFilterArg::Eval(
+    absl::Span<const TupleData* const> params,
+    EvaluationContext* context) const {
+  TupleSlot keys;
+  TupleSlot min_key;
+  TupleSlot max_key;
+  ::zetasql_base::Status status;
+  if (!keys_->EvalSimple(params, context, &keys, &status) ||
+      !min_key_->EvalSimple(params, context, &min_key, &status) ||
+      !max_key_->EvalSimple(params, context, &max_key, &status)) {
+    return status;
+  }
+
+  if (!keys.value().is_null()) {
+    std::vector<Value> values;
+    values.reserve(keys.value().elements().size());
+    for (const Value& value : keys.value().elements()) {
+      // Check for NULL or NaN.
+      if (value.SqlEquals(value) == values::True()) {
+        values.push_back(value);
+      }
+    }
+    return absl::make_unique<ColumnFilter>(values);
+  }
+
+  // Invalid bounds represent +/- infinity.
+  Value lower_bound;
+  Value upper_bound;
+  if (!min_key.value().is_null()) lower_bound = min_key.value();
+  if (!max_key.value().is_null()) upper_bound = max_key.value();
+  return absl::make_unique<ColumnFilter>(lower_bound, upper_bound);
+}
+
+std::string BuildKeysColumnFilterArg::DebugInternal(const std::string& indent,
+                                                    bool verbose) const {
+  return absl::StrCat("BuildKeysColumnFilterArg($", variable_.ToString(),
+                      ", column_idx: ", column_idx(),
+                      ", keys: ", keys_->DebugInternal(indent, verbose),
+                      ", min_key: ", min_key_->DebugInternal(indent, verbose),
+                      ", max_key: ", max_key_->DebugInternal(indent, verbose),
+                      ")");
+}
+
+BuildKeysColumnFilterArg::BuildKeysColumnFilterArg(
+    const VariableId& variable, int column_idx,
+    std::unique_ptr<ValueExpr> keys, std::unique_ptr<ValueExpr> min_key,
+    std::unique_ptr<ValueExpr> max_key)
+    : ColumnFilterArg(column_idx),
+      variable_(variable),
+      keys_(std::move(keys)),
+      min_key_(std::move(min_key)),
+      max_key_(std::move(max_key)) {}
+
+// -------------------------------------------------------
+// ColumnPredicateArg
+// -------------------------------------------------------
+
+static std::string ColumnPredicateKindToString(ColumnPredicate::Kind kind) {
+  switch (kind) {
+    case ColumnPredicate::kAnd:
+      return "AND";
+    case ColumnPredicate::kOr:
+      return "OR";
+    case ColumnPredicate::kEqual:
+      return "=";
+    case ColumnPredicate::kLess:
+      return "<";
+    case ColumnPredicate::kLessOrEqual:
+      return "<=";
+    case ColumnPredicate::kGreater:
+      return ">";
+    case ColumnPredicate::kGreaterOrEqual:
+      return ">=";
+    case ColumnPredicate::kIsNull:
+      return "IS NULL";
+    case ColumnPredicate::kIsNotNull:
+      return "IS NOT NULL";
+    case ColumnPredicate::kStartsWith:
+      return "STARTS WITH";
+    case ColumnPredicate::kInList:
+      return "IN";
+    default:
+      return absl::StrCat("UNKNOWN(", kind, ")");
+  }
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<ColumnPredicateArg>>
+ColumnPredicateArg::CreateJunction(
+    ColumnPredicate::Kind kind,
+    std::vector<std::unique_ptr<ColumnPredicateArg>> children) {
+  ZETASQL_RET_CHECK(kind == ColumnPredicate::kAnd || kind == ColumnPredicate::kOr)
+      << ColumnPredicateKindToString(kind);
+  return absl::WrapUnique(new ColumnPredicateArg(
+      kind, VariableId(), /*column_idx=*/-1, std::move(children),
+      /*args=*/{}));
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<ColumnPredicateArg>>
+ColumnPredicateArg::CreateLeaf(ColumnPredicate::Kind kind,
+                               const VariableId& variable, int column_idx,
+                               std::vector<std::unique_ptr<ValueExpr>> args) {
+  switch (kind) {
+    case ColumnPredicate::kEqual:
+    case ColumnPredicate::kLess:
+    case ColumnPredicate::kLessOrEqual:
+    case ColumnPredicate::kGreater:
+    case ColumnPredicate::kGreaterOrEqual:
+    case ColumnPredicate::kStartsWith:
+      ZETASQL_RET_CHECK_EQ(args.size(), 1);
+      break;
+    case ColumnPredicate::kIsNull:
+    case ColumnPredicate::kIsNotNull:
+      ZETASQL_RET_CHECK(args.empty());
+      break;
+    case ColumnPredicate::kInList:
+      break;
+    default:
+      ZETASQL_RET_CHECK_FAIL() << "Unexpected leaf ColumnPredicate::Kind "
+                       << ColumnPredicateKindToString(kind);
+  }
+  ZETASQL_RET_CHECK_GE(column_idx, 0);
+  return absl::WrapUnique(new ColumnPredicateArg(
+      kind, variable, column_idx, /*children=*/{}, std::move(args)));
+}
+
+::zetasql_base::Status ColumnPredicateArg::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  for (std::unique_ptr<ColumnPredicateArg>& child : children_) {
+    ZETASQL_RETURN_IF_ERROR(child->SetSchemasForEvaluation(params_schemas));
+  }
+  for (std::unique_ptr<ValueExpr>& arg : args_) {
+    ZETASQL_RETURN_IF_ERROR(arg->SetSchemasForEvaluation(params_schemas));
+  }
+  return zetasql_base::OkStatus();
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<ColumnPredicate>> ColumnPredicateArg::Eval(
+    absl::Span<const TupleData* const> params,
+    EvaluationContext* context) const {
+  if (kind_ == ColumnPredicate::kAnd || kind_ == ColumnPredicate::kOr) {
+    std::vector<std::unique_ptr<ColumnPredicate>> children;
+    children.reserve(children_.size());
+    for (const std::unique_ptr<ColumnPredicateArg>& child : children_) {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ColumnPredicate> predicate,
+                       child->Eval(params, context));
+      children.push_back(std::move(predicate));
+    }
+    return kind_ == ColumnPredicate::kAnd
+               ? ColumnPredicate::CreateAnd(std::move(children))
+               : ColumnPredicate::CreateOr(std::move(children));
+  }
+
+  std::vector<Value> values(args_.size());
+  for (int i = 0; i < args_.size(); ++i) {
+    std::shared_ptr<TupleSlot::SharedProtoState> shared_state;
+    VirtualTupleSlot result(&values[i], &shared_state);
+    ::zetasql_base::Status status;
+    if (!args_[i]->Eval(params, context, &result, &status)) {
+      return status;
+    }
+  }
+
+  switch (kind_) {
+    case ColumnPredicate::kIsNull:
+    case ColumnPredicate::kIsNotNull:
+      return ColumnPredicate::CreateIsNull(
+          column_idx_, /*negated=*/kind_ == ColumnPredicate::kIsNotNull);
+    case ColumnPredicate::kInList:
+      return ColumnPredicate::CreateInList(column_idx_, std::move(values));
+    default:
+      return ColumnPredicate::CreateComparison(kind_, column_idx_, values[0]);
+  }
+}
+
+std::string ColumnPredicateArg::DebugInternal(const std::string& indent,
+                                              bool verbose) const {
+  if (kind_ == ColumnPredicate::kAnd || kind_ == ColumnPredicate::kOr) {
+    std::vector<std::string> child_strs;
+    child_strs.reserve(children_.size());
+    for (const std::unique_ptr<ColumnPredicateArg>& child : children_) {
+      child_strs.push_back(child->DebugInternal(indent, verbose));
+    }
+    return absl::StrCat("ColumnPredicateArg(", ColumnPredicateKindToString(kind_),
+                        "(", absl::StrJoin(child_strs, ", "), "))");
+  }
+
+  std::vector<std::string> arg_strs;
+  arg_strs.reserve(args_.size());
+  for (const std::unique_ptr<ValueExpr>& arg : args_) {
+    arg_strs.push_back(arg->DebugInternal(indent, verbose));
+  }
+  return absl::StrCat("ColumnPredicateArg($", variable_.ToString(),
+                      ", column_idx: ", column_idx_, ", predicate: ",
+                      ColumnPredicateKindToString(kind_),
+                      arg_strs.empty() ? "" : " ",
+                      kind_ == ColumnPredicate::kInList
+                          ? absl::StrCat("(", absl::StrJoin(arg_strs, ", "), ")")
+                          : absl::StrJoin(arg_strs, ", "),
+                      ")");
+}
+
+ColumnPredicateArg::ColumnPredicateArg(
+    ColumnPredicate::Kind kind, const VariableId& variable, int column_idx,
+    std::vector<std::unique_ptr<ColumnPredicateArg>> children,
+    std::vector<std::unique_ptr<ValueExpr>> args)
+    : AlgebraArg(VariableId(), /*node=*/nullptr),
+      kind_(kind),
+      variable_(variable),
+      column_idx_(column_idx),
+      children_(std::move(children)),
+      args_(std::move(args)) {}
+
 // -------------------------------------------------------
 // EvaluatorTableScanOp
 // -------------------------------------------------------
@@ -416,33 +780,199 @@ EvaluatorTableScanOp::IntersectColumnFilters(
   }
 }
 
+::zetasql_base::Status EvaluatorTableScanOp::AddPushedDownConjunct(
+    std::unique_ptr<ColumnPredicateArg> predicate,
+    std::unique_ptr<ValueExpr> conjunct) {
+  ZETASQL_RET_CHECK(table_->SupportsEvaluatorPredicatePushdown()) << table_->Name();
+  pushed_down_predicates_.push_back(std::move(predicate));
+  pushed_down_conjuncts_.push_back(std::move(conjunct));
+  return zetasql_base::OkStatus();
+}
+
 ::zetasql_base::Status EvaluatorTableScanOp::SetSchemasForEvaluation(
     absl::Span<const TupleSchema* const> params_schemas) {
   for (std::unique_ptr<ColumnFilterArg>& filter : and_filters_) {
     ZETASQL_RETURN_IF_ERROR(filter->SetSchemasForEvaluation(params_schemas));
   }
 
+  if (!pushed_down_predicates_.empty()) {
+    const std::unique_ptr<const TupleSchema> output_schema =
+        CreateOutputSchema();
+    for (int i = 0; i < pushed_down_predicates_.size(); ++i) {
+      ZETASQL_RETURN_IF_ERROR(
+          pushed_down_predicates_[i]->SetSchemasForEvaluation(params_schemas));
+      ZETASQL_RETURN_IF_ERROR(pushed_down_conjuncts_[i]->SetSchemasForEvaluation(
+          ConcatSpans(params_schemas, {output_schema.get()})));
+    }
+  }
+
   if (read_time_ != nullptr) {
     ZETASQL_RETURN_IF_ERROR(read_time_->SetSchemasForEvaluation(params_schemas));
   }
 
+  if (block_sample_percent_ != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(
+        block_sample_percent_->SetSchemasForEvaluation(params_schemas));
+  }
+  if (block_sample_seed_ != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(block_sample_seed_->SetSchemasForEvaluation(params_schemas));
+  }
+
   return zetasql_base::OkStatus();
 }
 
+namespace {
+// Evaluates 'expr', an argument of a TABLESAMPLE, on 'params'.
+zetasql_base::StatusOr<Value> EvalSampleArg(const ValueExpr* expr,
+                                    absl::Span<const TupleData* const> params,
+                                    EvaluationContext* context) {
+  TupleSlot slot;
+  zetasql_base::Status status;
+  if (!expr->EvalSimple(params, context, &slot, &status)) return status;
+  return slot.value();
+}
+
+// Returns the percent of a TABLESAMPLE with PERCENT from 'value', which is an
+// INT64 or a DOUBLE.
+zetasql_base::StatusOr<double> GetSamplePercent(const Value& value) {
+  if (value.is_null()) {
+    return zetasql_base::OutOfRangeErrorBuilder()
+           << "TABLESAMPLE percent must not be NULL";
+  }
+  const double percent = value.type()->IsInt64()
+                             ? static_cast<double>(value.int64_value())
+                             : value.double_value();
+  // Also rejects NaN.
+  if (!(percent >= 0 && percent <= 100)) {
+    return zetasql_base::OutOfRangeErrorBuilder()
+           << "TABLESAMPLE percent must be between 0 and 100, but is "
+           << value.DebugString();
+  }
+  return percent;
+}
+
+// Returns the seed of a TABLESAMPLE from 'value', its REPEATABLE argument.
+zetasql_base::StatusOr<int64_t> GetSampleSeed(const Value& value) {
+  if (value.is_null()) {
+    return zetasql_base::OutOfRangeErrorBuilder()
+           << "TABLESAMPLE REPEATABLE argument must not be NULL";
+  }
+  return value.int64_value();
+}
+
+// Returns the random number generator of a sample, seeded with 'seed' if there
+// is one. 'partition_index' distinguishes the partitions of a scan that is
+// evaluated in parallel (see ExchangeOp).
+std::mt19937_64 CreateSampleRandomGenerator(absl::optional<int64_t> seed,
+                                            int partition_index,
+                                            EvaluationContext* context) {
+  if (!seed.has_value()) {
+    return std::mt19937_64(
+        absl::Uniform<uint64_t>(*context->GetRandomNumberGenerator()));
+  }
+  return std::mt19937_64(static_cast<uint64_t>(seed.value()) + partition_index);
+}
+
+// Returns each tuple of an underlying iterator independently with probability
+// 'percent' / 100. If 'weight_slot' is non-negative, sets that slot of each
+// tuple to the inverse of the probability.
+class BernoulliSampleTupleIterator : public TupleIterator {
+ public:
+  BernoulliSampleTupleIterator(double percent, std::mt19937_64 rng,
+                               int weight_slot,
+                               std::unique_ptr<TupleIterator> iter,
+                               std::unique_ptr<TupleSchema> output_schema,
+                               EvaluationContext* context)
+      : distribution_(percent / 100),
+        rng_(std::move(rng)),
+        weight_slot_(weight_slot),
+        weight_(values::Double(100 / percent)),
+        iter_(std::move(iter)),
+        output_schema_(std::move(output_schema)),
+        context_(context) {}
+
+  BernoulliSampleTupleIterator(const BernoulliSampleTupleIterator&) = delete;
+  BernoulliSampleTupleIterator& operator=(
+      const BernoulliSampleTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return *output_schema_; }
+
+  TupleData* Next() override {
+    while (true) {
+      TupleData* current = iter_->Next();
+      if (current == nullptr) {
+        status_ = iter_->Status();
+        return nullptr;
+      }
+      // A small sample can read many tuples per call to Next(), so it checks
+      // for cancellation itself.
+      if (num_tuples_read_++ %
+              absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period) ==
+          0) {
+        status_ = context_->VerifyNotAborted();
+        if (!status_.ok()) return nullptr;
+      }
+      if (!distribution_(rng_)) continue;
+      if (weight_slot_ >= 0) {
+        current->mutable_slot(weight_slot_)->SetValue(weight_);
+      }
+      return current;
+    }
+  }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  std::string DebugString() const override {
+    return SampleScanOp::GetIteratorDebugString(SampleScanOp::kBernoulli,
+                                                iter_->DebugString());
+  }
+
+ private:
+  std::bernoulli_distribution distribution_;
+  std::mt19937_64 rng_;
+  const int weight_slot_;
+  const Value weight_;
+  std::unique_ptr<TupleIterator> iter_;
+  const std::unique_ptr<TupleSchema> output_schema_;
+  EvaluationContext* context_;
+  int64_t num_tuples_read_ = 0;
+  zetasql_base::Status status_;
+};
+}  // namespace
+
 namespace {
 class EvaluatorTableTupleIterator : public TupleIterator {
  public:
   EvaluatorTableTupleIterator(
       const std::string& name, std::unique_ptr<TupleSchema> schema,
       int num_extra_slots, EvaluationContext* context,
-      std::unique_ptr<EvaluatorTableIterator> evaluator_table_iter)
+      std::unique_ptr<EvaluatorTableIterator> evaluator_table_iter,
+      absl::Span<const TupleData* const> params,
+      std::vector<const ValueExpr*> residual_filters, int partition_index,
+      int num_partitions)
       : name_(name),
         schema_(std::move(schema)),
         context_(context),
         evaluator_table_iter_(std::move(evaluator_table_iter)),
+        use_column_batches_(evaluator_table_iter_->SupportsColumnBatches()),
+        residual_filters_(std::move(residual_filters)),
+        partition_index_(partition_index),
+        num_partitions_(num_partitions),
         current_(schema_->num_variables() + num_extra_slots) {
+    if (!residual_filters_.empty()) {
+      params_and_current_.assign(params.begin(), params.end());
+      params_and_current_.push_back(nullptr);
+    }
     context_->RegisterCancelCallback(
         [this] { return evaluator_table_iter_->Cancel(); });
+    if (use_column_batches_) {
+      column_batch_size_ = context_->options().batch_size > 0
+                               ? context_->options().batch_size
+                               : kDefaultColumnBatchSize;
+      for (int i = 0; i < evaluator_table_iter_->NumColumns(); ++i) {
+        column_types_.push_back(evaluator_table_iter_->GetColumnType(i));
+      }
+    }
   }
 
   EvaluatorTableTupleIterator(const EvaluatorTableTupleIterator&) = delete;
@@ -452,14 +982,79 @@ class EvaluatorTableTupleIterator : public TupleIterator {
   const TupleSchema& Schema() const override { return *schema_; }
 
   TupleData* Next() override {
+    while (AdvanceRow()) {
+      CopyCurrentRow(&current_);
+      bool matches;
+      if (!MatchesResidualFilters(&current_, &matches)) return nullptr;
+      if (matches) return &current_;
+    }
+    return nullptr;
+  }
+
+  bool NextBatch(TupleBatch* batch) override {
+    do {
+      batch->Clear();
+      while (!batch->IsFull() && AdvanceRow()) {
+        TupleData* row = batch->AppendRow();
+        if (row->num_slots() != current_.num_slots()) {
+          *row = TupleData(current_.num_slots());
+        }
+        CopyCurrentRow(row);
+      }
+      if (!status_.ok()) return false;
+      if (!residual_filters_.empty()) {
+        selected_rows_.clear();
+        for (int i = 0; i < batch->size(); ++i) {
+          bool matches;
+          if (!MatchesResidualFilters(batch->mutable_row(i), &matches)) {
+            return false;
+          }
+          if (matches) selected_rows_.push_back(i);
+        }
+        batch->SelectRows(selected_rows_);
+      }
+    } while (batch->IsEmpty() && !done_);
+    return !batch->IsEmpty();
+  }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  std::string DebugString() const override {
+    return EvaluatorTableScanOp::GetIteratorDebugString(name_);
+  }
+
+ private:
+  // Advances 'evaluator_table_iter_' to the next row in this iterator's
+  // partition. Returns false if there are no more rows or if there is an
+  // error, in which case 'status_' is updated.
+  bool AdvanceRow() {
+    while (AdvanceTableRow()) {
+      if (num_partitions_ == 1) return true;
+      // Partition the table into morsels of consecutive rows so that each
+      // partition reads whole runs of the table.
+      const int64_t morsel = row_number_++ / kRowsPerMorsel;
+      if (morsel % num_partitions_ == partition_index_) return true;
+    }
+    return false;
+  }
+
+  // Advances 'evaluator_table_iter_' to the next row, regardless of the
+  // partition. Returns false if there are no more rows or if there is an
+  // error, in which case 'status_' is updated.
+  bool AdvanceTableRow() {
+    if (done_) return false;
     if (!called_next_) {
       evaluator_table_iter_->SetDeadline(
           context_->GetStatementEvaluationDeadline());
       called_next_ = true;
     }
-    if (!evaluator_table_iter_->NextRow()) {
+    if (use_column_batches_) return AdvanceColumnBatchRow();
+    const bool has_row = evaluator_table_iter_->NextRow();
+    RecordStallTime();
+    if (!has_row) {
       status_ = evaluator_table_iter_->Status();
-      return nullptr;
+      done_ = true;
+      return false;
     }
 
     if (schema_->num_variables() != evaluator_table_iter_->NumColumns()) {
@@ -467,36 +1062,285 @@ class EvaluatorTableTupleIterator : public TupleIterator {
                 << "EvaluatorTableTupleIterator::Next() found wrong number of "
                 << "columns: " << current_.num_slots() << " vs. "
                 << evaluator_table_iter_->NumColumns();
-      return nullptr;
+      done_ = true;
+      return false;
     }
+    return true;
+  }
 
-    for (int i = 0; i < schema_->num_variables(); ++i) {
-      current_.mutable_slot(i)->SetValue(evaluator_table_iter_->GetValue(i));
+  // Like AdvanceRow(), but for 'use_column_batches_'. Moves to the next row of
+  // 'column_batch_', reading a new batch if necessary.
+  bool AdvanceColumnBatchRow() {
+    ++row_in_column_batch_;
+    if (row_in_column_batch_ < column_batch_.num_rows) return true;
+
+    const bool has_batch = evaluator_table_iter_->NextColumnBatch(
+        column_batch_size_, &column_batch_);
+    RecordStallTime();
+    if (!has_batch) {
+      status_ = evaluator_table_iter_->Status();
+      done_ = true;
+      return false;
     }
-    return &current_;
+    status_ = ValidateColumnBatch();
+    if (!status_.ok()) {
+      done_ = true;
+      return false;
+    }
+    row_in_column_batch_ = 0;
+    return true;
   }
 
-  zetasql_base::Status Status() const override { return status_; }
+  // Charges the stall time of 'evaluator_table_iter_' since the last call to
+  // the profile of the scan, if there is one.
+  void RecordStallTime() {
+    if (context_->current_operator_profile() == nullptr) return;
+    const absl::Duration stall_time = evaluator_table_iter_->GetStallTime();
+    context_->RecordTableStallTime(stall_time - recorded_stall_time_);
+    recorded_stall_time_ = stall_time;
+  }
 
-  std::string DebugString() const override {
-    return EvaluatorTableScanOp::GetIteratorDebugString(name_);
+  // Checks that 'column_batch_' has the right shape, so that GetBatchValue()
+  // does not have to.
+  zetasql_base::Status ValidateColumnBatch() const {
+    const int64_t num_rows = column_batch_.num_rows;
+    if (num_rows <= 0 || num_rows > column_batch_size_) {
+      return zetasql_base::InternalErrorBuilder()
+             << "EvaluatorTableIterator::NextColumnBatch() returned " << num_rows
+             << " rows, but the maximum was " << column_batch_size_;
+    }
+    if (schema_->num_variables() != column_batch_.columns.size()) {
+      return zetasql_base::InternalErrorBuilder()
+             << "EvaluatorTableTupleIterator::Next() found wrong number of "
+             << "columns in batch: " << schema_->num_variables() << " vs. "
+             << column_batch_.columns.size();
+    }
+    const int64_t num_bitmap_bytes = (num_rows + 7) / 8;
+    for (int i = 0; i < column_types_.size(); ++i) {
+      const EvaluatorTableColumnBatch::Column& column = column_batch_.columns[i];
+      if (!column.validity_bitmap.empty() &&
+          column.validity_bitmap.size() < num_bitmap_bytes) {
+        return zetasql_base::InternalErrorBuilder()
+               << "EvaluatorTableIterator::NextColumnBatch() returned a too "
+               << "short validity bitmap for column " << i;
+      }
+      if (!column.dictionary.empty()) {
+        ZETASQL_RETURN_IF_ERROR(ValidateDictionaryColumn(i));
+        continue;
+      }
+      int64_t size;
+      int64_t min_size = num_rows;
+      switch (column_types_[i]->kind()) {
+        case TYPE_INT64:
+          size = column.int64_values.size();
+          break;
+        case TYPE_DOUBLE:
+          size = column.double_values.size();
+          break;
+        case TYPE_BOOL:
+          size = column.bool_bitmap.size();
+          min_size = num_bitmap_bytes;
+          break;
+        case TYPE_STRING:
+          size = column.string_values.size();
+          break;
+        default:
+          size = column.values.size();
+          break;
+      }
+      if (size < min_size) {
+        return zetasql_base::InternalErrorBuilder()
+               << "EvaluatorTableIterator::NextColumnBatch() returned too few "
+               << "values for column " << i << " of type "
+               << column_types_[i]->DebugString();
+      }
+    }
+    return zetasql_base::OkStatus();
   }
 
- private:
+  // Checks the codes and the dictionary of the dictionary-encoded column 'i'
+  // of 'column_batch_'.
+  zetasql_base::Status ValidateDictionaryColumn(int i) const {
+    const EvaluatorTableColumnBatch::Column& column = column_batch_.columns[i];
+    const Type* type = column_types_[i];
+    if (column.dictionary_codes.size() < column_batch_.num_rows) {
+      return zetasql_base::InternalErrorBuilder()
+             << "EvaluatorTableIterator::NextColumnBatch() returned too few "
+             << "dictionary codes for column " << i;
+    }
+    for (const Value& value : column.dictionary) {
+      if (value.is_null() || !value.type()->Equals(type)) {
+        return zetasql_base::InternalErrorBuilder()
+               << "EvaluatorTableIterator::NextColumnBatch() returned a "
+               << "dictionary element " << value.DebugString()
+               << " for column " << i << " of type " << type->DebugString();
+      }
+    }
+    const int64_t dictionary_size = column.dictionary.size();
+    for (int64_t row = 0; row < column_batch_.num_rows; ++row) {
+      const int32_t code = column.dictionary_codes[row];
+      if ((code < 0 || code >= dictionary_size) && !column.IsNull(row)) {
+        return zetasql_base::InternalErrorBuilder()
+               << "EvaluatorTableIterator::NextColumnBatch() returned "
+               << "dictionary code " << code << " for column " << i
+               << ", but the dictionary has " << dictionary_size
+               << " elements";
+      }
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  // Returns the value of column 'i' in the current row of 'column_batch_'.
+  // Dictionary elements are copied, which shares their contents instead of
+  // decoding them.
+  Value GetBatchValue(int i) const {
+    const EvaluatorTableColumnBatch::Column& column = column_batch_.columns[i];
+    const Type* type = column_types_[i];
+    const int64_t row = row_in_column_batch_;
+    if (column.IsNull(row)) return Value::Null(type);
+    if (!column.dictionary.empty()) {
+      return column.dictionary[column.dictionary_codes[row]];
+    }
+    switch (type->kind()) {
+      case TYPE_INT64:
+        return Value::Int64(column.int64_values[row]);
+      case TYPE_DOUBLE:
+        return Value::Double(column.double_values[row]);
+      case TYPE_BOOL:
+        return Value::Bool(EvaluatorTableColumnBatch::Column::GetBit(
+            column.bool_bitmap, row));
+      case TYPE_STRING:
+        return Value::String(column.string_values[row]);
+      default:
+        return column.values[row];
+    }
+  }
+
+  // Sets 'matches' to true if all of 'residual_filters_' evaluate to
+  // Bool(true) on 'row'. Returns false and updates 'status_' on error.
+  bool MatchesResidualFilters(const TupleData* row, bool* matches) {
+    *matches = true;
+    if (residual_filters_.empty()) return true;
+    params_and_current_.back() = row;
+    for (const ValueExpr* filter : residual_filters_) {
+      TupleSlot slot;
+      ::zetasql_base::Status status;
+      if (!filter->EvalSimple(params_and_current_, context_, &slot, &status)) {
+        status_ = status;
+        done_ = true;
+        return false;
+      }
+      if (slot.value() != Bool(true)) {
+        *matches = false;
+        return true;
+      }
+    }
+    return true;
+  }
+
+  // Copies the current row of 'evaluator_table_iter_' into the first
+  // 'schema_->num_variables()' slots of 'data'.
+  void CopyCurrentRow(TupleData* data) {
+    if (use_column_batches_) {
+      for (int i = 0; i < schema_->num_variables(); ++i) {
+        data->mutable_slot(i)->SetValue(GetBatchValue(i));
+      }
+      return;
+    }
+    for (int i = 0; i < schema_->num_variables(); ++i) {
+      data->mutable_slot(i)->SetValue(evaluator_table_iter_->GetValue(i));
+    }
+  }
+
+  // The number of rows requested from NextColumnBatch() if
+  // EvaluationOptions::batch_size is not set.
+  static constexpr int kDefaultColumnBatchSize = 1024;
+  // The number of consecutive rows of the table that go to the same partition
+  // when 'num_partitions_' is greater than one.
+  static constexpr int64_t kRowsPerMorsel = 256;
+
   const std::string name_;
   const std::unique_ptr<TupleSchema> schema_;
   EvaluationContext* context_;
   bool called_next_ = false;
+  // True if AdvanceRow() has returned false.
+  bool done_ = false;
   std::unique_ptr<EvaluatorTableIterator> evaluator_table_iter_;
+  // True if 'evaluator_table_iter_' is read with NextColumnBatch() instead of
+  // NextRow().
+  const bool use_column_batches_;
+  // The following are only used if 'use_column_batches_' is true.
+  int64_t column_batch_size_ = 0;
+  std::vector<const Type*> column_types_;
+  EvaluatorTableColumnBatch column_batch_;
+  // The index of the current row in 'column_batch_'.
+  int64_t row_in_column_batch_ = -1;
+  // The pushed down conjuncts that the Table did not fully handle, which are
+  // evaluated on 'params_and_current_'.
+  const std::vector<const ValueExpr*> residual_filters_;
+  // The parameters followed by the row that is being filtered. Only used if
+  // 'residual_filters_' is non-empty.
+  std::vector<const TupleData*> params_and_current_;
+  // Positions in the current batch of the rows that pass 'residual_filters_'.
+  // Only used by NextBatch().
+  std::vector<int> selected_rows_;
+  // This iterator only returns the rows of partition 'partition_index_' of
+  // 'num_partitions_' (see ExchangeOp).
+  const int partition_index_;
+  const int num_partitions_;
+  // The number of rows read from 'evaluator_table_iter_' so far. Only
+  // maintained if 'num_partitions_' is greater than one.
+  int64_t row_number_ = 0;
+  // The part of EvaluatorTableIterator::GetStallTime() that RecordStallTime()
+  // has already charged to the profile.
+  absl::Duration recorded_stall_time_ = absl::ZeroDuration();
   TupleData current_;
   zetasql_base::Status status_;
 };
+
+// Populates 'keys' with every combination of the values of the kInList
+// ColumnFilters in 'filter_map' of the columns at 'key_column_idxs', in that
+// order, and returns true. Returns false if one of the columns does not have
+// a kInList filter or there are more than
+// EvaluatorTableScanOp::kMaxKeyLookups combinations.
+bool GetLookupKeys(
+    const absl::flat_hash_map<int, std::unique_ptr<ColumnFilter>>& filter_map,
+    absl::Span<const int> key_column_idxs,
+    std::vector<std::vector<Value>>* keys) {
+  std::vector<const std::vector<Value>*> in_lists;
+  in_lists.reserve(key_column_idxs.size());
+  int64_t num_keys = 1;
+  for (const int column_idx : key_column_idxs) {
+    const auto it = filter_map.find(column_idx);
+    if (it == filter_map.end() ||
+        it->second->kind() != ColumnFilter::kInList) {
+      return false;
+    }
+    in_lists.push_back(&it->second->in_list());
+    num_keys *= in_lists.back()->size();
+    if (num_keys > EvaluatorTableScanOp::kMaxKeyLookups) return false;
+  }
+  keys->assign(1, {});
+  for (const std::vector<Value>* in_list : in_lists) {
+    std::vector<std::vector<Value>> extended_keys;
+    extended_keys.reserve(keys->size() * in_list->size());
+    for (const std::vector<Value>& key : *keys) {
+      for (const Value& value : *in_list) {
+        extended_keys.push_back(key);
+        extended_keys.back().push_back(value);
+      }
+    }
+    *keys = std::move(extended_keys);
+  }
+  return true;
+}
+
 }  // namespace
 
 ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>>
-EvaluatorTableScanOp::CreateIterator(absl::Span<const TupleData* const> params,
-                                     int num_extra_slots,
-                                     EvaluationContext* context) const {
+EvaluatorTableScanOp::CreateIteratorInternal(
+    absl::Span<const TupleData* const> params, int num_extra_slots,
+    EvaluationContext* context) const {
   absl::optional<absl::Time> read_time;
   if (read_time_ != nullptr) {
     std::shared_ptr<TupleSlot::SharedProtoState> shared_state;
@@ -513,12 +1357,6 @@ EvaluatorTableScanOp::CreateIterator(absl::Span<const TupleData* const> params,
     read_time = time_value.ToTime();
   }
 
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> evaluator_table_iter,
-                   table_->CreateEvaluatorTableIterator(column_idxs_));
-  if (read_time.has_value()) {
-    ZETASQL_RETURN_IF_ERROR(evaluator_table_iter->SetReadTime(read_time.value()));
-  }
-
   absl::flat_hash_map<int, std::vector<std::unique_ptr<ColumnFilter>>>
       filter_list_map;
   for (const std::unique_ptr<ColumnFilterArg>& arg : and_filters_) {
@@ -535,13 +1373,90 @@ EvaluatorTableScanOp::CreateIterator(absl::Span<const TupleData* const> params,
     ZETASQL_RET_CHECK(filter_map.emplace(column_idx, std::move(filter)).second);
   }
 
+  std::unique_ptr<EvaluatorTableIterator> evaluator_table_iter;
+  std::vector<const ValueExpr*> residual_filters;
+  std::vector<std::vector<Value>> lookup_keys;
+  if (pushed_down_predicates_.empty() && !key_lookup_column_idxs_.empty() &&
+      table_->SupportsEvaluatorKeyLookups() &&
+      GetLookupKeys(filter_map, key_lookup_column_idxs_, &lookup_keys)) {
+    ZETASQL_ASSIGN_OR_RETURN(evaluator_table_iter,
+                     table_->CreateEvaluatorTableIteratorForKeys(
+                         column_idxs_, lookup_keys));
+  } else if (pushed_down_predicates_.empty()) {
+    ZETASQL_ASSIGN_OR_RETURN(evaluator_table_iter,
+                     table_->CreateEvaluatorTableIterator(column_idxs_));
+  } else {
+    std::vector<std::unique_ptr<ColumnPredicate>> predicates;
+    std::vector<const ColumnPredicate*> predicate_ptrs;
+    predicates.reserve(pushed_down_predicates_.size());
+    predicate_ptrs.reserve(pushed_down_predicates_.size());
+    for (const std::unique_ptr<ColumnPredicateArg>& arg :
+         pushed_down_predicates_) {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ColumnPredicate> predicate,
+                       arg->Eval(params, context));
+      predicate_ptrs.push_back(predicate.get());
+      predicates.push_back(std::move(predicate));
+    }
+    std::vector<bool> fully_handled(predicates.size(), false);
+    ZETASQL_ASSIGN_OR_RETURN(evaluator_table_iter,
+                     table_->CreateEvaluatorTableIteratorWithPredicate(
+                         column_idxs_, predicate_ptrs, &fully_handled));
+    ZETASQL_RET_CHECK_EQ(fully_handled.size(), predicates.size());
+    for (int i = 0; i < fully_handled.size(); ++i) {
+      if (!fully_handled[i]) {
+        residual_filters.push_back(pushed_down_conjuncts_[i].get());
+      }
+    }
+  }
+  if (read_time.has_value()) {
+    ZETASQL_RETURN_IF_ERROR(evaluator_table_iter->SetReadTime(read_time.value()));
+  }
+
   ZETASQL_RETURN_IF_ERROR(
       evaluator_table_iter->SetColumnFilterMap(std::move(filter_map)));
 
+  int partition_index = 0;
+  int num_partitions = 1;
+  context->GetScanPartition(this, &partition_index, &num_partitions);
+
+  // The percent of rows to sample here, if the iterator does not sample them.
+  absl::optional<double> row_sample_percent;
+  absl::optional<int64_t> sample_seed;
+  if (block_sample_percent_ != nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        const Value percent_value,
+        EvalSampleArg(block_sample_percent_.get(), params, context));
+    ZETASQL_ASSIGN_OR_RETURN(const double percent, GetSamplePercent(percent_value));
+    if (block_sample_seed_ != nullptr) {
+      ZETASQL_ASSIGN_OR_RETURN(const Value seed_value,
+                       EvalSampleArg(block_sample_seed_.get(), params, context));
+      ZETASQL_ASSIGN_OR_RETURN(sample_seed, GetSampleSeed(seed_value));
+    }
+    if (percent > 0 && percent < 100) context->SetNonDeterministicOutput();
+    if (!evaluator_table_iter->SetBlockSample(percent, sample_seed)) {
+      row_sample_percent = percent;
+    }
+  }
+
+  // The hint is about the rows that this scan returns, which are all the rows
+  // of 'evaluator_table_iter' unless some are filtered out here.
+  if (row_limit_hint_ >= 0 && residual_filters.empty() && num_partitions == 1) {
+    evaluator_table_iter->SetRowLimitHint(row_limit_hint_);
+  }
+
   std::unique_ptr<TupleIterator> tuple_iter =
       absl::make_unique<EvaluatorTableTupleIterator>(
           table_->Name(), CreateOutputSchema(), num_extra_slots, context,
-          std::move(evaluator_table_iter));
+          std::move(evaluator_table_iter), params, std::move(residual_filters),
+          partition_index, num_partitions);
+  if (row_sample_percent.has_value()) {
+    tuple_iter = absl::make_unique<BernoulliSampleTupleIterator>(
+        row_sample_percent.value(),
+        CreateSampleRandomGenerator(sample_seed, partition_index, context),
+        /*weight_slot=*/-1, std::move(tuple_iter), CreateOutputSchema(),
+        context);
+  }
+  tuple_iter = MaybeBatch(std::move(tuple_iter), context);
   return MaybeReorder(std::move(tuple_iter), context);
 }
 
@@ -570,6 +1485,10 @@ std::string EvaluatorTableScanOp::DebugInternal(const std::string& indent,
   for (const std::unique_ptr<ColumnFilterArg>& filter : and_filters_) {
     filter_strings.push_back(filter->DebugInternal(indent_input, verbose));
   }
+  for (const std::unique_ptr<ColumnPredicateArg>& predicate :
+       pushed_down_predicates_) {
+    filter_strings.push_back(predicate->DebugInternal(indent_input, verbose));
+  }
 
   return absl::StrCat(
       "EvaluatorTableScanOp(", column_names_.empty() ? "" : indent_input,
@@ -577,7 +1496,23 @@ std::string EvaluatorTableScanOp::DebugInternal(const std::string& indent,
       filter_strings.empty() ? "" : indent_input,
       absl::StrJoin(filter_strings, indent_input), indent_input,
       "table: ", table_->Name(),
-      alias_.empty() ? "" : absl::StrCat(indent_input, "alias: ", alias_), ")");
+      alias_.empty() ? "" : absl::StrCat(indent_input, "alias: ", alias_),
+      row_limit_hint_ < 0
+          ? ""
+          : absl::StrCat(indent_input, "row_limit_hint: ", row_limit_hint_),
+      key_lookup_column_idxs_.empty()
+          ? ""
+          : absl::StrCat(indent_input, "key_lookup_column_idxs: [",
+                         absl::StrJoin(key_lookup_column_idxs_, ", "), "]"),
+      block_sample_percent_ == nullptr
+          ? ""
+          : absl::StrCat(indent_input, "block_sample_percent: ",
+                         block_sample_percent_->DebugInternal(indent, verbose)),
+      block_sample_seed_ == nullptr
+          ? ""
+          : absl::StrCat(indent_input, "block_sample_seed: ",
+                         block_sample_seed_->DebugInternal(indent, verbose)),
+      ")");
 }
 
 EvaluatorTableScanOp::EvaluatorTableScanOp(
@@ -674,7 +1609,7 @@ class LetOpTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LetOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LetOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   // Initialize 'all_params' with 'params', then extend 'all_params' with new
@@ -781,6 +1716,19 @@ zetasql_base::StatusOr<std::unique_ptr<SortOp>> SortOp::Create(
   return op;
 }
 
+zetasql_base::Status SortOp::SetPartitionLimit(int num_partition_keys,
+                                       int64_t partition_limit,
+                                       bool with_ties) {
+  ZETASQL_RET_CHECK(!has_limit_);
+  ZETASQL_RET_CHECK_GE(num_partition_keys, 0);
+  ZETASQL_RET_CHECK_LE(num_partition_keys, keys().size());
+  ZETASQL_RET_CHECK_GE(partition_limit, 0);
+  num_partition_keys_ = num_partition_keys;
+  partition_limit_ = partition_limit;
+  partition_limit_with_ties_ = with_ties;
+  return zetasql_base::OkStatus();
+}
+
 zetasql_base::Status SortOp::SetSchemasForEvaluation(
     absl::Span<const TupleSchema* const> params_schemas) {
   if (has_limit_) {
@@ -813,13 +1761,15 @@ zetasql_base::Status SortOp::SetSchemasForEvaluation(
 namespace {
 // Takes a list of tuples sorted by 'comparator'. If DisableReordering() is
 // called before Next(), returns them in order. Otherwise, scrambles the order
-// of tuples that are equal with respect to 'comparator'.
+// of tuples that are equal with respect to 'comparator' (unless the tuples were
+// spilled to disk, in which case they are returned in order but
+// PreservesOrder() still returns false).
 class SortTupleIterator : public TupleIterator {
  public:
   SortTupleIterator(std::unique_ptr<TupleIterator> input_iter_for_debug_string,
                     std::unique_ptr<const TupleSchema> schema,
                     std::unique_ptr<TupleComparator> comparator,
-                    std::unique_ptr<TupleDataDeque> tuples,
+                    std::unique_ptr<SpillableTupleSorter> tuples,
                     EvaluationContext* context)
       : input_iter_for_debug_string_(std::move(input_iter_for_debug_string)),
         schema_(std::move(schema)),
@@ -842,8 +1792,8 @@ class SortTupleIterator : public TupleIterator {
         return nullptr;
       }
     }
-    if (enable_reordering_ && num_next_calls_ == 0) {
-      status_ = ReorderTuplesWithSameKey();
+    if (enable_reordering_ && num_next_calls_ == 0 && !tuples_->spilled()) {
+      status_ = ReorderTuplesWithSameKey(tuples_->mutable_in_memory_tuples());
       if (!status_.ok()) {
         return nullptr;
       }
@@ -852,7 +1802,7 @@ class SortTupleIterator : public TupleIterator {
 
     if (tuples_->IsEmpty()) return nullptr;
 
-    current_ = tuples_->PopFront();
+    current_ = tuples_->PopFront(&status_);
     return current_.get();
   }
 
@@ -873,14 +1823,14 @@ class SortTupleIterator : public TupleIterator {
   }
 
  private:
-  // Iterates over 'tuples_' and scrambles the order of tuples with the same
-  // key.
-  zetasql_base::Status ReorderTuplesWithSameKey() {
+  // Iterates over 'sorted_tuples' and scrambles the order of tuples with the
+  // same key.
+  zetasql_base::Status ReorderTuplesWithSameKey(TupleDataDeque* sorted_tuples) {
     // Scramble the sorted order.
     std::vector<std::unique_ptr<TupleData>> tuples;
-    tuples.reserve(tuples_->GetSize());
-    while (!tuples_->IsEmpty()) {
-      tuples.push_back(tuples_->PopFront());
+    tuples.reserve(sorted_tuples->GetSize());
+    while (!sorted_tuples->IsEmpty()) {
+      tuples.push_back(sorted_tuples->PopFront());
     }
     std::vector<int> scrambled_idxs;
     scrambled_idxs.reserve(tuples.size());
@@ -916,10 +1866,10 @@ class SortTupleIterator : public TupleIterator {
       start_idx += equal_length;
     }
 
-    ZETASQL_RET_CHECK(tuples_->IsEmpty());
+    ZETASQL_RET_CHECK(sorted_tuples->IsEmpty());
     zetasql_base::Status status;
     for (int idx : scrambled_idxs) {
-      if (!tuples_->PushBack(std::move(tuples[idx]), &status)) {
+      if (!sorted_tuples->PushBack(std::move(tuples[idx]), &status)) {
         return status;
       }
     }
@@ -931,7 +1881,7 @@ class SortTupleIterator : public TupleIterator {
   const std::unique_ptr<TupleIterator> input_iter_for_debug_string_;
   const std::unique_ptr<const TupleSchema> schema_;
   const std::unique_ptr<TupleComparator> comparator_;
-  std::unique_ptr<TupleDataDeque> tuples_;
+  std::unique_ptr<SpillableTupleSorter> tuples_;
   int64_t num_next_calls_ = 0;
   std::unique_ptr<TupleData> current_;
   EvaluationContext* context_;
@@ -940,7 +1890,7 @@ class SortTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> SortOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> SortOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   Value limit_value;   // Invalid if no limit set.
@@ -1008,12 +1958,49 @@ class SortTupleIterator : public TupleIterator {
 
   // If 'limit_offset' is set, 'top_n_outputs' contains the top
   // 'limit_offset.limit + limit_offset.offset' rows. Otherwise, 'outputs'
-  // contains all the rows.
-  auto top_n_outputs = absl::make_unique<TupleDataOrderedQueue>(
-      *comparator, context->memory_accountant());
-  auto outputs =
-      absl::make_unique<TupleDataDeque>(context->memory_accountant());
+  // contains all the rows, some of which may be spilled to disk.
+  std::unique_ptr<TupleDataBoundedHeap> top_n_outputs;
+  if (limit_offset.has_value()) {
+    const int64_t max_size =
+        limit_offset->limit >
+                std::numeric_limits<int64_t>::max() - limit_offset->offset
+            ? std::numeric_limits<int64_t>::max()
+            : limit_offset->limit + limit_offset->offset;
+    top_n_outputs = absl::make_unique<TupleDataBoundedHeap>(
+        *comparator, max_size, context->memory_accountant());
+  }
+  // If there is a partition limit, 'partitions' maps the values of the
+  // partition keys to the top rows of each partition, which are dumped into
+  // 'outputs' at the end.
+  struct Partition {
+    std::unique_ptr<TupleData> key;
+    std::unique_ptr<TupleDataBoundedHeap> top_n;
+  };
+  std::unique_ptr<TupleComparator> partition_comparator;
+  if (has_partition_limit()) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        partition_comparator,
+        TupleComparator::Create(
+            keys().subspan(0, num_partition_keys_),
+            absl::MakeConstSpan(slots_for_keys).subspan(0, num_partition_keys_),
+            params, context));
+  }
+  std::map<const TupleData*, Partition,
+           std::function<bool(const TupleData*, const TupleData*)>>
+      partitions([&partition_comparator](const TupleData* t1,
+                                         const TupleData* t2) {
+        return (*partition_comparator)(*t1, *t2);
+      });
+  // The rows from 'top_n_outputs' and 'partitions' are already in order, which
+  // a stable sort preserves.
+  auto outputs = absl::make_unique<SpillableTupleSorter>(
+      comparator.get(),
+      context->options().always_use_stable_sort || is_stable_sort_ ||
+          limit_offset.has_value() || has_partition_limit(),
+      context);
   zetasql_base::Status status;
+  // Reused for input rows that do not make it into 'top_n_outputs'.
+  std::unique_ptr<TupleData> next_output;
   while (true) {
     const TupleData* next_input = input_iter->Next();
     if (next_input == nullptr) {
@@ -1024,8 +2011,10 @@ class SortTupleIterator : public TupleIterator {
     const std::vector<const TupleData*> params_and_input_tuple =
         ConcatSpans(params, {next_input});
 
-    auto next_output = absl::make_unique<TupleData>(
-        keys().size() + values().size() + num_extra_slots);
+    if (next_output == nullptr) {
+      next_output = absl::make_unique<TupleData>(
+          keys().size() + values().size() + num_extra_slots);
+    }
     for (int i = 0; i < keys().size(); ++i) {
       TupleSlot* slot = next_output->mutable_slot(i);
       if (!keys()[i]->value_expr()->EvalSimple(params_and_input_tuple, context,
@@ -1042,12 +2031,30 @@ class SortTupleIterator : public TupleIterator {
     }
 
     if (limit_offset.has_value()) {
-      if (!top_n_outputs->Insert(std::move(next_output), &status)) {
+      // For a large input, most rows are not in the top n.
+      if (top_n_outputs->WouldKeep(*next_output) &&
+          !top_n_outputs->Insert(std::move(next_output), &status)) {
         return status;
       }
-      if (top_n_outputs->GetSize() >
-          limit_offset->limit + limit_offset->offset) {
-        top_n_outputs->PopBack();
+    } else if (has_partition_limit()) {
+      auto it = partitions.find(next_output.get());
+      if (it == partitions.end()) {
+        Partition partition;
+        partition.key = absl::make_unique<TupleData>(num_partition_keys_);
+        for (int i = 0; i < num_partition_keys_; ++i) {
+          partition.key->mutable_slot(i)->SetValue(
+              next_output->slot(i).value());
+        }
+        partition.top_n = absl::make_unique<TupleDataBoundedHeap>(
+            *comparator, partition_limit_, context->memory_accountant(),
+            partition_limit_with_ties_);
+        const TupleData* key = partition.key.get();
+        it = partitions.emplace(key, std::move(partition)).first;
+      }
+      TupleDataBoundedHeap* top_n = it->second.top_n.get();
+      if (top_n->WouldKeep(*next_output) &&
+          !top_n->Insert(std::move(next_output), &status)) {
+        return status;
       }
     } else {
       if (!outputs->PushBack(std::move(next_output), &status)) {
@@ -1061,15 +2068,14 @@ class SortTupleIterator : public TupleIterator {
   bool is_uniquely_ordered;
   if (limit_offset.has_value()) {
     ZETASQL_RET_CHECK(outputs->IsEmpty());
-    for (int i = 0; i < limit_offset->offset && !top_n_outputs->IsEmpty();
-         ++i) {
-      top_n_outputs->PopFront();
-    }
-    while (!top_n_outputs->IsEmpty()) {
-      if (!outputs->PushBack(top_n_outputs->PopFront(), &status)) {
+    std::vector<std::unique_ptr<TupleData>> top_n =
+        top_n_outputs->PopAllSorted();
+    for (int64_t i = limit_offset->offset; i < top_n.size(); ++i) {
+      if (!outputs->PushBack(std::move(top_n[i]), &status)) {
         return status;
       }
     }
+    ZETASQL_RETURN_IF_ERROR(outputs->Finish());
     // This is safe because 'limit_offset' is only set as an optimization, and
     // is not set for compliance or random query tests. If that changes, this
     // will cause spurious test failures due to asserting that things are in an
@@ -1077,12 +2083,26 @@ class SortTupleIterator : public TupleIterator {
     // ignoring failures.
     is_uniquely_ordered = true;
   } else {
-    ZETASQL_RET_CHECK(top_n_outputs->IsEmpty());
-    outputs->Sort(*comparator,
-                  context->options().always_use_stable_sort || is_stable_sort_);
-    const std::vector<const TupleData*> output_ptrs = outputs->GetTuplePtrs();
-    is_uniquely_ordered =
-        comparator->IsUniquelyOrdered(output_ptrs, slots_for_values);
+    ZETASQL_RET_CHECK(top_n_outputs == nullptr);
+    for (auto& entry : partitions) {
+      for (std::unique_ptr<TupleData>& output :
+           entry.second.top_n->PopAllSorted()) {
+        if (!outputs->PushBack(std::move(output), &status)) {
+          return status;
+        }
+      }
+    }
+    partitions.clear();
+    ZETASQL_RETURN_IF_ERROR(outputs->Finish());
+    if (outputs->spilled()) {
+      // We can't check this without reading the tuples back from disk.
+      is_uniquely_ordered = false;
+    } else {
+      const std::vector<const TupleData*> output_ptrs =
+          outputs->mutable_in_memory_tuples()->GetTuplePtrs();
+      is_uniquely_ordered =
+          comparator->IsUniquelyOrdered(output_ptrs, slots_for_values);
+    }
   }
   // We are done with 'top_n_outputs'. Deallocate it and crash if we ever
   // try to access it again.
@@ -1135,6 +2155,11 @@ std::string SortOp::DebugInternal(const std::string& indent,
                                   bool verbose) const {
   return absl::StrCat(
       "SortOp(", is_order_preserving() ? "ordered" : "unordered",
+      has_partition_limit()
+          ? absl::StrCat(", partition_limit: ", partition_limit_,
+                         partition_limit_with_ties_ ? " with ties" : "",
+                         " over ", num_partition_keys_, " partition keys")
+          : "",
       ArgDebugString(
           {"keys", "values", "limit", "offset", "input"},
           {kN, kN, has_limit() ? k1 : k0, has_offset() ? k1 : k0, k1}, indent,
@@ -1255,10 +2280,16 @@ class ComputeTupleIterator : public TupleIterator {
                        std::unique_ptr<TupleSchema> output_schema,
                        EvaluationContext* context)
       : expr_args_(expr_args.begin(), expr_args.end()),
-        params_(params.begin(), params.end()),
+        params_and_current_(params.begin(), params.end()),
         iter_(std::move(iter)),
         output_schema_(std::move(output_schema)),
-        context_(context) {}
+        context_(context) {
+    params_and_current_.push_back(nullptr);
+    for (const ExprArg* expr_arg : expr_args_) {
+      call_exprs_.push_back(dynamic_cast<const ScalarFunctionCallExpr*>(
+          expr_arg->value_expr()));
+    }
+  }
 
   ComputeTupleIterator(const ComputeTupleIterator&) = delete;
   ComputeTupleIterator& operator=(const ComputeTupleIterator&) = delete;
@@ -1271,28 +2302,48 @@ class ComputeTupleIterator : public TupleIterator {
       status_ = iter_->Status();
       return nullptr;
     }
+    if (!ComputeSlots(current)) return nullptr;
+    return current;
+  }
 
-    if (current->num_slots() < Schema().num_variables()) {
-      status_ = zetasql_base::InternalErrorBuilder()
-                << "ComputeTupleIterator::Next() found " << current->num_slots()
-                << " slots but expected at least " << Schema().num_variables();
-      return nullptr;
+  bool NextBatch(TupleBatch* batch) override {
+    if (!iter_->NextBatch(batch)) {
+      status_ = iter_->Status();
+      return false;
     }
-
+    for (int i = 0; i < batch->size(); ++i) {
+      if (!CheckNumSlots(batch->row(i))) return false;
+    }
+    // Computes one expression at a time for the whole batch, so that function
+    // calls go through ScalarFunctionBody::EvalBatch(). Every expression only
+    // depends on the ones before it, so this order is as valid as computing
+    // one row at a time.
+    const absl::Span<const TupleData* const> params =
+        absl::MakeConstSpan(params_and_current_)
+            .subspan(0, params_and_current_.size() - 1);
     for (int i = 0; i < expr_args_.size(); ++i) {
-      TupleSlot* slot =
-          current->mutable_slot(iter_->Schema().num_variables() + i);
+      const int slot_idx = iter_->Schema().num_variables() + i;
       ::zetasql_base::Status status;
-      if (!expr_args_[i]->value_expr()->EvalSimple(
-              ConcatSpans(absl::Span<const TupleData* const>(params_),
-                          {current}),
-              context_, slot, &status)) {
-        status_ = status;
-        return nullptr;
+      if (call_exprs_[i] != nullptr) {
+        if (!call_exprs_[i]->EvalBatch(params, slot_idx, context_, batch,
+                                       &status)) {
+          status_ = status;
+          return false;
+        }
+        continue;
+      }
+      for (int row = 0; row < batch->size(); ++row) {
+        TupleData* current = batch->mutable_row(row);
+        params_and_current_.back() = current;
+        if (!expr_args_[i]->value_expr()->EvalSimple(
+                params_and_current_, context_,
+                current->mutable_slot(slot_idx), &status)) {
+          status_ = status;
+          return false;
+        }
       }
     }
-
-    return current;
+    return true;
   }
 
   zetasql_base::Status Status() const override { return status_; }
@@ -1302,8 +2353,45 @@ class ComputeTupleIterator : public TupleIterator {
   }
 
  private:
+  // Populates the slots of 'current' following the variables of
+  // 'iter_->Schema()' with the results of 'expr_args_'. Returns false and
+  // updates 'status_' on error.
+  bool ComputeSlots(TupleData* current) {
+    if (!CheckNumSlots(*current)) return false;
+
+    params_and_current_.back() = current;
+    for (int i = 0; i < expr_args_.size(); ++i) {
+      TupleSlot* slot =
+          current->mutable_slot(iter_->Schema().num_variables() + i);
+      ::zetasql_base::Status status;
+      if (!expr_args_[i]->value_expr()->EvalSimple(params_and_current_,
+                                                   context_, slot, &status)) {
+        status_ = status;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Returns false and updates 'status_' if 'current' does not have a slot for
+  // each variable of Schema().
+  bool CheckNumSlots(const TupleData& current) {
+    if (current.num_slots() < Schema().num_variables()) {
+      status_ = zetasql_base::InternalErrorBuilder()
+                << "ComputeTupleIterator::Next() found " << current.num_slots()
+                << " slots but expected at least " << Schema().num_variables();
+      return false;
+    }
+    return true;
+  }
+
   const std::vector<const ExprArg*> expr_args_;
-  const std::vector<const TupleData*> params_;
+  // For each element of 'expr_args_', its expression if it is a function call,
+  // which NextBatch() evaluates for the whole batch at once, or NULL.
+  std::vector<const ScalarFunctionCallExpr*> call_exprs_;
+  // The parameters followed by the tuple that is currently being augmented.
+  // Reused across tuples to avoid concatenating the parameters for each one.
+  std::vector<const TupleData*> params_and_current_;
 
   std::unique_ptr<TupleIterator> iter_;
   std::unique_ptr<TupleSchema> output_schema_;
@@ -1312,7 +2400,7 @@ class ComputeTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> ComputeOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> ComputeOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   ZETASQL_ASSIGN_OR_RETURN(
@@ -1320,6 +2408,7 @@ class ComputeTupleIterator : public TupleIterator {
       input()->CreateIterator(params, num_extra_slots + map().size(), context));
   iter = absl::make_unique<ComputeTupleIterator>(params, map(), std::move(iter),
                                                  CreateOutputSchema(), context);
+  iter = MaybeBatch(std::move(iter), context);
   return MaybeReorder(std::move(iter), context);
 }
 
@@ -1400,9 +2489,11 @@ class FilterTupleIterator : public TupleIterator {
                       std::unique_ptr<TupleIterator> iter,
                       EvaluationContext* context)
       : predicate_(predicate),
-        params_(params.begin(), params.end()),
+        params_and_current_(params.begin(), params.end()),
         iter_(std::move(iter)),
-        context_(context) {}
+        context_(context) {
+    params_and_current_.push_back(nullptr);
+  }
 
   FilterTupleIterator(const FilterTupleIterator&) = delete;
   FilterTupleIterator& operator=(const FilterTupleIterator&) = delete;
@@ -1417,80 +2508,517 @@ class FilterTupleIterator : public TupleIterator {
         return nullptr;
       }
 
-      TupleSlot slot;
-      ::zetasql_base::Status status;
-      if (!predicate_->EvalSimple(
-              ConcatSpans(absl::Span<const TupleData* const>(params_),
-                          {current}),
-              context_, &slot, &status)) {
-        status_ = status;
-        return nullptr;
-      }
-      if (slot.value() == Bool(true)) {
-        return current;
-      }
+      bool matches;
+      if (!EvalPredicate(current, &matches)) return nullptr;
+      if (matches) {
+        return current;
+      }
+    }
+  }
+
+  bool NextBatch(TupleBatch* batch) override {
+    while (iter_->NextBatch(batch)) {
+      selected_rows_.clear();
+      for (int i = 0; i < batch->size(); ++i) {
+        bool matches;
+        if (!EvalPredicate(batch->mutable_row(i), &matches)) return false;
+        if (matches) {
+          selected_rows_.push_back(i);
+        }
+      }
+      batch->SelectRows(selected_rows_);
+      if (!batch->IsEmpty()) {
+        return true;
+      }
+    }
+    status_ = iter_->Status();
+    return false;
+  }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  std::string DebugString() const override {
+    return FilterOp::GetIteratorDebugString(iter_->DebugString());
+  }
+
+ private:
+  // Sets 'matches' to true if 'predicate_' evaluates to Bool(true) on
+  // 'current'. Returns false and updates 'status_' on error.
+  bool EvalPredicate(const TupleData* current, bool* matches) {
+    // A selective filter can read many tuples per call to Next(), so it checks
+    // for cancellation itself.
+    if (num_tuples_evaluated_++ %
+            absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period) ==
+        0) {
+      status_ = context_->VerifyNotAborted();
+      if (!status_.ok()) return false;
+    }
+    params_and_current_.back() = current;
+    TupleSlot slot;
+    ::zetasql_base::Status status;
+    if (!predicate_->EvalSimple(params_and_current_, context_, &slot,
+                                &status)) {
+      status_ = status;
+      return false;
+    }
+    *matches = slot.value() == Bool(true);
+    return true;
+  }
+
+  const ValueExpr* predicate_;
+  // The parameters followed by the tuple that is currently being filtered.
+  // Reused across tuples to avoid concatenating the parameters for each one.
+  std::vector<const TupleData*> params_and_current_;
+  std::unique_ptr<TupleIterator> iter_;
+  // Positions in the current batch of the tuples that pass the filter. Only
+  // used by NextBatch().
+  std::vector<int> selected_rows_;
+  zetasql_base::Status status_;
+  EvaluationContext* context_;
+  // The number of calls to EvalPredicate(). Used to call
+  // context_->VerifyNotAborted() periodically.
+  int64_t num_tuples_evaluated_ = 0;
+};
+}  // namespace
+
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> FilterOp::CreateIteratorInternal(
+    absl::Span<const TupleData* const> params, int num_extra_slots,
+    EvaluationContext* context) const {
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
+                   input()->CreateIterator(params, num_extra_slots, context));
+  iter = absl::make_unique<FilterTupleIterator>(params, predicate(),
+                                                std::move(iter), context);
+  iter = MaybeBatch(std::move(iter), context);
+  return MaybeReorder(std::move(iter), context);
+}
+
+std::unique_ptr<TupleSchema> FilterOp::CreateOutputSchema() const {
+  return input()->CreateOutputSchema();
+}
+
+std::string FilterOp::IteratorDebugString() const {
+  return GetIteratorDebugString(input()->IteratorDebugString());
+}
+
+std::string FilterOp::DebugInternal(const std::string& indent,
+                                    bool verbose) const {
+  return absl::StrCat(
+      "FilterOp(",
+      ArgDebugString({"condition", "input"}, {k1, k1}, indent, verbose), ")");
+}
+
+FilterOp::FilterOp(std::unique_ptr<ValueExpr> predicate,
+                   std::unique_ptr<RelationalOp> input) {
+  SetArg(kPredicate, absl::make_unique<ExprArg>(std::move(predicate)));
+  SetArg(kInput, absl::make_unique<RelationalArg>(std::move(input)));
+}
+
+const ValueExpr* FilterOp::predicate() const {
+  return GetArg(kPredicate)->node()->AsValueExpr();
+}
+
+ValueExpr* FilterOp::mutable_predicate() {
+  return GetMutableArg(kPredicate)->mutable_node()->AsMutableValueExpr();
+}
+
+const RelationalOp* FilterOp::input() const {
+  return GetArg(kInput)->node()->AsRelationalOp();
+}
+
+RelationalOp* FilterOp::mutable_input() {
+  return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
+}
+
+// -------------------------------------------------------
+// ExchangeOp
+// -------------------------------------------------------
+
+std::string ExchangeOp::GetIteratorDebugString(
+    absl::string_view input_iter_debug_string) {
+  return absl::StrCat("ExchangeTupleIterator(", input_iter_debug_string, ")");
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<ExchangeOp>> ExchangeOp::Create(
+    std::unique_ptr<RelationalOp> input,
+    const EvaluatorTableScanOp* partitioned_scan) {
+  ZETASQL_RET_CHECK(partitioned_scan != nullptr);
+  return absl::WrapUnique(new ExchangeOp(std::move(input), partitioned_scan));
+}
+
+::zetasql_base::Status ExchangeOp::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  return mutable_input()->SetSchemasForEvaluation(params_schemas);
+}
+
+namespace {
+// Runs a producer function on one thread per child context and passes the
+// tuples that the producers emit to a single consumer through a bounded queue
+// of chunks.
+//
+// If EvaluatorExecutor::TaskGroup::Current() is set, the producers are tasks
+// of that group instead of new threads. Next() runs the producers whose tasks
+// the executor rejected, or has not started after kStartDelay, on the
+// consumer's thread (without the bound on the queue), so the tuples are all
+// produced even when the executor's threads are busy.
+class ParallelTupleProducers {
+ public:
+  // Adds a copy of a tuple to the output. Returns false if the producer should
+  // stop instead.
+  using EmitFn = std::function<bool(const TupleData&)>;
+  // Produces the tuples of the 'i'-th producer using 'context'.
+  using ProduceFn = std::function<zetasql_base::Status(
+      int i, EvaluationContext* context, const EmitFn& emit)>;
+
+  // Starts one thread or task per element of 'child_contexts', which are
+  // merged into 'context' once the producers finish.
+  ParallelTupleProducers(
+      std::vector<std::unique_ptr<EvaluationContext>> child_contexts,
+      ProduceFn produce, EvaluationContext* context)
+      : produce_(std::move(produce)),
+        context_(context),
+        child_contexts_(std::move(child_contexts)),
+        task_group_(EvaluatorExecutor::TaskGroup::Current()),
+        may_take_back_tasks_(task_group_ != nullptr) {
+    num_running_producers_ = static_cast<int>(child_contexts_.size());
+    if (task_group_ == nullptr) {
+      threads_.reserve(child_contexts_.size());
+      for (int i = 0; i < child_contexts_.size(); ++i) {
+        threads_.emplace_back([this, i] { Produce(i, /*on_consumer=*/false); });
+      }
+      return;
+    }
+    tasks_.resize(child_contexts_.size());
+    for (int i = 0; i < child_contexts_.size(); ++i) {
+      tasks_[i] = task_group_->Schedule(
+          [this, i] { Produce(i, /*on_consumer=*/false); });
+      if (tasks_[i] == nullptr) rejected_producers_.push_back(i);
+    }
+  }
+
+  ParallelTupleProducers(const ParallelTupleProducers&) = delete;
+  ParallelTupleProducers& operator=(const ParallelTupleProducers&) = delete;
+
+  ~ParallelTupleProducers() {
+    {
+      absl::MutexLock lock(&mutex_);
+      cancelled_ = true;
+    }
+    // Producers that are busy between two pushes stop at their next check for
+    // cancellation instead of finishing their work.
+    for (const std::unique_ptr<EvaluationContext>& child : child_contexts_) {
+      child->SetCancelled();
+    }
+    JoinProducers();
+  }
+
+  // Returns the next tuple, or NULL if the producers are done or one of them
+  // failed, in which case status() returns the error.
+  TupleData* Next() {
+    if (next_row_in_chunk_ < current_chunk_.size()) {
+      return &current_chunk_[next_row_in_chunk_++];
+    }
+    if (done_) return nullptr;
+
+    while (true) {
+      if (!rejected_producers_.empty() && QueueIsEmpty()) {
+        const int i = rejected_producers_.front();
+        rejected_producers_.pop_front();
+        Produce(i, /*on_consumer=*/true);
+        continue;
+      }
+      if (may_take_back_tasks_ && !AwaitCanPop(kStartDelay)) {
+        may_take_back_tasks_ = TakeBackUnstartedTask();
+        continue;
+      }
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &ParallelTupleProducers::CanPop));
+      if (!producer_status_.ok()) {
+        status_ = producer_status_;
+        cancelled_ = true;
+      } else if (!queue_.empty()) {
+        current_chunk_ = std::move(queue_.front());
+        queue_.pop_front();
+        next_row_in_chunk_ = 0;
+        return &current_chunk_[next_row_in_chunk_++];
+      }
+      break;
+    }
+    // Either all the producers are done or one of them failed.
+    done_ = true;
+    JoinProducers();
+    return nullptr;
+  }
+
+  const zetasql_base::Status& status() const { return status_; }
+
+ private:
+  // The maximum number of tuples that a producer passes to Next() at once.
+  static constexpr int kMaxChunkSize = 256;
+  // The maximum number of chunks in 'queue_' per producer.
+  static constexpr int kMaxQueuedChunksPerProducer = 4;
+  // How long Next() waits for tuples before it runs a producer whose task has
+  // not started on the consumer's thread.
+  static constexpr absl::Duration kStartDelay = absl::Milliseconds(10);
+
+  // Runs 'produce_' with the 'i'-th child context and pushes the results onto
+  // 'queue_'. If 'on_consumer' is true, runs on the thread that calls Next(),
+  // so it must not wait for space in 'queue_'.
+  void Produce(int i, bool on_consumer) {
+    std::vector<TupleData> chunk;
+    chunk.reserve(kMaxChunkSize);
+    const EmitFn emit = [this, &chunk, on_consumer](const TupleData& tuple) {
+      chunk.push_back(tuple);
+      return chunk.size() < kMaxChunkSize || Push(&chunk, on_consumer);
+    };
+    zetasql_base::Status status = produce_(i, child_contexts_[i].get(), emit);
+    if (status.ok() && !chunk.empty()) Push(&chunk, on_consumer);
+
+    absl::MutexLock lock(&mutex_);
+    if (!status.ok() && producer_status_.ok()) {
+      producer_status_ = status;
+    }
+    --num_running_producers_;
+  }
+
+  // Moves 'chunk' onto 'queue_', waiting for space if necessary unless
+  // 'on_consumer' is true, and leaves 'chunk' empty. Returns false if the
+  // producers should stop instead.
+  bool Push(std::vector<TupleData>* chunk, bool on_consumer) {
+    absl::MutexLock lock(&mutex_);
+    if (!on_consumer) {
+      mutex_.Await(absl::Condition(this, &ParallelTupleProducers::CanPush));
+    }
+    if (cancelled_) return false;
+    queue_.push_back(std::move(*chunk));
+    chunk->clear();
+    chunk->reserve(kMaxChunkSize);
+    return true;
+  }
+
+  // If the task of a producer has not started, cancels it and runs the
+  // producer on this thread. Returns false if all the tasks have started.
+  bool TakeBackUnstartedTask() {
+    for (int i = 0; i < tasks_.size(); ++i) {
+      if (tasks_[i] != nullptr && task_group_->Cancel(tasks_[i].get())) {
+        tasks_[i].reset();
+        Produce(i, /*on_consumer=*/true);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool QueueIsEmpty() {
+    absl::MutexLock lock(&mutex_);
+    return queue_.empty();
+  }
+
+  // Waits up to 'timeout' for CanPop() and returns it.
+  bool AwaitCanPop(absl::Duration timeout) {
+    absl::MutexLock lock(&mutex_);
+    return mutex_.AwaitWithTimeout(
+        absl::Condition(this, &ParallelTupleProducers::CanPop), timeout);
+  }
+
+  bool CanPop() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !queue_.empty() || num_running_producers_ == 0 ||
+           !producer_status_.ok();
+  }
+
+  bool CanPush() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return cancelled_ || queue_.size() < kMaxQueuedChunksPerProducer *
+                                             child_contexts_.size();
+  }
+
+  // Waits for the producers to finish and merges their contexts into
+  // 'context_'. Unless the producers are already done, 'cancelled_' must be
+  // set first. Producers that have not started never run. Does nothing if
+  // called a second time.
+  void JoinProducers() {
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+    for (const std::shared_ptr<EvaluatorExecutor::Task>& task : tasks_) {
+      if (task != nullptr && !task_group_->Cancel(task.get())) {
+        task_group_->Wait(task.get());
+      }
+    }
+    tasks_.clear();
+    rejected_producers_.clear();
+    for (const std::unique_ptr<EvaluationContext>& child : child_contexts_) {
+      context_->MergeChildContext(*child);
+    }
+    child_contexts_.clear();
+  }
+
+  const ProduceFn produce_;
+  EvaluationContext* context_;
+  // The i-th producer runs with the i-th child context.
+  std::vector<std::unique_ptr<EvaluationContext>> child_contexts_;
+  // Used if 'task_group_' is NULL.
+  std::vector<std::thread> threads_;
+  // Otherwise, the i-th element of 'tasks_' runs the i-th producer, or is
+  // NULL if the producer runs (or ran) on the consumer's thread instead.
+  EvaluatorExecutor::TaskGroup* const task_group_;
+  std::vector<std::shared_ptr<EvaluatorExecutor::Task>> tasks_;
+  // The producers whose tasks the executor rejected, which Next() runs.
+  std::deque<int> rejected_producers_;
+  // False once Next() knows that all the tasks have started.
+  bool may_take_back_tasks_;
+
+  absl::Mutex mutex_;
+  std::deque<std::vector<TupleData>> queue_ ABSL_GUARDED_BY(mutex_);
+  int num_running_producers_ ABSL_GUARDED_BY(mutex_) = 0;
+  // The first error returned by a producer.
+  zetasql_base::Status producer_status_ ABSL_GUARDED_BY(mutex_);
+  // Tells the producers to stop.
+  bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // The chunk that Next() is currently returning tuples from.
+  std::vector<TupleData> current_chunk_;
+  int next_row_in_chunk_ = 0;
+  // True if Next() has returned nullptr.
+  bool done_ = false;
+  zetasql_base::Status status_;
+};
+
+// Returns copies of 'params', so that producer threads do not depend on the
+// lifetime of the parameters passed to an iterator's constructor.
+std::vector<TupleData> CopyParams(absl::Span<const TupleData* const> params) {
+  std::vector<TupleData> copies;
+  copies.reserve(params.size());
+  for (const TupleData* param : params) {
+    copies.push_back(*param);
+  }
+  return copies;
+}
+
+// Returns pointers to the elements of 'params'.
+std::vector<const TupleData*> GetParamPtrs(
+    const std::vector<TupleData>& params) {
+  std::vector<const TupleData*> ptrs;
+  ptrs.reserve(params.size());
+  for (const TupleData& param : params) {
+    ptrs.push_back(&param);
+  }
+  return ptrs;
+}
+
+// Evaluates an ExchangeOp's input on several threads, each of which pushes
+// chunks of tuples onto a bounded queue that Next() pops from.
+class ExchangeTupleIterator : public TupleIterator {
+ public:
+  // Starts the threads. 'params' are copied, so they only need to remain valid
+  // during this call.
+  ExchangeTupleIterator(const RelationalOp* input,
+                        const RelationalOp* partitioned_scan,
+                        absl::Span<const TupleData* const> params,
+                        int num_extra_slots, int num_partitions,
+                        EvaluationContext* context)
+      : input_(input),
+        schema_(input->CreateOutputSchema()),
+        num_extra_slots_(num_extra_slots),
+        params_(CopyParams(params)),
+        param_ptrs_(GetParamPtrs(params_)) {
+    // The threads share the memory budget of the statement.
+    const int64_t max_intermediate_byte_size =
+        context->options().max_intermediate_byte_size / num_partitions;
+    std::vector<std::unique_ptr<EvaluationContext>> child_contexts;
+    for (int i = 0; i < num_partitions; ++i) {
+      child_contexts.push_back(context->CreateChildContext(
+          max_intermediate_byte_size, partitioned_scan, i, num_partitions));
     }
+    producers_ = absl::make_unique<ParallelTupleProducers>(
+        std::move(child_contexts),
+        [this](int i, EvaluationContext* context,
+               const ParallelTupleProducers::EmitFn& emit) {
+          return Produce(context, emit);
+        },
+        context);
   }
 
-  zetasql_base::Status Status() const override { return status_; }
+  ExchangeTupleIterator(const ExchangeTupleIterator&) = delete;
+  ExchangeTupleIterator& operator=(const ExchangeTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return *schema_; }
+
+  TupleData* Next() override { return producers_->Next(); }
+
+  zetasql_base::Status Status() const override { return producers_->status(); }
 
   std::string DebugString() const override {
-    return FilterOp::GetIteratorDebugString(iter_->DebugString());
+    return ExchangeOp::GetIteratorDebugString(input_->IteratorDebugString());
   }
 
  private:
-  const ValueExpr* predicate_;
-  const std::vector<const TupleData*> params_;
-  std::unique_ptr<TupleIterator> iter_;
-  zetasql_base::Status status_;
-  EvaluationContext* context_;
+  // Evaluates 'input_' with 'context' and emits the results.
+  zetasql_base::Status Produce(EvaluationContext* context,
+                       const ParallelTupleProducers::EmitFn& emit) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<TupleIterator> iter,
+        input_->CreateIterator(param_ptrs_, num_extra_slots_, context));
+    while (true) {
+      const TupleData* tuple = iter->Next();
+      if (tuple == nullptr) return iter->Status();
+      if (!emit(*tuple)) return zetasql_base::OkStatus();
+    }
+  }
+
+  const RelationalOp* input_;
+  const std::unique_ptr<TupleSchema> schema_;
+  const int num_extra_slots_;
+  const std::vector<TupleData> params_;
+  const std::vector<const TupleData*> param_ptrs_;
+  // Declared last so that the producers stop before the members they use are
+  // destroyed.
+  std::unique_ptr<ParallelTupleProducers> producers_;
 };
 }  // namespace
 
-zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> FilterOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> ExchangeOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
-                   input()->CreateIterator(params, num_extra_slots, context));
-  iter = absl::make_unique<FilterTupleIterator>(params, predicate(),
-                                                std::move(iter), context);
+  const int num_partitions =
+      num_partitions_ > 0 ? num_partitions_ : context->options().num_threads;
+  if (num_partitions <= 1) {
+    return input()->CreateIterator(params, num_extra_slots, context);
+  }
+  std::unique_ptr<TupleIterator> iter =
+      absl::make_unique<ExchangeTupleIterator>(input(), partitioned_scan_,
+                                               params, num_extra_slots,
+                                               num_partitions, context);
   return MaybeReorder(std::move(iter), context);
 }
 
-std::unique_ptr<TupleSchema> FilterOp::CreateOutputSchema() const {
+std::unique_ptr<TupleSchema> ExchangeOp::CreateOutputSchema() const {
   return input()->CreateOutputSchema();
 }
 
-std::string FilterOp::IteratorDebugString() const {
+std::string ExchangeOp::IteratorDebugString() const {
   return GetIteratorDebugString(input()->IteratorDebugString());
 }
 
-std::string FilterOp::DebugInternal(const std::string& indent,
-                                    bool verbose) const {
+std::string ExchangeOp::DebugInternal(const std::string& indent,
+                                      bool verbose) const {
   return absl::StrCat(
-      "FilterOp(",
-      ArgDebugString({"condition", "input"}, {k1, k1}, indent, verbose), ")");
+      "ExchangeOp(",
+      num_partitions_ > 0 ? absl::StrCat("num_partitions=", num_partitions_)
+                          : "",
+      ArgDebugString({"input"}, {k1}, indent, verbose), ")");
 }
 
-FilterOp::FilterOp(std::unique_ptr<ValueExpr> predicate,
-                   std::unique_ptr<RelationalOp> input) {
-  SetArg(kPredicate, absl::make_unique<ExprArg>(std::move(predicate)));
+ExchangeOp::ExchangeOp(std::unique_ptr<RelationalOp> input,
+                       const EvaluatorTableScanOp* partitioned_scan)
+    : partitioned_scan_(partitioned_scan) {
   SetArg(kInput, absl::make_unique<RelationalArg>(std::move(input)));
 }
 
-const ValueExpr* FilterOp::predicate() const {
-  return GetArg(kPredicate)->node()->AsValueExpr();
-}
-
-ValueExpr* FilterOp::mutable_predicate() {
-  return GetMutableArg(kPredicate)->mutable_node()->AsMutableValueExpr();
-}
-
-const RelationalOp* FilterOp::input() const {
+const RelationalOp* ExchangeOp::input() const {
   return GetArg(kInput)->node()->AsRelationalOp();
 }
 
-RelationalOp* FilterOp::mutable_input() {
+RelationalOp* ExchangeOp::mutable_input() {
   return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
 }
 
@@ -1562,10 +3090,38 @@ class LimitTupleIterator : public TupleIterator {
       return nullptr;
     }
     ++next_iter_row_number_;
+    ++num_output_tuples_;
 
     return current;
   }
 
+  bool NextBatch(TupleBatch* batch) override {
+    while (true) {
+      // Don't return more than 'count_' tuples from 'iter_'.
+      if (next_iter_row_number_ >= offset_ + count_) {
+        Finish(absl::nullopt, batch);
+        return false;
+      }
+
+      if (!iter_->NextBatch(batch)) {
+        Finish(iter_->Status(), batch);
+        return false;
+      }
+      const int64_t batch_row_number = next_iter_row_number_;
+      next_iter_row_number_ += batch->size();
+
+      // Skip the tuples before 'offset_' and after 'offset_ + count_'.
+      const int64_t begin = std::max<int64_t>(0, offset_ - batch_row_number);
+      const int64_t end = std::min<int64_t>(
+          batch->size(), offset_ + count_ - batch_row_number);
+      if (begin < end) {
+        batch->SelectRange(begin, end);
+        num_output_tuples_ += batch->size();
+        return true;
+      }
+    }
+  }
+
   zetasql_base::Status Status() const override { return status_; }
 
   std::string DebugString() const override {
@@ -1574,28 +3130,32 @@ class LimitTupleIterator : public TupleIterator {
 
  private:
   // Update 'status_' and 'context_' to indicate that the iterator is done. If
-  // 'iter_' is done, 'iter_status' contains its status.
-  void Finish(absl::optional<zetasql_base::Status> iter_status) {
+  // 'iter_' is done, 'iter_status' contains its status. If 'batch' is
+  // non-NULL, any further tuples are read from 'iter_' with NextBatch() using
+  // 'batch' as scratch space instead of with Next().
+  void Finish(absl::optional<zetasql_base::Status> iter_status,
+              TupleBatch* batch = nullptr) {
     if (iter_status.has_value()) {
       status_ = iter_status.value();
     }
     // The ZetaSQL behavior is non-deterministic if the underlying iterator
     // does not preserve order, there is more than one input tuple, there is at
     // least one output tuple, and not every input tuple is output.
-    const bool has_output = next_iter_row_number_ > offset_;
+    const bool has_output = num_output_tuples_ > 0;
     const bool output_everything = offset_ == 0 && iter_status.has_value();
     if (!iter_->PreservesOrder() && has_output && !output_everything) {
       // Read at least two rows from 'iter_' if possible, so that we can
       // determine if the input has more than one row.
       while (next_iter_row_number_ <= 1 && !iter_status.has_value()) {
-        const TupleData* current = iter_->Next();
-        if (current == nullptr) {
+        const bool has_next = batch == nullptr ? iter_->Next() != nullptr
+                                               : iter_->NextBatch(batch);
+        if (!has_next) {
           status_ = iter_->Status();
           if (!status_.ok()) return;
           iter_status = status_;
           break;
         }
-        ++next_iter_row_number_;
+        next_iter_row_number_ += batch == nullptr ? 1 : batch->size();
       }
       if (next_iter_row_number_ >= 2) {
         context_->SetNonDeterministicOutput();
@@ -1609,11 +3169,13 @@ class LimitTupleIterator : public TupleIterator {
   std::unique_ptr<TupleIterator> iter_;
   // The row number of the next tuple returned by iter_->Next().
   int64_t next_iter_row_number_ = 0;
+  // The number of tuples returned from Next() or NextBatch() so far.
+  int64_t num_output_tuples_ = 0;
   zetasql_base::Status status_;
 };
 }  // namespace
 
-zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LimitOp::CreateIterator(
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LimitOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   TupleSlot count_slot;
@@ -1643,6 +3205,7 @@ zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LimitOp::CreateIterator(
   iter = absl::make_unique<LimitTupleIterator>(count.int64_value(),
                                                offset_value.int64_value(),
                                                context, std::move(iter));
+  iter = MaybeBatch(std::move(iter), context);
   // Scramble the output if the scrambling is enabled and either the underlying
   // iterator scrambles or this operator does not preserve order.
   if (context->options().scramble_undefined_orderings &&
@@ -1701,6 +3264,340 @@ RelationalOp* LimitOp::mutable_input() {
   return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
 }
 
+// -------------------------------------------------------
+// SampleScanOp
+// -------------------------------------------------------
+
+std::string SampleScanOp::GetIteratorDebugString(
+    Method method, absl::string_view input_iter_debug_string) {
+  return absl::StrCat(method == kBernoulli ? "Bernoulli" : "Reservoir",
+                      "SampleTupleIterator(", input_iter_debug_string, ")");
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<SampleScanOp>> SampleScanOp::Create(
+    Method method, std::unique_ptr<ValueExpr> size,
+    std::unique_ptr<ValueExpr> repeatable,
+    std::vector<std::unique_ptr<ExprArg>> partition_keys,
+    const VariableId& weight, std::unique_ptr<RelationalOp> input) {
+  switch (method) {
+    case kBernoulli:
+      ZETASQL_RET_CHECK(size->output_type()->IsInt64() ||
+                size->output_type()->IsDouble());
+      ZETASQL_RET_CHECK(partition_keys.empty());
+      break;
+    case kReservoir:
+      ZETASQL_RET_CHECK(size->output_type()->IsInt64());
+      break;
+  }
+  ZETASQL_RET_CHECK(repeatable == nullptr || repeatable->output_type()->IsInt64());
+  return absl::WrapUnique(new SampleScanOp(
+      method, std::move(size), std::move(repeatable), std::move(partition_keys),
+      weight, std::move(input)));
+}
+
+::zetasql_base::Status SampleScanOp::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  ZETASQL_RETURN_IF_ERROR(mutable_size()->SetSchemasForEvaluation(params_schemas));
+  if (repeatable() != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(mutable_repeatable()->SetSchemasForEvaluation(params_schemas));
+  }
+  ZETASQL_RETURN_IF_ERROR(mutable_input()->SetSchemasForEvaluation(params_schemas));
+
+  const std::unique_ptr<const TupleSchema> input_schema =
+      input()->CreateOutputSchema();
+  for (ExprArg* key : mutable_partition_keys()) {
+    ZETASQL_RETURN_IF_ERROR(key->mutable_value_expr()->SetSchemasForEvaluation(
+        ConcatSpans(params_schemas, {input_schema.get()})));
+  }
+  return zetasql_base::OkStatus();
+}
+
+namespace {
+// Returns 'size' tuples of an underlying iterator, or all of them if there are
+// fewer, chosen uniformly at random with reservoir sampling, for each
+// partition by 'partition_keys'. The partitions are returned in the order in
+// which their first tuples arrive. If 'weight_slot' is non-negative, sets that
+// slot of each tuple to the number of tuples in its partition divided by the
+// number of sampled ones.
+class ReservoirSampleTupleIterator : public TupleIterator {
+ public:
+  ReservoirSampleTupleIterator(absl::Span<const TupleData* const> params,
+                               int64_t size, std::mt19937_64 rng,
+                               absl::Span<const ExprArg* const> partition_keys,
+                               int weight_slot,
+                               std::unique_ptr<TupleIterator> iter,
+                               std::unique_ptr<TupleSchema> output_schema,
+                               EvaluationContext* context)
+      : size_(size),
+        rng_(std::move(rng)),
+        partition_keys_(partition_keys.begin(), partition_keys.end()),
+        weight_slot_(weight_slot),
+        params_and_current_(params.begin(), params.end()),
+        iter_(std::move(iter)),
+        output_schema_(std::move(output_schema)),
+        context_(context) {
+    params_and_current_.push_back(nullptr);
+  }
+
+  ReservoirSampleTupleIterator(const ReservoirSampleTupleIterator&) = delete;
+  ReservoirSampleTupleIterator& operator=(
+      const ReservoirSampleTupleIterator&) = delete;
+
+  ~ReservoirSampleTupleIterator() override {
+    for (Partition& partition : partitions_) {
+      for (Entry& entry : partition.sample) {
+        context_->memory_accountant()->ReturnTupleBytes(*entry.data,
+                                                        entry.byte_size);
+      }
+    }
+  }
+
+  const TupleSchema& Schema() const override { return *output_schema_; }
+
+  TupleData* Next() override {
+    if (!sampled_) {
+      if (!SampleInput()) return nullptr;
+      sampled_ = true;
+    }
+    while (next_partition_ < partitions_.size()) {
+      const Partition& partition = partitions_[next_partition_];
+      if (next_tuple_ < partition.sample.size()) {
+        TupleData* tuple = partition.sample[next_tuple_++].data.get();
+        if (weight_slot_ >= 0) {
+          tuple->mutable_slot(weight_slot_)
+              ->SetValue(values::Double(
+                  static_cast<double>(partition.num_tuples) /
+                  static_cast<double>(partition.sample.size())));
+        }
+        return tuple;
+      }
+      ++next_partition_;
+      next_tuple_ = 0;
+    }
+    return nullptr;
+  }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  std::string DebugString() const override {
+    return SampleScanOp::GetIteratorDebugString(SampleScanOp::kReservoir,
+                                                iter_->DebugString());
+  }
+
+ private:
+  struct Entry {
+    // The memory reservation of 'data'.
+    int64_t byte_size;
+    std::unique_ptr<TupleData> data;
+  };
+
+  struct Partition {
+    // The number of tuples of the input in the partition.
+    int64_t num_tuples = 0;
+    std::vector<Entry> sample;
+  };
+
+  // Reads the whole input into 'partitions_'. Returns false and updates
+  // 'status_' on error.
+  bool SampleInput() {
+    absl::flat_hash_map<std::vector<Value>, int> partition_idxs;
+    std::vector<Value> key;
+    bool dropped_tuples = false;
+    while (true) {
+      const TupleData* current = iter_->Next();
+      if (current == nullptr) {
+        status_ = iter_->Status();
+        if (!status_.ok()) return false;
+        break;
+      }
+      if (num_tuples_read_++ %
+              absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period) ==
+          0) {
+        status_ = context_->VerifyNotAborted();
+        if (!status_.ok()) return false;
+      }
+
+      params_and_current_.back() = current;
+      key.clear();
+      for (const ExprArg* partition_key : partition_keys_) {
+        TupleSlot slot;
+        if (!partition_key->value_expr()->EvalSimple(
+                params_and_current_, context_, &slot, &status_)) {
+          return false;
+        }
+        key.push_back(slot.value());
+      }
+      const auto inserted =
+          partition_idxs.emplace(key, static_cast<int>(partitions_.size()));
+      if (inserted.second) partitions_.emplace_back();
+      Partition& partition = partitions_[inserted.first->second];
+
+      // Algorithm R: the n-th tuple replaces a random sampled one with
+      // probability 'size_' / n.
+      const int64_t tuple_idx = partition.num_tuples++;
+      int64_t sample_idx = tuple_idx;
+      if (tuple_idx >= size_) {
+        dropped_tuples = true;
+        sample_idx = std::uniform_int_distribution<int64_t>(0, tuple_idx)(rng_);
+        if (sample_idx >= size_) continue;
+      }
+      auto data = absl::make_unique<TupleData>(*current);
+      const int64_t byte_size = data->GetPhysicalByteSize() + sizeof(Entry);
+      if (!context_->memory_accountant()->RequestTupleBytes(*data, byte_size,
+                                                            &status_)) {
+        return false;
+      }
+      if (sample_idx < partition.sample.size()) {
+        Entry& entry = partition.sample[sample_idx];
+        context_->memory_accountant()->ReturnTupleBytes(*entry.data,
+                                                        entry.byte_size);
+        entry = Entry{byte_size, std::move(data)};
+      } else {
+        partition.sample.push_back(Entry{byte_size, std::move(data)});
+      }
+    }
+    if (dropped_tuples && size_ > 0) context_->SetNonDeterministicOutput();
+    return true;
+  }
+
+  const int64_t size_;
+  std::mt19937_64 rng_;
+  const std::vector<const ExprArg*> partition_keys_;
+  const int weight_slot_;
+  // The parameters followed by the tuple that is being partitioned.
+  std::vector<const TupleData*> params_and_current_;
+  std::unique_ptr<TupleIterator> iter_;
+  const std::unique_ptr<TupleSchema> output_schema_;
+  EvaluationContext* context_;
+  int64_t num_tuples_read_ = 0;
+  // True once SampleInput() has populated 'partitions_'.
+  bool sampled_ = false;
+  std::vector<Partition> partitions_;
+  // The position of the next tuple to return.
+  int next_partition_ = 0;
+  int64_t next_tuple_ = 0;
+  zetasql_base::Status status_;
+};
+}  // namespace
+
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>>
+SampleScanOp::CreateIteratorInternal(absl::Span<const TupleData* const> params,
+                                     int num_extra_slots,
+                                     EvaluationContext* context) const {
+  ZETASQL_ASSIGN_OR_RETURN(const Value size_value,
+                   EvalSampleArg(size(), params, context));
+  absl::optional<int64_t> seed;
+  if (repeatable() != nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(const Value seed_value,
+                     EvalSampleArg(repeatable(), params, context));
+    ZETASQL_ASSIGN_OR_RETURN(seed, GetSampleSeed(seed_value));
+  }
+
+  const int num_weight_slots = weight_.is_valid() ? 1 : 0;
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<TupleIterator> iter,
+      input()->CreateIterator(params, num_extra_slots + num_weight_slots,
+                              context));
+  const int weight_slot =
+      weight_.is_valid() ? iter->Schema().num_variables() : -1;
+  std::mt19937_64 rng =
+      CreateSampleRandomGenerator(seed, /*partition_index=*/0, context);
+  switch (method_) {
+    case kBernoulli: {
+      ZETASQL_ASSIGN_OR_RETURN(const double percent, GetSamplePercent(size_value));
+      if (percent > 0 && percent < 100) context->SetNonDeterministicOutput();
+      iter = absl::make_unique<BernoulliSampleTupleIterator>(
+          percent, std::move(rng), weight_slot, std::move(iter),
+          CreateOutputSchema(), context);
+      break;
+    }
+    case kReservoir:
+      if (size_value.is_null() || size_value.int64_value() < 0) {
+        return zetasql_base::OutOfRangeErrorBuilder()
+               << "TABLESAMPLE ROWS must be a non-negative INT64, but is "
+               << size_value.DebugString();
+      }
+      iter = absl::make_unique<ReservoirSampleTupleIterator>(
+          params, size_value.int64_value(), std::move(rng), partition_keys(),
+          weight_slot, std::move(iter), CreateOutputSchema(), context);
+      break;
+  }
+  iter = MaybeBatch(std::move(iter), context);
+  return MaybeReorder(std::move(iter), context);
+}
+
+std::unique_ptr<TupleSchema> SampleScanOp::CreateOutputSchema() const {
+  std::unique_ptr<TupleSchema> input_schema = input()->CreateOutputSchema();
+  if (!weight_.is_valid()) return input_schema;
+  std::vector<VariableId> variables = input_schema->variables();
+  variables.push_back(weight_);
+  return absl::make_unique<TupleSchema>(variables);
+}
+
+std::string SampleScanOp::IteratorDebugString() const {
+  return GetIteratorDebugString(method_, input()->IteratorDebugString());
+}
+
+std::string SampleScanOp::DebugInternal(const std::string& indent,
+                                        bool verbose) const {
+  return absl::StrCat(
+      "SampleScanOp(", method_ == kBernoulli ? "bernoulli" : "reservoir",
+      weight_.is_valid() ? absl::StrCat(", weight: $", weight_.ToString()) : "",
+      ArgDebugString({"size", "repeatable", "partition_keys", "input"},
+                     {k1, k1, kN, k1}, indent, verbose),
+      ")");
+}
+
+SampleScanOp::SampleScanOp(Method method, std::unique_ptr<ValueExpr> size,
+                           std::unique_ptr<ValueExpr> repeatable,
+                           std::vector<std::unique_ptr<ExprArg>> partition_keys,
+                           const VariableId& weight,
+                           std::unique_ptr<RelationalOp> input)
+    : method_(method), weight_(weight) {
+  SetArg(kSize, absl::make_unique<ExprArg>(std::move(size)));
+  SetArg(kRepeatable,
+         repeatable == nullptr
+             ? nullptr
+             : absl::make_unique<ExprArg>(std::move(repeatable)));
+  SetArgs<ExprArg>(kPartitionKey, std::move(partition_keys));
+  SetArg(kInput, absl::make_unique<RelationalArg>(std::move(input)));
+}
+
+const ValueExpr* SampleScanOp::size() const {
+  return GetArg(kSize)->node()->AsValueExpr();
+}
+
+ValueExpr* SampleScanOp::mutable_size() {
+  return GetMutableArg(kSize)->mutable_node()->AsMutableValueExpr();
+}
+
+const ValueExpr* SampleScanOp::repeatable() const {
+  return GetArg(kRepeatable) != nullptr ? GetArg(kRepeatable)->value_expr()
+                                        : nullptr;
+}
+
+ValueExpr* SampleScanOp::mutable_repeatable() {
+  return GetMutableArg(kRepeatable) != nullptr
+             ? GetMutableArg(kRepeatable)->mutable_value_expr()
+             : nullptr;
+}
+
+absl::Span<const ExprArg* const> SampleScanOp::partition_keys() const {
+  return GetArgs<ExprArg>(kPartitionKey);
+}
+
+absl::Span<ExprArg* const> SampleScanOp::mutable_partition_keys() {
+  return GetMutableArgs<ExprArg>(kPartitionKey);
+}
+
+const RelationalOp* SampleScanOp::input() const {
+  return GetArg(kInput)->node()->AsRelationalOp();
+}
+
+RelationalOp* SampleScanOp::mutable_input() {
+  return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
+}
+
 // -------------------------------------------------------
 // EnumerateOp
 // -------------------------------------------------------
@@ -1767,7 +3664,7 @@ class EnumerateTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> EnumerateOp::CreateIterator(
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> EnumerateOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   TupleSlot count_slot;
@@ -1865,8 +3762,15 @@ const std::string& JoinOp::JoinKindToString(JoinOp::JoinKind kind) {
 
 ::zetasql_base::Status JoinOp::SetSchemasForEvaluation(
     absl::Span<const TupleSchema* const> params_schemas) {
-  ZETASQL_RETURN_IF_ERROR(
-      mutable_left_input()->SetSchemasForEvaluation(params_schemas));
+  const std::unique_ptr<const TupleSchema> build_keys_schema =
+      CreateBuildKeysSchema();
+  if (build_keys_schema == nullptr) {
+    ZETASQL_RETURN_IF_ERROR(
+        mutable_left_input()->SetSchemasForEvaluation(params_schemas));
+  } else {
+    ZETASQL_RETURN_IF_ERROR(mutable_left_input()->SetSchemasForEvaluation(
+        ConcatSpans(params_schemas, {build_keys_schema.get()})));
+  }
 
   const std::unique_ptr<const TupleSchema> left_schema =
       left_input()->CreateOutputSchema();
@@ -1938,6 +3842,16 @@ class RightInputForJoin {
   // case, the right input does not depend on the left-hand side.
   virtual zetasql_base::Status ResetForLeftInput(const Tuple* left_input) = 0;
 
+  // Informs the input that the next calls to ResetForLeftInput() will be for
+  // the (non-NULL) tuples in 'left_inputs', in that order. Implementations may
+  // use this to do the work for all of them at once (e.g., on multiple
+  // threads). The pointers must remain valid until the corresponding calls to
+  // ResetForLeftInput().
+  virtual zetasql_base::Status PrepareForLeftInputs(
+      absl::Span<const TupleData* const> left_inputs) {
+    return zetasql_base::OkStatus();
+  }
+
   // Returns the number of tuples on this side of the join that the last call to
   // ResetForLeftInput() identified as possibly joining with the current left
   // tuple. Guaranteed to be the entire right-hand side if IsCorrelated() is
@@ -2040,6 +3954,13 @@ class UncorrelatedRightInput : public RightInputForJoin {
   std::vector<RightTupleAndJoinedBit> tuples_and_bits_;
 };
 
+// Represents the right-hand input side of a hash join. The right tuples are
+// stored in a hash table keyed on the values of the right-hand side equality
+// expressions. If 'num_threads' is greater than one, the hash table is radix
+// partitioned on the hash of the key so that each partition can be built on a
+// separate thread, and PrepareForLeftInputs() looks up a whole morsel of left
+// tuples in parallel. The equality expressions themselves are always evaluated
+// on the calling thread because EvaluationContext is not thread-safe.
 class UncorrelatedHashedRightInput : public RightInputForJoin {
  public:
   static zetasql_base::StatusOr<std::unique_ptr<UncorrelatedHashedRightInput>> Create(
@@ -2048,23 +3969,37 @@ class UncorrelatedHashedRightInput : public RightInputForJoin {
       absl::Span<const ExprArg* const> right_equality_exprs,
       std::unique_ptr<TupleSchema> schema,
       std::unique_ptr<TupleDataDeque> right_tuples,
-      std::unique_ptr<TupleIterator> iter_for_debug_string,
+      std::unique_ptr<TupleIterator> iter_for_debug_string, int num_threads,
       EvaluationContext* context) {
     ZETASQL_RET_CHECK_EQ(left_equality_exprs.size(), right_equality_exprs.size());
 
     std::vector<RightTupleAndJoinedBit> right_tuples_and_bits =
         WrapWithJoinedBits(right_tuples->GetTuplePtrs());
 
-    auto right_tuple_map = absl::make_unique<RightTupleMap>();
-    for (auto& tuple_and_bit : right_tuples_and_bits) {
+    std::vector<TupleData> keys;
+    keys.reserve(right_tuples_and_bits.size());
+    for (const RightTupleAndJoinedBit& tuple_and_bit : right_tuples_and_bits) {
       ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleData> key,
                        CreateTupleMapKey(params, *tuple_and_bit.tuple,
                                          right_equality_exprs, context));
-      (*right_tuple_map)[*key].push_back(&tuple_and_bit);
+      keys.push_back(std::move(*key));
     }
+
+    context->RecordHashTableSize(keys.size());
+
+    // Don't bother with extra threads for small right-hand sides.
+    const int num_build_threads = static_cast<int>(std::min<int64_t>(
+        num_threads, std::max<int64_t>(1, keys.size() / kMinTuplesPerThread)));
+    const int radix_bits = GetNumRadixBits(num_build_threads);
+    std::shared_ptr<const TupleHasher> key_hasher =
+        CreateKeyHasher(right_equality_exprs);
+    std::unique_ptr<std::vector<RightTupleMap>> right_tuple_maps =
+        BuildRightTupleMaps(num_build_threads, radix_bits, key_hasher, &keys,
+                            &right_tuples_and_bits);
     return absl::WrapUnique(new UncorrelatedHashedRightInput(
         params, left_equality_exprs, std::move(schema), std::move(right_tuples),
-        std::move(right_tuples_and_bits), std::move(right_tuple_map),
+        std::move(right_tuples_and_bits), std::move(key_hasher),
+        std::move(right_tuple_maps), radix_bits, num_threads,
         std::move(iter_for_debug_string), context));
   }
 
@@ -2075,40 +4010,40 @@ class UncorrelatedHashedRightInput : public RightInputForJoin {
   zetasql_base::Status ResetForLeftInput(const Tuple* left_input) override {
     if (left_input == nullptr) {
       matching_right_tuple_list_ = absl::nullopt;
-    } else {
+      return zetasql_base::OkStatus();
+    }
+    if (next_prefetched_idx_ < prefetched_.size()) {
+      const PrefetchedLeftInput& prefetched =
+          prefetched_[next_prefetched_idx_++];
+      ZETASQL_RET_CHECK(prefetched.left_input == left_input->data);
+      return SetMatchingRightTuples(prefetched.key, prefetched.entry);
+    }
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleData> key,
+                     CreateTupleMapKey(params_, *left_input->data,
+                                       left_equality_exprs_, context_));
+    return SetMatchingRightTuples(*key, FindEntry(*key));
+  }
+
+  zetasql_base::Status PrepareForLeftInputs(
+      absl::Span<const TupleData* const> left_inputs) override {
+    prefetched_.clear();
+    next_prefetched_idx_ = 0;
+    if (num_threads_ <= 1) return zetasql_base::OkStatus();
+
+    prefetched_.resize(left_inputs.size());
+    for (int i = 0; i < left_inputs.size(); ++i) {
+      prefetched_[i].left_input = left_inputs[i];
       ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleData> key,
-                       CreateTupleMapKey(params_, *left_input->data,
+                       CreateTupleMapKey(params_, *left_inputs[i],
                                          left_equality_exprs_, context_));
-      const auto it = right_tuple_map_->find(*key);
-      if (it == right_tuple_map_->end()) {
-        // No matching tuples.
-        matching_right_tuple_list_ = nullptr;
-      } else {
-        const TupleData& other_key = it->first;
-        matching_right_tuple_list_ = &it->second;
-        // We have to compare 'key' against 'other_key', because TupleData::==()
-        // uses Value::Equals(), which is more permissive than SQL equality. In
-        // particular, SQL specifies that the result of NULL = NULL is NULL and
-        // that the result of NaN = NaN is false, but NULL.Equals(NULL) and
-        // NaN.Equals(NaN) are both true.
-        ZETASQL_RET_CHECK_EQ(key->num_slots(), other_key.num_slots());
-        zetasql_base::Status status;
-        for (int i = 0; i < key->num_slots(); ++i) {
-          const ComparisonFunction equals_function(FunctionKind::kEqual,
-                                                   types::BoolType());
-          Value equals_result;
-          if (!equals_function.Eval(
-                  {key->slot(i).value(), other_key.slot(i).value()}, context_,
-                  &equals_result, &status)) {
-            return status;
-          }
-          if (equals_result != values::Bool(true)) {
-            matching_right_tuple_list_ = nullptr;
-            break;
-          }
-        }
-      }
+      prefetched_[i].key = std::move(*key);
     }
+    ParallelForRanges(num_threads_, prefetched_.size(), kMinTuplesPerThread,
+                      [this](int64_t begin, int64_t end) {
+                        for (int64_t i = begin; i < end; ++i) {
+                          prefetched_[i].entry = FindEntry(prefetched_[i].key);
+                        }
+                      });
     return zetasql_base::OkStatus();
   }
 
@@ -2158,11 +4093,102 @@ class UncorrelatedHashedRightInput : public RightInputForJoin {
     return iter_for_debug_string_->DebugString();
   }
 
+  // Returns the TupleMap key corresponding to 'row' and 'args'.
+  static zetasql_base::StatusOr<std::unique_ptr<TupleData>> CreateTupleMapKey(
+      absl::Span<const TupleData* const> params, const TupleData& row,
+      absl::Span<const ExprArg* const> args, EvaluationContext* context) {
+    auto key = absl::make_unique<TupleData>(args.size());
+    for (int i = 0; i < args.size(); ++i) {
+      const ExprArg* arg = args[i];
+      TupleSlot* slot = key->mutable_slot(i);
+      zetasql_base::Status status;
+      if (!arg->value_expr()->EvalSimple(ConcatSpans(params, {&row}), context,
+                                         slot, &status)) {
+        return status;
+      }
+      // Represent non-negative INT64 values with UINT64 values to support
+      // equalities of the form INT64 = UINT64 (or UINT64 = INT64).
+      if (slot->value().type_kind() == TYPE_INT64 && !slot->value().is_null()) {
+        const int64_t int64_value = slot->value().int64_value();
+        if (int64_value >= 0) {
+          slot->SetValue(values::Uint64(static_cast<uint64_t>(int64_value)));
+        }
+      }
+    }
+    return key;
+  }
+
+  // Returns a TupleHasher for the keys created by CreateTupleMapKey() for
+  // 'args'. Since that represents non-negative INT64 values as UINT64 values,
+  // INT64 keys are hashed as UINT64 keys.
+  static std::shared_ptr<const TupleHasher> CreateKeyHasher(
+      absl::Span<const ExprArg* const> args) {
+    std::vector<const Type*> key_types;
+    key_types.reserve(args.size());
+    for (const ExprArg* arg : args) {
+      key_types.push_back(arg->type()->IsInt64() ? types::Uint64Type()
+                                                 : arg->type());
+    }
+    return std::make_shared<const TupleHasher>(key_types);
+  }
+
+  // Populates 'keys', 'min_key' and 'max_key' as described in
+  // JoinOp::AddBuildKeysParameter() for the 'key_idx'-th right-hand side
+  // equality expression.
+  void GetBuildKeys(int key_idx, const ArrayType* keys_type, Value* keys,
+                    Value* min_key, Value* max_key) const {
+    const Type* key_type = keys_type->element_type();
+    *min_key = Value::Null(key_type);
+    *max_key = Value::Null(key_type);
+    absl::flat_hash_set<Value> distinct_keys;
+    bool too_many_keys = false;
+    for (const RightTupleMap& map : *right_tuple_maps_) {
+      for (const auto& entry : map) {
+        Value key = entry.first.slot(key_idx).value();
+        // NULLs and NaNs do not join with anything.
+        if (key.SqlEquals(key) != values::True()) continue;
+        // Undo the conversion in CreateTupleMapKey().
+        if (key_type->IsInt64() && key.type()->IsUint64()) {
+          key = values::Int64(static_cast<int64_t>(key.uint64_value()));
+        }
+        if (min_key->is_null() || key.SqlLessThan(*min_key) == values::True()) {
+          *min_key = key;
+        }
+        if (max_key->is_null() || max_key->SqlLessThan(key) == values::True()) {
+          *max_key = key;
+        }
+        if (!too_many_keys) {
+          distinct_keys.insert(key);
+          too_many_keys = distinct_keys.size() > JoinOp::kMaxBuildKeysInList;
+        }
+      }
+    }
+    if (too_many_keys) {
+      *keys = Value::Null(keys_type);
+    } else {
+      *keys = Value::Array(keys_type, std::vector<Value>(distinct_keys.begin(),
+                                                         distinct_keys.end()));
+    }
+  }
+
  private:
   using RightTupleList = std::vector<RightTupleAndJoinedBit*>;
   // Maps the values of the right-hand side join expressions to the
   // corresponding right tuples.
-  using RightTupleMap = absl::flat_hash_map<TupleData, RightTupleList>;
+  using RightTupleMap = absl::flat_hash_map<TupleData, RightTupleList,
+                                            TupleHasher::Hash, TupleHasher::Eq>;
+
+  // A left tuple passed to PrepareForLeftInputs(), along with its key and the
+  // corresponding entry in 'right_tuple_maps_' (or NULL if there is none).
+  struct PrefetchedLeftInput {
+    const TupleData* left_input = nullptr;
+    TupleData key;
+    RightTupleMap::value_type* entry = nullptr;
+  };
+
+  // The minimum number of tuples per thread for building or probing the hash
+  // table. Below this, the overhead of starting threads dominates.
+  static constexpr int64_t kMinTuplesPerThread = 1024;
 
   UncorrelatedHashedRightInput(
       absl::Span<const TupleData* const> params,
@@ -2171,7 +4197,9 @@ class UncorrelatedHashedRightInput : public RightInputForJoin {
       std::unique_ptr<TupleDataDeque> right_tuples,
       // The TupleDatas in here are owned by 'right_tuples'.
       std::vector<RightTupleAndJoinedBit> right_tuples_and_bits,
-      std::unique_ptr<RightTupleMap> right_tuple_map,
+      std::shared_ptr<const TupleHasher> key_hasher,
+      std::unique_ptr<std::vector<RightTupleMap>> right_tuple_maps,
+      int radix_bits, int num_threads,
       std::unique_ptr<TupleIterator> iter_for_debug_string,
       EvaluationContext* context)
       : params_(params.begin(), params.end()),
@@ -2180,7 +4208,10 @@ class UncorrelatedHashedRightInput : public RightInputForJoin {
         schema_(std::move(schema)),
         right_tuples_(std::move(right_tuples)),
         right_tuples_and_bits_(std::move(right_tuples_and_bits)),
-        right_tuple_map_(std::move(right_tuple_map)),
+        key_hasher_(std::move(key_hasher)),
+        right_tuple_maps_(std::move(right_tuple_maps)),
+        radix_bits_(radix_bits),
+        num_threads_(num_threads),
         iter_for_debug_string_(std::move(iter_for_debug_string)),
         context_(context) {}
 
@@ -2188,29 +4219,115 @@ class UncorrelatedHashedRightInput : public RightInputForJoin {
   UncorrelatedHashedRightInput& operator=(const UncorrelatedHashedRightInput&) =
       delete;
 
-  // Returns the TupleMap key corresponding to 'row' and 'args'.
-  static zetasql_base::StatusOr<std::unique_ptr<TupleData>> CreateTupleMapKey(
-      absl::Span<const TupleData* const> params, const TupleData& row,
-      absl::Span<const ExprArg* const> args, EvaluationContext* context) {
-    auto key = absl::make_unique<TupleData>(args.size());
-    for (int i = 0; i < args.size(); ++i) {
-      const ExprArg* arg = args[i];
-      TupleSlot* slot = key->mutable_slot(i);
-      zetasql_base::Status status;
-      if (!arg->value_expr()->EvalSimple(ConcatSpans(params, {&row}), context,
-                                         slot, &status)) {
+  // Returns the number of bits of the key hash used to pick a partition of the
+  // hash table when building it on 'num_threads' threads. We use at least as
+  // many partitions as threads.
+  static int GetNumRadixBits(int num_threads) {
+    int radix_bits = 0;
+    while ((1 << radix_bits) < num_threads) {
+      ++radix_bits;
+    }
+    return radix_bits;
+  }
+
+  // Returns the partition of 'right_tuple_maps_' that contains 'key'. Uses the
+  // high bits of the hash because absl::flat_hash_map uses the low ones.
+  static int GetPartition(const TupleHasher& key_hasher, const TupleData& key,
+                          int radix_bits) {
+    if (radix_bits == 0) return 0;
+    const uint64_t hash = key_hasher.HashCode(key);
+    return static_cast<int>(hash >> (64 - radix_bits));
+  }
+
+  // Moves 'keys' into 2^'radix_bits' hash tables (one per partition) mapping
+  // each key to the corresponding elements of 'tuples_and_bits'. The hashes and
+  // the tables are computed on 'num_threads' threads.
+  static std::unique_ptr<std::vector<RightTupleMap>> BuildRightTupleMaps(
+      int num_threads, int radix_bits,
+      const std::shared_ptr<const TupleHasher>& key_hasher,
+      std::vector<TupleData>* keys,
+      std::vector<RightTupleAndJoinedBit>* tuples_and_bits) {
+    const int num_partitions = 1 << radix_bits;
+    auto maps = absl::make_unique<std::vector<RightTupleMap>>(
+        num_partitions,
+        RightTupleMap(/*bucket_count=*/0, TupleHasher::Hash{key_hasher},
+                      TupleHasher::Eq{key_hasher}));
+    if (num_partitions == 1) {
+      for (int64_t i = 0; i < keys->size(); ++i) {
+        (*maps)[0][std::move((*keys)[i])].push_back(&(*tuples_and_bits)[i]);
+      }
+      return maps;
+    }
+
+    std::vector<int> partitions(keys->size());
+    ParallelForRanges(num_threads, keys->size(), kMinTuplesPerThread,
+                      [keys, radix_bits, &key_hasher, &partitions](
+                          int64_t begin, int64_t end) {
+                        for (int64_t i = begin; i < end; ++i) {
+                          partitions[i] = GetPartition(*key_hasher, (*keys)[i],
+                                                       radix_bits);
+                        }
+                      });
+
+    // Preserve the order of the right tuples within each partition so that the
+    // output does not depend on the number of threads.
+    std::vector<std::vector<int64_t>> partition_rows(num_partitions);
+    for (int64_t i = 0; i < partitions.size(); ++i) {
+      partition_rows[partitions[i]].push_back(i);
+    }
+
+    ParallelFor(num_threads, num_partitions,
+                [keys, tuples_and_bits, &maps, &partition_rows](int64_t p) {
+                  RightTupleMap& map = (*maps)[p];
+                  map.reserve(partition_rows[p].size());
+                  for (const int64_t i : partition_rows[p]) {
+                    map[std::move((*keys)[i])].push_back(&(*tuples_and_bits)[i]);
+                  }
+                });
+    return maps;
+  }
+
+  // Returns the entry of 'right_tuple_maps_' for 'key', or NULL if there is
+  // none. Thread-safe.
+  RightTupleMap::value_type* FindEntry(const TupleData& key) {
+    RightTupleMap& map =
+        (*right_tuple_maps_)[GetPartition(*key_hasher_, key, radix_bits_)];
+    const auto it = map.find(key);
+    return it == map.end() ? nullptr : &*it;
+  }
+
+  // Sets 'matching_right_tuple_list_' for a left tuple with key 'key' and
+  // hash table entry 'entry' (or NULL if there is no entry).
+  zetasql_base::Status SetMatchingRightTuples(const TupleData& key,
+                                      RightTupleMap::value_type* entry) {
+    if (entry == nullptr) {
+      // No matching tuples.
+      matching_right_tuple_list_ = nullptr;
+      return zetasql_base::OkStatus();
+    }
+    const TupleData& other_key = entry->first;
+    matching_right_tuple_list_ = &entry->second;
+    // We have to compare 'key' against 'other_key', because TupleData::==()
+    // uses Value::Equals(), which is more permissive than SQL equality. In
+    // particular, SQL specifies that the result of NULL = NULL is NULL and
+    // that the result of NaN = NaN is false, but NULL.Equals(NULL) and
+    // NaN.Equals(NaN) are both true.
+    ZETASQL_RET_CHECK_EQ(key.num_slots(), other_key.num_slots());
+    zetasql_base::Status status;
+    for (int i = 0; i < key.num_slots(); ++i) {
+      const ComparisonFunction equals_function(FunctionKind::kEqual,
+                                               types::BoolType());
+      Value equals_result;
+      if (!equals_function.Eval({key.slot(i).value(), other_key.slot(i).value()},
+                                context_, &equals_result, &status)) {
         return status;
       }
-      // Represent non-negative INT64 values with UINT64 values to support
-      // equalities of the form INT64 = UINT64 (or UINT64 = INT64).
-      if (slot->value().type_kind() == TYPE_INT64 && !slot->value().is_null()) {
-        const int64_t int64_value = slot->value().int64_value();
-        if (int64_value >= 0) {
-          slot->SetValue(values::Uint64(static_cast<uint64_t>(int64_value)));
-        }
+      if (equals_result != values::Bool(true)) {
+        matching_right_tuple_list_ = nullptr;
+        break;
       }
     }
-    return key;
+    return zetasql_base::OkStatus();
   }
 
   const std::vector<const TupleData*> params_;
@@ -2220,13 +4337,26 @@ class UncorrelatedHashedRightInput : public RightInputForJoin {
   std::unique_ptr<TupleDataDeque> right_tuples_;
   // The TupleDatas in here are owned by 'right_tuples_'.
   std::vector<RightTupleAndJoinedBit> right_tuples_and_bits_;
-  std::unique_ptr<RightTupleMap> right_tuple_map_;
-  // The TupleList in 'right_tuple_map_' corresponding to the current left
+  // Hashes and compares the keys of 'right_tuple_maps_'.
+  const std::shared_ptr<const TupleHasher> key_hasher_;
+  // One hash table for each partition. Immutable after construction.
+  std::unique_ptr<std::vector<RightTupleMap>> right_tuple_maps_;
+  // 'right_tuple_maps_' has 2^'radix_bits_' entries.
+  const int radix_bits_;
+  // The number of threads to use in PrepareForLeftInputs().
+  const int num_threads_;
+  // The TupleList in 'right_tuple_maps_' corresponding to the current left
   // tuple. NULL indicates there are no corresponding tuples. No value indicates
   // that left tuple in the last call to ResetForLeftInput() was NULL and
   // therefore GetNumMatchingTuples()/etc. should iterate over everything.
   absl::optional<RightTupleList*> matching_right_tuple_list_ = nullptr;
 
+  // The left tuples from the last call to PrepareForLeftInputs(). The first
+  // 'next_prefetched_idx_' of them have already been passed to
+  // ResetForLeftInput().
+  std::vector<PrefetchedLeftInput> prefetched_;
+  int64_t next_prefetched_idx_ = 0;
+
   // We store a TupleIterator instead of the debug string to avoid computing the
   // debug string unnecessarily.
   const std::unique_ptr<TupleIterator> iter_for_debug_string_;
@@ -2246,13 +4376,18 @@ zetasql_base::Status ExtractFromRelationalOp(
                    op->CreateIterator(params, /*num_extra_slots=*/0, context));
   tuples->Clear();
   zetasql_base::Status status;
-  while (true) {
+  for (int64_t num_tuples = 0;; ++num_tuples) {
+    if (num_tuples %
+            absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period) ==
+        0) {
+      ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
+    }
     TupleData* tuple = iter->Next();
     if (tuple == nullptr) {
       ZETASQL_RETURN_IF_ERROR(iter->Status());
       break;
     }
-    if (!tuples->PushBack(absl::make_unique<TupleData>(*tuple), &status)) {
+    if (!tuples->PushBackCopy(*tuple, &status)) {
       return status;
     }
   }
@@ -2338,6 +4473,255 @@ class CorrelatedRightInput : public RightInputForJoin {
   std::vector<const TupleData*> tuple_ptrs_;
 };
 
+// Represents the right-hand input side of a merge join. Both inputs must be
+// sorted in ascending order (with NULLs first) on the first 'num_merge_keys'
+// equality expressions. The right tuples are read as the left tuples advance,
+// and only the right tuples whose merge keys equal those of the current left
+// tuple are kept in memory.
+class MergeJoinRightInput : public RightInputForJoin {
+ public:
+  static zetasql_base::StatusOr<std::unique_ptr<MergeJoinRightInput>> Create(
+      absl::Span<const TupleData* const> params,
+      absl::Span<const ExprArg* const> left_equality_exprs,
+      absl::Span<const ExprArg* const> right_equality_exprs,
+      int num_merge_keys, std::unique_ptr<TupleSchema> schema,
+      std::unique_ptr<TupleIterator> right_iter, EvaluationContext* context) {
+    ZETASQL_RET_CHECK_EQ(left_equality_exprs.size(), right_equality_exprs.size());
+    ZETASQL_RET_CHECK_GT(num_merge_keys, 0);
+    ZETASQL_RET_CHECK_LE(num_merge_keys, right_equality_exprs.size());
+
+    // TupleComparator only uses the sort orders of the keys, so their
+    // expressions are placeholders.
+    std::vector<std::unique_ptr<KeyArg>> keys;
+    std::vector<const KeyArg*> key_ptrs;
+    std::vector<int> slots_for_keys;
+    for (int i = 0; i < num_merge_keys; ++i) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          std::unique_ptr<ConstExpr> placeholder,
+          ConstExpr::Create(Value::Null(right_equality_exprs[i]->type())));
+      keys.push_back(absl::make_unique<KeyArg>(
+          VariableId(), std::move(placeholder), KeyArg::kAscending));
+      key_ptrs.push_back(keys.back().get());
+      slots_for_keys.push_back(i);
+    }
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<TupleComparator> comparator,
+        TupleComparator::Create(key_ptrs, slots_for_keys, params, context));
+    return absl::WrapUnique(new MergeJoinRightInput(
+        params, left_equality_exprs, right_equality_exprs, std::move(keys),
+        std::move(comparator), std::move(schema), std::move(right_iter),
+        context));
+  }
+
+  MergeJoinRightInput(const MergeJoinRightInput&) = delete;
+  MergeJoinRightInput& operator=(const MergeJoinRightInput&) = delete;
+
+  ~MergeJoinRightInput() override {}
+
+  bool IsCorrelated() const override { return false; }
+
+  const TupleSchema& Schema() const override { return *schema_; }
+
+  zetasql_base::Status ResetForLeftInput(const Tuple* left_input) override {
+    // JoinOp only uses merge joins for inner and left outer joins, which never
+    // iterate over the entire right-hand side.
+    ZETASQL_RET_CHECK(left_input != nullptr);
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleData> left_key,
+                     CreateKey(*left_input->data, left_equality_exprs_));
+    if (last_left_key_ != nullptr) {
+      if ((*comparator_)(*left_key, *last_left_key_)) {
+        return zetasql_base::InternalErrorBuilder()
+               << "The left input of a merge join is not sorted on the join "
+               << "keys";
+      }
+    }
+    // Consecutive left tuples with the same merge keys share a group.
+    if (last_left_key_ == nullptr ||
+        (*comparator_)(*last_left_key_, *left_key)) {
+      ZETASQL_RETURN_IF_ERROR(LoadGroup(*left_key));
+    }
+
+    matching_tuples_.clear();
+    for (int64_t i = 0; i < group_tuple_ptrs_.size(); ++i) {
+      ZETASQL_ASSIGN_OR_RETURN(const bool equal,
+                       KeysEqual(*left_key, *group_key_ptrs_[i]));
+      if (equal) matching_tuples_.push_back(group_tuple_ptrs_[i]);
+    }
+    last_left_key_ = std::move(left_key);
+    return zetasql_base::OkStatus();
+  }
+
+  int64_t GetNumMatchingTuples() const override {
+    return matching_tuples_.size();
+  }
+
+  const TupleData& GetMatchingTuple(int64_t index) const override {
+    return *matching_tuples_[index];
+  }
+
+  zetasql_base::Status RecordMatchingTupleJoined(int64_t index) override {
+    // Only right and full outer joins need to know which right tuples joined.
+    return zetasql_base::OkStatus();
+  }
+
+  zetasql_base::StatusOr<bool> DidMatchingTupleJoin(int64_t index) const override {
+    ZETASQL_RET_CHECK_FAIL() << "DidMatchingTupleJoin() is not supported for merge "
+                     << "joins";
+  }
+
+  std::string DebugString() const override {
+    return right_iter_->DebugString();
+  }
+
+ private:
+  MergeJoinRightInput(absl::Span<const TupleData* const> params,
+                      absl::Span<const ExprArg* const> left_equality_exprs,
+                      absl::Span<const ExprArg* const> right_equality_exprs,
+                      std::vector<std::unique_ptr<KeyArg>> keys,
+                      std::unique_ptr<TupleComparator> comparator,
+                      std::unique_ptr<TupleSchema> schema,
+                      std::unique_ptr<TupleIterator> right_iter,
+                      EvaluationContext* context)
+      : params_(params.begin(), params.end()),
+        left_equality_exprs_(left_equality_exprs.begin(),
+                             left_equality_exprs.end()),
+        right_equality_exprs_(right_equality_exprs.begin(),
+                              right_equality_exprs.end()),
+        keys_(std::move(keys)),
+        comparator_(std::move(comparator)),
+        schema_(std::move(schema)),
+        right_iter_(std::move(right_iter)),
+        group_tuples_(context->memory_accountant()),
+        group_keys_(context->memory_accountant()),
+        context_(context) {}
+
+  // Returns the values of 'exprs' for 'row'. Unlike
+  // UncorrelatedHashedRightInput::CreateTupleMapKey(), this does not convert
+  // INT64 values because the comparator needs the original types.
+  zetasql_base::StatusOr<std::unique_ptr<TupleData>> CreateKey(
+      const TupleData& row, absl::Span<const ExprArg* const> exprs) {
+    auto key = absl::make_unique<TupleData>(exprs.size());
+    for (int i = 0; i < exprs.size(); ++i) {
+      zetasql_base::Status status;
+      if (!exprs[i]->value_expr()->EvalSimple(
+              ConcatSpans(absl::Span<const TupleData* const>(params_), {&row}),
+              context_, key->mutable_slot(i), &status)) {
+        return status;
+      }
+    }
+    return key;
+  }
+
+  // Returns true if all the slots of 'key1' and 'key2' are equal according to
+  // SQL equality, which is false for NULLs and NaNs.
+  zetasql_base::StatusOr<bool> KeysEqual(const TupleData& key1,
+                                  const TupleData& key2) {
+    const ComparisonFunction equals_function(FunctionKind::kEqual,
+                                             types::BoolType());
+    zetasql_base::Status status;
+    for (int i = 0; i < key1.num_slots(); ++i) {
+      Value equals_result;
+      if (!equals_function.Eval({key1.slot(i).value(), key2.slot(i).value()},
+                                context_, &equals_result, &status)) {
+        return status;
+      }
+      if (equals_result != values::Bool(true)) return false;
+    }
+    return true;
+  }
+
+  // Reads the next right tuple into 'next_right_tuple_' and
+  // 'next_right_key_'. Returns false if there are no more right tuples.
+  zetasql_base::StatusOr<bool> ReadNextRightTuple() {
+    const TupleData* tuple = right_iter_->Next();
+    if (tuple == nullptr) {
+      ZETASQL_RETURN_IF_ERROR(right_iter_->Status());
+      next_right_tuple_ = nullptr;
+      return false;
+    }
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleData> key,
+                     CreateKey(*tuple, right_equality_exprs_));
+    if (next_right_key_ != nullptr && (*comparator_)(*key, *next_right_key_)) {
+      return zetasql_base::InternalErrorBuilder()
+             << "The right input of a merge join is not sorted on the join "
+             << "keys";
+    }
+    next_right_tuple_ = absl::make_unique<TupleData>(*tuple);
+    next_right_key_ = std::move(key);
+    return true;
+  }
+
+  // Replaces the group with the right tuples whose merge keys equal those of
+  // 'left_key', skipping the right tuples with smaller merge keys.
+  zetasql_base::Status LoadGroup(const TupleData& left_key) {
+    group_tuples_.Clear();
+    group_keys_.Clear();
+    group_tuple_ptrs_.clear();
+    group_key_ptrs_.clear();
+    while (true) {
+      if (next_right_tuple_ == nullptr) {
+        if (right_iter_done_) return zetasql_base::OkStatus();
+        ZETASQL_ASSIGN_OR_RETURN(const bool has_tuple, ReadNextRightTuple());
+        if (!has_tuple) {
+          right_iter_done_ = true;
+          return zetasql_base::OkStatus();
+        }
+      }
+      if ((*comparator_)(left_key, *next_right_key_)) {
+        return zetasql_base::OkStatus();
+      }
+      if (!(*comparator_)(*next_right_key_, left_key)) break;
+      next_right_tuple_ = nullptr;
+    }
+
+    zetasql_base::Status status;
+    do {
+      if (!group_tuples_.PushBackCopy(*next_right_tuple_, &status) ||
+          !group_keys_.PushBackCopy(*next_right_key_, &status)) {
+        return status;
+      }
+      ZETASQL_ASSIGN_OR_RETURN(const bool has_tuple, ReadNextRightTuple());
+      right_iter_done_ = !has_tuple;
+    } while (!right_iter_done_ && !(*comparator_)(left_key, *next_right_key_));
+    group_tuple_ptrs_ = group_tuples_.GetTuplePtrs();
+    group_key_ptrs_ = group_keys_.GetTuplePtrs();
+    return zetasql_base::OkStatus();
+  }
+
+  const std::vector<const TupleData*> params_;
+  const std::vector<const ExprArg*> left_equality_exprs_;
+  const std::vector<const ExprArg*> right_equality_exprs_;
+  // The merge keys referenced by 'comparator_'.
+  const std::vector<std::unique_ptr<KeyArg>> keys_;
+  // Compares the merge keys, which are the first slots of the keys created by
+  // CreateKey().
+  const std::unique_ptr<TupleComparator> comparator_;
+  const std::unique_ptr<TupleSchema> schema_;
+  const std::unique_ptr<TupleIterator> right_iter_;
+  bool right_iter_done_ = false;
+
+  // The first right tuple that is not in the group, and its key. NULL if it
+  // has not been read yet or was skipped.
+  std::unique_ptr<TupleData> next_right_tuple_;
+  std::unique_ptr<TupleData> next_right_key_;
+
+  // The right tuples whose merge keys equal those of 'last_left_key_', and
+  // their keys.
+  TupleDataDeque group_tuples_;
+  TupleDataDeque group_keys_;
+  // Owned by 'group_tuples_' and 'group_keys_'.
+  std::vector<const TupleData*> group_tuple_ptrs_;
+  std::vector<const TupleData*> group_key_ptrs_;
+  // The tuples of the group whose keys equal the key of the current left
+  // tuple.
+  std::vector<const TupleData*> matching_tuples_;
+
+  // The key of the left tuple from the last call to ResetForLeftInput().
+  std::unique_ptr<TupleData> last_left_key_;
+
+  EvaluationContext* context_;
+};
+
 // Takes left tuples, right tuples, and an arbitrary join predicate, and outputs
 // the joined tuples that match the join predicate.
 class JoinTupleIterator : public TupleIterator {
@@ -2352,7 +4736,8 @@ class JoinTupleIterator : public TupleIterator {
                     std::unique_ptr<RightInputForJoin> right_input,
                     absl::Span<const ExprArg* const> right_outputs,
                     std::unique_ptr<TupleSchema> output_schema,
-                    int num_extra_slots, EvaluationContext* context)
+                    int left_morsel_size, int num_extra_slots,
+                    EvaluationContext* context)
       : join_kind_(join_kind),
         params_(params.begin(), params.end()),
         join_expr_(join_expr),
@@ -2361,6 +4746,8 @@ class JoinTupleIterator : public TupleIterator {
         right_input_(std::move(right_input)),
         right_outputs_(right_outputs.begin(), right_outputs.end()),
         output_schema_(std::move(output_schema)),
+        left_morsel_size_(left_morsel_size),
+        left_morsel_(context->memory_accountant()),
         context_(context) {
     output_tuple_.AddSlots(output_schema_->num_variables() + num_extra_slots);
   }
@@ -2455,10 +4842,8 @@ class JoinTupleIterator : public TupleIterator {
   // Updates the private variables to point to the first candidate join tuples.
   zetasql_base::Status InitializeJoinCandidates() {
     ZETASQL_RET_CHECK(!next_left_tuple_.has_value());
-    next_left_tuple_ = left_iter_->Next();
+    ZETASQL_ASSIGN_OR_RETURN(next_left_tuple_, NextLeftTuple());
     if (next_left_tuple_ == nullptr) {
-      ZETASQL_RETURN_IF_ERROR(left_iter_->Status());
-
       // There are no left tuples, so we are done unless we are doing a right
       // join or full outer join, in which case we need to load the right-hand
       // side and emit right tuples that are left-padded with NULLs.
@@ -2482,6 +4867,42 @@ class JoinTupleIterator : public TupleIterator {
     return zetasql_base::OkStatus();
   }
 
+  // Returns the next left tuple, or NULL if there are no more. If
+  // 'left_morsel_size_' is positive, reads that many left tuples at a time into
+  // 'left_morsel_' and passes them to RightInputForJoin::PrepareForLeftInputs()
+  // so that the right input can look them all up at once.
+  zetasql_base::StatusOr<const TupleData*> NextLeftTuple() {
+    if (left_morsel_size_ <= 0) {
+      const TupleData* left_tuple = left_iter_->Next();
+      if (left_tuple == nullptr) {
+        ZETASQL_RETURN_IF_ERROR(left_iter_->Status());
+      }
+      return left_tuple;
+    }
+
+    if (next_left_morsel_idx_ == left_morsel_ptrs_.size()) {
+      left_morsel_.Clear();
+      left_morsel_ptrs_.clear();
+      next_left_morsel_idx_ = 0;
+      while (!left_iter_done_ && left_morsel_.GetSize() < left_morsel_size_) {
+        const TupleData* left_tuple = left_iter_->Next();
+        if (left_tuple == nullptr) {
+          ZETASQL_RETURN_IF_ERROR(left_iter_->Status());
+          left_iter_done_ = true;
+          break;
+        }
+        zetasql_base::Status status;
+        if (!left_morsel_.PushBackCopy(*left_tuple, &status)) {
+          return status;
+        }
+      }
+      if (left_morsel_.IsEmpty()) return nullptr;
+      left_morsel_ptrs_ = left_morsel_.GetTuplePtrs();
+      ZETASQL_RETURN_IF_ERROR(right_input_->PrepareForLeftInputs(left_morsel_ptrs_));
+    }
+    return left_morsel_ptrs_[next_left_morsel_idx_++];
+  }
+
   // Advances the private variables for the next candidate join tuples.
   zetasql_base::Status Advance() {
     ZETASQL_RET_CHECK(!done_);
@@ -2533,9 +4954,8 @@ class JoinTupleIterator : public TupleIterator {
 
     while (true) {
       left_tuple_joined_ = false;
-      next_left_tuple_ = left_iter_->Next();
+      ZETASQL_ASSIGN_OR_RETURN(next_left_tuple_, NextLeftTuple());
       if (next_left_tuple_ == nullptr) {
-        ZETASQL_RETURN_IF_ERROR(left_iter_->Status());
         // We have finished trying to join left tuples with right tuples.
         return FinishJoiningLeftAndRightTuples();
       }
@@ -2808,6 +5228,17 @@ class JoinTupleIterator : public TupleIterator {
 
   std::unique_ptr<const TupleSchema> output_schema_;
 
+  // If positive, the number of left tuples to read from 'left_iter_' at a time.
+  const int left_morsel_size_;
+  // The current batch of left tuples if 'left_morsel_size_' is positive.
+  TupleDataDeque left_morsel_;
+  // The TupleDatas in here are owned by 'left_morsel_'.
+  std::vector<const TupleData*> left_morsel_ptrs_;
+  // The index in 'left_morsel_ptrs_' of the next left tuple to return.
+  int64_t next_left_morsel_idx_ = 0;
+  // True if 'left_iter_' has returned NULL.
+  bool left_iter_done_ = false;
+
   bool done_ = false;
   // The next left tuple to consider. Unset means uninitialized. NULL means
   // there are no more left tuples.
@@ -2833,35 +5264,424 @@ class JoinTupleIterator : public TupleIterator {
   int64_t num_join_tuples_calls_ = 0;
 };
 
+// Reads the tuples from 'iter' into 'tuples' like ExtractFromRelationalOp().
+// If they do not fit in memory and spilling is enabled, stops early, moves the
+// tuple that did not fit into '*overflow' and returns false. In that case, the
+// rest of the tuples can still be read from 'iter'.
+zetasql_base::StatusOr<bool> ExtractFromTupleIteratorUnlessSpilling(
+    TupleIterator* iter, EvaluationContext* context, TupleDataDeque* tuples,
+    std::unique_ptr<TupleData>* overflow) {
+  zetasql_base::Status status;
+  while (true) {
+    TupleData* tuple = iter->Next();
+    if (tuple == nullptr) {
+      ZETASQL_RETURN_IF_ERROR(iter->Status());
+      return true;
+    }
+    auto copy = absl::make_unique<TupleData>(*tuple);
+    if (!tuples->TryPushBack(&copy, &status)) {
+      if (!ShouldSpill(status, *context)) return status;
+      *overflow = std::move(copy);
+      return false;
+    }
+  }
+}
+
+// Implements a hash join whose right-hand side does not fit in memory (a
+// "grace hash join"). Both inputs are hash partitioned on their join keys into
+// kNumPartitions TupleSpillFiles, and then each pair of partitions is joined
+// with a JoinTupleIterator. Each right partition must fit in memory.
+//
+// The output is grouped by partition, so this iterator does not preserve the
+// order of the left input.
+class GraceHashJoinTupleIterator : public TupleIterator {
+ public:
+  using JoinKind = JoinOp::JoinKind;
+
+  // 'right_tuples', 'right_overflow' and the rest of 'right_iter' are the
+  // right-hand side tuples as returned by
+  // ExtractFromTupleIteratorUnlessSpilling().
+  static zetasql_base::StatusOr<std::unique_ptr<GraceHashJoinTupleIterator>> Create(
+      JoinKind join_kind, absl::Span<const TupleData* const> params,
+      absl::Span<const ExprArg* const> left_equality_exprs,
+      absl::Span<const ExprArg* const> right_equality_exprs,
+      const ValueExpr* join_expr, std::unique_ptr<TupleIterator> left_iter,
+      absl::Span<const ExprArg* const> left_outputs,
+      std::unique_ptr<TupleDataDeque> right_tuples,
+      std::unique_ptr<TupleData> right_overflow,
+      std::unique_ptr<TupleIterator> right_iter,
+      absl::Span<const ExprArg* const> right_outputs,
+      std::unique_ptr<TupleSchema> output_schema, int num_extra_slots,
+      EvaluationContext* context) {
+    auto iter = absl::WrapUnique(new GraceHashJoinTupleIterator(
+        join_kind, params, left_equality_exprs, right_equality_exprs,
+        join_expr, std::move(left_iter), left_outputs, std::move(right_iter),
+        right_outputs, std::move(output_schema), num_extra_slots, context));
+    ZETASQL_RETURN_IF_ERROR(iter->PartitionInputs(std::move(right_tuples),
+                                          std::move(right_overflow)));
+    return iter;
+  }
+
+  GraceHashJoinTupleIterator(const GraceHashJoinTupleIterator&) = delete;
+  GraceHashJoinTupleIterator& operator=(const GraceHashJoinTupleIterator&) =
+      delete;
+
+  const TupleSchema& Schema() const override { return *output_schema_; }
+
+  TupleData* Next() override {
+    while (true) {
+      if (partition_iter_ != nullptr) {
+        TupleData* tuple = partition_iter_->Next();
+        if (tuple != nullptr) return tuple;
+        status_ = partition_iter_->Status();
+        if (!status_.ok()) return nullptr;
+        partition_iter_.reset();
+      }
+      if (next_partition_ == kNumPartitions) return nullptr;
+      status_ = StartPartition(next_partition_++);
+      if (!status_.ok()) return nullptr;
+    }
+  }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  bool PreservesOrder() const override { return false; }
+
+  std::string DebugString() const override {
+    return JoinOp::GetIteratorDebugString(join_kind_, left_iter_->DebugString(),
+                                          right_iter_->DebugString());
+  }
+
+ private:
+  static constexpr int kNumPartitionBits = 5;
+  static constexpr int kNumPartitions = 1 << kNumPartitionBits;
+
+  GraceHashJoinTupleIterator(
+      JoinKind join_kind, absl::Span<const TupleData* const> params,
+      absl::Span<const ExprArg* const> left_equality_exprs,
+      absl::Span<const ExprArg* const> right_equality_exprs,
+      const ValueExpr* join_expr, std::unique_ptr<TupleIterator> left_iter,
+      absl::Span<const ExprArg* const> left_outputs,
+      std::unique_ptr<TupleIterator> right_iter,
+      absl::Span<const ExprArg* const> right_outputs,
+      std::unique_ptr<TupleSchema> output_schema, int num_extra_slots,
+      EvaluationContext* context)
+      : join_kind_(join_kind),
+        params_(params.begin(), params.end()),
+        left_equality_exprs_(left_equality_exprs.begin(),
+                             left_equality_exprs.end()),
+        right_equality_exprs_(right_equality_exprs.begin(),
+                              right_equality_exprs.end()),
+        join_expr_(join_expr),
+        left_iter_(std::move(left_iter)),
+        left_outputs_(left_outputs.begin(), left_outputs.end()),
+        right_iter_(std::move(right_iter)),
+        right_outputs_(right_outputs.begin(), right_outputs.end()),
+        output_schema_(std::move(output_schema)),
+        num_extra_slots_(num_extra_slots),
+        context_(context) {}
+
+  // Returns the partition of a tuple with join key 'key'. Avoids the high bits
+  // of the hash, which UncorrelatedHashedRightInput uses for its own
+  // partitioning, and the low bits, which absl::flat_hash_map uses.
+  static int GetPartition(const TupleData& key) {
+    const uint64_t hash = absl::Hash<TupleData>()(key);
+    return static_cast<int>((hash >> 32) & (kNumPartitions - 1));
+  }
+
+  // Writes 'tuple' to the partition in 'partitions' corresponding to its join
+  // key with respect to 'equality_exprs'.
+  zetasql_base::Status WriteToPartition(
+      const TupleData& tuple, absl::Span<const ExprArg* const> equality_exprs,
+      std::vector<std::unique_ptr<TupleSpillFile>>* partitions) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleData> key,
+                     UncorrelatedHashedRightInput::CreateTupleMapKey(
+                         params_, tuple, equality_exprs, context_));
+    return (*partitions)[GetPartition(*key)]->Write(tuple);
+  }
+
+  // Partitions the right-hand side and then the whole left-hand side.
+  zetasql_base::Status PartitionInputs(std::unique_ptr<TupleDataDeque> right_tuples,
+                               std::unique_ptr<TupleData> right_overflow) {
+    left_partitions_.resize(kNumPartitions);
+    right_partitions_.resize(kNumPartitions);
+    for (int i = 0; i < kNumPartitions; ++i) {
+      ZETASQL_ASSIGN_OR_RETURN(left_partitions_[i], TupleSpillFile::Create(context_));
+      ZETASQL_ASSIGN_OR_RETURN(right_partitions_[i],
+                       TupleSpillFile::Create(context_));
+    }
+
+    while (!right_tuples->IsEmpty()) {
+      ZETASQL_RETURN_IF_ERROR(WriteToPartition(
+          *right_tuples->PopFront(), right_equality_exprs_, &right_partitions_));
+    }
+    right_tuples.reset();
+    ZETASQL_RETURN_IF_ERROR(WriteToPartition(*right_overflow, right_equality_exprs_,
+                                     &right_partitions_));
+    ZETASQL_RETURN_IF_ERROR(
+        PartitionRest(right_iter_.get(), right_equality_exprs_,
+                      &right_partitions_));
+    ZETASQL_RETURN_IF_ERROR(PartitionRest(left_iter_.get(), left_equality_exprs_,
+                                  &left_partitions_));
+
+    for (int i = 0; i < kNumPartitions; ++i) {
+      ZETASQL_RETURN_IF_ERROR(left_partitions_[i]->FinishWriting());
+      ZETASQL_RETURN_IF_ERROR(right_partitions_[i]->FinishWriting());
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  // Writes the remaining tuples from 'iter' to 'partitions'.
+  zetasql_base::Status PartitionRest(
+      TupleIterator* iter, absl::Span<const ExprArg* const> equality_exprs,
+      std::vector<std::unique_ptr<TupleSpillFile>>* partitions) {
+    int64_t num_tuples = 0;
+    while (true) {
+      if (num_tuples++ %
+              absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period) ==
+          0) {
+        ZETASQL_RETURN_IF_ERROR(context_->VerifyNotAborted());
+      }
+      const TupleData* tuple = iter->Next();
+      if (tuple == nullptr) {
+        return iter->Status();
+      }
+      ZETASQL_RETURN_IF_ERROR(WriteToPartition(*tuple, equality_exprs, partitions));
+    }
+  }
+
+  // Loads right partition 'partition' into memory and sets 'partition_iter_'
+  // to a JoinTupleIterator that joins it with left partition 'partition'.
+  zetasql_base::Status StartPartition(int partition) {
+    std::unique_ptr<TupleSpillFile> right_partition =
+        std::move(right_partitions_[partition]);
+    auto right_tuples =
+        absl::make_unique<TupleDataDeque>(context_->memory_accountant());
+    zetasql_base::Status status;
+    while (true) {
+      auto tuple = absl::make_unique<TupleData>();
+      ZETASQL_ASSIGN_OR_RETURN(const bool found, right_partition->Read(tuple.get()));
+      if (!found) break;
+      if (!right_tuples->PushBack(std::move(tuple), &status)) {
+        return status;
+      }
+    }
+
+    // Like in JoinOp::CreateIterator(), the (exhausted) iterator over the right
+    // tuples is only used for debug strings.
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<RightInputForJoin> right_input,
+        UncorrelatedHashedRightInput::Create(
+            params_, left_equality_exprs_, right_equality_exprs_,
+            absl::make_unique<TupleSchema>(right_iter_->Schema().variables()),
+            std::move(right_tuples),
+            absl::make_unique<TupleSpillFileIterator>(
+                absl::make_unique<TupleSchema>(
+                    right_iter_->Schema().variables()),
+                std::move(right_partition)),
+            /*num_threads=*/1, context_));
+    auto left_partition_iter = absl::make_unique<TupleSpillFileIterator>(
+        absl::make_unique<TupleSchema>(left_iter_->Schema().variables()),
+        std::move(left_partitions_[partition]));
+    partition_iter_ = absl::make_unique<JoinTupleIterator>(
+        join_kind_, params_, join_expr_, std::move(left_partition_iter),
+        left_outputs_, std::move(right_input), right_outputs_,
+        absl::make_unique<TupleSchema>(output_schema_->variables()),
+        /*left_morsel_size=*/0, num_extra_slots_, context_);
+    return zetasql_base::OkStatus();
+  }
+
+  const JoinKind join_kind_;
+  const std::vector<const TupleData*> params_;
+  const std::vector<const ExprArg*> left_equality_exprs_;
+  const std::vector<const ExprArg*> right_equality_exprs_;
+  const ValueExpr* join_expr_;
+  // Exhausted after construction. Only used for Schema() and DebugString().
+  const std::unique_ptr<TupleIterator> left_iter_;
+  const std::vector<const ExprArg*> left_outputs_;
+  // Exhausted after construction. Only used for Schema() and DebugString().
+  const std::unique_ptr<TupleIterator> right_iter_;
+  const std::vector<const ExprArg*> right_outputs_;
+  const std::unique_ptr<TupleSchema> output_schema_;
+  const int num_extra_slots_;
+
+  // Each partition is moved out of these vectors when it is joined.
+  std::vector<std::unique_ptr<TupleSpillFile>> left_partitions_;
+  std::vector<std::unique_ptr<TupleSpillFile>> right_partitions_;
+  // Joins partition 'next_partition_' - 1, if non-NULL.
+  std::unique_ptr<TupleIterator> partition_iter_;
+  int next_partition_ = 0;
+
+  zetasql_base::Status status_;
+  EvaluationContext* context_;
+};
+
+}  // namespace
+
+namespace {
+
+// Passes through the tuples of an iterator that was created with 'params',
+// which this object owns.
+class TupleIteratorWithParams : public TupleIterator {
+ public:
+  TupleIteratorWithParams(std::unique_ptr<TupleData> params,
+                          std::unique_ptr<TupleIterator> iter)
+      : params_(std::move(params)), iter_(std::move(iter)) {}
+
+  TupleIteratorWithParams(const TupleIteratorWithParams&) = delete;
+  TupleIteratorWithParams& operator=(const TupleIteratorWithParams&) = delete;
+
+  const TupleSchema& Schema() const override { return iter_->Schema(); }
+
+  TupleData* Next() override { return iter_->Next(); }
+
+  zetasql_base::Status Status() const override { return iter_->Status(); }
+
+  bool PreservesOrder() const override { return iter_->PreservesOrder(); }
+
+  zetasql_base::Status DisableReordering() override {
+    return iter_->DisableReordering();
+  }
+
+  std::string DebugString() const override { return iter_->DebugString(); }
+
+ private:
+  const std::unique_ptr<TupleData> params_;
+  std::unique_ptr<TupleIterator> iter_;
+};
+
+// Creates an iterator for 'left_input' of a JoinOp with 'params', followed by
+// the build keys in 'build_keys_parameters' (see
+// JoinOp::AddBuildKeysParameter()) if there are any. 'hashed_right_input' is
+// the hash table of the right input, or NULL if the join did not build one.
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateJoinLeftIterator(
+    const RelationalOp* left_input, absl::Span<const TupleData* const> params,
+    absl::Span<const JoinOp::BuildKeysParameter> build_keys_parameters,
+    const UncorrelatedHashedRightInput* hashed_right_input,
+    EvaluationContext* context) {
+  if (build_keys_parameters.empty()) {
+    return left_input->CreateIterator(params, /*num_extra_slots=*/0, context);
+  }
+
+  auto build_keys =
+      absl::make_unique<TupleData>(3 * build_keys_parameters.size());
+  for (int i = 0; i < build_keys_parameters.size(); ++i) {
+    const JoinOp::BuildKeysParameter& parameter = build_keys_parameters[i];
+    const Type* key_type = parameter.keys_type->element_type();
+    Value keys = Value::Null(parameter.keys_type);
+    Value min_key = Value::Null(key_type);
+    Value max_key = Value::Null(key_type);
+    if (hashed_right_input != nullptr) {
+      hashed_right_input->GetBuildKeys(parameter.equality_expr_idx,
+                                       parameter.keys_type, &keys, &min_key,
+                                       &max_key);
+    }
+    build_keys->mutable_slot(3 * i)->SetValue(keys);
+    build_keys->mutable_slot(3 * i + 1)->SetValue(min_key);
+    build_keys->mutable_slot(3 * i + 2)->SetValue(max_key);
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<TupleIterator> iter,
+      left_input->CreateIterator(ConcatSpans(params, {build_keys.get()}),
+                                 /*num_extra_slots=*/0, context));
+  iter = absl::make_unique<TupleIteratorWithParams>(std::move(build_keys),
+                                                    std::move(iter));
+  return iter;
+}
+
 }  // namespace
 
-zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> JoinOp::CreateIterator(
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> JoinOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
+  // The number of left tuples per thread that a parallel hash join probes at a
+  // time.
+  constexpr int kLeftMorselSizePerThread = 1024;
+
   std::unique_ptr<RightInputForJoin> right_hand_side;
+  // Owned by 'right_hand_side' if it is a hash table.
+  const UncorrelatedHashedRightInput* hashed_right_hand_side = nullptr;
+  int left_morsel_size = 0;
   switch (join_kind_) {
     case kInnerJoin:
     case kLeftOuterJoin:
     case kRightOuterJoin:
     case kFullOuterJoin: {
+      // Multiple threads and scrambling both change the order of the inputs.
+      if (num_merge_join_keys_ > 0 && context->options().num_threads <= 1 &&
+          !context->options().scramble_undefined_orderings) {
+        ZETASQL_ASSIGN_OR_RETURN(
+            std::unique_ptr<TupleIterator> right_iter,
+            right_input()->CreateIterator(params, /*num_extra_slots=*/0,
+                                          context));
+        ZETASQL_ASSIGN_OR_RETURN(
+            right_hand_side,
+            MergeJoinRightInput::Create(
+                params, hash_join_equality_left_exprs(),
+                hash_join_equality_right_exprs(), num_merge_join_keys_,
+                right_input()->CreateOutputSchema(), std::move(right_iter),
+                context));
+        break;
+      }
       auto tuples =
           absl::make_unique<TupleDataDeque>(context->memory_accountant());
       std::unique_ptr<TupleIterator> iter_for_right_debug_string;
-      ZETASQL_RETURN_IF_ERROR(ExtractFromRelationalOp(right_input(), params, context,
-                                              tuples.get(),
-                                              &iter_for_right_debug_string));
+      if (!hash_join_equality_left_exprs().empty() && !is_order_preserving() &&
+          !context->options().spill_directory.empty()) {
+        // Fall back to a grace hash join if the right-hand side does not fit
+        // in memory. We can't do that if the output must preserve the order
+        // of the left input.
+        ZETASQL_ASSIGN_OR_RETURN(
+            std::unique_ptr<TupleIterator> right_iter,
+            right_input()->CreateIterator(params, /*num_extra_slots=*/0,
+                                          context));
+        std::unique_ptr<TupleData> right_overflow;
+        ZETASQL_ASSIGN_OR_RETURN(const bool fits_in_memory,
+                         ExtractFromTupleIteratorUnlessSpilling(
+                             right_iter.get(), context, tuples.get(),
+                             &right_overflow));
+        if (!fits_in_memory) {
+          ZETASQL_ASSIGN_OR_RETURN(
+              std::unique_ptr<TupleIterator> left_iter,
+              CreateJoinLeftIterator(left_input(), params,
+                                     build_keys_parameters_,
+                                     /*hashed_right_input=*/nullptr, context));
+          ZETASQL_ASSIGN_OR_RETURN(
+              std::unique_ptr<TupleIterator> iter,
+              GraceHashJoinTupleIterator::Create(
+                  join_kind_, params, hash_join_equality_left_exprs(),
+                  hash_join_equality_right_exprs(), remaining_join_expr(),
+                  std::move(left_iter), left_outputs(), std::move(tuples),
+                  std::move(right_overflow), std::move(right_iter),
+                  right_outputs(), CreateOutputSchema(), num_extra_slots,
+                  context));
+          return MaybeReorder(std::move(iter), context);
+        }
+        iter_for_right_debug_string = std::move(right_iter);
+      } else {
+        ZETASQL_RETURN_IF_ERROR(ExtractFromRelationalOp(right_input(), params,
+                                                context, tuples.get(),
+                                                &iter_for_right_debug_string));
+      }
       if (hash_join_equality_left_exprs().empty()) {
         right_hand_side = absl::make_unique<UncorrelatedRightInput>(
             right_input()->CreateOutputSchema(), std::move(tuples),
             std::move(iter_for_right_debug_string));
       } else {
         ZETASQL_ASSIGN_OR_RETURN(
-            right_hand_side,
+            std::unique_ptr<UncorrelatedHashedRightInput> hashed_right_input,
             UncorrelatedHashedRightInput::Create(
                 params, hash_join_equality_left_exprs(),
                 hash_join_equality_right_exprs(),
                 right_input()->CreateOutputSchema(), std::move(tuples),
-                std::move(iter_for_right_debug_string), context));
+                std::move(iter_for_right_debug_string),
+                context->options().num_threads, context));
+        hashed_right_hand_side = hashed_right_input.get();
+        right_hand_side = std::move(hashed_right_input);
+        if (context->options().num_threads > 1) {
+          left_morsel_size = kLeftMorselSizePerThread *
+                             context->options().num_threads;
+        }
       }
       break;
     }
@@ -2875,12 +5695,13 @@ zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> JoinOp::CreateIterator(
 
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<TupleIterator> left_iter,
-      left_input()->CreateIterator(params, /*num_extra_slots=*/0, context));
+      CreateJoinLeftIterator(left_input(), params, build_keys_parameters_,
+                             hashed_right_hand_side, context));
 
   std::unique_ptr<TupleIterator> iter = absl::make_unique<JoinTupleIterator>(
       join_kind_, params, remaining_join_expr(), std::move(left_iter),
       left_outputs(), std::move(right_hand_side), right_outputs(),
-      CreateOutputSchema(), num_extra_slots, context);
+      CreateOutputSchema(), left_morsel_size, num_extra_slots, context);
   return MaybeReorder(std::move(iter), context);
 }
 
@@ -2968,14 +5789,55 @@ std::string JoinOp::DebugInternal(const std::string& indent,
       (join_kind_ == kRightOuterJoin || join_kind_ == kFullOuterJoin) ? kN : k0;
   const ArgPrintMode right_output_mode =
       (join_kind_ == kInnerJoin || join_kind_ == kCrossApply) ? k0 : kN;
+  const std::string merge_join_string =
+      num_merge_join_keys_ > 0
+          ? absl::StrCat(", num_merge_join_keys=", num_merge_join_keys_)
+          : "";
   return absl::StrCat(
-      "JoinOp(", JoinKindToString(join_kind_),
+      "JoinOp(", JoinKindToString(join_kind_), merge_join_string,
       ArgDebugString(*arg_names,
                      {left_output_mode, right_output_mode, kN, kN, k1, k1, k1},
                      indent, verbose),
       ")");
 }
 
+zetasql_base::Status JoinOp::set_num_merge_join_keys(int num_merge_join_keys) {
+  ZETASQL_RET_CHECK(join_kind_ == kInnerJoin || join_kind_ == kLeftOuterJoin)
+      << JoinKindToString(join_kind_);
+  ZETASQL_RET_CHECK_GE(num_merge_join_keys, 0);
+  ZETASQL_RET_CHECK_LE(num_merge_join_keys, hash_join_equality_left_exprs().size());
+  num_merge_join_keys_ = num_merge_join_keys;
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status JoinOp::AddBuildKeysParameter(int equality_expr_idx,
+                                            const VariableId& keys,
+                                            const VariableId& min_key,
+                                            const VariableId& max_key,
+                                            const ArrayType* keys_type) {
+  ZETASQL_RET_CHECK(join_kind_ == kInnerJoin || join_kind_ == kRightOuterJoin)
+      << JoinKindToString(join_kind_);
+  ZETASQL_RET_CHECK_GE(equality_expr_idx, 0);
+  ZETASQL_RET_CHECK_LT(equality_expr_idx, hash_join_equality_right_exprs().size());
+  ZETASQL_RET_CHECK(keys_type->element_type()->Equals(
+      hash_join_equality_right_exprs()[equality_expr_idx]->type()));
+  build_keys_parameters_.push_back(
+      {equality_expr_idx, keys, min_key, max_key, keys_type});
+  return zetasql_base::OkStatus();
+}
+
+std::unique_ptr<TupleSchema> JoinOp::CreateBuildKeysSchema() const {
+  if (build_keys_parameters_.empty()) return nullptr;
+  std::vector<VariableId> variables;
+  variables.reserve(3 * build_keys_parameters_.size());
+  for (const BuildKeysParameter& parameter : build_keys_parameters_) {
+    variables.push_back(parameter.keys);
+    variables.push_back(parameter.min_key);
+    variables.push_back(parameter.max_key);
+  }
+  return absl::make_unique<TupleSchema>(variables);
+}
+
 JoinOp::JoinOp(
     JoinKind kind,
     std::vector<std::unique_ptr<ExprArg>> hash_join_equality_left_exprs,
@@ -3076,17 +5938,230 @@ std::string ArrayScanOp::GetIteratorDebugString(
     absl::Span<const std::pair<VariableId, int>> fields,
     std::unique_ptr<ValueExpr> array) {
   ZETASQL_RET_CHECK(array->output_type()->IsArray());
-  return absl::WrapUnique(
-      new ArrayScanOp(element, position, fields, std::move(array)));
+  const ArrayType* array_type = array->output_type()->AsArray();
+  return absl::WrapUnique(new ArrayScanOp(element, position, fields,
+                                          array_type, std::move(array),
+                                          /*generator_arguments=*/{}));
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<ArrayScanOp>>
+ArrayScanOp::CreateForGeneratedArray(
+    const VariableId& element, const VariableId& position,
+    const ArrayType* array_type,
+    std::vector<std::unique_ptr<ValueExpr>> generator_arguments) {
+  ZETASQL_RET_CHECK_GE(generator_arguments.size(), 2);
+  ZETASQL_RET_CHECK_LE(generator_arguments.size(), 4);
+  switch (array_type->element_type()->kind()) {
+    case TYPE_INT64:
+    case TYPE_UINT64:
+    case TYPE_NUMERIC:
+    case TYPE_DOUBLE:
+    case TYPE_DATE:
+      break;
+    case TYPE_TIMESTAMP:
+      // GENERATE_TIMESTAMP_ARRAY requires a step.
+      ZETASQL_RET_CHECK_EQ(generator_arguments.size(), 4);
+      break;
+    default:
+      ZETASQL_RET_CHECK_FAIL() << "Unsupported generated array type: "
+                       << array_type->DebugString();
+  }
+  return absl::WrapUnique(new ArrayScanOp(
+      element, position, /*fields=*/{}, array_type, /*array=*/nullptr,
+      std::move(generator_arguments)));
+}
+
+::zetasql_base::Status ArrayScanOp::set_filter(
+    std::unique_ptr<ValueExpr> filter,
+    absl::Span<const VariableId> filter_variables) {
+  ZETASQL_RET_CHECK(!has_filter());
+  const std::unique_ptr<const TupleSchema> schema = CreateOutputSchema();
+  filter_slots_.assign(schema->num_variables(), false);
+  for (const VariableId& variable : filter_variables) {
+    const absl::optional<int> slot = schema->FindIndexForVariable(variable);
+    if (slot.has_value()) filter_slots_[slot.value()] = true;
+  }
+  SetArg(kFilter, absl::make_unique<ExprArg>(std::move(filter)));
+  return zetasql_base::OkStatus();
 }
 
 ::zetasql_base::Status ArrayScanOp::SetSchemasForEvaluation(
     absl::Span<const TupleSchema* const> params_schemas) {
-  return mutable_array_expr()->SetSchemasForEvaluation(params_schemas);
+  if (is_generated_array()) {
+    for (ExprArg* argument : mutable_generator_arguments()) {
+      ZETASQL_RETURN_IF_ERROR(
+          argument->mutable_value_expr()->SetSchemasForEvaluation(
+              params_schemas));
+    }
+  } else {
+    ZETASQL_RETURN_IF_ERROR(
+        mutable_array_expr()->SetSchemasForEvaluation(params_schemas));
+  }
+  if (!has_filter()) return zetasql_base::OkStatus();
+  const std::unique_ptr<const TupleSchema> schema = CreateOutputSchema();
+  return mutable_filter()->SetSchemasForEvaluation(
+      ConcatSpans(params_schemas, {schema.get()}));
 }
 
 namespace {
-// Returns one tuple per element of 'array_value'.
+// The elements scanned by an ArrayScanTupleIterator.
+class ArrayElementSource {
+ public:
+  virtual ~ArrayElementSource() {}
+
+  // Returns the next element, or NULL after the last one. The element is
+  // valid until the next call.
+  virtual const Value* Next() = 0;
+
+  // Returns true if the order of the elements is not defined.
+  virtual bool IgnoresOrder() const = 0;
+
+  virtual std::string DebugString() const = 0;
+};
+
+// The elements of an array value. A NULL array has no elements.
+class ArrayValueElementSource : public ArrayElementSource {
+ public:
+  explicit ArrayValueElementSource(const Value& array_value)
+      : array_value_(array_value) {}
+
+  const Value* Next() override {
+    if (array_value_.is_null() ||
+        next_element_idx_ == array_value_.num_elements()) {
+      return nullptr;
+    }
+    return &array_value_.element(next_element_idx_++);
+  }
+
+  bool IgnoresOrder() const override {
+    return !array_value_.is_null() &&
+           InternalValue::GetOrderKind(array_value_) ==
+               InternalValue::kIgnoresOrder &&
+           array_value_.num_elements() > 1;
+  }
+
+  std::string DebugString() const override {
+    return array_value_.DebugString();
+  }
+
+ private:
+  const Value array_value_;
+  int next_element_idx_ = 0;
+};
+
+// The elements of a generated array, which are computed by
+// functions::ArrayGenerator<T> as they are read.
+template <typename T>
+class GeneratedElementSource : public ArrayElementSource {
+ public:
+  using MakeValueFn = Value (*)(typename T::elem_t);
+
+  explicit GeneratedElementSource(MakeValueFn make_value)
+      : make_value_(make_value) {}
+
+  zetasql_base::Status Init(typename T::elem_t start, typename T::elem_t end,
+                    typename T::step_t step) {
+    return generator_.Init(start, end, step);
+  }
+
+  const Value* Next() override {
+    typename T::elem_t value;
+    if (!generator_.Next(&value)) return nullptr;
+    current_ = make_value_(value);
+    return &current_;
+  }
+
+  bool IgnoresOrder() const override { return false; }
+
+  std::string DebugString() const override { return "<generated array>"; }
+
+ private:
+  functions::ArrayGenerator<T> generator_;
+  const MakeValueFn make_value_;
+  Value current_;
+};
+
+// A source with no elements, for a generated array with a NULL argument.
+class EmptyElementSource : public ArrayElementSource {
+ public:
+  const Value* Next() override { return nullptr; }
+  bool IgnoresOrder() const override { return false; }
+  std::string DebugString() const override { return "NULL"; }
+};
+
+template <typename T>
+zetasql_base::StatusOr<std::unique_ptr<ArrayElementSource>>
+MakeGeneratedElementSource(
+    typename T::elem_t start, typename T::elem_t end, typename T::step_t step,
+    typename GeneratedElementSource<T>::MakeValueFn make_value) {
+  auto source = absl::make_unique<GeneratedElementSource<T>>(make_value);
+  ZETASQL_RETURN_IF_ERROR(source->Init(start, end, step));
+  return std::unique_ptr<ArrayElementSource>(std::move(source));
+}
+
+Value MakeDateValue(int64_t date) { return Value::Date(date); }
+
+// Returns the elements of the array that GENERATE_ARRAY,
+// GENERATE_DATE_ARRAY or GENERATE_TIMESTAMP_ARRAY returns for 'args', the
+// same way as GenerateArrayFunction::Eval(), but without materializing it.
+zetasql_base::StatusOr<std::unique_ptr<ArrayElementSource>>
+MakeGeneratedArraySource(
+    const Type* element_type, absl::Span<const Value> args) {
+  for (const Value& arg : args) {
+    if (arg.is_null()) return absl::make_unique<EmptyElementSource>();
+  }
+  const bool has_step = args.size() >= 3;
+  switch (element_type->kind()) {
+    case TYPE_INT64:
+      return MakeGeneratedElementSource<
+          functions::ArrayGenTrait<int64_t, int64_t>>(
+          args[0].int64_value(), args[1].int64_value(),
+          has_step ? args[2].int64_value() : 1, &Value::Int64);
+    case TYPE_UINT64:
+      return MakeGeneratedElementSource<
+          functions::ArrayGenTrait<uint64_t, uint64_t>>(
+          args[0].uint64_value(), args[1].uint64_value(),
+          has_step ? args[2].uint64_value() : 1, &Value::Uint64);
+    case TYPE_NUMERIC:
+      return MakeGeneratedElementSource<
+          functions::ArrayGenTrait<NumericValue, NumericValue>>(
+          args[0].numeric_value(), args[1].numeric_value(),
+          has_step ? args[2].numeric_value() : NumericValue(1LL),
+          &Value::Numeric);
+    case TYPE_DOUBLE:
+      return MakeGeneratedElementSource<
+          functions::ArrayGenTrait<double, double>>(
+          args[0].double_value(), args[1].double_value(),
+          has_step ? args[2].double_value() : 1.0, &Value::Double);
+    case TYPE_DATE: {
+      functions::DateIncrement increment{functions::DAY, 1};
+      if (has_step) {
+        increment.unit =
+            static_cast<functions::DateTimestampPart>(args[3].enum_value());
+        increment.value = args[2].int64_value();
+      }
+      return MakeGeneratedElementSource<
+          functions::ArrayGenTrait<int64_t, functions::DateIncrement>>(
+          args[0].date_value(), args[1].date_value(), increment,
+          &MakeDateValue);
+    }
+    case TYPE_TIMESTAMP: {
+      ZETASQL_RET_CHECK(has_step);
+      functions::TimestampIncrement increment;
+      increment.unit =
+          static_cast<functions::DateTimestampPart>(args[3].enum_value());
+      increment.value = args[2].int64_value();
+      return MakeGeneratedElementSource<
+          functions::ArrayGenTrait<absl::Time, functions::TimestampIncrement>>(
+          args[0].ToTime(), args[1].ToTime(), increment, &Value::Timestamp);
+    }
+    default:
+      return ::zetasql_base::UnimplementedErrorBuilder()
+             << "Unsupported argument type for generate_array.";
+  }
+}
+
+// Returns one tuple per element of 'source'.
 // - If 'element' is valid, the tuple includes a variable containing the array
 //   element.
 // - If 'position' is valid, the tuple includes a variable containing the
@@ -3095,22 +6170,35 @@ namespace {
 //   the corresponding field of the array element (which must be a struct if
 //   'field_list' is non-empty). This functionality is useful for scanning an
 //   table represented as an array (e.g., in the compliance tests).
+// If 'filter' is non-NULL, elements for which it is not true are skipped. Only
+// the slots for which 'filter_slots' is true are populated before evaluating
+// it, so the rest of the tuple is only built for the elements that pass.
 class ArrayScanTupleIterator : public TupleIterator {
  public:
   ArrayScanTupleIterator(
-      const Value& array_value, const VariableId& element,
+      std::unique_ptr<ArrayElementSource> source, const VariableId& element,
       const VariableId& position,
       absl::Span<const ArrayScanOp::FieldArg* const> field_list,
+      const ValueExpr* filter, const std::vector<bool>& filter_slots,
+      absl::Span<const TupleData* const> params,
       std::unique_ptr<TupleSchema> schema, int num_extra_slots,
       EvaluationContext* context)
-      : array_value_(array_value),
+      : source_(std::move(source)),
         schema_(std::move(schema)),
         include_element_(element.is_valid()),
         include_position_(position.is_valid()),
         field_list_(field_list.begin(), field_list.end()),
+        filter_(filter),
         current_(schema_->num_variables() + num_extra_slots),
         context_(context) {
     context_->RegisterCancelCallback([this] { return Cancel(); });
+    if (filter_ != nullptr) {
+      for (int i = 0; i < schema_->num_variables(); ++i) {
+        (filter_slots[i] ? filter_slots_ : other_slots_).push_back(i);
+      }
+      params_and_current_.assign(params.begin(), params.end());
+      params_and_current_.push_back(&current_);
+    }
   }
 
   ArrayScanTupleIterator(const ArrayScanTupleIterator&) = delete;
@@ -3119,24 +6207,7 @@ class ArrayScanTupleIterator : public TupleIterator {
   const TupleSchema& Schema() const override { return *schema_; }
 
   TupleData* Next() override {
-    // Scanning a NULL array results in no output.
-    if (array_value_.is_null()) {
-      return nullptr;
-    }
-
-    if (next_element_idx_ == array_value_.num_elements()) {
-      // Done iterating over the array. The output is non-deterministic if it
-      // includes the position but the array is unordered and has more than one
-      // element.
-      if (include_position_ &&
-          (InternalValue::GetOrderKind(array_value_) ==
-           InternalValue::kIgnoresOrder) &&
-          array_value_.num_elements() > 1) {
-        context_->SetNonDeterministicOutput();
-      }
-
-      return nullptr;
-    }
+    if (done_) return nullptr;
 
     if (cancelled_) {
       status_ = zetasql_base::CancelledErrorBuilder()
@@ -3144,19 +6215,15 @@ class ArrayScanTupleIterator : public TupleIterator {
       return nullptr;
     }
 
-    const Value& element = array_value_.element(next_element_idx_);
-    for (int i = 0; i < field_list_.size(); ++i) {
-      current_.mutable_slot(i)->SetValue(
-          element.field(field_list_[i]->field_index()));
-    }
-    int next_value_idx = field_list_.size();
-    if (include_element_) {
-      current_.mutable_slot(next_value_idx)->SetValue(element);
-
-      ++next_value_idx;
+    if (filter_ != nullptr) {
+      return NextFiltered();
     }
-    if (include_position_) {
-      current_.mutable_slot(next_value_idx)->SetValue(Int64(next_element_idx_));
+    status_ = context_->VerifyNotAbortedPeriodically(&num_elements_read_);
+    if (!status_.ok()) return nullptr;
+    const Value* element = source_->Next();
+    if (element == nullptr) return Finish();
+    for (int i = 0; i < schema_->num_variables(); ++i) {
+      SetSlot(i, *element);
     }
     ++next_element_idx_;
 
@@ -3166,7 +6233,7 @@ class ArrayScanTupleIterator : public TupleIterator {
   zetasql_base::Status Status() const override { return status_; }
 
   std::string DebugString() const override {
-    return ArrayScanOp::GetIteratorDebugString(array_value_.DebugString());
+    return ArrayScanOp::GetIteratorDebugString(source_->DebugString());
   }
 
   zetasql_base::Status Cancel() {
@@ -3175,30 +6242,110 @@ class ArrayScanTupleIterator : public TupleIterator {
   }
 
  private:
-  const Value array_value_;
+  // Called after the last element. The output is non-deterministic if it
+  // includes the position but the order of the elements is not defined.
+  TupleData* Finish() {
+    done_ = true;
+    if (include_position_ && source_->IgnoresOrder()) {
+      context_->SetNonDeterministicOutput();
+    }
+    return nullptr;
+  }
+
+  // Populates slot 'i' of 'current_' for 'element', which is at
+  // 'next_element_idx_'. The slots hold the fields, then the element, and then
+  // the position.
+  void SetSlot(int i, const Value& element) {
+    if (i < field_list_.size()) {
+      current_.mutable_slot(i)->SetValue(
+          element.field(field_list_[i]->field_index()));
+    } else if (include_element_ && i == field_list_.size()) {
+      current_.mutable_slot(i)->SetValue(element);
+    } else {
+      current_.mutable_slot(i)->SetValue(Int64(next_element_idx_));
+    }
+  }
+
+  // Next() for a non-NULL 'filter_'.
+  TupleData* NextFiltered() {
+    for (const Value* element = source_->Next(); element != nullptr;
+         element = source_->Next(), ++next_element_idx_) {
+      // A selective filter over a large generated array can read many
+      // elements for one output row.
+      status_ = context_->VerifyNotAbortedPeriodically(&num_elements_read_);
+      if (!status_.ok()) return nullptr;
+      for (const int i : filter_slots_) {
+        SetSlot(i, *element);
+      }
+      TupleSlot slot;
+      if (!filter_->EvalSimple(params_and_current_, context_, &slot,
+                               &status_)) {
+        return nullptr;
+      }
+      if (slot.value() != Bool(true)) continue;
+
+      for (const int i : other_slots_) {
+        SetSlot(i, *element);
+      }
+      ++next_element_idx_;
+      return &current_;
+    }
+    return Finish();
+  }
+
+  const std::unique_ptr<ArrayElementSource> source_;
   const std::unique_ptr<TupleSchema> schema_;
   const bool include_element_;
   const bool include_position_;
   const std::vector<const ArrayScanOp::FieldArg*> field_list_;
+  const ValueExpr* filter_;
+  // The slots that are populated before and after evaluating 'filter_'.
+  std::vector<int> filter_slots_;
+  std::vector<int> other_slots_;
+  // The parameters followed by 'current_', for evaluating 'filter_'.
+  std::vector<const TupleData*> params_and_current_;
   TupleData current_;
-  int next_element_idx_ = 0;
+  // A generated array may have more elements than fit in an int.
+  int64_t next_element_idx_ = 0;
+  // For VerifyNotAbortedPeriodically().
+  int64_t num_elements_read_ = 0;
+  bool done_ = false;
   bool cancelled_ = false;
   zetasql_base::Status status_;
   EvaluationContext* context_;
 };
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> ArrayScanOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> ArrayScanOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
-  TupleSlot array_slot;
-  ::zetasql_base::Status status;
-  if (!array_expr()->EvalSimple(params, context, &array_slot, &status))
-    return status;
+  std::unique_ptr<ArrayElementSource> source;
+  if (is_generated_array()) {
+    std::vector<Value> args;
+    args.reserve(generator_arguments().size());
+    for (const ExprArg* argument : generator_arguments()) {
+      TupleSlot slot;
+      ::zetasql_base::Status status;
+      if (!argument->value_expr()->EvalSimple(params, context, &slot,
+                                              &status)) {
+        return status;
+      }
+      args.push_back(slot.value());
+    }
+    ZETASQL_ASSIGN_OR_RETURN(source, MakeGeneratedArraySource(
+                                 array_type_->element_type(), args));
+  } else {
+    TupleSlot array_slot;
+    ::zetasql_base::Status status;
+    if (!array_expr()->EvalSimple(params, context, &array_slot, &status))
+      return status;
+    source = absl::make_unique<ArrayValueElementSource>(array_slot.value());
+  }
   std::unique_ptr<TupleIterator> iter =
       absl::make_unique<ArrayScanTupleIterator>(
-          array_slot.value(), element(), position(), field_list(),
-          CreateOutputSchema(), num_extra_slots, context);
+          std::move(source), element(), position(), field_list(), filter(),
+          filter_slots_, params, CreateOutputSchema(), num_extra_slots,
+          context);
   return MaybeReorder(std::move(iter), context);
 }
 
@@ -3229,8 +6376,7 @@ std::string ArrayScanOp::DebugInternal(const std::string& indent,
                                        bool verbose) const {
   std::string indent_child = indent + kIndentSpace;
   std::string indent_input = indent + kIndentFork;
-  const Type* element_type =
-      array_expr()->output_type()->AsArray()->element_type();
+  const Type* element_type = array_type_->element_type();
   std::vector<std::string> fstr;
   for (auto ch : field_list()) {
     const std::string& field_name =
@@ -3239,6 +6385,18 @@ std::string ArrayScanOp::DebugInternal(const std::string& indent,
                                 field_name, ",", indent_input));
   }
   std::sort(fstr.begin(), fstr.end());
+  std::string array_debug_string;
+  if (is_generated_array()) {
+    std::vector<std::string> arguments;
+    for (const ExprArg* argument : generator_arguments()) {
+      arguments.push_back(
+          argument->value_expr()->DebugInternal(indent_child, verbose));
+    }
+    array_debug_string =
+        absl::StrCat("Generate(", absl::StrJoin(arguments, ", "), ")");
+  } else {
+    array_debug_string = array_expr()->DebugInternal(indent_child, verbose);
+  }
   return absl::StrCat(
       "ArrayScanOp(", indent_input,
       (!element().is_valid() ? ""
@@ -3247,22 +6405,38 @@ std::string ArrayScanOp::DebugInternal(const std::string& indent,
       (!position().is_valid() ? ""
                               : absl::StrCat(GetArg(kPosition)->DebugString(),
                                              " := position,", indent_input)),
-      absl::StrJoin(fstr, ""),
-      "array: ", array_expr()->DebugInternal(indent_child, verbose), ")");
+      absl::StrJoin(fstr, ""), "array: ", array_debug_string,
+      (!has_filter() ? ""
+                     : absl::StrCat(",", indent_input, "filter: ",
+                                    filter()->DebugInternal(indent_child,
+                                                            verbose))),
+      ")");
 }
 
-ArrayScanOp::ArrayScanOp(const VariableId& element, const VariableId& position,
-                         absl::Span<const std::pair<VariableId, int>> fields,
-                         std::unique_ptr<ValueExpr> array) {
-  CHECK(array->output_type()->IsArray());
-  const Type* element_type = array->output_type()->AsArray()->element_type();
+ArrayScanOp::ArrayScanOp(
+    const VariableId& element, const VariableId& position,
+    absl::Span<const std::pair<VariableId, int>> fields,
+    const ArrayType* array_type, std::unique_ptr<ValueExpr> array,
+    std::vector<std::unique_ptr<ValueExpr>> generator_arguments)
+    : array_type_(array_type) {
+  CHECK((array == nullptr) != generator_arguments.empty());
+  const Type* element_type = array_type->element_type();
   SetArg(kElement, !element.is_valid()
                        ? nullptr
                        : absl::make_unique<ExprArg>(element, element_type));
   SetArg(kPosition, !position.is_valid() ? nullptr
                                          : absl::make_unique<ExprArg>(
                                                position, types::Int64Type()));
-  SetArg(kArray, absl::make_unique<ExprArg>(std::move(array)));
+  SetArg(kArray, array == nullptr
+                     ? nullptr
+                     : absl::make_unique<ExprArg>(std::move(array)));
+  SetArg(kFilter, nullptr);
+  std::vector<std::unique_ptr<ExprArg>> generator_args;
+  generator_args.reserve(generator_arguments.size());
+  for (auto& argument : generator_arguments) {
+    generator_args.push_back(absl::make_unique<ExprArg>(std::move(argument)));
+  }
+  SetArgs<ExprArg>(kGeneratorArgument, std::move(generator_args));
   std::vector<std::unique_ptr<FieldArg>> field_args;
   field_args.reserve(fields.size());
   for (const auto& f : fields) {
@@ -3273,17 +6447,33 @@ ArrayScanOp::ArrayScanOp(const VariableId& element, const VariableId& position,
 }
 
 const ValueExpr* ArrayScanOp::array_expr() const {
-  return GetArg(kArray)->value_expr();
+  return GetArg(kArray) != nullptr ? GetArg(kArray)->value_expr() : nullptr;
 }
 
 ValueExpr* ArrayScanOp::mutable_array_expr() {
   return GetMutableArg(kArray)->mutable_value_expr();
 }
 
+const ValueExpr* ArrayScanOp::filter() const {
+  return has_filter() ? GetArg(kFilter)->value_expr() : nullptr;
+}
+
+ValueExpr* ArrayScanOp::mutable_filter() {
+  return GetMutableArg(kFilter)->mutable_value_expr();
+}
+
 absl::Span<const ArrayScanOp::FieldArg* const> ArrayScanOp::field_list() const {
   return GetArgs<FieldArg>(kField);
 }
 
+absl::Span<const ExprArg* const> ArrayScanOp::generator_arguments() const {
+  return GetArgs<ExprArg>(kGeneratorArgument);
+}
+
+absl::Span<ExprArg* const> ArrayScanOp::mutable_generator_arguments() {
+  return GetMutableArgs<ExprArg>(kGeneratorArgument);
+}
+
 const VariableId& ArrayScanOp::element() const {
   static const VariableId* empty_str = new VariableId();
   return GetArg(kElement) != nullptr ? GetArg(kElement)->variable()
@@ -3296,6 +6486,123 @@ const VariableId& ArrayScanOp::position() const {
                                       : *empty_str;
 }
 
+// -------------------------------------------------------
+// WithRefScanOp
+// -------------------------------------------------------
+
+std::string WithRefScanOp::GetIteratorDebugString(
+    absl::string_view with_table) {
+  return absl::StrCat("WithRefScanTupleIterator(", with_table, ")");
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<WithRefScanOp>> WithRefScanOp::Create(
+    const VariableId& with_table, std::vector<VariableId> columns) {
+  ZETASQL_RET_CHECK(with_table.is_valid());
+  return absl::WrapUnique(new WithRefScanOp(with_table, std::move(columns)));
+}
+
+::zetasql_base::Status WithRefScanOp::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  return zetasql_base::OkStatus();
+}
+
+namespace {
+// Returns copies of the tuples of a WITH table, with extra slots added.
+class WithRefScanTupleIterator : public TupleIterator {
+ public:
+  WithRefScanTupleIterator(std::shared_ptr<const SharedTupleBuffer> table,
+                           std::unique_ptr<TupleSchema> schema,
+                           int num_extra_slots, absl::string_view with_table,
+                           EvaluationContext* context)
+      : table_(std::move(table)),
+        schema_(std::move(schema)),
+        num_extra_slots_(num_extra_slots),
+        with_table_(with_table) {
+    context->RegisterCancelCallback([this] { return Cancel(); });
+  }
+
+  WithRefScanTupleIterator(const WithRefScanTupleIterator&) = delete;
+  WithRefScanTupleIterator& operator=(const WithRefScanTupleIterator&) =
+      delete;
+
+  const TupleSchema& Schema() const override { return *schema_; }
+
+  TupleData* Next() override {
+    if (cancelled_) {
+      status_ = zetasql_base::CancelledErrorBuilder()
+                << "WithRefScanTupleIterator was cancelled";
+      return nullptr;
+    }
+    const zetasql_base::StatusOr<bool> status_or_found =
+        table_->Read(&position_, &current_);
+    if (!status_or_found.ok()) {
+      status_ = status_or_found.status();
+      return nullptr;
+    }
+    if (!status_or_found.ValueOrDie()) return nullptr;
+    current_.AddSlots(num_extra_slots_);
+    return &current_;
+  }
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  bool PreservesOrder() const override { return table_->preserves_order(); }
+
+  std::string DebugString() const override {
+    return WithRefScanOp::GetIteratorDebugString(with_table_);
+  }
+
+  zetasql_base::Status Cancel() {
+    cancelled_ = true;
+    return zetasql_base::OkStatus();
+  }
+
+ private:
+  const std::shared_ptr<const SharedTupleBuffer> table_;
+  const std::unique_ptr<TupleSchema> schema_;
+  const int num_extra_slots_;
+  const std::string with_table_;
+  SharedTupleBuffer::Position position_;
+  TupleData current_;
+  bool cancelled_ = false;
+  zetasql_base::Status status_;
+};
+}  // namespace
+
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>>
+WithRefScanOp::CreateIteratorInternal(absl::Span<const TupleData* const> params,
+                                      int num_extra_slots,
+                                      EvaluationContext* context) const {
+  std::shared_ptr<const SharedTupleBuffer> table =
+      context->GetWithTable(with_table_);
+  ZETASQL_RET_CHECK(table != nullptr) << "WITH table " << with_table_
+                              << " has not been materialized";
+  std::unique_ptr<TupleIterator> iter =
+      absl::make_unique<WithRefScanTupleIterator>(
+          std::move(table), CreateOutputSchema(), num_extra_slots,
+          with_table_.ToString(), context);
+  return MaybeReorder(std::move(iter), context);
+}
+
+std::unique_ptr<TupleSchema> WithRefScanOp::CreateOutputSchema() const {
+  return absl::make_unique<TupleSchema>(columns_);
+}
+
+std::string WithRefScanOp::IteratorDebugString() const {
+  return GetIteratorDebugString(with_table_.ToString());
+}
+
+std::string WithRefScanOp::DebugInternal(const std::string& indent,
+                                         bool verbose) const {
+  std::vector<std::string> column_strs;
+  column_strs.reserve(columns_.size());
+  for (const VariableId& column : columns_) {
+    column_strs.push_back(column.ToString());
+  }
+  return absl::StrCat("WithRefScanOp(", with_table_.ToString(), ", columns=(",
+                      absl::StrJoin(column_strs, ", "), "))");
+}
+
 // -------------------------------------------------------
 // UnionAllOp
 // -------------------------------------------------------
@@ -3434,9 +6741,111 @@ class UnionAllTupleIterator : public TupleIterator {
   zetasql_base::Status status_;
   EvaluationContext* context_;
 };
+
+// Evaluates the inputs of a UnionAllOp on several threads. Each thread
+// repeatedly claims the next input that nobody has started on, so the output
+// interleaves the tuples of different inputs.
+class ParallelUnionAllTupleIterator : public TupleIterator {
+ public:
+  // Starts 'num_threads' threads. 'params' are copied, so they only need to
+  // remain valid during this call.
+  ParallelUnionAllTupleIterator(
+      absl::Span<const TupleData* const> params,
+      absl::Span<const RelationalOp* const> inputs,
+      absl::Span<const absl::Span<const ExprArg* const>> values,
+      std::unique_ptr<TupleSchema> output_schema, int num_extra_slots,
+      int num_threads, EvaluationContext* context)
+      : params_(CopyParams(params)),
+        param_ptrs_(GetParamPtrs(params_)),
+        inputs_(inputs.begin(), inputs.end()),
+        values_(values.begin(), values.end()),
+        output_schema_(std::move(output_schema)),
+        num_extra_slots_(num_extra_slots) {
+    // The threads share the memory budget of the statement.
+    const int64_t max_intermediate_byte_size =
+        context->options().max_intermediate_byte_size / num_threads;
+    std::vector<std::unique_ptr<EvaluationContext>> child_contexts;
+    for (int i = 0; i < num_threads; ++i) {
+      child_contexts.push_back(context->CreateChildContext(
+          max_intermediate_byte_size, /*partitioned_scan=*/nullptr,
+          /*partition_index=*/0, /*num_partitions=*/1));
+    }
+    producers_ = absl::make_unique<ParallelTupleProducers>(
+        std::move(child_contexts),
+        [this](int i, EvaluationContext* context,
+               const ParallelTupleProducers::EmitFn& emit) {
+          return Produce(context, emit);
+        },
+        context);
+  }
+
+  ParallelUnionAllTupleIterator(const ParallelUnionAllTupleIterator&) = delete;
+  ParallelUnionAllTupleIterator& operator=(
+      const ParallelUnionAllTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return *output_schema_; }
+
+  TupleData* Next() override { return producers_->Next(); }
+
+  zetasql_base::Status Status() const override { return producers_->status(); }
+
+  std::string DebugString() const override {
+    std::vector<std::string> input_strings;
+    input_strings.reserve(inputs_.size());
+    for (const RelationalOp* input : inputs_) {
+      input_strings.push_back(input->IteratorDebugString());
+    }
+    return UnionAllOp::GetIteratorDebugString(input_strings);
+  }
+
+ private:
+  // Evaluates unclaimed inputs with 'context' until there are none left, and
+  // emits the output tuples computed from their tuples.
+  zetasql_base::Status Produce(EvaluationContext* context,
+                       const ParallelTupleProducers::EmitFn& emit) {
+    TupleData data(output_schema_->num_variables() + num_extra_slots_);
+    for (int i = next_input_++; i < inputs_.size(); i = next_input_++) {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
+                       inputs_[i]->CreateIterator(
+                           param_ptrs_, /*num_extra_slots=*/0, context));
+      absl::Span<const ExprArg* const> values = values_[i];
+      ZETASQL_RET_CHECK_EQ(values.size(), output_schema_->num_variables());
+      while (true) {
+        const TupleData* tuple = iter->Next();
+        if (tuple == nullptr) {
+          ZETASQL_RETURN_IF_ERROR(iter->Status());
+          break;
+        }
+        for (int j = 0; j < values.size(); ++j) {
+          zetasql_base::Status status;
+          if (!values[j]->value_expr()->EvalSimple(
+                  ConcatSpans(absl::Span<const TupleData* const>(param_ptrs_),
+                              {tuple}),
+                  context, data.mutable_slot(j), &status)) {
+            return status;
+          }
+        }
+        if (!emit(data)) return zetasql_base::OkStatus();
+      }
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  const std::vector<TupleData> params_;
+  const std::vector<const TupleData*> param_ptrs_;
+  const std::vector<const RelationalOp*> inputs_;
+  const std::vector<absl::Span<const ExprArg* const>> values_;
+  const std::unique_ptr<TupleSchema> output_schema_;
+  const int num_extra_slots_;
+  // The index of the next input to claim.
+  std::atomic<int> next_input_{0};
+  // Declared last so that the producers stop before the members they use are
+  // destroyed.
+  std::unique_ptr<ParallelTupleProducers> producers_;
+};
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> UnionAllOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> UnionAllOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   std::vector<absl::Span<const ExprArg* const>> tuple_values;
@@ -3445,6 +6854,20 @@ class UnionAllTupleIterator : public TupleIterator {
     tuple_values.push_back(values(i));
   }
 
+  const int num_threads = std::min(context->options().num_threads, num_rel());
+  if (evaluate_inputs_in_parallel_ && num_threads > 1) {
+    std::vector<const RelationalOp*> inputs;
+    inputs.reserve(num_rel());
+    for (int i = 0; i < num_rel(); ++i) {
+      inputs.push_back(rel(i));
+    }
+    std::unique_ptr<TupleIterator> iter =
+        absl::make_unique<ParallelUnionAllTupleIterator>(
+            params, inputs, tuple_values, CreateOutputSchema(),
+            num_extra_slots, num_threads, context);
+    return MaybeReorder(std::move(iter), context);
+  }
+
   std::vector<std::unique_ptr<TupleIterator>> iters;
   iters.reserve(num_rel());
   for (int i = 0; i < num_rel(); ++i) {
@@ -3551,7 +6974,7 @@ RelationalOp* UnionAllOp::mutable_rel(int i) {
   return mutable_input()->SetSchemasForEvaluation(params_schemas);
 }
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RootOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RootOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   return input()->CreateIterator(params, num_extra_slots, context);
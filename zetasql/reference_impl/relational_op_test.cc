@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <functional>
 #include <memory>
+#include <set>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -29,6 +30,7 @@
 #include "zetasql/common/evaluator_test_table.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "zetasql/common/testing/testing_proto_util.h"
+#include "zetasql/public/evaluator_profile.pb.h"
 #include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/simple_catalog.h"
@@ -268,6 +270,16 @@ TEST(ColumnFilterArgTest, InArray) {
                        arg->Eval({&params_null_data}, &context));
   ASSERT_EQ(column_filter_null->kind(), ColumnFilter::kInList);
   EXPECT_THAT(column_filter_null->in_list(), IsEmpty());
+
+  // Duplicates are dropped for types that InListSet supports.
+  const TupleData params_int64_data = CreateTupleDataFromValues(
+      {Value::Array(Int64ArrayType(),
+                    {Int64(12), NullInt64(), Int64(10), Int64(12)})});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnFilter> column_filter_int64,
+                       arg->Eval({&params_int64_data}, &context));
+  ASSERT_EQ(column_filter_int64->kind(), ColumnFilter::kInList);
+  EXPECT_THAT(column_filter_int64->in_list(),
+              ElementsAre(Int64(12), Int64(10)));
 }
 
 TEST(ColumnFilterArgTest, InList) {
@@ -376,6 +388,126 @@ TEST(ColumnFilterArgTest, HalfUnbounded) {
   }
 }
 
+TEST(ColumnFilterArgTest, BuildKeys) {
+  VariableId keys("keys"), min_key("min_key"), max_key("max_key");
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_keys,
+                       DerefExpr::Create(keys, Int64ArrayType()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_min_key,
+                       DerefExpr::Create(min_key, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_max_key,
+                       DerefExpr::Create(max_key, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto arg, BuildKeysColumnFilterArg::Create(
+                    VariableId("foo"), /*column_idx=*/3, std::move(deref_keys),
+                    std::move(deref_min_key), std::move(deref_max_key)));
+  EXPECT_EQ(arg->column_idx(), 3);
+  EXPECT_EQ(arg->DebugString(),
+            "BuildKeysColumnFilterArg($foo, column_idx: 3, keys: $keys, "
+            "min_key: $min_key, max_key: $max_key)");
+
+  const TupleSchema params_schemas({keys, min_key, max_key});
+  ZETASQL_ASSERT_OK(arg->SetSchemasForEvaluation({&params_schemas}));
+  EvaluationContext context((EvaluationOptions()));
+
+  // An IN-list of the keys if there are few enough of them.
+  const TupleData in_list_data = CreateTupleDataFromValues(
+      {Value::Array(Int64ArrayType(), {Int64(12), Int64(10), NullInt64()}),
+       Int64(10), Int64(12)});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnFilter> in_list_filter,
+                       arg->Eval({&in_list_data}, &context));
+  ASSERT_EQ(in_list_filter->kind(), ColumnFilter::kInList);
+  EXPECT_THAT(in_list_filter->in_list(), ElementsAre(Int64(12), Int64(10)));
+
+  // Else the range between the smallest and largest keys.
+  const TupleData range_data = CreateTupleDataFromValues(
+      {Null(Int64ArrayType()), Int64(10), Int64(12)});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnFilter> range_filter,
+                       arg->Eval({&range_data}, &context));
+  ASSERT_EQ(range_filter->kind(), ColumnFilter::kRange);
+  EXPECT_EQ(range_filter->lower_bound(), Int64(10));
+  EXPECT_EQ(range_filter->upper_bound(), Int64(12));
+
+  // No filtering if the join did not build a hash table.
+  const TupleData unbounded_data = CreateTupleDataFromValues(
+      {Null(Int64ArrayType()), NullInt64(), NullInt64()});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnFilter> unbounded_filter,
+                       arg->Eval({&unbounded_data}, &context));
+  ASSERT_EQ(unbounded_filter->kind(), ColumnFilter::kRange);
+  EXPECT_FALSE(unbounded_filter->lower_bound().is_valid());
+  EXPECT_FALSE(unbounded_filter->upper_bound().is_valid());
+}
+
+TEST(ColumnPredicateArgTest, Tree) {
+  VariableId p1("p1"), p2("p2");
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_p1, DerefExpr::Create(p1, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_p2, DerefExpr::Create(p2, Int64Type()));
+
+  std::vector<std::unique_ptr<ValueExpr>> less_args;
+  less_args.push_back(std::move(deref_p1));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto less, ColumnPredicateArg::CreateLeaf(
+                     ColumnPredicate::kLess, VariableId("foo"),
+                     /*column_idx=*/3, std::move(less_args)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto is_null,
+      ColumnPredicateArg::CreateLeaf(ColumnPredicate::kIsNull,
+                                     VariableId("bar"), /*column_idx=*/1,
+                                     /*args=*/{}));
+  std::vector<std::unique_ptr<ValueExpr>> in_list_args;
+  in_list_args.push_back(std::move(deref_p2));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto in_list, ColumnPredicateArg::CreateLeaf(
+                        ColumnPredicate::kInList, VariableId("bar"),
+                        /*column_idx=*/1, std::move(in_list_args)));
+
+  std::vector<std::unique_ptr<ColumnPredicateArg>> or_children;
+  or_children.push_back(std::move(is_null));
+  or_children.push_back(std::move(in_list));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto or_arg,
+                       ColumnPredicateArg::CreateJunction(
+                           ColumnPredicate::kOr, std::move(or_children)));
+  std::vector<std::unique_ptr<ColumnPredicateArg>> and_children;
+  and_children.push_back(std::move(less));
+  and_children.push_back(std::move(or_arg));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto arg,
+                       ColumnPredicateArg::CreateJunction(
+                           ColumnPredicate::kAnd, std::move(and_children)));
+  EXPECT_EQ(arg->DebugString(),
+            "ColumnPredicateArg(AND("
+            "ColumnPredicateArg($foo, column_idx: 3, predicate: < $p1), "
+            "ColumnPredicateArg(OR("
+            "ColumnPredicateArg($bar, column_idx: 1, predicate: IS NULL), "
+            "ColumnPredicateArg($bar, column_idx: 1, predicate: IN ($p2))))))");
+
+  const TupleSchema params_schemas({p1, p2});
+  const TupleData params_data =
+      CreateTupleDataFromValues({Int64(10), NullInt64()});
+  ZETASQL_ASSERT_OK(arg->SetSchemasForEvaluation({&params_schemas}));
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnPredicate> predicate,
+                       arg->Eval({&params_data}, &context));
+  ASSERT_EQ(predicate->kind(), ColumnPredicate::kAnd);
+  ASSERT_EQ(predicate->children().size(), 2);
+
+  const ColumnPredicate& less_predicate = *predicate->children()[0];
+  EXPECT_EQ(less_predicate.kind(), ColumnPredicate::kLess);
+  EXPECT_EQ(less_predicate.column_idx(), 3);
+  EXPECT_EQ(less_predicate.value(), Int64(10));
+
+  const ColumnPredicate& or_predicate = *predicate->children()[1];
+  ASSERT_EQ(or_predicate.kind(), ColumnPredicate::kOr);
+  ASSERT_EQ(or_predicate.children().size(), 2);
+  EXPECT_EQ(or_predicate.children()[0]->kind(), ColumnPredicate::kIsNull);
+  EXPECT_EQ(or_predicate.children()[0]->column_idx(), 1);
+  EXPECT_EQ(or_predicate.children()[1]->kind(), ColumnPredicate::kInList);
+  // Unlike ColumnFilters, ColumnPredicates keep NULLs.
+  EXPECT_THAT(or_predicate.children()[1]->in_list(),
+              ElementsAre(NullInt64()));
+}
+
 MATCHER_P2(IsRangeColumnFilterWith, lower_bound, upper_bound, "") {
   if (arg.kind() != ColumnFilter::kRange) return false;
   if (lower_bound.is_valid() != arg.lower_bound().is_valid() ||
@@ -730,6 +862,338 @@ TEST_F(CreateIteratorTest, EvaluatorTableScanOpWithColumnFilter) {
                   IsTupleSlotWith(Int64(100), IsNull()), _));
 }
 
+// An EvaluatorTableIterator over columnar data that only implements
+// NextColumnBatch(). Row i has the values i, i / 2.0, i % 2 == 0 and
+// "s<i>". The STRING column is NULL for every third row. If
+// 'dictionary_encoded' is true, the STRING column is instead "d<i % 4>",
+// encoded with a dictionary of four strings, or 'invalid_code' if it is set.
+class ColumnarTestTableIterator : public EvaluatorTableIterator {
+ public:
+  explicit ColumnarTestTableIterator(int64_t num_rows,
+                                     bool dictionary_encoded = false,
+                                     int32_t invalid_code = -1)
+      : num_rows_(num_rows),
+        dictionary_encoded_(dictionary_encoded),
+        bool_bitmap_((num_rows + 7) / 8),
+        validity_bitmap_((num_rows + 7) / 8) {
+    for (int64_t i = 0; i < num_rows; ++i) {
+      int64_values_.push_back(i);
+      double_values_.push_back(i / 2.0);
+      if (i % 2 == 0) bool_bitmap_[i / 8] |= 1 << (i % 8);
+      strings_.push_back(absl::StrCat("s", i));
+      if (i % 3 != 0) validity_bitmap_[i / 8] |= 1 << (i % 8);
+      dictionary_codes_.push_back(invalid_code >= 0 ? invalid_code : i % 4);
+    }
+    for (const std::string& str : strings_) {
+      string_values_.push_back(str);
+    }
+    for (int i = 0; i < 4; ++i) {
+      dictionary_.push_back(String(absl::StrCat("d", i)));
+    }
+  }
+
+  int NumColumns() const override { return 4; }
+  std::string GetColumnName(int i) const override {
+    return absl::StrCat("column", i);
+  }
+  const Type* GetColumnType(int i) const override {
+    switch (i) {
+      case 0:
+        return types::Int64Type();
+      case 1:
+        return types::DoubleType();
+      case 2:
+        return types::BoolType();
+      default:
+        return types::StringType();
+    }
+  }
+
+  bool NextRow() override {
+    ADD_FAILURE() << "NextRow() should not be called";
+    return false;
+  }
+  const Value& GetValue(int i) const override {
+    ADD_FAILURE() << "GetValue() should not be called";
+    return invalid_value_;
+  }
+
+  bool SupportsColumnBatches() const override { return true; }
+
+  // Returns batches that start at multiples of eight rows, so that the bitmaps
+  // can be sliced by byte.
+  bool NextColumnBatch(int64_t max_num_rows,
+                       EvaluatorTableColumnBatch* batch) override {
+    EXPECT_EQ(max_num_rows % 8, 0);
+    if (next_row_ >= num_rows_) return false;
+    const int64_t start = next_row_;
+    batch->num_rows = std::min(max_num_rows, num_rows_ - start);
+    next_row_ += batch->num_rows;
+    batch->columns.resize(4);
+    batch->columns[0].int64_values =
+        absl::MakeConstSpan(int64_values_).subspan(start);
+    batch->columns[1].double_values =
+        absl::MakeConstSpan(double_values_).subspan(start);
+    batch->columns[2].bool_bitmap =
+        absl::MakeConstSpan(bool_bitmap_).subspan(start / 8);
+    if (dictionary_encoded_) {
+      batch->columns[3].dictionary_codes =
+          absl::MakeConstSpan(dictionary_codes_).subspan(start);
+      batch->columns[3].dictionary = dictionary_;
+    } else {
+      batch->columns[3].string_values =
+          absl::MakeConstSpan(string_values_).subspan(start);
+    }
+    batch->columns[3].validity_bitmap =
+        absl::MakeConstSpan(validity_bitmap_).subspan(start / 8);
+    return true;
+  }
+
+  zetasql_base::Status Status() const override { return zetasql_base::OkStatus(); }
+  zetasql_base::Status Cancel() override { return zetasql_base::OkStatus(); }
+
+ private:
+  const int64_t num_rows_;
+  const bool dictionary_encoded_;
+  int64_t next_row_ = 0;
+  std::vector<int64_t> int64_values_;
+  std::vector<double> double_values_;
+  std::vector<uint8_t> bool_bitmap_;
+  std::vector<std::string> strings_;
+  std::vector<absl::string_view> string_values_;
+  std::vector<int32_t> dictionary_codes_;
+  std::vector<Value> dictionary_;
+  std::vector<uint8_t> validity_bitmap_;
+  const Value invalid_value_;
+};
+
+// A table that returns a ColumnarTestTableIterator.
+class ColumnarTestTable : public SimpleTable {
+ public:
+  ColumnarTestTable(const std::string& name, int64_t num_rows,
+                    bool dictionary_encoded = false,
+                    int32_t invalid_code = -1)
+      : SimpleTable(name, {{"column0", types::Int64Type()},
+                           {"column1", types::DoubleType()},
+                           {"column2", types::BoolType()},
+                           {"column3", types::StringType()}}),
+        num_rows_(num_rows),
+        dictionary_encoded_(dictionary_encoded),
+        invalid_code_(invalid_code) {}
+
+  zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+  CreateEvaluatorTableIterator(
+      absl::Span<const int> column_idxs) const override {
+    ZETASQL_RET_CHECK_EQ(column_idxs.size(), 4);
+    for (int i = 0; i < column_idxs.size(); ++i) {
+      ZETASQL_RET_CHECK_EQ(column_idxs[i], i);
+    }
+    return absl::make_unique<ColumnarTestTableIterator>(
+        num_rows_, dictionary_encoded_, invalid_code_);
+  }
+
+ private:
+  const int64_t num_rows_;
+  const bool dictionary_encoded_;
+  const int32_t invalid_code_;
+};
+
+TEST_F(CreateIteratorTest, EvaluatorTableScanOpColumnBatches) {
+  VariableId w("w"), x("x"), y("y"), z("z");
+  ColumnarTestTable table("TestTable", /*num_rows=*/20);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto scan_op,
+      EvaluatorTableScanOp::Create(
+          &table, /*alias=*/"", {0, 1, 2, 3},
+          {"column0", "column1", "column2", "column3"}, {w, x, y, z},
+          /*and_filters=*/{}, /*read_time=*/nullptr));
+
+  // Use both the default batch size and a small one that needs several
+  // batches.
+  for (int batch_size : {0, 8}) {
+    EvaluationOptions options;
+    options.batch_size = batch_size;
+    EvaluationContext context(options);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<TupleIterator> iter,
+        scan_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/1,
+                                &context));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    ASSERT_EQ(data.size(), 20);
+    for (int i = 0; i < data.size(); ++i) {
+      EXPECT_THAT(
+          data[i].slots(),
+          ElementsAre(
+              IsTupleSlotWith(Int64(i), IsNull()),
+              IsTupleSlotWith(Double(i / 2.0), IsNull()),
+              IsTupleSlotWith(Bool(i % 2 == 0), IsNull()),
+              IsTupleSlotWith(
+                  i % 3 == 0 ? NullString() : String(absl::StrCat("s", i)),
+                  IsNull()),
+              _))
+          << batch_size << " " << i;
+    }
+  }
+}
+
+TEST_F(CreateIteratorTest, EvaluatorTableScanOpDictionaryEncodedColumn) {
+  VariableId w("w"), x("x"), y("y"), z("z");
+  ColumnarTestTable table("TestTable", /*num_rows=*/20,
+                          /*dictionary_encoded=*/true);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto scan_op,
+      EvaluatorTableScanOp::Create(
+          &table, /*alias=*/"", {0, 1, 2, 3},
+          {"column0", "column1", "column2", "column3"}, {w, x, y, z},
+          /*and_filters=*/{}, /*read_time=*/nullptr));
+
+  EvaluationOptions options;
+  options.batch_size = 8;
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      scan_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/1, &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), 20);
+  for (int i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(data[i].slot(3).value(),
+              i % 3 == 0 ? NullString() : String(absl::StrCat("d", i % 4)))
+        << i;
+  }
+  // Rows with the same code share the contents of the dictionary element,
+  // also across batches.
+  EXPECT_EQ(data[1].slot(3).value().string_view_value().data(),
+            data[13].slot(3).value().string_view_value().data());
+
+  ColumnarTestTable invalid_table("TestTable", /*num_rows=*/20,
+                                  /*dictionary_encoded=*/true,
+                                  /*invalid_code=*/4);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto invalid_scan_op,
+      EvaluatorTableScanOp::Create(
+          &invalid_table, /*alias=*/"", {0, 1, 2, 3},
+          {"column0", "column1", "column2", "column3"}, {w, x, y, z},
+          /*and_filters=*/{}, /*read_time=*/nullptr));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      iter, invalid_scan_op->CreateIterator(EmptyParams(),
+                                            /*num_extra_slots=*/1, &context));
+  EXPECT_THAT(ReadFromTupleIterator(iter.get()),
+              StatusIs(zetasql_base::INTERNAL, HasSubstr("dictionary code 4")));
+}
+
+// A table that supports predicate pushdown. It records the conjuncts passed to
+// it and claims to fully handle the first one, but does not actually filter
+// any rows.
+class PredicatePushdownTestTable : public SimpleTable {
+ public:
+  explicit PredicatePushdownTestTable(const std::string& name)
+      : SimpleTable(name, {{"column0", types::Int64Type()},
+                           {"column1", types::Int64Type()}}) {}
+
+  bool SupportsEvaluatorPredicatePushdown() const override { return true; }
+
+  zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+  CreateEvaluatorTableIteratorWithPredicate(
+      absl::Span<const int> column_idxs,
+      absl::Span<const ColumnPredicate* const> conjuncts,
+      std::vector<bool>* fully_handled) const override {
+    ZETASQL_RET_CHECK_EQ(conjuncts.size(), fully_handled->size());
+    conjunct_kinds_.clear();
+    for (const ColumnPredicate* conjunct : conjuncts) {
+      conjunct_kinds_.push_back(conjunct->kind());
+    }
+    if (!fully_handled->empty()) (*fully_handled)[0] = true;
+    return CreateEvaluatorTableIterator(column_idxs);
+  }
+
+  const std::vector<ColumnPredicate::Kind>& conjunct_kinds() const {
+    return conjunct_kinds_;
+  }
+
+ private:
+  mutable std::vector<ColumnPredicate::Kind> conjunct_kinds_;
+};
+
+TEST_F(CreateIteratorTest, EvaluatorTableScanOpPushedDownConjuncts) {
+  VariableId x("x"), y("y");
+  PredicatePushdownTestTable table("TestTable");
+  std::vector<std::vector<Value>> contents;
+  for (int i = 0; i < 10; ++i) {
+    contents.push_back({Int64(i), Int64(i % 3)});
+  }
+  table.SetContents(contents);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto scan_op,
+      EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0, 1},
+                                   {"column0", "column1"}, {x, y},
+                                   /*and_filters=*/{}, /*read_time=*/nullptr));
+
+  // Pushes down two conjuncts, $x < 5 (which the table claims to handle) and
+  // $y = 0 (which the scan has to apply itself).
+  for (int i = 0; i < 2; ++i) {
+    const VariableId& column = i == 0 ? x : y;
+    const FunctionKind function_kind =
+        i == 0 ? FunctionKind::kLess : FunctionKind::kEqual;
+    const ColumnPredicate::Kind predicate_kind =
+        i == 0 ? ColumnPredicate::kLess : ColumnPredicate::kEqual;
+    const Value value = Int64(i == 0 ? 5 : 0);
+
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto predicate_value, ConstExpr::Create(value));
+    std::vector<std::unique_ptr<ValueExpr>> predicate_args;
+    predicate_args.push_back(std::move(predicate_value));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        auto predicate,
+        ColumnPredicateArg::CreateLeaf(predicate_kind, column,
+                                       /*column_idx=*/i,
+                                       std::move(predicate_args)));
+
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_column,
+                         DerefExpr::Create(column, Int64Type()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto conjunct_value, ConstExpr::Create(value));
+    std::vector<std::unique_ptr<ValueExpr>> conjunct_args;
+    conjunct_args.push_back(std::move(deref_column));
+    conjunct_args.push_back(std::move(conjunct_value));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto conjunct,
+                         ScalarFunctionCallExpr::Create(
+                             CreateFunction(function_kind, BoolType()),
+                             std::move(conjunct_args)));
+
+    ZETASQL_ASSERT_OK(scan_op->AddPushedDownConjunct(std::move(predicate),
+                                             std::move(conjunct)));
+  }
+  ZETASQL_ASSERT_OK(scan_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+  EXPECT_EQ(scan_op->IteratorDebugString(),
+            "EvaluatorTableTupleIterator(TestTable)");
+
+  for (int batch_size : {0, 2}) {
+    EvaluationOptions options;
+    options.batch_size = batch_size;
+    EvaluationContext context(options);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<TupleIterator> iter,
+        scan_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/1,
+                                &context));
+    EXPECT_THAT(table.conjunct_kinds(),
+                ElementsAre(ColumnPredicate::kLess, ColumnPredicate::kEqual));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    // The table did not apply $x < 5 even though it claimed to, so only
+    // $y = 0 was applied.
+    ASSERT_EQ(data.size(), 4) << batch_size;
+    for (int i = 0; i < data.size(); ++i) {
+      EXPECT_THAT(data[i].slots(),
+                  ElementsAre(IsTupleSlotWith(Int64(3 * i), IsNull()),
+                              IsTupleSlotWith(Int64(0), IsNull()), _))
+          << batch_size << " " << i;
+    }
+  }
+}
+
 TEST_F(CreateIteratorTest, EvaluatorTableScanOpFailure) {
   const std::string error = "Failed to read row from TestTable";
   const zetasql_base::Status failure = zetasql_base::OutOfRangeErrorBuilder() << error;
@@ -2322,6 +2786,340 @@ TEST_F(CreateIteratorTest, FullOuterHashJoin) {
                        HasSubstr("Out of memory")));
 }
 
+TEST_F(CreateIteratorTest, ParallelFullOuterHashJoin) {
+  VariableId x("x"), x_prime("x'"), y("y"), y_prime("y'"), a("a"), b("b");
+
+  // Left keys are 0..4999 and 7000..7499. Right keys are 0..5999, twice each.
+  // The inputs are large enough to use several partitions and left morsels.
+  std::vector<TupleData> left_tuples;
+  for (int64_t i = 0; i < 5000; ++i) {
+    left_tuples.push_back(CreateTestTupleData({Int64(i)}));
+  }
+  for (int64_t i = 7000; i < 7500; ++i) {
+    left_tuples.push_back(CreateTestTupleData({Int64(i)}));
+  }
+  std::vector<TupleData> right_tuples;
+  for (int64_t i = 0; i < 12000; ++i) {
+    right_tuples.push_back(CreateTestTupleData({Int64(i % 6000)}));
+  }
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y, DerefExpr::Create(y, Int64Type()));
+  JoinOp::HashJoinEqualityExprs equality_expr;
+  equality_expr.left_expr = absl::make_unique<ExprArg>(a, std::move(deref_x));
+  equality_expr.right_expr = absl::make_unique<ExprArg>(b, std::move(deref_y));
+  std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs;
+  equality_exprs.push_back(std::move(equality_expr));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto true_expr, ConstExpr::Create(Bool(true)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x_output,
+                       DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y_output,
+                       DerefExpr::Create(y, Int64Type()));
+  std::vector<std::unique_ptr<ExprArg>> left_outputs;
+  left_outputs.push_back(
+      absl::make_unique<ExprArg>(x_prime, std::move(deref_x_output)));
+  std::vector<std::unique_ptr<ExprArg>> right_outputs;
+  right_outputs.push_back(
+      absl::make_unique<ExprArg>(y_prime, std::move(deref_y_output)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto join_op,
+      JoinOp::Create(
+          JoinOp::kFullOuterJoin, std::move(equality_exprs),
+          std::move(true_expr),
+          absl::make_unique<TestRelationalOp>(std::vector<VariableId>{x},
+                                              left_tuples,
+                                              /*preserves_order=*/true),
+          absl::make_unique<TestRelationalOp>(std::vector<VariableId>{y},
+                                              right_tuples,
+                                              /*preserves_order=*/true),
+          std::move(left_outputs), std::move(right_outputs)));
+  ZETASQL_ASSERT_OK(join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  // The output must not depend on the number of threads.
+  std::vector<TupleData> expected;
+  for (int num_threads : {1, 2, 4, 7}) {
+    EvaluationOptions options;
+    options.num_threads = num_threads;
+    EvaluationContext context(options);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<TupleIterator> iter,
+        join_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                &context));
+    EXPECT_TRUE(iter->PreservesOrder());
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    // 5000 left keys join with two right tuples each, 500 left tuples and
+    // 2000 right tuples do not join.
+    ASSERT_EQ(data.size(), 12500) << num_threads;
+    if (num_threads == 1) {
+      EXPECT_THAT(data[0].slots(), ElementsAre(IsTupleSlotWith(Int64(0), _),
+                                               IsTupleSlotWith(Int64(0), _)));
+      EXPECT_THAT(data[1].slots(), ElementsAre(IsTupleSlotWith(Int64(0), _),
+                                               IsTupleSlotWith(Int64(0), _)));
+      EXPECT_THAT(data[10000].slots(),
+                  ElementsAre(IsTupleSlotWith(Int64(7000), _),
+                              IsTupleSlotWith(NullInt64(), _)));
+      EXPECT_THAT(data[10500].slots(),
+                  ElementsAre(IsTupleSlotWith(NullInt64(), _),
+                              IsTupleSlotWith(Int64(5000), _)));
+      expected = std::move(data);
+      continue;
+    }
+    for (int i = 0; i < data.size(); ++i) {
+      ASSERT_EQ(data[i].num_slots(), expected[i].num_slots());
+      for (int j = 0; j < data[i].num_slots(); ++j) {
+        ASSERT_EQ(data[i].slot(j).value(), expected[i].slot(j).value())
+            << num_threads << " " << i << " " << j;
+      }
+    }
+  }
+}
+
+// Returns a join of TestRelationalOps over 'left_keys' and 'right_keys' on
+// equal keys, which merges its inputs.
+static zetasql_base::StatusOr<std::unique_ptr<JoinOp>> CreateMergeJoin(
+    JoinOp::JoinKind join_kind, absl::Span<const Value> left_keys,
+    absl::Span<const Value> right_keys) {
+  VariableId x("x"), y("y"), y_prime("y'"), a("a"), b("b");
+  std::vector<TupleData> left_tuples;
+  for (const Value& key : left_keys) {
+    left_tuples.push_back(CreateTestTupleData({key}));
+  }
+  std::vector<TupleData> right_tuples;
+  for (const Value& key : right_keys) {
+    right_tuples.push_back(CreateTestTupleData({key}));
+  }
+
+  ZETASQL_ASSIGN_OR_RETURN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSIGN_OR_RETURN(auto deref_y, DerefExpr::Create(y, Int64Type()));
+  JoinOp::HashJoinEqualityExprs equality_expr;
+  equality_expr.left_expr = absl::make_unique<ExprArg>(a, std::move(deref_x));
+  equality_expr.right_expr = absl::make_unique<ExprArg>(b, std::move(deref_y));
+  std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs;
+  equality_exprs.push_back(std::move(equality_expr));
+
+  ZETASQL_ASSIGN_OR_RETURN(auto true_expr, ConstExpr::Create(Bool(true)));
+  std::vector<std::unique_ptr<ExprArg>> right_outputs;
+  if (join_kind == JoinOp::kLeftOuterJoin) {
+    ZETASQL_ASSIGN_OR_RETURN(auto deref_y_output, DerefExpr::Create(y, Int64Type()));
+    right_outputs.push_back(
+        absl::make_unique<ExprArg>(y_prime, std::move(deref_y_output)));
+  }
+
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<JoinOp> join_op,
+      JoinOp::Create(
+          join_kind, std::move(equality_exprs), std::move(true_expr),
+          absl::make_unique<TestRelationalOp>(std::vector<VariableId>{x},
+                                              left_tuples,
+                                              /*preserves_order=*/true),
+          absl::make_unique<TestRelationalOp>(std::vector<VariableId>{y},
+                                              right_tuples,
+                                              /*preserves_order=*/true),
+          /*left_outputs=*/{}, std::move(right_outputs)));
+  ZETASQL_RETURN_IF_ERROR(join_op->set_num_merge_join_keys(1));
+  ZETASQL_RETURN_IF_ERROR(join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+  return join_op;
+}
+
+TEST_F(CreateIteratorTest, MergeJoin) {
+  const std::vector<Value> left_keys = {NullInt64(), Int64(1), Int64(1),
+                                        Int64(2),    Int64(4), Int64(5)};
+  const std::vector<Value> right_keys = {NullInt64(), Int64(1), Int64(1),
+                                         Int64(3),    Int64(4), Int64(4),
+                                         Int64(6)};
+  for (const JoinOp::JoinKind join_kind :
+       {JoinOp::kInnerJoin, JoinOp::kLeftOuterJoin}) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<JoinOp> join_op,
+                         CreateMergeJoin(join_kind, left_keys, right_keys));
+    EXPECT_THAT(join_op->DebugString(), HasSubstr("num_merge_join_keys=1"));
+
+    // Multiple threads use a hash join, which must produce the same output.
+    std::vector<TupleData> expected;
+    for (int num_threads : {1, 2}) {
+      EvaluationOptions options;
+      options.num_threads = num_threads;
+      EvaluationContext context(options);
+      ZETASQL_ASSERT_OK_AND_ASSIGN(
+          std::unique_ptr<TupleIterator> iter,
+          join_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                  &context));
+      EXPECT_TRUE(iter->PreservesOrder());
+      ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                           ReadFromTupleIterator(iter.get()));
+      if (num_threads == 1) {
+        if (join_kind == JoinOp::kInnerJoin) {
+          ASSERT_EQ(data.size(), 6);
+          EXPECT_THAT(data[0].slots(),
+                      ElementsAre(IsTupleSlotWith(Int64(1), _),
+                                  IsTupleSlotWith(Int64(1), _)));
+          EXPECT_THAT(data[5].slots(),
+                      ElementsAre(IsTupleSlotWith(Int64(4), _),
+                                  IsTupleSlotWith(Int64(4), _)));
+        } else {
+          ASSERT_EQ(data.size(), 9);
+          EXPECT_THAT(data[0].slots(),
+                      ElementsAre(IsTupleSlotWith(NullInt64(), _),
+                                  IsTupleSlotWith(NullInt64(), _)));
+          EXPECT_THAT(data[5].slots(),
+                      ElementsAre(IsTupleSlotWith(Int64(2), _),
+                                  IsTupleSlotWith(NullInt64(), _)));
+          EXPECT_THAT(data[8].slots(),
+                      ElementsAre(IsTupleSlotWith(Int64(5), _),
+                                  IsTupleSlotWith(NullInt64(), _)));
+        }
+        expected = std::move(data);
+        continue;
+      }
+      ASSERT_EQ(data.size(), expected.size());
+      for (int i = 0; i < data.size(); ++i) {
+        ASSERT_EQ(data[i].num_slots(), expected[i].num_slots());
+        for (int j = 0; j < data[i].num_slots(); ++j) {
+          EXPECT_EQ(data[i].slot(j).value(), expected[i].slot(j).value())
+              << i << " " << j;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(CreateIteratorTest, MergeJoinUnsortedInputs) {
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<JoinOp> unsorted_left,
+      CreateMergeJoin(JoinOp::kInnerJoin, {Int64(2), Int64(1)},
+                      {Int64(1), Int64(2)}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      unsorted_left->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                    &context));
+  EXPECT_THAT(ReadFromTupleIterator(iter.get()),
+              StatusIs(zetasql_base::StatusCode::kInternal,
+                       HasSubstr("left input of a merge join is not sorted")));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<JoinOp> unsorted_right,
+      CreateMergeJoin(JoinOp::kInnerJoin, {Int64(1), Int64(2)},
+                      {Int64(2), Int64(1)}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      iter, unsorted_right->CreateIterator(EmptyParams(),
+                                           /*num_extra_slots=*/0, &context));
+  EXPECT_THAT(ReadFromTupleIterator(iter.get()),
+              StatusIs(zetasql_base::StatusCode::kInternal,
+                       HasSubstr("right input of a merge join is not sorted")));
+
+  // Only inner and left outer joins can merge their inputs.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto true_expr, ConstExpr::Create(Bool(true)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto full_outer_join,
+      JoinOp::Create(JoinOp::kFullOuterJoin, /*equality_exprs=*/{},
+                     std::move(true_expr),
+                     absl::make_unique<TestRelationalOp>(
+                         std::vector<VariableId>{}, std::vector<TupleData>{},
+                         /*preserves_order=*/true),
+                     absl::make_unique<TestRelationalOp>(
+                         std::vector<VariableId>{}, std::vector<TupleData>{},
+                         /*preserves_order=*/true),
+                     /*left_outputs=*/{}, /*right_outputs=*/{}));
+  EXPECT_FALSE(full_outer_join->set_num_merge_join_keys(0).ok());
+}
+
+TEST_F(CreateIteratorTest, GraceHashJoin) {
+  VariableId x("x"), x_prime("x'"), y("y"), y_prime("y'"), a("a"), b("b");
+
+  // Left keys are 0..1999 and 3000..3199. Right keys are 0..2499, twice each.
+  std::vector<TupleData> left_tuples;
+  for (int64_t i = 0; i < 2000; ++i) {
+    left_tuples.push_back(CreateTestTupleData({Int64(i)}));
+  }
+  for (int64_t i = 3000; i < 3200; ++i) {
+    left_tuples.push_back(CreateTestTupleData({Int64(i)}));
+  }
+  std::vector<TupleData> right_tuples;
+  for (int64_t i = 0; i < 5000; ++i) {
+    right_tuples.push_back(CreateTestTupleData({Int64(i % 2500)}));
+  }
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y, DerefExpr::Create(y, Int64Type()));
+  JoinOp::HashJoinEqualityExprs equality_expr;
+  equality_expr.left_expr = absl::make_unique<ExprArg>(a, std::move(deref_x));
+  equality_expr.right_expr = absl::make_unique<ExprArg>(b, std::move(deref_y));
+  std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs;
+  equality_exprs.push_back(std::move(equality_expr));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto true_expr, ConstExpr::Create(Bool(true)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x_output,
+                       DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y_output,
+                       DerefExpr::Create(y, Int64Type()));
+  std::vector<std::unique_ptr<ExprArg>> left_outputs;
+  left_outputs.push_back(
+      absl::make_unique<ExprArg>(x_prime, std::move(deref_x_output)));
+  std::vector<std::unique_ptr<ExprArg>> right_outputs;
+  right_outputs.push_back(
+      absl::make_unique<ExprArg>(y_prime, std::move(deref_y_output)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto join_op,
+      JoinOp::Create(
+          JoinOp::kFullOuterJoin, std::move(equality_exprs),
+          std::move(true_expr),
+          absl::make_unique<TestRelationalOp>(std::vector<VariableId>{x},
+                                              left_tuples,
+                                              /*preserves_order=*/true),
+          absl::make_unique<TestRelationalOp>(std::vector<VariableId>{y},
+                                              right_tuples,
+                                              /*preserves_order=*/true),
+          std::move(left_outputs), std::move(right_outputs)));
+  ZETASQL_ASSERT_OK(join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+  // Grace hash joins do not preserve the order of the left input.
+  ZETASQL_ASSERT_OK(join_op->set_is_order_preserving(false));
+
+  auto read_sorted_output =
+      [&join_op](EvaluationContext* context,
+                 bool* spilled) -> zetasql_base::StatusOr<std::vector<std::string>> {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<TupleIterator> iter,
+        join_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, context));
+    ZETASQL_ASSIGN_OR_RETURN(std::vector<TupleData> data,
+                     ReadFromTupleIterator(iter.get()));
+    std::vector<std::string> rows;
+    for (const TupleData& tuple : data) {
+      rows.push_back(Tuple(&iter->Schema(), &tuple).DebugString());
+    }
+    std::sort(rows.begin(), rows.end());
+    *spilled = context->stats().num_spill_files > 0;
+    return rows;
+  };
+
+  EvaluationContext context((EvaluationOptions()));
+  bool spilled;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<std::string> expected,
+                       read_sorted_output(&context, &spilled));
+  EXPECT_FALSE(spilled);
+  // 2000 left keys join with two right tuples each, 200 left tuples and
+  // 1000 right tuples do not join.
+  ASSERT_EQ(expected.size(), 5200);
+
+  // Without a spill directory, the join runs out of memory.
+  EvaluationOptions options;
+  options.max_intermediate_byte_size = 100000;
+  EvaluationContext memory_context(options);
+  EXPECT_THAT(read_sorted_output(&memory_context, &spilled),
+              StatusIs(zetasql_base::StatusCode::kResourceExhausted,
+                       HasSubstr("Out of memory")));
+
+  options.spill_directory = testing::TempDir();
+  EvaluationContext spill_context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<std::string> data,
+                       read_sorted_output(&spill_context, &spilled));
+  EXPECT_TRUE(spilled);
+  EXPECT_EQ(data, expected);
+}
+
 TEST_F(CreateIteratorTest, SortOpTotalOrder) {
   VariableId a("a"), b("b"), c("c"), param("param"), k("k"), v1("v1"), v2("v2"),
       v3("v3");
@@ -2793,6 +3591,64 @@ TEST_F(CreateIteratorTest, SortOpPartialOrderStableSort) {
   EXPECT_EQ(data[3].num_slots(), 2);
 }
 
+TEST_F(CreateIteratorTest, SortOpSpillsToDisk) {
+  VariableId a("a"), b("b"), k("k"), v("v");
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+
+  std::vector<std::unique_ptr<KeyArg>> keys;
+  keys.push_back(
+      absl::make_unique<KeyArg>(k, std::move(deref_a), KeyArg::kAscending));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_b, DerefExpr::Create(b, Int64Type()));
+
+  std::vector<std::unique_ptr<ExprArg>> values;
+  values.push_back(absl::make_unique<ExprArg>(v, std::move(deref_b)));
+
+  std::vector<TupleData> input_tuples;
+  for (int64_t i = 0; i < 1000; ++i) {
+    input_tuples.push_back(CreateTestTupleData({Int64(i % 10), Int64(i)}));
+  }
+  auto input = absl::make_unique<TestRelationalOp>(
+      std::vector<VariableId>{a, b}, input_tuples, /*preserves_order=*/true);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto sort_op,
+      SortOp::Create(std::move(keys), std::move(values),
+                     /*limit=*/nullptr, /*offset=*/nullptr, std::move(input),
+                     /*is_order_preserving=*/true,
+                     /*is_stable_sort=*/true));
+  ZETASQL_ASSERT_OK(sort_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  // Without a spill directory, the sort runs out of memory.
+  EvaluationOptions options;
+  options.max_intermediate_byte_size = 5000;
+  EvaluationContext memory_context(options);
+  EXPECT_THAT(sort_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                      &memory_context),
+              StatusIs(zetasql_base::StatusCode::kResourceExhausted,
+                       HasSubstr("Out of memory")));
+
+  options.spill_directory = testing::TempDir();
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      sort_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, &context));
+  EXPECT_GT(context.stats().num_spill_files, 1);
+  EXPECT_GT(context.stats().num_spilled_tuples, 0);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  // The merge of the sorted runs is stable too.
+  ASSERT_EQ(data.size(), 1000);
+  for (int i = 0; i < data.size(); ++i) {
+    const int64_t key = i / 100;
+    EXPECT_THAT(data[i].slots(),
+                ElementsAre(IsTupleSlotWith(Int64(key), _),
+                            IsTupleSlotWith(Int64(key + 10 * (i % 100)), _)))
+        << i;
+  }
+}
+
 // Tests the reordering functionality in SortTupleIterator.
 TEST_F(CreateIteratorTest, SortOpPartialInputReordersTest) {
   const int num_keys = 10;
@@ -2882,9 +3738,8 @@ TEST_F(CreateIteratorTest, SortOpPartialInputReordersTest) {
   }
 }
 
-TEST_F(CreateIteratorTest, SortOpTotalOrderWithLimitAndOffset) {
-  VariableId a("a"), b("b"), c("c"), param("param"), k("k"), v1("v1"), v2("v2"),
-      v3("v3"), limit("limit"), offset("offset");
+TEST_F(CreateIteratorTest, SortOpWithLimitUsesBoundedMemory) {
+  VariableId a("a"), b("b"), k("k"), v("v");
 
   ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
 
@@ -2893,27 +3748,20 @@ TEST_F(CreateIteratorTest, SortOpTotalOrderWithLimitAndOffset) {
       absl::make_unique<KeyArg>(k, std::move(deref_a), KeyArg::kDescending));
 
   ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_b, DerefExpr::Create(b, Int64Type()));
-  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_c, DerefExpr::Create(c, proto_type_));
-  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_param, DerefExpr::Create(param, Int64Type()));
 
   std::vector<std::unique_ptr<ExprArg>> values;
-  values.push_back(absl::make_unique<ExprArg>(v1, std::move(deref_b)));
-  values.push_back(absl::make_unique<ExprArg>(v2, std::move(deref_c)));
-  values.push_back(absl::make_unique<ExprArg>(v3, std::move(deref_param)));
+  values.push_back(absl::make_unique<ExprArg>(v, std::move(deref_b)));
 
-  std::vector<std::vector<const SharedProtoState*>> shared_states;
-  auto input = absl::WrapUnique(new TestRelationalOp(
-      {a, b, c},
-      CreateTestTupleDatas({{NullInt64(), Int64(10), GetProtoValue(1)},
-                            {Int64(2), Int64(20), GetProtoValue(2)},
-                            {Int64(3), Int64(30), GetProtoValue(3)},
-                            {Int64(4), Int64(40), GetProtoValue(4)}},
-                           &shared_states),
-      /*preserves_order=*/true));
+  // Many more input rows than fit in memory.
+  std::vector<TupleData> input_tuples;
+  for (int64_t i = 0; i < 10000; ++i) {
+    input_tuples.push_back(CreateTestTupleData({Int64(i % 1000), Int64(i)}));
+  }
+  auto input = absl::make_unique<TestRelationalOp>(
+      std::vector<VariableId>{a, b}, input_tuples, /*preserves_order=*/true);
 
-  ZETASQL_ASSERT_OK_AND_ASSIGN(auto limit_expr, DerefExpr::Create(limit, Int64Type()));
-  ZETASQL_ASSERT_OK_AND_ASSIGN(auto offset_expr,
-                       DerefExpr::Create(offset, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto limit_expr, ConstExpr::Create(Int64(3)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto offset_expr, ConstExpr::Create(Int64(2)));
 
   ZETASQL_ASSERT_OK_AND_ASSIGN(
       auto sort_op,
@@ -2921,9 +3769,148 @@ TEST_F(CreateIteratorTest, SortOpTotalOrderWithLimitAndOffset) {
                      std::move(offset_expr), std::move(input),
                      /*is_order_preserving=*/true,
                      /*is_stable_sort=*/false));
-  EXPECT_EQ(sort_op->IteratorDebugString(),
-            "SortTupleIterator(TestTupleIterator)");
-  EXPECT_EQ(sort_op->DebugString(),
+  ZETASQL_ASSERT_OK(sort_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  EvaluationOptions options;
+  options.max_intermediate_byte_size = 5000;
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      sort_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  // The top five rows are (999, 999), (999, 1999), ..., (999, 4999). Ties are
+  // broken by the input order.
+  ASSERT_EQ(data.size(), 3);
+  EXPECT_THAT(data[0].slots(), ElementsAre(IsTupleSlotWith(Int64(999), _),
+                                           IsTupleSlotWith(Int64(2999), _)));
+  EXPECT_THAT(data[1].slots(), ElementsAre(IsTupleSlotWith(Int64(999), _),
+                                           IsTupleSlotWith(Int64(3999), _)));
+  EXPECT_THAT(data[2].slots(), ElementsAre(IsTupleSlotWith(Int64(999), _),
+                                           IsTupleSlotWith(Int64(4999), _)));
+}
+
+TEST_F(CreateIteratorTest, SortOpWithPartitionLimit) {
+  VariableId a("a"), b("b"), c("c"), p("p"), o("o"), v("v");
+
+  // Many more input rows than fit in memory.
+  std::vector<TupleData> input_tuples;
+  for (int64_t i = 0; i < 10000; ++i) {
+    input_tuples.push_back(
+        CreateTestTupleData({Int64(i % 3), Int64(i % 100), Int64(i)}));
+  }
+
+  for (bool with_ties : {false, true}) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a,
+                         DerefExpr::Create(a, Int64Type()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_b,
+                         DerefExpr::Create(b, Int64Type()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_c,
+                         DerefExpr::Create(c, Int64Type()));
+
+    std::vector<std::unique_ptr<KeyArg>> keys;
+    keys.push_back(
+        absl::make_unique<KeyArg>(p, std::move(deref_a), KeyArg::kAscending));
+    keys.push_back(
+        absl::make_unique<KeyArg>(o, std::move(deref_b), KeyArg::kDescending));
+
+    std::vector<std::unique_ptr<ExprArg>> values;
+    values.push_back(absl::make_unique<ExprArg>(v, std::move(deref_c)));
+
+    auto input = absl::make_unique<TestRelationalOp>(
+        std::vector<VariableId>{a, b, c}, input_tuples,
+        /*preserves_order=*/true);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        auto sort_op,
+        SortOp::Create(std::move(keys), std::move(values), /*limit=*/nullptr,
+                       /*offset=*/nullptr, std::move(input),
+                       /*is_order_preserving=*/true,
+                       /*is_stable_sort=*/false));
+    ZETASQL_ASSERT_OK(sort_op->SetPartitionLimit(/*num_partition_keys=*/1,
+                                         /*partition_limit=*/2, with_ties));
+    ZETASQL_ASSERT_OK(sort_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+    EXPECT_THAT(sort_op->DebugString(),
+                HasSubstr(with_ties ? "partition_limit: 2 with ties over 1"
+                                    : "partition_limit: 2 over 1"));
+
+    EvaluationOptions options;
+    options.max_intermediate_byte_size = 50000;
+    EvaluationContext context(options);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<TupleIterator> iter,
+        sort_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                &context));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    if (with_ties) {
+      // All the rows with b = 99, which all rank first in their partitions.
+      ASSERT_EQ(data.size(), 100);
+      for (int i = 0; i < data.size(); ++i) {
+        EXPECT_EQ(data[i].slot(1).value(), Int64(99)) << i;
+        if (i > 0) {
+          EXPECT_LE(data[i - 1].slot(0).value().int64_value(),
+                    data[i].slot(0).value().int64_value());
+        }
+      }
+    } else {
+      // The first two rows of each partition with b = 99. Ties are broken by
+      // the input order.
+      ASSERT_EQ(data.size(), 6);
+      const std::vector<std::vector<int64_t>> expected = {
+          {0, 99, 99},  {0, 99, 399}, {1, 99, 199},
+          {1, 99, 499}, {2, 99, 299}, {2, 99, 599}};
+      for (int i = 0; i < data.size(); ++i) {
+        EXPECT_THAT(data[i].slots(),
+                    ElementsAre(IsTupleSlotWith(Int64(expected[i][0]), _),
+                                IsTupleSlotWith(Int64(expected[i][1]), _),
+                                IsTupleSlotWith(Int64(expected[i][2]), _)));
+      }
+    }
+  }
+}
+
+TEST_F(CreateIteratorTest, SortOpTotalOrderWithLimitAndOffset) {
+  VariableId a("a"), b("b"), c("c"), param("param"), k("k"), v1("v1"), v2("v2"),
+      v3("v3"), limit("limit"), offset("offset");
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+
+  std::vector<std::unique_ptr<KeyArg>> keys;
+  keys.push_back(
+      absl::make_unique<KeyArg>(k, std::move(deref_a), KeyArg::kDescending));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_b, DerefExpr::Create(b, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_c, DerefExpr::Create(c, proto_type_));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_param, DerefExpr::Create(param, Int64Type()));
+
+  std::vector<std::unique_ptr<ExprArg>> values;
+  values.push_back(absl::make_unique<ExprArg>(v1, std::move(deref_b)));
+  values.push_back(absl::make_unique<ExprArg>(v2, std::move(deref_c)));
+  values.push_back(absl::make_unique<ExprArg>(v3, std::move(deref_param)));
+
+  std::vector<std::vector<const SharedProtoState*>> shared_states;
+  auto input = absl::WrapUnique(new TestRelationalOp(
+      {a, b, c},
+      CreateTestTupleDatas({{NullInt64(), Int64(10), GetProtoValue(1)},
+                            {Int64(2), Int64(20), GetProtoValue(2)},
+                            {Int64(3), Int64(30), GetProtoValue(3)},
+                            {Int64(4), Int64(40), GetProtoValue(4)}},
+                           &shared_states),
+      /*preserves_order=*/true));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto limit_expr, DerefExpr::Create(limit, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto offset_expr,
+                       DerefExpr::Create(offset, Int64Type()));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto sort_op,
+      SortOp::Create(std::move(keys), std::move(values), std::move(limit_expr),
+                     std::move(offset_expr), std::move(input),
+                     /*is_order_preserving=*/true,
+                     /*is_stable_sort=*/false));
+  EXPECT_EQ(sort_op->IteratorDebugString(),
+            "SortTupleIterator(TestTupleIterator)");
+  EXPECT_EQ(sort_op->DebugString(),
             "SortOp(ordered\n"
             "+-keys: {\n"
             "| +-$k := $a DESC},\n"
@@ -3148,6 +4135,59 @@ TEST_F(CreateIteratorTest, ScanArrayOfStructs) {
   EXPECT_EQ(data[0].num_slots(), 3);
 }
 
+TEST_F(CreateIteratorTest, ScanArrayOfStructsWithFilter) {
+  VariableId x("x"), p("p"), v1("v1"), v2("v2"), param("param");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto array_expr,
+      ConstExpr::Create(Array({Struct({"foo", "bar"}, {Int64(1), Int64(2)}),
+                               Struct({"foo", "bar"}, {Int64(3), Int64(4)}),
+                               Struct({"foo", "bar"}, {Int64(5), Int64(6)})})));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto scan_op,
+                       ArrayScanOp::Create(x, p, {{v1, 0}, {v2, 1}},
+                                           std::move(array_expr)));
+
+  // v1 < param
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_v1, DerefExpr::Create(v1, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_param,
+                       DerefExpr::Create(param, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> less_args;
+  less_args.push_back(std::move(deref_v1));
+  less_args.push_back(std::move(deref_param));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto less_expr,
+                       ScalarFunctionCallExpr::Create(
+                           CreateFunction(FunctionKind::kLess, BoolType()),
+                           std::move(less_args)));
+  EXPECT_FALSE(scan_op->has_filter());
+  ZETASQL_ASSERT_OK(scan_op->set_filter(std::move(less_expr), {v1, param}));
+  EXPECT_TRUE(scan_op->has_filter());
+  EXPECT_EQ(
+      "ArrayScanOp(\n"
+      "+-$x := element,\n"
+      "+-$p := position,\n"
+      "+-$v1 := field[0]:foo,\n"
+      "+-$v2 := field[1]:bar,\n"
+      "+-array: ConstExpr([{foo:1, bar:2}, {foo:3, bar:4}, {foo:5, bar:6}]),\n"
+      "+-filter: Less($v1, $param))",
+      scan_op->DebugString());
+
+  TupleSchema params_schema({param});
+  TupleData params_data = CreateTestTupleData({Int64(5)});
+  ZETASQL_ASSERT_OK(scan_op->SetSchemasForEvaluation({&params_schema}));
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      scan_op->CreateIterator({&params_data}, /*num_extra_slots=*/1, &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), 2);
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[0]).DebugString(),
+            "<v1:1,v2:2,x:{foo:1, bar:2},p:0>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[1]).DebugString(),
+            "<v1:3,v2:4,x:{foo:3, bar:4},p:1>");
+  EXPECT_EQ(data[0].num_slots(), 5);
+}
+
 TEST_F(CreateIteratorTest, TableScanAsArray) {
   VariableId v1("v1"), v2("v2");
   Value table = Array({
@@ -3322,6 +4362,114 @@ TEST_F(CreateIteratorTest, UnionAllOp) {
   EXPECT_FALSE(iter->PreservesOrder());
 }
 
+TEST_F(CreateIteratorTest, UnionAllOpInParallel) {
+  const VariableId x("x");
+  const int kNumInputs = 3;
+  const int kNumRowsPerInput = 1000;
+  std::vector<std::unique_ptr<SimpleTable>> tables;
+  std::vector<UnionAllOp::Input> union_inputs;
+  for (int i = 0; i < kNumInputs; ++i) {
+    tables.push_back(absl::make_unique<SimpleTable>(
+        absl::StrCat("TestTable", i),
+        std::vector<SimpleTable::NameAndType>{
+            {"column0", types::Int64Type()}}));
+    std::vector<std::vector<Value>> contents;
+    for (int j = 0; j < kNumRowsPerInput; ++j) {
+      contents.push_back({Int64(i * kNumRowsPerInput + j)});
+    }
+    tables.back()->SetContents(contents);
+
+    const VariableId column(absl::StrCat("column", i));
+    UnionAllOp::Input input;
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        input.first,
+        EvaluatorTableScanOp::Create(tables.back().get(), /*alias=*/"", {0},
+                                     {"column0"}, {column},
+                                     /*and_filters=*/{},
+                                     /*read_time=*/nullptr));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref, DerefExpr::Create(column, Int64Type()));
+    input.second.push_back(absl::make_unique<ExprArg>(x, std::move(deref)));
+    union_inputs.push_back(std::move(input));
+  }
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto union_all_op,
+                       UnionAllOp::Create(std::move(union_inputs)));
+  union_all_op->set_evaluate_inputs_in_parallel(true);
+  ZETASQL_ASSERT_OK(union_all_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  for (int num_threads : {1, 2, 3, 8}) {
+    EvaluationOptions options;
+    options.num_threads = num_threads;
+    EvaluationContext context(options);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                         union_all_op->CreateIterator(
+                             EmptyParams(), /*num_extra_slots=*/1, &context));
+    EXPECT_EQ(iter->DebugString(),
+              "UnionAllTupleIterator("
+              "EvaluatorTableTupleIterator(TestTable0),"
+              "EvaluatorTableTupleIterator(TestTable1),"
+              "EvaluatorTableTupleIterator(TestTable2))");
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+
+    // Every row of every input is returned exactly once, in some order.
+    std::vector<int64_t> values;
+    for (const TupleData& tuple : data) {
+      ASSERT_EQ(tuple.num_slots(), 2);
+      values.push_back(tuple.slot(0).value().int64_value());
+    }
+    std::sort(values.begin(), values.end());
+    ASSERT_EQ(values.size(), kNumInputs * kNumRowsPerInput) << num_threads;
+    for (int i = 0; i < values.size(); ++i) {
+      ASSERT_EQ(values[i], i) << num_threads;
+    }
+  }
+}
+
+TEST_F(CreateIteratorTest, UnionAllOpInParallelFailure) {
+  const std::string error = "Failed to read row from TestTable";
+  const zetasql_base::Status failure = zetasql_base::OutOfRangeErrorBuilder() << error;
+
+  SimpleTable good_table("GoodTable", {{"column0", types::Int64Type()}});
+  good_table.SetContents({{Int64(1)}, {Int64(2)}});
+  EvaluatorTestTable bad_table("TestTable", {{"column0", types::Int64Type()}},
+                               {{Int64(10)}, {Int64(20)}}, failure);
+
+  const VariableId x("x"), good("good"), bad("bad");
+  std::vector<UnionAllOp::Input> union_inputs(2);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      union_inputs[0].first,
+      EvaluatorTableScanOp::Create(&good_table, /*alias=*/"", {0}, {"column0"},
+                                   {good}, /*and_filters=*/{},
+                                   /*read_time=*/nullptr));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_good, DerefExpr::Create(good, Int64Type()));
+  union_inputs[0].second.push_back(
+      absl::make_unique<ExprArg>(x, std::move(deref_good)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      union_inputs[1].first,
+      EvaluatorTableScanOp::Create(&bad_table, /*alias=*/"", {0}, {"column0"},
+                                   {bad}, /*and_filters=*/{},
+                                   /*read_time=*/nullptr));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_bad, DerefExpr::Create(bad, Int64Type()));
+  union_inputs[1].second.push_back(
+      absl::make_unique<ExprArg>(x, std::move(deref_bad)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto union_all_op,
+                       UnionAllOp::Create(std::move(union_inputs)));
+  union_all_op->set_evaluate_inputs_in_parallel(true);
+  ZETASQL_ASSERT_OK(union_all_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  EvaluationOptions options;
+  options.num_threads = 2;
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                       union_all_op->CreateIterator(
+                           EmptyParams(), /*num_extra_slots=*/0, &context));
+  zetasql_base::Status status;
+  ReadFromTupleIteratorFull(iter.get(), &status);
+  EXPECT_THAT(status, StatusIs(zetasql_base::OUT_OF_RANGE, HasSubstr(error)));
+}
+
 TEST_F(CreateIteratorTest, ComputeOp) {
   VariableId a("a"), b("b"), param("param"), minus("minus"), plus("plus");
   std::vector<TupleData> test_values =
@@ -3475,6 +4623,16 @@ TEST_F(CreateIteratorTest, FilterOp) {
               ElementsAre(IsTupleSlotWith(Int64(2), IsNull()),
                           IsTupleSlotWith(Int64(20), IsNull()), _));
 
+  // Do it again with cancellation.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter,
+                       filter_op->CreateIterator(
+                           {&params_data}, /*num_extra_slots=*/1, &context));
+  context.SetCancelled();
+  zetasql_base::Status status;
+  data = ReadFromTupleIteratorFull(iter.get(), &status);
+  EXPECT_TRUE(data.empty());
+  EXPECT_THAT(status, StatusIs(zetasql_base::CANCELLED, _));
+
   // Check that scrambling works.
   EvaluationContext scramble_context(GetScramblingEvaluationOptions());
   ZETASQL_ASSERT_OK_AND_ASSIGN(
@@ -3485,6 +4643,327 @@ TEST_F(CreateIteratorTest, FilterOp) {
   EXPECT_FALSE(iter->PreservesOrder());
 }
 
+TEST_F(CreateIteratorTest, FilterOpProfile) {
+  VariableId a("a"), param("param");
+  const std::vector<TupleData> test_values = CreateTestTupleDatas(
+      {{Int64(1)}, {Int64(3)}, {Int64(2)}, {Int64(4)}});
+  auto input = absl::WrapUnique(
+      new TestRelationalOp({a}, test_values, /*preserves_order=*/true));
+  const RelationalOp* input_op = input.get();
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_param, DerefExpr::Create(param, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> args;
+  args.push_back(std::move(deref_a));
+  args.push_back(std::move(deref_param));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto predicate,
+                       ScalarFunctionCallExpr::Create(
+                           CreateFunction(FunctionKind::kLess, BoolType()),
+                           std::move(args), DEFAULT_ERROR_MODE));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto filter_op, FilterOp::Create(std::move(predicate), std::move(input)));
+
+  TupleSchema params_schema({param});
+  const TupleData params_data = CreateTestTupleData({Int64(3)});
+  ZETASQL_ASSERT_OK(filter_op->SetSchemasForEvaluation({&params_schema}));
+
+  // No profile is collected by default.
+  EvaluationContext default_context((EvaluationOptions()));
+  EXPECT_EQ(default_context.profile(), nullptr);
+
+  EvaluationOptions options;
+  options.collect_profile = true;
+  EvaluationContext context(options);
+  ASSERT_NE(context.profile(), nullptr);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                       filter_op->CreateIterator(
+                           {&params_data}, /*num_extra_slots=*/0, &context));
+  EXPECT_EQ(iter->DebugString(), "FilterTupleIterator(TestTupleIterator)");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), 2);
+  EXPECT_EQ(context.current_operator_profile(), nullptr);
+
+  const OperatorProfile* filter_profile =
+      context.profile()->GetOperatorProfile(filter_op.get());
+  ASSERT_NE(filter_profile, nullptr);
+  EXPECT_EQ(filter_profile->num_iterators, 1);
+  EXPECT_EQ(filter_profile->num_output_rows, 2);
+  EXPECT_EQ(filter_profile->num_function_calls, 4);
+
+  const OperatorProfile* input_profile =
+      context.profile()->GetOperatorProfile(input_op);
+  ASSERT_NE(input_profile, nullptr);
+  EXPECT_EQ(input_profile->num_iterators, 1);
+  EXPECT_EQ(input_profile->num_output_rows, 4);
+  EXPECT_EQ(input_profile->num_function_calls, 0);
+  EXPECT_LE(input_profile->total_time, filter_profile->total_time);
+
+  OperatorProfileProto proto;
+  context.profile()->Serialize(filter_op.get(), &proto);
+  EXPECT_EQ(proto.name(), "FilterOp");
+  EXPECT_EQ(proto.num_input_rows(), 4);
+  EXPECT_EQ(proto.num_output_rows(), 2);
+  EXPECT_EQ(proto.num_function_calls(), 4);
+  EXPECT_GE(proto.self_time_nanos(), 0);
+  ASSERT_EQ(proto.inputs_size(), 1);
+  EXPECT_EQ(proto.inputs(0).name(), "TestRelationalOp");
+  EXPECT_EQ(proto.inputs(0).num_output_rows(), 4);
+  EXPECT_EQ(proto.inputs(0).inputs_size(), 0);
+}
+
+TEST_F(CreateIteratorTest, BatchedPipeline) {
+  // LIMIT 4 OFFSET 2 over a filter over a compute over a table scan.
+  VariableId x("x"), y("y");
+  SimpleTable table("TestTable", {{"column0", types::Int64Type()}});
+  std::vector<std::vector<Value>> contents;
+  for (int i = 0; i < 10; ++i) {
+    contents.push_back({Int64(i)});
+  }
+  table.SetContents(contents);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto scan_op,
+      EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0}, {"column0"}, {x},
+                                   /*and_filters=*/{}, /*read_time=*/nullptr));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x_again, DerefExpr::Create(x, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> plus_args;
+  plus_args.push_back(std::move(deref_x));
+  plus_args.push_back(std::move(deref_x_again));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto plus_expr,
+                       ScalarFunctionCallExpr::Create(
+                           CreateFunction(FunctionKind::kAdd, Int64Type()),
+                           std::move(plus_args), DEFAULT_ERROR_MODE));
+  std::vector<std::unique_ptr<ExprArg>> map;
+  map.push_back(absl::make_unique<ExprArg>(y, std::move(plus_expr)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto compute_op,
+                       ComputeOp::Create(std::move(map), std::move(scan_op)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y, DerefExpr::Create(y, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto const_16, ConstExpr::Create(Int64(16)));
+  std::vector<std::unique_ptr<ValueExpr>> less_args;
+  less_args.push_back(std::move(deref_y));
+  less_args.push_back(std::move(const_16));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto predicate,
+                       ScalarFunctionCallExpr::Create(
+                           CreateFunction(FunctionKind::kLess, BoolType()),
+                           std::move(less_args), DEFAULT_ERROR_MODE));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto filter_op,
+      FilterOp::Create(std::move(predicate), std::move(compute_op)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto row_count, ConstExpr::Create(Int64(4)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto offset, ConstExpr::Create(Int64(2)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto limit_op,
+      LimitOp::Create(std::move(row_count), std::move(offset),
+                      std::move(filter_op), /*is_order_preserving=*/true));
+  ZETASQL_ASSERT_OK(limit_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  for (int batch_size : {0, 1, 3, 100}) {
+    EvaluationOptions options;
+    options.batch_size = batch_size;
+    EvaluationContext context(options);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<TupleIterator> iter,
+        limit_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/1,
+                                 &context));
+    if (batch_size == 0) {
+      EXPECT_EQ(iter->DebugString(),
+                "LimitTupleIterator(FilterTupleIterator(ComputeTupleIterator("
+                "EvaluatorTableTupleIterator(TestTable))))");
+    } else {
+      EXPECT_EQ(iter->DebugString(),
+                "BatchedTupleIterator(LimitTupleIterator("
+                "BatchedTupleIterator(FilterTupleIterator("
+                "BatchedTupleIterator(ComputeTupleIterator("
+                "BatchedTupleIterator(EvaluatorTableTupleIterator(TestTable)"
+                "))))))");
+    }
+    EXPECT_TRUE(iter->PreservesOrder());
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    ASSERT_EQ(data.size(), 4) << batch_size;
+    for (int i = 0; i < data.size(); ++i) {
+      EXPECT_THAT(data[i].slots(),
+                  ElementsAre(IsTupleSlotWith(Int64(i + 2), IsNull()),
+                              IsTupleSlotWith(Int64(2 * (i + 2)), IsNull()),
+                              _));
+    }
+  }
+}
+
+TEST_F(CreateIteratorTest, BatchedComputeOp) {
+  // $y := $x + $x, $z := SAFE.DIV($y, $x) over a table scan. The batched
+  // ComputeTupleIterator evaluates $y for the whole batch before $z, and
+  // suppresses the division by zero of the first row only.
+  VariableId x("x"), y("y"), z("z");
+  SimpleTable table("TestTable", {{"column0", types::Int64Type()}});
+  std::vector<std::vector<Value>> contents;
+  for (int i = 0; i < 5; ++i) {
+    contents.push_back({Int64(i)});
+  }
+  table.SetContents(contents);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto scan_op,
+      EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0}, {"column0"}, {x},
+                                   /*and_filters=*/{}, /*read_time=*/nullptr));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x_again, DerefExpr::Create(x, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> plus_args;
+  plus_args.push_back(std::move(deref_x));
+  plus_args.push_back(std::move(deref_x_again));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto plus_expr,
+                       ScalarFunctionCallExpr::Create(
+                           CreateFunction(FunctionKind::kAdd, Int64Type()),
+                           std::move(plus_args), DEFAULT_ERROR_MODE));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y, DerefExpr::Create(y, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x_divisor, DerefExpr::Create(x, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> div_args;
+  div_args.push_back(std::move(deref_y));
+  div_args.push_back(std::move(deref_x_divisor));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto div_expr,
+      ScalarFunctionCallExpr::Create(
+          CreateFunction(FunctionKind::kDiv, Int64Type()), std::move(div_args),
+          ResolvedFunctionCallBase::SAFE_ERROR_MODE));
+
+  std::vector<std::unique_ptr<ExprArg>> map;
+  map.push_back(absl::make_unique<ExprArg>(y, std::move(plus_expr)));
+  map.push_back(absl::make_unique<ExprArg>(z, std::move(div_expr)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto compute_op,
+                       ComputeOp::Create(std::move(map), std::move(scan_op)));
+  ZETASQL_ASSERT_OK(compute_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  for (int batch_size : {0, 2, 100}) {
+    EvaluationOptions options;
+    options.batch_size = batch_size;
+    EvaluationContext context(options);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<TupleIterator> iter,
+        compute_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/1,
+                                   &context));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    ASSERT_EQ(data.size(), 5) << batch_size;
+    for (int i = 0; i < data.size(); ++i) {
+      EXPECT_THAT(data[i].slots(),
+                  ElementsAre(IsTupleSlotWith(Int64(i), IsNull()),
+                              IsTupleSlotWith(Int64(2 * i), IsNull()),
+                              IsTupleSlotWith(i == 0 ? NullInt64() : Int64(2),
+                                              IsNull()),
+                              _))
+          << batch_size << " " << i;
+    }
+  }
+}
+
+TEST_F(CreateIteratorTest, ExchangeOp) {
+  VariableId x("x"), param("param");
+  const int kNumRows = 2000;
+  SimpleTable table("TestTable", {{"column0", types::Int64Type()}});
+  std::vector<std::vector<Value>> contents;
+  for (int i = 0; i < kNumRows; ++i) {
+    contents.push_back({Int64(i)});
+  }
+  table.SetContents(contents);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto scan_op,
+      EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0}, {"column0"}, {x},
+                                   /*and_filters=*/{}, /*read_time=*/nullptr));
+  const EvaluatorTableScanOp* partitioned_scan = scan_op.get();
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_param,
+                       DerefExpr::Create(param, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> less_args;
+  less_args.push_back(std::move(deref_x));
+  less_args.push_back(std::move(deref_param));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto less,
+                       ScalarFunctionCallExpr::Create(
+                           CreateFunction(FunctionKind::kLess, BoolType()),
+                           std::move(less_args)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto filter_op,
+                       FilterOp::Create(std::move(less), std::move(scan_op)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto exchange_op,
+      ExchangeOp::Create(std::move(filter_op), partitioned_scan));
+  EXPECT_EQ(exchange_op->IteratorDebugString(),
+            "ExchangeTupleIterator(FilterTupleIterator("
+            "EvaluatorTableTupleIterator(TestTable)))");
+  std::unique_ptr<TupleSchema> output_schema =
+      exchange_op->CreateOutputSchema();
+  EXPECT_THAT(output_schema->variables(), ElementsAre(x));
+
+  const TupleSchema params_schema({param});
+  ZETASQL_ASSERT_OK(exchange_op->SetSchemasForEvaluation({&params_schema}));
+  const TupleData params_data = CreateTestTupleData({Int64(1500)});
+
+  for (int num_threads : {1, 2, 4, 7}) {
+    EvaluationOptions options;
+    options.num_threads = num_threads;
+    EvaluationContext context(options);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                         exchange_op->CreateIterator(
+                             {&params_data}, /*num_extra_slots=*/1, &context));
+    if (num_threads > 1) {
+      EXPECT_EQ(iter->DebugString(),
+                "ExchangeTupleIterator(FilterTupleIterator("
+                "EvaluatorTableTupleIterator(TestTable)))");
+    }
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+
+    // Every row that passes the filter is returned exactly once, in some
+    // order.
+    std::vector<int64_t> values;
+    for (const TupleData& tuple : data) {
+      ASSERT_EQ(tuple.num_slots(), 2);
+      values.push_back(tuple.slot(0).value().int64_value());
+    }
+    std::sort(values.begin(), values.end());
+    ASSERT_EQ(values.size(), 1500) << num_threads;
+    for (int i = 0; i < values.size(); ++i) {
+      ASSERT_EQ(values[i], i) << num_threads;
+    }
+  }
+}
+
+TEST_F(CreateIteratorTest, ExchangeOpFailure) {
+  const std::string error = "Failed to read row from TestTable";
+  const zetasql_base::Status failure = zetasql_base::OutOfRangeErrorBuilder() << error;
+
+  EvaluatorTestTable table("TestTable", {{"column0", types::Int64Type()}},
+                           {{Int64(10)}, {Int64(20)}}, failure);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto scan_op, EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0},
+                                                 {"column0"}, {VariableId("x")},
+                                                 /*and_filters=*/{},
+                                                 /*read_time=*/nullptr));
+  const EvaluatorTableScanOp* partitioned_scan = scan_op.get();
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto exchange_op,
+      ExchangeOp::Create(std::move(scan_op), partitioned_scan));
+  ZETASQL_ASSERT_OK(exchange_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  EvaluationOptions options;
+  options.num_threads = 3;
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                       exchange_op->CreateIterator(
+                           EmptyParams(), /*num_extra_slots=*/1, &context));
+  zetasql_base::Status status;
+  ReadFromTupleIteratorFull(iter.get(), &status);
+  EXPECT_THAT(status, StatusIs(zetasql_base::OUT_OF_RANGE, HasSubstr(error)));
+}
+
 TEST_F(CreateIteratorTest, LimitOp_OrderedInput) {
   VariableId a("a"), b("b"), row_count("row_count"), offset("offset");
   const std::vector<TupleData> test_values =
@@ -3748,6 +5227,173 @@ TEST_F(CreateIteratorTest, LimitOp_UnorderedInput) {
   EXPECT_TRUE(context->IsDeterministicOutput());
 }
 
+TEST_F(CreateIteratorTest, SampleScanOpBernoulli) {
+  VariableId a("a"), w("w"), percent("percent"), seed("seed");
+  std::vector<TupleData> input_tuples;
+  for (int i = 0; i < 100; ++i) {
+    input_tuples.push_back(CreateTestTupleData({Int64(i)}));
+  }
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_percent,
+                       DerefExpr::Create(percent, DoubleType()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_seed, DerefExpr::Create(seed, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto sample_op,
+      SampleScanOp::Create(SampleScanOp::kBernoulli, std::move(deref_percent),
+                           std::move(deref_seed), /*partition_keys=*/{}, w,
+                           absl::WrapUnique(new TestRelationalOp(
+                               {a}, input_tuples, /*preserves_order=*/true))));
+  EXPECT_EQ(sample_op->IteratorDebugString(),
+            "BernoulliSampleTupleIterator(TestTupleIterator)");
+  EXPECT_EQ(sample_op->DebugString(),
+            "SampleScanOp(bernoulli, weight: $w\n"
+            "+-size: $percent,\n"
+            "+-repeatable: $seed,\n"
+            "+-partition_keys: {},\n"
+            "+-input: TestRelationalOp)");
+  EXPECT_THAT(sample_op->CreateOutputSchema()->variables(),
+              ElementsAre(a, w));
+
+  const TupleSchema params_schema({percent, seed});
+  ZETASQL_ASSERT_OK(sample_op->SetSchemasForEvaluation({&params_schema}));
+
+  auto read_sample = [&](const Value& percent_value, int64_t seed_value,
+                         EvaluationContext* context)
+      -> zetasql_base::StatusOr<std::vector<TupleData>> {
+    const TupleData params_data =
+        CreateTestTupleData({percent_value, Int64(seed_value)});
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
+                     sample_op->CreateIterator({&params_data},
+                                               /*num_extra_slots=*/1, context));
+    return ReadFromTupleIterator(iter.get());
+  };
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       read_sample(Double(100), 1, &context));
+  ASSERT_EQ(data.size(), 100);
+  for (int i = 0; i < data.size(); ++i) {
+    EXPECT_THAT(data[i].slots(),
+                ElementsAre(IsTupleSlotWith(Int64(i), IsNull()),
+                            IsTupleSlotWith(Double(1), IsNull()), _));
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(data, read_sample(Double(0), 1, &context));
+  EXPECT_THAT(data, IsEmpty());
+  EXPECT_TRUE(context.IsDeterministicOutput());
+
+  // The same seed samples the same tuples.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(data, read_sample(Double(25), 7, &context));
+  EXPECT_FALSE(context.IsDeterministicOutput());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data_again,
+                       read_sample(Double(25), 7, &context));
+  ASSERT_EQ(data.size(), data_again.size());
+  EXPECT_GT(data.size(), 0);
+  EXPECT_LT(data.size(), 100);
+  for (int i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(data[i].slot(0).value(), data_again[i].slot(0).value());
+    EXPECT_EQ(data[i].slot(1).value(), Double(4));
+  }
+
+  EXPECT_THAT(read_sample(Double(101), 1, &context),
+              StatusIs(zetasql_base::OUT_OF_RANGE,
+                       HasSubstr("must be between 0 and 100")));
+  EXPECT_THAT(read_sample(NullDouble(), 1, &context),
+              StatusIs(zetasql_base::OUT_OF_RANGE,
+                       HasSubstr("must not be NULL")));
+}
+
+TEST_F(CreateIteratorTest, SampleScanOpReservoir) {
+  VariableId a("a"), b("b"), w("w"), rows("rows");
+  std::vector<TupleData> input_tuples;
+  for (int i = 0; i < 10; ++i) {
+    input_tuples.push_back(CreateTestTupleData({Int64(i), Int64(i % 2)}));
+  }
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_rows, DerefExpr::Create(rows, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_b, DerefExpr::Create(b, Int64Type()));
+  std::vector<std::unique_ptr<ExprArg>> partition_keys;
+  partition_keys.push_back(absl::make_unique<ExprArg>(std::move(deref_b)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto sample_op,
+      SampleScanOp::Create(
+          SampleScanOp::kReservoir, std::move(deref_rows),
+          /*repeatable=*/nullptr, std::move(partition_keys), w,
+          absl::WrapUnique(new TestRelationalOp({a, b}, input_tuples,
+                                                /*preserves_order=*/true))));
+  EXPECT_EQ(sample_op->IteratorDebugString(),
+            "ReservoirSampleTupleIterator(TestTupleIterator)");
+  EXPECT_THAT(sample_op->CreateOutputSchema()->variables(),
+              ElementsAre(a, b, w));
+
+  const TupleSchema params_schema({rows});
+  ZETASQL_ASSERT_OK(sample_op->SetSchemasForEvaluation({&params_schema}));
+
+  for (int64_t num_rows : {0, 3, 5, 20}) {
+    const TupleData params_data = CreateTestTupleData({Int64(num_rows)});
+    EvaluationContext context((EvaluationOptions()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                         sample_op->CreateIterator(
+                             {&params_data}, /*num_extra_slots=*/1, &context));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+
+    // Each partition has 5 tuples, and all of the tuples of the first
+    // partition come first.
+    const int64_t sample_size = std::min<int64_t>(num_rows, 5);
+    ASSERT_EQ(data.size(), 2 * sample_size) << num_rows;
+    std::set<int64_t> values;
+    for (int i = 0; i < data.size(); ++i) {
+      ASSERT_EQ(data[i].num_slots(), 4);
+      const int64_t value = data[i].slot(0).value().int64_value();
+      values.insert(value);
+      EXPECT_EQ(value % 2, i < sample_size ? 0 : 1) << num_rows;
+      EXPECT_EQ(data[i].slot(1).value(), Int64(value % 2));
+      EXPECT_EQ(data[i].slot(2).value(), Double(5.0 / sample_size));
+    }
+    EXPECT_EQ(values.size(), data.size());
+    EXPECT_EQ(context.IsDeterministicOutput(), num_rows == 0 || num_rows >= 5)
+        << num_rows;
+  }
+
+  const TupleData params_data = CreateTestTupleData({Int64(-1)});
+  EvaluationContext context((EvaluationOptions()));
+  EXPECT_THAT(
+      sample_op->CreateIterator({&params_data}, /*num_extra_slots=*/1,
+                                &context),
+      StatusIs(zetasql_base::OUT_OF_RANGE, HasSubstr("non-negative INT64")));
+}
+
+TEST_F(CreateIteratorTest, EvaluatorTableScanOpBlockSample) {
+  VariableId x("x");
+  SimpleTable table("TestTable", {{"column0", types::Int64Type()}});
+  std::vector<std::vector<Value>> contents;
+  for (int i = 0; i < 10; ++i) {
+    contents.push_back({Int64(i)});
+  }
+  table.SetContents(contents);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto scan_op,
+      EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0}, {"column0"}, {x},
+                                   /*and_filters=*/{}, /*read_time=*/nullptr));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto percent, ConstExpr::Create(Int64(100)));
+  scan_op->SetBlockSample(std::move(percent), /*seed=*/nullptr);
+  ZETASQL_ASSERT_OK(scan_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  // SimpleTable does not sample blocks, so the scan samples its rows.
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      scan_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, &context));
+  EXPECT_EQ(iter->DebugString(),
+            "BernoulliSampleTupleIterator("
+            "EvaluatorTableTupleIterator(TestTable))");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  EXPECT_EQ(data.size(), 10);
+  EXPECT_TRUE(context.IsDeterministicOutput());
+}
+
 TEST_F(CreateIteratorTest, EnumerateOp) {
   VariableId count("count");
   ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_count, DerefExpr::Create(count, Int64Type()));
@@ -3923,7 +5569,7 @@ TEST(TimeoutTest, ShortTimeout) {
       join_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, &context));
   EXPECT_THAT(
       ReadFromTupleIterator(iter.get()),
-      StatusIs(::zetasql_base::RESOURCE_EXHAUSTED,
+      StatusIs(::zetasql_base::DEADLINE_EXCEEDED,
                ContainsRegex("The statement has been aborted because the "
                              "statement deadline .+ was exceeded.")));
 }
@@ -0,0 +1,385 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/spill.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "zetasql/public/value.h"
+#include "zetasql/public/value.pb.h"
+#include "zetasql/reference_impl/evaluator_metrics.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+// Appends the bytes of 'value' to 'buffer'.
+template <typename T>
+void AppendRaw(T value, std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Reads a T from 'buffer' at '*pos' and advances '*pos'. Returns false if
+// there are not enough bytes.
+template <typename T>
+bool ReadRaw(const std::string& buffer, size_t* pos, T* value) {
+  if (buffer.size() - *pos < sizeof(T)) return false;
+  std::memcpy(value, buffer.data() + *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+}  // namespace
+
+bool ShouldSpill(const zetasql_base::Status& status,
+                 const EvaluationContext& context) {
+  return zetasql_base::IsResourceExhausted(status) &&
+         !context.options().spill_directory.empty();
+}
+
+// -------------------------------------------------------
+// TupleSpillFile
+// -------------------------------------------------------
+
+zetasql_base::StatusOr<std::unique_ptr<TupleSpillFile>> TupleSpillFile::Create(
+    EvaluationContext* context) {
+  const std::string& directory = context->options().spill_directory;
+  ZETASQL_RET_CHECK(!directory.empty());
+  std::string path = absl::StrCat(directory, "/zetasql_spill_XXXXXX");
+  const int fd = mkstemp(&path[0]);
+  if (fd < 0) {
+    return zetasql_base::ResourceExhaustedErrorBuilder()
+           << "Failed to create a spill file in " << directory << ": "
+           << std::strerror(errno);
+  }
+  // Nobody else needs to open the file, so unlink it right away. That way it
+  // cannot outlive this process.
+  unlink(path.c_str());
+  std::FILE* file = fdopen(fd, "w+b");
+  if (file == nullptr) {
+    close(fd);
+    return zetasql_base::ResourceExhaustedErrorBuilder()
+           << "Failed to open spill file " << path << ": "
+           << std::strerror(errno);
+  }
+  ++context->mutable_stats()->num_spill_files;
+  GetEvaluatorMetrics().spill_files.Increment();
+  return absl::WrapUnique(new TupleSpillFile(file, context));
+}
+
+TupleSpillFile::~TupleSpillFile() { std::fclose(file_); }
+
+zetasql_base::Status TupleSpillFile::IOError(const std::string& operation) const {
+  return zetasql_base::ResourceExhaustedErrorBuilder()
+         << "Failed to " << operation << " spill file in "
+         << context_->options().spill_directory << ": "
+         << std::strerror(errno);
+}
+
+zetasql_base::Status TupleSpillFile::Write(const TupleData& data) {
+  ZETASQL_RET_CHECK(writing_);
+  buffer_.clear();
+  AppendRaw<uint32_t>(0, &buffer_);  // Placeholder for the length.
+  AppendRaw<uint32_t>(data.num_slots(), &buffer_);
+  ValueProto value_proto;
+  std::string serialized_value;
+  for (const TupleSlot& slot : data.slots()) {
+    const Value& value = slot.value();
+    if (!value.is_valid()) {
+      AppendRaw<int32_t>(-1, &buffer_);
+      continue;
+    }
+    auto inserted = type_indexes_.emplace(value.type(), types_.size());
+    if (inserted.second) {
+      types_.push_back(value.type());
+    }
+    AppendRaw<int32_t>(inserted.first->second, &buffer_);
+
+    value_proto.Clear();
+    ZETASQL_RETURN_IF_ERROR(value.Serialize(&value_proto));
+    serialized_value.clear();
+    ZETASQL_RET_CHECK(value_proto.SerializeToString(&serialized_value));
+    AppendRaw<uint32_t>(serialized_value.size(), &buffer_);
+    buffer_.append(serialized_value);
+  }
+  const uint32_t length = buffer_.size() - sizeof(uint32_t);
+  std::memcpy(&buffer_[0], &length, sizeof(length));
+
+  if (std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+    return IOError("write to");
+  }
+  ++num_tuples_;
+  num_bytes_ += buffer_.size();
+  EvaluationStats* stats = context_->mutable_stats();
+  ++stats->num_spilled_tuples;
+  stats->num_spilled_bytes += buffer_.size();
+  EvaluatorMetrics& metrics = GetEvaluatorMetrics();
+  metrics.spilled_tuples.Increment();
+  metrics.spilled_bytes.Increment(buffer_.size());
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status TupleSpillFile::FinishWriting() {
+  ZETASQL_RET_CHECK(writing_);
+  writing_ = false;
+  if (std::fflush(file_) != 0) {
+    return IOError("flush");
+  }
+  if (std::fseek(file_, 0, SEEK_SET) != 0) {
+    return IOError("rewind");
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::StatusOr<bool> TupleSpillFile::Read(TupleData* data) {
+  ZETASQL_RET_CHECK(!writing_);
+  uint32_t length;
+  const size_t num_read = std::fread(&length, 1, sizeof(length), file_);
+  if (num_read == 0 && std::feof(file_)) {
+    return false;
+  }
+  if (num_read != sizeof(length)) {
+    return IOError("read from");
+  }
+  buffer_.resize(length);
+  if (std::fread(&buffer_[0], 1, length, file_) != length) {
+    return IOError("read from");
+  }
+
+  size_t pos = 0;
+  uint32_t num_slots;
+  ZETASQL_RET_CHECK(ReadRaw(buffer_, &pos, &num_slots));
+  data->Clear();
+  data->AddSlots(num_slots);
+  ValueProto value_proto;
+  for (int i = 0; i < num_slots; ++i) {
+    int32_t type_index;
+    ZETASQL_RET_CHECK(ReadRaw(buffer_, &pos, &type_index));
+    if (type_index < 0) continue;
+    ZETASQL_RET_CHECK_LT(type_index, types_.size());
+    uint32_t value_length;
+    ZETASQL_RET_CHECK(ReadRaw(buffer_, &pos, &value_length));
+    ZETASQL_RET_CHECK_LE(value_length, buffer_.size() - pos);
+    ZETASQL_RET_CHECK(value_proto.ParseFromArray(buffer_.data() + pos, value_length));
+    pos += value_length;
+    ZETASQL_ASSIGN_OR_RETURN(Value value,
+                     Value::Deserialize(value_proto, types_[type_index]));
+    data->mutable_slot(i)->SetValue(std::move(value));
+  }
+  ZETASQL_RET_CHECK_EQ(pos, buffer_.size());
+  return true;
+}
+
+zetasql_base::StatusOr<bool> TupleSpillFile::ReadAt(int64_t* offset,
+                                             TupleData* data) {
+  ZETASQL_RET_CHECK(!writing_);
+  if (std::fseek(file_, *offset, SEEK_SET) != 0) {
+    return IOError("seek in");
+  }
+  ZETASQL_ASSIGN_OR_RETURN(const bool found, Read(data));
+  if (found) {
+    const long next_offset = std::ftell(file_);  // NOLINT
+    if (next_offset < 0) {
+      return IOError("seek in");
+    }
+    *offset = next_offset;
+  }
+  return found;
+}
+
+// -------------------------------------------------------
+// TupleSpillFileIterator
+// -------------------------------------------------------
+
+TupleData* TupleSpillFileIterator::Next() {
+  const zetasql_base::StatusOr<bool> status_or_found = file_->Read(&current_);
+  if (!status_or_found.ok()) {
+    status_ = status_or_found.status();
+    return nullptr;
+  }
+  return status_or_found.ValueOrDie() ? &current_ : nullptr;
+}
+
+// -------------------------------------------------------
+// SpillableTupleSorter
+// -------------------------------------------------------
+
+bool SpillableTupleSorter::PushBack(std::unique_ptr<TupleData> data,
+                                    zetasql_base::Status* status) {
+  DCHECK(!finished_);
+  if (!tuples_.TryPushBack(&data, status)) {
+    if (!ShouldSpill(*status, *context_) || tuples_.IsEmpty()) {
+      return false;
+    }
+    *status = Spill();
+    if (!status->ok() || !tuples_.PushBack(std::move(data), status)) {
+      return false;
+    }
+  }
+  ++num_tuples_;
+  return true;
+}
+
+zetasql_base::Status SpillableTupleSorter::Spill() {
+  ZETASQL_RET_CHECK(!finished_);
+  if (tuples_.IsEmpty()) return zetasql_base::OkStatus();
+  tuples_.Sort(*comparator_, use_stable_sort_,
+               context_->options().num_threads);
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleSpillFile> run,
+                   TupleSpillFile::Create(context_));
+  while (!tuples_.IsEmpty()) {
+    ZETASQL_RETURN_IF_ERROR(run->Write(*tuples_.PopFront()));
+  }
+  ZETASQL_RETURN_IF_ERROR(run->FinishWriting());
+  runs_.push_back(std::move(run));
+  return zetasql_base::OkStatus();
+}
+
+bool SpillableTupleSorter::RunHeadGreater(int i, int j) const {
+  const TupleData& head_i = *run_heads_[i];
+  const TupleData& head_j = *run_heads_[j];
+  if ((*comparator_)(head_j, head_i)) return true;
+  if ((*comparator_)(head_i, head_j)) return false;
+  return i > j;
+}
+
+zetasql_base::Status SpillableTupleSorter::Finish() {
+  ZETASQL_RET_CHECK(!finished_);
+  if (!spilled()) {
+    finished_ = true;
+    tuples_.Sort(*comparator_, use_stable_sort_,
+                 context_->options().num_threads);
+    return zetasql_base::OkStatus();
+  }
+
+  // Spill the rest of the tuples too, so that their memory is available to
+  // the consumers of this object.
+  ZETASQL_RETURN_IF_ERROR(Spill());
+  finished_ = true;
+  run_heads_.resize(runs_.size());
+  for (int i = 0; i < runs_.size(); ++i) {
+    auto head = absl::make_unique<TupleData>();
+    ZETASQL_ASSIGN_OR_RETURN(const bool found, runs_[i]->Read(head.get()));
+    if (found) {
+      run_heads_[i] = std::move(head);
+      run_heap_.push_back(i);
+    }
+  }
+  std::make_heap(run_heap_.begin(), run_heap_.end(),
+                 [this](int i, int j) { return RunHeadGreater(i, j); });
+  return zetasql_base::OkStatus();
+}
+
+std::unique_ptr<TupleData> SpillableTupleSorter::PopFront(
+    zetasql_base::Status* status) {
+  DCHECK(finished_);
+  if (!spilled()) {
+    if (tuples_.IsEmpty()) return nullptr;
+    --num_tuples_;
+    return tuples_.PopFront();
+  }
+
+  if (run_heap_.empty()) return nullptr;
+  const auto greater = [this](int i, int j) { return RunHeadGreater(i, j); };
+  std::pop_heap(run_heap_.begin(), run_heap_.end(), greater);
+  const int run_idx = run_heap_.back();
+  std::unique_ptr<TupleData> next = std::move(run_heads_[run_idx]);
+
+  // Replace the head of the run.
+  auto head = absl::make_unique<TupleData>();
+  const zetasql_base::StatusOr<bool> status_or_found = runs_[run_idx]->Read(head.get());
+  if (!status_or_found.ok()) {
+    *status = status_or_found.status();
+    return nullptr;
+  }
+  if (status_or_found.ValueOrDie()) {
+    run_heads_[run_idx] = std::move(head);
+    std::push_heap(run_heap_.begin(), run_heap_.end(), greater);
+  } else {
+    run_heap_.pop_back();
+    runs_[run_idx].reset();
+  }
+  --num_tuples_;
+  return next;
+}
+
+// -------------------------------------------------------
+// SharedTupleBuffer
+// -------------------------------------------------------
+
+bool SharedTupleBuffer::PushBack(std::unique_ptr<TupleData> data,
+                                 zetasql_base::Status* status) {
+  DCHECK(!finished_);
+  if (file_ == nullptr) {
+    if (tuples_.TryPushBack(&data, status)) {
+      ++num_tuples_;
+      return true;
+    }
+    if (!ShouldSpill(*status, *context_)) return false;
+    // Move everything to disk so that the memory is available to the readers.
+    zetasql_base::StatusOr<std::unique_ptr<TupleSpillFile>> status_or_file =
+        TupleSpillFile::Create(context_);
+    if (!status_or_file.ok()) {
+      *status = status_or_file.status();
+      return false;
+    }
+    file_ = std::move(status_or_file).ValueOrDie();
+    while (!tuples_.IsEmpty()) {
+      *status = file_->Write(*tuples_.PopFront());
+      if (!status->ok()) return false;
+    }
+  }
+  *status = file_->Write(*data);
+  if (!status->ok()) return false;
+  ++num_tuples_;
+  return true;
+}
+
+zetasql_base::Status SharedTupleBuffer::Finish() {
+  ZETASQL_RET_CHECK(!finished_);
+  finished_ = true;
+  if (file_ != nullptr) {
+    return file_->FinishWriting();
+  }
+  tuple_ptrs_ = tuples_.GetTuplePtrs();
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::StatusOr<bool> SharedTupleBuffer::Read(Position* position,
+                                             TupleData* data) const {
+  ZETASQL_RET_CHECK(finished_);
+  if (file_ == nullptr) {
+    if (position->index >= tuple_ptrs_.size()) return false;
+    *data = *tuple_ptrs_[position->index];
+    ++position->index;
+    return true;
+  }
+  absl::MutexLock lock(&file_mutex_);
+  ZETASQL_ASSIGN_OR_RETURN(const bool found,
+                   file_->ReadAt(&position->file_offset, data));
+  if (found) ++position->index;
+  return found;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,277 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Support for operators that exceed EvaluationOptions::max_intermediate_byte_size
+// when EvaluationOptions::spill_directory is set. Such operators write some of
+// their tuples to TupleSpillFiles and process them later in pieces that fit in
+// memory:
+// - SortOp does an external merge sort with SpillableTupleSorter.
+// - AggregateOp hash partitions the input rows for groups that do not fit in
+//   memory into TupleSpillFiles and aggregates each partition separately. The
+//   output groups are sorted with SpillableTupleSorter.
+// - JoinOp does a grace hash join: if the right-hand side of a hash join does
+//   not fit in memory, both sides are hash partitioned into TupleSpillFiles
+//   and each pair of partitions is joined separately.
+// - WITH tables are materialized in SharedTupleBuffers, which move all their
+//   tuples to a TupleSpillFile once they no longer fit in memory.
+//
+// Spilled tuples are counted in EvaluationContext::stats().
+
+#ifndef ZETASQL_REFERENCE_IMPL_SPILL_H_
+#define ZETASQL_REFERENCE_IMPL_SPILL_H_
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/reference_impl/evaluation.h"
+#include "zetasql/reference_impl/tuple.h"
+#include "zetasql/reference_impl/tuple_comparator.h"
+#include <cstdint>
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// Returns true if an operator should react to 'status' (returned by a
+// MemoryAccountant) by spilling tuples to disk instead of failing.
+bool ShouldSpill(const zetasql_base::Status& status,
+                 const EvaluationContext& context);
+
+// Stores TupleDatas in an unnamed temporary file in
+// EvaluationOptions::spill_directory. The tuples are written with Write(), and
+// then read back in the same order with Read() after calling FinishWriting().
+// The file is unlinked as soon as it is created, so it goes away when this
+// object is destroyed (or the process dies).
+//
+// Values are serialized as ValueProtos. Their Types are kept in memory, so a
+// file can only be read back by the object that wrote it.
+class TupleSpillFile {
+ public:
+  static zetasql_base::StatusOr<std::unique_ptr<TupleSpillFile>> Create(
+      EvaluationContext* context);
+
+  TupleSpillFile(const TupleSpillFile&) = delete;
+  TupleSpillFile& operator=(const TupleSpillFile&) = delete;
+
+  ~TupleSpillFile();
+
+  // Appends 'data' to the file. Must not be called after FinishWriting().
+  zetasql_base::Status Write(const TupleData& data);
+
+  // Prepares the file for reading from the beginning.
+  zetasql_base::Status FinishWriting();
+
+  // Reads the next tuple into 'data'. Returns false if there are no more
+  // tuples. Requires that FinishWriting() has been called.
+  zetasql_base::StatusOr<bool> Read(TupleData* data);
+
+  // Same as Read(), but reads the tuple that starts at byte '*offset' and then
+  // advances '*offset' to the next tuple. Lets several readers share the file
+  // as long as calls are not concurrent.
+  zetasql_base::StatusOr<bool> ReadAt(int64_t* offset, TupleData* data);
+
+  // The number of tuples and bytes written to the file.
+  int64_t num_tuples() const { return num_tuples_; }
+  int64_t num_bytes() const { return num_bytes_; }
+
+ private:
+  TupleSpillFile(std::FILE* file, EvaluationContext* context)
+      : file_(file), context_(context) {}
+
+  // Returns an error describing a failed 'operation' on the file.
+  zetasql_base::Status IOError(const std::string& operation) const;
+
+  std::FILE* file_;
+  EvaluationContext* context_;
+  bool writing_ = true;
+  int64_t num_tuples_ = 0;
+  int64_t num_bytes_ = 0;
+  // The Types of the values in the file. Each value in the file refers to its
+  // Type by its index in 'types_'.
+  std::vector<const Type*> types_;
+  absl::flat_hash_map<const Type*, int> type_indexes_;
+  // Reused for serializing and deserializing tuples.
+  std::string buffer_;
+};
+
+// Returns the tuples in a TupleSpillFile (on which FinishWriting() has been
+// called) in the order they were written.
+class TupleSpillFileIterator : public TupleIterator {
+ public:
+  TupleSpillFileIterator(std::unique_ptr<const TupleSchema> schema,
+                         std::unique_ptr<TupleSpillFile> file)
+      : schema_(std::move(schema)), file_(std::move(file)) {}
+
+  TupleSpillFileIterator(const TupleSpillFileIterator&) = delete;
+  TupleSpillFileIterator& operator=(const TupleSpillFileIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return *schema_; }
+
+  TupleData* Next() override;
+
+  zetasql_base::Status Status() const override { return status_; }
+
+  std::string DebugString() const override { return "TupleSpillFileIterator"; }
+
+ private:
+  const std::unique_ptr<const TupleSchema> schema_;
+  const std::unique_ptr<TupleSpillFile> file_;
+  TupleData current_;
+  zetasql_base::Status status_;
+};
+
+// Sorts TupleDatas, spilling sorted runs to TupleSpillFiles if they do not all
+// fit in memory (and spilling is enabled). Tuples are added with PushBack().
+// After calling Finish(), they are removed in sorted order with PopFront(),
+// which merges the runs if there are any.
+class SpillableTupleSorter {
+ public:
+  // 'comparator' must outlive this object. If 'use_stable_sort' is true, the
+  // result is a stable sort, even if there are multiple runs.
+  SpillableTupleSorter(const TupleComparator* comparator, bool use_stable_sort,
+                       EvaluationContext* context)
+      : comparator_(comparator),
+        use_stable_sort_(use_stable_sort),
+        context_(context),
+        tuples_(context->memory_accountant()) {}
+
+  SpillableTupleSorter(const SpillableTupleSorter&) = delete;
+  SpillableTupleSorter& operator=(const SpillableTupleSorter&) = delete;
+
+  // Adds 'data'. Returns true on success. On failure, returns false and
+  // populates 'status'. If there is not enough memory for 'data' and spilling
+  // is enabled, first writes the tuples in memory to a new run. Must not be
+  // called after Finish().
+  bool PushBack(std::unique_ptr<TupleData> data, zetasql_base::Status* status);
+
+  // Writes the tuples in memory (if there are any) to a new run to free up
+  // memory for other uses. Requires that spilling is enabled. Must not be
+  // called after Finish().
+  zetasql_base::Status Spill();
+
+  // Sorts the tuples. Must be called exactly once, after the last call to
+  // PushBack() and before the first call to PopFront().
+  zetasql_base::Status Finish();
+
+  // Returns true if some tuples were written to disk.
+  bool spilled() const { return !runs_.empty(); }
+
+  bool IsEmpty() const { return GetSize() == 0; }
+
+  // Returns the number of tuples that have been added but not yet removed.
+  int64_t GetSize() const { return num_tuples_; }
+
+  // Returns the tuples in memory. If !spilled(), these are all the tuples (and
+  // they are sorted after Finish()).
+  TupleDataDeque* mutable_in_memory_tuples() { return &tuples_; }
+
+  // Removes and returns the first remaining tuple. Returns NULL if there are
+  // no more tuples or there is an error, in which case 'status' is populated.
+  // Requires that Finish() has been called.
+  std::unique_ptr<TupleData> PopFront(zetasql_base::Status* status);
+
+ private:
+  // Returns true if the head of run 'i' should come after the head of run 'j'.
+  // Ties are broken by run index so that the merge is stable.
+  bool RunHeadGreater(int i, int j) const;
+
+  const TupleComparator* comparator_;
+  const bool use_stable_sort_;
+  EvaluationContext* context_;
+  // Tuples that have not been spilled.
+  TupleDataDeque tuples_;
+  int64_t num_tuples_ = 0;
+  bool finished_ = false;
+
+  // Sorted runs in the order they were written. The first tuple of each run
+  // that has not been returned yet is in 'run_heads_', which is NULL for
+  // exhausted runs. These tuples are not counted by the MemoryAccountant.
+  std::vector<std::unique_ptr<TupleSpillFile>> runs_;
+  std::vector<std::unique_ptr<TupleData>> run_heads_;
+  // A heap of the indexes of the non-exhausted runs, ordered by
+  // RunHeadGreater().
+  std::vector<int> run_heap_;
+};
+
+// Stores the tuples of a relation that is materialized once and then read any
+// number of times, possibly concurrently (e.g., a WITH table). Tuples are
+// added with PushBack(). After calling Finish(), they are read in the order
+// they were added with Read(). The tuples are kept in memory as long as they
+// fit. Once they do not (and spilling is enabled), all of them are moved to a
+// TupleSpillFile, which then holds all the tuples added later as well.
+class SharedTupleBuffer {
+ public:
+  // The position of a reader. Starts at the first tuple.
+  struct Position {
+    int64_t index = 0;
+    int64_t file_offset = 0;
+  };
+
+  explicit SharedTupleBuffer(EvaluationContext* context)
+      : context_(context), tuples_(context->memory_accountant()) {}
+
+  SharedTupleBuffer(const SharedTupleBuffer&) = delete;
+  SharedTupleBuffer& operator=(const SharedTupleBuffer&) = delete;
+
+  // Adds 'data'. Returns true on success. On failure, returns false and
+  // populates 'status'. Must not be called after Finish().
+  bool PushBack(std::unique_ptr<TupleData> data, zetasql_base::Status* status);
+
+  // Must be called exactly once, after the last call to PushBack() and before
+  // the first call to Read().
+  zetasql_base::Status Finish();
+
+  // Returns true if the tuples were written to disk.
+  bool spilled() const { return file_ != nullptr; }
+
+  // Returns the number of tuples that have been added.
+  int64_t GetSize() const { return num_tuples_; }
+
+  // Whether the order in which the tuples were added is meaningful. Defaults
+  // to false.
+  bool preserves_order() const { return preserves_order_; }
+  void set_preserves_order(bool preserves_order) {
+    preserves_order_ = preserves_order;
+  }
+
+  // Copies the tuple at '*position' to 'data' and advances '*position'.
+  // Returns false if there are no more tuples. Thread-safe.
+  zetasql_base::StatusOr<bool> Read(Position* position, TupleData* data) const;
+
+ private:
+  EvaluationContext* context_;
+  bool finished_ = false;
+  bool preserves_order_ = false;
+  int64_t num_tuples_ = 0;
+  // The tuples, unless they have been spilled.
+  TupleDataDeque tuples_;
+  // Pointers to the elements of 'tuples_', populated by Finish().
+  std::vector<const TupleData*> tuple_ptrs_;
+  // The tuples if they have been spilled, in which case 'tuples_' is empty.
+  std::unique_ptr<TupleSpillFile> file_;
+  // Serializes reads from 'file_'.
+  mutable absl::Mutex file_mutex_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_SPILL_H_
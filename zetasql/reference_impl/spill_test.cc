@@ -0,0 +1,282 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/spill.h"
+
+#include <memory>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/reference_impl/evaluation.h"
+#include "zetasql/reference_impl/operator.h"
+#include "zetasql/reference_impl/tuple.h"
+#include "zetasql/reference_impl/tuple_test_util.h"
+#include "zetasql/testing/test_value.h"
+#include "zetasql/testing/using_test_value.cc"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+namespace zetasql {
+namespace {
+
+using testing::HasSubstr;
+using testing::IsNull;
+
+using zetasql_base::testing::StatusIs;
+
+EvaluationOptions GetSpillingEvaluationOptions(int64_t total_bytes) {
+  EvaluationOptions options;
+  options.max_intermediate_byte_size = total_bytes;
+  options.spill_directory = testing::TempDir();
+  return options;
+}
+
+TEST(TupleSpillFileTest, RoundTrip) {
+  EvaluationContext context(GetSpillingEvaluationOptions(/*total_bytes=*/1));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleSpillFile> file,
+                       TupleSpillFile::Create(&context));
+  const std::vector<TupleData> tuples = {
+      CreateTestTupleData({Int64(1), String("foo"), Int64Array({1, 2})}),
+      CreateTestTupleData({NullInt64(), String(""), Value::EmptyArray(
+                                                        Int64ArrayType())}),
+      TupleData(/*num_slots=*/2)};
+  for (const TupleData& tuple : tuples) {
+    ZETASQL_ASSERT_OK(file->Write(tuple));
+  }
+  ZETASQL_ASSERT_OK(file->FinishWriting());
+  EXPECT_EQ(file->num_tuples(), 3);
+  EXPECT_GT(file->num_bytes(), 0);
+
+  TupleData data;
+  for (const TupleData& tuple : tuples) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(const bool found, file->Read(&data));
+    ASSERT_TRUE(found);
+    ASSERT_EQ(data.num_slots(), tuple.num_slots());
+    for (int i = 0; i < tuple.num_slots(); ++i) {
+      EXPECT_EQ(data.slot(i).value().is_valid(),
+                tuple.slot(i).value().is_valid());
+      if (tuple.slot(i).value().is_valid()) {
+        EXPECT_EQ(data.slot(i).value(), tuple.slot(i).value());
+      }
+    }
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const bool found, file->Read(&data));
+  EXPECT_FALSE(found);
+
+  EXPECT_EQ(context.stats().num_spill_files, 1);
+  EXPECT_EQ(context.stats().num_spilled_tuples, 3);
+  EXPECT_EQ(context.stats().num_spilled_bytes, file->num_bytes());
+}
+
+TEST(TupleSpillFileTest, BadDirectory) {
+  EvaluationOptions options;
+  options.spill_directory = "/this/directory/does/not/exist";
+  EvaluationContext context(options);
+  EXPECT_THAT(TupleSpillFile::Create(&context),
+              StatusIs(zetasql_base::StatusCode::kResourceExhausted,
+                       HasSubstr("Failed to create a spill file")));
+}
+
+TEST(TupleSpillFileIteratorTest, Next) {
+  const VariableId x("x");
+  EvaluationContext context(GetSpillingEvaluationOptions(/*total_bytes=*/1));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleSpillFile> file,
+                       TupleSpillFile::Create(&context));
+  ZETASQL_ASSERT_OK(file->Write(CreateTestTupleData({Int64(1)})));
+  ZETASQL_ASSERT_OK(file->Write(CreateTestTupleData({Int64(2)})));
+  ZETASQL_ASSERT_OK(file->FinishWriting());
+
+  TupleSpillFileIterator iter(absl::make_unique<TupleSchema>(
+                                  std::vector<VariableId>{x}),
+                              std::move(file));
+  EXPECT_EQ(iter.DebugString(), "TupleSpillFileIterator");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(&iter));
+  ASSERT_EQ(data.size(), 2);
+  EXPECT_EQ(data[0].slot(0).value(), Int64(1));
+  EXPECT_EQ(data[1].slot(0).value(), Int64(2));
+}
+
+class SpillableTupleSorterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_key,
+                         DerefExpr::Create(VariableId("key"), Int64Type()));
+    key_ = absl::make_unique<KeyArg>(VariableId("key"), std::move(deref_key),
+                                     KeyArg::kAscending);
+  }
+
+  // Returns 1000 tuples with keys 9, 8, ..., 0, 9, 8, ... in the first slot
+  // and their indexes in the second slot.
+  static std::vector<TupleData> CreateInput() {
+    std::vector<TupleData> tuples;
+    for (int i = 0; i < 1000; ++i) {
+      tuples.push_back(CreateTestTupleData({Int64(9 - i % 10), Int64(i)}));
+    }
+    return tuples;
+  }
+
+  std::unique_ptr<KeyArg> key_;
+};
+
+TEST_F(SpillableTupleSorterTest, InMemory) {
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleComparator> comparator,
+                       TupleComparator::Create({key_.get()}, {0},
+                                               /*params=*/{}, &context));
+  SpillableTupleSorter sorter(comparator.get(), /*use_stable_sort=*/true,
+                              &context);
+  zetasql_base::Status status;
+  for (const TupleData& tuple : CreateInput()) {
+    ASSERT_TRUE(
+        sorter.PushBack(absl::make_unique<TupleData>(tuple), &status));
+  }
+  ZETASQL_ASSERT_OK(sorter.Finish());
+  EXPECT_FALSE(sorter.spilled());
+  EXPECT_EQ(sorter.GetSize(), 1000);
+  EXPECT_EQ(sorter.mutable_in_memory_tuples()->GetSize(), 1000);
+  EXPECT_EQ(context.stats().num_spill_files, 0);
+}
+
+TEST_F(SpillableTupleSorterTest, Spills) {
+  EvaluationContext context(
+      GetSpillingEvaluationOptions(/*total_bytes=*/10000));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleComparator> comparator,
+                       TupleComparator::Create({key_.get()}, {0},
+                                               /*params=*/{}, &context));
+  SpillableTupleSorter sorter(comparator.get(), /*use_stable_sort=*/true,
+                              &context);
+  zetasql_base::Status status;
+  for (const TupleData& tuple : CreateInput()) {
+    ASSERT_TRUE(sorter.PushBack(absl::make_unique<TupleData>(tuple), &status))
+        << status;
+  }
+  ZETASQL_ASSERT_OK(sorter.Finish());
+  EXPECT_TRUE(sorter.spilled());
+  EXPECT_GT(context.stats().num_spill_files, 1);
+  EXPECT_EQ(context.stats().num_spilled_tuples, 1000);
+  // Everything was spilled, so all the memory is available again.
+  EXPECT_EQ(context.memory_accountant()->remaining_bytes(), 10000);
+
+  // The merge is stable.
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(sorter.GetSize(), 1000 - i);
+    std::unique_ptr<TupleData> tuple = sorter.PopFront(&status);
+    ASSERT_TRUE(tuple != nullptr) << status;
+    EXPECT_EQ(tuple->slot(0).value(), Int64(i / 100));
+    EXPECT_EQ(tuple->slot(1).value(), Int64(9 - i / 100 + 10 * (i % 100)));
+  }
+  EXPECT_THAT(sorter.PopFront(&status), IsNull());
+  ZETASQL_EXPECT_OK(status);
+}
+
+TEST_F(SpillableTupleSorterTest, SpillingDisabled) {
+  EvaluationOptions options;
+  options.max_intermediate_byte_size = 10000;
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleComparator> comparator,
+                       TupleComparator::Create({key_.get()}, {0},
+                                               /*params=*/{}, &context));
+  SpillableTupleSorter sorter(comparator.get(), /*use_stable_sort=*/false,
+                              &context);
+  zetasql_base::Status status;
+  for (const TupleData& tuple : CreateInput()) {
+    if (!sorter.PushBack(absl::make_unique<TupleData>(tuple), &status)) break;
+  }
+  EXPECT_THAT(status, StatusIs(zetasql_base::StatusCode::kResourceExhausted,
+                               HasSubstr("Out of memory")));
+  EXPECT_FALSE(sorter.spilled());
+}
+
+// Adds 1000 tuples (i, "value<i>") to 'buffer' and finishes it.
+void FillSharedTupleBuffer(SharedTupleBuffer* buffer) {
+  zetasql_base::Status status;
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(buffer->PushBack(
+        absl::make_unique<TupleData>(CreateTestTupleData(
+            {Int64(i), String(absl::StrCat("value", i))})),
+        &status))
+        << status;
+  }
+  ZETASQL_ASSERT_OK(buffer->Finish());
+  EXPECT_EQ(buffer->GetSize(), 1000);
+}
+
+// Reads the tuples of 'buffer' with two interleaved readers.
+void ReadSharedTupleBuffer(const SharedTupleBuffer& buffer) {
+  SharedTupleBuffer::Position positions[2];
+  TupleData data;
+  for (int i = 0; i < 1000; ++i) {
+    for (SharedTupleBuffer::Position& position : positions) {
+      ZETASQL_ASSERT_OK_AND_ASSIGN(const bool found, buffer.Read(&position, &data));
+      ASSERT_TRUE(found);
+      ASSERT_EQ(data.num_slots(), 2);
+      EXPECT_EQ(data.slot(0).value(), Int64(i));
+      EXPECT_EQ(data.slot(1).value(), String(absl::StrCat("value", i)));
+    }
+  }
+  for (SharedTupleBuffer::Position& position : positions) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(const bool found, buffer.Read(&position, &data));
+    EXPECT_FALSE(found);
+  }
+}
+
+TEST(SharedTupleBufferTest, InMemory) {
+  EvaluationContext context((EvaluationOptions()));
+  SharedTupleBuffer buffer(&context);
+  FillSharedTupleBuffer(&buffer);
+  EXPECT_FALSE(buffer.spilled());
+  ReadSharedTupleBuffer(buffer);
+  EXPECT_EQ(context.stats().num_spill_files, 0);
+}
+
+TEST(SharedTupleBufferTest, Spills) {
+  EvaluationContext context(
+      GetSpillingEvaluationOptions(/*total_bytes=*/10000));
+  {
+    SharedTupleBuffer buffer(&context);
+    FillSharedTupleBuffer(&buffer);
+    EXPECT_TRUE(buffer.spilled());
+    // Everything was spilled, so all the memory is available again.
+    EXPECT_EQ(context.memory_accountant()->remaining_bytes(), 10000);
+    ReadSharedTupleBuffer(buffer);
+  }
+  EXPECT_EQ(context.stats().num_spill_files, 1);
+  EXPECT_EQ(context.stats().num_spilled_tuples, 1000);
+}
+
+TEST(SharedTupleBufferTest, SpillingDisabled) {
+  EvaluationOptions options;
+  options.max_intermediate_byte_size = 10000;
+  EvaluationContext context(options);
+  SharedTupleBuffer buffer(&context);
+  zetasql_base::Status status;
+  for (int i = 0; i < 1000; ++i) {
+    if (!buffer.PushBack(
+            absl::make_unique<TupleData>(CreateTestTupleData({Int64(i)})),
+            &status)) {
+      break;
+    }
+  }
+  EXPECT_THAT(status, StatusIs(zetasql_base::StatusCode::kResourceExhausted,
+                               HasSubstr("Out of memory")));
+  EXPECT_FALSE(buffer.spilled());
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -40,7 +40,7 @@ class TestRelationalOp : public RelationalOp {
     return zetasql_base::OkStatus();
   }
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> /*params*/, int num_extra_slots,
       EvaluationContext* context) const override {
     std::vector<TupleData> iter_values = values_;
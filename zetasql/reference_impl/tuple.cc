@@ -17,12 +17,17 @@
 #include "zetasql/reference_impl/tuple.h"
 
 #include <algorithm>
+#include <array>
+#include <numeric>
 
 #include "zetasql/base/logging.h"
 #include "zetasql/public/value.h"
+#include "zetasql/reference_impl/evaluator_metrics.h"
+#include "zetasql/reference_impl/parallel.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
 #include "zetasql/base/map_util.h"
 
 namespace zetasql {
@@ -125,22 +130,113 @@ Tuple ConcatTuples(const std::vector<Tuple>& tuples,
 // TupleDataDeque
 // -------------------------------------------------------
 
+MemoryAccountant::~MemoryAccountant() {
+  DCHECK_EQ(remaining_bytes_, total_num_bytes_);
+  DCHECK(shared_payloads_.empty());
+  GetEvaluatorMetrics().peak_tracked_bytes.Record(total_num_bytes_ -
+                                                  min_remaining_bytes_);
+}
+
+zetasql_base::Status MemoryAccountant::OutOfMemoryError(
+    int64_t num_bytes) const {
+  GetEvaluatorMetrics().out_of_memory_errors.Increment();
+  return zetasql_base::ResourceExhaustedErrorBuilder()
+         << "Out of memory: requested " << num_bytes << " bytes but only "
+         << remaining_bytes_ << " are available out of a total of "
+         << total_num_bytes_;
+}
+
+const void* MemoryAccountant::GetTrackedPayload(const TupleSlot& slot,
+                                                int64_t* byte_size) {
+  const Value& value = slot.value();
+  const void* payload = InternalValue::GetSharedPayload(value);
+  if (payload == nullptr) return nullptr;
+  *byte_size = value.physical_byte_size() - sizeof(Value);
+  return *byte_size >= kMinSharedPayloadByteSize ? payload : nullptr;
+}
+
+bool MemoryAccountant::RequestTupleBytes(const TupleData& data,
+                                         int64_t num_bytes,
+                                         zetasql_base::Status* status) {
+  // Compute the charge before updating 'shared_payloads_' so that nothing
+  // needs to be undone on failure.
+  const std::vector<TupleSlot>& slots = data.slots();
+  bool has_tracked_payload = false;
+  for (int i = 0; i < slots.size(); ++i) {
+    int64_t byte_size;
+    const void* payload = GetTrackedPayload(slots[i], &byte_size);
+    if (payload == nullptr) continue;
+    has_tracked_payload = true;
+    auto it = shared_payloads_.find(payload);
+    if (it != shared_payloads_.end()) {
+      num_bytes -= it->second.byte_size;
+      continue;
+    }
+    // Count representations that appear in several slots of 'data' once.
+    for (int j = 0; j < i; ++j) {
+      int64_t unused;
+      if (GetTrackedPayload(slots[j], &unused) == payload) {
+        num_bytes -= byte_size;
+        break;
+      }
+    }
+  }
+  if (!RequestBytes(num_bytes, status)) return false;
+  if (has_tracked_payload) {
+    for (const TupleSlot& slot : slots) {
+      int64_t byte_size;
+      const void* payload = GetTrackedPayload(slot, &byte_size);
+      if (payload == nullptr) continue;
+      SharedPayload& shared = shared_payloads_[payload];
+      if (shared.num_refs++ == 0) shared.byte_size = byte_size;
+    }
+  }
+  return true;
+}
+
+void MemoryAccountant::ReturnTupleBytes(const TupleData& data,
+                                        int64_t num_bytes) {
+  for (const TupleSlot& slot : data.slots()) {
+    int64_t byte_size;
+    const void* payload = GetTrackedPayload(slot, &byte_size);
+    if (payload == nullptr) continue;
+    auto it = shared_payloads_.find(payload);
+    DCHECK(it != shared_payloads_.end());
+    if (--it->second.num_refs > 0) {
+      // Another slot still holds the charge for the representation.
+      num_bytes -= it->second.byte_size;
+    } else {
+      shared_payloads_.erase(it);
+    }
+  }
+  ReturnBytes(num_bytes);
+}
+
 zetasql_base::Status TupleDataDeque::SetSlot(int slot_idx, std::vector<Value> values) {
   ZETASQL_RET_CHECK_EQ(values.size(), datas_.size());
   zetasql_base::Status status;
   int64_t i = 0;
   for (Entry& entry : datas_) {
-    int64_t& byte_size = entry.first;
-    TupleData* tuple = entry.second.get();
+    int64_t& byte_size = entry.byte_size;
+    TupleData* tuple = &entry.data;
 
+    accountant_->ReturnTupleBytes(*tuple, byte_size);
     TupleSlot* slot = tuple->mutable_slot(slot_idx);
     const int64_t old_slot_size = slot->GetPhysicalByteSize();
+    Value old_value = slot->value();
     slot->SetValue(std::move(values[i]));
     const int64_t new_slot_size = slot->GetPhysicalByteSize();
 
-    accountant_->ReturnBytes(byte_size);
     byte_size += (new_slot_size - old_slot_size);
-    if (!accountant_->RequestBytes(byte_size, &status)) {
+    if (!accountant_->RequestTupleBytes(*tuple, byte_size, &status)) {
+      // Restore the old value so that the entry is charged consistently when
+      // it is dropped.
+      slot->SetValue(std::move(old_value));
+      byte_size += (slot->GetPhysicalByteSize() - new_slot_size);
+      zetasql_base::Status restore_status;
+      if (!accountant_->RequestTupleBytes(*tuple, byte_size, &restore_status)) {
+        ZETASQL_RET_CHECK_FAIL() << restore_status;
+      }
       return status;
     }
 
@@ -149,11 +245,232 @@ zetasql_base::Status TupleDataDeque::SetSlot(int slot_idx, std::vector<Value> va
   return zetasql_base::OkStatus();
 }
 
+namespace {
+
+// Ranges of tuples smaller than this are sorted by comparing their normalized
+// keys instead of distributing them into buckets.
+constexpr int64_t kMinRadixSortSize = 64;
+// The number of bytes of the normalized keys that are distributed into
+// buckets, which bounds the recursion of MsdRadixSort().
+constexpr size_t kMaxRadixSortDepth = 128;
+// The minimum number of tuples per thread for a parallel sort. Below this, the
+// overhead of starting threads and merging dominates.
+constexpr int64_t kMinParallelSortSize = 4096;
+
+// Stably sorts 'order[begin, end)', which are indexes into 'keys' whose first
+// 'depth' bytes are equal, by 'keys'. 'buffer' has the size of 'order'.
+void MsdRadixSort(const std::vector<std::string>& keys, int64_t begin,
+                  int64_t end, size_t depth, std::vector<int64_t>* order,
+                  std::vector<int64_t>* buffer) {
+  if (end - begin < kMinRadixSortSize || depth >= kMaxRadixSortDepth) {
+    std::stable_sort(order->begin() + begin, order->begin() + end,
+                     [&keys, depth](int64_t i, int64_t j) {
+                       return absl::string_view(keys[i]).substr(depth) <
+                              absl::string_view(keys[j]).substr(depth);
+                     });
+    return;
+  }
+
+  // Bucket 0 holds the keys with exactly 'depth' bytes, and bucket c + 1 the
+  // keys whose next byte is c. 'bucket_starts[b + 1]' first counts the keys of
+  // bucket b, then 'bucket_starts[b]' becomes the index of the first key of
+  // bucket b and is incremented as keys are placed in it.
+  constexpr int kNumBuckets = 257;
+  auto bucket = [&keys, depth](int64_t i) {
+    const std::string& key = keys[i];
+    return depth < key.size() ? static_cast<uint8_t>(key[depth]) + 1 : 0;
+  };
+  std::array<int64_t, kNumBuckets + 1> bucket_starts{};
+  for (int64_t i = begin; i < end; ++i) {
+    ++bucket_starts[bucket((*order)[i]) + 1];
+  }
+  bucket_starts[0] = begin;
+  std::partial_sum(bucket_starts.begin(), bucket_starts.end(),
+                   bucket_starts.begin());
+  // Bucket b is [bucket_bounds[b], bucket_bounds[b + 1]).
+  const std::array<int64_t, kNumBuckets + 1> bucket_bounds = bucket_starts;
+  for (int64_t i = begin; i < end; ++i) {
+    const int64_t idx = (*order)[i];
+    (*buffer)[bucket_starts[bucket(idx)]++] = idx;
+  }
+  std::copy(buffer->begin() + begin, buffer->begin() + end,
+            order->begin() + begin);
+
+  // The keys in bucket 0 are all equal.
+  for (int b = 1; b < kNumBuckets; ++b) {
+    const int64_t bucket_begin = bucket_bounds[b];
+    const int64_t bucket_end = bucket_bounds[b + 1];
+    if (bucket_end - bucket_begin > 1) {
+      MsdRadixSort(keys, bucket_begin, bucket_end, depth + 1, order, buffer);
+    }
+  }
+}
+
+// Returns the number of elements of 'a' among the first 'k' elements of the
+// stable merge of the sorted ranges 'a' and 'b', which takes the elements of
+// 'a' first among equal ones.
+template <typename Less>
+int64_t MergeCoRank(int64_t k, absl::Span<const int64_t> a,
+                    absl::Span<const int64_t> b, const Less& less) {
+  int64_t lo = std::max<int64_t>(0, k - static_cast<int64_t>(b.size()));
+  int64_t hi = std::min<int64_t>(k, a.size());
+  while (lo < hi) {
+    const int64_t i = lo + (hi - lo) / 2;
+    const int64_t j = k - i;
+    if (j > 0 && i < a.size() && !less(b[j - 1], a[i])) {
+      lo = i + 1;
+    } else {
+      hi = i;
+    }
+  }
+  return lo;
+}
+
+// Sorts 'order' on up to 'num_threads' threads. 'sort_range(begin, end)'
+// sorts 'order[begin, end)' by 'less'. Each thread sorts one chunk of 'order',
+// and the sorted chunks are merged pairwise until one remains. Every merge is
+// split into pieces of its output that are merged in parallel, so that all the
+// threads are busy until the end. The merges are stable.
+template <typename Less, typename SortRange>
+void ParallelSortIndexes(int num_threads, const Less& less,
+                         const SortRange& sort_range,
+                         std::vector<int64_t>* order) {
+  const int64_t size = order->size();
+  // Run r is [bounds[r], bounds[r + 1]).
+  std::vector<int64_t> bounds;
+  const int64_t chunk_size = (size + num_threads - 1) / num_threads;
+  for (int64_t begin = 0; begin < size; begin += chunk_size) {
+    bounds.push_back(begin);
+  }
+  bounds.push_back(size);
+  ParallelFor(num_threads, bounds.size() - 1, [&](int64_t run) {
+    sort_range(bounds[run], bounds[run + 1]);
+  });
+
+  std::vector<int64_t> buffer(size);
+  std::vector<int64_t>* from = order;
+  std::vector<int64_t>* to = &buffer;
+  while (bounds.size() > 2) {
+    const int64_t num_runs = bounds.size() - 1;
+    // An odd run out is merged with an empty one, i.e., copied.
+    const int64_t num_merges = (num_runs + 1) / 2;
+    const int64_t pieces_per_merge =
+        std::max<int64_t>(1, (num_threads + num_merges - 1) / num_merges);
+    ParallelFor(
+        num_threads, num_merges * pieces_per_merge, [&](int64_t shard) {
+          const int64_t run = shard / pieces_per_merge * 2;
+          const int64_t piece = shard % pieces_per_merge;
+          const int64_t a_begin = bounds[run];
+          const int64_t b_begin = bounds[run + 1];
+          const int64_t b_end = run + 2 < bounds.size() ? bounds[run + 2]
+                                                        : b_begin;
+          const absl::Span<const int64_t> a(from->data() + a_begin,
+                                            b_begin - a_begin);
+          const absl::Span<const int64_t> b(from->data() + b_begin,
+                                            b_end - b_begin);
+          const int64_t merge_size = b_end - a_begin;
+          const int64_t k_begin = merge_size * piece / pieces_per_merge;
+          const int64_t k_end = merge_size * (piece + 1) / pieces_per_merge;
+          const int64_t i_begin = MergeCoRank(k_begin, a, b, less);
+          const int64_t i_end = MergeCoRank(k_end, a, b, less);
+          std::merge(a.begin() + i_begin, a.begin() + i_end,
+                     b.begin() + (k_begin - i_begin),
+                     b.begin() + (k_end - i_end),
+                     to->begin() + a_begin + k_begin, less);
+        });
+    std::vector<int64_t> merged_bounds;
+    for (int64_t run = 0; run < num_runs; run += 2) {
+      merged_bounds.push_back(bounds[run]);
+    }
+    merged_bounds.push_back(size);
+    bounds.swap(merged_bounds);
+    std::swap(from, to);
+  }
+  if (from != order) order->swap(*from);
+}
+
+}  // namespace
+
+void TupleDataDeque::Permute(const std::vector<int64_t>& order) {
+  std::deque<Entry> sorted_datas;
+  for (const int64_t idx : order) {
+    sorted_datas.push_back(std::move(datas_[idx]));
+  }
+  datas_.swap(sorted_datas);
+}
+
+void TupleDataDeque::RadixSort(const TupleComparator& comparator) {
+  std::vector<std::string> keys(datas_.size());
+  for (int64_t i = 0; i < datas_.size(); ++i) {
+    comparator.AppendNormalizedKey(datas_[i].data, &keys[i]);
+  }
+  std::vector<int64_t> order(datas_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<int64_t> buffer(datas_.size());
+  MsdRadixSort(keys, /*begin=*/0, /*end=*/order.size(), /*depth=*/0, &order,
+               &buffer);
+  Permute(order);
+}
+
+void TupleDataDeque::ParallelSort(const TupleComparator& comparator,
+                                  bool use_radix_sort, bool use_stable_sort,
+                                  int num_threads) {
+  std::vector<int64_t> order(datas_.size());
+  std::iota(order.begin(), order.end(), 0);
+  if (use_radix_sort) {
+    std::vector<std::string> keys(datas_.size());
+    ParallelForRanges(num_threads, keys.size(), kMinParallelSortSize,
+                      [this, &comparator, &keys](int64_t begin, int64_t end) {
+                        for (int64_t i = begin; i < end; ++i) {
+                          comparator.AppendNormalizedKey(datas_[i].data,
+                                                         &keys[i]);
+                        }
+                      });
+    // MsdRadixSort() only uses the part of 'buffer' for its range.
+    std::vector<int64_t> buffer(datas_.size());
+    ParallelSortIndexes(
+        num_threads,
+        [&keys](int64_t i, int64_t j) { return keys[i] < keys[j]; },
+        [&keys, &order, &buffer](int64_t begin, int64_t end) {
+          MsdRadixSort(keys, begin, end, /*depth=*/0, &order, &buffer);
+        },
+        &order);
+  } else {
+    const auto less = [this, &comparator](int64_t i, int64_t j) {
+      return comparator(datas_[i].data, datas_[j].data);
+    };
+    ParallelSortIndexes(
+        num_threads, less,
+        [&less, &order, use_stable_sort](int64_t begin, int64_t end) {
+          if (use_stable_sort) {
+            std::stable_sort(order.begin() + begin, order.begin() + end, less);
+          } else {
+            std::sort(order.begin() + begin, order.begin() + end, less);
+          }
+        },
+        &order);
+  }
+  Permute(order);
+}
+
 void TupleDataDeque::Sort(const TupleComparator& comparator,
-                          bool use_stable_sort) {
+                          bool use_stable_sort, int num_threads) {
+  const bool use_radix_sort =
+      comparator.HasNormalizedKeys() &&
+      (datas_.size() >= kMinRadixSortSize || comparator.HasCollations());
+  if (num_threads > 1 && datas_.size() >= 2 * kMinParallelSortSize) {
+    ParallelSort(comparator, use_radix_sort, use_stable_sort,
+                 std::min<int64_t>(num_threads,
+                                   datas_.size() / kMinParallelSortSize));
+    return;
+  }
+  if (use_radix_sort) {
+    RadixSort(comparator);
+    return;
+  }
   auto entry_comparator = [&comparator](const Entry& entry1,
                                         const Entry& entry2) {
-    return comparator(entry1.second, entry2.second);
+    return comparator(entry1.data, entry2.data);
   };
   if (use_stable_sort) {
     std::stable_sort(datas_.begin(), datas_.end(), entry_comparator);
@@ -162,6 +479,93 @@ void TupleDataDeque::Sort(const TupleComparator& comparator,
   }
 }
 
+// -------------------------------------------------------
+// TypedValueHasher
+// -------------------------------------------------------
+
+TypedValueHasher::TypedValueHasher(const Type* type)
+    : type_(type), kind_(type->kind()) {
+  if (type->IsStruct()) {
+    for (const StructType::StructField& field : type->AsStruct()->fields()) {
+      children_.emplace_back(field.type);
+    }
+  } else if (type->IsArray()) {
+    children_.emplace_back(type->AsArray()->element_type());
+  }
+}
+
+bool TypedValueHasher::Equals(const Value& v1, const Value& v2) const {
+  if (!HasExpectedType(v1) || !HasExpectedType(v2)) return v1 == v2;
+  if (v1.is_null() || v2.is_null()) return v1.is_null() == v2.is_null();
+  switch (kind_) {
+    case TYPE_INT32:
+      return v1.int32_value() == v2.int32_value();
+    case TYPE_INT64:
+      return v1.int64_value() == v2.int64_value();
+    case TYPE_UINT32:
+      return v1.uint32_value() == v2.uint32_value();
+    case TYPE_UINT64:
+      return v1.uint64_value() == v2.uint64_value();
+    case TYPE_BOOL:
+      return v1.bool_value() == v2.bool_value();
+    case TYPE_DATE:
+      return v1.date_value() == v2.date_value();
+    case TYPE_ENUM:
+      return v1.enum_value() == v2.enum_value();
+    case TYPE_STRING:
+      return v1.string_view_value() == v2.string_view_value();
+    case TYPE_BYTES:
+      return v1.bytes_view_value() == v2.bytes_view_value();
+    case TYPE_STRUCT:
+      for (int i = 0; i < children_.size(); ++i) {
+        if (!children_[i].Equals(v1.field(i), v2.field(i))) return false;
+      }
+      return true;
+    default:
+      return v1 == v2;
+  }
+}
+
+// -------------------------------------------------------
+// TupleHasher
+// -------------------------------------------------------
+
+TupleHasher::TupleHasher(absl::Span<const Type* const> slot_types) {
+  slot_hashers_.reserve(slot_types.size());
+  for (const Type* type : slot_types) {
+    slot_hashers_.emplace_back(type);
+  }
+}
+
+bool TupleHasher::Equals(const TupleData& d1, const TupleData& d2) const {
+  DCHECK_EQ(d1.num_slots(), slot_hashers_.size());
+  DCHECK_EQ(d2.num_slots(), slot_hashers_.size());
+  for (int i = 0; i < slot_hashers_.size(); ++i) {
+    if (!slot_hashers_[i].Equals(d1.slot(i).value(), d2.slot(i).value())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// -------------------------------------------------------
+// TupleIterator
+// -------------------------------------------------------
+
+bool TupleIterator::NextBatch(TupleBatch* batch) {
+  batch->Clear();
+  while (!next_returned_null_ && !batch->IsFull()) {
+    const TupleData* data = Next();
+    if (data == nullptr) {
+      next_returned_null_ = true;
+      if (!Status().ok()) return false;
+      break;
+    }
+    *batch->AppendRow() = *data;
+  }
+  return !batch->IsEmpty();
+}
+
 // -------------------------------------------------------
 // ReorderingTupleIterator
 // -------------------------------------------------------
@@ -217,4 +621,19 @@ TupleData* ReorderingTupleIterator::Next() {
   return &current_batch_[index];
 }
 
+// -------------------------------------------------------
+// BatchedTupleIterator
+// -------------------------------------------------------
+
+TupleData* BatchedTupleIterator::Next() {
+  if (next_row_in_batch_ == batch_.size()) {
+    if (done_ || !iter_->NextBatch(&batch_)) {
+      done_ = true;
+      return nullptr;
+    }
+    next_row_in_batch_ = 0;
+  }
+  return batch_.mutable_row(next_row_in_batch_++);
+}
+
 }  // namespace zetasql
@@ -21,6 +21,8 @@
 
 #include <stddef.h>
 
+#include <algorithm>
+#include <deque>
 #include <iterator>
 #include <map>
 #include <memory>
@@ -37,6 +39,7 @@
 #include <cstdint>
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
@@ -122,9 +125,28 @@ class ProtoFieldRegistry {
   int RegisterField(const ProtoFieldAccessInfo* access_info) {
     const int index = registered_access_infos_.size();
     registered_access_infos_.push_back(access_info);
+    is_eager_field_.push_back(false);
     return index;
   }
 
+  // Marks the field at 'index' (as returned by RegisterField()) as one that is
+  // read eagerly, e.g., because a filter predicate reads it. Once a field is
+  // marked, the fields of this registry that are not marked are deferred: they
+  // are read separately, the first time one of them is accessed, so that they
+  // are never read for the rows that the filter rejects.
+  void MarkEagerField(int index) {
+    is_eager_field_[index] = true;
+    has_eager_fields_ = true;
+  }
+
+  // Returns true if the field at 'index' is read separately from the eager
+  // fields.
+  bool IsDeferredField(int index) const {
+    return has_eager_fields_ && !is_eager_field_[index];
+  }
+
+  bool has_eager_fields() const { return has_eager_fields_; }
+
   const std::vector<const ProtoFieldAccessInfo*>& GetRegisteredFields() const {
     return registered_access_infos_;
   }
@@ -136,6 +158,10 @@ class ProtoFieldRegistry {
 
   // This is the set of fields that GetProtoFieldExprs care about. Not owned.
   std::vector<const ProtoFieldAccessInfo*> registered_access_infos_;
+
+  // Parallel to 'registered_access_infos_'. See MarkEagerField().
+  std::vector<bool> is_eager_field_;
+  bool has_eager_fields_ = false;
 };
 
 // Key type for ProtoFieldValueMap (defined below). An entry in that map
@@ -143,17 +169,24 @@ class ProtoFieldRegistry {
 // (representing by a pointer to its internally reference-counted data) and
 // ProtoFieldRegistry. (A subfield access a.b.c involves two
 // ProtoFieldValueMapKeys: one for a.b and another for (a.b).c.)
+//
+// If the registry has deferred fields (see
+// ProtoFieldRegistry::MarkEagerField()), the values of its eager fields and
+// the values of its deferred fields are in two different entries, the latter
+// with 'deferred' set to true.
 struct ProtoFieldValueMapKey {
   const InternalValue::ProtoRep* proto_rep = nullptr;
   const ProtoFieldRegistry* registry = nullptr;
+  bool deferred = false;
 
   bool operator==(const ProtoFieldValueMapKey& k) const {
-    return proto_rep == k.proto_rep && registry == k.registry;
+    return proto_rep == k.proto_rep && registry == k.registry &&
+           deferred == k.deferred;
   }
 
   template <typename H>
   friend H AbslHashValue(H h, const ProtoFieldValueMapKey& k) {
-    return H::combine(std::move(h), k.proto_rep, k.registry);
+    return H::combine(std::move(h), k.proto_rep, k.registry, k.deferred);
   }
 };
 
@@ -385,7 +418,7 @@ class VirtualTupleSlot {
   void SetValueAndMaybeSharedProtoState(
       Value&& value,
       std::shared_ptr<TupleSlot::SharedProtoState>* shared_proto_state) {
-    *value_ = value;
+    *value_ = std::move(value);
     MaybeUpdateSharedProtoStateAfterSettingValue(shared_proto_state);
   }
 
@@ -406,7 +439,7 @@ class VirtualTupleSlot {
   // Move 'value' into this object. If we should be storing SharedProtoState for
   // 'value', initializes it.
   void SetValue(Value&& value) {
-    *value_ = value;
+    *value_ = std::move(value);
     MaybeResetSharedProtoState();
   }
 
@@ -595,11 +628,15 @@ class MemoryAccountant {
   // Constructs a MemoryAccountant that can allocate at most 'total_num_bytes'
   // at once.
   explicit MemoryAccountant(int64_t total_num_bytes)
-      : total_num_bytes_(total_num_bytes), remaining_bytes_(total_num_bytes) {}
+      : total_num_bytes_(total_num_bytes),
+        remaining_bytes_(total_num_bytes),
+        min_remaining_bytes_(total_num_bytes) {}
 
   MemoryAccountant(const MemoryAccountant&) = delete;
   MemoryAccountant& operator=(const MemoryAccountant&) = delete;
-  ~MemoryAccountant() { DCHECK_EQ(remaining_bytes_, total_num_bytes_); }
+  // Records the peak number of allocated bytes in the RuntimeMetrics of the
+  // evaluator.
+  ~MemoryAccountant();
 
   // If there are 'num_bytes' available, updates the number of remaining bytes
   // accordingly and returns true. Else returns false and populates
@@ -607,13 +644,13 @@ class MemoryAccountant {
   bool RequestBytes(int64_t num_bytes, zetasql_base::Status* status) {
     DCHECK_GE(num_bytes, 0);
     if (num_bytes > remaining_bytes_) {
-      *status = zetasql_base::ResourceExhaustedErrorBuilder()
-                << "Out of memory: requested " << num_bytes
-                << " bytes but only " << remaining_bytes_
-                << " are available out of a total of " << total_num_bytes_;
+      *status = OutOfMemoryError(num_bytes);
       return false;
     }
     remaining_bytes_ -= num_bytes;
+    if (remaining_bytes_ < min_remaining_bytes_) {
+      min_remaining_bytes_ = remaining_bytes_;
+    }
     return true;
   }
 
@@ -624,15 +661,62 @@ class MemoryAccountant {
     DCHECK_LE(remaining_bytes_, total_num_bytes_);
   }
 
+  // Same as RequestBytes(), for 'num_bytes' that include
+  // data.GetPhysicalByteSize(). Slot values whose representation is at least
+  // kMinSharedPayloadByteSize bytes and is shared with a tuple that is
+  // already charged through this method (e.g., an array that is copied into
+  // many rows) are only charged for once. 'data' must be returned with
+  // ReturnTupleBytes() while it still holds the same slot values, which
+  // also keep the shared representations alive until then.
+  bool RequestTupleBytes(const TupleData& data, int64_t num_bytes,
+                         zetasql_base::Status* status);
+
+  // Returns the bytes requested by RequestTupleBytes(data, num_bytes).
+  void ReturnTupleBytes(const TupleData& data, int64_t num_bytes);
+
+  int64_t total_num_bytes() const { return total_num_bytes_; }
   int64_t remaining_bytes() const { return remaining_bytes_; }
 
+  // Smaller representations are charged to every tuple that refers to them,
+  // which saves looking them up.
+  static constexpr int64_t kMinSharedPayloadByteSize = 256;
+
  private:
+  // A representation that is shared by the slots of tuples charged through
+  // RequestTupleBytes().
+  struct SharedPayload {
+    // The number of such slots.
+    int64_t num_refs = 0;
+    // The bytes charged for the representation along with its first slot.
+    int64_t byte_size = 0;
+  };
+
+  // Returns the representation of the value in 'slot' if it is large enough
+  // to be tracked in 'shared_payloads_', and sets 'byte_size' to its size.
+  // Otherwise returns nullptr.
+  static const void* GetTrackedPayload(const TupleSlot& slot,
+                                       int64_t* byte_size);
+
+  // Returns the error of RequestBytes(num_bytes), and counts it in the
+  // RuntimeMetrics of the evaluator.
+  zetasql_base::Status OutOfMemoryError(int64_t num_bytes) const;
+
   const int64_t total_num_bytes_;
   int64_t remaining_bytes_;
+  // The smallest value of 'remaining_bytes_' so far.
+  int64_t min_remaining_bytes_;
+
+  absl::flat_hash_map<const void*, SharedPayload> shared_payloads_;
 };
 
 // Holds a deque of TupleDatas whose memory usage is tracked by a
-// MemoryAccountant, which is not owned by this object.
+// MemoryAccountant, which is not owned by this object. The TupleDatas are
+// stored inline in the blocks of a std::deque rather than each in its own heap
+// allocation, so a buffered row costs a single allocation (for its slots) and
+// rows that are pushed back together are adjacent in memory. Pointers to the
+// TupleDatas remain valid until they are popped or the deque is sorted. Large
+// values shared between the TupleDatas are only charged for once (see
+// MemoryAccountant::RequestTupleBytes()).
 class TupleDataDeque {
  public:
   explicit TupleDataDeque(MemoryAccountant* accountant)
@@ -652,26 +736,47 @@ class TupleDataDeque {
   // this object are unaccounted for. This method does not return zetasql_base::Status
   // for performance reasons.
   bool PushBack(std::unique_ptr<TupleData> data, zetasql_base::Status* status) {
-    const int64_t byte_size = data->GetPhysicalByteSize() + sizeof(Entry);
-    if (!accountant_->RequestBytes(byte_size, status)) {
+    return TryPushBack(&data, status);
+  }
+
+  // Same as above, but copies 'data' straight into the deque. Avoids the
+  // allocation of a std::unique_ptr<TupleData> for callers that would
+  // otherwise have to copy 'data' into one.
+  bool PushBackCopy(const TupleData& data, zetasql_base::Status* status) {
+    const int64_t byte_size = GetEntryByteSize(data);
+    if (!accountant_->RequestTupleBytes(data, byte_size, status)) {
+      return false;
+    }
+    datas_.emplace_back(byte_size, data);
+    return true;
+  }
+
+  // Same as PushBack(), except that '*data' is only moved into the deque on
+  // success. This allows the caller to free up memory (e.g., by spilling to
+  // disk) and try again.
+  bool TryPushBack(std::unique_ptr<TupleData>* data, zetasql_base::Status* status) {
+    const int64_t byte_size = GetEntryByteSize(**data);
+    if (!accountant_->RequestTupleBytes(**data, byte_size, status)) {
       return false;
     }
-    datas_.emplace_back(byte_size, std::move(data));
+    datas_.emplace_back(byte_size, std::move(**data));
+    data->reset();
     return true;
   }
 
   // Removes the front entry of the deque, which must be non-empty.
   std::unique_ptr<TupleData> PopFront() {
-    Entry entry = std::move(datas_.front());
+    Entry& front = datas_.front();
+    accountant_->ReturnTupleBytes(front.data, front.byte_size);
+    auto data = absl::make_unique<TupleData>(std::move(front.data));
     datas_.pop_front();
-    accountant_->ReturnBytes(entry.first);
-    return std::move(entry.second);
+    return data;
   }
 
   // Clears the deque.
   void Clear() {
     while (!IsEmpty()) {
-      PopFront();
+      DropFront();
     }
   }
 
@@ -680,7 +785,7 @@ class TupleDataDeque {
     std::vector<const TupleData*> ptrs;
     ptrs.reserve(datas_.size());
     for (const Entry& entry : datas_) {
-      ptrs.push_back(entry.second.get());
+      ptrs.push_back(&entry.data);
     }
     return ptrs;
   }
@@ -690,12 +795,49 @@ class TupleDataDeque {
   // into the appropriate slots. Also updates the memory accountant accordingly.
   zetasql_base::Status SetSlot(int slot_idx, std::vector<Value> values);
 
-  // Sorts the deque using std::sort or std::stable_sort.
-  void Sort(const TupleComparator& comparator, bool use_stable_sort);
+  // Sorts the deque using std::sort or std::stable_sort, or with a radix sort
+  // of normalized keys if 'comparator' has them and there are enough tuples
+  // or a collation makes comparing the tuples directly expensive. If
+  // 'num_threads' is greater than one and there are enough tuples, sorts
+  // chunks of the deque on up to 'num_threads' threads and merges them in
+  // parallel. The merge is stable, so a stable sort remains stable.
+  void Sort(const TupleComparator& comparator, bool use_stable_sort,
+            int num_threads = 1);
 
  private:
   // Stores a TupleData and its memory size.
-  using Entry = std::pair<int64_t, std::unique_ptr<TupleData>>;
+  struct Entry {
+    Entry(int64_t byte_size_in, TupleData data_in)
+        : byte_size(byte_size_in), data(std::move(data_in)) {}
+
+    int64_t byte_size;
+    TupleData data;
+  };
+
+  // Returns the number of bytes to reserve for an Entry holding 'data'. The
+  // TupleData itself is part of the Entry, so only its slots are counted
+  // separately.
+  static int64_t GetEntryByteSize(const TupleData& data) {
+    return data.GetPhysicalByteSize() - sizeof(TupleData) + sizeof(Entry);
+  }
+
+  // Sorts the deque with an MSD radix sort of the normalized keys of
+  // 'comparator', which is stable. The keys are only allocated for the
+  // duration of the sort and are not charged to the MemoryAccountant.
+  void RadixSort(const TupleComparator& comparator);
+
+  // Like Sort(), but on 'num_threads' threads.
+  void ParallelSort(const TupleComparator& comparator, bool use_radix_sort,
+                    bool use_stable_sort, int num_threads);
+
+  // Reorders the entries so that the i-th one is the 'order[i]'-th one.
+  void Permute(const std::vector<int64_t>& order);
+
+  void DropFront() {
+    const Entry& front = datas_.front();
+    accountant_->ReturnTupleBytes(front.data, front.byte_size);
+    datas_.pop_front();
+  }
 
   MemoryAccountant* accountant_;
 
@@ -731,7 +873,7 @@ class TupleDataOrderedQueue {
   bool Insert(std::unique_ptr<TupleData> data, zetasql_base::Status* status) {
     const int64_t byte_size = data->GetPhysicalByteSize() +
                             sizeof(std::pair<const TupleData*, ValueEntry>);
-    if (!accountant_->RequestBytes(byte_size, status)) {
+    if (!accountant_->RequestTupleBytes(*data, byte_size, status)) {
       return false;
     }
     TupleData* ptr = data.get();
@@ -744,7 +886,7 @@ class TupleDataOrderedQueue {
     auto iter = entries_.begin();
     ValueEntry value_entry = std::move(iter->second);
     entries_.erase(iter);
-    accountant_->ReturnBytes(value_entry.first);
+    accountant_->ReturnTupleBytes(*value_entry.second, value_entry.first);
     return std::move(value_entry.second);
   }
 
@@ -754,7 +896,7 @@ class TupleDataOrderedQueue {
     --iter;
     ValueEntry value_entry = std::move(iter->second);
     entries_.erase(iter);
-    accountant_->ReturnBytes(value_entry.first);
+    accountant_->ReturnTupleBytes(*value_entry.second, value_entry.first);
     return std::move(value_entry.second);
   }
 
@@ -777,11 +919,333 @@ class TupleDataOrderedQueue {
   std::multimap<const TupleData*, ValueEntry, Comparator> entries_;
 };
 
+// Keeps the 'max_size' smallest TupleDatas inserted so far according to a
+// TupleComparator, with memory tracked by a MemoryAccountant. Ties are broken by
+// insertion order, so the result is the same as stably sorting all the inserted
+// TupleDatas and keeping the first 'max_size' of them. Insertion takes
+// O(log(max_size)) time and the memory use is O(max_size), unlike
+// TupleDataOrderedQueue, which allocates a node for every TupleData.
+//
+// If 'keep_ties' is true, the TupleDatas that tie with the 'max_size'-th one
+// are kept as well, i.e., the ones whose RANK() would be at most 'max_size'.
+class TupleDataBoundedHeap {
+ public:
+  TupleDataBoundedHeap(const TupleComparator& comparator, int64_t max_size,
+                       MemoryAccountant* accountant, bool keep_ties = false)
+      : comparator_(comparator),
+        max_size_(max_size),
+        keep_ties_(keep_ties),
+        accountant_(accountant) {}
+
+  TupleDataBoundedHeap(const TupleDataBoundedHeap&) = delete;
+  TupleDataBoundedHeap& operator=(const TupleDataBoundedHeap&) = delete;
+
+  ~TupleDataBoundedHeap() { Clear(); }
+
+  bool IsEmpty() const { return entries_.empty(); }
+
+  int64_t GetSize() const { return entries_.size() + ties_.size(); }
+
+  // Returns true if Insert() would keep 'data'. Only the slots used by the
+  // comparator need to be populated, so callers can use this to avoid
+  // building TupleDatas that would be dropped right away.
+  bool WouldKeep(const TupleData& data) const {
+    if (entries_.size() < max_size_) return true;
+    if (max_size_ == 0) return false;
+    // Unless 'keep_ties_' is true, a TupleData that ties with the largest one
+    // is dropped because it was inserted later.
+    const TupleData& largest = *entries_.front().data;
+    return keep_ties_ ? !comparator_(largest, data)
+                      : comparator_(data, largest);
+  }
+
+  // Adds 'data' to the heap, dropping the largest TupleData if there are more
+  // than 'max_size' of them. Returns true on success. On failure, returns false
+  // and populates 'status'. Any modifications to 'data' while it is in this
+  // object are unaccounted for. This method does not return zetasql_base::Status
+  // for performance reasons.
+  bool Insert(std::unique_ptr<TupleData> data, zetasql_base::Status* status) {
+    if (!WouldKeep(*data)) return true;
+    if (entries_.size() < max_size_) {
+      return Push(std::move(data), status);
+    }
+    if (keep_ties_ && !comparator_(*data, *entries_.front().data)) {
+      // 'data' ties with the largest TupleData, which stays.
+      return Reserve(std::move(data), &ties_, status);
+    }
+    // Make room first to keep the peak memory usage down, unless the largest
+    // TupleData turns out to tie with the next largest one.
+    std::pop_heap(entries_.begin(), entries_.end(), EntryLess(comparator_));
+    Entry largest = std::move(entries_.back());
+    entries_.pop_back();
+    if (!keep_ties_) {
+      accountant_->ReturnTupleBytes(*largest.data, largest.byte_size);
+    }
+    if (!Push(std::move(data), status)) {
+      if (keep_ties_) {
+        accountant_->ReturnTupleBytes(*largest.data, largest.byte_size);
+      }
+      return false;
+    }
+    if (keep_ties_) {
+      if (!comparator_(*entries_.front().data, *largest.data)) {
+        ties_.push_back(std::move(largest));
+      } else {
+        // The ties were of 'largest', which no longer makes the cut.
+        accountant_->ReturnTupleBytes(*largest.data, largest.byte_size);
+        ReturnAll(&ties_);
+      }
+    }
+    return true;
+  }
+
+  // Removes all the TupleDatas from the heap and returns them in sorted order.
+  std::vector<std::unique_ptr<TupleData>> PopAllSorted() {
+    std::sort_heap(entries_.begin(), entries_.end(), EntryLess(comparator_));
+    // The ties all compare equal to the largest entry, and were inserted after
+    // the entries that they tie with.
+    std::sort(ties_.begin(), ties_.end(), [](const Entry& e1, const Entry& e2) {
+      return e1.sequence_number < e2.sequence_number;
+    });
+    std::vector<std::unique_ptr<TupleData>> datas;
+    datas.reserve(entries_.size() + ties_.size());
+    for (std::vector<Entry>* entries : {&entries_, &ties_}) {
+      for (Entry& entry : *entries) {
+        accountant_->ReturnTupleBytes(*entry.data, entry.byte_size);
+        datas.push_back(std::move(entry.data));
+      }
+      entries->clear();
+    }
+    return datas;
+  }
+
+  // Clears the heap.
+  void Clear() {
+    ReturnAll(&entries_);
+    ReturnAll(&ties_);
+  }
+
+ private:
+  struct Entry {
+    // Used to break ties.
+    int64_t sequence_number;
+    // The memory reservation of 'data' for 'accountant_'.
+    int64_t byte_size;
+    std::unique_ptr<TupleData> data;
+  };
+
+  class EntryLess {
+   public:
+    explicit EntryLess(const TupleComparator& comparator)
+        : comparator_(comparator) {}
+
+    bool operator()(const Entry& e1, const Entry& e2) const {
+      if (comparator_(*e1.data, *e2.data)) return true;
+      if (comparator_(*e2.data, *e1.data)) return false;
+      return e1.sequence_number < e2.sequence_number;
+    }
+
+   private:
+    const TupleComparator& comparator_;
+  };
+
+  // Appends 'data' to 'entries' with a memory reservation. Returns false and
+  // populates 'status' on failure.
+  bool Reserve(std::unique_ptr<TupleData> data, std::vector<Entry>* entries,
+               zetasql_base::Status* status) {
+    const int64_t byte_size = data->GetPhysicalByteSize() + sizeof(Entry);
+    if (!accountant_->RequestTupleBytes(*data, byte_size, status)) {
+      return false;
+    }
+    entries->push_back(Entry{next_sequence_number_++, byte_size,
+                             std::move(data)});
+    return true;
+  }
+
+  // Adds 'data' to 'entries_'.
+  bool Push(std::unique_ptr<TupleData> data, zetasql_base::Status* status) {
+    if (!Reserve(std::move(data), &entries_, status)) return false;
+    std::push_heap(entries_.begin(), entries_.end(), EntryLess(comparator_));
+    return true;
+  }
+
+  // Clears 'entries' and returns their memory reservations.
+  void ReturnAll(std::vector<Entry>* entries) {
+    for (const Entry& entry : *entries) {
+      accountant_->ReturnTupleBytes(*entry.data, entry.byte_size);
+    }
+    entries->clear();
+  }
+
+  const TupleComparator& comparator_;
+  const int64_t max_size_;
+  const bool keep_ties_;
+  MemoryAccountant* accountant_;
+  int64_t next_sequence_number_ = 0;
+  // A max-heap according to EntryLess.
+  std::vector<Entry> entries_;
+  // If 'keep_ties_' is true, the TupleDatas that tie with the largest one in
+  // 'entries_' but did not fit into it.
+  std::vector<Entry> ties_;
+};
+
+// Hashes and compares Values of a type that is known up front, such as the
+// values of a grouping or join key column. Dispatches on a TypeKind computed
+// once from the type (recursively for structs and arrays) instead of the one
+// stored in each Value, and does not hash any type information, which
+// absl::Hash<Value> has to do for every value. Values of a different kind (for
+// example the UINT64 join keys that replace non-negative INT64 ones) fall back
+// to absl::Hash<Value> and Value::Equals(), so the results are consistent
+// with each other, but not with absl::Hash<Value>.
+class TypedValueHasher {
+ public:
+  explicit TypedValueHasher(const Type* type);
+
+  size_t HashCode(const Value& value) const {
+    return absl::Hash<HashedValue>()(HashedValue{this, &value});
+  }
+
+  template <typename H>
+  H HashValue(H h, const Value& value) const;
+
+  bool Equals(const Value& v1, const Value& v2) const;
+
+ private:
+  // Binds a Value to the TypedValueHasher for its type so that it can be
+  // passed to absl::Hash.
+  struct HashedValue {
+    const TypedValueHasher* hasher;
+    const Value* value;
+
+    template <typename H>
+    friend H AbslHashValue(H h, const HashedValue& v) {
+      return v.hasher->HashValue(std::move(h), *v.value);
+    }
+  };
+
+  // Returns false if 'value' must be hashed and compared generically because
+  // its type is not the expected one.
+  bool HasExpectedType(const Value& value) const {
+    if (value.type_kind() != kind_) return false;
+    if (children_.empty()) return true;
+    return value.type() == type_ || value.type()->Equals(type_);
+  }
+
+  const Type* type_;
+  TypeKind kind_;
+  // One per field for structs, just the element for arrays, and empty for all
+  // other types.
+  std::vector<TypedValueHasher> children_;
+};
+
+template <typename H>
+H TypedValueHasher::HashValue(H h, const Value& value) const {
+  if (!HasExpectedType(value)) {
+    return H::combine(std::move(h), value);
+  }
+  if (value.is_null()) {
+    // Only NULL is equal to NULL.
+    return H::combine(std::move(h), kind_);
+  }
+  switch (kind_) {
+    case TYPE_INT32:
+      return H::combine(std::move(h), value.int32_value());
+    case TYPE_INT64:
+      return H::combine(std::move(h), value.int64_value());
+    case TYPE_UINT32:
+      return H::combine(std::move(h), value.uint32_value());
+    case TYPE_UINT64:
+      return H::combine(std::move(h), value.uint64_value());
+    case TYPE_BOOL:
+      return H::combine(std::move(h), value.bool_value());
+    case TYPE_DATE:
+      return H::combine(std::move(h), value.date_value());
+    case TYPE_ENUM:
+      return H::combine(std::move(h), value.enum_value());
+    case TYPE_STRING:
+      return H::combine(std::move(h), value.string_view_value());
+    case TYPE_BYTES:
+      return H::combine(std::move(h), value.bytes_view_value());
+    case TYPE_STRUCT:
+      for (int i = 0; i < children_.size(); ++i) {
+        h = children_[i].HashValue(std::move(h), value.field(i));
+      }
+      return h;
+    case TYPE_ARRAY: {
+      // Like absl::Hash<Value>, ignore the order of the elements so that
+      // arrays with order_kind() == kIgnoresOrder are supported.
+      const absl::Hash<HashedValue> element_hasher;
+      size_t combined_hash = 1;
+      for (const Value& element : value.elements()) {
+        combined_hash += element_hasher(HashedValue{&children_[0], &element});
+      }
+      return H::combine(std::move(h), combined_hash);
+    }
+    default:
+      return H::combine(std::move(h), value);
+  }
+}
+
+// Hashes and compares TupleDatas whose slots have known types, using one
+// TypedValueHasher per slot. Hash and Eq adapt it for absl::flat_hash_map and
+// absl::flat_hash_set.
+class TupleHasher {
+ public:
+  explicit TupleHasher(absl::Span<const Type* const> slot_types);
+
+  size_t HashCode(const TupleData& data) const {
+    return absl::Hash<HashedTuple>()(HashedTuple{&slot_hashers_, &data});
+  }
+
+  bool Equals(const TupleData& d1, const TupleData& d2) const;
+
+  struct Hash {
+    size_t operator()(const TupleData& data) const {
+      return hasher->HashCode(data);
+    }
+    std::shared_ptr<const TupleHasher> hasher;
+  };
+
+  struct Eq {
+    bool operator()(const TupleData& d1, const TupleData& d2) const {
+      return hasher->Equals(d1, d2);
+    }
+    std::shared_ptr<const TupleHasher> hasher;
+  };
+
+ private:
+  struct HashedTuple {
+    const std::vector<TypedValueHasher>* slot_hashers;
+    const TupleData* data;
+
+    template <typename H>
+    friend H AbslHashValue(H h, const HashedTuple& t) {
+      const std::vector<TypedValueHasher>& slot_hashers = *t.slot_hashers;
+      DCHECK_EQ(t.data->num_slots(), slot_hashers.size());
+      for (int i = 0; i < slot_hashers.size(); ++i) {
+        h = slot_hashers[i].HashValue(std::move(h), t.data->slot(i).value());
+      }
+      return h;
+    }
+  };
+
+  std::vector<TypedValueHasher> slot_hashers_;
+};
+
 // Represents a hash set of values with memory tracked by a MemoryAccountant.
+// The values are stored inline in an open-addressing table. The accountant is
+// charged for every slot of the table (including the ones that are still
+// empty) when the table grows, and for the bytes that each value owns outside
+// of its slot when it is inserted.
 class ValueHashSet {
  public:
-  explicit ValueHashSet(MemoryAccountant* accountant)
-      : accountant_(accountant) {}
+  // If 'type' is non-NULL, the values are expected to have that type and are
+  // hashed with a TypedValueHasher.
+  explicit ValueHashSet(MemoryAccountant* accountant,
+                        const Type* type = nullptr)
+      : accountant_(accountant),
+        values_(/*bucket_count=*/0, ValueHash{MakeHasher(type)},
+                ValueEq{MakeHasher(type)}) {}
 
   ValueHashSet(const ValueHashSet&) = delete;
   ValueHashSet& operator=(const ValueHashSet&) = delete;
@@ -789,33 +1253,191 @@ class ValueHashSet {
   ~ValueHashSet() { Clear(); }
 
   // If 'value' is in the underlying set, sets 'inserted' to false and returns
-  // true. Otherwise requests bytes. If that succeeds, inserts 'value' into the
-  // underlying set, sets 'inserted' to true, and returns false. Otherwise,
-  // populates 'status' and returns false.
+  // true. Otherwise inserts 'value' into the underlying set and requests its
+  // bytes. If that succeeds, sets 'inserted' to true and returns true.
+  // Otherwise, removes 'value' again, sets 'inserted' to false, populates
+  // 'status' and returns false.
   bool Insert(const Value& value, bool* inserted, zetasql_base::Status* status) {
     *inserted = false;
-    if (values_.contains(value)) {
+    const auto result = values_.insert(value);
+    if (!result.second) {
       return true;
     }
-    if (!accountant_->RequestBytes(value.physical_byte_size(), status)) {
+    const int64_t owned_bytes = OwnedBytes(value);
+    if (!accountant_->RequestBytes(owned_bytes, status)) {
+      values_.erase(result.first);
       return false;
     }
-    values_.insert(value);
+    if (!RequestSlotBytes(status)) {
+      values_.erase(result.first);
+      accountant_->ReturnBytes(owned_bytes);
+      return false;
+    }
+    owned_bytes_ += owned_bytes;
     *inserted = true;
     return true;
   }
 
+  // Makes room for 'num_values' values without growing the table again, for
+  // example from a hint of the number of distinct values, and requests the
+  // bytes of the additional slots. Returns false and populates 'status' if
+  // that fails.
+  bool Reserve(int64_t num_values, zetasql_base::Status* status) {
+    if (num_values <= size()) return true;
+    values_.reserve(num_values);
+    if (!RequestSlotBytes(status)) {
+      values_.rehash(0);
+      return false;
+    }
+    return true;
+  }
+
+  int64_t size() const { return values_.size(); }
+
+  // Calls 'fn' on each value in the set, in no particular order.
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    for (const Value& value : values_) fn(value);
+  }
+
   // Clear the hash set.
   void Clear() {
-    for (const Value& value : values_) {
-      accountant_->ReturnBytes(value.physical_byte_size());
-    }
+    accountant_->ReturnBytes(owned_bytes_ + slot_bytes_);
+    owned_bytes_ = 0;
+    slot_bytes_ = 0;
     values_.clear();
   }
 
  private:
+  // The bytes of a slot of 'values_', including its control byte.
+  static constexpr int64_t kSlotBytes = sizeof(Value) + 1;
+
+  // Returns the bytes that 'value' owns outside of its slot.
+  static int64_t OwnedBytes(const Value& value) {
+    return value.physical_byte_size() - sizeof(Value);
+  }
+
+  // Requests the bytes of the slots that 'values_' has gained since the last
+  // call. The table grows geometrically, so this only requests bytes for a
+  // logarithmic number of insertions.
+  bool RequestSlotBytes(zetasql_base::Status* status) {
+    const int64_t slot_bytes =
+        static_cast<int64_t>(values_.capacity()) * kSlotBytes;
+    if (slot_bytes > slot_bytes_) {
+      if (!accountant_->RequestBytes(slot_bytes - slot_bytes_, status)) {
+        return false;
+      }
+      slot_bytes_ = slot_bytes;
+    }
+    return true;
+  }
+
+  struct ValueHash {
+    size_t operator()(const Value& value) const {
+      if (hasher == nullptr) return absl::Hash<Value>()(value);
+      return hasher->HashCode(value);
+    }
+    std::shared_ptr<const TypedValueHasher> hasher;
+  };
+
+  struct ValueEq {
+    bool operator()(const Value& v1, const Value& v2) const {
+      return hasher == nullptr ? v1 == v2 : hasher->Equals(v1, v2);
+    }
+    std::shared_ptr<const TypedValueHasher> hasher;
+  };
+
+  static std::shared_ptr<const TypedValueHasher> MakeHasher(const Type* type) {
+    if (type == nullptr) return nullptr;
+    return std::make_shared<const TypedValueHasher>(type);
+  }
+
   MemoryAccountant* accountant_;
-  absl::flat_hash_set<Value> values_;
+  absl::flat_hash_set<Value, ValueHash, ValueEq> values_;
+  // The bytes requested for the values outside of their slots.
+  int64_t owned_bytes_ = 0;
+  // The bytes requested for the slots of 'values_'.
+  int64_t slot_bytes_ = 0;
+};
+
+// Holds up to 'capacity()' TupleDatas that are passed between iterators in a
+// single call to TupleIterator::NextBatch(). The TupleDatas are owned by the
+// batch and reused across calls to Clear() to avoid reallocating their
+// slots. A selection vector records which of the appended rows are still part
+// of the batch, so that an operator like a filter can drop rows without moving
+// any TupleSlots.
+class TupleBatch {
+ public:
+  explicit TupleBatch(int capacity) : capacity_(capacity) {
+    DCHECK_GT(capacity, 0);
+    rows_.reserve(capacity);
+    selection_.reserve(capacity);
+  }
+
+  TupleBatch(const TupleBatch&) = delete;
+  TupleBatch& operator=(const TupleBatch&) = delete;
+
+  int capacity() const { return capacity_; }
+
+  // Returns the number of selected rows.
+  int size() const { return selection_.size(); }
+
+  bool IsEmpty() const { return selection_.empty(); }
+
+  // Returns true if no more rows can be appended until the next Clear().
+  bool IsFull() const { return num_appended_ == capacity_; }
+
+  // Returns the 'i'-th selected row. 'i' must be in [0, size()).
+  const TupleData& row(int i) const { return rows_[selection_[i]]; }
+  TupleData* mutable_row(int i) { return &rows_[selection_[i]]; }
+
+  // Appends a selected row and returns it. Must not be called if IsFull(). The
+  // returned TupleData may still contain the slots of a row from before the
+  // last call to Clear(), which the caller is expected to overwrite.
+  TupleData* AppendRow() {
+    DCHECK(!IsFull());
+    if (num_appended_ == rows_.size()) {
+      rows_.emplace_back();
+    }
+    selection_.push_back(num_appended_);
+    return &rows_[num_appended_++];
+  }
+
+  // Keeps only the selected rows at 'positions', which must be strictly
+  // increasing and in [0, size()).
+  void SelectRows(absl::Span<const int> positions) {
+    DCHECK_LE(positions.size(), selection_.size());
+    for (int i = 0; i < positions.size(); ++i) {
+      DCHECK_GE(positions[i], i);
+      selection_[i] = selection_[positions[i]];
+    }
+    selection_.resize(positions.size());
+  }
+
+  // Keeps only the selected rows in [begin, end), where
+  // 0 <= begin <= end <= size().
+  void SelectRange(int begin, int end) {
+    DCHECK_LE(0, begin);
+    DCHECK_LE(begin, end);
+    DCHECK_LE(end, size());
+    selection_.erase(selection_.begin() + end, selection_.end());
+    selection_.erase(selection_.begin(), selection_.begin() + begin);
+  }
+
+  // Removes all rows from the batch without deallocating them.
+  void Clear() {
+    num_appended_ = 0;
+    selection_.clear();
+  }
+
+ private:
+  const int capacity_;
+  // Only the first 'num_appended_' entries are part of the batch. The rest are
+  // kept around for reuse.
+  std::vector<TupleData> rows_;
+  int num_appended_ = 0;
+  // Indexes into 'rows_' of the selected rows, in increasing order.
+  std::vector<int> selection_;
 };
 
 // An iterator over TupleDatas. Particularly useful as a representation of a
@@ -851,6 +1473,23 @@ class TupleIterator {
   // TupleData into a wider TupleData with more slots.
   virtual TupleData* Next() = 0;
 
+  // Replaces the contents of 'batch' with up to 'batch->capacity()' tuples and
+  // returns true if the result is non-empty. Returns false if there are no more
+  // tuples or if there is an error, in which case the caller must call Status()
+  // to distinguish between success and failure. The behavior of NextBatch() is
+  // undefined after it has returned false, and callers must not mix calls to
+  // Next() and NextBatch() on the same iterator.
+  //
+  // The rows of 'batch' are subject to the same rules as the return value of
+  // Next(): they remain valid until the next call to NextBatch(), and the
+  // caller may only modify the slots after the first
+  // 'Schema()->num_variables()'.
+  //
+  // The default implementation fills 'batch' by calling Next(). Iterators that
+  // can process a whole batch at a time without a virtual call per row (e.g.,
+  // FilterTupleIterator) override it.
+  virtual bool NextBatch(TupleBatch* batch);
+
   // Returns the current status.
   virtual zetasql_base::Status Status() const = 0;
 
@@ -879,6 +1518,11 @@ class TupleIterator {
   // most cases, more detailed information is available from the RelationalOp
   // corresponding to the iterator.
   virtual std::string DebugString() const = 0;
+
+ private:
+  // True if the default implementation of NextBatch() has seen Next() return
+  // NULL, and therefore must not call it again.
+  bool next_returned_null_ = false;
 };
 
 // Wraps another iterator and scrambles its order. The scrambling is
@@ -979,6 +1623,47 @@ class PassThroughTupleIterator : public TupleIterator {
   zetasql_base::Status iterator_factory_status_;
 };
 
+// Wraps an iterator that natively implements NextBatch() so that consumers that
+// only call Next() can still use it. NextBatch() is forwarded to the wrapped
+// iterator, which lets stacked batch-aware iterators (e.g., a
+// FilterTupleIterator on top of a ComputeTupleIterator) bypass the per-row
+// interface entirely.
+class BatchedTupleIterator : public TupleIterator {
+ public:
+  BatchedTupleIterator(std::unique_ptr<TupleIterator> iter, int batch_size)
+      : iter_(std::move(iter)), batch_(batch_size) {}
+
+  BatchedTupleIterator(const BatchedTupleIterator&) = delete;
+  BatchedTupleIterator& operator=(const BatchedTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return iter_->Schema(); }
+
+  TupleData* Next() override;
+
+  bool NextBatch(TupleBatch* batch) override { return iter_->NextBatch(batch); }
+
+  zetasql_base::Status Status() const override { return iter_->Status(); }
+
+  bool PreservesOrder() const override { return iter_->PreservesOrder(); }
+
+  zetasql_base::Status DisableReordering() override {
+    return iter_->DisableReordering();
+  }
+
+  std::string DebugString() const override {
+    return absl::StrCat("BatchedTupleIterator(", iter_->DebugString(), ")");
+  }
+
+ private:
+  std::unique_ptr<TupleIterator> iter_;
+  // The batch whose rows are returned by Next().
+  TupleBatch batch_;
+  // The index in 'batch_' of the next row to return from Next().
+  int next_row_in_batch_ = 0;
+  // True if 'iter_->NextBatch()' has returned false.
+  bool done_ = false;
+};
+
 }  // namespace zetasql
 
 #endif  // ZETASQL_REFERENCE_IMPL_TUPLE_H_
@@ -16,6 +16,8 @@
 
 #include "zetasql/reference_impl/tuple_comparator.h"
 
+#include <cmath>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
@@ -32,6 +34,8 @@
 #include "zetasql/base/status.h"
 #include "zetasql/base/status_macros.h"
 #include "zetasql/base/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 namespace zetasql {
 
@@ -78,6 +82,16 @@ zetasql_base::StatusOr<std::unique_ptr<TupleComparator>> TupleComparator::Create
   return absl::WrapUnique(new TupleComparator(keys, slots_for_keys, collators));
 }
 
+std::vector<ValueComparator> TupleComparator::GetValueComparators(
+    absl::Span<const KeyArg* const> keys) {
+  std::vector<ValueComparator> comparators;
+  comparators.reserve(keys.size());
+  for (const KeyArg* key : keys) {
+    comparators.push_back(GetValueComparator(key->type()));
+  }
+  return comparators;
+}
+
 bool TupleComparator::operator()(const TupleData& t1,
                                  const TupleData& t2) const {
   for (int i = 0; i < keys_.size(); ++i) {
@@ -120,12 +134,9 @@ bool TupleComparator::operator()(const TupleData& t1,
         }
       }
     } else {
-      if (!v1.Equals(v2)) {
-        if (key->is_descending()) {
-          return v2.LessThan(v1);
-        } else {
-          return v1.LessThan(v2);
-        }
+      const int result = comparators_[i](v1, v2);
+      if (result != 0) {
+        return key->is_descending() ? result > 0 : result < 0;
       }
     }
   }
@@ -133,6 +144,171 @@ bool TupleComparator::operator()(const TupleData& t1,
   return false;
 }
 
+namespace {
+
+// Appends the big-endian bytes of 'bits' to 'normalized_key'.
+template <typename Bits>
+void AppendBigEndian(Bits bits, std::string* normalized_key) {
+  for (int shift = 8 * (sizeof(Bits) - 1); shift >= 0; shift -= 8) {
+    normalized_key->push_back(static_cast<char>(bits >> shift));
+  }
+}
+
+// Returns the bits of signed 'value' ordered as unsigned integers.
+template <typename Bits, typename Int>
+Bits OrderedIntBits(Int value) {
+  return static_cast<Bits>(value) ^ (Bits{1} << (8 * sizeof(Bits) - 1));
+}
+
+// Returns the bits of 'value' ordered as unsigned integers in the order of
+// Value::LessThan(), which puts NaNs first and does not distinguish -0.0 and
+// 0.0.
+template <typename Bits, typename Float>
+Bits OrderedFloatBits(Float value) {
+  static_assert(sizeof(Bits) == sizeof(Float), "Bits must hold a Float");
+  if (std::isnan(value)) return 0;
+  if (value == 0) value = 0;
+  Bits bits;
+  memcpy(&bits, &value, sizeof(bits));
+  constexpr Bits kSignBit = Bits{1} << (8 * sizeof(Bits) - 1);
+  return (bits & kSignBit) != 0 ? ~bits : bits | kSignBit;
+}
+
+// Appends 'bytes' to 'normalized_key' followed by two zero bytes, escaping
+// every zero byte of 'bytes' as a zero byte followed by 0xff, so that shorter
+// strings sort before longer strings that they are prefixes of.
+void AppendEscapedBytes(absl::string_view bytes, std::string* normalized_key) {
+  for (const char c : bytes) {
+    normalized_key->push_back(c);
+    if (c == '\0') normalized_key->push_back('\xff');
+  }
+  normalized_key->append(2, '\0');
+}
+
+// Appends the ascending encoding of non-NULL 'value' to 'normalized_key'.
+// 'collator' is the collator of a STRING value, or nullptr if it has no
+// collation.
+void AppendNormalizedValue(const Value& value, const ZetaSqlCollator* collator,
+                           std::string* normalized_key) {
+  if (collator != nullptr) {
+    DCHECK(value.type()->IsString());
+    std::string sort_key;
+    zetasql_base::Status status;
+    collator->AppendSortKeyUtf8(value.string_value(), &sort_key, &status);
+    ZETASQL_DCHECK_OK(status);
+    AppendEscapedBytes(sort_key, normalized_key);
+    return;
+  }
+  switch (value.type_kind()) {
+    case TYPE_INT32:
+      AppendBigEndian(OrderedIntBits<uint32_t>(value.int32_value()),
+                      normalized_key);
+      break;
+    case TYPE_DATE:
+      AppendBigEndian(OrderedIntBits<uint32_t>(value.date_value()),
+                      normalized_key);
+      break;
+    case TYPE_ENUM:
+      AppendBigEndian(OrderedIntBits<uint32_t>(value.enum_value()),
+                      normalized_key);
+      break;
+    case TYPE_INT64:
+      AppendBigEndian(OrderedIntBits<uint64_t>(value.int64_value()),
+                      normalized_key);
+      break;
+    case TYPE_UINT32:
+      AppendBigEndian(value.uint32_value(), normalized_key);
+      break;
+    case TYPE_UINT64:
+      AppendBigEndian(value.uint64_value(), normalized_key);
+      break;
+    case TYPE_BOOL:
+      normalized_key->push_back(value.bool_value() ? 1 : 0);
+      break;
+    case TYPE_FLOAT:
+      AppendBigEndian(OrderedFloatBits<uint32_t>(value.float_value()),
+                      normalized_key);
+      break;
+    case TYPE_DOUBLE:
+      AppendBigEndian(OrderedFloatBits<uint64_t>(value.double_value()),
+                      normalized_key);
+      break;
+    case TYPE_TIMESTAMP: {
+      const absl::Time time = value.ToTime();
+      // ToUnixSeconds() rounds down, so the nanoseconds are non-negative.
+      const int64_t seconds = absl::ToUnixSeconds(time);
+      const int64_t nanos =
+          absl::ToInt64Nanoseconds(time - absl::FromUnixSeconds(seconds));
+      AppendBigEndian(OrderedIntBits<uint64_t>(seconds), normalized_key);
+      AppendBigEndian(static_cast<uint32_t>(nanos), normalized_key);
+      break;
+    }
+    case TYPE_STRING:
+      AppendEscapedBytes(value.string_value(), normalized_key);
+      break;
+    case TYPE_BYTES:
+      AppendEscapedBytes(value.bytes_value(), normalized_key);
+      break;
+    default:
+      LOG(DFATAL) << "No normalized key for type "
+                  << value.type()->DebugString();
+  }
+}
+
+}  // namespace
+
+bool TupleComparator::SupportsNormalizedKeys(
+    absl::Span<const KeyArg* const> keys, const Collators& collators) {
+  for (int i = 0; i < keys.size(); ++i) {
+    if (collators[i] != nullptr && !collators[i]->SupportsSortKeys()) {
+      return false;
+    }
+    switch (keys[i]->type()->kind()) {
+      case TYPE_INT32:
+      case TYPE_INT64:
+      case TYPE_UINT32:
+      case TYPE_UINT64:
+      case TYPE_BOOL:
+      case TYPE_DATE:
+      case TYPE_ENUM:
+      case TYPE_FLOAT:
+      case TYPE_DOUBLE:
+      case TYPE_STRING:
+      case TYPE_BYTES:
+      case TYPE_TIMESTAMP:
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+void TupleComparator::AppendNormalizedKey(const TupleData& t,
+                                          std::string* normalized_key) const {
+  DCHECK(has_normalized_keys_);
+  for (int i = 0; i < keys_.size(); ++i) {
+    const KeyArg* key = keys_[i];
+    const Value& value = t.slot(slots_for_keys_[i]).value();
+    // The defaults match operator().
+    const bool nulls_first = key->is_descending()
+                                 ? key->null_order() == KeyArg::kNullsFirst
+                                 : key->null_order() != KeyArg::kNullsLast;
+    if (value.is_null()) {
+      normalized_key->push_back(nulls_first ? 0 : 2);
+      continue;
+    }
+    normalized_key->push_back(1);
+    const size_t value_start = normalized_key->size();
+    AppendNormalizedValue(value, (*collators_)[i].get(), normalized_key);
+    if (key->is_descending()) {
+      for (size_t j = value_start; j < normalized_key->size(); ++j) {
+        (*normalized_key)[j] = ~(*normalized_key)[j];
+      }
+    }
+  }
+}
+
 bool TupleComparator::IsUniquelyOrdered(
     absl::Span<const TupleData* const> tuples,
     absl::Span<const int> slot_idxs_for_values) const {
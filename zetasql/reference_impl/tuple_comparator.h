@@ -17,11 +17,14 @@
 #ifndef ZETASQL_REFERENCE_IMPL_TUPLE_COMPARATOR_H_
 #define ZETASQL_REFERENCE_IMPL_TUPLE_COMPARATOR_H_
 
+#include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "zetasql/common/internal_value.h"
 #include "zetasql/public/collator.h"
+#include "zetasql/reference_impl/value_comparator.h"
 #include "absl/types/span.h"
 #include "zetasql/base/status.h"
 
@@ -66,6 +69,24 @@ class TupleComparator {
 
   const std::vector<const KeyArg*>& keys() const { return keys_; }
 
+  // Returns true if AppendNormalizedKey() can be called, which requires that
+  // every key is of a type with a normalized encoding (integers, BOOL, DATE,
+  // ENUM, FLOAT, DOUBLE, STRING, BYTES and TIMESTAMP), and that the collator
+  // of every key with a collation supports sort keys.
+  bool HasNormalizedKeys() const { return has_normalized_keys_; }
+
+  // Returns true if any key has a collation. Comparing collated strings is
+  // expensive, so normalized keys (which encode the collation sort keys) are
+  // worth computing even for few tuples.
+  bool HasCollations() const { return has_collations_; }
+
+  // Appends an encoding of the keys of 't' to 'normalized_key' such that t1 is
+  // less than t2 iff the encoding of t1 is lexicographically less than the
+  // encoding of t2 (comparing unsigned bytes). The sort order and NULL order
+  // of the keys are part of the encoding. Requires HasNormalizedKeys().
+  void AppendNormalizedKey(const TupleData& t,
+                           std::string* normalized_key) const;
+
  private:
   using Collators = std::vector<std::unique_ptr<const ZetaSqlCollator>>;
 
@@ -74,7 +95,22 @@ class TupleComparator {
                   std::shared_ptr<const Collators> collators)
       : keys_(keys.begin(), keys.end()),
         slots_for_keys_(slots_for_keys.begin(), slots_for_keys.end()),
-        collators_(collators) {}
+        collators_(collators),
+        comparators_(GetValueComparators(keys)),
+        has_normalized_keys_(SupportsNormalizedKeys(keys, *collators)),
+        has_collations_(std::any_of(
+            collators->begin(), collators->end(),
+            [](const std::unique_ptr<const ZetaSqlCollator>& collator) {
+              return collator != nullptr;
+            })) {}
+
+  // Returns the ValueComparators for the types of 'keys'.
+  static std::vector<ValueComparator> GetValueComparators(
+      absl::Span<const KeyArg* const> keys);
+
+  // Returns true if 'keys' with 'collators' have normalized encodings.
+  static bool SupportsNormalizedKeys(absl::Span<const KeyArg* const> keys,
+                                     const Collators& collators);
 
   const std::vector<const KeyArg*> keys_;
   const std::vector<int> slots_for_keys_;
@@ -84,6 +120,11 @@ class TupleComparator {
   // compared based on their UTF-8 encoding.
   // We use std::shared_ptr<const ...> to allow the comparator to be copied.
   const std::shared_ptr<const Collators> collators_;
+  // The comparators for the non-NULL values of the keys without a collation,
+  // selected once from the key types. Corresponds 1-1 with keys_.
+  const std::vector<ValueComparator> comparators_;
+  const bool has_normalized_keys_;
+  const bool has_collations_;
 };
 
 }  // namespace zetasql
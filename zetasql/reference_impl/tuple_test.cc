@@ -16,8 +16,12 @@
 
 #include "zetasql/reference_impl/tuple.h"
 
+#include <limits>
+#include <string>
+
 #include "google/protobuf/descriptor.h"
 #include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/common/evaluator_registration_utils.h"
 #include "zetasql/reference_impl/operator.h"
 #include "zetasql/reference_impl/tuple_test_util.h"
 #include "zetasql/testdata/test_schema.pb.h"
@@ -25,6 +29,7 @@
 #include "zetasql/testing/using_test_value.cc"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 
 namespace zetasql {
 namespace {
@@ -164,6 +169,55 @@ TEST(TupleDataTest, Equals) {
   EXPECT_FALSE(data1.Equals(data4));
 }
 
+TEST(TupleHasherTest, ConsistentWithEquals) {
+  const Value struct1 = Struct({"a", "b"}, {Int64(1), String("x")});
+  const Value struct2 = Struct({"a", "b"}, {Int64(1), String("y")});
+  const TupleHasher hasher({types::Int64Type(), types::StringType(),
+                            struct1.type(), types::Int64ArrayType(),
+                            types::DoubleType()});
+
+  const std::vector<TupleData> datas = {
+      CreateTupleDataFromValues({Int64(1), String("a"), struct1,
+                                 Int64Array({1, 2}), Double(1.5)}),
+      CreateTupleDataFromValues({Int64(2), String("a"), struct1,
+                                 Int64Array({1, 2}), Double(1.5)}),
+      CreateTupleDataFromValues({Int64(1), String("b"), struct1,
+                                 Int64Array({1, 2}), Double(1.5)}),
+      CreateTupleDataFromValues({Int64(1), String("a"), struct2,
+                                 Int64Array({1, 2}), Double(1.5)}),
+      CreateTupleDataFromValues({Int64(1), String("a"), struct1,
+                                 Int64Array({1, 3}), Double(1.5)}),
+      CreateTupleDataFromValues({Int64(1), String("a"), struct1,
+                                 Int64Array({1, 2}), Double(2.5)}),
+      CreateTupleDataFromValues({NullInt64(), NullString(),
+                                 Value::Null(struct1.type()),
+                                 Value::Null(types::Int64ArrayType()),
+                                 NullDouble()}),
+      // Values with unexpected types are hashed generically.
+      CreateTupleDataFromValues({Uint64(1), String("a"), struct1,
+                                 Int64Array({1, 2}), Double(1.5)}),
+  };
+  for (int i = 0; i < datas.size(); ++i) {
+    for (int j = 0; j < datas.size(); ++j) {
+      SCOPED_TRACE(absl::StrCat(i, " ", j));
+      const TupleData copy = datas[j];
+      EXPECT_EQ(hasher.Equals(datas[i], copy), datas[i] == copy);
+      if (i == j) {
+        EXPECT_EQ(hasher.HashCode(datas[i]), hasher.HashCode(copy));
+      }
+    }
+  }
+}
+
+TEST(TypedValueHasherTest, ArraysIgnoreOrder) {
+  const TypedValueHasher hasher(types::StringArrayType());
+  const Value array1 = StringArray({"a", "b"});
+  const Value array2 = Array({String("b"), String("a")}, kIgnoresOrder);
+  EXPECT_EQ(hasher.Equals(array1, array2), array1 == array2);
+  EXPECT_EQ(hasher.HashCode(array1), hasher.HashCode(array2));
+  EXPECT_FALSE(hasher.Equals(array1, StringArray({"a", "c"})));
+}
+
 TEST(Tuple, DebugString) {
   TupleSchema schema({VariableId("foo"), VariableId("bar")});
   TupleData data = CreateTupleDataFromValues({Int64(10), NullInt64()});
@@ -317,6 +371,84 @@ TEST(TupleDataDeque, PushAndPopTest) {
   EXPECT_EQ(accountant.remaining_bytes(), 1000);
 }
 
+TEST(TupleDataDeque, PushBackCopyTest) {
+  MemoryAccountant accountant(/*total_num_bytes=*/100000);
+  TupleDataDeque deque(&accountant);
+
+  zetasql_base::Status status;
+  const TupleData first = CreateTupleDataFromValues({Int64(0), String("a")});
+  ASSERT_TRUE(deque.PushBackCopy(first, &status));
+  const TupleData* first_ptr = deque.GetTuplePtrs()[0];
+
+  // Pushing more tuples does not move the ones already in the deque.
+  for (int i = 1; i < 1000; ++i) {
+    ASSERT_TRUE(deque.PushBackCopy(
+        CreateTupleDataFromValues({Int64(i), String("a")}), &status))
+        << status;
+  }
+  EXPECT_EQ(first_ptr, deque.GetTuplePtrs()[0]);
+  EXPECT_TRUE(first_ptr->Equals(first));
+
+  // A TupleData that does not fit is left with the caller.
+  auto too_big = absl::make_unique<TupleData>(CreateTupleDataFromValues(
+      {String(std::string(accountant.remaining_bytes(), 'x'))}));
+  EXPECT_FALSE(deque.TryPushBack(&too_big, &status));
+  EXPECT_THAT(status, StatusIs(zetasql_base::StatusCode::kResourceExhausted));
+  ASSERT_NE(too_big, nullptr);
+  EXPECT_EQ(too_big->num_slots(), 1);
+
+  for (int i = 0; i < 1000; ++i) {
+    std::unique_ptr<TupleData> data = deque.PopFront();
+    EXPECT_EQ(data->slot(0).value(), Int64(i));
+  }
+  EXPECT_EQ(accountant.remaining_bytes(), 100000);
+}
+
+TEST(TupleDataDeque, SharedValuesTest) {
+  MemoryAccountant accountant(/*total_num_bytes=*/100000);
+  TupleDataDeque deque(&accountant);
+
+  const Value large = String(std::string(10000, 'x'));
+  const int64_t payload_size = large.physical_byte_size() - sizeof(Value);
+  ASSERT_GE(payload_size, MemoryAccountant::kMinSharedPayloadByteSize);
+
+  // Only the first of the tuples sharing 'large' is charged for its contents,
+  // even if it appears in several slots.
+  zetasql_base::Status status;
+  const TupleData first = CreateTupleDataFromValues({Int64(0), large, large});
+  ASSERT_TRUE(deque.PushBackCopy(first, &status)) << status;
+  const int64_t first_charge = 100000 - accountant.remaining_bytes();
+  EXPECT_GE(first_charge, payload_size);
+  EXPECT_LT(first_charge, 2 * payload_size);
+  for (int i = 1; i < 20; ++i) {
+    const int64_t remaining_bytes = accountant.remaining_bytes();
+    ASSERT_TRUE(deque.PushBackCopy(
+        CreateTupleDataFromValues({Int64(i), large, large}), &status))
+        << status;
+    EXPECT_EQ(remaining_bytes - accountant.remaining_bytes(),
+              first_charge - payload_size);
+  }
+
+  // The contents stay charged until the last tuple referring to them is gone.
+  for (int i = 0; i < 19; ++i) {
+    std::unique_ptr<TupleData> data = deque.PopFront();
+    EXPECT_EQ(data->slot(0).value(), Int64(i));
+  }
+  EXPECT_EQ(accountant.remaining_bytes(), 100000 - first_charge);
+
+  // Replacing the shared value returns its charge.
+  ZETASQL_ASSERT_OK(deque.SetSlot(/*slot_idx=*/1, {Int64(1)}));
+  ZETASQL_ASSERT_OK(deque.SetSlot(/*slot_idx=*/2, {Int64(2)}));
+  EXPECT_LT(100000 - accountant.remaining_bytes(), payload_size);
+
+  // A value that was not charged for is still charged for in full.
+  ZETASQL_ASSERT_OK(deque.SetSlot(/*slot_idx=*/1, {large}));
+  EXPECT_GE(100000 - accountant.remaining_bytes(), payload_size);
+
+  deque.Clear();
+  EXPECT_EQ(accountant.remaining_bytes(), 100000);
+}
+
 TEST(TupleDataDeque, DestructorTest) {
   MemoryAccountant accountant(/*total_num_bytes=*/1000);
   {
@@ -409,6 +541,188 @@ TEST(TupleDataDeque, SetSlotTest) {
   }
 }
 
+TEST(TupleDataDeque, RadixSortTest) {
+  VariableId k0("k0"), k1("k1"), k2("k2");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k0,
+                       DerefExpr::Create(k0, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k1,
+                       DerefExpr::Create(k1, StringType()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k2,
+                       DerefExpr::Create(k2, DoubleType()));
+  KeyArg key0(k0, std::move(deref_k0), KeyArg::kAscending, KeyArg::kNullsLast);
+  KeyArg key1(k1, std::move(deref_k1), KeyArg::kDescending);
+  KeyArg key2(k2, std::move(deref_k2), KeyArg::kAscending);
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> comparator,
+      TupleComparator::Create({&key0, &key1, &key2},
+                              /*slots_for_keys=*/{0, 1, 2},
+                              /*params=*/{}, &context));
+  ASSERT_TRUE(comparator->HasNormalizedKeys());
+
+  const std::vector<Value> strings = {NullString(),
+                                      String(""),
+                                      String("a"),
+                                      String(std::string("a\0", 2)),
+                                      String(std::string("a\0b", 3)),
+                                      String("ab"),
+                                      String("b\xff")};
+  const std::vector<Value> doubles = {
+      NullDouble(), Double(std::numeric_limits<double>::quiet_NaN()),
+      Double(-std::numeric_limits<double>::infinity()), Double(-1.5),
+      Double(-0.0), Double(0.0), Double(2.5),
+      Double(std::numeric_limits<double>::infinity())};
+
+  // The last slot holds the index of each tuple, which identifies it.
+  std::vector<TupleData> tuples;
+  for (int i = 0; i < 2000; ++i) {
+    const int64_t k = (i * 7919) % 13 - 6;
+    tuples.push_back(CreateTestTupleData(
+        {k == 0 ? NullInt64() : Int64(k), strings[(i * 31) % strings.size()],
+         doubles[(i * 17) % doubles.size()], Int64(i)}));
+  }
+  std::vector<TupleData> expected = tuples;
+  std::stable_sort(expected.begin(), expected.end(), *comparator);
+
+  MemoryAccountant accountant(/*total_num_bytes=*/10 * 1024 * 1024);
+  TupleDataDeque deque(&accountant);
+  zetasql_base::Status status;
+  for (const TupleData& tuple : tuples) {
+    ASSERT_TRUE(deque.PushBack(absl::make_unique<TupleData>(tuple), &status))
+        << status;
+  }
+  deque.Sort(*comparator, /*use_stable_sort=*/true);
+
+  const std::vector<const TupleData*> sorted = deque.GetTuplePtrs();
+  ASSERT_EQ(sorted.size(), expected.size());
+  for (int i = 0; i < sorted.size(); ++i) {
+    EXPECT_EQ(sorted[i]->slot(3).value(), expected[i].slot(3).value()) << i;
+  }
+}
+
+TEST(TupleDataDeque, CollatedSortTest) {
+  internal::EnableFullEvaluatorFeatures();
+  VariableId k0("k0"), k1("k1");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k0,
+                       DerefExpr::Create(k0, StringType()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k1,
+                       DerefExpr::Create(k1, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> collation,
+                       ConstExpr::Create(String("en_US:ci")));
+  KeyArg key0(k0, std::move(deref_k0), KeyArg::kDescending);
+  key0.set_collation(std::move(collation));
+  KeyArg key1(k1, std::move(deref_k1), KeyArg::kAscending);
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> comparator,
+      TupleComparator::Create({&key0, &key1}, /*slots_for_keys=*/{0, 1},
+                              /*params=*/{}, &context));
+  ASSERT_TRUE(comparator->HasNormalizedKeys());
+  EXPECT_TRUE(comparator->HasCollations());
+
+  const std::vector<Value> strings = {
+      NullString(), String(""),   String("a"),  String("A"),
+      String("ab"), String("aB"), String("b"),  String("\xc3\x84"),
+      String("ä"),  String("B"),  String("ch"), String("Ch")};
+  // Few enough tuples that they would be compared directly without a
+  // collation. The last slot identifies each tuple.
+  std::vector<TupleData> tuples;
+  for (int i = 0; i < 40; ++i) {
+    tuples.push_back(CreateTestTupleData(
+        {strings[(i * 7) % strings.size()], Int64(i % 3), Int64(i)}));
+  }
+  std::vector<TupleData> expected = tuples;
+  std::stable_sort(expected.begin(), expected.end(), *comparator);
+
+  MemoryAccountant accountant(/*total_num_bytes=*/10 * 1024 * 1024);
+  TupleDataDeque deque(&accountant);
+  zetasql_base::Status status;
+  for (const TupleData& tuple : tuples) {
+    ASSERT_TRUE(deque.PushBack(absl::make_unique<TupleData>(tuple), &status))
+        << status;
+  }
+  deque.Sort(*comparator, /*use_stable_sort=*/true);
+
+  const std::vector<const TupleData*> sorted = deque.GetTuplePtrs();
+  ASSERT_EQ(sorted.size(), expected.size());
+  for (int i = 0; i < sorted.size(); ++i) {
+    EXPECT_EQ(sorted[i]->slot(2).value(), expected[i].slot(2).value()) << i;
+  }
+}
+
+TEST(TupleDataDeque, ParallelSortTest) {
+  VariableId k0("k0"), k1("k1");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k0,
+                       DerefExpr::Create(k0, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k1,
+                       DerefExpr::Create(k1, NumericType()));
+  KeyArg key0(k0, std::move(deref_k0), KeyArg::kDescending);
+  KeyArg key1(k1, std::move(deref_k1), KeyArg::kAscending);
+
+  EvaluationContext context((EvaluationOptions()));
+  // Sorts by 'k0' with a radix sort, and by 'k1' without normalized keys.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> radix_comparator,
+      TupleComparator::Create({&key0}, /*slots_for_keys=*/{0},
+                              /*params=*/{}, &context));
+  ASSERT_TRUE(radix_comparator->HasNormalizedKeys());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> direct_comparator,
+      TupleComparator::Create({&key1}, /*slots_for_keys=*/{1},
+                              /*params=*/{}, &context));
+  ASSERT_FALSE(direct_comparator->HasNormalizedKeys());
+
+  // Few distinct keys, so that the merges must keep equal tuples in order.
+  // The last slot identifies each tuple.
+  std::vector<TupleData> tuples;
+  for (int i = 0; i < 30000; ++i) {
+    tuples.push_back(CreateTestTupleData(
+        {Int64((i * 7919) % 37), Numeric((i * 31) % 29),
+         Int64(i)}));
+  }
+
+  for (const TupleComparator* comparator :
+       {radix_comparator.get(), direct_comparator.get()}) {
+    for (int num_threads : {2, 3, 4, 8}) {
+      std::vector<TupleData> expected = tuples;
+      std::stable_sort(expected.begin(), expected.end(), *comparator);
+
+      MemoryAccountant accountant(/*total_num_bytes=*/100 * 1024 * 1024);
+      TupleDataDeque deque(&accountant);
+      zetasql_base::Status status;
+      for (const TupleData& tuple : tuples) {
+        ASSERT_TRUE(
+            deque.PushBack(absl::make_unique<TupleData>(tuple), &status))
+            << status;
+      }
+      deque.Sort(*comparator, /*use_stable_sort=*/true, num_threads);
+
+      const std::vector<const TupleData*> sorted = deque.GetTuplePtrs();
+      ASSERT_EQ(sorted.size(), expected.size());
+      for (int i = 0; i < sorted.size(); ++i) {
+        ASSERT_EQ(sorted[i]->slot(2).value(), expected[i].slot(2).value())
+            << "num_threads " << num_threads << ", index " << i;
+      }
+    }
+  }
+}
+
+TEST(TupleDataDeque, NoNormalizedKeys) {
+  VariableId k("k");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k,
+                       DerefExpr::Create(k, NumericType()));
+  KeyArg key(k, std::move(deref_k), KeyArg::kAscending);
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> comparator,
+      TupleComparator::Create({&key}, /*slots_for_keys=*/{0},
+                              /*params=*/{}, &context));
+  EXPECT_FALSE(comparator->HasNormalizedKeys());
+}
+
 TEST(TupleDataOrderedQueue, InsertAndPopTest) {
   VariableId k1("k1"), k2("k2");
   TupleSchema schema({k1});
@@ -502,6 +816,146 @@ TEST(TupleDataOrderedQueue, DestructorTest) {
   EXPECT_EQ(accountant.remaining_bytes(), 1000);
 }
 
+TEST(TupleDataBoundedHeap, KeepsSmallestTuples) {
+  VariableId k1("k1"), k2("k2");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> key,
+                       DerefExpr::Create(k1, Int64Type()));
+  KeyArg key_arg(k2, std::move(key), KeyArg::kAscending);
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> comparator,
+      TupleComparator::Create({&key_arg}, /*slots_for_keys=*/{0},
+                              /*params=*/{}, &context));
+
+  MemoryAccountant accountant(/*total_num_bytes=*/10000);
+  TupleDataBoundedHeap heap(*comparator, /*max_size=*/5, &accountant);
+  EXPECT_TRUE(heap.IsEmpty());
+
+  // Insert keys 9, 8, ..., 0 twice, with the second slot recording the order
+  // of insertion.
+  for (int i = 0; i < 20; ++i) {
+    TupleData data = CreateTupleDataFromValues({Int64(9 - i % 10), Int64(i)});
+    EXPECT_EQ(heap.WouldKeep(data), i < 10 || i >= 16) << i;
+    zetasql_base::Status status;
+    ASSERT_TRUE(heap.Insert(absl::make_unique<TupleData>(data), &status));
+    EXPECT_EQ(heap.GetSize(), std::min(i + 1, 5));
+  }
+  EXPECT_LT(accountant.remaining_bytes(), 10000);
+
+  // Ties are broken by insertion order.
+  std::vector<std::unique_ptr<TupleData>> datas = heap.PopAllSorted();
+  EXPECT_TRUE(heap.IsEmpty());
+  EXPECT_EQ(accountant.remaining_bytes(), 10000);
+  ASSERT_EQ(datas.size(), 5);
+  const std::vector<std::pair<int, int>> expected = {
+      {0, 9}, {0, 19}, {1, 8}, {1, 18}, {2, 7}};
+  for (int i = 0; i < datas.size(); ++i) {
+    EXPECT_EQ(datas[i]->slot(0).value(), Int64(expected[i].first));
+    EXPECT_EQ(datas[i]->slot(1).value(), Int64(expected[i].second));
+  }
+}
+
+TEST(TupleDataBoundedHeap, KeepsTies) {
+  VariableId k1("k1"), k2("k2");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> key,
+                       DerefExpr::Create(k1, Int64Type()));
+  KeyArg key_arg(k2, std::move(key), KeyArg::kAscending);
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> comparator,
+      TupleComparator::Create({&key_arg}, /*slots_for_keys=*/{0},
+                              /*params=*/{}, &context));
+
+  // The second slot records the order of insertion.
+  std::vector<TupleData> tuples;
+  for (int i = 0; i < 200; ++i) {
+    tuples.push_back(
+        CreateTupleDataFromValues({Int64((i * 7919) % 23 % 10), Int64(i)}));
+  }
+  for (int max_size : {1, 3, 7, 50, 300}) {
+    std::vector<TupleData> expected = tuples;
+    std::stable_sort(expected.begin(), expected.end(), *comparator);
+    const Value& last_key =
+        expected[std::min<int>(max_size, expected.size()) - 1].slot(0).value();
+    while (expected.back().slot(0).value().int64_value() >
+           last_key.int64_value()) {
+      expected.pop_back();
+    }
+
+    MemoryAccountant accountant(/*total_num_bytes=*/100000);
+    TupleDataBoundedHeap heap(*comparator, max_size, &accountant,
+                              /*keep_ties=*/true);
+    for (const TupleData& tuple : tuples) {
+      zetasql_base::Status status;
+      ASSERT_TRUE(heap.Insert(absl::make_unique<TupleData>(tuple), &status))
+          << status;
+    }
+    EXPECT_EQ(heap.GetSize(), expected.size());
+
+    std::vector<std::unique_ptr<TupleData>> datas = heap.PopAllSorted();
+    EXPECT_TRUE(heap.IsEmpty());
+    EXPECT_EQ(accountant.remaining_bytes(), 100000);
+    ASSERT_EQ(datas.size(), expected.size()) << max_size;
+    for (int i = 0; i < datas.size(); ++i) {
+      EXPECT_EQ(datas[i]->slot(1).value(), expected[i].slot(1).value())
+          << max_size << " " << i;
+    }
+  }
+}
+
+TEST(TupleDataBoundedHeap, ZeroMaxSize) {
+  VariableId k1("k1"), k2("k2");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> key,
+                       DerefExpr::Create(k1, Int64Type()));
+  KeyArg key_arg(k2, std::move(key), KeyArg::kAscending);
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> comparator,
+      TupleComparator::Create({&key_arg}, /*slots_for_keys=*/{0},
+                              /*params=*/{}, &context));
+
+  MemoryAccountant accountant(/*total_num_bytes=*/1000);
+  TupleDataBoundedHeap heap(*comparator, /*max_size=*/0, &accountant);
+  TupleData data = CreateTupleDataFromValues({Int64(1)});
+  EXPECT_FALSE(heap.WouldKeep(data));
+  zetasql_base::Status status;
+  EXPECT_TRUE(heap.Insert(absl::make_unique<TupleData>(data), &status));
+  EXPECT_TRUE(heap.IsEmpty());
+  EXPECT_EQ(accountant.remaining_bytes(), 1000);
+}
+
+TEST(TupleDataBoundedHeap, OutOfMemory) {
+  VariableId k1("k1"), k2("k2");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> key,
+                       DerefExpr::Create(k1, Int64Type()));
+  KeyArg key_arg(k2, std::move(key), KeyArg::kAscending);
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> comparator,
+      TupleComparator::Create({&key_arg}, /*slots_for_keys=*/{0},
+                              /*params=*/{}, &context));
+
+  MemoryAccountant accountant(/*total_num_bytes=*/1000);
+  {
+    TupleDataBoundedHeap heap(*comparator, /*max_size=*/1000, &accountant);
+    zetasql_base::Status status;
+    int num_tuples = 0;
+    while (heap.Insert(absl::make_unique<TupleData>(
+                           CreateTupleDataFromValues({Int64(num_tuples)})),
+                       &status)) {
+      ++num_tuples;
+    }
+    EXPECT_THAT(status, StatusIs(zetasql_base::StatusCode::kResourceExhausted));
+    EXPECT_GE(num_tuples, 5);
+    EXPECT_EQ(heap.GetSize(), num_tuples);
+  }
+  EXPECT_EQ(accountant.remaining_bytes(), 1000);
+}
+
 TEST(ValueHashSet, BasicTest) {
   MemoryAccountant accountant(/*total_num_bytes=*/1000);
   ValueHashSet set(&accountant);
@@ -538,6 +992,20 @@ TEST(ValueHashSet, BasicTest) {
   EXPECT_EQ(accountant.remaining_bytes(), 1000);
 }
 
+TEST(ValueHashSet, TypedValues) {
+  MemoryAccountant accountant(/*total_num_bytes=*/10000);
+  ValueHashSet set(&accountant, types::StringType());
+  int num_inserted = 0;
+  for (const Value& value :
+       {String("a"), String("b"), String("a"), NullString(), NullString()}) {
+    bool inserted;
+    zetasql_base::Status status;
+    EXPECT_TRUE(set.Insert(value, &inserted, &status));
+    if (inserted) ++num_inserted;
+  }
+  EXPECT_EQ(num_inserted, 3);
+}
+
 TEST(ValueHashSet, DestructorTest) {
   MemoryAccountant accountant(/*total_num_bytes=*/1000);
   {
@@ -552,6 +1020,43 @@ TEST(ValueHashSet, DestructorTest) {
   EXPECT_EQ(accountant.remaining_bytes(), 1000);
 }
 
+TEST(ValueHashSet, ChargesSlotsWhenGrowing) {
+  MemoryAccountant accountant(/*total_num_bytes=*/1000000);
+  ValueHashSet set(&accountant);
+  zetasql_base::Status status;
+  ASSERT_TRUE(set.Reserve(1000, &status));
+  const int64_t reserved_bytes = 1000000 - accountant.remaining_bytes();
+  EXPECT_GE(reserved_bytes, 1000 * sizeof(Value));
+
+  // Inserting fixed-size values up to the reserved size requests no more
+  // bytes, while strings are charged for the bytes that they own.
+  for (int i = 0; i < 1000; ++i) {
+    bool inserted;
+    ASSERT_TRUE(set.Insert(Int64(i), &inserted, &status));
+    EXPECT_TRUE(inserted);
+  }
+  EXPECT_EQ(set.size(), 1000);
+  EXPECT_EQ(1000000 - accountant.remaining_bytes(), reserved_bytes);
+  bool inserted;
+  ASSERT_TRUE(set.Insert(String(std::string(100, 'a')), &inserted, &status));
+  EXPECT_GE(1000000 - accountant.remaining_bytes(), reserved_bytes + 100);
+
+  set.Clear();
+  EXPECT_EQ(accountant.remaining_bytes(), 1000000);
+}
+
+TEST(ValueHashSet, ReserveFailure) {
+  MemoryAccountant accountant(/*total_num_bytes=*/1000);
+  ValueHashSet set(&accountant);
+  zetasql_base::Status status;
+  EXPECT_FALSE(set.Reserve(1000, &status));
+  EXPECT_THAT(status, StatusIs(zetasql_base::StatusCode::kResourceExhausted));
+  EXPECT_EQ(accountant.remaining_bytes(), 1000);
+  bool inserted;
+  EXPECT_TRUE(set.Insert(Int64(1), &inserted, &status));
+  EXPECT_TRUE(inserted);
+}
+
 TEST(ReorderingTupleIterator, BasicTest) {
   for (int size = 0; size <= 500; ++size) {
     for (bool error : {false, true}) {
@@ -726,5 +1231,116 @@ TEST(PassThroughTupleIterator, Success) {
   EXPECT_EQ(data[1].num_slots(), 2);
 }
 
+TEST(TupleBatch, AppendAndSelect) {
+  TupleBatch batch(/*capacity=*/4);
+  EXPECT_EQ(batch.capacity(), 4);
+  EXPECT_TRUE(batch.IsEmpty());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_FALSE(batch.IsFull());
+    *batch.AppendRow() = CreateTupleDataFromValues({Int64(i)});
+  }
+  EXPECT_TRUE(batch.IsFull());
+  EXPECT_EQ(batch.size(), 4);
+
+  batch.SelectRows({0, 2, 3});
+  ASSERT_EQ(batch.size(), 3);
+  EXPECT_EQ(batch.row(0).slot(0).value(), Int64(0));
+  EXPECT_EQ(batch.row(1).slot(0).value(), Int64(2));
+  EXPECT_EQ(batch.row(2).slot(0).value(), Int64(3));
+  // Dropping rows does not make room for more.
+  EXPECT_TRUE(batch.IsFull());
+
+  batch.SelectRange(1, 2);
+  ASSERT_EQ(batch.size(), 1);
+  EXPECT_EQ(batch.row(0).slot(0).value(), Int64(2));
+
+  batch.Clear();
+  EXPECT_TRUE(batch.IsEmpty());
+  EXPECT_FALSE(batch.IsFull());
+}
+
+// Reads all the tuples from 'iter' with NextBatch().
+static std::vector<TupleData> ReadBatchesFull(TupleIterator* iter,
+                                              int batch_size,
+                                              zetasql_base::Status* end_status,
+                                              int* num_batches) {
+  TupleBatch batch(batch_size);
+  std::vector<TupleData> datas;
+  *num_batches = 0;
+  while (iter->NextBatch(&batch)) {
+    ++*num_batches;
+    EXPECT_FALSE(batch.IsEmpty());
+    EXPECT_LE(batch.size(), batch_size);
+    for (int i = 0; i < batch.size(); ++i) {
+      datas.push_back(batch.row(i));
+    }
+  }
+  *end_status = iter->Status();
+  return datas;
+}
+
+TEST(TupleIterator, DefaultNextBatch) {
+  for (int size : {0, 1, 3, 4, 10}) {
+    for (bool error : {false, true}) {
+      std::vector<TupleData> values;
+      for (int i = 0; i < size; ++i) {
+        values.push_back(CreateTupleDataFromValues({Int64(i)}));
+      }
+      zetasql_base::Status expected_end_status;
+      if (error) {
+        expected_end_status = zetasql_base::OutOfRangeErrorBuilder()
+                              << "Some evaluation error";
+      }
+      TestTupleIterator iter(std::vector<VariableId>{VariableId("foo")},
+                             values, /*preserves_order=*/true,
+                             expected_end_status);
+
+      zetasql_base::Status end_status;
+      int num_batches;
+      const std::vector<TupleData> output =
+          ReadBatchesFull(&iter, /*batch_size=*/4, &end_status, &num_batches);
+      EXPECT_EQ(end_status, expected_end_status);
+      if (error) continue;
+      EXPECT_EQ(num_batches, (size + 3) / 4);
+      ASSERT_EQ(output.size(), size);
+      for (int i = 0; i < size; ++i) {
+        EXPECT_EQ(output[i].slot(0).value(), Int64(i));
+      }
+    }
+  }
+}
+
+TEST(BatchedTupleIterator, Next) {
+  std::vector<TupleData> values;
+  for (int i = 0; i < 5; ++i) {
+    values.push_back(CreateTupleDataFromValues({Int64(i)}));
+  }
+  auto test_iter = absl::make_unique<TestTupleIterator>(
+      std::vector<VariableId>{VariableId("foo")}, values,
+      /*preserves_order=*/true, zetasql_base::OkStatus());
+  BatchedTupleIterator iter(std::move(test_iter), /*batch_size=*/2);
+  EXPECT_EQ(iter.DebugString(), "BatchedTupleIterator(TestTupleIterator)");
+  EXPECT_TRUE(iter.PreservesOrder());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> output,
+                       ReadFromTupleIterator(&iter));
+  ASSERT_EQ(output.size(), values.size());
+  for (int i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(output[i].slot(0).value(), Int64(i));
+  }
+}
+
+TEST(BatchedTupleIterator, NextFails) {
+  const std::vector<TupleData> values = {CreateTupleDataFromValues({Int64(1)})};
+  auto test_iter = absl::make_unique<TestTupleIterator>(
+      std::vector<VariableId>{VariableId("foo")}, values,
+      /*preserves_order=*/true,
+      zetasql_base::InternalErrorBuilder() << "Iterator failure");
+  BatchedTupleIterator iter(std::move(test_iter), /*batch_size=*/16);
+  EXPECT_TRUE(iter.Next() == nullptr);
+  EXPECT_THAT(iter.Status(),
+              StatusIs(zetasql_base::INTERNAL, "Iterator failure"));
+}
+
 }  // namespace
 }  // namespace zetasql
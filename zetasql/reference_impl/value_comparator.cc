@@ -0,0 +1,125 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/value_comparator.h"
+
+#include <cmath>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace zetasql {
+
+namespace {
+
+template <typename T>
+int CompareValues(const T& x, const T& y) {
+  return x < y ? -1 : (y < x ? 1 : 0);
+}
+
+template <typename Float>
+int CompareFloatingPointValues(Float x, Float y) {
+  if (std::isnan(x)) return std::isnan(y) ? 0 : -1;
+  if (std::isnan(y)) return 1;
+  return CompareValues(x, y);
+}
+
+int CompareInt32(const Value& v1, const Value& v2) {
+  return CompareValues(v1.int32_value(), v2.int32_value());
+}
+
+int CompareInt64(const Value& v1, const Value& v2) {
+  return CompareValues(v1.int64_value(), v2.int64_value());
+}
+
+int CompareUint32(const Value& v1, const Value& v2) {
+  return CompareValues(v1.uint32_value(), v2.uint32_value());
+}
+
+int CompareUint64(const Value& v1, const Value& v2) {
+  return CompareValues(v1.uint64_value(), v2.uint64_value());
+}
+
+int CompareBool(const Value& v1, const Value& v2) {
+  return CompareValues(v1.bool_value(), v2.bool_value());
+}
+
+int CompareDate(const Value& v1, const Value& v2) {
+  return CompareValues(v1.date_value(), v2.date_value());
+}
+
+int CompareFloat(const Value& v1, const Value& v2) {
+  return CompareFloatingPointValues(v1.float_value(), v2.float_value());
+}
+
+int CompareDouble(const Value& v1, const Value& v2) {
+  return CompareFloatingPointValues(v1.double_value(), v2.double_value());
+}
+
+int CompareString(const Value& v1, const Value& v2) {
+  return v1.string_view_value().compare(v2.string_view_value());
+}
+
+int CompareBytes(const Value& v1, const Value& v2) {
+  return v1.bytes_view_value().compare(v2.bytes_view_value());
+}
+
+int CompareTimestamp(const Value& v1, const Value& v2) {
+  return CompareValues(v1.ToTime(), v2.ToTime());
+}
+
+int CompareGeneric(const Value& v1, const Value& v2) {
+  if (v1.Equals(v2)) return 0;
+  return v1.LessThan(v2) ? -1 : 1;
+}
+
+}  // namespace
+
+ValueComparator GetPrimitiveValueComparator(const Type* type) {
+  switch (type->kind()) {
+    case TYPE_INT32:
+      return &CompareInt32;
+    case TYPE_INT64:
+      return &CompareInt64;
+    case TYPE_UINT32:
+      return &CompareUint32;
+    case TYPE_UINT64:
+      return &CompareUint64;
+    case TYPE_BOOL:
+      return &CompareBool;
+    case TYPE_DATE:
+      return &CompareDate;
+    case TYPE_FLOAT:
+      return &CompareFloat;
+    case TYPE_DOUBLE:
+      return &CompareDouble;
+    case TYPE_STRING:
+      return &CompareString;
+    case TYPE_BYTES:
+      return &CompareBytes;
+    case TYPE_TIMESTAMP:
+      return &CompareTimestamp;
+    default:
+      return nullptr;
+  }
+}
+
+ValueComparator GetValueComparator(const Type* type) {
+  const ValueComparator comparator = GetPrimitiveValueComparator(type);
+  return comparator != nullptr ? comparator : &CompareGeneric;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,44 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_REFERENCE_IMPL_VALUE_COMPARATOR_H_
+#define ZETASQL_REFERENCE_IMPL_VALUE_COMPARATOR_H_
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+
+namespace zetasql {
+
+// Compares two non-NULL values of the same type consistently with
+// Value::Equals() and Value::LessThan(). Returns a negative number if 'v1' is
+// less than 'v2', zero if they are equal, and a positive number otherwise.
+// NaNs are equal to each other and less than all other floating point values.
+using ValueComparator = int (*)(const Value& v1, const Value& v2);
+
+// Returns a ValueComparator for 'type' that compares the primitive values
+// directly, without dispatching on the type kind of every value, or nullptr
+// if 'type' is not one of the integer types, BOOL, DATE, FLOAT, DOUBLE,
+// STRING, BYTES or TIMESTAMP.
+ValueComparator GetPrimitiveValueComparator(const Type* type);
+
+// Returns GetPrimitiveValueComparator(type) if it is not nullptr, and
+// otherwise a ValueComparator that calls Value::Equals() and
+// Value::LessThan().
+ValueComparator GetValueComparator(const Type* type);
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_VALUE_COMPARATOR_H_
@@ -0,0 +1,107 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/value_comparator.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace zetasql {
+namespace {
+
+// Checks that 'comparator' orders every pair of 'values' like
+// Value::Equals() and Value::LessThan().
+void ExpectConsistentWithLessThan(ValueComparator comparator,
+                                  const std::vector<Value>& values) {
+  for (const Value& v1 : values) {
+    for (const Value& v2 : values) {
+      const int result = comparator(v1, v2);
+      EXPECT_EQ(result == 0, v1.Equals(v2))
+          << v1.DebugString() << " " << v2.DebugString();
+      EXPECT_EQ(result < 0, v1.LessThan(v2))
+          << v1.DebugString() << " " << v2.DebugString();
+    }
+  }
+}
+
+TEST(ValueComparatorTest, PrimitiveTypes) {
+  EXPECT_NE(GetPrimitiveValueComparator(types::Int64Type()), nullptr);
+  EXPECT_NE(GetPrimitiveValueComparator(types::DoubleType()), nullptr);
+  EXPECT_NE(GetPrimitiveValueComparator(types::StringType()), nullptr);
+  EXPECT_NE(GetPrimitiveValueComparator(types::TimestampType()), nullptr);
+  EXPECT_EQ(GetPrimitiveValueComparator(types::NumericType()), nullptr);
+  EXPECT_EQ(GetPrimitiveValueComparator(types::Int64ArrayType()), nullptr);
+  EXPECT_NE(GetValueComparator(types::Int64ArrayType()), nullptr);
+}
+
+TEST(ValueComparatorTest, Int64) {
+  ExpectConsistentWithLessThan(
+      GetValueComparator(types::Int64Type()),
+      {Value::Int64(std::numeric_limits<int64_t>::min()), Value::Int64(-1),
+       Value::Int64(0), Value::Int64(1),
+       Value::Int64(std::numeric_limits<int64_t>::max())});
+}
+
+TEST(ValueComparatorTest, Double) {
+  const double kNaN = std::numeric_limits<double>::quiet_NaN();
+  const double kInf = std::numeric_limits<double>::infinity();
+  ExpectConsistentWithLessThan(
+      GetValueComparator(types::DoubleType()),
+      {Value::Double(kNaN), Value::Double(-kInf), Value::Double(-1.5),
+       Value::Double(-0.0), Value::Double(0.0), Value::Double(2),
+       Value::Double(kInf)});
+  ExpectConsistentWithLessThan(
+      GetValueComparator(types::FloatType()),
+      {Value::Float(std::nanf("")), Value::Float(-1), Value::Float(0),
+       Value::Float(1)});
+}
+
+TEST(ValueComparatorTest, String) {
+  ExpectConsistentWithLessThan(
+      GetValueComparator(types::StringType()),
+      {Value::String(""), Value::String("a"), Value::String("ab"),
+       Value::String("b"), Value::String("\xc3\xa9")});
+  ExpectConsistentWithLessThan(
+      GetValueComparator(types::BytesType()),
+      {Value::Bytes(""), Value::Bytes(std::string("\0", 1)),
+       Value::Bytes("\xff")});
+}
+
+TEST(ValueComparatorTest, Timestamp) {
+  const absl::Time epoch = absl::UnixEpoch();
+  ExpectConsistentWithLessThan(
+      GetValueComparator(types::TimestampType()),
+      {Value::Timestamp(epoch - absl::Nanoseconds(1)),
+       Value::Timestamp(epoch), Value::Timestamp(epoch + absl::Nanoseconds(1)),
+       Value::Timestamp(epoch + absl::Seconds(1))});
+}
+
+TEST(ValueComparatorTest, Generic) {
+  ExpectConsistentWithLessThan(
+      GetValueComparator(types::Int64ArrayType()),
+      {values::Int64Array({}), values::Int64Array({1}),
+       values::Int64Array({1, 2}), values::Int64Array({2})});
+}
+
+}  // namespace
+}  // namespace zetasql
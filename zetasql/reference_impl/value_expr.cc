@@ -43,8 +43,12 @@
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
 #include "zetasql/reference_impl/evaluation.h"
+#include "zetasql/reference_impl/evaluator_metrics.h"
+#include "zetasql/reference_impl/in_list_set.h"
 #include "zetasql/reference_impl/operator.h"
+#include "zetasql/reference_impl/parallel.h"
 #include "zetasql/reference_impl/parameters.h"
+#include "zetasql/reference_impl/spill.h"
 #include "zetasql/reference_impl/tuple.h"
 #include "zetasql/reference_impl/variable_id.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
@@ -358,6 +362,10 @@ bool ArrayNestExpr::Eval(absl::Span<const TupleData* const> params,
   // If we fail early, return the accumulated bytes.
   auto cleanup = zetasql_base::MakeCleanup(return_bytes);
   int64_t output_byte_size = 0;  // Valid if 'is_with_table_' is false.
+  // The last element is replaced by each tuple of 'iter'.
+  std::vector<const TupleData*> params_and_tuple(params.begin(), params.end());
+  params_and_tuple.push_back(nullptr);
+  std::shared_ptr<TupleSlot::SharedProtoState> element_shared_state;
   while (true) {
     const TupleData* tuple = iter->Next();
     if (tuple == nullptr) {
@@ -366,12 +374,17 @@ bool ArrayNestExpr::Eval(absl::Span<const TupleData* const> params,
       break;
     }
 
-    TupleSlot slot;
-    if (!element()->EvalSimple(ConcatSpans(params, {tuple}), context, &slot,
-                               status)) {
+    // Evaluates the element directly into 'output'. It is removed again
+    // before returning an error, so that 'cleanup' only sees the elements
+    // whose bytes were requested.
+    params_and_tuple.back() = tuple;
+    output.emplace_back();
+    Value& value = output.back();
+    VirtualTupleSlot element_result(&value, &element_shared_state);
+    if (!element()->Eval(params_and_tuple, context, &element_result, status)) {
+      output.pop_back();
       return false;
     }
-    Value& value = *slot.mutable_value();
 
     // Check for memory usage. See the comment for 'accountant' above.
     if (accountant == nullptr) {
@@ -380,15 +393,15 @@ bool ArrayNestExpr::Eval(absl::Span<const TupleData* const> params,
         *status = zetasql_base::OutOfRangeErrorBuilder()
                   << "Cannot construct array Value larger than "
                   << context->options().max_value_byte_size << " bytes";
+        output.pop_back();
         return false;
       }
     } else {
       if (!accountant->RequestBytes(value.physical_byte_size(), status)) {
+        output.pop_back();
         return false;
       }
     }
-
-    output.push_back(std::move(value));
   }
 
   // Free the memory. Ideally we would not do this here and instead do it when
@@ -429,6 +442,103 @@ RelationalOp* ArrayNestExpr::mutable_input() {
   return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
 }
 
+// -------------------------------------------------------
+// MaterializeWithTableExpr
+// -------------------------------------------------------
+
+::zetasql_base::StatusOr<std::unique_ptr<MaterializeWithTableExpr>>
+MaterializeWithTableExpr::Create(const VariableId& with_table,
+                                 std::vector<VariableId> columns,
+                                 std::unique_ptr<RelationalOp> input) {
+  ZETASQL_RET_CHECK(with_table.is_valid());
+  return absl::WrapUnique(new MaterializeWithTableExpr(
+      with_table, std::move(columns), std::move(input)));
+}
+
+::zetasql_base::Status MaterializeWithTableExpr::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  ZETASQL_RETURN_IF_ERROR(mutable_input()->SetSchemasForEvaluation(params_schemas));
+  const std::unique_ptr<const TupleSchema> input_schema =
+      input()->CreateOutputSchema();
+  column_slot_idxs_.clear();
+  column_slot_idxs_.reserve(columns_.size());
+  for (const VariableId& column : columns_) {
+    const absl::optional<int> slot_idx =
+        input_schema->FindIndexForVariable(column);
+    ZETASQL_RET_CHECK(slot_idx.has_value()) << column;
+    column_slot_idxs_.push_back(slot_idx.value());
+  }
+  return zetasql_base::OkStatus();
+}
+
+bool MaterializeWithTableExpr::Eval(absl::Span<const TupleData* const> params,
+                                    EvaluationContext* context,
+                                    VirtualTupleSlot* result,
+                                    ::zetasql_base::Status* status) const {
+  auto status_or_iter =
+      input()->CreateIterator(params, /*num_extra_slots=*/0, context);
+  if (!status_or_iter.ok()) {
+    *status = status_or_iter.status();
+    return false;
+  }
+  std::unique_ptr<TupleIterator> iter = std::move(status_or_iter).ValueOrDie();
+  const bool iter_originally_preserved_order = iter->PreservesOrder();
+  // Same as for ArrayNestExpr with 'is_with_table' true.
+  *status = iter->DisableReordering();
+  if (!status->ok()) return false;
+
+  auto table = std::make_shared<SharedTupleBuffer>(context);
+  table->set_preserves_order(iter_originally_preserved_order);
+  while (true) {
+    const TupleData* tuple = iter->Next();
+    if (tuple == nullptr) {
+      *status = iter->Status();
+      if (!status->ok()) return false;
+      break;
+    }
+    auto row = absl::make_unique<TupleData>(columns_.size());
+    for (int i = 0; i < column_slot_idxs_.size(); ++i) {
+      *row->mutable_slot(i) = tuple->slot(column_slot_idxs_[i]);
+    }
+    if (!table->PushBack(std::move(row), status)) return false;
+  }
+  *status = table->Finish();
+  if (!status->ok()) return false;
+
+  result->SetValue(Value::Int64(table->GetSize()));
+  context->SetWithTable(with_table_, std::move(table));
+  return true;
+}
+
+std::string MaterializeWithTableExpr::DebugInternal(const std::string& indent,
+                                                    bool verbose) const {
+  std::vector<std::string> column_strs;
+  column_strs.reserve(columns_.size());
+  for (const VariableId& column : columns_) {
+    column_strs.push_back(column.ToString());
+  }
+  return absl::StrCat("MaterializeWithTableExpr(", with_table_.ToString(),
+                      ", columns=(", absl::StrJoin(column_strs, ", "), ")",
+                      ArgDebugString({"input"}, {k1}, indent, verbose), ")");
+}
+
+MaterializeWithTableExpr::MaterializeWithTableExpr(
+    const VariableId& with_table, std::vector<VariableId> columns,
+    std::unique_ptr<RelationalOp> input)
+    : ValueExpr(types::Int64Type()),
+      with_table_(with_table),
+      columns_(std::move(columns)) {
+  SetArg(kInput, absl::make_unique<RelationalArg>(std::move(input)));
+}
+
+const RelationalOp* MaterializeWithTableExpr::input() const {
+  return GetArg(kInput)->node()->AsRelationalOp();
+}
+
+RelationalOp* MaterializeWithTableExpr::mutable_input() {
+  return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
+}
+
 // -------------------------------------------------------
 // DerefExpr
 // -------------------------------------------------------
@@ -506,6 +616,57 @@ ConstExpr::ConstExpr(const Value& value) : ValueExpr(value.type()) {
   slot_.SetValue(value);
 }
 
+// -------------------------------------------------------
+// CachedExpr
+// -------------------------------------------------------
+
+::zetasql_base::StatusOr<std::unique_ptr<CachedExpr>> CachedExpr::Create(
+    std::unique_ptr<ValueExpr> expr) {
+  return absl::WrapUnique(new CachedExpr(std::move(expr)));
+}
+
+::zetasql_base::Status CachedExpr::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  return mutable_expr()->SetSchemasForEvaluation(params_schemas);
+}
+
+bool CachedExpr::Eval(absl::Span<const TupleData* const> params,
+                      EvaluationContext* context, VirtualTupleSlot* result,
+                      ::zetasql_base::Status* status) const {
+  const Value* cached_value = context->GetCachedValue(this);
+  if (cached_value != nullptr) {
+    result->SetValue(*cached_value);
+    return true;
+  }
+  TupleSlot slot;
+  if (!expr()->EvalSimple(params, context, &slot, status)) {
+    return false;
+  }
+  context->SetCachedValue(this, slot.value());
+  result->SetValueAndMaybeSharedProtoState(std::move(*slot.mutable_value()),
+                                           slot.mutable_shared_proto_state());
+  return true;
+}
+
+std::string CachedExpr::DebugInternal(const std::string& indent,
+                                      bool verbose) const {
+  return absl::StrCat("CachedExpr(", expr()->DebugInternal(indent, verbose),
+                      ")");
+}
+
+CachedExpr::CachedExpr(std::unique_ptr<ValueExpr> expr)
+    : ValueExpr(expr->output_type()) {
+  SetArg(kExpr, absl::make_unique<ExprArg>(std::move(expr)));
+}
+
+const ValueExpr* CachedExpr::expr() const {
+  return GetArg(kExpr)->node()->AsValueExpr();
+}
+
+ValueExpr* CachedExpr::mutable_expr() {
+  return GetMutableArg(kExpr)->mutable_node()->AsMutableValueExpr();
+}
+
 // -------------------------------------------------------
 // FieldValueExpr
 // -------------------------------------------------------
@@ -530,7 +691,23 @@ static ::zetasql_base::StatusOr<int> GetFieldIndex(const StructType* type,
 
 ::zetasql_base::StatusOr<std::unique_ptr<FieldValueExpr>> FieldValueExpr::Create(
     int field_index, std::unique_ptr<ValueExpr> expr) {
-  return absl::WrapUnique(new FieldValueExpr(field_index, std::move(expr)));
+  ZETASQL_RET_CHECK(expr->output_type()->IsStruct());
+  const StructType* struct_type = expr->output_type()->AsStruct();
+  ZETASQL_RET_CHECK_GE(field_index, 0);
+  ZETASQL_RET_CHECK_LT(field_index, struct_type->num_fields());
+  std::vector<int> field_path;
+  if (auto* field_expr = dynamic_cast<FieldValueExpr*>(expr.get())) {
+    // Absorb the inner FieldValueExpr, which has already absorbed its own
+    // FieldValueExpr input, if any.
+    field_path = std::move(field_expr->field_path_);
+    std::unique_ptr<AlgebraNode> input =
+        field_expr->GetMutableArg(kStruct)->release_node();
+    expr = absl::WrapUnique(input.release()->AsMutableValueExpr());
+  }
+  field_path.push_back(field_index);
+  return absl::WrapUnique(new FieldValueExpr(
+      std::move(field_path), struct_type->field(field_index).type,
+      std::move(expr)));
 }
 
 ::zetasql_base::Status FieldValueExpr::SetSchemasForEvaluation(
@@ -542,28 +719,52 @@ bool FieldValueExpr::Eval(absl::Span<const TupleData* const> params,
                           EvaluationContext* context, VirtualTupleSlot* result,
                           ::zetasql_base::Status* status) const {
   TupleSlot struct_slot;
-  if (!input()->EvalSimple(params, context, &struct_slot, status)) {
-    return false;
+  const TupleSlot* base_slot;
+  if (deref_input_ != nullptr) {
+    base_slot =
+        &params[deref_input_->idx_in_params()]->slot(deref_input_->slot());
+  } else {
+    if (!input()->EvalSimple(params, context, &struct_slot, status)) {
+      return false;
+    }
+    base_slot = &struct_slot;
+  }
+  // Only the accessed field is copied; the structs along the path are read in
+  // place.
+  const Value* value = &base_slot->value();
+  for (const int field_index : field_path_) {
+    if (value->is_null()) {
+      result->SetValue(Value::Null(output_type()));
+      return true;
+    }
+    value = &value->field(field_index);
   }
-  const Value& struct_value = struct_slot.value();
-  Value field_value = struct_value.is_null()
-                          ? Value::Null(output_type())
-                          : struct_value.field(field_index());
   result->SetValueAndMaybeSharedProtoState(
-      std::move(field_value), struct_slot.mutable_shared_proto_state());
+      Value(*value), base_slot->mutable_shared_proto_state());
   return true;
 }
 
 std::string FieldValueExpr::DebugInternal(const std::string& indent,
                                           bool verbose) const {
-  return absl::StrCat("FieldValueExpr(", field_index(), ":", field_name(), ", ",
-                      input()->DebugInternal(indent, verbose), ")");
-}
-
-FieldValueExpr::FieldValueExpr(int field_index, std::unique_ptr<ValueExpr> expr)
-    : ValueExpr(expr->output_type()->AsStruct()->field(field_index).type),
-      field_name_(expr->output_type()->AsStruct()->field(field_index).name),
-      field_index_(field_index) {
+  // Prints the path as nested FieldValueExprs, outermost field last.
+  std::string prefix;
+  const StructType* struct_type = input()->output_type()->AsStruct();
+  for (int i = 0; i < field_path_.size(); ++i) {
+    const StructType::StructField& field = struct_type->field(field_path_[i]);
+    prefix = absl::StrCat("FieldValueExpr(", field_path_[i], ":", field.name,
+                          ", ", prefix);
+    if (i + 1 < field_path_.size()) struct_type = field.type->AsStruct();
+  }
+  return absl::StrCat(prefix, input()->DebugInternal(indent, verbose),
+                      std::string(field_path_.size(), ')'));
+}
+
+FieldValueExpr::FieldValueExpr(std::vector<int> field_path,
+                               const Type* output_type,
+                               std::unique_ptr<ValueExpr> expr)
+    : ValueExpr(output_type),
+      field_path_(std::move(field_path)),
+      deref_input_(dynamic_cast<const DerefExpr*>(expr.get())) {
   SetArg(kStruct, absl::make_unique<ExprArg>(std::move(expr)));
 }
 
@@ -608,6 +809,7 @@ bool ProtoFieldReader::GetFieldValue(const TupleSlot& proto_slot,
   ProtoFieldValueMapKey value_map_key;
   value_map_key.proto_rep = InternalValue::GetProtoRep(proto_value);
   value_map_key.registry = registry_;
+  value_map_key.deferred = registry_->IsDeferredField(access_info_registry_id_);
 
   // We store the ProtoFieldValueList in 'shared_state' if
   // EvaluationOptions::store_proto_field_value_maps is true. Otherwise,
@@ -625,23 +827,51 @@ bool ProtoFieldReader::GetFieldValue(const TupleSlot& proto_slot,
     context->set_last_get_field_value_call_read_fields_from_proto(this, true);
     context->set_num_proto_deserializations(
         context->num_proto_deserializations() + 1);
-
+    GetEvaluatorMetrics().proto_deserializations.Increment();
+
+    // If 'registry_' has deferred fields, only read the fields that are in
+    // the same group as the field of this reader. Their values are still
+    // stored at their index in the registry, so the ProtoFieldValueList for
+    // each group has an entry for every registered field.
+    const std::vector<const ProtoFieldAccessInfo*>& registered_fields =
+        registry_->GetRegisteredFields();
     std::vector<const ProtoFieldInfo*> field_infos;
-    field_infos.reserve(registry_->GetRegisteredFields().size());
-    for (const ProtoFieldAccessInfo* access_info :
-         registry_->GetRegisteredFields()) {
-      field_infos.push_back(&access_info->field_info);
+    std::vector<int> field_indexes;
+    field_infos.reserve(registered_fields.size());
+    for (int i = 0; i < registered_fields.size(); ++i) {
+      if (registry_->IsDeferredField(i) == value_map_key.deferred) {
+        field_infos.push_back(&registered_fields[i]->field_info);
+        field_indexes.push_back(i);
+      }
     }
 
     value_list_owner = absl::make_unique<ProtoFieldValueList>();
     value_list = value_list_owner.get();
 
-    const ::zetasql_base::Status read_status = ReadProtoFields(
-        field_infos, proto_value.ToCord(), value_list_owner.get());
+    ProtoFieldValueList read_values;
+    ProtoFieldValueList* read_value_list = registry_->has_eager_fields()
+                                               ? &read_values
+                                               : value_list_owner.get();
+    const ::zetasql_base::Status read_status =
+        ReadProtoFields(field_infos, proto_value.ToCord(), read_value_list);
     if (!read_status.ok()) {
       *status = read_status;
       return false;
     }
+    if (registry_->has_eager_fields()) {
+      value_list_owner->resize(registered_fields.size());
+      for (int i = 0; i < read_values.size(); ++i) {
+        (*value_list_owner)[field_indexes[i]] = std::move(read_values[i]);
+      }
+    }
+
+    int64_t num_bytes_decoded = 0;
+    for (const ::zetasql_base::StatusOr<Value>& read_value : *value_list) {
+      if (read_value.ok()) {
+        num_bytes_decoded += read_value.ValueOrDie().physical_byte_size();
+      }
+    }
+    context->add_num_proto_field_bytes_decoded(num_bytes_decoded);
 
     // Store 'value_list' in 'proto_slot' if
     // EvaluationOptions::store_proto_field_value_maps is true.
@@ -727,6 +957,207 @@ std::string GetProtoFieldExpr::DebugInternal(const std::string& indent,
       "])");
 }
 
+// -------------------------------------------------------
+// MemoizedSubqueryExpr
+// -------------------------------------------------------
+
+::zetasql_base::StatusOr<std::unique_ptr<MemoizedSubqueryExpr>>
+MemoizedSubqueryExpr::Create(std::vector<std::unique_ptr<ValueExpr>> keys,
+                             std::unique_ptr<ValueExpr> subquery) {
+  for (const std::unique_ptr<ValueExpr>& key : keys) {
+    ZETASQL_RET_CHECK(key->output_type()->IsSimpleType() &&
+              !key->output_type()->IsFloatingPoint())
+        << key->output_type()->DebugString();
+  }
+  return absl::WrapUnique(
+      new MemoizedSubqueryExpr(std::move(keys), std::move(subquery)));
+}
+
+::zetasql_base::Status MemoizedSubqueryExpr::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  for (ExprArg* key : mutable_keys()) {
+    ZETASQL_RETURN_IF_ERROR(
+        key->mutable_value_expr()->SetSchemasForEvaluation(params_schemas));
+  }
+  return mutable_subquery()->SetSchemasForEvaluation(params_schemas);
+}
+
+bool MemoizedSubqueryExpr::Eval(absl::Span<const TupleData* const> params,
+                                EvaluationContext* context,
+                                VirtualTupleSlot* result,
+                                ::zetasql_base::Status* status) const {
+  std::vector<Value> key_values;
+  key_values.reserve(keys().size());
+  for (const ExprArg* key : keys()) {
+    TupleSlot slot;
+    if (!key->value_expr()->EvalSimple(params, context, &slot, status)) {
+      return false;
+    }
+    key_values.push_back(std::move(*slot.mutable_value()));
+  }
+  const Value* memoized_value =
+      context->GetMemoizedSubqueryValue(this, key_values);
+  if (memoized_value != nullptr) {
+    result->SetValue(*memoized_value);
+    return true;
+  }
+
+  TupleSlot slot;
+  if (!subquery()->EvalSimple(params, context, &slot, status)) {
+    return false;
+  }
+  context->MemoizeSubqueryValue(this, std::move(key_values), slot.value());
+  result->SetValueAndMaybeSharedProtoState(std::move(*slot.mutable_value()),
+                                           slot.mutable_shared_proto_state());
+  return true;
+}
+
+std::string MemoizedSubqueryExpr::DebugInternal(const std::string& indent,
+                                                bool verbose) const {
+  return absl::StrCat(
+      "MemoizedSubqueryExpr(",
+      ArgDebugString({"keys", "subquery"}, {kN, k1}, indent, verbose), ")");
+}
+
+MemoizedSubqueryExpr::MemoizedSubqueryExpr(
+    std::vector<std::unique_ptr<ValueExpr>> keys,
+    std::unique_ptr<ValueExpr> subquery)
+    : ValueExpr(subquery->output_type()) {
+  std::vector<std::unique_ptr<ExprArg>> key_args;
+  key_args.reserve(keys.size());
+  for (std::unique_ptr<ValueExpr>& key : keys) {
+    key_args.push_back(absl::make_unique<ExprArg>(std::move(key)));
+  }
+  SetArgs<ExprArg>(kKey, std::move(key_args));
+  SetArg(kSubquery, absl::make_unique<ExprArg>(std::move(subquery)));
+}
+
+absl::Span<const ExprArg* const> MemoizedSubqueryExpr::keys() const {
+  return GetArgs<ExprArg>(kKey);
+}
+
+absl::Span<ExprArg* const> MemoizedSubqueryExpr::mutable_keys() {
+  return GetMutableArgs<ExprArg>(kKey);
+}
+
+const ValueExpr* MemoizedSubqueryExpr::subquery() const {
+  return GetArg(kSubquery)->node()->AsValueExpr();
+}
+
+ValueExpr* MemoizedSubqueryExpr::mutable_subquery() {
+  return GetMutableArg(kSubquery)->mutable_node()->AsMutableValueExpr();
+}
+
+// -------------------------------------------------------
+// InListExpr
+// -------------------------------------------------------
+
+::zetasql_base::StatusOr<std::unique_ptr<InListExpr>> InListExpr::Create(
+    Kind kind, std::unique_ptr<ValueExpr> value,
+    std::vector<std::unique_ptr<ValueExpr>> elements) {
+  ZETASQL_RET_CHECK(InListSet::SupportsType(value->output_type()))
+      << value->output_type()->DebugString();
+  if (kind == kArray) {
+    ZETASQL_RET_CHECK_EQ(elements.size(), 1);
+    ZETASQL_RET_CHECK(elements[0]->output_type()->IsArray());
+    const Type* element_type =
+        elements[0]->output_type()->AsArray()->element_type();
+    ZETASQL_RET_CHECK(element_type->Equals(value->output_type()));
+  } else {
+    for (const std::unique_ptr<ValueExpr>& element : elements) {
+      ZETASQL_RET_CHECK(element->output_type()->Equals(value->output_type()));
+    }
+  }
+  return absl::WrapUnique(
+      new InListExpr(kind, std::move(value), std::move(elements)));
+}
+
+::zetasql_base::Status InListExpr::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  for (ExprArg* element : mutable_elements()) {
+    ZETASQL_RETURN_IF_ERROR(
+        element->mutable_value_expr()->SetSchemasForEvaluation(params_schemas));
+  }
+  return mutable_value()->SetSchemasForEvaluation(params_schemas);
+}
+
+bool InListExpr::Eval(absl::Span<const TupleData* const> params,
+                      EvaluationContext* context, VirtualTupleSlot* result,
+                      ::zetasql_base::Status* status) const {
+  const zetasql_base::StatusOr<const InListSet*> set = GetSet(params, context);
+  if (!set.ok()) {
+    *status = set.status();
+    return false;
+  }
+  TupleSlot slot;
+  if (!value()->EvalSimple(params, context, &slot, status)) return false;
+  result->SetValue(set.ValueOrDie()->Contains(slot.value()));
+  return true;
+}
+
+::zetasql_base::StatusOr<const InListSet*> InListExpr::GetSet(
+    absl::Span<const TupleData* const> params,
+    EvaluationContext* context) const {
+  const InListSet* set = context->GetInListSet(this);
+  if (set != nullptr) return set;
+
+  std::vector<Value> values;
+  for (const ExprArg* element : elements()) {
+    TupleSlot slot;
+    ::zetasql_base::Status status;
+    if (!element->value_expr()->EvalSimple(params, context, &slot, &status)) {
+      return status;
+    }
+    Value value = InternalValue::CopyOutOfArena(slot.value());
+    if (kind_ == kList) {
+      values.push_back(std::move(value));
+    } else if (!value.is_null()) {
+      values = value.elements();
+    }
+  }
+  auto new_set = std::make_shared<const InListSet>(values);
+  set = new_set.get();
+  context->SetInListSet(this, std::move(new_set));
+  return set;
+}
+
+std::string InListExpr::DebugInternal(const std::string& indent,
+                                      bool verbose) const {
+  return absl::StrCat(
+      "InListExpr(",
+      ArgDebugString({"value", kind_ == kList ? "list" : "array"}, {k1, kN},
+                     indent, verbose),
+      ")");
+}
+
+InListExpr::InListExpr(Kind kind, std::unique_ptr<ValueExpr> value,
+                       std::vector<std::unique_ptr<ValueExpr>> elements)
+    : ValueExpr(types::BoolType()), kind_(kind) {
+  SetArg(kValue, absl::make_unique<ExprArg>(std::move(value)));
+  std::vector<std::unique_ptr<ExprArg>> element_args;
+  element_args.reserve(elements.size());
+  for (std::unique_ptr<ValueExpr>& element : elements) {
+    element_args.push_back(absl::make_unique<ExprArg>(std::move(element)));
+  }
+  SetArgs<ExprArg>(kElement, std::move(element_args));
+}
+
+const ValueExpr* InListExpr::value() const {
+  return GetArg(kValue)->node()->AsValueExpr();
+}
+
+ValueExpr* InListExpr::mutable_value() {
+  return GetMutableArg(kValue)->mutable_node()->AsMutableValueExpr();
+}
+
+absl::Span<const ExprArg* const> InListExpr::elements() const {
+  return GetArgs<ExprArg>(kElement);
+}
+
+absl::Span<ExprArg* const> InListExpr::mutable_elements() {
+  return GetMutableArgs<ExprArg>(kElement);
+}
+
 // -------------------------------------------------------
 // SingleValueExpr
 // -------------------------------------------------------
@@ -869,6 +1300,25 @@ RelationalOp* ExistsExpr::mutable_input() {
   return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
 }
 
+// -------------------------------------------------------
+// ScalarFunctionBody
+// -------------------------------------------------------
+
+bool ScalarFunctionBody::EvalBatch(absl::Span<const Value> args,
+                                   EvaluationContext* context,
+                                   absl::Span<Value> results,
+                                   ::zetasql_base::Status* status) const {
+  if (results.empty()) return true;
+  const int num_args = args.size() / results.size();
+  for (int i = 0; i < results.size(); ++i) {
+    if (!Eval(args.subspan(i * num_args, num_args), context, &results[i],
+              status)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // -------------------------------------------------------
 // ScalarFunctionCallExpr
 // -------------------------------------------------------
@@ -907,6 +1357,7 @@ bool ScalarFunctionCallExpr::Eval(absl::Span<const TupleData* const> params,
     }
   }
 
+  context->RecordFunctionCalls(1);
   if (!function_->Eval(call_args, context, result->mutable_value(), status)) {
     if (ShouldSuppressError(*status, error_mode_)) {
       *status = ::zetasql_base::OkStatus();
@@ -919,6 +1370,53 @@ bool ScalarFunctionCallExpr::Eval(absl::Span<const TupleData* const> params,
   return true;
 }
 
+bool ScalarFunctionCallExpr::EvalBatch(
+    absl::Span<const TupleData* const> params, int slot_idx,
+    EvaluationContext* context, TupleBatch* batch,
+    ::zetasql_base::Status* status) const {
+  const auto& args = GetArgs();
+  const int num_rows = batch->size();
+  std::vector<const TupleData*> params_and_row(params.begin(), params.end());
+  params_and_row.push_back(nullptr);
+  std::vector<Value> call_args(num_rows * args.size());
+  for (int row = 0; row < num_rows; ++row) {
+    params_and_row.back() = &batch->row(row);
+    for (int i = 0; i < args.size(); ++i) {
+      std::shared_ptr<TupleSlot::SharedProtoState> arg_shared_state;
+      VirtualTupleSlot arg_result(&call_args[row * args.size() + i],
+                                  &arg_shared_state);
+      if (!args[i]->value_expr()->Eval(params_and_row, context, &arg_result,
+                                       status)) {
+        return false;
+      }
+    }
+  }
+
+  context->RecordFunctionCalls(num_rows);
+  std::vector<Value> results(num_rows);
+  if (!function_->EvalBatch(call_args, context, absl::MakeSpan(results),
+                            status)) {
+    if (error_mode_ == ResolvedFunctionCallBase::DEFAULT_ERROR_MODE) {
+      return false;
+    }
+    // Calls the function one row at a time to find out which rows fail.
+    const absl::Span<const Value> all_args(call_args);
+    for (int row = 0; row < num_rows; ++row) {
+      if (!function_->Eval(all_args.subspan(row * args.size(), args.size()),
+                           context, &results[row], status)) {
+        if (!ShouldSuppressError(*status, error_mode_)) return false;
+        *status = ::zetasql_base::OkStatus();
+        results[row] = Value::Null(output_type());
+      }
+    }
+  }
+  for (int row = 0; row < num_rows; ++row) {
+    VirtualTupleSlot result(batch->mutable_row(row)->mutable_slot(slot_idx));
+    result.SetValue(std::move(results[row]));
+  }
+  return true;
+}
+
 std::string ScalarFunctionCallExpr::DebugInternal(const std::string& indent,
                                                   bool verbose) const {
   std::vector<std::string> sarg;
@@ -1381,6 +1879,77 @@ DMLValueExpr::GetScannedTupleAsColumnValues(
   return t.data->slot(slot.value()).value();
 }
 
+// The minimum number of rows per thread for evaluating the WHERE clause of a
+// DML statement. Below this, the overhead of starting threads dominates.
+static constexpr int64_t kMinDMLRowsPerThread = 1024;
+
+::zetasql_base::Status DMLValueExpr::EvalWhereClause(
+    const ValueExpr& where_expr, absl::Span<const TupleData* const> params,
+    const std::vector<std::unique_ptr<TupleData>>& tuples,
+    EvaluationContext* context, std::vector<uint8_t>* matches) const {
+  matches->assign(tuples.size(), 0);
+  const int64_t num_ranges = std::max<int64_t>(
+      1, std::min<int64_t>(context->options().num_threads,
+                           tuples.size() / kMinDMLRowsPerThread));
+  const int64_t range_size = (tuples.size() + num_ranges - 1) / num_ranges;
+
+  // Evaluates the range of 'tuples' starting at 'begin' with 'range_context'.
+  auto eval_range = [&where_expr, params, &tuples, matches, range_size](
+                        int64_t begin, EvaluationContext* range_context)
+      -> zetasql_base::Status {
+    const int64_t end = std::min<int64_t>(tuples.size(), begin + range_size);
+    for (int64_t i = begin; i < end; ++i) {
+      // It is expensive to call this for every row, but this code is only
+      // used for compliance testing, so it's ok.
+      ZETASQL_RETURN_IF_ERROR(range_context->VerifyNotAborted());
+      ZETASQL_ASSIGN_OR_RETURN(const Value where_value,
+                       EvalExpr(where_expr,
+                                ConcatSpans(params, {tuples[i].get()}),
+                                range_context));
+      (*matches)[i] = (where_value == Bool(true));
+    }
+    return zetasql_base::OkStatus();
+  };
+
+  if (num_ranges == 1) return eval_range(/*begin=*/0, context);
+
+  // The threads share the memory budget of the statement.
+  const int64_t max_intermediate_byte_size =
+      context->options().max_intermediate_byte_size / num_ranges;
+  std::vector<std::unique_ptr<EvaluationContext>> child_contexts;
+  for (int i = 0; i < num_ranges; ++i) {
+    child_contexts.push_back(context->CreateChildContext(
+        max_intermediate_byte_size, /*partitioned_scan=*/nullptr,
+        /*partition_index=*/0, /*num_partitions=*/1));
+  }
+  std::vector<zetasql_base::Status> statuses(num_ranges);
+  ParallelFor(static_cast<int>(num_ranges), num_ranges,
+              [&eval_range, &child_contexts, &statuses,
+               range_size](int64_t range) {
+                statuses[range] = eval_range(range * range_size,
+                                             child_contexts[range].get());
+                if (!statuses[range].ok()) {
+                  // Stop the other ranges early.
+                  for (const auto& child : child_contexts) {
+                    child->SetCancelled();
+                  }
+                }
+              });
+  for (const std::unique_ptr<EvaluationContext>& child : child_contexts) {
+    context->MergeChildContext(*child);
+  }
+  // Prefer a real error over the cancellations caused by it.
+  for (const zetasql_base::Status& status : statuses) {
+    if (!status.ok() && status.code() != zetasql_base::StatusCode::kCancelled) {
+      return status;
+    }
+  }
+  for (const zetasql_base::Status& status : statuses) {
+    ZETASQL_RETURN_IF_ERROR(status);
+  }
+  return zetasql_base::OkStatus();
+}
+
 ::zetasql_base::Status DMLValueExpr::PopulatePrimaryKeyRowMap(
     const std::vector<std::vector<Value>>& original_rows,
     absl::string_view duplicate_primary_key_error_prefix,
@@ -1579,20 +2148,16 @@ DMLDeleteValueExpr::Create(
   std::vector<std::unique_ptr<TupleData>> tuple_datas;
   ZETASQL_RETURN_IF_ERROR(EvalRelationalOp(*relational_op, params, context,
                                    &tuple_schema, &tuple_datas));
-  for (const std::unique_ptr<TupleData>& tuple_data : tuple_datas) {
-    // It is expensive to call this for every row, but this code is only used
-    // for compliance testing, so it's ok.
-    ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
-
-    const Tuple tuple(tuple_schema.get(), tuple_data.get());
+  // The WHERE clause can reference column values and statement parameters.
+  std::vector<uint8_t> deleted_rows;
+  ZETASQL_RETURN_IF_ERROR(EvalWhereClause(*where_expr, params, tuple_datas, context,
+                                  &deleted_rows));
+  for (int64_t i = 0; i < tuple_datas.size(); ++i) {
+    const Tuple tuple(tuple_schema.get(), tuple_datas[i].get());
     ZETASQL_ASSIGN_OR_RETURN(std::vector<Value> tuple_as_values,
                      GetScannedTupleAsColumnValues(*column_list_, tuple));
 
-    // The WHERE clause can reference column values and statement parameters.
-    ZETASQL_ASSIGN_OR_RETURN(
-        const Value where_value,
-        EvalExpr(*where_expr, ConcatSpans(params, {tuple.data}), context));
-    const bool deleted = (where_value == Bool(true));
+    const bool deleted = deleted_rows[i];
     if (deleted) {
       ++num_rows_deleted;
       if (!context->options().return_all_rows_for_dml) {
@@ -1722,16 +2287,29 @@ DMLUpdateValueExpr::Create(
   std::vector<std::unique_ptr<TupleData>> tuples;
   ZETASQL_RETURN_IF_ERROR(EvalRelationalOp(*relational_op, params, context,
                                    &tuple_schema, &tuples));
-  for (const std::unique_ptr<TupleData>& tuple_data : tuples) {
-    // It is expensive to call this for every row, but this code is only used
-    // for compliance testing, so it's ok.
-    ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
-
-    const Tuple tuple(tuple_schema.get(), tuple_data.get());
+  // Without a FROM clause, the WHERE clause only depends on the row being
+  // updated, so it can be evaluated for all the rows up front.
+  std::vector<uint8_t> updated_rows;
+  if (from_tuples == nullptr) {
+    ZETASQL_RETURN_IF_ERROR(
+        EvalWhereClause(*where_expr, params, tuples, context, &updated_rows));
+  }
+  for (int64_t i = 0; i < tuples.size(); ++i) {
+    const TupleData* tuple_data = tuples[i].get();
+    const Tuple tuple(tuple_schema.get(), tuple_data);
     std::vector<const TupleData*> joined_tuple_datas;
-    ZETASQL_RETURN_IF_ERROR(GetJoinedTupleDatas(params, tuple_data.get(),
-                                        from_tuples.get(), where_expr, context,
-                                        &joined_tuple_datas));
+    if (from_tuples == nullptr) {
+      if (updated_rows[i]) {
+        joined_tuple_datas = ConcatSpans(params, {tuple_data});
+      }
+    } else {
+      // It is expensive to call this for every row, but this code is only
+      // used for compliance testing, so it's ok.
+      ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
+      ZETASQL_RETURN_IF_ERROR(GetJoinedTupleDatas(params, tuple_data,
+                                          from_tuples.get(), where_expr,
+                                          context, &joined_tuple_datas));
+    }
     if (joined_tuple_datas.empty()) {
       ZETASQL_ASSIGN_OR_RETURN(const std::vector<Value> dml_output_row,
                        GetScannedTupleAsColumnValues(*column_list_, tuple));
@@ -16,9 +16,11 @@
 
 // Tests for ValueExprs not covered by other tests.
 
+#include <limits>
 #include <memory>
 #include <set>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -495,6 +497,40 @@ TEST_F(EvalTest, FieldValueExpr) {
               IsOkAndHolds(NullInt64()));
 }
 
+TEST_F(EvalTest, FieldValueExprPath) {
+  const StructType* inner_type =
+      MakeStructType({{"a", Int64Type()}, {"b", StringType()}});
+  const StructType* outer_type =
+      MakeStructType({{"x", Int64Type()}, {"inner", inner_type}});
+  const VariableId t("t");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_t, DerefExpr::Create(t, outer_type));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto inner_op,
+                       FieldValueExpr::Create("inner", std::move(deref_t)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto field_op,
+                       FieldValueExpr::Create("b", std::move(inner_op)));
+  // The chain is a single FieldValueExpr, but it prints as the nested chain.
+  EXPECT_EQ("FieldValueExpr(1:b, FieldValueExpr(1:inner, $t))",
+            field_op->DebugString());
+  EXPECT_EQ(field_op->output_type(), StringType());
+
+  const TupleSchema schema({t});
+  ZETASQL_ASSERT_OK(field_op->SetSchemasForEvaluation({&schema}));
+  const Value inner = Struct({{"a", Int64(1)}, {"b", String("foo")}});
+  const TupleData data =
+      CreateTestTupleData({Struct({{"x", Int64(2)}, {"inner", inner}})});
+  EXPECT_THAT(EvalExpr(*field_op, {&data}), IsOkAndHolds(String("foo")));
+
+  // A NULL struct anywhere along the path makes the result NULL.
+  const TupleData null_inner_data = CreateTestTupleData(
+      {Struct({{"x", Int64(2)}, {"inner", Value::Null(inner_type)}})});
+  EXPECT_THAT(EvalExpr(*field_op, {&null_inner_data}),
+              IsOkAndHolds(NullString()));
+  const TupleData null_outer_data =
+      CreateTestTupleData({Value::Null(outer_type)});
+  EXPECT_THAT(EvalExpr(*field_op, {&null_outer_data}),
+              IsOkAndHolds(NullString()));
+}
+
 static std::unique_ptr<ValueExpr> DivByZeroErrorExpr() {
   std::vector<std::unique_ptr<ValueExpr>> div_args;
   div_args.push_back(ConstExpr::Create(Int64(1)).ValueOrDie());
@@ -536,6 +572,148 @@ TEST_F(EvalTest, IfExpr) {
   EXPECT_THAT(EvalExpr(*if_op_null, EmptyParams()), IsOkAndHolds(Int64(1)));
 }
 
+TEST_F(EvalTest, InListExpr) {
+  const VariableId x("x"), p("p");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_p, DerefExpr::Create(p, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto one_expr, ConstExpr::Create(Int64(1)));
+  std::vector<std::unique_ptr<ValueExpr>> elements;
+  elements.push_back(std::move(one_expr));
+  elements.push_back(std::move(deref_p));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto in_list,
+      InListExpr::Create(InListExpr::kList, std::move(deref_x),
+                         std::move(elements)));
+  EXPECT_EQ(
+      "InListExpr(\n"
+      "+-value: $x,\n"
+      "+-list: {\n"
+      "  +-ConstExpr(1),\n"
+      "  +-$p})",
+      in_list->DebugString());
+
+  const TupleSchema params_schema({p});
+  const TupleSchema tuple_schema({x});
+  ZETASQL_ASSERT_OK(in_list->SetSchemasForEvaluation({&params_schema, &tuple_schema}));
+  const TupleData params_data = CreateTestTupleData({NullInt64()});
+  EvaluationContext context((EvaluationOptions()));
+  for (const auto& value_and_result :
+       std::vector<std::pair<Value, Value>>{{Int64(1), True()},
+                                            {Int64(2), NullBool()},
+                                            {NullInt64(), NullBool()}}) {
+    const TupleData tuple_data = CreateTestTupleData({value_and_result.first});
+    EXPECT_THAT(EvalExpr(*in_list, {&params_data, &tuple_data}, &context),
+                IsOkAndHolds(value_and_result.second));
+  }
+
+  // The set is built once per context, so new parameters only take effect
+  // after ClearCachedValues().
+  const TupleData new_params_data = CreateTestTupleData({Int64(2)});
+  const TupleData two_data = CreateTestTupleData({Int64(2)});
+  EXPECT_THAT(EvalExpr(*in_list, {&new_params_data, &two_data}, &context),
+              IsOkAndHolds(NullBool()));
+  context.ClearCachedValues();
+  EXPECT_THAT(EvalExpr(*in_list, {&new_params_data, &two_data}, &context),
+              IsOkAndHolds(True()));
+}
+
+TEST_F(EvalTest, InListExprForArray) {
+  const VariableId x("x"), p("p");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_p, DerefExpr::Create(p, Int64ArrayType()));
+  std::vector<std::unique_ptr<ValueExpr>> elements;
+  elements.push_back(std::move(deref_p));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto in_array,
+      InListExpr::Create(InListExpr::kArray, std::move(deref_x),
+                         std::move(elements)));
+  const TupleSchema params_schema({p});
+  const TupleSchema tuple_schema({x});
+  ZETASQL_ASSERT_OK(
+      in_array->SetSchemasForEvaluation({&params_schema, &tuple_schema}));
+
+  const TupleData one_data = CreateTestTupleData({Int64(1)});
+  const TupleData null_data = CreateTestTupleData({NullInt64()});
+  for (const auto& array_and_results :
+       std::vector<std::tuple<Value, Value, Value>>{
+           {Array({Int64(3), Int64(1)}), True(), NullBool()},
+           {Array({Int64(3), Int64(4)}), False(), NullBool()},
+           {Array({Int64(3), NullInt64()}), NullBool(), NullBool()},
+           {Value::EmptyArray(Int64ArrayType()), False(), False()},
+           {Null(Int64ArrayType()), False(), False()}}) {
+    EvaluationContext context((EvaluationOptions()));
+    const TupleData params_data =
+        CreateTestTupleData({std::get<0>(array_and_results)});
+    EXPECT_THAT(EvalExpr(*in_array, {&params_data, &one_data}, &context),
+                IsOkAndHolds(std::get<1>(array_and_results)));
+    EXPECT_THAT(EvalExpr(*in_array, {&params_data, &null_data}, &context),
+                IsOkAndHolds(std::get<2>(array_and_results)));
+  }
+
+  // Floating point values are not supported.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_double, DerefExpr::Create(x, DoubleType()));
+  EXPECT_FALSE(InListExpr::Create(InListExpr::kList, std::move(deref_double),
+                                  /*elements=*/{})
+                   .ok());
+}
+
+static zetasql_base::StatusOr<Value> EvalBinaryCall(FunctionKind kind,
+                                            const Type* output_type,
+                                            const Value& x, const Value& y) {
+  std::vector<std::unique_ptr<ValueExpr>> args;
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> x_expr, ConstExpr::Create(x));
+  args.push_back(std::move(x_expr));
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> y_expr, ConstExpr::Create(y));
+  args.push_back(std::move(y_expr));
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ScalarFunctionCallExpr> call,
+                   BuiltinScalarFunction::CreateCall(
+                       kind, LanguageOptions::MaximumFeatures(), output_type,
+                       std::move(args)));
+  ZETASQL_RETURN_IF_ERROR(call->SetSchemasForEvaluation(EmptyParamsSchemas()));
+  return EvalExpr(*call, EmptyParams());
+}
+
+// Calls with arguments of known primitive types use typed kernels, which must
+// behave like the generic implementations.
+TEST_F(EvalTest, TypedScalarFunctionKernels) {
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kAdd, Int64Type(), Int64(1),
+                             Int64(2)),
+              IsOkAndHolds(Int64(3)));
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kAdd, Int64Type(), Int64(1),
+                             NullInt64()),
+              IsOkAndHolds(NullInt64()));
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kAdd, Int64Type(),
+                             Int64(std::numeric_limits<int64_t>::max()),
+                             Int64(1)),
+              StatusIs(zetasql_base::OUT_OF_RANGE, HasSubstr("int64 overflow")));
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kSafeAdd, Int64Type(),
+                             Int64(std::numeric_limits<int64_t>::max()),
+                             Int64(1)),
+              IsOkAndHolds(NullInt64()));
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kDivide, DoubleType(), Double(1),
+                             Double(4)),
+              IsOkAndHolds(Double(0.25)));
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kSafeDivide, DoubleType(),
+                             Double(1), Double(0)),
+              IsOkAndHolds(NullDouble()));
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kMod, Uint64Type(), Uint64(7),
+                             Uint64(4)),
+              IsOkAndHolds(Uint64(3)));
+
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kLess, BoolType(), Int64(1),
+                             Int64(2)),
+              IsOkAndHolds(Bool(true)));
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kLessOrEqual, BoolType(),
+                             Uint32(2), Uint32(2)),
+              IsOkAndHolds(Bool(true)));
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kEqual, BoolType(), Int32(1),
+                             Int32(2)),
+              IsOkAndHolds(Bool(false)));
+  EXPECT_THAT(EvalBinaryCall(FunctionKind::kEqual, BoolType(), Int64(1),
+                             NullInt64()),
+              IsOkAndHolds(NullBool()));
+}
+
 TEST_F(EvalTest, LetExpr) {
   VariableId a("a"), x("x"), y("y");
 
@@ -0,0 +1,160 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/resolved_ast/column_reference_index.h"
+
+#include <utility>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_static_visitor.h"
+#include "absl/container/flat_hash_set.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+// Visits the children of each node before the node, so that the lowest node
+// that mentions a column defines it.
+class ColumnReferenceIndex::Builder
+    : public ResolvedASTStaticVisitor<ColumnReferenceIndex::Builder> {
+ public:
+  Builder(ColumnReferenceIndex* index, bool collect_referenced_columns)
+      : index_(index),
+        collect_referenced_columns_(collect_referenced_columns) {}
+
+  zetasql_base::Status DefaultVisit(const ResolvedNode* node) {
+    ZETASQL_RETURN_IF_ERROR(VisitChildren(node));
+    if (node->IsScan()) {
+      for (const ResolvedColumn& column :
+           node->GetAs<ResolvedScan>()->column_list()) {
+        Define(column, node);
+      }
+    }
+    return zetasql_base::OkStatus();
+  }
+
+  zetasql_base::Status VisitResolvedComputedColumn(
+      const ResolvedComputedColumn* node) {
+    ZETASQL_RETURN_IF_ERROR(VisitChildren(node));
+    Define(node->column(), node);
+    return zetasql_base::OkStatus();
+  }
+
+  zetasql_base::Status VisitResolvedTableScan(const ResolvedTableScan* node) {
+    const Table* table = node->table();
+    if (seen_tables_.insert(table).second) {
+      index_->tables_.push_back(table);
+    }
+    const bool has_column_indexes =
+        node->column_index_list_size() == node->column_list_size();
+    for (int i = 0; i < node->column_list_size(); ++i) {
+      const ResolvedColumn& column = node->column_list(i);
+      const Column* table_column =
+          has_column_indexes
+              ? table->GetColumn(node->column_index_list(i))
+              : table->FindColumnByName(column.name());
+      index_->columns_[column.column_id()].table_column = table_column;
+      table_columns_.emplace_back(table, column);
+    }
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedColumnRef(const ResolvedColumnRef* node) {
+    if (collect_referenced_columns_) {
+      index_->columns_[node->column().column_id()].is_referenced = true;
+    }
+    return DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedOutputColumn(const ResolvedOutputColumn* node) {
+    if (collect_referenced_columns_) {
+      index_->columns_[node->column().column_id()].is_referenced = true;
+    }
+    return DefaultVisit(node);
+  }
+
+  // The columns scanned from tables, in the order of the table scans.
+  const std::vector<std::pair<const Table*, ResolvedColumn>>& table_columns()
+      const {
+    return table_columns_;
+  }
+
+ private:
+  void Define(const ResolvedColumn& column, const ResolvedNode* node) {
+    ColumnInfo& info = index_->columns_[column.column_id()];
+    if (info.defining_node == nullptr) {
+      info.defining_node = node;
+    }
+  }
+
+  ColumnReferenceIndex* index_;  // Not owned.
+  const bool collect_referenced_columns_;
+  absl::flat_hash_set<const Table*> seen_tables_;
+  std::vector<std::pair<const Table*, ResolvedColumn>> table_columns_;
+};
+
+ColumnReferenceIndex::ColumnReferenceIndex(
+    const ResolvedNode* root,
+    const std::vector<ResolvedColumn>* referenced_columns) {
+  if (referenced_columns != nullptr) {
+    for (const ResolvedColumn& column : *referenced_columns) {
+      columns_[column.column_id()].is_referenced = true;
+    }
+  }
+  Builder builder(this,
+                  /*collect_referenced_columns=*/referenced_columns == nullptr);
+  // The visitor only returns errors for node kinds that it does not know, and
+  // it knows all of them.
+  ZETASQL_CHECK_OK(builder.Visit(root));
+  for (const auto& table_and_column : builder.table_columns()) {
+    if (IsReferenced(table_and_column.second.column_id())) {
+      referenced_columns_by_table_[table_and_column.first].push_back(
+          table_and_column.second);
+    }
+  }
+}
+
+const std::vector<ResolvedColumn>& ColumnReferenceIndex::GetReferencedColumns(
+    const Table* table) const {
+  static const std::vector<ResolvedColumn>* kEmpty =
+      new std::vector<ResolvedColumn>;
+  auto it = referenced_columns_by_table_.find(table);
+  return it == referenced_columns_by_table_.end() ? *kEmpty : it->second;
+}
+
+const ColumnReferenceIndex::ColumnInfo* ColumnReferenceIndex::FindColumnInfo(
+    int column_id) const {
+  auto it = columns_.find(column_id);
+  return it == columns_.end() ? nullptr : &it->second;
+}
+
+bool ColumnReferenceIndex::IsReferenced(int column_id) const {
+  const ColumnInfo* info = FindColumnInfo(column_id);
+  return info != nullptr && info->is_referenced;
+}
+
+const ResolvedNode* ColumnReferenceIndex::GetDefiningNode(int column_id) const {
+  const ColumnInfo* info = FindColumnInfo(column_id);
+  return info == nullptr ? nullptr : info->defining_node;
+}
+
+const Column* ColumnReferenceIndex::GetTableColumn(int column_id) const {
+  const ColumnInfo* info = FindColumnInfo(column_id);
+  return info == nullptr ? nullptr : info->table_column;
+}
+
+}  // namespace zetasql
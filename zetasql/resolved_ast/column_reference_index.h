@@ -0,0 +1,95 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_RESOLVED_AST_COLUMN_REFERENCE_INDEX_H_
+#define ZETASQL_RESOLVED_AST_COLUMN_REFERENCE_INDEX_H_
+
+#include <vector>
+
+#include "zetasql/public/catalog.h"
+#include "zetasql/resolved_ast/resolved_column.h"
+#include "zetasql/resolved_ast/resolved_node.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace zetasql {
+
+// An index of the columns of a resolved AST, built in one traversal, for
+// consumers like access control, column pruning and lineage that would
+// otherwise walk the whole tree to find out which columns of which tables a
+// statement uses.
+//
+// The index records, for every column that the tree produces, the node that
+// defines it: the ResolvedComputedColumn that computes it, or otherwise the
+// lowest scan that has it in its column_list, e.g. the ResolvedTableScan that
+// reads it from a table. Columns that are scanned from tables also map to the
+// Column of the Table.
+//
+// The index points into the tree, which must outlive it. Building the index
+// reads fields through the node accessors, so it marks them as accessed for
+// CheckFieldsAccessed().
+class ColumnReferenceIndex {
+ public:
+  // Indexes the tree rooted at <root>. <referenced_columns> are the columns
+  // that the tree references, as recorded by the resolver. If it is NULL, the
+  // columns of ResolvedColumnRefs and ResolvedOutputColumns in the tree are
+  // used instead, which misses columns that are only referenced by other
+  // nodes, e.g. by the output_column_list of a ResolvedSetOperationItem.
+  ColumnReferenceIndex(const ResolvedNode* root,
+                       const std::vector<ResolvedColumn>* referenced_columns);
+  ColumnReferenceIndex(const ColumnReferenceIndex&) = delete;
+  ColumnReferenceIndex& operator=(const ColumnReferenceIndex&) = delete;
+
+  // Returns the tables that the tree scans, in the order of their first
+  // ResolvedTableScan.
+  const std::vector<const Table*>& tables() const { return tables_; }
+
+  // Returns the columns scanned from <table> that the tree references, in
+  // the order of the table scans and their column lists. Returns an empty
+  // list if <table> is not scanned or none of its columns are referenced.
+  const std::vector<ResolvedColumn>& GetReferencedColumns(
+      const Table* table) const;
+
+  // Returns true if the column with <column_id> is referenced.
+  bool IsReferenced(int column_id) const;
+
+  // Returns the node that defines the column with <column_id>, or NULL if no
+  // node in the tree does, e.g. for the arguments of a CREATE FUNCTION.
+  const ResolvedNode* GetDefiningNode(int column_id) const;
+
+  // Returns the table column that the column with <column_id> is scanned
+  // from, or NULL if it is not scanned from a table.
+  const Column* GetTableColumn(int column_id) const;
+
+ private:
+  class Builder;
+
+  struct ColumnInfo {
+    const ResolvedNode* defining_node = nullptr;
+    const Column* table_column = nullptr;
+    bool is_referenced = false;
+  };
+
+  const ColumnInfo* FindColumnInfo(int column_id) const;
+
+  absl::flat_hash_map<int, ColumnInfo> columns_;
+  std::vector<const Table*> tables_;
+  absl::flat_hash_map<const Table*, std::vector<ResolvedColumn>>
+      referenced_columns_by_table_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_RESOLVED_AST_COLUMN_REFERENCE_INDEX_H_
@@ -0,0 +1,111 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/resolved_ast/column_reference_index.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+using testing::ElementsAre;
+
+class ColumnReferenceIndexTest : public ::testing::Test {
+ protected:
+  ColumnReferenceIndexTest() {
+    catalog_.AddTable(&t1_);
+    catalog_.AddTable(&t2_);
+    catalog_.AddZetaSQLFunctions();
+  }
+
+  // Returns the names of <columns>.
+  static std::vector<std::string> Names(
+      const std::vector<ResolvedColumn>& columns) {
+    std::vector<std::string> names;
+    for (const ResolvedColumn& column : columns) {
+      names.push_back(column.name());
+    }
+    return names;
+  }
+
+  SimpleTable t1_{"t1",
+                  {{"a", types::Int64Type()},
+                   {"b", types::Int64Type()},
+                   {"c", types::Int64Type()}}};
+  SimpleTable t2_{"t2", {{"x", types::Int64Type()}, {"y", types::Int64Type()}}};
+  SimpleCatalog catalog_{"catalog"};
+  TypeFactory type_factory_;
+};
+
+TEST_F(ColumnReferenceIndexTest, IndexesAnalyzerOutput) {
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(
+      "SELECT a, b + 1 AS b1 FROM t1 JOIN t2 ON t1.a = t2.x", AnalyzerOptions(),
+      &catalog_, &type_factory_, &output));
+  const ColumnReferenceIndex& index = output->column_reference_index();
+  EXPECT_EQ(&index, &output->column_reference_index());
+  EXPECT_THAT(index.tables(), ElementsAre(&t1_, &t2_));
+  EXPECT_THAT(Names(index.GetReferencedColumns(&t1_)), ElementsAre("a", "b"));
+  EXPECT_THAT(Names(index.GetReferencedColumns(&t2_)), ElementsAre("x"));
+
+  std::vector<const ResolvedNode*> table_scans;
+  output->resolved_statement()->GetDescendantsWithKinds({RESOLVED_TABLE_SCAN},
+                                                        &table_scans);
+  ASSERT_EQ(2, table_scans.size());
+  const ResolvedTableScan* t1_scan = table_scans[0]->GetAs<ResolvedTableScan>();
+  for (const ResolvedColumn& column : t1_scan->column_list()) {
+    EXPECT_EQ(t1_scan, index.GetDefiningNode(column.column_id()));
+    ASSERT_NE(nullptr, index.GetTableColumn(column.column_id()));
+    EXPECT_EQ(column.name(), index.GetTableColumn(column.column_id())->Name());
+    EXPECT_EQ(column.name() != "c", index.IsReferenced(column.column_id()));
+  }
+
+  // The computed output column is defined by its ResolvedComputedColumn.
+  const ResolvedQueryStmt* query =
+      output->resolved_statement()->GetAs<ResolvedQueryStmt>();
+  const int b1_id = query->output_column_list(1)->column().column_id();
+  const ResolvedNode* b1_node = index.GetDefiningNode(b1_id);
+  ASSERT_NE(nullptr, b1_node);
+  EXPECT_EQ(RESOLVED_COMPUTED_COLUMN, b1_node->node_kind());
+  EXPECT_EQ(nullptr, index.GetTableColumn(b1_id));
+  EXPECT_TRUE(index.IsReferenced(b1_id));
+}
+
+TEST_F(ColumnReferenceIndexTest, FindsReferencesInTree) {
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement("SELECT c FROM t1 WHERE a > 1",
+                             AnalyzerOptions(), &catalog_, &type_factory_,
+                             &output));
+  ColumnReferenceIndex index(output->resolved_statement(),
+                             /*referenced_columns=*/nullptr);
+  EXPECT_THAT(Names(index.GetReferencedColumns(&t1_)), ElementsAre("a", "c"));
+  EXPECT_TRUE(index.GetReferencedColumns(&t2_).empty());
+  EXPECT_EQ(nullptr, index.GetDefiningNode(-1));
+  EXPECT_FALSE(index.IsReferenced(-1));
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -610,6 +610,9 @@ class TreeGenerator(object):
         field['is_node_vector'] and field['is_constructor_arg']
         for field in fields + inherited_fields)
 
+    has_node_fields = any(
+        field['is_node_ptr'] or field['is_node_vector'] for field in fields)
+
     node_dict = ({
         'name': name,
         'proto_type': proto_type,
@@ -634,6 +637,7 @@ class TreeGenerator(object):
         'extra_defs': extra_enum_decls + extra_defs,
         'emit_default_constructor': emit_default_constructor,
         'has_node_vector_constructor_arg': has_node_vector_constructor_arg,
+        'has_node_fields': has_node_fields,
         'use_custom_debug_string': use_custom_debug_string,
         'subclasses': []
     })
@@ -16,6 +16,8 @@
 
 #include "zetasql/resolved_ast/query_expression.h"
 
+#include <utility>
+
 #include "zetasql/base/logging.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
@@ -50,7 +52,7 @@ void QueryExpression::ClearAllClauses() {
   select_list_.clear();
   select_as_modifier_.clear();
   query_hints_.clear();
-  from_.clear();
+  from_.Clear();
   where_.clear();
   set_op_type_.clear();
   set_op_modifier_.clear();
@@ -64,6 +66,14 @@ void QueryExpression::ClearAllClauses() {
 }
 
 std::string QueryExpression::GetSQLQuery() const {
+  absl::Cord sql;
+  AppendSQLQuery(&sql);
+  return std::string(sql);
+}
+
+void QueryExpression::AppendSQLQuery(absl::Cord* cord) const {
+  // Clauses other than FROM and the set operation inputs are small, so they
+  // are assembled in <sql> and appended to <cord> in one piece.
   std::string sql;
   if (!with_list_.empty()) {
     absl::StrAppend(&sql, "WITH ", JoinListWithAliases(with_list_, ", "), " ");
@@ -93,12 +103,19 @@ std::string QueryExpression::GetSQLQuery() const {
         }
         absl::StrAppend(&sql, " ", set_op_modifier_);
       }
-      absl::StrAppend(&sql, "(", qe->GetSQLQuery(), ")");
+      absl::StrAppend(&sql, "(");
+      cord->Append(sql);
+      sql.clear();
+      qe->AppendSQLQuery(cord);
+      sql = ")";
     }
   }
 
   if (!from_.empty()) {
-    absl::StrAppend(&sql, " FROM ", from_);
+    absl::StrAppend(&sql, " FROM ");
+    cord->Append(sql);
+    sql.clear();
+    cord->Append(from_);
   }
 
   if (!where_.empty()) {
@@ -148,7 +165,7 @@ std::string QueryExpression::GetSQLQuery() const {
     absl::StrAppend(&sql, " OFFSET ", offset_);
   }
 
-  return sql;
+  cord->Append(sql);
 }
 
 bool QueryExpression::CanFormSQLQuery() const {
@@ -158,9 +175,11 @@ bool QueryExpression::CanFormSQLQuery() const {
 void QueryExpression::Wrap(const std::string& alias) {
   DCHECK(CanFormSQLQuery());
   DCHECK(!alias.empty());
-  const std::string sql = GetSQLQuery();
+  absl::Cord from("(");
+  AppendSQLQuery(&from);
+  from.Append(absl::StrCat(") AS ", alias));
   ClearAllClauses();
-  from_ = absl::StrCat("(", sql, ") AS ", alias);
+  from_ = std::move(from);
 }
 
 bool QueryExpression::TrySetWithClause(
@@ -196,6 +215,14 @@ bool QueryExpression::TrySetFromClause(const std::string& from) {
   return true;
 }
 
+bool QueryExpression::TrySetFromClause(absl::Cord from) {
+  if (!CanSetFromClause()) {
+    return false;
+  }
+  from_ = std::move(from);
+  return true;
+}
+
 bool QueryExpression::TrySetWhereClause(const std::string& where) {
   if (!CanSetWhereClause()) {
     return false;
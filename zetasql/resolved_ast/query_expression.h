@@ -23,6 +23,8 @@
 #include <utility>
 #include <vector>
 
+#include "absl/strings/cord.h"
+
 namespace zetasql {
 
 // SQLBuilder representation of a SQL query. Holds internal state while
@@ -40,8 +42,13 @@ class QueryExpression {
 
   std::string GetSQLQuery() const;
 
+  // Appends the SQL query to <cord>. The FROM clause and the set operation
+  // inputs are appended as ropes, without copying their text, so building the
+  // SQL for deeply nested queries takes time linear in the size of the output.
+  void AppendSQLQuery(absl::Cord* cord) const;
+
   // Mutates the QueryExpression, wrapping its previous form as a subquery in
-  // the from_ clause, with the given <alias>.
+  // the from_ clause, with the given <alias>. The previous form is not copied.
   void Wrap(const std::string& alias);
 
   // The below TrySet... methods return true if we are able to set the concerned
@@ -53,6 +60,7 @@ class QueryExpression {
       const std::vector<std::pair<std::string, std::string>>& select_list,
       const std::string& select_hints);
   bool TrySetFromClause(const std::string& from);
+  bool TrySetFromClause(absl::Cord from);
   bool TrySetWhereClause(const std::string& where);
   bool TrySetSetOpScanList(
       std::vector<std::unique_ptr<QueryExpression>>* set_op_scan_list,
@@ -93,7 +101,7 @@ class QueryExpression {
 
   void ResetSelectClause();
 
-  const std::string FromClause() const { return from_; }
+  std::string FromClause() const { return std::string(from_); }
 
   // Returns an immutable reference to select_list_. For QueryExpression built
   // from a SetOp scan, it returns the select_list_ of its first subquery.
@@ -115,7 +123,7 @@ class QueryExpression {
   // Returns a mutable pointer to the from_ clause of QueryExpression. Used
   // while building sql for a sample scan so as to rewrite the from_ clause to
   // include the TABLESAMPLE clause.
-  std::string* MutableFromClause() { return &from_; }
+  absl::Cord* MutableFromClause() { return &from_; }
 
   // Returns a mutable pointer to the select_list_ of QueryExpression. Used
   // while building sql for a sample scan that has a WITH WEIGHT clause.
@@ -141,7 +149,8 @@ class QueryExpression {
   std::string select_as_modifier_;  // "AS TypeName", "AS STRUCT", or "AS VALUE"
   std::string query_hints_;
 
-  std::string from_;
+  // A rope, since it holds the text of all the subqueries wrapped by Wrap().
+  absl::Cord from_;
   std::string where_;
 
   // Contains the keyword corresponding to the set operation (UNION | INTERSECT
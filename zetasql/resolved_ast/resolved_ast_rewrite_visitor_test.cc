@@ -0,0 +1,138 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/resolved_ast/resolved_ast_rewrite_visitor.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_deep_copy_visitor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+using testing::HasSubstr;
+using testing::Not;
+using zetasql_base::testing::StatusIs;
+
+// Replaces all literals with NULL literals of the same type, optionally
+// leaving the filter expressions of filter scans alone.
+class NullifyLiterals : public ResolvedASTRewriteVisitor {
+ public:
+  explicit NullifyLiterals(bool skip_filters) : skip_filters_(skip_filters) {}
+
+  int num_replaced() const { return num_replaced_; }
+
+ protected:
+  bool ShouldRewriteChildren(const ResolvedNode* node) override {
+    return !skip_filters_ || !node->Is<ResolvedFilterScan>();
+  }
+
+  zetasql_base::StatusOr<std::unique_ptr<const ResolvedNode>> PostVisitResolvedLiteral(
+      std::unique_ptr<const ResolvedLiteral> node) override {
+    ++num_replaced_;
+    return std::unique_ptr<const ResolvedNode>(
+        MakeResolvedLiteral(Value::Null(node->type())));
+  }
+
+ private:
+  const bool skip_filters_;
+  int num_replaced_ = 0;
+};
+
+// Replaces table scans with literals, which their parents cannot hold.
+class ReplaceTableScans : public ResolvedASTRewriteVisitor {
+ protected:
+  zetasql_base::StatusOr<std::unique_ptr<const ResolvedNode>>
+  PostVisitResolvedTableScan(
+      std::unique_ptr<const ResolvedTableScan> node) override {
+    return std::unique_ptr<const ResolvedNode>(
+        MakeResolvedLiteral(Value::Int64(1)));
+  }
+};
+
+class ResolvedASTRewriteVisitorTest : public ::testing::Test {
+ protected:
+  ResolvedASTRewriteVisitorTest() { catalog_.AddTable(&table_); }
+
+  // Returns a copy of the resolved AST of "SELECT baz + 1 FROM bar WHERE
+  // baz > 2".
+  std::unique_ptr<const ResolvedStatement> AnalyzeQuery() {
+    ZETASQL_CHECK_OK(AnalyzeStatement("SELECT baz + 1 FROM bar WHERE baz > 2",
+                              AnalyzerOptions(), &catalog_, &type_factory_,
+                              &output_));
+    ResolvedASTDeepCopyVisitor copier;
+    ZETASQL_CHECK_OK(output_->resolved_statement()->Accept(&copier));
+    return copier.ConsumeRootNode<ResolvedStatement>().ValueOrDie();
+  }
+
+  SimpleColumn column_{"bar", "baz", types::Int64Type()};
+  SimpleTable table_{"bar", {&column_}};
+  SimpleCatalog catalog_{"foo"};
+  TypeFactory type_factory_;
+  std::unique_ptr<const AnalyzerOutput> output_;
+};
+
+TEST_F(ResolvedASTRewriteVisitorTest, ReusesUnchangedNodes) {
+  std::unique_ptr<const ResolvedStatement> statement = AnalyzeQuery();
+  const ResolvedStatement* original_statement = statement.get();
+  std::vector<const ResolvedNode*> table_scans;
+  statement->GetDescendantsWithKinds({RESOLVED_TABLE_SCAN}, &table_scans);
+  ASSERT_EQ(1, table_scans.size());
+
+  NullifyLiterals rewriter(/*skip_filters=*/false);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(statement, rewriter.Rewrite(std::move(statement)));
+  EXPECT_EQ(2, rewriter.num_replaced());
+  const std::string debug_string = statement->DebugString();
+  EXPECT_THAT(debug_string, HasSubstr("value=NULL"));
+  EXPECT_THAT(debug_string, Not(HasSubstr("value=1")));
+  EXPECT_THAT(debug_string, Not(HasSubstr("value=2")));
+
+  // The nodes that were not replaced are the same objects.
+  EXPECT_EQ(original_statement, statement.get());
+  std::vector<const ResolvedNode*> rewritten_table_scans;
+  statement->GetDescendantsWithKinds({RESOLVED_TABLE_SCAN},
+                                     &rewritten_table_scans);
+  EXPECT_EQ(table_scans, rewritten_table_scans);
+}
+
+TEST_F(ResolvedASTRewriteVisitorTest, SkipsChildren) {
+  NullifyLiterals rewriter(/*skip_filters=*/true);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<const ResolvedStatement> statement,
+                       rewriter.Rewrite(AnalyzeQuery()));
+  // Only the literal in the SELECT list is rewritten.
+  EXPECT_EQ(1, rewriter.num_replaced());
+  EXPECT_THAT(statement->DebugString(), HasSubstr("value=2"));
+}
+
+TEST_F(ResolvedASTRewriteVisitorTest, ChecksReplacementTypes) {
+  ReplaceTableScans rewriter;
+  EXPECT_THAT(rewriter.Rewrite(AnalyzeQuery()),
+              StatusIs(zetasql_base::StatusCode::kInternal,
+                       HasSubstr("Rewrite returned a Literal")));
+}
+
+}  // namespace
+}  // namespace zetasql
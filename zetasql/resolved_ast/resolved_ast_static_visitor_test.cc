@@ -0,0 +1,126 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/resolved_ast/resolved_ast_static_visitor.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_visitor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+using testing::ElementsAre;
+using zetasql_base::testing::StatusIs;
+
+// Collects the names of the columns that column references refer to, and the
+// kinds of the nodes that it visits.
+class ColumnRefCollector
+    : public ResolvedASTStaticVisitor<ColumnRefCollector> {
+ public:
+  zetasql_base::Status DefaultVisit(const ResolvedNode* node) {
+    visited_kinds.push_back(node->node_kind());
+    return ResolvedASTStaticVisitor::DefaultVisit(node);
+  }
+
+  zetasql_base::Status VisitResolvedColumnRef(const ResolvedColumnRef* node) {
+    column_names.push_back(node->column().name());
+    return DefaultVisit(node);
+  }
+
+  std::vector<std::string> column_names;
+  std::vector<ResolvedNodeKind> visited_kinds;
+};
+
+// The same traversal with a ResolvedASTVisitor.
+class VirtualKindCollector : public ResolvedASTVisitor {
+ public:
+  zetasql_base::Status DefaultVisit(const ResolvedNode* node) override {
+    visited_kinds.push_back(node->node_kind());
+    return ResolvedASTVisitor::DefaultVisit(node);
+  }
+
+  std::vector<ResolvedNodeKind> visited_kinds;
+};
+
+// Stops at the first literal.
+class FailOnLiteral : public ResolvedASTStaticVisitor<FailOnLiteral> {
+ public:
+  zetasql_base::Status VisitResolvedLiteral(const ResolvedLiteral* node) {
+    return zetasql_base::Status(zetasql_base::StatusCode::kCancelled, "literal");
+  }
+};
+
+class ResolvedASTStaticVisitorTest : public ::testing::Test {
+ protected:
+  ResolvedASTStaticVisitorTest() {
+    catalog_.AddTable(&table_);
+    catalog_.AddZetaSQLFunctions();
+    ZETASQL_CHECK_OK(AnalyzeStatement(
+        "SELECT a + 1 FROM t WHERE b > (SELECT MAX(a) FROM t) OR b = 2",
+        AnalyzerOptions(), &catalog_, &type_factory_, &output_));
+  }
+
+  const ResolvedStatement* statement() const {
+    return output_->resolved_statement();
+  }
+
+  SimpleTable table_{
+      "t", {{"a", types::Int64Type()}, {"b", types::Int64Type()}}};
+  SimpleCatalog catalog_{"catalog"};
+  TypeFactory type_factory_;
+  std::unique_ptr<const AnalyzerOutput> output_;
+};
+
+TEST_F(ResolvedASTStaticVisitorTest, VisitsLikeResolvedASTVisitor) {
+  ColumnRefCollector collector;
+  ZETASQL_ASSERT_OK(collector.Visit(statement()));
+  EXPECT_THAT(collector.column_names, ElementsAre("a", "b", "a", "b"));
+
+  VirtualKindCollector virtual_collector;
+  ZETASQL_ASSERT_OK(statement()->Accept(&virtual_collector));
+  EXPECT_EQ(virtual_collector.visited_kinds, collector.visited_kinds);
+}
+
+TEST_F(ResolvedASTStaticVisitorTest, SkipsNodeKinds) {
+  ColumnRefCollector collector;
+  collector.set_skipped_node_kinds(
+      ColumnRefCollector::MakeNodeKindMask({RESOLVED_SUBQUERY_EXPR}));
+  ZETASQL_ASSERT_OK(collector.Visit(statement()));
+  EXPECT_THAT(collector.column_names, ElementsAre("a", "b", "b"));
+  for (ResolvedNodeKind kind : collector.visited_kinds) {
+    EXPECT_NE(RESOLVED_SUBQUERY_EXPR, kind);
+    EXPECT_NE(RESOLVED_AGGREGATE_SCAN, kind);
+  }
+}
+
+TEST_F(ResolvedASTStaticVisitorTest, ReturnsErrors) {
+  FailOnLiteral visitor;
+  EXPECT_THAT(visitor.Visit(statement()),
+              StatusIs(zetasql_base::StatusCode::kCancelled, testing::_));
+}
+
+}  // namespace
+}  // namespace zetasql
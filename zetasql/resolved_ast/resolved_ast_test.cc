@@ -124,6 +124,41 @@ TEST(ResolvedAST, Misc) {
   EXPECT_EQ(select_column, project->column_list(1));
 }
 
+TEST(ResolvedAST, ArenaScope) {
+  zetasql_base::UnsafeArena arena(/*block_size=*/1 << 20);
+  const size_t initial_bytes = arena.bytes_until_next_allocation();
+  std::unique_ptr<ResolvedProjectScan> project;
+  {
+    ResolvedNode::ArenaScope arena_scope(&arena);
+    project = MakeResolvedProjectScan(
+        {}, MakeNodeVector(MakeResolvedComputedColumn(MakeColumn(),
+                                                      MakeIntLiteral(1))),
+        MakeJoin());
+    {
+      // Nested scopes can go back to the heap.
+      ResolvedNode::ArenaScope heap_scope(nullptr);
+      const size_t bytes = arena.bytes_until_next_allocation();
+      project->add_expr_list(
+          MakeResolvedComputedColumn(MakeColumn(), MakeIntLiteral(2)));
+      EXPECT_EQ(bytes, arena.bytes_until_next_allocation());
+    }
+    project->add_expr_list(
+        MakeResolvedComputedColumn(MakeColumn(), MakeIntLiteral(3)));
+  }
+  EXPECT_LT(arena.bytes_until_next_allocation(), initial_bytes);
+  const size_t bytes = arena.bytes_until_next_allocation();
+  project->set_input_scan(MakeJoin());
+  EXPECT_EQ(bytes, arena.bytes_until_next_allocation());
+
+  // Trees that mix arena and heap nodes can be used and deleted as usual.
+  EXPECT_EQ(3, project->expr_list_size());
+  EXPECT_EQ(Value::Int64(2), project->expr_list(1)
+                                 ->expr()
+                                 ->GetAs<ResolvedLiteral>()
+                                 ->value());
+  project.reset();
+}
+
 TEST(ResolvedAST, ReleaseAndSet) {
   TypeFactory type_factory;
   const FunctionSignature signature(
@@ -19,11 +19,25 @@
 #include <memory>
 
 #include "zetasql/resolved_ast/serialization.pb.h"
+#include "absl/base/const_init.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "zetasql/base/status_macros.h"
 
 namespace zetasql {
 
+namespace {
+
+// The registry of the ResolvedColumns that are constructed without one.
+ResolvedColumnRegistry* GetGlobalRegistry() {
+  static ResolvedColumnRegistry* registry = new ResolvedColumnRegistry;
+  return registry;
+}
+
+absl::Mutex global_registry_mutex(absl::kConstInit);
+
+}  // namespace
+
 // TODO This version is allocating the names in the global pool, so
 // they leak.  This constructor should not be used by any production zetasql
 // code, and should probably only be used in tests, so this may be okay for
@@ -34,13 +48,30 @@ ResolvedColumn::ResolvedColumn(int column_id, const std::string& table_name,
     : ResolvedColumn(column_id, IdString::MakeGlobal(table_name),
                      IdString::MakeGlobal(name), type) {}
 
+// The names are interned in the global registry, so they leak too, but only
+// once per distinct pair of names. <table_name> and <name> must outlive the
+// global registry, i.e. be allocated in the global pool, if this is the first
+// column with these names.
+ResolvedColumn::ResolvedColumn(int column_id, IdString table_name,
+                               IdString name, const Type* type)
+    : column_id_(column_id), type_(type) {
+  DCHECK_GT(column_id, 0) << "column_id should be positive";
+  DCHECK(!table_name.empty());
+  DCHECK(!name.empty());
+  DCHECK(type != nullptr);
+  absl::MutexLock lock(&global_registry_mutex);
+  names_ = GetGlobalRegistry()->InternNames(
+      IdString::MakeGlobal(table_name.ToStringView()),
+      IdString::MakeGlobal(name.ToStringView()));
+}
+
 std::string ResolvedColumn::DebugString() const {
-  return absl::StrCat(table_name_.ToStringView(), ".", name_.ToStringView(),
-                      "#", column_id_);
+  return absl::StrCat(table_name_id().ToStringView(), ".",
+                      name_id().ToStringView(), "#", column_id_);
 }
 
 std::string ResolvedColumn::ShortDebugString() const {
-  return absl::StrCat(name_.ToStringView(), "#", column_id_);
+  return absl::StrCat(name_id().ToStringView(), "#", column_id_);
 }
 
 zetasql_base::Status ResolvedColumn::SaveTo(
@@ -48,8 +79,8 @@ zetasql_base::Status ResolvedColumn::SaveTo(
     ResolvedColumnProto* proto) const {
   // Consider serializing ResolvedColumn in a separate table, indexed by
   // column_id_, and then only serialize the column_id_ in the AST.
-  proto->set_table_name(std::string(table_name_.ToStringView()));
-  proto->set_name(std::string(name_.ToStringView()));
+  proto->set_table_name(std::string(table_name_id().ToStringView()));
+  proto->set_name(std::string(name_id().ToStringView()));
 
   proto->set_column_id(column_id_);
   return type_->SerializeToProtoAndDistinctFileDescriptors(
@@ -64,9 +95,33 @@ zetasql_base::StatusOr<ResolvedColumn> ResolvedColumn::RestoreFrom(
   const Type* type;
   ZETASQL_RETURN_IF_ERROR(params.type_factory->DeserializeFromProtoUsingExistingPools(
       proto.type(), params.pools, &type));
+  if (params.column_registry != nullptr) {
+    return params.column_registry->MakeColumn(proto.column_id(), table_name,
+                                              column_name, type);
+  }
   return ResolvedColumn(proto.column_id(), table_name, column_name, type);
 }
 
+const ResolvedColumn::Names* ResolvedColumnRegistry::InternNames(
+    IdString table_name, IdString name) {
+  const ResolvedColumn::Names*& names = names_[{table_name, name}];
+  if (names == nullptr) {
+    ResolvedColumn::Names* new_names;
+    if (arena_ != nullptr) {
+      new_names = new (arena_->AllocAligned(sizeof(ResolvedColumn::Names),
+                                            alignof(ResolvedColumn::Names)))
+          ResolvedColumn::Names;
+    } else {
+      owned_names_.emplace_back();
+      new_names = &owned_names_.back();
+    }
+    new_names->table_name = table_name;
+    new_names->name = name;
+    names = new_names;
+  }
+  return names;
+}
+
 std::string ResolvedColumnListToString(const ResolvedColumnList& columns) {
   if (columns.empty()) return "[]";
   const std::string& common_table_name = columns[0].table_name();
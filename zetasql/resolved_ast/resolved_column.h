@@ -18,14 +18,19 @@
 #define ZETASQL_RESOLVED_AST_RESOLVED_COLUMN_H_
 
 #include <stddef.h>
+#include <deque>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "zetasql/base/logging.h"
+#include "zetasql/base/arena.h"
 #include "zetasql/public/id_string.h"
 #include "zetasql/public/type.h"
 #include "zetasql/resolved_ast/resolved_node.h"
 #include "zetasql/resolved_ast/serialization.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
 
@@ -48,6 +53,13 @@ namespace zetasql {
 // inputs, with the same column_ids.
 class ResolvedColumn {
  public:
+  // The names of a column, which are shared by all the copies of the column
+  // and interned by ResolvedColumnRegistry.
+  struct Names {
+    IdString table_name;
+    IdString name;
+  };
+
   // Default constructor makes an uninitialized ResolvedColumn.
   ResolvedColumn() = default;
   ResolvedColumn(const ResolvedColumn&) = default;
@@ -56,23 +68,27 @@ class ResolvedColumn {
   // <table_name> and <name> are for display only, have no defined meaning and
   // are required to be non-empty.
   //
-  // NOTE: The IdString constructor is preferred because it avoids doing any
-  // string copying.  We don't want the string-based constructor to be called
-  // anywhere during zetasql analysis, but there are outside callers.
-  // WARNING: This string-based constructor allocates IdStrings in the
-  // global IdStringPool, so they never get freed.  Avoid using this for an
+  // NOTE: ResolvedColumnRegistry::MakeColumn() is preferred because it
+  // avoids doing any string copying.  We don't want these constructors to be
+  // called anywhere during zetasql analysis, but there are outside callers.
+  // WARNING: These constructors intern the names in a global
+  // ResolvedColumnRegistry, and allocate IdStrings in the global
+  // IdStringPool, so they never get freed.  Avoid using this for an
   // unbounded number of strings.
   // TODO Maybe get this removed, or figure out a way to enforce that
   // zetasql code can't call it.
   ResolvedColumn(int column_id, const std::string& table_name,
                  const std::string& name, const Type* type);
   ResolvedColumn(int column_id, IdString table_name,
-                 IdString name, const Type* type)
-      : column_id_(column_id), table_name_(table_name),
-        name_(name), type_(type) {
+                 IdString name, const Type* type);
+
+  // Constructs a ResolvedColumn whose names are <names>, which must outlive
+  // it and all its copies.
+  ResolvedColumn(int column_id, const Names* names, const Type* type)
+      : column_id_(column_id), type_(type), names_(names) {
     DCHECK_GT(column_id, 0) << "column_id should be positive";
-    DCHECK(!table_name.empty());
-    DCHECK(!name.empty());
+    DCHECK(!names->table_name.empty());
+    DCHECK(!names->name.empty());
     DCHECK(type != nullptr);
   }
 
@@ -82,9 +98,8 @@ class ResolvedColumn {
   // Reset this object so IsInitialized returns false.
   void Clear() {
     column_id_ = -1;
-    table_name_.clear();
-    name_.clear();
     type_ = nullptr;
+    names_ = nullptr;
   }
 
   // Return "<table>.<column>#<column_id>".
@@ -110,10 +125,14 @@ class ResolvedColumn {
   // <table_name> and <name> are for display only, have no defined meaning and
   // are required to be non-empty.  Semantic behavior must never be defined
   // using these names.
-  const std::string table_name() const { return table_name_.ToString(); }
-  const std::string name() const { return name_.ToString(); }
-  IdString table_name_id() const { return table_name_; }
-  IdString name_id() const { return name_; }
+  const std::string table_name() const { return table_name_id().ToString(); }
+  const std::string name() const { return name_id().ToString(); }
+  IdString table_name_id() const {
+    return names_ == nullptr ? IdString() : names_->table_name;
+  }
+  IdString name_id() const {
+    return names_ == nullptr ? IdString() : names_->name;
+  }
 
   const Type* type() const { return type_; }
 
@@ -137,17 +156,65 @@ class ResolvedColumn {
   // Always positive if valid.
   int column_id_ = -1;
 
-  // Table name (or alias) this column comes from.
-  // Not necessarily unique or meaningful - used only for DebugString to
-  // make the resolved AST understandable when printed.
-  IdString table_name_;
-
-  // The name of this column.  Matches the identifier that could have been
-  // used to select this column (if it was properly scoped).
-  IdString name_;
-
   // The type of this column.  Not owned.
   const Type* type_ = nullptr;
+
+  // Table name (or alias) this column comes from, and the name of this
+  // column, which matches the identifier that could have been used to select
+  // this column (if it was properly scoped).
+  // The table name is not necessarily unique or meaningful - used only for
+  // DebugString to make the resolved AST understandable when printed.
+  // The names are shared rather than stored in each copy of the column, which
+  // keeps column lists of wide tables small. NULL if not initialized.
+  // Not owned.
+  const Names* names_ = nullptr;
+};
+
+// Interns the names of ResolvedColumns, so that all the columns with the same
+// table name and name share one ResolvedColumn::Names. The resolver uses one
+// registry per analysis, with the names allocated in the analysis arena.
+//
+// Not thread-safe, except for the global registry used by the ResolvedColumn
+// constructors that take names, which is internal.
+class ResolvedColumnRegistry {
+ public:
+  // Allocates the names in this registry, which must outlive the columns.
+  ResolvedColumnRegistry() = default;
+  // Allocates the names in <arena>, which must outlive the columns. This
+  // registry can be destroyed before them.
+  explicit ResolvedColumnRegistry(zetasql_base::UnsafeArena* arena)
+      : arena_(arena) {}
+  ResolvedColumnRegistry(const ResolvedColumnRegistry&) = delete;
+  ResolvedColumnRegistry& operator=(const ResolvedColumnRegistry&) = delete;
+
+  // Returns the interned names <table_name> and <name>, which must outlive the
+  // names.
+  const ResolvedColumn::Names* InternNames(IdString table_name, IdString name);
+
+  // Returns a ResolvedColumn with interned names. See the ResolvedColumn
+  // constructors for the arguments.
+  ResolvedColumn MakeColumn(int column_id, IdString table_name, IdString name,
+                            const Type* type) {
+    return ResolvedColumn(column_id, InternNames(table_name, name), type);
+  }
+
+  // Returns the number of distinct names.
+  int num_names() const { return static_cast<int>(names_.size()); }
+
+ private:
+  struct NamesHash {
+    size_t operator()(const std::pair<IdString, IdString>& names) const {
+      return absl::Hash<std::pair<size_t, size_t>>()(
+          {names.first.Hash(), names.second.Hash()});
+    }
+  };
+
+  zetasql_base::UnsafeArena* arena_ = nullptr;  // Not owned.
+  // Allocated names if there is no arena.
+  std::deque<ResolvedColumn::Names> owned_names_;
+  absl::flat_hash_map<std::pair<IdString, IdString>,
+                      const ResolvedColumn::Names*, NamesHash>
+      names_;
 };
 
 // A vector of columns produced by an operation like a scan or subquery.
@@ -20,6 +20,8 @@
 #include <utility>
 
 #include "google/protobuf/descriptor.h"
+#include "zetasql/base/arena.h"
+#include "zetasql/public/id_string.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/resolved_ast/resolved_node.h"
@@ -110,11 +112,63 @@ TEST(ResolvedColumnTest, RestoreFrom) {
   EXPECT_EQ(c1.type(), c2.type());
 }
 
+TEST(ResolvedColumnTest, Registry) {
+  TypeFactory type_factory;
+  IdStringPool id_string_pool;
+  zetasql_base::UnsafeArena arena(/*block_size=*/1024);
+  const IdString t1 = id_string_pool.Make("T1");
+  const IdString c1_name = id_string_pool.Make("C1");
+  const IdString c2_name = id_string_pool.Make("C2");
+
+  ResolvedColumnRegistry owning_registry;
+  ResolvedColumnRegistry arena_registry(&arena);
+  for (ResolvedColumnRegistry* registry : {&owning_registry, &arena_registry}) {
+    const ResolvedColumn c1 =
+        registry->MakeColumn(1, t1, c1_name, type_factory.get_int32());
+    const ResolvedColumn c2 =
+        registry->MakeColumn(2, t1, c2_name, type_factory.get_int64());
+    const ResolvedColumn c1_copy = registry->MakeColumn(
+        3, id_string_pool.Make("T1"), id_string_pool.Make("C1"),
+        type_factory.get_int32());
+    EXPECT_EQ(2, registry->num_names());
+    EXPECT_EQ("T1.C1#1", c1.DebugString());
+    EXPECT_EQ("C2#2", c2.ShortDebugString());
+    EXPECT_EQ("T1.C1#3", c1_copy.DebugString());
+    EXPECT_EQ(registry->InternNames(t1, c1_name),
+              registry->InternNames(c1_copy.table_name_id(),
+                                    c1_copy.name_id()));
+  }
+
+  ResolvedColumn column;
+  EXPECT_FALSE(column.IsInitialized());
+  EXPECT_TRUE(column.name_id().empty());
+  EXPECT_TRUE(column.table_name_id().empty());
+}
+
+TEST(ResolvedColumnTest, RestoreWithRegistry) {
+  TypeFactory type_factory;
+  ResolvedColumn c1(1, "T1", "C1", type_factory.get_int32());
+  FileDescriptorSetMap map;
+  ResolvedColumnProto proto;
+  ZETASQL_CHECK_OK(c1.SaveTo(&map, &proto));
+
+  IdStringPool id_string_pool;
+  ResolvedColumnRegistry registry;
+  ResolvedNode::RestoreParams params({}, nullptr, &type_factory,
+                                     &id_string_pool);
+  params.column_registry = &registry;
+  auto c2 = ResolvedColumn::RestoreFrom(proto, params).ValueOrDie();
+  auto c3 = ResolvedColumn::RestoreFrom(proto, params).ValueOrDie();
+  EXPECT_EQ("T1.C1#1", c2.DebugString());
+  EXPECT_EQ("T1.C1#1", c3.DebugString());
+  EXPECT_EQ(1, registry.num_names());
+}
+
 TEST(ResolvedColumnTest, ClassAndProtoSize) {
   EXPECT_EQ(16, sizeof(ResolvedNode))
       << "The size of ResolvedNode class has changed, please also update the "
       << "proto and serialization code if you added/removed fields in it.";
-  EXPECT_EQ(2 * sizeof(IdString), sizeof(ResolvedColumn) - sizeof(ResolvedNode))
+  EXPECT_EQ(24, sizeof(ResolvedColumn))
       << "The size of ResolvedColumn class has changed, please also update the "
       << "proto and serialization code if you added/removed fields in it.";
   EXPECT_EQ(1, ResolvedNodeProto::descriptor()->field_count())
@@ -38,6 +38,45 @@
 
 namespace zetasql {
 
+namespace {
+
+// The arena of the innermost ResolvedNode::ArenaScope on this thread.
+thread_local zetasql_base::UnsafeArena* resolved_node_arena = nullptr;
+
+}  // namespace
+
+ResolvedNode::ArenaScope::ArenaScope(zetasql_base::UnsafeArena* arena)
+    : previous_arena_(resolved_node_arena) {
+  resolved_node_arena = arena;
+}
+
+ResolvedNode::ArenaScope::~ArenaScope() {
+  resolved_node_arena = previous_arena_;
+}
+
+// Like zetasql_base::Gladiator, allocates one more byte than needed, which
+// records whether the node is on the heap.
+void* ResolvedNode::operator new(size_t size) {
+  char* memory;
+  if (resolved_node_arena != nullptr) {
+    memory = static_cast<char*>(resolved_node_arena->AllocAligned(
+        size + 1, zetasql_base::BaseArena::kDefaultAlignment));
+    memory[size] = 0;
+  } else {
+    memory = static_cast<char*>(::operator new(size + 1));
+    memory[size] = 1;
+  }
+  return memory;
+}
+
+void ResolvedNode::operator delete(void* memory, size_t size) {
+  // <size> is the size of the most derived class, since the destructor is
+  // virtual.
+  if (static_cast<char*>(memory)[size] != 0) {
+    ::operator delete(memory);
+  }
+}
+
 // ResolvedNode::RestoreFrom is generated in resolved_node.cc.template.
 
 zetasql_base::Status ResolvedNode::Accept(ResolvedASTVisitor* visitor) const {
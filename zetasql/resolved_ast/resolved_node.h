@@ -23,6 +23,7 @@
 #include <utility>
 #include <vector>
 
+#include "zetasql/base/arena.h"
 #include "google/protobuf/descriptor.h"
 #include "zetasql/public/catalog.h"
 #include "zetasql/public/id_string.h"
@@ -37,6 +38,7 @@
 namespace zetasql {
 
 class ResolvedASTVisitor;
+class ResolvedColumnRegistry;
 
 // This is the base class for the resolved AST.
 // Subclasses are in the generated file resolved_ast.h.
@@ -61,6 +63,26 @@ class ResolvedNode {
   ResolvedNode& operator=(const ResolvedNode&) = delete;
   virtual ~ResolvedNode() {}
 
+  // While an ArenaScope exists, ResolvedNodes created with new (including
+  // by MakeResolved* and absl::make_unique) on the same thread are allocated
+  // from its arena instead of the heap. Deleting such a node still runs its
+  // destructor, but its memory is only released with the arena, so the arena
+  // must outlive the node. Creating many nodes is cheaper this way, and so
+  // is deleting them. ArenaScopes can be nested; the innermost one is used.
+  class ArenaScope {
+   public:
+    explicit ArenaScope(zetasql_base::UnsafeArena* arena);
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+    ~ArenaScope();
+
+   private:
+    zetasql_base::UnsafeArena* const previous_arena_;
+  };
+
+  static void* operator new(size_t size);
+  static void operator delete(void* memory, size_t size);
+
   // Return this node's kind.
   // e.g. zetasql::RESOLVED_TABLE_SCAN for ResolvedTableScan.
   virtual ResolvedNodeKind node_kind() const = 0;
@@ -147,6 +169,11 @@ class ResolvedNode {
     // This is used to store any IdStrings allocated during
     // deserialization.
     IdStringPool* string_pool = nullptr;
+
+    // If set, the names of deserialized ResolvedColumns are interned here.
+    // Must outlive the deserialized nodes. Otherwise they are interned in a
+    // global registry and never freed.
+    ResolvedColumnRegistry* column_registry = nullptr;
   };
 
   // Deserializes any node type from <proto>.
@@ -0,0 +1,324 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/resolved_ast/resolved_node_proto_view.h"
+
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast.pb.h"
+#include "absl/strings/match.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_builder.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+
+using google::protobuf::internal::WireFormatLite;
+
+// A field value read from the wire format. <bytes> points into the serialized
+// message for length-delimited fields; <number> is set for the other fields.
+struct WireValue {
+  uint64_t number = 0;
+  absl::string_view bytes;
+};
+
+zetasql_base::Status CorruptedProtoError(const google::protobuf::Descriptor* descriptor) {
+  return zetasql_base::OutOfRangeErrorBuilder()
+         << "Corrupted protocol buffer: Failed to read "
+         << descriptor->full_name();
+}
+
+// Calls <callback>(field_number, value) for every field in <message>, a
+// serialized message of type <descriptor>, in order.
+template <class Callback>
+zetasql_base::Status ForEachField(absl::string_view message,
+                          const google::protobuf::Descriptor* descriptor,
+                          Callback callback) {
+  google::protobuf::io::CodedInputStream in(
+      reinterpret_cast<const uint8_t*>(message.data()), message.size());
+  uint32_t tag_and_type;
+  while (0 < (tag_and_type = in.ReadTag())) {
+    WireValue value;
+    bool ok;
+    switch (WireFormatLite::GetTagWireType(tag_and_type)) {
+      case WireFormatLite::WIRETYPE_VARINT:
+        ok = in.ReadVarint64(&value.number);
+        break;
+      case WireFormatLite::WIRETYPE_FIXED64:
+        ok = in.ReadLittleEndian64(&value.number);
+        break;
+      case WireFormatLite::WIRETYPE_FIXED32: {
+        uint32_t number;
+        ok = in.ReadLittleEndian32(&number);
+        value.number = number;
+        break;
+      }
+      case WireFormatLite::WIRETYPE_LENGTH_DELIMITED: {
+        uint32_t length;
+        ok = in.ReadVarint32(&length) &&
+             length <= message.size() - in.CurrentPosition();
+        if (ok) {
+          value.bytes = message.substr(in.CurrentPosition(), length);
+          ok = in.Skip(length);
+        }
+        break;
+      }
+      default:
+        // The resolved AST protos do not use groups.
+        ok = false;
+        break;
+    }
+    if (!ok) return CorruptedProtoError(descriptor);
+    callback(WireFormatLite::GetTagFieldNumber(tag_and_type), value);
+  }
+  if (in.CurrentPosition() != message.size()) {
+    return CorruptedProtoError(descriptor);
+  }
+  return zetasql_base::OkStatus();
+}
+
+// Sets <*value> to the last value of the non-repeated field <field> in
+// <message>, as proto parsers do, and <*found> to whether the field is set.
+// Does not merge values of message fields that are split into several
+// occurrences, which serializing a proto never does.
+zetasql_base::Status GetLastValue(absl::string_view message,
+                          const google::protobuf::FieldDescriptor* field, bool* found,
+                          WireValue* value) {
+  *found = false;
+  return ForEachField(message, field->containing_type(),
+                      [field, found, value](int number, const WireValue& v) {
+                        if (number == field->number()) {
+                          *found = true;
+                          *value = v;
+                        }
+                      });
+}
+
+// Returns true for the AnyResolved*Proto messages, which hold a node of some
+// subclass of an abstract node class in a oneof.
+bool IsAnyNodeProto(const google::protobuf::Descriptor* descriptor) {
+  return descriptor->oneof_decl_count() == 1 &&
+         absl::StartsWith(descriptor->name(), "AnyResolved");
+}
+
+// Appends to <path> the oneof fields that lead from <from>, an
+// AnyResolved*Proto, to a field of type <to>. Returns false if there is no
+// such path.
+bool FindPathToNodeProto(const google::protobuf::Descriptor* from,
+                         const google::protobuf::Descriptor* to,
+                         std::vector<const google::protobuf::FieldDescriptor*>* path) {
+  for (int i = 0; i < from->field_count(); ++i) {
+    const google::protobuf::FieldDescriptor* field = from->field(i);
+    const google::protobuf::Descriptor* type = field->message_type();
+    path->push_back(field);
+    if (type == to ||
+        (IsAnyNodeProto(type) && FindPathToNodeProto(type, to, path))) {
+      return true;
+    }
+    path->pop_back();
+  }
+  return false;
+}
+
+}  // namespace
+
+zetasql_base::StatusOr<ResolvedNodeProtoView> ResolvedNodeProtoView::Create(
+    absl::string_view serialized) {
+  return CreateForMessage(serialized, AnyResolvedNodeProto::descriptor());
+}
+
+zetasql_base::StatusOr<ResolvedNodeProtoView> ResolvedNodeProtoView::CreateForMessage(
+    absl::string_view serialized, const google::protobuf::Descriptor* descriptor) {
+  while (IsAnyNodeProto(descriptor)) {
+    int node_field_number = 0;
+    absl::string_view node_bytes;
+    ZETASQL_RETURN_IF_ERROR(ForEachField(
+        serialized, descriptor, [&](int number, const WireValue& value) {
+          node_field_number = number;
+          node_bytes = value.bytes;
+        }));
+    const google::protobuf::FieldDescriptor* node_field =
+        descriptor->FindFieldByNumber(node_field_number);
+    if (node_field == nullptr) {
+      return zetasql_base::InvalidArgumentErrorBuilder()
+             << "No subnode types set in " << descriptor->full_name();
+    }
+    descriptor = node_field->message_type();
+    serialized = node_bytes;
+  }
+  ZETASQL_ASSIGN_OR_RETURN(const ResolvedNodeKind node_kind,
+                   ResolvedNodeKindFromProtoDescriptor(descriptor));
+  return ResolvedNodeProtoView(serialized, descriptor, node_kind);
+}
+
+zetasql_base::Status ResolvedNodeProtoView::FindField(
+    absl::string_view field_name, absl::string_view* message,
+    const google::protobuf::FieldDescriptor** field) const {
+  *message = serialized_;
+  const google::protobuf::Descriptor* descriptor = descriptor_;
+  while (true) {
+    *field = descriptor->FindFieldByName(std::string(field_name));
+    if (*field != nullptr) return zetasql_base::OkStatus();
+    // Fields of parent classes are in the proto of the parent class, in the
+    // "parent" field.
+    const google::protobuf::FieldDescriptor* parent_field =
+        descriptor->FindFieldByName("parent");
+    if (parent_field == nullptr) {
+      return zetasql_base::InvalidArgumentErrorBuilder()
+             << node_kind_string() << " has no field " << field_name;
+    }
+    bool found;
+    WireValue value;
+    ZETASQL_RETURN_IF_ERROR(GetLastValue(*message, parent_field, &found, &value));
+    *message = value.bytes;
+    descriptor = parent_field->message_type();
+  }
+}
+
+zetasql_base::StatusOr<bool> ResolvedNodeProtoView::HasField(
+    absl::string_view field_name) const {
+  absl::string_view message;
+  const google::protobuf::FieldDescriptor* field;
+  ZETASQL_RETURN_IF_ERROR(FindField(field_name, &message, &field));
+  ZETASQL_RET_CHECK(!field->is_repeated()) << field->full_name();
+  bool found;
+  WireValue value;
+  ZETASQL_RETURN_IF_ERROR(GetLastValue(message, field, &found, &value));
+  return found;
+}
+
+zetasql_base::StatusOr<int64_t> ResolvedNodeProtoView::GetInt64(
+    absl::string_view field_name) const {
+  absl::string_view message;
+  const google::protobuf::FieldDescriptor* field;
+  ZETASQL_RETURN_IF_ERROR(FindField(field_name, &message, &field));
+  ZETASQL_RET_CHECK(!field->is_repeated()) << field->full_name();
+  bool found;
+  WireValue value;
+  ZETASQL_RETURN_IF_ERROR(GetLastValue(message, field, &found, &value));
+  switch (field->cpp_type()) {
+    case google::protobuf::FieldDescriptor::CPPTYPE_INT32:
+    case google::protobuf::FieldDescriptor::CPPTYPE_INT64:
+      if (!found) {
+        return field->cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_INT32
+                   ? field->default_value_int32()
+                   : field->default_value_int64();
+      }
+      if (field->type() == google::protobuf::FieldDescriptor::TYPE_SINT32 ||
+          field->type() == google::protobuf::FieldDescriptor::TYPE_SINT64) {
+        return WireFormatLite::ZigZagDecode64(value.number);
+      }
+      if (field->type() == google::protobuf::FieldDescriptor::TYPE_SFIXED32) {
+        return static_cast<int32_t>(value.number);
+      }
+      return static_cast<int64_t>(value.number);
+    case google::protobuf::FieldDescriptor::CPPTYPE_UINT32:
+      return found ? value.number : field->default_value_uint32();
+    case google::protobuf::FieldDescriptor::CPPTYPE_UINT64:
+      return found ? value.number : field->default_value_uint64();
+    case google::protobuf::FieldDescriptor::CPPTYPE_BOOL:
+      return found ? value.number != 0 : field->default_value_bool();
+    case google::protobuf::FieldDescriptor::CPPTYPE_ENUM:
+      return found ? static_cast<int32_t>(value.number)
+                   : field->default_value_enum()->number();
+    default:
+      return zetasql_base::InvalidArgumentErrorBuilder()
+             << field->full_name() << " is not an integer field";
+  }
+}
+
+zetasql_base::StatusOr<absl::string_view> ResolvedNodeProtoView::GetBytes(
+    absl::string_view field_name) const {
+  absl::string_view message;
+  const google::protobuf::FieldDescriptor* field;
+  ZETASQL_RETURN_IF_ERROR(FindField(field_name, &message, &field));
+  ZETASQL_RET_CHECK(!field->is_repeated()) << field->full_name();
+  if (field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_STRING &&
+      field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << field->full_name() << " is not a string, bytes or message field";
+  }
+  bool found;
+  WireValue value;
+  ZETASQL_RETURN_IF_ERROR(GetLastValue(message, field, &found, &value));
+  return value.bytes;
+}
+
+zetasql_base::StatusOr<ResolvedNodeProtoView> ResolvedNodeProtoView::GetNode(
+    absl::string_view field_name) const {
+  absl::string_view message;
+  const google::protobuf::FieldDescriptor* field;
+  ZETASQL_RETURN_IF_ERROR(FindField(field_name, &message, &field));
+  ZETASQL_RET_CHECK(!field->is_repeated()) << field->full_name();
+  ZETASQL_RET_CHECK(field->message_type() != nullptr) << field->full_name();
+  bool found;
+  WireValue value;
+  ZETASQL_RETURN_IF_ERROR(GetLastValue(message, field, &found, &value));
+  if (!found) {
+    return zetasql_base::NotFoundErrorBuilder()
+           << field->full_name() << " is not set";
+  }
+  return CreateForMessage(value.bytes, field->message_type());
+}
+
+zetasql_base::Status ResolvedNodeProtoView::GetNodeList(
+    absl::string_view field_name,
+    std::vector<ResolvedNodeProtoView>* nodes) const {
+  nodes->clear();
+  absl::string_view message;
+  const google::protobuf::FieldDescriptor* field;
+  ZETASQL_RETURN_IF_ERROR(FindField(field_name, &message, &field));
+  ZETASQL_RET_CHECK(field->is_repeated()) << field->full_name();
+  ZETASQL_RET_CHECK(field->message_type() != nullptr) << field->full_name();
+  std::vector<absl::string_view> elements;
+  ZETASQL_RETURN_IF_ERROR(ForEachField(
+      message, field->containing_type(),
+      [field, &elements](int number, const WireValue& value) {
+        if (number == field->number()) elements.push_back(value.bytes);
+      }));
+  nodes->reserve(elements.size());
+  for (absl::string_view element : elements) {
+    ZETASQL_ASSIGN_OR_RETURN(ResolvedNodeProtoView node,
+                     CreateForMessage(element, field->message_type()));
+    nodes->push_back(node);
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::StatusOr<std::unique_ptr<ResolvedNode>> ResolvedNodeProtoView::Materialize(
+    const ResolvedNode::RestoreParams& params) const {
+  // Parses the node into the AnyResolvedNodeProto fields that hold a node of
+  // this kind, so nodes anywhere in the tree can be restored.
+  std::vector<const google::protobuf::FieldDescriptor*> path;
+  ZETASQL_RET_CHECK(FindPathToNodeProto(AnyResolvedNodeProto::descriptor(),
+                                descriptor_, &path))
+      << descriptor_->full_name();
+  AnyResolvedNodeProto proto;
+  google::protobuf::Message* message = &proto;
+  for (const google::protobuf::FieldDescriptor* field : path) {
+    message = message->GetReflection()->MutableMessage(message, field);
+  }
+  if (!message->ParseFromArray(serialized_.data(), serialized_.size())) {
+    return CorruptedProtoError(descriptor_);
+  }
+  return ResolvedNode::RestoreFrom(proto, params);
+}
+
+}  // namespace zetasql
@@ -0,0 +1,122 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_RESOLVED_AST_RESOLVED_NODE_PROTO_VIEW_H_
+#define ZETASQL_RESOLVED_AST_RESOLVED_NODE_PROTO_VIEW_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+#include "google/protobuf/descriptor.h"
+#include "zetasql/resolved_ast/resolved_node.h"
+#include "zetasql/resolved_ast/resolved_node_kind.h"
+#include "absl/strings/string_view.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// A read-only view of a resolved AST serialized with ResolvedNode::SaveTo()
+// into an AnyResolvedNodeProto in protocol buffer wire format. The view reads
+// the serialized bytes in place: it does not parse the proto and does not
+// create ResolvedNode objects, so an executor that receives a serialized plan
+// can inspect it, e.g. to dispatch on the statement kind or to find the tables
+// it scans, without paying for a full deserialization. Materialize() creates
+// the ResolvedNodes of a subtree when they are needed.
+//
+// Fields are looked up by their names in the generated node protos, including
+// the fields that the node inherits from its parent classes. Fields that hold
+// nodes return views; other fields return their values or their serialized
+// bytes, e.g. a serialized ResolvedColumnProto or TypeProto.
+//
+// A view is small and cheap to copy. It points into the serialized bytes and
+// must not outlive them. Lookups scan the serialized node, so callers that
+// read many fields of one large node may prefer to Materialize() it.
+class ResolvedNodeProtoView {
+ public:
+  // Returns a view of the root node of <serialized>, which must be an
+  // AnyResolvedNodeProto in wire format.
+  static zetasql_base::StatusOr<ResolvedNodeProtoView> Create(
+      absl::string_view serialized);
+
+  ResolvedNodeKind node_kind() const { return node_kind_; }
+  std::string node_kind_string() const {
+    return ResolvedNodeKindToString(node_kind_);
+  }
+
+  // The proto of this node, e.g. ResolvedLiteralProto, and its serialized
+  // bytes.
+  const google::protobuf::Descriptor* descriptor() const { return descriptor_; }
+  absl::string_view serialized() const { return serialized_; }
+
+  // Returns true if the non-repeated field <field_name> is set.
+  zetasql_base::StatusOr<bool> HasField(absl::string_view field_name) const;
+
+  // Returns the value of the non-repeated integer, bool or enum field
+  // <field_name>, or its default value if it is not set.
+  zetasql_base::StatusOr<int64_t> GetInt64(absl::string_view field_name) const;
+
+  // Returns the value of the non-repeated string or bytes field <field_name>,
+  // or the serialized value of the non-repeated message field <field_name>.
+  // Returns an empty string if the field is not set.
+  zetasql_base::StatusOr<absl::string_view> GetBytes(
+      absl::string_view field_name) const;
+
+  // Returns the node in the non-repeated node field <field_name>, or an error
+  // if it is not set.
+  zetasql_base::StatusOr<ResolvedNodeProtoView> GetNode(
+      absl::string_view field_name) const;
+
+  // Sets <*nodes> to the nodes in the repeated node field <field_name>.
+  zetasql_base::Status GetNodeList(absl::string_view field_name,
+                           std::vector<ResolvedNodeProtoView>* nodes) const;
+
+  // Deserializes this node and its subtree, as ResolvedNode::RestoreFrom()
+  // does.
+  zetasql_base::StatusOr<std::unique_ptr<ResolvedNode>> Materialize(
+      const ResolvedNode::RestoreParams& params) const;
+
+ private:
+  ResolvedNodeProtoView(absl::string_view serialized,
+                        const google::protobuf::Descriptor* descriptor,
+                        ResolvedNodeKind node_kind)
+      : serialized_(serialized),
+        descriptor_(descriptor),
+        node_kind_(node_kind) {}
+
+  // Returns a view of the node in <serialized>, a serialized message of type
+  // <descriptor>, which is either the proto of a node or one of the
+  // AnyResolved*Proto messages that hold a node of an abstract class.
+  static zetasql_base::StatusOr<ResolvedNodeProtoView> CreateForMessage(
+      absl::string_view serialized, const google::protobuf::Descriptor* descriptor);
+
+  // Finds the field <field_name> of this node. Sets <*message> to the
+  // serialized proto of this node or of the parent class that defines the
+  // field.
+  zetasql_base::Status FindField(absl::string_view field_name,
+                         absl::string_view* message,
+                         const google::protobuf::FieldDescriptor** field) const;
+
+  absl::string_view serialized_;  // Not owned.
+  const google::protobuf::Descriptor* descriptor_;
+  ResolvedNodeKind node_kind_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_RESOLVED_AST_RESOLVED_NODE_PROTO_VIEW_H_
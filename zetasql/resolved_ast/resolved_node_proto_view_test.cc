@@ -0,0 +1,104 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/resolved_ast/resolved_node_proto_view.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/id_string.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/serialization.pb.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+TEST(ResolvedNodeProtoViewTest, ReadsInPlace) {
+  SimpleColumn column("bar" /* table_name */, "baz" /* name */,
+                      types::Int64Type());
+  SimpleTable table("bar", {&column}, false /* takes_ownership */,
+                    123 /* id */);
+  SimpleCatalog catalog("foo");
+  catalog.AddTable(&table);
+  TypeFactory factory;
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement("select baz, 5 from bar;", AnalyzerOptions(),
+                             &catalog, &factory, &output));
+  AnyResolvedNodeProto proto;
+  FileDescriptorSetMap map;
+  ZETASQL_ASSERT_OK(output->resolved_statement()->SaveTo(&map, &proto));
+  const std::string serialized = proto.SerializeAsString();
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(ResolvedNodeProtoView query,
+                       ResolvedNodeProtoView::Create(serialized));
+  EXPECT_EQ(RESOLVED_QUERY_STMT, query.node_kind());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(ResolvedNodeProtoView project,
+                       query.GetNode("query"));
+  EXPECT_EQ(RESOLVED_PROJECT_SCAN, project.node_kind());
+  // A field inherited from ResolvedScan.
+  EXPECT_FALSE(project.GetInt64("is_ordered").ValueOrDie());
+  EXPECT_FALSE(project.GetNode("no_such_field").ok());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(ResolvedNodeProtoView table_scan,
+                       project.GetNode("input_scan"));
+  EXPECT_EQ(RESOLVED_TABLE_SCAN, table_scan.node_kind());
+  EXPECT_TRUE(table_scan.HasField("table").ValueOrDie());
+  EXPECT_FALSE(table_scan.HasField("for_system_time_expr").ValueOrDie());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(absl::string_view table_ref_bytes,
+                       table_scan.GetBytes("table"));
+  TableRefProto table_ref;
+  ASSERT_TRUE(table_ref.ParseFromArray(table_ref_bytes.data(),
+                                       table_ref_bytes.size()));
+  EXPECT_EQ("bar", table_ref.name());
+  EXPECT_EQ(123, table_ref.serialization_id());
+
+  std::vector<ResolvedNodeProtoView> expr_list;
+  ZETASQL_ASSERT_OK(project.GetNodeList("expr_list", &expr_list));
+  ASSERT_EQ(1, expr_list.size());
+  EXPECT_EQ(RESOLVED_COMPUTED_COLUMN, expr_list[0].node_kind());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(ResolvedNodeProtoView literal,
+                       expr_list[0].GetNode("expr"));
+  EXPECT_EQ(RESOLVED_LITERAL, literal.node_kind());
+
+  // Materializing the whole tree or one subtree gives the same nodes as
+  // deserializing the proto.
+  std::vector<const google::protobuf::DescriptorPool*> pools;
+  for (const auto& entry : map) pools.push_back(entry.first);
+  IdStringPool string_pool;
+  ResolvedNode::RestoreParams restore_params(pools, &catalog, &factory,
+                                             &string_pool);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ResolvedNode> restored_query,
+                       query.Materialize(restore_params));
+  EXPECT_EQ(output->resolved_statement()->DebugString(),
+            restored_query->DebugString());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ResolvedNode> restored_literal,
+                       literal.Materialize(restore_params));
+  ASSERT_TRUE(restored_literal->Is<ResolvedLiteral>());
+  EXPECT_EQ(5,
+            restored_literal->GetAs<ResolvedLiteral>()->value().int64_value());
+
+  EXPECT_FALSE(ResolvedNodeProtoView::Create("not a proto").ok());
+  EXPECT_FALSE(ResolvedNodeProtoView::Create("").ok());
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -1752,15 +1752,19 @@ static std::string GetJoinTypeString(ResolvedJoinScan::JoinType join_type,
   }
 }
 
-zetasql_base::StatusOr<std::string> SQLBuilder::GetJoinOperand(
+zetasql_base::StatusOr<absl::Cord> SQLBuilder::GetJoinOperand(
     const ResolvedScan* scan) {
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<QueryFragment> scan_f, ProcessNode(scan));
+  ZETASQL_RET_CHECK(scan_f->query_expression != nullptr);
 
   std::string alias = GetScanAlias(scan);
   ZETASQL_RETURN_IF_ERROR(AddSelectListIfNeeded(scan->column_list(),
                                         scan_f->query_expression.get()));
   SetPathForColumnList(scan->column_list(), alias);
-  return absl::StrCat("(", scan_f->GetSQL(), ") AS ", alias);
+  absl::Cord operand("(");
+  scan_f->query_expression->AppendSQLQuery(&operand);
+  operand.Append(absl::StrCat(") AS ", alias));
+  return operand;
 }
 
 std::string SQLBuilder::MakeNonconflictingAlias(const std::string& name) {
@@ -1841,26 +1845,24 @@ void SQLBuilder::SetPathForColumnsInScan(const ResolvedScan* scan,
 
 zetasql_base::Status SQLBuilder::VisitResolvedJoinScan(const ResolvedJoinScan* node) {
   std::unique_ptr<QueryExpression> query_expression(new QueryExpression);
-  ZETASQL_ASSIGN_OR_RETURN(const std::string left_join_operand,
-                   GetJoinOperand(node->left_scan()));
-  ZETASQL_ASSIGN_OR_RETURN(const std::string right_join_operand,
+  ZETASQL_ASSIGN_OR_RETURN(absl::Cord from, GetJoinOperand(node->left_scan()));
+  ZETASQL_ASSIGN_OR_RETURN(const absl::Cord right_join_operand,
                    GetJoinOperand(node->right_scan()));
 
   std::string hints = "";
   if (node->hint_list_size() > 0) {
     ZETASQL_RETURN_IF_ERROR(AppendHintsIfPresent(node->hint_list(), &hints));
   }
-  std::string from;
-  absl::StrAppend(
-      &from, left_join_operand, " ",
-      GetJoinTypeString(node->join_type(), node->join_expr() != nullptr), hints,
-      " ", right_join_operand);
+  from.Append(absl::StrCat(
+      " ", GetJoinTypeString(node->join_type(), node->join_expr() != nullptr),
+      hints, " "));
+  from.Append(right_join_operand);
   if (node->join_expr() != nullptr) {
     ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<QueryFragment> result,
                      ProcessNode(node->join_expr()));
-    absl::StrAppend(&from, " ON ", result->GetSQL());
+    from.Append(absl::StrCat(" ON ", result->GetSQL()));
   }
-  ZETASQL_RET_CHECK(query_expression->TrySetFromClause(from));
+  ZETASQL_RET_CHECK(query_expression->TrySetFromClause(std::move(from)));
   PushSQLForQueryExpression(node, query_expression.release());
   return ::zetasql_base::OkStatus();
 }
@@ -1873,30 +1875,28 @@ zetasql_base::Status SQLBuilder::VisitResolvedColumnHolder(
 
 zetasql_base::Status SQLBuilder::VisitResolvedArrayScan(const ResolvedArrayScan* node) {
   std::unique_ptr<QueryExpression> query_expression(new QueryExpression);
-  std::string from;
+  absl::Cord from;
   if (node->input_scan() != nullptr) {
-    ZETASQL_ASSIGN_OR_RETURN(const std::string join_operand,
-                     GetJoinOperand(node->input_scan()));
-    absl::StrAppend(&from, join_operand, node->is_outer() ? " LEFT" : "",
-                    " JOIN ");
+    ZETASQL_ASSIGN_OR_RETURN(from, GetJoinOperand(node->input_scan()));
+    from.Append(node->is_outer() ? " LEFT JOIN " : " JOIN ");
   }
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<QueryFragment> result,
                    ProcessNode(node->array_expr()));
-  absl::StrAppend(&from, "UNNEST(", result->GetSQL(), ") ",
-                  GetColumnAlias(node->element_column()));
+  from.Append(absl::StrCat("UNNEST(", result->GetSQL(), ") ",
+                           GetColumnAlias(node->element_column())));
 
   if (node->array_offset_column() != nullptr) {
     ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<QueryFragment> result,
                      ProcessNode(node->array_offset_column()));
-    absl::StrAppend(&from, " WITH OFFSET ", result->GetSQL());
+    from.Append(absl::StrCat(" WITH OFFSET ", result->GetSQL()));
   }
   if (node->join_expr() != nullptr) {
     ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<QueryFragment> result,
                      ProcessNode(node->join_expr()));
-    absl::StrAppend(&from, " ON ", result->GetSQL());
+    from.Append(absl::StrCat(" ON ", result->GetSQL()));
   }
 
-  ZETASQL_RET_CHECK(query_expression->TrySetFromClause(from));
+  ZETASQL_RET_CHECK(query_expression->TrySetFromClause(std::move(from)));
   PushSQLForQueryExpression(node, query_expression.release());
   return ::zetasql_base::OkStatus();
 }
@@ -38,6 +38,7 @@
 #include "zetasql/resolved_ast/resolved_node.h"
 #include <cstdint>
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
@@ -413,7 +414,7 @@ class SQLBuilder : public ResolvedASTVisitor {
 
   // Returns the sql text associated with a left/right join scan. Adds explicit
   // scan alias if necessary.
-  zetasql_base::StatusOr<std::string> GetJoinOperand(const ResolvedScan* scan);
+  zetasql_base::StatusOr<absl::Cord> GetJoinOperand(const ResolvedScan* scan);
 
   // Helper function which fetches the list of function arguments
   zetasql_base::StatusOr<std::string> GetFunctionArgListString(
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <string>
 #include <type_traits>
+#include <utility>
 
 #include "zetasql/base/logging.h"
 #include "zetasql/base/varsetter.h"
@@ -39,6 +40,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "zetasql/base/case.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/stl_util.h"
@@ -50,8 +52,105 @@
 
 namespace zetasql {
 
-Validator::Validator(const LanguageOptions& language_options)
-    : language_options_(language_options) {}
+void ValidatorTimingReport::RecordValidation(const NodeKindCostMap& costs) {
+  absl::MutexLock lock(&mutex_);
+  ++num_validated_;
+  for (const auto& entry : costs) {
+    NodeKindCost& cost = costs_[entry.first];
+    cost.num_nodes += entry.second.num_nodes;
+    cost.time += entry.second.time;
+  }
+}
+
+void ValidatorTimingReport::RecordSkippedValidation() {
+  absl::MutexLock lock(&mutex_);
+  ++num_skipped_;
+}
+
+int64_t ValidatorTimingReport::num_validated() const {
+  absl::MutexLock lock(&mutex_);
+  return num_validated_;
+}
+
+int64_t ValidatorTimingReport::num_skipped() const {
+  absl::MutexLock lock(&mutex_);
+  return num_skipped_;
+}
+
+std::map<ResolvedNodeKind, ValidatorTimingReport::NodeKindCost>
+ValidatorTimingReport::GetCosts() const {
+  absl::MutexLock lock(&mutex_);
+  return std::map<ResolvedNodeKind, NodeKindCost>(costs_.begin(),
+                                                  costs_.end());
+}
+
+std::string ValidatorTimingReport::DebugString() const {
+  std::vector<std::pair<ResolvedNodeKind, NodeKindCost>> costs;
+  std::string debug_string;
+  {
+    absl::MutexLock lock(&mutex_);
+    costs.assign(costs_.begin(), costs_.end());
+    debug_string = absl::StrCat("Validated ", num_validated_, " trees, skipped ",
+                                num_skipped_, "\n");
+  }
+  std::sort(costs.begin(), costs.end(),
+            [](const std::pair<ResolvedNodeKind, NodeKindCost>& a,
+               const std::pair<ResolvedNodeKind, NodeKindCost>& b) {
+              return a.second.time > b.second.time;
+            });
+  for (const auto& entry : costs) {
+    absl::StrAppend(&debug_string, ResolvedNodeKindToString(entry.first), ": ",
+                    entry.second.num_nodes, " nodes, ",
+                    absl::FormatDuration(entry.second.time), "\n");
+  }
+  return debug_string;
+}
+
+void ValidatorTimingReport::Clear() {
+  absl::MutexLock lock(&mutex_);
+  costs_.clear();
+  num_validated_ = 0;
+  num_skipped_ = 0;
+}
+
+class Validator::ScopedNodeTimer {
+ public:
+  ScopedNodeTimer(const Validator* validator, const ResolvedNode* node)
+      : validator_(validator->options_.timing_report != nullptr ? validator
+                                                                : nullptr),
+        node_kind_(node->node_kind()) {
+    if (validator_ != nullptr) {
+      validator_->timer_stack_.push_back({absl::GetCurrentTimeNanos(), 0});
+    }
+  }
+  ScopedNodeTimer(const ScopedNodeTimer&) = delete;
+  ScopedNodeTimer& operator=(const ScopedNodeTimer&) = delete;
+
+  ~ScopedNodeTimer() {
+    if (validator_ == nullptr) return;
+    const TimerFrame frame = validator_->timer_stack_.back();
+    validator_->timer_stack_.pop_back();
+    const int64_t nanos = absl::GetCurrentTimeNanos() - frame.start_nanos;
+    ValidatorTimingReport::NodeKindCost& cost = validator_->costs_[node_kind_];
+    ++cost.num_nodes;
+    cost.time += absl::Nanoseconds(nanos - frame.children_nanos);
+    if (!validator_->timer_stack_.empty()) {
+      validator_->timer_stack_.back().children_nanos += nanos;
+    } else {
+      // This was the root of a tree.
+      validator_->options_.timing_report->RecordValidation(validator_->costs_);
+      validator_->costs_.clear();
+    }
+  }
+
+ private:
+  const Validator* validator_;
+  const ResolvedNodeKind node_kind_;
+};
+
+Validator::Validator(const LanguageOptions& language_options,
+                     const ValidatorOptions& options)
+    : language_options_(language_options), options_(options) {}
 
 static bool IsEmptyWindowFrame(const ResolvedWindowFrame& window_frame) {
   const ResolvedWindowFrameExpr* frame_start_expr = window_frame.start_expr();
@@ -247,6 +346,8 @@ zetasql_base::Status Validator::ValidateResolvedExpr(
   ZETASQL_RET_CHECK(nullptr != expr);
   ZETASQL_RET_CHECK(expr->type() != nullptr)
       << "ResolvedExpr does not have a Type:\n" << expr->DebugString();
+  if (!options_.validate_expressions) return zetasql_base::OkStatus();
+  ScopedNodeTimer timer(this, expr);
 
   switch (expr->node_kind()) {
     case RESOLVED_LITERAL:
@@ -1488,6 +1589,7 @@ zetasql_base::Status Validator::ValidateResolvedWithScan(
 zetasql_base::Status Validator::ValidateResolvedStatement(
     const ResolvedStatement* statement) {
   ZETASQL_RET_CHECK(nullptr != statement);
+  ScopedNodeTimer timer(this, statement);
 
   zetasql_base::Status status;
   switch (statement->node_kind()) {
@@ -2345,6 +2447,7 @@ zetasql_base::Status Validator::ValidateResolvedScan(
     const ResolvedScan* scan,
     const std::set<ResolvedColumn>& visible_parameters) const {
   ZETASQL_RET_CHECK(nullptr != scan);
+  ScopedNodeTimer timer(this, scan);
 
   switch (scan->node_kind()) {
     case RESOLVED_SINGLE_ROW_SCAN:
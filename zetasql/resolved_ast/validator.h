@@ -18,20 +18,86 @@
 #define ZETASQL_RESOLVED_AST_VALIDATOR_H_
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <set>
+#include <string>
 #include <vector>
 
+#include <cstdint>
+
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/table_valued_function.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/resolved_ast_enums.pb.h"
 #include "zetasql/resolved_ast/resolved_column.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "zetasql/base/status.h"
 
 namespace zetasql {
 
+// Collects the time that Validators spend on each kind of resolved node, to
+// find out what validation costs on a workload. Costs are exclusive: the time
+// for a scan does not include the time for its input scans and expressions,
+// which are counted under their own node kinds. Nodes that are validated as
+// parts of their parents, e.g. ResolvedComputedColumns, count towards their
+// parents.
+//
+// This class is thread-safe, so one report can collect the costs of all the
+// validations in a process.
+class ValidatorTimingReport {
+ public:
+  struct NodeKindCost {
+    int64_t num_nodes = 0;
+    absl::Duration time;
+  };
+  using NodeKindCostMap = absl::flat_hash_map<ResolvedNodeKind, NodeKindCost>;
+
+  ValidatorTimingReport() = default;
+  ValidatorTimingReport(const ValidatorTimingReport&) = delete;
+  ValidatorTimingReport& operator=(const ValidatorTimingReport&) = delete;
+
+  // Adds the costs of validating one tree.
+  void RecordValidation(const NodeKindCostMap& costs)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Counts a tree that was not validated because of sampling.
+  void RecordSkippedValidation() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int64_t num_validated() const ABSL_LOCKS_EXCLUDED(mutex_);
+  int64_t num_skipped() const ABSL_LOCKS_EXCLUDED(mutex_);
+  std::map<ResolvedNodeKind, NodeKindCost> GetCosts() const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns one line per node kind with its number of nodes and total time,
+  // the most expensive node kinds first.
+  std::string DebugString() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  void Clear() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  mutable absl::Mutex mutex_;
+  NodeKindCostMap costs_ ABSL_GUARDED_BY(mutex_);
+  int64_t num_validated_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t num_skipped_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+struct ValidatorOptions {
+  // If false, only validates the statement and its scans, e.g. that the
+  // column_list of each scan is produced by the scan or its inputs, and not
+  // the expressions in them, nor subqueries inside expressions. This is much
+  // cheaper on large trees, since most of their nodes are expressions.
+  bool validate_expressions = true;
+
+  // If not NULL, the Validator adds the time it spends on each kind of node
+  // to this report after validating each tree. Not owned.
+  ValidatorTimingReport* timing_report = nullptr;
+};
+
 // Used to validate generated Resolved AST structures.
 //  * verifies that any column reference  within the resolved tree should be
 //    either from the column_list of one of the child nodes of the parent scan
@@ -39,7 +105,8 @@ namespace zetasql {
 class Validator {
  public:
   Validator();
-  explicit Validator(const LanguageOptions& language_options);
+  explicit Validator(const LanguageOptions& language_options,
+                     const ValidatorOptions& options = ValidatorOptions());
   Validator(const Validator&) = delete;
   Validator& operator=(const Validator&) = delete;
   ~Validator();
@@ -49,7 +116,21 @@ class Validator {
   zetasql_base::Status ValidateStandaloneResolvedExpr(const ResolvedExpr* expr) const;
 
  private:
+  // Measures the exclusive time spent validating a node if the options have a
+  // timing report.
+  class ScopedNodeTimer;
+
   const LanguageOptions language_options_;
+  const ValidatorOptions options_;
+
+  // The start times of the nodes being timed by ScopedNodeTimers, and the
+  // time spent in their timed descendants.
+  struct TimerFrame {
+    int64_t start_nanos;
+    int64_t children_nanos;
+  };
+  mutable std::vector<TimerFrame> timer_stack_;
+  mutable ValidatorTimingReport::NodeKindCostMap costs_;
 
   // Statements.
   zetasql_base::Status ValidateResolvedQueryStmt(const ResolvedQueryStmt* query) const;
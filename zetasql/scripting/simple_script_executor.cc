@@ -0,0 +1,368 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/scripting/simple_script_executor.h"
+
+#include "zetasql/common/errors.h"
+#include "zetasql/common/status_payload_utils.h"
+#include "zetasql/parser/parse_tree.h"
+#include "zetasql/public/error_location.pb.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/scripting/error_helpers.h"
+#include "zetasql/scripting/script_exception.pb.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+
+// Returns true if an EXCEPTION clause can handle <status>: errors raised as
+// script exceptions, and errors of evaluation.
+bool IsHandleable(const zetasql_base::Status& status) {
+  return internal::HasPayloadWithType<ScriptException>(status) ||
+         status.code() == zetasql_base::StatusCode::kOutOfRange;
+}
+
+std::string VariableName(const ASTIdentifier* identifier) {
+  return absl::AsciiStrToLower(identifier->GetAsString());
+}
+
+}  // namespace
+
+zetasql_base::StatusOr<std::unique_ptr<SimpleScriptExecutor>>
+SimpleScriptExecutor::Create(const std::string& script,
+                             const SimpleScriptExecutorOptions& options,
+                             Catalog* catalog) {
+  std::unique_ptr<SimpleScriptExecutor> executor =
+      absl::WrapUnique(new SimpleScriptExecutor(script, options, catalog));
+  ZETASQL_ASSIGN_OR_RETURN(
+      executor->parsed_script_,
+      ParsedScript::Create(executor->script_,
+                           options.analyzer_options.GetParserOptions(),
+                           options.analyzer_options.error_message_mode()));
+  return executor;
+}
+
+SimpleScriptExecutor::SimpleScriptExecutor(
+    const std::string& script, const SimpleScriptExecutorOptions& options,
+    Catalog* catalog)
+    : script_(script), options_(options), catalog_(catalog) {}
+
+zetasql_base::Status SimpleScriptExecutor::Execute() {
+  variables_.clear();
+  exceptions_.clear();
+  const ControlFlowGraph& graph = parsed_script_->control_flow_graph();
+  int64_t num_executed_nodes = 0;
+  for (const ControlFlowNode* node = graph.start_node();
+       node != graph.end_node();) {
+    if (options_.max_executed_nodes > 0 &&
+        num_executed_nodes >= options_.max_executed_nodes) {
+      return zetasql_base::ResourceExhaustedErrorBuilder()
+             << "Script executed more than " << options_.max_executed_nodes
+             << " statements";
+    }
+    ++num_executed_nodes;
+    ++num_executed_nodes_;
+
+    zetasql_base::StatusOr<ControlFlowEdge::Kind> kind = ExecuteNode(node);
+    zetasql_base::Status error;
+    const ControlFlowEdge* edge = nullptr;
+    if (kind.ok()) {
+      auto it = node->successors().find(kind.ValueOrDie());
+      ZETASQL_RET_CHECK(it != node->successors().end())
+          << "No " << ControlFlowEdgeKindString(kind.ValueOrDie())
+          << " edge from " << node->DebugString();
+      edge = it->second;
+    } else {
+      error = kind.status();
+      auto it = node->successors().find(ControlFlowEdge::Kind::kException);
+      if (!IsHandleable(error) || it == node->successors().end()) {
+        return ConvertInternalErrorLocationAndAdjustErrorString(
+            options_.analyzer_options.error_message_mode(), script_, error);
+      }
+      edge = it->second;
+    }
+    FollowEdge(edge, error);
+    node = edge->successor();
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::StatusOr<ControlFlowEdge::Kind> SimpleScriptExecutor::ExecuteNode(
+    const ControlFlowNode* node) {
+  const ASTNode* ast_node = node->ast_node();
+  // The body of an empty LOOP.
+  if (ast_node == nullptr) return ControlFlowEdge::Kind::kNormal;
+
+  const ASTExpression* condition = nullptr;
+  switch (ast_node->node_kind()) {
+    case AST_IF_STATEMENT:
+      condition = ast_node->GetAsOrDie<ASTIfStatement>()->condition();
+      break;
+    case AST_ELSEIF_CLAUSE:
+      condition = ast_node->GetAsOrDie<ASTElseifClause>()->condition();
+      break;
+    case AST_WHILE_STATEMENT:
+      condition = ast_node->GetAsOrDie<ASTWhileStatement>()->condition();
+      // A LOOP has no condition.
+      if (condition == nullptr) return ControlFlowEdge::Kind::kNormal;
+      break;
+    case AST_VARIABLE_DECLARATION:
+      ZETASQL_RETURN_IF_ERROR(ExecuteVariableDeclaration(
+          node, ast_node->GetAsOrDie<ASTVariableDeclaration>()));
+      return ControlFlowEdge::Kind::kNormal;
+    case AST_SINGLE_ASSIGNMENT:
+      ZETASQL_RETURN_IF_ERROR(ExecuteSingleAssignment(
+          node, ast_node->GetAsOrDie<ASTSingleAssignment>()));
+      return ControlFlowEdge::Kind::kNormal;
+    case AST_QUERY_STATEMENT:
+      ZETASQL_RETURN_IF_ERROR(
+          ExecuteQuery(node, ast_node->GetAsOrDie<ASTQueryStatement>()));
+      return ControlFlowEdge::Kind::kNormal;
+    case AST_RAISE_STATEMENT:
+      return ExecuteRaise(node, ast_node->GetAsOrDie<ASTRaiseStatement>());
+    case AST_BREAK_STATEMENT:
+    case AST_CONTINUE_STATEMENT:
+    case AST_RETURN_STATEMENT:
+      // The control flow graph already has the edges of these.
+      return ControlFlowEdge::Kind::kNormal;
+    default:
+      return MakeSqlErrorAt(ast_node)
+             << "Statement not supported by SimpleScriptExecutor: "
+             << ast_node->GetNodeKindString();
+  }
+
+  ZETASQL_ASSIGN_OR_RETURN(const Value value,
+                   EvaluateExpression(node, condition, types::BoolType()));
+  // As in WHERE, a NULL condition is not satisfied.
+  return !value.is_null() && value.bool_value()
+             ? ControlFlowEdge::Kind::kTrueCondition
+             : ControlFlowEdge::Kind::kFalseCondition;
+}
+
+zetasql_base::Status SimpleScriptExecutor::ExecuteVariableDeclaration(
+    const ControlFlowNode* node, const ASTVariableDeclaration* declaration) {
+  const ASTExpression* default_value = declaration->default_value();
+  CachedNode* cached = FindCachedNode(node);
+  if (cached == nullptr) {
+    std::unique_ptr<CachedNode> new_node = MakeCachedNode();
+    if (declaration->type() != nullptr) {
+      const ScriptSegment segment =
+          ScriptSegment::FromASTNode(script_, declaration->type());
+      ZETASQL_ASSIGN_OR_RETURN(const AnalyzerOptions analyzer_options,
+                       MakeAnalyzerOptions(/*variables_as_columns=*/false));
+      ZETASQL_RETURN_IF_ERROR(AnalyzeType(std::string(segment.GetSegmentText()),
+                                  analyzer_options, catalog_, &type_factory_,
+                                  &new_node->declared_type))
+          .With(ConvertLocalErrorToScriptError(segment));
+    }
+    if (default_value != nullptr) {
+      ZETASQL_RETURN_IF_ERROR(PrepareExpression(
+          default_value, new_node->declared_type, new_node.get()));
+    }
+    ZETASQL_RET_CHECK(new_node->declared_type != nullptr ||
+              new_node->expression != nullptr);
+    cached = StoreCachedNode(node, std::move(new_node));
+  }
+
+  Value value;
+  if (cached->expression != nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(value, ExecuteExpression(*cached));
+  } else {
+    value = Value::Null(cached->declared_type);
+  }
+  for (const ASTIdentifier* identifier :
+       declaration->variable_list()->identifier_list()) {
+    variables_[VariableName(identifier)] = value;
+  }
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status SimpleScriptExecutor::ExecuteSingleAssignment(
+    const ControlFlowNode* node, const ASTSingleAssignment* assignment) {
+  auto it = variables_.find(VariableName(assignment->variable()));
+  if (it == variables_.end()) {
+    return MakeSqlErrorAt(assignment->variable())
+           << "Undeclared variable: "
+           << assignment->variable()->GetAsString();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      Value value,
+      EvaluateExpression(node, assignment->expression(), it->second.type()));
+  it->second = std::move(value);
+  return zetasql_base::OkStatus();
+}
+
+zetasql_base::Status SimpleScriptExecutor::ExecuteQuery(
+    const ControlFlowNode* node, const ASTQueryStatement* query) {
+  const ScriptSegment segment = ScriptSegment::FromASTNode(script_, query);
+  CachedNode* cached = FindCachedNode(node);
+  if (cached == nullptr) {
+    std::unique_ptr<CachedNode> new_node = MakeCachedNode();
+    ZETASQL_ASSIGN_OR_RETURN(const AnalyzerOptions analyzer_options,
+                     MakeAnalyzerOptions(/*variables_as_columns=*/false));
+    ZETASQL_RETURN_IF_ERROR(AnalyzeStatement(segment.GetSegmentText(),
+                                     analyzer_options, catalog_, &type_factory_,
+                                     &new_node->analyzer_output))
+        .With(ConvertLocalErrorToScriptError(segment));
+    const ResolvedStatement* statement =
+        new_node->analyzer_output->resolved_statement();
+    ZETASQL_RET_CHECK_EQ(statement->node_kind(), RESOLVED_QUERY_STMT);
+    new_node->query = absl::make_unique<PreparedQuery>(
+        statement->GetAs<ResolvedQueryStmt>(), options_.evaluator_options);
+    ZETASQL_RETURN_IF_ERROR(
+        new_node->query->Prepare(analyzer_options, catalog_));
+    cached = StoreCachedNode(node, std::move(new_node));
+  }
+
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iterator,
+                   cached->query->Execute(variables_));
+  if (options_.query_result_callback) {
+    return options_.query_result_callback(segment, iterator.get());
+  }
+  while (iterator->NextRow()) {
+  }
+  return iterator->Status();
+}
+
+zetasql_base::Status SimpleScriptExecutor::ExecuteRaise(
+    const ControlFlowNode* node, const ASTRaiseStatement* raise) {
+  if (raise->is_rethrow()) {
+    if (exceptions_.empty()) {
+      return MakeSqlErrorAt(raise)
+             << "Cannot re-raise an exception outside of an exception handler";
+    }
+    return exceptions_.back();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      const Value message,
+      EvaluateExpression(node, raise->message(), types::StringType()));
+  return MakeScriptExceptionAt(raise)
+         << (message.is_null() ? "NULL" : message.string_value());
+}
+
+zetasql_base::StatusOr<Value> SimpleScriptExecutor::EvaluateExpression(
+    const ControlFlowNode* node, const ASTExpression* expression,
+    const Type* target_type) {
+  CachedNode* cached = FindCachedNode(node);
+  if (cached == nullptr) {
+    std::unique_ptr<CachedNode> new_node = MakeCachedNode();
+    ZETASQL_RETURN_IF_ERROR(
+        PrepareExpression(expression, target_type, new_node.get()));
+    cached = StoreCachedNode(node, std::move(new_node));
+  }
+  return ExecuteExpression(*cached);
+}
+
+zetasql_base::Status SimpleScriptExecutor::PrepareExpression(
+    const ASTExpression* expression, const Type* target_type,
+    CachedNode* cached) {
+  const ScriptSegment segment = ScriptSegment::FromASTNode(script_, expression);
+  ZETASQL_ASSIGN_OR_RETURN(const AnalyzerOptions analyzer_options,
+                   MakeAnalyzerOptions(/*variables_as_columns=*/true));
+  ZETASQL_RETURN_IF_ERROR(AnalyzeExpressionForAssignmentToType(
+                      segment.GetSegmentText(), analyzer_options, catalog_,
+                      &type_factory_, target_type, &cached->analyzer_output))
+      .With(ConvertLocalErrorToScriptError(segment));
+  cached->expression = absl::make_unique<PreparedExpression>(
+      cached->analyzer_output->resolved_expr(), options_.evaluator_options);
+  return cached->expression->Prepare(analyzer_options, catalog_);
+}
+
+zetasql_base::StatusOr<Value> SimpleScriptExecutor::ExecuteExpression(
+    const CachedNode& cached) const {
+  // The expression sees each variable both as a column and as a parameter.
+  return cached.expression->ExecuteAfterPrepare(/*columns=*/variables_,
+                                                /*parameters=*/variables_);
+}
+
+SimpleScriptExecutor::CachedNode* SimpleScriptExecutor::FindCachedNode(
+    const ControlFlowNode* node) const {
+  auto it = cached_nodes_.find(node);
+  if (it == cached_nodes_.end()) return nullptr;
+  const CachedNode& cached = *it->second;
+  // The analysis depends on the names and types of the variables in scope,
+  // which usually are the same each time the node is reached.
+  if (cached.signature.size() != variables_.size()) return nullptr;
+  auto signature_it = cached.signature.begin();
+  for (const auto& variable : variables_) {
+    if (signature_it->first != variable.first ||
+        !signature_it->second->Equals(variable.second.type())) {
+      return nullptr;
+    }
+    ++signature_it;
+  }
+  return it->second.get();
+}
+
+std::unique_ptr<SimpleScriptExecutor::CachedNode>
+SimpleScriptExecutor::MakeCachedNode() const {
+  auto cached = absl::make_unique<CachedNode>();
+  cached->signature.reserve(variables_.size());
+  for (const auto& variable : variables_) {
+    cached->signature.emplace_back(variable.first, variable.second.type());
+  }
+  return cached;
+}
+
+SimpleScriptExecutor::CachedNode* SimpleScriptExecutor::StoreCachedNode(
+    const ControlFlowNode* node, std::unique_ptr<CachedNode> cached) {
+  ++num_analyzed_nodes_;
+  std::unique_ptr<CachedNode>& entry = cached_nodes_[node];
+  entry = std::move(cached);
+  return entry.get();
+}
+
+zetasql_base::StatusOr<AnalyzerOptions>
+SimpleScriptExecutor::MakeAnalyzerOptions(bool variables_as_columns) const {
+  AnalyzerOptions analyzer_options = options_.analyzer_options;
+  // Errors are moved to their place in the script through their payloads.
+  analyzer_options.set_error_message_mode(ERROR_MESSAGE_WITH_PAYLOAD);
+  for (const auto& variable : variables_) {
+    if (variables_as_columns) {
+      ZETASQL_RETURN_IF_ERROR(analyzer_options.AddExpressionColumn(
+          variable.first, variable.second.type()));
+    }
+    ZETASQL_RETURN_IF_ERROR(analyzer_options.AddQueryParameter(
+        variable.first, variable.second.type()));
+  }
+  return analyzer_options;
+}
+
+void SimpleScriptExecutor::FollowEdge(const ControlFlowEdge* edge,
+                                      const zetasql_base::Status& error) {
+  auto it = side_effects_.find(edge);
+  if (it == side_effects_.end()) {
+    it = side_effects_.emplace(edge, edge->ComputeSideEffects()).first;
+  }
+  const ControlFlowEdge::SideEffects& side_effects = it->second;
+  for (const std::string& name : side_effects.destroyed_variables) {
+    variables_.erase(absl::AsciiStrToLower(name));
+  }
+  for (int i = 0; i < side_effects.num_exception_handlers_exited &&
+                  !exceptions_.empty();
+       ++i) {
+    exceptions_.pop_back();
+  }
+  if (side_effects.exception_handler_entered) {
+    exceptions_.push_back(error);
+  }
+}
+
+}  // namespace zetasql
@@ -0,0 +1,201 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_SCRIPTING_SIMPLE_SCRIPT_EXECUTOR_H_
+#define ZETASQL_SCRIPTING_SIMPLE_SCRIPT_EXECUTOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/scripting/control_flow_graph.h"
+#include "zetasql/scripting/parsed_script.h"
+#include "zetasql/scripting/script_segment.h"
+#include "absl/container/flat_hash_map.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+struct SimpleScriptExecutorOptions {
+  // Options used to parse the script and to analyze each statement and
+  // expression in it. Variables are added to a copy of these options, so
+  // these must not already declare expression columns or query parameters
+  // with the same names.
+  AnalyzerOptions analyzer_options;
+
+  // Options used to evaluate each statement and expression.
+  EvaluatorOptions evaluator_options;
+
+  // Called with the rows of each query statement. The iterator is only valid
+  // during the call. If not set, the rows are read and dropped.
+  std::function<zetasql_base::Status(const ScriptSegment& segment,
+                             EvaluatorTableIterator* iterator)>
+      query_result_callback;
+
+  // If positive, Execute() fails once this many statements and conditions
+  // have been executed, so that a runaway loop does not run forever.
+  int64_t max_executed_nodes = 0;
+};
+
+// Executes a script with the reference implementation, one node of its
+// ControlFlowGraph at a time.
+//
+// Each statement or condition is analyzed and prepared the first time its
+// node is reached, and the result is kept with the node. Later executions of
+// the node, for instance in the following iterations of a loop, reuse it as
+// long as the names and types of the variables in scope are the same as when
+// it was analyzed, and only analyze it again otherwise.
+//
+// Supported statements are DECLARE, SET of a single variable, query
+// statements, IF, LOOP, WHILE, BREAK, CONTINUE, RETURN, BEGIN...END with an
+// EXCEPTION handler, and RAISE. Expressions (the conditions, DEFAULT values
+// and assigned values) see the variables in scope as columns, by name. Query
+// statements see them as named query parameters, e.g. "SELECT @x".
+//
+// Errors raised by RAISE, and errors of evaluation such as division by zero,
+// can be handled by an EXCEPTION clause. Analysis errors cannot. Errors have
+// ErrorLocation payloads relative to the whole script.
+//
+// Example:
+//   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<SimpleScriptExecutor> executor,
+//                    SimpleScriptExecutor::Create(
+//                        "DECLARE x INT64 DEFAULT 0;"
+//                        "WHILE x < 10 DO SET x = x + 1; END WHILE;",
+//                        options, &catalog));
+//   ZETASQL_RETURN_IF_ERROR(executor->Execute());
+//   // executor->variables() is empty, and
+//   // executor->num_analyzed_nodes() is 3.
+//
+// Not thread-safe.
+class SimpleScriptExecutor {
+ public:
+  // Parses <script>. <catalog>, which should contain the ZetaSQL built-in
+  // functions, must outlive the executor.
+  static zetasql_base::StatusOr<std::unique_ptr<SimpleScriptExecutor>> Create(
+      const std::string& script, const SimpleScriptExecutorOptions& options,
+      Catalog* catalog);
+
+  SimpleScriptExecutor(const SimpleScriptExecutor&) = delete;
+  SimpleScriptExecutor& operator=(const SimpleScriptExecutor&) = delete;
+
+  // Runs the script from the start. May be called more than once, in which
+  // case the analyses cached by the previous runs are reused.
+  zetasql_base::Status Execute();
+
+  // The variables in scope, by lower case name. After Execute() returns,
+  // these are the variables that were in scope when the script stopped, so
+  // the variables declared at the top of the script hold their final values.
+  const std::map<std::string, Value>& variables() const { return variables_; }
+
+  // The number of times that a node was analyzed and prepared, and the number
+  // of times a node was executed, over all the runs. For a loop, the first
+  // is the number of statements and conditions in the loop while the second
+  // grows with the number of iterations.
+  int64_t num_analyzed_nodes() const { return num_analyzed_nodes_; }
+  int64_t num_executed_nodes() const { return num_executed_nodes_; }
+
+ private:
+  // Analysis of one node, valid for the variable types in <signature>.
+  struct CachedNode {
+    std::vector<std::pair<std::string, const Type*>> signature;
+    // The declared type of the variables of a DECLARE statement, or NULL if
+    // it has no type or the node is not a DECLARE.
+    const Type* declared_type = nullptr;
+    std::unique_ptr<const AnalyzerOutput> analyzer_output;
+    std::unique_ptr<PreparedExpression> expression;
+    std::unique_ptr<PreparedQuery> query;
+  };
+
+  SimpleScriptExecutor(const std::string& script,
+                       const SimpleScriptExecutorOptions& options,
+                       Catalog* catalog);
+
+  // Runs <node>, and returns the kind of the edge to follow from it.
+  zetasql_base::StatusOr<ControlFlowEdge::Kind> ExecuteNode(
+      const ControlFlowNode* node);
+
+  zetasql_base::Status ExecuteVariableDeclaration(
+      const ControlFlowNode* node, const ASTVariableDeclaration* declaration);
+  zetasql_base::Status ExecuteSingleAssignment(
+      const ControlFlowNode* node, const ASTSingleAssignment* assignment);
+  zetasql_base::Status ExecuteQuery(const ControlFlowNode* node,
+                            const ASTQueryStatement* query);
+  zetasql_base::Status ExecuteRaise(const ControlFlowNode* node,
+                            const ASTRaiseStatement* raise);
+
+  // Evaluates <expression> from the statement of <node>, coerced to
+  // <target_type> if that is not NULL.
+  zetasql_base::StatusOr<Value> EvaluateExpression(const ControlFlowNode* node,
+                                           const ASTExpression* expression,
+                                           const Type* target_type);
+
+  // Analyzes and prepares <expression> into <cached>.
+  zetasql_base::Status PrepareExpression(const ASTExpression* expression,
+                                 const Type* target_type, CachedNode* cached);
+  zetasql_base::StatusOr<Value> ExecuteExpression(
+      const CachedNode& cached) const;
+
+  // Returns the analysis of <node>, or NULL if it was not analyzed yet or
+  // the variables in scope changed since it was.
+  CachedNode* FindCachedNode(const ControlFlowNode* node) const;
+  // Returns an empty analysis for the variables in scope.
+  std::unique_ptr<CachedNode> MakeCachedNode() const;
+  // Replaces the analysis of <node> by <cached>, and returns it.
+  CachedNode* StoreCachedNode(const ControlFlowNode* node,
+                              std::unique_ptr<CachedNode> cached);
+
+  // Returns the analyzer options for a node, with the variables in scope
+  // added as expression columns or as query parameters.
+  zetasql_base::StatusOr<AnalyzerOptions> MakeAnalyzerOptions(
+      bool variables_as_columns) const;
+
+  // Applies the side effects of following <edge>, given the error that
+  // caused it to be followed, if any.
+  void FollowEdge(const ControlFlowEdge* edge,
+                  const zetasql_base::Status& error);
+
+  const std::string script_;
+  const SimpleScriptExecutorOptions options_;
+  Catalog* catalog_;  // Not owned.
+  TypeFactory type_factory_;
+  std::unique_ptr<ParsedScript> parsed_script_;
+
+  absl::flat_hash_map<const ControlFlowNode*, std::unique_ptr<CachedNode>>
+      cached_nodes_;
+  absl::flat_hash_map<const ControlFlowEdge*, ControlFlowEdge::SideEffects>
+      side_effects_;
+
+  std::map<std::string, Value> variables_;
+  // The errors being handled, innermost last.
+  std::vector<zetasql_base::Status> exceptions_;
+
+  int64_t num_analyzed_nodes_ = 0;
+  int64_t num_executed_nodes_ = 0;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_SCRIPTING_SIMPLE_SCRIPT_EXECUTOR_H_
@@ -0,0 +1,161 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/scripting/simple_script_executor.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::zetasql_base::testing::StatusIs;
+
+class SimpleScriptExecutorTest : public ::testing::Test {
+ protected:
+  SimpleScriptExecutorTest() : catalog_("test_catalog") {
+    catalog_.AddZetaSQLFunctions();
+    options_.query_result_callback =
+        [this](const ScriptSegment& segment,
+               EvaluatorTableIterator* iterator) -> zetasql_base::Status {
+      while (iterator->NextRow()) {
+        query_results_.push_back(iterator->GetValue(0));
+      }
+      return iterator->Status();
+    };
+  }
+
+  zetasql_base::StatusOr<std::unique_ptr<SimpleScriptExecutor>> Create(
+      const std::string& script) {
+    return SimpleScriptExecutor::Create(script, options_, &catalog_);
+  }
+
+  SimpleCatalog catalog_;
+  SimpleScriptExecutorOptions options_;
+  std::vector<Value> query_results_;
+};
+
+TEST_F(SimpleScriptExecutorTest, WhileLoopAnalyzesBodyOnce) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SimpleScriptExecutor> executor,
+                       Create("DECLARE x INT64 DEFAULT 0;\n"
+                              "DECLARE total INT64 DEFAULT 0;\n"
+                              "WHILE x < 100 DO\n"
+                              "  SET x = x + 1;\n"
+                              "  SET total = total + x;\n"
+                              "END WHILE;"));
+  ZETASQL_ASSERT_OK(executor->Execute());
+  EXPECT_EQ(Value::Int64(100), executor->variables().at("x"));
+  EXPECT_EQ(Value::Int64(5050), executor->variables().at("total"));
+  // Two declarations, 101 conditions and 200 assignments.
+  EXPECT_EQ(303, executor->num_executed_nodes());
+  EXPECT_EQ(5, executor->num_analyzed_nodes());
+
+  // Running again reuses all of the analyses.
+  ZETASQL_ASSERT_OK(executor->Execute());
+  EXPECT_EQ(Value::Int64(5050), executor->variables().at("total"));
+  EXPECT_EQ(606, executor->num_executed_nodes());
+  EXPECT_EQ(5, executor->num_analyzed_nodes());
+}
+
+TEST_F(SimpleScriptExecutorTest, LoopWithBreakAndContinue) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SimpleScriptExecutor> executor,
+                       Create("DECLARE i, odd_sum INT64 DEFAULT 0;\n"
+                              "LOOP\n"
+                              "  SET i = i + 1;\n"
+                              "  IF i > 9 THEN BREAK;\n"
+                              "  ELSEIF MOD(i, 2) = 0 THEN CONTINUE;\n"
+                              "  END IF;\n"
+                              "  SET odd_sum = odd_sum + i;\n"
+                              "END LOOP;"));
+  ZETASQL_ASSERT_OK(executor->Execute());
+  EXPECT_EQ(Value::Int64(10), executor->variables().at("i"));
+  EXPECT_EQ(Value::Int64(25), executor->variables().at("odd_sum"));
+}
+
+TEST_F(SimpleScriptExecutorTest, QueriesSeeVariablesAsParameters) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SimpleScriptExecutor> executor,
+                       Create("DECLARE n DEFAULT 3;\n"
+                              "DECLARE label STRING;\n"
+                              "WHILE n > 0 DO\n"
+                              "  SELECT @n * 10;\n"
+                              "  SET n = n - 1;\n"
+                              "END WHILE;\n"
+                              "SELECT IFNULL(@label, 'none');"));
+  ZETASQL_ASSERT_OK(executor->Execute());
+  EXPECT_THAT(query_results_,
+              ElementsAre(Value::Int64(30), Value::Int64(20), Value::Int64(10),
+                          Value::String("none")));
+  EXPECT_EQ(6, executor->num_analyzed_nodes());
+}
+
+TEST_F(SimpleScriptExecutorTest, ExceptionHandler) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SimpleScriptExecutor> executor,
+                       Create("DECLARE handled BOOL DEFAULT FALSE;\n"
+                              "BEGIN\n"
+                              "  DECLARE y DOUBLE DEFAULT 1 / 0;\n"
+                              "EXCEPTION WHEN ERROR THEN\n"
+                              "  SET handled = TRUE;\n"
+                              "END;"));
+  ZETASQL_ASSERT_OK(executor->Execute());
+  EXPECT_EQ(Value::Bool(true), executor->variables().at("handled"));
+  EXPECT_EQ(0, executor->variables().count("y"));
+}
+
+TEST_F(SimpleScriptExecutorTest, RaiseAndReraise) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SimpleScriptExecutor> executor,
+                       Create("BEGIN\n"
+                              "  RAISE USING MESSAGE = CONCAT('bo', 'om');\n"
+                              "EXCEPTION WHEN ERROR THEN\n"
+                              "  RAISE;\n"
+                              "END;"));
+  EXPECT_THAT(executor->Execute(), StatusIs(_, HasSubstr("boom")));
+}
+
+TEST_F(SimpleScriptExecutorTest, AnalysisErrorsAreNotHandled) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SimpleScriptExecutor> executor,
+                       Create("DECLARE x INT64;\n"
+                              "BEGIN\n"
+                              "  SET x = 'a';\n"
+                              "EXCEPTION WHEN ERROR THEN\n"
+                              "  SELECT 1;\n"
+                              "END;"));
+  EXPECT_THAT(executor->Execute(),
+              StatusIs(zetasql_base::StatusCode::kInvalidArgument,
+                       HasSubstr("INT64")));
+  EXPECT_TRUE(query_results_.empty());
+}
+
+TEST_F(SimpleScriptExecutorTest, MaxExecutedNodes) {
+  options_.max_executed_nodes = 100;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SimpleScriptExecutor> executor,
+                       Create("LOOP\nEND LOOP;"));
+  EXPECT_THAT(executor->Execute(),
+              StatusIs(zetasql_base::StatusCode::kResourceExhausted));
+}
+
+}  // namespace
+}  // namespace zetasql